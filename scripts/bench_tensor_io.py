@@ -14,12 +14,13 @@ import torch_xla.core.xla_model as xm
 def run_benchmark(args, pos_args):
   devices = xm.get_xla_supported_devices(max_devices=args.max_devices)
   shape = [int(x) for x in args.shape.split(',')]
+  dtype = getattr(torch, args.dtype)
 
   send_list = []
   for i in range(0, len(devices)):
     mb = []
     for j in range(0, args.prefetch):
-      mb.append(torch.randn(*shape))
+      mb.append(torch.randn(*shape).to(dtype))
     send_list.append(mb)
 
   def threadfn(i):
@@ -46,5 +47,8 @@ if __name__ == '__main__':
   arg_parser.add_argument('--max_devices', type=int, default=None)
   # Same size as resnet50 bs=128 but avoid re-layout to drop tensor transform cost.
   arg_parser.add_argument('--shape', type=str, default='384,224,224')
+  # Use float32 with XLA_USE_BF16=1, or int64 with XLA_USE_32BIT_LONG=1, to
+  # measure the type converting copies.
+  arg_parser.add_argument('--dtype', type=str, default='float32')
   args, pos_args = arg_parser.parse_known_args()
   run_benchmark(args, pos_args)
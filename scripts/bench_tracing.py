@@ -0,0 +1,61 @@
+#!/usr/bin/env python
+
+from __future__ import print_function
+
+import argparse
+import time
+import torch
+import torch_xla
+import torch_xla.debug.metrics as met
+import torch_xla.core.xla_model as xm
+
+# The elementwise and reduction ops traced by every layer. They only build IR
+# nodes (no graph gets compiled or run within the timed loop), so the time
+# reported is the one of the node construction, shape functions included.
+_UNARY_OPS = [
+    torch.sigmoid, torch.sqrt, torch.exp, torch.tanh, torch.abs, torch.neg,
+    torch.rsqrt, torch.reciprocal
+]
+
+
+def trace_layer(x, y):
+  for op in _UNARY_OPS:
+    x = op(x)
+  x = torch.maximum(x, y) + torch.minimum(x, y)
+  x = x * y - y / 2.0
+  mask = torch.logical_and(x > 0, y < 1)
+  x = torch.where(mask, x, y)
+  return x.sum(dim=-1, keepdim=True) + x.mean(dim=-1, keepdim=True)
+
+
+def run_benchmark(args, pos_args):
+  device = xm.xla_device()
+  shape = [int(x) for x in args.shape.split(',')]
+  x = torch.randn(*shape, device=device)
+  y = torch.randn(*shape, device=device)
+  xm.mark_step()
+
+  times = []
+  for n in range(0, args.test_count):
+    start = time.time()
+    z = x
+    for _ in range(0, args.layers):
+      z = trace_layer(z, y)
+    times.append(time.time() - start)
+    # Drop the traced graph without running it.
+    del z
+  times = sorted(times)
+  print('Tracing {} layers: min={:.3f}ms median={:.3f}ms'.format(
+      args.layers, times[0] * 1000.0, times[len(times) // 2] * 1000.0))
+  if args.metrics:
+    print(met.metrics_report())
+
+
+if __name__ == '__main__':
+  arg_parser = argparse.ArgumentParser()
+  arg_parser.add_argument('--test_count', type=int, default=20)
+  arg_parser.add_argument('--layers', type=int, default=100)
+  arg_parser.add_argument('--shape', type=str, default='64,1024')
+  arg_parser.add_argument('--metrics', action='store_true')
+  args, pos_args = arg_parser.parse_known_args()
+  run_benchmark(args, pos_args)
@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""
+Decodes the files of the function call tracker in binary mode
+(XLA_FNTRACKER_MODE=binary), and prints the calls by tag, to spot the hot
+functions, or their timeline.
+"""
+
+import argparse
+import collections
+import struct
+import sys
+
+MAGIC = b'XLAFNTR1'
+RECORD = struct.Struct('=qIi')
+
+
+class Reader(object):
+
+  def __init__(self, data):
+    self.data = data
+    self.offset = 0
+
+  def read(self, fmt):
+    values = struct.unpack_from(fmt, self.data, self.offset)
+    self.offset += struct.calcsize(fmt)
+    return values[0] if len(values) == 1 else values
+
+  def read_bytes(self, size):
+    data = self.data[self.offset:self.offset + size]
+    self.offset += size
+    return data
+
+
+def decode(path):
+  """Returns the tags, and the threads as (ID, DROPPED, RECORDS) tuples, with
+  the RECORDS a list of (TIMESTAMP_NS, TAG, LEVEL) tuples."""
+  with open(path, 'rb') as f:
+    reader = Reader(f.read())
+  if reader.read_bytes(len(MAGIC)) != MAGIC:
+    raise RuntimeError('{} is not a function tracker file'.format(path))
+  tags = []
+  for _ in range(reader.read('=I')):
+    tags.append(reader.read_bytes(reader.read('=I')).decode('utf-8'))
+  threads = []
+  for _ in range(reader.read('=I')):
+    thread_id, dropped, count = reader.read('=QQI')
+    records = []
+    for _ in range(count):
+      timestamp_ns, tag, level = RECORD.unpack_from(reader.data, reader.offset)
+      reader.offset += RECORD.size
+      records.append((timestamp_ns, tags[tag], level))
+    threads.append((thread_id, dropped, records))
+  return tags, threads
+
+
+def print_summary(threads, topn):
+  counts = collections.Counter()
+  timestamps = []
+  for _, _, records in threads:
+    for timestamp_ns, tag, _ in records:
+      counts[tag] += 1
+      timestamps.append(timestamp_ns)
+  total = sum(counts.values())
+  dropped = sum(thread[1] for thread in threads)
+  print('{} calls over {} threads, {} overwritten'.format(
+      total, len(threads), dropped))
+  if timestamps:
+    print('Time span: {:.3f}s'.format(
+        (max(timestamps) - min(timestamps)) * 1e-9))
+  print('{:>10} {:>7}  {}'.format('CALLS', 'PCT', 'TAG'))
+  for tag, count in counts.most_common(topn):
+    print('{:>10} {:>6.2f}%  {}'.format(count, 100.0 * count / total, tag))
+
+
+def print_timeline(threads):
+  events = []
+  for thread_id, _, records in threads:
+    for timestamp_ns, tag, level in records:
+      events.append((timestamp_ns, thread_id, tag, level))
+  events.sort()
+  start = events[0][0] if events else 0
+  for timestamp_ns, thread_id, tag, level in events:
+    print('{:>14.6f} {:016x} {} (level {})'.format(
+        (timestamp_ns - start) * 1e-9, thread_id, tag, level))
+
+
+def parse_args():
+  parser = argparse.ArgumentParser()
+  parser.add_argument('path', help='The binary function tracker file')
+  parser.add_argument(
+      '--timeline',
+      '-t',
+      action='store_true',
+      help='Print the calls in time order, rather than their counts')
+  parser.add_argument('--topn', '-n', type=int, default=50)
+  return parser.parse_args()
+
+
+def main():
+  args = parse_args()
+  _, threads = decode(args.path)
+  if args.timeline:
+    print_timeline(threads)
+  else:
+    print_summary(threads, args.topn)
+
+
+if __name__ == '__main__':
+  sys.exit(main())
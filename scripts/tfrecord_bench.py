@@ -0,0 +1,84 @@
+#!/usr/bin/env python
+
+from __future__ import print_function
+
+import argparse
+import time
+import torch_xla.utils.tf_record_reader as tfrr
+
+
+def create_readers(args, seed):
+  if args.parallelism > 0:
+    yield tfrr.TfRecordInterleavedReader(
+        args.files,
+        compression=args.compression,
+        buffer_size=args.buffer_size,
+        parallelism=args.parallelism,
+        readahead=args.readahead,
+        shuffle=args.shuffle,
+        seed=seed)
+  else:
+    # The baseline, reading the files sequentially.
+    for path in args.files:
+      yield tfrr.TfRecordReader(
+          path, compression=args.compression, buffer_size=args.buffer_size)
+
+
+def read_all(reader, args):
+  num_records, num_bytes = 0, 0
+  while True:
+    if args.batch_size > 0:
+      batch = reader.read_examples(args.batch_size)
+      if batch is None:
+        break
+      num_records += len(next(iter(batch.values()))) if batch else 0
+    else:
+      record = reader.read_record()
+      if record is None:
+        break
+      num_records += 1
+      num_bytes += len(record)
+  return num_records, num_bytes
+
+
+def run_benchmark(args):
+  for n in range(0, args.test_count):
+    ts = time.time()
+    num_records, num_bytes = 0, 0
+    for reader in create_readers(args, n):
+      records, size = read_all(reader, args)
+      num_records += records
+      num_bytes += size
+    elapsed = time.time() - ts
+    report = 'Run {}: {} records in {:.2f}s, {:.1f} records/s'.format(
+        n, num_records, elapsed, num_records / elapsed)
+    if num_bytes > 0:
+      report += ', {:.2f}MB/s'.format(num_bytes / (1024 * 1024 * elapsed))
+    print(report)
+
+
+if __name__ == '__main__':
+  arg_parser = argparse.ArgumentParser()
+  arg_parser.add_argument('--test_count', type=int, default=3)
+  arg_parser.add_argument(
+      '--parallelism',
+      type=int,
+      default=8,
+      help='The number of files read at the same time, 0 for sequential')
+  arg_parser.add_argument('--readahead', type=int, default=64)
+  arg_parser.add_argument('--buffer_size', type=int, default=16 * 1024 * 1024)
+  arg_parser.add_argument('--compression', type=str, default='')
+  arg_parser.add_argument('--shuffle', action='store_true')
+  arg_parser.add_argument(
+      '--batch_size',
+      type=int,
+      default=0,
+      help='If set, parse the records as TfExample batches of this size')
+  arg_parser.add_argument(
+      'files',
+      type=str,
+      nargs='+',
+      metavar='FILE',
+      help='The paths (local or GCS) of the TfRecord files')
+  args = arg_parser.parse_args()
+  run_benchmark(args)
@@ -315,6 +315,9 @@ if re.match(r'clang', os.getenv('CC', '')):
       '-Wno-return-std-move',
   ]
 
+if _check_env_flag('XLA_DISABLE_HOST_TRACING'):
+  extra_compile_args += ['-DXLA_DISABLE_HOST_TRACING']
+
 if DEBUG:
   extra_compile_args += ['-O0', '-g']
   extra_link_args += ['-O0', '-g']
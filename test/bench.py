@@ -101,6 +101,55 @@ class BenchAddMulDivTransfer(BaseBench):
     self.use_results([xla_c])
 
 
+class BenchTopK(BaseBench):
+  # Run with XLA_TOPK_TILE_SIZE=0 to compare with the full sort of the
+  # vocabulary.
+  vocab_scale = 1
+
+  def setup(self):
+    vocab_size = xu.getenv_as('TOPK_VOCAB_SIZE', int, 32000)
+    self.k = xu.getenv_as('TOPK_K', int, 50)
+    self.xla_logits = torch.randn(32, self.vocab_scale * vocab_size).to(
+        self.device)
+
+  def bench(self):
+    values, indices = torch.topk(self.xla_logits, self.k)
+    self.use_results([values, indices])
+
+
+class BenchTopKLargeVocab(BenchTopK):
+  vocab_scale = 8
+
+
+class BenchKthValue(BenchTopK):
+
+  def bench(self):
+    values, indices = torch.kthvalue(self.xla_logits, self.k)
+    self.use_results([values, indices])
+
+
+class BenchUpsampleBilinear(BaseBench):
+  # Run with XLA_RESIZE_MATMUL=0 to compare with the resize custom calls (TPU
+  # only).
+  mode = 'bilinear'
+
+  def setup(self):
+    size = xu.getenv_as('UPSAMPLE_SIZE', int, 64)
+    self.xla_input = torch.randn(
+        8, 64, size, size, requires_grad=True, device=self.device)
+
+  def bench(self):
+    kwargs = {'align_corners': False} if self.mode == 'bilinear' else {}
+    output = torch.nn.functional.interpolate(
+        self.xla_input, scale_factor=2, mode=self.mode, **kwargs)
+    grad, = torch.autograd.grad(output.sum(), self.xla_input)
+    self.use_results([output, grad])
+
+
+class BenchUpsampleNearest(BenchUpsampleBilinear):
+  mode = 'nearest'
+
+
 def run_benchmarks(args):
   benchs = {}
   for name, cls in inspect.getmembers(sys.modules[__name__], inspect.isclass):
@@ -0,0 +1,238 @@
+// Measures the latency and bandwidth of the replicated collectives, over the
+// local devices of the default device type, and prints the bus bandwidth in
+// the same convention as the NCCL tests, so that the numbers are comparable
+// across replica counts and collectives.
+// Build it with "run_tests.sh -B -K" and run build/bench_collectives. The
+// XLA_BENCH_MIN_BYTES, XLA_BENCH_MAX_BYTES, XLA_BENCH_WARMUP and XLA_BENCH_ITERS
+// environment variables control the sweep.
+
+#include <ATen/ATen.h>
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+struct Topology {
+  std::string name;
+  std::vector<std::vector<int64_t>> groups;
+  int64_t group_size = 0;
+};
+
+struct Collective {
+  std::string name;
+  // The input elements for a given size in elements, which is the larger of
+  // the input and output buffers, like in the NCCL tests.
+  std::function<int64_t(int64_t, int64_t)> input_elements;
+  // The ratio of the bus bandwidth to the algorithm bandwidth.
+  std::function<double(int64_t)> bus_factor;
+  std::function<xla::XlaOp(xla::XlaOp, xla::XlaOp, const Topology&)> build;
+};
+
+std::vector<Topology> GetTopologies(int64_t num_devices) {
+  std::vector<Topology> topologies;
+  topologies.push_back({"all", {}, num_devices});
+  if (num_devices >= 4 && num_devices % 2 == 0) {
+    // Two independent halves, which run concurrently on the fabric.
+    Topology halves{"halves", {{}, {}}, num_devices / 2};
+    for (int64_t i = 0; i < num_devices; ++i) {
+      halves.groups[i / halves.group_size].push_back(i);
+    }
+    topologies.push_back(std::move(halves));
+  }
+  return topologies;
+}
+
+std::vector<std::pair<int64_t, int64_t>> RingPairs(const Topology& topology,
+                                                   int64_t num_devices) {
+  std::vector<std::vector<int64_t>> groups = topology.groups;
+  if (groups.empty()) {
+    groups.push_back(xla::util::Iota<int64_t>(num_devices));
+  }
+  std::vector<std::pair<int64_t, int64_t>> pairs;
+  for (auto& group : groups) {
+    for (size_t i = 0; i < group.size(); ++i) {
+      pairs.emplace_back(group[i], group[(i + 1) % group.size()]);
+    }
+  }
+  return pairs;
+}
+
+std::vector<Collective> GetCollectives(int64_t num_devices) {
+  auto same = [](int64_t elements, int64_t) { return elements; };
+  auto sharded = [](int64_t elements, int64_t group_size) {
+    return elements / group_size;
+  };
+  auto ring = [](int64_t n) { return static_cast<double>(n - 1) / n; };
+  std::vector<Collective> collectives;
+  collectives.push_back(
+      {"all_reduce", same, [](int64_t n) { return 2.0 * (n - 1) / n; },
+       [](xla::XlaOp x, xla::XlaOp token, const Topology& topology) {
+         return BuildAllReduce(AllReduceType::kSum, {x}, token, 1.0,
+                               topology.groups, /*pin_layout=*/false)[0];
+       }});
+  collectives.push_back(
+      {"all_gather", sharded, ring,
+       [](xla::XlaOp x, xla::XlaOp token, const Topology& topology) {
+         return BuildAllGather(x, token, 0, topology.group_size,
+                               topology.groups, /*pin_layout=*/false)
+             .result;
+       }});
+  collectives.push_back(
+      {"reduce_scatter", same, ring,
+       [](xla::XlaOp x, xla::XlaOp token, const Topology& topology) {
+         return BuildReduceScatter(AllReduceType::kSum, x, token, 1.0, 0,
+                                   topology.group_size, topology.groups,
+                                   /*pin_layout=*/false)
+             .result;
+       }});
+  collectives.push_back(
+      {"all_to_all", same, ring,
+       [](xla::XlaOp x, xla::XlaOp token, const Topology& topology) {
+         return BuildAllToAll(x, token, 0, 0, topology.group_size,
+                              topology.groups, /*pin_layout=*/false)
+             .result;
+       }});
+  collectives.push_back(
+      {"collective_permute", same, [](int64_t) { return 1.0; },
+       [num_devices](xla::XlaOp x, xla::XlaOp token,
+                     const Topology& topology) {
+         return BuildCollectivePermute(x, token,
+                                       RingPairs(topology, num_devices))
+             .result;
+       }});
+  return collectives;
+}
+
+void RunBenchmark(const Collective& collective, const Topology& topology,
+                  xla::PrimitiveType type, int64_t bytes,
+                  const std::vector<std::string>& devices, int64_t warmup,
+                  int64_t iterations) {
+  int64_t elements =
+      bytes / xla::ShapeUtil::ByteSizeOfPrimitiveType(type) /
+      topology.group_size * topology.group_size;
+  int64_t input_elements =
+      collective.input_elements(elements, topology.group_size);
+  if (input_elements == 0) {
+    return;
+  }
+  xla::Shape shape = xla::ShapeUtil::MakeShape(type, {input_elements});
+  xla::XlaBuilder builder(collective.name);
+  xla::XlaOp x = xla::Parameter(&builder, 0, shape, "x");
+  collective.build(x, xla::Zero(&builder, xla::PrimitiveType::F32), topology);
+  xla::XlaComputation computation = ConsumeValue(builder.Build());
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape result_shape = program_shape.result();
+
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.emplace_back(std::move(computation), devices.front(), devices,
+                         &result_shape);
+  auto computations =
+      xla::ComputationClient::Get()->Compile(std::move(instances));
+
+  at::ScalarType scalar_type = type == xla::PrimitiveType::BF16
+                                   ? at::ScalarType::BFloat16
+                                   : at::ScalarType::Float;
+  std::vector<at::Tensor> tensors(
+      devices.size(),
+      at::ones({input_elements}, at::TensorOptions(scalar_type)));
+  auto tensors_data = CreateTensorsData(tensors, devices);
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> arguments;
+  for (auto& data : tensors_data) {
+    arguments.push_back({UnwrapXlaData(data)});
+  }
+
+  xla::ComputationClient::ExecuteReplicatedOptions options;
+  auto execute = [&]() {
+    return xla::ComputationClient::Get()->ExecuteReplicated(
+        *computations.front(), arguments, devices, options);
+  };
+  for (int64_t i = 0; i < warmup; ++i) {
+    execute();
+  }
+  int64_t start = xla::sys_util::NowNs();
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> results;
+  for (int64_t i = 0; i < iterations; ++i) {
+    results = execute();
+  }
+  // Fetching one result waits for the executions which complete
+  // asynchronously.
+  xla::ComputationClient::Get()->TransferFromServer(results.front());
+  double seconds = 1e-9 * (xla::sys_util::NowNs() - start) / iterations;
+
+  int64_t size_bytes =
+      elements * xla::ShapeUtil::ByteSizeOfPrimitiveType(type);
+  double algbw = size_bytes / seconds / 1e9;
+  double busbw = algbw * collective.bus_factor(topology.group_size);
+  std::printf("%-20s %-6s %-8s %12lld %12.1f %10.3f %10.3f\n",
+              collective.name.c_str(),
+              xla::primitive_util::LowercasePrimitiveTypeName(type).c_str(),
+              topology.name.c_str(), static_cast<long long>(size_bytes),
+              seconds * 1e6, algbw, busbw);
+}
+
+}  // namespace
+}  // namespace cpp_test
+}  // namespace torch_xla
+
+int main(int argc, char** argv) {
+  using namespace torch_xla;
+  using namespace torch_xla::cpp_test;
+
+  int64_t min_bytes = xla::sys_util::GetEnvInt("XLA_BENCH_MIN_BYTES", 1024);
+  int64_t max_bytes =
+      xla::sys_util::GetEnvInt("XLA_BENCH_MAX_BYTES", 64 * 1024 * 1024);
+  int64_t warmup = xla::sys_util::GetEnvInt("XLA_BENCH_WARMUP", 5);
+  int64_t iterations = xla::sys_util::GetEnvInt("XLA_BENCH_ITERS", 20);
+
+  std::string default_device =
+      xla::ComputationClient::Get()->GetDefaultDevice();
+  torch::lazy::BackendDevice device_type = ParseDeviceString(default_device);
+  std::vector<std::string> devices;
+  for (auto& device_str : xla::ComputationClient::Get()->GetLocalDevices()) {
+    if (ParseDeviceString(device_str).type() == device_type.type()) {
+      devices.push_back(device_str);
+    }
+  }
+  if (devices.size() < 2) {
+    std::fprintf(stderr, "At least two %s devices are required\n",
+                 default_device.c_str());
+    return 1;
+  }
+  xla::ComputationClient::Get()->SetReplicationDevices(
+      std::make_shared<std::vector<std::string>>(devices));
+
+  std::printf("# %zu replicas, %lld warmup and %lld timed iterations\n",
+              devices.size(), static_cast<long long>(warmup),
+              static_cast<long long>(iterations));
+  std::printf("%-20s %-6s %-8s %12s %12s %10s %10s\n", "collective", "type",
+              "groups", "bytes", "time(us)", "algbw", "busbw");
+  std::vector<Topology> topologies = GetTopologies(devices.size());
+  for (auto& collective : GetCollectives(devices.size())) {
+    for (auto type : {xla::PrimitiveType::F32, xla::PrimitiveType::BF16}) {
+      for (auto& topology : topologies) {
+        for (int64_t bytes = min_bytes; bytes <= max_bytes; bytes *= 2) {
+          RunBenchmark(collective, topology, type, bytes, devices, warmup,
+                       iterations);
+        }
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,242 @@
+// Microbenchmarks of the host side of the lazy tensor path: the ATen dispatch
+// of a single op, the build (and hashing) of the IR of synthetic N ops graphs,
+// their post-order and lowering, the collection of many live tensors for a
+// sync, the output shape inference, and the cache lookups. Nothing gets
+// executed on the device, but for the upload of the inputs.
+// Build it with "run_tests.sh -B -K" and run build/bench_host_path. Every
+// benchmark runs for at least XLA_BENCH_MIN_TIME seconds (default 0.5), and
+// XLA_BENCH_FILTER (a substring of the names) selects the ones to run. If
+// XLA_BENCH_JSON is set, the results are also written to that file, in the
+// Google Benchmark JSON format, so that they can be tracked by commit.
+
+#include <ATen/ATen.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch/csrc/lazy/core/ir_util.h"
+#include "torch_xla/csrc/aten_xla_bridge.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/ir_util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+struct BenchResult {
+  std::string name;
+  int64_t iterations = 0;
+  double ns_per_iteration = 0.0;
+  // The items (like IR nodes) processed by every iteration, 0 if not
+  // meaningful.
+  int64_t items = 0;
+};
+
+// Keeps the compiler from dropping the benchmarked computations.
+volatile size_t g_sink = 0;
+
+// Runs fn (which runs the given number of iterations of the benchmarked code)
+// with a growing number of iterations, until a run takes at least
+// min_seconds.
+BenchResult RunBenchmark(const std::string& name, int64_t items,
+                         double min_seconds,
+                         const std::function<void(int64_t)>& fn) {
+  // A first short run warms up the caches.
+  fn(1);
+  BenchResult result;
+  result.name = name;
+  result.items = items;
+  for (int64_t iterations = 1;; iterations *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    fn(iterations);
+    double seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count();
+    if (seconds >= min_seconds || iterations >= (int64_t(1) << 30)) {
+      result.iterations = iterations;
+      result.ns_per_iteration = seconds * 1e9 / iterations;
+      return result;
+    }
+  }
+}
+
+XLATensorPtr BuildChain(const XLATensorPtr& input, int64_t num_ops) {
+  XLATensorPtr result = input;
+  for (int64_t i = 0; i < num_ops; i += 2) {
+    result = XLATensor::add(result, input, 1.0);
+    result = XLATensor::mul(result, 0.5);
+  }
+  return result;
+}
+
+void WriteJson(const std::string& path, const std::string& device,
+               const std::vector<BenchResult>& results) {
+  std::ofstream file(path);
+  file << "{\n  \"context\": {\"device\": \"" << device
+       << "\", \"library_build_type\": \"release\"},\n  \"benchmarks\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult& result = results[i];
+    file << "    {\"name\": \"" << result.name
+         << "\", \"run_type\": \"iteration\", \"iterations\": "
+         << result.iterations << ", \"real_time\": " << result.ns_per_iteration
+         << ", \"cpu_time\": " << result.ns_per_iteration
+         << ", \"time_unit\": \"ns\"";
+    if (result.items > 0) {
+      file << ", \"items_per_second\": "
+           << result.items * 1e9 / result.ns_per_iteration;
+    }
+    file << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  file << "  ]\n}\n";
+}
+
+}  // namespace
+}  // namespace cpp_test
+}  // namespace torch_xla
+
+int main(int argc, char** argv) {
+  using namespace torch_xla;
+  using namespace torch_xla::cpp_test;
+
+  std::string default_device =
+      xla::ComputationClient::Get()->GetDefaultDevice();
+  torch::lazy::BackendDevice device = ParseDeviceString(default_device);
+  SetCurrentDevice(device);
+  double min_seconds =
+      xla::sys_util::GetEnvDouble("XLA_BENCH_MIN_TIME", 0.5);
+  std::string filter = xla::sys_util::GetEnvString("XLA_BENCH_FILTER", "");
+  std::string json_path = xla::sys_util::GetEnvString("XLA_BENCH_JSON", "");
+
+  std::vector<BenchResult> results;
+  auto run = [&](const std::string& name, int64_t items,
+                 const std::function<void(int64_t)>& fn) {
+    if (name.find(filter) == std::string::npos) {
+      return;
+    }
+    results.push_back(RunBenchmark(name, items, min_seconds, fn));
+    const BenchResult& result = results.back();
+    std::printf("%-32s %12lld %14.1f ns", result.name.c_str(),
+                static_cast<long long>(result.iterations),
+                result.ns_per_iteration);
+    if (result.items > 0) {
+      std::printf(" %14.0f items/s",
+                  result.items * 1e9 / result.ns_per_iteration);
+    }
+    std::printf("\n");
+  };
+
+  at::Tensor cpu_tensor = at::rand({8, 8}, at::TensorOptions(at::kFloat));
+  at::Tensor xla_a = bridge::CreateXlaTensor(cpu_tensor, device);
+  at::Tensor xla_b = bridge::CreateXlaTensor(cpu_tensor + 1.0, device);
+  XLATensorPtr input = bridge::GetXlaTensor(xla_a);
+
+  std::printf("# %s device\n", default_device.c_str());
+  std::printf("%-32s %12s %17s\n", "benchmark", "iterations", "time");
+  run("Dispatch/add", 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      at::Tensor result = xla_a + xla_b;
+      g_sink += result.dim();
+    }
+  });
+  run("Dispatch/add_", 1, [&](int64_t iterations) {
+    at::Tensor result = xla_a.clone();
+    for (int64_t i = 0; i < iterations; ++i) {
+      result.add_(xla_b);
+    }
+    g_sink += result.dim();
+  });
+
+  for (int64_t num_ops : {100, 1000, 10000}) {
+    std::string suffix = std::to_string(num_ops);
+    run("IrBuildAndHash/" + suffix, num_ops, [&](int64_t iterations) {
+      for (int64_t i = 0; i < iterations; ++i) {
+        XLATensorPtr result = BuildChain(input, num_ops);
+        g_sink += result->GetIrValue().hash();
+      }
+    });
+    XLATensorPtr root = BuildChain(input, num_ops);
+    torch::lazy::Value root_value = root->GetIrValue();
+    run("PostOrder/" + suffix, num_ops, [&](int64_t iterations) {
+      for (int64_t i = 0; i < iterations; ++i) {
+        torch::lazy::Util::EmissionMap emission_map;
+        g_sink += Util::ComputePostOrder(root_value.node.get(), &emission_map)
+                      .size();
+      }
+    });
+    run("Lowering/" + suffix, num_ops, [&](int64_t iterations) {
+      for (int64_t i = 0; i < iterations; ++i) {
+        torch::lazy::Util::EmissionMap emission_map;
+        std::vector<const torch::lazy::Node*> post_order =
+            Util::ComputePostOrder(root_value.node.get(), &emission_map);
+        LoweringContext lowering_ctx("BenchLowering", device, post_order,
+                                     std::move(emission_map));
+        g_sink += lowering_ctx.GetParametersData().size();
+      }
+    });
+  }
+
+  for (int64_t num_tensors : {100, 10000}) {
+    // Tensors holding device data only, so that the sync has nothing to
+    // execute, and is all about collecting the tensors.
+    std::vector<XLATensorPtr> tensors;
+    for (int64_t i = 0; i < num_tensors; ++i) {
+      tensors.push_back(XLATensor::clone(input));
+    }
+    run("SyncDataTensors/" + std::to_string(num_tensors), num_tensors,
+        [&](int64_t iterations) {
+          for (int64_t i = 0; i < iterations; ++i) {
+            XLATensor::SyncTensorsGraph(&tensors, {}, /*wait=*/true,
+                                        /*sync_xla_data=*/false);
+          }
+        });
+  }
+
+  xla::Shape shape1 = xla::ShapeUtil::MakeShape(xla::F32, {64, 1, 32});
+  xla::Shape shape2 = xla::ShapeUtil::MakeShape(xla::F32, {1, 16, 32});
+  auto add_fn = [](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    return operands[0] + operands[1];
+  };
+  run("InferOutputShape/add", 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      g_sink += InferOutputShape({shape1, shape2}, add_fn).rank();
+    }
+  });
+  run("InferBinaryOpShape/add", 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      g_sink += InferBinaryOpShape(shape1, shape2, add_fn).rank();
+    }
+  });
+
+  xla::util::Cache<int64_t, int64_t> cache(1024);
+  for (int64_t i = 0; i < 1024; ++i) {
+    cache.Add(i, std::make_shared<int64_t>(i));
+  }
+  run("CacheGet/hit", 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      g_sink += cache.Get(i & 1023) != nullptr;
+    }
+  });
+  run("CacheGet/miss", 1, [&](int64_t iterations) {
+    for (int64_t i = 0; i < iterations; ++i) {
+      g_sink += cache.Get(1024 + i) != nullptr;
+    }
+  });
+
+  if (!json_path.empty()) {
+    WriteJson(json_path, default_device, results);
+  }
+  return 0;
+}
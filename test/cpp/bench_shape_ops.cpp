@@ -0,0 +1,174 @@
+// Compares the execution time of the roll and repeat lowerings against the
+// previous ones, which concatenated copies of the input, both on their own and
+// followed by an elementwise consumer they can fuse into. Every variant runs on
+// the default device with the same input and the results are checked to match.
+// Build it with "run_tests.sh -B -K" and run build/bench_shape_ops. The
+// XLA_BENCH_SIZE (elements per side of the square input), XLA_BENCH_WARMUP and
+// XLA_BENCH_ITERS environment variables control the runs.
+
+#include <ATen/ATen.h>
+
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/data_ops.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/tensor_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+using BuildFn = std::function<xla::XlaOp(xla::XlaOp)>;
+
+struct Variant {
+  std::string name;
+  BuildFn current;
+  BuildFn previous;
+};
+
+// The roll lowering before the slicing one: the output is sliced out of the
+// concatenation of two copies of the input.
+xla::XlaOp PreviousRoll(xla::XlaOp input, int64_t shift, int64_t dim) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t dim_size = input_shape.dimensions(dim);
+  int64_t offset = ((shift % dim_size) + dim_size) % dim_size;
+  xla::XlaOp concat = xla::ConcatInDim(input.builder(), {input, input}, dim);
+  std::vector<xla::XlaOp> start_indices(
+      input_shape.rank(), xla::Zero(input.builder(), xla::PrimitiveType::S64));
+  start_indices[dim] = XlaHelpers::ScalarValue(
+      dim_size - offset, xla::PrimitiveType::S64, input.builder());
+  return xla::DynamicSlice(concat, start_indices, input_shape.dimensions());
+}
+
+// The repeat lowering before the broadcasting one: one concatenation of the
+// copies per dimension.
+xla::XlaOp PreviousRepeat(xla::XlaOp input,
+                          absl::Span<const int64_t> repeats) {
+  xla::XlaOp repeated = input;
+  for (size_t dim = 0; dim < repeats.size(); ++dim) {
+    std::vector<xla::XlaOp> repeated_inputs(repeats[dim], repeated);
+    repeated = xla::ConcatInDim(input.builder(), repeated_inputs, dim);
+  }
+  return repeated;
+}
+
+std::vector<Variant> GetVariants() {
+  auto consumer = [](BuildFn fn) -> BuildFn {
+    return [fn](xla::XlaOp input) {
+      xla::XlaOp output = fn(input);
+      return xla::Add(xla::Mul(output, output), output);
+    };
+  };
+  std::vector<Variant> variants;
+  variants.push_back({"roll(1, dim=0)",
+                      [](xla::XlaOp x) { return BuildRoll(x, {1}, {0}); },
+                      [](xla::XlaOp x) { return PreviousRoll(x, 1, 0); }});
+  variants.push_back({"roll(-3, dim=1)",
+                      [](xla::XlaOp x) { return BuildRoll(x, {-3}, {1}); },
+                      [](xla::XlaOp x) { return PreviousRoll(x, -3, 1); }});
+  variants.push_back({"repeat(2, 2)",
+                      [](xla::XlaOp x) { return BuildRepeat(x, {2, 2}); },
+                      [](xla::XlaOp x) { return PreviousRepeat(x, {2, 2}); }});
+  variants.push_back({"repeat(1, 4)",
+                      [](xla::XlaOp x) { return BuildRepeat(x, {1, 4}); },
+                      [](xla::XlaOp x) { return PreviousRepeat(x, {1, 4}); }});
+  size_t num_variants = variants.size();
+  for (size_t i = 0; i < num_variants; ++i) {
+    variants.push_back({variants[i].name + " + mul/add",
+                        consumer(variants[i].current),
+                        consumer(variants[i].previous)});
+  }
+  return variants;
+}
+
+// Returns the seconds per execution of the computation built by fn, and the
+// output of its last execution.
+double RunBuild(const BuildFn& fn, const std::string& name,
+                const at::Tensor& tensor, const std::string& device,
+                int64_t warmup, int64_t iterations, at::Tensor* output) {
+  xla::Shape shape = CreateComputationShapeFromTensor(tensor, nullptr);
+  xla::XlaBuilder builder(name);
+  fn(xla::Parameter(&builder, 0, shape, "x"));
+  xla::XlaComputation computation = ConsumeValue(builder.Build());
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape result_shape = program_shape.result();
+
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.emplace_back(std::move(computation), device,
+                         xla::ComputationClient::Get()->GetCompilationDevices(
+                             device, {}),
+                         &result_shape);
+  auto computations =
+      xla::ComputationClient::Get()->Compile(std::move(instances));
+  auto tensors_data = CreateTensorsData({tensor}, {device});
+  std::vector<xla::ComputationClient::DataPtr> arguments = {
+      UnwrapXlaData(tensors_data.front())};
+
+  xla::ComputationClient::ExecuteComputationOptions options;
+  auto execute = [&]() {
+    return xla::ComputationClient::Get()->ExecuteComputation(
+        *computations.front(), arguments, device, options);
+  };
+  for (int64_t i = 0; i < warmup; ++i) {
+    execute();
+  }
+  int64_t start = xla::sys_util::NowNs();
+  std::vector<xla::ComputationClient::DataPtr> results;
+  for (int64_t i = 0; i < iterations; ++i) {
+    results = execute();
+  }
+  // Fetching the result waits for the executions which complete
+  // asynchronously.
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::Get()->TransferFromServer(results);
+  double seconds = 1e-9 * (xla::sys_util::NowNs() - start) / iterations;
+  *output = MakeTensorFromXlaLiteral(literals.front(), tensor.scalar_type());
+  return seconds;
+}
+
+}  // namespace
+}  // namespace cpp_test
+}  // namespace torch_xla
+
+int main(int argc, char** argv) {
+  using namespace torch_xla;
+  using namespace torch_xla::cpp_test;
+
+  int64_t size = xla::sys_util::GetEnvInt("XLA_BENCH_SIZE", 2048);
+  int64_t warmup = xla::sys_util::GetEnvInt("XLA_BENCH_WARMUP", 5);
+  int64_t iterations = xla::sys_util::GetEnvInt("XLA_BENCH_ITERS", 50);
+
+  std::string device = xla::ComputationClient::Get()->GetDefaultDevice();
+  at::Tensor input =
+      at::rand({size, size}, at::TensorOptions(at::ScalarType::Float));
+
+  std::printf("# %s, %lldx%lld f32 input, %lld warmup and %lld timed runs\n",
+              device.c_str(), static_cast<long long>(size),
+              static_cast<long long>(size), static_cast<long long>(warmup),
+              static_cast<long long>(iterations));
+  std::printf("%-24s %14s %14s %9s\n", "op", "previous(us)", "current(us)",
+              "speedup");
+  for (auto& variant : GetVariants()) {
+    at::Tensor previous_output;
+    at::Tensor current_output;
+    double previous = RunBuild(variant.previous, variant.name, input, device,
+                               warmup, iterations, &previous_output);
+    double current = RunBuild(variant.current, variant.name, input, device,
+                              warmup, iterations, &current_output);
+    XLA_CHECK(previous_output.allclose(current_output)) << variant.name;
+    std::printf("%-24s %14.1f %14.1f %8.2fx\n", variant.name.c_str(),
+                previous * 1e6, current * 1e6, previous / current);
+  }
+  return 0;
+}
@@ -0,0 +1,294 @@
+// Measures the end to end step time of small representative models (an MLP,
+// a ResNet basic block and a transformer block), trained with SGD through the
+// whole SyncTensorsGraph, Compile and ExecuteComputation path, and reports the
+// host time of the step phases, together with the compile and execute times
+// collected by the metrics. Meant to run on the CPU client (like with
+// PJRT_DEVICE=CPU or XRT_DEVICE_MAP/XRT_WORKERS for a local CPU device), to
+// catch regressions before they reach the TPU jobs.
+// Build it with "run_tests.sh -B -K" and run build/bench_step_time. The
+// XLA_BENCH_WARMUP (default 3) steps, which include the compilations, are
+// followed by XLA_BENCH_STEPS (default 20) measured ones. If XLA_BENCH_BASELINE
+// names a file of "<model> <median step us>" lines, the medians are compared
+// against it, and the run fails if one is more than XLA_BENCH_TOLERANCE
+// (default 0.1) slower. XLA_BENCH_UPDATE_BASELINE=1 rewrites the file instead.
+
+#include <ATen/ATen.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "metrics_snapshot.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/aten_xla_bridge.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/step_breakdown.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+struct Model {
+  std::string name;
+  std::vector<at::Tensor> parameters;
+  // Runs the forward pass and returns the loss.
+  std::function<at::Tensor()> forward;
+};
+
+struct ModelResult {
+  std::string name;
+  double median_step_us = 0.0;
+  double compile_ms = 0.0;
+  double execute_us = 0.0;
+  // The mean host time of the phases, over the measured steps.
+  std::array<double, step_breakdown::kNumPhases> phase_us = {};
+};
+
+at::Tensor MakeParameter(at::IntArrayRef sizes,
+                         const torch::lazy::BackendDevice& device) {
+  at::Tensor cpu = at::randn(sizes, at::TensorOptions(at::kFloat)) * 0.1;
+  return bridge::CreateXlaTensor(cpu, device).requires_grad_();
+}
+
+at::Tensor MakeInput(at::IntArrayRef sizes,
+                     const torch::lazy::BackendDevice& device) {
+  return bridge::CreateXlaTensor(
+      at::randn(sizes, at::TensorOptions(at::kFloat)), device);
+}
+
+Model MakeMlp(const torch::lazy::BackendDevice& device) {
+  Model model;
+  model.name = "mlp";
+  at::Tensor input = MakeInput({64, 256}, device);
+  at::Tensor w1 = MakeParameter({512, 256}, device);
+  at::Tensor b1 = MakeParameter({512}, device);
+  at::Tensor w2 = MakeParameter({10, 512}, device);
+  at::Tensor b2 = MakeParameter({10}, device);
+  model.parameters = {w1, b1, w2, b2};
+  model.forward = [=]() {
+    at::Tensor hidden = at::relu(at::linear(input, w1, b1));
+    return at::linear(hidden, w2, b2).pow(2).mean();
+  };
+  return model;
+}
+
+Model MakeResNetBlock(const torch::lazy::BackendDevice& device) {
+  Model model;
+  model.name = "resnet_block";
+  at::Tensor input = MakeInput({8, 32, 16, 16}, device);
+  at::Tensor conv1 = MakeParameter({32, 32, 3, 3}, device);
+  at::Tensor conv2 = MakeParameter({32, 32, 3, 3}, device);
+  at::Tensor bn_weight = MakeParameter({32}, device);
+  at::Tensor bn_bias = MakeParameter({32}, device);
+  model.parameters = {conv1, conv2, bn_weight, bn_bias};
+  model.forward = [=]() {
+    auto batch_norm = [&](const at::Tensor& x) {
+      return at::batch_norm(x, bn_weight, bn_bias, /*running_mean=*/{},
+                            /*running_var=*/{}, /*training=*/true,
+                            /*momentum=*/0.1, /*eps=*/1e-5,
+                            /*cudnn_enabled=*/false);
+    };
+    at::Tensor x = at::relu(batch_norm(
+        at::conv2d(input, conv1, /*bias=*/{}, /*stride=*/1, /*padding=*/1)));
+    x = batch_norm(at::conv2d(x, conv2, /*bias=*/{}, /*stride=*/1,
+                              /*padding=*/1));
+    return at::relu(x + input).mean();
+  };
+  return model;
+}
+
+Model MakeTransformerBlock(const torch::lazy::BackendDevice& device) {
+  static const int64_t kBatch = 8;
+  static const int64_t kSequence = 64;
+  static const int64_t kModel = 128;
+  static const int64_t kHeads = 4;
+  Model model;
+  model.name = "transformer_block";
+  at::Tensor input = MakeInput({kBatch, kSequence, kModel}, device);
+  at::Tensor qkv = MakeParameter({3 * kModel, kModel}, device);
+  at::Tensor proj = MakeParameter({kModel, kModel}, device);
+  at::Tensor ff1 = MakeParameter({4 * kModel, kModel}, device);
+  at::Tensor ff2 = MakeParameter({kModel, 4 * kModel}, device);
+  at::Tensor ln_weight = MakeParameter({kModel}, device);
+  at::Tensor ln_bias = MakeParameter({kModel}, device);
+  model.parameters = {qkv, proj, ff1, ff2, ln_weight, ln_bias};
+  model.forward = [=]() {
+    auto layer_norm = [&](const at::Tensor& x) {
+      return at::layer_norm(x, {kModel}, ln_weight, ln_bias);
+    };
+    auto heads = [&](const at::Tensor& x) {
+      return x.view({kBatch, kSequence, kHeads, kModel / kHeads})
+          .transpose(1, 2);
+    };
+    std::vector<at::Tensor> q_k_v =
+        at::linear(layer_norm(input), qkv).chunk(3, -1);
+    at::Tensor scores =
+        at::matmul(heads(q_k_v[0]), heads(q_k_v[1]).transpose(-2, -1)) /
+        std::sqrt(static_cast<double>(kModel / kHeads));
+    at::Tensor attention = at::matmul(at::softmax(scores, -1), heads(q_k_v[2]))
+                               .transpose(1, 2)
+                               .reshape({kBatch, kSequence, kModel});
+    at::Tensor x = input + at::linear(attention, proj);
+    x = x + at::linear(at::gelu(at::linear(layer_norm(x), ff1)), ff2);
+    return x.pow(2).mean();
+  };
+  return model;
+}
+
+void RunStep(const Model& model, const torch::lazy::BackendDevice& device) {
+  at::Tensor loss = model.forward();
+  loss.backward();
+  {
+    at::NoGradGuard no_grad;
+    for (auto& parameter : model.parameters) {
+      parameter.sub_(parameter.grad(), /*alpha=*/0.01);
+      parameter.mutable_grad() = at::Tensor();
+    }
+  }
+  // What xm.mark_step() does.
+  XLATensor::SyncLiveTensorsGraph(&device, /*devices=*/{}, /*wait=*/true);
+  XLATensor::MarkStep(device);
+}
+
+ModelResult RunModel(const Model& model,
+                     const torch::lazy::BackendDevice& device,
+                     int64_t warmup_steps, int64_t steps) {
+  ModelResult result;
+  result.name = model.name;
+  MetricsSnapshot warmup_start;
+  for (int64_t i = 0; i < warmup_steps; ++i) {
+    RunStep(model, device);
+  }
+  MetricsSnapshot start;
+  result.compile_ms =
+      warmup_start.GetMetricDelta("CompileTime", start).accumulator / 1e6;
+  std::vector<double> step_us;
+  for (int64_t i = 0; i < steps; ++i) {
+    auto step_start = std::chrono::steady_clock::now();
+    RunStep(model, device);
+    step_us.push_back(std::chrono::duration<double, std::micro>(
+                          std::chrono::steady_clock::now() - step_start)
+                          .count());
+  }
+  MetricsSnapshot end;
+  result.execute_us =
+      start.GetMetricDelta("ExecuteTime", end).accumulator / 1e3 / steps;
+  std::sort(step_us.begin(), step_us.end());
+  result.median_step_us = step_us[step_us.size() / 2];
+  std::vector<step_breakdown::StepRecord> records = step_breakdown::GetSteps();
+  size_t num_records = std::min<size_t>(records.size(), steps);
+  for (size_t i = records.size() - num_records; i < records.size(); ++i) {
+    for (size_t phase = 0; phase < step_breakdown::kNumPhases; ++phase) {
+      result.phase_us[phase] +=
+          records[i].phase_ns[phase] / 1e3 / std::max<size_t>(num_records, 1);
+    }
+  }
+  return result;
+}
+
+std::map<std::string, double> LoadBaseline(const std::string& path) {
+  std::map<std::string, double> baseline;
+  std::ifstream file(path);
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string name;
+    double step_us = 0.0;
+    if (line.empty() || line[0] == '#' || !(fields >> name >> step_us)) {
+      continue;
+    }
+    baseline[name] = step_us;
+  }
+  return baseline;
+}
+
+}  // namespace
+}  // namespace cpp_test
+}  // namespace torch_xla
+
+int main(int argc, char** argv) {
+  using namespace torch_xla;
+  using namespace torch_xla::cpp_test;
+
+  // The phases of the steps are only accounted when asked for.
+  setenv("XLA_STEP_BREAKDOWN", "1", /*overwrite=*/0);
+  std::string default_device =
+      xla::ComputationClient::Get()->GetDefaultDevice();
+  torch::lazy::BackendDevice device = ParseDeviceString(default_device);
+  SetCurrentDevice(device);
+  int64_t warmup_steps = xla::sys_util::GetEnvInt("XLA_BENCH_WARMUP", 3);
+  int64_t steps =
+      std::max<int64_t>(xla::sys_util::GetEnvInt("XLA_BENCH_STEPS", 20), 1);
+  std::string baseline_path =
+      xla::sys_util::GetEnvString("XLA_BENCH_BASELINE", "");
+  bool update_baseline =
+      xla::sys_util::GetEnvBool("XLA_BENCH_UPDATE_BASELINE", false);
+  double tolerance = xla::sys_util::GetEnvDouble("XLA_BENCH_TOLERANCE", 0.1);
+  at::manual_seed(42);
+
+  std::vector<ModelResult> results;
+  for (auto& make_model : {MakeMlp, MakeResNetBlock, MakeTransformerBlock}) {
+    results.push_back(
+        RunModel(make_model(device), device, warmup_steps, steps));
+  }
+
+  std::printf("# %s device, %lld warmup and %lld measured steps\n",
+              default_device.c_str(), static_cast<long long>(warmup_steps),
+              static_cast<long long>(steps));
+  std::printf("%-20s %12s %12s %12s", "model", "step(us)", "compile(ms)",
+              "execute(us)");
+  for (size_t phase = 0; phase < step_breakdown::kNumPhases; ++phase) {
+    std::printf(" %12s", step_breakdown::PhaseName(
+                             static_cast<step_breakdown::Phase>(phase)));
+  }
+  std::printf("\n");
+  for (auto& result : results) {
+    std::printf("%-20s %12.0f %12.1f %12.0f", result.name.c_str(),
+                result.median_step_us, result.compile_ms, result.execute_us);
+    for (double phase_us : result.phase_us) {
+      std::printf(" %12.0f", phase_us);
+    }
+    std::printf("\n");
+  }
+
+  if (baseline_path.empty()) {
+    return 0;
+  }
+  if (update_baseline) {
+    std::ofstream file(baseline_path);
+    file << "# model median_step_us (" << default_device << ")\n";
+    for (auto& result : results) {
+      file << result.name << " " << result.median_step_us << "\n";
+    }
+    return 0;
+  }
+  std::map<std::string, double> baseline = LoadBaseline(baseline_path);
+  int status = 0;
+  for (auto& result : results) {
+    auto it = baseline.find(result.name);
+    if (it == baseline.end()) {
+      std::printf("%s: no baseline\n", result.name.c_str());
+      continue;
+    }
+    double ratio = result.median_step_us / std::max(it->second, 1e-3);
+    bool regressed = ratio > 1.0 + tolerance;
+    std::printf("%s: %.0fus vs %.0fus baseline (%+.1f%%)%s\n",
+                result.name.c_str(), result.median_step_us, it->second,
+                (ratio - 1.0) * 100.0, regressed ? " REGRESSION" : "");
+    if (regressed) {
+      status = 1;
+    }
+  }
+  return status;
+}
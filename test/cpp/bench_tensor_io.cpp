@@ -0,0 +1,219 @@
+// Measures the bandwidth of the host to device and device to host tensor
+// paths, split into their host conversion part (GetTensorLiteral(), which
+// runs PopulateTensorBuffer(), and MakeTensorFromXlaLiteral()) and their link
+// part (TransferToServer() of an already packed buffer, and
+// TransferFromServer()), next to the end to end TensorToXlaData() and
+// XlaDataToTensors(). It sweeps the tensor/device type pairs (including the
+// BF16 and F16 downcasts and the 32 bit longs), contiguous, strided and
+// transposed sources, sizes, and the number of caller threads.
+// Build it with "run_tests.sh -B -K" and run build/bench_tensor_io. The
+// XLA_BENCH_MIN_TIME (seconds per measure, default 0.2), XLA_BENCH_MAX_BYTES
+// (default 64MB), XLA_BENCH_MAX_THREADS (default 8) and XLA_BENCH_FILTER (a
+// substring of the path names) environment variables control the runs.
+
+#include <ATen/ATen.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+struct TypePair {
+  at::ScalarType tensor_type;
+  xla::PrimitiveType xla_type;
+};
+
+enum class Layout { kContiguous, kStrided, kTransposed };
+
+const char* LayoutName(Layout layout) {
+  switch (layout) {
+    case Layout::kContiguous:
+      return "contiguous";
+    case Layout::kStrided:
+      return "strided";
+    case Layout::kTransposed:
+      return "transposed";
+  }
+  return "";
+}
+
+// Makes a [rows, 1024] tensor with the given layout: a slice of every other
+// column of a twice as wide tensor for the strided one, and the transpose of
+// a [1024, rows] tensor for the transposed one.
+at::Tensor MakeTensor(at::ScalarType type, int64_t rows, Layout layout) {
+  static const int64_t kColumns = 1024;
+  auto make_base = [&](int64_t dim0, int64_t dim1) {
+    return (at::rand({dim0, dim1}, at::TensorOptions(at::kFloat)) * 100.0)
+        .to(type);
+  };
+  switch (layout) {
+    case Layout::kContiguous:
+      return make_base(rows, kColumns);
+    case Layout::kStrided:
+      return make_base(rows, 2 * kColumns)
+          .slice(/*dim=*/1, /*start=*/0, /*end=*/2 * kColumns, /*step=*/2);
+    case Layout::kTransposed:
+      return make_base(kColumns, rows).t();
+  }
+  return at::Tensor();
+}
+
+// Runs fn on num_threads threads, repeating the runs for at least
+// min_seconds, and returns the bytes per second, given the bytes moved by
+// every call of fn.
+double MeasureBandwidth(int64_t num_threads, double min_seconds,
+                        int64_t bytes, const std::function<void()>& fn) {
+  fn();
+  int64_t calls = 0;
+  auto start = std::chrono::steady_clock::now();
+  double seconds = 0.0;
+  for (int64_t iterations = 1; seconds < min_seconds; iterations *= 2) {
+    std::vector<std::thread> threads;
+    for (int64_t t = 0; t < num_threads; ++t) {
+      threads.emplace_back([&fn, iterations]() {
+        for (int64_t i = 0; i < iterations; ++i) {
+          fn();
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    calls += iterations * num_threads;
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+  }
+  return static_cast<double>(calls * bytes) / seconds;
+}
+
+}  // namespace
+}  // namespace cpp_test
+}  // namespace torch_xla
+
+int main(int argc, char** argv) {
+  using namespace torch_xla;
+  using namespace torch_xla::cpp_test;
+
+  std::string default_device =
+      xla::ComputationClient::Get()->GetDefaultDevice();
+  torch::lazy::BackendDevice device = ParseDeviceString(default_device);
+  double min_seconds =
+      xla::sys_util::GetEnvDouble("XLA_BENCH_MIN_TIME", 0.2);
+  int64_t max_bytes =
+      xla::sys_util::GetEnvInt("XLA_BENCH_MAX_BYTES", 64 << 20);
+  int64_t max_threads = xla::sys_util::GetEnvInt("XLA_BENCH_MAX_THREADS", 8);
+  std::string filter = xla::sys_util::GetEnvString("XLA_BENCH_FILTER", "");
+
+  const std::vector<TypePair> type_pairs = {
+      {at::kFloat, xla::F32},    {at::kFloat, xla::BF16},
+      {at::kFloat, xla::F16},    {at::kDouble, xla::F32},
+      {at::kLong, xla::S64},     {at::kLong, xla::S32},
+      {at::kBFloat16, xla::BF16}, {at::kHalf, xla::F16},
+      {at::kInt, xla::S32},      {at::kByte, xla::U8},
+  };
+  const std::vector<Layout> layouts = {Layout::kContiguous, Layout::kStrided,
+                                       Layout::kTransposed};
+
+  std::printf("# %s device, GB/s of tensor bytes\n", default_device.c_str());
+  std::printf("%-24s %-9s %-5s %-10s %10s %7s %10s\n", "path", "tensor",
+              "xla", "layout", "bytes", "threads", "GB/s");
+  // Measures and reports the path for all the thread counts.
+  auto measure = [&](const std::string& path, const TypePair& pair,
+                     Layout layout, int64_t bytes,
+                     const std::function<void()>& fn) {
+    if (path.find(filter) == std::string::npos) {
+      return;
+    }
+    for (int64_t num_threads = 1; num_threads <= max_threads;
+         num_threads *= 2) {
+      double bandwidth =
+          MeasureBandwidth(num_threads, min_seconds, bytes, fn);
+      std::printf(
+          "%-24s %-9s %-5s %-10s %10lld %7lld %10.3f\n", path.c_str(),
+          c10::toString(pair.tensor_type),
+          xla::primitive_util::LowercasePrimitiveTypeName(pair.xla_type)
+              .c_str(),
+          LayoutName(layout), static_cast<long long>(bytes),
+          static_cast<long long>(num_threads), bandwidth / 1e9);
+    }
+  };
+
+  for (int64_t bytes = 4 << 10; bytes <= max_bytes; bytes *= 16) {
+    for (const TypePair& pair : type_pairs) {
+      int64_t element_size = c10::elementSize(pair.tensor_type);
+      int64_t rows = std::max<int64_t>(bytes / element_size / 1024, 1);
+      int64_t tensor_bytes = rows * 1024 * element_size;
+      xla::Shape shape = MakeShapeWithDeviceLayout(
+          xla::ShapeUtil::MakeShape(pair.xla_type, {rows, 1024}),
+          static_cast<XlaDeviceType>(device.type()));
+      // The end to end paths use the device type of the tensor type, so they
+      // only run for the pairs matching it.
+      bool native_pair =
+          pair.xla_type == MakeXlaPrimitiveType(pair.tensor_type, &device);
+      for (Layout layout : layouts) {
+        at::Tensor tensor = MakeTensor(pair.tensor_type, rows, layout);
+        measure("GetTensorLiteral", pair, layout, tensor_bytes,
+                [&]() { GetTensorLiteral(tensor, &shape, &device); });
+        if (native_pair) {
+          measure("TensorToXlaData", pair, layout, tensor_bytes,
+                  [&]() { TensorToXlaData(tensor, device); });
+        }
+      }
+
+      // The link paths, and the download conversion, do not depend on the
+      // layout of the source tensor.
+      at::Tensor tensor =
+          MakeTensor(pair.tensor_type, rows, Layout::kContiguous);
+      auto literal = std::make_shared<xla::Literal>(
+          GetTensorLiteral(tensor, &shape, &device));
+      int64_t literal_bytes = literal->size_bytes();
+      auto populate_fn = [&](const xla::ComputationClient::TensorSource&,
+                             void* dest, size_t dest_size) {
+        std::memcpy(dest, literal->untyped_data(), dest_size);
+      };
+      measure("TransferToServer", pair, Layout::kContiguous, literal_bytes,
+              [&]() {
+                xla::ComputationClient::TensorSource source(
+                    shape, device.toString(), populate_fn);
+                // The packed buffer can be read in place.
+                source.data = std::shared_ptr<const void>(
+                    literal, literal->untyped_data());
+                xla::ComputationClient::Get()->TransferToServer({source});
+              });
+      measure("MakeTensorFromXlaLiteral", pair, Layout::kContiguous,
+              tensor_bytes, [&]() {
+                MakeTensorFromXlaLiteral(*literal, pair.tensor_type);
+              });
+      if (native_pair) {
+        std::vector<torch::lazy::BackendDataPtr> datas = {
+            TensorToXlaData(tensor, device)};
+        measure("TransferFromServer", pair, Layout::kContiguous,
+                literal_bytes, [&]() {
+                  xla::ComputationClient::Get()->TransferFromServer(
+                      UnwrapXlaData(datas));
+                });
+        measure("XlaDataToTensors", pair, Layout::kContiguous, tensor_bytes,
+                [&]() { XlaDataToTensors(datas, pair.tensor_type); });
+      }
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Measures the host tracing throughput, in traced operations per second, of
+// one to XLA_BENCH_MAX_THREADS threads, each tracing its own graphs on its own
+// local device (round robin when there are more threads than devices), and
+// prints how it scales with the number of threads. The graphs are only traced,
+// never executed, so that the numbers only reflect the host side.
+// Build it with "run_tests.sh -B -K" and run build/bench_tracing. The
+// XLA_BENCH_MAX_THREADS (default, the number of local devices),
+// XLA_BENCH_OPS (operations per graph) and XLA_BENCH_ITERS (graphs per thread)
+// environment variables control the runs.
+
+#include <ATen/ATen.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/tensor.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+void TraceGraphs(const torch::lazy::BackendDevice& device, int64_t num_ops,
+                 int64_t iterations) {
+  SetCurrentDevice(device);
+  XLATensorPtr input = XLATensor::Create(
+      at::rand({8, 8}, at::TensorOptions(at::kFloat)), device);
+  for (int64_t i = 0; i < iterations; ++i) {
+    XLATensorPtr result = input;
+    for (int64_t j = 0; j < num_ops; j += 2) {
+      result = XLATensor::add(result, input, 1.0);
+      result = XLATensor::mul(result, 0.5);
+    }
+  }
+}
+
+double RunThreads(const std::vector<torch::lazy::BackendDevice>& devices,
+                  int64_t num_threads, int64_t num_ops, int64_t iterations) {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int64_t t = 0; t < num_threads; ++t) {
+    threads.emplace_back(TraceGraphs, devices[t % devices.size()], num_ops,
+                         iterations);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+}  // namespace
+}  // namespace cpp_test
+}  // namespace torch_xla
+
+int main(int argc, char** argv) {
+  using namespace torch_xla;
+  using namespace torch_xla::cpp_test;
+
+  std::string default_device =
+      xla::ComputationClient::Get()->GetDefaultDevice();
+  torch::lazy::BackendDevice device_type = ParseDeviceString(default_device);
+  std::vector<torch::lazy::BackendDevice> devices;
+  for (auto& device_str : xla::ComputationClient::Get()->GetLocalDevices()) {
+    torch::lazy::BackendDevice device = ParseDeviceString(device_str);
+    if (device.type() == device_type.type()) {
+      devices.push_back(device);
+    }
+  }
+  int64_t max_threads =
+      xla::sys_util::GetEnvInt("XLA_BENCH_MAX_THREADS", devices.size());
+  int64_t num_ops = xla::sys_util::GetEnvInt("XLA_BENCH_OPS", 200);
+  int64_t iterations = xla::sys_util::GetEnvInt("XLA_BENCH_ITERS", 200);
+
+  // Warm up the caches, like the shape one, which are shared by the threads.
+  RunThreads(devices, 1, num_ops, 1);
+
+  std::printf("# %zu %s devices, %lld ops per graph, %lld graphs per thread\n",
+              devices.size(), default_device.c_str(),
+              static_cast<long long>(num_ops),
+              static_cast<long long>(iterations));
+  std::printf("%8s %14s %14s %10s\n", "threads", "ops/s", "ops/s/thread",
+              "scaling");
+  double single_rate = 0.0;
+  max_threads = std::max<int64_t>(max_threads, 1);
+  for (int64_t num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    double seconds = RunThreads(devices, num_threads, num_ops, iterations);
+    double rate = static_cast<double>(num_threads * num_ops * iterations) /
+                  std::max(seconds, 1e-9);
+    if (num_threads == 1) {
+      single_rate = rate;
+    }
+    std::printf("%8lld %14.0f %14.0f %9.2fx\n",
+                static_cast<long long>(num_threads), rate, rate / num_threads,
+                rate / single_rate);
+  }
+  return 0;
+}
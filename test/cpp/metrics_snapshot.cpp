@@ -42,6 +42,23 @@ std::vector<MetricsSnapshot::ChangedCounter> MetricsSnapshot::CounterChanged(
   return changed;
 }
 
+MetricsSnapshot::MetricDelta MetricsSnapshot::GetMetricDelta(
+    const std::string& name, const MetricsSnapshot& after) const {
+  MetricDelta delta;
+  auto after_it = after.metrics_map_.find(name);
+  if (after_it == after.metrics_map_.end()) {
+    return delta;
+  }
+  delta.samples = after_it->second.total_samples;
+  delta.accumulator = after_it->second.accumulator;
+  auto it = metrics_map_.find(name);
+  if (it != metrics_map_.end()) {
+    delta.samples -= it->second.total_samples;
+    delta.accumulator -= it->second.accumulator;
+  }
+  return delta;
+}
+
 std::string MetricsSnapshot::DumpDifferences(
     const MetricsSnapshot& after,
     const std::unordered_set<std::string>* ignore_set) const {
@@ -20,12 +20,23 @@ class MetricsSnapshot {
     int64_t after = 0;
   };
 
+  struct MetricDelta {
+    size_t samples = 0;
+    // The sum of the values of the new samples.
+    double accumulator = 0.0;
+  };
+
   MetricsSnapshot();
 
   std::vector<ChangedCounter> CounterChanged(
       const std::string& counter_regex, const MetricsSnapshot& after,
       const std::unordered_set<std::string>* ignore_set) const;
 
+  // Returns the samples the metric collected between this snapshot and the
+  // after one.
+  MetricDelta GetMetricDelta(const std::string& name,
+                             const MetricsSnapshot& after) const;
+
   std::string DumpDifferences(
       const MetricsSnapshot& after,
       const std::unordered_set<std::string>* ignore_set) const;
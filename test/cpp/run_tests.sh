@@ -62,6 +62,13 @@ if [ $BUILD_ONLY -eq 0 ]; then
   else
     ./test_ptxla ${FILTER:+"$FILTER"}
   fi
+  if [ "$FILTER" == "" ]; then
+    # The host object pool and the device memory quota are opt-in, so their
+    # tests run in passes of their own.
+    XLA_HOST_OBJECT_POOL=1 ./test_ptxla --gtest_filter='HostObjectPool*'
+    XLA_DEVICE_MEMORY_QUOTA_MB=1 XLA_DEVICE_MEMORY_QUOTA_WAIT_MS=1000 \
+      ./test_ptxla --gtest_filter='MemoryQuota*'
+  fi
 fi
 popd
 if [ $RMBUILD -eq 1 -a $BUILD_ONLY -eq 0 ]; then
@@ -4030,6 +4030,30 @@ TEST_F(AtenXlaTensorTest, TestUpsampleBilinear2DBackward) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestUpsampleBilinear2DDownsample) {
+  int batch_size = 2;
+  int h = 9;
+  int w = 7;
+  int uh = 4;
+  int uw = 5;
+  int chans = 2;
+  for (bool align_corners : {true, false}) {
+    torch::Tensor input = torch::rand({batch_size, chans, h, w},
+                                      torch::TensorOptions(torch::kFloat));
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      torch::Tensor result =
+          torch::upsample_bilinear2d(input, {uh, uw}, align_corners);
+      torch::Tensor xla_result =
+          torch::upsample_bilinear2d(xla_input, {uh, uw}, align_corners);
+      AllClose(result, xla_result);
+    });
+  }
+  ExpectCounterNotChanged("aten::.*", cpp_test::GetIgnoredCounters());
+  ExpectCounterChanged("xla::upsample_bilinear2d",
+                       cpp_test::GetIgnoredCounters());
+}
+
 TEST_F(AtenXlaTensorTest, TestAddCMul) {
   torch::Tensor a = torch::rand({2, 2}, torch::TensorOptions(torch::kFloat));
   torch::Tensor b = torch::rand({2, 2}, torch::TensorOptions(torch::kFloat));
@@ -4309,8 +4333,9 @@ TEST_F(AtenXlaTensorTest, TestUnbind) {
 }
 
 TEST_F(AtenXlaTensorTest, TestRepeat) {
-  std::vector<std::vector<int64_t>> repeats_list = {{4, 2}, {4, 2, 3}};
-  std::vector<std::vector<int64_t>> input_size_list = {{3}, {2, 4}};
+  std::vector<std::vector<int64_t>> repeats_list = {
+      {4, 2}, {4, 2, 3}, {1, 1}, {3, 1}, {2, 0, 3}};
+  std::vector<std::vector<int64_t>> input_size_list = {{3}, {2, 4}, {1, 5}};
   for (const auto& repeats : repeats_list) {
     for (const auto& input_size : input_size_list) {
       torch::Tensor input =
@@ -8355,6 +8380,20 @@ TEST_F(AtenXlaTensorTest, TestFlip) {
   }
 }
 
+TEST_F(AtenXlaTensorTest, TestFlipUnitDims) {
+  torch::Tensor input =
+      torch::rand({2, 1, 4, 1}, torch::TensorOptions(torch::kFloat));
+  for (std::vector<int64_t> flip_dims :
+       {std::vector<int64_t>{1}, {1, 3}, {0, 1}, {0, 1, 2, 3}}) {
+    torch::Tensor output = torch::flip(input, flip_dims);
+    ForEachDevice([&](const torch::Device& device) {
+      torch::Tensor xla_input = CopyToDevice(input, device);
+      torch::Tensor xla_output = torch::flip(xla_input, flip_dims);
+      AllClose(output, xla_output);
+    });
+  }
+}
+
 TEST_F(AtenXlaTensorTest, TestPixelShuffle) {
   torch::Tensor input =
       torch::rand({5, 18, 4, 4}, torch::TensorOptions(torch::kFloat));
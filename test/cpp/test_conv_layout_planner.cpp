@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "torch_xla/csrc/conv_layout_planner.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(ConvLayoutPlannerTest, FeatureMinorLayouts) {
+  xla::Shape input = xla::ShapeUtil::MakeShape(xla::F32, {8, 64, 32, 32});
+  xla::Shape kernel = xla::ShapeUtil::MakeShape(xla::F32, {128, 64, 3, 3});
+  xla::Shape output = xla::ShapeUtil::MakeShape(xla::F32, {8, 128, 30, 30});
+  // Not used by any convolution yet.
+  EXPECT_EQ(ConvLayoutPlanner::GetLayout(input.dimensions(),
+                                         input.element_type(),
+                                         XlaDeviceType::TPU),
+            nullptr);
+  // The operands come in the default layout, so no transpose got elided.
+  EXPECT_EQ(ConvLayoutPlanner::RecordConvolution({&input, &kernel, &output},
+                                                 XlaDeviceType::TPU),
+            0);
+  const std::vector<int64_t>* layout = ConvLayoutPlanner::GetLayout(
+      input.dimensions(), input.element_type(), XlaDeviceType::TPU);
+  ASSERT_NE(layout, nullptr);
+  EXPECT_EQ(*layout, std::vector<int64_t>({1, 3, 2, 0}));
+  // Neither are the shapes planned for another device type.
+  EXPECT_EQ(ConvLayoutPlanner::GetLayout(input.dimensions(),
+                                         input.element_type(),
+                                         XlaDeviceType::GPU),
+            nullptr);
+
+  // The operands created from then on have the planned layout.
+  xla::Shape planned_input = xla::ShapeUtil::MakeShapeWithLayout(
+      xla::F32, {8, 64, 32, 32}, *layout);
+  EXPECT_EQ(ConvLayoutPlanner::RecordConvolution(
+                {&planned_input, &kernel, &output}, XlaDeviceType::TPU),
+            1);
+
+  xla::Shape input_3d = xla::ShapeUtil::MakeShape(xla::BF16, {2, 16, 4, 8, 8});
+  ConvLayoutPlanner::RecordConvolution({&input_3d}, XlaDeviceType::GPU);
+  layout = ConvLayoutPlanner::GetLayout(
+      input_3d.dimensions(), input_3d.element_type(), XlaDeviceType::GPU);
+  ASSERT_NE(layout, nullptr);
+  EXPECT_EQ(*layout, std::vector<int64_t>({1, 4, 3, 2, 0}));
+}
+
+TEST(ConvLayoutPlannerTest, DefaultLayouts) {
+  std::vector<xla::Shape> shapes = {
+      // Unaligned features, like the images fed to the first convolution.
+      xla::ShapeUtil::MakeShape(xla::F32, {8, 3, 224, 224}),
+      // No spatial extent.
+      xla::ShapeUtil::MakeShape(xla::F32, {8, 64, 1, 1}),
+      xla::ShapeUtil::MakeShape(xla::F32, {64, 128})};
+  for (const xla::Shape& shape : shapes) {
+    ConvLayoutPlanner::RecordConvolution({&shape}, XlaDeviceType::TPU);
+    EXPECT_EQ(ConvLayoutPlanner::GetLayout(
+                  shape.dimensions(), shape.element_type(), XlaDeviceType::TPU),
+              nullptr);
+  }
+  // The F32 GPU convolutions, and the CPU ones, are feature major.
+  xla::Shape shape = xla::ShapeUtil::MakeShape(xla::F32, {4, 64, 16, 16});
+  for (XlaDeviceType hw_type : {XlaDeviceType::GPU, XlaDeviceType::CPU}) {
+    ConvLayoutPlanner::RecordConvolution({&shape}, hw_type);
+    EXPECT_EQ(ConvLayoutPlanner::GetLayout(shape.dimensions(),
+                                           shape.element_type(), hw_type),
+              nullptr);
+  }
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "tensorflow/core/lib/bfloat16/bfloat16.h"
+#include "torch_xla/csrc/copy_kernels.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+// Covers the vectorized bodies, as well as the scalar tails.
+const int64_t kSizes[] = {0, 1, 7, 8, 15, 16, 17, 33, 1027};
+
+}  // namespace
+
+TEST(CopyKernelsTest, F32ToBF16) {
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<float> distribution(-1e6, 1e6);
+  for (int64_t size : kSizes) {
+    std::vector<float> source(size);
+    for (auto& value : source) {
+      value = distribution(generator);
+    }
+    if (size > 4) {
+      source[0] = std::numeric_limits<float>::infinity();
+      source[1] = -std::numeric_limits<float>::infinity();
+      source[2] = std::numeric_limits<float>::min();
+      source[3] = std::numeric_limits<float>::quiet_NaN();
+    }
+    std::vector<uint16_t> dest(size);
+    ConvertF32ToBF16(source.data(), dest.data(), size);
+    for (int64_t i = 0; i < size; ++i) {
+      if (std::isnan(source[i])) {
+        EXPECT_EQ(dest[i], 0x7fc0);
+        continue;
+      }
+      tensorflow::bfloat16 expected(source[i]);
+      uint16_t expected_bits;
+      std::memcpy(&expected_bits, &expected, sizeof(expected_bits));
+      EXPECT_EQ(dest[i], expected_bits) << source[i];
+    }
+
+    std::vector<float> back(size);
+    ConvertBF16ToF32(dest.data(), back.data(), size);
+    for (int64_t i = 0; i < size; ++i) {
+      tensorflow::bfloat16 value;
+      std::memcpy(&value, &dest[i], sizeof(dest[i]));
+      if (std::isnan(source[i])) {
+        EXPECT_TRUE(std::isnan(back[i]));
+      } else {
+        EXPECT_EQ(back[i], static_cast<float>(value));
+      }
+    }
+  }
+}
+
+TEST(CopyKernelsTest, S64ToS32) {
+  std::mt19937_64 generator(17);
+  for (int64_t size : kSizes) {
+    std::vector<int64_t> source(size);
+    for (auto& value : source) {
+      value = static_cast<int64_t>(generator());
+    }
+    std::vector<int32_t> dest(size);
+    ConvertS64ToS32(source.data(), dest.data(), size);
+    for (int64_t i = 0; i < size; ++i) {
+      EXPECT_EQ(dest[i], static_cast<int32_t>(source[i]));
+    }
+
+    std::vector<int64_t> back(size);
+    ConvertS32ToS64(dest.data(), back.data(), size);
+    for (int64_t i = 0; i < size; ++i) {
+      EXPECT_EQ(back[i], dest[i]);
+    }
+  }
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
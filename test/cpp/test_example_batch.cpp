@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/example/feature.pb.h"
+#include "torch_xla/csrc/example_batch.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+xla::util::RecordReader::Data MakeRecord(int64_t index) {
+  tensorflow::Example example;
+  auto& features = *example.mutable_features()->mutable_feature();
+  features["label"].mutable_int64_list()->add_value(index);
+  auto* embedding = features["embedding"].mutable_float_list();
+  embedding->add_value(index);
+  embedding->add_value(index + 0.5);
+  // A different number of values (and bytes) in every example.
+  auto* tokens = features["tokens"].mutable_int64_list();
+  for (int64_t i = 0; i <= index; ++i) {
+    tokens->add_value(i);
+  }
+  features["name"].mutable_bytes_list()->add_value(
+      std::string(index + 1, 'x'));
+  std::string serialized;
+  example.SerializeToString(&serialized);
+  return xla::util::RecordReader::Data(serialized);
+}
+
+}  // namespace
+
+TEST(ExampleBatchTest, StacksSameSizeFeatures) {
+  // Enough examples for the parsing to run in more than one chunk.
+  static const int64_t kNumExamples = 100;
+  std::vector<xla::util::RecordReader::Data> records;
+  for (int64_t i = 0; i < kNumExamples; ++i) {
+    records.push_back(MakeRecord(i));
+  }
+  auto batch = ParseExampleBatch(records, "test");
+  ASSERT_EQ(batch.size(), 4);
+
+  at::Tensor label = batch.at("label").stacked;
+  ASSERT_TRUE(label.defined());
+  AllEqual(label, at::arange(kNumExamples, at::TensorOptions(at::kLong))
+                      .view({kNumExamples, 1}));
+  at::Tensor embedding = batch.at("embedding").stacked;
+  ASSERT_TRUE(embedding.defined());
+  EXPECT_EQ(embedding.sizes(), at::IntArrayRef({kNumExamples, 2}));
+  EXPECT_EQ(embedding[7][1].item<float>(), 7.5);
+
+  const ExampleFeatureBatch& tokens = batch.at("tokens");
+  EXPECT_FALSE(tokens.stacked.defined());
+  ASSERT_EQ(tokens.values.size(), kNumExamples);
+  ASSERT_EQ(tokens.values[9].size(), 1);
+  EXPECT_EQ(tokens.values[9][0].numel(), 10);
+  const ExampleFeatureBatch& name = batch.at("name");
+  EXPECT_FALSE(name.stacked.defined());
+  ASSERT_EQ(name.values[3].size(), 1);
+  EXPECT_EQ(name.values[3][0].numel(), 4);
+}
+
+TEST(ExampleBatchTest, MissingFeature) {
+  std::string empty;
+  tensorflow::Example().SerializeToString(&empty);
+  std::vector<xla::util::RecordReader::Data> records = {
+      MakeRecord(0), xla::util::RecordReader::Data(empty)};
+  EXPECT_THROW(ParseExampleBatch(records, "test"), std::exception);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/future.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(FutureTest, ThenChains) {
+  xla::util::Promise<int> promise;
+  xla::util::Future<std::string> result =
+      promise.GetFuture()
+          .Then([](const int& value) { return value * 2; })
+          .Then([](const int& value) { return std::to_string(value); });
+  EXPECT_FALSE(result.IsReady());
+  promise.SetValue(21);
+  EXPECT_TRUE(result.IsReady());
+  EXPECT_EQ(result.Get(), "42");
+  // Chaining on a complete future runs the continuation right away.
+  xla::util::Future<int> chained =
+      promise.GetFuture().Then([](const int& value) { return value + 1; });
+  EXPECT_TRUE(chained.IsReady());
+  EXPECT_EQ(chained.Get(), 22);
+}
+
+TEST(FutureTest, ExceptionsPropagate) {
+  xla::util::Promise<int> promise;
+  bool called = false;
+  xla::util::Future<int> result =
+      promise.GetFuture()
+          .Then([](const int&) -> int { throw std::runtime_error("Failed"); })
+          .Then([&](const int& value) {
+            called = true;
+            return value;
+          });
+  promise.SetValue(0);
+  EXPECT_THROW(result.Get(), std::runtime_error);
+  EXPECT_FALSE(called);
+}
+
+TEST(FutureTest, ThenIoRunsOnIoPool) {
+  xla::util::Promise<int> promise;
+  std::thread::id completer_id = std::this_thread::get_id();
+  xla::util::Future<std::thread::id> result =
+      promise.GetFuture().ThenIo([](const int& value) {
+        EXPECT_EQ(value, 1);
+        return std::this_thread::get_id();
+      });
+  promise.SetValue(1);
+  EXPECT_NE(result.Get(), completer_id);
+
+  xla::util::Promise<int> failed;
+  xla::util::Future<int> failed_result =
+      failed.GetFuture().ThenIo([](const int& value) { return value; });
+  failed.SetException(std::make_exception_ptr(std::runtime_error("Failed")));
+  EXPECT_THROW(failed_result.Get(), std::runtime_error);
+}
+
+TEST(FutureTest, ScheduleAndJoin) {
+  const int num_futures = 64;
+  std::vector<xla::util::Future<int>> futures;
+  for (int i = 0; i < num_futures; ++i) {
+    futures.push_back(xla::util::ScheduleIoFuture([i]() { return i; }));
+  }
+  xla::util::WhenAll(futures).Get();
+  for (int i = 0; i < num_futures; ++i) {
+    EXPECT_TRUE(futures[i].IsReady());
+    EXPECT_EQ(futures[i].Get(), i);
+  }
+  EXPECT_TRUE(
+      xla::util::WhenAll(std::vector<xla::util::Future<int>>()).IsReady());
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "cpp_test_util.h"
+#include "torch_xla/csrc/host_object_pool.h"
+#include "torch_xla/csrc/tensor.h"
+#include "torch_xla_test.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+struct Counted {
+  explicit Counted(int* count) : count(count) { ++*count; }
+  ~Counted() { --*count; }
+
+  int* count;
+};
+
+}  // namespace
+
+TEST(HostObjectPoolTest, Reuse) {
+  if (!host_pool::IsEnabled()) {
+    GTEST_SKIP();
+  }
+  void* ptr = host_pool::Allocate(100);
+  host_pool::Deallocate(ptr, 100);
+  // Same size class, from the cache of the thread.
+  void* other = host_pool::Allocate(112);
+  EXPECT_EQ(other, ptr);
+  host_pool::Deallocate(other, 112);
+}
+
+TEST(HostObjectPoolTest, LargeSizes) {
+  size_t size = host_pool::kMaxPooledSize + 1;
+  void* ptr = host_pool::Allocate(size);
+  EXPECT_NE(ptr, nullptr);
+  host_pool::Deallocate(ptr, size);
+}
+
+TEST(HostObjectPoolTest, MakeShared) {
+  int count = 0;
+  {
+    std::shared_ptr<Counted> counted = host_pool::MakeShared<Counted>(&count);
+    EXPECT_EQ(count, 1);
+  }
+  EXPECT_EQ(count, 0);
+}
+
+TEST(HostObjectPoolTest, CrossThreadFree) {
+  if (!host_pool::IsEnabled()) {
+    GTEST_SKIP();
+  }
+  const size_t num_blocks = 1000;
+  std::vector<void*> blocks;
+  std::thread producer([&]() {
+    for (size_t i = 0; i < num_blocks; ++i) {
+      blocks.push_back(host_pool::Allocate(64));
+    }
+  });
+  producer.join();
+  for (auto ptr : blocks) {
+    host_pool::Deallocate(ptr, 64);
+  }
+  // The freeing thread only keeps a batch of the blocks in its cache, and
+  // releases the others to the central lists, where another thread picks
+  // them up without new slabs for most of them.
+  int64_t num_slabs = host_pool::GetNumSlabs();
+  std::thread([&]() {
+    for (auto& ptr : blocks) {
+      ptr = host_pool::Allocate(64);
+    }
+    for (auto ptr : blocks) {
+      host_pool::Deallocate(ptr, 64);
+    }
+  }).join();
+  EXPECT_LE(host_pool::GetNumSlabs(), num_slabs + 1);
+}
+
+using HostObjectPoolTracingTest = TorchXlaTest;
+
+TEST_F(HostObjectPoolTracingTest, TracingLoopRecyclesBlocks) {
+  // Once warmed up, a tracing loop creating and dropping the same objects at
+  // every iteration does not need new slabs.
+  if (!host_pool::IsEnabled()) {
+    GTEST_SKIP();
+  }
+  ForEachDevice([&](const torch::lazy::BackendDevice& device) {
+    at::Tensor a = at::rand({2, 2}, at::TensorOptions(at::kFloat));
+    XLATensorPtr dev_a = XLATensor::Create(a, device);
+    auto trace = [&]() {
+      XLATensorPtr result = dev_a;
+      for (int i = 0; i < 100; ++i) {
+        result = XLATensor::add(result, dev_a, 1.0);
+      }
+    };
+    trace();
+    int64_t num_slabs = host_pool::GetNumSlabs();
+    for (int i = 0; i < 10; ++i) {
+      trace();
+    }
+    EXPECT_EQ(host_pool::GetNumSlabs(), num_slabs);
+  });
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -1,16 +1,40 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+#include <vector>
+
 #include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/ir_simplifier.h"
+#include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/node_arena.h"
 #include "torch_xla/csrc/ops/arithmetic_ir_ops.h"
+#include "torch_xla/csrc/ops/expand.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/ops/ops.h"
 #include "torch_xla/csrc/ops/scalar.h"
 #include "torch_xla/csrc/ops/select.h"
 #include "torch_xla/csrc/ops/unselect.h"
+#include "torch_xla/csrc/parallel_lowering.h"
+#include "torch_xla/csrc/source_location_table.h"
+#include "torch_xla/csrc/subgraph_calls.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 
 namespace torch_xla {
 namespace cpp_test {
+namespace {
+
+void ExpectCompatibleShapes(const xla::Shape& shape1,
+                            const xla::Shape& shape2) {
+  EXPECT_TRUE(xla::ShapeUtil::Compatible(shape1, shape2))
+      << shape1 << " vs. " << shape2;
+}
+
+}  // namespace
 
 TEST(IrTest, TestScalarCreate) {
   torch::lazy::NodePtr scalar = ScalarOp(1.0, xla::F32);
@@ -94,5 +118,229 @@ TEST(IrTest, TestScopePusherWithDebugging) {
   FLAGS_torch_lazy_ir_debug = restore_FLAGS_torch_lazy_ir_debug;
 }
 
+TEST(IrTest, TestMemoizedPostOrder) {
+  torch::lazy::NodePtr scalar1 = ScalarOp(1.0, xla::F32);
+  torch::lazy::NodePtr scalar2 = ScalarOp(2.0, xla::F32);
+  torch::lazy::Value add =
+      torch::lazy::Value(scalar1, 0) + torch::lazy::Value(scalar2, 0);
+  torch::lazy::Value mul = add * torch::lazy::Value(scalar2, 0);
+
+  std::vector<const torch::lazy::Node*> roots({mul.node.get()});
+  auto expected = Util::ComputePostOrder(roots);
+
+  Util::EmissionMap emap;
+  auto post_order = Util::ComputeMemoizedPostOrder(roots, &emap);
+  EXPECT_EQ(post_order, expected);
+  const XlaNode* casted = dynamic_cast<const XlaNode*>(mul.node.get());
+  ASSERT_TRUE(casted->post_order() != nullptr);
+  EXPECT_EQ(*casted->post_order(), expected);
+
+  // Merging with a second root must not emit the shared nodes twice.
+  torch::lazy::Value sub =
+      torch::lazy::Value(scalar1, 0) - torch::lazy::Value(scalar2, 0);
+  roots = {sub.node.get(), mul.node.get()};
+  expected = Util::ComputePostOrder(roots);
+  emap.clear();
+  post_order = Util::ComputeMemoizedPostOrder(roots, &emap);
+  EXPECT_EQ(post_order, expected);
+}
+
+TEST(IrTest, TestClosedFormShapes) {
+  xla::Shape f32_shape = xla::ShapeUtil::MakeShape(xla::F32, {4, 1, 3});
+  xla::Shape s32_shape = xla::ShapeUtil::MakeShape(xla::S32, {5, 1});
+  auto binary_fn = [](absl::Span<const xla::XlaOp> operands) {
+    auto promoted = XlaHelpers::Promote(operands[0], operands[1]);
+    return xla::Pow(promoted.first, promoted.second);
+  };
+  ExpectCompatibleShapes(InferBinaryOpShape(f32_shape, s32_shape, binary_fn),
+                         InferOutputShape({f32_shape, s32_shape}, binary_fn));
+
+  auto compare_fn = [](absl::Span<const xla::XlaOp> operands) {
+    auto promoted = XlaHelpers::Promote(operands[0], operands[1]);
+    return xla::Lt(promoted.first, promoted.second);
+  };
+  ExpectCompatibleShapes(
+      InferComparisonOpShape(f32_shape, s32_shape, compare_fn),
+      InferOutputShape({f32_shape, s32_shape}, compare_fn));
+
+  std::vector<int64_t> permutation = {2, 0, 1};
+  auto transpose_fn = [&](absl::Span<const xla::XlaOp> operands) {
+    return xla::Transpose(operands[0], permutation);
+  };
+  ExpectCompatibleShapes(InferTransposeShape(f32_shape, permutation),
+                         InferOutputShape({f32_shape}, transpose_fn));
+
+  auto dot_fn = [](absl::Span<const xla::XlaOp> operands) {
+    return BuildDot(operands[0], operands[1]);
+  };
+  xla::Shape matrix_shape = xla::ShapeUtil::MakeShape(xla::F32, {2, 3});
+  xla::Shape vector_shape = xla::ShapeUtil::MakeShape(xla::F32, {3});
+  xla::Shape rhs_matrix_shape = xla::ShapeUtil::MakeShape(xla::F32, {3, 4});
+  ExpectCompatibleShapes(
+      InferDotShape(matrix_shape, rhs_matrix_shape, dot_fn),
+      InferOutputShape({matrix_shape, rhs_matrix_shape}, dot_fn));
+  ExpectCompatibleShapes(
+      InferDotShape(matrix_shape, vector_shape, dot_fn),
+      InferOutputShape({matrix_shape, vector_shape}, dot_fn));
+  ExpectCompatibleShapes(
+      InferDotShape(vector_shape, vector_shape, dot_fn),
+      InferOutputShape({vector_shape, vector_shape}, dot_fn));
+
+  for (bool keep_reduced_dimensions : {false, true}) {
+    std::vector<int64_t> dimensions = {0, 2};
+    auto reduce_fn = [&](absl::Span<const xla::XlaOp> operands) {
+      xla::XlaOp result = xla::Reduce(
+          operands[0], xla::Zero(operands[0].builder(), xla::F32),
+          XlaHelpers::CreateAddComputation(xla::F32), dimensions);
+      return keep_reduced_dimensions ? xla::Reshape(result, {1, 1, 1})
+                                     : result;
+    };
+    ExpectCompatibleShapes(
+        InferReduceShape(f32_shape, xla::F32, dimensions,
+                         keep_reduced_dimensions, reduce_fn),
+        InferOutputShape({f32_shape}, reduce_fn));
+  }
+}
+
+TEST(IrTest, TestMakeXlaNode) {
+  torch::lazy::NodePtr node = MakeXlaNode<Scalar>(1.0, xla::F32);
+  EXPECT_EQ(node->op(), torch::lazy::OpKind(at::prim::Constant));
+}
+
+TEST(IrTest, TestIrSimplifier) {
+  ForEachDevice([&](const torch::lazy::BackendDevice& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    torch::lazy::Value v_a = GetTensorIrValue(a, device);
+    torch::lazy::Value v_s1(ScalarOp(2.0, xla::F32), 0);
+    torch::lazy::Value v_s2(ScalarOp(2.0, xla::F32), 0);
+    torch::lazy::Value v_m1 = v_a * v_s1;
+    torch::lazy::Value v_m2 = v_a * v_s2;
+    torch::lazy::Value v_e = torch::lazy::MakeNode<Expand>(
+        torch::lazy::Value(ScalarOp(1.0, xla::F32), 0),
+        std::vector<int64_t>{4, 3});
+    torch::lazy::Value v_r = (v_m1 + v_m2) + v_e;
+
+    std::vector<const torch::lazy::Node*> post_order =
+        Util::ComputePostOrder({v_r.node.get()});
+    IrSimplifier simplifier(post_order, /*parameter_sequence=*/{0});
+    EXPECT_EQ(simplifier.GetReplacement(v_s2.node.get()), v_s1.node.get());
+    EXPECT_EQ(simplifier.GetReplacement(v_m2.node.get()), v_m1.node.get());
+    EXPECT_EQ(simplifier.GetReplacement(v_m1.node.get()), nullptr);
+    const Scalar* folded =
+        dynamic_cast<const Scalar*>(simplifier.GetReplacement(v_e.node.get()));
+    ASSERT_TRUE(folded != nullptr);
+    EXPECT_EQ(folded->xla_shape(), GetXlaShape(v_e));
+    EXPECT_EQ(simplifier.cse_nodes(), 2);
+    EXPECT_EQ(simplifier.folded_nodes(), 1);
+  });
+}
+
+TEST(IrTest, TestParallelLowering) {
+  if (std::thread::hardware_concurrency() < 2) {
+    GTEST_SKIP();
+  }
+  ForEachDevice([&](const torch::lazy::BackendDevice& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    torch::lazy::Value v_a = GetTensorIrValue(a, device);
+    torch::lazy::Value v_b = GetTensorIrValue(b, device);
+    // Two independent chains, big enough to be lowered by separate threads,
+    // reading the same shared node.
+    torch::lazy::Value v_shared = v_a * v_b;
+    torch::lazy::Value v_r1 = v_shared;
+    torch::lazy::Value v_r2 = v_shared;
+    for (int i = 0; i < 300; ++i) {
+      v_r1 = v_r1 + v_a;
+      v_r2 = v_r2 - v_b;
+    }
+    std::vector<torch::lazy::Output> roots = {
+        torch::lazy::Output(v_r1.node.get(), v_r1.index),
+        torch::lazy::Output(v_r2.node.get(), v_r2.index)};
+    std::vector<const torch::lazy::Node*> post_order =
+        Util::ComputePostOrder({v_r1.node.get(), v_r2.node.get()});
+
+    LoweringContext lowering_ctx("TestParallelLowering", device);
+    ASSERT_TRUE(ParallelLowering::Lower(post_order, roots,
+                                        /*replacement_fn=*/nullptr,
+                                        &lowering_ctx));
+    for (auto& root : roots) {
+      lowering_ctx.AddResult(lowering_ctx.GetOutputOp(root));
+    }
+    xla::XlaComputation computation = ConsumeValue(lowering_ctx.BuildXla());
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    EXPECT_EQ(program_shape.parameters_size(), 2);
+    EXPECT_EQ(program_shape.result().tuple_shapes_size(), 2);
+  });
+}
+
+TEST(IrTest, TestSubgraphCalls) {
+  ForEachDevice([&](const torch::lazy::BackendDevice& device) {
+    at::Tensor a = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({4, 3}, at::TensorOptions(at::kFloat));
+    torch::lazy::Value v_a = GetTensorIrValue(a, device);
+    torch::lazy::Value v_b = GetTensorIrValue(b, device);
+    // Stacked blocks, every one using the output of the previous twice, so
+    // that they end up being separate regions with the same hash.
+    torch::lazy::Value v_x = v_a + v_b;
+    for (int i = 0; i < 3; ++i) {
+      v_x = (v_x * v_x + v_a) * v_b - v_a;
+    }
+    std::vector<torch::lazy::Output> roots = {
+        torch::lazy::Output(v_x.node.get(), v_x.index)};
+    std::vector<const torch::lazy::Node*> post_order =
+        Util::ComputePostOrder({v_x.node.get()});
+
+    SubgraphCalls calls(post_order, roots, /*replacement_fn=*/nullptr, device);
+    EXPECT_EQ(calls.num_calls(), 3);
+    LoweringContext lowering_ctx("TestSubgraphCalls", device);
+    for (auto node : post_order) {
+      if (!calls.IsCalled(node) && !calls.LowerCall(node, &lowering_ctx)) {
+        lowering_ctx.LowerNode(node);
+      }
+    }
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(roots.front()));
+    xla::XlaComputation computation = ConsumeValue(lowering_ctx.BuildXla());
+    // The main computation, and the one shared by all the blocks.
+    EXPECT_EQ(computation.proto().computations_size(), 2);
+    xla::ProgramShape program_shape =
+        ConsumeValue(computation.GetProgramShape());
+    EXPECT_EQ(program_shape.parameters_size(), 2);
+  });
+}
+
+TEST(IrTest, TestSourceLocationTable) {
+  static const int kCodes[2] = {0, 0};
+  size_t describe_calls = 0;
+  SourceLocationTable::SetCallbacks(
+      /*capture_fn=*/nullptr, [&](const SourceLocationTable::Frame& frame) {
+        ++describe_calls;
+        torch::lazy::SourceLocation location;
+        location.file = frame.code == &kCodes[0] ? "a.py" : "b.py";
+        location.function = "fn";
+        location.line = frame.line;
+        return location;
+      });
+  std::vector<SourceLocationTable::Frame> frames = {{&kCodes[0], 3},
+                                                    {&kCodes[1], 7}};
+  uint32_t id = SourceLocationTable::Intern(frames);
+  EXPECT_NE(id, 0);
+  EXPECT_EQ(SourceLocationTable::Intern(frames), id);
+  // The frames shared with the first record are not described again.
+  uint32_t inner_id = SourceLocationTable::Intern({frames.front()});
+  EXPECT_NE(inner_id, id);
+  EXPECT_EQ(describe_calls, 2);
+
+  const std::vector<torch::lazy::SourceLocation>& locations =
+      SourceLocationTable::Get(id);
+  ASSERT_EQ(locations.size(), 2);
+  EXPECT_EQ(locations[0].file, "a.py");
+  EXPECT_EQ(locations[0].line, 3);
+  EXPECT_EQ(locations[1].file, "b.py");
+  EXPECT_EQ(SourceLocationTable::Get(inner_id).size(), 1);
+  EXPECT_TRUE(SourceLocationTable::Get(0).empty());
+  SourceLocationTable::SetCallbacks(nullptr, nullptr);
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
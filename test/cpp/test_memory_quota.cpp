@@ -0,0 +1,130 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_quota.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+class TestData : public xla::ComputationClient::Data {
+ public:
+  TestData(std::string device, xla::Shape shape)
+      : Data(std::move(device), std::move(shape)) {}
+
+  OpaqueHandle GetOpaqueHandle() override { return 0; }
+
+  void Assign(const Data& data) override {}
+
+  bool HasValue() const override { return true; }
+};
+
+}  // namespace
+
+// The quota is only set in the pass of run_tests.sh running these tests with
+// XLA_DEVICE_MEMORY_QUOTA_MB=1 and XLA_DEVICE_MEMORY_QUOTA_WAIT_MS=1000.
+TEST(MemoryQuotaTest, ReleasedByLastHolder) {
+  if (!xla::memory_quota::IsEnabled()) {
+    GTEST_SKIP();
+  }
+  const std::string device = "TEST:0";
+  std::vector<xla::memory_quota::ChargePtr> charges =
+      xla::memory_quota::Acquire(device, {1000, 2000});
+  ASSERT_EQ(charges.size(), 2);
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 3000);
+  // The data objects the buffer gets assigned to share its charge.
+  xla::memory_quota::ChargePtr holder = charges[0];
+  charges[0].reset();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 3000);
+  holder.reset();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 2000);
+  charges.clear();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 0);
+}
+
+TEST(MemoryQuotaTest, WaitsForReleases) {
+  if (!xla::memory_quota::IsEnabled()) {
+    GTEST_SKIP();
+  }
+  const std::string device = "TEST:1";
+  int64_t quota_bytes = xla::memory_quota::GetQuotaBytes();
+  std::vector<xla::memory_quota::ChargePtr> charges =
+      xla::memory_quota::Acquire(device, {quota_bytes});
+  EXPECT_TRUE(xla::memory_quota::UnderPressure(device));
+  std::thread releaser([&]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    charges.clear();
+  });
+  // Fits once the other charge is returned, well within the wait time.
+  std::vector<xla::memory_quota::ChargePtr> waited =
+      xla::memory_quota::Acquire(device, {quota_bytes / 2});
+  releaser.join();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), quota_bytes / 2);
+  waited.clear();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 0);
+}
+
+TEST(MemoryQuotaTest, FailsAfterWaiting) {
+  if (!xla::memory_quota::IsEnabled()) {
+    GTEST_SKIP();
+  }
+  const std::string device = "TEST:2";
+  int64_t quota_bytes = xla::memory_quota::GetQuotaBytes();
+  std::vector<xla::memory_quota::ChargePtr> charges =
+      xla::memory_quota::Acquire(device, {quota_bytes - 100});
+  EXPECT_THROW(xla::memory_quota::Acquire(device, {200}), std::runtime_error);
+  // The failed allocation charged nothing.
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), quota_bytes - 100);
+  EXPECT_THROW(xla::memory_quota::Acquire(device, {quota_bytes + 1}),
+               std::runtime_error);
+  charges.clear();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 0);
+}
+
+TEST(MemoryQuotaTest, AliasedResultsShareCharge) {
+  if (!xla::memory_quota::IsEnabled()) {
+    GTEST_SKIP();
+  }
+  const std::string device = "TEST:3";
+  xla::Shape shape = xla::ShapeUtil::MakeShape(xla::F32, {256});
+  xla::XlaBuilder builder("AliasedResultsShareCharge");
+  xla::XlaOp input = xla::Parameter(&builder, 0, shape, "input");
+  xla::Tuple(&builder, {input + input, input * input});
+  // The first result gets written over the input buffer.
+  builder.SetUpAlias({0}, 0, {});
+  xla::ComputationClient::Computation computation(
+      xla::ConsumeValue(builder.Build()));
+
+  auto data = std::make_shared<TestData>(device, shape);
+  std::vector<xla::ComputationClient::DataPtr> arguments = {data};
+  std::vector<xla::ComputationClient::TensorSource> sources = {
+      xla::ComputationClient::TensorSource(shape, device, nullptr)};
+  xla::ComputationClient::AttachQuota(
+      arguments, xla::ComputationClient::AcquireTransferQuota(sources));
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 1024);
+
+  std::vector<xla::memory_quota::ChargePtr> charges =
+      xla::ComputationClient::AcquireResultsQuota(
+          computation, arguments, device, /*explode_tuple=*/true);
+  ASSERT_EQ(charges.size(), 2);
+  EXPECT_EQ(charges[0], data->quota_charge());
+  // Only the result which is not aliased got charged.
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 2048);
+  data.reset();
+  arguments.clear();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 2048);
+  charges.clear();
+  EXPECT_EQ(xla::memory_quota::GetChargedBytes(device), 0);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
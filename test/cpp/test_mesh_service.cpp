@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/mesh_service.h"
+#include "tensorflow/core/platform/net.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+std::string PickAddress() {
+  return absl::StrCat("localhost:",
+                      tensorflow::internal::PickUnusedPortOrDie());
+}
+
+// Runs a rendezvous of every ordinal, each from its own thread and client,
+// and returns the payloads seen by every ordinal.
+std::vector<std::vector<std::string>> RunRendezvous(
+    const std::string& address, const std::string& aggregator_address,
+    const std::string& tag, const std::vector<std::string>& payloads,
+    const std::vector<int64_t>& ordinals,
+    const std::vector<int64_t>& replicas) {
+  std::vector<std::unique_ptr<xla::service::MeshClient>> clients;
+  for (size_t i = 0; i < ordinals.size(); ++i) {
+    clients.push_back(absl::make_unique<xla::service::MeshClient>(
+        address, aggregator_address));
+  }
+  std::vector<std::vector<std::string>> results(ordinals.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < ordinals.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      results[i] =
+          clients[i]->Rendezvous(ordinals[i], tag, payloads[i], replicas);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+}  // namespace
+
+TEST(MeshServiceTest, AggregatedRendezvous) {
+  const int64_t kMeshSize = 4;
+  std::string address = PickAddress();
+  std::string aggregator_address = PickAddress();
+  xla::service::grpc::Config config;
+  config.set_mesh_size(kMeshSize);
+  xla::service::MeshService service(address, config);
+  // All the ordinals live on the same host, so the aggregator joins the master
+  // with a single request carrying all their payloads.
+  xla::service::MeshAggregator aggregator(aggregator_address, address,
+                                          kMeshSize);
+
+  // The repeated payloads are sent once by the master, and expanded back per
+  // ordinal by the clients.
+  std::vector<std::string> payloads = {"a", "b", "a", ""};
+  std::vector<std::vector<std::string>> results =
+      RunRendezvous(address, aggregator_address, "dedup", payloads,
+                    {0, 1, 2, 3}, /*replicas=*/{});
+  for (auto& result : results) {
+    EXPECT_EQ(result, payloads);
+  }
+
+  // The same tag can be used again once the previous rendezvous completed.
+  results = RunRendezvous(address, aggregator_address, "dedup",
+                          {"x", "x", "x", "x"}, {0, 1, 2, 3}, {});
+  for (auto& result : results) {
+    EXPECT_EQ(result, std::vector<std::string>(kMeshSize, "x"));
+  }
+
+  // The rendezvous over explicit replicas pass straight through to the
+  // master.
+  results = RunRendezvous(address, aggregator_address, "replicas", {"p", "q"},
+                          {1, 3}, {1, 3});
+  for (auto& result : results) {
+    EXPECT_EQ(result, std::vector<std::string>({"p", "q"}));
+  }
+
+  aggregator.Shutdown();
+  service.Shutdown();
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
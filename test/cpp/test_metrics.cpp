@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/metrics_reader.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+static const int kNumThreads = 8;
+
+template <typename F>
+void RunThreads(const F& fn) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&fn, t]() { fn(t); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+}  // namespace
+
+TEST(MetricsTest, ShardedCounter) {
+  static const int kNumAdds = 10000;
+  xla::metrics::CounterData counter;
+  RunThreads([&](int) {
+    for (int i = 0; i < kNumAdds; ++i) {
+      counter.AddValue(1);
+    }
+  });
+  EXPECT_EQ(counter.Value(), kNumThreads * kNumAdds);
+  counter.AddValue(-5);
+  EXPECT_EQ(counter.Value(), kNumThreads * kNumAdds - 5);
+}
+
+TEST(MetricsTest, ThreadSamplesMerge) {
+  static const int kNumSamples = 100;
+  static const size_t kMaxSamples = 64;
+  xla::metrics::MetricData metric(xla::metrics::MetricFnValue, kMaxSamples);
+  RunThreads([&](int t) {
+    for (int i = 0; i < kNumSamples; ++i) {
+      metric.AddSample(/*timestamp_ns=*/i * kNumThreads + t, 1.0);
+    }
+  });
+  double accumulator = 0.0;
+  size_t total_samples = 0;
+  std::vector<xla::metrics::Sample> samples =
+      metric.Samples(&accumulator, &total_samples);
+  EXPECT_EQ(total_samples, kNumThreads * kNumSamples);
+  EXPECT_EQ(accumulator, kNumThreads * kNumSamples);
+  EXPECT_EQ(metric.TotalSamples(), total_samples);
+  EXPECT_EQ(metric.Accumulator(), accumulator);
+  // The most recent samples across all the threads, from the oldest.
+  ASSERT_EQ(samples.size(), kMaxSamples);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(samples[i].timestamp_ns,
+              kNumThreads * kNumSamples - kMaxSamples + i);
+  }
+}
+
+TEST(MetricsTest, ThreadSamplesRetired) {
+  static const size_t kMaxSamples = 16;
+  xla::metrics::MetricData metric(xla::metrics::MetricFnValue, kMaxSamples);
+  for (int round = 0; round < 3; ++round) {
+    RunThreads([&](int t) {
+      metric.AddSample(/*timestamp_ns=*/round * kNumThreads + t, 2.0);
+    });
+    // The buffers of the exited threads got merged and dropped.
+    EXPECT_EQ(metric.ThreadBuffers(), 0);
+  }
+  metric.AddSample(/*timestamp_ns=*/3 * kNumThreads, 2.0);
+  EXPECT_EQ(metric.ThreadBuffers(), 1);
+  double accumulator = 0.0;
+  size_t total_samples = 0;
+  std::vector<xla::metrics::Sample> samples =
+      metric.Samples(&accumulator, &total_samples);
+  EXPECT_EQ(total_samples, 3 * kNumThreads + 1);
+  EXPECT_EQ(accumulator, 2.0 * total_samples);
+  EXPECT_EQ(metric.GetHistogram().Count(), total_samples);
+  ASSERT_EQ(samples.size(), kMaxSamples);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    EXPECT_EQ(samples[i].timestamp_ns, total_samples - kMaxSamples + i);
+  }
+}
+
+TEST(MetricsTest, HistogramPercentiles) {
+  xla::metrics::Histogram histogram;
+  for (int i = 1; i <= 1000; ++i) {
+    histogram.Add(i);
+  }
+  histogram.Add(-4.0);
+  EXPECT_EQ(histogram.Count(), 1001);
+  EXPECT_EQ(histogram.Sum(), 500500.0 - 4.0);
+  EXPECT_EQ(histogram.Min(), -4.0);
+  EXPECT_EQ(histogram.Max(), 1000.0);
+  double tolerance = 1.0 / xla::metrics::Histogram::kSubBuckets;
+  EXPECT_NEAR(histogram.Percentile(0.5), 500.0, 500.0 * tolerance);
+  EXPECT_NEAR(histogram.Percentile(0.99), 990.0, 990.0 * tolerance);
+  EXPECT_EQ(histogram.Percentile(0.0), -4.0);
+
+  xla::metrics::Histogram other;
+  other.Add(1e6);
+  histogram.Merge(other);
+  EXPECT_EQ(histogram.Count(), 1002);
+  EXPECT_EQ(histogram.Max(), 1e6);
+  EXPECT_NEAR(histogram.Percentile(0.9999), 1e6, 1e6 * tolerance);
+  for (auto& index_count : histogram.Buckets()) {
+    std::pair<double, double> bounds =
+        xla::metrics::Histogram::BucketBounds(index_count.first);
+    EXPECT_LE(bounds.first, bounds.second);
+    // The bound closest to zero belongs to the bucket.
+    double value = index_count.first > 0 ? bounds.first : bounds.second;
+    EXPECT_EQ(xla::metrics::Histogram::BucketIndex(value), index_count.first);
+  }
+}
+
+TEST(MetricsTest, PrometheusReport) {
+  xla::metrics::Counter counter("PrometheusTestCounter");
+  counter.AddValue(3);
+  xla::metrics::Metric metric("PrometheusTest\"Metric");
+  metric.AddSample(2.0);
+  metric.AddSample(4.0);
+  std::string report =
+      xla::metrics::CreatePrometheusReport({{"ordinal", "1"}});
+  EXPECT_NE(report.find("xla_counter_total{name=\"PrometheusTestCounter\","
+                        "ordinal=\"1\"} 3\n"),
+            std::string::npos);
+  EXPECT_NE(report.find("xla_metric_sum{name=\"PrometheusTest\\\"Metric\","
+                        "ordinal=\"1\"} 6\n"),
+            std::string::npos);
+  EXPECT_NE(report.find("xla_metric_count{name=\"PrometheusTest\\\"Metric\","
+                        "ordinal=\"1\"} 2\n"),
+            std::string::npos);
+}
+
+TEST(MetricsTest, SnapshotGates) {
+  xla::metrics::Counter counter("aten::snapshot_gates_test");
+  xla::metrics::Metric metric("SnapshotGatesTestBytes");
+  xla::metrics_reader::MetricsSnapshot before =
+      xla::metrics_reader::TakeSnapshot();
+  counter.AddValue(2);
+  metric.AddSample(16.0);
+  metric.AddSample(48.0);
+  xla::metrics_reader::MetricsDelta delta =
+      xla::metrics_reader::DiffSnapshots(before,
+                                         xla::metrics_reader::TakeSnapshot());
+  EXPECT_EQ(delta.counters.at("aten::snapshot_gates_test"), 2);
+  EXPECT_EQ(delta.cpu_fallbacks, 2);
+  EXPECT_EQ(delta.metrics.at("SnapshotGatesTestBytes").total_samples, 2);
+  EXPECT_EQ(delta.metrics.at("SnapshotGatesTestBytes").accumulator, 64.0);
+  EXPECT_TRUE(
+      xla::metrics_reader::CheckGates(delta, {{"SnapshotGatesTestBytes", 2}})
+          .empty());
+  std::vector<std::string> violations = xla::metrics_reader::CheckGates(
+      delta, {{"cpu_fallbacks", 0}, {"UnknownSnapshotGatesTest", 0}});
+  ASSERT_EQ(violations.size(), 1);
+  EXPECT_NE(violations[0].find("cpu_fallbacks"), std::string::npos);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
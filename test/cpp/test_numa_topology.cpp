@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+
+#include "tensorflow/compiler/xla/xla_client/numa_topology.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(NumaTopologyTest, ParseCpuList) {
+  EXPECT_EQ(xla::numa::ParseCpuList("0-3,8,10-11\n"),
+            std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(xla::numa::ParseCpuList("5"), std::vector<int>({5}));
+  EXPECT_TRUE(xla::numa::ParseCpuList("").empty());
+}
+
+TEST(NumaTopologyTest, DeviceNodes) {
+  xla::numa::Topology topology({{0, 1}, {2, 3}}, {1, 0, 5});
+  EXPECT_EQ(topology.GetNumNodes(), 2);
+  EXPECT_EQ(topology.GetCpuNode(3), 1);
+  EXPECT_EQ(topology.GetCpuNode(4), -1);
+  EXPECT_EQ(topology.GetDeviceNode("TPU:0"), 1);
+  EXPECT_EQ(topology.GetDeviceNode(
+                "/job:localservice/replica:0/task:0/device:TPU:1"),
+            0);
+  // Out of range nodes and ordinals are unknown.
+  EXPECT_EQ(topology.GetDeviceNode("TPU:2"), -1);
+  EXPECT_EQ(topology.GetDeviceNode("TPU:3"), -1);
+  EXPECT_EQ(topology.GetDeviceNode("CPU"), -1);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
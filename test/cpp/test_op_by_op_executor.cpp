@@ -49,6 +49,26 @@ TEST(OpByOpExecutorTest, TestStack) {
   });
 }
 
+TEST(OpByOpExecutorTest, TestManyUniqueOps) {
+  ForEachDevice([&](const torch::lazy::BackendDevice& device) {
+    // Every op misses the cache, so they all get compiled in one batch.
+    at::Tensor a = at::rand({5, 7, 2}, at::TensorOptions(at::kFloat));
+    at::Tensor b = at::rand({5, 7, 2}, at::TensorOptions(at::kFloat)) + 1.0;
+    at::Tensor c = ((a + b) * a - b) / b;
+
+    torch::lazy::Value v_a = GetTensorIrValue(a, device);
+    torch::lazy::Value v_b = GetTensorIrValue(b, device);
+    torch::lazy::Value v_c = ((v_a + v_b) * v_a - v_b) / v_b;
+
+    auto results_data =
+        OpByOpExecutor::Get()->Execute({v_c, v_a + v_b}, device.toString(), {});
+    auto results = Fetch(UnwrapXlaData(results_data));
+
+    AllClose(results[0], c);
+    AllClose(results[1], a + b);
+  });
+}
+
 TEST(OpByOpExecutorTest, TestAsyncStack) {
   ForEachDevice([&](const torch::lazy::BackendDevice& device) {
     at::Tensor a = at::rand({4, 8, 3}, at::TensorOptions(at::kFloat));
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+// Writes one file per num_records entry, whose records are "<file>:<record>".
+std::vector<std::string> WriteFiles(const std::string& name,
+                                    const std::vector<size_t>& num_records) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::string dir;
+  XLA_CHECK(env->LocalTempFilename(&dir));
+  XLA_CHECK_OK(env->RecursivelyCreateDir(dir));
+  std::vector<std::string> paths;
+  for (size_t i = 0; i < num_records.size(); ++i) {
+    paths.push_back(absl::StrCat(dir, "/", name, i, ".tfrecord"));
+    std::unique_ptr<tensorflow::WritableFile> file;
+    XLA_CHECK_OK(env->NewWritableFile(paths.back(), &file));
+    tensorflow::io::RecordWriter writer(file.get());
+    for (size_t r = 0; r < num_records[i]; ++r) {
+      XLA_CHECK_OK(writer.WriteRecord(absl::StrCat(i, ":", r)));
+    }
+    XLA_CHECK_OK(writer.Close());
+    XLA_CHECK_OK(file->Close());
+  }
+  return paths;
+}
+
+std::vector<std::string> ReadAll(xla::util::InterleavedRecordReader* reader) {
+  std::vector<std::string> values;
+  xla::util::RecordReader::Data value;
+  while (reader->Read(&value)) {
+    values.emplace_back(value);
+  }
+  return values;
+}
+
+}  // namespace
+
+TEST(RecordReaderTest, InterleavedDeterministic) {
+  std::vector<std::string> paths = WriteFiles("det", {2, 1, 2});
+  xla::util::InterleavedRecordReader::Options options;
+  options.parallelism = 2;
+  options.readahead = 1;
+  xla::util::InterleavedRecordReader reader(paths, options);
+  // The third file takes the turn of the second one, once that is done.
+  EXPECT_EQ(ReadAll(&reader), std::vector<std::string>(
+                                  {"0:0", "1:0", "0:1", "2:0", "2:1"}));
+}
+
+TEST(RecordReaderTest, InterleavedShuffled) {
+  std::vector<std::string> paths = WriteFiles("shuf", {10, 20, 5, 1});
+  xla::util::InterleavedRecordReader::Options options;
+  options.parallelism = 3;
+  options.shuffle = true;
+  options.seed = 17;
+  xla::util::InterleavedRecordReader reader(paths, options);
+  std::vector<std::string> values = ReadAll(&reader);
+  EXPECT_EQ(values.size(), 36);
+  std::vector<std::string> batch;
+  EXPECT_EQ(reader.ReadBatch(8, &batch), 0);
+}
+
+TEST(RecordReaderTest, InterleavedMissingFile) {
+  xla::util::InterleavedRecordReader reader({"/does/not/exist.tfrecord"},
+                                            {});
+  xla::util::RecordReader::Data value;
+  EXPECT_THROW(reader.Read(&value), std::exception);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
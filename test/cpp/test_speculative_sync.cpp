@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <mutex>
+#include <vector>
+
+#include "torch/csrc/lazy/core/hash.h"
+#include "torch_xla/csrc/speculative_sync.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+std::mutex preloaded_lock;
+std::vector<torch::lazy::hash_t> preloaded;
+
+void RecordPreload(const torch::lazy::hash_t& hash) {
+  std::lock_guard<std::mutex> lock(preloaded_lock);
+  preloaded.push_back(hash);
+}
+
+std::vector<torch::lazy::hash_t> TakePreloaded() {
+  std::lock_guard<std::mutex> lock(preloaded_lock);
+  std::vector<torch::lazy::hash_t> hashes;
+  hashes.swap(preloaded);
+  return hashes;
+}
+
+// Traces a step of the given values, ending with the graph_hash sync.
+void RunStep(SpeculativeSync* speculative_sync,
+             const std::vector<int64_t>& values,
+             const torch::lazy::hash_t& graph_hash) {
+  for (int64_t value : values) {
+    speculative_sync->RecordValue(torch::lazy::Hash(value), RecordPreload);
+  }
+  // Waits for the preload of graph_hash, if any.
+  speculative_sync->RecordGraph(graph_hash);
+}
+
+}  // namespace
+
+TEST(SpeculativeSyncTest, PreloadAfterMatches) {
+  SpeculativeSync speculative_sync(/*prefix_values=*/2, /*min_matches=*/2,
+                                   /*max_prefixes=*/16);
+  torch::lazy::hash_t graph1 = torch::lazy::Hash(101);
+  torch::lazy::hash_t graph2 = torch::lazy::Hash(102);
+  TakePreloaded();
+  RunStep(&speculative_sync, {1, 2, 3}, graph1);
+  RunStep(&speculative_sync, {1, 2, 4}, graph1);
+  EXPECT_TRUE(TakePreloaded().empty());
+  // The prefix led to graph1 twice in a row.
+  RunStep(&speculative_sync, {1, 2, 3}, graph1);
+  EXPECT_EQ(TakePreloaded(), std::vector<torch::lazy::hash_t>({graph1}));
+  // Shorter traces than the prefix predict nothing.
+  RunStep(&speculative_sync, {1}, graph2);
+  EXPECT_TRUE(TakePreloaded().empty());
+  // A different successor resets the matches. The mispredicted preload is
+  // waited for by a trace shorter than the prefix.
+  RunStep(&speculative_sync, {1, 2, 5}, graph2);
+  RunStep(&speculative_sync, {}, graph1);
+  EXPECT_EQ(TakePreloaded(), std::vector<torch::lazy::hash_t>({graph1}));
+  RunStep(&speculative_sync, {1, 2}, graph2);
+  EXPECT_TRUE(TakePreloaded().empty());
+  RunStep(&speculative_sync, {1, 2}, graph2);
+  EXPECT_EQ(TakePreloaded(), std::vector<torch::lazy::hash_t>({graph2}));
+  // Other prefixes are unknown.
+  RunStep(&speculative_sync, {2, 1}, graph2);
+  EXPECT_TRUE(TakePreloaded().empty());
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -0,0 +1,44 @@
+#include <gtest/gtest.h>
+
+#include "tensorflow/compiler/xla/xla_client/staging_buffer_pool.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(StagingBufferPoolTest, SizeClasses) {
+  EXPECT_EQ(xla::StagingBufferPool::GetSizeClass(1), 64);
+  EXPECT_EQ(xla::StagingBufferPool::GetSizeClass(1024), 1024);
+  EXPECT_EQ(xla::StagingBufferPool::GetSizeClass(1025), 1280);
+  EXPECT_EQ(xla::StagingBufferPool::GetSizeClass(1800), 2048);
+}
+
+TEST(StagingBufferPoolTest, Reuse) {
+  xla::StagingBufferPool pool(/*max_size=*/4096, /*page_lock=*/false);
+  char* data = nullptr;
+  {
+    std::shared_ptr<char> buffer = pool.Acquire(1000);
+    data = buffer.get();
+  }
+  EXPECT_EQ(pool.GetCachedBytes(), 1024);
+  // Same size class, so the buffer gets recycled.
+  std::shared_ptr<char> buffer = pool.Acquire(1010);
+  EXPECT_EQ(buffer.get(), data);
+  EXPECT_EQ(pool.GetCachedBytes(), 0);
+}
+
+TEST(StagingBufferPoolTest, MaxSize) {
+  xla::StagingBufferPool pool(/*max_size=*/2048, /*page_lock=*/false);
+  {
+    std::shared_ptr<char> buffer1 = pool.Acquire(2048);
+    std::shared_ptr<char> buffer2 = pool.Acquire(2048);
+  }
+  EXPECT_EQ(pool.GetCachedBytes(), 2048);
+  {
+    // Too big to be retained.
+    std::shared_ptr<char> buffer = pool.Acquire(8192);
+  }
+  EXPECT_EQ(pool.GetCachedBytes(), 2048);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "cpp_test_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "torch/csrc/autograd/variable.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/tensor.h"
@@ -263,6 +264,30 @@ TEST_F(TensorTest, TestViewOfViewMod) {
   });
 }
 
+TEST_F(TensorTest, TestReleaseDeadView) {
+  at::Tensor input = at::zeros({32, 20, 4, 4}, at::TensorOptions(at::kFloat));
+  at::Tensor one = at::tensor(1.0, at::TensorOptions(at::kFloat));
+  input.view({-1, 320}).add_(one, 1.0);
+  input.add_(one, 1.0);
+  ForEachDevice([&](const torch::lazy::BackendDevice& device) {
+    at::Tensor dev_input =
+        at::zeros({32, 20, 4, 4},
+                  at::TensorOptions(bridge::XlaDeviceToAtenDevice(device)));
+    at::Tensor dev_one = at::tensor(
+        1.0, at::TensorOptions(bridge::XlaDeviceToAtenDevice(device)));
+    dev_input.view({-1, 320}).add_(dev_one, 1.0);
+    // The only other view of the input is gone, so the step barrier turns the
+    // input back into a plain tensor, without any pending IR being synced.
+    XLATensor::MarkStep(device);
+    xla::metrics::CounterData* counter =
+        xla::metrics::GetCounter("ReleasedDeadIrViews");
+    ASSERT_NE(counter, nullptr);
+    EXPECT_GT(counter->Value(), 0);
+    dev_input.add_(dev_one, 1.0);
+    AllClose(input, dev_input);
+  });
+}
+
 TEST_F(TensorTest, TestMaxPool2D) {
   at::Tensor input = at::rand({1, 64, 112, 112}, at::TensorOptions(at::kFloat));
   int kernel_size = 3;
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(ThreadPoolTest, RunsAllClosures) {
+  const size_t num_closures = 1000;
+  std::atomic<size_t> count(0);
+  xla::util::MultiWait mwait(num_closures);
+  for (size_t i = 0; i < num_closures; ++i) {
+    xla::env::ScheduleClosure(mwait.Completer([&]() { count += 1; }));
+  }
+  mwait.Wait();
+  EXPECT_EQ(count.load(), num_closures);
+}
+
+TEST(ThreadPoolTest, NestedWaits) {
+  // More closures than workers, all waiting for the ones they schedule, which
+  // only completes if the blocked workers get compensated.
+  const size_t num_closures = 2 * std::thread::hardware_concurrency() + 1;
+  std::atomic<size_t> count(0);
+  xla::util::MultiWait mwait(num_closures);
+  for (size_t i = 0; i < num_closures; ++i) {
+    xla::env::ScheduleClosure(mwait.Completer([&]() {
+      xla::env::ScheduleClosureWithCompletion([&]() { count += 1; }).Wait();
+    }));
+  }
+  mwait.Wait();
+  EXPECT_EQ(count.load(), num_closures);
+}
+
+TEST(ThreadPoolTest, IoClosures) {
+  const size_t num_closures = 16;
+  xla::util::MultiWait started(num_closures);
+  xla::util::MultiWait mwait(num_closures);
+  for (size_t i = 0; i < num_closures; ++i) {
+    // Every closure blocks until all of them started.
+    xla::env::ScheduleIoClosure(mwait.Completer([&]() {
+      started.Done();
+      started.Wait();
+    }));
+  }
+  mwait.Wait();
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
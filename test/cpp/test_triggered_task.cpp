@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "tensorflow/compiler/xla/xla_client/triggered_task.h"
+
+namespace torch_xla {
+namespace cpp_test {
+
+TEST(TriggeredTaskTest, RunsAfterActivation) {
+  std::atomic<int> runs(0);
+  xla::util::TriggeredTask task([&]() { ++runs; }, 1);
+  size_t run_id = task.Activate();
+  EXPECT_GT(task.WaitForRun(run_id), run_id);
+  EXPECT_GE(runs.load(), 1);
+  task.Stop();
+}
+
+TEST(TriggeredTaskTest, CoalescesDelayedActivations) {
+  std::atomic<int> runs(0);
+  xla::util::TriggeredTask::Options options;
+  options.max_delay = std::chrono::milliseconds(200);
+  xla::util::TriggeredTask task([&]() { ++runs; }, options);
+  for (int i = 0; i < 100; ++i) {
+    task.Activate();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  EXPECT_EQ(runs.load(), 1);
+  task.Stop();
+}
+
+TEST(TriggeredTaskTest, UrgentActivationSkipsDelay) {
+  std::atomic<int> runs(0);
+  xla::util::TriggeredTask::Options options;
+  options.max_delay = std::chrono::seconds(60);
+  xla::util::TriggeredTask task([&]() { ++runs; }, options);
+  task.Activate();
+  auto start = std::chrono::steady_clock::now();
+  task.Activate(/*urgent=*/true);
+  while (runs.load() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(30));
+  task.Stop();
+}
+
+TEST(TriggeredTaskTest, WaitersSkipDelay) {
+  std::atomic<int> runs(0);
+  xla::util::TriggeredTask::Options options;
+  options.max_delay = std::chrono::seconds(60);
+  xla::util::TriggeredTask task([&]() { ++runs; }, options);
+  size_t run_id = task.Activate();
+  EXPECT_GT(task.WaitForRun(run_id), run_id);
+  EXPECT_EQ(runs.load(), 1);
+  task.Stop();
+}
+
+TEST(TriggeredTaskTest, MinIntervalSpacesRuns) {
+  std::atomic<int> runs(0);
+  xla::util::TriggeredTask::Options options;
+  options.min_interval = std::chrono::milliseconds(100);
+  xla::util::TriggeredTask task([&]() { ++runs; }, options);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 3; ++i) {
+    task.Activate(/*urgent=*/true);
+    while (runs.load() <= i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(200));
+  task.Stop();
+}
+
+TEST(TriggeredTaskTest, AdaptiveConcurrencyIsBounded) {
+  std::atomic<int> active(0);
+  std::atomic<int> max_active(0);
+  auto taskfn = [&]() {
+    int current = ++active;
+    int observed = max_active.load();
+    while (current > observed &&
+           !max_active.compare_exchange_weak(observed, current)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    --active;
+  };
+  xla::util::TriggeredTask::Options options;
+  options.num_threads = 4;
+  options.adaptive_concurrency = true;
+  xla::util::TriggeredTask task(taskfn, options);
+  for (int i = 0; i < 200; ++i) {
+    task.Activate();
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  size_t run_id = task.Activate();
+  task.WaitForRun(run_id);
+  EXPECT_GE(max_active.load(), 1);
+  EXPECT_LE(max_active.load(), 4);
+  task.Stop();
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
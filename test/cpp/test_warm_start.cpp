@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/core/platform/env.h"
+#include "torch_xla/csrc/warm_start.h"
+
+namespace torch_xla {
+namespace cpp_test {
+namespace {
+
+std::string TempManifestPath() {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::string dir;
+  XLA_CHECK(env->LocalTempFilename(&dir));
+  XLA_CHECK_OK(env->RecursivelyCreateDir(dir));
+  return absl::StrCat(dir, "/warm_start.manifest");
+}
+
+// The WarmStart objects are leaked, like the singleton, as the manifest writes
+// scheduled by RecordGraph() run in background.
+WarmStart* MakeWarmStart(const std::string& path, size_t max_graphs) {
+  return new WarmStart(path, max_graphs);
+}
+
+}  // namespace
+
+TEST(WarmStartTest, ManifestRoundTrip) {
+  std::string path = TempManifestPath();
+  torch::lazy::hash_t hash1 = torch::lazy::Hash(1);
+  torch::lazy::hash_t hash2 = torch::lazy::Hash(2);
+  WarmStart* writer = MakeWarmStart(path, /*max_graphs=*/16);
+  EXPECT_TRUE(writer->GetGraphs().empty());
+  writer->RecordGraph(hash2);
+  writer->RecordGraph(hash1);
+  writer->RecordGraph(hash2);
+  writer->Flush();
+
+  WarmStart* reader = MakeWarmStart(path, /*max_graphs=*/16);
+  EXPECT_EQ(reader->GetGraphs(),
+            std::vector<std::string>({torch::lazy::HashToString(hash2),
+                                      torch::lazy::HashToString(hash1)}));
+  // Nothing got preloaded.
+  EXPECT_EQ(reader->Take(hash2), nullptr);
+  EXPECT_EQ(MakeWarmStart(path, /*max_graphs=*/1)->GetGraphs().size(), 1);
+}
+
+TEST(WarmStartTest, ManifestMerge) {
+  std::string path = TempManifestPath();
+  torch::lazy::hash_t hash1 = torch::lazy::Hash(1);
+  torch::lazy::hash_t hash2 = torch::lazy::Hash(2);
+  WarmStart* late = MakeWarmStart(path, /*max_graphs=*/16);
+  WarmStart* early = MakeWarmStart(path, /*max_graphs=*/16);
+  early->RecordGraph(hash1);
+  early->Flush();
+  // The graphs stored by other processes are kept. The order depends on the
+  // background writes.
+  late->RecordGraph(hash2);
+  late->Flush();
+  std::vector<std::string> graphs =
+      MakeWarmStart(path, /*max_graphs=*/16)->GetGraphs();
+  std::sort(graphs.begin(), graphs.end());
+  std::vector<std::string> expected = {torch::lazy::HashToString(hash1),
+                                       torch::lazy::HashToString(hash2)};
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(graphs, expected);
+}
+
+}  // namespace cpp_test
+}  // namespace torch_xla
@@ -1,13 +1,57 @@
 #include <gtest/gtest.h>
 
 #include <string>
+#include <thread>
+#include <vector>
 
 #include "cpp_test_util.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/sharded_cache.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 
 namespace torch_xla {
 namespace cpp_test {
+namespace {
+
+static const int kNumContentionThreads = 8;
+static const int kNumContentionLookups = 20000;
+
+// Runs a read mostly workload, like the one the IR shape cache sees while
+// tracing, from many threads, and checks the cache contents and stats.
+template <typename C>
+void RunContention(C* cache, int num_keys) {
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumContentionThreads; ++t) {
+    threads.emplace_back([cache, num_keys, t]() {
+      for (int i = 0; i < kNumContentionLookups; ++i) {
+        int key = (i * 31 + t) % num_keys;
+        auto ptr = cache->Get(key);
+        if (ptr == nullptr) {
+          ptr = cache->Add(key, std::make_shared<int>(key));
+        }
+        EXPECT_EQ(*ptr, key);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int key = 0; key < num_keys; ++key) {
+    auto ptr = cache->Get(key);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, key);
+  }
+  xla::util::CacheStats stats = cache->GetStats();
+  // Every key misses at least once, and at most once per thread racing to add
+  // it, then only hits, as the cache has room for all the keys.
+  EXPECT_EQ(stats.hits + stats.misses,
+            kNumContentionThreads * kNumContentionLookups + num_keys);
+  EXPECT_GE(stats.misses, num_keys);
+  EXPECT_LE(stats.misses, num_keys * kNumContentionThreads);
+  EXPECT_EQ(stats.evictions, 0);
+}
+
+}  // namespace
 
 TEST(XlaUtilCacheTest, BasicTest) {
   static const int kMaxSize = 64;
@@ -36,5 +80,139 @@ TEST(XlaUtilCacheTest, BasicTest) {
   EXPECT_EQ(ptr, nullptr);
 }
 
+TEST(XlaUtilCacheTest, ByteBudgetTest) {
+  static const size_t kMaxBytes = 100;
+  std::vector<int> evicted;
+  xla::util::Cache<int, std::string> cache(
+      /*max_size=*/1024, kMaxBytes,
+      [](const std::string& str) { return str.size(); },
+      /*cost_fn=*/nullptr,
+      [&](const int& key, const std::shared_ptr<std::string>&) {
+        evicted.push_back(key);
+      });
+
+  // A small object which keeps getting hit, and a big one.
+  cache.Add(0, std::make_shared<std::string>(10, 'a'));
+  cache.Add(1, std::make_shared<std::string>(60, 'b'));
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_NE(cache.Get(0), nullptr);
+  }
+  EXPECT_EQ(cache.GetBytes(), 70);
+
+  // Going over budget evicts the big object, even if more recently used.
+  cache.Add(2, std::make_shared<std::string>(40, 'c'));
+  EXPECT_EQ(evicted, std::vector<int>({1}));
+  EXPECT_NE(cache.Get(0), nullptr);
+  EXPECT_EQ(cache.Get(1), nullptr);
+  EXPECT_NE(cache.Get(2), nullptr);
+  EXPECT_EQ(cache.GetBytes(), 50);
+
+  EXPECT_TRUE(cache.Erase(0));
+  EXPECT_EQ(cache.GetBytes(), 40);
+  cache.Clear();
+  EXPECT_EQ(cache.GetBytes(), 0);
+}
+
+TEST(XlaUtilCacheTest, ShardedBasicTest) {
+  static const int kMaxSize = 64;
+  xla::util::ShardedCache<int, std::string> cache(kMaxSize, /*num_shards=*/4);
+
+  for (int i = 0; i < 4 * kMaxSize; ++i) {
+    std::string istr = std::to_string(i);
+    auto ptr = cache.Add(i, std::make_shared<std::string>(istr));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, istr);
+
+    ptr = cache.Get(i);
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, istr);
+  }
+  EXPECT_LE(cache.Size(), kMaxSize);
+
+  // Adding an existing key returns the cached object.
+  auto ptr = cache.Add(-1, std::make_shared<std::string>("MINUS"));
+  ptr = cache.Add(-1, std::make_shared<std::string>("OTHER"));
+  ASSERT_NE(ptr, nullptr);
+  EXPECT_EQ(*ptr, "MINUS");
+  EXPECT_TRUE(cache.Erase(-1));
+  EXPECT_FALSE(cache.Erase(-1));
+  EXPECT_EQ(cache.Get(-1), nullptr);
+
+  cache.Clear();
+  EXPECT_EQ(cache.Size(), 0);
+}
+
+TEST(XlaUtilCacheTest, ShardedClockTest) {
+  // With a single shard, a referenced object survives a full sweep.
+  xla::util::ShardedCache<int, int> cache(/*max_size=*/4, /*num_shards=*/1);
+  for (int i = 0; i < 4; ++i) {
+    cache.Add(i, std::make_shared<int>(i));
+  }
+  ASSERT_NE(cache.Get(0), nullptr);
+  for (int i = 4; i < 7; ++i) {
+    cache.Add(i, std::make_shared<int>(i));
+    EXPECT_NE(cache.Get(0), nullptr);
+  }
+  EXPECT_EQ(cache.Size(), 4);
+}
+
+TEST(XlaUtilCacheTest, StatsTest) {
+  xla::util::Cache<int, int> cache(/*max_size=*/2);
+  EXPECT_EQ(cache.Get(0), nullptr);
+  for (int i = 0; i < 3; ++i) {
+    cache.Add(i, std::make_shared<int>(i));
+  }
+  EXPECT_NE(cache.Get(2), nullptr);
+  xla::util::CacheStats stats = cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.evictions, 1);
+  EXPECT_EQ(stats.rejections, 0);
+
+  xla::util::ShardedCache<int, int> sharded_cache(/*max_size=*/2,
+                                                  /*num_shards=*/1);
+  EXPECT_EQ(sharded_cache.Get(0), nullptr);
+  for (int i = 0; i < 3; ++i) {
+    sharded_cache.Add(i, std::make_shared<int>(i));
+  }
+  EXPECT_NE(sharded_cache.Get(2), nullptr);
+  stats = sharded_cache.GetStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.evictions, 1);
+}
+
+TEST(XlaUtilCacheTest, TinyLfuAdmissionTest) {
+  xla::util::CacheOptions options;
+  options.admission = xla::util::CacheAdmission::kTinyLfu;
+  xla::util::Cache<int, int> cache(/*max_size=*/4, options);
+  for (int i = 0; i < 4; ++i) {
+    cache.Add(i, std::make_shared<int>(i));
+    for (int j = 0; j < 4; ++j) {
+      ASSERT_NE(cache.Get(i), nullptr);
+    }
+  }
+  // A scan of one-off keys does not flush the ones which keep getting hit.
+  for (int i = 4; i < 64; ++i) {
+    auto ptr = cache.Add(i, std::make_shared<int>(i));
+    ASSERT_NE(ptr, nullptr);
+    EXPECT_EQ(*ptr, i);
+    for (int j = 0; j < 4; ++j) {
+      EXPECT_NE(cache.Get(j), nullptr);
+    }
+  }
+  EXPECT_GT(cache.GetStats().rejections, 0);
+}
+
+TEST(XlaUtilCacheTest, ContentionTest) {
+  static const int kNumKeys = 1024;
+  xla::util::Cache<int, int> cache(2 * kNumKeys);
+  xla::util::ShardedCache<int, int> sharded_cache(2 * kNumKeys);
+
+  RunContention(&cache, kNumKeys);
+  RunContention(&sharded_cache, kNumKeys);
+  EXPECT_EQ(sharded_cache.Size(), kNumKeys);
+}
+
 }  // namespace cpp_test
 }  // namespace torch_xla
@@ -109,6 +109,38 @@ FZXY
     self.assertEqual(blobs[0].size, SIZE)
     self.assertFalse(blobs[0].isdir)
 
+  def test_readinto(self):
+    SIZE = 10000000  # 10MB
+    FNAME = 'test_readinto'
+    gcs_path = _gcs_test_path(name=FNAME)
+    content = _create_gcs_file(gcs_path, 'wb', size=SIZE, cleanup=self._cleanup)
+    buffer = bytearray(SIZE)
+    self.assertEqual(gcs.readinto(gcs_path, buffer), SIZE)
+    self.assertEqual(content, bytes(buffer))
+    # Past the end of the blob, only the available bytes get read.
+    tail = bytearray(100)
+    self.assertEqual(gcs.readinto(gcs_path, tail, offset=SIZE - 10), 10)
+    self.assertEqual(content[-10:], bytes(tail[:10]))
+    pending = gcs.readinto_async(gcs_path, memoryview(buffer)[:1000], offset=1)
+    self.assertEqual(pending.wait(), 1000)
+    self.assertTrue(pending.is_ready())
+    self.assertEqual(content[1:1001], bytes(buffer[:1000]))
+
+  def test_write_many(self):
+    SIZE = 1000000  # 1MB
+    COUNT = 8
+    paths = [
+        _gcs_test_path(name='test_write_many_{}'.format(i))
+        for i in range(COUNT)
+    ]
+    contents = [os.urandom(SIZE) for _ in range(COUNT)]
+    buffers = [memoryview(bytearray(c)) for c in contents]
+    for path in paths:
+      self._cleanup.append(lambda path=path: gcs.remove(path))
+    gcs.write_many(paths, buffers)
+    for path, content in zip(paths, contents):
+      self.assertEqual(content, gcs.read(path))
+
 
 if __name__ == '__main__':
   if _TEST_PATH is not None:
@@ -1,5 +1,6 @@
 import concurrent.futures
 import os
+import threading
 import time
 
 import torch
@@ -90,5 +91,25 @@ class TestExperimentalPjrt(parameterized.TestCase):
     self.assertDictEqual(results, {0: {0: torch.device('xla:0')}})
 
 
+  def test_host_callback(self):
+    device = xm.xla_device()
+    received = []
+    done = threading.Event()
+
+    def _callback(device_str, value):
+      received.append((device_str, value))
+      if len(received) == 2:
+        done.set()
+
+    x = torch.arange(4, dtype=torch.float32, device=device)
+    y = xm.host_callback(x * 2, _callback)
+    z = xm.host_callback(y + 1, _callback)
+    xm.mark_step()
+    self.assertTrue(done.wait(timeout=30))
+    xm.remove_host_callback(_callback)
+    self.assertEqual(received[0][1].tolist(), [0.0, 2.0, 4.0, 6.0])
+    self.assertEqual(received[1][1].tolist(), [1.0, 3.0, 5.0, 7.0])
+    self.assertEqual(z.cpu().tolist(), [1.0, 3.0, 5.0, 7.0])
+
 if __name__ == '__main__':
   absltest.main()
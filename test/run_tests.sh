@@ -70,6 +70,11 @@ function run_eager_debug {
   XLA_USE_EAGER_DEBUG_MODE=1 run_test "$@"
 }
 
+function run_eager {
+  echo "Running in Eager mode: $@"
+  XLA_USE_EAGER_MODE=1 XLA_EAGER_MICRO_GRAPH_OPS=8 run_test "$@"
+}
+
 function run_xla_backend_mp {
   echo "Running XLA backend multiprocessing test: $@"
   MASTER_ADDR=localhost MASTER_PORT=6000 run_test "$@"
@@ -85,6 +90,41 @@ function run_async_scalar {
   XLA_TRANSFER_SCALAR_ASYNC=1 run_test "$@"
 }
 
+function run_counter_rng {
+  echo "Running with XLA_RNG_COUNTER_BASED: $@"
+  XLA_RNG_COUNTER_BASED=1 run_test "$@"
+}
+
+function run_inplace_updates {
+  echo "Running with XLA_INPLACE_UPDATES: $@"
+  XLA_INPLACE_UPDATES=1 run_test "$@"
+}
+
+function run_autocast {
+  echo "Running with XLA_AUTOCAST: $@"
+  XLA_AUTOCAST=1 run_test "$@"
+}
+
+function run_memory_tracker {
+  echo "Running with XLA_MEMORY_TRACKER: $@"
+  XLA_MEMORY_TRACKER=1 run_test "$@"
+}
+
+function run_fn_tracker {
+  echo "Running with XLA_FNTRACKER_MODE: $@"
+  XLA_FNTRACKER_MODE=binary XLA_FNTRACKER_FILE=/tmp/xla_fn_tracker.bin run_test "$@"
+}
+
+function run_step_breakdown {
+  echo "Running with XLA_STEP_BREAKDOWN: $@"
+  XLA_STEP_BREAKDOWN=1 run_test "$@"
+}
+
+function run_cpu_fallback_decompose {
+  echo "Running with XLA_CPU_FALLBACK_DECOMPOSE: $@"
+  XLA_CPU_FALLBACK_DECOMPOSE=1 run_test "$@"
+}
+
 function run_op_tests {
   run_dynamic python3 "$CDIR/../../test/test_view_ops.py" "$@" -v TestViewOpsXLA
   run_test python3 "$CDIR/../../test/test_torch.py" "$@" -v TestTorchDeviceTypeXLA
@@ -97,7 +137,15 @@ function run_op_tests {
   run_dynamic python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
   run_opbyop python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
   run_eager_debug python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
+  run_eager python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
   run_async_scalar python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
+  run_counter_rng python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY TestRandomOps
+  run_inplace_updates python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY TestInPlaceUpdates
+  run_autocast python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY TestAutocastPolicy
+  run_memory_tracker python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY TestMemoryTracker
+  run_fn_tracker python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY TestFunctionCallTracker
+  run_cpu_fallback_decompose python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY TestCpuFallbackDecompose
+  run_step_breakdown python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY TestStepBreakdown
   run_test python3 "$CDIR/test_grad_checkpoint.py"
   run_pjrt python3 "$CDIR/test_operations.py" "$@" --verbosity=$VERBOSITY
   run_test python3 "$CDIR/test_async_closures.py"
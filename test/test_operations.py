@@ -18,6 +18,7 @@ sys.argv = [sys.argv[0]] + leftovers
 import collections
 import copy
 import itertools
+import json
 import math
 from numbers import Number
 import numpy
@@ -34,10 +35,14 @@ import torch_xla.core.xla_op_registry as xor
 import torch_xla.distributed.data_parallel as dp
 import torch_xla.debug.metrics as met
 import torch_xla.debug.model_comparator as mc
+import torch_xla.debug.summary as xsum
 import torch_xla.distributed.parallel_loader as pl
+import torch_xla.distributed.pipeline as pipeline
 import torch_xla.test.test_utils as xtu
+import torch_xla.utils.checkpoint as checkpoint
 import torch_xla.utils.utils as xu
 import torch_xla.utils.serialization as xser
+import torch_xla.utils.serving as serving
 import torch_xla.core.xla_model as xm
 import torch_xla.core.functions as xf
 import torchvision
@@ -562,6 +567,25 @@ class TestAtenTensorTo(XlaTestCase):
       self.assertEqual(t0.cpu(), t1.cpu())
 
 
+class TestMultiDeviceFetch(XlaTestCase):
+
+  def test(self):
+    devices = xm.get_xla_supported_devices()
+    cpu_tensors = [_gen_tensor(3, 4) for _ in devices]
+    xla_tensors = []
+    for device, cpu_tensor in zip(devices, cpu_tensors):
+      xla_tensor = cpu_tensor.to(device=torch.device(device))
+      xla_tensors.append(xla_tensor * 2.0)
+      xla_tensors.append(xla_tensor)
+    fetches = met.counter_value('MultiDeviceFetches') or 0
+    fetched = torch_xla._XLAC._xla_get_cpu_tensors(xla_tensors)
+    for i, cpu_tensor in enumerate(cpu_tensors):
+      self.assertEqual(fetched[2 * i], cpu_tensor * 2.0)
+      self.assertEqual(fetched[2 * i + 1], cpu_tensor)
+    if len(devices) > 1:
+      self.assertEqual(met.counter_value('MultiDeviceFetches'), fetches + 1)
+
+
 class XlaMNIST(nn.Module):
 
   def __init__(self):
@@ -747,6 +771,107 @@ class TestDynamicShape(XlaTestCase):
         torch.masked_select(x, mask), 0)
     self.assertEqual(x_dim0_shape.item(), 3)
 
+  def test_nonzero_padded(self):
+    x = torch.tensor([[0, 1, 2], [0, 3, 0]], device=xm.xla_device())
+    indices, count = xf.nonzero_padded(x)
+    # The padded indices compose with the following ops at their static size.
+    values = x[indices[:, 0], indices[:, 1]]
+    self.assertEqual(indices.size(), torch.Size([6, 2]))
+    self.assertEqual(count.item(), 3)
+    self.assertEqual(indices.cpu()[:3], torch.tensor([[0, 1], [0, 2], [1, 1]]))
+    self.assertEqual(values.cpu(), torch.tensor([1, 2, 3, 0, 0, 0]))
+    self.assertIn('AvoidedSizeSyncs', met.counter_names())
+
+  def test_masked_select_padded(self):
+    x = torch.tensor([5.0, 0.5, 7.0, 1.0], device=xm.xla_device())
+    values, count = xf.masked_select_padded(x, x > 2.0)
+    self.assertEqual(count.item(), 2)
+    self.assertEqual(values.cpu(), torch.tensor([5.0, 7.0, 0.0, 0.0]))
+
+  def test_bounded_shape_no_recompile(self):
+    device = xm.xla_device()
+    sizes = []
+    compiles = []
+    for values in ((0, 1, 2, 0, 3, 4), (5, 0, 0, 0, 0, 6)):
+      nonzero = torch.nonzero(
+          torch.tensor(values, device=device), as_tuple=False)
+      xm.mark_step()
+      # The synced result keeps its bounded shape, so the graph consuming it
+      # does not change with the actual number of non zero elements.
+      size = torch_xla._XLAC._get_xla_tensor_dimension_size(nonzero, 0)
+      xm.mark_step()
+      sizes.append(size.item())
+      compiles.append(met.metric_data('CompileTime')[0])
+    self.assertEqual(sizes, [4, 2])
+    self.assertEqual(compiles[0], compiles[1])
+
+
+class TestGraphReplay(XlaTestCase):
+
+  def test_capture_and_replay(self):
+    device = xm.xla_device()
+    x = torch.randn(4, 4, device=device)
+    w = torch.randn(4, 4, device=device)
+    xm.mark_step()
+    y = torch.matmul(x, w) + 1.0
+    graph_id = torch_xla._XLAC._xla_capture_graph([y], [x, w])
+    self.assertEqual(y, torch.matmul(x, w) + 1.0)
+    for _ in range(3):
+      x = torch.randn(4, 4, device=device)
+      xm.mark_step()
+      y, = torch_xla._XLAC._xla_replay_graph(graph_id, [x, w])
+      self.assertEqual(y.cpu(), torch.matmul(x.cpu(), w.cpu()) + 1.0)
+
+  def test_capture_loop(self):
+    device = xm.xla_device()
+    w = torch.randn(4, 4, device=device)
+    x = torch.randn(4, 4, device=device)
+
+    def step_fn(w, x):
+      y = torch.matmul(x, w)
+      return w - 0.1 * y, y.sum()
+
+    run_loop = xm.capture_loop(step_fn, [w], [x], 3)
+    xs = torch.randn(3, 4, 4)
+    expected_w = w.cpu()
+    for i in range(3):
+      expected_w, expected_sum = step_fn(expected_w, xs[i])
+    loop_w, loop_sum = run_loop([w], [xs.to(device)])
+    self.assertEqual(loop_w.cpu(), expected_w)
+    self.assertEqual(loop_sum.cpu(), expected_sum)
+
+  def test_frozen_model(self):
+    device = xm.xla_device()
+    model = nn.Linear(8, 4)
+    xla_model = copy.deepcopy(model).to(device)
+    frozen = serving.FrozenModel(xla_model, [torch.randn(1, 8)], [2, 4])
+    replays = met.counter_value('ReplayGraph') or 0
+    for batch_size in [1, 2, 3, 4]:
+      x = torch.randn(batch_size, 8)
+      self.assertEqual(frozen(x), model(x).detach())
+    self.assertEqual(met.counter_value('ReplayGraph'), replays + 4)
+    batcher = serving.DynamicBatcher(frozen, max_delay=0.05)
+    xs = [torch.randn(1, 8) for _ in range(6)]
+    futures = [batcher.submit(x) for x in xs]
+    for x, future in zip(xs, futures):
+      self.assertEqual(future.result(), model(x).detach())
+    batcher.close()
+    frozen.release()
+
+
+class TestPadToBucket(XlaTestCase):
+
+  def test_pad_to_bucket(self):
+    device = xm.xla_device()
+    x = torch.rand(3, 5, device=device)
+    padded, mask = xf.pad_to_bucket(x, 1, [4, 8, 16])
+    self.assertEqual(padded.size(), (3, 8))
+    self.assertEqual(padded[:, :5].cpu(), x.cpu())
+    self.assertEqual(padded[:, 5:].cpu(), torch.zeros(3, 3))
+    self.assertEqual(mask.cpu(), torch.arange(8) < 5)
+    padded, _ = xf.pad_to_bucket(x, 1, [4])
+    self.assertEqual(padded.size(), (3, 8))
+
 
 class TestOptimizationBarrier(XlaTestCase):
 
@@ -952,6 +1077,33 @@ class TestAtenXlaTensor(XlaTestCase):
     with self.assertRaisesRegex(RuntimeError, r'unsupported range'):
       a = torch.arange(float('nan'), 5, device=xm.xla_device())
 
+  def test_host_mirror(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 4, device=xla_device)
+    xm.mark_step()
+    hits = met.counter_value('HostMirrorHit') or 0
+    a = x.cpu()
+    # Only the device data read a second time get mirrored.
+    self.assertEqual(x.cpu(), a)
+    self.assertEqual(met.counter_value('HostMirrorHit') or 0, hits)
+    b = x.cpu()
+    self.assertEqual(met.counter_value('HostMirrorHit'), hits + 1)
+    self.assertEqual(a, b)
+    # The host copies are owned by the callers.
+    b.add_(1.0)
+    self.assertEqual(x.cpu(), a)
+    x.add_(1.0)
+    self.assertEqual(x.cpu(), b)
+
+  def test_arange_hoisted(self):
+    xla_device = xm.xla_device()
+    hoisted = met.counter_value('HoistedConstants') or 0
+    a = torch.arange(0, 4096, dtype=torch.int32, device=xla_device)
+    b = torch.arange(1, 4097, dtype=torch.int32, device=xla_device)
+    self.assertEqual(met.counter_value('HoistedConstants'), hoisted + 2)
+    self.assertEqual(a.cpu(), torch.arange(0, 4096, dtype=torch.int32))
+    self.assertEqual(b.cpu(), torch.arange(1, 4097, dtype=torch.int32))
+
   def test_empty_advanced_indexing(self):
     xla_device = xm.xla_device()
     base = torch.randn(2, 3, 4, 5)
@@ -1191,6 +1343,41 @@ class TestAtenXlaTensor(XlaTestCase):
     self.assertEqual(b.grad.tolist(), [5])
     self.assertIsNone(a.grad)
 
+  def test_coalesced_slice_updates(self):
+    xla_device = xm.xla_device()
+    t = torch.zeros(16, 8)
+    xt = t.to(xla_device)
+    coalesced = met.counter_value('ViewUpdatesCoalesced') or 0
+    for i in range(4):
+      rows = torch.full((2, 8), i + 1.0)
+      t[i * 2:(i + 1) * 2] = rows
+      xt[i * 2:(i + 1) * 2] = rows.to(xla_device)
+    # Overlapping the previous writes.
+    t[3:10] = 9.0
+    xt[3:10] = 9.0
+    self.assertEqual(xt.cpu(), t)
+    self.assertGreater(met.counter_value('ViewUpdatesCoalesced'), coalesced)
+
+  def test_clone_shares_device_data(self):
+    xla_device = xm.xla_device()
+    xt = torch.rand(4, 8, device=xla_device)
+    xm.mark_step()
+    expected = xt.cpu()
+    shared = met.counter_value('SharedDeviceData') or 0
+    xclone = xt.clone()
+    xcopy = torch.zeros(4, 8, device=xla_device)
+    xcopy.copy_(xt)
+    self.assertEqual(met.counter_value('SharedDeviceData'), shared + 2)
+    xt.add_(1.0)
+    xm.mark_step()
+    self.assertEqual(xclone.cpu(), expected)
+    self.assertEqual(xcopy.cpu(), expected)
+    self.assertEqual(xt.cpu(), expected + 1.0)
+    xclone.mul_(2.0)
+    xm.mark_step()
+    self.assertEqual(xclone.cpu(), expected * 2.0)
+    self.assertEqual(xcopy.cpu(), expected)
+
   def test_inplace_view_modify_base(self):
     # Test that an in-place operation on a base that forced it to require
     # grad also forces any previous views to require grad and backprop
@@ -1662,6 +1849,48 @@ class TestAtenXlaTensor(XlaTestCase):
       loaded_model = cpu_model.to(xla_device)
       self.assertEqual(model.state_dict(), loaded_model.state_dict())
 
+  def test_serialization_api_mapped(self):
+    with tempfile.TemporaryDirectory() as tmpdir:
+      path = os.path.join(tmpdir, 'data.pt')
+      xla_device = xm.xla_device()
+      model = XlaMNIST().to(xla_device)
+      xser.save(model.state_dict(), path, mapped=True)
+      state_dict = xser.load(path)
+      cpu_model = XlaMNIST()
+      cpu_model.load_state_dict(state_dict)
+      self.assertEqual(model.state_dict(),
+                       cpu_model.to(xla_device).state_dict())
+      xla_state_dict = xser.load(path, device=xla_device)
+      for key, tensor in model.state_dict().items():
+        self.assertEqual(xla_state_dict[key].device, xla_device)
+        self.assertEqual(xla_state_dict[key], tensor)
+
+  def test_device_snapshotter(self):
+    with tempfile.TemporaryDirectory() as tmpdir:
+      path = os.path.join(tmpdir, 'snapshot.pt')
+      xla_device = xm.xla_device()
+      state = {
+          'a': torch.rand(4, device=xla_device),
+          'b': torch.rand(3, device=xla_device),
+          'step': 0
+      }
+      snapshotter = xser.DeviceSnapshotter(path, state, signals=())
+      snapshotter.step()
+      self.assertEqual(snapshotter.flush(), 2)
+      expected_a = state['a'].cpu()
+      state['a'].add_(1.0)
+      xm.mark_step()
+      snapshotter.step()
+      # The in-place update must not affect the pending snapshot.
+      state['a'].add_(1.0)
+      xm.mark_step()
+      self.assertEqual(snapshotter.flush(), 1)
+      loaded = xser.load(path)
+      self.assertEqual(loaded['a'], expected_a + 1.0)
+      self.assertEqual(loaded['b'], state['b'].cpu())
+      self.assertEqual(loaded['step'], 0)
+      self.assertEqual(snapshotter.flush(), 0)
+
   def test_deepcopy(self):
     xla_device = xm.xla_device()
     x = torch.rand(5, device=xla_device)
@@ -1745,6 +1974,32 @@ class TestAtenXlaTensor(XlaTestCase):
 
     self.runAtenTest([torch.arange(144, dtype=torch.int32)], test_fn)
 
+  def test_as_strided_patterns(self):
+    PATTERNS = (
+        ((3, 2), (4, 1), 1),  # Column slice.
+        ((4, 3), (10, 2), 0),  # Strided slice.
+        ((3, 4, 2), (0, 2, 1), 3),  # Broadcast.
+        ((9, 5), (2, 1), 0),  # Sliding windows.
+        ((3, 2), (5, 2), 0),  # Gather.
+    )
+    gathers = met.counter_value('AsStridedGather') or 0
+    for size, stride, offset in PATTERNS:
+
+      def test_fn(r):
+        return torch.as_strided(r, size, stride, offset)
+
+      self.runAtenTest([torch.arange(40, dtype=torch.int32)], test_fn)
+    self.assertEqual(met.counter_value('AsStridedGather'), gathers + 1)
+
+  def test_as_strided_strided_update(self):
+
+    def test_fn(r):
+      a = torch.as_strided(r, (4, 3), (10, 2))
+      a[1, 2] = -1
+      return r
+
+    self.runAtenTest([torch.arange(40, dtype=torch.int32)], test_fn)
+
   def test_basic_bfloat16(self):
 
     def test_fn(s):
@@ -1876,6 +2131,448 @@ class TestModelComparator(XlaTestCase):
     self.assertEqual(len(report), 0)
 
 
+class TestRandomOps(XlaTestCase):
+
+  def test_rng_streams(self):
+    xla_device = xm.xla_device()
+
+    def sample():
+      xm.set_rng_state(2022, device=xla_device)
+      a = torch.rand(64, device=xla_device)
+      b = torch.rand(64, device=xla_device)
+      mask = torch.nn.functional.dropout(
+          torch.ones(64, device=xla_device), p=0.5)
+      return a.cpu(), b.cpu(), mask.cpu()
+
+    a, b, mask = sample()
+    # Every random operation gets its own stream.
+    self.assertFalse(torch.equal(a, b))
+    # The streams only depend on the seed and the order of the operations.
+    for x, y in zip((a, b, mask), sample()):
+      self.assertEqual(x, y)
+
+
+class TestInPlaceUpdates(XlaTestCase):
+
+  def test_index_put_sync(self):
+    xla_device = xm.xla_device()
+    cache = torch.zeros(4, 8, device=xla_device)
+    xm.mark_step()
+    # The pending graph of other reads the buffer the update would be written
+    # into, so it cannot be donated.
+    other = cache + 1
+    cache.index_put_((torch.tensor([1], device=xla_device),),
+                     torch.ones(8, device=xla_device))
+    self.assertEqual(cache.cpu()[1], torch.ones(8))
+    self.assertEqual(other.cpu(), torch.ones(4, 8))
+    cache.index_put_((torch.tensor([2], device=xla_device),),
+                     torch.full((8,), 2.0, device=xla_device))
+    expected = torch.zeros(4, 8)
+    expected[1] = 1
+    expected[2] = 2
+    self.assertEqual(cache.cpu(), expected)
+    if xu.getenv_as('XLA_INPLACE_UPDATES', bool, defval=False):
+      self.assertIn('InPlaceUpdates', met.counter_names())
+
+
+@unittest.skipIf(not xu.getenv_as('XLA_USE_EAGER_MODE', bool, defval=False),
+                 'Requires XLA_USE_EAGER_MODE=1')
+class TestEagerMode(XlaTestCase):
+
+  def test_micro_graphs(self):
+    xla_device = xm.xla_device()
+    t = torch.rand(4, 8)
+    xt = t.to(xla_device)
+    micro_graphs = met.counter_value('EagerMicroGraphs') or 0
+    for i in range(64):
+      t = t * 0.5 + float(i)
+      xt = xt * 0.5 + float(i)
+    self.assertGreater(met.counter_value('EagerMicroGraphs'), micro_graphs)
+    self.assertEqual(xt.cpu(), t)
+
+
+@unittest.skipIf(
+    not xu.getenv_as('XLA_CPU_FALLBACK_DECOMPOSE', bool, defval=False),
+    'Requires XLA_CPU_FALLBACK_DECOMPOSE=1')
+class TestCpuFallbackDecompose(XlaTestCase):
+
+  def test_decompose_integer_mv(self):
+    # The XLA mv kernel falls back for integer inputs, and aten::mv has a
+    # composite kernel.
+    xla_device = xm.xla_device()
+    m = torch.randint(0, 10, (4, 3), dtype=torch.int32)
+    v = torch.randint(0, 10, (3,), dtype=torch.int32)
+    decomposed = met.counter_value('CpuFallbackDecomposed') or 0
+    xresult = torch.mv(m.to(xla_device), v.to(xla_device))
+    self.assertEqual(xresult.cpu(), torch.mv(m, v))
+    self.assertGreater(met.counter_value('CpuFallbackDecomposed'), decomposed)
+
+
+@unittest.skipIf(not xu.getenv_as('XLA_STEP_BREAKDOWN', bool, defval=False),
+                 'Requires XLA_STEP_BREAKDOWN=1')
+class TestStepBreakdown(XlaTestCase):
+
+  def test_step_breakdown(self):
+    xla_device = xm.xla_device()
+    xm.mark_step()
+    t = torch.ones(16, 32).to(xla_device)
+    (t * 2.0 + 1.0).sum().item()
+    xm.mark_step()
+    step = met.step_breakdown()[-1]
+    self.assertGreater(step['wall_ns'], 0)
+    for phase in ('dispatch', 'upload', 'collect_sync_tensors', 'hash',
+                  'download'):
+      self.assertGreater(step[phase + '_ns'], 0, phase)
+    phases = sum(
+        value for key, value in step.items()
+        if key.endswith('_ns') and key not in ('wall_ns', 'execute_ns'))
+    self.assertLessEqual(phases, step['wall_ns'])
+
+
+@unittest.skipIf(not xu.getenv_as('XLA_MEMORY_TRACKER', bool, defval=False),
+                 'Requires XLA_MEMORY_TRACKER=1')
+class TestMemoryTracker(XlaTestCase):
+
+  def test_snapshot_and_timeline(self):
+    xla_device = xm.xla_device()
+    t = torch.ones(64, 128, device=xla_device)
+    u = t * 2.0
+    xm.mark_step()
+    owners = {
+        torch_xla._XLAC._xla_get_tensor_id(t),
+        torch_xla._XLAC._xla_get_tensor_id(u)
+    }
+    buffers = [
+        buffer for buffer in xm.get_memory_snapshot(xla_device)
+        if buffer['owner'] in owners
+    ]
+    self.assertEqual(len(buffers), 2)
+    for buffer in buffers:
+      self.assertEqual(buffer['bytes'], 64 * 128 * 4)
+      self.assertTrue(buffer['graph'])
+    with tempfile.NamedTemporaryFile(suffix='.json') as tf:
+      xm.save_memory_timeline(tf.name)
+      with open(tf.name) as fd:
+        timeline = json.load(fd)
+    self.assertTrue(timeline['traceEvents'])
+    del t, u
+    self.assertFalse([
+        buffer for buffer in xm.get_memory_snapshot(xla_device)
+        if buffer['owner'] in owners
+    ])
+
+
+@unittest.skipIf(
+    os.environ.get('XLA_FNTRACKER_MODE') != 'binary',
+    'Requires XLA_FNTRACKER_MODE=binary and XLA_FNTRACKER_FILE')
+class TestFunctionCallTracker(XlaTestCase):
+
+  def test_dump_function_calls(self):
+    xla_device = xm.xla_device()
+    t = torch.ones(4, 4, device=xla_device)
+    t = torch.mm(t, t) + 1.0
+    xm.mark_step()
+    with tempfile.NamedTemporaryFile(suffix='.bin') as tf:
+      self.assertTrue(met.dump_function_calls(tf.name))
+      with open(tf.name, 'rb') as fd:
+        data = fd.read()
+    self.assertTrue(data.startswith(b'XLAFNTR1'))
+    self.assertIn(b'mm', data)
+
+
+class TestAutocastPolicy(XlaTestCase):
+
+  def test_matmul(self):
+    xla_device = xm.xla_device()
+    a = torch.randn(64, 128)
+    b = torch.randn(128, 32)
+    xla_product = torch.mm(a.to(xla_device), b.to(xla_device))
+    # The tensor types do not change, only the lowering does.
+    self.assertEqual(xla_product.dtype, torch.float32)
+    autocast = xu.getenv_as('XLA_AUTOCAST', bool, defval=False)
+    self.assertEqual(
+        xla_product.cpu(), torch.mm(a, b), prec=0.5 if autocast else 1e-3)
+    if autocast:
+      self.assertIn('AutocastNodes', met.counter_names())
+
+
+class TestAppendBuffer(XlaTestCase):
+
+  def test_append(self):
+    xla_device = xm.xla_device()
+    expected = torch.randn(2, 3)
+    buffer = xf.AppendBuffer(expected.to(xla_device), dim=1, capacity=8)
+    compiles = []
+    for _ in range(4):
+      step = torch.randn(2, 1)
+      expected = torch.cat([expected, step], dim=1)
+      buffer.append(step.to(xla_device))
+      xm.mark_step()
+      compiles.append(met.metric_data('CompileTime')[0])
+    self.assertEqual(len(buffer), 7)
+    self.assertEqual(buffer.capacity, 8)
+    # The appends at growing offsets all run the same graph.
+    self.assertEqual(compiles[1], compiles[-1])
+    self.assertEqual(buffer.tensor().cpu(), expected)
+    self.assertEqual(buffer.mask().cpu(), torch.arange(8) < 7)
+    buffer.append(torch.ones(2, 2, device=xla_device))
+    self.assertEqual(buffer.capacity, 16)
+    self.assertEqual(buffer.tensor().cpu(),
+                     torch.cat([expected, torch.ones(2, 2)], dim=1))
+
+
+class TestCheckpointSequential(XlaTestCase):
+
+  def test_memory_budget(self):
+    xla_device = xm.xla_device()
+    torch.manual_seed(42)
+    layers = [
+        nn.Sequential(nn.Linear(16, 64), nn.ReLU(), nn.Linear(64, 16))
+        for _ in range(4)
+    ]
+    cpu_input = torch.randn(8, 16, requires_grad=True)
+    cpu_output = nn.Sequential(*layers)(cpu_input)
+    cpu_output.sum().backward()
+
+    xla_layers = [copy.deepcopy(layer).to(xla_device) for layer in layers]
+    xla_input = cpu_input.detach().to(xla_device).requires_grad_()
+    activation_bytes = checkpoint.estimate_activation_bytes(
+        xla_layers[0], xla_input)
+    # At least the [8, 64] hidden activations, on top of the [8, 16] output.
+    self.assertGreaterEqual(activation_bytes, (8 * 64 + 8 * 16) * 4)
+    xla_output = checkpoint.checkpoint_sequential(
+        xla_layers, xla_input, memory_budget=2 * activation_bytes)
+    xla_output.sum().backward()
+    self.assertEqual(xla_output, cpu_output)
+    self.assertEqual(xla_input.grad, cpu_input.grad)
+    self.assertEqual(xla_layers[0][0].weight.grad, layers[0][0].weight.grad)
+
+  def test_estimate_once(self):
+    xla_device = xm.xla_device()
+    layers = [nn.Linear(16, 16), nn.BatchNorm1d(16), nn.Linear(16, 16)]
+    xla_layers = [copy.deepcopy(layer).to(xla_device) for layer in layers]
+    for _ in range(2):
+      cpu_input = torch.randn(8, 16)
+      nn.Sequential(*layers)(cpu_input)
+      checkpoint.checkpoint_sequential(
+          xla_layers, cpu_input.to(xla_device), memory_budget=0)
+    # The estimation neither updates the running stats, nor runs again on the
+    # second call with the same input shape.
+    self.assertEqual(xla_layers[1].running_mean, layers[1].running_mean)
+    self.assertEqual(xla_layers[1].num_batches_tracked,
+                     layers[1].num_batches_tracked)
+    keys = [
+        key for key in checkpoint._checkpoint_selections
+        if key[0] == tuple(id(layer) for layer in xla_layers)
+    ]
+    self.assertEqual(len(keys), 1)
+
+  def test_select_checkpoints(self):
+    costs = [(100, 10), (400, 10), (50, 60), (200, 10)]
+    self.assertEqual(
+        checkpoint._select_checkpoints(costs, 1000), [False] * 4)
+    self.assertEqual(
+        checkpoint._select_checkpoints(costs, 400),
+        [False, True, False, False])
+    self.assertEqual(
+        checkpoint._select_checkpoints(costs, 0),
+        [True, True, False, True])
+
+
+class TestAllReduceBuckets(XlaTestCase):
+
+  def test_bucket_tensors(self):
+    tensors = [torch.zeros(n, dtype=torch.float32) for n in (4, 2, 8, 1, 1)]
+    self.assertEqual(len(xm._bucket_tensors(tensors, 0)), 1)
+    buckets = xm._bucket_tensors(tensors, 32)
+    # In the reverse order, with no bucket over 32 bytes.
+    self.assertEqual([[t.numel() for t in bucket] for bucket in buckets],
+                     [[1, 1], [8], [2, 4]])
+
+  def test_hierarchical_groups(self):
+    host_groups, cross_groups = xm._hierarchical_groups(8, 4)
+    self.assertEqual(host_groups, [[0, 1, 2, 3], [4, 5, 6, 7]])
+    self.assertEqual(cross_groups, [[0, 4], [1, 5], [2, 6], [3, 7]])
+
+
+class TestMoeDispatch(XlaTestCase):
+
+  def test_dispatch_combine(self):
+    device = xm.xla_device()
+    tokens = torch.randn(8, 4, device=device)
+    logits = torch.randn(8, 3, device=device)
+    routed = xf.moe_dispatch(tokens, logits, k=2, capacity=8)
+    self.assertEqual(routed.dispatched.shape, (3, 8, 4))
+    self.assertEqual(routed.counts.sum().item(), 16)
+    # With enough capacity and identity experts, every token gets back the sum
+    # of its top-2 gates.
+    output = xf.moe_combine(routed.dispatched, routed.slots, routed.weights)
+    gates = torch.softmax(logits, dim=-1).topk(2, dim=-1)[0].sum(-1)
+    self.assertEqual(output, tokens * gates.unsqueeze(-1), prec=1e-5)
+
+  def test_capacity_drop(self):
+    device = xm.xla_device()
+    tokens = torch.randn(6, 4, device=device)
+    logits = torch.zeros(6, 2, device=device)
+    logits[:, 0] = 10.0
+    routed = xf.moe_dispatch(
+        tokens, logits, k=1, capacity=2, record_load=False)
+    weights = routed.weights.cpu()
+    # Only the first two tokens fit in the capacity of expert 0.
+    self.assertGreater(weights[:2].min().item(), 0.0)
+    self.assertEqual(weights[2:].abs().sum().item(), 0.0)
+    self.assertEqual(routed.dispatched[0].cpu(), tokens[:2].cpu())
+
+
+class TestPipeline(XlaTestCase):
+
+  def test_circular_schedule(self):
+    num_steps, injections, chunks, finishes = pipeline._circular_schedule(
+        4, 2, 2)
+    self.assertEqual(num_steps, 9)
+    self.assertEqual(injections, {0: 0, 1: 1, 4: 2, 5: 3})
+    self.assertEqual(finishes, {3: 0, 4: 1, 7: 2, 8: 3})
+    self.assertEqual(chunks[2], [1, 0])
+    self.assertEqual(
+        pipeline._stage_pairs(4, 2, False), [[0, 1], [2, 3]])
+
+  def test_single_stage(self):
+    device = xm.xla_device()
+    weight = torch.randn(4, 4, device=device, requires_grad=True)
+    microbatches = [torch.randn(2, 4, device=device) for _ in range(3)]
+    pipe = pipeline.Pipeline(num_stages=1, device=device)
+    outputs = pipe.forward(lambda x: torch.tanh(x @ weight), microbatches)
+    for output, x in zip(outputs, microbatches):
+      self.assertEqual(output, torch.tanh(x @ weight))
+    self.assertEqual(pipe.last_stage_mask.item(), 1.0)
+
+
+class TestCompressedAllReduce(XlaTestCase):
+
+  def test_small_matrix_linalg(self):
+    xla_device = xm.xla_device()
+    a = torch.randn(64, 6, 6)
+    spd = a @ a.transpose(-1, -2) + torch.eye(6)
+    b = torch.randn(64, 6, 3)
+    xla_spd = spd.to(xla_device)
+    xla_l = torch.linalg.cholesky(xla_spd)
+    self.assertEqual(torch.linalg.cholesky(spd), xla_l.cpu(), prec=1e-3)
+    x, _ = torch.triangular_solve(b.to(xla_device), xla_l, upper=False)
+    self.assertEqual(xla_l.cpu() @ x.cpu(), b, prec=1e-3)
+    w = torch.randn(64, 7, 5)
+    q, r = torch.linalg.qr(w.to(xla_device))
+    self.assertEqual(q.cpu() @ r.cpu(), w, prec=1e-3)
+    self.assertEqual(
+        q.cpu().transpose(-1, -2) @ q.cpu(),
+        torch.eye(5).expand(64, 5, 5),
+        prec=1e-3)
+    u, s, v = torch.svd(w.to(xla_device))
+    self.assertEqual(torch.svd(w)[1], s.cpu(), prec=1e-3)
+    self.assertEqual(
+        u.cpu() @ torch.diag_embed(s.cpu()) @ v.cpu().transpose(-1, -2),
+        w,
+        prec=1e-3)
+    self.assertIn('SmallMatrixLowering', met.counter_names())
+
+  def test_grad_scaler_skips_on_device(self):
+    from torch_xla.amp import GradScaler
+    xla_device = xm.xla_device()
+    model = nn.Linear(4, 2).to(xla_device)
+    optimizer = optim.SGD(model.parameters(), lr=0.1, momentum=0.9)
+    scaler = GradScaler()
+
+    def train_step(x):
+      optimizer.zero_grad()
+      scaler.scale(model(x).sum()).backward()
+      scaler.step(optimizer)
+      scaler.update()
+
+    train_step(torch.ones(3, 4, device=xla_device))
+    xm.mark_step()
+    weight = model.weight.cpu()
+    buf = optimizer.state[model.weight]['momentum_buffer'].cpu()
+    steps = met.counter_value('MarkStep')
+    train_step(torch.full((3, 4), float('inf'), device=xla_device))
+    # The skipped step waits for nothing on the host.
+    self.assertEqual(met.counter_value('MarkStep'), steps)
+    self.assertEqual(model.weight.cpu(), weight)
+    self.assertEqual(
+        optimizer.state[model.weight]['momentum_buffer'].cpu(), buf)
+
+  def test_accumulate_gradients(self):
+    xla_device = xm.xla_device()
+    model = nn.Linear(5, 3).to(xla_device)
+    optimizer = optim.SGD(model.parameters(), lr=0.1)
+    inputs = [torch.randn(4, 5) for _ in range(3)]
+    for x in inputs:
+      model(x.to(xla_device)).sum().backward()
+      xm.accumulate_gradients(optimizer)
+    updates = met.counter_value('InPlaceUpdates') or 0
+    model(inputs[0].to(xla_device)).sum().backward()
+    xm.accumulate_gradients(optimizer)
+    self.assertGreater(met.counter_value('InPlaceUpdates'), updates)
+    expected = sum(inputs + [inputs[0]]).sum(0).expand(3, 5)
+    self.assertEqual(model.weight.grad.cpu(), expected, prec=1e-4)
+
+  def test_packed_dropout(self):
+    xla_device = xm.xla_device()
+    x = (torch.rand(7, 33) + 1).to(xla_device).requires_grad_()
+    y = F.dropout(x, p=0.25, training=True)
+    y.sum().backward()
+    scale = y.cpu() / x.cpu().detach()
+    kept = scale != 0
+    self.assertTrue(kept.any() and not kept.all())
+    self.assertEqual(scale[kept], torch.full_like(scale[kept], 1 / 0.75),
+                     prec=1e-5)
+    # The backward pass zeroes the same elements the forward one did.
+    self.assertEqual(x.grad.cpu(), scale, prec=1e-5)
+    self.assertIn('PackedDropout', met.counter_names())
+
+  def test_compressed_all_reduce(self):
+    device = xm.xla_device()
+    a = torch.randn(5, 3, device=device)
+    b = torch.randn(7, device=device)
+    expected = [a.cpu(), b.cpu()]
+    xm.all_reduce_compressed([a, b], wire_type='bf16', key='test')
+    xm.mark_step()
+    self.assertEqual(a.cpu(), expected[0], prec=1e-2)
+    self.assertEqual(b.cpu(), expected[1], prec=1e-2)
+    self.assertIn('CompressedAllReduce', met.counter_names())
+    # The residual of the first reduction is fed back into the second one.
+    devctx = xm._get_device_context()
+    residual = devctx.compression_residuals['test'].cpu()
+    self.assertEqual(residual.numel(), 22)
+    self.assertLess(residual.abs().max().item(), 1e-2)
+
+
+class TestDeviceSummary(XlaTestCase):
+
+  def test_summaries(self):
+    xla_device = xm.xla_device()
+    fetched = []
+    writer = xsum.SummaryWriter(
+        fetch_steps=2, callback=lambda step, values: fetched.append(values))
+    loss = writer.scalar('loss', ema_decay=0.5)
+    hist = writer.histogram('values', bins=4, min_value=0.0, max_value=4.0)
+    values = [torch.tensor([0.5, 1.5]), torch.tensor([3.5, 9.0, float('nan')])]
+    for value in values:
+      loss.update(value[:2].to(xla_device))
+      hist.update(value.to(xla_device))
+      xm.mark_step()
+      writer.step()
+    writer.flush()
+    self.assertEqual(len(fetched), 1)
+    scalars = fetched[0]['loss']
+    self.assertEqual(scalars['count'], 4)
+    self.assertEqual(scalars['mean'], 3.625, prec=1e-5)
+    self.assertEqual(scalars['min'], 0.5)
+    self.assertEqual(scalars['max'], 9.0)
+    self.assertEqual(scalars['last'], 6.25, prec=1e-5)
+    self.assertEqual(scalars['ema'], 3.625, prec=1e-5)
+    self.assertEqual([count for _, _, count in fetched[0]['values']],
+                     [1, 1, 0, 2])
+
+
 class TestAsyncScalar(XlaTestCase):
 
   def test_rng_seed_transfer(self):
@@ -2037,6 +2734,25 @@ class TestOpBuilder(XlaTestCase):
             'transpose_a': False
         })
 
+  def test_cached_computations(self):
+
+    def op_fn(a, b, k0=None):
+      return a * b + a.scalar_like(k0)
+
+    def aten_fn(a, b, k0=None):
+      return a * b + k0
+
+    op = xor.register('test_cached_computations', op_fn)
+    device = xm.xla_device()
+    # The repeated shapes and kwargs run the registered computations, the
+    # other ones build new ones.
+    for shape, k0 in [([2, 2], 1.0), ([2, 2], 1.0), ([3, 2], 1.0),
+                      ([2, 2], 2.0)]:
+      a = torch.randn(*shape)
+      b = torch.randn(*shape)
+      result = op(a.to(device), b.to(device), k0=k0)
+      self.compareResults([aten_fn(a, b, k0=k0)], [result])
+
 
 class MpDecoratorTest(XlaTestCase):
 
@@ -2048,6 +2764,67 @@ class MpDecoratorTest(XlaTestCase):
 
 class TestGeneric(XlaTestCase):
 
+  def test_get_cpu_tensors_async(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 4, device=xla_device)
+    y = x * 2 + 1
+    fetch = torch_xla._XLAC._xla_get_cpu_tensors_async([y, x])
+    cpu_y, cpu_x = fetch.wait()
+    self.assertTrue(fetch.done())
+    self.assertEqual(cpu_x.device, torch.device('cpu'))
+    self.assertEqual(cpu_y, cpu_x * 2 + 1)
+
+  def test_offload_tensors(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 4, device=xla_device)
+    y = x * 2 + 1
+    expected = y.cpu()
+    offloaded = met.counter_value('OffloadedTensors') or 0
+    xm.offload_to_host([x, y])
+    self.assertEqual(met.counter_value('OffloadedTensors'), offloaded + 2)
+    xm.prefetch_to_device([x, y])
+    self.assertGreater(met.counter_value('PrefetchedTensors'), 0)
+    self.assertEqual((y - x).cpu(), expected - x.cpu())
+    # Offloading an unchanged tensor again needs no transfer.
+    xm.offload_to_host([y])
+    self.assertEqual(y.cpu(), expected)
+
+  def test_offload_view_tensors(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 4, device=xla_device)
+    v = x.view(-1)
+    xm.offload_to_host([v])
+    # The offloaded view still aliases its base.
+    x.add_(1)
+    self.assertEqual(v.cpu(), x.cpu().view(-1))
+
+  def test_copy_to_cpu_tensors(self):
+    xla_device = xm.xla_device()
+    x = torch.randn(4, 3, device=xla_device)
+    y = x * 2 + 1
+    cpu_y = torch.empty(4, 3)
+    cpu_x = torch.empty(3, 4, dtype=torch.float64).t()
+    torch_xla._XLAC._xla_copy_to_cpu_tensors([y, x], [cpu_y, cpu_x])
+    self.assertEqual(cpu_x.dtype, torch.float64)
+    self.assertEqual(cpu_y, cpu_x.float() * 2 + 1)
+    with self.assertRaises(RuntimeError):
+      torch_xla._XLAC._xla_copy_to_cpu_tensors([x], [torch.empty(3)])
+
+  def test_input_prefetcher(self):
+    xla_device = xm.xla_device()
+    prefetcher = torch_xla._XLAC._xla_create_input_prefetcher(
+        str(xla_device), 2)
+    batches = [[torch.randn(2, 3), torch.arange(4)] for _ in range(2)]
+    for batch in batches:
+      prefetcher.put(batch)
+    prefetcher.close()
+    for batch in batches:
+      xbatch = prefetcher.get()
+      self.assertEqual(xbatch[0].device, xla_device)
+      self.assertEqual(xbatch[0].cpu(), batch[0])
+      self.assertEqual(xbatch[1].cpu(), batch[1])
+    self.assertIsNone(prefetcher.get())
+
   def test_zeros_like_patch(self):
     a = torch.ones(3, 3)
     b = torch.zeros_like(a, dtype=torch.int8)
@@ -2060,6 +2837,16 @@ class TestGeneric(XlaTestCase):
     self.assertTrue(revs['xla'])
     self.assertTrue('torch' in revs)
 
+  def test_packed_upload(self):
+    xla_device = xm.xla_device()
+    tensors = [torch.randn(3, 2) for _ in range(20)]
+    tensors += [torch.tensor(i) for i in range(10)]
+    tensors += [torch.tensor([True, False, True])]
+    xtensors = xm.send_cpu_data_to_device(tensors, xla_device)
+    for tensor, xtensor in zip(tensors, xtensors):
+      self.assertEqual(xtensor.dtype, tensor.dtype)
+      self.assertEqual(xtensor.cpu(), tensor)
+
   def test_send_to_device_grad(self):
     xla_device = xm.xla_device()
     t = _gen_tensor(2, 2, requires_grad=True)
@@ -2092,6 +2879,453 @@ class TestGeneric(XlaTestCase):
                      torch.tensor([2, 0, 3, 1], dtype=torch.int32))
     self.assertEqual(num_valid.item(), 3)
 
+  def test_nms_tiled(self):
+
+    def nms_reference(boxes, scores, idxs, score_threshold, iou_threshold,
+                      output_size):
+      mins = torch.min(boxes[:, :2], boxes[:, 2:])
+      maxs = torch.max(boxes[:, :2], boxes[:, 2:])
+      sizes = (torch.min(maxs[:, None], maxs[None]) -
+               torch.max(mins[:, None], mins[None])).clamp(min=0)
+      i_area = sizes[..., 0] * sizes[..., 1]
+      area = (maxs - mins).prod(dim=1)
+      iou = i_area / (area[:, None] + area[None] - i_area)
+      selected = []
+      for i in torch.argsort(scores, descending=True).tolist():
+        if len(selected) == output_size:
+          break
+        if scores[i] <= score_threshold:
+          continue
+        if all(idxs[i] != idxs[j] or iou[i, j] <= iou_threshold
+               for j in selected):
+          selected.append(i)
+      return selected
+
+    xla_device = xm.xla_device()
+    # More boxes than a tile, so that boxes get suppressed across tiles.
+    num_boxes = 700
+    corners = torch.rand(num_boxes, 2) * 100
+    boxes = torch.cat([corners, corners + torch.rand(num_boxes, 2) * 20], dim=1)
+    scores = torch.rand(num_boxes)
+    idxs = torch.randint(0, 3, (num_boxes,))
+    score_threshold = torch.tensor(0.1)
+    iou_threshold = torch.tensor(0.3)
+    for batched in (False, True):
+      groups = idxs if batched else torch.zeros_like(idxs)
+      expected = nms_reference(boxes, scores, groups, 0.1, 0.3, 200)
+      args = [boxes.to(xla_device), scores.to(xla_device)]
+      if batched:
+        args.append(idxs.to(xla_device))
+      args += [score_threshold.to(xla_device), iou_threshold.to(xla_device)]
+      nms_fn = xf.batched_nms if batched else xf.nms
+      selected_indices, num_valid = nms_fn(*args, 200)
+      self.assertEqual(num_valid.item(), len(expected))
+      self.assertEqual(selected_indices.cpu()[:len(expected)].tolist(),
+                       expected)
+
+  def test_crop_and_resize(self):
+    xla_device = xm.xla_device()
+    images = torch.randint(0, 256, (3, 3, 9, 9), dtype=torch.uint8)
+    boxes = torch.tensor([[0, 0, 1, 1], [0, 1, 1, 0], [0, 0, 0.5, 0.5]])
+    crops = xf.crop_and_resize(
+        images.to(xla_device), boxes.to(xla_device), (5, 5)).cpu()
+    fimages = images.float()
+    expected = torch.nn.functional.interpolate(
+        fimages, size=(5, 5), mode='bilinear', align_corners=True)
+    self.assertEqual(crops[0], expected[0], prec=1e-3)
+    self.assertEqual(crops[1], expected[1].flip(-1), prec=1e-3)
+    self.assertEqual(crops[2], fimages[2, :, :5, :5], prec=1e-3)
+
+  def test_random_resized_crop(self):
+    xla_device = xm.xla_device()
+    images = torch.randint(0, 256, (4, 3, 32, 24), dtype=torch.uint8)
+    crops = xf.random_resized_crop(images.to(xla_device), (16, 16))
+    crops = xf.color_jitter(
+        crops / 255.0, brightness=0.4, contrast=0.4, saturation=0.4)
+    crops = xf.normalize(crops, [0.485, 0.456, 0.406], [0.229, 0.224, 0.225])
+    self.assertEqual(list(crops.shape), [4, 3, 16, 16])
+    self.assertTrue(torch.isfinite(crops.cpu()).all())
+
+  def test_scaled_dot_product_attention(self):
+
+    def attention(query, key, value, mask, is_causal):
+      scores = query @ key.transpose(-2, -1) / math.sqrt(query.size(-1))
+      if is_causal:
+        causal = torch.ones(
+            scores.shape[-2:], dtype=torch.bool, device=scores.device).tril()
+        scores = scores.masked_fill(~causal, float('-inf'))
+      if mask is not None:
+        scores = scores.masked_fill(~mask, float('-inf'))
+      return torch.softmax(scores, dim=-1) @ value
+
+    xla_device = xm.xla_device()
+    # Longer than a key block, so that the keys get tiled and padded.
+    query = torch.randn(2, 3, 5, 8)
+    key = torch.randn(2, 3, 600, 8)
+    value = torch.randn(2, 3, 600, 4)
+    mask = torch.rand(2, 1, 5, 600) > 0.2
+    for is_causal, attn_mask in ((False, None), (True, None), (False, mask)):
+      inputs = [t.clone().requires_grad_() for t in (query, key, value)]
+      xla_inputs = [
+          t.detach().to(xla_device).requires_grad_()
+          for t in (query, key, value)
+      ]
+      output = attention(*inputs, attn_mask, is_causal)
+      xla_output = xf.scaled_dot_product_attention(
+          *xla_inputs,
+          attn_mask=attn_mask.to(xla_device) if attn_mask is not None else None,
+          is_causal=is_causal)
+      output.sum().backward()
+      xla_output.sum().backward()
+      self.assertEqual(output, xla_output.cpu(), prec=1e-4)
+      for t, xla_t in zip(inputs, xla_inputs):
+        self.assertEqual(t.grad, xla_t.grad.cpu(), prec=1e-4)
+
+  def test_layer_norm(self):
+    xla_device = xm.xla_device()
+    # A large mean, which the single pass variance must stay accurate for.
+    input = torch.randn(4, 6, 10) * 3 + 100
+    for affine in (True, False):
+      layer_norm = torch.nn.LayerNorm([6, 10], elementwise_affine=affine)
+      if affine:
+        with torch.no_grad():
+          layer_norm.weight.uniform_(0.5, 1.5)
+          layer_norm.bias.uniform_(-1, 1)
+      xla_layer_norm = copy.deepcopy(layer_norm).to(xla_device)
+      x = input.clone().requires_grad_()
+      xla_x = input.to(xla_device).requires_grad_()
+      output = layer_norm(x)
+      xla_output = xla_layer_norm(xla_x)
+      grad = torch.randn_like(output)
+      output.backward(grad)
+      xla_output.backward(grad.to(xla_device))
+      self.assertEqual(output, xla_output.cpu(), prec=1e-4)
+      self.assertEqual(x.grad, xla_x.grad.cpu(), prec=1e-4)
+      for p, xla_p in zip(layer_norm.parameters(),
+                          xla_layer_norm.parameters()):
+        self.assertEqual(p.grad, xla_p.grad.cpu(), prec=1e-4)
+
+  def test_rms_norm(self):
+
+    def rms_norm(input, weight, eps):
+      return input * torch.rsqrt(input.pow(2).mean(-1, keepdim=True) +
+                                 eps) * weight
+
+    xla_device = xm.xla_device()
+    input = torch.randn(3, 5, 16, requires_grad=True)
+    weight = torch.rand(16, requires_grad=True)
+    xla_input = input.detach().to(xla_device).requires_grad_()
+    xla_weight = weight.detach().to(xla_device).requires_grad_()
+    output = rms_norm(input, weight, 1e-6)
+    xla_output = xf.rms_norm(xla_input, 16, weight=xla_weight, eps=1e-6)
+    output.sum().backward()
+    xla_output.sum().backward()
+    self.assertEqual(output, xla_output.cpu(), prec=1e-4)
+    self.assertEqual(input.grad, xla_input.grad.cpu(), prec=1e-4)
+    self.assertEqual(weight.grad, xla_weight.grad.cpu(), prec=1e-4)
+
+  def test_sync_batch_norm(self):
+    xla_device = xm.xla_device()
+    input = torch.randn(4, 3, 5, 6, requires_grad=True)
+    weight = torch.rand(3, requires_grad=True)
+    bias = torch.rand(3, requires_grad=True)
+    xla_input = input.detach().to(xla_device).requires_grad_()
+    xla_weight = weight.detach().to(xla_device).requires_grad_()
+    xla_bias = bias.detach().to(xla_device).requires_grad_()
+    output = torch.nn.functional.batch_norm(
+        input, None, None, weight=weight, bias=bias, training=True, eps=1e-5)
+    xla_output, xla_mean, xla_var = xf.sync_batch_norm(
+        xla_input, xla_weight, xla_bias, eps=1e-5)
+    output.sum().backward()
+    xla_output.sum().backward()
+    self.assertEqual(output, xla_output.cpu(), prec=1e-4)
+    self.assertEqual(input.mean((0, 2, 3)), xla_mean.cpu(), prec=1e-4)
+    self.assertEqual(
+        input.var((0, 2, 3), unbiased=False), xla_var.cpu(), prec=1e-4)
+    self.assertEqual(input.grad, xla_input.grad.cpu(), prec=1e-4)
+    self.assertEqual(weight.grad, xla_weight.grad.cpu(), prec=1e-4)
+    self.assertEqual(bias.grad, xla_bias.grad.cpu(), prec=1e-4)
+    self.assertIn('SyncBatchNorm', met.counter_names())
+
+  def test_cross_entropy(self):
+    xla_device = xm.xla_device()
+    input = torch.randn(6, 50) * 4
+    target = torch.randint(0, 50, (6,))
+    target[2] = -100
+    weight = torch.rand(50) + 0.5
+    for reduction, label_smoothing, w in itertools.product(
+        ('none', 'mean', 'sum'), (0.0, 0.1), (None, weight)):
+      x = input.clone().requires_grad_()
+      xla_x = input.to(xla_device).requires_grad_()
+      xla_w = w.to(xla_device) if w is not None else None
+      loss = F.cross_entropy(
+          x,
+          target,
+          weight=w,
+          reduction=reduction,
+          label_smoothing=label_smoothing)
+      xla_loss = F.cross_entropy(
+          xla_x,
+          target.to(xla_device),
+          weight=xla_w,
+          reduction=reduction,
+          label_smoothing=label_smoothing)
+      grad = torch.randn_like(loss)
+      loss.backward(grad)
+      xla_loss.backward(grad.to(xla_device))
+      self.assertEqual(loss, xla_loss.cpu(), prec=1e-4)
+      self.assertEqual(x.grad, xla_x.grad.cpu(), prec=1e-4)
+    self.assertIn('xla::cross_entropy_loss', met.counter_names())
+
+  def test_quantized_linear(self):
+    xla_device = xm.xla_device()
+    input = torch.randint(-128, 128, (4, 3, 32), dtype=torch.int8)
+    weight = torch.randint(-127, 128, (16, 32), dtype=torch.int8)
+    weight_scales = torch.rand(16) * 0.01 + 0.001
+    bias = torch.randn(16)
+    input_scale, input_zero_point = 0.05, 3
+    expected = torch.nn.functional.linear(
+        (input.float() - input_zero_point) * input_scale,
+        weight.float() * weight_scales.unsqueeze(1), bias)
+    xla_args = [t.to(xla_device) for t in (input, weight, weight_scales, bias)]
+    output = xf.quantized_linear(
+        *xla_args, input_scale=input_scale, input_zero_point=input_zero_point)
+    self.assertEqual(output.cpu(), expected, prec=1e-4)
+    # Requantized, the values may only differ by the rounding of the floats.
+    output = xf.quantized_linear(
+        *xla_args,
+        input_scale=input_scale,
+        input_zero_point=input_zero_point,
+        output_scale=0.1,
+        output_zero_point=-5)
+    self.assertEqual(output.dtype, torch.int8)
+    requantized = torch.clamp(torch.round(expected / 0.1) - 5, -128, 127)
+    self.assertLessEqual(
+        (output.cpu().float() - requantized).abs().max().item(), 1)
+
+  def test_quantized_conv(self):
+    xla_device = xm.xla_device()
+    input = torch.randint(-128, 128, (2, 8, 9, 9), dtype=torch.int8)
+    weight = torch.randint(-127, 128, (12, 4, 3, 3), dtype=torch.int8)
+    weight_scales = torch.rand(12) * 0.01 + 0.001
+    input_scale, input_zero_point = 0.02, -7
+    for stride, padding, groups in ((1, 1, 2), (2, 0, 1)):
+      conv_weight = weight if groups == 2 else weight.repeat(1, 2, 1, 1)
+      expected = torch.nn.functional.conv2d(
+          (input.float() - input_zero_point) * input_scale,
+          conv_weight.float() * weight_scales.view(-1, 1, 1, 1),
+          stride=stride,
+          padding=padding,
+          groups=groups)
+      output = xf.quantized_conv(
+          input.to(xla_device),
+          conv_weight.to(xla_device),
+          weight_scales.to(xla_device),
+          stride=stride,
+          padding=padding,
+          groups=groups,
+          input_scale=input_scale,
+          input_zero_point=input_zero_point)
+      self.assertEqual(output.cpu(), expected, prec=1e-4)
+
+  def test_cpu_fallback_stats(self):
+    xla_device = xm.xla_device()
+    t = torch.tensor(2.5, device=xla_device)
+    key = 'aten::_local_scalar_dense(Float[])'
+    fallbacks = met.cpu_fallback_stats().get(key, 0)
+    self.assertEqual(t.item(), 2.5)
+    self.assertEqual(met.cpu_fallback_stats()[key], fallbacks + 1)
+
+  def test_metrics_gate(self):
+    xla_device = xm.xla_device()
+    t = torch.ones(8, 8, device=xla_device)
+    for _ in range(2):
+      before = met.snapshot()
+      t = t * 3.0 - 1.0
+      xm.mark_step()
+    delta = met.diff(before)
+    self.assertEqual(delta['compiles'], 0)
+    self.assertEqual(delta['executions'], 1)
+    self.assertEqual(met.check_gates(before, compiles=0), [])
+    with met.MetricsGate(compiles=0) as gate:
+      t = t * 3.0 - 1.0
+      xm.mark_step()
+    self.assertEqual(gate.delta['executions'], 1)
+    with self.assertRaises(met.MetricsRegressionError):
+      with met.MetricsGate(compiles=0, cpu_fallbacks=0):
+        t.sum().item()
+
+  def test_graph_profile(self):
+    xla_device = xm.xla_device()
+    met.clear_graph_profile()
+    t = torch.ones(16, 32, device=xla_device)
+    for _ in range(3):
+      t = t * 2.0 + 1.0
+      xm.mark_step()
+    graphs = met.graph_profile()
+    self.assertEqual(sum(graph['executions'] for graph in graphs), 3)
+    graph = max(graphs, key=lambda graph: graph['executions'])
+    self.assertEqual(graph['output_bytes'], 16 * 32 * 4)
+    self.assertGreater(graph['execute_time_ns'], 0)
+    self.assertIn('Graph: ' + graph['hash'], met.graph_report())
+
+  def test_performance_analysis(self):
+    xla_device = xm.xla_device()
+    t = torch.ones(16, 32, device=xla_device)
+    for _ in range(12):
+      t = t * 2.0 + 1.0
+      t.sum().item()
+      xm.mark_step()
+    self.assertIn('StepTracingTime', met.metric_names())
+    self.assertIn('StepSyncTime', met.metric_names())
+    self.assertIn('GraphExecuteTime', met.metric_names())
+    for analysis in met.performance_analysis():
+      self.assertNotEqual(analysis['symptom'], 'normal')
+      self.assertTrue(analysis['message'].startswith('pt-xla-profiler: '))
+      if analysis['symptom'] == 'transfer_stall':
+        self.assertTrue(analysis['remediation'])
+        self.assertGreater(analysis['values']['transfers'], 0)
+
+  def test_fetch_with_pending_graph(self):
+    xla_device = xm.xla_device()
+    a = torch.arange(8, dtype=torch.float32).to(xla_device)
+    b = torch.ones(64, 64, device=xla_device)
+    xm.mark_step()
+    for _ in range(8):
+      b = b @ b / 64.0
+    xm.mark_step()
+    self.assertEqual(a.cpu(), torch.arange(8, dtype=torch.float32))
+    self.assertEqual(b.cpu(), torch.ones(64, 64))
+
+  def test_recompile_reports(self):
+    xla_device = xm.xla_device()
+    for size in (7, 9):
+      t = torch.ones(size, 3, device=xla_device)
+      (t.sum(dim=0) * 3.0).cpu()
+    reports = met.recompile_reports()
+    self.assertTrue(reports)
+    self.assertIn('The shape changed from', reports[-1])
+
+  def test_cumulative_scan(self):
+    xla_device = xm.xla_device()
+    for size in (5000, 5001):
+      input = torch.randint(-100, 100, (3, size))
+      self.assertEqual(
+          torch.cumsum(input, 1),
+          torch.cumsum(input.to(xla_device), 1).cpu())
+      input = torch.rand(size, 2) * 0.002 + 0.999
+      self.assertEqual(
+          torch.cumprod(input, 0),
+          torch.cumprod(input.to(xla_device), 0).cpu(),
+          prec=1e-4)
+    self.assertIn('CumulativeScan', met.counter_names())
+
+  def test_topk_large_dim(self):
+    xla_device = xm.xla_device()
+    # Distinct values, so that the indices do not depend on the tie breaking.
+    input = torch.stack([torch.randperm(50000).float() for _ in range(2)])
+    xla_input = input.to(xla_device)
+    for largest in (True, False):
+      values, indices = torch.topk(input, 20, largest=largest)
+      xla_values, xla_indices = torch.topk(xla_input, 20, largest=largest)
+      self.assertEqual(values, xla_values.cpu())
+      self.assertEqual(indices, xla_indices.cpu())
+    for k in (7, 49000):
+      values, indices = torch.kthvalue(input, k)
+      xla_values, xla_indices = torch.kthvalue(xla_input, k)
+      self.assertEqual(values, xla_values.cpu())
+      self.assertEqual(indices, xla_indices.cpu())
+    self.assertIn('TiledTopK', met.counter_names())
+
+  def test_foreach_ops(self):
+    xla_device = xm.xla_device()
+    shapes = [(3, 4), (7,), (2, 3, 5), ()]
+    lists = [[torch.randn(*shape) for shape in shapes] for _ in range(3)]
+    xla_lists = [[t.to(xla_device) for t in ts] for ts in lists]
+
+    self.assertEqual(
+        torch._foreach_add(lists[0], 2.5),
+        [t.cpu() for t in torch._foreach_add(xla_lists[0], 2.5)])
+    self.assertEqual(
+        torch._foreach_add(lists[0], lists[1], alpha=0.5),
+        [t.cpu() for t in torch._foreach_add(*xla_lists[:2], alpha=0.5)])
+    self.assertEqual(
+        torch._foreach_mul(lists[0], lists[1]),
+        [t.cpu() for t in torch._foreach_mul(*xla_lists[:2])])
+    self.assertEqual(
+        torch._foreach_norm(lists[0]),
+        [t.cpu() for t in torch._foreach_norm(xla_lists[0])])
+
+    expected = [t.clone() for t in lists[0]]
+    xla_inputs = [t.clone() for t in xla_lists[0]]
+    torch._foreach_addcmul_(expected, lists[1], lists[2], value=0.3)
+    torch._foreach_addcmul_(xla_inputs, xla_lists[1], xla_lists[2], value=0.3)
+    torch._foreach_mul_(expected, 1.5)
+    torch._foreach_mul_(xla_inputs, 1.5)
+    self.assertEqual(expected, [t.cpu() for t in xla_inputs])
+
+  def test_clip_grad_norm(self):
+    xla_device = xm.xla_device()
+    shapes = [(3, 4), (7,), (2, 3, 5)]
+    for norm_type in (2.0, 1.0, 3.0, float('inf')):
+      params = [torch.randn(*shape, requires_grad=True) for shape in shapes]
+      xla_params = [p.detach().to(xla_device).requires_grad_() for p in params]
+      for p, xla_p in zip(params, xla_params):
+        p.grad = torch.randn_like(p) * 10
+        xla_p.grad = p.grad.to(xla_device)
+      total_norm = torch.nn.utils.clip_grad_norm_(
+          params, 1.0, norm_type=norm_type)
+      xla_total_norm = xf.clip_grad_norm_(
+          xla_params, 1.0, norm_type=norm_type)
+      self.assertEqual(total_norm, xla_total_norm.cpu(), prec=1e-4)
+      for p, xla_p in zip(params, xla_params):
+        self.assertEqual(p.grad, xla_p.grad.cpu(), prec=1e-4)
+
+  def test_embedding_bag(self):
+    xla_device = xm.xla_device()
+    # Bags of various sizes, with an empty one and repeated indices.
+    input = torch.tensor([1, 2, 4, 5, 4, 3, 2, 9, 0, 4, 4])
+    offsets = torch.tensor([0, 3, 3, 7])
+    for mode in ('sum', 'mean', 'max'):
+      for padding_idx in (None, 4):
+        weight = torch.randn(10, 5, requires_grad=True)
+        xla_weight = weight.detach().to(xla_device).requires_grad_()
+        output = F.embedding_bag(
+            input, weight, offsets, mode=mode, padding_idx=padding_idx)
+        xla_output = F.embedding_bag(
+            input.to(xla_device),
+            xla_weight,
+            offsets.to(xla_device),
+            mode=mode,
+            padding_idx=padding_idx)
+        self.assertEqual(output, xla_output.cpu(), prec=1e-5)
+        grad = torch.randn_like(output)
+        output.backward(grad)
+        xla_output.backward(grad.to(xla_device))
+        self.assertEqual(weight.grad, xla_weight.grad.cpu(), prec=1e-5)
+
+  def test_embedding_bag_sparse_sgd(self):
+    xla_device = xm.xla_device()
+    input = torch.tensor([1, 2, 4, 5, 4, 3, 2, 9])
+    offsets = torch.tensor([0, 3, 5])
+    weight = torch.randn(10, 5)
+    per_sample_weights = torch.rand(input.size(0))
+    grad = torch.randn(offsets.size(0), weight.size(1))
+    ref_weight = weight.clone().requires_grad_()
+    F.embedding_bag(
+        input, ref_weight, offsets,
+        per_sample_weights=per_sample_weights).backward(grad)
+    xla_weight = weight.to(xla_device)
+    xf.embedding_bag_sparse_sgd_(
+        xla_weight,
+        grad.to(xla_device),
+        input.to(xla_device),
+        offsets.to(xla_device),
+        0.1,
+        per_sample_weights=per_sample_weights.to(xla_device))
+    self.assertEqual(
+        weight - 0.1 * ref_weight.grad, xla_weight.cpu(), prec=1e-5)
+
   def test_util_foreach_api(self):
 
     class ForTest(object):
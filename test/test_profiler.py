@@ -6,9 +6,12 @@ import os
 import sys
 import tempfile
 import unittest
+import urllib.request
 
 import args_parse
 import test_profile_mp_mnist
+import torch
+import torch_xla.core.xla_model as xm
 import torch_xla.debug.profiler as xp
 import torch_xla.utils.utils as xu
 
@@ -85,6 +88,19 @@ class ProfilerTest(unittest.TestCase):
     self._check_trace_namespace_exists(path)
     self._check_metrics_warnings_exist(self.fname)
 
+  def test_metrics_server(self):
+    port = xu.get_free_tcp_ports()[0]
+    server = xp.start_metrics_server(port, labels={'job': 'test'})
+    x = torch.ones(4, device=xm.xla_device())
+    (x + 1).cpu()
+    with urllib.request.urlopen(f'http://localhost:{port}/metrics') as f:
+      report = f.read().decode()
+    self.assertIn('# TYPE xla_metric summary', report)
+    self.assertIn('xla_counter_total{name="CreateXlaTensor",job="test"}',
+                  report)
+    self.assertIn('xla_metric_count{name="CompileTime",job="test"}', report)
+    del server
+
 
 if __name__ == '__main__':
   logging.getLogger().setLevel(logging.INFO)
@@ -1,4 +1,5 @@
 import argparse
+import functools
 import sys
 
 parser = argparse.ArgumentParser(add_help=False)
@@ -16,6 +17,7 @@ try:
   from torch_xla.amp import syncfree
 except ImportError:
   assert False, "Missing package syncfree; the package is available in torch-xla>=1.11"
+from torch_xla.distributed.zero_redundancy_optimizer import ShardedAdam
 
 
 class MNIST(nn.Module):
@@ -40,6 +42,97 @@ class MNIST(nn.Module):
     return F.log_softmax(x, dim=1)
 
 
+class LambReference(torch.optim.Optimizer):
+
+  def __init__(self, params, lr=1e-3, betas=(0.9, 0.999), eps=1e-6,
+               weight_decay=0):
+    defaults = dict(lr=lr, betas=betas, eps=eps, weight_decay=weight_decay)
+    super(LambReference, self).__init__(params, defaults)
+
+  @torch.no_grad()
+  def step(self, closure=None):
+    for group in self.param_groups:
+      beta1, beta2 = group['betas']
+      for p in group['params']:
+        if p.grad is None:
+          continue
+        state = self.state[p]
+        if not state:
+          state['step'] = 0
+          state['exp_avg'] = torch.zeros_like(p)
+          state['exp_avg_sq'] = torch.zeros_like(p)
+        state['step'] += 1
+        exp_avg, exp_avg_sq = state['exp_avg'], state['exp_avg_sq']
+        exp_avg.mul_(beta1).add_(p.grad, alpha=1 - beta1)
+        exp_avg_sq.mul_(beta2).addcmul_(p.grad, p.grad, value=1 - beta2)
+        update = (exp_avg / (1 - beta1**state['step'])) / (
+            (exp_avg_sq / (1 - beta2**state['step'])).sqrt() + group['eps'])
+        update.add_(p, alpha=group['weight_decay'])
+        p_norm, update_norm = p.norm(), update.norm()
+        trust_ratio = torch.where((p_norm > 0) & (update_norm > 0),
+                                  p_norm / update_norm,
+                                  torch.ones_like(p_norm))
+        p.sub_(update * trust_ratio * group['lr'])
+
+
+class AdafactorReference(torch.optim.Optimizer):
+
+  def __init__(self,
+               params,
+               lr=1e-3,
+               eps=(1e-30, 1e-3),
+               clip_threshold=1.0,
+               decay_rate=-0.8,
+               weight_decay=0.0,
+               scale_parameter=True):
+    defaults = dict(
+        lr=lr,
+        eps=eps,
+        clip_threshold=clip_threshold,
+        decay_rate=decay_rate,
+        weight_decay=weight_decay,
+        scale_parameter=scale_parameter)
+    super(AdafactorReference, self).__init__(params, defaults)
+
+  @torch.no_grad()
+  def step(self, closure=None):
+    rms = lambda t: t.norm() / (t.numel()**0.5)
+    for group in self.param_groups:
+      eps1, eps2 = group['eps']
+      for p in group['params']:
+        if p.grad is None:
+          continue
+        state = self.state[p]
+        factored = p.dim() >= 2
+        if not state:
+          state['step'] = 0
+          if factored:
+            state['row'] = torch.zeros(p.shape[:-1], device=p.device)
+            state['col'] = torch.zeros(
+                p.shape[:-2] + p.shape[-1:], device=p.device)
+          else:
+            state['exp_avg_sq'] = torch.zeros_like(p)
+        state['step'] += 1
+        beta2t = 1.0 - state['step']**group['decay_rate']
+        update = p.grad * p.grad + eps1
+        if factored:
+          row, col = state['row'], state['col']
+          row.mul_(beta2t).add_(update.mean(dim=-1), alpha=1.0 - beta2t)
+          col.mul_(beta2t).add_(update.mean(dim=-2), alpha=1.0 - beta2t)
+          row_factor = (row / row.mean(dim=-1, keepdim=True)).rsqrt()
+          update = row_factor.unsqueeze(-1) * col.rsqrt().unsqueeze(-2) * p.grad
+        else:
+          exp_avg_sq = state['exp_avg_sq']
+          exp_avg_sq.mul_(beta2t).add_(update, alpha=1.0 - beta2t)
+          update = exp_avg_sq.rsqrt() * p.grad
+        update.div_((rms(update) / group['clip_threshold']).clamp_(min=1.0))
+        lr = group['lr']
+        if group['scale_parameter']:
+          lr = lr * torch.clamp(rms(p), min=eps2)
+        p.sub_(p * group['weight_decay'] * lr)
+        p.sub_(update * lr)
+
+
 class TestSyncFreeOptimizerBase(unittest.TestCase):
 
   def setUp(self):
@@ -188,6 +281,48 @@ class TestSyncFreeAdam(TestSyncFreeOptimizerBase):
     self._test_adam_optimizer_helper(syncfree.AdamW, torch.optim.AdamW)
 
 
+class TestSyncFreeLamb(TestSyncFreeOptimizerBase):
+
+  def test_optimizer(self):
+    self._test_optimizer(syncfree.Lamb, LambReference, {
+        "lr": 1e-3,
+        "betas": (0.9, 0.99),
+    })
+    self._test_optimizer(syncfree.Lamb, LambReference, {
+        "lr": 1e-3,
+        "betas": (0.9, 0.999),
+        "weight_decay": 0.01,
+    })
+
+
+class TestSyncFreeAdafactor(TestSyncFreeOptimizerBase):
+
+  def test_optimizer(self):
+    self._test_optimizer(syncfree.Adafactor, AdafactorReference, {
+        "lr": 1e-2,
+    })
+    self._test_optimizer(syncfree.Adafactor, AdafactorReference, {
+        "lr": 1e-2,
+        "weight_decay": 0.01,
+        "scale_parameter": False,
+    })
+
+
+class TestShardedAdam(TestSyncFreeOptimizerBase):
+
+  def test_optimizer(self):
+    self._test_optimizer(ShardedAdam, torch.optim.Adam, {
+        "lr": 1e-3,
+        "betas": (0.9, 0.99),
+        "weight_decay": 1e-4,
+    })
+    self._test_optimizer(
+        functools.partial(ShardedAdam, use_adamw=True), torch.optim.AdamW, {
+            "lr": 1e-3,
+            "weight_decay": 1e-2,
+        })
+
+
 if __name__ == "__main__":
   test = unittest.main(verbosity=FLAGS.verbosity, exit=False)
   sys.exit(0 if test.result.wasSuccessful() else 1)
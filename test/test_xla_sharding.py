@@ -1,10 +1,15 @@
+import math
 import os
 import sys
+import tempfile
 
 import torch
 import torch_xla
 import torch_xla.core.xla_model as xm
+import torch_xla.debug.metrics as met
+import torch_xla.utils.serialization as xser
 import torch_xla.utils.utils as xu
+import torch_xla.experimental.context_parallel as cp
 import torch_xla.experimental.xla_sharding as xs
 from torch_xla.experimental.xla_sharded_tensor import XLAShardedTensor
 import unittest
@@ -39,6 +44,212 @@ class XlaShardingTest(unittest.TestCase):
     # assignment as intended.
     # assert device_assignment == t1_sharded.sharding_spec[0]
 
+  def test_mesh_replica_groups(self):
+    mesh = xs.Mesh([0, 2, 4, 6, 1, 3, 5, 7], (2, 4), ('data', 'model'))
+    self.assertEqual(mesh.shape(), {'data': 2, 'model': 4})
+    self.assertEqual(
+        mesh.get_replica_groups('model'), [[0, 2, 4, 6], [1, 3, 5, 7]])
+    self.assertEqual(
+        mesh.get_replica_groups('data'), [[0, 1], [2, 3], [4, 5], [6, 7]])
+    self.assertEqual(
+        mesh.get_replica_groups(('data', 'model')), [[0, 2, 4, 6, 1, 3, 5, 7]])
+
+  def test_create_device_mesh(self):
+    num_devices = len(xs._get_mesh_devices())
+    mesh = xs.create_device_mesh((num_devices,), ('x',))
+    self.assertEqual(sorted(mesh.get_logical_mesh().tolist()),
+                     list(range(num_devices)))
+
+  @unittest.skipIf(
+      not xu.getenv_as('XLA_USE_SPMD', bool, False) or
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_USE_SPMD and at least two devices')
+  def test_spmd_sharded_matmul(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    # The rows do not split evenly, so the last shard gets padded.
+    xa = torch.randn(num_devices * 2 + 1, 8)
+    xb = torch.randn(8, 4)
+    a = xa.to(device)
+    b = xb.to(device)
+    xs.mark_sharding(a, (num_devices, 1), (0, None))
+    self.assertTrue(torch.allclose(a.cpu(), xa))
+    c = a @ b
+    xm.mark_step()
+    # The host data went straight to the devices as shards.
+    self.assertEqual(met.counter_value('ShardedTensorsToData'), 1)
+    self.assertTrue(torch.allclose(c.cpu(), xa @ xb, atol=1e-4))
+
+  @unittest.skipIf(
+      not xu.getenv_as('XLA_USE_SPMD', bool, False) or
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2 or
+      len(torch_xla._XLAC._xla_get_spmd_devices()) % 2 != 0,
+      'Requires XLA_USE_SPMD and an even number of devices')
+  def test_spmd_partial_replication(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    mesh_shape = (num_devices // 2, 2)
+    tile_assignment, replicated, partial = xs._get_tile_assignment(
+        2, mesh_shape, (0, None))
+    # The rows split over the first mesh axis, and every row shard is
+    # replicated over the second one instead of splitting the columns.
+    self.assertFalse(replicated)
+    self.assertTrue(partial)
+    self.assertEqual(
+        list(np.array(tile_assignment).shape), [num_devices // 2, 1, 2])
+    xa = torch.randn(num_devices * 2, 8)
+    a = xa.to(device)
+    xs.mark_sharding(a, mesh_shape, (0, None))
+    self.assertIn('last_tile_dim_replicate',
+                  torch_xla._XLAC._get_xla_sharding_spec(a))
+    b = a * 2.0 + 1.0
+    xm.mark_step()
+    self.assertTrue(torch.allclose(b.cpu(), xa * 2.0 + 1.0))
+
+  @unittest.skipIf(
+      not xu.getenv_as('XLA_USE_SPMD', bool, False) or
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_USE_SPMD and at least two devices')
+  def test_spmd_copy_into_sharded(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    xt = torch.randn(num_devices * 2, 4)
+    src = xt.to(device)
+    xm.mark_step()
+    dest = torch.zeros(num_devices * 2, 4, device=device)
+    xs.mark_sharding(dest, (num_devices, 1), (0, None))
+    shared = met.counter_value('SharedDeviceData') or 0
+    # The unsharded data of src cannot back the sharded dest, so it gets
+    # copied instead of shared.
+    dest.copy_(src)
+    self.assertEqual(met.counter_value('SharedDeviceData') or 0, shared)
+    self.assertIn('devices=', torch_xla._XLAC._get_xla_sharding_spec(dest))
+    xm.mark_step()
+    self.assertTrue(torch.allclose(dest.cpu(), xt))
+
+  @unittest.skipIf(
+      not xu.getenv_as('XLA_USE_SPMD', bool, False) or
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_USE_SPMD and at least two devices')
+  def test_spmd_sharding_in_graph_hash(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    xt = torch.randn(num_devices, num_devices)
+    results = []
+    for mesh_shape, partition_spec in [((num_devices, 1), (0, None)),
+                                       ((1, num_devices), (None, 1))]:
+      t = xt.to(device)
+      xs.mark_sharding(t, mesh_shape, partition_spec)
+      compiles = met.counter_value('UncachedCompile') or 0
+      results.append(t * 2.0)
+      xm.mark_step()
+      # The same graph over differently sharded data compiles again.
+      self.assertEqual(met.counter_value('UncachedCompile'), compiles + 1)
+    for result in results:
+      self.assertTrue(torch.allclose(result.cpu(), xt * 2.0))
+
+  @unittest.skipIf(
+      not xu.getenv_as('XLA_USE_SPMD', bool, False) or
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_USE_SPMD and at least two devices')
+  def test_spmd_sharded_checkpoint(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    xw = torch.randn(num_devices * 2, 4)
+    xb = torch.randn(4)
+    w = xw.to(device)
+    xs.mark_sharding(w, (num_devices, 1), (0, None))
+    data = {'w': w, 'b': xb.to(device)}
+    with tempfile.TemporaryDirectory() as tmpdir:
+      path = os.path.join(tmpdir, 'data.pt')
+      xser.save_sharded(data, path)
+      # Every device shard of w is a slice of its own.
+      self.assertEqual(len(os.listdir(path + '.tensors')), num_devices + 1)
+      cpu_data = xser.load_sharded(path)
+      self.assertTrue(torch.allclose(cpu_data['w'], xw))
+      self.assertTrue(torch.allclose(cpu_data['b'], xb))
+      xla_data = xser.load_sharded(path, device=device)
+      self.assertIn('devices=',
+                    torch_xla._XLAC._get_xla_sharding_spec(xla_data['w']))
+      self.assertTrue(torch.allclose(xla_data['w'].cpu(), xw))
+      self.assertTrue(torch.allclose(xla_data['b'].cpu(), xb))
+
+  @unittest.skipIf(
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_USE_SPMD and at least two devices')
+  def test_spmd_manual_sharding(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    xt = torch.randn(num_devices * 2, 4)
+    t = xt.to(device)
+    mesh = xs.create_device_mesh((num_devices, 1), ('data', 'model'))
+    shard = xs.enable_manual_sharding(t, mesh, ('data', None))
+    self.assertEqual(list(shard.shape), [2, 4])
+    # Every device sums the shards of all the devices.
+    shard = xm.all_reduce(xm.REDUCE_SUM, shard)
+    t = xs.disable_manual_sharding(shard, mesh, ('data', None), xt.shape)
+    expected = xt.view(num_devices, 2, 4).sum(0).repeat(num_devices, 1)
+    self.assertTrue(torch.allclose(t.cpu(), expected, atol=1e-5))
+
+  @unittest.skipIf(
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_USE_SPMD and at least two devices')
+  def test_spmd_ring_attention(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    xq, xk, xv = [torch.randn(2, 2, num_devices * 4, 8) for _ in range(3)]
+    mesh = xs.create_device_mesh((1, 1, num_devices, 1),
+                                 ('data', 'heads', 'seq', 'dim'))
+    for causal in (False, True):
+      scores = torch.matmul(xq, xk.transpose(-1, -2)) / math.sqrt(8)
+      if causal:
+        mask = torch.ones(scores.shape[-2:], dtype=torch.bool).tril()
+        scores = scores.masked_fill(~mask, -math.inf)
+      expected = torch.matmul(torch.softmax(scores, dim=-1), xv)
+      output = cp.ring_attention(
+          xq.to(device),
+          xk.to(device),
+          xv.to(device),
+          mesh, (None, None, 'seq', None),
+          causal=causal)
+      self.assertTrue(torch.allclose(output.cpu(), expected, atol=1e-4))
+
+  @unittest.skipIf(
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_USE_SPMD and at least two devices')
+  def test_spmd_memory_plan(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    w = torch.randn(num_devices * 4, 8).to(device)
+    xs.mark_sharding(w, (num_devices, 1), (0, None))
+    y = w * 2.0
+    plan = xs.get_memory_plan([y])
+    # Every device holds a 4x8 float shard of w and of y.
+    self.assertEqual(plan['argument_bytes'], 4 * 8 * 4)
+    self.assertEqual(plan['output_bytes'], 4 * 8 * 4)
+    self.assertGreaterEqual(plan['peak_bytes'],
+                            plan['argument_bytes'] + plan['output_bytes'])
+    self.assertEqual(plan['collective_bytes'], {})
+
+  @unittest.skipIf(
+      not xu.getenv_as('XLA_SPMD_AUTO_SHARDING', bool, False) or
+      len(torch_xla._XLAC._xla_get_spmd_devices()) < 2,
+      'Requires XLA_SPMD_AUTO_SHARDING and at least two devices')
+  def test_spmd_auto_sharding(self):
+    num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+    device = xm.xla_device()
+    xa = torch.randn(num_devices * 2, 8)
+    xb = torch.randn(8, 4)
+    a = xa.to(device)
+    b = xb.to(device)
+    xs.mark_sharding(a, (num_devices, 1), (0, None))
+    # Both the matmul and the relu inherit the row sharding of a.
+    c = torch.relu(a @ b) * 2.0
+    xm.mark_step()
+    self.assertIn('SpmdInferredShardings', met.metric_names())
+    self.assertTrue(torch.allclose(c.cpu(), torch.relu(xa @ xb) * 2.0,
+                                   atol=1e-4))
+
 
 if __name__ == '__main__':
   test = unittest.main()
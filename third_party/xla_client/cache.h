@@ -1,45 +1,95 @@
 #ifndef XLA_CLIENT_CACHE_H_
 #define XLA_CLIENT_CACHE_H_
 
+#include <algorithm>
 #include <functional>
+#include <iterator>
 #include <list>
 #include <memory>
 #include <mutex>
 #include <unordered_map>
 #include <utility>
 
+#include "tensorflow/compiler/xla/xla_client/cache_policy.h"
+
 namespace xla {
 namespace util {
 
 // Generic key and object cache with LRU expiration policy. The objects of type
 // T will be stored as std::shared_ptr<T> and taken and returned as such, by the
 // cache API.
+// Besides the maximum number of objects, the cache can be limited by the total
+// byte size of the stored objects, as reported by the size function. When such
+// limit is exceeded, the object to evict is chosen among the least recently
+// used ones, as the one with the lowest cost (as reported by the cost
+// function, like the time it took to create it) times the number of hits,
+// per byte. With the TinyLFU admission (see CacheOptions), a new object only
+// evicts the least recently used one if its key is requested at least as
+// frequently.
 template <typename K, typename T, typename H = std::hash<K>,
           typename E = std::equal_to<K>>
 class Cache {
  public:
   using TypePtr = std::shared_ptr<T>;
-  using Element = std::pair<K, TypePtr>;
-
-  explicit Cache(size_t max_size) : max_size_(max_size) {}
+  using SizeFn = std::function<size_t(const T&)>;
+  using CostFn = std::function<double(const T&)>;
+  using EvictFn = std::function<void(const K&, const TypePtr&)>;
+
+  explicit Cache(size_t max_size, CacheOptions options = CacheOptions())
+      : Cache(max_size, 0, nullptr, nullptr, nullptr, std::move(options)) {}
+
+  // The evict_fn, if set, is called (with the cache lock held, so it must not
+  // call back into the cache) for every object evicted due to the limits.
+  Cache(size_t max_size, size_t max_bytes, SizeFn size_fn,
+        CostFn cost_fn = nullptr, EvictFn evict_fn = nullptr,
+        CacheOptions options = CacheOptions())
+      : max_size_(max_size),
+        max_bytes_(max_bytes),
+        size_fn_(std::move(size_fn)),
+        cost_fn_(std::move(cost_fn)),
+        evict_fn_(std::move(evict_fn)),
+        counters_(options.name) {
+    if (options.admission == CacheAdmission::kTinyLfu) {
+      sketch_ = std::make_unique<FrequencySketch>(max_size);
+    }
+  }
 
   // Adds an object to the cache, unless it already exists. If the cache grows
-  // beyond the limit set during construction, the oldest used object will be
-  // removed from the cache.
+  // beyond the limits set during construction, objects will be removed from the
+  // cache according to the policy described above.
+  // A new object which is not admitted gets returned without being cached.
   TypePtr Add(K key, TypePtr object) {
     std::lock_guard<std::mutex> slock(lock_);
-    element_list_.emplace_front(Element(std::move(key), std::move(object)));
+    auto mit = element_map_.find(&key);
+    if (mit != element_map_.end()) {
+      DoLRU(mit->second);
+      return mit->second->object;
+    }
+    if (sketch_ != nullptr) {
+      uint64_t hash = element_map_.hash_function().hasher(key);
+      sketch_->Increment(hash);
+      if (!element_list_.empty() && element_list_.size() >= max_size_ &&
+          sketch_->Frequency(hash) <
+              sketch_->Frequency(element_map_.hash_function().hasher(
+                  element_list_.back().key))) {
+        stats_.rejections += 1;
+        counters_.Rejection();
+        return object;
+      }
+    }
+    size_t bytes = size_fn_ != nullptr ? size_fn_(*object) : 0;
+    element_list_.emplace_front(std::move(key), std::move(object), bytes);
     auto it = element_list_.begin();
-    auto emplace_result = element_map_.emplace(&it->first, it);
-    if (!emplace_result.second) {
-      element_list_.erase(it);
-      DoLRU(emplace_result.first->second);
-    } else if (element_list_.size() > max_size_) {
-      Element* last = &element_list_.back();
-      element_map_.erase(&last->first);
-      element_list_.pop_back();
+    element_map_.emplace(&it->key, it);
+    total_bytes_ += bytes;
+    if (element_list_.size() > max_size_) {
+      Evict(std::prev(element_list_.end()));
     }
-    return emplace_result.first->second->second;
+    while (max_bytes_ > 0 && total_bytes_ > max_bytes_ &&
+           element_list_.size() > 1) {
+      Evict(SelectVictim());
+    }
+    return it->object;
   }
 
   // Retrieves the existing object if it exists. If it does, it's position in
@@ -48,12 +98,20 @@ class Cache {
   // cache.
   TypePtr Get(const K& key) {
     std::lock_guard<std::mutex> slock(lock_);
+    if (sketch_ != nullptr) {
+      sketch_->Increment(element_map_.hash_function().hasher(key));
+    }
     auto it = element_map_.find(&key);
     if (it == element_map_.end()) {
+      stats_.misses += 1;
+      counters_.Miss();
       return nullptr;
     }
+    stats_.hits += 1;
+    counters_.Hit();
+    it->second->hits += 1;
     DoLRU(it->second);
-    return it->second->second;
+    return it->second->object;
   }
 
   bool Erase(const K& key) {
@@ -63,6 +121,7 @@ class Cache {
       return false;
     }
     auto lit = it->second;
+    total_bytes_ -= lit->bytes;
     element_map_.erase(it);
     element_list_.erase(lit);
     return true;
@@ -72,9 +131,36 @@ class Cache {
     std::lock_guard<std::mutex> slock(lock_);
     element_map_.clear();
     element_list_.clear();
+    total_bytes_ = 0;
+  }
+
+  // Returns the total byte size of the objects within the cache, as reported
+  // by the size function.
+  size_t GetBytes() {
+    std::lock_guard<std::mutex> slock(lock_);
+    return total_bytes_;
+  }
+
+  CacheStats GetStats() {
+    std::lock_guard<std::mutex> slock(lock_);
+    return stats_;
   }
 
  private:
+  // Number of least recently used objects considered when evicting due to the
+  // byte size limit.
+  static constexpr size_t kEvictionWindow = 8;
+
+  struct Element {
+    Element(K key, TypePtr object, size_t bytes)
+        : key(std::move(key)), object(std::move(object)), bytes(bytes) {}
+
+    K key;
+    TypePtr object;
+    size_t bytes = 0;
+    size_t hits = 0;
+  };
+
   using ElementList = std::list<Element>;
 
   struct Hasher {
@@ -99,8 +185,46 @@ class Cache {
     element_list_.splice(element_list_.begin(), element_list_, it);
   }
 
+  typename ElementList::iterator SelectVictim() {
+    // Never pick the most recent object, which is the one just added.
+    auto victim = std::prev(element_list_.end());
+    double victim_score = 0.0;
+    size_t count = 0;
+    for (auto it = victim;
+         count < kEvictionWindow && it != element_list_.begin();
+         --it, ++count) {
+      double cost = cost_fn_ != nullptr ? cost_fn_(*it->object) : 1.0;
+      double score = cost * static_cast<double>(it->hits + 1) /
+                     static_cast<double>(std::max<size_t>(it->bytes, 1));
+      if (count == 0 || score < victim_score) {
+        victim = it;
+        victim_score = score;
+      }
+    }
+    return victim;
+  }
+
+  void Evict(typename ElementList::iterator it) {
+    stats_.evictions += 1;
+    counters_.Eviction();
+    if (evict_fn_ != nullptr) {
+      evict_fn_(it->key, it->object);
+    }
+    total_bytes_ -= it->bytes;
+    element_map_.erase(&it->key);
+    element_list_.erase(it);
+  }
+
   std::mutex lock_;
   size_t max_size_ = 0;
+  size_t max_bytes_ = 0;
+  size_t total_bytes_ = 0;
+  SizeFn size_fn_;
+  CostFn cost_fn_;
+  EvictFn evict_fn_;
+  CacheCounters counters_;
+  std::unique_ptr<FrequencySketch> sketch_;
+  CacheStats stats_;
   ElementList element_list_;
   ElementMap element_map_;
 };
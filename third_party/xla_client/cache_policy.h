@@ -0,0 +1,141 @@
+#ifndef XLA_CLIENT_CACHE_POLICY_H_
+#define XLA_CLIENT_CACHE_POLICY_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+
+namespace xla {
+namespace util {
+
+// Which new objects get into a cache which is full.
+enum class CacheAdmission {
+  // Every new object gets in, evicting the victim of the expiration policy.
+  kAlways,
+  // TinyLFU: a new object only gets in if it was requested at least as
+  // frequently as the victim it would evict, so that the one-off objects
+  // (like the graphs of a dynamic shape) do not flush the popular ones.
+  kTinyLfu,
+};
+
+struct CacheOptions {
+  // If not empty, the hits, misses, evictions and rejections of the cache are
+  // also exported as the <name>Hits, <name>Misses, <name>Evictions and
+  // <name>Rejections counters.
+  std::string name;
+  CacheAdmission admission = CacheAdmission::kAlways;
+};
+
+struct CacheStats {
+  int64_t hits = 0;
+  int64_t misses = 0;
+  int64_t evictions = 0;
+  // The new objects which were not admitted into the cache.
+  int64_t rejections = 0;
+};
+
+// The metrics counters of a named cache.
+class CacheCounters {
+ public:
+  explicit CacheCounters(const std::string& name) {
+    if (!name.empty()) {
+      hits_ = std::make_unique<metrics::Counter>(name + "Hits");
+      misses_ = std::make_unique<metrics::Counter>(name + "Misses");
+      evictions_ = std::make_unique<metrics::Counter>(name + "Evictions");
+      rejections_ = std::make_unique<metrics::Counter>(name + "Rejections");
+    }
+  }
+
+  void Hit() { Add(hits_.get()); }
+
+  void Miss() { Add(misses_.get()); }
+
+  void Eviction() { Add(evictions_.get()); }
+
+  void Rejection() { Add(rejections_.get()); }
+
+ private:
+  static void Add(metrics::Counter* counter) {
+    if (counter != nullptr) {
+      counter->AddValue(1);
+    }
+  }
+
+  std::unique_ptr<metrics::Counter> hits_;
+  std::unique_ptr<metrics::Counter> misses_;
+  std::unique_ptr<metrics::Counter> evictions_;
+  std::unique_ptr<metrics::Counter> rejections_;
+};
+
+// Approximates the recent request frequency of the keys, by hash, with a
+// count-min sketch of four rows of counters saturating at 15. Once the number
+// of increments reaches ten times the capacity of the cache, all the counters
+// get halved, so that the past popularity fades. Not thread safe.
+class FrequencySketch {
+ public:
+  explicit FrequencySketch(size_t capacity)
+      : sample_size_(10 * std::max<size_t>(capacity, 1)) {
+    width_ = 64;
+    while (width_ < 2 * capacity) {
+      width_ *= 2;
+    }
+    table_.resize(kNumRows * width_, 0);
+  }
+
+  void Increment(uint64_t hash) {
+    bool incremented = false;
+    for (size_t row = 0; row < kNumRows; ++row) {
+      uint8_t& count = table_[Index(hash, row)];
+      if (count < kMaxCount) {
+        ++count;
+        incremented = true;
+      }
+    }
+    if (incremented && ++increments_ >= sample_size_) {
+      Age();
+    }
+  }
+
+  int Frequency(uint64_t hash) const {
+    int frequency = kMaxCount;
+    for (size_t row = 0; row < kNumRows; ++row) {
+      frequency = std::min<int>(frequency, table_[Index(hash, row)]);
+    }
+    return frequency;
+  }
+
+ private:
+  static constexpr size_t kNumRows = 4;
+  static constexpr uint8_t kMaxCount = 15;
+
+  size_t Index(uint64_t hash, size_t row) const {
+    static const uint64_t kSeeds[kNumRows] = {
+        0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL,
+        0xd6e8feb86659fd93ULL};
+    uint64_t mixed = (hash + kSeeds[row]) * kSeeds[(row + 1) % kNumRows];
+    mixed ^= mixed >> 32;
+    return row * width_ + (mixed & (width_ - 1));
+  }
+
+  void Age() {
+    for (auto& count : table_) {
+      count >>= 1;
+    }
+    increments_ /= 2;
+  }
+
+  size_t width_ = 0;
+  size_t sample_size_ = 0;
+  size_t increments_ = 0;
+  std::vector<uint8_t> table_;
+};
+
+}  // namespace util
+}  // namespace xla
+
+#endif  // XLA_CLIENT_CACHE_POLICY_H_
@@ -316,6 +316,84 @@ std::vector<std::string> ComputationClient::GetCompilationDevices(
   return compilation_devices;
 }
 
+std::vector<memory_quota::ChargePtr> ComputationClient::AcquireTransferQuota(
+    absl::Span<const TensorSource> tensors) {
+  std::vector<memory_quota::ChargePtr> charges;
+  if (!memory_quota::IsEnabled()) {
+    return charges;
+  }
+  // The tensors of every device get charged at once.
+  std::map<std::string, std::vector<size_t>> device_tensors;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    device_tensors[tensors[i].device].push_back(i);
+  }
+  charges.resize(tensors.size());
+  for (auto& device_indices : device_tensors) {
+    std::vector<int64_t> bytes;
+    bytes.reserve(device_indices.second.size());
+    for (auto index : device_indices.second) {
+      bytes.push_back(ShapeUtil::ByteSizeOf(tensors[index].shape));
+    }
+    std::vector<memory_quota::ChargePtr> device_charges =
+        memory_quota::Acquire(device_indices.first, bytes);
+    for (size_t i = 0; i < device_charges.size(); ++i) {
+      charges[device_indices.second[i]] = std::move(device_charges[i]);
+    }
+  }
+  return charges;
+}
+
+std::vector<memory_quota::ChargePtr> ComputationClient::AcquireResultsQuota(
+    const Computation& computation, absl::Span<const DataPtr> arguments,
+    const std::string& device, bool explode_tuple) {
+  std::vector<memory_quota::ChargePtr> charges;
+  if (!memory_quota::IsEnabled()) {
+    return charges;
+  }
+  const Shape& result_shape = computation.program_shape().result();
+  if (!explode_tuple || !result_shape.IsTuple()) {
+    memory_quota::ChargePtr charge = memory_quota::Acquire(
+        device, {ShapeUtil::ByteSizeOf(result_shape, sizeof(void*))})[0];
+    charges.push_back(std::move(charge));
+    return charges;
+  }
+  charges.resize(result_shape.tuple_shapes_size());
+  for (auto& entry :
+       computation.computation().proto().input_output_alias().entries()) {
+    if (entry.output_shape_index_size() == 1 &&
+        static_cast<size_t>(entry.parameter_number()) < arguments.size()) {
+      charges[entry.output_shape_index(0)] =
+          arguments[entry.parameter_number()]->quota_charge();
+    }
+  }
+  std::vector<size_t> indices;
+  std::vector<int64_t> bytes;
+  for (size_t i = 0; i < charges.size(); ++i) {
+    if (charges[i] == nullptr) {
+      indices.push_back(i);
+      bytes.push_back(ShapeUtil::ByteSizeOf(result_shape.tuple_shapes(i),
+                                            sizeof(void*)));
+    }
+  }
+  std::vector<memory_quota::ChargePtr> new_charges =
+      memory_quota::Acquire(device, bytes);
+  for (size_t i = 0; i < indices.size(); ++i) {
+    charges[indices[i]] = std::move(new_charges[i]);
+  }
+  return charges;
+}
+
+void ComputationClient::AttachQuota(
+    absl::Span<const DataPtr> datas,
+    std::vector<memory_quota::ChargePtr> charges) {
+  if (charges.size() != datas.size()) {
+    return;
+  }
+  for (size_t i = 0; i < datas.size(); ++i) {
+    datas[i]->set_quota_charge(std::move(charges[i]));
+  }
+}
+
 void ComputationClient::RunLocalService(uint64_t service_port) {
   try {
     XrtLocalService* service = new XrtLocalService(
@@ -14,6 +14,8 @@
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_quota.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/types.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
@@ -33,7 +35,7 @@ class ComputationClient {
     Data(std::string device, Shape shape)
         : device_(std::move(device)), shape_(std::move(shape)) {}
 
-    virtual ~Data() {}
+    virtual ~Data() { memory_tracker::RecordRelease(this); }
 
     const std::string& device() const { return device_; }
 
@@ -52,10 +54,21 @@ class ComputationClient {
 
     virtual bool HasValue() const = 0;
 
+    // The device memory quota charge of the buffer, shared by all the data
+    // objects the buffer gets assigned to.
+    const memory_quota::ChargePtr& quota_charge() const {
+      return quota_charge_;
+    }
+
+    void set_quota_charge(memory_quota::ChargePtr charge) {
+      quota_charge_ = std::move(charge);
+    }
+
    private:
     std::string device_;
     Shape shape_;
     std::shared_ptr<Info> info_;
+    memory_quota::ChargePtr quota_charge_;
   };
 
   using DataPtr = std::shared_ptr<Data>;
@@ -129,6 +142,11 @@ class ComputationClient {
     Shape shape;
     std::string device;
     PopulateFn populate_fn;
+    // If set, points to the source data, which already has the dense layout
+    // and the element type populate_fn would produce for shape. Clients can
+    // read it in place, instead of calling populate_fn, but they must be done
+    // reading it by the time TransferToServer() returns.
+    std::shared_ptr<const void> data;
   };
 
   struct CompileInstance {
@@ -186,6 +204,11 @@ class ComputationClient {
   struct MemoryInfo {
     int64_t kb_free = 0;
     int64_t kb_total = 0;
+    // The following fields are only filled by clients which can access the
+    // device allocator statistics, and left to zero otherwise.
+    int64_t kb_peak = 0;
+    int64_t kb_largest_free_block = 0;
+    int64_t num_allocs = 0;
   };
 
   static std::unique_ptr<ComputationClient> Create();
@@ -220,6 +243,11 @@ class ComputationClient {
   virtual std::vector<Literal> TransferFromServer(
       absl::Span<const DataPtr> handles) = 0;
 
+  // Reads the next value of the given shape from the outfeed of the device,
+  // blocking until a running computation emits it.
+  virtual Literal TransferFromOutfeed(const std::string& device,
+                                      const Shape& shape) = 0;
+
   // Compiles a set of computations.
   virtual std::vector<ComputationPtr> Compile(
       std::vector<CompileInstance> instances) = 0;
@@ -274,6 +302,20 @@ class ComputationClient {
   virtual std::vector<std::vector<DataPtr>> DeconstructTuple(
       absl::Span<const DataPtr> tuples) = 0;
 
+  // Serializes a compiled computation into an opaque string, which can be
+  // persisted and later restored with DeserializeComputation(), possibly from a
+  // different process. Returns an empty string if the client is not able to
+  // serialize compiled executables.
+  virtual std::string SerializeComputation(const Computation& computation) = 0;
+
+  // Restores a computation previously serialized with SerializeComputation().
+  // The computation and program_shape arguments must be the ones the
+  // serialized executable was compiled from. Returns nullptr if the serialized
+  // executable cannot be loaded by the client.
+  virtual ComputationPtr DeserializeComputation(
+      const std::string& serialized, XlaComputation computation,
+      ProgramShape program_shape, std::vector<std::string> devices) = 0;
+
   // Returns a unique string which identifies the resource domain of a given
   // device. Within a resource domain, handles to device memory or compiled
   // computations can be used for all devices part of such domain.
@@ -287,6 +329,11 @@ class ComputationClient {
 
   virtual std::vector<std::string> GetAllDevices() const = 0;
 
+  // Returns the physical coordinates of the device within the interconnect
+  // topology, with the fastest varying coordinate last, so that the devices
+  // sorted by their coordinates have their closest peers next to them.
+  virtual std::vector<int> GetDeviceCoords(const std::string& device) const = 0;
+
   virtual void SetReplicationDevices(
       std::shared_ptr<std::vector<std::string>> devices) = 0;
 
@@ -322,6 +369,24 @@ class ComputationClient {
   // after the last ':' character of the device string.
   static int64_t GetDeviceOrdinal(const std::string& device);
 
+  // Charges the buffers the tensors are about to be uploaded into against the
+  // device memory quota. Returns one charge per tensor, or an empty vector if
+  // the quota is disabled.
+  static std::vector<memory_quota::ChargePtr> AcquireTransferQuota(
+      absl::Span<const TensorSource> tensors);
+
+  // Charges the results of an execution of the computation on the device
+  // against the device memory quota, before it runs. The results aliasing an
+  // argument share the charge of the argument. Returns one charge per result
+  // data, or an empty vector if the quota is disabled.
+  static std::vector<memory_quota::ChargePtr> AcquireResultsQuota(
+      const Computation& computation, absl::Span<const DataPtr> arguments,
+      const std::string& device, bool explode_tuple);
+
+  // Assigns the charges returned by the Acquire*Quota() APIs to the datas.
+  static void AttachQuota(absl::Span<const DataPtr> datas,
+                          std::vector<memory_quota::ChargePtr> charges);
+
   // Returns the ComputationClient singleton.
   static ComputationClient* Get();
 
@@ -18,6 +18,12 @@ const char* const kEnvShardOrdinal = "XRT_SHARD_ORDINAL";
 const char* const kEnvStartService = "XRT_START_LOCAL_SERVER";
 const char* const kEnvTpuvmMode = "TPUVM_MODE";
 const char* const kEnvPjRtDevice = "PJRT_DEVICE";
+const char* const kEnvPjRtTpuMaxInflightComputations =
+    "PJRT_TPU_MAX_INFLIGHT_COMPUTATIONS";
+const char* const kEnvPjRtAsyncCpuClient = "PJRT_CPU_ASYNC_CLIENT";
+const char* const kEnvPjRtDistServiceAddr = "PJRT_DIST_SERVICE_ADDR";
+const char* const kEnvPjRtProcessIndex = "PJRT_PROCESS_INDEX";
+const char* const kEnvPjRtNumProcesses = "PJRT_NUM_PROCESSES";
 
 }  // namespace env
 }  // namespace xla
@@ -19,6 +19,11 @@ extern const char* const kEnvShardOrdinal;
 extern const char* const kEnvStartService;
 extern const char* const kEnvTpuvmMode;
 extern const char* const kEnvPjRtDevice;
+extern const char* const kEnvPjRtTpuMaxInflightComputations;
+extern const char* const kEnvPjRtAsyncCpuClient;
+extern const char* const kEnvPjRtDistServiceAddr;
+extern const char* const kEnvPjRtProcessIndex;
+extern const char* const kEnvPjRtNumProcesses;
 
 }  // namespace env
 }  // namespace xla
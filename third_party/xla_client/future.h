@@ -0,0 +1,235 @@
+#ifndef XLA_CLIENT_FUTURE_H_
+#define XLA_CLIENT_FUTURE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+
+namespace xla {
+namespace util {
+
+template <typename T>
+class Promise;
+
+// The result of an asynchronous operation, a value or an exception. Rather
+// than parking a thread on Wait(), the steps of a pipeline can be chained with
+// Then(), whose continuations run on the thread which completes the future,
+// or right away if it is complete already, or with ThenIo() for the blocking
+// ones. For the operations without a result, T is int, like for the AsyncTask
+// ones.
+template <typename T>
+class Future {
+  struct State {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool ready = false;
+    absl::optional<T> value;
+    std::exception_ptr exptr;
+    std::vector<std::function<void()>> continuations;
+  };
+
+ public:
+  Future() = default;
+
+  bool IsValid() const { return state_ != nullptr; }
+
+  bool IsReady() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->ready;
+  }
+
+  void Wait() const {
+    env::ScopedBlockingRegion blocking;
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->cv.wait(lock, [this] { return state_->ready; });
+  }
+
+  // Waits for the future and returns its value, or re-throws its exception.
+  const T& Get() const {
+    Wait();
+    if (state_->exptr != nullptr) {
+      std::rethrow_exception(state_->exptr);
+    }
+    return *state_->value;
+  }
+
+  // Calls fn once the future is complete, whatever its outcome. The function
+  // runs on the completing thread, so it must not block.
+  void OnReady(std::function<void(const Future<T>&)> fn) const {
+    Future<T> self = *this;
+    std::function<void()> continuation = [self, fn = std::move(fn)]() {
+      fn(self);
+    };
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      if (!state_->ready) {
+        state_->continuations.push_back(std::move(continuation));
+        return;
+      }
+    }
+    continuation();
+  }
+
+  // Returns the future of fn applied to the value of this one. The exception
+  // of this future, or the one thrown by fn, goes to the returned future.
+  template <typename F,
+            typename R = decltype(std::declval<F>()(std::declval<const T&>()))>
+  Future<R> Then(F fn) const {
+    Promise<R> promise;
+    Future<R> result = promise.GetFuture();
+    OnReady([promise, fn = std::move(fn)](const Future<T>& future) mutable {
+      if (future.state_->exptr != nullptr) {
+        promise.SetException(future.state_->exptr);
+        return;
+      }
+      try {
+        promise.SetValue(fn(*future.state_->value));
+      } catch (...) {
+        promise.SetException(std::current_exception());
+      }
+    });
+    return result;
+  }
+
+  // Same as Then(), but fn runs on the IO thread pool rather than on the
+  // completing thread, for the continuations which block.
+  template <typename F,
+            typename R = decltype(std::declval<F>()(std::declval<const T&>()))>
+  Future<R> ThenIo(F fn) const {
+    Promise<R> promise;
+    Future<R> result = promise.GetFuture();
+    OnReady([promise, fn = std::move(fn)](const Future<T>& future) mutable {
+      env::ScheduleIoClosure([promise, fn = std::move(fn), future]() mutable {
+        if (future.state_->exptr != nullptr) {
+          promise.SetException(future.state_->exptr);
+          return;
+        }
+        try {
+          promise.SetValue(fn(*future.state_->value));
+        } catch (...) {
+          promise.SetException(std::current_exception());
+        }
+      });
+    });
+    return result;
+  }
+
+ private:
+  friend class Promise<T>;
+
+  explicit Future(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+  std::shared_ptr<State> state_;
+};
+
+// The producer side of a Future. Copies share the same future, which must be
+// completed exactly once.
+template <typename T>
+class Promise {
+ public:
+  Promise() : state_(std::make_shared<typename Future<T>::State>()) {}
+
+  Future<T> GetFuture() const { return Future<T>(state_); }
+
+  void SetValue(T value) {
+    Complete([&]() { state_->value = std::move(value); });
+  }
+
+  void SetException(std::exception_ptr exptr) {
+    Complete([&]() { state_->exptr = std::move(exptr); });
+  }
+
+ private:
+  template <typename F>
+  void Complete(const F& set_fn) {
+    std::vector<std::function<void()>> continuations;
+    {
+      std::lock_guard<std::mutex> lock(state_->mutex);
+      set_fn();
+      state_->ready = true;
+      continuations.swap(state_->continuations);
+    }
+    state_->cv.notify_all();
+    for (auto& continuation : continuations) {
+      continuation();
+    }
+  }
+
+  std::shared_ptr<typename Future<T>::State> state_;
+};
+
+template <typename T>
+Future<T> MakeReadyFuture(T value) {
+  Promise<T> promise;
+  promise.SetValue(std::move(value));
+  return promise.GetFuture();
+}
+
+// Runs fn on the IO thread pool, returning the future of its result.
+template <typename F, typename R = decltype(std::declval<F>()())>
+Future<R> ScheduleIoFuture(F fn) {
+  Promise<R> promise;
+  Future<R> future = promise.GetFuture();
+  env::ScheduleIoClosure([promise, fn = std::move(fn)]() mutable {
+    try {
+      promise.SetValue(fn());
+    } catch (...) {
+      promise.SetException(std::current_exception());
+    }
+  });
+  return future;
+}
+
+// Returns a future which completes once all the futures did, with the first
+// exception among them, if any.
+template <typename T>
+Future<int> WhenAll(const std::vector<Future<T>>& futures) {
+  struct Join {
+    explicit Join(size_t count) : pending(count) {}
+
+    Promise<int> promise;
+    std::atomic<size_t> pending;
+    std::mutex mutex;
+    std::exception_ptr exptr;
+  };
+
+  auto join = std::make_shared<Join>(futures.size());
+  Future<int> result = join->promise.GetFuture();
+  if (futures.empty()) {
+    join->promise.SetValue(0);
+    return result;
+  }
+  for (auto& future : futures) {
+    future.OnReady([join](const Future<T>& done) {
+      try {
+        done.Get();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(join->mutex);
+        if (join->exptr == nullptr) {
+          join->exptr = std::current_exception();
+        }
+      }
+      if (join->pending.fetch_sub(1) == 1) {
+        if (join->exptr != nullptr) {
+          join->promise.SetException(join->exptr);
+        } else {
+          join->promise.SetValue(0);
+        }
+      }
+    });
+  }
+  return result;
+}
+
+}  // namespace util
+}  // namespace xla
+
+#endif  // XLA_CLIENT_FUTURE_H_
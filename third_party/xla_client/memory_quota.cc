@@ -0,0 +1,153 @@
+#include "tensorflow/compiler/xla/xla_client/memory_quota.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace xla {
+namespace memory_quota {
+namespace {
+
+struct DeviceState {
+  int64_t charged_bytes = 0;
+  size_t waiters = 0;
+};
+
+class Quota {
+ public:
+  Quota()
+      : quota_bytes_(sys_util::GetEnvInt("XLA_DEVICE_MEMORY_QUOTA_MB", 0) *
+                     1024 * 1024),
+        wait_ms_(sys_util::GetEnvInt("XLA_DEVICE_MEMORY_QUOTA_WAIT_MS", 60000)),
+        pressure_bytes_(static_cast<int64_t>(
+            quota_bytes_ *
+            sys_util::GetEnvDouble("XLA_DEVICE_MEMORY_QUOTA_PRESSURE", 0.9))) {
+  }
+
+  int64_t quota_bytes() const { return quota_bytes_; }
+
+  int64_t GetChargedBytes(const std::string& device) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = devices_.find(device);
+    return it != devices_.end() ? it->second.charged_bytes : 0;
+  }
+
+  void Acquire(const std::string& device, int64_t bytes) {
+    XLA_CHECK_LE(bytes, quota_bytes_)
+        << "An allocation of " << bytes << " bytes on " << device
+        << " exceeds the device memory quota of " << quota_bytes_ << " bytes";
+    std::unique_lock<std::mutex> lock(lock_);
+    DeviceState& state = devices_[device];
+    if (state.charged_bytes + bytes > quota_bytes_) {
+      std::function<void(const std::string&)> handler = pressure_handler_;
+      ++state.waiters;
+      if (handler != nullptr) {
+        lock.unlock();
+        handler(device);
+        lock.lock();
+      }
+      XLA_COUNTER("DeviceMemoryQuotaWaits", 1);
+      int64_t start = sys_util::NowNs();
+      bool fits =
+          cv_.wait_for(lock, std::chrono::milliseconds(wait_ms_), [&]() {
+            return state.charged_bytes + bytes <= quota_bytes_;
+          });
+      --state.waiters;
+      XLA_VALUE_METRIC("DeviceMemoryQuotaWaitTime", sys_util::NowNs() - start);
+      XLA_CHECK(fits) << "Device memory quota exceeded on " << device << ": "
+                      << state.charged_bytes << " bytes charged, "
+                      << bytes << " more requested, with a quota of "
+                      << quota_bytes_ << " bytes";
+    }
+    state.charged_bytes += bytes;
+  }
+
+  void Release(const std::string& device, int64_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      devices_[device].charged_bytes -= bytes;
+    }
+    cv_.notify_all();
+  }
+
+  bool UnderPressure(const std::string& device) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = devices_.find(device);
+    return it != devices_.end() && (it->second.waiters > 0 ||
+                                    it->second.charged_bytes > pressure_bytes_);
+  }
+
+  void SetPressureHandler(std::function<void(const std::string&)> handler) {
+    std::lock_guard<std::mutex> lock(lock_);
+    pressure_handler_ = std::move(handler);
+  }
+
+ private:
+  const int64_t quota_bytes_;
+  const int64_t wait_ms_;
+  const int64_t pressure_bytes_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::map<std::string, DeviceState> devices_;
+  std::function<void(const std::string&)> pressure_handler_;
+};
+
+Quota* GetQuota() {
+  static Quota* quota = new Quota();
+  return quota;
+}
+
+}  // namespace
+
+Charge::Charge(std::string device, int64_t bytes)
+    : device_(std::move(device)), bytes_(bytes) {}
+
+Charge::~Charge() { GetQuota()->Release(device_, bytes_); }
+
+bool IsEnabled() {
+  static const bool enabled = GetQuota()->quota_bytes() > 0;
+  return enabled;
+}
+
+int64_t GetQuotaBytes() { return GetQuota()->quota_bytes(); }
+
+int64_t GetChargedBytes(const std::string& device) {
+  return GetQuota()->GetChargedBytes(device);
+}
+
+std::vector<ChargePtr> Acquire(const std::string& device,
+                               absl::Span<const int64_t> bytes) {
+  std::vector<ChargePtr> charges;
+  if (!IsEnabled()) {
+    return charges;
+  }
+  int64_t total_bytes = 0;
+  for (auto size : bytes) {
+    total_bytes += size;
+  }
+  // The buffers are charged all at once, so that two allocations waiting for
+  // each other's releases cannot hold part of the quota.
+  GetQuota()->Acquire(device, total_bytes);
+  charges.reserve(bytes.size());
+  for (auto size : bytes) {
+    charges.push_back(std::make_shared<Charge>(device, size));
+  }
+  return charges;
+}
+
+bool UnderPressure(const std::string& device) {
+  return IsEnabled() && GetQuota()->UnderPressure(device);
+}
+
+void SetPressureHandler(std::function<void(const std::string&)> handler) {
+  GetQuota()->SetPressureHandler(std::move(handler));
+}
+
+}  // namespace memory_quota
+}  // namespace xla
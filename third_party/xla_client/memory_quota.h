@@ -0,0 +1,66 @@
+#ifndef XLA_CLIENT_MEMORY_QUOTA_H_
+#define XLA_CLIENT_MEMORY_QUOTA_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace xla {
+namespace memory_quota {
+
+// The bytes of a device buffer charged against the quota of its device. They
+// are returned to the quota when the last data object holding the buffer (and
+// so the charge) goes away.
+class Charge {
+ public:
+  Charge(std::string device, int64_t bytes);
+
+  ~Charge();
+
+  const std::string& device() const { return device_; }
+
+  int64_t bytes() const { return bytes_; }
+
+ private:
+  std::string device_;
+  int64_t bytes_;
+};
+
+using ChargePtr = std::shared_ptr<Charge>;
+
+// Whether the per process device memory quota is set, with
+// XLA_DEVICE_MEMORY_QUOTA_MB greater than zero.
+bool IsEnabled();
+
+// Returns the quota of every device, in bytes, or zero if disabled.
+int64_t GetQuotaBytes();
+
+// Returns the bytes currently charged on the device.
+int64_t GetChargedBytes(const std::string& device);
+
+// Charges the bytes of the buffers about to be allocated on the device. If
+// they do not fit within the quota, waits (up to
+// XLA_DEVICE_MEMORY_QUOTA_WAIT_MS milliseconds) for the charges of other
+// buffers to be returned, and throws if they still do not fit. Returns one
+// charge per size, or an empty vector if the quota is disabled.
+std::vector<ChargePtr> Acquire(const std::string& device,
+                               absl::Span<const int64_t> bytes);
+
+// Whether the charged bytes of the device went above the
+// XLA_DEVICE_MEMORY_QUOTA_PRESSURE fraction of the quota, or an allocation is
+// waiting for releases. The clients should then release the device buffers
+// right away, rather than batching their releases.
+bool UnderPressure(const std::string& device);
+
+// Sets the function called when an allocation of the device starts waiting,
+// which should flush the pending buffer releases of the clients.
+void SetPressureHandler(std::function<void(const std::string&)> handler);
+
+}  // namespace memory_quota
+}  // namespace xla
+
+#endif  // XLA_CLIENT_MEMORY_QUOTA_H_
@@ -0,0 +1,208 @@
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace xla {
+namespace memory_tracker {
+namespace {
+
+struct Entry {
+  Buffer buffer;
+  // Whether the data holds a buffer, which is not the case for the
+  // placeholders of the pending computation outputs.
+  bool live = false;
+};
+
+struct Event {
+  int64_t time_ns = 0;
+  std::string device;
+  std::string graph;
+  int64_t delta_bytes = 0;
+};
+
+const std::string& GraphName(const Event& event) {
+  static const std::string* uploads = new std::string("uploads");
+  return event.graph.empty() ? *uploads : event.graph;
+}
+
+class Tracker {
+ public:
+  Tracker()
+      : max_events_(
+            sys_util::GetEnvInt("XLA_MEMORY_TRACKER_EVENTS", 1000000)) {}
+
+  void RecordAllocation(const void* data, const std::string& device,
+                        int64_t bytes, const std::string& graph) {
+    std::lock_guard<std::mutex> lock(lock_);
+    AllocateLocked(&entries_[data], device, bytes, graph);
+  }
+
+  void RecordData(const void* data, const std::string& device,
+                  int64_t bytes) {
+    std::lock_guard<std::mutex> lock(lock_);
+    Entry& entry = entries_[data];
+    if (!entry.live) {
+      AllocateLocked(&entry, device, bytes, /*graph=*/"");
+    }
+  }
+
+  void SetOwner(const void* data, int64_t tensor_id) {
+    std::lock_guard<std::mutex> lock(lock_);
+    entries_[data].buffer.owner = tensor_id;
+  }
+
+  void RecordRelease(const void* data) {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = entries_.find(data);
+    if (it != entries_.end()) {
+      if (it->second.live) {
+        ReleaseLocked(&it->second);
+      }
+      entries_.erase(it);
+    }
+  }
+
+  std::vector<Buffer> GetLiveBuffers() {
+    std::vector<Buffer> buffers;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      for (auto& data_entry : entries_) {
+        if (data_entry.second.live) {
+          buffers.push_back(data_entry.second.buffer);
+        }
+      }
+    }
+    std::sort(buffers.begin(), buffers.end(),
+              [](const Buffer& b1, const Buffer& b2) {
+                return b1.bytes > b2.bytes;
+              });
+    return buffers;
+  }
+
+  std::string CreateTimelineTrace() {
+    std::deque<Event> events;
+    // The timeline starts from the bytes the dropped events left live.
+    std::map<std::string, std::map<std::string, int64_t>> device_bytes;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      events = events_;
+      device_bytes = dropped_bytes_;
+    }
+    std::stringstream ss;
+    ss << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i) {
+      const Event& event = events[i];
+      std::map<std::string, int64_t>& graph_bytes = device_bytes[event.device];
+      graph_bytes[GraphName(event)] += event.delta_bytes;
+      if (i > 0) {
+        ss << ",";
+      }
+      ss << "{\"name\":\"Memory " << event.device
+         << "\",\"ph\":\"C\",\"pid\":0,\"ts\":" << event.time_ns / 1000.0
+         << ",\"args\":{";
+      bool first = true;
+      for (auto& name_bytes : graph_bytes) {
+        if (!first) {
+          ss << ",";
+        }
+        first = false;
+        ss << "\"" << name_bytes.first << "\":" << name_bytes.second;
+      }
+      ss << "}}";
+    }
+    ss << "]}";
+    return ss.str();
+  }
+
+ private:
+  void AllocateLocked(Entry* entry, const std::string& device, int64_t bytes,
+                      const std::string& graph) {
+    if (entry->live) {
+      ReleaseLocked(entry);
+    }
+    entry->buffer.device = device;
+    entry->buffer.bytes = bytes;
+    entry->buffer.graph = graph;
+    entry->buffer.allocation_ns = sys_util::NowNs();
+    entry->live = true;
+    AddEvent(entry->buffer, bytes);
+  }
+
+  void ReleaseLocked(Entry* entry) {
+    AddEvent(entry->buffer, -entry->buffer.bytes);
+    entry->live = false;
+  }
+
+  void AddEvent(const Buffer& buffer, int64_t delta_bytes) {
+    events_.push_back(
+        {sys_util::NowNs(), buffer.device, buffer.graph, delta_bytes});
+    if (events_.size() > max_events_) {
+      const Event& event = events_.front();
+      dropped_bytes_[event.device][GraphName(event)] += event.delta_bytes;
+      events_.pop_front();
+    }
+  }
+
+  std::mutex lock_;
+  size_t max_events_;
+  std::unordered_map<const void*, Entry> entries_;
+  std::deque<Event> events_;
+  std::map<std::string, std::map<std::string, int64_t>> dropped_bytes_;
+};
+
+Tracker* GetTracker() {
+  static Tracker* tracker = new Tracker();
+  return tracker;
+}
+
+}  // namespace
+
+bool IsEnabled() {
+  static const bool enabled =
+      sys_util::GetEnvBool("XLA_MEMORY_TRACKER", false);
+  return enabled;
+}
+
+void RecordAllocation(const void* data, const std::string& device,
+                      int64_t bytes, const std::string& graph) {
+  if (IsEnabled()) {
+    GetTracker()->RecordAllocation(data, device, bytes, graph);
+  }
+}
+
+void RecordData(const void* data, const std::string& device, int64_t bytes) {
+  if (IsEnabled()) {
+    GetTracker()->RecordData(data, device, bytes);
+  }
+}
+
+void SetOwner(const void* data, int64_t tensor_id) {
+  if (IsEnabled()) {
+    GetTracker()->SetOwner(data, tensor_id);
+  }
+}
+
+void RecordRelease(const void* data) {
+  if (IsEnabled()) {
+    GetTracker()->RecordRelease(data);
+  }
+}
+
+std::vector<Buffer> GetLiveBuffers() {
+  return IsEnabled() ? GetTracker()->GetLiveBuffers() : std::vector<Buffer>();
+}
+
+std::string CreateTimelineTrace() {
+  return IsEnabled() ? GetTracker()->CreateTimelineTrace()
+                     : "{\"traceEvents\":[]}";
+}
+
+}  // namespace memory_tracker
+}  // namespace xla
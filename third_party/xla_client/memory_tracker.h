@@ -0,0 +1,55 @@
+#ifndef XLA_CLIENT_MEMORY_TRACKER_H_
+#define XLA_CLIENT_MEMORY_TRACKER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace xla {
+namespace memory_tracker {
+
+// A device buffer held by a computation client data object.
+struct Buffer {
+  std::string device;
+  int64_t bytes = 0;
+  // The unique ID of the tensor owning the data, or -1 if none.
+  int64_t owner = -1;
+  // The hash of the graph whose execution produced the buffer, or empty for
+  // the buffers uploaded from host tensors.
+  std::string graph;
+  int64_t allocation_ns = 0;
+};
+
+// Whether the allocations and releases of the device buffers get recorded,
+// with XLA_MEMORY_TRACKER set to 1.
+bool IsEnabled();
+
+// Records that the data object (a ComputationClient::Data) now holds a device
+// buffer of the given size. A data object getting assigned a new buffer
+// releases its previous one.
+void RecordAllocation(const void* data, const std::string& device,
+                      int64_t bytes, const std::string& graph);
+
+// Records the buffer of a data object which did not come from a recorded
+// execution, like an upload, unless the data object is already recorded.
+void RecordData(const void* data, const std::string& device, int64_t bytes);
+
+// Records the tensor owning the data object, whether or not its buffer has
+// been allocated yet.
+void SetOwner(const void* data, int64_t tensor_id);
+
+// Records that the data object went away, together with its buffer.
+void RecordRelease(const void* data);
+
+// Returns the buffers currently live, sorted by decreasing size.
+std::vector<Buffer> GetLiveBuffers();
+
+// Returns the timeline of the live bytes of every device, in the Chrome trace
+// event format (which the Perfetto and TensorBoard trace viewers load), with
+// the bytes of every device broken down by the graph which produced them.
+std::string CreateTimelineTrace();
+
+}  // namespace memory_tracker
+}  // namespace xla
+
+#endif  // XLA_CLIENT_MEMORY_TRACKER_H_
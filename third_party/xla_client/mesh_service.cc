@@ -11,19 +11,23 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <exception>
 #include <functional>
+#include <future>
 #include <iostream>
 #include <map>
 #include <mutex>
 #include <set>
 #include <unordered_map>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
 #include "tensorflow/compiler/xla/status.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.grpc.pb.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/nccl_distributed.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
@@ -107,9 +111,9 @@ class MeshServiceImpl : public grpc::MeshService::Service {
     void Complete(int64_t ordinal, std::string payload,
                   const std::set<int64_t>& replicas);
 
-    const std::map<int64_t, std::string>& Payloads() const {
-      return payloads_;
-    };
+    // Returns the response shared by all the participants, holding every
+    // distinct payload once. Must be called after a successful Wait().
+    const grpc::RendezvousResponse& Response();
 
    private:
     size_t count_;
@@ -119,6 +123,8 @@ class MeshServiceImpl : public grpc::MeshService::Service {
     std::atomic<size_t> release_count_;
     std::map<int64_t, std::string> payloads_;
     ::grpc::Status status_;
+    bool response_ready_ = false;
+    grpc::RendezvousResponse response_;
   };
 
   std::shared_ptr<RendezvousData> GetRendezvous(
@@ -168,6 +174,25 @@ void MeshServiceImpl::RendezvousData::Complete(
   mwait_.Done();
 }
 
+const grpc::RendezvousResponse& MeshServiceImpl::RendezvousData::Response() {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (!response_ready_) {
+    // Broadcast style exchanges have most payloads equal (typically empty), so
+    // sending them once cuts the response size from O(N) to O(1) payloads.
+    std::unordered_map<std::string, size_t> payload_indices;
+    for (auto& ordinal_payload : payloads_) {
+      auto it = payload_indices.emplace(ordinal_payload.second,
+                                        payload_indices.size());
+      if (it.second) {
+        response_.add_payloads(ordinal_payload.second);
+      }
+      response_.add_payload_indices(it.first->second);
+    }
+    response_ready_ = true;
+  }
+  return response_;
+}
+
 MeshServiceImpl::MeshServiceImpl(grpc::Config config) {
   configs_.emplace(0, std::move(config));
 }
@@ -204,17 +229,22 @@ MeshServiceImpl::MeshServiceImpl(grpc::Config config) {
   std::set<int64_t> replicas(request->replicas().begin(),
                              request->replicas().end());
   auto rendezvous = GetRendezvous(request->tag(), replicas);
-  rendezvous->Complete(request->ordinal(), request->payload(), replicas);
+  if (request->entries_size() > 0) {
+    for (auto& entry : request->entries()) {
+      rendezvous->Complete(entry.ordinal(), entry.payload(), replicas);
+    }
+  } else {
+    rendezvous->Complete(request->ordinal(), request->payload(), replicas);
+  }
   TF_VLOG(3) << "Entering rendezvous: ordinal=" << request->ordinal()
+             << ", entries=" << request->entries_size()
              << ", tag=" << request->tag() << ", peer=" << context->peer();
   ::grpc::Status status = rendezvous->Wait();
   TF_VLOG(3) << "Exiting rendezvous: ordinal=" << request->ordinal()
              << ", tag=" << request->tag() << ", peer=" << context->peer()
              << ", status=" << status;
   if (status.ok()) {
-    for (auto& ordinal_payload : rendezvous->Payloads()) {
-      response->add_payloads(ordinal_payload.second);
-    }
+    response->CopyFrom(rendezvous->Response());
   }
   ReleaseRendezvous(request->tag(), rendezvous);
   return status;
@@ -267,18 +297,143 @@ void MeshServiceImpl::ReleaseRendezvous(
   }
 }
 
+// Collects the rendezvous of the processes of a host, and joins the master
+// mesh service with a single request carrying all their payloads, so that the
+// master only sees one RPC per host.
+class MeshAggregatorImpl : public grpc::MeshService::Service {
+ public:
+  MeshAggregatorImpl(const std::string& upstream_address, size_t local_count);
+
+  ::grpc::Status Rendezvous(::grpc::ServerContext* context,
+                            const grpc::RendezvousRequest* request,
+                            grpc::RendezvousResponse* response) override;
+
+ private:
+  struct LocalRendezvous {
+    std::mutex lock;
+    std::condition_variable cv;
+    grpc::RendezvousRequest request;
+    bool done = false;
+    ::grpc::Status status;
+    grpc::RendezvousResponse response;
+    std::atomic<size_t> release_count{0};
+  };
+
+  std::shared_ptr<LocalRendezvous> GetRendezvous(const std::string& tag);
+
+  void ReleaseRendezvous(const std::string& tag,
+                         const std::shared_ptr<LocalRendezvous>& rendezvous);
+
+  size_t local_count_;
+  std::unique_ptr<grpc::MeshService::Stub> stub_;
+  std::mutex lock_;
+  std::unordered_map<std::string, std::shared_ptr<LocalRendezvous>>
+      rendezvous_map_;
+};
+
+MeshAggregatorImpl::MeshAggregatorImpl(const std::string& upstream_address,
+                                       size_t local_count)
+    : local_count_(local_count),
+      stub_(grpc::MeshService::NewStub(::grpc::CreateChannel(
+          upstream_address, ::grpc::InsecureChannelCredentials()))) {}
+
+::grpc::Status MeshAggregatorImpl::Rendezvous(
+    ::grpc::ServerContext* context, const grpc::RendezvousRequest* request,
+    grpc::RendezvousResponse* response) {
+  if (request->replicas_size() > 0 || request->entries_size() > 0) {
+    // Which local processes take part in an explicit replicas list is not
+    // known here, so those go straight to the master.
+    ::grpc::ClientContext upstream_context;
+    return stub_->Rendezvous(&upstream_context, *request, response);
+  }
+  auto rendezvous = GetRendezvous(request->tag());
+  std::unique_lock<std::mutex> lock(rendezvous->lock);
+  grpc::RendezvousEntry* entry = rendezvous->request.add_entries();
+  entry->set_ordinal(request->ordinal());
+  entry->set_payload(request->payload());
+  if (static_cast<size_t>(rendezvous->request.entries_size()) ==
+      local_count_) {
+    // The last local arrival joins the master rendezvous for the whole host.
+    rendezvous->request.set_tag(request->tag());
+    rendezvous->request.set_ordinal(request->ordinal());
+    rendezvous->request.set_payload("");
+    lock.unlock();
+    TF_VLOG(3) << "Forwarding host rendezvous: tag=" << request->tag()
+               << ", entries=" << local_count_;
+    ::grpc::ClientContext upstream_context;
+    ::grpc::Status status = stub_->Rendezvous(
+        &upstream_context, rendezvous->request, &rendezvous->response);
+    lock.lock();
+    rendezvous->status = status;
+    rendezvous->done = true;
+    rendezvous->cv.notify_all();
+  } else {
+    TF_VLOG(3) << "Entering host rendezvous: ordinal=" << request->ordinal()
+               << ", tag=" << request->tag() << ", peer=" << context->peer();
+    rendezvous->cv.wait(lock, [&]() { return rendezvous->done; });
+  }
+  ::grpc::Status status = rendezvous->status;
+  if (status.ok()) {
+    response->CopyFrom(rendezvous->response);
+  }
+  lock.unlock();
+  ReleaseRendezvous(request->tag(), rendezvous);
+  return status;
+}
+
+std::shared_ptr<MeshAggregatorImpl::LocalRendezvous>
+MeshAggregatorImpl::GetRendezvous(const std::string& tag) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = rendezvous_map_.find(tag);
+  if (it == rendezvous_map_.end()) {
+    it = rendezvous_map_.emplace(tag, std::make_shared<LocalRendezvous>())
+             .first;
+  }
+  return it->second;
+}
+
+void MeshAggregatorImpl::ReleaseRendezvous(
+    const std::string& tag,
+    const std::shared_ptr<LocalRendezvous>& rendezvous) {
+  if (rendezvous->release_count.fetch_add(1) == 0) {
+    std::lock_guard<std::mutex> lock(lock_);
+    rendezvous_map_.erase(tag);
+  }
+}
+
+::grpc::ServerBuilder* ConfigureServer(::grpc::ServerBuilder* builder,
+                                       const std::string& address) {
+  int64_t max_msg_size =
+      sys_util::GetEnvInt("XRT_MESH_MAX_MSGSIZE", 1024 * 1024 * 1024);
+  builder->SetMaxReceiveMessageSize(max_msg_size);
+  builder->SetMaxSendMessageSize(max_msg_size);
+  builder->AddListeningPort(address, ::grpc::InsecureServerCredentials());
+  return builder;
+}
+
+metrics::Metric* GetRendezvousMetric(const std::string& tag) {
+  static std::mutex* lock = new std::mutex();
+  static auto* tag_metrics =
+      new std::unordered_map<std::string, std::unique_ptr<metrics::Metric>>();
+  std::lock_guard<std::mutex> guard(*lock);
+  auto it = tag_metrics->find(tag);
+  if (it == tag_metrics->end()) {
+    it = tag_metrics
+             ->emplace(tag, absl::make_unique<metrics::Metric>(
+                                absl::StrCat("RendezvousTime_", tag),
+                                metrics::MetricFnTime))
+             .first;
+  }
+  return it->second.get();
+}
+
 }  // namespace
 
 struct MeshService::Impl {
   Impl(const std::string& address, grpc::Config config)
       : impl(std::move(config)) {
     ::grpc::ServerBuilder builder;
-    int64_t max_msg_size =
-        sys_util::GetEnvInt("XRT_MESH_MAX_MSGSIZE", 1024 * 1024 * 1024);
-    builder.SetMaxReceiveMessageSize(max_msg_size);
-    builder.SetMaxSendMessageSize(max_msg_size);
-    builder.AddListeningPort(address, ::grpc::InsecureServerCredentials());
-    builder.RegisterService(&impl);
+    ConfigureServer(&builder, address)->RegisterService(&impl);
     server = builder.BuildAndStart();
   }
 
@@ -296,30 +451,78 @@ void MeshService::Shutdown() {
   impl_->server->Wait();
 }
 
+struct MeshAggregator::Impl {
+  Impl(const std::string& address, const std::string& upstream_address,
+       size_t local_count)
+      : impl(upstream_address, local_count) {
+    ::grpc::ServerBuilder builder;
+    ConfigureServer(&builder, address)->RegisterService(&impl);
+    server = builder.BuildAndStart();
+  }
+
+  MeshAggregatorImpl impl;
+  std::unique_ptr<::grpc::Server> server;
+};
+
+MeshAggregator::MeshAggregator(const std::string& address,
+                               const std::string& upstream_address,
+                               size_t local_count)
+    : impl_(new Impl(address, upstream_address, local_count)) {}
+
+MeshAggregator::~MeshAggregator() {}
+
+void MeshAggregator::Shutdown() {
+  impl_->server->Shutdown();
+  impl_->server->Wait();
+}
+
 struct MeshClient::Impl {
-  explicit Impl(const std::string& address) : address(address) {
+  Impl(const std::string& address, const std::string& aggregator_address)
+      : address(address) {
     channel =
         ::grpc::CreateChannel(address, ::grpc::InsecureChannelCredentials());
     stub = grpc::MeshService::NewStub(channel);
+    if (!aggregator_address.empty()) {
+      rendezvous_channel = ::grpc::CreateChannel(
+          aggregator_address, ::grpc::InsecureChannelCredentials());
+      rendezvous_stub = grpc::MeshService::NewStub(rendezvous_channel);
+    }
+  }
+
+  grpc::MeshService::Stub* GetRendezvousStub() const {
+    return rendezvous_stub != nullptr ? rendezvous_stub.get() : stub.get();
   }
 
   std::shared_ptr<::grpc::Channel> channel;
   std::unique_ptr<grpc::MeshService::Stub> stub;
+  // The host aggregator the rendezvous go through, if any.
+  std::shared_ptr<::grpc::Channel> rendezvous_channel;
+  std::unique_ptr<grpc::MeshService::Stub> rendezvous_stub;
   std::string address;
+  // The NCCL UIDs already fetched from the master, keyed by the replica group
+  // signature. The master hands out a single UID per group for the lifetime
+  // of the service, so every graph using the same group can share it.
+  std::mutex nccl_uid_lock;
+  std::map<std::string, std::shared_future<std::string>> nccl_uids;
 };
 
 MeshClient* MeshClient::Get() {
   auto create_client = []() {
     std::string mesh_service_address =
         sys_util::GetEnvString("XRT_MESH_SERVICE_ADDRESS", "");
-    return !mesh_service_address.empty() ? new MeshClient(mesh_service_address)
-                                         : nullptr;
+    return !mesh_service_address.empty()
+               ? new MeshClient(mesh_service_address,
+                                sys_util::GetEnvString(
+                                    "XRT_MESH_AGGREGATOR_ADDRESS", ""))
+               : nullptr;
   };
   static MeshClient* client = create_client();
   return client;
 }
 
-MeshClient::MeshClient(const std::string& address) : impl_(new Impl(address)) {
+MeshClient::MeshClient(const std::string& address,
+                       const std::string& aggregator_address)
+    : impl_(new Impl(address, aggregator_address)) {
   int64_t connect_wait_seconds =
       sys_util::GetEnvInt("XRT_MESH_CONNECT_WAIT", 300);
   TF_LOG(INFO) << "Waiting to connect to client mesh master ("
@@ -328,6 +531,12 @@ MeshClient::MeshClient(const std::string& address) : impl_(new Impl(address)) {
       std::chrono::system_clock::now() +
       std::chrono::seconds(connect_wait_seconds)))
       << "Failed to connect to client mesh master: " << address;
+  if (impl_->rendezvous_channel != nullptr) {
+    XLA_CHECK(impl_->rendezvous_channel->WaitForConnected(
+        std::chrono::system_clock::now() +
+        std::chrono::seconds(connect_wait_seconds)))
+        << "Failed to connect to the host mesh aggregator";
+  }
 }
 
 MeshClient::~MeshClient() {}
@@ -371,20 +580,77 @@ std::vector<std::string> MeshClient::Rendezvous(
     request.add_replicas(replica);
   }
   TF_VLOG(3) << "Waiting for rendezvous: ordinal=" << ordinal << " tag=" << tag;
-  ::grpc::Status status = impl_->stub->Rendezvous(&context, request, &response);
+  ::grpc::Status status;
+  {
+    metrics::TimedSection timed(GetRendezvousMetric(tag));
+    status = impl_->GetRendezvousStub()->Rendezvous(&context, request,
+                                                     &response);
+  }
   TF_VLOG(3) << "Rendezvous wait complete: " << tag;
   if (!status.ok()) {
     XLA_ERROR() << "Failed to meet rendezvous '" << tag << "': " << status;
   }
   std::vector<std::string> rv_payloads;
-  for (auto& rv_payload : response.payloads()) {
-    rv_payloads.push_back(rv_payload);
+  if (response.payload_indices_size() > 0) {
+    for (auto index : response.payload_indices()) {
+      rv_payloads.push_back(response.payloads(index));
+    }
+  } else {
+    for (auto& rv_payload : response.payloads()) {
+      rv_payloads.push_back(rv_payload);
+    }
   }
   return rv_payloads;
 }
 
 std::string MeshClient::GetNcclUniqueUid(
     absl::Span<const int64_t> replicas) const {
+  std::string signature = absl::StrJoin(replicas, ",");
+  std::promise<std::string> promise;
+  std::shared_future<std::string> uid;
+  bool fetch = false;
+  {
+    std::lock_guard<std::mutex> lock(impl_->nccl_uid_lock);
+    auto it = impl_->nccl_uids.find(signature);
+    if (it != impl_->nccl_uids.end()) {
+      XLA_COUNTER("NcclUidCacheHit", 1);
+      uid = it->second;
+    } else {
+      uid = promise.get_future().share();
+      impl_->nccl_uids.emplace(signature, uid);
+      fetch = true;
+    }
+  }
+  if (!fetch) {
+    // Either cached, or being fetched by a concurrent caller.
+    return uid.get();
+  }
+  try {
+    promise.set_value(FetchNcclUniqueUid(replicas));
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> lock(impl_->nccl_uid_lock);
+      impl_->nccl_uids.erase(signature);
+    }
+    promise.set_exception(std::current_exception());
+  }
+  return uid.get();
+}
+
+void MeshClient::PrefetchNcclUniqueUid(std::vector<int64_t> replicas) const {
+  env::ScheduleIoClosure([this, replicas = std::move(replicas)]() {
+    try {
+      GetNcclUniqueUid(replicas);
+    } catch (const std::exception& ex) {
+      // The foreground fetch of the same group will retry and report it.
+      TF_VLOG(1) << "NCCL UID prefetch failed: " << ex.what();
+    }
+  });
+}
+
+std::string MeshClient::FetchNcclUniqueUid(
+    absl::Span<const int64_t> replicas) const {
+  XLA_COUNTER("NcclUidFetch", 1);
   ::grpc::ClientContext context;
   grpc::GetNcclUniqueUidRequest request;
   grpc::GetNcclUniqueUidResponse response;
@@ -26,12 +26,37 @@ class MeshService {
   std::unique_ptr<Impl> impl_;
 };
 
+// Per host aggregator of the rendezvous of the local processes, which joins the
+// master mesh service once per host.
+class MeshAggregator {
+  struct Impl;
+
+ public:
+  MeshAggregator(const std::string& address,
+                 const std::string& upstream_address, size_t local_count);
+
+  ~MeshAggregator();
+
+  void Shutdown();
+
+ private:
+  std::unique_ptr<Impl> impl_;
+};
+
 class MeshClient {
   struct Impl;
 
  public:
   static MeshClient* Get();
 
+  // Connects to the master mesh service at address, going through the host
+  // aggregator at aggregator_address for the rendezvous, if not empty. Most
+  // users want the process wide client returned by Get().
+  MeshClient(const std::string& address,
+             const std::string& aggregator_address);
+
+  ~MeshClient();
+
   const std::string& address() const;
 
   grpc::Config GetConfig(int ordinal) const;
@@ -42,12 +67,16 @@ class MeshClient {
                                       const std::string& payload,
                                       absl::Span<const int64_t> replicas) const;
 
+  // Returns the NCCL UID of the replica group, which is only fetched from the
+  // master the first time the group is seen by this process.
   std::string GetNcclUniqueUid(absl::Span<const int64_t> replicas) const;
 
- private:
-  MeshClient(const std::string& address);
+  // Fetches the NCCL UID of the replica group in the background, so that the
+  // first collective over the group does not wait for it.
+  void PrefetchNcclUniqueUid(std::vector<int64_t> replicas) const;
 
-  ~MeshClient();
+ private:
+  std::string FetchNcclUniqueUid(absl::Span<const int64_t> replicas) const;
 
   std::unique_ptr<Impl> impl_;
 };
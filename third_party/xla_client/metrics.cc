@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <cmath>
 #include <sstream>
+#include <unordered_map>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_split.h"
@@ -34,6 +35,10 @@ const std::vector<double>& GetPercentiles() {
   return *metrics_percentiles;
 }
 
+// The exponents of the doubles, shifted to make the bucket indices of the
+// positive values positive.
+constexpr int64_t kExponentBias = 1100;
+
 void EmitMetricInfo(const std::string& name, MetricData* data,
                     std::stringstream* ss) {
   double accumulator = 0.0;
@@ -59,18 +64,16 @@ void EmitMetricInfo(const std::string& name, MetricData* data,
     }
   }
 
+  // The percentiles cover all the samples, not just the retained ones.
+  Histogram histogram = data->GetHistogram();
   const std::vector<double>& metrics_percentiles = GetPercentiles();
-  std::sort(
-      samples.begin(), samples.end(),
-      [](const Sample& s1, const Sample& s2) { return s1.value < s2.value; });
   (*ss) << "  Percentiles: ";
   for (size_t i = 0; i < metrics_percentiles.size(); ++i) {
-    size_t index = metrics_percentiles[i] * samples.size();
     if (i > 0) {
       (*ss) << "; ";
     }
-    (*ss) << (metrics_percentiles[i] * 100.0)
-          << "%=" << data->Repr(samples[index].value);
+    (*ss) << (metrics_percentiles[i] * 100.0) << "%="
+          << data->Repr(histogram.Percentile(metrics_percentiles[i]));
   }
   (*ss) << std::endl;
 }
@@ -81,6 +84,35 @@ void EmitCounterInfo(const std::string& name, CounterData* data,
   (*ss) << "  Value: " << data->Value() << std::endl;
 }
 
+// Escapes a label value of the Prometheus text format.
+std::string PrometheusEscape(const std::string& value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+      escaped += c;
+    } else if (c == '\n') {
+      escaped += "\\n";
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+std::string PrometheusLabels(
+    const std::string& name,
+    const std::vector<std::pair<std::string, std::string>>& labels) {
+  std::stringstream ss;
+  ss << "{name=\"" << PrometheusEscape(name) << "\"";
+  for (auto& label : labels) {
+    ss << "," << label.first << "=\"" << PrometheusEscape(label.second)
+       << "\"";
+  }
+  ss << "}";
+  return ss.str();
+}
+
 }  // namespace
 
 MetricsArena* MetricsArena::Get() {
@@ -154,48 +186,273 @@ CounterData* MetricsArena::GetCounter(const std::string& name) {
   return it != counters_.end() ? it->second.get() : nullptr;
 }
 
+int64_t Histogram::BucketIndex(double value) {
+  if (value == 0.0 || !std::isfinite(value)) {
+    return 0;
+  }
+  int exponent = 0;
+  double mantissa = std::frexp(std::fabs(value), &exponent);
+  // The mantissa is within [0.5, 1).
+  int64_t sub_bucket = std::min<int64_t>(
+      static_cast<int64_t>((mantissa - 0.5) * 2.0 * kSubBuckets),
+      kSubBuckets - 1);
+  int64_t index = (exponent + kExponentBias) * kSubBuckets + sub_bucket + 1;
+  return value > 0.0 ? index : -index;
+}
+
+std::pair<double, double> Histogram::BucketBounds(int64_t index) {
+  if (index == 0) {
+    return {0.0, 0.0};
+  }
+  int64_t magnitude = std::abs(index) - 1;
+  int exponent = static_cast<int>(magnitude / kSubBuckets - kExponentBias);
+  int64_t sub_bucket = magnitude % kSubBuckets;
+  double lower = std::ldexp(0.5 + 0.5 * sub_bucket / kSubBuckets, exponent);
+  double upper =
+      std::ldexp(0.5 + 0.5 * (sub_bucket + 1) / kSubBuckets, exponent);
+  if (index > 0) {
+    return {lower, upper};
+  }
+  return {-upper, -lower};
+}
+
+void Histogram::Add(double value) {
+  if (count_ == 0) {
+    min_ = max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  buckets_[BucketIndex(value)] += 1;
+  count_ += 1;
+  sum_ += value;
+}
+
+void Histogram::Merge(const Histogram& other) {
+  if (other.count_ == 0) {
+    return;
+  }
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+  for (auto& index_count : other.buckets_) {
+    buckets_[index_count.first] += index_count.second;
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+double Histogram::Percentile(double fraction) const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  // Same rank as the one of the sorted samples, floor(fraction * count).
+  int64_t rank = std::min<int64_t>(fraction * count_, count_ - 1);
+  int64_t seen = 0;
+  for (auto& index_count : buckets_) {
+    seen += index_count.second;
+    if (seen > rank) {
+      std::pair<double, double> bounds = BucketBounds(index_count.first);
+      double value = 0.5 * (bounds.first + bounds.second);
+      return std::min(std::max(value, min_), max_);
+    }
+  }
+  return max_;
+}
+
 MetricData::MetricData(MetricReprFn repr_fn, size_t max_samples)
-    : repr_fn_(std::move(repr_fn)), samples_(max_samples) {}
+    : repr_fn_(std::move(repr_fn)),
+      max_samples_(max_samples),
+      threads_(std::make_shared<ThreadList>(max_samples)) {
+  static std::atomic<int64_t> next_id(0);
+  id_ = next_id++;
+}
+
+// The buffers a thread posted to, which get retired when the thread exits.
+class MetricData::ThreadSamplesMap {
+ public:
+  struct Entry {
+    ThreadSamples* samples;
+    std::weak_ptr<ThreadList> list;
+  };
+
+  ~ThreadSamplesMap() {
+    for (auto& id_entry : entries) {
+      std::shared_ptr<ThreadList> list = id_entry.second.list.lock();
+      if (list != nullptr) {
+        RetireThreadSamples(list.get(), id_entry.second.samples);
+      }
+    }
+    exited = true;
+  }
+
+  std::unordered_map<int64_t, Entry> entries;
+  // Stays set after the destruction, for the samples posted by the thread
+  // local destructors running after this one.
+  static thread_local bool exited;
+};
+
+thread_local bool MetricData::ThreadSamplesMap::exited = false;
+
+MetricData::ThreadSamples* MetricData::GetThreadSamples() {
+  static thread_local ThreadSamplesMap thread_samples;
+  if (TF_PREDICT_FALSE(ThreadSamplesMap::exited)) {
+    return nullptr;
+  }
+  auto it = thread_samples.entries.find(id_);
+  if (TF_PREDICT_TRUE(it != thread_samples.entries.end())) {
+    return it->second.samples;
+  }
+  auto samples = std::make_shared<ThreadSamples>();
+  {
+    std::lock_guard<std::mutex> lock(threads_->lock);
+    threads_->threads.push_back(samples);
+  }
+  thread_samples.entries.emplace(
+      id_, ThreadSamplesMap::Entry{samples.get(), threads_});
+  return samples.get();
+}
+
+void MetricData::RetireThreadSamples(ThreadList* list, ThreadSamples* thread) {
+  std::lock_guard<std::mutex> lock(list->lock);
+  {
+    std::lock_guard<std::mutex> thread_lock(thread->lock);
+    MergeThreadSamples(*thread, list->max_samples, &list->retired);
+  }
+  for (auto it = list->threads.begin(); it != list->threads.end(); ++it) {
+    if (it->get() == thread) {
+      list->threads.erase(it);
+      break;
+    }
+  }
+}
+
+void MetricData::MergeThreadSamples(const ThreadSamples& thread,
+                                    size_t max_samples, ThreadSamples* dest) {
+  dest->count += thread.count;
+  dest->accumulator += thread.accumulator;
+  dest->histogram.Merge(thread.histogram);
+  dest->samples.insert(dest->samples.end(), thread.samples.begin(),
+                       thread.samples.end());
+  // Only the most recent samples are retained, like in the thread buffers.
+  if (dest->samples.size() > max_samples) {
+    std::stable_sort(dest->samples.begin(), dest->samples.end(),
+                     [](const Sample& s1, const Sample& s2) {
+                       return s1.timestamp_ns < s2.timestamp_ns;
+                     });
+    dest->samples.erase(dest->samples.begin(),
+                        dest->samples.end() - max_samples);
+  }
+}
+
+void MetricData::ForEachThread(
+    const std::function<void(const ThreadSamples&)>& fn) const {
+  std::lock_guard<std::mutex> lock(threads_->lock);
+  fn(threads_->retired);
+  for (auto& thread : threads_->threads) {
+    std::lock_guard<std::mutex> thread_lock(thread->lock);
+    fn(*thread);
+  }
+}
 
 void MetricData::AddSample(int64_t timestamp_ns, double value) {
-  std::lock_guard<std::mutex> lock(lock_);
-  size_t position = count_ % samples_.size();
-  ++count_;
-  accumulator_ += value;
-  samples_[position] = Sample(timestamp_ns, value);
+  ThreadSamples* thread = GetThreadSamples();
+  if (TF_PREDICT_FALSE(thread == nullptr)) {
+    ThreadSamples exiting;
+    exiting.count = 1;
+    exiting.accumulator = value;
+    exiting.samples.emplace_back(timestamp_ns, value);
+    exiting.histogram.Add(value);
+    std::lock_guard<std::mutex> lock(threads_->lock);
+    MergeThreadSamples(exiting, max_samples_, &threads_->retired);
+    return;
+  }
+  std::lock_guard<std::mutex> lock(thread->lock);
+  if (thread->samples.size() < max_samples_) {
+    thread->samples.emplace_back(timestamp_ns, value);
+  } else {
+    thread->samples[thread->count % max_samples_] =
+        Sample(timestamp_ns, value);
+  }
+  ++thread->count;
+  thread->accumulator += value;
+  thread->histogram.Add(value);
 }
 
 double MetricData::Accumulator() const {
-  std::lock_guard<std::mutex> lock(lock_);
-  return accumulator_;
+  double accumulator = 0.0;
+  ForEachThread([&](const ThreadSamples& thread) {
+    accumulator += thread.accumulator;
+  });
+  return accumulator;
+}
+
+Histogram MetricData::GetHistogram() const {
+  Histogram histogram;
+  ForEachThread([&](const ThreadSamples& thread) {
+    histogram.Merge(thread.histogram);
+  });
+  return histogram;
 }
 
 size_t MetricData::TotalSamples() const {
-  std::lock_guard<std::mutex> lock(lock_);
-  return count_;
+  size_t total_samples = 0;
+  ForEachThread(
+      [&](const ThreadSamples& thread) { total_samples += thread.count; });
+  return total_samples;
+}
+
+size_t MetricData::ThreadBuffers() const {
+  std::lock_guard<std::mutex> lock(threads_->lock);
+  return threads_->threads.size();
 }
 
 std::vector<Sample> MetricData::Samples(double* accumulator,
                                         size_t* total_samples) const {
-  std::lock_guard<std::mutex> lock(lock_);
   std::vector<Sample> samples;
-  if (count_ <= samples_.size()) {
-    samples.insert(samples.end(), samples_.begin(), samples_.begin() + count_);
-  } else {
-    size_t position = count_ % samples_.size();
-    samples.insert(samples.end(), samples_.begin() + position, samples_.end());
-    samples.insert(samples.end(), samples_.begin(),
-                   samples_.begin() + position);
+  double total_accumulator = 0.0;
+  size_t count = 0;
+  ForEachThread([&](const ThreadSamples& thread) {
+    samples.insert(samples.end(), thread.samples.begin(),
+                   thread.samples.end());
+    total_accumulator += thread.accumulator;
+    count += thread.count;
+  });
+  // The merged samples keep the most recent ones across all the threads.
+  std::stable_sort(samples.begin(), samples.end(),
+                   [](const Sample& s1, const Sample& s2) {
+                     return s1.timestamp_ns < s2.timestamp_ns;
+                   });
+  if (samples.size() > max_samples_) {
+    samples.erase(samples.begin(), samples.end() - max_samples_);
   }
   if (accumulator != nullptr) {
-    *accumulator = accumulator_;
+    *accumulator = total_accumulator;
   }
   if (total_samples != nullptr) {
-    *total_samples = count_;
+    *total_samples = count;
   }
   return samples;
 }
 
+int64_t CounterData::Value() const {
+  int64_t value = 0;
+  for (auto& shard : shards_) {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+size_t CounterData::ShardIndex() {
+  static std::atomic<size_t> next_index(0);
+  static thread_local size_t index = next_index++ % kNumShards;
+  return index;
+}
+
 Metric::Metric(std::string name, MetricReprFn repr_fn, size_t max_samples)
     : name_(std::move(name)),
       repr_fn_(std::move(repr_fn)),
@@ -315,6 +572,41 @@ std::string CreateMetricReport() {
   return ss.str();
 }
 
+std::string CreatePrometheusReport(
+    const std::map<std::string, std::string>& labels) {
+  MetricsArena* arena = MetricsArena::Get();
+  std::vector<std::pair<std::string, std::string>> common_labels(
+      labels.begin(), labels.end());
+  const std::vector<double>& metrics_percentiles = GetPercentiles();
+  std::stringstream ss;
+  ss.precision(17);
+  ss << "# HELP xla_metric The samples of the metrics, in the unit of the "
+        "metric (nanoseconds for the times).\n";
+  ss << "# TYPE xla_metric summary\n";
+  arena->ForEachMetric([&](const std::string& name, MetricData* data) {
+    Histogram histogram = data->GetHistogram();
+    if (histogram.Count() > 0) {
+      for (double percentile : metrics_percentiles) {
+        auto quantile_labels = common_labels;
+        quantile_labels.emplace_back("quantile", absl::StrCat(percentile));
+        ss << "xla_metric" << PrometheusLabels(name, quantile_labels) << " "
+           << histogram.Percentile(percentile) << "\n";
+      }
+    }
+    std::string name_labels = PrometheusLabels(name, common_labels);
+    ss << "xla_metric_sum" << name_labels << " " << histogram.Sum() << "\n";
+    ss << "xla_metric_count" << name_labels << " " << histogram.Count()
+       << "\n";
+  });
+  ss << "# HELP xla_counter_total The values of the counters.\n";
+  ss << "# TYPE xla_counter_total counter\n";
+  arena->ForEachCounter([&](const std::string& name, CounterData* data) {
+    ss << "xla_counter_total" << PrometheusLabels(name, common_labels) << " "
+       << data->Value() << "\n";
+  });
+  return ss.str();
+}
+
 std::vector<std::string> GetMetricNames() {
   return MetricsArena::Get()->GetMetricNames();
 }
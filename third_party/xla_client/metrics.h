@@ -2,6 +2,7 @@
 #define XLA_CLIENT_METRICS_H_
 
 #include <atomic>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -26,8 +27,52 @@ struct Sample {
 
 using MetricReprFn = std::function<std::string(double)>;
 
+// A log-linear histogram, with kSubBuckets linear buckets within every power of
+// two, which bounds the relative error of the percentiles to 1 / kSubBuckets.
+// The counts, sum, minimum and maximum are exact, and the histograms of
+// different threads (or processes, through Buckets()) merge by adding up the
+// bucket counts.
+class Histogram {
+ public:
+  static constexpr int kSubBuckets = 32;
+
+  void Add(double value);
+
+  void Merge(const Histogram& other);
+
+  int64_t Count() const { return count_; }
+
+  double Sum() const { return sum_; }
+
+  double Min() const { return min_; }
+
+  double Max() const { return max_; }
+
+  // Returns the value below which the fraction of the samples falls, as the
+  // midpoint of its bucket, clamped within the minimum and maximum.
+  double Percentile(double fraction) const;
+
+  // The non empty buckets, sorted by value, as (index, count) pairs.
+  const std::map<int64_t, int64_t>& Buckets() const { return buckets_; }
+
+  // The (lower, upper) value range of the bucket with the given index, which
+  // includes the bound closest to zero.
+  static std::pair<double, double> BucketBounds(int64_t index);
+
+  static int64_t BucketIndex(double value);
+
+ private:
+  std::map<int64_t, int64_t> buckets_;
+  int64_t count_ = 0;
+  double sum_ = 0.0;
+  double min_ = 0.0;
+  double max_ = 0.0;
+};
+
 // Class used to collect time-stamped numeric samples. The samples are stored in
-// a circular buffer whose size can be configured at constructor time.
+// a circular buffer whose size can be configured at constructor time. Every
+// thread posts into a buffer of its own, so that the threads do not contend
+// with each other, and the buffers get merged when the samples are read.
 class MetricData {
  public:
   // Creates a new MetricData object with the internal circular buffer storing
@@ -48,28 +93,87 @@ class MetricData {
   // is not nullptr, it will receive the count of the posted values.
   std::vector<Sample> Samples(double* accumulator, size_t* total_samples) const;
 
+  // Returns the histogram of all the samples posted to the metric, beyond the
+  // ones the circular buffers retain.
+  Histogram GetHistogram() const;
+
   std::string Repr(double value) const { return repr_fn_(value); }
 
+  // Returns the number of the per thread buffers, one for every live thread
+  // which posted samples to the metric.
+  size_t ThreadBuffers() const;
+
  private:
-  mutable std::mutex lock_;
+  // The samples posted by one thread. Its lock is only ever contended by the
+  // readers.
+  struct ThreadSamples {
+    std::mutex lock;
+    size_t count = 0;
+    double accumulator = 0.0;
+    std::vector<Sample> samples;
+    Histogram histogram;
+  };
+
+  // The buffers of the live threads, and the samples of the exited ones merged
+  // together. It is shared with the thread local maps of the buffers, which
+  // only retire them if the metric is still around when their thread exits.
+  struct ThreadList {
+    explicit ThreadList(size_t max_samples) : max_samples(max_samples) {}
+
+    std::mutex lock;
+    size_t max_samples;
+    ThreadSamples retired;
+    std::vector<std::shared_ptr<ThreadSamples>> threads;
+  };
+
+  class ThreadSamplesMap;
+
+  // Returns the buffer of the calling thread, or nullptr if the thread is
+  // exiting.
+  ThreadSamples* GetThreadSamples();
+
+  // Merges the samples of an exited thread into the retired ones, and drops its
+  // buffer.
+  static void RetireThreadSamples(ThreadList* list, ThreadSamples* thread);
+
+  static void MergeThreadSamples(const ThreadSamples& thread,
+                                 size_t max_samples, ThreadSamples* dest);
+
+  // Calls fn with every thread buffer (the retired one included) locked.
+  void ForEachThread(const std::function<void(const ThreadSamples&)>& fn) const;
+
   MetricReprFn repr_fn_;
-  size_t count_ = 0;
-  std::vector<Sample> samples_;
-  double accumulator_ = 0.0;
+  size_t max_samples_;
+  // Identifies the metric within the thread local buffer maps, as addresses
+  // can be reused.
+  int64_t id_;
+  std::shared_ptr<ThreadList> threads_;
 };
 
 // Counters are a very lightweight form of metrics which do not need to track
-// sample time.
+// sample time. The value is split into shards on separate cache lines, with
+// every thread adding to one of them, so that the threads hitting the same
+// counter do not bounce its cache line.
 class CounterData {
  public:
-  CounterData() : value_(0) {}
-
-  void AddValue(int64_t value) { value_ += value; }
+  void AddValue(int64_t value) {
+    shards_[ShardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+  }
 
-  int64_t Value() const { return value_; }
+  int64_t Value() const;
 
  private:
-  std::atomic<int64_t> value_;
+  static constexpr size_t kNumShards = 16;
+  static constexpr size_t kCacheLineSize = 64;
+
+  struct Shard {
+    std::atomic<int64_t> value{0};
+    char padding[kCacheLineSize - sizeof(std::atomic<int64_t>)];
+  };
+
+  static size_t ShardIndex();
+
+  Shard shards_[kNumShards];
 };
 
 class MetricsArena {
@@ -188,6 +292,12 @@ class Counter {
 // Creates a report with the current metrics statistics.
 std::string CreateMetricReport();
 
+// Creates a report of the metrics and counters in the Prometheus text
+// exposition format, with the metrics as summaries of the percentiles of
+// XLA_METRICS_PERCENTILES, and the given labels on every sample.
+std::string CreatePrometheusReport(
+    const std::map<std::string, std::string>& labels);
+
 // Returns the currently registered metric names. Note that the list can grow
 // since metrics are usualy function intialized (they are static function
 // variables).
@@ -1,5 +1,7 @@
 #include "tensorflow/compiler/xla/xla_client/metrics_analysis.h"
 
+#include <algorithm>
+
 #include "absl/types/variant.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
@@ -17,6 +19,62 @@ float DivToFloat(std::ldiv_t val, std::int64_t denominator) {
   return val.quot + (float)val.rem / denominator;
 }
 
+// The recent steps, as retained by the circular buffers of the step metrics.
+struct StepWindow {
+  size_t steps = 0;
+  int64_t start_ns = 0;
+  // The host time between the steps, which traces the graphs, and the one
+  // within the step markers, which syncs them.
+  double tracing_ns = 0;
+  double sync_ns = 0;
+};
+
+// Sums the samples of the metric posted at or after since_ns.
+double SumSince(const std::string& name, int64_t since_ns,
+                size_t* count = nullptr) {
+  double sum = 0;
+  size_t samples = 0;
+  MetricData* metric = GetMetric(name);
+  if (metric != nullptr) {
+    for (const Sample& sample : metric->Samples(nullptr, nullptr)) {
+      if (sample.timestamp_ns >= since_ns) {
+        sum += sample.value;
+        ++samples;
+      }
+    }
+  }
+  if (count != nullptr) {
+    *count = samples;
+  }
+  return sum;
+}
+
+bool GetStepWindow(size_t min_steps, StepWindow* window) {
+  MetricData* tracing = GetMetric("StepTracingTime");
+  if (tracing == nullptr) {
+    return false;
+  }
+  std::vector<Sample> samples = tracing->Samples(nullptr, nullptr);
+  if (samples.size() < min_steps) {
+    return false;
+  }
+  window->steps = samples.size();
+  const Sample& first = samples.front();
+  window->start_ns = first.timestamp_ns - static_cast<int64_t>(first.value);
+  for (const Sample& sample : samples) {
+    window->tracing_ns += sample.value;
+  }
+  // The compilations of the window are not part of the steady state.
+  window->sync_ns = std::max(SumSince("StepSyncTime", window->start_ns) -
+                                 SumSince("CompileTime", window->start_ns),
+                             0.0);
+  return true;
+}
+
+std::string Percent(double value, double total) {
+  return absl::StrFormat("%.0f%%", total > 0 ? 100.0 * value / total : 0.0);
+}
+
 class MetricFrequency : public Analyzer {
  public:
   MetricFrequency(std::string metric_name, float frequency_threshold,
@@ -176,6 +234,126 @@ class UnloweredOp : public Analyzer {
   }
 };
 
+// The device idles while the host traces the next step, when the graphs of a
+// step execute in less time than the host takes to trace them and the host
+// never waits for the device.
+class HostBound : public Analyzer {
+ public:
+  explicit HostBound(size_t min_steps) : min_steps_(min_steps) {}
+
+  Analysis Run() override {
+    StepWindow window;
+    if (!GetStepWindow(min_steps_, &window)) {
+      return {Analysis::Symptom::kNormal};
+    }
+    double execute_ns = SumSince("GraphExecuteTime", window.start_ns);
+    double wait_ns = SumSince("DeviceLockWait", window.start_ns);
+    if (window.tracing_ns <= execute_ns || wait_ns > 0.1 * window.tracing_ns) {
+      return {Analysis::Symptom::kNormal};
+    }
+    return {
+        Analysis::Symptom::kHostBound,
+        absl::StrFormat(
+            "%s: Host bound steps: tracing takes %s per step while the graphs "
+            "execute in %s, so the device idles %s of the time.",
+            kAnalysisPrefix, MetricFnTime(window.tracing_ns / window.steps),
+            MetricFnTime(execute_ns / window.steps),
+            Percent(window.tracing_ns - execute_ns, window.tracing_ns)),
+        "Move the input pipeline off the training thread with "
+        "torch_xla.distributed.parallel_loader.MpDeviceLoader, drop the "
+        "Python work between the steps (logging, metrics, tensor printing), "
+        "or increase the batch size so that every graph does more work.",
+        {{"steps", window.steps},
+         {"tracing_ns", window.tracing_ns},
+         {"execute_ns", execute_ns},
+         {"wait_ns", wait_ns}}};
+  }
+
+ private:
+  size_t min_steps_;
+};
+
+// The device to host transfers block the host, and within a step they also
+// force the execution of the pending graph which produces the tensors.
+class TransferStall : public Analyzer {
+ public:
+  TransferStall(size_t min_steps, double threshold)
+      : min_steps_(min_steps), threshold_(threshold) {}
+
+  Analysis Run() override {
+    StepWindow window;
+    if (!GetStepWindow(min_steps_, &window)) {
+      return {Analysis::Symptom::kNormal};
+    }
+    size_t transfers = 0;
+    double transfer_ns =
+        SumSince("TransferFromServerTime", window.start_ns, &transfers);
+    double step_ns = window.tracing_ns + window.sync_ns;
+    if (transfer_ns <= threshold_ * step_ns) {
+      return {Analysis::Symptom::kNormal};
+    }
+    return {
+        Analysis::Symptom::kTransferStall,
+        absl::StrFormat(
+            "%s: Transfer stalls: %zu device to host transfers during %zu "
+            "steps block the host for %s of the step time.",
+            kAnalysisPrefix, transfers, window.steps,
+            Percent(transfer_ns, step_ns)),
+        "Avoid reading device tensors within the steps, like with .item(), "
+        ".cpu(), print() or Python conditions on tensors. Defer the reads to "
+        "after the step with torch_xla.core.xla_model.add_step_closure(), "
+        "and read the logged values every few steps only.",
+        {{"steps", window.steps},
+         {"transfers", transfers},
+         {"transfer_ns", transfer_ns},
+         {"step_ns", step_ns}}};
+  }
+
+ private:
+  size_t min_steps_;
+  double threshold_;
+};
+
+// The host waits at the tensor collection barrier for the device to be done
+// with the graphs in flight, before it can run the next one.
+class BarrierWait : public Analyzer {
+ public:
+  BarrierWait(size_t min_steps, double threshold)
+      : min_steps_(min_steps), threshold_(threshold) {}
+
+  Analysis Run() override {
+    StepWindow window;
+    if (!GetStepWindow(min_steps_, &window)) {
+      return {Analysis::Symptom::kNormal};
+    }
+    size_t waits = 0;
+    double wait_ns = SumSince("DeviceLockWait", window.start_ns, &waits);
+    double step_ns = window.tracing_ns + window.sync_ns;
+    if (wait_ns <= threshold_ * step_ns) {
+      return {Analysis::Symptom::kNormal};
+    }
+    return {
+        Analysis::Symptom::kBarrierWait,
+        absl::StrFormat(
+            "%s: Barrier waits: the host waits for the device %zu times "
+            "during %zu steps, for %s of the step time.",
+            kAnalysisPrefix, waits, window.steps, Percent(wait_ns, step_ns)),
+        "With about one wait per step the device is the bottleneck, and the "
+        "graphs are the ones to optimize. More waits come from the graphs "
+        "executed within the steps, by the tensor reads or the explicit "
+        "syncs, which serialize the host and the device: remove them or move "
+        "them to the step closures.",
+        {{"steps", window.steps},
+         {"waits", waits},
+         {"wait_ns", wait_ns},
+         {"step_ns", step_ns}}};
+  }
+
+ private:
+  size_t min_steps_;
+  double threshold_;
+};
+
 std::vector<Analyzer*>* GetAnalyzers() {
   static std::vector<Analyzer*>* analyzers = new std::vector<Analyzer*>{
       new MetricFrequency("CompileTime", 0.5f, 10),
@@ -183,6 +361,9 @@ std::vector<Analyzer*>* GetAnalyzers() {
       new MetricTime("CompileTime", 300e9),
       new MetricTime("ExecuteTime", 30e9),
       new UnloweredOp(),
+      new HostBound(10),
+      new TransferStall(10, 0.1),
+      new BarrierWait(10, 0.3),
       new XrtMetricFrequency({{"XrtTryFreeMemory", 0.1f},
                               {"XrtCompaction", 0.1f},
                               {"XrtExecutorEvict", 0.1f}},
@@ -193,14 +374,46 @@ std::vector<Analyzer*>* GetAnalyzers() {
 
 }  // namespace
 
-std::string CreatePerformanceReport() {
-  std::stringstream ss;
+const char* SymptomName(Analysis::Symptom symptom) {
+  switch (symptom) {
+    case Analysis::Symptom::kNormal:
+      return "normal";
+    case Analysis::Symptom::kMetricTooFrequent:
+      return "metric_too_frequent";
+    case Analysis::Symptom::kMetricTooSlow:
+      return "metric_too_slow";
+    case Analysis::Symptom::kUnloweredOp:
+      return "unlowered_op";
+    case Analysis::Symptom::kHostBound:
+      return "host_bound";
+    case Analysis::Symptom::kTransferStall:
+      return "transfer_stall";
+    case Analysis::Symptom::kBarrierWait:
+      return "barrier_wait";
+  }
+  return "unknown";
+}
+
+std::vector<Analysis> RunPerformanceAnalysis() {
+  std::vector<Analysis> results;
   std::vector<Analyzer*>* analyzers = GetAnalyzers();
   for (auto const& analyzer : *analyzers) {
     Analysis result = analyzer->Run();
     if (result.symptom != Analysis::Symptom::kNormal) {
-      ss << result.repr << std::endl;
+      results.push_back(std::move(result));
+    }
+  }
+  return results;
+}
+
+std::string CreatePerformanceReport() {
+  std::stringstream ss;
+  for (auto& result : RunPerformanceAnalysis()) {
+    ss << result.repr;
+    if (!result.remediation.empty()) {
+      ss << " " << result.remediation;
     }
+    ss << std::endl;
   }
   return ss.str();
 }
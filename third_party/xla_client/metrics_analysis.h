@@ -2,7 +2,9 @@
 #define XLA_CLIENT_METRICS_ANALYSIS_H_
 
 #include <iostream>
+#include <map>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace xla {
@@ -15,6 +17,9 @@ namespace metrics {
 // - Frequent XLA->CPU transfers
 // - Device HBM to host RAM swapping and HBM defragmentation
 // - Unlowered aten:: ops
+// - Host bound steps, where the device idles while the host traces
+// - Synchronous device to host transfers within the steps
+// - Waits of the host for the device at the tensor collection barrier
 
 struct Analysis {
   enum class Symptom {
@@ -22,16 +27,32 @@ struct Analysis {
     kMetricTooFrequent,
     kMetricTooSlow,
     kUnloweredOp,
+    kHostBound,
+    kTransferStall,
+    kBarrierWait,
   };
 
   Analysis() = default;
   Analysis(Symptom symptom) : symptom(symptom) {}
   Analysis(Symptom symptom, std::string repr) : symptom(symptom), repr(repr) {}
+  Analysis(Symptom symptom, std::string repr, std::string remediation,
+           std::map<std::string, double> values)
+      : symptom(symptom),
+        repr(std::move(repr)),
+        remediation(std::move(remediation)),
+        values(std::move(values)) {}
 
   Symptom symptom;
   std::string repr;
+  // What to change in the program, if the analyzer knows.
+  std::string remediation;
+  // The quantities the diagnosis is based on, by name, with the times in
+  // nanoseconds.
+  std::map<std::string, double> values;
 };
 
+const char* SymptomName(Analysis::Symptom symptom);
+
 class Analyzer {
  public:
   virtual Analysis Run() = 0;
@@ -39,6 +60,9 @@ class Analyzer {
 
 std::string CreatePerformanceReport();
 
+// The analyses behind CreatePerformanceReport(), without the normal ones.
+std::vector<Analysis> RunPerformanceAnalysis();
+
 }  // namespace metrics
 }  // namespace xla
 
@@ -2,6 +2,9 @@
 
 #include <sstream>
 
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
@@ -74,5 +77,109 @@ std::string CreateMetricReport() {
   return metrics::CreateMetricReport() + CreateXrtMetricReport();
 }
 
+MetricsSnapshot TakeSnapshot() {
+  MetricsSnapshot snapshot;
+  for (auto& name : metrics::GetCounterNames()) {
+    metrics::CounterData* counter = metrics::GetCounter(name);
+    if (counter != nullptr) {
+      snapshot.counters[name] = counter->Value();
+    }
+  }
+  for (auto& name : metrics::GetMetricNames()) {
+    metrics::MetricData* metric = metrics::GetMetric(name);
+    if (metric != nullptr) {
+      MetricsSnapshot::MetricValue& value = snapshot.metrics[name];
+      value.total_samples = metric->TotalSamples();
+      value.accumulator = metric->Accumulator();
+    }
+  }
+  return snapshot;
+}
+
+MetricsDelta DiffSnapshots(const MetricsSnapshot& before,
+                           const MetricsSnapshot& after) {
+  MetricsDelta delta;
+  for (auto& name_value : after.counters) {
+    int64_t change =
+        name_value.second - util::FindOr(before.counters, name_value.first, 0);
+    if (change != 0) {
+      delta.counters[name_value.first] = change;
+      // The counters of the CPU fallbacks are named after the ATen operators.
+      if (absl::StartsWith(name_value.first, "aten::")) {
+        delta.cpu_fallbacks += change;
+      }
+    }
+  }
+  for (auto& name_value : after.metrics) {
+    MetricsSnapshot::MetricValue change = name_value.second;
+    auto it = before.metrics.find(name_value.first);
+    if (it != before.metrics.end()) {
+      change.total_samples -= it->second.total_samples;
+      change.accumulator -= it->second.accumulator;
+    }
+    if (change.total_samples != 0) {
+      delta.metrics[name_value.first] = change;
+    }
+  }
+  auto samples = [&](const std::string& name) -> int64_t {
+    auto it = delta.metrics.find(name);
+    return it != delta.metrics.end() ? it->second.total_samples : 0;
+  };
+  auto accumulator = [&](const std::string& name) -> int64_t {
+    auto it = delta.metrics.find(name);
+    return it != delta.metrics.end()
+               ? static_cast<int64_t>(it->second.accumulator)
+               : 0;
+  };
+  delta.compiles = samples("CompileTime");
+  delta.executions = samples("ExecuteTime") +
+                     samples("ExecuteReplicatedTime") +
+                     samples("ExecuteParallelTime") +
+                     samples("ExecuteChainedTime");
+  delta.transfers_to_server = samples("TransferToServerTime");
+  delta.transfers_from_server = samples("TransferFromServerTime");
+  delta.bytes_to_server = accumulator("OutboundData");
+  delta.bytes_from_server = accumulator("InboundData");
+  return delta;
+}
+
+int64_t GetGateValue(const MetricsDelta& delta, const std::string& name) {
+  static const std::map<std::string, int64_t MetricsDelta::*>* const
+      summary_fields = new std::map<std::string, int64_t MetricsDelta::*>({
+          {"compiles", &MetricsDelta::compiles},
+          {"executions", &MetricsDelta::executions},
+          {"transfers_to_server", &MetricsDelta::transfers_to_server},
+          {"transfers_from_server", &MetricsDelta::transfers_from_server},
+          {"cpu_fallbacks", &MetricsDelta::cpu_fallbacks},
+          {"bytes_to_server", &MetricsDelta::bytes_to_server},
+          {"bytes_from_server", &MetricsDelta::bytes_from_server},
+      });
+  auto field_it = summary_fields->find(name);
+  if (field_it != summary_fields->end()) {
+    return delta.*(field_it->second);
+  }
+  auto counter_it = delta.counters.find(name);
+  if (counter_it != delta.counters.end()) {
+    return counter_it->second;
+  }
+  auto metric_it = delta.metrics.find(name);
+  return metric_it != delta.metrics.end() ? metric_it->second.total_samples
+                                          : 0;
+}
+
+std::vector<std::string> CheckGates(
+    const MetricsDelta& delta, const std::map<std::string, int64_t>& limits) {
+  std::vector<std::string> violations;
+  for (auto& name_limit : limits) {
+    int64_t value = GetGateValue(delta, name_limit.first);
+    if (value > name_limit.second) {
+      violations.push_back(absl::StrCat(name_limit.first, " changed by ", value,
+                                        ", above the limit of ",
+                                        name_limit.second));
+    }
+  }
+  return violations;
+}
+
 }  // namespace metrics_reader
 }  // namespace xla
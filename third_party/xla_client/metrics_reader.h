@@ -1,14 +1,64 @@
 #ifndef XLA_CLIENT_METRICS_READER_H_
 #define XLA_CLIENT_METRICS_READER_H_
 
+#include <map>
 #include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/types.h"
 
 namespace xla {
 namespace metrics_reader {
 
+// The values of all the counters, and the sample counts and accumulators of
+// all the metrics, at a point in time.
+struct MetricsSnapshot {
+  struct MetricValue {
+    int64_t total_samples = 0;
+    double accumulator = 0.0;
+  };
+
+  std::map<std::string, int64_t> counters;
+  std::map<std::string, MetricValue> metrics;
+};
+
+// The changes between two snapshots. Only the counters and metrics which
+// changed are listed, and the metric values are the count and the sum of the
+// new samples.
+struct MetricsDelta {
+  std::map<std::string, int64_t> counters;
+  std::map<std::string, MetricsSnapshot::MetricValue> metrics;
+  // The summary of the costs most regressions show up in.
+  int64_t compiles = 0;
+  int64_t executions = 0;
+  int64_t transfers_to_server = 0;
+  int64_t transfers_from_server = 0;
+  int64_t cpu_fallbacks = 0;
+  int64_t bytes_to_server = 0;
+  int64_t bytes_from_server = 0;
+};
+
 // Creates a report with the current metrics statistics.
 std::string CreateMetricReport();
 
+MetricsSnapshot TakeSnapshot();
+
+MetricsDelta DiffSnapshots(const MetricsSnapshot& before,
+                           const MetricsSnapshot& after);
+
+// Returns the value of the delta which the gate name refers to: one of the
+// summary fields ("compiles", "executions", "transfers_to_server",
+// "transfers_from_server", "cpu_fallbacks", "bytes_to_server" and
+// "bytes_from_server"), else the change of the counter, else the number of
+// new samples of the metric, with that name.
+int64_t GetGateValue(const MetricsDelta& delta, const std::string& name);
+
+// Checks the delta against the maximum values of the gates, by gate name (see
+// GetGateValue()). Returns a message for every exceeded gate, or an empty
+// vector if all of them hold.
+std::vector<std::string> CheckGates(
+    const MetricsDelta& delta, const std::map<std::string, int64_t>& limits);
+
 }  // namespace metrics_reader
 }  // namespace xla
 
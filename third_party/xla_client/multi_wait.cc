@@ -3,6 +3,8 @@
 #include <chrono>
 #include <exception>
 
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+
 namespace xla {
 namespace util {
 
@@ -19,6 +21,7 @@ void MultiWait::Done() {
 }
 
 void MultiWait::Wait() {
+  env::ScopedBlockingRegion blocking;
   std::unique_lock<std::mutex> lock(mutex_);
   cv_.wait(lock, [this] { return completed_count_ >= count_; });
   if (exptr_ != nullptr) {
@@ -27,6 +30,7 @@ void MultiWait::Wait() {
 }
 
 void MultiWait::Wait(double wait_seconds) {
+  env::ScopedBlockingRegion blocking;
   std::unique_lock<std::mutex> lock(mutex_);
   if (!cv_.wait_for(lock, std::chrono::duration<double>(wait_seconds),
                     [this] { return completed_count_ >= count_; })) {
@@ -0,0 +1,198 @@
+#include "tensorflow/compiler/xla/xla_client/numa_topology.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace xla {
+namespace numa {
+namespace {
+
+bool ReadSysfsLine(const std::string& path, std::string* line) {
+  std::ifstream file(path);
+  return static_cast<bool>(std::getline(file, *line));
+}
+
+std::vector<std::vector<int>> LoadNodeCpus() {
+  std::vector<std::vector<int>> node_cpus;
+  std::string online;
+  if (ReadSysfsLine("/sys/devices/system/node/online", &online)) {
+    for (int node : ParseCpuList(online)) {
+      std::string cpulist;
+      if (ReadSysfsLine(absl::StrCat("/sys/devices/system/node/node", node,
+                                     "/cpulist"),
+                        &cpulist)) {
+        node_cpus.resize(std::max<size_t>(node_cpus.size(), node + 1));
+        node_cpus[node] = ParseCpuList(cpulist);
+      }
+    }
+  }
+  if (node_cpus.empty()) {
+    node_cpus.emplace_back();
+    for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+      node_cpus.back().push_back(cpu);
+    }
+  }
+  return node_cpus;
+}
+
+std::vector<int> LoadDeviceNodes() {
+  std::vector<int> device_nodes;
+  std::string nodes = sys_util::GetEnvString("XLA_DEVICE_NUMA_NODES", "");
+  if (!nodes.empty()) {
+    for (absl::string_view node : absl::StrSplit(nodes, ',')) {
+      int value = -1;
+      XLA_CHECK(absl::SimpleAtoi(node, &value))
+          << "Invalid XLA_DEVICE_NUMA_NODES: " << nodes;
+      device_nodes.push_back(value);
+    }
+    return device_nodes;
+  }
+  // The TPU chips show up as accel<N> devices, whose PCIe device has the
+  // node its slot is attached to.
+  for (int ordinal = 0;; ++ordinal) {
+    std::string path =
+        absl::StrCat("/sys/class/accel/accel", ordinal, "/device/numa_node");
+    std::string node;
+    if (!ReadSysfsLine(path, &node)) {
+      break;
+    }
+    int value = -1;
+    if (!absl::SimpleAtoi(node, &value)) {
+      value = -1;
+    }
+    device_nodes.push_back(value);
+  }
+  return device_nodes;
+}
+
+}  // namespace
+
+const Topology* Topology::Get() {
+  static const Topology* topology = []() {
+    Topology* topology = new Topology(LoadNodeCpus(), LoadDeviceNodes());
+    if (IsAffinityEnabled()) {
+      TF_LOG(INFO) << topology->Report();
+    } else {
+      TF_VLOG(1) << topology->Report();
+    }
+    return topology;
+  }();
+  return topology;
+}
+
+Topology::Topology(std::vector<std::vector<int>> node_cpus,
+                   std::vector<int> device_nodes)
+    : node_cpus_(std::move(node_cpus)), device_nodes_(std::move(device_nodes)) {
+  for (size_t node = 0; node < node_cpus_.size(); ++node) {
+    for (int cpu : node_cpus_[node]) {
+      cpu_nodes_.resize(std::max<size_t>(cpu_nodes_.size(), cpu + 1), -1);
+      cpu_nodes_[cpu] = node;
+    }
+  }
+  for (auto& node : device_nodes_) {
+    if (node >= static_cast<int>(node_cpus_.size()) ||
+        (node >= 0 && node_cpus_[node].empty())) {
+      node = -1;
+    }
+  }
+}
+
+int Topology::GetCpuNode(int cpu) const {
+  return cpu >= 0 && cpu < static_cast<int>(cpu_nodes_.size())
+             ? cpu_nodes_[cpu]
+             : -1;
+}
+
+int Topology::GetDeviceNode(const std::string& device) const {
+  size_t pos = device.rfind(':');
+  int ordinal = -1;
+  if (pos == std::string::npos ||
+      !absl::SimpleAtoi(absl::string_view(device).substr(pos + 1), &ordinal) ||
+      ordinal < 0 || ordinal >= static_cast<int>(device_nodes_.size())) {
+    return -1;
+  }
+  return device_nodes_[ordinal];
+}
+
+std::string Topology::Report() const {
+  std::stringstream ss;
+  ss << "NUMA topology: " << node_cpus_.size() << " nodes, "
+     << cpu_nodes_.size() << " CPUs, affinity "
+     << (IsAffinityEnabled() ? "enabled" : "disabled") << "\n";
+  for (size_t node = 0; node < node_cpus_.size(); ++node) {
+    if (node_cpus_[node].empty()) {
+      continue;
+    }
+    ss << "  Node " << node << ": CPUs " << node_cpus_[node].front() << "-"
+       << node_cpus_[node].back() << " (" << node_cpus_[node].size() << ")";
+    std::vector<int> ordinals;
+    for (size_t ordinal = 0; ordinal < device_nodes_.size(); ++ordinal) {
+      if (device_nodes_[ordinal] == static_cast<int>(node)) {
+        ordinals.push_back(ordinal);
+      }
+    }
+    if (!ordinals.empty()) {
+      ss << ", devices " << absl::StrJoin(ordinals, ",");
+    }
+    ss << "\n";
+  }
+  return ss.str();
+}
+
+bool IsAffinityEnabled() {
+  static const bool enabled = sys_util::GetEnvBool("XLA_NUMA_AFFINITY", false);
+  return enabled;
+}
+
+bool PinCurrentThread(int node) {
+  const Topology* topology = Topology::Get();
+  if (node < 0 || node >= static_cast<int>(topology->GetNumNodes()) ||
+      topology->GetNodeCpus(node).empty()) {
+    return false;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  for (int cpu : topology->GetNodeCpus(node)) {
+    CPU_SET(cpu, &cpus);
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0;
+}
+
+int GetCurrentNode() { return Topology::Get()->GetCpuNode(sched_getcpu()); }
+
+std::vector<int> ParseCpuList(const std::string& list) {
+  std::vector<int> cpus;
+  for (absl::string_view range :
+       absl::StrSplit(absl::StripAsciiWhitespace(list), ',',
+                      absl::SkipEmpty())) {
+    std::vector<absl::string_view> bounds = absl::StrSplit(range, '-');
+    int first = 0;
+    int last = 0;
+    XLA_CHECK(absl::SimpleAtoi(bounds[0], &first)) << "Invalid list: " << list;
+    last = first;
+    if (bounds.size() > 1) {
+      XLA_CHECK(absl::SimpleAtoi(bounds[1], &last)) << "Invalid list: " << list;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+}  // namespace numa
+}  // namespace xla
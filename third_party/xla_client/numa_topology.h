@@ -0,0 +1,66 @@
+#ifndef XLA_CLIENT_NUMA_TOPOLOGY_H_
+#define XLA_CLIENT_NUMA_TOPOLOGY_H_
+
+#include <string>
+#include <vector>
+
+namespace xla {
+namespace numa {
+
+// The NUMA nodes of the host, and their CPUs, as reported by sysfs. Hosts
+// without NUMA information have a single node with all the CPUs.
+class Topology {
+ public:
+  // Returns the topology of the host, logging its report on the first call
+  // (at INFO level if XLA_NUMA_AFFINITY is set, at VLOG level 1 otherwise).
+  static const Topology* Get();
+
+  Topology(std::vector<std::vector<int>> node_cpus,
+           std::vector<int> device_nodes);
+
+  size_t GetNumNodes() const { return node_cpus_.size(); }
+
+  const std::vector<int>& GetNodeCpus(int node) const {
+    return node_cpus_.at(node);
+  }
+
+  size_t GetNumCpus() const { return cpu_nodes_.size(); }
+
+  // Returns the node of the CPU, or -1 if unknown.
+  int GetCpuNode(int cpu) const;
+
+  // Returns the node local to the device (by its ordinal, so that "TPU:3" and
+  // "/job:localservice/replica:0/task:0/device:TPU:3" map the same), or -1 if
+  // unknown. The device nodes come from XLA_DEVICE_NUMA_NODES, a comma
+  // separated list of nodes by device ordinal, or else from the sysfs entries
+  // of the accelerators.
+  int GetDeviceNode(const std::string& device) const;
+
+  std::string Report() const;
+
+ private:
+  std::vector<std::vector<int>> node_cpus_;
+  std::vector<int> cpu_nodes_;
+  std::vector<int> device_nodes_;
+};
+
+// Whether the client threads and the staging buffers are placed by NUMA node,
+// as set by XLA_NUMA_AFFINITY. Without it, the functions below still work,
+// but the thread pools and the staging buffer pool do not use them.
+bool IsAffinityEnabled();
+
+// Pins the calling thread to the CPUs of the node. Returns false if the node
+// is unknown or the affinity could not be set.
+bool PinCurrentThread(int node);
+
+// Returns the node of the CPU the calling thread is running on, or -1 if
+// unknown.
+int GetCurrentNode();
+
+// Parses a sysfs CPU (or node) list, like "0-3,8,10-11".
+std::vector<int> ParseCpuList(const std::string& list);
+
+}  // namespace numa
+}  // namespace xla
+
+#endif  // XLA_CLIENT_NUMA_TOPOLOGY_H_
@@ -0,0 +1,54 @@
+#include "tensorflow/compiler/xla/xla_client/outfeed_listener.h"
+
+#include <algorithm>
+
+#include "absl/memory/memory.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace xla {
+
+OutfeedListener::OutfeedListener(ComputationClient* client,
+                                 ShapeResolver resolver, Dispatcher dispatcher)
+    : client_(client),
+      resolver_(std::move(resolver)),
+      dispatcher_(std::move(dispatcher)) {}
+
+OutfeedListener::~OutfeedListener() {
+  for (auto& thread : threads_) {
+    thread->detach();
+  }
+}
+
+void OutfeedListener::Listen(const std::string& device) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (std::find(devices_.begin(), devices_.end(), device) != devices_.end()) {
+    return;
+  }
+  devices_.push_back(device);
+  threads_.push_back(
+      absl::make_unique<std::thread>([this, device]() { Run(device); }));
+  TF_VLOG(1) << "Listening to the outfeed of " << device;
+}
+
+void OutfeedListener::Run(const std::string& device) {
+  static const Shape* header_shape =
+      new Shape(ShapeUtil::MakeShape(PrimitiveType::S32, {}));
+  while (true) {
+    try {
+      Literal header = client_->TransferFromOutfeed(device, *header_shape);
+      int64_t id = header.Get<int32_t>({});
+      Literal payload = client_->TransferFromOutfeed(device, resolver_(id));
+      XLA_COUNTER("OutfeedPayloads", 1);
+      dispatcher_(device, id, std::move(payload));
+    } catch (const std::exception& ex) {
+      TF_LOG(ERROR) << "Outfeed listener of " << device
+                    << " stopped: " << ex.what();
+      return;
+    }
+  }
+}
+
+}  // namespace xla
@@ -0,0 +1,53 @@
+#ifndef XLA_CLIENT_OUTFEED_LISTENER_H_
+#define XLA_CLIENT_OUTFEED_LISTENER_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tensorflow/compiler/xla/literal.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+
+namespace xla {
+
+// Reads the outfeeds of the devices on threads of their own, and dispatches
+// the payloads to their receivers. Every payload is preceded by a S32 scalar
+// header, within the same outfeed stream, holding the ID of its receiver. The
+// computations must keep the header and payload outfeeds of a receiver next to
+// each other, by chaining all their outfeeds through a single token.
+class OutfeedListener {
+ public:
+  // Returns the shape of the payloads of a receiver.
+  using ShapeResolver = std::function<Shape(int64_t id)>;
+  // Called on the listener thread of the device, with the payload.
+  using Dispatcher = std::function<void(const std::string& device, int64_t id,
+                                        Literal payload)>;
+
+  OutfeedListener(ComputationClient* client, ShapeResolver resolver,
+                  Dispatcher dispatcher);
+
+  // The listener threads block within the outfeed reads, which cannot be
+  // interrupted, so they are detached instead of being joined.
+  ~OutfeedListener();
+
+  // Starts the listener thread of the device, if not already running.
+  void Listen(const std::string& device);
+
+ private:
+  void Run(const std::string& device);
+
+  ComputationClient* client_;
+  ShapeResolver resolver_;
+  Dispatcher dispatcher_;
+  std::mutex lock_;
+  std::vector<std::string> devices_;
+  std::vector<std::unique_ptr<std::thread>> threads_;
+};
+
+}  // namespace xla
+
+#endif  // XLA_CLIENT_OUTFEED_LISTENER_H_
@@ -1,20 +1,32 @@
 #include "tensorflow/compiler/xla/xla_client/pjrt_computation_client.h"
 
 #include <algorithm>
+#include <atomic>
 
 #include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
 #include "absl/types/span.h"
 #include "tensorflow/compiler/xla/client/xla_computation.h"
 #include "tensorflow/compiler/xla/layout_util.h"
 #include "tensorflow/compiler/xla/literal.h"
 #include "tensorflow/compiler/xla/pjrt/cpu_device.h"
+#if XLA_CUDA
+#include "tensorflow/compiler/xla/pjrt/gpu_device.h"
+#endif
 #include "tensorflow/compiler/xla/pjrt/pjrt_client.h"
 #include "tensorflow/compiler/xla/pjrt/tpu_client.h"
 #include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/env_vars.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/numa_topology.h"
+#include "tensorflow/compiler/xla/xla_client/staging_buffer_pool.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
 
 namespace xla {
 
@@ -39,16 +51,60 @@ std::vector<std::string> PjRtDevicesToString(
   return strs;
 }
 
+// Computes the byte strides of the buffer described by shape, according to
+// its layout.
+std::vector<int64_t> GetByteStrides(const Shape& shape) {
+  std::vector<int64_t> byte_strides(shape.rank());
+  int64_t stride = ShapeUtil::ByteSizeOfPrimitiveType(shape.element_type());
+  if (shape.has_layout()) {
+    for (auto dim : shape.layout().minor_to_major()) {
+      byte_strides[dim] = stride;
+      stride *= shape.dimensions(dim);
+    }
+  } else {
+    for (int64_t dim = shape.rank() - 1; dim >= 0; --dim) {
+      byte_strides[dim] = stride;
+      stride *= shape.dimensions(dim);
+    }
+  }
+  return byte_strides;
+}
+
+// Returns the shape of the index-th output buffer of an execution, taking it
+// from the computation result shape so that there is no need to wait for the
+// execution to complete. Outputs with dynamic dimensions keep their bounded
+// shape, so that the graphs consuming them do not depend on (and do not get
+// recompiled for) the actual sizes, which are only needed by the transfers.
+Shape GetOutputShape(const Shape& result_shape, bool explode_tuple,
+                     size_t index) {
+  return explode_tuple && result_shape.IsTuple()
+             ? ShapeUtil::GetTupleElementShape(result_shape, index)
+             : result_shape;
+}
+
 }  // namespace
 
 PjRtComputationClient::PjRtComputationClient() {
   std::string device_type = sys_util::GetEnvString(env::kEnvPjRtDevice, "");
   if (device_type == "CPU") {
-    TF_VLOG(1) << "Initializing PjRt CPU client...";
-    client_ = std::move(xla::GetCpuClient(/*asynchronous=*/false).ValueOrDie());
+    bool async = sys_util::GetEnvBool(env::kEnvPjRtAsyncCpuClient, false);
+    TF_VLOG(1) << "Initializing PjRt CPU client (async=" << async << ")...";
+    client_ = std::move(xla::GetCpuClient(async).ValueOrDie());
   } else if (device_type == "TPU") {
-    TF_VLOG(1) << "Initializing PjRt TPU client...";
-    client_ = xla::GetTpuClient(/*max_inflight_computations=*/1).ValueOrDie();
+    // Allowing more than one computation in flight lets the host enqueue the
+    // next step while the device is still busy with the current one. It used
+    // to be 1, which PJRT_TPU_MAX_INFLIGHT_COMPUTATIONS=1 restores for the
+    // models which no longer fit in the device memory.
+    int64_t max_inflight_computations =
+        sys_util::GetEnvInt(env::kEnvPjRtTpuMaxInflightComputations, 32);
+    TF_VLOG(1) << "Initializing PjRt TPU client (max_inflight_computations="
+               << max_inflight_computations << ")...";
+    client_ = xla::GetTpuClient(max_inflight_computations).ValueOrDie();
+#if XLA_CUDA
+  } else if (device_type == "GPU") {
+    TF_VLOG(1) << "Initializing PjRt GPU client...";
+    client_ = CreateGpuClient();
+#endif
   } else {
     XLA_ERROR() << absl::StrFormat("Unknown %s '%s'", env::kEnvPjRtDevice,
                                    device_type);
@@ -62,10 +118,52 @@ PjRtComputationClient::PjRtComputationClient() {
   }
 }
 
+#if XLA_CUDA
+std::shared_ptr<PjRtClient> PjRtComputationClient::CreateGpuClient() {
+  // Multi-host setups rendezvous through the distributed runtime service,
+  // which is run by the process with index zero. The resulting client sees
+  // the devices of all the processes, with global ids, while only the local
+  // ones are addressable.
+  std::string dist_service_addr =
+      sys_util::GetEnvString(env::kEnvPjRtDistServiceAddr, "");
+  int64_t process_index = sys_util::GetEnvInt(env::kEnvPjRtProcessIndex, 0);
+  std::shared_ptr<DistributedRuntimeClient> distributed_client;
+  if (!dist_service_addr.empty()) {
+    int64_t num_processes = sys_util::GetEnvInt(env::kEnvPjRtNumProcesses, 1);
+    XLA_CHECK_LT(process_index, num_processes);
+    if (process_index == 0) {
+      DistributedRuntimeServiceImpl::Options service_options;
+      service_options.num_nodes = num_processes;
+      TF_VLOG(1) << "Starting PjRt distributed runtime service at "
+                 << dist_service_addr << " for " << num_processes
+                 << " processes";
+      distributed_service_ =
+          GetDistributedRuntimeService(dist_service_addr, service_options)
+              .ValueOrDie();
+    }
+    DistributedRuntimeClient::Options client_options;
+    client_options.node_id = process_index;
+    distributed_client =
+        GetDistributedRuntimeClient(dist_service_addr, client_options);
+    XLA_CHECK_OK(distributed_client->Connect());
+  }
+  // Under a device memory quota several processes share the device, so none
+  // of them can grab most of its memory upfront.
+  GpuAllocatorConfig allocator_config;
+  if (memory_quota::IsEnabled()) {
+    allocator_config.preallocate = false;
+  }
+  return GetGpuClient(/*asynchronous=*/true, allocator_config,
+                      std::move(distributed_client), process_index)
+      .ValueOrDie();
+}
+#endif
+
 void PjRtComputationClient::PjRtData::Assign(const Data& data) {
   const PjRtData& pjrt_data = dynamic_cast<const PjRtData&>(data);
   if (&pjrt_data != this) {
     buffer = pjrt_data.buffer;
+    set_quota_charge(pjrt_data.quota_charge());
   }
 }
 
@@ -76,64 +174,170 @@ ComputationClient::DataPtr PjRtComputationClient::CreateDataPlaceholder(
 
 std::vector<ComputationClient::DataPtr> PjRtComputationClient::TransferToServer(
     absl::Span<const TensorSource> tensors) {
-  std::vector<ComputationClient::DataPtr> datas;
-  datas.reserve(tensors.size());
-  for (auto& tensor : tensors) {
-    xla::Literal literal(tensor.shape);
-    tensor.populate_fn(tensor, literal.untyped_data(), literal.size_bytes());
-
-    PjRtDevice* pjrt_device = StringToPjRtDevice(tensor.device);
-    std::shared_ptr<xla::PjRtBuffer> buffer =
-        client_->BufferFromHostLiteral(literal, pjrt_device).ValueOrDie();
-    buffer->GetReadyFuture().Await();
-    ComputationClient::DataPtr data =
-        std::make_shared<PjRtData>(tensor.device, tensor.shape, buffer);
-    datas.push_back(data);
+  metrics::TimedSection timed(TransferToServerMetric());
+  tensorflow::profiler::TraceMe activity(
+      "PjRtComputationClient::TransferToServer",
+      tensorflow::profiler::TraceMeLevel::kInfo);
+  std::vector<memory_quota::ChargePtr> charges = AcquireTransferQuota(tensors);
+  std::vector<ComputationClient::DataPtr> datas(tensors.size());
+  std::atomic<int64_t> total_size(0);
+  auto mwait = std::make_shared<util::MultiWait>(tensors.size());
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    auto converter = [&, i]() {
+      const TensorSource& tensor = tensors[i];
+      size_t size = ShapeUtil::ByteSizeOf(tensor.shape);
+      PjRtDevice* pjrt_device = StringToPjRtDevice(tensor.device);
+      std::vector<int64_t> byte_strides = GetByteStrides(tensor.shape);
+      if (tensor.data != nullptr) {
+        // The source data is only borrowed for the duration of this call, so
+        // the transfer needs to complete before returning.
+        std::shared_ptr<const void> source_data = tensor.data;
+        std::shared_ptr<xla::PjRtBuffer> buffer =
+            client_
+                ->BufferFromHostBuffer(
+                    source_data.get(), tensor.shape.element_type(),
+                    tensor.shape.dimensions(), byte_strides,
+                    PjRtClient::HostBufferSemantics::
+                        kImmutableUntilTransferCompletes,
+                    [source_data]() {}, pjrt_device)
+                .ValueOrDie();
+        XLA_CHECK_OK(buffer->GetReadyFuture().Await());
+        datas[i] =
+            std::make_shared<PjRtData>(tensor.device, tensor.shape, buffer);
+        total_size += size;
+        XLA_COUNTER("PjRtZeroCopyTransfers", 1);
+        return;
+      }
+      // The host buffer is kept alive by the done callback until PjRt has
+      // completed the transfer, so there is no need to wait for the device
+      // buffer to become ready here. Readiness is tracked by PjRt, and the
+      // consumers of the buffer will wait on it.
+      std::shared_ptr<char> host_buffer =
+          StagingBufferPool::Get()->Acquire(size);
+      tensor.populate_fn(tensor, host_buffer.get(), size);
+
+      std::shared_ptr<xla::PjRtBuffer> buffer =
+          client_
+              ->BufferFromHostBuffer(
+                  host_buffer.get(), tensor.shape.element_type(),
+                  tensor.shape.dimensions(), byte_strides,
+                  PjRtClient::HostBufferSemantics::
+                      kImmutableUntilTransferCompletes,
+                  [host_buffer]() {}, pjrt_device)
+              .ValueOrDie();
+      datas[i] =
+          std::make_shared<PjRtData>(tensor.device, tensor.shape, buffer);
+      total_size += size;
+    };
+    // The staging of the tensor runs on the workers local to its device.
+    env::ScopedNumaNode numa_node(
+        numa::Topology::Get()->GetDeviceNode(tensors[i].device));
+    env::ScheduleClosure(
+        util::MultiWait::Completer(mwait, std::move(converter)));
   }
-
+  mwait->Wait();
+  OutboundDataMetric()->AddSample(total_size);
+  AttachQuota(datas, std::move(charges));
   return datas;
 }
 
 std::vector<xla::Literal> PjRtComputationClient::TransferFromServer(
     absl::Span<const DataPtr> handles) {
+  metrics::TimedSection timed(TransferFromServerMetric());
   std::vector<xla::Literal> literals;
   literals.reserve(handles.size());
-
+  // Start all the device to host copies before waiting for any of them, so
+  // that the transfers overlap, instead of paying one round trip per handle.
+  std::vector<PjRtFuture<Status>> futures;
+  futures.reserve(handles.size());
   for (auto handle : handles) {
     const PjRtData& pjrt_data = dynamic_cast<const PjRtData&>(*handle);
-
-    std::shared_ptr<xla::Literal> literal =
-        pjrt_data.buffer->ToLiteralSync().ValueOrDie();
-    literals.push_back(std::move(*literal));
+    XLA_CHECK(pjrt_data.HasValue())
+        << "Transfer of an empty data handle: " << pjrt_data.device();
+    // The literal of a bounded dynamic buffer has its actual sizes, known once
+    // the buffer is ready.
+    literals.emplace_back(
+        handle->shape().is_static()
+            ? handle->shape()
+            : pjrt_data.buffer->logical_on_device_shape().ValueOrDie());
+    futures.push_back(pjrt_data.buffer->ToLiteral(&literals.back()));
   }
-
+  int64_t total_size = 0;
+  for (size_t i = 0; i < futures.size(); ++i) {
+    XLA_CHECK_OK(futures[i].Await());
+    total_size += literals[i].size_bytes();
+  }
+  InboundDataMetric()->AddSample(total_size);
   return literals;
 }
 
+Literal PjRtComputationClient::TransferFromOutfeed(const std::string& device,
+                                                  const Shape& shape) {
+  Literal literal(shape);
+  XLA_CHECK_OK(StringToPjRtDevice(device)->TransferFromOutfeed(
+      MutableBorrowingLiteral(&literal)));
+  InboundDataMetric()->AddSample(literal.size_bytes());
+  return literal;
+}
+
 std::vector<ComputationClient::ComputationPtr> PjRtComputationClient::Compile(
     std::vector<ComputationClient::CompileInstance> instances) {
-  std::vector<ComputationClient::ComputationPtr> computations;
-
-  for (auto& instance : instances) {
+  std::vector<ComputationClient::ComputationPtr> computations(
+      instances.size());
+  auto compile_fn = [&](size_t i) {
+    CompileInstance& instance = instances[i];
     PjRtDevice* pjrt_device = StringToPjRtDevice(instance.compilation_device);
     xla::ProgramShape program_shape =
         instance.computation.GetProgramShape().ValueOrDie();
-    xla::CompileOptions compile_options;
-    // TODO(wcromar): set compile_options.argument_layouts, enable strict shapes
-    compile_options.executable_build_options.set_num_partitions(1);
-    compile_options.executable_build_options.set_num_replicas(
-        client_->device_count());
     std::unique_ptr<xla::PjRtExecutable> executable =
-        client_->Compile(instance.computation, compile_options).ValueOrDie();
-    std::shared_ptr<PjRtComputation> pjrt_computation =
-        std::make_shared<PjRtComputation>(std::move(instance.computation),
-                                          program_shape, instance.devices,
-                                          std::move(executable));
+        client_->Compile(instance.computation, GetCompileOptions())
+            .ValueOrDie();
+    computations[i] = std::make_shared<PjRtComputation>(
+        std::move(instance.computation), program_shape, instance.devices,
+        std::move(executable));
+  };
+  if (instances.size() == 1) {
+    compile_fn(0);
+    return computations;
+  }
+  // Batches of computations (like the single ops of the op-by-op execution)
+  // are compiled in parallel.
+  auto mwait = std::make_shared<util::MultiWait>(instances.size());
+  for (size_t i = 0; i < instances.size(); ++i) {
+    env::ScheduleClosure(util::MultiWait::Completer(
+        mwait, [&compile_fn, i]() { compile_fn(i); }));
+  }
+  mwait->Wait();
+  return computations;
+}
 
-    computations.push_back(pjrt_computation);
+std::string PjRtComputationClient::SerializeComputation(
+    const Computation& computation) {
+  const PjRtComputation& pjrt_computation =
+      dynamic_cast<const PjRtComputation&>(computation);
+  StatusOr<std::string> serialized =
+      client_->SerializeExecutable(*pjrt_computation.executable);
+  if (!serialized.ok()) {
+    TF_VLOG(3) << "Unable to serialize PjRt executable: "
+               << serialized.status();
+    return std::string();
   }
+  return serialized.ConsumeValueOrDie();
+}
 
-  return computations;
+ComputationClient::ComputationPtr PjRtComputationClient::DeserializeComputation(
+    const std::string& serialized, XlaComputation computation,
+    ProgramShape program_shape, std::vector<std::string> devices) {
+  StatusOr<std::unique_ptr<xla::PjRtExecutable>> executable =
+      client_->DeserializeExecutable(serialized, GetCompileOptions());
+  if (!executable.ok()) {
+    TF_VLOG(3) << "Unable to deserialize PjRt executable: "
+               << executable.status();
+    return nullptr;
+  }
+  return std::make_shared<PjRtComputation>(
+      std::move(computation), std::move(program_shape), std::move(devices),
+      executable.ConsumeValueOrDie());
 }
 
 std::vector<ComputationClient::DataPtr>
@@ -153,12 +357,17 @@ PjRtComputationClient::ExecuteComputation(
   for (auto& argument : arguments) {
     const PjRtData* pjrt_data = dynamic_cast<PjRtData*>(argument.get());
 
+    XLA_CHECK(pjrt_data->HasValue())
+        << "Argument buffer has been deleted or donated: "
+        << pjrt_data->shape();
     XLA_CHECK(pjrt_device == pjrt_data->buffer->device())
         << pjrt_device->DebugString() << " vs "
         << pjrt_data->buffer->device()->DebugString();
     buffers.push_back(pjrt_data->buffer.get());
   }
 
+  std::vector<memory_quota::ChargePtr> charges = AcquireResultsQuota(
+      computation, arguments, device, options.explode_tuple);
   xla::ExecuteOptions execute_options;
   execute_options.untuple_result = options.explode_tuple;
   execute_options.strict_shape_checking = false;
@@ -166,23 +375,270 @@ PjRtComputationClient::ExecuteComputation(
       pjrt_computation.executable
           ->ExecuteSharded(buffers, pjrt_device, execute_options)
           .ValueOrDie();
+  DonateArguments(pjrt_computation, arguments);
 
+  // The returned buffers might not be ready yet, as PjRt dispatches the
+  // execution asynchronously, and their consumers will wait on them.
+  const Shape& result_shape = computation.program_shape().result();
   std::vector<DataPtr> datas;
   datas.reserve(results.size());
-  for (auto& result : results) {
-    std::unique_ptr<xla::PjRtBuffer> buffer = std::move(result);
-
-    std::shared_ptr<PjRtData> data = std::make_shared<PjRtData>(
-        device, buffer->logical_on_device_shape().ValueOrDie(),
-        std::move(buffer));
-
-    datas.push_back(data);
+  for (size_t i = 0; i < results.size(); ++i) {
+    std::unique_ptr<xla::PjRtBuffer> buffer = std::move(results[i]);
+    Shape shape = GetOutputShape(result_shape, options.explode_tuple, i);
+    datas.push_back(std::make_shared<PjRtData>(device, std::move(shape),
+                                               std::move(buffer)));
   }
 
+  AttachQuota(datas, std::move(charges));
   TF_VLOG(1) << "Returning " << datas.size() << " results";
   return datas;
 }
 
+std::vector<std::vector<ComputationClient::DataPtr>>
+PjRtComputationClient::ExecuteReplicated(
+    const ComputationClient::Computation& computation,
+    const std::vector<std::vector<ComputationClient::DataPtr>>& arguments,
+    absl::Span<const std::string> devices,
+    const ExecuteReplicatedOptions& options) {
+  TF_VLOG(1) << "Executing replicated PjRt computation on "
+             << absl::StrJoin(devices, ", ");
+  const PjRtComputation& pjrt_computation =
+      dynamic_cast<const PjRtComputation&>(computation);
+  XLA_CHECK_EQ(devices.size(), arguments.size());
+
+  // PjRt wants the arguments in the order of the executable's addressable
+  // devices, which might differ from the order of the devices argument.
+  const std::vector<xla::PjRtDevice*>& addressable_devices =
+      pjrt_computation.executable->addressable_devices();
+  XLA_CHECK_EQ(addressable_devices.size(), devices.size())
+      << "Replicated execution must run on all the addressable devices";
+  std::vector<size_t> replica_index(devices.size());
+  std::vector<std::vector<xla::PjRtBuffer*>> argument_handles(devices.size());
+  for (size_t i = 0; i < devices.size(); ++i) {
+    xla::PjRtDevice* pjrt_device = StringToPjRtDevice(devices[i]);
+    auto it = std::find(addressable_devices.begin(), addressable_devices.end(),
+                        pjrt_device);
+    XLA_CHECK(it != addressable_devices.end())
+        << "Device " << devices[i] << " is not addressable by the executable";
+    size_t position = it - addressable_devices.begin();
+    replica_index[position] = i;
+
+    std::vector<xla::PjRtBuffer*>& buffers = argument_handles[position];
+    buffers.reserve(arguments[i].size());
+    for (auto& argument : arguments[i]) {
+      const PjRtData* pjrt_data = dynamic_cast<PjRtData*>(argument.get());
+      XLA_CHECK(pjrt_data->HasValue())
+          << "Argument buffer has been deleted or donated: "
+          << pjrt_data->shape();
+      XLA_CHECK(pjrt_device == pjrt_data->buffer->device())
+          << pjrt_device->DebugString() << " vs "
+          << pjrt_data->buffer->device()->DebugString();
+      buffers.push_back(pjrt_data->buffer.get());
+    }
+  }
+
+  std::vector<std::vector<memory_quota::ChargePtr>> charges;
+  charges.reserve(devices.size());
+  for (size_t i = 0; i < devices.size(); ++i) {
+    charges.push_back(AcquireResultsQuota(computation, arguments[i],
+                                          devices[i], options.explode_tuple));
+  }
+  xla::ExecuteOptions execute_options;
+  execute_options.untuple_result = options.explode_tuple;
+  execute_options.strict_shape_checking = false;
+  std::vector<std::vector<std::unique_ptr<xla::PjRtBuffer>>> results =
+      pjrt_computation.executable->Execute(argument_handles, execute_options)
+          .ValueOrDie();
+  for (auto& replica_arguments : arguments) {
+    DonateArguments(pjrt_computation, replica_arguments);
+  }
+  XLA_CHECK_EQ(results.size(), devices.size());
+
+  const Shape& result_shape = computation.program_shape().result();
+  std::vector<std::vector<DataPtr>> data_handles(devices.size());
+  for (size_t position = 0; position < results.size(); ++position) {
+    size_t i = replica_index[position];
+    std::vector<DataPtr>& datas = data_handles[i];
+    datas.reserve(results[position].size());
+    for (size_t j = 0; j < results[position].size(); ++j) {
+      std::unique_ptr<xla::PjRtBuffer> buffer = std::move(results[position][j]);
+      Shape shape = GetOutputShape(result_shape, options.explode_tuple, j);
+      datas.push_back(std::make_shared<PjRtData>(devices[i], std::move(shape),
+                                                 std::move(buffer)));
+    }
+    AttachQuota(datas, std::move(charges[i]));
+  }
+  TF_VLOG(1) << "Returning " << data_handles.size() << " sets of results";
+  return data_handles;
+}
+
+std::vector<std::vector<ComputationClient::DataPtr>>
+PjRtComputationClient::ExecuteParallel(
+    absl::Span<const Computation* const> computations,
+    const std::vector<std::vector<DataPtr>>& arguments,
+    absl::Span<const std::string> devices,
+    const ExecuteParallelOptions& options) {
+  metrics::TimedSection timed(ExecuteParallelMetric());
+  XLA_CHECK_EQ(computations.size(), arguments.size());
+  XLA_CHECK_EQ(computations.size(), devices.size());
+  TF_VLOG(1) << "Executing " << computations.size()
+             << " parallel PjRt computations on "
+             << absl::StrJoin(devices, ", ");
+
+  // Every device has its own execution stream, so dispatching from separate
+  // threads lets the computations overlap. The results are still returned in
+  // the order of the computations argument.
+  ExecuteComputationOptions execute_options;
+  execute_options.explode_tuple = options.explode_tuple;
+  std::vector<std::vector<DataPtr>> results(computations.size());
+  auto mwait = std::make_shared<util::MultiWait>(computations.size());
+  for (size_t i = 0; i < computations.size(); ++i) {
+    auto executefn = [&, i]() {
+      results[i] = ExecuteComputation(*computations[i], arguments[i],
+                                      devices[i], execute_options);
+    };
+    env::ScheduleIoClosure(
+        util::MultiWait::Completer(mwait, std::move(executefn)));
+  }
+  mwait->Wait();
+  return results;
+}
+
+std::vector<ComputationClient::DataPtr> PjRtComputationClient::ExecuteChained(
+    absl::Span<const ExecuteChainedOp> ops, const std::string& device) {
+  metrics::TimedSection timed(ExecuteChainedMetric());
+  // PjRt dispatches every execution asynchronously, and untuples the results
+  // on device, so chaining the single computations does not need any host
+  // round trip, nor the materialization of the output tuples.
+  std::vector<int64_t> uses(ops.size(), 0);
+  for (auto& op : ops) {
+    for (auto& input : op.inputs) {
+      uses[input.op_index] += 1;
+    }
+  }
+  ExecuteComputationOptions options;
+  options.explode_tuple = true;
+  std::vector<std::vector<DataPtr>> ops_outputs(ops.size());
+  std::vector<DataPtr> results;
+  for (size_t i = 0; i < ops.size(); ++i) {
+    const ExecuteChainedOp& op = ops[i];
+    if (op.device_data != nullptr) {
+      ops_outputs[i].push_back(op.device_data);
+    } else {
+      std::vector<DataPtr> arguments;
+      arguments.reserve(op.inputs.size());
+      for (auto& input : op.inputs) {
+        XLA_CHECK_LT(input.op_index, i);
+        XLA_CHECK_LT(input.output_index.value_or(0),
+                     ops_outputs[input.op_index].size());
+        arguments.push_back(
+            ops_outputs[input.op_index][input.output_index.value_or(0)]);
+      }
+      ops_outputs[i] =
+          ExecuteComputation(*op.computation, arguments, device, options);
+    }
+
+    for (auto& output : op.outputs) {
+      if (output.result_index >= results.size()) {
+        results.resize(output.result_index + 1);
+      }
+      XLA_CHECK_LT(output.output_index.value_or(0), ops_outputs[i].size());
+      results[output.result_index] =
+          ops_outputs[i][output.output_index.value_or(0)];
+    }
+    // Drop references to any intermediate result which is not used anymore.
+    for (auto& input : op.inputs) {
+      uses[input.op_index] -= 1;
+      if (uses[input.op_index] == 0) {
+        ops_outputs[input.op_index].clear();
+      }
+    }
+  }
+  return results;
+}
+
+std::vector<std::vector<ComputationClient::DataPtr>>
+PjRtComputationClient::DeconstructTuple(absl::Span<const DataPtr> tuples) {
+  metrics::TimedSection timed(DeconstructTupleMetric());
+  // The executions always untuple their results on device, so tuple buffers
+  // only show up when explicitly requested with explode_tuple=false. PjRt
+  // has no sub-buffer views, so those are decomposed through the host.
+  std::vector<Literal> literals = TransferFromServer(tuples);
+  std::vector<std::vector<DataPtr>> results;
+  results.reserve(tuples.size());
+  for (size_t i = 0; i < tuples.size(); ++i) {
+    XLA_CHECK(literals[i].shape().IsTuple()) << literals[i].shape();
+    const std::string& device = tuples[i]->device();
+    PjRtDevice* pjrt_device = StringToPjRtDevice(device);
+    std::vector<Literal> elements = literals[i].DecomposeTuple();
+    std::vector<DataPtr> datas;
+    datas.reserve(elements.size());
+    for (auto& element : elements) {
+      std::shared_ptr<PjRtBuffer> buffer =
+          client_->BufferFromHostLiteral(element, pjrt_device).ValueOrDie();
+      // The literal must outlive the transfer.
+      XLA_CHECK_OK(buffer->GetReadyFuture().Await());
+      datas.push_back(
+          std::make_shared<PjRtData>(device, element.shape(), buffer));
+    }
+    results.push_back(std::move(datas));
+  }
+  return results;
+}
+
+std::map<std::string, Metric> PjRtComputationClient::GetMetrics() const {
+  std::map<std::string, Metric> metrics_data;
+  for (auto* device : client_->addressable_devices()) {
+    StatusOr<tensorflow::AllocatorStats> stats = device->GetAllocatorStats();
+    if (!stats.ok()) {
+      continue;
+    }
+    std::string device_str = PjRtDeviceToString(device);
+    auto add_metric = [&](const char* name, int64_t value) {
+      Metric metric;
+      metric.int64_value = value;
+      metrics_data.emplace(absl::StrCat(name, ".", device_str),
+                           std::move(metric));
+    };
+    add_metric("PjRtBytesInUse", stats->bytes_in_use);
+    add_metric("PjRtPeakBytesInUse", stats->peak_bytes_in_use);
+    add_metric("PjRtLargestAllocSize", stats->largest_alloc_size);
+    add_metric("PjRtNumAllocs", stats->num_allocs);
+    if (stats->largest_free_block_bytes > 0) {
+      add_metric("PjRtLargestFreeBlockBytes", stats->largest_free_block_bytes);
+    }
+  }
+  return metrics_data;
+}
+
+ComputationClient::MemoryInfo PjRtComputationClient::GetMemoryInfo(
+    const std::string& device) {
+  PjRtDevice* pjrt_device = StringToPjRtDevice(device);
+  tensorflow::AllocatorStats stats =
+      pjrt_device->GetAllocatorStats().ValueOrDie();
+  XLA_CHECK(stats.bytes_limit) << "No memory limit for device " << device;
+  MemoryInfo mem_info;
+  mem_info.kb_free = (*stats.bytes_limit - stats.bytes_in_use) / 1024;
+  mem_info.kb_total = *stats.bytes_limit / 1024;
+  mem_info.kb_peak = stats.peak_bytes_in_use / 1024;
+  mem_info.kb_largest_free_block = stats.largest_free_block_bytes / 1024;
+  mem_info.num_allocs = stats.num_allocs;
+  return mem_info;
+}
+
+void PjRtComputationClient::DonateArguments(
+    const PjRtComputation& computation, absl::Span<const DataPtr> arguments) {
+  if (computation.donated_parameters.empty()) {
+    return;
+  }
+  for (auto parameter : computation.donated_parameters) {
+    XLA_CHECK_LT(parameter, arguments.size());
+    PjRtData* pjrt_data = dynamic_cast<PjRtData*>(arguments[parameter].get());
+    pjrt_data->Donate();
+  }
+  XLA_COUNTER("PjRtDonatedBuffers", computation.donated_parameters.size());
+}
+
 size_t PjRtComputationClient::GetNumDevices() const {
   return client_->addressable_device_count();
 }
@@ -199,6 +655,15 @@ std::vector<std::string> PjRtComputationClient::GetAllDevices() const {
   return PjRtDevicesToString(client_->devices());
 }
 
+std::vector<int> PjRtComputationClient::GetDeviceCoords(
+    const std::string& device) const {
+  // The PjRt devices do not expose their physical coordinates, and their ids
+  // follow the topology order.
+  auto it = string_to_device_.find(device);
+  XLA_CHECK(it != string_to_device_.end()) << "Unknown device " << device;
+  return {it->second->id()};
+}
+
 void PjRtComputationClient::SetReplicationDevices(
     std::shared_ptr<std::vector<std::string>> devices) {
   replication_devices_ = std::move(devices);
@@ -209,6 +674,18 @@ PjRtComputationClient::GetReplicationDevices() {
   return replication_devices_;
 }
 
+xla::CompileOptions PjRtComputationClient::GetCompileOptions() const {
+  xla::CompileOptions compile_options;
+  // TODO(wcromar): set compile_options.argument_layouts, enable strict shapes
+  compile_options.executable_build_options.set_num_partitions(1);
+  // Replicated computations run on the replication devices, if set.
+  compile_options.executable_build_options.set_num_replicas(
+      replication_devices_ != nullptr && !replication_devices_->empty()
+          ? replication_devices_->size()
+          : client_->device_count());
+  return compile_options;
+}
+
 xla::PjRtDevice* PjRtComputationClient::StringToPjRtDevice(
     const std::string& device) {
   XLA_CHECK(string_to_device_.find(device) != string_to_device_.end())
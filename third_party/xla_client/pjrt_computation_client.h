@@ -7,6 +7,9 @@
 #include "tensorflow/compiler/xla/client/xla_computation.h"
 #include "tensorflow/compiler/xla/literal.h"
 #include "tensorflow/compiler/xla/pjrt/pjrt_client.h"
+#if XLA_CUDA
+#include "tensorflow/compiler/xla/pjrt/distributed/distributed.h"
+#endif
 #include "tensorflow/compiler/xla/shape.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
@@ -26,6 +29,9 @@ class PjRtComputationClient : public ComputationClient {
   std::vector<Literal> TransferFromServer(
       absl::Span<const DataPtr> handles) override;
 
+  Literal TransferFromOutfeed(const std::string& device,
+                              const Shape& shape) override;
+
   std::vector<ComputationPtr> Compile(
       std::vector<CompileInstance> instances) override;
 
@@ -34,6 +40,30 @@ class PjRtComputationClient : public ComputationClient {
       const std::string& device,
       const ExecuteComputationOptions& options) override;
 
+  std::vector<std::vector<DataPtr>> ExecuteReplicated(
+      const Computation& computation,
+      const std::vector<std::vector<DataPtr>>& arguments,
+      absl::Span<const std::string> devices,
+      const ExecuteReplicatedOptions& options) override;
+
+  std::string SerializeComputation(const Computation& computation) override;
+
+  ComputationPtr DeserializeComputation(
+      const std::string& serialized, XlaComputation computation,
+      ProgramShape program_shape, std::vector<std::string> devices) override;
+
+  std::vector<std::vector<DataPtr>> ExecuteParallel(
+      absl::Span<const Computation* const> computations,
+      const std::vector<std::vector<DataPtr>>& arguments,
+      absl::Span<const std::string> devices,
+      const ExecuteParallelOptions& options) override;
+
+  std::vector<DataPtr> ExecuteChained(absl::Span<const ExecuteChainedOp> ops,
+                                      const std::string& device) override;
+
+  std::vector<std::vector<DataPtr>> DeconstructTuple(
+      absl::Span<const DataPtr> tuples) override;
+
   size_t GetNumDevices() const override;
 
   std::string GetDefaultDevice() const override;
@@ -42,6 +72,8 @@ class PjRtComputationClient : public ComputationClient {
 
   std::vector<std::string> GetAllDevices() const override;
 
+  std::vector<int> GetDeviceCoords(const std::string& device) const override;
+
   void SetReplicationDevices(
       std::shared_ptr<std::vector<std::string>> devices) override;
 
@@ -66,32 +98,6 @@ class PjRtComputationClient : public ComputationClient {
     XLA_ERROR() << __FUNCTION__ << " not implemented";
   };
 
-  std::vector<std::vector<DataPtr>> DeconstructTuple(
-      absl::Span<const DataPtr> tuples) override {
-    XLA_ERROR() << __FUNCTION__ << " not implemented";
-  };
-
-  std::vector<std::vector<DataPtr>> ExecuteReplicated(
-      const Computation& computation,
-      const std::vector<std::vector<DataPtr>>& arguments,
-      absl::Span<const std::string> devices,
-      const ExecuteReplicatedOptions& options) override {
-    XLA_ERROR() << __FUNCTION__ << " not implemented";
-  };
-
-  std::vector<std::vector<DataPtr>> ExecuteParallel(
-      absl::Span<const Computation* const> computations,
-      const std::vector<std::vector<DataPtr>>& arguments,
-      absl::Span<const std::string> devices,
-      const ExecuteParallelOptions& options) override {
-    XLA_ERROR() << __FUNCTION__ << " not implemented";
-  };
-
-  std::vector<DataPtr> ExecuteChained(absl::Span<const ExecuteChainedOp> ops,
-                                      const std::string& device) override {
-    XLA_ERROR() << __FUNCTION__ << " not implemented";
-  };
-
   std::string GetResourceDomain(const std::string& device) const override {
     // TODO(wcromar): return a meaningful value
     return "getresourcedomainplaceholder";
@@ -101,21 +107,33 @@ class PjRtComputationClient : public ComputationClient {
     XLA_ERROR() << __FUNCTION__ << " not implemented";
   };
 
-  std::map<std::string, Metric> GetMetrics() const override {
-    XLA_ERROR() << __FUNCTION__ << " not implemented";
-  };
+  std::map<std::string, Metric> GetMetrics() const override;
 
-  MemoryInfo GetMemoryInfo(const std::string& device) override {
-    XLA_ERROR() << __FUNCTION__ << " not implemented";
-  };
+  MemoryInfo GetMemoryInfo(const std::string& device) override;
 
  private:
+#if XLA_CUDA
+  // Declared ahead of the client, so that it outlives it.
+  std::unique_ptr<DistributedRuntimeService> distributed_service_;
+#endif
   std::shared_ptr<PjRtClient> client_;
   std::unordered_map<std::string, xla::PjRtDevice* const> string_to_device_;
   std::shared_ptr<std::vector<std::string>> replication_devices_;
+#if XLA_CUDA
+  std::shared_ptr<PjRtClient> CreateGpuClient();
+#endif
 
   xla::PjRtDevice* StringToPjRtDevice(const std::string& device);
 
+  xla::CompileOptions GetCompileOptions() const;
+
+  struct PjRtComputation;
+
+  // Invalidates the arguments which got donated to an execution of the given
+  // computation.
+  void DonateArguments(const PjRtComputation& computation,
+                       absl::Span<const DataPtr> arguments);
+
   struct PjRtData : public Data {
     PjRtData(std::string device, Shape device_shape)
         : Data(std::move(device), std::move(device_shape)) {}
@@ -137,6 +155,11 @@ class PjRtComputationClient : public ComputationClient {
       return buffer != nullptr && !buffer->IsDeleted();
     };
 
+    // Drops the reference to the buffer, once it has been donated to an
+    // execution. PjRt invalidates donated buffers, so any other PjRtData
+    // sharing it will report HasValue() false.
+    void Donate() { buffer = nullptr; }
+
     std::shared_ptr<PjRtBuffer> buffer;
   };
 
@@ -146,9 +169,18 @@ class PjRtComputationClient : public ComputationClient {
                     std::unique_ptr<xla::PjRtExecutable> executable)
         : Computation(std::move(computation), std::move(program_shape),
                       std::move(devices)),
-          executable(std::move(executable)) {}
+          executable(std::move(executable)) {
+      // PjRt donates the buffers of all the parameters which are aliased with
+      // an output, so we track them to invalidate the donors after execution.
+      const HloInputOutputAliasProto& aliases =
+          this->computation().proto().input_output_alias();
+      for (auto& entry : aliases.entries()) {
+        donated_parameters.push_back(entry.parameter_number());
+      }
+    }
 
     std::unique_ptr<xla::PjRtExecutable> executable;
+    std::vector<int64_t> donated_parameters;
   };
 };
 
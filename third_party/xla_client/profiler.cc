@@ -1,9 +1,95 @@
 #include "tensorflow/compiler/xla/xla_client/profiler.h"
 
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 #include "tensorflow/core/profiler/rpc/profiler_server.h"
 
 namespace xla {
 namespace profiler {
+namespace {
+
+// The interval the accept and read loops check whether the server got stopped.
+constexpr int kPollTimeoutMs = 100;
+// The time a client gets to send its request line, and to take the response,
+// before the connection is dropped, so that one idle client cannot hang the
+// single serving thread.
+constexpr int kRequestTimeoutMs = 5000;
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void WriteAll(int fd, const std::string& data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t count = ::send(fd, data.data() + offset, data.size() - offset,
+                           MSG_NOSIGNAL);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    offset += count;
+  }
+}
+
+// Returns the request line, or an empty string if the client did not send it
+// within kRequestTimeoutMs or the server got stopped meanwhile.
+std::string ReadRequestLine(int fd, const std::atomic<bool>& stopped) {
+  std::string request;
+  char buffer[1024];
+  int64_t deadline = NowMs() + kRequestTimeoutMs;
+  while (request.find("\r\n") == std::string::npos && request.size() < 8192) {
+    if (stopped.load() || NowMs() >= deadline) {
+      return std::string();
+    }
+    struct pollfd pfd = {fd, POLLIN, 0};
+    int ready = ::poll(&pfd, 1, kPollTimeoutMs);
+    if (ready < 0 && errno != EINTR) {
+      break;
+    }
+    if (ready <= 0) {
+      continue;
+    }
+    ssize_t count = ::recv(fd, buffer, sizeof(buffer), 0);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    request.append(buffer, count);
+  }
+  return request.substr(0, request.find("\r\n"));
+}
+
+std::string HttpResponse(const std::string& status,
+                         const std::string& content_type,
+                         const std::string& body) {
+  return absl::StrCat("HTTP/1.1 ", status, "\r\nContent-Type: ", content_type,
+                      "\r\nContent-Length: ", body.size(),
+                      "\r\nConnection: close\r\n\r\n", body);
+}
+
+}  // namespace
 
 struct ProfilerServer::Impl {
   Impl() : server(new tensorflow::profiler::ProfilerServer()) {}
@@ -19,5 +105,81 @@ void ProfilerServer::Start(int port) {
 
 ProfilerServer::~ProfilerServer() {}
 
+struct MetricsServer::Impl {
+  explicit Impl(std::map<std::string, std::string> labels)
+      : labels(std::move(labels)) {}
+
+  void Serve() {
+    while (!stopped.load()) {
+      struct pollfd pfd = {socket_fd, POLLIN, 0};
+      if (::poll(&pfd, 1, kPollTimeoutMs) <= 0) {
+        continue;
+      }
+      int fd = ::accept(socket_fd, nullptr, nullptr);
+      if (fd < 0) {
+        continue;
+      }
+      // A single connection at a time is plenty for the scrapers, which poll
+      // every few seconds. The response writes time out as well.
+      struct timeval timeout = {kRequestTimeoutMs / 1000, 0};
+      ::setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+      std::string request = ReadRequestLine(fd, stopped);
+      if (request.empty()) {
+        ::close(fd);
+        continue;
+      }
+      if (absl::StartsWith(request, "GET /metrics ") ||
+          absl::StartsWith(request, "GET / ")) {
+        WriteAll(fd, HttpResponse("200 OK", "text/plain; version=0.0.4",
+                                  metrics::CreatePrometheusReport(labels)));
+      } else {
+        WriteAll(fd, HttpResponse("404 Not Found", "text/plain", ""));
+      }
+      ::close(fd);
+    }
+  }
+
+  std::map<std::string, std::string> labels;
+  int socket_fd = -1;
+  std::atomic<bool> stopped{false};
+  std::unique_ptr<std::thread> thread;
+};
+
+MetricsServer::MetricsServer(std::map<std::string, std::string> labels)
+    : impl_(new Impl(std::move(labels))) {}
+
+void MetricsServer::Start(int port) {
+  XLA_CHECK(impl_->thread == nullptr) << "Metrics server already started";
+  int fd = ::socket(AF_INET6, SOCK_STREAM, 0);
+  XLA_CHECK_GE(fd, 0) << "Unable to create the metrics server socket: "
+                      << std::strerror(errno);
+  int on = 1;
+  ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  struct sockaddr_in6 address;
+  std::memset(&address, 0, sizeof(address));
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(port);
+  if (::bind(fd, reinterpret_cast<struct sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+      ::listen(fd, 16) != 0) {
+    int error = errno;
+    ::close(fd);
+    XLA_ERROR() << "Unable to start the metrics server on port " << port
+                << ": " << std::strerror(error);
+  }
+  impl_->socket_fd = fd;
+  impl_->thread = absl::make_unique<std::thread>([this]() { impl_->Serve(); });
+  TF_VLOG(1) << "Metrics server listening on port " << port;
+}
+
+MetricsServer::~MetricsServer() {
+  if (impl_->thread != nullptr) {
+    impl_->stopped.store(true);
+    impl_->thread->join();
+    ::close(impl_->socket_fd);
+  }
+}
+
 }  // namespace profiler
 }  // namespace xla
@@ -1,7 +1,9 @@
 #ifndef XLA_CLIENT_PROFILER_H_
 #define XLA_CLIENT_PROFILER_H_
 
+#include <map>
 #include <memory>
+#include <string>
 
 namespace xla {
 namespace profiler {
@@ -18,6 +20,21 @@ class ProfilerServer {
   std::unique_ptr<Impl> impl_;
 };
 
+// A minimal HTTP server, which answers the GET requests of "/metrics" with the
+// metrics and counters of the process in the Prometheus text format, labeled
+// with the given labels. The server stops when the object gets destroyed.
+class MetricsServer {
+  struct Impl;
+
+ public:
+  explicit MetricsServer(std::map<std::string, std::string> labels);
+  ~MetricsServer();
+  void Start(int port);
+
+ private:
+  std::unique_ptr<Impl> impl_;
+};
+
 }  // namespace profiler
 }  // namespace xla
 
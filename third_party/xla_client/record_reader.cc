@@ -1,6 +1,11 @@
 #include "tensorflow/compiler/xla/xla_client/record_reader.h"
 
+#include <algorithm>
+#include <random>
+
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/env.h"
@@ -30,5 +35,175 @@ bool RecordReader::Read(Data* value) {
   return true;
 }
 
+size_t RecordReader::ReadBatch(size_t count, std::vector<Data>* values) {
+  std::lock_guard<std::mutex> slock(lock_);
+  size_t num_read = 0;
+  for (; num_read < count; ++num_read) {
+    Data value;
+    xla::Status status = reader_->ReadRecord(&offset_, &value);
+    if (tensorflow::errors::IsOutOfRange(status)) {
+      break;
+    }
+    XLA_CHECK_OK(status) << path_ << " offset " << offset_;
+    values->push_back(std::move(value));
+  }
+  return num_read;
+}
+
+InterleavedRecordReader::InterleavedRecordReader(std::vector<std::string> paths,
+                                                 Options options)
+    : paths_(std::move(paths)), options_(std::move(options)) {
+  options_.parallelism = std::max<size_t>(options_.parallelism, 1);
+  options_.readahead = std::max<size_t>(options_.readahead, 1);
+  if (options_.shuffle) {
+    std::mt19937_64 generator(options_.seed);
+    std::shuffle(paths_.begin(), paths_.end(), generator);
+  }
+  last_file_ = paths_.size();
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (open_files_.size() < options_.parallelism) {
+    std::shared_ptr<FileState> state = StartNextFile();
+    if (state == nullptr) {
+      break;
+    }
+    open_files_.push_back(std::move(state));
+  }
+}
+
+InterleavedRecordReader::~InterleavedRecordReader() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  stopping_ = true;
+  space_cv_.notify_all();
+  data_cv_.wait(lock, [this] { return num_readers_ == 0; });
+}
+
+std::string InterleavedRecordReader::path() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_file_ < paths_.size() ? paths_[last_file_] : std::string();
+}
+
+bool InterleavedRecordReader::Read(Data* value) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return ReadLocked(&lock, value);
+}
+
+size_t InterleavedRecordReader::ReadBatch(size_t count,
+                                          std::vector<Data>* values) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  size_t num_read = 0;
+  for (; num_read < count; ++num_read) {
+    Data value;
+    if (!ReadLocked(&lock, &value)) {
+      break;
+    }
+    values->push_back(std::move(value));
+  }
+  return num_read;
+}
+
+std::shared_ptr<InterleavedRecordReader::FileState>
+InterleavedRecordReader::StartNextFile() {
+  if (next_file_ >= paths_.size()) {
+    return nullptr;
+  }
+  auto state = std::make_shared<FileState>(next_file_++);
+  ++num_readers_;
+  env::ScheduleIoClosure([this, state]() { ReadFile(state); });
+  return state;
+}
+
+void InterleavedRecordReader::ReadFile(std::shared_ptr<FileState> state) {
+  try {
+    RecordReader reader(paths_[state->index], options_.compression,
+                        options_.buffer_size);
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_cv_.wait(lock, [&] {
+          return stopping_ || state->records.size() < options_.readahead;
+        });
+        if (stopping_) {
+          break;
+        }
+      }
+      Data value;
+      if (!reader.Read(&value)) {
+        break;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      state->records.push_back(std::move(value));
+      data_cv_.notify_all();
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    state->exptr = std::current_exception();
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  state->done = true;
+  --num_readers_;
+  data_cv_.notify_all();
+}
+
+bool InterleavedRecordReader::TakeRecord(size_t slot, Data* value) {
+  FileState* state = open_files_[slot].get();
+  if (!state->records.empty()) {
+    *value = std::move(state->records.front());
+    state->records.pop_front();
+    last_file_ = state->index;
+    space_cv_.notify_all();
+    return true;
+  }
+  if (state->exptr != nullptr) {
+    std::rethrow_exception(state->exptr);
+  }
+  std::shared_ptr<FileState> next_state = StartNextFile();
+  if (next_state != nullptr) {
+    open_files_[slot] = std::move(next_state);
+  } else {
+    open_files_.erase(open_files_.begin() + slot);
+  }
+  return false;
+}
+
+bool InterleavedRecordReader::ReadLocked(std::unique_lock<std::mutex>* lock,
+                                         Data* value) {
+  while (!open_files_.empty()) {
+    size_t slot = cursor_ % open_files_.size();
+    if (options_.shuffle) {
+      // The first file, from the cursor on, which has a record (or its end)
+      // available.
+      size_t num_files = open_files_.size();
+      size_t i = 0;
+      for (; i < num_files; ++i) {
+        FileState* state = open_files_[(slot + i) % num_files].get();
+        if (!state->records.empty() || state->done) {
+          break;
+        }
+      }
+      if (i == num_files) {
+        XLA_COUNTER("InterleavedRecordReaderStalls", 1);
+        data_cv_.wait(*lock);
+        continue;
+      }
+      slot = (slot + i) % num_files;
+    } else {
+      FileState* state = open_files_[slot].get();
+      if (state->records.empty() && !state->done) {
+        XLA_COUNTER("InterleavedRecordReaderStalls", 1);
+        data_cv_.wait(*lock, [state] {
+          return !state->records.empty() || state->done;
+        });
+      }
+    }
+    if (TakeRecord(slot, value)) {
+      cursor_ = slot + 1;
+      return true;
+    }
+    // The next file of the list takes the turn of the completed one.
+    cursor_ = slot;
+  }
+  return false;
+}
+
 }  // namespace util
 }  // namespace xla
@@ -1,9 +1,13 @@
 #ifndef XLA_CLIENT_RECORD_READER_H_
 #define XLA_CLIENT_RECORD_READER_H_
 
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/core/lib/io/record_reader.h"
@@ -22,6 +26,11 @@ class RecordReader {
 
   bool Read(Data* value);
 
+  // Reads up to count records, appending them to values, within a single
+  // acquisition of the lock. Returns the number of records read, fewer than
+  // count only at the end of the file.
+  size_t ReadBatch(size_t count, std::vector<Data>* values);
+
  private:
   std::string path_;
   std::mutex lock_;
@@ -30,6 +39,76 @@ class RecordReader {
   std::unique_ptr<tensorflow::io::RecordReader> reader_;
 };
 
+// Reads the records of many files, with up to parallelism of them being read
+// at the same time by background readers, which keep up to readahead records
+// of their file buffered. In deterministic order, the records are taken round
+// robin from the open files, and a completed file gets replaced by the next
+// one of the list in its turn. With shuffle, the list of files is shuffled
+// with the seed, and the records are taken from whichever open file has one
+// buffered.
+class InterleavedRecordReader {
+ public:
+  using Data = RecordReader::Data;
+
+  struct Options {
+    std::string compression;
+    // The size of the read buffer of every open file.
+    int64_t buffer_size = 16 * 1024 * 1024;
+    size_t parallelism = 4;
+    size_t readahead = 64;
+    bool shuffle = false;
+    uint64_t seed = 0;
+  };
+
+  InterleavedRecordReader(std::vector<std::string> paths, Options options);
+
+  ~InterleavedRecordReader();
+
+  // The path of the file of the last record read.
+  std::string path();
+
+  bool Read(Data* value);
+
+  // Reads up to count records, appending them to values. Returns the number
+  // of records read, fewer than count only at the end of the files.
+  size_t ReadBatch(size_t count, std::vector<Data>* values);
+
+ private:
+  struct FileState {
+    explicit FileState(size_t index) : index(index) {}
+
+    size_t index;
+    std::deque<Data> records;
+    bool done = false;
+    std::exception_ptr exptr;
+  };
+
+  // Requires mutex_. Starts the background reader of the next file, or
+  // returns nullptr if they have all been started.
+  std::shared_ptr<FileState> StartNextFile();
+
+  void ReadFile(std::shared_ptr<FileState> state);
+
+  // Requires mutex_, and a record (or the file end) to be available from the
+  // state. Returns false if the file is done, after replacing it with the
+  // next one (or removing it).
+  bool TakeRecord(size_t slot, Data* value);
+
+  bool ReadLocked(std::unique_lock<std::mutex>* lock, Data* value);
+
+  std::vector<std::string> paths_;
+  Options options_;
+  std::mutex mutex_;
+  std::condition_variable data_cv_;
+  std::condition_variable space_cv_;
+  size_t next_file_ = 0;
+  size_t cursor_ = 0;
+  size_t num_readers_ = 0;
+  bool stopping_ = false;
+  size_t last_file_ = 0;
+  std::vector<std::shared_ptr<FileState>> open_files_;
+};
+
 }  // namespace util
 }  // namespace xla
 
@@ -0,0 +1,211 @@
+#ifndef XLA_CLIENT_SHARDED_CACHE_H_
+#define XLA_CLIENT_SHARDED_CACHE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/cache_policy.h"
+
+namespace xla {
+namespace util {
+
+// Key and object cache meant for read mostly workloads, accessed by many
+// threads. The keys are split among independent shards, each one protected by
+// its own reader/writer lock, so that lookups neither serialize on a single
+// lock, nor write to shared state other than the shard lock itself.
+// Expiration uses the CLOCK approximation of LRU: a lookup only marks the
+// entry as referenced, and when a shard is full, the insertion sweeps the
+// shard entries, clearing the referenced marks, until it finds an entry whose
+// mark was not set, which gets evicted.
+// The API mirrors the one of the Cache class, without the byte size limits.
+// As every shard holds up to max_size / num_shards objects, the eviction is
+// per shard, and the cache might evict before holding max_size objects.
+// Only the name of the CacheOptions applies: the TinyLFU admission would need
+// the lookups, which only take the reader lock, to update the sketch.
+template <typename K, typename T, typename H = std::hash<K>,
+          typename E = std::equal_to<K>>
+class ShardedCache {
+ public:
+  using TypePtr = std::shared_ptr<T>;
+
+  // The number of shards gets rounded up to a power of two.
+  explicit ShardedCache(size_t max_size, size_t num_shards = 16,
+                        const CacheOptions& options = CacheOptions())
+      : counters_(options.name) {
+    size_t shards = 1;
+    while (shards < num_shards) {
+      shards *= 2;
+    }
+    shard_mask_ = shards - 1;
+    size_t shard_size = std::max<size_t>((max_size + shards - 1) / shards, 1);
+    for (size_t i = 0; i < shards; ++i) {
+      shards_.emplace_back(new Shard(shard_size));
+    }
+  }
+
+  // Adds an object to the cache, unless it already exists, in which case the
+  // existing object is returned.
+  TypePtr Add(K key, TypePtr object) {
+    Shard* shard = GetShard(key);
+    std::lock_guard<std::shared_timed_mutex> lock(shard->lock);
+    auto it = shard->elements.find(key);
+    if (it != shard->elements.end()) {
+      it->second.referenced.store(true, std::memory_order_relaxed);
+      return it->second.object;
+    }
+    if (shard->clock.size() >= shard->max_size) {
+      EvictOne(shard);
+      shard->evictions += 1;
+      counters_.Eviction();
+    }
+    it = shard->elements
+             .emplace(std::piecewise_construct,
+                      std::forward_as_tuple(std::move(key)),
+                      std::forward_as_tuple(std::move(object),
+                                            shard->clock.size()))
+             .first;
+    shard->clock.push_back(&*it);
+    return it->second.object;
+  }
+
+  // Retrieves the existing object if it exists, marking it as referenced.
+  // Returns nullptr if no object with the specified key is found within the
+  // cache.
+  TypePtr Get(const K& key) {
+    Shard* shard = GetShard(key);
+    std::shared_lock<std::shared_timed_mutex> lock(shard->lock);
+    auto it = shard->elements.find(key);
+    if (it == shard->elements.end()) {
+      shard->misses.fetch_add(1, std::memory_order_relaxed);
+      counters_.Miss();
+      return nullptr;
+    }
+    shard->hits.fetch_add(1, std::memory_order_relaxed);
+    counters_.Hit();
+    // Avoid dirtying the cache line if the mark is already set.
+    if (!it->second.referenced.load(std::memory_order_relaxed)) {
+      it->second.referenced.store(true, std::memory_order_relaxed);
+    }
+    return it->second.object;
+  }
+
+  bool Erase(const K& key) {
+    Shard* shard = GetShard(key);
+    std::lock_guard<std::shared_timed_mutex> lock(shard->lock);
+    auto it = shard->elements.find(key);
+    if (it == shard->elements.end()) {
+      return false;
+    }
+    Remove(shard, it->second.slot);
+    return true;
+  }
+
+  void Clear() {
+    for (auto& shard : shards_) {
+      std::lock_guard<std::shared_timed_mutex> lock(shard->lock);
+      shard->clock.clear();
+      shard->elements.clear();
+      shard->hand = 0;
+    }
+  }
+
+  // Returns the number of objects within the cache.
+  size_t Size() {
+    size_t size = 0;
+    for (auto& shard : shards_) {
+      std::shared_lock<std::shared_timed_mutex> lock(shard->lock);
+      size += shard->clock.size();
+    }
+    return size;
+  }
+
+  CacheStats GetStats() {
+    CacheStats stats;
+    for (auto& shard : shards_) {
+      std::shared_lock<std::shared_timed_mutex> lock(shard->lock);
+      stats.hits += shard->hits.load(std::memory_order_relaxed);
+      stats.misses += shard->misses.load(std::memory_order_relaxed);
+      stats.evictions += shard->evictions;
+    }
+    return stats;
+  }
+
+ private:
+  struct Element {
+    Element(TypePtr object, size_t slot)
+        : object(std::move(object)), slot(slot) {}
+
+    TypePtr object;
+    // The position of the element within the shard clock.
+    size_t slot = 0;
+    std::atomic<bool> referenced{false};
+  };
+
+  using ElementMap = std::unordered_map<K, Element, H, E>;
+
+  struct Shard {
+    explicit Shard(size_t max_size) : max_size(max_size) {}
+
+    std::shared_timed_mutex lock;
+    size_t max_size = 0;
+    size_t hand = 0;
+    // The lookups only hold the reader lock, so their counts are atomic.
+    std::atomic<int64_t> hits{0};
+    std::atomic<int64_t> misses{0};
+    int64_t evictions = 0;
+    ElementMap elements;
+    // The map nodes are stable, so the clock can point straight into them.
+    std::vector<typename ElementMap::value_type*> clock;
+  };
+
+  Shard* GetShard(const K& key) const {
+    // The element maps use the low bits of the hash, so the shard is picked
+    // from the high bits of a mixed version of it.
+    uint64_t hash = static_cast<uint64_t>(hasher_(key));
+    hash *= 0x9e3779b97f4a7c15ULL;
+    return shards_[(hash >> 40) & shard_mask_].get();
+  }
+
+  void EvictOne(Shard* shard) {
+    while (true) {
+      if (shard->hand >= shard->clock.size()) {
+        shard->hand = 0;
+      }
+      Element& element = shard->clock[shard->hand]->second;
+      if (!element.referenced.exchange(false, std::memory_order_relaxed)) {
+        break;
+      }
+      ++shard->hand;
+    }
+    Remove(shard, shard->hand);
+  }
+
+  void Remove(Shard* shard, size_t slot) {
+    auto* node = shard->clock[slot];
+    auto* last = shard->clock.back();
+    shard->clock[slot] = last;
+    last->second.slot = slot;
+    shard->clock.pop_back();
+    // Erase by iterator, as the key reference lives within the erased node.
+    shard->elements.erase(shard->elements.find(node->first));
+  }
+
+  H hasher_;
+  CacheCounters counters_;
+  size_t shard_mask_ = 0;
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace util
+}  // namespace xla
+
+#endif  // XLA_CLIENT_SHARDED_CACHE_H_
@@ -0,0 +1,149 @@
+#include "tensorflow/compiler/xla/xla_client/staging_buffer_pool.h"
+
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/numa_topology.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace xla {
+namespace {
+
+// Large enough for any vectorized access to the staged data.
+static const size_t kBufferAlignment = 64;
+
+}  // namespace
+
+StagingBufferPool* StagingBufferPool::Get() {
+  static StagingBufferPool* pool = new StagingBufferPool(
+      sys_util::GetEnvInt("XLA_STAGING_POOL_MAXSIZE", 1000000000),
+      sys_util::GetEnvBool("XLA_STAGING_POOL_MLOCK", false));
+  return pool;
+}
+
+StagingBufferPool::StagingBufferPool(size_t max_size, bool page_lock)
+    : max_size_(max_size), page_lock_(page_lock) {}
+
+StagingBufferPool::~StagingBufferPool() {
+  for (auto& size_buffers : buffers_) {
+    for (auto& buffer : size_buffers.second) {
+      FreeBuffer(buffer.data, size_buffers.first);
+    }
+  }
+}
+
+size_t StagingBufferPool::GetSizeClass(size_t size) {
+  size = std::max<size_t>(size, kBufferAlignment);
+  // Four size classes for every power of two, which bounds the waste to 25%.
+  size_t top_bit = sizeof(size_t) * 8 - 1 - __builtin_clzl(size);
+  size_t step = top_bit >= 2 ? size_t(1) << (top_bit - 2) : 1;
+  step = std::max(step, kBufferAlignment);
+  return (size + step - 1) / step * step;
+}
+
+std::shared_ptr<char> StagingBufferPool::Acquire(size_t size) {
+  size_t size_class = GetSizeClass(size);
+  Buffer buffer = {nullptr,
+                   numa::IsAffinityEnabled() ? numa::GetCurrentNode() : -1};
+  bool remote = false;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = buffers_.find(size_class);
+    if (it != buffers_.end()) {
+      // The most recently released buffer of the node, or of any node if the
+      // node has none.
+      auto buffer_it = std::find_if(
+          it->second.rbegin(), it->second.rend(),
+          [&](const Buffer& cached) {
+            return cached.numa_node == buffer.numa_node;
+          });
+      remote = buffer_it == it->second.rend();
+      if (remote) {
+        buffer_it = it->second.rbegin();
+      }
+      buffer = *buffer_it;
+      it->second.erase(std::next(buffer_it).base());
+      if (it->second.empty()) {
+        buffers_.erase(it);
+      }
+      cached_size_ -= size_class;
+    }
+  }
+  if (buffer.data != nullptr) {
+    XLA_COUNTER("StagingBufferHit", 1);
+    if (remote) {
+      XLA_COUNTER("StagingBufferRemoteNode", 1);
+    }
+  } else {
+    XLA_COUNTER("StagingBufferMiss", 1);
+    buffer.data = NewBuffer(size_class);
+  }
+  return std::shared_ptr<char>(
+      buffer.data, [this, size_class, numa_node = buffer.numa_node](char* ptr) {
+        Release({ptr, numa_node}, size_class);
+      });
+}
+
+size_t StagingBufferPool::GetCachedBytes() {
+  std::lock_guard<std::mutex> lock(lock_);
+  return cached_size_;
+}
+
+char* StagingBufferPool::NewBuffer(size_t size) {
+  char* buffer =
+      reinterpret_cast<char*>(::aligned_alloc(kBufferAlignment, size));
+  XLA_CHECK(buffer != nullptr) << "Unable to allocate " << size << " bytes";
+  if (page_lock_ && mlock(buffer, size) != 0) {
+    static bool warned = false;
+    if (!warned) {
+      warned = true;
+      TF_LOG(WARNING) << "Unable to page-lock staging buffers ("
+                      << std::strerror(errno)
+                      << "), check the RLIMIT_MEMLOCK limit";
+    }
+  }
+  return buffer;
+}
+
+void StagingBufferPool::FreeBuffer(char* buffer, size_t size) {
+  if (page_lock_) {
+    munlock(buffer, size);
+  }
+  std::free(buffer);
+}
+
+void StagingBufferPool::Release(Buffer buffer, size_t size) {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    // Evict the largest unused buffers until the new one fits, as those are
+    // the most expensive to keep around.
+    while (cached_size_ + size > max_size_ && !buffers_.empty()) {
+      auto it = std::prev(buffers_.end());
+      if (it->first < size) {
+        break;
+      }
+      FreeBuffer(it->second.back().data, it->first);
+      cached_size_ -= it->first;
+      it->second.pop_back();
+      if (it->second.empty()) {
+        buffers_.erase(it);
+      }
+    }
+    if (cached_size_ + size <= max_size_) {
+      buffers_[size].push_back(buffer);
+      cached_size_ += size;
+      return;
+    }
+  }
+  FreeBuffer(buffer.data, size);
+}
+
+}  // namespace xla
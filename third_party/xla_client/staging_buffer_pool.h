@@ -0,0 +1,63 @@
+#ifndef XLA_CLIENT_STAGING_BUFFER_POOL_H_
+#define XLA_CLIENT_STAGING_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace xla {
+
+// A pool of host buffers used to stage the data of the tensors being uploaded
+// to the devices. Input pipelines upload the same shapes at every step, so
+// recycling the buffers avoids paying the allocation and page faulting costs
+// on the critical path. Buffer sizes are rounded up to size classes (four per
+// power of two), so that similar sizes can share buffers. With
+// XLA_NUMA_AFFINITY set, the buffers are recycled preferably on the NUMA node
+// of the thread which first acquired them (and so first touched their pages).
+class StagingBufferPool {
+ public:
+  // Returns the pool singleton, configured by the XLA_STAGING_POOL_MAXSIZE and
+  // XLA_STAGING_POOL_MLOCK environment variables.
+  static StagingBufferPool* Get();
+
+  // Creates a pool retaining at most max_size bytes of unused buffers. If
+  // page_lock is true, the buffers are locked in memory with mlock(), so that
+  // the device DMA engines do not hit non-resident pages.
+  StagingBufferPool(size_t max_size, bool page_lock);
+
+  ~StagingBufferPool();
+
+  // Returns a buffer of at least size bytes. The buffer returns to the pool
+  // once the last reference to it is dropped.
+  std::shared_ptr<char> Acquire(size_t size);
+
+  // Returns the number of bytes held by the unused buffers within the pool.
+  size_t GetCachedBytes();
+
+  static size_t GetSizeClass(size_t size);
+
+ private:
+  struct Buffer {
+    char* data;
+    int numa_node;
+  };
+
+  char* NewBuffer(size_t size);
+
+  void FreeBuffer(char* buffer, size_t size);
+
+  void Release(Buffer buffer, size_t size);
+
+  size_t max_size_;
+  bool page_lock_;
+  std::mutex lock_;
+  size_t cached_size_ = 0;
+  // The unused buffers, by size class.
+  std::map<size_t, std::vector<Buffer>> buffers_;
+};
+
+}  // namespace xla
+
+#endif  // XLA_CLIENT_STAGING_BUFFER_POOL_H_
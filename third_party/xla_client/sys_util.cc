@@ -1,8 +1,11 @@
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 
+#include <unistd.h>
+
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
+#include <fstream>
 
 #include "absl/strings/str_cat.h"
 
@@ -57,5 +60,16 @@ int64_t NowNs() {
       .count();
 }
 
+int64_t GetResidentMemoryBytes() {
+  // The second field of statm is the number of resident pages.
+  std::ifstream statm("/proc/self/statm");
+  int64_t size_pages = 0;
+  int64_t resident_pages = 0;
+  if (!(statm >> size_pages >> resident_pages)) {
+    return -1;
+  }
+  return resident_pages * static_cast<int64_t>(sysconf(_SC_PAGESIZE));
+}
+
 }  // namespace sys_util
 }  // namespace xla
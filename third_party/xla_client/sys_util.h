@@ -23,6 +23,10 @@ bool GetEnvBool(const char* name, bool defval);
 // Retrieves the current EPOCH time in nanoseconds.
 int64_t NowNs();
 
+// Retrieves the resident set size of the process in bytes, or -1 if not
+// available on the platform.
+int64_t GetResidentMemoryBytes();
+
 }  // namespace sys_util
 }  // namespace xla
 
@@ -1,119 +1,384 @@
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 
+#include <algorithm>
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <exception>
 #include <mutex>
+#include <string>
+#include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/numa_topology.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 
 namespace xla {
 namespace env {
-namespace {
 
+// A work stealing pool. Every worker has its own deque, where the closures it
+// schedules go, and which it runs from the back, while the closures scheduled
+// from the other threads go to a shared queue. The idle workers steal from the
+// front of the deques of the others. The pool starts with num_threads workers,
+// and starts more of them, up to max_threads, to keep num_threads of them
+// running while some are blocked in a ScopedBlockingRegion. For the pools of
+// the closures which block on IO, every running closure counts as blocked.
+// The workers never go away, so the threads get reused across the bursts.
+// The workers of the pools of a NUMA node are pinned to the CPUs of the node.
 class ThreadPool {
  public:
-  explicit ThreadPool(size_t num_threads) {
-    threads_.reserve(num_threads);
-    for (size_t i = 0; i < num_threads; ++i) {
-      threads_.emplace_back([this]() { Worker(); });
+  ThreadPool(const std::string& name, size_t num_threads, size_t max_threads,
+             bool blocking_closures, int numa_node = -1)
+      : num_threads_(std::max<size_t>(num_threads, 1)),
+        max_threads_(std::max(max_threads, num_threads_)),
+        blocking_closures_(blocking_closures),
+        numa_node_(numa_node),
+        queues_(max_threads_),
+        queue_depth_(absl::StrCat(name, "QueueDepth"), metrics::MetricFnValue),
+        steals_(absl::StrCat(name, "Steals")),
+        compensations_(absl::StrCat(name, "Compensations")),
+        saturations_(absl::StrCat(name, "Saturated")) {
+    for (auto& queue : queues_) {
+      queue = std::make_unique<WorkerQueue>();
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < num_threads_; ++i) {
+      StartWorker();
     }
   }
 
   ~ThreadPool() {
+    std::vector<std::thread> threads;
     {
       std::lock_guard<std::mutex> lock(mutex_);
       exiting_ = true;
       cv_.notify_all();
+      threads.swap(threads_);
     }
-    for (auto& thread : threads_) {
+    for (auto& thread : threads) {
       thread.join();
     }
   }
 
   void Schedule(std::function<void()> closure) {
-    // If we have more work scheduled than waiting worker threads, just schedule
-    // it on a separate thread. This prevents tricky thread-pool-size-deadlocks
-    // caused by an undersized thread pool and closures that end up doing sync
-    // waits on the pool threads.
-    bool scheduled = false;
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      if (work_.size() < waiting_) {
-        work_.emplace_back(std::move(closure));
-        scheduled = true;
-      }
+    WorkerState* state = GetWorkerState();
+    if (state->pool == this) {
+      WorkerQueue* queue = queues_[state->index].get();
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->work.push_back(std::move(closure));
+    } else {
+      std::lock_guard<std::mutex> lock(injector_.mutex);
+      injector_.work.push_back(std::move(closure));
     }
-    if (scheduled) {
+    // Counted once visible, so that a worker seeing it pending also finds it.
+    size_t pending = pending_.fetch_add(1) + 1;
+    queue_depth_.AddSample(pending);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (idle_ > 0) {
       cv_.notify_one();
     } else {
-      ScheduleOnThread(std::move(closure));
+      MaybeStartWorker();
     }
   }
 
+  // Called by the workers of the pool only, where the nested blocking
+  // regions count once.
+  void EnterBlocking() {
+    if (GetWorkerState()->blocking++ > 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++blocked_;
+    if (pending_.load() > 0 && idle_ == 0) {
+      MaybeStartWorker();
+    }
+  }
+
+  void ExitBlocking() {
+    if (--GetWorkerState()->blocking > 0) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    --blocked_;
+  }
+
+  static ThreadPool* GetCurrent() { return GetWorkerState()->pool; }
+
+  size_t GetNumThreads() const { return num_threads_; }
+
+  int GetNumaNode() const { return numa_node_; }
+
  private:
-  void Worker() {
-    while (true) {
-      std::function<void()> closure = GetWork();
-      if (closure == nullptr) {
-        break;
-      }
-      try {
-        closure();
-      } catch (const std::exception& ex) {
-        XLA_COUNTER("ThreadPoolException", 1);
-        TF_LOG(ERROR) << "Exception from running thread pool closure: "
-                      << ex.what();
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> work;
+  };
+
+  // The pool and the queue index of the calling thread, if a worker.
+  struct WorkerState {
+    ThreadPool* pool = nullptr;
+    size_t index = 0;
+    // The depth of the blocking regions the worker is in.
+    size_t blocking = 0;
+  };
+
+  static WorkerState* GetWorkerState() {
+    static thread_local WorkerState state;
+    return &state;
+  }
+
+  // Requires mutex_.
+  void StartWorker() {
+    size_t index = threads_.size();
+    threads_.emplace_back([this, index]() { Worker(index); });
+    num_workers_.store(threads_.size());
+  }
+
+  // Requires mutex_. Called when no worker is idle.
+  void MaybeStartWorker() {
+    size_t running = threads_.size() - blocked_;
+    if (!blocking_closures_ && running >= num_threads_) {
+      return;
+    }
+    if (threads_.size() >= max_threads_) {
+      // The closures queue up behind the blocked ones.
+      saturations_.AddValue(1);
+      return;
+    }
+    compensations_.AddValue(1);
+    StartWorker();
+  }
+
+  bool PopBack(WorkerQueue* queue, std::function<void()>* closure) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->work.empty()) {
+      return false;
+    }
+    *closure = std::move(queue->work.back());
+    queue->work.pop_back();
+    pending_.fetch_sub(1);
+    return true;
+  }
+
+  bool PopFront(WorkerQueue* queue, std::function<void()>* closure) {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    if (queue->work.empty()) {
+      return false;
+    }
+    *closure = std::move(queue->work.front());
+    queue->work.pop_front();
+    pending_.fetch_sub(1);
+    return true;
+  }
+
+  bool TryGetWork(size_t index, std::function<void()>* closure) {
+    if (PopBack(queues_[index].get(), closure) ||
+        PopFront(&injector_, closure)) {
+      return true;
+    }
+    size_t num_workers = num_workers_.load();
+    for (size_t i = 1; i < num_workers; ++i) {
+      if (PopFront(queues_[(index + i) % num_workers].get(), closure)) {
+        steals_.AddValue(1);
+        return true;
       }
     }
+    return false;
   }
 
-  void ScheduleOnThread(std::function<void()> closure) {
-    std::thread thread(std::move(closure));
-    thread.detach();
+  void Worker(size_t index) {
+    WorkerState* state = GetWorkerState();
+    state->pool = this;
+    state->index = index;
+    if (numa_node_ >= 0 && !numa::PinCurrentThread(numa_node_)) {
+      TF_LOG(WARNING) << "Unable to pin thread pool worker to NUMA node "
+                      << numa_node_;
+    }
+    while (true) {
+      std::function<void()> closure;
+      if (TryGetWork(index, &closure)) {
+        Run(closure);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mutex_);
+      ++idle_;
+      cv_.wait(lock, [this] { return exiting_ || pending_.load() > 0; });
+      --idle_;
+      if (exiting_ && pending_.load() == 0) {
+        break;
+      }
+    }
   }
 
-  std::function<void()> GetWork() {
-    std::unique_lock<std::mutex> lock(mutex_);
-    ++waiting_;
-    cv_.wait(lock, [this] { return exiting_ || !work_.empty(); });
-    --waiting_;
-    if (work_.empty()) {
-      return nullptr;
+  void Run(const std::function<void()>& closure) {
+    if (blocking_closures_) {
+      EnterBlocking();
+    }
+    try {
+      closure();
+    } catch (const std::exception& ex) {
+      XLA_COUNTER("ThreadPoolException", 1);
+      TF_LOG(ERROR) << "Exception from running thread pool closure: "
+                    << ex.what();
+    }
+    if (blocking_closures_) {
+      ExitBlocking();
     }
-    std::function<void()> closure(std::move(work_.front()));
-    work_.pop_front();
-    return closure;
   }
 
-  std::vector<std::thread> threads_;
+  const size_t num_threads_;
+  const size_t max_threads_;
+  const bool blocking_closures_;
+  const int numa_node_;
+  // One per possible worker, so that they never move while being stolen from.
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  WorkerQueue injector_;
+  std::atomic<size_t> num_workers_{0};
+  std::atomic<size_t> pending_{0};
   std::mutex mutex_;
   std::condition_variable cv_;
   bool exiting_ = false;
-  std::deque<std::function<void()>> work_;
-  size_t waiting_ = 0;
+  std::vector<std::thread> threads_;
+  size_t idle_ = 0;
+  size_t blocked_ = 0;
+  metrics::Metric queue_depth_;
+  metrics::Counter steals_;
+  metrics::Counter compensations_;
+  metrics::Counter saturations_;
+};
+
+namespace {
+
+// The NUMA node set by the innermost ScopedNumaNode of the thread, if any.
+thread_local int g_numa_node = -1;
+
+// Returns the NUMA node whose pools the closures scheduled by the calling
+// thread go to, or -1 for the default pools. The pool workers schedule to the
+// pools of their own node, so that the nested closures stay on it.
+int GetSchedulingNode() {
+  if (!numa::IsAffinityEnabled()) {
+    return -1;
+  }
+  if (g_numa_node >= 0) {
+    return g_numa_node;
+  }
+  ThreadPool* pool = ThreadPool::GetCurrent();
+  return pool != nullptr ? pool->GetNumaNode() : -1;
+}
+
+// The pools of one kind, the default one with all its threads, and the ones of
+// the NUMA nodes, with a share of the threads proportional to the CPUs of
+// their node.
+class PoolSet {
+ public:
+  PoolSet(std::string name, size_t num_threads, size_t max_threads,
+          bool blocking_closures)
+      : name_(std::move(name)),
+        num_threads_(num_threads),
+        max_threads_(max_threads),
+        blocking_closures_(blocking_closures) {}
+
+  ThreadPool* GetPool(int numa_node) {
+    if (numa_node < 0) {
+      std::call_once(default_once_, [this]() {
+        default_pool_ = std::make_unique<ThreadPool>(
+            name_, num_threads_, max_threads_, blocking_closures_);
+      });
+      return default_pool_.get();
+    }
+    std::call_once(node_once_, [this]() { CreateNodePools(); });
+    ThreadPool* pool = numa_node < static_cast<int>(node_pools_.size())
+                           ? node_pools_[numa_node].get()
+                           : nullptr;
+    return pool != nullptr ? pool : GetPool(-1);
+  }
+
+ private:
+  void CreateNodePools() {
+    const numa::Topology* topology = numa::Topology::Get();
+    node_pools_.resize(topology->GetNumNodes());
+    for (size_t node = 0; node < topology->GetNumNodes(); ++node) {
+      size_t node_cpus = topology->GetNodeCpus(node).size();
+      if (node_cpus == 0) {
+        continue;
+      }
+      size_t total_cpus = std::max<size_t>(topology->GetNumCpus(), 1);
+      node_pools_[node] = std::make_unique<ThreadPool>(
+          absl::StrCat(name_, "Node", node),
+          std::max<size_t>(num_threads_ * node_cpus / total_cpus, 1),
+          std::max<size_t>(max_threads_ * node_cpus / total_cpus, 1),
+          blocking_closures_, node);
+    }
+  }
+
+  const std::string name_;
+  const size_t num_threads_;
+  const size_t max_threads_;
+  const bool blocking_closures_;
+  std::once_flag default_once_;
+  std::unique_ptr<ThreadPool> default_pool_;
+  std::once_flag node_once_;
+  std::vector<std::unique_ptr<ThreadPool>> node_pools_;
 };
 
 ThreadPool* GetThreadPool() {
   static size_t num_threads = sys_util::GetEnvInt(
       "XLA_THREAD_POOL_SIZE", std::thread::hardware_concurrency());
-  static ThreadPool* pool = new ThreadPool(num_threads);
-  return pool;
+  static PoolSet* pools = new PoolSet(
+      "ThreadPool", num_threads,
+      sys_util::GetEnvInt("XLA_THREAD_POOL_MAX_SIZE", 4 * num_threads),
+      /*blocking_closures=*/false);
+  return pools->GetPool(GetSchedulingNode());
 }
 
 ThreadPool* GetIoThreadPool() {
   static size_t num_threads = sys_util::GetEnvInt(
       "XLA_IO_THREAD_POOL_SIZE", std::thread::hardware_concurrency());
-  static ThreadPool* pool = new ThreadPool(num_threads);
-  return pool;
+  static PoolSet* pools = new PoolSet(
+      "IoThreadPool", num_threads,
+      sys_util::GetEnvInt("XLA_IO_THREAD_POOL_MAX_SIZE", 16 * num_threads),
+      /*blocking_closures=*/true);
+  return pools->GetPool(GetSchedulingNode());
+}
+
+ThreadPool* GetCopyThreadPool() {
+  static size_t num_threads = sys_util::GetEnvInt(
+      "XLA_COPY_THREAD_POOL_SIZE", std::thread::hardware_concurrency());
+  static PoolSet* pools = new PoolSet("CopyThreadPool", num_threads,
+                                      num_threads, /*blocking_closures=*/false);
+  return pools->GetPool(GetSchedulingNode());
 }
 
 }  // namespace
 
+ScopedBlockingRegion::ScopedBlockingRegion()
+    : pool_(ThreadPool::GetCurrent()) {
+  if (pool_ != nullptr) {
+    pool_->EnterBlocking();
+  }
+}
+
+ScopedBlockingRegion::~ScopedBlockingRegion() {
+  if (pool_ != nullptr) {
+    pool_->ExitBlocking();
+  }
+}
+
+ScopedNumaNode::ScopedNumaNode(int numa_node) : prev_numa_node_(g_numa_node) {
+  if (numa_node >= 0) {
+    g_numa_node = numa_node;
+  }
+}
+
+ScopedNumaNode::~ScopedNumaNode() { g_numa_node = prev_numa_node_; }
+
 class Completion::Data {
  public:
   void Wait() {
+    ScopedBlockingRegion blocking;
     std::unique_lock<std::mutex> lock(mutex_);
     cv_.wait(lock, [this] { return completed_; });
     if (exptr_ != nullptr) {
@@ -163,6 +428,12 @@ void ScheduleIoClosure(std::function<void()> closure) {
   GetIoThreadPool()->Schedule(std::move(closure));
 }
 
+void ScheduleCopyClosure(std::function<void()> closure) {
+  GetCopyThreadPool()->Schedule(std::move(closure));
+}
+
+size_t GetCopyThreadPoolSize() { return GetCopyThreadPool()->GetNumThreads(); }
+
 Completion ScheduleClosureWithCompletion(std::function<void()> closure) {
   auto data = std::make_shared<Completion::Data>();
   GetThreadPool()->Schedule(
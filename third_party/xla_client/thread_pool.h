@@ -8,6 +8,8 @@
 namespace xla {
 namespace env {
 
+class ThreadPool;
+
 class Completion {
  public:
   class Data;
@@ -22,8 +24,35 @@ class Completion {
   std::shared_ptr<Data> data_;
 };
 
+// Marks the scope of the calling thread as blocked waiting for other closures
+// or events. A pool worker blocked in it does not count as running, and the
+// pool starts more workers, up to its maximum, to run the queued closures in
+// the meantime. Outside of the pool workers it does nothing.
+class ScopedBlockingRegion {
+ public:
+  ScopedBlockingRegion();
+
+  ~ScopedBlockingRegion();
+
+ private:
+  ThreadPool* pool_;
+};
+
+// Routes the closures scheduled by the calling thread within the scope to the
+// pools whose workers are pinned to the CPUs of the NUMA node, if
+// XLA_NUMA_AFFINITY is set. A negative node keeps the current routing.
+class ScopedNumaNode {
+ public:
+  explicit ScopedNumaNode(int numa_node);
+
+  ~ScopedNumaNode();
+
+ private:
+  int prev_numa_node_;
+};
+
 // Schedules a closure to be run. The closure should not block waiting for other
-// events.
+// events, but within a ScopedBlockingRegion.
 void ScheduleClosure(std::function<void()> closure);
 Completion ScheduleClosureWithCompletion(std::function<void()> closure);
 
@@ -31,6 +60,14 @@ Completion ScheduleClosureWithCompletion(std::function<void()> closure);
 void ScheduleIoClosure(std::function<void()> closure);
 Completion ScheduleIoClosureWithCompletion(std::function<void()> closure);
 
+// Schedules a closure running a host memory copy. Copies run on a dedicated
+// pool, so that they do not compete with the ScheduleClosure() ones.
+void ScheduleCopyClosure(std::function<void()> closure);
+
+// Returns the number of threads of the pool used by ScheduleCopyClosure(),
+// from the calling thread.
+size_t GetCopyThreadPoolSize();
+
 }  // namespace env
 }  // namespace xla
 
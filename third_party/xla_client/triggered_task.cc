@@ -1,14 +1,31 @@
 #include "tensorflow/compiler/xla/xla_client/triggered_task.h"
 
+#include <algorithm>
+
 namespace xla {
 namespace util {
 
 TriggeredTask::TriggeredTask(std::function<void()> function, size_t num_threads)
-    : function_(std::move(function)), running_(num_threads) {
+    : TriggeredTask(std::move(function), [num_threads]() {
+        Options options;
+        options.num_threads = num_threads;
+        return options;
+      }()) {}
+
+TriggeredTask::TriggeredTask(std::function<void()> function, Options options)
+    : function_(std::move(function)),
+      options_(std::move(options)),
+      running_(options_.num_threads),
+      concurrency_(options_.adaptive_concurrency ? 1 : options_.num_threads) {
+  if (!options_.name.empty()) {
+    runs_counter_ = std::make_unique<metrics::Counter>(options_.name + "Runs");
+    coalesced_counter_ = std::make_unique<metrics::Counter>(
+        options_.name + "CoalescedActivations");
+  }
   // We set running_ to num_threads because until the threads reach the
   // condition wait point (the cv_.wait() call) in the Runner() function, they
   // are effectively running.
-  for (size_t i = 0; i < num_threads; ++i) {
+  for (size_t i = 0; i < options_.num_threads; ++i) {
     threads_.emplace_back(new std::thread([this]() { Runner(); }));
   }
 }
@@ -25,17 +42,28 @@ void TriggeredTask::Stop() {
   }
 }
 
-size_t TriggeredTask::Activate() {
+size_t TriggeredTask::Activate(bool urgent) {
   bool notify = false;
+  bool coalesced = false;
   size_t run_id;
   {
     std::lock_guard<std::mutex> lock(mutex_);
-    notify = !activated_;
+    coalesced = activated_;
+    // An already pending activation only needs a wakeup if it turns urgent,
+    // as the runner waiting for its deadline has to recompute it.
+    notify = !activated_ || (urgent && !urgent_);
+    if (!activated_) {
+      activation_time_ = Clock::now();
+    }
     activated_ = true;
+    urgent_ = urgent_ || urgent;
     run_id = run_id_ + running_;
   }
+  if (coalesced && coalesced_counter_ != nullptr) {
+    coalesced_counter_->AddValue(1);
+  }
   if (notify) {
-    cv_.notify_one();
+    cv_.notify_all();
   }
   return run_id;
 }
@@ -43,12 +71,23 @@ size_t TriggeredTask::Activate() {
 size_t TriggeredTask::WaitForRun(size_t run_id) {
   std::unique_lock<std::mutex> lock(mutex_);
   ++run_waiters_;
+  // Cuts the wait of a pending activation for its deadline.
+  cv_.notify_all();
   run_cv_.wait(lock, [this, run_id] { return run_id_ > run_id || stopped_; });
   --run_waiters_;
   return run_id_;
 }
 
+TriggeredTask::Clock::time_point TriggeredTask::RunDeadline() const {
+  Clock::time_point deadline = last_run_time_ + options_.min_interval;
+  if (!urgent_) {
+    deadline = std::max(deadline, activation_time_ + options_.max_delay);
+  }
+  return deadline;
+}
+
 void TriggeredTask::Runner() {
+  bool ran = false;
   while (true) {
     {
       std::unique_lock<std::mutex> lock(mutex_);
@@ -57,14 +96,40 @@ void TriggeredTask::Runner() {
         run_cv_.notify_all();
       }
       --running_;
-      cv_.wait(lock, [this] { return activated_ || stopped_; });
-      if (stopped_) {
-        break;
+      if (ran && options_.adaptive_concurrency) {
+        // An activation which arrived during the run means the runs do not
+        // keep up with the activations.
+        if (activated_) {
+          concurrency_ = std::min(concurrency_ + 1, options_.num_threads);
+        } else if (concurrency_ > 1) {
+          --concurrency_;
+        }
+      }
+      while (true) {
+        cv_.wait(lock, [this] {
+          return (activated_ && running_ < concurrency_) || stopped_;
+        });
+        if (stopped_) {
+          return;
+        }
+        Clock::time_point deadline = RunDeadline();
+        if (run_waiters_ > 0 || Clock::now() >= deadline) {
+          break;
+        }
+        // Another runner might take the activation, or an urgent activation
+        // move the deadline, by the time this wait returns.
+        cv_.wait_until(lock, deadline);
       }
       ++running_;
       activated_ = false;
+      urgent_ = false;
+      last_run_time_ = Clock::now();
+    }
+    if (runs_counter_ != nullptr) {
+      runs_counter_->AddValue(1);
     }
     function_();
+    ran = true;
   }
 }
 
@@ -1,51 +1,90 @@
 #ifndef XLA_CLIENT_TRIGGERED_TASK_H_
 #define XLA_CLIENT_TRIGGERED_TASK_H_
 
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+
 namespace xla {
 namespace util {
 
 // Wraps a function which should be run many times upon user activations.
+// The activations which happen before a run starts are coalesced into it.
 class TriggeredTask {
  public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    // The maximum number of concurrent runs of the function.
+    size_t num_threads = 1;
+    // The minimum time between the starts of two runs.
+    Clock::duration min_interval = Clock::duration::zero();
+    // How long a non urgent activation is held, waiting for more activations
+    // to coalesce with, before its run starts.
+    Clock::duration max_delay = Clock::duration::zero();
+    // If set, the number of concurrent runs starts from one, grows when the
+    // activations arrive faster than the runs complete, and shrinks back when
+    // a run completes with no pending activation.
+    bool adaptive_concurrency = false;
+    // If not empty, the <name>Runs and <name>CoalescedActivations counters
+    // account the runs of the task.
+    std::string name;
+  };
+
   // Note that if num_threads > 1, the function will be run concurrently from
   // multiple threads, so it will have to be thread safe. This condition does
   // not apply if num_threads is 1.
   TriggeredTask(std::function<void()> function, size_t num_threads);
 
+  TriggeredTask(std::function<void()> function, Options options);
+
   // Stops the background thread and waits for it to complete.
   void Stop();
 
   // Triggers a function run. If the function is already running, it will run
-  // again immediately after it completes. Returns tthe value of thte run-ID the
-  // caller should eventually wait with the WaitForRun() API, to be sure that a
-  // full function run happened after its Activate() call.
-  size_t Activate();
+  // again after it completes. Non urgent activations wait for max_delay
+  // before their run, urgent ones only for min_interval since the start of
+  // the previous run. Returns the value of the run-ID the caller should
+  // eventually wait with the WaitForRun() API, to be sure that a full
+  // function run happened after its Activate() call.
+  size_t Activate(bool urgent = false);
 
   // Wait until a run-ID returned by the Activate() API completed. Returns the
   // value of the current run-ID. If such value or less or equal to run_id, the
-  // wait did not complete successfully.
+  // wait did not complete successfully. The pending activations run without
+  // delay while there are waiters.
   size_t WaitForRun(size_t run_id);
 
  private:
   // Function implementing the main thread loop running the user function.
   void Runner();
 
+  // Returns the time at which the pending activation can start its run.
+  Clock::time_point RunDeadline() const;
+
   std::function<void()> function_;
+  Options options_;
+  std::unique_ptr<metrics::Counter> runs_counter_;
+  std::unique_ptr<metrics::Counter> coalesced_counter_;
   std::mutex mutex_;
   std::condition_variable cv_;
   std::condition_variable run_cv_;
   size_t run_id_ = 0;
   size_t run_waiters_ = 0;
   size_t running_ = 0;
+  size_t concurrency_ = 0;
   bool activated_ = false;
+  bool urgent_ = false;
   bool stopped_ = false;
+  Clock::time_point activation_time_;
+  Clock::time_point last_run_time_;
   std::vector<std::unique_ptr<std::thread>> threads_;
 };
 
@@ -1,11 +1,17 @@
 #include "tensorflow/compiler/xla/xla_client/xrt_computation_client.h"
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <functional>
 #include <limits>
 #include <list>
+#include <set>
 #include <sstream>
+#include <thread>
 #include <unordered_map>
 
 #include "absl/memory/memory.h"
@@ -13,10 +19,14 @@
 #include "absl/strings/str_join.h"
 #include "absl/strings/str_split.h"
 #include "tensorflow/cc/ops/const_op.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_client/env_vars.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/numa_topology.h"
+#include "tensorflow/compiler/xla/xla_client/staging_buffer_pool.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/unique.h"
@@ -224,6 +234,115 @@ T ParseProto(const tensorflow::Tensor& tensor) {
   return proto;
 }
 
+int64_t GetCompressionMinBytes() {
+  static int64_t min_bytes =
+      sys_util::GetEnvInt("XRT_GRPC_COMPRESSION_MIN_BYTES", 0);
+  return min_bytes;
+}
+
+// Returns whether the transfer of a tensor with the given shape should go
+// through a compressed session. Floating point payloads (weights, activations)
+// rarely compress enough to pay for the CPU cost, and small ones are dominated
+// by the RPC overhead, so only large non floating point ones are compressed.
+bool ShouldCompressTransfer(const Shape& shape) {
+  return !primitive_util::IsFloatingPointType(shape.element_type()) &&
+         !primitive_util::IsComplexType(shape.element_type()) &&
+         ShapeUtil::ByteSizeOfElements(shape) >= GetCompressionMinBytes();
+}
+
+void AddTransferBytes(const Shape& shape, bool compressed) {
+  int64_t size = ShapeUtil::ByteSizeOfElements(shape);
+  if (compressed) {
+    XLA_COUNTER("XrtCompressedTransferBytes", size);
+  } else {
+    XLA_COUNTER("XrtUncompressedTransferBytes", size);
+  }
+}
+
+int64_t GetBulkTransferMinBytes() {
+  static int64_t min_bytes =
+      sys_util::GetEnvInt("XRT_BULK_TRANSFER_MIN_BYTES", 1 << 20);
+  return min_bytes;
+}
+
+// Bounds the number of bulk transfer session runs in flight per worker target
+// (XRT_BULK_TRANSFER_CONCURRENCY), so that checkpoint sized transfers leave
+// the worker streams and threads to the executes. The time the transfers wait
+// for a slot goes into the XrtBulkTransferQueueTime metric.
+class BulkTransferSlot {
+ public:
+  explicit BulkTransferSlot(const std::string& target) : target_(target) {
+    if (MaxInFlight() <= 0) {
+      return;
+    }
+    static metrics::Metric* queue_metric = new metrics::Metric(
+        "XrtBulkTransferQueueTime", metrics::MetricFnTime);
+    metrics::TimedSection timed(queue_metric);
+    std::unique_lock<std::mutex> lock(*GetLock());
+    GetCondition()->wait(lock, [&]() {
+      return (*GetInFlight())[target_] < MaxInFlight();
+    });
+    (*GetInFlight())[target_] += 1;
+    acquired_ = true;
+  }
+
+  ~BulkTransferSlot() {
+    if (acquired_) {
+      std::lock_guard<std::mutex> lock(*GetLock());
+      (*GetInFlight())[target_] -= 1;
+      GetCondition()->notify_all();
+    }
+  }
+
+ private:
+  static int64_t MaxInFlight() {
+    static int64_t max_in_flight =
+        sys_util::GetEnvInt("XRT_BULK_TRANSFER_CONCURRENCY", 0);
+    return max_in_flight;
+  }
+
+  static std::mutex* GetLock() {
+    static std::mutex* lock = new std::mutex();
+    return lock;
+  }
+
+  static std::condition_variable* GetCondition() {
+    static std::condition_variable* cv = new std::condition_variable();
+    return cv;
+  }
+
+  static std::map<std::string, int64_t>* GetInFlight() {
+    static auto* in_flight = new std::map<std::string, int64_t>();
+    return in_flight;
+  }
+
+  std::string target_;
+  bool acquired_ = false;
+};
+
+// Returns the metric tracking the execute latency of a given worker.
+metrics::Metric* GetWorkerExecuteMetric(const std::string& worker) {
+  static std::mutex* lock = new std::mutex();
+  static auto* worker_metrics =
+      new std::map<std::string, std::unique_ptr<metrics::Metric>>();
+  std::lock_guard<std::mutex> guard(*lock);
+  auto it = worker_metrics->find(worker);
+  if (it == worker_metrics->end()) {
+    it = worker_metrics
+             ->emplace(worker, absl::make_unique<metrics::Metric>(
+                                   absl::StrCat("XrtExecuteWorker.", worker),
+                                   metrics::MetricFnTime))
+             .first;
+  }
+  return it->second.get();
+}
+
+bool CoalesceHandleReleases() {
+  static bool coalesce_releases =
+      sys_util::GetEnvBool("XRT_COALESCE_HANDLE_RELEASES", true);
+  return coalesce_releases;
+}
+
 int64_t GetMaxTensorsPartitionSize() {
   // We need to limit the amount of data we send to the XRT backend since
   // Protocol Buffers does not allow sizes greater than 2GB. We keep some margin
@@ -246,6 +365,7 @@ void XrtComputationClient::XrtData::Assign(const Data& data) {
   const XrtData& xrt_data = dynamic_cast<const XrtData&>(data);
   if (&xrt_data != this) {
     handle_ptr = xrt_data.handle_ptr;
+    set_quota_charge(xrt_data.quota_charge());
   }
 }
 
@@ -254,13 +374,27 @@ XrtComputationClient::XrtComputationClient(
     std::unique_ptr<tensorflow::tpu::TopologyProto> topology_proto)
     : options_(std::move(options)),
       compilation_cache_(sys_util::GetEnvInt("XLA_COMPILATION_CACHE_SIZE", 64)),
-      rng_seed_(0x5a2d296e9) {
+      rng_seed_(0x5a2d296e9),
+      chained_exec_stats_(1024) {
   tensorflow::ConfigProto config = CreateConfigProto(options_);
   std::string local_target = GetLocalTarget(options_);
+  local_target_ = local_target;
+  // With a minimum compression size set, the regular sessions do not compress,
+  // and transfers selected by ShouldCompressTransfer() go through dedicated
+  // compressed sessions instead.
+  bool compress_all = GetCompressionMinBytes() <= 0;
   session_cache_ = absl::make_unique<XrtSessionCache>(
-      config, [this](XrtSession* s) { InitSession(s); }, local_target);
-  alloc_session_cache_ =
-      absl::make_unique<XrtSessionCache>(config, nullptr, local_target);
+      config, [this](XrtSession* s) { InitSession(s); }, local_target,
+      compress_all);
+  alloc_session_cache_ = absl::make_unique<XrtSessionCache>(
+      config, nullptr, local_target, compress_all,
+      /*dedicated_connections=*/true);
+  if (!compress_all &&
+      !sys_util::GetEnvString("XRT_GRPC_COMPRESSION", "").empty()) {
+    compressed_session_cache_ = absl::make_unique<XrtSessionCache>(
+        config, nullptr, local_target, /*compress=*/true,
+        /*dedicated_connections=*/true);
+  }
 
   auto default_device_target =
       options_.global_device_map.find(options_.default_device);
@@ -287,10 +421,68 @@ XrtComputationClient::XrtComputationClient(
   if (ShouldStartLocalService(options_.devices)) {
     MaybeCreateLocalService(options_);
   }
-  InitializeDevices(std::move(topology_proto));
+  if (sys_util::GetEnvBool("XRT_ASYNC_INIT", true)) {
+    // The TPU system configuration and the mesh service setup run in the
+    // background, so that the process can go on tracing (which only needs the
+    // device names) until the first operation needing a session waits for
+    // them.
+    std::shared_ptr<tensorflow::tpu::TopologyProto> topology(
+        topology_proto.release());
+    init_wait_ = std::make_shared<util::MultiWait>(1);
+    auto initializer = [this, topology]() {
+      InitializeDevices(
+          topology != nullptr
+              ? absl::make_unique<tensorflow::tpu::TopologyProto>(*topology)
+              : nullptr);
+    };
+    env::ScheduleIoClosure(
+        util::MultiWait::Completer(init_wait_, std::move(initializer)));
+    env::ScheduleIoClosure([this]() {
+      try {
+        WaitForInitialization();
+        PrewarmSessions();
+      } catch (const std::exception& ex) {
+        // The first operation gets the initialization error.
+        TF_LOG(ERROR) << "XRT sessions prewarm failed: " << ex.what();
+      }
+    });
+  } else {
+    InitializeDevices(std::move(topology_proto));
+    PrewarmSessions();
+  }
   StartHandleReleaser();
 }
 
+void XrtComputationClient::WaitForInitialization() const {
+  if (init_wait_ != nullptr) {
+    init_wait_->Wait();
+  }
+}
+
+void XrtComputationClient::PrewarmSessions() {
+  int64_t num_sessions = sys_util::GetEnvInt("XRT_PREWARM_SESSIONS", 0);
+  if (num_sessions <= 0) {
+    return;
+  }
+  std::set<std::string> targets;
+  for (auto& device : options_.devices) {
+    targets.insert(GetWorkerForDevice(device).second);
+  }
+  TF_VLOG(1) << "Prewarming " << num_sessions << " XRT sessions for "
+             << targets.size() << " targets";
+  // Session creation (and InitSession) is dominated by the round trips to the
+  // XRT service, so the targets are warmed up in parallel.
+  auto mwait = std::make_shared<util::MultiWait>(targets.size());
+  for (auto& target : targets) {
+    auto prewarmer = [this, &target, num_sessions]() {
+      session_cache_->Prewarm(target, num_sessions);
+    };
+    env::ScheduleIoClosure(
+        util::MultiWait::Completer(mwait, std::move(prewarmer)));
+  }
+  mwait->Wait();
+}
+
 ComputationClient::DataPtr XrtComputationClient::CreateDataPlaceholder(
     std::string device, Shape shape) {
   return std::make_shared<XrtData>(std::move(device), std::move(shape));
@@ -350,23 +542,39 @@ std::vector<size_t> XrtComputationClient::PartitionTransferToServer(
 
 std::vector<ComputationClient::DataPtr> XrtComputationClient::TransferToServer(
     absl::Span<const TensorSource> tensors) {
-  return TransferToServerHelper(tensors, {});
+  std::vector<memory_quota::ChargePtr> charges = AcquireTransferQuota(tensors);
+  std::vector<DataPtr> results = TransferToServerHelper(tensors, {});
+  AttachQuota(results, std::move(charges));
+  return results;
 }
 
 void XrtComputationClient::TransferToServer(
     absl::Span<const TensorSource> tensors, absl::Span<const DataPtr> datas) {
   XLA_CHECK_EQ(tensors.size(), datas.size());
+  std::vector<memory_quota::ChargePtr> charges = AcquireTransferQuota(tensors);
   TransferToServerHelper(tensors, datas);
+  AttachQuota(datas, std::move(charges));
   return;
 }
 
 std::vector<ComputationClient::DataPtr>
 XrtComputationClient::TransferToServerHelper(
     absl::Span<const TensorSource> tensors, absl::Span<const DataPtr> datas) {
+  int64_t max_partition_size = GetMaxTensorsPartitionSize();
+  for (auto& tensor : tensors) {
+    if (ShapeUtil::ByteSizeOfElements(tensor.shape) > max_partition_size) {
+      return TransferToServerChunked(tensors, datas, max_partition_size);
+    }
+  }
   auto partitions = PartitionTransferToServer(tensors);
   if (partitions.size() == 1) {
     // Fast path in case of single partition. Avoid creating threads and
-    // waiting, since this is the common case.
+    // waiting, since this is the common case. The copies of the tensors still
+    // run on the copy workers local to the device.
+    env::ScopedNumaNode numa_node(
+        tensors.empty() ? -1
+                        : numa::Topology::Get()->GetDeviceNode(
+                              tensors.front().device));
     return TransferToServerInternal(tensors, datas);
   }
   XLA_COUNTER("XrtPartitionedTransferToServer", 1);
@@ -393,6 +601,10 @@ XrtComputationClient::TransferToServerHelper(
         results[base_index + r] = std::move(partitions_results[r]);
       }
     };
+    // The partition senders, and the copies they schedule, run on the workers
+    // local to the device of the partition.
+    env::ScopedNumaNode numa_node(
+        numa::Topology::Get()->GetDeviceNode(tensors[partitions[i]].device));
     env::ScheduleIoClosure(
         util::MultiWait::Completer(mwait, std::move(sender)));
   }
@@ -400,6 +612,92 @@ XrtComputationClient::TransferToServerHelper(
   return results;
 }
 
+std::vector<ComputationClient::DataPtr>
+XrtComputationClient::TransferToServerChunked(
+    absl::Span<const TensorSource> tensors, absl::Span<const DataPtr> datas,
+    int64_t max_chunk_size) {
+  XLA_COUNTER("XrtChunkedTransferToServer", 1);
+  // Tensors larger than the maximum partition size cannot be fed as a single
+  // allocation, so they are split into chunks along their dim0 (the source
+  // buffer is dim0-major, so every chunk is a contiguous range of it), which
+  // are uploaded by the regular path, and then concatenated on device.
+  std::vector<std::shared_ptr<char>> sources;
+  std::vector<TensorSource> chunked_tensors;
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (auto& tensor : tensors) {
+    size_t base = chunked_tensors.size();
+    int64_t size = ShapeUtil::ByteSizeOfElements(tensor.shape);
+    if (size <= max_chunk_size) {
+      chunked_tensors.push_back(tensor);
+    } else {
+      XLA_CHECK_GT(tensor.shape.rank(), 0) << tensor.shape;
+      int64_t rows = tensor.shape.dimensions(0);
+      int64_t row_size = size / rows;
+      XLA_CHECK_LE(row_size, max_chunk_size)
+          << "Tensor " << tensor.shape
+          << " cannot be chunked within XRT_MAX_TENSORS_PARTITION="
+          << max_chunk_size;
+      int64_t chunk_rows = std::max<int64_t>(1, max_chunk_size / row_size);
+      std::shared_ptr<char> source = StagingBufferPool::Get()->Acquire(size);
+      tensor.populate_fn(tensor, source.get(), size);
+      for (int64_t row = 0; row < rows; row += chunk_rows) {
+        int64_t num_rows = std::min(chunk_rows, rows - row);
+        Shape chunk_shape(tensor.shape);
+        chunk_shape.set_dimensions(0, num_rows);
+        const char* chunk_data = source.get() + row * row_size;
+        auto populate_fn = [chunk_data](const TensorSource& src_tensor,
+                                        void* dest_buffer, size_t dest_size) {
+          std::memcpy(dest_buffer, chunk_data, dest_size);
+        };
+        chunked_tensors.emplace_back(std::move(chunk_shape), tensor.device,
+                                     std::move(populate_fn));
+      }
+      sources.push_back(std::move(source));
+    }
+    ranges.emplace_back(base, chunked_tensors.size() - base);
+  }
+  std::vector<DataPtr> chunks = TransferToServerHelper(chunked_tensors, {});
+  sources.clear();
+
+  std::vector<DataPtr> results(tensors.size());
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    size_t base = ranges[i].first;
+    size_t count = ranges[i].second;
+    if (chunked_tensors[base].shape == tensors[i].shape) {
+      results[i] = std::move(chunks[base]);
+    } else {
+      results[i] = ConcatenateChunks(
+          tensors[i],
+          absl::Span<const DataPtr>(chunks).subspan(base, count));
+    }
+    if (!datas.empty()) {
+      datas[i]->Assign(*results[i]);
+    }
+  }
+  return datas.empty() ? results : std::vector<DataPtr>();
+}
+
+ComputationClient::DataPtr XrtComputationClient::ConcatenateChunks(
+    const TensorSource& tensor, absl::Span<const DataPtr> chunks) {
+  XlaBuilder builder("ConcatenateChunks");
+  std::vector<XlaOp> params;
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    params.push_back(Parameter(&builder, i, chunks[i]->shape(),
+                               absl::StrCat("chunk", i)));
+  }
+  ConcatInDim(&builder, params, 0);
+  // The compilation cache makes sure that equally chunked tensors (like the
+  // ones of the same model on every device) only compile once.
+  std::vector<CompileInstance> instances;
+  instances.emplace_back(builder.Build().ValueOrDie(), tensor.device,
+                         std::vector<std::string>{tensor.device},
+                         &tensor.shape);
+  ComputationPtr computation = std::move(Compile(std::move(instances)).front());
+  return std::move(ExecuteComputation(*computation, chunks, tensor.device,
+                                      ExecuteComputationOptions())
+                       .front());
+}
+
 std::vector<ComputationClient::DataPtr>
 XrtComputationClient::TransferToServerInternal(
     absl::Span<const TensorSource> tensors, absl::Span<const DataPtr> datas) {
@@ -412,6 +710,7 @@ XrtComputationClient::TransferToServerInternal(
   bool create_new_data = (datas.size() == 0);
   std::mutex lock;
   XrtSessionCache::SessionMap session_map;
+  XrtSessionCache::SessionMap compressed_session_map;
   int64_t total_size = 0;
   auto mwait = std::make_shared<util::MultiWait>(tensors.size());
   std::map<XrtSession*, SessionWork> session_work_map;
@@ -434,8 +733,15 @@ XrtComputationClient::TransferToServerInternal(
 
         {
           std::lock_guard<std::mutex> slock(lock);
-          XrtSession* session = GetSessionForXrtDevice(
-              alloc_session_cache_.get(), xrt_device, &session_map);
+          bool compress = compressed_session_cache_ != nullptr &&
+                          ShouldCompressTransfer(tensors[i].shape);
+          XrtSession* session =
+              compress ? GetSessionForXrtDevice(compressed_session_cache_.get(),
+                                                xrt_device,
+                                                &compressed_session_map)
+                       : GetSessionForXrtDevice(alloc_session_cache_.get(),
+                                                xrt_device, &session_map);
+          AddTransferBytes(tensors[i].shape, compress);
           SessionWork* session_work = &session_work_map[session];
           tensorflow::Scope device_scope =
               session->root()->WithDevice(xrt_device);
@@ -473,6 +779,14 @@ XrtComputationClient::TransferToServerInternal(
       XrtSession* session = session_session_work.first;
       SessionWork* session_work = &session_session_work.second;
       auto runner = [&, session, session_work]() {
+        int64_t work_size = 0;
+        for (auto li : session_work->index_mapping) {
+          work_size += ShapeUtil::ByteSizeOfElements(tensors[li].shape);
+        }
+        absl::optional<BulkTransferSlot> slot;
+        if (work_size >= GetBulkTransferMinBytes()) {
+          slot.emplace(session->target());
+        }
         std::vector<tensorflow::Tensor> outputs;
         XLA_CHECK_OK(session->session()->Run(session_work->feed_inputs,
                                              session_work->outputs_handles,
@@ -508,30 +822,59 @@ std::vector<Literal> XrtComputationClient::TransferFromServer(
 
   int64_t max_partition_size = GetMaxTensorsPartitionSize();
   std::list<XrtSessionCache::SessionMap> session_maps;
+  std::list<XrtSessionCache::SessionMap> bulk_session_maps;
+  std::list<XrtSessionCache::SessionMap> compressed_session_maps;
   int64_t current_size = 0;
   session_maps.emplace_back();
+  bulk_session_maps.emplace_back();
+  compressed_session_maps.emplace_back();
   std::map<XrtSession*, SessionWork> session_work_map;
+  // The handles read as tensors rather than LiteralProto, by session.
+  std::map<XrtSession*, std::vector<bool>> session_tensor_reads;
   for (size_t i = 0; i < handles.size(); ++i) {
     const XrtData& xrt_data = dynamic_cast<const XrtData&>(*handles[i]);
 
     int64_t shape_size = ShapeUtil::ByteSizeOfElements(xrt_data.shape());
     if (current_size + shape_size >= max_partition_size) {
       session_maps.emplace_back();
+      bulk_session_maps.emplace_back();
+      compressed_session_maps.emplace_back();
       current_size = 0;
     }
     current_size += shape_size;
 
-    XrtSession* session = GetSessionForDevice(
-        session_cache_.get(), xrt_data.device(), &session_maps.back());
+    // The large reads go through the bulk data sessions, which do not share
+    // the gRPC connections of the executes.
+    bool compress = compressed_session_cache_ != nullptr &&
+                    ShouldCompressTransfer(xrt_data.shape());
+    XrtSession* session = nullptr;
+    if (compress) {
+      session = GetSessionForDevice(compressed_session_cache_.get(),
+                                    xrt_data.device(),
+                                    &compressed_session_maps.back());
+    } else if (shape_size >= GetBulkTransferMinBytes()) {
+      session = GetSessionForDevice(alloc_session_cache_.get(),
+                                    xrt_data.device(),
+                                    &bulk_session_maps.back());
+    } else {
+      session = GetSessionForDevice(session_cache_.get(), xrt_data.device(),
+                                    &session_maps.back());
+    }
+    AddTransferBytes(xrt_data.shape(), compress);
     SessionWork* session_work = &session_work_map[session];
     tensorflow::Scope device_scope =
         session->root()->WithDevice(TorchDeviceToXrtDevice(xrt_data.device()));
+    bool read_tensor = UseReadToTensor(session, xrt_data.shape());
     const XrtSession::CachedNode& cached_node =
-        GetReadNode(session, device_scope, xrt_data.device());
+        read_tensor
+            ? GetReadToTensorNode(session, device_scope, xrt_data.device(),
+                                  xrt_data.shape().element_type())
+            : GetReadNode(session, device_scope, xrt_data.device());
     session_work->feed_inputs.insert(
         {cached_node.holders[0], xrt_data.get_handle()});
     session_work->outputs_handles.push_back(cached_node.outputs[0]);
     session_work->index_mapping.push_back(i);
+    session_tensor_reads[session].push_back(read_tensor);
   }
 
   auto mwait = std::make_shared<util::MultiWait>(session_work_map.size());
@@ -541,7 +884,16 @@ std::vector<Literal> XrtComputationClient::TransferFromServer(
   for (auto& session_session_work : session_work_map) {
     XrtSession* session = session_session_work.first;
     SessionWork* session_work = &session_session_work.second;
-    auto runner = [&, session, session_work]() {
+    const std::vector<bool>* tensor_reads = &session_tensor_reads[session];
+    auto runner = [&, session, session_work, tensor_reads]() {
+      int64_t work_size = 0;
+      for (auto li : session_work->index_mapping) {
+        work_size += ShapeUtil::ByteSizeOfElements(handles[li]->shape());
+      }
+      absl::optional<BulkTransferSlot> slot;
+      if (work_size >= GetBulkTransferMinBytes()) {
+        slot.emplace(session->target());
+      }
       std::vector<tensorflow::Tensor> outputs;
       XLA_CHECK_OK(session->session()->Run(
           session_work->feed_inputs, session_work->outputs_handles, &outputs));
@@ -550,9 +902,20 @@ std::vector<Literal> XrtComputationClient::TransferFromServer(
 
       for (size_t i = 0; i < outputs.size(); ++i) {
         size_t li = session_work->index_mapping[i];
-        LiteralProto response = ParseProto<LiteralProto>(outputs[i]);
-        results[li] =
-            std::move(Literal::CreateFromProto(response).ValueOrDie());
+        if ((*tensor_reads)[i]) {
+          // The tensor holds the data in the physical layout of the device
+          // data, which the literal gets created with.
+          const XrtData& xrt_data = dynamic_cast<const XrtData&>(*handles[li]);
+          Literal literal(ShapeUtil::DeviceShapeToHostShape(xrt_data.shape()));
+          auto tdata = outputs[i].tensor_data();
+          XLA_CHECK_EQ(tdata.size(), literal.size_bytes()) << xrt_data.shape();
+          std::memcpy(literal.untyped_data(), tdata.data(), tdata.size());
+          results[li] = std::move(literal);
+        } else {
+          LiteralProto response = ParseProto<LiteralProto>(outputs[i]);
+          results[li] =
+              std::move(Literal::CreateFromProto(response).ValueOrDie());
+        }
         total_size += results[li].size_bytes();
       }
     };
@@ -569,6 +932,14 @@ std::vector<Literal> XrtComputationClient::TransferFromServer(
   return results;
 }
 
+Literal XrtComputationClient::TransferFromOutfeed(const std::string& device,
+                                                 const Shape& shape) {
+  // XRT has no session op dequeuing the outfeed of its devices.
+  XLA_ERROR() << "The outfeed of " << device
+              << " cannot be read through XRT, the host callbacks need the "
+                 "PJRT runtime";
+}
+
 std::vector<ComputationClient::ComputationPtr> XrtComputationClient::Compile(
     std::vector<CompileInstance> instances) {
   metrics::TimedSection timed(CompileMetric());
@@ -674,6 +1045,24 @@ std::vector<ComputationClient::ComputationPtr> XrtComputationClient::Compile(
   return results;
 }
 
+void XrtComputationClient::ReportStragglers(
+    const std::vector<std::string>& workers,
+    const std::vector<int64_t>& times) {
+  static metrics::Metric* skew_metric =
+      new metrics::Metric("XrtExecuteWorkerSkew", metrics::MetricFnTime);
+  std::vector<int64_t> sorted_times(times);
+  std::nth_element(sorted_times.begin(),
+                   sorted_times.begin() + sorted_times.size() / 2,
+                   sorted_times.end());
+  int64_t median = sorted_times[sorted_times.size() / 2];
+  size_t slowest = std::max_element(times.begin(), times.end()) - times.begin();
+  // The skew is how much the slowest worker lags behind the median one.
+  int64_t skew = times[slowest] - median;
+  skew_metric->AddSample(skew);
+  TF_VLOG(5) << "Slowest execute worker " << workers[slowest] << ": "
+             << times[slowest] << "ns (median " << median << "ns)";
+}
+
 void XrtComputationClient::CheckCompileStatus(
     const Status& status, const std::vector<CompileInstance>& instances,
     const SessionWork& session_work) {
@@ -696,6 +1085,8 @@ XrtComputationClient::ExecuteComputation(
   tensorflow::profiler::TraceMe activity(
       "ExecuteComputation", tensorflow::profiler::TraceMeLevel::kInfo);
 
+  std::vector<memory_quota::ChargePtr> charges = AcquireResultsQuota(
+      computation, arguments, device, options.explode_tuple);
   XrtSessionCache::SessionMap session_map;
   tensorflow::ClientSession::FeedType feed_inputs;
   std::vector<tensorflow::Output> exec_ops = CreateExecuteOps(
@@ -705,14 +1096,34 @@ XrtComputationClient::ExecuteComputation(
 
   XrtSession* session =
       GetSessionForDevice(session_cache_.get(), device, &session_map);
+  std::vector<tensorflow::Operation> release_ops;
+  std::vector<DeviceHandle> released_handles;
+  if (CoalesceHandleReleases()) {
+    released_handles =
+        TakeSessionDataReleases(session, device, &feed_inputs, &release_ops);
+  }
   std::vector<tensorflow::Tensor> outputs;
-  util::CheckComputationStatus(
-      session->session()->Run(feed_inputs, {exec_ops.front()}, &outputs),
-      {&computation.computation()}, {&computation.program_shape().result()});
+  Status status = session->session()->Run(feed_inputs, {exec_ops.front()},
+                                          release_ops, &outputs);
+  if (!released_handles.empty()) {
+    if (status.ok()) {
+      DestroyDataHandlesCounter()->AddValue(released_handles.size());
+    } else {
+      // Let the handle releaser retry them.
+      std::lock_guard<std::mutex> lock(lock_);
+      released_data_handles_.insert(released_data_handles_.end(),
+                                    released_handles.begin(),
+                                    released_handles.end());
+    }
+  }
+  util::CheckComputationStatus(status, {&computation.computation()},
+                               {&computation.program_shape().result()});
   XLA_CHECK_EQ(outputs.size(), 1);
 
-  return GetComputationResults(outputs[0], computation.program_shape().result(),
-                               device);
+  std::vector<DataPtr> results = GetComputationResults(
+      outputs[0], computation.program_shape().result(), device);
+  AttachQuota(results, std::move(charges));
+  return results;
 }
 
 std::vector<std::vector<ComputationClient::DataPtr>>
@@ -732,9 +1143,19 @@ XrtComputationClient::ExecuteReplicated(
       options.explode_tuple, devices, &feed_inputs);
   std::vector<const Computation*> computations(devices.size());
   std::fill(computations.begin(), computations.end(), &computation);
+  std::vector<std::vector<memory_quota::ChargePtr>> charges;
+  charges.reserve(devices.size());
+  for (size_t i = 0; i < devices.size(); ++i) {
+    charges.push_back(AcquireResultsQuota(computation, arguments[i],
+                                          devices[i], options.explode_tuple));
+  }
 
-  return RunComputations(session_map, exec_ops, computations, devices,
-                         feed_inputs);
+  std::vector<std::vector<DataPtr>> results = RunComputations(
+      session_map, exec_ops, computations, devices, feed_inputs);
+  for (size_t i = 0; i < results.size(); ++i) {
+    AttachQuota(results[i], std::move(charges[i]));
+  }
+  return results;
 }
 
 std::vector<std::vector<ComputationClient::DataPtr>>
@@ -769,11 +1190,16 @@ XrtComputationClient::RunComputations(
 
   auto mwait = std::make_shared<util::MultiWait>(session_replicas.size());
   std::vector<std::vector<DataPtr>> results(devices.size());
+  std::vector<int64_t> session_times(session_replicas.size(), 0);
+  std::vector<std::string> session_workers;
+  session_workers.reserve(session_replicas.size());
   for (auto& sess_replica : session_replicas) {
     XrtSession* session = sess_replica.first;
     const std::vector<size_t>& replicas = sess_replica.second;
+    size_t session_index = session_workers.size();
+    session_workers.push_back(session->target());
 
-    auto session_runner = [&, this, session]() {
+    auto session_runner = [&, this, session, session_index]() {
       std::vector<tensorflow::Output> exec_nodes;
       std::vector<const XlaComputation*> xla_computations;
       std::vector<const Shape*> output_shapes;
@@ -784,9 +1210,13 @@ XrtComputationClient::RunComputations(
             &computations[replica]->program_shape().result());
       }
       std::vector<tensorflow::Tensor> outputs;
+      int64_t start = sys_util::NowNs();
       util::CheckComputationStatus(
           session->session()->Run(feed_inputs, exec_nodes, &outputs),
           xla_computations, output_shapes);
+      session_times[session_index] = sys_util::NowNs() - start;
+      GetWorkerExecuteMetric(session->target())
+          ->AddSample(session_times[session_index]);
       XLA_CHECK_EQ(outputs.size(), exec_nodes.size());
 
       for (size_t i = 0; i < outputs.size(); ++i) {
@@ -800,6 +1230,9 @@ XrtComputationClient::RunComputations(
         util::MultiWait::Completer(mwait, std::move(session_runner)));
   }
   mwait->Wait();
+  if (session_times.size() > 1) {
+    ReportStragglers(session_workers, session_times);
+  }
   return results;
 }
 
@@ -847,11 +1280,76 @@ std::vector<ComputationClient::DataPtr> XrtComputationClient::ExecuteChained(
     absl::Span<const ExecuteChainedOp> ops, const std::string& device) {
   tensorflow::profiler::TraceMe activity(
       "ExecuteChained", tensorflow::profiler::TraceMeLevel::kInfo);
-  static int64_t split_mode = sys_util::GetEnvInt("XRT_SPLIT_CHAINED_EXEC", 0);
+  // A negative split mode (the default) selects the implementation
+  // adaptively, according to the observed timings.
+  static int64_t split_mode =
+      sys_util::GetEnvInt("XRT_SPLIT_CHAINED_EXEC", -1);
+  if (split_mode < 0) {
+    return ExecuteChainedAdaptive(ops, device);
+  }
   return split_mode ? ExecuteChainedSplit(ops, device)
                     : ExecuteChainedXrt(ops, device);
 }
 
+std::vector<ComputationClient::DataPtr>
+XrtComputationClient::ExecuteChainedAdaptive(
+    absl::Span<const ExecuteChainedOp> ops, const std::string& device) {
+  static int64_t num_samples =
+      sys_util::GetEnvInt("XRT_CHAINED_EXEC_SAMPLES", 3);
+  // The op-by-op executor reuses the cached computations, so the plan hash
+  // only needs their identity and the op graph topology.
+  size_t plan_hash = std::hash<std::string>()(device);
+  for (auto& op : ops) {
+    plan_hash = util::StdHashCombine(
+        plan_hash, reinterpret_cast<uintptr_t>(op.computation.get()));
+    for (auto& input : op.inputs) {
+      plan_hash = util::StdHashCombine(
+          plan_hash, util::StdHashCombine(input.op_index,
+                                          input.output_index.value_or(-1)));
+    }
+    plan_hash = util::StdHashCombine(plan_hash, op.outputs.size());
+  }
+
+  std::shared_ptr<ChainedExecStats> stats = chained_exec_stats_.Get(plan_hash);
+  if (stats == nullptr) {
+    stats = chained_exec_stats_.Add(plan_hash,
+                                    std::make_shared<ChainedExecStats>());
+  }
+  int mode;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    // Until a selection is made, alternate the implementations.
+    mode = stats->selected >= 0 ? stats->selected
+                                : (stats->runs[1] < stats->runs[0] ? 1 : 0);
+  }
+  int64_t start = sys_util::NowNs();
+  std::vector<DataPtr> results = mode ? ExecuteChainedSplit(ops, device)
+                                      : ExecuteChainedXrt(ops, device);
+  int64_t elapsed = sys_util::NowNs() - start;
+
+  std::lock_guard<std::mutex> lock(lock_);
+  if (stats->selected < 0) {
+    // Use the minimum time, since the first runs can include one-time costs.
+    if (stats->runs[mode] == 0 || elapsed < stats->min_time_ns[mode]) {
+      stats->min_time_ns[mode] = elapsed;
+    }
+    stats->runs[mode] += 1;
+    if (stats->runs[0] >= num_samples && stats->runs[1] >= num_samples) {
+      stats->selected = stats->min_time_ns[1] < stats->min_time_ns[0] ? 1 : 0;
+      if (stats->selected) {
+        XLA_COUNTER("XrtChainedExecSelectedSplit", 1);
+      } else {
+        XLA_COUNTER("XrtChainedExecSelectedXrt", 1);
+      }
+      TF_VLOG(3) << "Selected " << (stats->selected ? "split" : "XRT")
+                 << " chained execution for plan " << plan_hash << " (XRT="
+                 << stats->min_time_ns[0]
+                 << "ns, split=" << stats->min_time_ns[1] << "ns)";
+    }
+  }
+  return results;
+}
+
 std::vector<ComputationClient::DataPtr> XrtComputationClient::ExecuteChainedXrt(
     absl::Span<const ExecuteChainedOp> ops, const std::string& device) {
   metrics::TimedSection timed(ExecuteChainedMetric());
@@ -1060,6 +1558,7 @@ XrtComputationClient::DeconstructTuple(absl::Span<const DataPtr> tuples) {
 XrtSession* XrtComputationClient::GetSessionForTarget(
     XrtSessionCache* cache, const std::string& target,
     XrtSessionCache::SessionMap* session_map) {
+  WaitForInitialization();
   return cache->GetSession(target, session_map);
 }
 
@@ -1143,6 +1642,65 @@ tensorflow::Tensor XrtComputationClient::GetArgumentsInputs(
   return inputs_tensor;
 }
 
+void XrtComputationClient::AddExecuteFeeds(
+    const XrtSession::CachedNode& cached_node,
+    const XrtComputation& computation, absl::Span<const DataPtr> arguments,
+    bool explode_tuple, const std::string& device,
+    tensorflow::ClientSession::FeedType* feed_inputs) {
+  std::string replay_key;
+  std::shared_ptr<ExecReplay> replay;
+  if (exec_replays_ != nullptr) {
+    replay_key =
+        absl::StrCat(computation.get_handle(), ":", device, ":", explode_tuple);
+    replay = exec_replays_->Get(replay_key);
+    if (replay != nullptr && replay->rng_seed != rng_seed_) {
+      replay = nullptr;
+    }
+  }
+  std::vector<int64_t> argument_handles;
+  if (replay != nullptr) {
+    argument_handles.reserve(arguments.size());
+    for (auto& argument : arguments) {
+      argument_handles.push_back(
+          dynamic_cast<const XrtData&>(*argument).get_handle());
+    }
+    if (argument_handles == replay->argument_handles) {
+      XLA_COUNTER("XrtExecReplays", 1);
+      feed_inputs->insert({cached_node.holders[1], replay->exec_config});
+      feed_inputs->insert({cached_node.holders[2], replay->inputs});
+      return;
+    }
+  }
+  auto new_replay = std::make_shared<ExecReplay>();
+  if (replay != nullptr) {
+    // Only the arguments changed, so the recorded config is still valid.
+    new_replay->exec_config = replay->exec_config;
+    new_replay->rng_seed = replay->rng_seed;
+  } else {
+    xrt::XRTExecutionConfig exec_config;
+    exec_config.set_release_input_handles(false);
+    exec_config.set_release_compilation_handle(false);
+    exec_config.set_return_exploded_tuple(explode_tuple);
+    new_replay->rng_seed = rng_seed_;
+    SetupExecConfig(Device(device), &exec_config);
+    new_replay->exec_config = exec_config.SerializeAsString();
+  }
+  new_replay->inputs = GetArgumentsInputs(arguments, device);
+  feed_inputs->insert({cached_node.holders[1], new_replay->exec_config});
+  feed_inputs->insert({cached_node.holders[2], new_replay->inputs});
+  if (exec_replays_ != nullptr) {
+    if (argument_handles.empty()) {
+      for (auto& argument : arguments) {
+        argument_handles.push_back(
+            dynamic_cast<const XrtData&>(*argument).get_handle());
+      }
+    }
+    new_replay->argument_handles = std::move(argument_handles);
+    exec_replays_->Erase(replay_key);
+    exec_replays_->Add(std::move(replay_key), std::move(new_replay));
+  }
+}
+
 std::vector<tensorflow::Output> XrtComputationClient::CreateExecuteOps(
     XrtSessionCache::SessionMap* session_map,
     absl::Span<const Computation* const> computations,
@@ -1153,7 +1711,6 @@ std::vector<tensorflow::Output> XrtComputationClient::CreateExecuteOps(
   for (size_t i = 0; i < computations.size(); ++i) {
     const XrtComputation* xrt_computation =
         dynamic_cast<const XrtComputation*>(computations[i]);
-    auto inputs = GetArgumentsInputs(arguments[i], devices[i]);
     const std::string& xrt_device = TorchDeviceToXrtDevice(devices[i]);
     XrtSession* session =
         GetSessionForXrtDevice(session_cache_.get(), xrt_device, session_map);
@@ -1162,16 +1719,8 @@ std::vector<tensorflow::Output> XrtComputationClient::CreateExecuteOps(
         GetExecuteNode(session, device_scope, devices[i]);
     feed_inputs->insert(
         {cached_node.holders[0], xrt_computation->get_handle()});
-
-    xrt::XRTExecutionConfig exec_config;
-    exec_config.set_release_input_handles(false);
-    exec_config.set_release_compilation_handle(false);
-    exec_config.set_return_exploded_tuple(explode_tuple);
-    SetupExecConfig(Device(devices[i]), &exec_config);
-
-    feed_inputs->insert(
-        {cached_node.holders[1], exec_config.SerializeAsString()});
-    feed_inputs->insert({cached_node.holders[2], inputs});
+    AddExecuteFeeds(cached_node, *xrt_computation, arguments[i], explode_tuple,
+                    devices[i], feed_inputs);
 
     exec_ops.push_back(cached_node.outputs[0]);
   }
@@ -1185,7 +1734,6 @@ std::vector<tensorflow::Output> XrtComputationClient::CreateExecuteOps(
     tensorflow::ClientSession::FeedType* feed_inputs) {
   std::vector<tensorflow::Output> exec_ops;
   for (size_t i = 0; i < arguments.size(); ++i) {
-    auto inputs = GetArgumentsInputs(arguments[i], devices[i]);
     const std::string& xrt_device = TorchDeviceToXrtDevice(devices[i]);
     XrtSession* session =
         GetSessionForXrtDevice(session_cache_.get(), xrt_device, session_map);
@@ -1193,16 +1741,8 @@ std::vector<tensorflow::Output> XrtComputationClient::CreateExecuteOps(
     const XrtSession::CachedNode& cached_node =
         GetExecuteNode(session, device_scope, devices[i]);
     feed_inputs->insert({cached_node.holders[0], computation.get_handle()});
-
-    xrt::XRTExecutionConfig exec_config;
-    exec_config.set_release_input_handles(false);
-    exec_config.set_release_compilation_handle(false);
-    exec_config.set_return_exploded_tuple(explode_tuple);
-    SetupExecConfig(Device(devices[i]), &exec_config);
-
-    feed_inputs->insert(
-        {cached_node.holders[1], exec_config.SerializeAsString()});
-    feed_inputs->insert({cached_node.holders[2], inputs});
+    AddExecuteFeeds(cached_node, computation, arguments[i], explode_tuple,
+                    devices[i], feed_inputs);
 
     exec_ops.push_back(cached_node.outputs[0]);
   }
@@ -1258,13 +1798,69 @@ void XrtComputationClient::ReleaseHandles(
   }
 }
 
+std::vector<XrtComputationClient::DeviceHandle>
+XrtComputationClient::TakeSessionDataReleases(
+    XrtSession* session, const std::string& device,
+    tensorflow::ClientSession::FeedType* feed_inputs,
+    std::vector<tensorflow::Operation>* run_ops) {
+  const std::string& worker_hostport = GetWorkerForDevice(device).second;
+  std::map<std::string, std::vector<int64_t>> device_handles;
+  std::vector<DeviceHandle> released_handles;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = std::partition(
+        released_data_handles_.begin(), released_data_handles_.end(),
+        [&](const DeviceHandle& handle) {
+          return GetWorkerForDevice(handle.device).second != worker_hostport;
+        });
+    released_handles.assign(it, released_data_handles_.end());
+    released_data_handles_.erase(it, released_data_handles_.end());
+  }
+  for (auto& handle : released_handles) {
+    device_handles[handle.device].push_back(handle.handle);
+  }
+  for (auto& device_and_handles : device_handles) {
+    const std::vector<int64_t>& handles = device_and_handles.second;
+    tensorflow::Tensor handles_tensor(
+        tensorflow::DT_INT64, tensorflow::TensorShape({handles.size()}));
+    auto flat_handles_tensor = handles_tensor.flat<tensorflow::int64>();
+    for (size_t i = 0; i < handles.size(); ++i) {
+      flat_handles_tensor(i) = handles[i];
+    }
+    tensorflow::Scope device_scope = session->root()->WithDevice(
+        TorchDeviceToXrtDevice(device_and_handles.first));
+    const XrtSession::CachedNode& cached_node = GetReleaseAllocationHandleNode(
+        session, device_scope, device_and_handles.first);
+    feed_inputs->insert({cached_node.holders[0], handles_tensor});
+    run_ops->push_back(cached_node.operations[0]);
+  }
+  if (!released_handles.empty()) {
+    XLA_COUNTER("XrtCoalescedHandleReleases", released_handles.size());
+  }
+  return released_handles;
+}
+
 void XrtComputationClient::StartHandleReleaser() {
   static const size_t kMinReleaserThreads = 8;
-  int64_t num_threads = sys_util::GetEnvInt(
+  util::TriggeredTask::Options options;
+  options.num_threads = sys_util::GetEnvInt(
       "XLA_HANDLE_RELEASE_THREADS",
       std::max<size_t>(options_.devices.size(), kMinReleaserThreads));
-  triggered_task_.reset(
-      new util::TriggeredTask([this]() { HandleReleaser(); }, num_threads));
+  // The releases which do not fill a batch are held for the maximum latency,
+  // so that the following ones coalesce into the same run.
+  options.max_delay = std::chrono::milliseconds(
+      sys_util::GetEnvInt("XRT_RELEASE_MAX_LATENCY_MS", 100));
+  options.min_interval = std::chrono::milliseconds(
+      sys_util::GetEnvInt("XRT_RELEASE_MIN_INTERVAL_MS", 0));
+  options.adaptive_concurrency =
+      sys_util::GetEnvBool("XLA_HANDLE_RELEASE_ADAPTIVE_THREADS", true);
+  options.name = "XrtHandleReleaser";
+  triggered_task_.reset(new util::TriggeredTask([this]() { HandleReleaser(); },
+                                                std::move(options)));
+  // The allocations waiting for quota get the pending releases, of both the
+  // data and the compiled computations, run right away.
+  memory_quota::SetPressureHandler(
+      [this](const std::string& device) { triggered_task_->Activate(true); });
 }
 
 void XrtComputationClient::HandleReleaser() {
@@ -1289,11 +1885,17 @@ void XrtComputationClient::HandleReleaser() {
 void XrtComputationClient::ReleaseHandle(int64_t handle,
                                          const std::string& device,
                                          std::vector<DeviceHandle>* handles) {
+  static const size_t kMinReleaseBatch =
+      sys_util::GetEnvInt("XRT_RELEASE_MIN_BATCH", 64);
+  bool urgent = false;
   {
     std::lock_guard<std::mutex> lock(lock_);
     handles->push_back({device, handle});
+    urgent = handles->size() >= kMinReleaseBatch ||
+             memory_pressure_devices_.count(device) > 0 ||
+             memory_quota::UnderPressure(device);
   }
-  triggered_task_->Activate();
+  triggered_task_->Activate(urgent);
 }
 
 void XrtComputationClient::ReleaseXrtData(const std::string& device,
@@ -1327,6 +1929,7 @@ XrtComputationClient::GetWorkerForDevice(const std::string& device) const {
 
 const std::vector<int>& XrtComputationClient::GetDeviceMeshCoords(
     const std::string& xrt_device) const {
+  WaitForInitialization();
   auto it = device_mesh_coords_.find(xrt_device);
   if (it == device_mesh_coords_.end()) {
     TF_LOG(FATAL) << "Missing mesh coordinates for device: " << xrt_device;
@@ -1440,17 +2043,19 @@ void XrtComputationClient::InitializeDevices(
   if (!mesh_service_address.empty() && !mp_device.empty()) {
     int host_ordinal = sys_util::GetEnvInt(env::kEnvHostOrdinal, -1);
     Device device(mp_device);
-    if (host_ordinal <= 0) {
-      if (device.ordinal == 0) {
-        CreateMeshService(mesh_service_address, topology_proto.get());
-      }
-    } else {
+    if (host_ordinal <= 0 && device.ordinal == 0) {
+      CreateMeshService(mesh_service_address, topology_proto.get());
+    }
+    // The aggregator must be serving before the first MeshClient::Get(), whose
+    // constructor waits to connect to it.
+    if (device.ordinal == 0) {
+      CreateMeshAggregator(mesh_service_address);
+    }
+    if (host_ordinal > 0 && device.ordinal == 0) {
       // Here we are in the sea-of-devices case.
-      if (device.ordinal == 0) {
-        service::grpc::Config config =
-            CreateMeshServiceConfig(topology_proto.get());
-        service::MeshClient::Get()->SetConfig(host_ordinal, config);
-      }
+      service::grpc::Config config =
+          CreateMeshServiceConfig(topology_proto.get());
+      service::MeshClient::Get()->SetConfig(host_ordinal, config);
     }
     SetupGpuRuntime();
   }
@@ -1464,6 +2069,33 @@ void XrtComputationClient::SetupGpuRuntime() {
   };
 
   tensorflow::SetNcclUniqueIdFactory(std::make_shared<NcclUniqueIdFactory>());
+
+  // The small GPU executions are bound by their dispatch cost, which the
+  // replay mode trims by reusing the execute feeds of the previous executions
+  // of the same computation.
+  int64_t exec_replay_size = sys_util::GetEnvInt("XRT_GPU_EXEC_REPLAY", 0);
+  if (exec_replay_size > 0) {
+    exec_replays_ = absl::make_unique<util::Cache<std::string, ExecReplay>>(
+        exec_replay_size);
+  }
+
+  // Warm up the UIDs of the replica groups most graphs use, the whole world
+  // and the processes of every host, so that the first collectives do not
+  // serialize on the round trips to the master.
+  int64_t world_size = sys_util::GetEnvInt(env::kEnvWorldSize, 1);
+  if (world_size <= 1 || !sys_util::GetEnvBool("XRT_NCCL_UID_PREFETCH", true)) {
+    return;
+  }
+  service::MeshClient::Get()->PrefetchNcclUniqueUid(
+      util::Iota<int64_t>(world_size));
+  int64_t host_world_size = sys_util::GetEnvInt("XRT_HOST_WORLD_SIZE", 1);
+  if (host_world_size > 1 && world_size % host_world_size == 0) {
+    int64_t local_count = world_size / host_world_size;
+    for (int64_t base = 0; base < world_size; base += local_count) {
+      service::MeshClient::Get()->PrefetchNcclUniqueUid(
+          util::Iota<int64_t>(local_count, base));
+    }
+  }
 }
 
 service::grpc::Config XrtComputationClient::CreateMeshServiceConfig(
@@ -1512,6 +2144,25 @@ void XrtComputationClient::CreateMeshService(
       absl::make_unique<service::MeshService>(address, std::move(config));
 }
 
+void XrtComputationClient::CreateMeshAggregator(
+    const std::string& mesh_service_address) {
+  std::string address =
+      sys_util::GetEnvString("XRT_MESH_AGGREGATOR_ADDRESS", "");
+  if (address.empty()) {
+    return;
+  }
+  int64_t world_size = sys_util::GetEnvInt(env::kEnvWorldSize, 1);
+  int64_t host_world_size = sys_util::GetEnvInt("XRT_HOST_WORLD_SIZE", 1);
+  XLA_CHECK_EQ(world_size % host_world_size, 0)
+      << "The world size " << world_size
+      << " is not a multiple of the host world size " << host_world_size;
+  size_t local_count = world_size / host_world_size;
+  TF_VLOG(1) << "Creating mesh aggregator bound to " << address << " for "
+             << local_count << " local processes";
+  mesh_aggregator_ = absl::make_unique<service::MeshAggregator>(
+      address, mesh_service_address, local_count);
+}
+
 std::vector<ComputationClient::DataPtr>
 XrtComputationClient::GetComputationResults(
     const tensorflow::Tensor& xrt_result, const Shape& result_shape,
@@ -1558,6 +2209,21 @@ std::vector<std::string> XrtComputationClient::GetAllDevices() const {
   return devices;
 }
 
+std::vector<int> XrtComputationClient::GetDeviceCoords(
+    const std::string& device) const {
+  Device parsed_device(device);
+  if (parsed_device.kind != "TPU") {
+    // Like for the device assignments of the replicated computations.
+    return {0, 0, 0, parsed_device.ordinal};
+  }
+  // The TPU mesh coordinates are X, Y, Z and core. The cores of a chip are
+  // the closest peers, followed by the chips along X, then along Y.
+  const std::vector<int>& coords =
+      GetDeviceMeshCoords(TorchDeviceToXrtDevice(device));
+  XLA_CHECK_EQ(coords.size(), 4) << device;
+  return {coords[2], coords[1], coords[0], coords[3]};
+}
+
 void XrtComputationClient::SetReplicationDevices(
     std::shared_ptr<std::vector<std::string>> devices) {
   std::lock_guard<std::mutex> lock(lock_);
@@ -1693,10 +2359,30 @@ ComputationClient::MemoryInfo XrtComputationClient::GetMemoryInfo(
   XLA_CHECK_OK(session->session()->Run({cached_node.outputs[0]}, &outputs));
 
   xrt::MemoryInfo mem_info = ParseProto<xrt::MemoryInfo>(outputs[0]);
+  // Releases for devices low on memory are not batched, as the memory they
+  // hold might be what a pending allocation is waiting for.
+  static const double kMemoryPressureFraction =
+      sys_util::GetEnvDouble("XRT_RELEASE_MEMORY_PRESSURE_FRACTION", 0.1);
+  bool memory_pressure =
+      mem_info.kb_free() < kMemoryPressureFraction * mem_info.kb_total();
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (memory_pressure) {
+      memory_pressure_devices_.insert(device);
+    } else {
+      memory_pressure_devices_.erase(device);
+    }
+  }
   return {mem_info.kb_free(), mem_info.kb_total()};
 }
 
 void XrtComputationClient::PrepareToExit() {
+  try {
+    // The mesh service may still be in the making.
+    WaitForInitialization();
+  } catch (const std::exception& ex) {
+    TF_LOG(ERROR) << "XRT initialization failed: " << ex.what();
+  }
   if (mesh_service_ != nullptr) {
     TF_VLOG(1) << "Shutting down mesh service ...";
     mesh_service_->Shutdown();
@@ -1817,6 +2503,35 @@ const XrtSession::CachedNode& XrtComputationClient::GetReadNode(
   return cache->Get();
 }
 
+const XrtSession::CachedNode& XrtComputationClient::GetReadToTensorNode(
+    XrtSession* session, const tensorflow::Scope& scope,
+    const std::string& device, PrimitiveType type) const {
+  static const std::string op_name("XrtReadToTensor");
+  XrtSession::NodeCache* cache = session->GetNodeCache(XrtSession::GetCacheKey(
+      absl::StrCat(op_name, ":", PrimitiveType_Name(type)), device));
+  if (cache->Empty()) {
+    XLA_COUNTER("XrtReadToTensor_Empty", 1);
+    std::vector<tensorflow::ops::Placeholder> holders(
+        {tensorflow::ops::Placeholder(scope, tensorflow::DT_INT64)});
+    tensorflow::ops::XRTReadToTensor read(scope, holders[0],
+                                          {XlaTypeToDataType(type)});
+    cache->Add(std::make_shared<XrtSession::CachedNode>(read.tensors[0],
+                                                        holders));
+  }
+  return cache->Get();
+}
+
+bool XrtComputationClient::UseReadToTensor(XrtSession* session,
+                                           const Shape& shape) const {
+  static const bool read_to_tensor =
+      sys_util::GetEnvBool("XRT_READ_TO_TENSOR", true);
+  // Only the in-process service is known to run the same XRT build as the
+  // client, while remote workers may predate XRTReadToTensor.
+  return read_to_tensor && !local_target_.empty() &&
+         session->target() == local_target_ && shape.IsArray() &&
+         !ShapeUtil::IsZeroElementArray(shape);
+}
+
 const XrtSession::CachedNode& XrtComputationClient::GetAllocateNode(
     XrtSession* session, const tensorflow::Scope& scope,
     const std::string& device, const Shape& shape) const {
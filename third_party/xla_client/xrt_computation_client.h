@@ -6,6 +6,7 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <string>
 #include <utility>
 
@@ -19,6 +20,7 @@
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/triggered_task.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/xla/xla_client/xrt_local_service.h"
@@ -254,6 +256,9 @@ class XrtComputationClient : public ComputationClient {
   std::vector<Literal> TransferFromServer(
       absl::Span<const DataPtr> handles) override;
 
+  Literal TransferFromOutfeed(const std::string& device,
+                              const Shape& shape) override;
+
   std::vector<ComputationPtr> Compile(
       std::vector<CompileInstance> instances) override;
 
@@ -280,6 +285,18 @@ class XrtComputationClient : public ComputationClient {
   std::vector<std::vector<DataPtr>> DeconstructTuple(
       absl::Span<const DataPtr> tuples) override;
 
+  // XRT compilation handles are only valid within the XRT server which created
+  // them, so compiled computations cannot be serialized.
+  std::string SerializeComputation(const Computation& computation) override {
+    return std::string();
+  }
+
+  ComputationPtr DeserializeComputation(
+      const std::string& serialized, XlaComputation computation,
+      ProgramShape program_shape, std::vector<std::string> devices) override {
+    return nullptr;
+  }
+
   std::string GetResourceDomain(const std::string& device) const override;
 
   std::string GetDefaultDevice() const override;
@@ -290,6 +307,8 @@ class XrtComputationClient : public ComputationClient {
 
   std::vector<std::string> GetAllDevices() const override;
 
+  std::vector<int> GetDeviceCoords(const std::string& device) const override;
+
   void SetReplicationDevices(
       std::shared_ptr<std::vector<std::string>> devices) override;
 
@@ -367,6 +386,17 @@ class XrtComputationClient : public ComputationClient {
   tensorflow::Tensor GetArgumentsInputs(absl::Span<const DataPtr> arguments,
                                         const std::string& device);
 
+  // Feeds the execution config and the arguments of the execute node for the
+  // computation. With the GPU execution replay mode (XRT_GPU_EXEC_REPLAY), the
+  // feeds are recorded by the first execution of a computation on a device,
+  // and replayed by the following ones (the arguments ones only as long as
+  // the argument buffers are the same).
+  void AddExecuteFeeds(const XrtSession::CachedNode& cached_node,
+                       const XrtComputation& computation,
+                       absl::Span<const DataPtr> arguments, bool explode_tuple,
+                       const std::string& device,
+                       tensorflow::ClientSession::FeedType* feed_inputs);
+
   std::vector<tensorflow::Output> CreateExecuteOps(
       XrtSessionCache::SessionMap* session_map,
       absl::Span<const Computation* const> computations,
@@ -388,12 +418,26 @@ class XrtComputationClient : public ComputationClient {
       absl::Span<const std::string> devices,
       const tensorflow::ClientSession::FeedType& feed_inputs);
 
+  // Reports the skew between the slowest and the median per worker execute
+  // times of a replicated (or parallel) execution.
+  static void ReportStragglers(const std::vector<std::string>& workers,
+                               const std::vector<int64_t>& times);
+
   std::vector<DataPtr> TransferToServerHelper(
       absl::Span<const TensorSource> tensors, absl::Span<const DataPtr> datas);
 
   std::vector<DataPtr> TransferToServerInternal(
       absl::Span<const TensorSource> tensors, absl::Span<const DataPtr> datas);
 
+  // Transfers tensors which might exceed max_chunk_size, by uploading their
+  // dim0 chunks and concatenating them on device.
+  std::vector<DataPtr> TransferToServerChunked(
+      absl::Span<const TensorSource> tensors, absl::Span<const DataPtr> datas,
+      int64_t max_chunk_size);
+
+  DataPtr ConcatenateChunks(const TensorSource& tensor,
+                            absl::Span<const DataPtr> chunks);
+
   // Retrieves the worker,worker_host pair for a given PyTorch device (ie,
   // TPU:0).
   std::pair<Worker, std::string> GetWorkerForDevice(
@@ -414,11 +458,23 @@ class XrtComputationClient : public ComputationClient {
   void ReleaseHandle(int64_t handle, const std::string& device,
                      std::vector<DeviceHandle>* handles);
 
+  // Takes the pending data handle releases which can run within a session
+  // for the given device, and adds the release operations and their feeds to
+  // run_ops and feed_inputs, so that they can piggyback on another Run.
+  std::vector<DeviceHandle> TakeSessionDataReleases(
+      XrtSession* session, const std::string& device,
+      tensorflow::ClientSession::FeedType* feed_inputs,
+      std::vector<tensorflow::Operation>* run_ops);
+
   void ReleaseXrtData(const std::string& device, int64_t handle);
 
   void ReleaseXrtComputation(const std::string& compilation_device,
                              int64_t handle);
 
+  // Pre-creates (if XRT_PREWARM_SESSIONS is set) sessions, with all their
+  // common cached nodes, for the targets of the local devices.
+  void PrewarmSessions();
+
   // Starts the handle releaser thread (which runs the HandleReleaser() API).
   void StartHandleReleaser();
 
@@ -433,12 +489,20 @@ class XrtComputationClient : public ComputationClient {
   void InitializeDevices(
       std::unique_ptr<tensorflow::tpu::TopologyProto> topology_proto);
 
+  // Waits for the background initialization of the devices (XRT_ASYNC_INIT),
+  // rethrowing its error, if any.
+  void WaitForInitialization() const;
+
   service::grpc::Config CreateMeshServiceConfig(
       const tensorflow::tpu::TopologyProto* topology_proto) const;
 
   void CreateMeshService(const std::string& address,
                          const tensorflow::tpu::TopologyProto* topology_proto);
 
+  // Creates the host aggregator of the mesh rendezvous, if one is configured
+  // with the XRT_MESH_AGGREGATOR_ADDRESS environment variable.
+  void CreateMeshAggregator(const std::string& mesh_service_address);
+
   void SetupGpuRuntime();
 
   std::vector<DataPtr> GetComputationResults(
@@ -456,6 +520,11 @@ class XrtComputationClient : public ComputationClient {
   std::vector<DataPtr> ExecuteChainedSplit(
       absl::Span<const ExecuteChainedOp> ops, const std::string& device);
 
+  // Times both the chained execution implementations over the first runs of
+  // every distinct plan, and then sticks with the faster one for the plan.
+  std::vector<DataPtr> ExecuteChainedAdaptive(
+      absl::Span<const ExecuteChainedOp> ops, const std::string& device);
+
   // Creates an XRT graph with an XRTCompile operation:
   //
   //  XRTCompile(
@@ -510,6 +579,24 @@ class XrtComputationClient : public ComputationClient {
                                             const tensorflow::Scope& scope,
                                             const std::string& device) const;
 
+  // Creates an XRT graph with an XRTReadToTensor operation, which returns the
+  // device data as a tensor (in the physical layout of the device data)
+  // instead of a serialized LiteralProto:
+  //
+  //  XRTReadToTensor(
+  //    holders[0]
+  //  )
+  //
+  // With:
+  //  holders[0] = The handle place-holder to be read (DT_INT64)
+  const XrtSession::CachedNode& GetReadToTensorNode(
+      XrtSession* session, const tensorflow::Scope& scope,
+      const std::string& device, PrimitiveType type) const;
+
+  // Whether the device data of the given shape, read through the session, can
+  // skip the LiteralProto round trip (see XRT_READ_TO_TENSOR).
+  bool UseReadToTensor(XrtSession* session, const Shape& shape) const;
+
   // Creates an XRTAllocateFromTensor node for creating a device tensor with
   // the given shape and layout:
   //
@@ -606,21 +693,59 @@ class XrtComputationClient : public ComputationClient {
 
   Options options_;
   std::mutex lock_;
+  // Set while the devices get initialized in the background, and completed
+  // once InitializeDevices() returns.
+  std::shared_ptr<util::MultiWait> init_wait_;
   std::map<std::string, std::vector<int>> device_mesh_coords_;
+  // The control and execute traffic class.
   std::unique_ptr<XrtSessionCache> session_cache_;
+  // The bulk data traffic class (the uploads, and the reads of at least
+  // XRT_BULK_TRANSFER_MIN_BYTES), whose sessions never share their gRPC
+  // connections with the ones of session_cache_.
   std::unique_ptr<XrtSessionCache> alloc_session_cache_;
+  // Only set when XRT_GRPC_COMPRESSION_MIN_BYTES restricts compression to the
+  // transfers selected by ShouldCompressTransfer().
+  std::unique_ptr<XrtSessionCache> compressed_session_cache_;
   std::unique_ptr<util::TriggeredTask> triggered_task_;
   XrtLocalService* local_service_ = nullptr;
+  // The target of the in-process XRT service, empty if there is none.
+  std::string local_target_;
   util::Cache<CompilationCacheKey, Computation, CompilationCacheKey::Hash>
       compilation_cache_;
   std::atomic<size_t> rng_seed_;
+  // The timings of the chained execution implementations, by plan hash.
+  // Access to the objects within the cache must be done while holding lock_.
+  struct ChainedExecStats {
+    int64_t runs[2] = {0, 0};
+    int64_t min_time_ns[2] = {0, 0};
+    // Set to the index of the selected implementation (0 for XRT, 1 for
+    // split), once enough samples have been collected.
+    int selected = -1;
+  };
+  util::Cache<size_t, ChainedExecStats> chained_exec_stats_;
+  // The execute feeds recorded by the GPU execution replay mode, by
+  // computation handle, device and result tuple explosion. Null when the mode
+  // is disabled. The recorded objects are never modified, but replaced.
+  struct ExecReplay {
+    size_t rng_seed = 0;
+    std::string exec_config;
+    std::vector<int64_t> argument_handles;
+    tensorflow::Tensor inputs;
+  };
+  std::unique_ptr<util::Cache<std::string, ExecReplay>> exec_replays_;
   // Access to the following members must be done while holding lock_.
   // XRT thread safety semantics.
   std::vector<DeviceHandle> released_data_handles_;
   std::vector<DeviceHandle> released_compile_handles_;
+  // The devices which the last GetMemoryInfo() call reported as being low on
+  // free memory. Releases for such devices are not batched.
+  std::set<std::string> memory_pressure_devices_;
   // The mesh service which is used to coordinate all the client hosts which are
   // feeding different TPU devices in a POD (or slice) training.
   std::unique_ptr<service::MeshService> mesh_service_;
+  // Joins the mesh service rendezvous on behalf of all the processes of this
+  // host.
+  std::unique_ptr<service::MeshAggregator> mesh_aggregator_;
   std::shared_ptr<std::vector<std::string>> replication_devices_;
 };
 
@@ -1,5 +1,7 @@
 #include "tensorflow/compiler/xla/xla_client/xrt_session_cache.h"
 
+#include <vector>
+
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 
@@ -7,10 +9,13 @@ namespace xla {
 
 XrtSessionCache::XrtSessionCache(tensorflow::ConfigProto config,
                                  std::function<void(XrtSession*)> initfn,
-                                 std::string local_target)
+                                 std::string local_target, bool compress,
+                                 bool dedicated_connections)
     : config_(std::move(config)),
       initfn_(std::move(initfn)),
-      local_target_(std::move(local_target)) {}
+      local_target_(std::move(local_target)),
+      compress_(compress),
+      dedicated_connections_(dedicated_connections) {}
 
 XrtSessionCache::Ref XrtSessionCache::GetSession(const std::string& target) {
   std::lock_guard<std::mutex> lock(lock_);
@@ -21,6 +26,9 @@ XrtSessionCache::Ref XrtSessionCache::GetSession(const std::string& target) {
     session->Reset();
     return Ref(this, std::move(session));
   }
+  // All the cached sessions for the target are in use, so the pool is
+  // saturated and we need to create a new one.
+  XLA_COUNTER("XrtSessionPoolMiss", 1);
   return Ref(this, CreateSession(target));
 }
 
@@ -38,6 +46,20 @@ void XrtSessionCache::AddSession(std::shared_ptr<XrtSession> session) {
   session_map_[session->target()].push_back(std::move(session));
 }
 
+void XrtSessionCache::Prewarm(const std::string& target, size_t count) {
+  std::vector<std::shared_ptr<XrtSession>> sessions;
+  sessions.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    sessions.push_back(CreateSession(target));
+  }
+  std::lock_guard<std::mutex> lock(lock_);
+  auto& session_queue = session_map_[target];
+  for (auto& session : sessions) {
+    session->Reset();
+    session_queue.push_back(std::move(session));
+  }
+}
+
 std::shared_ptr<XrtSession> XrtSessionCache::CreateSession(
     const std::string& target) const {
   XLA_COUNTER("XrtSessionCount", 1);
@@ -52,14 +74,15 @@ std::shared_ptr<XrtSession> XrtSessionCache::CreateSession(
       session_options.config.mutable_rpc_options();
 
   std::string compression = sys_util::GetEnvString("XRT_GRPC_COMPRESSION", "");
-  if (!compression.empty()) {
+  if (!compression.empty() && compress_) {
     rpc_options->set_compression_algorithm(compression);
     rpc_options->set_compression_level(
         sys_util::GetEnvInt("XRT_GRPC_COMPRESSION_LEVEL", 3));
   }
 
   bool multi_stream = sys_util::GetEnvBool("XRT_GRPC_MULTISTREAM", true);
-  rpc_options->set_disable_session_connection_sharing(multi_stream);
+  rpc_options->set_disable_session_connection_sharing(multi_stream ||
+                                                      dedicated_connections_);
 
   std::shared_ptr<XrtSession> session =
       std::make_shared<XrtSession>(session_options);
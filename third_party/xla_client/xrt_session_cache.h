@@ -66,9 +66,15 @@ class XrtSessionCache {
   // Map from session target to XrtSession reference.
   using SessionMap = std::map<std::string, Ref>;
 
+  // If compress is false, the sessions created by the cache will not use gRPC
+  // compression, even if XRT_GRPC_COMPRESSION is set. If dedicated_connections
+  // is true, every session created by the cache gets its own gRPC connection,
+  // even if XRT_GRPC_MULTISTREAM is disabled, so that its traffic never queues
+  // behind the one of the other sessions.
   XrtSessionCache(tensorflow::ConfigProto config,
                   std::function<void(XrtSession*)> initfn,
-                  std::string local_target);
+                  std::string local_target, bool compress = true,
+                  bool dedicated_connections = false);
 
   const tensorflow::ConfigProto& GetConfig() const { return config_; }
 
@@ -84,12 +90,19 @@ class XrtSessionCache {
 
   void AddSession(std::shared_ptr<XrtSession> session);
 
+  // Creates count sessions for the given target, and adds them to the cache,
+  // so that the first users of the target do not pay the session creation
+  // (and initialization) cost.
+  void Prewarm(const std::string& target, size_t count);
+
  private:
   std::shared_ptr<XrtSession> CreateSession(const std::string& target) const;
 
   tensorflow::ConfigProto config_;
   std::function<void(XrtSession*)> initfn_;
   std::string local_target_;
+  bool compress_;
+  bool dedicated_connections_;
   std::mutex lock_;
   std::map<std::string, std::deque<std::shared_ptr<XrtSession>>> session_map_;
 };
@@ -68,6 +68,8 @@ _fd, _tmp_fname = -1, ''
 def _setup_debug_env():
   fd, tmp_fname = tempfile.mkstemp('.ptxla', text=True)
   _set_missing_env('XLA_FNTRACKER_FILE', tmp_fname)
+  # The summary only covers the CPU fallbacks, not the ATen operations.
+  _set_missing_env('XLA_FNTRACKER_LEVEL', '3')
   return fd, tmp_fname
 
 
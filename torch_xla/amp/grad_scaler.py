@@ -22,6 +22,11 @@ class GradScaler(torch.cuda.amp.GradScaler):
       use_zero_grad (bool, optional, default=False): If ``True``, enables the torch_xla specific zero gradients
           optimization that performs ``optimizer.step()`` with gradients set to zero instead of skipping it when
           inf/NaN gradients occur. This may improve the performance by removing the barrier in GradScaler.
+
+  The syncfree optimizers (see ``torch_xla.amp.syncfree``) skip the steps with inf/NaN gradients within
+  their fused update. The other optimizers run the step, and have their parameters and state selected
+  back, on device, to the values before it, as long as their state is made of XLA tensors. Only the
+  first step, and the optimizers with host side state, wait for ``found_inf`` on the host.
   """
 
   def __init__(
@@ -73,9 +78,55 @@ class GradScaler(torch.cuda.amp.GradScaler):
         grad.nan_to_num_()
         grad.mul_(scaling_factor)
       retval = optimizer.step(*args, **kwargs)
+    elif self._can_skip_on_device(optimizer):
+      found_inf = torch.stack(
+          tuple(optimizer_state["found_inf_per_device"].values())).sum()
+      retval = self._skip_on_device_step(optimizer, found_inf, *args, **kwargs)
     else:
       xm.mark_step()
       if not sum(
           v.item() for v in optimizer_state["found_inf_per_device"].values()):
         retval = optimizer.step(*args, **kwargs)
     return retval
+
+  def _optimized_params(self, optimizer):
+    for group in optimizer.param_groups:
+      for p in group['params']:
+        if p.grad is not None:
+          yield p
+
+  def _can_skip_on_device(self, optimizer):
+    # The step can be undone on device only if all of the state it updates is
+    # held by XLA tensors which exist before the step, that is, past the first
+    # step, and with no host side values (like CPU step counters) in the state.
+    for p in self._optimized_params(optimizer):
+      state = optimizer.state.get(p)
+      if not state:
+        return False
+      for value in state.values():
+        if value is not None and not (isinstance(value, torch.Tensor) and
+                                      xm.is_xla_tensor(value)):
+          return False
+    return True
+
+  def _skip_on_device_step(self, optimizer, found_inf, *args, **kwargs):
+    # Runs the step unconditionally, and selects, on device, between the
+    # updated values and the ones before the step according to found_inf, so
+    # that the non syncfree optimizers need no host round trip either. The
+    # clones share the buffers of their sources, which the step does not
+    # overwrite in place outside of the step barrier.
+    snapshots = []
+    with torch.no_grad():
+      for p in self._optimized_params(optimizer):
+        state = optimizer.state[p]
+        snapshots.append((p, p.detach().clone(), {
+            k: v.detach().clone() for k, v in state.items() if v is not None
+        }))
+      retval = optimizer.step(*args, **kwargs)
+      skip = found_inf != 0
+      for p, p_old, state_old in snapshots:
+        p.copy_(torch.where(skip, p_old, p))
+        state = optimizer.state[p]
+        for k, v_old in state_old.items():
+          state[k].copy_(torch.where(skip, v_old, state[k]))
+    return retval
@@ -1,3 +1,5 @@
+from .adafactor import Adafactor
 from .adam import Adam
 from .adamw import AdamW
+from .lamb import Lamb
 from .sgd import SGD
@@ -12,17 +12,47 @@ def adam_step(found_inf: Tensor, state_steps: List[Tensor],
   r"""Functional API that performs PT-XLA sync-free Adam/AdamW algorithm computation
    """
 
-  for i, param in enumerate(params):
-    grad = grads[i]
-    exp_avg = exp_avgs[i]
-    exp_avg_sq = exp_avg_sqs[i]
-    step = state_steps[i]
-    max_exp_avg_sq = max_exp_avg_sqs[i]
-    torch_xla._XLAC._xla_adam_optimizer_step_(found_inf, step, param, grad,
-                                              exp_avg, exp_avg_sq,
-                                              max_exp_avg_sq, beta1, beta2, lr,
-                                              weight_decay, eps, amsgrad,
-                                              maximize, use_adamw)
+  if not params:
+    return
+  # All the parameters get updated within a single fused IR node.
+  torch_xla._XLAC._xla_foreach_adam_optimizer_step_(
+      found_inf, state_steps, params, grads, exp_avgs, exp_avg_sqs,
+      max_exp_avg_sqs, beta1, beta2, lr, weight_decay, eps, amsgrad, maximize,
+      use_adamw)
+
+
+def lamb_step(found_inf: Tensor, state_steps: List[Tensor],
+              params: List[Tensor], grads: List[Tensor], exp_avgs: List[Tensor],
+              exp_avg_sqs: List[Tensor], *, beta1: float, beta2: float,
+              lr: float, weight_decay: float, eps: float):
+  r"""Functional API that performs PT-XLA sync-free LAMB algorithm computation.
+   """
+
+  if not params:
+    return
+  torch_xla._XLAC._xla_lamb_optimizer_step_(found_inf, state_steps, params,
+                                            grads, exp_avgs, exp_avg_sqs, beta1,
+                                            beta2, lr, weight_decay, eps)
+
+
+def adafactor_step(found_inf: Tensor, state_steps: List[Tensor],
+                   params: List[Tensor], grads: List[Tensor],
+                   exp_avg_sqs: List[Tensor], exp_avg_sq_rows: List[Tensor],
+                   exp_avg_sq_cols: List[Tensor], *, lr: float,
+                   weight_decay: float, decay_rate: float, eps1: float,
+                   eps2: float, clip_threshold: float, scale_parameter: bool):
+  r"""Functional API that performs PT-XLA sync-free Adafactor algorithm
+  computation. The `exp_avg_sqs` are the second moments of the parameters with
+  less than two dimensions, and the `exp_avg_sq_rows` and `exp_avg_sq_cols` the
+  factored second moments of the others, in the order of `params`.
+   """
+
+  if not params:
+    return
+  torch_xla._XLAC._xla_adafactor_optimizer_step_(
+      found_inf, state_steps, params, grads, exp_avg_sqs, exp_avg_sq_rows,
+      exp_avg_sq_cols, lr, weight_decay, decay_rate, eps1, eps2,
+      clip_threshold, scale_parameter)
 
 
 def sgd_step(found_inf: Tensor, state_steps: List[Tensor], params: List[Tensor],
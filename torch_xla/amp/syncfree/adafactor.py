@@ -0,0 +1,139 @@
+import torch
+from torch import Tensor
+from . import _functional as F
+
+
+class Adafactor(torch.optim.Optimizer):
+  r"""PT-XLA implementation of the Adafactor optimizer with syncfree support for
+    AMP mode. It takes an optional `found_inf` tensor in optimizer.step to
+    indicate whether this optimizer.step should be performed (found_inf is 0 or
+    None) or skipped (found_inf != 0).
+
+    The second moment of the parameters with two or more dimensions is factored
+    into running averages of its rows and columns (the last two dimensions),
+    and the parameters of every group are updated within a single fused IR node.
+    This implementation uses the given learning rate (no relative step sizes)
+    and keeps no first moment.
+
+    It has been proposed in `Adafactor: Adaptive Learning Rates with Sublinear
+    Memory Cost`_.
+
+    Args:
+        params (iterable): iterable of parameters to optimize or dicts defining
+            parameter groups
+        lr (float, optional): learning rate (default: 1e-3)
+        eps (Tuple[float, float], optional): regularization constants for the
+            squared gradient and the parameter scale respectively
+            (default: (1e-30, 1e-3))
+        clip_threshold (float, optional): threshold of the root mean square of
+            the final update (default: 1.0)
+        decay_rate (float, optional): coefficient used to compute the running
+            averages of the squared gradient (default: -0.8)
+        weight_decay (float, optional): weight decay coefficient (default: 0)
+        scale_parameter (bool, optional): if True, the learning rate is scaled
+            by the root mean square of the parameter (default: True)
+
+    .. _Adafactor\: Adaptive Learning Rates with Sublinear Memory Cost:
+        https://arxiv.org/abs/1804.04235
+    """
+
+  def __init__(self,
+               params,
+               lr=1e-3,
+               eps=(1e-30, 1e-3),
+               clip_threshold=1.0,
+               decay_rate=-0.8,
+               weight_decay=0.0,
+               scale_parameter=True):
+    if not 0.0 <= lr:
+      raise ValueError("Invalid learning rate: {}".format(lr))
+    if not 0.0 <= weight_decay:
+      raise ValueError("Invalid weight_decay value: {}".format(weight_decay))
+    defaults = dict(
+        lr=lr,
+        eps=eps,
+        clip_threshold=clip_threshold,
+        decay_rate=decay_rate,
+        weight_decay=weight_decay,
+        scale_parameter=scale_parameter)
+    super(Adafactor, self).__init__(params, defaults)
+
+  @torch.no_grad()
+  def step(self, closure=None, found_inf: Tensor = None):
+    """Performs a single optimization step.
+
+        Args:
+            closure (callable, optional): A closure that reevaluates the model
+                and returns the loss.
+            found_inf (torch.Tensor, optional): A scalar tensor indicates if
+                the optimizer.step should be performed (found_inf is 0 or None) or
+                skipped (found_inf == 1).
+        """
+    if found_inf is not None and found_inf.shape:
+      raise ValueError("The found_inf tensor has to be scalar type")
+
+    loss = None
+    if closure is not None:
+      with torch.enable_grad():
+        loss = closure()
+
+    for group in self.param_groups:
+      params_with_grad = []
+      grads = []
+      exp_avg_sqs = []
+      exp_avg_sq_rows = []
+      exp_avg_sq_cols = []
+      state_steps = []
+      eps1, eps2 = group['eps']
+
+      for p in group['params']:
+        if p.grad is not None:
+          if found_inf is None:
+            found_inf = torch.zeros((), dtype=torch.float, device=p.device)
+          params_with_grad.append(p)
+          if p.grad.is_sparse:
+            raise RuntimeError('Adafactor does not support sparse gradients')
+          grads.append(p.grad)
+
+          state = self.state[p]
+          factored = p.dim() >= 2
+
+          # Lazy state initialization
+          if not state:
+            state['step'] = torch.zeros_like(found_inf)
+            if factored:
+              # Exponential moving averages of the rows and columns means of
+              # the squared gradient values
+              state['exp_avg_sq_row'] = torch.zeros(
+                  p.shape[:-1], dtype=p.dtype, device=p.device)
+              state['exp_avg_sq_col'] = torch.zeros(
+                  p.shape[:-2] + p.shape[-1:], dtype=p.dtype, device=p.device)
+            else:
+              # Exponential moving average of squared gradient values
+              state['exp_avg_sq'] = torch.zeros_like(
+                  p, memory_format=torch.preserve_format)
+
+          if factored:
+            exp_avg_sq_rows.append(state['exp_avg_sq_row'])
+            exp_avg_sq_cols.append(state['exp_avg_sq_col'])
+          else:
+            exp_avg_sqs.append(state['exp_avg_sq'])
+          state_steps.append(state['step'])
+
+      F.adafactor_step(
+          found_inf,
+          state_steps,
+          params_with_grad,
+          grads,
+          exp_avg_sqs,
+          exp_avg_sq_rows,
+          exp_avg_sq_cols,
+          lr=group['lr'],
+          weight_decay=group['weight_decay'],
+          decay_rate=group['decay_rate'],
+          eps1=eps1,
+          eps2=eps2,
+          clip_threshold=group['clip_threshold'],
+          scale_parameter=group['scale_parameter'])
+
+    return loss
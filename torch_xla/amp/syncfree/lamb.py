@@ -0,0 +1,118 @@
+import torch
+from torch import Tensor
+from . import _functional as F
+
+
+class Lamb(torch.optim.Optimizer):
+  r"""PT-XLA implementation of the LAMB optimizer with syncfree support for AMP
+    mode. It takes an optional `found_inf` tensor in optimizer.step to indicate
+    whether this optimizer.step should be performed (found_inf is 0 or None) or
+    skipped (found_inf != 0).
+
+    The parameters of every group are updated within a single fused IR node.
+
+    It has been proposed in `Large Batch Optimization for Deep Learning:
+    Training BERT in 76 minutes`_.
+
+    Args:
+        params (iterable): iterable of parameters to optimize or dicts defining
+            parameter groups
+        lr (float, optional): learning rate (default: 1e-3)
+        betas (Tuple[float, float], optional): coefficients used for computing
+            running averages of gradient and its square (default: (0.9, 0.999))
+        eps (float, optional): term added to the denominator to improve
+            numerical stability (default: 1e-6)
+        weight_decay (float, optional): weight decay, added to the update before
+            the trust ratio scaling (default: 0)
+
+    .. _Large Batch Optimization for Deep Learning\: Training BERT in 76 minutes:
+        https://arxiv.org/abs/1904.00962
+    """
+
+  def __init__(self,
+               params,
+               lr=1e-3,
+               betas=(0.9, 0.999),
+               eps=1e-6,
+               weight_decay=0):
+    if not 0.0 <= lr:
+      raise ValueError("Invalid learning rate: {}".format(lr))
+    if not 0.0 <= eps:
+      raise ValueError("Invalid epsilon value: {}".format(eps))
+    if not 0.0 <= betas[0] < 1.0:
+      raise ValueError("Invalid beta parameter at index 0: {}".format(
+          betas[0]))
+    if not 0.0 <= betas[1] < 1.0:
+      raise ValueError("Invalid beta parameter at index 1: {}".format(
+          betas[1]))
+    if not 0.0 <= weight_decay:
+      raise ValueError("Invalid weight_decay value: {}".format(weight_decay))
+    defaults = dict(lr=lr, betas=betas, eps=eps, weight_decay=weight_decay)
+    super(Lamb, self).__init__(params, defaults)
+
+  @torch.no_grad()
+  def step(self, closure=None, found_inf: Tensor = None):
+    """Performs a single optimization step.
+
+        Args:
+            closure (callable, optional): A closure that reevaluates the model
+                and returns the loss.
+            found_inf (torch.Tensor, optional): A scalar tensor indicates if
+                the optimizer.step should be performed (found_inf is 0 or None) or
+                skipped (found_inf == 1).
+        """
+    if found_inf is not None and found_inf.shape:
+      raise ValueError("The found_inf tensor has to be scalar type")
+
+    loss = None
+    if closure is not None:
+      with torch.enable_grad():
+        loss = closure()
+
+    for group in self.param_groups:
+      params_with_grad = []
+      grads = []
+      exp_avgs = []
+      exp_avg_sqs = []
+      state_steps = []
+      beta1, beta2 = group['betas']
+
+      for p in group['params']:
+        if p.grad is not None:
+          if found_inf is None:
+            found_inf = torch.zeros((), dtype=torch.float, device=p.device)
+          params_with_grad.append(p)
+          if p.grad.is_sparse:
+            raise RuntimeError('Lamb does not support sparse gradients')
+          grads.append(p.grad)
+
+          state = self.state[p]
+
+          # Lazy state initialization
+          if not state:
+            state['step'] = torch.zeros_like(found_inf)
+            # Exponential moving average of gradient values
+            state['exp_avg'] = torch.zeros_like(
+                p, memory_format=torch.preserve_format)
+            # Exponential moving average of squared gradient values
+            state['exp_avg_sq'] = torch.zeros_like(
+                p, memory_format=torch.preserve_format)
+
+          exp_avgs.append(state['exp_avg'])
+          exp_avg_sqs.append(state['exp_avg_sq'])
+          state_steps.append(state['step'])
+
+      F.lamb_step(
+          found_inf,
+          state_steps,
+          params_with_grad,
+          grads,
+          exp_avgs,
+          exp_avg_sqs,
+          beta1=beta1,
+          beta2=beta2,
+          lr=group['lr'],
+          weight_decay=group['weight_decay'],
+          eps=group['eps'])
+
+    return loss
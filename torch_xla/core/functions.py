@@ -1,3 +1,5 @@
+import collections
+import math
 import torch
 import torch_xla
 import torch_xla.core.xla_model as xm
@@ -107,6 +109,648 @@ def nms(boxes, scores, score_threshold, iou_threshold, output_size):
                                   output_size)
 
 
+def batched_nms(boxes, scores, idxs, score_threshold, iou_threshold,
+                output_size):
+  """Performs a Non Maximal Suppression operation within groups of boxes.
+
+  Same as `nms()`, but boxes only suppress the boxes with the same group index,
+  so that the boxes of all the classes (and images) get processed at once.
+
+  Args:
+    boxes (torch.Tensor): A `torch.Tensor` of shape `[N, 4]` listing the boxes
+      coordinates in `(y0, x0, y1, x1)` form.
+    scores (torch.Tensor): A `torch.Tensor` of shape `[N]` listing the scores
+      of each box.
+    idxs (torch.Tensor): A `torch.Tensor` of shape `[N]` listing the group
+      index of each box, like its class, or a combined image and class index.
+    score_threshold (torch.Tensor): The minimum score for a box to qualify as
+      valid.
+    iou_threshold (torch.Tensor): The minimum IOU (Intersection Over Union)
+      score to trigger overlap logic.
+    output_size (int): The maximum number of returned indices (must be lower or
+      equal to N).
+
+  Returns:
+    A tuple of `torch.Tensor` with the first element being the selected box
+    indices, and the second element being the number of valid boxes.
+  """
+  return torch_xla._XLAC._xla_batched_nms(boxes, scores, idxs, score_threshold,
+                                          iou_threshold, output_size)
+
+
+def crop_and_resize(images, boxes, output_size):
+  """Crops a box out of every image, and bilinearly resizes it.
+
+  The crops run on the device, as interpolation matmuls, so the images can be
+  uploaded in their raw form (like ``uint8``), and the boxes can be computed on
+  the device.
+
+  Args:
+    images (torch.Tensor): A `torch.Tensor` of shape `[N, C, H, W]`.
+    boxes (torch.Tensor): A `torch.Tensor` of shape `[N, 4]` listing the crop
+      box of each image, in `(y0, x0, y1, x1)` form, normalized to `[0, 1]`.
+      The box corners map on the corner pixels of the crops, so that a box
+      with `x0 > x1` (or `y0 > y1`) gets flipped.
+    output_size (tuple): The `(height, width)` of the crops.
+
+  Returns:
+    A float `torch.Tensor` of shape `[N, C, output_size[0], output_size[1]]`,
+    with the same value range as the input images.
+  """
+  return torch_xla._XLAC._xla_crop_and_resize(images, boxes, list(output_size))
+
+
+def random_resized_crop(images,
+                        output_size,
+                        scale=(0.08, 1.0),
+                        ratio=(3.0 / 4.0, 4.0 / 3.0),
+                        flip_prob=0.5):
+  """Crops a random box out of every image, and resizes it, on the device.
+
+  Like the `RandomResizedCrop` and `RandomHorizontalFlip` vision transforms,
+  but for a whole batch at once, with the boxes drawn by the device RNG. Boxes
+  which would not fit the image get clamped to its size, instead of being
+  drawn again.
+
+  Args:
+    images (torch.Tensor): A `torch.Tensor` of shape `[N, C, H, W]`.
+    output_size (tuple): The `(height, width)` of the crops.
+    scale (tuple, optional): The range of the area of the boxes, relative to
+      the area of the images.
+      Default: (0.08, 1.0)
+    ratio (tuple, optional): The range of the aspect ratio of the boxes.
+      Default: (3/4, 4/3)
+    flip_prob (float, optional): The probability of a crop to be flipped
+      horizontally.
+      Default: 0.5
+
+  Returns:
+    The float crops, as returned by `crop_and_resize()`.
+  """
+  n, _, h, w = images.shape
+  device = images.device
+  area = torch.empty(n, device=device).uniform_(scale[0], scale[1])
+  aspect = torch.exp(
+      torch.empty(n, device=device).uniform_(
+          math.log(ratio[0]), math.log(ratio[1])))
+  crop_h = torch.sqrt(area * w / (aspect * h)).clamp(max=1.0)
+  crop_w = torch.sqrt(area * aspect * h / w).clamp(max=1.0)
+  y0 = torch.rand(n, device=device) * (1.0 - crop_h)
+  x0 = torch.rand(n, device=device) * (1.0 - crop_w)
+  x1 = x0 + crop_w
+  flip = torch.rand(n, device=device) < flip_prob
+  # Swapping the horizontal box coordinates flips the crop.
+  x0, x1 = torch.where(flip, x1, x0), torch.where(flip, x0, x1)
+  boxes = torch.stack([y0, x0, y0 + crop_h, x1], dim=1)
+  return crop_and_resize(images, boxes, output_size)
+
+
+def _random_factors(n, amount, device):
+  return torch.empty(
+      n, 1, 1, 1, device=device).uniform_(max(0.0, 1.0 - amount), 1.0 + amount)
+
+
+def color_jitter(images, brightness=0.0, contrast=0.0, saturation=0.0,
+                 max_value=1.0):
+  """Randomly changes the brightness, contrast and saturation of the images.
+
+  Like the `ColorJitter` vision transform, but for a whole batch at once, with
+  the factors drawn by the device RNG, and applied in a fixed order.
+
+  Args:
+    images (torch.Tensor): A float `torch.Tensor` of shape `[N, 3, H, W]`, with
+      RGB values within `[0, max_value]`.
+    brightness (float, optional): The brightness factors get drawn within
+      `[max(0, 1 - brightness), 1 + brightness]`.
+      Default: 0
+    contrast (float, optional): Like `brightness`, for the contrast.
+      Default: 0
+    saturation (float, optional): Like `brightness`, for the saturation.
+      Default: 0
+    max_value (float, optional): The maximum value of the images, which the
+      results get clamped to.
+      Default: 1.0
+
+  Returns:
+    The jittered images.
+  """
+  n = images.shape[0]
+  weights = torch.tensor([0.299, 0.587, 0.114],
+                         dtype=images.dtype,
+                         device=images.device).view(1, 3, 1, 1)
+
+  def grayscale(x):
+    return (x * weights).sum(dim=1, keepdim=True)
+
+  if brightness > 0:
+    images = (images * _random_factors(n, brightness, images.device)).clamp(
+        0, max_value)
+  if contrast > 0:
+    mean = grayscale(images).mean(dim=(2, 3), keepdim=True)
+    factors = _random_factors(n, contrast, images.device)
+    images = ((images - mean) * factors + mean).clamp(0, max_value)
+  if saturation > 0:
+    gray = grayscale(images)
+    factors = _random_factors(n, saturation, images.device)
+    images = ((images - gray) * factors + gray).clamp(0, max_value)
+  return images
+
+
+def normalize(images, mean, std, scale=1.0):
+  """Normalizes the channels of the images, as `(images * scale - mean) / std`.
+
+  Args:
+    images (torch.Tensor): A `torch.Tensor` of shape `[N, C, H, W]`.
+    mean (list): The mean of every channel.
+    std (list): The standard deviation of every channel.
+    scale (float, optional): The scale applied to the images before the
+      normalization, like `1/255` for the crops of `uint8` images.
+      Default: 1.0
+
+  Returns:
+    The normalized float images.
+  """
+  if not images.is_floating_point():
+    images = images.float()
+  mean = torch.tensor(mean, dtype=images.dtype, device=images.device)
+  std = torch.tensor(std, dtype=images.dtype, device=images.device)
+  return (images * scale - mean.view(1, -1, 1, 1)) / std.view(1, -1, 1, 1)
+
+
+def scaled_dot_product_attention(query,
+                                 key,
+                                 value,
+                                 attn_mask=None,
+                                 is_causal=False,
+                                 scale=None):
+  """Computes the scaled dot product attention, with memory linear in the
+  sequence length.
+
+  The keys are processed in blocks of `XLA_FLASH_ATTENTION_BLOCK_SIZE`, with an
+  online softmax, so that the `[..., L, S]` attention scores are never
+  materialized, neither in the forward nor in the backward pass (which
+  recomputes them block by block).
+
+  Args:
+    query (torch.Tensor): The query, of shape `[..., L, E]`.
+    key (torch.Tensor): The key, of shape `[..., S, E]`.
+    value (torch.Tensor): The value, of shape `[..., S, Ev]`.
+    attn_mask (torch.Tensor, optional): A mask broadcastable to `[..., L, S]`.
+      A boolean mask is `True` for the positions taking part in the attention,
+      any other mask is added to the attention scores. The mask gets no
+      gradient.
+      Default: None
+    is_causal (bool): Whether the query position `i` only attends the key
+      positions up to `i`.
+      Default: False
+    scale (float, optional): The scaling of the attention scores.
+      Default: `1 / sqrt(E)`
+  Returns:
+    The attention output, of shape `[..., L, Ev]`.
+  """
+  return torch_xla._XLAC._xla_scaled_dot_product_attention(
+      query, key, value, attn_mask, is_causal, scale)
+
+
+def rms_norm(input, normalized_shape, weight=None, eps=1e-6):
+  """Applies the root mean square layer normalization.
+
+  The last `len(normalized_shape)` dimensions of the input are scaled by the
+  inverse of their root mean square, `x / sqrt(mean(x^2) + eps) * weight`,
+  within a single fused IR node (and a single fused node for its backward).
+
+  Args:
+    input (torch.Tensor): The input tensor.
+    normalized_shape (int or list): The trailing sizes of the input to
+      normalize over.
+    weight (torch.Tensor, optional): The `normalized_shape` scale of the
+      output.
+      Default: None
+    eps (float): The value added to the mean square for numerical stability.
+      Default: 1e-6
+  Returns:
+    The normalized tensor, with the shape and type of the input.
+  """
+  if isinstance(normalized_shape, int):
+    normalized_shape = [normalized_shape]
+  return torch_xla._XLAC._xla_rms_norm(input, list(normalized_shape), weight,
+                                       float(eps))
+
+
+def clip_grad_norm_(parameters, max_norm, norm_type=2.0):
+  """Clips the gradients of the parameters by their global norm.
+
+  Same as `torch.nn.utils.clip_grad_norm_()`, but computing the norm and
+  scaling all the gradients within a single IR node, instead of lowering a
+  separate subgraph for every parameter.
+
+  Args:
+    parameters (torch.Tensor or list): A tensor, or a list of tensors, whose
+      gradients get clipped.
+    max_norm (float): The max global norm of the gradients.
+    norm_type (float): The type of the p-norm, which can be `inf`.
+      Default: 2.0
+  Returns:
+    The global norm of the gradients, before the clipping, as a `float32`
+    tensor.
+  """
+  if isinstance(parameters, torch.Tensor):
+    parameters = [parameters]
+  grads = [p.grad for p in parameters if p.grad is not None]
+  if not grads:
+    return torch.tensor(0.0)
+  return torch_xla._XLAC._xla_foreach_clip_norm_(grads, float(max_norm),
+                                                 float(norm_type))
+
+
+def embedding_bag_sparse_sgd_(weight,
+                              grad,
+                              input,
+                              offsets,
+                              lr,
+                              mode='sum',
+                              per_sample_weights=None,
+                              include_last_offset=False,
+                              padding_idx=None):
+  """Applies an SGD step to the weight of an embedding bag, only updating the
+  rows selected by the input.
+
+  Unlike an optimizer step over the dense gradient of the weight, which reads
+  and writes the whole `[num_embeddings, embedding_dim]` table, the gradient
+  rows of the input are summed by a sorted segment reduction, and only the
+  rows of the distinct indices get updated.
+
+  Args:
+    weight (torch.Tensor): The `[num_embeddings, embedding_dim]` weight of the
+      embedding bag, updated in place. It should not be in the autograd graph.
+    grad (torch.Tensor): The gradient of the `[num_bags, embedding_dim]` output
+      of `torch.nn.functional.embedding_bag()`.
+    input (torch.Tensor): The rank 1 indices of the embedding bag.
+    offsets (torch.Tensor): The offsets into input of the bags.
+    lr (float): The learning rate.
+    mode (str): The reduction of the bags, one of `'sum'`, `'mean'` or
+      `'max'`.
+      Default: 'sum'
+    per_sample_weights (torch.Tensor, optional): The weights of the indices
+      (only for the `'sum'` mode).
+      Default: None
+    include_last_offset (bool): Whether offsets has one more element, the end
+      of the last bag.
+      Default: False
+    padding_idx (int, optional): The index whose row gets no update.
+      Default: None
+  """
+  modes = {'sum': 0, 'mean': 1, 'max': 2}
+  if padding_idx is None:
+    padding_idx = -1
+  elif padding_idx < 0:
+    padding_idx += weight.size(0)
+  torch_xla._XLAC._xla_embedding_bag_sparse_sgd_(weight, grad, input, offsets,
+                                                 float(lr), modes[mode],
+                                                 per_sample_weights,
+                                                 include_last_offset,
+                                                 padding_idx)
+
+
+def quantized_linear(input,
+                     weight,
+                     weight_scales,
+                     bias=None,
+                     input_scale=1.0,
+                     input_zero_point=0,
+                     output_scale=None,
+                     output_zero_point=0):
+  """Applies an int8 linear layer, accumulating the products in int32.
+
+  The real value of the input is `input_scale * (input - input_zero_point)`,
+  and the one of the weight is `weight_scales[n] * weight[n]` for every output
+  feature `n` (the weight is quantized symmetrically per channel). The scaling
+  of the accumulators, the bias addition and the requantization of the output
+  are fused with the matmul.
+
+  Args:
+    input (torch.Tensor): The `torch.int8` input, of shape `[..., K]`.
+    weight (torch.Tensor): The `torch.int8` weight, of shape `[N, K]`.
+    weight_scales (torch.Tensor): The `[N]` float scales of the weight.
+    bias (torch.Tensor, optional): The `[N]` float bias.
+      Default: None
+    input_scale (float): The scale of the input.
+      Default: 1.0
+    input_zero_point (int): The zero point of the input.
+      Default: 0
+    output_scale (float, optional): The scale of the output. If missing, the
+      output is not requantized.
+      Default: None
+    output_zero_point (int): The zero point of the output.
+      Default: 0
+  Returns:
+    The `[..., N]` output, as `torch.int8` if `output_scale` is given, and
+    `torch.float32` otherwise.
+  """
+  return torch_xla._XLAC._xla_quantized_linear(
+      input, weight, weight_scales, bias, float(input_scale),
+      int(input_zero_point),
+      float(output_scale) if output_scale is not None else None,
+      int(output_zero_point))
+
+
+def quantized_conv(input,
+                   weight,
+                   weight_scales,
+                   bias=None,
+                   stride=1,
+                   padding=0,
+                   dilation=1,
+                   groups=1,
+                   input_scale=1.0,
+                   input_zero_point=0,
+                   output_scale=None,
+                   output_zero_point=0):
+  """Applies an int8 2D or 3D convolution, accumulating the products in int32.
+
+  Same as `quantized_linear()`, for the `[N, Cin, spatial...]` input and the
+  `[Cout, Cin / groups, spatial...]` weight, whose `[Cout]` scales are applied
+  to the channels of the output. The padding holds the input zero point, which
+  is the real value zero.
+
+  Args:
+    stride (int or list): The stride of the convolution.
+      Default: 1
+    padding (int or list): The padding of the spatial dimensions.
+      Default: 0
+    dilation (int or list): The dilation of the kernel.
+      Default: 1
+    groups (int): The number of groups of the input channels.
+      Default: 1
+  Returns:
+    The `[N, Cout, spatial...]` output, as `torch.int8` if `output_scale` is
+    given, and `torch.float32` otherwise.
+  """
+  num_spatial = input.dim() - 2
+
+  def expand(value):
+    return [value] * num_spatial if isinstance(value, int) else list(value)
+
+  return torch_xla._XLAC._xla_quantized_conv(
+      input, weight, weight_scales, bias, expand(stride), expand(padding),
+      expand(dilation), groups, float(input_scale), int(input_zero_point),
+      float(output_scale) if output_scale is not None else None,
+      int(output_zero_point))
+
+
+def pad_to_bucket(tensor, dim, buckets, value=0):
+  """Pads a tensor dimension to the smallest bucket size which can contain it.
+
+  Feeding models with tensors whose dynamic dimensions (like sequence lengths)
+  are bucketed bounds the number of distinct graphs which need to be compiled.
+  The amount of padding is reported by the `BucketPaddingElements` counter, out
+  of the `BucketedElements` total.
+
+  Args:
+    tensor (torch.Tensor): The tensor to be padded.
+    dim (int): The dimension to be padded.
+    buckets (list): The list of the bucket sizes. Sizes beyond the largest
+      bucket are rounded up to a multiple of it.
+    value (number): The value to be used for the padding.
+      Default: 0
+  Returns:
+    A tuple of `torch.Tensor` with the first element being the padded tensor,
+    and the second element being a boolean mask of the bucket size, which is
+    `True` for the positions of the original tensor.
+  """
+  return torch_xla._XLAC._xla_pad_to_bucket(tensor, dim, buckets, value)
+
+
+def nonzero_padded(input):
+  """Returns the indices of the non zero elements, padded to a static size.
+
+  Unlike `torch.nonzero()`, whose result size depends on the data, the indices
+  keep the size of the upper bound (the number of elements of `input`), so that
+  they compose with the following operations without syncing the graph to read
+  the actual count. The `AvoidedSizeSyncs` counter reports those calls.
+
+  Args:
+    input (torch.Tensor): The input tensor.
+  Returns:
+    A tuple of `torch.Tensor` with the first element being the
+    `[input.numel(), input.dim()]` indices, whose rows past the count are zeros,
+    and the second element being the scalar count of the non zero elements.
+  """
+  return torch_xla._XLAC._xla_nonzero_padded(input)
+
+
+def masked_select_padded(input, mask):
+  """Same as `torch.masked_select()`, padded to a static size.
+
+  Args:
+    input (torch.Tensor): The input tensor.
+    mask (torch.Tensor): The boolean mask, broadcastable to `input`.
+  Returns:
+    A tuple of `torch.Tensor` with the first element being the `[input.numel()]`
+    selected values, which are zeros past the count, and the second element
+    being the scalar count of the selected values.
+  """
+  return torch_xla._XLAC._xla_masked_select_padded(input, mask)
+
+
+class AppendBuffer(object):
+  """A tensor growing along one dimension, replacing chains of `torch.cat()`.
+
+  Concatenating to a tensor at every step (like the decoding loops do) copies
+  all the previous data, and changes the shapes of the graph at every step. The
+  buffer instead preallocates a device tensor and writes the appended data at
+  its length, kept on device, so that an append only moves the new data and
+  generates the same graph at every step. The capacity doubles when full.
+
+  Args:
+    tensor (torch.Tensor): The initial content of the buffer.
+    dim (int): The dimension along which the data gets appended.
+      Default: 0
+    capacity (int, optional): The initial capacity of the buffer along `dim`.
+      Default: the size of `tensor` along `dim`
+  """
+
+  def __init__(self, tensor, dim=0, capacity=None):
+    self._dim = dim if dim >= 0 else dim + tensor.dim()
+    self._length = tensor.size(self._dim)
+    self._data = self._grow(tensor, max(capacity or 0, self._length, 1))
+    self._offset = torch.tensor(
+        self._length, dtype=torch.int64, device=tensor.device)
+
+  def _grow(self, tensor, capacity):
+    size = tensor.size(self._dim)
+    if capacity == size:
+      return tensor
+    shape = list(tensor.size())
+    shape[self._dim] = capacity - size
+    return torch.cat([tensor, tensor.new_zeros(shape)], dim=self._dim)
+
+  def append(self, tensor):
+    """Appends `tensor`, which must match the buffer but along `dim`."""
+    size = tensor.size(self._dim)
+    capacity = self.capacity
+    while self._length + size > capacity:
+      capacity *= 2
+    if capacity != self.capacity:
+      self._data = self._grow(self._data, capacity)
+    self._data = torch_xla._XLAC._xla_dynamic_update_slice(
+        self._data, tensor, self._offset, self._dim)
+    self._offset = self._offset + size
+    self._length += size
+
+  def __len__(self):
+    return self._length
+
+  @property
+  def capacity(self):
+    return self._data.size(self._dim)
+
+  @property
+  def data(self):
+    """The whole preallocated tensor, whose shape only changes on growth."""
+    return self._data
+
+  def mask(self):
+    """The boolean mask of the `data` positions along `dim` holding data."""
+    positions = torch.arange(
+        self.capacity, dtype=torch.int64, device=self._data.device)
+    return positions < self._offset
+
+  def tensor(self):
+    """The appended data, like the result of the `torch.cat()` chain."""
+    return self._data.narrow(self._dim, 0, self._length)
+
+
+class AllToAll(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, split_dimension, concat_dimension, split_count):
+    ctx.split_dimension = split_dimension
+    ctx.concat_dimension = concat_dimension
+    ctx.split_count = split_count
+    return xm.all_to_all(input, split_dimension, concat_dimension, split_count)
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    return xm.all_to_all(grad_output, ctx.concat_dimension,
+                         ctx.split_dimension, ctx.split_count), None, None, None
+
+
+def all_to_all(value, split_dimension, concat_dimension, split_count):
+  """Same as `xm.all_to_all()` but supports autograd differentiation."""
+  return AllToAll.apply(value, split_dimension, concat_dimension, split_count)
+
+
+MoeDispatch = collections.namedtuple('MoeDispatch',
+                                     'dispatched slots weights counts')
+
+
+def _record_expert_load(counts, capacity):
+  torch_xla._XLAC._xla_record_expert_load(counts.cpu().tolist(), capacity)
+
+
+def moe_dispatch(tokens, router_logits, k, capacity, record_load=True):
+  """Routes the tokens to their top-k experts, with bounded expert capacity.
+
+  The routing computes the slot of every (token, choice) pair within its
+  expert with a cumulative count, and scatters the tokens into the expert
+  buffers, instead of building the dense one-hot dispatch and combine matmuls.
+  The first choices of all the tokens get slots before the second ones, and the
+  pairs which overflow the capacity of their expert are dropped.
+
+  Args:
+    tokens (torch.Tensor): The `[T, D]` tokens.
+    router_logits (torch.Tensor): The `[T, E]` router logits.
+    k (int): The number of experts per token.
+    capacity (int): The number of tokens each expert can receive.
+    record_load (bool, optional): Whether to post the expert load to the
+      ``MoeExpertLoadImbalance`` (maximum over mean expert load) and
+      ``MoeDroppedTokenFraction`` metrics, once the step has executed.
+      Default: True
+  Returns:
+    A `MoeDispatch` tuple with the `[E, capacity, D]` dispatched tokens, the
+    `[T, k]` slots and combine weights to be passed to `moe_combine()`, and the
+    `[E]` number of pairs routed to each expert before the capacity bound.
+  """
+  num_tokens = tokens.size(0)
+  num_experts = router_logits.size(-1)
+  probs = torch.softmax(router_logits, dim=-1, dtype=torch.float32)
+  gates, experts = probs.topk(k, dim=-1)
+  # Choice major, so that the first choices come first in the cumulative count.
+  flat_experts = experts.t().reshape(-1)
+  expert_mask = torch.nn.functional.one_hot(flat_experts, num_experts)
+  positions = (expert_mask.cumsum(0) - 1).gather(
+      1, flat_experts.unsqueeze(1)).squeeze(1)
+  keep = positions < capacity
+  # The dropped pairs all go to one extra overflow slot, which is discarded.
+  overflow = num_experts * capacity
+  slots = torch.where(keep, flat_experts * capacity + positions,
+                      torch.full_like(positions, overflow))
+  buffer = tokens.new_zeros(overflow + 1, tokens.size(1))
+  buffer = buffer.index_add(0, slots, tokens.repeat(k, 1))
+  dispatched = buffer[:overflow].view(num_experts, capacity, tokens.size(1))
+  weights = (gates.t().reshape(-1) * keep).view(k, num_tokens).t()
+  counts = expert_mask.sum(0)
+  if record_load:
+    xm.add_step_closure(
+        _record_expert_load, args=(counts, capacity), run_async=True)
+  return MoeDispatch(dispatched, slots.view(k, num_tokens).t(),
+                     weights.to(tokens.dtype), counts)
+
+
+def moe_combine(expert_outputs, slots, weights):
+  """Gathers the outputs of the experts back to the tokens.
+
+  Args:
+    expert_outputs (torch.Tensor): The `[E, capacity, D]` expert outputs.
+    slots (torch.Tensor): The `[T, k]` slots returned by `moe_dispatch()`.
+    weights (torch.Tensor): The `[T, k]` weights returned by `moe_dispatch()`.
+  Returns:
+    The `[T, D]` sum of the expert outputs of every token, weighted by its
+    gates, with zero contributions for the dropped choices.
+  """
+  num_experts, capacity, dim = expert_outputs.shape
+  flat = torch.cat([
+      expert_outputs.reshape(num_experts * capacity, dim),
+      expert_outputs.new_zeros(1, dim)
+  ])
+  gathered = flat.index_select(0, slots.reshape(-1)).view(*slots.shape, dim)
+  return (gathered * weights.unsqueeze(-1)).sum(1)
+
+
+def moe_expert_parallel(dispatched, expert_fn, num_chunks=1):
+  """Runs the experts sharded across the replicas on the dispatched tokens.
+
+  The `[E, capacity, D]` dispatched tokens are all-to-all exchanged so that
+  every replica gets the tokens of its `E / world_size` experts, and the expert
+  outputs are exchanged back. The capacity is split in ``num_chunks`` chunks,
+  with all the dispatch exchanges issued before the expert compute, so that the
+  exchanges of a chunk can overlap the compute on the others (see also the
+  ``XLA_CHAIN_COLLECTIVES`` environment variable).
+
+  Args:
+    dispatched (torch.Tensor): The dispatched tokens from `moe_dispatch()`.
+    expert_fn (callable): Computes the `[E / world_size, C, D]` outputs of the
+      local experts from their `[E / world_size, C, D]` inputs.
+    num_chunks (int, optional): The number of chunks of the capacity, which
+      must divide it.
+      Default: 1
+  Returns:
+    The `[E, capacity, D]` expert outputs, to be passed to `moe_combine()`.
+  """
+  world_size = xm.xrt_world_size()
+  if world_size == 1:
+    return expert_fn(dispatched)
+  received = [
+      all_to_all(chunk, 0, 1, world_size)
+      for chunk in dispatched.chunk(num_chunks, dim=1)
+  ]
+  outputs = [
+      all_to_all(expert_fn(chunk), 1, 0, world_size) for chunk in received
+  ]
+  return torch.cat(outputs, dim=1)
+
+
 def distributed_mm(w, x, split=1):
   """Performs a matrix multiplication with sharded weight.
 
@@ -152,18 +796,74 @@ def distributed_mm(w, x, split=1):
   return torch.cat(results, dim=1) if len(results) > 1 else results[0]
 
 
+class SyncBatchNormFunction(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, input, weight, bias, eps, groups, pin_layout):
+    ctx.eps = eps
+    ctx.groups = groups
+    ctx.pin_layout = pin_layout
+    token, devctx = xm._get_all_reduce_token()
+    output, mean, variance, devctx.all_reduce_token = (
+        torch_xla._XLAC._xla_sync_batch_norm(input, weight, bias, token, eps,
+                                             groups or [], pin_layout))
+    ctx.save_for_backward(input, weight, mean, variance)
+    ctx.mark_non_differentiable(mean, variance)
+    return output, mean, variance
+
+  @staticmethod
+  def backward(ctx, grad_output, grad_mean, grad_variance):
+    input, weight, mean, variance = ctx.saved_tensors
+    token, devctx = xm._get_all_reduce_token()
+    grad_input, grad_weight, grad_bias, devctx.all_reduce_token = (
+        torch_xla._XLAC._xla_sync_batch_norm_backward(grad_output, input,
+                                                      weight, mean, variance,
+                                                      token, ctx.eps,
+                                                      ctx.groups or [],
+                                                      ctx.pin_layout))
+    return grad_input, grad_weight, grad_bias, None, None, None
+
+
+def sync_batch_norm(input, weight, bias, eps=1e-5, groups=None,
+                    pin_layout=True):
+  """Applies the batch normalization with the statistics of all the replicas.
+
+  The local sums and sums of squares of the features, and the element counts,
+  are reduced across the replicas with a single all-reduce within a fused IR
+  node, and so is the backward, so that the statistics of the replicas with
+  different batch sizes are weighted by them. The gradients of the weight and
+  bias are the local ones, which get reduced like the ones of the other
+  parameters (for example by `xm.optimizer_step()`).
+
+  Args:
+    input (torch.Tensor): The input, of shape `[N, C, ...]`.
+    weight (torch.Tensor): The `[C]` scale of the output.
+    bias (torch.Tensor): The `[C]` offset of the output.
+    eps (float): The value added to the variance for numerical stability.
+      Default: 1e-5
+    groups (list, optional): The replica groups, see `xm.all_reduce()`.
+    pin_layout (bool, optional): whether to pin the layout for the communication
+      ops. See `xm.all_reduce` for details.
+  Returns:
+    A tuple of the normalized input, and the `[C]` batch mean and (biased)
+    variance across the replicas.
+  """
+  return SyncBatchNormFunction.apply(input, weight, bias, float(eps), groups,
+                                     pin_layout)
+
+
 class SyncBatchNorm(torch.nn.Module):
 
-  def __init__(
-      self,
-      num_features: int,
-      eps: float = 1e-5,
-      momentum: float = 0.1,
-  ):
+  def __init__(self,
+               num_features: int,
+               eps: float = 1e-5,
+               momentum: float = 0.1,
+               groups=None):
     super().__init__()
     self.num_features = num_features
     self.eps = eps
     self.momentum = momentum
+    self.groups = groups
     self.weight = torch.nn.Parameter(torch.ones(num_features))
     self.bias = torch.nn.Parameter(torch.zeros(num_features))
     self.register_buffer('running_mean', torch.zeros(num_features))
@@ -171,36 +871,24 @@ class SyncBatchNorm(torch.nn.Module):
 
   def forward(self, batch: torch.Tensor) -> torch.Tensor:
     assert 2 <= batch.ndim <= 5 and batch.shape[1] == self.num_features
-    reduce_dims = list(range(batch.ndim))
-    reduce_dims.pop(1)  # channel dim
-
-    if self.training:
-      local_mean = torch.mean(batch, dim=reduce_dims)
-      local_sqr_mean = torch.mean(batch * batch, dim=reduce_dims)
-
-      scale = 1.0 / xm.xrt_world_size()
-      mean = AllReduceSumLayer.apply(local_mean) * scale
-      sqr_mean = AllReduceSumLayer.apply(local_sqr_mean) * scale
-      var = sqr_mean - mean.pow(2)
 
+    if not self.training:
+      return torch.nn.functional.batch_norm(
+          batch,
+          self.running_mean,
+          self.running_var,
+          weight=self.weight,
+          bias=self.bias,
+          training=False,
+          eps=self.eps)
+
+    res, mean, var = sync_batch_norm(
+        batch, self.weight, self.bias, eps=self.eps, groups=self.groups)
+    with torch.no_grad():
       self.running_mean = (
           1 - self.momentum) * self.running_mean + self.momentum * mean
       self.running_var = (
           1 - self.momentum) * self.running_var + self.momentum * var
-    else:
-      mean = self.running_mean
-      var = self.running_var
-
-    res = torch.empty_like(batch)
-    for c in range(self.num_features):
-      if batch.ndim == 2:
-        res = ((batch - mean) /
-               torch.sqrt(var + self.eps)) * self.weight + self.bias
-      else:
-        res[:, c, ...] = (
-            (batch[:, c, ...] - mean[c]) /
-            torch.sqrt(var[c] + self.eps)) * self.weight[c] + self.bias[c]
-
     return res
 
   def extra_repr(self) -> str:
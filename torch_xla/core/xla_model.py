@@ -31,6 +31,8 @@ _TORCH_DIST_LOCK = threading.Lock()
 
 _DEVICE_CONTEXTS = dict()
 _DEVICE_CONTEXTS_LOCK = threading.Lock()
+_HOST_CALLBACKS = dict()
+_HOST_CALLBACKS_LOCK = threading.Lock()
 
 
 class DeviceContext(object):
@@ -471,6 +473,26 @@ def _fetch_gradients(optimizer):
   return gradients
 
 
+def _bucket_tensors(tensors, bucket_bytes):
+  if bucket_bytes <= 0:
+    return [tensors] if tensors else []
+  # The last layers get their gradients first in the backward pass, so their
+  # buckets are issued first to overlap the communication with the remaining
+  # backward computation.
+  buckets = []
+  bucket, size = [], 0
+  for tensor in reversed(tensors):
+    tensor_bytes = tensor.element_size() * tensor.numel()
+    if bucket and size + tensor_bytes > bucket_bytes:
+      buckets.append(bucket)
+      bucket, size = [], 0
+    bucket.append(tensor)
+    size += tensor_bytes
+  if bucket:
+    buckets.append(bucket)
+  return buckets
+
+
 def _get_all_reduce_token():
   devctx = _get_device_context()
   token = getattr(devctx, 'all_reduce_token', None)
@@ -794,6 +816,45 @@ def recv(output, channel_id):
   return result
 
 
+def host_callback(value, fn):
+  """Streams a tensor to a host function while the computation runs.
+
+  The value gets emitted through the device outfeed, and `fn` is called with the
+  device string and the CPU copy of the value, on a listener thread, while the
+  computation is still running. This keeps long running graphs, like a loop
+  captured into a single XLA while loop, observable. Requires the PJRT runtime.
+
+  The callback registration is kept for the same `fn`, shape, type and device,
+  so that the graphs of the following steps find the same callback ID, and do
+  not recompile.
+
+  Args:
+    value (torch.Tensor): The tensor to stream.
+    fn (callable): Called with the device and value. It must not block for long,
+      as the values of the device wait for it.
+
+  Returns:
+    The value, which must be used in place of the input for the callback to be
+    part of the graph.
+  """
+  if not pjrt.using_pjrt():
+    raise RuntimeError('Host callbacks require the PJRT runtime')
+  key = (fn, tuple(value.size()), value.dtype, str(value.device))
+  with _HOST_CALLBACKS_LOCK:
+    callback_id = _HOST_CALLBACKS.get(key, None)
+    if callback_id is None:
+      callback_id = torch_xla._XLAC._xla_register_host_callback(fn, value)
+      _HOST_CALLBACKS[key] = callback_id
+  return torch_xla._XLAC._xla_host_callback(value, callback_id)
+
+
+def remove_host_callback(fn):
+  """Unregisters the host callbacks of `fn`, added by `host_callback()`."""
+  with _HOST_CALLBACKS_LOCK:
+    for key in [key for key in _HOST_CALLBACKS.keys() if key[0] is fn]:
+      torch_xla._XLAC._xla_unregister_host_callback(_HOST_CALLBACKS.pop(key))
+
+
 def reduce_scatter(reduce_type,
                    input,
                    scale,
@@ -849,6 +910,144 @@ def reduce_scatter(reduce_type,
   return result[0]
 
 
+def _hierarchical_groups(world_size, devices_per_host):
+  assert world_size % devices_per_host == 0, \
+    'World size {} is not a multiple of the devices per host {}'.format(
+        world_size, devices_per_host)
+  num_hosts = world_size // devices_per_host
+  # The hosts own consecutive ranges of replicas, and the cross host groups
+  # hold the replicas with the same local ordinal.
+  host_groups = [
+      list(range(h * devices_per_host, (h + 1) * devices_per_host))
+      for h in range(num_hosts)
+  ]
+  cross_groups = [
+      list(range(i, world_size, devices_per_host))
+      for i in range(devices_per_host)
+  ]
+  return host_groups, cross_groups
+
+
+def all_reduce_hierarchical(reduce_type,
+                            inputs,
+                            scale=1.0,
+                            devices_per_host=None,
+                            pin_layout=True):
+  """Performs an inplace two level all-reduce of the input tensors.
+
+  The tensors are reduce-scattered among the devices of each host, the shards
+  are all-reduced across the hosts, and the results all-gathered back within
+  each host. Only ``1 / devices_per_host`` of the data crosses the slower links
+  between the hosts, compared to a flat all-reduce over all the replicas.
+  The replicas are assumed to be numbered host by host.
+
+  Args:
+    reduce_type (string): One of ``xm.REDUCE_SUM``, ``xm.REDUCE_MUL``,
+      ``xm.REDUCE_AND``, ``xm.REDUCE_OR``, ``xm.REDUCE_MIN`` and
+      ``xm.REDUCE_MAX``.
+    inputs: A list of `torch.Tensor` to perform the all reduce op to. They are
+      reduced as a single flattened buffer, so they must have the same type.
+    scale (float): A default scaling value to be applied after the reduce.
+      Default: 1.0
+    devices_per_host (int, optional): The number of replicas on each host.
+      Default: the ``XLA_HIERARCHICAL_ALL_REDUCE`` environment variable
+    pin_layout (bool, optional): whether to pin the layout for the communication
+      ops. See `xm.all_reduce` for details.
+
+  Returns:
+    The list of input tensors, holding the reduced values.
+  """
+  if devices_per_host is None:
+    devices_per_host = xu.getenv_as('XLA_HIERARCHICAL_ALL_REDUCE', int, 0)
+  world_size = xrt_world_size()
+  if devices_per_host <= 1 or devices_per_host >= world_size:
+    return all_reduce(reduce_type, inputs, scale=scale, pin_layout=pin_layout)
+  host_groups, cross_groups = _hierarchical_groups(world_size,
+                                                   devices_per_host)
+  flat = torch.cat([t.reshape(-1) for t in inputs])
+  numel = flat.numel()
+  padding = -numel % devices_per_host
+  if padding:
+    flat = torch.cat([flat, flat.new_zeros(padding)])
+  shard = reduce_scatter(
+      reduce_type,
+      flat,
+      1.0,
+      0,
+      devices_per_host,
+      groups=host_groups,
+      pin_layout=pin_layout)
+  shard = all_reduce(
+      reduce_type,
+      shard,
+      scale=scale,
+      groups=cross_groups,
+      pin_layout=pin_layout)
+  flat = all_gather(shard, dim=0, groups=host_groups, pin_layout=pin_layout)
+  offset = 0
+  for tensor in inputs:
+    tensor.copy_(flat[offset:offset + tensor.numel()].view_as(tensor))
+    offset += tensor.numel()
+  return inputs
+
+
+def _record_compression_error(error):
+  torch_xla._XLAC._xla_record_compression_error(error.item())
+
+
+def all_reduce_compressed(inputs,
+                          scale=1.0,
+                          groups=None,
+                          wire_type='bf16',
+                          key=None,
+                          pin_layout=True):
+  """Performs an inplace sum of the input tensors in a compressed wire format.
+
+  The tensors are reduced as a single flattened buffer, cast to ``wire_type``
+  after being scaled by the inverse of their absolute maximum across the
+  replicas. What the cast loses is kept as an error feedback residual on the
+  device, and added to the inputs of the next reduction with the same ``key``.
+  The relative norm of the residuals is posted to the
+  ``CompressedAllReduceError`` metric once the step has executed.
+
+  Args:
+    inputs: A list of `torch.Tensor` of the same floating point type.
+    scale (float): A default scaling value to be applied after the reduce.
+      Default: 1.0
+    groups (list, optional): The replica groups, see `xm.all_reduce()`.
+    wire_type (string): Either ``bf16`` or ``f16``.
+      Default: ``bf16``
+    key (optional): The hashable key of the error feedback residual. If `None`
+      no residual is kept.
+    pin_layout (bool, optional): whether to pin the layout for the communication
+      ops. See `xm.all_reduce` for details.
+
+  Returns:
+    The list of input tensors, holding the reduced values.
+  """
+  flat = torch.cat([t.reshape(-1) for t in inputs])
+  token, devctx = _get_all_reduce_token()
+  residuals = getattr(devctx, 'compression_residuals', None)
+  if residuals is None:
+    residuals = dict()
+    devctx.compression_residuals = residuals
+  residual = residuals.get(key, None)
+  if residual is None or residual.shape != flat.shape:
+    residual = torch.zeros_like(flat)
+  result, residual, error, devctx.all_reduce_token = (
+      torch_xla._XLAC._xla_compressed_all_reduce(flat, residual, token, scale,
+                                                 groups or [], pin_layout,
+                                                 wire_type))
+  if key is not None:
+    residuals[key] = residual
+  add_step_closure(_record_compression_error, args=(error,), run_async=True)
+  offset = 0
+  for tensor in inputs:
+    tensor.copy_(result[offset:offset + tensor.numel()].view_as(tensor))
+    offset += tensor.numel()
+  return inputs
+
+
 def add_step_closure(closure, args=(), run_async=False):
   """Adds a closure to the list of the ones to be run at the end of the step.
 
@@ -928,7 +1127,10 @@ def wait_device_ops(devices=[]):
   torch_xla._XLAC._xla_wait_device_ops(devices=devices)
 
 
-def reduce_gradients(optimizer, groups=None, pin_layout=True):
+def reduce_gradients(optimizer,
+                     groups=None,
+                     pin_layout=True,
+                     bucket_cap_mb=None):
   """Reduces all the gradients handled by an optimizer.
 
   Args:
@@ -941,18 +1143,57 @@ def reduce_gradients(optimizer, groups=None, pin_layout=True):
         all the replicas in it.
     pin_layout (bool, optional): whether to pin the layout when reducing gradients.
       See `xm.all_reduce` for details.
+    bucket_cap_mb (float, optional): The size in MB of the buckets of gradients
+      reduced by each `all_reduce()`, in the reverse order of the parameters,
+      so that the reductions of the last layers can overlap the backward pass
+      of the first ones. The reductions are chained by the all-reduce token.
+      Zero reduces all the gradients at once.
+      Default: the ``XLA_ALL_REDUCE_BUCKET_MB`` environment variable, or 0
+  If the ``XLA_HIERARCHICAL_ALL_REDUCE`` environment variable is set to the
+  number of devices per host, and no groups are given, the buckets are reduced
+  with `xm.all_reduce_hierarchical()`. If the ``XLA_ALL_REDUCE_COMPRESSION``
+  environment variable is set to a wire type, they are reduced with
+  `xm.all_reduce_compressed()` instead, with one error feedback residual per
+  bucket.
   """
   cctx = CollectiveContext()
   count = max(cctx.replica_devcount, cctx.world_size)
   if count > 1:
+    if bucket_cap_mb is None:
+      bucket_cap_mb = xu.getenv_as('XLA_ALL_REDUCE_BUCKET_MB', float, 0.0)
+    devices_per_host = xu.getenv_as('XLA_HIERARCHICAL_ALL_REDUCE', int, 0)
+    hierarchical = (
+        groups is None and cctx.world_size == count and
+        1 < devices_per_host < count and count % devices_per_host == 0)
+    compression = xu.getenv_as('XLA_ALL_REDUCE_COMPRESSION', str, '')
     gradients = _fetch_gradients(optimizer)
-    all_reduce(
-        REDUCE_SUM,
-        gradients,
-        scale=1.0 / count,
-        groups=groups,
-        cctx=cctx,
-        pin_layout=pin_layout)
+    buckets = _bucket_tensors(gradients, int(bucket_cap_mb * 1024 * 1024))
+    for index, bucket in enumerate(buckets):
+      uniform = len(set(t.dtype for t in bucket)) == 1
+      if compression and uniform and not cctx.requires_interhost_reduce:
+        all_reduce_compressed(
+            bucket,
+            scale=1.0 / count,
+            groups=groups,
+            wire_type=compression,
+            key=('reduce_gradients', index),
+            pin_layout=pin_layout)
+        continue
+      if hierarchical and uniform:
+        all_reduce_hierarchical(
+            REDUCE_SUM,
+            bucket,
+            scale=1.0 / count,
+            devices_per_host=devices_per_host,
+            pin_layout=pin_layout)
+        continue
+      all_reduce(
+          REDUCE_SUM,
+          bucket,
+          scale=1.0 / count,
+          groups=groups,
+          cctx=cctx,
+          pin_layout=pin_layout)
 
 
 def optimizer_step(optimizer,
@@ -991,6 +1232,38 @@ def optimizer_step(optimizer,
   return loss
 
 
+def accumulate_gradients(optimizer, tensors=()):
+  """Ends a gradient accumulation micro-step.
+
+  The gradients of the optimizer parameters get marked as accumulators, and
+  synced (along with `tensors`, like the loss of the micro-batch) outside of the
+  step barrier, so that every micro-step runs the same cached graph, which adds
+  the new gradients into the buffers of the accumulated ones in place. The
+  optimizer step, issued by `optimizer_step()` every K micro-steps, runs as a
+  graph of its own at the step barrier.
+
+  Example::
+
+    for i, (data, target) in enumerate(loader):
+      loss_fn(model(data), target).backward()
+      if (i + 1) % K == 0:
+        xm.optimizer_step(optimizer, barrier=True)
+        optimizer.zero_grad(set_to_none=False)
+      else:
+        xm.accumulate_gradients(optimizer)
+
+  Args:
+    optimizer (:class:`torch.Optimizer`): The `torch.Optimizer` instance whose
+      parameter gradients are accumulated.
+    tensors (list, optional): The other tensors of the micro-step to be synced
+      with the gradients.
+  """
+  gradients = _fetch_gradients(optimizer)
+  torch_xla._XLAC._xla_set_accumulators(gradients)
+  torch_xla._XLAC._xla_sync_multi(
+      gradients + list(tensors), devices=[], wait=False, sync_xla_data=False)
+
+
 def save(data, file_or_path, master_only=True, global_master=False):
   """Saves the input data into a file.
 
@@ -1159,11 +1432,78 @@ def get_memory_info(device):
 
   Returns:
     A dictionary with `kb_free` (free memory in KB) and `kb_total` (total
-    memory in KB) keys.
+    memory in KB) keys. Runtimes which expose the device allocator statistics
+    also fill the `kb_peak` (peak memory in use in KB), `kb_largest_free_block`
+    (largest free block in KB) and `num_allocs` (number of allocations) keys,
+    which are zero otherwise.
   """
   return torch_xla._XLAC._xla_memory_info(str(device))
 
 
+def get_memory_snapshot(device=None):
+  """Retrieves the live device buffers, as recorded with `XLA_MEMORY_TRACKER=1`.
+
+  Args:
+    device (string, optional): The device whose buffers are requested, or all
+      the devices if None.
+      Default: None
+
+  Returns:
+    A list of dictionaries, sorted by decreasing size, with the `device` and
+    the `bytes` of the buffer, the unique ID of the tensor owning it
+    (`owner`, -1 if none), `graph`, the hash of the graph which produced it
+    (the `Graph Hash` of the `XLA_SAVE_TENSORS_FILE` dumps, empty for the
+    uploaded tensors), and `age_ns`, the time since its allocation.
+  """
+  snapshot = torch_xla._XLAC._xla_memory_snapshot()
+  if device is not None:
+    device = xla_real_devices([str(device)])[0]
+    snapshot = [buffer for buffer in snapshot if buffer['device'] == device]
+  return snapshot
+
+
+def save_memory_timeline(path):
+  """Saves the timeline of the device memory, as recorded with
+  `XLA_MEMORY_TRACKER=1`.
+
+  The file is in the Chrome trace event format, which the Perfetto
+  (https://ui.perfetto.dev) and TensorBoard trace viewers load, with the live
+  bytes of every device broken down by the graph which produced them.
+
+  Args:
+    path (string): The path of the JSON file to write.
+  """
+  with open(path, 'w') as fd:
+    fd.write(torch_xla._XLAC._xla_memory_timeline())
+
+
+def offload_to_host(tensors):
+  """Moves the values of the tensors to host memory, to free the device memory
+  while they are not used.
+
+  The device buffers are released once the pending graphs which use them have
+  run, and the tensors get uploaded again when used. The tensors which are not
+  updated between an offload and the next one are not transferred back.
+
+  Args:
+    tensors (List[torch.Tensor]): The XLA tensors to offload.
+  """
+  torch_xla._XLAC._xla_offload_tensors(tensors)
+
+
+def prefetch_to_device(tensors):
+  """Starts the uploads of the offloaded tensors to their devices, in the
+  background.
+
+  Called ahead of the use of the tensors, the transfers overlap with the torch
+  operations tracing and the execution of the previous graphs.
+
+  Args:
+    tensors (List[torch.Tensor]): The XLA tensors to prefetch.
+  """
+  torch_xla._XLAC._xla_prefetch_tensors(tensors)
+
+
 def optimization_barrier_(tensors):
   """Blocks xla compiler from moving computations across this barrier. The common
   use case would be blocking xla common-subexpression elimination pass from undoing
@@ -1173,3 +1513,51 @@ def optimization_barrier_(tensors):
     tensors (List[torch.Tensor]): List of `torch.Tensor` to add barrier to.
   """
   torch_xla._XLAC._xla_optimization_barrier_(tensors)
+
+
+def capture_loop(step_fn, carried, inputs, num_iterations):
+  """Captures a loop step into a single computation running many of them.
+
+  The step gets traced and lowered once, and every call of the returned
+  function runs `num_iterations` steps within a single XLA while loop, with one
+  device dispatch, instead of one per step.
+
+  Args:
+    step_fn (callable): The loop step, called as `step_fn(*carried, *inputs)`.
+      It must return the new values of the `carried` tensors, followed by any
+      other output, and must not update its arguments in place. The step is
+      traced twice, the second time on the outputs of the first trace, and both
+      traces must result in the same graph.
+    carried (List[torch.Tensor]): The XLA tensors carried across the
+      iterations, like the model weights.
+    inputs (List[torch.Tensor]): The XLA tensors of the inputs of one
+      iteration, like a batch.
+    num_iterations (int): The number of iterations run by every call.
+  Returns:
+    A function, which takes the `carried` tensors, and the `inputs` of
+    `num_iterations` iterations stacked along a new first dimension, and
+    returns the outputs of the last iteration.
+  """
+  carried = list(carried)
+  inputs = list(inputs)
+  unlazy(carried + inputs)
+  outputs = xu.as_list(step_fn(*carried, *inputs))
+  if len(outputs) < len(carried):
+    raise ValueError(
+        'The loop step must return the new values of the {} carried tensors, '
+        'but it returned {} outputs'.format(len(carried), len(outputs)))
+  graph_id = torch_xla._XLAC._xla_capture_graph(outputs, carried + inputs)
+  next_carried = torch_xla._XLAC._xla_replay_graph(
+      graph_id, carried + inputs)[:len(carried)]
+  next_outputs = xu.as_list(step_fn(*next_carried, *inputs))
+  if torch_xla._XLAC._xla_capture_graph(next_outputs,
+                                        next_carried + inputs) != graph_id:
+    raise RuntimeError('The graph of the loop step changes across iterations')
+  loop_id = torch_xla._XLAC._xla_capture_loop(graph_id, num_iterations,
+                                              len(carried))
+
+  def run_loop(carried, stacked_inputs):
+    return torch_xla._XLAC._xla_replay_graph(
+        loop_id, list(carried) + list(stacked_inputs))
+
+  return run_loop
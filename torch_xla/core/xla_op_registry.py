@@ -1,6 +1,7 @@
 from __future__ import division
 from __future__ import print_function
 
+import itertools
 import pickle
 import sys
 import threading
@@ -8,6 +9,8 @@ import torch_xla
 import torch_xla.core.xla_builder as xb
 import torch_xla.utils.utils as xu
 
+_OP_IDS = itertools.count()
+
 
 class Op(object):
   """Creates a PyTorch operation with an XLA lowering function.
@@ -21,8 +24,8 @@ class Op(object):
     self._name = name
     self._opfn = opfn
     self._opname = 'xla::_op_' + name
+    self._id = next(_OP_IDS)
     self._lock = threading.Lock()
-    self._computations = dict()
 
   def __call__(self, *args, **kwargs):
     """Perform the PyTorch operation based on XLA tensors.
@@ -34,18 +37,23 @@ class Op(object):
     Returns:
       The PyTorch tensors wrapping the values returned by XLA lowering function.
     """
-    shapes = xb.tensor_shape(args)
-    key = pickle.dumps([shapes, kwargs])
-    with self._lock:
-      computation = self._computations.get(key, None)
-      if computation is None:
+    # The computations are registered on the C++ side, keyed by the op, the
+    # kwargs and the input shapes, so that the calls of the op with already
+    # seen shapes do not need to build the Python shapes of the inputs.
+    attrs = pickle.dumps(kwargs) if kwargs else b''
+    result = torch_xla._XLAC._xla_cached_user_computation(
+        self._opname, self._id, args, attrs)
+    if result is None:
+      with self._lock:
+        shapes = xb.tensor_shape(args)
         computation = xb.create_computation(self._name, self._opfn, shapes,
                                             **kwargs)
-        self._computations[key] = computation
+        torch_xla._XLAC._xla_register_user_computation(self._id, args, attrs,
+                                                       computation)
         if xu.getenv_as('XLA_OP_PRINT_COMPUTATIONS', bool, False):
           print(xb.get_computation_hlo(computation), file=sys.stderr)
-    result = torch_xla._XLAC._xla_user_computation(self._opname, args,
-                                                   computation)
+      result = torch_xla._XLAC._xla_user_computation(self._opname, args,
+                                                     computation)
     return result[0] if len(result) == 1 else result
 
 
@@ -3,6 +3,9 @@
 #include <ATen/Operators.h>
 #include <ATen/native/CPUFallback.h>
 
+#include <cmath>
+
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "torch_xla/csrc/aten_cpu_fallback.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/helpers.h"
@@ -140,5 +143,258 @@ torch::autograd::variable_list MaxPool3dAutogradFunction::backward(
   return grad_inputs;
 }
 
+torch::Tensor ScaledDotProductAttentionAutogradFunction::forward(
+    torch::autograd::AutogradContext* ctx, torch::Tensor query,
+    torch::Tensor key, torch::Tensor value,
+    const c10::optional<torch::Tensor>& attn_mask, bool is_causal,
+    c10::optional<double> scale) {
+  double attention_scale =
+      scale ? *scale : 1.0 / std::sqrt(static_cast<double>(query.size(-1)));
+  ctx->saved_data["scale"] = attention_scale;
+  ctx->saved_data["is_causal"] = is_causal;
+  XLATensorPtr mask_tensor =
+      attn_mask ? bridge::GetXlaTensor(*attn_mask) : XLATensorPtr();
+  auto outputs = XLATensor::flash_attention(
+      bridge::GetXlaTensor(query), bridge::GetXlaTensor(key),
+      bridge::GetXlaTensor(value), mask_tensor, attention_scale, is_causal);
+  torch::Tensor output = bridge::AtenFromXlaTensor(std::get<0>(outputs));
+  torch::Tensor logsumexp = bridge::AtenFromXlaTensor(std::get<1>(outputs));
+  ctx->save_for_backward({query, key, value, output, logsumexp,
+                          attn_mask ? *attn_mask : torch::Tensor()});
+  return output;
+}
+
+torch::autograd::variable_list
+ScaledDotProductAttentionAutogradFunction::backward(
+    torch::autograd::AutogradContext* ctx,
+    torch::autograd::variable_list grad_output) {
+  double scale = ctx->saved_data["scale"].toDouble();
+  bool is_causal = ctx->saved_data["is_causal"].toBool();
+  auto saved = ctx->get_saved_variables();
+  XLATensorPtr mask_tensor =
+      saved[5].defined() ? bridge::GetXlaTensor(saved[5]) : XLATensorPtr();
+  auto grads = XLATensor::flash_attention_backward(
+      bridge::GetXlaTensor(grad_output[0]), bridge::GetXlaTensor(saved[0]),
+      bridge::GetXlaTensor(saved[1]), bridge::GetXlaTensor(saved[2]),
+      bridge::GetXlaTensor(saved[3]), bridge::GetXlaTensor(saved[4]),
+      mask_tensor, scale, is_causal);
+
+  // The mask gets no gradient.
+  torch::Tensor undef;
+  torch::autograd::variable_list grad_inputs = {
+      bridge::AtenFromXlaTensor(std::get<0>(grads)),
+      bridge::AtenFromXlaTensor(std::get<1>(grads)),
+      bridge::AtenFromXlaTensor(std::get<2>(grads)),
+      undef,
+      undef,
+      undef};
+  return grad_inputs;
+}
+
+torch::autograd::variable_list EmbeddingBagAutogradFunction::forward(
+    torch::autograd::AutogradContext* ctx, torch::Tensor weight,
+    torch::Tensor indices, torch::Tensor offsets, bool scale_grad_by_freq,
+    int64_t mode, const c10::optional<torch::Tensor>& per_sample_weights,
+    bool include_last_offset, int64_t padding_idx) {
+  ctx->saved_data["num_weights"] = weight.size(0);
+  ctx->saved_data["scale_grad_by_freq"] = scale_grad_by_freq;
+  ctx->saved_data["mode"] = mode;
+  ctx->saved_data["padding_idx"] = padding_idx;
+  auto results = at::_embedding_bag_forward_only(
+      weight, indices, offsets, scale_grad_by_freq, mode, /*sparse=*/false,
+      per_sample_weights, include_last_offset, padding_idx);
+  torch::Tensor offset2bag = std::get<1>(results);
+  torch::Tensor bag_size = std::get<2>(results);
+  torch::Tensor max_indices = std::get<3>(results);
+  ctx->save_for_backward(
+      {weight, indices, offset2bag, bag_size, max_indices,
+       per_sample_weights ? *per_sample_weights : torch::Tensor()});
+  ctx->mark_non_differentiable({offset2bag, bag_size, max_indices});
+  return {std::get<0>(results), offset2bag, bag_size, max_indices};
+}
+
+torch::autograd::variable_list EmbeddingBagAutogradFunction::backward(
+    torch::autograd::AutogradContext* ctx,
+    torch::autograd::variable_list grad_output) {
+  int64_t num_weights = ctx->saved_data["num_weights"].toInt();
+  bool scale_grad_by_freq = ctx->saved_data["scale_grad_by_freq"].toBool();
+  int64_t mode = ctx->saved_data["mode"].toInt();
+  int64_t padding_idx = ctx->saved_data["padding_idx"].toInt();
+  auto saved = ctx->get_saved_variables();
+  torch::Tensor weight = saved[0];
+  torch::Tensor indices = saved[1];
+  torch::Tensor offset2bag = saved[2];
+  torch::Tensor per_sample_weights = saved[5];
+  XLATensorPtr per_sample_weights_tensor =
+      per_sample_weights.defined() ? bridge::GetXlaTensor(per_sample_weights)
+                                   : XLATensorPtr();
+  torch::Tensor grad_weight =
+      bridge::AtenFromXlaTensor(XLATensor::embedding_bag_backward(
+          bridge::GetXlaTensor(grad_output[0]), bridge::GetXlaTensor(indices),
+          bridge::GetXlaTensor(offset2bag), bridge::GetXlaTensor(saved[3]),
+          bridge::GetXlaTensor(saved[4]), num_weights, scale_grad_by_freq,
+          mode, per_sample_weights_tensor, padding_idx));
+
+  // The per sample weights (only allowed in the sum mode) scale the selected
+  // rows, so their gradient is the dot product of the rows and the gradient of
+  // their bag.
+  torch::Tensor grad_per_sample_weights;
+  if (per_sample_weights.defined()) {
+    grad_per_sample_weights =
+        at::index_select(grad_output[0], 0, offset2bag)
+            .mul(at::index_select(weight, 0, indices))
+            .sum(1);
+    if (padding_idx >= 0) {
+      grad_per_sample_weights =
+          grad_per_sample_weights.masked_fill(indices.eq(padding_idx), 0);
+    }
+  }
+  torch::Tensor undef;
+  torch::autograd::variable_list grad_inputs = {
+      grad_weight, undef, undef, undef, undef, grad_per_sample_weights,
+      undef,       undef};
+  return grad_inputs;
+}
+
+torch::autograd::variable_list LayerNormAutogradFunction::forward(
+    torch::autograd::AutogradContext* ctx, torch::Tensor input,
+    torch::IntArrayRef normalized_shape,
+    const c10::optional<torch::Tensor>& weight,
+    const c10::optional<torch::Tensor>& bias, double eps, bool rms) {
+  int64_t normalized_ndim = normalized_shape.size();
+  XLA_CHECK_LE(normalized_ndim, input.dim());
+  XLA_CHECK(input.sizes().slice(input.dim() - normalized_ndim) ==
+            normalized_shape)
+      << "Input sizes " << input.sizes()
+      << " do not end with the normalized shape " << normalized_shape;
+  ctx->saved_data["normalized_ndim"] = normalized_ndim;
+  ctx->saved_data["rms"] = rms;
+  ctx->saved_data["has_bias"] = bias.has_value() && bias->defined();
+  XLATensorPtr weight_tensor = weight && weight->defined()
+                                   ? bridge::GetXlaTensor(*weight)
+                                   : XLATensorPtr();
+  XLATensorPtr bias_tensor =
+      bias && bias->defined() ? bridge::GetXlaTensor(*bias) : XLATensorPtr();
+  auto results =
+      XLATensor::layer_norm(bridge::GetXlaTensor(input), normalized_ndim,
+                            weight_tensor, bias_tensor, eps, rms);
+  torch::Tensor output = bridge::AtenFromXlaTensor(std::get<0>(results));
+  torch::Tensor mean = bridge::AtenFromXlaTensor(std::get<1>(results));
+  torch::Tensor rstd = bridge::AtenFromXlaTensor(std::get<2>(results));
+  ctx->save_for_backward(
+      {input, mean, rstd, weight_tensor ? *weight : torch::Tensor()});
+  ctx->mark_non_differentiable({mean, rstd});
+  return {output, mean, rstd};
+}
+
+torch::autograd::variable_list LayerNormAutogradFunction::backward(
+    torch::autograd::AutogradContext* ctx,
+    torch::autograd::variable_list grad_output) {
+  int64_t normalized_ndim = ctx->saved_data["normalized_ndim"].toInt();
+  bool rms = ctx->saved_data["rms"].toBool();
+  bool has_bias = ctx->saved_data["has_bias"].toBool();
+  auto saved = ctx->get_saved_variables();
+  torch::Tensor undef;
+  if (!grad_output[0].defined()) {
+    return {undef, undef, undef, undef, undef, undef};
+  }
+  torch::Tensor weight = saved[3];
+  XLATensorPtr weight_tensor =
+      weight.defined() ? bridge::GetXlaTensor(weight) : XLATensorPtr();
+  auto grads = XLATensor::layer_norm_backward(
+      bridge::GetXlaTensor(grad_output[0]), bridge::GetXlaTensor(saved[0]),
+      bridge::GetXlaTensor(saved[1]), bridge::GetXlaTensor(saved[2]),
+      weight_tensor, normalized_ndim, rms);
+  torch::autograd::variable_list grad_inputs = {
+      bridge::AtenFromXlaTensor(std::get<0>(grads)),
+      undef,
+      weight.defined() ? bridge::AtenFromXlaTensor(std::get<1>(grads)) : undef,
+      has_bias ? bridge::AtenFromXlaTensor(std::get<2>(grads)) : undef,
+      undef,
+      undef};
+  return grad_inputs;
+}
+
+torch::Tensor CrossEntropyAutogradFunction::forward(
+    torch::autograd::AutogradContext* ctx, torch::Tensor input,
+    torch::Tensor target, const c10::optional<torch::Tensor>& weight,
+    int64_t reduction, int64_t ignore_index, double label_smoothing) {
+  ctx->saved_data["reduction"] = reduction;
+  ctx->saved_data["ignore_index"] = ignore_index;
+  ctx->saved_data["label_smoothing"] = label_smoothing;
+  XLATensorPtr weight_tensor = weight && weight->defined()
+                                   ? bridge::GetXlaTensor(*weight)
+                                   : XLATensorPtr();
+  auto results = XLATensor::cross_entropy(
+      bridge::GetXlaTensor(input), bridge::GetXlaTensor(target),
+      weight_tensor, reduction, ignore_index, label_smoothing);
+  torch::Tensor logsumexp = bridge::AtenFromXlaTensor(std::get<1>(results));
+  ctx->save_for_backward({input, target, logsumexp,
+                          weight_tensor ? *weight : torch::Tensor()});
+  return bridge::AtenFromXlaTensor(std::get<0>(results));
+}
+
+torch::autograd::variable_list CrossEntropyAutogradFunction::backward(
+    torch::autograd::AutogradContext* ctx,
+    torch::autograd::variable_list grad_output) {
+  int64_t reduction = ctx->saved_data["reduction"].toInt();
+  int64_t ignore_index = ctx->saved_data["ignore_index"].toInt();
+  double label_smoothing = ctx->saved_data["label_smoothing"].toDouble();
+  auto saved = ctx->get_saved_variables();
+  torch::Tensor undef;
+  if (!grad_output[0].defined()) {
+    return {undef, undef, undef, undef, undef, undef};
+  }
+  torch::Tensor weight = saved[3];
+  XLATensorPtr weight_tensor =
+      weight.defined() ? bridge::GetXlaTensor(weight) : XLATensorPtr();
+  XLATensorPtr grad_input = XLATensor::cross_entropy_backward(
+      bridge::GetXlaTensor(grad_output[0]), bridge::GetXlaTensor(saved[0]),
+      bridge::GetXlaTensor(saved[1]), bridge::GetXlaTensor(saved[2]),
+      weight_tensor, reduction, ignore_index, label_smoothing);
+  torch::autograd::variable_list grad_inputs = {
+      bridge::AtenFromXlaTensor(grad_input), undef, undef, undef, undef, undef};
+  return grad_inputs;
+}
+
+namespace {
+
+bool DropoutRegenerateMask() {
+  static bool regenerate_mask =
+      xla::sys_util::GetEnvBool("XLA_DROPOUT_REGENERATE_MASK", false);
+  return regenerate_mask;
+}
+
+}  // namespace
+
+torch::Tensor DropoutAutogradFunction::forward(
+    torch::autograd::AutogradContext* ctx, torch::Tensor input, double p) {
+  bool regenerate_mask = DropoutRegenerateMask();
+  ctx->saved_data["p"] = p;
+  ctx->saved_data["regenerate_mask"] = regenerate_mask;
+  auto results =
+      XLATensor::dropout(bridge::GetXlaTensor(input), p, regenerate_mask);
+  ctx->save_for_backward({bridge::AtenFromXlaTensor(std::get<1>(results))});
+  return bridge::AtenFromXlaTensor(std::get<0>(results));
+}
+
+torch::autograd::variable_list DropoutAutogradFunction::backward(
+    torch::autograd::AutogradContext* ctx,
+    torch::autograd::variable_list grad_output) {
+  double p = ctx->saved_data["p"].toDouble();
+  bool regenerate_mask = ctx->saved_data["regenerate_mask"].toBool();
+  auto saved = ctx->get_saved_variables();
+  torch::Tensor undef;
+  if (!grad_output[0].defined()) {
+    return {undef, undef};
+  }
+  XLATensorPtr grad_input = XLATensor::dropout_backward(
+      bridge::GetXlaTensor(grad_output[0]), bridge::GetXlaTensor(saved[0]), p,
+      regenerate_mask);
+  torch::autograd::variable_list grad_inputs = {
+      bridge::AtenFromXlaTensor(grad_input), undef};
+  return grad_inputs;
+}
+
 }  // namespace aten_autograd_ops
 }  // namespace torch_xla
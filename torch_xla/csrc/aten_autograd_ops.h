@@ -33,5 +33,76 @@ struct MaxPool3dAutogradFunction
       torch::autograd::variable_list grad_output);
 };
 
+// Attention computed by the FlashAttention IR node, whose backward recomputes
+// the attention probabilities out of the saved logsumexp instead of keeping
+// them around.
+struct ScaledDotProductAttentionAutogradFunction
+    : public torch::autograd::Function<
+          ScaledDotProductAttentionAutogradFunction> {
+  static torch::Tensor forward(torch::autograd::AutogradContext* ctx,
+                               torch::Tensor query, torch::Tensor key,
+                               torch::Tensor value,
+                               const c10::optional<torch::Tensor>& attn_mask,
+                               bool is_causal, c10::optional<double> scale);
+  static torch::autograd::variable_list backward(
+      torch::autograd::AutogradContext* ctx,
+      torch::autograd::variable_list grad_output);
+};
+
+// Embedding bag whose backward sums the gradient rows of the indices by a
+// sorted segment reduction, instead of scattering them over the whole weight.
+struct EmbeddingBagAutogradFunction
+    : public torch::autograd::Function<EmbeddingBagAutogradFunction> {
+  static torch::autograd::variable_list forward(
+      torch::autograd::AutogradContext* ctx, torch::Tensor weight,
+      torch::Tensor indices, torch::Tensor offsets, bool scale_grad_by_freq,
+      int64_t mode, const c10::optional<torch::Tensor>& per_sample_weights,
+      bool include_last_offset, int64_t padding_idx);
+  static torch::autograd::variable_list backward(
+      torch::autograd::AutogradContext* ctx,
+      torch::autograd::variable_list grad_output);
+};
+
+// Layer (or RMS) normalization by the LayerNorm IR node, whose backward is a
+// single fused node out of the saved mean and rstd of the rows.
+struct LayerNormAutogradFunction
+    : public torch::autograd::Function<LayerNormAutogradFunction> {
+  static torch::autograd::variable_list forward(
+      torch::autograd::AutogradContext* ctx, torch::Tensor input,
+      torch::IntArrayRef normalized_shape,
+      const c10::optional<torch::Tensor>& weight,
+      const c10::optional<torch::Tensor>& bias, double eps, bool rms);
+  static torch::autograd::variable_list backward(
+      torch::autograd::AutogradContext* ctx,
+      torch::autograd::variable_list grad_output);
+};
+
+// Cross entropy by the CrossEntropy IR node, whose backward emits the softmax
+// minus the one-hot labels directly, so that neither pass materializes the
+// log-probabilities of the whole vocabulary.
+struct CrossEntropyAutogradFunction
+    : public torch::autograd::Function<CrossEntropyAutogradFunction> {
+  static torch::Tensor forward(torch::autograd::AutogradContext* ctx,
+                               torch::Tensor input, torch::Tensor target,
+                               const c10::optional<torch::Tensor>& weight,
+                               int64_t reduction, int64_t ignore_index,
+                               double label_smoothing);
+  static torch::autograd::variable_list backward(
+      torch::autograd::AutogradContext* ctx,
+      torch::autograd::variable_list grad_output);
+};
+
+// Dropout by the Dropout IR node, which saves its keep mask for the backward
+// pass packed one bit per element (or only its seed, with
+// XLA_DROPOUT_REGENERATE_MASK), instead of a mask of the input type.
+struct DropoutAutogradFunction
+    : public torch::autograd::Function<DropoutAutogradFunction> {
+  static torch::Tensor forward(torch::autograd::AutogradContext* ctx,
+                               torch::Tensor input, double p);
+  static torch::autograd::variable_list backward(
+      torch::autograd::AutogradContext* ctx,
+      torch::autograd::variable_list grad_output);
+};
+
 }  // namespace aten_autograd_ops
 }  // namespace torch_xla
@@ -2,9 +2,14 @@
 
 #include <tensorflow/compiler/xla/xla_client/debug_macros.h>
 #include <tensorflow/compiler/xla/xla_client/metrics.h>
+#include <tensorflow/compiler/xla/xla_client/sys_util.h>
 #include <tensorflow/compiler/xla/xla_client/tf_logging.h>
+#include <tensorflow/compiler/xla/xla_client/util.h>
 #include <torch_xla/csrc/function_call_tracker.h>
 
+#include <mutex>
+#include <set>
+#include <sstream>
 #include <unordered_map>
 
 namespace torch_xla {
@@ -12,10 +17,141 @@ namespace torch_xla {
 static std::unordered_map<std::string, ::xla::metrics::Counter*>
     _cpu_fallback_counters;
 
+namespace {
+
+// The fallbacks of every operator and input shapes, and the number of the
+// ones within the current step.
+struct FallbackStats {
+  std::mutex lock;
+  std::map<std::string, int64_t> counts;
+  int64_t step = -1;
+  int64_t step_fallbacks = 0;
+};
+
+FallbackStats* GetFallbackStats() {
+  static FallbackStats* stats = new FallbackStats();
+  return stats;
+}
+
+std::string GetFallbackKey(const std::string& name,
+                           torch::jit::ArrayRef<c10::IValue> arguments) {
+  std::stringstream ss;
+  ss << name << "(";
+  bool first = true;
+  for (const auto& ivalue : arguments) {
+    if (ivalue.isTensor()) {
+      const at::Tensor& tensor = ivalue.toTensor();
+      ss << (first ? "" : ", ");
+      if (tensor.defined()) {
+        ss << tensor.scalar_type() << tensor.sizes();
+      } else {
+        ss << "undefined";
+      }
+      first = false;
+    }
+  }
+  ss << ")";
+  return ss.str();
+}
+
+std::string FallbackStatsReport(const FallbackStats& stats) {
+  std::stringstream ss;
+  for (const auto& key_count : stats.counts) {
+    ss << "  " << key_count.first << ": " << key_count.second << "\n";
+  }
+  return ss.str();
+}
+
+// Records the fallback, and fails if it exceeds the per step fallback budget.
+void RecordFallback(const std::string& key) {
+  static int64_t budget =
+      xla::sys_util::GetEnvInt("XLA_CPU_FALLBACK_BUDGET", -1);
+  FallbackStats* stats = GetFallbackStats();
+  std::lock_guard<std::mutex> lock(stats->lock);
+  stats->counts[key] += 1;
+  ::xla::metrics::CounterData* mark_step =
+      ::xla::metrics::GetCounter("MarkStep");
+  int64_t step = mark_step != nullptr ? mark_step->Value() : 0;
+  if (step != stats->step) {
+    stats->step = step;
+    stats->step_fallbacks = 0;
+  }
+  stats->step_fallbacks += 1;
+  XLA_CHECK(budget < 0 || stats->step_fallbacks <= budget)
+      << "The CPU fallback of " << key << " exceeds the budget of " << budget
+      << " fallbacks per step (XLA_CPU_FALLBACK_BUDGET). Fallbacks so far:\n"
+      << FallbackStatsReport(*stats);
+}
+
+// Returns the runtime dispatch key to redispatch the operator to in order to
+// run its composite kernel, if it has one. The composite keys are alias keys,
+// which cannot be dispatched to, but their kernel is the one of every key of
+// their runtime set without a kernel of its own.
+c10::optional<c10::DispatchKey> GetCompositeKey(const c10::OperatorHandle& op) {
+  for (c10::DispatchKey alias :
+       {c10::DispatchKey::CompositeExplicitAutograd,
+        c10::DispatchKey::CompositeImplicitAutograd}) {
+    if (!op.hasKernelForDispatchKey(alias)) {
+      continue;
+    }
+    for (c10::DispatchKey key : c10::getRuntimeDispatchKeySet(alias)) {
+      if (key != c10::DispatchKey::XLA && !op.hasKernelForDispatchKey(key)) {
+        return key;
+      }
+    }
+  }
+  return c10::nullopt;
+}
+
+// Runs the ATen decomposition of the operator, if it has one, whose ops then
+// get dispatched to XLA again, instead of moving the tensors to the CPU. The
+// operators without an XLA kernel never get here when they have a composite
+// kernel, so these are the ones whose XLA kernel falls back for some inputs,
+// like the integer matrix products.
+bool RunDecomposition(const c10::OperatorHandle& op,
+                      torch::jit::Stack* stack) {
+  static bool decompose =
+      xla::sys_util::GetEnvBool("XLA_CPU_FALLBACK_DECOMPOSE", false);
+  // The operators being decomposed by this thread, as a decomposition can
+  // call back into the operator it decomposes.
+  static thread_local std::set<std::string> decomposing;
+  if (!decompose) {
+    return false;
+  }
+  std::string name = c10::toString(op.operator_name());
+  if (decomposing.count(name) > 0) {
+    return false;
+  }
+  c10::optional<c10::DispatchKey> key = GetCompositeKey(op);
+  if (!key) {
+    return false;
+  }
+  XLA_COUNTER("CpuFallbackDecomposed", 1);
+  decomposing.insert(name);
+  xla::util::ExceptionCleanup cleanup(
+      [&](xla::util::ExceptionCleanup::StatusType) {
+        decomposing.erase(name);
+      });
+  op.redispatchBoxed(c10::DispatchKeySet(*key), stack);
+  return true;
+}
+
+}  // namespace
+
+std::map<std::string, int64_t> GetCpuFallbackStats() {
+  FallbackStats* stats = GetFallbackStats();
+  std::lock_guard<std::mutex> lock(stats->lock);
+  return stats->counts;
+}
+
 void xla_cpu_fallback(const c10::OperatorHandle& op, torch::jit::Stack* stack) {
   XLA_FN_TRACK(3);
   const auto name = c10::toString(op.operator_name());
 
+  if (RunDecomposition(op, stack)) {
+    return;
+  }
+
   // Manually applying the XLA_COUNTER macro.
   // We need to do it ourselves and explicitly keep a mapping of counters
   // because this boxed fallback kernel is used by multiple operators,
@@ -28,6 +164,7 @@ void xla_cpu_fallback(const c10::OperatorHandle& op, torch::jit::Stack* stack) {
 
   auto& args = op.schema().arguments();
   auto arguments = torch::jit::last(stack, args.size());
+  RecordFallback(GetFallbackKey(name, arguments));
 
   // Log each tensor argument.
   for (int64_t idx = 0; idx < arguments.size(); ++idx) {
@@ -2,8 +2,15 @@
 
 #include <ATen/native/CPUFallback.h>
 
+#include <map>
+#include <string>
+
 namespace torch_xla {
 
 void xla_cpu_fallback(const c10::OperatorHandle& op, torch::jit::Stack* stack);
 
+// Returns how many times every operator fell back to the CPU, keyed by the
+// operator name and the shapes of its input tensors.
+std::map<std::string, int64_t> GetCpuFallbackStats();
+
 }  // namespace torch_xla
@@ -2,6 +2,7 @@
 
 #include <map>
 #include <string>
+#include <typeinfo>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
@@ -50,8 +51,16 @@ AtenXlaDeviceMapper* AtenXlaDeviceMapper::Get() {
   return device_mapper;
 }
 
+// Called for every input of every operation, so it avoids the dynamic_cast:
+// the XLA dispatch key rules out the other tensors without touching the RTTI,
+// and as XLATensorImpl is final, an exact type check is enough for the rest.
 XLATensorImpl* GetXlaTensorImpl(const at::Tensor& tensor) {
-  return dynamic_cast<XLATensorImpl*>(tensor.unsafeGetTensorImpl());
+  c10::TensorImpl* impl = tensor.unsafeGetTensorImpl();
+  if (!impl->key_set().has(c10::DispatchKey::XLA) ||
+      typeid(*impl) != typeid(XLATensorImpl)) {
+    return nullptr;
+  }
+  return static_cast<XLATensorImpl*>(impl);
 }
 
 }  // namespace
@@ -76,8 +85,7 @@ XLATensorPtr GetXlaTensor(const at::Tensor& tensor) {
 }
 
 void ReplaceXlaTensor(const at::Tensor& tensor, XLATensorPtr new_xla_tensor) {
-  XLATensorImpl* impl =
-      dynamic_cast<XLATensorImpl*>(tensor.unsafeGetTensorImpl());
+  XLATensorImpl* impl = GetXlaTensorImpl(tensor);
   XLA_CHECK(impl != nullptr)
       << "Input tensor is not an XLA tensor: " << tensor.toString();
   impl->set_tensor(std::move(new_xla_tensor));
@@ -87,7 +95,10 @@ std::vector<XLATensorPtr> GetXlaTensors(absl::Span<const at::Tensor> tensors) {
   std::vector<XLATensorPtr> xla_tensors;
   xla_tensors.reserve(tensors.size());
   for (const auto& tensor : tensors) {
-    xla_tensors.push_back(bridge::GetXlaTensor(tensor));
+    XLATensorImpl* impl = GetXlaTensorImpl(tensor);
+    XLA_CHECK(impl != nullptr)
+        << "Input tensor is not an XLA tensor: " << tensor.toString();
+    xla_tensors.push_back(impl->tensor());
   }
   return xla_tensors;
 }
@@ -133,16 +144,17 @@ std::vector<XLATensorPtr> GetOrCreateXlaTensors(
 std::vector<at::Tensor> XlaCreateTensorList(const at::TensorList& tensors) {
   std::vector<at::Tensor> aten_xla_tensors(tensors.size());
   std::vector<XLATensorPtr> xla_tensors;
+  xla_tensors.reserve(tensors.size());
   // We need to separate out the defined tensors first, GetXlaTensor() doesn't
   // work with undefined tensors.
   std::vector<bool> to_translate(tensors.size());
   for (size_t i = 0; i < tensors.size(); ++i) {
     const at::Tensor& tensor = tensors[i];
     if (tensor.defined()) {
-      auto xtensor = TryGetXlaTensor(tensor);
-      if (xtensor) {
+      XLATensorImpl* impl = GetXlaTensorImpl(tensor);
+      if (impl != nullptr) {
         to_translate[i] = true;
-        xla_tensors.push_back(xtensor);
+        xla_tensors.push_back(impl->tensor());
       } else {
         aten_xla_tensors[i] = tensor;
       }
@@ -23,9 +23,11 @@
 #include "torch_xla/csrc/device.h"
 #include "torch_xla/csrc/generated/XLANativeFunctions.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/host_trace.h"
 #include "torch_xla/csrc/ops/as_strided.h"
 #include "torch_xla/csrc/ops/index_ops.h"
 #include "torch_xla/csrc/pooling.h"
+#include "torch_xla/csrc/resize_ops.h"
 #include "torch_xla/csrc/tensor_impl.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
@@ -247,11 +249,35 @@ void DoBinaryOpOut(const at::Tensor& self, const at::Tensor& other,
   bin_op_out(operands.first, operands.second, out_tensor);
 }
 
+// Whether a foreach operation can be lowered within a single IR node: the
+// lists must hold floating point tensors of a single device, with the tensors
+// at the same position of all the lists having the same sizes and type.
+bool IsForeachFusible(std::initializer_list<at::TensorList> lists) {
+  at::TensorList inputs = *lists.begin();
+  if (inputs.empty()) {
+    return false;
+  }
+  for (auto& list : lists) {
+    if (list.size() != inputs.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      if (!at::native::is_floating_point(list[i]) ||
+          list[i].device() != inputs[0].device() ||
+          list[i].scalar_type() != inputs[i].scalar_type() ||
+          list[i].sizes() != inputs[i].sizes()) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
 }  // namespace
 
 at::Tensor& XLANativeFunctions::__ilshift__(at::Tensor& self,
                                             const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ilshift__(self_tensor, other);
   return self;
@@ -259,7 +285,7 @@ at::Tensor& XLANativeFunctions::__ilshift__(at::Tensor& self,
 
 at::Tensor& XLANativeFunctions::__ilshift__(at::Tensor& self,
                                             const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckBinaryOpTypePromotion(self, self, other);
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__ilshift__(self_tensor, bridge::GetXlaTensor(other));
@@ -268,7 +294,7 @@ at::Tensor& XLANativeFunctions::__ilshift__(at::Tensor& self,
 
 at::Tensor& XLANativeFunctions::__irshift__(at::Tensor& self,
                                             const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckBinaryOpTypePromotion(self, self, other);
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__irshift__(self_tensor, other);
@@ -277,7 +303,7 @@ at::Tensor& XLANativeFunctions::__irshift__(at::Tensor& self,
 
 at::Tensor& XLANativeFunctions::__irshift__(at::Tensor& self,
                                             const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckBinaryOpTypePromotion(self, self, other);
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::__irshift__(self_tensor, bridge::GetXlaTensor(other));
@@ -286,7 +312,7 @@ at::Tensor& XLANativeFunctions::__irshift__(at::Tensor& self,
 
 at::Tensor XLANativeFunctions::__lshift__(const at::Tensor& self,
                                           const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const at::Scalar& other,
                         at::ScalarType dtype) {
@@ -296,7 +322,7 @@ at::Tensor XLANativeFunctions::__lshift__(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::__lshift__(const at::Tensor& self,
                                           const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const XLATensorPtr& xother,
                         at::ScalarType dtype) {
@@ -306,7 +332,7 @@ at::Tensor XLANativeFunctions::__lshift__(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::__rshift__(const at::Tensor& self,
                                           const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const at::Scalar& other,
                         at::ScalarType dtype) {
@@ -316,7 +342,7 @@ at::Tensor XLANativeFunctions::__rshift__(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::__rshift__(const at::Tensor& self,
                                           const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const XLATensorPtr& xother,
                         at::ScalarType dtype) {
@@ -326,7 +352,7 @@ at::Tensor XLANativeFunctions::__rshift__(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::_adaptive_avg_pool3d(
     const at::Tensor& self, at::IntArrayRef output_size) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto output_size_list = XlaHelpers::I64List(output_size);
   if (!IsSupportedAdaptivePool(XlaHelpers::I64List(self.sizes()),
                                output_size_list, /*pool_dim=*/3)) {
@@ -340,7 +366,7 @@ at::Tensor XLANativeFunctions::_adaptive_avg_pool3d(
 
 at::Tensor XLANativeFunctions::_adaptive_avg_pool3d_backward(
     const at::Tensor& grad_output, const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   int64_t rank = grad_output.dim();
   std::vector<int64_t> output_size{grad_output.size(rank - 3),
                                    grad_output.size(rank - 2),
@@ -357,7 +383,7 @@ at::Tensor XLANativeFunctions::_adaptive_avg_pool3d_backward(
 
 at::Tensor XLANativeFunctions::_adaptive_avg_pool2d(
     const at::Tensor& self, at::IntArrayRef output_size) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto output_size_list = XlaHelpers::I64List(output_size);
   if (!IsSupportedAdaptivePool(XlaHelpers::I64List(self.sizes()),
                                output_size_list, /*pool_dim=*/2)) {
@@ -373,7 +399,7 @@ at::Tensor XLANativeFunctions::_adaptive_avg_pool2d(
 
 at::Tensor XLANativeFunctions::_adaptive_avg_pool2d_backward(
     const at::Tensor& grad_output, const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   int64_t rank = grad_output.dim();
   std::vector<int64_t> output_size{grad_output.size(rank - 2),
                                    grad_output.size(rank - 1)};
@@ -392,7 +418,7 @@ at::Tensor XLANativeFunctions::_adaptive_avg_pool2d_backward(
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::adaptive_max_pool2d(
     const at::Tensor& self, at::IntArrayRef output_size) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto output_size_list = XlaHelpers::I64List(output_size);
   if (!IsSupportedAdaptivePool(XlaHelpers::I64List(self.sizes()),
                                output_size_list, /*pool_dim=*/2)) {
@@ -409,7 +435,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::adaptive_max_pool2d(
 at::Tensor XLANativeFunctions::adaptive_max_pool2d_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& indices) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   int64_t rank = grad_output.dim();
   std::vector<int64_t> output_size{grad_output.size(rank - 2),
                                    grad_output.size(rank - 1)};
@@ -426,7 +452,7 @@ at::Tensor XLANativeFunctions::adaptive_max_pool2d_backward(
 
 void XLANativeFunctions::_amp_foreach_non_finite_check_and_unscale_(
     at::TensorList self, at::Tensor& found_inf, const at::Tensor& inv_scale) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr found_inf_tensor = bridge::GetXlaTensor(found_inf);
   XlaDeviceType hw_type =
       static_cast<XlaDeviceType>(found_inf_tensor->GetDevice().type());
@@ -443,7 +469,7 @@ at::Tensor& XLANativeFunctions::_amp_update_scale_(at::Tensor& current_scale,
                                                    double scale_growth_factor,
                                                    double scale_backoff_factor,
                                                    int64_t growth_interval) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr growth_tracker_tensor = bridge::GetXlaTensor(growth_tracker);
   XLATensorPtr current_scale_tensor = bridge::GetXlaTensor(current_scale);
   XlaDeviceType hw_type =
@@ -460,7 +486,7 @@ at::Tensor& XLANativeFunctions::_amp_update_scale_(at::Tensor& current_scale,
 at::Tensor XLANativeFunctions::_copy_from(const at::Tensor& self,
                                           const at::Tensor& dst,
                                           bool non_blocking) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto dst_tensor = bridge::TryGetXlaTensor(dst);
   auto self_tensor = bridge::TryGetXlaTensor(self);
   if (!self_tensor) {
@@ -482,7 +508,7 @@ at::Tensor XLANativeFunctions::_copy_from(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::_copy_from_and_resize(const at::Tensor& self,
                                                      const at::Tensor& dst) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto dst_tensor = bridge::TryGetXlaTensor(dst);
   auto self_tensor = bridge::TryGetXlaTensor(self);
   if (!self_tensor) {
@@ -496,29 +522,192 @@ at::Tensor XLANativeFunctions::_copy_from_and_resize(const at::Tensor& self,
   } else {
     // at this point we know dst is an XLA tensor
     XLATensorImpl* dest_impl =
-        dynamic_cast<XLATensorImpl*>(dst.unsafeGetTensorImpl());
+        static_cast<XLATensorImpl*>(dst.unsafeGetTensorImpl());
     dest_impl->tensor()->UpdateFromTensorOut(self_tensor);
     dest_impl->force_refresh_sizes();
   }
   return dst;
 }
 
+std::tuple<at::Tensor, at::Tensor, at::Tensor, at::Tensor>
+XLANativeFunctions::_embedding_bag(
+    const at::Tensor& weight, const at::Tensor& indices,
+    const at::Tensor& offsets, bool scale_grad_by_freq, int64_t mode,
+    bool sparse, const c10::optional<at::Tensor>& per_sample_weights,
+    bool include_last_offset, int64_t padding_idx) {
+  XLA_FN_TRACE("xla::");
+  // The gradient of the weight is always dense, as XLA has no sparse tensors,
+  // but it is computed by a sorted segment sum of the selected rows.
+  torch::autograd::variable_list outputs =
+      aten_autograd_ops::EmbeddingBagAutogradFunction::apply(
+          weight, indices, offsets, scale_grad_by_freq, mode,
+          per_sample_weights, include_last_offset, padding_idx);
+  return std::make_tuple(outputs[0], outputs[1], outputs[2], outputs[3]);
+}
+
+std::tuple<at::Tensor, at::Tensor, at::Tensor, at::Tensor>
+XLANativeFunctions::_embedding_bag_forward_only(
+    const at::Tensor& weight, const at::Tensor& indices,
+    const at::Tensor& offsets, bool scale_grad_by_freq, int64_t mode,
+    bool sparse, const c10::optional<at::Tensor>& per_sample_weights,
+    bool include_last_offset, int64_t padding_idx) {
+  XLA_FN_TRACE("xla::");
+  if (!at::isFloatingType(weight.scalar_type()) || indices.dim() != 1 ||
+      (per_sample_weights && mode != 0)) {
+    return at::native::call_fallback_fn<
+        &xla_cpu_fallback, ATEN_OP(_embedding_bag_forward_only)>::
+        call(weight, indices, offsets, scale_grad_by_freq, mode, sparse,
+             per_sample_weights, include_last_offset, padding_idx);
+  }
+  XLATensorPtr weight_tensor = bridge::GetXlaTensor(weight);
+  auto outputs = XLATensor::embedding_bag(
+      weight_tensor, bridge::GetXlaTensor(indices),
+      bridge::GetXlaTensor(offsets), mode,
+      bridge::GetOrCreateXlaTensor(per_sample_weights,
+                                   weight_tensor->GetDevice()),
+      include_last_offset, padding_idx);
+  return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
+                         bridge::AtenFromXlaTensor(std::get<1>(outputs)),
+                         bridge::AtenFromXlaTensor(std::get<2>(outputs)),
+                         bridge::AtenFromXlaTensor(std::get<3>(outputs)));
+}
+
 std::vector<at::Tensor> XLANativeFunctions::_to_cpu(at::TensorList tensors) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::XlaCreateTensorList(tensors);
 }
 
+// The foreach operations which cannot be lowered within a single node use the
+// ATen per tensor kernels, which still dispatch every operation to XLA rather
+// than falling back to CPU.
+std::vector<at::Tensor> XLANativeFunctions::_foreach_add(
+    at::TensorList self, const at::Scalar& scalar) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self}) || scalar.isComplex()) {
+    return at::native::foreach_tensor_add_scalar_kernel_slow(self, scalar);
+  }
+  return bridge::AtenFromXlaTensors(
+      XLATensor::foreach_add(bridge::GetXlaTensors(self), scalar));
+}
+
+void XLANativeFunctions::_foreach_add_(at::TensorList self,
+                                       const at::Scalar& scalar) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self}) || scalar.isComplex()) {
+    return at::native::foreach_tensor_add_scalar_kernel_slow_(self, scalar);
+  }
+  XLATensor::foreach_add_(bridge::GetXlaTensors(self), scalar);
+}
+
+std::vector<at::Tensor> XLANativeFunctions::_foreach_add(
+    at::TensorList self, at::TensorList other, const at::Scalar& alpha) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self, other}) || alpha.isComplex()) {
+    return at::native::foreach_tensor_add_list_kernel_slow(self, other, alpha);
+  }
+  return bridge::AtenFromXlaTensors(XLATensor::foreach_add(
+      bridge::GetXlaTensors(self), bridge::GetXlaTensors(other), alpha));
+}
+
+void XLANativeFunctions::_foreach_add_(at::TensorList self,
+                                       at::TensorList other,
+                                       const at::Scalar& alpha) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self, other}) || alpha.isComplex()) {
+    return at::native::foreach_tensor_add_list_kernel_slow_(self, other,
+                                                            alpha);
+  }
+  XLATensor::foreach_add_(bridge::GetXlaTensors(self),
+                          bridge::GetXlaTensors(other), alpha);
+}
+
+std::vector<at::Tensor> XLANativeFunctions::_foreach_addcmul(
+    at::TensorList self, at::TensorList tensor1, at::TensorList tensor2,
+    const at::Scalar& value) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self, tensor1, tensor2}) || value.isComplex()) {
+    return at::native::foreach_tensor_addcmul_scalar_slow(self, tensor1,
+                                                          tensor2, value);
+  }
+  return bridge::AtenFromXlaTensors(XLATensor::foreach_addcmul(
+      bridge::GetXlaTensors(self), bridge::GetXlaTensors(tensor1),
+      bridge::GetXlaTensors(tensor2), value));
+}
+
+void XLANativeFunctions::_foreach_addcmul_(at::TensorList self,
+                                           at::TensorList tensor1,
+                                           at::TensorList tensor2,
+                                           const at::Scalar& value) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self, tensor1, tensor2}) || value.isComplex()) {
+    return at::native::foreach_tensor_addcmul_scalar_slow_(self, tensor1,
+                                                           tensor2, value);
+  }
+  XLATensor::foreach_addcmul_(bridge::GetXlaTensors(self),
+                              bridge::GetXlaTensors(tensor1),
+                              bridge::GetXlaTensors(tensor2), value);
+}
+
+std::vector<at::Tensor> XLANativeFunctions::_foreach_mul(
+    at::TensorList self, const at::Scalar& scalar) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self}) || scalar.isComplex()) {
+    return at::native::foreach_tensor_mul_scalar_kernel_slow(self, scalar);
+  }
+  return bridge::AtenFromXlaTensors(
+      XLATensor::foreach_mul(bridge::GetXlaTensors(self), scalar));
+}
+
+void XLANativeFunctions::_foreach_mul_(at::TensorList self,
+                                       const at::Scalar& scalar) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self}) || scalar.isComplex()) {
+    return at::native::foreach_tensor_mul_scalar_kernel_slow_(self, scalar);
+  }
+  XLATensor::foreach_mul_(bridge::GetXlaTensors(self), scalar);
+}
+
+std::vector<at::Tensor> XLANativeFunctions::_foreach_mul(
+    at::TensorList self, at::TensorList other) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self, other})) {
+    return at::native::foreach_tensor_mul_list_kernel_slow(self, other);
+  }
+  return bridge::AtenFromXlaTensors(XLATensor::foreach_mul(
+      bridge::GetXlaTensors(self), bridge::GetXlaTensors(other)));
+}
+
+void XLANativeFunctions::_foreach_mul_(at::TensorList self,
+                                       at::TensorList other) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self, other})) {
+    return at::native::foreach_tensor_mul_list_kernel_slow_(self, other);
+  }
+  XLATensor::foreach_mul_(bridge::GetXlaTensors(self),
+                          bridge::GetXlaTensors(other));
+}
+
+std::vector<at::Tensor> XLANativeFunctions::_foreach_norm(
+    at::TensorList self, const at::Scalar& ord) {
+  XLA_FN_TRACE("xla::");
+  if (!IsForeachFusible({self})) {
+    return at::native::foreach_tensor_norm_slow(self, ord);
+  }
+  return bridge::AtenFromXlaTensors(
+      XLATensor::foreach_norm(bridge::GetXlaTensors(self), ord.toDouble()));
+}
+
 at::Tensor& XLANativeFunctions::_index_put_impl_(
     at::Tensor& self, const c10::List<c10::optional<at::Tensor>>& indices,
     const at::Tensor& values, bool accumulate, bool /* unsafe */) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return torch_xla::XLANativeFunctions::index_put_(self, indices, values,
                                                    accumulate);
 }
 
 at::Tensor XLANativeFunctions::_log_softmax(const at::Tensor& self, int64_t dim,
                                             bool half_to_float) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto self_meta = to_meta(self);
   auto out_meta = at::meta::_log_softmax(self_meta, dim, half_to_float);
 
@@ -531,14 +720,14 @@ at::Tensor XLANativeFunctions::_log_softmax(const at::Tensor& self, int64_t dim,
 at::Tensor XLANativeFunctions::_log_softmax_backward_data(
     const at::Tensor& grad_output, const at::Tensor& output, int64_t dim,
     at::ScalarType /* input_dtype */) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::log_softmax_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output), dim));
 }
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::_pack_padded_sequence(
     const at::Tensor& input, const at::Tensor& lengths, bool batch_first) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   std::vector<at::Tensor> xla_tensors = {lengths};
   auto cpu_tensors = bridge::XlaCreateTensorList(xla_tensors);
   return at::native::_pack_padded_sequence(input, cpu_tensors[0], batch_first);
@@ -546,7 +735,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::_pack_padded_sequence(
 
 at::Tensor XLANativeFunctions::_softmax(const at::Tensor& self, int64_t dim,
                                         bool /* half_to_float */) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::softmax(bridge::GetXlaTensor(self), dim, c10::nullopt));
 }
@@ -554,7 +743,7 @@ at::Tensor XLANativeFunctions::_softmax(const at::Tensor& self, int64_t dim,
 at::Tensor XLANativeFunctions::_softmax_backward_data(
     const at::Tensor& grad_output, const at::Tensor& output, int64_t dim,
     at::ScalarType input_dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::softmax_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output), dim));
 }
@@ -563,21 +752,21 @@ at::Tensor XLANativeFunctions::_trilinear(
     const at::Tensor& i1, const at::Tensor& i2, const at::Tensor& i3,
     at::IntArrayRef expand1, at::IntArrayRef expand2, at::IntArrayRef expand3,
     at::IntArrayRef sumdim, int64_t unroll_dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return at::native::_trilinear(i1, i2, i3, expand1, expand2, expand3, sumdim,
                                 unroll_dim);
 }
 
 at::Tensor XLANativeFunctions::_unsafe_view(const at::Tensor& self,
                                             at::IntArrayRef size) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return view(self, size);
 }
 
 at::Tensor XLANativeFunctions::add(const at::Tensor& self,
                                    const at::Tensor& other,
                                    const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   at::native::alpha_check(at::result_type(self, other), alpha);
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const XLATensorPtr& xother,
@@ -589,7 +778,7 @@ at::Tensor XLANativeFunctions::add(const at::Tensor& self,
 at::Tensor XLANativeFunctions::add(const at::Tensor& self,
                                    const at::Scalar& other,
                                    const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const at::Scalar& other,
                         at::ScalarType dtype) {
@@ -601,7 +790,7 @@ at::Tensor XLANativeFunctions::addcdiv(const at::Tensor& self,
                                        const at::Tensor& tensor1,
                                        const at::Tensor& tensor2,
                                        const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::addcdiv(
       bridge::GetXlaTensor(self), value, bridge::GetXlaTensor(tensor1),
       bridge::GetXlaTensor(tensor2)));
@@ -611,7 +800,7 @@ at::Tensor& XLANativeFunctions::addcdiv_(at::Tensor& self,
                                          const at::Tensor& tensor1,
                                          const at::Tensor& tensor2,
                                          const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::addcdiv_(self_tensor, value, bridge::GetXlaTensor(tensor1),
                       bridge::GetXlaTensor(tensor2));
@@ -622,7 +811,7 @@ at::Tensor XLANativeFunctions::addcmul(const at::Tensor& self,
                                        const at::Tensor& tensor1,
                                        const at::Tensor& tensor2,
                                        const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::addcmul(
       bridge::GetXlaTensor(self), value, bridge::GetXlaTensor(tensor1),
       bridge::GetXlaTensor(tensor2)));
@@ -633,7 +822,7 @@ at::Tensor XLANativeFunctions::addmm(const at::Tensor& self,
                                      const at::Tensor& mat2,
                                      const at::Scalar& beta,
                                      const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::dot doesn't support integer types.
   if (beta.to<double>() != 1 || alpha.to<double>() != 1 ||
       !at::native::is_floating_point(self) ||
@@ -650,12 +839,12 @@ at::Tensor XLANativeFunctions::addmm(const at::Tensor& self,
 }
 
 at::Tensor XLANativeFunctions::alias(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return self;
 }
 
 at::Tensor XLANativeFunctions::all(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::all(
       self_tensor,
@@ -665,14 +854,14 @@ at::Tensor XLANativeFunctions::all(const at::Tensor& self) {
 
 at::Tensor XLANativeFunctions::all(const at::Tensor& self, int64_t dim,
                                    bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::all(bridge::GetXlaTensor(self), {dim}, keepdim));
 }
 
 at::Tensor XLANativeFunctions::amax(const at::Tensor& self, at::IntArrayRef dim,
                                     bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto xdim = XlaHelpers::I64List(dim);
   return bridge::AtenFromXlaTensor(
       XLATensor::amax(bridge::GetXlaTensor(self), std::move(xdim), keepdim));
@@ -680,14 +869,14 @@ at::Tensor XLANativeFunctions::amax(const at::Tensor& self, at::IntArrayRef dim,
 
 at::Tensor XLANativeFunctions::amin(const at::Tensor& self, at::IntArrayRef dim,
                                     bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto xdim = XlaHelpers::I64List(dim);
   return bridge::AtenFromXlaTensor(
       XLATensor::amin(bridge::GetXlaTensor(self), std::move(xdim), keepdim));
 }
 
 at::Tensor XLANativeFunctions::any(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::any(
       self_tensor,
@@ -697,7 +886,7 @@ at::Tensor XLANativeFunctions::any(const at::Tensor& self) {
 
 at::Tensor XLANativeFunctions::any(const at::Tensor& self, int64_t dim,
                                    bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::any(bridge::GetXlaTensor(self), {dim}, keepdim));
 }
@@ -706,7 +895,7 @@ at::Tensor& XLANativeFunctions::arange_out(const at::Scalar& start,
                                            const at::Scalar& end,
                                            const at::Scalar& step,
                                            at::Tensor& out) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr out_tensor = bridge::GetXlaTensor(out);
   XLATensor::arange_out(out_tensor, start, end, step, out.scalar_type());
   return out;
@@ -715,7 +904,7 @@ at::Tensor& XLANativeFunctions::arange_out(const at::Scalar& start,
 at::Tensor XLANativeFunctions::argmax(const at::Tensor& self,
                                       c10::optional<int64_t> dim,
                                       bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return dim ? bridge::AtenFromXlaTensor(
                    XLATensor::argmax(bridge::GetXlaTensor(self), *dim, keepdim))
              : bridge::AtenFromXlaTensor(
@@ -725,7 +914,7 @@ at::Tensor XLANativeFunctions::argmax(const at::Tensor& self,
 at::Tensor XLANativeFunctions::argmin(const at::Tensor& self,
                                       c10::optional<int64_t> dim,
                                       bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return dim ? bridge::AtenFromXlaTensor(
                    XLATensor::argmin(bridge::GetXlaTensor(self), *dim, keepdim))
              : bridge::AtenFromXlaTensor(
@@ -735,7 +924,7 @@ at::Tensor XLANativeFunctions::argmin(const at::Tensor& self,
 at::Tensor XLANativeFunctions::as_strided(
     const at::Tensor& self, at::IntArrayRef size, at::IntArrayRef stride,
     c10::optional<int64_t> storage_offset) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   auto xsize = XlaHelpers::I64List(size);
   auto xstride = XlaHelpers::I64List(stride);
@@ -753,7 +942,7 @@ at::Tensor XLANativeFunctions::as_strided(
 const at::Tensor& XLANativeFunctions::as_strided_(
     const at::Tensor& self, at::IntArrayRef size, at::IntArrayRef stride,
     c10::optional<int64_t> storage_offset) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   auto xsize = XlaHelpers::I64List(size);
   auto xstride = XlaHelpers::I64List(stride);
@@ -770,7 +959,7 @@ const at::Tensor& XLANativeFunctions::as_strided_(
 
 at::Tensor XLANativeFunctions::atan2(const at::Tensor& self,
                                      const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::Atan2 doesn't support integer types.
   if (!self.is_floating_point() || !other.is_floating_point()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
@@ -787,7 +976,7 @@ at::Tensor XLANativeFunctions::avg_pool2d(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, bool ceil_mode, bool count_include_pad,
     c10::optional<int64_t> divisor_override) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP(avg_pool2d)>::call(self, kernel_size, stride,
@@ -806,7 +995,7 @@ at::Tensor XLANativeFunctions::avg_pool2d_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, bool ceil_mode, bool count_include_pad,
     c10::optional<int64_t> divisor_override) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return at::native::
         call_fallback_fn<&xla_cpu_fallback, ATEN_OP(avg_pool2d_backward)>::call(
@@ -824,7 +1013,7 @@ at::Tensor XLANativeFunctions::avg_pool3d(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, bool ceil_mode, bool count_include_pad,
     c10::optional<int64_t> divisor_override) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP(avg_pool3d)>::call(self, kernel_size, stride,
@@ -843,7 +1032,7 @@ at::Tensor XLANativeFunctions::avg_pool3d_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, bool ceil_mode, bool count_include_pad,
     c10::optional<int64_t> divisor_override) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if ((ceil_mode && count_include_pad) || divisor_override) {
     return at::native::
         call_fallback_fn<&xla_cpu_fallback, ATEN_OP(avg_pool3d_backward)>::call(
@@ -862,7 +1051,7 @@ at::Tensor XLANativeFunctions::baddbmm(const at::Tensor& self,
                                        const at::Tensor& batch2,
                                        const at::Scalar& beta,
                                        const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::dot doesn't support integer types.
   if (!at::native::is_floating_point(batch1) ||
       !at::native::is_floating_point(batch2)) {
@@ -878,7 +1067,7 @@ at::Tensor XLANativeFunctions::baddbmm(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::bernoulli(
     const at::Tensor& self, c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP(bernoulli)>::call(self,
@@ -890,7 +1079,7 @@ at::Tensor XLANativeFunctions::bernoulli(
 
 at::Tensor& XLANativeFunctions::bernoulli_(
     at::Tensor& self, double p, c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP2(bernoulli_, float)>::call(self, p,
@@ -904,7 +1093,7 @@ at::Tensor& XLANativeFunctions::bernoulli_(
 at::Tensor& XLANativeFunctions::bernoulli_(
     at::Tensor& self, const at::Tensor& p,
     c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP2(bernoulli_, Tensor)>::call(self, p,
@@ -918,7 +1107,7 @@ at::Tensor& XLANativeFunctions::bernoulli_(
 at::Tensor XLANativeFunctions::binary_cross_entropy(
     const at::Tensor& self, const at::Tensor& target,
     const c10::optional<at::Tensor>& weight, int64_t reduction) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensorPtr weight_tensor =
       bridge::GetOrCreateXlaTensor(weight, self_tensor->GetDevice());
@@ -930,7 +1119,7 @@ at::Tensor XLANativeFunctions::binary_cross_entropy_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& target, const c10::optional<at::Tensor>& weight,
     int64_t reduction) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensorPtr weight_tensor =
       bridge::GetOrCreateXlaTensor(weight, self_tensor->GetDevice());
@@ -943,7 +1132,7 @@ at::Tensor XLANativeFunctions::binary_cross_entropy_with_logits(
     const at::Tensor& self, const at::Tensor& target,
     const c10::optional<at::Tensor>& weight,
     const c10::optional<at::Tensor>& pos_weight, int64_t reduction) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return at::native::binary_cross_entropy_with_logits(
       self, target, IsDefined(weight) ? *weight : at::Tensor(),
       IsDefined(pos_weight) ? *pos_weight : at::Tensor(), reduction);
@@ -951,7 +1140,7 @@ at::Tensor XLANativeFunctions::binary_cross_entropy_with_logits(
 
 at::Tensor XLANativeFunctions::bitwise_and(const at::Tensor& self,
                                            const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckBinaryOpTypePromotion(self, self, other);
   return bridge::AtenFromXlaTensor(
       XLATensor::bitwise_and(bridge::GetXlaTensor(self), other));
@@ -959,7 +1148,7 @@ at::Tensor XLANativeFunctions::bitwise_and(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::bitwise_and(const at::Tensor& self,
                                            const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOpWithoutPromo(
       self, other, [&](const XLATensorPtr& xself, const XLATensorPtr& other) {
         return XLATensor::bitwise_and(xself, other);
@@ -967,14 +1156,14 @@ at::Tensor XLANativeFunctions::bitwise_and(const at::Tensor& self,
 }
 
 at::Tensor XLANativeFunctions::bitwise_not(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::bitwise_not(self_tensor));
 }
 
 at::Tensor XLANativeFunctions::bitwise_or(const at::Tensor& self,
                                           const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOpWithoutPromo(
       self, other, [&](const XLATensorPtr& xself, const at::Scalar& xother) {
         return XLATensor::bitwise_or(xself, xother);
@@ -983,7 +1172,7 @@ at::Tensor XLANativeFunctions::bitwise_or(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::bitwise_or(const at::Tensor& self,
                                           const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOpWithoutPromo(
       self, other, [&](const XLATensorPtr& xself, const XLATensorPtr& xother) {
         return XLATensor::bitwise_or(xself, xother);
@@ -992,7 +1181,7 @@ at::Tensor XLANativeFunctions::bitwise_or(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::bitwise_xor(const at::Tensor& self,
                                            const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOpWithoutPromo(
       self, other, [&](const XLATensorPtr& xself, const at::Scalar& xother) {
         return XLATensor::bitwise_xor(xself, xother);
@@ -1001,7 +1190,7 @@ at::Tensor XLANativeFunctions::bitwise_xor(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::bitwise_xor(const at::Tensor& self,
                                            const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOpWithoutPromo(
       self, other, [&](const XLATensorPtr& xself, const XLATensorPtr& xother) {
         return XLATensor::bitwise_xor(xself, xother);
@@ -1010,7 +1199,7 @@ at::Tensor XLANativeFunctions::bitwise_xor(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::bmm(const at::Tensor& self,
                                    const at::Tensor& mat2) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::dot doesn't support integer types.
   if (!at::native::is_floating_point(self) ||
       !at::native::is_floating_point(mat2)) {
@@ -1022,28 +1211,28 @@ at::Tensor XLANativeFunctions::bmm(const at::Tensor& self,
 }
 
 at::Tensor XLANativeFunctions::cat(at::TensorList tensors, int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::cat(
       bridge::GetXlaTensors(tensors), dim, at::native::result_type(tensors)));
 }
 
 at::Tensor XLANativeFunctions::celu(const at::Tensor& self,
                                     const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::celu(bridge::GetXlaTensor(self), alpha));
 }
 
 at::Tensor& XLANativeFunctions::celu_(at::Tensor& self,
                                       const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::celu_(self_tensor, alpha);
   return self;
 }
 
 at::Tensor XLANativeFunctions::cholesky(const at::Tensor& self, bool upper) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::cholesky(bridge::GetXlaTensor(self), upper));
 }
@@ -1051,7 +1240,7 @@ at::Tensor XLANativeFunctions::cholesky(const at::Tensor& self, bool upper) {
 at::Tensor XLANativeFunctions::clamp(const at::Tensor& self,
                                      const c10::optional<at::Scalar>& min,
                                      const c10::optional<at::Scalar>& max) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min, max));
 }
@@ -1059,35 +1248,35 @@ at::Tensor XLANativeFunctions::clamp(const at::Tensor& self,
 at::Tensor XLANativeFunctions::clamp(const at::Tensor& self,
                                      const c10::optional<at::Tensor>& min,
                                      const c10::optional<at::Tensor>& max) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min, max));
 }
 
 at::Tensor XLANativeFunctions::clamp_max(const at::Tensor& self,
                                          const at::Scalar& max) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), c10::nullopt, max));
 }
 
 at::Tensor XLANativeFunctions::clamp_max(const at::Tensor& self,
                                          const at::Tensor& max) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), c10::nullopt, max));
 }
 
 at::Tensor XLANativeFunctions::clamp_min(const at::Tensor& self,
                                          const at::Scalar& min) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min, c10::nullopt));
 }
 
 at::Tensor XLANativeFunctions::clamp_min(const at::Tensor& self,
                                          const at::Tensor& min) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min, c10::nullopt));
 }
@@ -1095,7 +1284,7 @@ at::Tensor XLANativeFunctions::clamp_min(const at::Tensor& self,
 at::Tensor XLANativeFunctions::clone(
     const at::Tensor& self,
     c10::optional<at::MemoryFormat> /* memory_format */) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clone(bridge::GetXlaTensor(self)));
 }
@@ -1103,7 +1292,7 @@ at::Tensor XLANativeFunctions::clone(
 at::Tensor XLANativeFunctions::constant_pad_nd(const at::Tensor& self,
                                                at::IntArrayRef pad,
                                                const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::constant_pad_nd(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(pad), value));
 }
@@ -1114,7 +1303,7 @@ at::Tensor XLANativeFunctions::convolution_overrideable(
     const c10::optional<at::Tensor>& bias, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool transposed,
     at::IntArrayRef output_padding, int64_t groups) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (IsDefined(bias)) {
     return bridge::AtenFromXlaTensor(XLATensor::convolution_overrideable(
         bridge::GetXlaTensor(input), bridge::GetXlaTensor(weight),
@@ -1137,7 +1326,7 @@ XLANativeFunctions::convolution_backward_overrideable(
     const at::Tensor& weight, at::IntArrayRef stride, at::IntArrayRef padding,
     at::IntArrayRef dilation, bool transposed, at::IntArrayRef output_padding,
     int64_t groups, std::array<bool, 3> output_mask) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto gradients = XLATensor::convolution_backward_overrideable(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(input),
       bridge::GetXlaTensor(weight), XlaHelpers::I64List(stride),
@@ -1155,15 +1344,31 @@ XLANativeFunctions::convolution_backward_overrideable(
 at::Tensor XLANativeFunctions::cross(const at::Tensor& self,
                                      const at::Tensor& other,
                                      c10::optional<int64_t> dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::cross(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other),
                        XlaHelpers::I64Optional(dim)));
 }
 
+at::Tensor XLANativeFunctions::cross_entropy_loss(
+    const at::Tensor& self, const at::Tensor& target,
+    const c10::optional<at::Tensor>& weight, int64_t reduction,
+    int64_t ignore_index, double label_smoothing) {
+  XLA_FN_TRACE("xla::");
+  if (!at::isFloatingType(self.scalar_type()) ||
+      !at::isIntegralType(target.scalar_type(), /*includeBool=*/false)) {
+    // re-use the composite kernel from core for the class probability
+    // targets, that way we don't need to provide a backwards formula for them.
+    return at::native::cross_entropy_loss(self, target, weight, reduction,
+                                          ignore_index, label_smoothing);
+  }
+  return aten_autograd_ops::CrossEntropyAutogradFunction::apply(
+      self, target, weight, reduction, ignore_index, label_smoothing);
+}
+
 at::Tensor XLANativeFunctions::cumprod(const at::Tensor& self, int64_t dim,
                                        c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   c10::optional<at::ScalarType> promoted_dtype =
       PromoteIntegralType(self_tensor->dtype(), dtype);
@@ -1180,7 +1385,7 @@ at::Tensor XLANativeFunctions::cumprod(const at::Tensor& self, int64_t dim,
 
 at::Tensor XLANativeFunctions::cumsum(const at::Tensor& self, int64_t dim,
                                       c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   if (IsOperationOnType(dtype, self_tensor->dtype(), at::ScalarType::Long)) {
     // XLA reduce-window does not support S64 mode.
@@ -1192,14 +1397,14 @@ at::Tensor XLANativeFunctions::cumsum(const at::Tensor& self, int64_t dim,
 }
 
 at::Tensor XLANativeFunctions::diag(const at::Tensor& self, int64_t diagonal) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::diag(bridge::GetXlaTensor(self), diagonal));
 }
 
 at::Tensor XLANativeFunctions::diagonal(const at::Tensor& self, int64_t offset,
                                         int64_t dim1, int64_t dim2) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::diagonal(bridge::GetXlaTensor(self), offset, dim1, dim2));
 }
@@ -1213,7 +1418,7 @@ at::Tensor XLANativeFunctions::div(const at::Tensor& self,
 at::Tensor XLANativeFunctions::div(
     const at::Tensor& self, const at::Tensor& other,
     c10::optional<c10::string_view> rounding_mode) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   at::ScalarType dtype = at::result_type(self, other);
   auto operands = GetBinaryOperands(self, UnwrapNumber(other, dtype));
   return bridge::AtenFromXlaTensor(
@@ -1222,14 +1427,14 @@ at::Tensor XLANativeFunctions::div(
 
 at::Tensor XLANativeFunctions::div(const at::Tensor& self,
                                    const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::div(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::dot(const at::Tensor& self,
                                    const at::Tensor& tensor) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK_EQ(self.dim(), 1)
       << "dot: Expected 1-D argument self, but got " << self.dim() << "-D";
   XLA_CHECK_EQ(tensor.dim(), 1)
@@ -1244,11 +1449,20 @@ at::Tensor XLANativeFunctions::dot(const at::Tensor& self,
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(tensor)));
 }
 
+at::Tensor XLANativeFunctions::dropout(const at::Tensor& input, double p,
+                                       bool train) {
+  XLA_FN_TRACE("xla::");
+  if (!train || p <= 0 || p >= 1 || !at::isFloatingType(input.scalar_type())) {
+    return at::native::dropout(input, p, train);
+  }
+  return aten_autograd_ops::DropoutAutogradFunction::apply(input, p);
+}
+
 at::Tensor XLANativeFunctions::elu(const at::Tensor& self,
                                    const at::Scalar& alpha,
                                    const at::Scalar& scale,
                                    const at::Scalar& input_scale) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::elu(bridge::GetXlaTensor(self), alpha, scale, input_scale));
 }
@@ -1256,7 +1470,7 @@ at::Tensor XLANativeFunctions::elu(const at::Tensor& self,
 at::Tensor& XLANativeFunctions::elu_(at::Tensor& self, const at::Scalar& alpha,
                                      const at::Scalar& scale,
                                      const at::Scalar& input_scale) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::elu_(self_tensor, alpha, scale, input_scale);
   return self;
@@ -1268,7 +1482,7 @@ at::Tensor XLANativeFunctions::elu_backward(const at::Tensor& grad_output,
                                             const at::Scalar& input_scale,
                                             bool self,
                                             const at::Tensor& self_or_result) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK(!self || alpha.to<double>() >= 0.0)
       << "In-place elu backward calculation is triggered with a negative slope "
          "which is not supported.";
@@ -1281,7 +1495,7 @@ at::Tensor XLANativeFunctions::embedding(const at::Tensor& weight,
                                          const at::Tensor& indices,
                                          int64_t padding_idx,
                                          bool scale_grad_by_freq, bool sparse) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // TODO: for now route to native, which dispatches supported XLA operations.
   // We need to make use of the TPU embedding core here eventually.
   return at::native::embedding(weight, indices, padding_idx, scale_grad_by_freq,
@@ -1291,7 +1505,7 @@ at::Tensor XLANativeFunctions::embedding(const at::Tensor& weight,
 at::Tensor XLANativeFunctions::embedding_dense_backward(
     const at::Tensor& grad_output, const at::Tensor& indices,
     int64_t num_weights, int64_t padding_idx, bool scale_grad_by_freq) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::embedding_dense_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(indices),
       num_weights, padding_idx, scale_grad_by_freq));
@@ -1302,7 +1516,7 @@ at::Tensor XLANativeFunctions::empty(
     c10::optional<at::Layout> layout, c10::optional<at::Device> device,
     c10::optional<bool> pin_memory,
     c10::optional<at::MemoryFormat> /* memory_format */) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // PT empty*() are optimizations to avoid initializing the data when it is
   // known it will be completely rewritten. But since for us doing a zero*()
   // does not actually end up doing any memory initialization, we use that and
@@ -1327,7 +1541,7 @@ at::Tensor XLANativeFunctions::empty_strided(
     at::IntArrayRef size, at::IntArrayRef stride,
     c10::optional<at::ScalarType> dtype, c10::optional<at::Layout> layout,
     c10::optional<at::Device> device, c10::optional<bool> pin_memory) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   at::Tensor t = empty(size, dtype, layout, device, pin_memory, c10::nullopt);
   return torch_xla::XLANativeFunctions::as_strided(t, size, stride,
                                                    /*storage_offset=*/0);
@@ -1335,28 +1549,28 @@ at::Tensor XLANativeFunctions::empty_strided(
 
 at::Tensor XLANativeFunctions::eq(const at::Tensor& self,
                                   const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::eq(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::eq(const at::Tensor& self,
                                   const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::eq(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor XLANativeFunctions::expand(const at::Tensor& self,
                                       at::IntArrayRef size, bool implicit) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::expand(
       bridge::GetXlaTensor(self), torch::lazy::ToVector<int64_t>(size)));
 }
 
 at::Tensor& XLANativeFunctions::exponential_(
     at::Tensor& self, double lambd, c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP(exponential_)>::call(self,
@@ -1370,14 +1584,14 @@ at::Tensor& XLANativeFunctions::exponential_(
 }
 
 at::Tensor& XLANativeFunctions::eye_out(int64_t n, at::Tensor& out) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr out_tensor = bridge::GetXlaTensor(out);
   XLATensor::eye_out(out_tensor, n, n);
   return out;
 }
 
 at::Tensor& XLANativeFunctions::eye_out(int64_t n, int64_t m, at::Tensor& out) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr out_tensor = bridge::GetXlaTensor(out);
   XLATensor::eye_out(out_tensor, n, m);
   return out;
@@ -1385,7 +1599,7 @@ at::Tensor& XLANativeFunctions::eye_out(int64_t n, int64_t m, at::Tensor& out) {
 
 at::Tensor& XLANativeFunctions::fill_(at::Tensor& self,
                                       const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::fill_(self_tensor, value);
   return self;
@@ -1393,7 +1607,7 @@ at::Tensor& XLANativeFunctions::fill_(at::Tensor& self,
 
 at::Tensor& XLANativeFunctions::fill_(at::Tensor& self,
                                       const at::Tensor& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK_EQ(value.dim(), 0) << "fill_ only supports a 0-dimensional "
                                << "value tensor, but got tensor "
                                << "with " << value.dim() << " dimension(s).";
@@ -1402,14 +1616,14 @@ at::Tensor& XLANativeFunctions::fill_(at::Tensor& self,
 
 at::Tensor XLANativeFunctions::flip(const at::Tensor& self,
                                     at::IntArrayRef dims) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::flip(bridge::GetXlaTensor(self), XlaHelpers::I64List(dims)));
 }
 
 at::Tensor XLANativeFunctions::fmod(const at::Tensor& self,
                                     const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const XLATensorPtr& xother,
                         at::ScalarType dtype) {
@@ -1419,7 +1633,7 @@ at::Tensor XLANativeFunctions::fmod(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::fmod(const at::Tensor& self,
                                     const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const at::Scalar& other,
                         at::ScalarType dtype) {
@@ -1428,35 +1642,35 @@ at::Tensor XLANativeFunctions::fmod(const at::Tensor& self,
 }
 
 at::Tensor XLANativeFunctions::frac(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::frac(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor XLANativeFunctions::gather(const at::Tensor& self, int64_t dim,
                                       const at::Tensor& index,
                                       bool /* sparse_grad */) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::gather(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index)));
 }
 
 at::Tensor XLANativeFunctions::ge(const at::Tensor& self,
                                   const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::ge(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::ge(const at::Tensor& self,
                                   const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::ge(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor XLANativeFunctions::gelu(const at::Tensor& self,
                                     c10::string_view approximate) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::gelu(bridge::GetXlaTensor(self), approximate));
 }
@@ -1464,35 +1678,35 @@ at::Tensor XLANativeFunctions::gelu(const at::Tensor& self,
 at::Tensor XLANativeFunctions::gelu_backward(const at::Tensor& grad,
                                              const at::Tensor& self,
                                              c10::string_view approximate) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::gelu_backward(
       bridge::GetXlaTensor(grad), bridge::GetXlaTensor(self), approximate));
 }
 
 at::Tensor XLANativeFunctions::ger(const at::Tensor& self,
                                    const at::Tensor& vec2) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::ger(bridge::GetXlaTensor(self), bridge::GetXlaTensor(vec2)));
 }
 
 at::Tensor XLANativeFunctions::gt(const at::Tensor& self,
                                   const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::gt(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::gt(const at::Tensor& self,
                                   const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::gt(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor XLANativeFunctions::hardshrink(const at::Tensor& self,
                                           const at::Scalar& lambda) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::hardshrink(bridge::GetXlaTensor(self), lambda));
 }
@@ -1500,7 +1714,7 @@ at::Tensor XLANativeFunctions::hardshrink(const at::Tensor& self,
 at::Tensor XLANativeFunctions::hardshrink_backward(const at::Tensor& grad_out,
                                                    const at::Tensor& self,
                                                    const at::Scalar& lambda) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::hardshrink_backward(
       bridge::GetXlaTensor(grad_out), bridge::GetXlaTensor(self), lambda));
 }
@@ -1508,7 +1722,7 @@ at::Tensor XLANativeFunctions::hardshrink_backward(const at::Tensor& grad_out,
 at::Tensor XLANativeFunctions::hardtanh(const at::Tensor& self,
                                         const at::Scalar& min_val,
                                         const at::Scalar& max_val) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::clamp(bridge::GetXlaTensor(self), min_val, max_val));
 }
@@ -1517,7 +1731,7 @@ at::Tensor XLANativeFunctions::hardtanh_backward(const at::Tensor& grad_output,
                                                  const at::Tensor& self,
                                                  const at::Scalar& min_val,
                                                  const at::Scalar& max_val) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::hardtanh_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self), min_val,
       max_val));
@@ -1526,7 +1740,7 @@ at::Tensor XLANativeFunctions::hardtanh_backward(const at::Tensor& grad_output,
 at::Tensor XLANativeFunctions::index(
     const at::Tensor& self,
     const c10::List<c10::optional<at::Tensor>>& indices) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   bool indices_on_cpu_or_xla =
       std::all_of(indices.begin(), indices.end(),
                   [=](const c10::optional<at::Tensor>& opt) {
@@ -1556,7 +1770,7 @@ at::Tensor XLANativeFunctions::index_add(const at::Tensor& self, int64_t dim,
                                          const at::Tensor& index,
                                          const at::Tensor& source,
                                          const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::index_add(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index),
       bridge::GetXlaTensor(source), alpha));
@@ -1565,7 +1779,7 @@ at::Tensor XLANativeFunctions::index_add(const at::Tensor& self, int64_t dim,
 at::Tensor XLANativeFunctions::index_copy(const at::Tensor& self, int64_t dim,
                                           const at::Tensor& index,
                                           const at::Tensor& source) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(
       XLATensor::index_copy(self_tensor, dim, bridge::GetXlaTensor(index),
@@ -1575,7 +1789,7 @@ at::Tensor XLANativeFunctions::index_copy(const at::Tensor& self, int64_t dim,
 at::Tensor& XLANativeFunctions::index_fill_(at::Tensor& self, int64_t dim,
                                             const at::Tensor& index,
                                             const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::index_fill_(self_tensor, dim, bridge::GetXlaTensor(index), value);
   return self;
@@ -1584,7 +1798,7 @@ at::Tensor& XLANativeFunctions::index_fill_(at::Tensor& self, int64_t dim,
 at::Tensor& XLANativeFunctions::index_fill_(at::Tensor& self, int64_t dim,
                                             const at::Tensor& index,
                                             const at::Tensor& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::index_fill_(self_tensor, dim, bridge::GetXlaTensor(index),
                          bridge::GetXlaTensor(value));
@@ -1594,7 +1808,7 @@ at::Tensor& XLANativeFunctions::index_fill_(at::Tensor& self, int64_t dim,
 at::Tensor& XLANativeFunctions::index_put_(
     at::Tensor& self, const c10::List<c10::optional<at::Tensor>>& indices,
     const at::Tensor& values, bool accumulate) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK(self.scalar_type() == values.scalar_type());
   CanonicalIndexInfo canonical_index_info =
       GetCanonicalIndexInfo(self, indices);
@@ -1617,7 +1831,7 @@ at::Tensor& XLANativeFunctions::index_put_(
 
 at::Tensor XLANativeFunctions::index_select(const at::Tensor& self, int64_t dim,
                                             const at::Tensor& index) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::index_select(
       bridge::GetXlaTensor(self), dim, bridge::GetXlaTensor(index)));
 }
@@ -1625,13 +1839,13 @@ at::Tensor XLANativeFunctions::index_select(const at::Tensor& self, int64_t dim,
 at::Tensor XLANativeFunctions::kl_div(const at::Tensor& self,
                                       const at::Tensor& target,
                                       int64_t reduction, bool log_target) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return at::native::kl_div(self, target, reduction, log_target);
 }
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::kthvalue(
     const at::Tensor& self, int64_t k, int64_t dim, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto results =
       XLATensor::kthvalue(bridge::GetXlaTensor(self), k, dim, keepdim);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
@@ -1640,21 +1854,21 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::kthvalue(
 
 at::Tensor XLANativeFunctions::le(const at::Tensor& self,
                                   const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::le(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::le(const at::Tensor& self,
                                   const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::le(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor XLANativeFunctions::leaky_relu(const at::Tensor& self,
                                           const at::Scalar& negative_slope) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::leaky_relu(
       bridge::GetXlaTensor(self), negative_slope.to<double>()));
 }
@@ -1662,7 +1876,7 @@ at::Tensor XLANativeFunctions::leaky_relu(const at::Tensor& self,
 at::Tensor XLANativeFunctions::leaky_relu_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Scalar& negative_slope, bool self_is_result) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK(!self_is_result || negative_slope.to<double>() >= 0.0);
   return bridge::AtenFromXlaTensor(XLATensor::leaky_relu_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
@@ -1672,7 +1886,7 @@ at::Tensor XLANativeFunctions::leaky_relu_backward(
 at::Tensor XLANativeFunctions::lerp(const at::Tensor& self,
                                     const at::Tensor& end,
                                     const at::Tensor& weight) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK_EQ(self.dtype(), end.dtype())
       << "expected dtype " << self.dtype() << " for `end` but got dtype "
       << end.dtype();
@@ -1687,7 +1901,7 @@ at::Tensor XLANativeFunctions::lerp(const at::Tensor& self,
 at::Tensor XLANativeFunctions::lerp(const at::Tensor& self,
                                     const at::Tensor& end,
                                     const at::Scalar& weight) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK_EQ(self.dtype(), end.dtype())
       << "expected dtype " << self.dtype() << " for `end` but got dtype "
       << end.dtype();
@@ -1701,7 +1915,7 @@ at::Tensor XLANativeFunctions::linspace(const at::Scalar& start,
                                         c10::optional<at::Layout> layout,
                                         c10::optional<at::Device> device,
                                         c10::optional<bool> pin_memory) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // Fall back to CPU if layout or pin_memory are not default
   if (layout.value_or(at::Layout::Strided) != at::Layout::Strided ||
       pin_memory.value_or(false)) {
@@ -1718,31 +1932,31 @@ at::Tensor XLANativeFunctions::linspace(const at::Scalar& start,
 }
 
 at::Tensor XLANativeFunctions::log(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::log(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor XLANativeFunctions::log10(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::log_base(
       bridge::GetXlaTensor(self), torch::lazy::OpKind(at::aten::log10), 10.0));
 }
 
 at::Tensor XLANativeFunctions::log1p(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::log1p(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor XLANativeFunctions::log2(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::log_base(
       bridge::GetXlaTensor(self), torch::lazy::OpKind(at::aten::log2), 2.0));
 }
 
 at::Tensor XLANativeFunctions::logsumexp(const at::Tensor& self,
                                          at::IntArrayRef dim, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::logsumexp(
       bridge::GetXlaTensor(self), torch::lazy::ToVector<int64_t>(dim),
       /*keep_reduced_dimensions=*/keepdim));
@@ -1750,21 +1964,21 @@ at::Tensor XLANativeFunctions::logsumexp(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::xlogy(const at::Tensor& self,
                                      const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::xlogy(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor XLANativeFunctions::lt(const at::Tensor& self,
                                   const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::lt(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::lt(const at::Tensor& self,
                                   const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::lt(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
@@ -1772,7 +1986,7 @@ at::Tensor XLANativeFunctions::lt(const at::Tensor& self,
 at::Tensor& XLANativeFunctions::masked_fill_(at::Tensor& self,
                                              const at::Tensor& mask,
                                              const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::masked_fill_(self_tensor, bridge::GetXlaTensor(mask), value);
   return self;
@@ -1781,7 +1995,7 @@ at::Tensor& XLANativeFunctions::masked_fill_(at::Tensor& self,
 at::Tensor& XLANativeFunctions::masked_fill_(at::Tensor& self,
                                              const at::Tensor& mask,
                                              const at::Tensor& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK_EQ(value.dim(), 0) << "masked_fill_ only supports a 0-dimensional "
                                << "value tensor, but got tensor "
                                << "with " << value.dim() << " dimension(s).";
@@ -1791,7 +2005,7 @@ at::Tensor& XLANativeFunctions::masked_fill_(at::Tensor& self,
 at::Tensor& XLANativeFunctions::masked_scatter_(at::Tensor& self,
                                                 const at::Tensor& mask,
                                                 const at::Tensor& source) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::masked_scatter_(self_tensor, bridge::GetXlaTensor(mask),
                              bridge::GetXlaTensor(source));
@@ -1800,7 +2014,7 @@ at::Tensor& XLANativeFunctions::masked_scatter_(at::Tensor& self,
 
 at::Tensor XLANativeFunctions::masked_select(const at::Tensor& self,
                                              const at::Tensor& mask) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   // Initially make XLA handled masked_select() handling experimental, and
   // opt-in.
@@ -1814,13 +2028,13 @@ at::Tensor XLANativeFunctions::masked_select(const at::Tensor& self,
 }
 
 at::Tensor XLANativeFunctions::max(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::max(bridge::GetXlaTensor(self)));
 }
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::max(
     const at::Tensor& self, int64_t dim, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto outputs = XLATensor::max(bridge::GetXlaTensor(self), dim, keepdim);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
                          bridge::AtenFromXlaTensor(std::get<1>(outputs)));
@@ -1829,7 +2043,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::max(
 std::tuple<at::Tensor&, at::Tensor&> XLANativeFunctions::max_out(
     const at::Tensor& self, int64_t dim, bool keepdim, at::Tensor& max,
     at::Tensor& max_values) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr max_tensor = bridge::GetXlaTensor(max);
   XLATensorPtr max_values_tensor = bridge::GetXlaTensor(max_values);
   XLATensor::max_out(max_tensor, max_values_tensor, bridge::GetXlaTensor(self),
@@ -1840,7 +2054,7 @@ std::tuple<at::Tensor&, at::Tensor&> XLANativeFunctions::max_out(
 at::Tensor XLANativeFunctions::max_pool2d(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return aten_autograd_ops::MaxPool2dAutogradFunction::apply(
       self, kernel_size, stride, padding, dilation, ceil_mode);
 }
@@ -1848,7 +2062,7 @@ at::Tensor XLANativeFunctions::max_pool2d(
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::max_pool2d_with_indices(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return at::native::call_fallback_fn<
@@ -1872,7 +2086,7 @@ at::Tensor XLANativeFunctions::max_pool2d_with_indices_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode,
     const at::Tensor& indices) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return at::native::call_fallback_fn<
@@ -1891,7 +2105,7 @@ at::Tensor XLANativeFunctions::max_pool2d_with_indices_backward(
 at::Tensor XLANativeFunctions::max_pool3d(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return aten_autograd_ops::MaxPool3dAutogradFunction::apply(
       self, kernel_size, stride, padding, dilation, ceil_mode);
 }
@@ -1901,7 +2115,7 @@ at::Tensor XLANativeFunctions::max_pool3d_with_indices_backward(
     at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode,
     const at::Tensor& indices) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return at::native::call_fallback_fn<
@@ -1920,7 +2134,7 @@ at::Tensor XLANativeFunctions::max_pool3d_with_indices_backward(
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::max_pool3d_with_indices(
     const at::Tensor& self, at::IntArrayRef kernel_size, at::IntArrayRef stride,
     at::IntArrayRef padding, at::IntArrayRef dilation, bool ceil_mode) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // Lowering when ceil_mode or dilation is set not supported yet.
   if (IsNonTrivialDilation(dilation)) {
     return at::native::call_fallback_fn<
@@ -1942,7 +2156,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::max_pool3d_with_indices(
 at::Tensor XLANativeFunctions::max_unpool2d(const at::Tensor& self,
                                             const at::Tensor& indices,
                                             at::IntArrayRef output_size) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::max_unpool(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(indices),
       torch::lazy::ToVector<int64_t>(output_size)));
@@ -1953,7 +2167,7 @@ at::Tensor XLANativeFunctions::max_unpool3d(const at::Tensor& self,
                                             at::IntArrayRef output_size,
                                             at::IntArrayRef stride,
                                             at::IntArrayRef padding) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::max_unpool(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(indices),
       torch::lazy::ToVector<int64_t>(output_size)));
@@ -1961,7 +2175,7 @@ at::Tensor XLANativeFunctions::max_unpool3d(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::mean(const at::Tensor& self,
                                     c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::mean(
       self_tensor,
@@ -1972,7 +2186,7 @@ at::Tensor XLANativeFunctions::mean(const at::Tensor& self,
 at::Tensor XLANativeFunctions::mean(const at::Tensor& self,
                                     at::OptionalIntArrayRef dim, bool keepdim,
                                     c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::mean(
       self_tensor,
@@ -1982,27 +2196,27 @@ at::Tensor XLANativeFunctions::mean(const at::Tensor& self,
 }
 
 at::Tensor XLANativeFunctions::min(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::min(bridge::GetXlaTensor(self)));
 }
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::min(
     const at::Tensor& self, int64_t dim, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto outputs = XLATensor::min(bridge::GetXlaTensor(self), dim, keepdim);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
                          bridge::AtenFromXlaTensor(std::get<1>(outputs)));
 }
 
 at::Tensor XLANativeFunctions::mish(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::mish(bridge::GetXlaTensor(self)));
 }
 
 std::tuple<at::Tensor&, at::Tensor&> XLANativeFunctions::min_out(
     const at::Tensor& self, int64_t dim, bool keepdim, at::Tensor& min,
     at::Tensor& min_indices) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr min_tensor = bridge::GetXlaTensor(min);
   XLATensorPtr min_indices_tensor = bridge::GetXlaTensor(min_indices);
   XLATensor::min_out(min_tensor, min_indices_tensor, bridge::GetXlaTensor(self),
@@ -2012,7 +2226,7 @@ std::tuple<at::Tensor&, at::Tensor&> XLANativeFunctions::min_out(
 
 at::Tensor XLANativeFunctions::mm(const at::Tensor& self,
                                   const at::Tensor& mat2) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::dot doesn't support integer types.
   if (!at::native::is_floating_point(self) ||
       !at::native::is_floating_point(mat2)) {
@@ -2027,7 +2241,7 @@ at::Tensor XLANativeFunctions::mm(const at::Tensor& self,
 at::Tensor XLANativeFunctions::mse_loss(const at::Tensor& self,
                                         const at::Tensor& target,
                                         int64_t reduction) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::mse_loss(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(target), reduction));
 }
@@ -2036,7 +2250,7 @@ at::Tensor XLANativeFunctions::mse_loss_backward(const at::Tensor& grad_output,
                                                  const at::Tensor& self,
                                                  const at::Tensor& target,
                                                  int64_t reduction) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::mse_loss_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       bridge::GetXlaTensor(target), reduction));
@@ -2044,7 +2258,7 @@ at::Tensor XLANativeFunctions::mse_loss_backward(const at::Tensor& grad_output,
 
 at::Tensor XLANativeFunctions::mul(const at::Tensor& self,
                                    const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const XLATensorPtr& xother,
                         at::ScalarType dtype) {
@@ -2054,7 +2268,7 @@ at::Tensor XLANativeFunctions::mul(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::mul(const at::Tensor& self,
                                    const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const at::Scalar& other,
                         at::ScalarType dtype) {
@@ -2064,7 +2278,7 @@ at::Tensor XLANativeFunctions::mul(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::mv(const at::Tensor& self,
                                   const at::Tensor& vec) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::dot doesn't support integer types.
   if (!at::native::is_floating_point(self) ||
       !at::native::is_floating_point(vec)) {
@@ -2077,7 +2291,7 @@ at::Tensor XLANativeFunctions::mv(const at::Tensor& self,
 
 at::Tensor& XLANativeFunctions::mv_out(const at::Tensor& self,
                                        const at::Tensor& vec, at::Tensor& out) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::dot doesn't support integer types.
   if (!at::native::is_floating_point(self) ||
       !at::native::is_floating_point(vec)) {
@@ -2094,7 +2308,7 @@ at::Tensor XLANativeFunctions::nan_to_num(const at::Tensor& self,
                                           c10::optional<double> nan,
                                           c10::optional<double> posinf,
                                           c10::optional<double> neginf) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // nan_to_num doesn't apply to integer types.
   if (!at::native::is_floating_point(self)) {
     return torch::lazy::CopyTensor(self);
@@ -2125,7 +2339,7 @@ XLANativeFunctions::native_batch_norm(
     const c10::optional<at::Tensor>& running_mean,
     const c10::optional<at::Tensor>& running_var, bool training,
     double momentum, double eps) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr input_tensor = bridge::GetXlaTensor(input);
   const torch::lazy::BackendDevice& device = input_tensor->GetDevice();
   XLATensorPtr running_mean_tensor =
@@ -2150,7 +2364,7 @@ XLANativeFunctions::native_batch_norm_backward(
     const c10::optional<at::Tensor>& save_mean,
     const c10::optional<at::Tensor>& save_invstd, bool train, double eps,
     std::array<bool, 3> output_mask) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr grad_out_tensor = bridge::GetXlaTensor(grad_out);
   const torch::lazy::BackendDevice& device = grad_out_tensor->GetDevice();
   auto gradients = XLATensor::native_batch_norm_backward(
@@ -2170,20 +2384,20 @@ XLANativeFunctions::native_batch_norm_backward(
 
 at::Tensor XLANativeFunctions::ne(const at::Tensor& self,
                                   const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::ne(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::ne(const at::Tensor& self,
                                   const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::ne(bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor XLANativeFunctions::neg(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLA_CHECK(self.scalar_type() != at::kBool)
       << "Negation, the `-` operator, on a bool tensor is not supported. If "
          "you are trying to invert a mask, use the `~` or `logical_not()` "
@@ -2195,7 +2409,7 @@ at::Tensor XLANativeFunctions::nll_loss2d_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& target, const c10::optional<at::Tensor>& weight,
     int64_t reduction, int64_t ignore_index, const at::Tensor& total_weight) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensorPtr weight_tensor =
       bridge::GetOrCreateXlaTensor(weight, self_tensor->GetDevice());
@@ -2214,7 +2428,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::nll_loss2d_forward(
     const at::Tensor& self, const at::Tensor& target,
     const c10::optional<at::Tensor>& weight, int64_t reduction,
     int64_t ignore_index) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensorPtr total_weight =
       XLATensor::full({}, 1, self_tensor->GetDevice(), self_tensor->dtype());
@@ -2230,7 +2444,7 @@ at::Tensor XLANativeFunctions::nll_loss_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& target, const c10::optional<at::Tensor>& weight,
     int64_t reduction, int64_t ignore_index, const at::Tensor& total_weight) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensorPtr weight_tensor =
       bridge::GetOrCreateXlaTensor(weight, self_tensor->GetDevice());
@@ -2249,7 +2463,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::nll_loss_forward(
     const at::Tensor& self, const at::Tensor& target,
     const c10::optional<at::Tensor>& weight, int64_t reduction,
     int64_t ignore_index) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensorPtr total_weight =
       XLATensor::full({}, 1, self_tensor->GetDevice(), self_tensor->dtype());
@@ -2262,7 +2476,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::nll_loss_forward(
 }
 
 at::Tensor XLANativeFunctions::nonzero(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   // Initially make XLA handled nonzero() handling experimental, and opt-in.
   if (!DebugUtil::ExperimentEnabled("nonzero")) {
@@ -2275,7 +2489,7 @@ at::Tensor XLANativeFunctions::nonzero(const at::Tensor& self) {
 at::Tensor XLANativeFunctions::norm(const at::Tensor& self,
                                     const c10::optional<at::Scalar>& p,
                                     at::ScalarType dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.has_value() && p->toDouble() == 0) {
@@ -2289,7 +2503,7 @@ at::Tensor XLANativeFunctions::norm(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::norm(const at::Tensor& self,
                                     const at::Scalar& p) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.toDouble() == 0) {
@@ -2304,7 +2518,7 @@ at::Tensor XLANativeFunctions::norm(const at::Tensor& self,
                                     const c10::optional<at::Scalar>& p,
                                     at::IntArrayRef dim, bool keepdim,
                                     at::ScalarType dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.has_value() && p->toDouble() == 0) {
@@ -2321,7 +2535,7 @@ at::Tensor XLANativeFunctions::norm(const at::Tensor& self,
 at::Tensor XLANativeFunctions::norm(const at::Tensor& self,
                                     const c10::optional<at::Scalar>& p,
                                     at::IntArrayRef dim, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // If p==0 it is a torch.nonzero(), which is not lowered to XLA due to dynamic
   // shapes issue.
   if (p.has_value() && p->toDouble() == 0) {
@@ -2335,7 +2549,7 @@ at::Tensor XLANativeFunctions::norm(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::normal(const at::Tensor& mean, double std,
                                       c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP2(normal, Tensor_float)>::call(mean, std,
@@ -2347,7 +2561,7 @@ at::Tensor XLANativeFunctions::normal(const at::Tensor& mean, double std,
 
 at::Tensor XLANativeFunctions::normal(double mean, const at::Tensor& std,
                                       c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP2(normal, float_Tensor)>::call(mean, std,
@@ -2360,7 +2574,7 @@ at::Tensor XLANativeFunctions::normal(double mean, const at::Tensor& std,
 at::Tensor XLANativeFunctions::normal(const at::Tensor& mean,
                                       const at::Tensor& std,
                                       c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP2(normal, Tensor_Tensor)>::call(mean, std,
@@ -2373,7 +2587,7 @@ at::Tensor XLANativeFunctions::normal(const at::Tensor& mean,
 at::Tensor& XLANativeFunctions::normal_(
     at::Tensor& self, double mean, double std,
     c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP(normal_)>::call(self, mean, std,
@@ -2386,14 +2600,14 @@ at::Tensor& XLANativeFunctions::normal_(
 
 at::Tensor XLANativeFunctions::permute(const at::Tensor& self,
                                        at::IntArrayRef dims) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::permute(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(dims)));
 }
 
 at::Tensor XLANativeFunctions::pow(const at::Tensor& self,
                                    const at::Scalar& exponent) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::Pow() doesn't support integer types.
   if (!at::native::is_floating_point(self)) {
     return at::native::call_fallback_fn<
@@ -2405,7 +2619,7 @@ at::Tensor XLANativeFunctions::pow(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::pow(const at::Tensor& self,
                                    const at::Tensor& exponent) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::Pow() doesn't support integer types.
   if (!at::native::is_floating_point(self)) {
     return at::native::call_fallback_fn<
@@ -2417,7 +2631,7 @@ at::Tensor XLANativeFunctions::pow(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::pow(const at::Scalar& self,
                                    const at::Tensor& exponent) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // xla::Pow() doesn't support integer types.
   if (!self.isFloatingPoint()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
@@ -2430,7 +2644,7 @@ at::Tensor XLANativeFunctions::pow(const at::Scalar& self,
 
 at::Tensor XLANativeFunctions::prelu(const at::Tensor& self,
                                      const at::Tensor& weight) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
 
   // If multiple weights, check channel size == number of weights.
   int64_t weight_num = weight.numel();
@@ -2454,7 +2668,7 @@ at::Tensor XLANativeFunctions::prelu(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::prod(const at::Tensor& self,
                                     c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::prod(
       self_tensor,
@@ -2466,7 +2680,7 @@ at::Tensor XLANativeFunctions::prod(const at::Tensor& self,
 at::Tensor XLANativeFunctions::prod(const at::Tensor& self, int64_t dim,
                                     bool keepdim,
                                     c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::prod(bridge::GetXlaTensor(self), {dim}, keepdim,
                       PromoteIntegralType(self.scalar_type(), dtype)));
@@ -2483,7 +2697,7 @@ at::Tensor& XLANativeFunctions::put_(at::Tensor& self, const at::Tensor& index,
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::qr(
     const at::Tensor& self, bool some) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto results = XLATensor::qr(bridge::GetXlaTensor(self), some);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
                          bridge::AtenFromXlaTensor(std::get<1>(results)));
@@ -2493,7 +2707,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::qr(
 at::Tensor& XLANativeFunctions::random_(
     at::Tensor& self, int64_t from, c10::optional<int64_t> to,
     c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP2(random_, from)>::call(self, from, to,
@@ -2513,7 +2727,7 @@ at::Tensor& XLANativeFunctions::random_(
 // The value generated should be in (0, to].
 at::Tensor& XLANativeFunctions::random_(
     at::Tensor& self, int64_t to, c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP2(random_, to)>::call(self, to,
@@ -2529,7 +2743,7 @@ at::Tensor& XLANativeFunctions::random_(
 // The value generated should be in (self_type_min, self_type_max).
 at::Tensor& XLANativeFunctions::random_(
     at::Tensor& self, c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP(random_)>::call(self,
@@ -2545,7 +2759,7 @@ at::Tensor& XLANativeFunctions::random_(
 
 at::Tensor XLANativeFunctions::reflection_pad2d(const at::Tensor& self,
                                                 at::IntArrayRef padding) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::reflection_pad2d(
       bridge::GetXlaTensor(self), torch::lazy::ToVector<int64_t>(padding)));
 }
@@ -2553,19 +2767,19 @@ at::Tensor XLANativeFunctions::reflection_pad2d(const at::Tensor& self,
 at::Tensor XLANativeFunctions::reflection_pad2d_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     at::IntArrayRef padding) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::reflection_pad2d_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       torch::lazy::ToVector<int64_t>(padding)));
 }
 
 at::Tensor XLANativeFunctions::relu(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::relu(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor& XLANativeFunctions::relu_(at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::relu_(self_tensor);
   return self;
@@ -2573,28 +2787,28 @@ at::Tensor& XLANativeFunctions::relu_(at::Tensor& self) {
 
 at::Tensor XLANativeFunctions::remainder(const at::Tensor& self,
                                          const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::remainder(
       bridge::GetXlaTensor(self), bridge::GetXlaTensor(other)));
 }
 
 at::Tensor XLANativeFunctions::remainder(const at::Tensor& self,
                                          const at::Scalar& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::remainder(bridge::GetXlaTensor(self), other));
 }
 
 at::Tensor XLANativeFunctions::repeat(const at::Tensor& self,
                                       at::IntArrayRef repeats) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::repeat(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(repeats)));
 }
 
 at::Tensor XLANativeFunctions::replication_pad1d(const at::Tensor& self,
                                                  at::IntArrayRef padding) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::replication_pad1d(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(padding)));
 }
@@ -2602,7 +2816,7 @@ at::Tensor XLANativeFunctions::replication_pad1d(const at::Tensor& self,
 at::Tensor XLANativeFunctions::replication_pad1d_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     at::IntArrayRef padding) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::replication_pad1d_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       XlaHelpers::I64List(padding)));
@@ -2610,7 +2824,7 @@ at::Tensor XLANativeFunctions::replication_pad1d_backward(
 
 at::Tensor XLANativeFunctions::replication_pad2d(const at::Tensor& self,
                                                  at::IntArrayRef padding) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::replication_pad2d(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(padding)));
 }
@@ -2618,7 +2832,7 @@ at::Tensor XLANativeFunctions::replication_pad2d(const at::Tensor& self,
 at::Tensor XLANativeFunctions::replication_pad2d_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     at::IntArrayRef padding) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::replication_pad2d_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       XlaHelpers::I64List(padding)));
@@ -2627,7 +2841,7 @@ at::Tensor XLANativeFunctions::replication_pad2d_backward(
 const at::Tensor& XLANativeFunctions::resize_(
     const at::Tensor& self, at::IntArrayRef size,
     c10::optional<at::MemoryFormat> /* memory_format */) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::resize_(self_tensor, XlaHelpers::I64List(size));
   return self;
@@ -2636,7 +2850,7 @@ const at::Tensor& XLANativeFunctions::resize_(
 at::Tensor XLANativeFunctions::roll(const at::Tensor& self,
                                     at::IntArrayRef shifts,
                                     at::IntArrayRef dims) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::roll(bridge::GetXlaTensor(self),
                                                    XlaHelpers::I64List(shifts),
                                                    XlaHelpers::I64List(dims)));
@@ -2646,7 +2860,7 @@ at::Tensor XLANativeFunctions::rrelu_with_noise(
     const at::Tensor& self, const at::Tensor& noise, const at::Scalar& lower,
     const at::Scalar& upper, bool training,
     c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     // The fallback path for rrelu_with_noise when training=true is wrong
     XLA_CHECK_EQ(training, false);
@@ -2664,7 +2878,7 @@ at::Tensor XLANativeFunctions::rrelu_with_noise_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& noise, const at::Scalar& lower, const at::Scalar& upper,
     bool training, bool self_is_result) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   double negative_slope = (lower.to<double>() + upper.to<double>()) / 2;
   XLA_CHECK(!self_is_result || negative_slope > 0.0);
   XLATensorPtr noise_tensor = bridge::GetXlaTensor(noise);
@@ -2676,7 +2890,7 @@ at::Tensor XLANativeFunctions::rrelu_with_noise_backward(
 at::Tensor XLANativeFunctions::rsub(const at::Tensor& self,
                                     const at::Tensor& other,
                                     const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckSubOperandTypes(self.scalar_type(), other.scalar_type());
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const XLATensorPtr& xother,
@@ -2688,7 +2902,7 @@ at::Tensor XLANativeFunctions::rsub(const at::Tensor& self,
 at::Tensor XLANativeFunctions::rsub(const at::Tensor& self,
                                     const at::Scalar& other,
                                     const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckSubOperandTypes(self.scalar_type(), GetScalarType(other));
   return bridge::AtenFromXlaTensor(
       XLATensor::rsub(bridge::GetXlaTensor(self), other, alpha));
@@ -2718,7 +2932,7 @@ at::Tensor scatter_reduce_helper(const at::Tensor& self, int64_t dim,
                                  const at::Tensor& index,
                                  const at::Scalar& value,
                                  c10::optional<c10::string_view> reduce) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   if (!reduce.has_value()) {
     return bridge::AtenFromXlaTensor(XLATensor::scatter(
@@ -2738,14 +2952,14 @@ at::Tensor scatter_reduce_helper(const at::Tensor& self, int64_t dim,
 at::Tensor XLANativeFunctions::scatter(const at::Tensor& self, int64_t dim,
                                        const at::Tensor& index,
                                        const at::Tensor& src) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return scatter_reduce_helper(self, dim, index, src, c10::nullopt);
 }
 
 at::Tensor XLANativeFunctions::scatter(const at::Tensor& self, int64_t dim,
                                        const at::Tensor& index,
                                        const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return scatter_reduce_helper(self, dim, index, value, c10::nullopt);
 }
 
@@ -2753,7 +2967,7 @@ at::Tensor XLANativeFunctions::scatter(const at::Tensor& self, int64_t dim,
                                        const at::Tensor& index,
                                        const at::Tensor& src,
                                        c10::string_view reduce) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return scatter_reduce_helper(self, dim, index, src, reduce);
 }
 
@@ -2761,41 +2975,35 @@ at::Tensor XLANativeFunctions::scatter(const at::Tensor& self, int64_t dim,
                                        const at::Tensor& index,
                                        const at::Scalar& value,
                                        c10::string_view reduce) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return scatter_reduce_helper(self, dim, index, value, reduce);
 }
 
 at::Tensor XLANativeFunctions::scatter_add(const at::Tensor& self, int64_t dim,
                                            const at::Tensor& index,
                                            const at::Tensor& src) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return scatter_reduce_helper(self, dim, index, src, "add");
 }
 
 at::Tensor XLANativeFunctions::select(const at::Tensor& self, int64_t dim,
                                       int64_t index) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::select(bridge::GetXlaTensor(self), dim, index));
 }
 
 // TODO(JackCaoG): Remove after elu being codegened
 at::Tensor& XLANativeFunctions::selu_(at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::selu_(self_tensor);
   return self;
 }
 
-at::Tensor XLANativeFunctions::sigmoid(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
-  return bridge::AtenFromXlaTensor(
-      XLATensor::sigmoid(bridge::GetXlaTensor(self)));
-}
-
 at::Tensor XLANativeFunctions::sigmoid_backward(const at::Tensor& grad_output,
                                                 const at::Tensor& output) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::sigmoid_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output)));
 }
@@ -2803,7 +3011,7 @@ at::Tensor XLANativeFunctions::sigmoid_backward(const at::Tensor& grad_output,
 at::Tensor XLANativeFunctions::slice(const at::Tensor& self, int64_t dim,
                                      c10::optional<int64_t> start,
                                      c10::optional<int64_t> end, int64_t step) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   int64_t start_val = start.has_value() ? start.value() : 0;
   int64_t end_val = end.has_value() ? end.value() : INT64_MAX;
   return bridge::AtenFromXlaTensor(XLATensor::slice(
@@ -2812,7 +3020,7 @@ at::Tensor XLANativeFunctions::slice(const at::Tensor& self, int64_t dim,
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::slogdet(
     const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   auto outputs = XLATensor::slogdet(self_tensor);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(outputs)),
@@ -2822,7 +3030,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::slogdet(
 at::Tensor XLANativeFunctions::smooth_l1_loss(const at::Tensor& self,
                                               const at::Tensor& target,
                                               int64_t reduction, double beta) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::smooth_l1_loss(bridge::GetXlaTensor(self),
                                 bridge::GetXlaTensor(target), reduction, beta));
@@ -2831,7 +3039,7 @@ at::Tensor XLANativeFunctions::smooth_l1_loss(const at::Tensor& self,
 at::Tensor XLANativeFunctions::smooth_l1_loss_backward(
     const at::Tensor& grad_output, const at::Tensor& self,
     const at::Tensor& target, int64_t reduction, double beta) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::smooth_l1_loss_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       bridge::GetXlaTensor(target), reduction, beta));
@@ -2840,7 +3048,7 @@ at::Tensor XLANativeFunctions::smooth_l1_loss_backward(
 at::Tensor XLANativeFunctions::softplus(const at::Tensor& self,
                                         const at::Scalar& beta,
                                         const at::Scalar& threshold) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::softplus(bridge::GetXlaTensor(self), beta, threshold));
 }
@@ -2849,7 +3057,7 @@ at::Tensor XLANativeFunctions::softplus_backward(const at::Tensor& grad_output,
                                                  const at::Tensor& self,
                                                  const at::Scalar& beta,
                                                  const at::Scalar& threshold) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::softplus_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self), beta,
       threshold));
@@ -2857,7 +3065,7 @@ at::Tensor XLANativeFunctions::softplus_backward(const at::Tensor& grad_output,
 
 at::Tensor XLANativeFunctions::softshrink(const at::Tensor& self,
                                           const at::Scalar& lambda) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::softshrink(bridge::GetXlaTensor(self), lambda));
 }
@@ -2865,14 +3073,14 @@ at::Tensor XLANativeFunctions::softshrink(const at::Tensor& self,
 at::Tensor XLANativeFunctions::softshrink_backward(const at::Tensor& grad_out,
                                                    const at::Tensor& self,
                                                    const at::Scalar& lambda) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::softshrink_backward(
       bridge::GetXlaTensor(grad_out), bridge::GetXlaTensor(self), lambda));
 }
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::sort(
     const at::Tensor& self, int64_t dim, bool descending) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto results =
       XLATensor::topk(bridge::GetXlaTensor(self), self.size(dim), dim,
                       descending, /*sorted=*/true, /*stable=*/false);
@@ -2883,7 +3091,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::sort(
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::sort(
     const at::Tensor& self, c10::optional<bool> stable, int64_t dim,
     bool descending) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto results =
       XLATensor::topk(bridge::GetXlaTensor(self), self.size(dim), dim,
                       descending, /*sorted=*/false,
@@ -2895,7 +3103,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::sort(
 std::vector<at::Tensor> XLANativeFunctions::split(const at::Tensor& self,
                                                   int64_t split_size,
                                                   int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto xla_tensors =
       XLATensor::split(bridge::GetXlaTensor(self), split_size, dim);
   return bridge::AtenFromXlaTensors(xla_tensors);
@@ -2903,51 +3111,46 @@ std::vector<at::Tensor> XLANativeFunctions::split(const at::Tensor& self,
 
 std::vector<at::Tensor> XLANativeFunctions::split_with_sizes(
     const at::Tensor& self, at::IntArrayRef split_sizes, int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto xla_tensors = XLATensor::split_with_sizes(
       bridge::GetXlaTensor(self), XlaHelpers::I64List(split_sizes), dim);
   return bridge::AtenFromXlaTensors(xla_tensors);
 }
 
-at::Tensor XLANativeFunctions::sqrt(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
-  return bridge::AtenFromXlaTensor(XLATensor::sqrt(bridge::GetXlaTensor(self)));
-}
-
 at::Tensor XLANativeFunctions::squeeze(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::squeeze(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor XLANativeFunctions::squeeze(const at::Tensor& self, int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::squeeze(bridge::GetXlaTensor(self), dim));
 }
 
 at::Tensor& XLANativeFunctions::squeeze_(at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::squeeze_(self_tensor);
   return self;
 }
 
 at::Tensor& XLANativeFunctions::squeeze_(at::Tensor& self, int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::squeeze_(self_tensor, dim);
   return self;
 }
 
 at::Tensor XLANativeFunctions::stack(at::TensorList tensors, int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::stack(bridge::GetXlaTensors(tensors), dim));
 }
 
 at::Tensor XLANativeFunctions::std(const at::Tensor& self, bool unbiased) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::std(
       self_tensor,
@@ -2957,7 +3160,7 @@ at::Tensor XLANativeFunctions::std(const at::Tensor& self, bool unbiased) {
 
 at::Tensor XLANativeFunctions::std(const at::Tensor& self, at::IntArrayRef dim,
                                    bool unbiased, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::std(
       bridge::GetXlaTensor(self), torch::lazy::ToVector<int64_t>(dim), keepdim,
       /*correction=*/unbiased ? 1 : 0));
@@ -2967,7 +3170,7 @@ at::Tensor XLANativeFunctions::std(const at::Tensor& self,
                                    at::OptionalIntArrayRef dim,
                                    c10::optional<int64_t> correction,
                                    bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::std(
       self_tensor,
@@ -2979,7 +3182,7 @@ at::Tensor XLANativeFunctions::std(const at::Tensor& self,
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::std_mean(
     const at::Tensor& self, at::OptionalIntArrayRef dim,
     c10::optional<int64_t> correction, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   auto results = XLATensor::std_mean(
       self_tensor,
@@ -2993,7 +3196,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::std_mean(
 at::Tensor XLANativeFunctions::sub(const at::Tensor& self,
                                    const at::Tensor& other,
                                    const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckSubOperandTypes(self.scalar_type(), other.scalar_type());
   at::native::alpha_check(at::result_type(self, other), alpha);
   return DoBinaryOp(self, other,
@@ -3006,7 +3209,7 @@ at::Tensor XLANativeFunctions::sub(const at::Tensor& self,
 at::Tensor XLANativeFunctions::sub(const at::Tensor& self,
                                    const at::Scalar& other,
                                    const at::Scalar& alpha) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   CheckSubOperandTypes(self.scalar_type(), GetScalarType(other));
   return DoBinaryOp(self, other,
                     [&](const XLATensorPtr& xself, const at::Scalar& other,
@@ -3017,7 +3220,7 @@ at::Tensor XLANativeFunctions::sub(const at::Tensor& self,
 
 at::Tensor XLANativeFunctions::sum(const at::Tensor& self,
                                    c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::sum(
       self_tensor,
@@ -3028,7 +3231,7 @@ at::Tensor XLANativeFunctions::sum(const at::Tensor& self,
 at::Tensor XLANativeFunctions::sum(const at::Tensor& self,
                                    at::OptionalIntArrayRef dim, bool keepdim,
                                    c10::optional<at::ScalarType> dtype) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::sum(
       self_tensor,
@@ -3039,7 +3242,7 @@ at::Tensor XLANativeFunctions::sum(const at::Tensor& self,
 
 std::tuple<at::Tensor, at::Tensor, at::Tensor> XLANativeFunctions::svd(
     const at::Tensor& self, bool some, bool compute_uv) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto results = XLATensor::svd(bridge::GetXlaTensor(self), some, compute_uv);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
                          bridge::AtenFromXlaTensor(std::get<1>(results)),
@@ -3048,7 +3251,7 @@ std::tuple<at::Tensor, at::Tensor, at::Tensor> XLANativeFunctions::svd(
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::symeig(
     const at::Tensor& self, bool eigenvectors, bool upper) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto results =
       XLATensor::symeig(bridge::GetXlaTensor(self), eigenvectors, upper);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
@@ -3056,13 +3259,13 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::symeig(
 }
 
 at::Tensor XLANativeFunctions::t(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::transpose(bridge::GetXlaTensor(self), 0, 1));
 }
 
 at::Tensor& XLANativeFunctions::t_(at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::transpose_(self_tensor, 0, 1);
   return self;
@@ -3070,14 +3273,14 @@ at::Tensor& XLANativeFunctions::t_(at::Tensor& self) {
 
 at::Tensor XLANativeFunctions::take(const at::Tensor& self,
                                     const at::Tensor& index) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::take(bridge::GetXlaTensor(self), bridge::GetXlaTensor(index)));
 }
 
 at::Tensor XLANativeFunctions::tanh_backward(const at::Tensor& grad_output,
                                              const at::Tensor& output) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::tanh_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(output)));
 }
@@ -3085,7 +3288,7 @@ at::Tensor XLANativeFunctions::tanh_backward(const at::Tensor& grad_output,
 at::Tensor XLANativeFunctions::threshold(const at::Tensor& self,
                                          const at::Scalar& threshold,
                                          const at::Scalar& value) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::threshold(
       bridge::GetXlaTensor(self), threshold.to<double>(), value.to<double>()));
 }
@@ -3093,7 +3296,7 @@ at::Tensor XLANativeFunctions::threshold(const at::Tensor& self,
 at::Tensor XLANativeFunctions::threshold_backward(const at::Tensor& grad_output,
                                                   const at::Tensor& self,
                                                   const at::Scalar& threshold) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(XLATensor::threshold_backward(
       bridge::GetXlaTensor(grad_output), bridge::GetXlaTensor(self),
       threshold.to<double>()));
@@ -3101,7 +3304,7 @@ at::Tensor XLANativeFunctions::threshold_backward(const at::Tensor& grad_output,
 
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::topk(
     const at::Tensor& self, int64_t k, int64_t dim, bool largest, bool sorted) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   auto results = XLATensor::topk(bridge::GetXlaTensor(self), k, dim, largest,
                                  sorted, /*stable=*/false);
   return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
@@ -3109,21 +3312,21 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::topk(
 }
 
 at::Tensor XLANativeFunctions::trace(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::trace(bridge::GetXlaTensor(self)));
 }
 
 at::Tensor XLANativeFunctions::transpose(const at::Tensor& self, int64_t dim0,
                                          int64_t dim1) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::transpose(bridge::GetXlaTensor(self), dim0, dim1));
 }
 
 at::Tensor& XLANativeFunctions::transpose_(at::Tensor& self, int64_t dim0,
                                            int64_t dim1) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::transpose_(self_tensor, dim0, dim1);
   return self;
@@ -3132,7 +3335,7 @@ at::Tensor& XLANativeFunctions::transpose_(at::Tensor& self, int64_t dim0,
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::triangular_solve(
     const at::Tensor& b, const at::Tensor& A, bool upper, bool transpose,
     bool unitriangular) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   // Currently, ATen doesn't have a left_side option. Once this
   // is added, this API will have to be changed.
   auto results = XLATensor::triangular_solve(
@@ -3143,14 +3346,14 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::triangular_solve(
 }
 
 at::Tensor XLANativeFunctions::trunc(const at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::trunc(bridge::GetXlaTensor(self)));
 }
 
 std::vector<at::Tensor> XLANativeFunctions::unbind(const at::Tensor& self,
                                                    int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensors(
       XLATensor::unbind(bridge::GetXlaTensor(self), dim));
 }
@@ -3158,7 +3361,7 @@ std::vector<at::Tensor> XLANativeFunctions::unbind(const at::Tensor& self,
 at::Tensor& XLANativeFunctions::uniform_(
     at::Tensor& self, double from, double to,
     c10::optional<at::Generator> generator) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   if (generator.has_value() && generator->defined()) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP(uniform_)>::call(self, from, to,
@@ -3170,13 +3373,13 @@ at::Tensor& XLANativeFunctions::uniform_(
 }
 
 at::Tensor XLANativeFunctions::unsqueeze(const at::Tensor& self, int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::unsqueeze(bridge::GetXlaTensor(self), dim));
 }
 
 at::Tensor& XLANativeFunctions::unsqueeze_(at::Tensor& self, int64_t dim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::unsqueeze_(self_tensor, dim);
   return self;
@@ -3185,13 +3388,13 @@ at::Tensor& XLANativeFunctions::unsqueeze_(at::Tensor& self, int64_t dim) {
 at::Tensor XLANativeFunctions::upsample_bilinear2d(
     const at::Tensor& self, at::IntArrayRef output_size, bool align_corners,
     c10::optional<double> scales_h, c10::optional<double> scales_w) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
-  // Only the XLA TPU backend for now implements the CustomCall required by
-  // our XLA lowering.
+  // Without the matmul lowering, only the XLA TPU backend implements the
+  // CustomCall required by our XLA lowering.
   XlaDeviceType hw_type =
       static_cast<XlaDeviceType>(self_tensor->GetDevice().type());
-  if (hw_type != XlaDeviceType::TPU || (scales_h && *scales_h != 1.0) ||
+  if (!resize::IsSupported(hw_type) || (scales_h && *scales_h != 1.0) ||
       (scales_w && *scales_w != 1.0)) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP(upsample_bilinear2d)>::call(self,
@@ -3208,13 +3411,13 @@ at::Tensor XLANativeFunctions::upsample_bilinear2d_backward(
     const at::Tensor& grad_output, at::IntArrayRef output_size,
     at::IntArrayRef input_size, bool align_corners,
     c10::optional<double> scales_h, c10::optional<double> scales_w) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr grad_output_tensor = bridge::GetXlaTensor(grad_output);
-  // Only the XLA TPU backend for now implements the CustomCall required by
-  // our XLA lowering.
+  // Without the matmul lowering, only the XLA TPU backend implements the
+  // CustomCall required by our XLA lowering.
   XlaDeviceType hw_type =
       static_cast<XlaDeviceType>(grad_output_tensor->GetDevice().type());
-  if (hw_type != XlaDeviceType::TPU || (scales_h && *scales_h != 1.0) ||
+  if (!resize::IsSupported(hw_type) || (scales_h && *scales_h != 1.0) ||
       (scales_w && *scales_w != 1.0)) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback,
@@ -3230,13 +3433,13 @@ at::Tensor XLANativeFunctions::upsample_bilinear2d_backward(
 at::Tensor XLANativeFunctions::upsample_nearest2d(
     const at::Tensor& input, at::OptionalIntArrayRef output_size,
     c10::optional<at::ArrayRef<double>> scale_factors) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr input_tensor = bridge::GetXlaTensor(input);
-  // Only the XLA TPU backend for now implements the CustomCall required by our
-  // XLA lowering.
+  // Without the matmul lowering, only the XLA TPU backend implements the
+  // CustomCall required by our XLA lowering.
   XlaDeviceType hw_type =
       static_cast<XlaDeviceType>(input_tensor->GetDevice().type());
-  if (hw_type != XlaDeviceType::TPU) {
+  if (!resize::IsSupported(hw_type)) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP2(upsample_nearest2d,
                                                  vec)>::call(input, output_size,
@@ -3253,13 +3456,13 @@ at::Tensor XLANativeFunctions::upsample_nearest2d_backward(
     const at::Tensor& grad_output, at::OptionalIntArrayRef output_size,
     at::IntArrayRef input_size,
     c10::optional<at::ArrayRef<double>> scale_factors) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr grad_output_tensor = bridge::GetXlaTensor(grad_output);
-  // Only the XLA TPU backend for now implements the CustomCall required by our
-  // XLA lowering.
+  // Without the matmul lowering, only the XLA TPU backend implements the
+  // CustomCall required by our XLA lowering.
   XlaDeviceType hw_type =
       static_cast<XlaDeviceType>(grad_output_tensor->GetDevice().type());
-  if (hw_type != XlaDeviceType::TPU) {
+  if (!resize::IsSupported(hw_type)) {
     return at::native::call_fallback_fn<&xla_cpu_fallback,
                                         ATEN_OP2(upsample_nearest2d_backward,
                                                  vec)>::call(grad_output,
@@ -3277,13 +3480,13 @@ at::Tensor XLANativeFunctions::upsample_nearest2d_backward(
 at::Tensor XLANativeFunctions::upsample_nearest2d(
     const at::Tensor& self, at::IntArrayRef output_size,
     c10::optional<double> scales_h, c10::optional<double> scales_w) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
-  // Only the XLA TPU backend for now implements the CustomCall required by
-  // our XLA lowering.
+  // Without the matmul lowering, only the XLA TPU backend implements the
+  // CustomCall required by our XLA lowering.
   XlaDeviceType hw_type =
       static_cast<XlaDeviceType>(self_tensor->GetDevice().type());
-  if (hw_type != XlaDeviceType::TPU || (scales_h && *scales_h != 1.0) ||
+  if (!resize::IsSupported(hw_type) || (scales_h && *scales_h != 1.0) ||
       (scales_w && *scales_w != 1.0)) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback, ATEN_OP(upsample_nearest2d)>::call(self, output_size,
@@ -3298,13 +3501,13 @@ at::Tensor XLANativeFunctions::upsample_nearest2d_backward(
     const at::Tensor& grad_output, at::IntArrayRef output_size,
     at::IntArrayRef input_size, c10::optional<double> scales_h,
     c10::optional<double> scales_w) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr grad_output_tensor = bridge::GetXlaTensor(grad_output);
-  // Only the XLA TPU backend for now implements the CustomCall required by
-  // our XLA lowering.
+  // Without the matmul lowering, only the XLA TPU backend implements the
+  // CustomCall required by our XLA lowering.
   XlaDeviceType hw_type =
       static_cast<XlaDeviceType>(grad_output_tensor->GetDevice().type());
-  if (hw_type != XlaDeviceType::TPU || (scales_h && *scales_h != 1.0) ||
+  if (!resize::IsSupported(hw_type) || (scales_h && *scales_h != 1.0) ||
       (scales_w && *scales_w != 1.0)) {
     return at::native::call_fallback_fn<
         &xla_cpu_fallback,
@@ -3321,7 +3524,7 @@ at::Tensor XLANativeFunctions::var(const at::Tensor& self,
                                    at::OptionalIntArrayRef dim,
                                    c10::optional<int64_t> correction,
                                    bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   return bridge::AtenFromXlaTensor(XLATensor::var(
       self_tensor,
@@ -3334,7 +3537,7 @@ at::Tensor XLANativeFunctions::var(const at::Tensor& self,
 std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::var_mean(
     const at::Tensor& self, at::OptionalIntArrayRef dim,
     c10::optional<int64_t> correction, bool keepdim) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   auto results = XLATensor::var_mean(
       self_tensor,
@@ -3347,7 +3550,7 @@ std::tuple<at::Tensor, at::Tensor> XLANativeFunctions::var_mean(
 
 at::Tensor XLANativeFunctions::view(const at::Tensor& self,
                                     at::IntArrayRef size) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   return bridge::AtenFromXlaTensor(
       XLATensor::view(bridge::GetXlaTensor(self), XlaHelpers::I64List(size)));
 }
@@ -3355,7 +3558,7 @@ at::Tensor XLANativeFunctions::view(const at::Tensor& self,
 at::Tensor XLANativeFunctions::where(const at::Tensor& condition,
                                      const at::Tensor& self,
                                      const at::Tensor& other) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   c10::MaybeOwned<at::Tensor> b_condition, b_self, b_other;
   std::tie(b_condition, b_self, b_other) =
       expand_outplace(condition, self, other, "where");
@@ -3365,7 +3568,7 @@ at::Tensor XLANativeFunctions::where(const at::Tensor& condition,
 }
 
 at::Tensor& XLANativeFunctions::zero_(at::Tensor& self) {
-  XLA_FN_COUNTER("xla::");
+  XLA_FN_TRACE("xla::");
   XLATensorPtr self_tensor = bridge::GetXlaTensor(self);
   XLATensor::zero_(self_tensor);
   return self;
@@ -3383,16 +3586,23 @@ at::Scalar XLANativeFunctions::_local_scalar_dense(const at::Tensor& self) {
                                       ATEN_OP(_local_scalar_dense)>::call(self);
 }
 
-// re-use the composite kernel from core, that way we don't need to provide a
-// backwards formula for native_layer_norm
 std::tuple<at::Tensor, at::Tensor, at::Tensor>
 XLANativeFunctions::native_layer_norm(const at::Tensor& input,
                                       at::IntArrayRef normalized_shape,
                                       const c10::optional<at::Tensor>& weight,
                                       const c10::optional<at::Tensor>& bias,
                                       double eps) {
-  return at::native::math_native_layer_norm(input, normalized_shape, weight,
-                                            bias, eps);
+  XLA_FN_TRACE("xla::");
+  if (!at::isFloatingType(input.scalar_type())) {
+    // re-use the composite kernel from core, that way we don't need to provide
+    // a backwards formula for the remaining types.
+    return at::native::math_native_layer_norm(input, normalized_shape, weight,
+                                              bias, eps);
+  }
+  torch::autograd::variable_list outputs =
+      aten_autograd_ops::LayerNormAutogradFunction::apply(
+          input, normalized_shape, weight, bias, eps, /*rms=*/false);
+  return std::make_tuple(outputs[0], outputs[1], outputs[2]);
 }
 
 // re-use the composite kernel from core, that way we don't need to provide a
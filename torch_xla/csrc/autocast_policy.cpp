@@ -0,0 +1,99 @@
+#include "torch_xla/csrc/autocast_policy.h"
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace torch_xla {
+namespace {
+
+// The operations which run at the throughput of the low precision type, with
+// F32 accumulation.
+const char* const kDefaultAllowlist =
+    "aten::addmm,aten::baddbmm,aten::bmm,aten::convolution_overrideable,"
+    "aten::matmul,aten::mm";
+
+// The operations whose accuracy needs the F32 range and precision.
+const char* const kDefaultDenylist =
+    "aten::cumprod,aten::cumsum,aten::exp,aten::log,aten::log_softmax,"
+    "aten::logsumexp,aten::mean,aten::mse_loss,aten::nll_loss,aten::norm,"
+    "aten::prod,aten::softmax,aten::sum,aten::var,xla::cross_entropy,"
+    "xla::layer_norm";
+
+std::unordered_set<std::string> ParseOpList(const char* env,
+                                            const char* defval) {
+  std::string ops = xla::sys_util::GetEnvString(env, defval);
+  std::vector<std::string> op_list =
+      absl::StrSplit(ops, ',', absl::SkipEmpty());
+  return std::unordered_set<std::string>(op_list.begin(), op_list.end());
+}
+
+struct OpLists {
+  OpLists()
+      : allowlist(ParseOpList("XLA_AUTOCAST_ALLOWLIST", kDefaultAllowlist)),
+        denylist(ParseOpList("XLA_AUTOCAST_DENYLIST", kDefaultDenylist)) {}
+
+  std::unordered_set<std::string> allowlist;
+  std::unordered_set<std::string> denylist;
+};
+
+const OpLists& GetOpLists() {
+  static const OpLists* op_lists = new OpLists();
+  return *op_lists;
+}
+
+bool IsLowPrecisionType(xla::PrimitiveType type) {
+  return type == xla::PrimitiveType::BF16 || type == xla::PrimitiveType::F16;
+}
+
+}  // namespace
+
+bool AutocastPolicy::IsEnabled() {
+  static bool enabled = []() {
+    bool enabled = xla::sys_util::GetEnvBool("XLA_AUTOCAST", false);
+    if (enabled) {
+      TF_LOG(INFO) << "Using the BF16 autocast policy at lowering time";
+    }
+    return enabled;
+  }();
+  return enabled;
+}
+
+AutocastPolicy::Cast AutocastPolicy::GetCast(const torch::lazy::OpKind& op) {
+  if (!IsEnabled()) {
+    return Cast::kNone;
+  }
+  const OpLists& op_lists = GetOpLists();
+  std::string name = op.ToString();
+  if (op_lists.allowlist.count(name) > 0) {
+    return Cast::kLowPrecision;
+  }
+  if (op_lists.denylist.count(name) > 0) {
+    return Cast::kFullPrecision;
+  }
+  return Cast::kNone;
+}
+
+xla::PrimitiveType AutocastPolicy::GetCastType(Cast cast,
+                                               xla::PrimitiveType from) {
+  switch (cast) {
+    case Cast::kLowPrecision:
+      return from == xla::PrimitiveType::F32 ? xla::PrimitiveType::BF16 : from;
+    case Cast::kFullPrecision:
+      return IsLowPrecisionType(from) ? xla::PrimitiveType::F32 : from;
+    default:
+      return from;
+  }
+}
+
+xla::PrimitiveType AutocastPolicy::GetAccumulationType(
+    xla::PrimitiveType type) {
+  return IsEnabled() && IsLowPrecisionType(type) ? xla::PrimitiveType::F32
+                                                 : type;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "torch/csrc/lazy/core/ir.h"
+
+namespace torch_xla {
+
+// The mixed precision policy applied at lowering time (see XLA_AUTOCAST). The
+// operations of the allowlist (like the matmuls and convolutions) get lowered
+// with their F32 operands cast to BF16, while the ones of the denylist (like
+// the reductions and losses) get lowered with their BF16 operands cast to F32.
+// The results are cast back to the types of the IR nodes, so the tensor types
+// do not change.
+class AutocastPolicy {
+ public:
+  enum class Cast {
+    kNone,
+    kLowPrecision,
+    kFullPrecision,
+  };
+
+  static bool IsEnabled();
+
+  static Cast GetCast(const torch::lazy::OpKind& op);
+
+  // The type the operations get lowered to, for operands of the from type.
+  static xla::PrimitiveType GetCastType(Cast cast, xla::PrimitiveType from);
+
+  // The type the reductions and matmuls of the given type accumulate in, which
+  // is F32 for the low precision types when the policy is enabled.
+  static xla::PrimitiveType GetAccumulationType(xla::PrimitiveType type);
+};
+
+}  // namespace torch_xla
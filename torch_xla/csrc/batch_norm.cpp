@@ -2,6 +2,9 @@
 
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "torch_xla/csrc/convert_ops.h"
+#include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/helpers.h"
 
 namespace torch_xla {
@@ -27,6 +30,53 @@ xla::XlaOp VarianceRecover(xla::XlaOp invstd, float eps_value) {
   return one_over_invstd * one_over_invstd - eps;
 }
 
+xla::PrimitiveType SyncBatchNormStatType(xla::PrimitiveType type) {
+  return type == xla::PrimitiveType::F16 || type == xla::PrimitiveType::BF16
+             ? xla::PrimitiveType::F32
+             : type;
+}
+
+// Broadcasts the [C] features to the shape of the input.
+xla::XlaOp BroadcastFeatures(xla::XlaOp features,
+                             const xla::Shape& input_shape) {
+  return xla::BroadcastInDim(features, input_shape.dimensions(), {1});
+}
+
+// Sums the [C] values of every replica of the group, along with the number of
+// elements per feature, with a single all-reduce. Returns the values divided
+// by the total count, followed by the token.
+std::vector<xla::XlaOp> AllReduceFeatureMeans(
+    absl::Span<const xla::XlaOp> sums, const xla::Shape& input_shape,
+    xla::XlaOp token, const std::vector<std::vector<int64_t>>& groups,
+    bool pin_layout) {
+  xla::XlaBuilder* builder = sums[0].builder();
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(sums[0]);
+  int64_t num_features = input_shape.dimensions(1);
+  double count = static_cast<double>(
+      xla::ShapeUtil::ElementsIn(input_shape) / num_features);
+  std::vector<xla::XlaOp> stats(sums.begin(), sums.end());
+  // The replicas may hold batches of different sizes, so the counts are
+  // reduced as well.
+  stats.push_back(xla::Broadcast(
+      XlaHelpers::ScalarValue<double>(count, type, builder), {1}));
+  std::vector<xla::XlaOp> reduce =
+      BuildAllReduce(AllReduceType::kSum, {xla::ConcatInDim(builder, stats, 0)},
+                     token, 1.0, groups, pin_layout);
+  int64_t num_sums = sums.size();
+  xla::XlaOp total = xla::Reshape(
+      xla::SliceInDim(reduce[0], num_sums * num_features,
+                      num_sums * num_features + 1, 1, 0),
+      {});
+  std::vector<xla::XlaOp> means;
+  for (int64_t i = 0; i < num_sums; ++i) {
+    means.push_back(xla::SliceInDim(reduce[0], i * num_features,
+                                    (i + 1) * num_features, 1, 0) /
+                    total);
+  }
+  means.push_back(reduce[1]);
+  return means;
+}
+
 }  // namespace
 
 xla::XlaOp BatchNormVarianceInvert(xla::XlaOp variance, float eps_value) {
@@ -96,4 +146,64 @@ BatchNormGrads BuildBatchNormBackward(xla::XlaOp grad, xla::XlaOp input,
   return {grad_input, grad_weight, grad_bias};
 }
 
+SyncBatchNormOutput BuildSyncBatchNormTraining(
+    xla::XlaOp input, xla::XlaOp weight, xla::XlaOp bias, xla::XlaOp token,
+    float eps_value, const std::vector<std::vector<int64_t>>& groups,
+    bool pin_layout) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = SyncBatchNormStatType(input_shape.element_type());
+  xla::XlaBuilder* builder = input.builder();
+  std::vector<int64_t> reduce_dims =
+      XlaHelpers::GetAllDimensions(input_shape.rank());
+  reduce_dims.erase(reduce_dims.begin() + 1);
+  xla::XlaComputation add = XlaHelpers::CreateAddComputation(type);
+  xla::XlaOp zero = xla::Zero(builder, type);
+  xla::XlaOp x = MaybeConvertTo(input, type);
+  std::vector<xla::XlaOp> means = AllReduceFeatureMeans(
+      {xla::Reduce(x, zero, add, reduce_dims),
+       xla::Reduce(x * x, zero, add, reduce_dims)},
+      input_shape, token, groups, pin_layout);
+  xla::XlaOp mean = means[0];
+  // The rounding may push the variance of constant features below zero.
+  xla::XlaOp variance = xla::Max(means[1] - mean * mean, zero);
+  xla::XlaOp scale = BatchNormVarianceInvert(variance, eps_value) *
+                     MaybeConvertTo(weight, type);
+  xla::XlaOp shift = MaybeConvertTo(bias, type) - mean * scale;
+  xla::XlaOp output = x * BroadcastFeatures(scale, input_shape) +
+                      BroadcastFeatures(shift, input_shape);
+  return {MaybeConvertTo(output, input_shape.element_type()), mean, variance,
+          means[2]};
+}
+
+SyncBatchNormGrads BuildSyncBatchNormBackward(
+    xla::XlaOp grad, xla::XlaOp input, xla::XlaOp weight, xla::XlaOp mean,
+    xla::XlaOp variance, xla::XlaOp token, float eps_value,
+    const std::vector<std::vector<int64_t>>& groups, bool pin_layout) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = SyncBatchNormStatType(input_shape.element_type());
+  xla::XlaBuilder* builder = input.builder();
+  std::vector<int64_t> reduce_dims =
+      XlaHelpers::GetAllDimensions(input_shape.rank());
+  reduce_dims.erase(reduce_dims.begin() + 1);
+  xla::XlaComputation add = XlaHelpers::CreateAddComputation(type);
+  xla::XlaOp zero = xla::Zero(builder, type);
+  xla::XlaOp g = MaybeConvertTo(grad, type);
+  xla::XlaOp x_mu = MaybeConvertTo(input, type) -
+                    BroadcastFeatures(MaybeConvertTo(mean, type), input_shape);
+  xla::XlaOp invstd =
+      BatchNormVarianceInvert(MaybeConvertTo(variance, type), eps_value);
+  xla::XlaOp sum_dy = xla::Reduce(g, zero, add, reduce_dims);
+  xla::XlaOp sum_dy_xmu = xla::Reduce(g * x_mu, zero, add, reduce_dims);
+  std::vector<xla::XlaOp> means = AllReduceFeatureMeans(
+      {sum_dy, sum_dy_xmu}, input_shape, token, groups, pin_layout);
+  xla::XlaOp grad_input =
+      (g - BroadcastFeatures(means[0], input_shape) -
+       x_mu * BroadcastFeatures(invstd * invstd * means[1], input_shape)) *
+      BroadcastFeatures(invstd * MaybeConvertTo(weight, type), input_shape);
+  xla::PrimitiveType weight_type = XlaHelpers::TypeOfXlaOp(weight);
+  return {MaybeConvertTo(grad_input, input_shape.element_type()),
+          MaybeConvertTo(sum_dy_xmu * invstd, weight_type),
+          MaybeConvertTo(sum_dy, weight_type), means[2]};
+}
+
 }  // namespace torch_xla
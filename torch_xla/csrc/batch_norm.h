@@ -1,5 +1,7 @@
 #pragma once
 
+#include <vector>
+
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 
 namespace torch_xla {
@@ -16,6 +18,20 @@ struct BatchNormGrads {
   xla::XlaOp grad_bias;
 };
 
+struct SyncBatchNormOutput {
+  xla::XlaOp output;
+  xla::XlaOp batch_mean;
+  xla::XlaOp batch_variance;
+  xla::XlaOp token;
+};
+
+struct SyncBatchNormGrads {
+  xla::XlaOp grad_input;
+  xla::XlaOp grad_weight;
+  xla::XlaOp grad_bias;
+  xla::XlaOp token;
+};
+
 xla::XlaOp BatchNormVarianceInvert(xla::XlaOp variance, float eps_value);
 
 BatchNormOutput BuildBatchNormTraining(xla::XlaOp input, xla::XlaOp weight,
@@ -30,4 +46,22 @@ BatchNormGrads BuildBatchNormBackward(xla::XlaOp grad, xla::XlaOp input,
                                       xla::XlaOp save_invstd, bool training,
                                       float eps_value);
 
+// Batch normalization over the feature dimension 1, with the batch statistics
+// of all the replicas of the group. The local sums and sums of squares, and the
+// element counts, go through a single all-reduce, and the biased batch mean
+// and variance are returned in F32 for the reduced precision inputs.
+SyncBatchNormOutput BuildSyncBatchNormTraining(
+    xla::XlaOp input, xla::XlaOp weight, xla::XlaOp bias, xla::XlaOp token,
+    float eps_value, const std::vector<std::vector<int64_t>>& groups,
+    bool pin_layout);
+
+// The gradients of BuildSyncBatchNormTraining(). The input gradient reduces
+// its statistics across the replicas of the group with a single all-reduce,
+// while the weight and bias gradients are the local ones, which get reduced
+// along with the other parameter gradients.
+SyncBatchNormGrads BuildSyncBatchNormBackward(
+    xla::XlaOp grad, xla::XlaOp input, xla::XlaOp weight, xla::XlaOp mean,
+    xla::XlaOp variance, xla::XlaOp token, float eps_value,
+    const std::vector<std::vector<int64_t>>& groups, bool pin_layout);
+
 }  // namespace torch_xla
@@ -0,0 +1,134 @@
+#include "torch_xla/csrc/compile_ahead.h"
+
+#include <exception>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace torch_xla {
+
+CompileAhead* CompileAhead::Get() {
+  static CompileAhead* compile_ahead = []() -> CompileAhead* {
+    if (!xla::sys_util::GetEnvBool("XLA_COMPILE_AHEAD", false)) {
+      return nullptr;
+    }
+    return new CompileAhead(
+        xla::sys_util::GetEnvInt("XLA_COMPILE_AHEAD_GRAPHS", 256),
+        xla::sys_util::GetEnvInt("XLA_COMPILE_AHEAD_MIN_TRANSITIONS", 1));
+  }();
+  return compile_ahead;
+}
+
+CompileAhead::CompileAhead(size_t max_graphs, size_t min_transitions)
+    : min_transitions_(min_transitions), graphs_(max_graphs) {}
+
+void CompileAhead::RecordComputation(
+    const torch::lazy::hash_t& hash,
+    const xla::ComputationClient::CompileInstance& instance) {
+  XLA_CHECK(instance.output_shape != nullptr);
+  graphs_.Add(hash, std::make_shared<GraphInfo>(
+                        instance.computation, instance.compilation_device,
+                        instance.devices, *instance.output_shape));
+}
+
+void CompileAhead::RecordExecution(const torch::lazy::hash_t& hash,
+                                   const std::string& device,
+                                   const IsCachedFn& is_cached_fn) {
+  std::lock_guard<std::mutex> lock(lock_);
+  // Whatever compiled ahead of time, and not claimed by the time the next
+  // graph executes, was a misprediction.
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    if (it->second->done) {
+      XLA_COUNTER("CompileAheadDiscarded", 1);
+      it = pending_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  auto last_it = last_hash_.find(device);
+  if (last_it != last_hash_.end()) {
+    std::shared_ptr<GraphInfo> last_graph = graphs_.Get(last_it->second);
+    if (last_graph != nullptr) {
+      last_graph->successors[hash] += 1;
+    }
+    last_it->second = hash;
+  } else {
+    last_hash_.emplace(device, hash);
+  }
+
+  std::shared_ptr<GraphInfo> graph = graphs_.Get(hash);
+  if (graph == nullptr) {
+    return;
+  }
+  const torch::lazy::hash_t* next_hash = nullptr;
+  size_t next_count = 0;
+  for (auto& hash_count : graph->successors) {
+    if (hash_count.second > next_count) {
+      next_hash = &hash_count.first;
+      next_count = hash_count.second;
+    }
+  }
+  if (next_hash == nullptr || next_count < min_transitions_ ||
+      pending_.count(*next_hash) > 0 || is_cached_fn(*next_hash)) {
+    return;
+  }
+  std::shared_ptr<GraphInfo> next_graph = graphs_.Get(*next_hash);
+  if (next_graph != nullptr) {
+    Schedule(*next_hash, std::move(next_graph));
+  }
+}
+
+CompileAhead::ComputationPtr CompileAhead::Take(
+    const torch::lazy::hash_t& hash) {
+  std::unique_lock<std::mutex> lock(lock_);
+  auto it = pending_.find(hash);
+  if (it == pending_.end()) {
+    return nullptr;
+  }
+  std::shared_ptr<Pending> pending = it->second;
+  if (!pending->done) {
+    XLA_TIMED("CompileAheadWait");
+    cv_.wait(lock, [&] { return pending->done; });
+  }
+  pending_.erase(hash);
+  if (pending->computation != nullptr) {
+    XLA_COUNTER("CompileAheadHit", 1);
+  }
+  return pending->computation;
+}
+
+void CompileAhead::Schedule(const torch::lazy::hash_t& hash,
+                            std::shared_ptr<GraphInfo> graph) {
+  // Called with lock_ held.
+  auto pending = std::make_shared<Pending>();
+  pending_.emplace(hash, pending);
+  XLA_COUNTER("CompileAheadScheduled", 1);
+  TF_VLOG(3) << "Compiling ahead IR graph hash "
+             << torch::lazy::HashToString(hash);
+
+  auto compilefn = [this, hash, graph = std::move(graph),
+                    pending = std::move(pending)]() {
+    ComputationPtr computation;
+    try {
+      std::vector<xla::ComputationClient::CompileInstance> instances;
+      instances.push_back({graph->computation, graph->compilation_device,
+                           graph->devices, &graph->output_shape});
+      computation = std::move(
+          xla::ComputationClient::Get()->Compile(std::move(instances)).front());
+    } catch (const std::exception& ex) {
+      TF_LOG(WARNING) << "Ahead of time compilation of IR graph hash "
+                      << torch::lazy::HashToString(hash)
+                      << " failed: " << ex.what();
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    pending->computation = std::move(computation);
+    pending->done = true;
+    cv_.notify_all();
+  };
+  xla::env::ScheduleIoClosure(std::move(compilefn));
+}
+
+}  // namespace torch_xla
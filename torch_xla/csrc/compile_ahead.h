@@ -0,0 +1,93 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch/csrc/lazy/core/hash.h"
+
+namespace torch_xla {
+
+// The CompileAhead class keeps a history of the graph transitions seen at the
+// sync points, together with the lowered (not compiled) XLA computations of
+// the graphs it has seen. When a graph is executed, and its most likely
+// successor is known and not present within the computation cache (for
+// example, because it got evicted, or because it is the tail graph of an eval
+// loop which shows only once per epoch), its compilation is started in the
+// background, so that the next sync point can pick it up without stalling.
+class CompileAhead {
+ public:
+  using ComputationPtr = std::shared_ptr<xla::ComputationClient::Computation>;
+  using IsCachedFn = std::function<bool(const torch::lazy::hash_t&)>;
+
+  // Returns the compile-ahead singleton, or nullptr if the compile-ahead mode
+  // is not enabled (XLA_COMPILE_AHEAD not set).
+  static CompileAhead* Get();
+
+  CompileAhead(size_t max_graphs, size_t min_transitions);
+
+  // Records the computation which got lowered for the given graph hash, so
+  // that it can later be compiled ahead of time.
+  void RecordComputation(
+      const torch::lazy::hash_t& hash,
+      const xla::ComputationClient::CompileInstance& instance);
+
+  // Records that the graph with the given hash is being executed on device,
+  // and schedules the compilation of its predicted successor, if any, and if
+  // is_cached_fn reports it to be missing from the computation cache.
+  void RecordExecution(const torch::lazy::hash_t& hash,
+                       const std::string& device,
+                       const IsCachedFn& is_cached_fn);
+
+  // Returns the computation compiled ahead of time for the given hash, waiting
+  // for it if the compilation is still in flight. Returns nullptr if no
+  // compilation was scheduled for the hash.
+  ComputationPtr Take(const torch::lazy::hash_t& hash);
+
+ private:
+  struct GraphInfo {
+    GraphInfo(xla::XlaComputation computation, std::string compilation_device,
+              std::vector<std::string> devices, xla::Shape output_shape)
+        : computation(std::move(computation)),
+          compilation_device(std::move(compilation_device)),
+          devices(std::move(devices)),
+          output_shape(std::move(output_shape)) {}
+
+    xla::XlaComputation computation;
+    std::string compilation_device;
+    std::vector<std::string> devices;
+    xla::Shape output_shape;
+    // Maps the hashes of the graphs which followed this one, to the number of
+    // times the transition has been observed.
+    std::unordered_map<torch::lazy::hash_t, size_t, torch::lazy::HashReducer>
+        successors;
+  };
+
+  struct Pending {
+    bool done = false;
+    ComputationPtr computation;
+  };
+
+  using GraphCache = xla::util::Cache<torch::lazy::hash_t, GraphInfo,
+                                      torch::lazy::HashReducer>;
+
+  void Schedule(const torch::lazy::hash_t& hash,
+                std::shared_ptr<GraphInfo> graph);
+
+  size_t min_transitions_;
+  GraphCache graphs_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::unordered_map<std::string, torch::lazy::hash_t> last_hash_;
+  std::unordered_map<torch::lazy::hash_t, std::shared_ptr<Pending>,
+                     torch::lazy::HashReducer>
+      pending_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,148 @@
+#include "torch_xla/csrc/conv_layout_planner.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include "absl/algorithm/container.h"
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+
+namespace torch_xla {
+namespace {
+
+// The feature counts the planned layouts must be a multiple of, below which
+// the feature dimension pads the minor tiles more than the spatial ones.
+constexpr int64_t kFeatureAlignment = 8;
+
+struct PlanEntry {
+  bool planned = false;
+  std::vector<int64_t> layout;
+};
+
+struct KeyHasher {
+  size_t operator()(const std::vector<int64_t>& key) const {
+    return xla::util::HashReduce(xla::util::MHash(key));
+  }
+};
+
+bool RunsFeatureMinorConvolutions(xla::PrimitiveType type,
+                                  XlaDeviceType hw_type) {
+  switch (hw_type) {
+    case XlaDeviceType::TPU:
+      return xla::primitive_util::IsFloatingPointType(type);
+    case XlaDeviceType::GPU:
+      // The GPU convolutions are only feature minor for the tensor cores.
+      return type == xla::PrimitiveType::F16 ||
+             type == xla::PrimitiveType::BF16;
+    default:
+      return false;
+  }
+}
+
+PlanEntry MakePlan(absl::Span<const int64_t> dimensions,
+                   xla::PrimitiveType type, XlaDeviceType hw_type) {
+  PlanEntry entry;
+  int64_t rank = dimensions.size();
+  if ((rank != 4 && rank != 5) ||
+      !RunsFeatureMinorConvolutions(type, hw_type)) {
+    return entry;
+  }
+  // Both the [N, C, spatial...] activations and the [Cout, Cin, spatial...]
+  // kernels have the feature dimension at 1.
+  int64_t spatial_size = 1;
+  for (int64_t dim = 2; dim < rank; ++dim) {
+    spatial_size *= dimensions[dim];
+  }
+  if (spatial_size <= 1 || dimensions[1] % kFeatureAlignment != 0) {
+    return entry;
+  }
+  // Minor-to-major: the features, the spatial dimensions (last one most
+  // minor), then the batch (or output features of the kernels).
+  entry.planned = true;
+  entry.layout.push_back(1);
+  for (int64_t dim = rank - 1; dim >= 2; --dim) {
+    entry.layout.push_back(dim);
+  }
+  entry.layout.push_back(0);
+  return entry;
+}
+
+struct PlanState {
+  std::mutex lock;
+  std::unordered_map<std::vector<int64_t>, PlanEntry, KeyHasher> plans;
+};
+
+PlanState* GetPlanState() {
+  static PlanState* state = new PlanState();
+  return state;
+}
+
+std::vector<int64_t> MakeKey(absl::Span<const int64_t> dimensions,
+                             xla::PrimitiveType type, XlaDeviceType hw_type) {
+  std::vector<int64_t> key(dimensions.begin(), dimensions.end());
+  key.push_back(static_cast<int64_t>(type));
+  key.push_back(static_cast<int64_t>(hw_type));
+  return key;
+}
+
+}  // namespace
+
+bool ConvLayoutPlanner::IsEnabled() {
+  static bool enabled =
+      xla::sys_util::GetEnvBool("XLA_CONV_LAYOUT_PLANNING", false);
+  return enabled;
+}
+
+const std::vector<int64_t>* ConvLayoutPlanner::GetLayout(
+    absl::Span<const int64_t> dimensions, xla::PrimitiveType type,
+    XlaDeviceType hw_type) {
+  PlanState* state = GetPlanState();
+  std::vector<int64_t> key = MakeKey(dimensions, type, hw_type);
+  std::lock_guard<std::mutex> guard(state->lock);
+  auto it = state->plans.find(key);
+  // The nodes of the map are stable, so the layout can be returned by pointer.
+  return it != state->plans.end() && it->second.planned ? &it->second.layout
+                                                        : nullptr;
+}
+
+int64_t ConvLayoutPlanner::RecordConvolution(
+    absl::Span<const xla::Shape* const> shapes, XlaDeviceType hw_type) {
+  PlanState* state = GetPlanState();
+  int64_t elided = 0;
+  std::lock_guard<std::mutex> guard(state->lock);
+  for (const xla::Shape* shape : shapes) {
+    std::vector<int64_t> key =
+        MakeKey(shape->dimensions(), shape->element_type(), hw_type);
+    auto it = state->plans.find(key);
+    if (it == state->plans.end()) {
+      it = state->plans
+               .emplace(key, MakePlan(shape->dimensions(),
+                                      shape->element_type(), hw_type))
+               .first;
+      if (it->second.planned) {
+        XLA_COUNTER("ConvLayoutPlannedShapes", 1);
+        TF_VLOG(3) << "Planned layout {"
+                   << absl::StrJoin(it->second.layout, ",") << "} for shape "
+                   << xla::ShapeUtil::HumanString(*shape);
+      }
+    }
+    // Only the operands which already come in the planned layout, like the
+    // ones created after an earlier convolution registered their shape, spare
+    // XLA a transpose.
+    if (it->second.planned && shape->has_layout() &&
+        absl::c_equal(shape->layout().minor_to_major(), it->second.layout)) {
+      ++elided;
+    }
+  }
+  if (elided > 0) {
+    XLA_COUNTER("ConvLayoutElidedTransposes", elided);
+  }
+  return elided;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/types.h"
+#include "torch_xla/csrc/device.h"
+
+namespace torch_xla {
+
+// Plans feature minor layouts (NHWC in memory, while the logical dimensions
+// stay NCHW) for the convolution activations and kernels of the devices whose
+// convolutions run in that layout, so that the layout assignment of XLA does
+// not have to transpose the operands and results of every convolution.
+class ConvLayoutPlanner {
+ public:
+  // Whether the planned layouts get exposed by MakeArrayShapeFromDimensions().
+  static bool IsEnabled();
+
+  // Returns the minor-to-major layout planned for an array of the given
+  // dimensions and type, or nullptr if it should keep the default layout. Only
+  // the shapes a convolution registered with RecordConvolution() get planned.
+  static const std::vector<int64_t>* GetLayout(
+      absl::Span<const int64_t> dimensions, xla::PrimitiveType type,
+      XlaDeviceType hw_type);
+
+  // Registers the shapes of the operands and result of a convolution, so that
+  // the arrays of those shapes get planned layouts from then on. Returns (and
+  // records in the metrics) how many of them already have their planned
+  // layout, which are the transposes XLA avoids.
+  static int64_t RecordConvolution(absl::Span<const xla::Shape* const> shapes,
+                                   XlaDeviceType hw_type);
+};
+
+}  // namespace torch_xla
@@ -122,6 +122,17 @@ xla::XlaOp CastToScalarType(xla::XlaOp input,
   return ConvertToNumeric(input, XlaHelpers::TypeOfXlaOp(input));
 }
 
+xla::PrimitiveType CastToScalarTypeType(xla::PrimitiveType type,
+                                        c10::optional<at::ScalarType> dtype) {
+  torch::lazy::BackendDevice xla_device = GetCurrentDevice();
+  if (dtype) {
+    return MakeXlaPrimitiveType(*dtype, &xla_device);
+  }
+  return type == xla::PrimitiveType::PRED
+             ? GetDevicePrimitiveType(xla::PrimitiveType::U8, &xla_device)
+             : type;
+}
+
 xla::XlaOp MaybeConvertTo(xla::XlaOp input, xla::PrimitiveType type) {
   return XlaHelpers::TypeOfXlaOp(input) != type
              ? xla::ConvertElementType(input, type)
@@ -27,6 +27,11 @@ xla::XlaOp ConvertToNumeric(xla::XlaOp op);
 xla::XlaOp CastToScalarType(xla::XlaOp input,
                             c10::optional<at::ScalarType> dtype);
 
+// Returns the element type CastToScalarType() produces for an input of the
+// given type.
+xla::PrimitiveType CastToScalarTypeType(xla::PrimitiveType type,
+                                        c10::optional<at::ScalarType> dtype);
+
 xla::XlaOp MaybeConvertTo(xla::XlaOp input, xla::PrimitiveType type);
 
 }  // namespace torch_xla
@@ -6,6 +6,7 @@
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/kernels/conv_grad_ops.h"
 #include "third_party/xla_client/debug_macros.h"
+#include "torch_xla/csrc/conv_layout_planner.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/tensor.h"
 #include "torch_xla/csrc/xla_lower_util.h"
@@ -270,6 +271,19 @@ xla::XlaOp BuildGradBias(xla::XlaOp grad_output) {
       BiasReduceDimensions(grad_output_shape.rank()));
 }
 
+// Records the operands and result of a convolution with the layout planner.
+void RecordConvolutionLayouts(absl::Span<const xla::XlaOp> ops) {
+  if (!ConvLayoutPlanner::IsEnabled()) {
+    return;
+  }
+  std::vector<const xla::Shape*> shapes;
+  for (const xla::XlaOp& op : ops) {
+    shapes.push_back(&XlaHelpers::ShapeOfXlaOp(op));
+  }
+  ConvLayoutPlanner::RecordConvolution(
+      shapes, static_cast<XlaDeviceType>(GetCurrentDevice().type()));
+}
+
 xla::XlaOp BuildTransposedConvolution(xla::XlaOp input, xla::XlaOp kernel,
                                       absl::Span<const int64_t> stride,
                                       absl::Span<const int64_t> padding,
@@ -317,6 +331,7 @@ ConvGrads BuildTransposedConvolutionBackward(
   xla::XlaOp grad_weight = BuildConvBackwardWeight(
       padded_input, grad_output, XlaHelpers::ShapeOfXlaOp(kernel), stride,
       padding, dilation, groups);
+  RecordConvolutionLayouts({padded_input, grad_output, grad_weight});
   xla::XlaOp grad_bias = BuildGradBias(grad_output);
   return {unpadded_grad_input, grad_weight, grad_bias};
 }
@@ -327,14 +342,15 @@ xla::XlaOp BuildConvolutionOverrideable(
     xla::XlaOp input, xla::XlaOp kernel, absl::Span<const int64_t> stride,
     absl::Span<const int64_t> padding, absl::Span<const int64_t> dilation,
     bool transposed, absl::Span<const int64_t> output_padding, int64_t groups) {
+  xla::XlaOp output;
   if (transposed) {
-    return BuildTransposedConvolution(input, kernel, stride, padding, dilation,
-                                      output_padding, groups);
+    output = BuildTransposedConvolution(input, kernel, stride, padding,
+                                        dilation, output_padding, groups);
   } else {
     auto dims_padding = MakePadding(padding);
     xla::PrecisionConfig precision_config =
         XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
-    return xla::ConvGeneralDilated(
+    output = xla::ConvGeneralDilated(
         input, kernel, stride, dims_padding,
         /*lhs_dilation*/ {},
         /*rhs_dilation*/ dilation,
@@ -343,6 +359,8 @@ xla::XlaOp BuildConvolutionOverrideable(
         /*feature_group_count*/ groups,
         /*batch_group_count=*/1, &precision_config);
   }
+  RecordConvolutionLayouts({input, kernel, output});
+  return output;
 }
 
 xla::XlaOp BuildConvolutionOverrideableBias(
@@ -379,6 +397,8 @@ ConvGrads BuildConvolutionBackwardOverrideable(
     xla::XlaOp grad_weight = BuildConvBackwardWeight(
         grad_output, input, XlaHelpers::ShapeOfXlaOp(kernel), stride, padding,
         dilation, groups);
+    RecordConvolutionLayouts({grad_output, kernel, grad_input});
+    RecordConvolutionLayouts({grad_output, input, grad_weight});
     xla::XlaOp grad_bias = BuildGradBias(grad_output);
     return {grad_input, grad_weight, grad_bias};
   }
@@ -0,0 +1,163 @@
+#include "torch_xla/csrc/copy_kernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define XLA_COPY_KERNELS_AVX2 1
+#endif
+
+namespace torch_xla {
+namespace {
+
+uint16_t F32ToBF16(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    // Quiet NaN with the sign of the input.
+    return static_cast<uint16_t>(((bits >> 16) & 0x8000) | 0x7fc0);
+  }
+  uint32_t rounding_bias = 0x7fff + ((bits >> 16) & 1);
+  return static_cast<uint16_t>((bits + rounding_bias) >> 16);
+}
+
+float BF16ToF32(uint16_t value) {
+  uint32_t bits = static_cast<uint32_t>(value) << 16;
+  float result;
+  std::memcpy(&result, &bits, sizeof(result));
+  return result;
+}
+
+#if defined(XLA_COPY_KERNELS_AVX2)
+
+bool HasAvx2() {
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  return has_avx2;
+}
+
+__attribute__((target("avx2"))) __m256i F32ToBF16Avx2(__m256i bits) {
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i bias = _mm256_set1_epi32(0x7fff);
+  const __m256i sign = _mm256_set1_epi32(0x8000);
+  const __m256i qnan = _mm256_set1_epi32(0x7fc0);
+  __m256i lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), one);
+  __m256i rounded = _mm256_srli_epi32(
+      _mm256_add_epi32(bits, _mm256_add_epi32(bias, lsb)), 16);
+  __m256i nan_value =
+      _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(bits, 16), sign), qnan);
+  __m256 values = _mm256_castsi256_ps(bits);
+  __m256i nan_mask =
+      _mm256_castps_si256(_mm256_cmp_ps(values, values, _CMP_UNORD_Q));
+  return _mm256_blendv_epi8(rounded, nan_value, nan_mask);
+}
+
+__attribute__((target("avx2"))) int64_t ConvertF32ToBF16Avx2(
+    const float* source, uint16_t* dest, int64_t n) {
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i lo = F32ToBF16Avx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+    __m256i hi = F32ToBF16Avx2(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 8)));
+    // The pack works within 128 bits lanes, so the 64 bits quads need to be
+    // put back in order.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi),
+                                              _MM_SHUFFLE(3, 1, 2, 0));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), packed);
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) int64_t ConvertBF16ToF32Avx2(
+    const uint16_t* source, float* dest, int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i values = _mm256_cvtepu16_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm256_slli_epi32(values, 16));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) int64_t ConvertS64ToS32Avx2(
+    const int64_t* source, int32_t* dest, int64_t n) {
+  const __m256i low_words = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256i lo = _mm256_permutevar8x32_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)),
+        low_words);
+    __m256i hi = _mm256_permutevar8x32_epi32(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i + 4)),
+        low_words);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm256_permute2x128_si256(lo, hi, 0x20));
+  }
+  return i;
+}
+
+__attribute__((target("avx2"))) int64_t ConvertS32ToS64Avx2(
+    const int32_t* source, int64_t* dest, int64_t n) {
+  int64_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m256i values = _mm256_cvtepi32_epi64(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), values);
+  }
+  return i;
+}
+
+#endif  // XLA_COPY_KERNELS_AVX2
+
+}  // namespace
+
+void ConvertF32ToBF16(const float* source, uint16_t* dest, int64_t n) {
+  int64_t i = 0;
+#if defined(XLA_COPY_KERNELS_AVX2)
+  if (HasAvx2()) {
+    i = ConvertF32ToBF16Avx2(source, dest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = F32ToBF16(source[i]);
+  }
+}
+
+void ConvertBF16ToF32(const uint16_t* source, float* dest, int64_t n) {
+  int64_t i = 0;
+#if defined(XLA_COPY_KERNELS_AVX2)
+  if (HasAvx2()) {
+    i = ConvertBF16ToF32Avx2(source, dest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = BF16ToF32(source[i]);
+  }
+}
+
+void ConvertS64ToS32(const int64_t* source, int32_t* dest, int64_t n) {
+  int64_t i = 0;
+#if defined(XLA_COPY_KERNELS_AVX2)
+  if (HasAvx2()) {
+    i = ConvertS64ToS32Avx2(source, dest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = static_cast<int32_t>(source[i]);
+  }
+}
+
+void ConvertS32ToS64(const int32_t* source, int64_t* dest, int64_t n) {
+  int64_t i = 0;
+#if defined(XLA_COPY_KERNELS_AVX2)
+  if (HasAvx2()) {
+    i = ConvertS32ToS64Avx2(source, dest, n);
+  }
+#endif
+  for (; i < n; ++i) {
+    dest[i] = source[i];
+  }
+}
+
+}  // namespace torch_xla
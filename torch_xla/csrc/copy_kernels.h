@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace torch_xla {
+
+// Element type converting copy kernels, used by the host to/from device
+// buffer copies for the conversions which show up in the input pipelines (like
+// the ones triggered by XLA_USE_BF16 and XLA_USE_32BIT_LONG).
+// The kernels select a vectorized implementation at runtime, if the CPU
+// supports it, and produce the same results as the scalar casts.
+
+// Converts float values to bfloat16 ones (stored as their 16 bits patterns),
+// rounding to nearest even, like tensorflow::bfloat16 does.
+void ConvertF32ToBF16(const float* source, uint16_t* dest, int64_t n);
+
+// Converts bfloat16 values (stored as their 16 bits patterns) to float ones.
+void ConvertBF16ToF32(const uint16_t* source, float* dest, int64_t n);
+
+// Converts int64 values to int32 ones, by truncation.
+void ConvertS64ToS32(const int64_t* source, int32_t* dest, int64_t n);
+
+// Converts int32 values to int64 ones.
+void ConvertS32ToS64(const int32_t* source, int64_t* dest, int64_t n);
+
+}  // namespace torch_xla
@@ -0,0 +1,196 @@
+#include "torch_xla/csrc/cross_entropy.h"
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+struct CrossEntropyData {
+  int64_t class_dim = 0;
+  int64_t num_classes = 0;
+  std::vector<int64_t> sizes;
+  // The dimensions of the logits the labels broadcast to.
+  std::vector<int64_t> label_dims;
+  // The logits, and all the values below, are in the compute type.
+  xla::XlaOp logits;
+  xla::XlaOp one_hot;
+  // One for the labels which are not ignore_index, zero otherwise.
+  xla::XlaOp valid;
+  // The weight of the class of every label, zero for the ignored ones.
+  xla::XlaOp label_weight;
+  // The class weights broadcast to the logits, if any.
+  absl::optional<xla::XlaOp> weight;
+  // The sum of the class weights.
+  xla::XlaOp weight_sum;
+};
+
+xla::PrimitiveType GetComputeType(xla::PrimitiveType type) {
+  return type == xla::PrimitiveType::F16 || type == xla::PrimitiveType::BF16
+             ? xla::PrimitiveType::F32
+             : type;
+}
+
+xla::XlaOp SumClasses(xla::XlaOp input, const CrossEntropyData& data) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(input);
+  return xla::Reduce(input, xla::Zero(input.builder(), type),
+                     XlaHelpers::CreateAddComputation(type), {data.class_dim});
+}
+
+xla::XlaOp SumAll(xla::XlaOp input) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(input);
+  return xla::ReduceAll(input, xla::Zero(input.builder(), type),
+                        XlaHelpers::CreateAddComputation(type));
+}
+
+CrossEntropyData MakeCrossEntropyData(xla::XlaOp logits, xla::XlaOp labels,
+                                      const absl::optional<xla::XlaOp>& weight,
+                                      int64_t ignore_index) {
+  xla::XlaBuilder* builder = logits.builder();
+  const xla::Shape& logits_shape = XlaHelpers::ShapeOfXlaOp(logits);
+  const xla::Shape& labels_shape = XlaHelpers::ShapeOfXlaOp(labels);
+  XLA_CHECK_GE(logits_shape.rank(), 1) << logits_shape;
+  XLA_CHECK_EQ(labels_shape.rank() + 1, logits_shape.rank())
+      << logits_shape << " vs. " << labels_shape;
+  xla::PrimitiveType type = GetComputeType(logits_shape.element_type());
+
+  CrossEntropyData data;
+  data.class_dim = logits_shape.rank() == 1 ? 0 : 1;
+  data.num_classes = logits_shape.dimensions(data.class_dim);
+  data.sizes = xla::util::ToVector<int64_t>(logits_shape.dimensions());
+  for (int64_t dim = 0; dim < logits_shape.rank(); ++dim) {
+    if (dim != data.class_dim) {
+      data.label_dims.push_back(dim);
+    }
+  }
+  data.logits = xla::ConvertElementType(logits, type);
+  xla::XlaOp iota = xla::Iota(
+      builder,
+      xla::ShapeUtil::MakeShape(labels_shape.element_type(), data.sizes),
+      data.class_dim);
+  data.one_hot = xla::Eq(
+      iota, xla::BroadcastInDim(labels, data.sizes, data.label_dims));
+  xla::XlaOp valid = xla::Ne(
+      labels, XlaHelpers::ScalarValue<int64_t>(
+                  ignore_index, labels_shape.element_type(), builder));
+  data.valid = xla::ConvertElementType(valid, type);
+  if (weight) {
+    data.weight = xla::BroadcastInDim(xla::ConvertElementType(*weight, type),
+                                      data.sizes, {data.class_dim});
+    xla::XlaOp picked_weight = SumClasses(
+        xla::Select(data.one_hot, *data.weight,
+                    xla::ZerosLike(*data.weight)),
+        data);
+    data.label_weight = picked_weight * data.valid;
+    data.weight_sum = SumAll(xla::ConvertElementType(*weight, type));
+  } else {
+    data.label_weight = data.valid;
+    data.weight_sum =
+        XlaHelpers::ScalarValue<int64_t>(data.num_classes, type, builder);
+  }
+  return data;
+}
+
+}  // namespace
+
+CrossEntropyOutput BuildCrossEntropy(xla::XlaOp logits, xla::XlaOp labels,
+                                     const absl::optional<xla::XlaOp>& weight,
+                                     ReductionMode reduction_mode,
+                                     int64_t ignore_index,
+                                     double label_smoothing) {
+  xla::XlaBuilder* builder = logits.builder();
+  CrossEntropyData data =
+      MakeCrossEntropyData(logits, labels, weight, ignore_index);
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(data.logits);
+  xla::XlaOp max = xla::Reduce(data.logits, xla::MinValue(builder, type),
+                               XlaHelpers::CreateMaxComputation(type),
+                               {data.class_dim});
+  xla::XlaOp shifted =
+      data.logits - xla::BroadcastInDim(max, data.sizes, data.label_dims);
+  xla::XlaOp logsumexp = max + xla::Log(SumClasses(xla::Exp(shifted), data));
+  xla::XlaOp picked = SumClasses(
+      xla::Select(data.one_hot, data.logits, xla::ZerosLike(data.logits)),
+      data);
+  // -log_softmax(logits)[label] = logsumexp - logits[label].
+  xla::XlaOp loss = data.label_weight * (logsumexp - picked);
+  if (label_smoothing > 0) {
+    // The smoothing term is the (weighted) sum of -log_softmax(logits) over
+    // all the classes, scaled by label_smoothing / num_classes.
+    xla::XlaOp weighted_logits =
+        data.weight ? data.logits * *data.weight : data.logits;
+    xla::XlaOp smooth_loss =
+        data.valid *
+        (logsumexp * data.weight_sum - SumClasses(weighted_logits, data));
+    loss = loss * XlaHelpers::ScalarValue<double>(1.0 - label_smoothing, type,
+                                                  builder) +
+           smooth_loss *
+               XlaHelpers::ScalarValue<double>(
+                   label_smoothing / data.num_classes, type, builder);
+  }
+  switch (reduction_mode) {
+    case ReductionMode::kNone:
+      break;
+    case ReductionMode::kMean:
+      loss = SumAll(loss) / SumAll(data.label_weight);
+      break;
+    case ReductionMode::kSum:
+      loss = SumAll(loss);
+      break;
+  }
+  return {xla::ConvertElementType(loss, XlaHelpers::TypeOfXlaOp(logits)),
+          logsumexp};
+}
+
+xla::XlaOp BuildCrossEntropyBackward(xla::XlaOp grad_output, xla::XlaOp logits,
+                                     xla::XlaOp labels, xla::XlaOp logsumexp,
+                                     const absl::optional<xla::XlaOp>& weight,
+                                     ReductionMode reduction_mode,
+                                     int64_t ignore_index,
+                                     double label_smoothing) {
+  xla::XlaBuilder* builder = logits.builder();
+  CrossEntropyData data =
+      MakeCrossEntropyData(logits, labels, weight, ignore_index);
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(data.logits);
+  xla::XlaOp grad = xla::ConvertElementType(grad_output, type);
+  switch (reduction_mode) {
+    case ReductionMode::kNone:
+      grad = xla::BroadcastInDim(grad, data.sizes, data.label_dims);
+      break;
+    case ReductionMode::kMean:
+      grad = xla::Broadcast(grad / SumAll(data.label_weight), data.sizes);
+      break;
+    case ReductionMode::kSum:
+      grad = xla::Broadcast(grad, data.sizes);
+      break;
+  }
+  xla::XlaOp softmax =
+      xla::Exp(data.logits -
+               xla::BroadcastInDim(xla::ConvertElementType(logsumexp, type),
+                                   data.sizes, data.label_dims));
+  xla::XlaOp one = xla::One(builder, type);
+  xla::XlaOp one_hot =
+      xla::Select(data.one_hot, xla::Broadcast(one, data.sizes),
+                  xla::Broadcast(xla::Zero(builder, type), data.sizes));
+  xla::XlaOp grad_logits =
+      xla::BroadcastInDim(data.label_weight, data.sizes, data.label_dims) *
+      (softmax - one_hot);
+  if (label_smoothing > 0) {
+    xla::XlaOp smooth_grad =
+        softmax * data.weight_sum - (data.weight ? *data.weight : one);
+    smooth_grad =
+        xla::BroadcastInDim(data.valid, data.sizes, data.label_dims) *
+        smooth_grad;
+    grad_logits = grad_logits * XlaHelpers::ScalarValue<double>(
+                                    1.0 - label_smoothing, type, builder) +
+                  smooth_grad * XlaHelpers::ScalarValue<double>(
+                                    label_smoothing / data.num_classes, type,
+                                    builder);
+  }
+  return xla::ConvertElementType(grad * grad_logits,
+                                 XlaHelpers::TypeOfXlaOp(logits));
+}
+
+}  // namespace torch_xla
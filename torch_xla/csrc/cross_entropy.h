@@ -0,0 +1,35 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "torch_xla/csrc/reduction.h"
+
+namespace torch_xla {
+
+struct CrossEntropyOutput {
+  xla::XlaOp loss;
+  // The logsumexp of the logits over the classes, with the shape of the
+  // labels. It is F32 for reduced precision logits.
+  xla::XlaOp logsumexp;
+};
+
+// Builds the cross entropy of the [N, C, d1, ...] (or [C]) logits and the
+// class indices "labels", the same as nll_loss(log_softmax(logits, 1)), out
+// of the logsumexp of the rows, without materializing the log-probabilities.
+CrossEntropyOutput BuildCrossEntropy(xla::XlaOp logits, xla::XlaOp labels,
+                                     const absl::optional<xla::XlaOp>& weight,
+                                     ReductionMode reduction_mode,
+                                     int64_t ignore_index,
+                                     double label_smoothing);
+
+// Builds the gradient of BuildCrossEntropy() with respect to the logits,
+// which is emitted directly as the softmax minus the (smoothed) one-hot
+// labels out of the saved logsumexp.
+xla::XlaOp BuildCrossEntropyBackward(xla::XlaOp grad_output, xla::XlaOp logits,
+                                     xla::XlaOp labels, xla::XlaOp logsumexp,
+                                     const absl::optional<xla::XlaOp>& weight,
+                                     ReductionMode reduction_mode,
+                                     int64_t ignore_index,
+                                     double label_smoothing);
+
+}  // namespace torch_xla
@@ -92,14 +92,17 @@ std::vector<xla::XlaOp> BuildAllReduce(
   // TODO: We use pseudo-tokens ATM, which are real values. This need to be
   // switched to use the real XLA Token once support has been added to XLA
   // AllReduce().
+  bool chain = TokenHandler::ChainCollectives();
   xla::XlaOp chained_token = token;
   ReduceContext redux = GetReduceContext(operands);
   std::vector<xla::XlaOp> result(operands.size());
   for (auto& type_ctx : redux.contexts) {
-    xla::XlaOp token_op = MaybeConvertTo(chained_token, type_ctx.first);
-    type_ctx.second.ops.push_back(token_op);
-    type_ctx.second.operand_shapes.push_back(
-        XlaHelpers::ShapeOfXlaOp(token_op));
+    if (chain) {
+      xla::XlaOp token_op = MaybeConvertTo(chained_token, type_ctx.first);
+      type_ctx.second.ops.push_back(token_op);
+      type_ctx.second.operand_shapes.push_back(
+          XlaHelpers::ShapeOfXlaOp(token_op));
+    }
 
     xla::XlaOp reduce;
     if (pin_layout) {
@@ -125,14 +128,58 @@ std::vector<xla::XlaOp> BuildAllReduce(
       }
       result[op_idx] = gte;
     }
-    chained_token =
-        xla::GetTupleElement(reduce, type_ctx.second.indices.size());
+    if (chain) {
+      chained_token =
+          xla::GetTupleElement(reduce, type_ctx.second.indices.size());
+    }
   }
   result.push_back(
       MaybeConvertTo(chained_token, XlaHelpers::TypeOfXlaOp(token)));
   return result;
 }
 
+CompressedAllReduceResult BuildCompressedAllReduce(
+    xla::XlaOp input, xla::XlaOp residual, xla::XlaOp token, double scale,
+    xla::PrimitiveType wire_type,
+    const std::vector<std::vector<int64_t>>& groups, bool pin_layout) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::PrimitiveType input_type = XlaHelpers::TypeOfXlaOp(input);
+  xla::PrimitiveType f32 = xla::PrimitiveType::F32;
+  xla::XlaOp value = MaybeConvertTo(input, f32) + MaybeConvertTo(residual, f32);
+  // All the replicas must agree on the scale, so the absolute maximums are
+  // reduced first. Scaling the maximum to one keeps the sum of the replicas
+  // within the range of F16.
+  xla::XlaOp amax = xla::ReduceAll(xla::Abs(value), xla::Zero(builder, f32),
+                                   XlaHelpers::CreateMaxComputation(f32));
+  std::vector<xla::XlaOp> amax_reduce = BuildAllReduce(
+      AllReduceType::kMax, {amax}, token, 1.0, groups, pin_layout);
+  xla::XlaOp zero = xla::Zero(builder, f32);
+  xla::XlaOp one = xla::One(builder, f32);
+  xla::XlaOp inv_scale =
+      xla::Select(xla::Gt(amax_reduce[0], zero), amax_reduce[0], one);
+  xla::XlaOp compressed = xla::ConvertElementType(value / inv_scale, wire_type);
+
+  xla::XlaOp lost =
+      value - xla::ConvertElementType(compressed, f32) * inv_scale;
+
+  CompressedAllReduceResult result;
+  result.residual = MaybeConvertTo(lost, XlaHelpers::TypeOfXlaOp(residual));
+  std::vector<xla::XlaOp> reduce = BuildAllReduce(
+      AllReduceType::kSum, {compressed}, amax_reduce[1], 1.0, groups,
+      pin_layout);
+  result.result = MaybeConvertTo(
+      xla::ConvertElementType(reduce[0], f32) *
+          (inv_scale * XlaHelpers::ScalarValue<double>(scale, f32, builder)),
+      input_type);
+  result.token = reduce[1];
+  xla::XlaComputation add = XlaHelpers::CreateAddComputation(f32);
+  xla::XlaOp lost_norm = xla::Sqrt(xla::ReduceAll(lost * lost, zero, add));
+  xla::XlaOp value_norm = xla::Sqrt(xla::ReduceAll(value * value, zero, add));
+  result.error = xla::Select(xla::Gt(value_norm, zero), lost_norm / value_norm,
+                             zero);
+  return result;
+}
+
 AllToAllResult BuildAllToAll(xla::XlaOp input, xla::XlaOp token,
                              int64_t split_dimension, int64_t concat_dimension,
                              int64_t split_count,
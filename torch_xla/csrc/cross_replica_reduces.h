@@ -46,11 +46,27 @@ struct ReduceScatterResult {
   xla::XlaOp token;
 };
 
+struct CompressedAllReduceResult {
+  xla::XlaOp result;
+  xla::XlaOp residual;
+  xla::XlaOp error;
+  xla::XlaOp token;
+};
+
 std::vector<xla::XlaOp> BuildAllReduce(
     AllReduceType reduce_type, absl::Span<const xla::XlaOp> operands,
     xla::XlaOp token, double scale,
     const std::vector<std::vector<int64_t>>& groups, bool pin_layout);
 
+// Sums the input plus the error feedback residual across the replicas in the
+// lower precision wire_type. The values are scaled by the inverse of their
+// absolute maximum across the replicas before the cast. The new residual is
+// what the cast lost, and the error the relative norm of the residual.
+CompressedAllReduceResult BuildCompressedAllReduce(
+    xla::XlaOp input, xla::XlaOp residual, xla::XlaOp token, double scale,
+    xla::PrimitiveType wire_type,
+    const std::vector<std::vector<int64_t>>& groups, bool pin_layout);
+
 AllToAllResult BuildAllToAll(xla::XlaOp input, xla::XlaOp token,
                              int64_t split_dimension, int64_t concat_dimension,
                              int64_t split_count,
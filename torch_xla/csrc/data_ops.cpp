@@ -16,6 +16,7 @@
 #include "torch/csrc/lazy/core/util.h"
 #include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/indexing_cost_model.h"
 #include "torch_xla/csrc/reduction.h"
 #include "torch_xla/csrc/tensor_util.h"
 
@@ -24,6 +25,11 @@ namespace {
 
 bool IsSparseGather(const xla::Shape& input_shape,
                     const xla::Shape& index_shape, int64_t dim) {
+  if (IndexingCostModel::IsEnabled()) {
+    return !IndexingCostModel::PreferDense(
+        GetCurrentDevice(), IndexingCostModel::Op::kGather,
+        input_shape.dimensions(dim), xla::ShapeUtil::ElementsIn(index_shape));
+  }
   // Conservative sparsity check for multi-platform support
   // to avoid gather on a single float on TPU.
   XlaDeviceType hw_type = static_cast<XlaDeviceType>(GetCurrentDevice().type());
@@ -176,18 +182,23 @@ xla::XlaOp BuildRepeat(xla::XlaOp input, absl::Span<const int64_t> repeats) {
       << "Number of dimensions of repeat dims can not be smaller than number "
          "of dimensions of tensor";
   size_t broadcast_dims = repeats.size() - input_sizes.size();
-  xla::XlaOp repeated = input;
+  // Broadcast every input dimension D into a (repeat, D) pair of dimensions,
+  // and merge the pairs with a reshape. Unlike concatenating the copies, this
+  // stays a broadcast which fuses into the consumers.
+  std::vector<int64_t> broadcast_sizes(repeats.begin(),
+                                       repeats.begin() + broadcast_dims);
+  std::vector<int64_t> output_sizes(broadcast_sizes);
+  std::vector<int64_t> broadcast_dimensions;
   for (size_t dim = 0; dim < input_sizes.size(); ++dim) {
-    std::vector<xla::XlaOp> repeated_inputs(repeats[broadcast_dims + dim],
-                                            repeated);
-    repeated = xla::ConcatInDim(input.builder(), repeated_inputs, dim);
-  }
-  if (repeats.size() > input_sizes.size()) {
-    std::vector<int64_t> remaining_repeats(repeats.begin(),
-                                           repeats.begin() + broadcast_dims);
-    repeated = xla::Broadcast(repeated, remaining_repeats);
+    int64_t repeat = repeats[broadcast_dims + dim];
+    broadcast_sizes.push_back(repeat);
+    broadcast_dimensions.push_back(broadcast_sizes.size());
+    broadcast_sizes.push_back(input_sizes[dim]);
+    output_sizes.push_back(repeat * input_sizes[dim]);
   }
-  return repeated;
+  xla::XlaOp repeated =
+      xla::BroadcastInDim(input, broadcast_sizes, broadcast_dimensions);
+  return xla::Reshape(repeated, output_sizes);
 }
 
 size_t ComputeSplitCount(int64_t dim_size,
@@ -239,6 +250,24 @@ xla::XlaOp BuildUpdateSlice(xla::XlaOp input, xla::XlaOp source,
   return xla::DynamicUpdateSlice(input, reshaped_source, start_indices);
 }
 
+xla::XlaOp BuildDynamicUpdateSlice(xla::XlaOp input, xla::XlaOp source,
+                                   xla::XlaOp offset, int64_t dim) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  const xla::Shape& source_shape = XlaHelpers::ShapeOfXlaOp(source);
+  XLA_CHECK_EQ(source_shape.rank(), input_shape.rank())
+      << source_shape << " vs. " << input_shape;
+  xla::XlaOp update_source = source;
+  if (source_shape.element_type() != input_shape.element_type()) {
+    update_source = ConvertTo(source, source_shape.element_type(),
+                              input_shape.element_type(), /*device=*/nullptr);
+  }
+  std::vector<xla::XlaOp> start_indices(
+      input_shape.rank(), XlaHelpers::ScalarValue<int64_t>(0, input.builder()));
+  start_indices[dim] = xla::ConvertElementType(xla::Reshape(offset, {}),
+                                               xla::PrimitiveType::S64);
+  return xla::DynamicUpdateSlice(input, update_source, start_indices);
+}
+
 xla::XlaOp BuildSlice(xla::XlaOp input, absl::Span<const int64_t> base_indices,
                       absl::Span<const int64_t> sizes) {
   XLA_CHECK_EQ(base_indices.size(), sizes.size());
@@ -72,6 +72,12 @@ std::vector<xla::XlaOp> BuildSplit(xla::XlaOp input,
 xla::XlaOp BuildUpdateSlice(xla::XlaOp input, xla::XlaOp source,
                             absl::Span<const int64_t> base_indices);
 
+// Same as above, with the start index of dimension dim given by the scalar
+// integer offset computed on device, so that the graph does not change with
+// its value.
+xla::XlaOp BuildDynamicUpdateSlice(xla::XlaOp input, xla::XlaOp source,
+                                   xla::XlaOp offset, int64_t dim);
+
 xla::XlaOp BuildSlice(xla::XlaOp input, absl::Span<const int64_t> base_indices,
                       absl::Span<const int64_t> sizes);
 
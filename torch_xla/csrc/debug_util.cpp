@@ -1,15 +1,28 @@
 #include "torch_xla/csrc/debug_util.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
 #include <fstream>
+#include <map>
 #include <mutex>
 #include <sstream>
 #include <unordered_set>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 #include "tensorflow/compiler/xla/xla_client/unique.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
 #include "torch/csrc/lazy/core/hash.h"
 #include "torch/csrc/lazy/python/python_util.h"
 #include "torch_xla/csrc/device.h"
@@ -29,6 +42,8 @@ DebugUtil::GraphFormat DefaultGraphFormat() {
     return DebugUtil::GraphFormat::kHlo;
   } else if (fmt_str == "dot") {
     return DebugUtil::GraphFormat::kDot;
+  } else if (fmt_str == "hlo_proto") {
+    return DebugUtil::GraphFormat::kHloProto;
   }
   XLA_ERROR() << "Invalid save graph format: " << fmt_str;
 }
@@ -44,42 +59,40 @@ std::unordered_set<std::string>* LoadExperiments() {
   return xset.release();
 }
 
-}  // namespace
-
-DebugUtil::GraphFormat DebugUtil::GetDefaultGraphFormat() {
-  static GraphFormat format = DefaultGraphFormat();
-  return format;
-}
-
-std::string DebugUtil::GetTensorsGraphInfo(
-    absl::Span<const XLATensorPtr> tensors, const std::vector<size_t>* indices,
-    GraphFormat format) {
-  std::vector<const torch::lazy::Node*> root_nodes;
-  std::vector<torch::lazy::Value> root_values;
-  std::vector<torch::lazy::hash_t> root_hashes;
+// The root nodes, values and hashes of the IR graph of the tensors.
+struct GraphRoots {
+  std::vector<const torch::lazy::Node*> nodes;
+  std::vector<torch::lazy::Value> values;
+  std::vector<torch::lazy::hash_t> hashes;
   xla::util::Unique<torch::lazy::BackendDevice> unique_device;
+};
+
+GraphRoots GetGraphRoots(absl::Span<const XLATensorPtr> tensors,
+                         const std::vector<size_t>* indices) {
+  GraphRoots roots;
+  auto add_root = [&](const XLATensorPtr& tensor) {
+    torch::lazy::Value ir_value = tensor->CurrentIrValue();
+    if (ir_value) {
+      roots.nodes.push_back(ir_value.node.get());
+      roots.hashes.push_back(ir_value.hash());
+      roots.values.push_back(std::move(ir_value));
+      roots.unique_device.set(tensor->GetDevice());
+    }
+  };
   if (indices != nullptr) {
     for (auto index : *indices) {
-      const XLATensorPtr& tensor = tensors[index];
-      torch::lazy::Value ir_value = tensor->CurrentIrValue();
-      if (ir_value) {
-        root_nodes.push_back(ir_value.node.get());
-        root_hashes.push_back(ir_value.hash());
-        root_values.push_back(std::move(ir_value));
-        unique_device.set(tensor->GetDevice());
-      }
+      add_root(tensors[index]);
     }
   } else {
     for (auto& tensor : tensors) {
-      torch::lazy::Value ir_value = tensor->CurrentIrValue();
-      if (ir_value) {
-        root_nodes.push_back(ir_value.node.get());
-        root_hashes.push_back(ir_value.hash());
-        root_values.push_back(std::move(ir_value));
-        unique_device.set(tensor->GetDevice());
-      }
+      add_root(tensor);
     }
   }
+  return roots;
+}
+
+// The current Python frames and the root hashes.
+std::string GetGraphInfoHeader(const GraphRoots& roots) {
   std::stringstream ss;
   std::vector<torch::lazy::SourceLocation> frames =
       torch::lazy::GetPythonFrames();
@@ -89,42 +102,425 @@ std::string DebugUtil::GetTensorsGraphInfo(
        << location.line << ")\n";
   }
   ss << "\nHashes: (";
-  for (size_t i = 0; i < root_hashes.size(); ++i) {
+  for (size_t i = 0; i < roots.hashes.size(); ++i) {
     if (i > 0) {
       ss << ", ";
     }
-    ss << torch::lazy::HashToString(root_hashes[i]);
+    ss << torch::lazy::HashToString(roots.hashes[i]);
   }
   ss << ")\n";
+  return ss.str();
+}
 
-  std::string graph_str;
-  if (format == GraphFormat::kText) {
-    graph_str = DumpUtil::ToText(root_nodes);
-  } else if (format == GraphFormat::kDot) {
-    graph_str = DumpUtil::ToDot(root_nodes);
-  } else if (format == GraphFormat::kHlo) {
-    graph_str = DumpUtil::ToHlo(
-        root_values, unique_device ? *unique_device : GetCurrentDevice());
-  } else {
-    XLA_ERROR() << "Invalid graph format: " << format;
+std::string GetGraphString(const GraphRoots& roots,
+                           DebugUtil::GraphFormat format) {
+  const torch::lazy::BackendDevice& device =
+      roots.unique_device ? *roots.unique_device : GetCurrentDevice();
+  switch (format) {
+    case DebugUtil::GraphFormat::kText:
+      return DumpUtil::ToText(roots.nodes);
+    case DebugUtil::GraphFormat::kDot:
+      return DumpUtil::ToDot(roots.nodes);
+    case DebugUtil::GraphFormat::kHlo:
+      return DumpUtil::ToHlo(roots.values, device);
+    case DebugUtil::GraphFormat::kHloProto:
+      return DumpUtil::ToHloProto(roots.values, device);
+  }
+  XLA_ERROR() << "Invalid graph format: " << format;
+}
+
+// Writes the reports of SaveTensorsGraphInfo() to the XLA_SAVE_TENSORS_FILE
+// file from the IO thread pool, in order, so that the sync path only pays for
+// building them. With the hlo_proto format the file is a TFRecord one, where
+// every graph is a record with the report header (name, hashes and Python
+// frames), followed by a record with the serialized xla::HloModuleProto.
+class GraphInfoWriter {
+ public:
+  static GraphInfoWriter* Get() {
+    static GraphInfoWriter* writer = []() -> GraphInfoWriter* {
+      std::string path =
+          xla::sys_util::GetEnvOrdinalPath("XLA_SAVE_TENSORS_FILE", "");
+      if (path.empty()) {
+        return nullptr;
+      }
+      bool records = DebugUtil::GetDefaultGraphFormat() ==
+                     DebugUtil::GraphFormat::kHloProto;
+      return new GraphInfoWriter(
+          std::move(path), records,
+          xla::sys_util::GetEnvBool("XLA_SAVE_TENSORS_UNIQUE", records));
+    }();
+    return writer;
+  }
+
+  GraphInfoWriter(std::string path, bool records, bool unique)
+      : path_(std::move(path)), records_(records), unique_(unique) {}
+
+  bool unique() const { return unique_; }
+
+  // Returns false if a graph with the given hash was already saved.
+  bool MarkSaved(const torch::lazy::hash_t& hash) {
+    std::lock_guard<std::mutex> lock(lock_);
+    return saved_.insert(hash).second;
+  }
+
+  // Queues the chunks of a report, which are written one after the other, or
+  // as separate records.
+  void Write(std::vector<std::string> chunks) {
+    std::lock_guard<std::mutex> lock(lock_);
+    queue_.push_back(std::move(chunks));
+    if (!draining_) {
+      draining_ = true;
+      xla::env::ScheduleIoClosure([this]() { Drain(); });
+    }
+  }
+
+  void Flush() {
+    std::unique_lock<std::mutex> lock(lock_);
+    cv_.wait(lock, [this] { return !draining_; });
+  }
+
+ private:
+  void Drain() {
+    std::unique_lock<std::mutex> lock(lock_);
+    while (!queue_.empty()) {
+      std::deque<std::vector<std::string>> reports;
+      reports.swap(queue_);
+      lock.unlock();
+      try {
+        WriteReports(reports);
+      } catch (const std::exception& ex) {
+        TF_LOG(ERROR) << "Unable to save the tensors graphs to " << path_
+                      << ": " << ex.what();
+      }
+      lock.lock();
+    }
+    draining_ = false;
+    cv_.notify_all();
+  }
+
+  void WriteReports(const std::deque<std::vector<std::string>>& reports) {
+    XLA_TIMED("SaveTensorsGraphInfo");
+    if (!records_) {
+      std::ofstream graph_file(path_, std::ios_base::app);
+      for (auto& chunks : reports) {
+        for (auto& chunk : chunks) {
+          graph_file << chunk;
+        }
+      }
+      return;
+    }
+    // Only touched by the single draining closure.
+    if (record_writer_ == nullptr) {
+      XLA_CHECK_OK(
+          tensorflow::Env::Default()->NewAppendableFile(path_, &file_));
+      record_writer_ = absl::make_unique<tensorflow::io::RecordWriter>(
+          file_.get());
+    }
+    for (auto& chunks : reports) {
+      for (auto& chunk : chunks) {
+        XLA_CHECK_OK(record_writer_->WriteRecord(chunk));
+      }
+    }
+    XLA_CHECK_OK(record_writer_->Flush());
+  }
+
+  std::string path_;
+  bool records_;
+  bool unique_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::deque<std::vector<std::string>> queue_;
+  bool draining_ = false;
+  std::unordered_set<torch::lazy::hash_t, torch::lazy::HashReducer> saved_;
+  std::unique_ptr<tensorflow::WritableFile> file_;
+  std::unique_ptr<tensorflow::io::RecordWriter> record_writer_;
+};
+
+// What is kept of a node of the graphs compiled for a device, to compare the
+// following ones with. The full description only gets built for the nodes of
+// the graph being compiled, so that the fingerprint stays small.
+struct NodeSignature {
+  torch::lazy::hash_t hash;
+  torch::lazy::OpKind op;
+  absl::optional<xla::Shape> shape;
+  // The innermost Python frame which created the node, with XLA_IR_DEBUG.
+  std::string location;
+};
+
+struct GraphSignature {
+  torch::lazy::hash_t hash;
+  std::vector<NodeSignature> nodes;
+  std::vector<size_t> parameter_sequence;
+};
+
+// The recent graphs compiled for every device, with the most recent last, and
+// the last divergence reports.
+struct GraphHistory {
+  std::mutex lock;
+  std::map<std::string, std::deque<GraphSignature>> graphs;
+  std::deque<std::string> reports;
+};
+
+GraphHistory* GetGraphHistory() {
+  static GraphHistory* history = new GraphHistory();
+  return history;
+}
+
+std::string DescribeNode(const torch::lazy::Node* node) {
+  std::stringstream ss;
+  ss << "  " << node->ToString() << "\n";
+  const torch::lazy::MetaData& nmeta = node->metadata();
+  if (!nmeta.scope.empty()) {
+    ss << "  Scope: " << nmeta.scope << "\n";
+  }
+  for (auto& location : GetFrameInfo(node)) {
+    ss << "    " << location.function << " (" << location.file << ":"
+       << location.line << ")\n";
+  }
+  return ss.str();
+}
+
+std::string DescribeNodeSignature(const NodeSignature& node) {
+  std::stringstream ss;
+  ss << "  " << node.op.ToString();
+  if (node.shape) {
+    ss << " " << *node.shape;
+  }
+  ss << "\n";
+  if (!node.location.empty()) {
+    ss << "    " << node.location << "\n";
   }
-  ss << "\n## BEGIN_GRAPH\n" << graph_str << "\n## END_GRAPH\n\n";
   return ss.str();
 }
 
+GraphSignature MakeGraphSignature(
+    const torch::lazy::hash_t& hash,
+    absl::Span<const torch::lazy::Node* const> post_order,
+    absl::Span<const size_t> parameter_sequence) {
+  GraphSignature graph;
+  graph.hash = hash;
+  graph.nodes.reserve(post_order.size());
+  for (auto node : post_order) {
+    // The node hash only covers the node itself, so the first mismatch in post
+    // order points to the node which changed, and not to all its users.
+    const XlaNode* xla_node = dynamic_cast<const XlaNode*>(node);
+    torch::lazy::hash_t node_hash =
+        xla_node != nullptr ? xla_node->node_hash() : node->hash();
+    NodeSignature node_signature;
+    node_signature.hash =
+        torch::lazy::HashCombine(node_hash, node->operands().size());
+    node_signature.op = node->op();
+    if (xla_node != nullptr) {
+      node_signature.shape = xla_node->xla_shape();
+    }
+    const std::vector<torch::lazy::SourceLocation>& frames =
+        GetFrameInfo(node);
+    if (!frames.empty()) {
+      node_signature.location =
+          absl::StrCat(frames.front().function, " (", frames.front().file, ":",
+                       frames.front().line, ")");
+    }
+    graph.nodes.push_back(std::move(node_signature));
+  }
+  graph.parameter_sequence.assign(parameter_sequence.begin(),
+                                  parameter_sequence.end());
+  return graph;
+}
+
+size_t CommonPrefixSize(const GraphSignature& graph1,
+                        const GraphSignature& graph2) {
+  size_t num_nodes = std::min(graph1.nodes.size(), graph2.nodes.size());
+  size_t i = 0;
+  while (i < num_nodes && graph1.nodes[i].hash == graph2.nodes[i].hash) {
+    ++i;
+  }
+  return i;
+}
+
+std::string GetNodeChange(const NodeSignature& previous,
+                          const NodeSignature& current) {
+  if (previous.op != current.op) {
+    return absl::StrCat("The operation changed from ", previous.op.ToString(),
+                        " to ", current.op.ToString(), ".\n");
+  }
+  if (previous.shape && current.shape && *previous.shape != *current.shape) {
+    if (previous.shape->element_type() != current.shape->element_type()) {
+      return absl::StrCat("The type changed from ",
+                          xla::primitive_util::LowercasePrimitiveTypeName(
+                              previous.shape->element_type()),
+                          " to ",
+                          xla::primitive_util::LowercasePrimitiveTypeName(
+                              current.shape->element_type()),
+                          ".\n");
+    }
+    return absl::StrCat("The shape changed from ", previous.shape->ToString(),
+                        " to ", current.shape->ToString(), ".\n");
+  }
+  return "The operation and shape are the same, while its attributes (like "
+         "the value of a scalar) or its number of operands changed.\n";
+}
+
+std::string GetGraphDivergence(
+    const GraphSignature& previous, const GraphSignature& current,
+    absl::Span<const torch::lazy::Node* const> post_order) {
+  size_t num_nodes = CommonPrefixSize(previous, current);
+  if (num_nodes < previous.nodes.size() && num_nodes < current.nodes.size()) {
+    return absl::StrCat(
+        "IR node ", num_nodes, " (in post order) is:\n",
+        DescribeNode(post_order[num_nodes]), "while it was:\n",
+        DescribeNodeSignature(previous.nodes[num_nodes]),
+        GetNodeChange(previous.nodes[num_nodes], current.nodes[num_nodes]));
+  }
+  if (previous.nodes.size() != current.nodes.size()) {
+    std::string unmatched =
+        current.nodes.size() > num_nodes
+            ? DescribeNode(post_order[num_nodes])
+            : DescribeNodeSignature(previous.nodes[num_nodes]);
+    return absl::StrCat("The graph has ", current.nodes.size(),
+                        " IR nodes while it had ", previous.nodes.size(),
+                        ", the first unmatched node being:\n", unmatched);
+  }
+  for (size_t i = 0; i < current.parameter_sequence.size() &&
+                     i < previous.parameter_sequence.size();
+       ++i) {
+    if (previous.parameter_sequence[i] != current.parameter_sequence[i]) {
+      return absl::StrCat(
+          "The device data node ", i, " maps to parameter ",
+          current.parameter_sequence[i], " while it mapped to parameter ",
+          previous.parameter_sequence[i],
+          " (device data got shared, or stopped being shared, by the graph)");
+    }
+  }
+  return "The IR nodes are the same, while the roots (or their order) or the "
+         "sync configuration differ";
+}
+
+}  // namespace
+
+DebugUtil::GraphFormat DebugUtil::GetDefaultGraphFormat() {
+  static GraphFormat format = DefaultGraphFormat();
+  return format;
+}
+
+std::string DebugUtil::GetTensorsGraphInfo(
+    absl::Span<const XLATensorPtr> tensors, const std::vector<size_t>* indices,
+    GraphFormat format) {
+  GraphRoots roots = GetGraphRoots(tensors, indices);
+  return absl::StrCat(GetGraphInfoHeader(roots), "\n## BEGIN_GRAPH\n",
+                      GetGraphString(roots, format), "\n## END_GRAPH\n\n");
+}
+
 void DebugUtil::SaveTensorsGraphInfo(const char* name,
                                      absl::Span<const XLATensorPtr> tensors,
                                      const std::vector<size_t>* indices,
-                                     GraphFormat format) {
-  static const std::string save_file =
-      xla::sys_util::GetEnvOrdinalPath("XLA_SAVE_TENSORS_FILE", "");
-  if (!save_file.empty()) {
-    static std::mutex lock;
-    std::string info = GetTensorsGraphInfo(tensors, indices, format);
-    std::lock_guard<std::mutex> guard(lock);
-    std::ofstream graph_file(save_file, std::ios_base::app);
-    graph_file << "[" << name << "]\n" << info << "\n";
+                                     GraphFormat format,
+                                     const torch::lazy::hash_t* graph_hash) {
+  GraphInfoWriter* writer = GraphInfoWriter::Get();
+  if (writer == nullptr) {
+    return;
+  }
+  GraphRoots roots = GetGraphRoots(tensors, indices);
+  if (writer->unique()) {
+    // The graph hash, when present, already covers the roots.
+    torch::lazy::hash_t hash = torch::lazy::Hash(std::string(name));
+    if (graph_hash != nullptr) {
+      hash = torch::lazy::HashCombine(hash, *graph_hash);
+    } else {
+      for (auto& root_hash : roots.hashes) {
+        hash = torch::lazy::HashCombine(hash, root_hash);
+      }
+    }
+    if (!writer->MarkSaved(hash)) {
+      return;
+    }
+  }
+  std::string header = absl::StrCat("[", name, "]\n");
+  if (graph_hash != nullptr) {
+    absl::StrAppend(&header, "Graph Hash: ",
+                    torch::lazy::HashToString(*graph_hash), "\n");
+  }
+  absl::StrAppend(&header, GetGraphInfoHeader(roots));
+  if (format == GraphFormat::kHloProto) {
+    writer->Write({std::move(header), GetGraphString(roots, format)});
+  } else {
+    writer->Write(
+        {absl::StrCat(header, "\n## BEGIN_GRAPH\n",
+                      GetGraphString(roots, format), "\n## END_GRAPH\n\n\n")});
+  }
+}
+
+void DebugUtil::FlushTensorsGraphInfo() {
+  GraphInfoWriter* writer = GraphInfoWriter::Get();
+  if (writer != nullptr) {
+    writer->Flush();
+  }
+}
+
+void DebugUtil::ReportGraphHashDivergence(
+    const torch::lazy::BackendDevice& device, const torch::lazy::hash_t& hash,
+    absl::Span<const torch::lazy::Node* const> post_order,
+    absl::Span<const size_t> parameter_sequence) {
+  static const bool log_report =
+      xla::sys_util::GetEnvBool("XLA_GRAPH_HASH_DIVERGENCE", false);
+  static const size_t max_graphs =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_HASH_HISTORY", 8);
+  static const size_t kMaxReports = 32;
+  if (max_graphs == 0) {
+    return;
+  }
+  GraphSignature graph =
+      MakeGraphSignature(hash, post_order, parameter_sequence);
+  GraphHistory* history = GetGraphHistory();
+  std::lock_guard<std::mutex> guard(history->lock);
+  std::deque<GraphSignature>& graphs = history->graphs[device.toString()];
+  // The graph the new one diverges from is the recent one with the longest
+  // common post order prefix, the most recent one among equals.
+  const GraphSignature* closest = nullptr;
+  size_t closest_prefix = 0;
+  for (auto it = graphs.rbegin(); it != graphs.rend(); ++it) {
+    size_t prefix = CommonPrefixSize(*it, graph);
+    if (closest == nullptr || prefix > closest_prefix) {
+      closest = &*it;
+      closest_prefix = prefix;
+    }
+  }
+  if (closest != nullptr) {
+    XLA_COUNTER("GraphHashDivergence", 1);
+    std::stringstream ss;
+    ss << "Graph hash " << torch::lazy::HashToString(hash) << " compiled for "
+       << device;
+    if (closest->hash == hash) {
+      ss << " was compiled before, and got evicted from the compilation "
+            "cache (see XLA_COMPILATION_CACHE_SIZE).\n";
+    } else {
+      ss << " diverges from the one of hash "
+         << torch::lazy::HashToString(closest->hash) << ":\n"
+         << GetGraphDivergence(*closest, graph, post_order);
+    }
+    ss << "Synced from:\n";
+    for (auto& location : torch::lazy::GetPythonFrames()) {
+      ss << "  " << location.function << " (" << location.file << ":"
+         << location.line << ")\n";
+    }
+    if (log_report) {
+      TF_LOG(INFO) << ss.str();
+    }
+    history->reports.push_back(ss.str());
+    if (history->reports.size() > kMaxReports) {
+      history->reports.pop_front();
+    }
   }
+  graphs.push_back(std::move(graph));
+  if (graphs.size() > max_graphs) {
+    graphs.pop_front();
+  }
+}
+
+std::vector<std::string> DebugUtil::GetGraphHashDivergences() {
+  GraphHistory* history = GetGraphHistory();
+  std::lock_guard<std::mutex> guard(history->lock);
+  return std::vector<std::string>(history->reports.begin(),
+                                  history->reports.end());
 }
 
 bool DebugUtil::ExperimentEnabled(const std::string& name) {
@@ -15,6 +15,8 @@ class DebugUtil {
     kText,
     kDot,
     kHlo,
+    // The binary xla::HloModuleProto.
+    kHloProto,
   };
 
   static GraphFormat GetDefaultGraphFormat();
@@ -29,11 +31,31 @@ class DebugUtil {
 
   // If the environment variable XLA_SAVE_TENSORS_FILE is set to the proper
   // output path, an instance of the report returned by GetTensorsGraphInfo() is
-  // saved.
+  // saved. If graph_hash is not nullptr, the report starts with the hash the
+  // graph is compiled and profiled with. The report is built by the caller,
+  // and written to the file in background. With XLA_SAVE_TENSORS_UNIQUE, the
+  // graphs already saved (by graph hash) are skipped.
   static void SaveTensorsGraphInfo(
       const char* name, absl::Span<const XLATensorPtr> tensors,
       const std::vector<size_t>* indices,
-      GraphFormat format = GetDefaultGraphFormat());
+      GraphFormat format = GetDefaultGraphFormat(),
+      const torch::lazy::hash_t* graph_hash = nullptr);
+
+  // Waits for the reports of SaveTensorsGraphInfo() to be written.
+  static void FlushTensorsGraphInfo();
+
+  // Compares the graph about to be compiled for a device with the most similar
+  // of the last XLA_GRAPH_HASH_HISTORY ones compiled for it, and reports the
+  // first IR node (in post order) at which they diverge, which is the one to
+  // look at to understand the recompilation. The reports get logged if the
+  // environment variable XLA_GRAPH_HASH_DIVERGENCE is set to 1.
+  static void ReportGraphHashDivergence(
+      const torch::lazy::BackendDevice& device, const torch::lazy::hash_t& hash,
+      absl::Span<const torch::lazy::Node* const> post_order,
+      absl::Span<const size_t> parameter_sequence);
+
+  // Returns the last reports of ReportGraphHashDivergence(), oldest first.
+  static std::vector<std::string> GetGraphHashDivergences();
 
   static bool ExperimentEnabled(const std::string& name);
 };
@@ -0,0 +1,384 @@
+#include "torch_xla/csrc/embedding_ops.h"
+
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/reduction.h"
+
+namespace torch_xla {
+namespace {
+
+struct SegmentSumResult {
+  // The distinct indices in increasing order, followed by increasing out of
+  // bounds entries (dropped by the scatters). The entries are all distinct, so
+  // the scatters can take them as unique indices.
+  xla::XlaOp indices;
+  // The sum of the rows of every distinct index.
+  xla::XlaOp rows;
+  // The number of rows of every distinct index.
+  xla::XlaOp counts;
+};
+
+// Scatters the rows of updates at the rank 1 row_indices of buffer. Out of
+// bounds indices are dropped.
+xla::XlaOp ScatterRows(xla::XlaOp buffer, xla::XlaOp row_indices,
+                       xla::XlaOp updates, const xla::XlaComputation& combiner,
+                       bool indices_are_sorted, bool unique_indices) {
+  int64_t rank = XlaHelpers::ShapeOfXlaOp(buffer).rank();
+  xla::ScatterDimensionNumbers dim_numbers;
+  dim_numbers.set_index_vector_dim(1);
+  for (int64_t dim = 1; dim < rank; ++dim) {
+    dim_numbers.add_update_window_dims(dim);
+  }
+  dim_numbers.add_inserted_window_dims(0);
+  dim_numbers.add_scatter_dims_to_operand_dims(0);
+  return xla::Scatter(buffer, row_indices, updates, combiner, dim_numbers,
+                      indices_are_sorted, unique_indices);
+}
+
+// Adds every element [b, d] of the rank 2 updates to the element
+// [row_indices[b, d], d] of buffer. Out of bounds indices are dropped.
+xla::XlaOp ScatterAddElements(xla::XlaOp buffer, xla::XlaOp row_indices,
+                              xla::XlaOp updates) {
+  const xla::Shape& indices_shape = XlaHelpers::ShapeOfXlaOp(row_indices);
+  xla::XlaBuilder* builder = buffer.builder();
+  xla::Shape index_shape = xla::ShapeUtil::MakeShape(
+      indices_shape.element_type(),
+      {indices_shape.dimensions(0), indices_shape.dimensions(1), 1});
+  xla::XlaOp element_indices = xla::ConcatInDim(
+      builder,
+      {xla::Reshape(row_indices, index_shape.dimensions()),
+       xla::Iota(builder, index_shape, 1)},
+      2);
+  xla::ScatterDimensionNumbers dim_numbers;
+  dim_numbers.set_index_vector_dim(2);
+  dim_numbers.add_inserted_window_dims(0);
+  dim_numbers.add_inserted_window_dims(1);
+  dim_numbers.add_scatter_dims_to_operand_dims(0);
+  dim_numbers.add_scatter_dims_to_operand_dims(1);
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(buffer);
+  return xla::Scatter(buffer, element_indices, updates,
+                      xla::CreateScalarAddComputation(type, builder),
+                      dim_numbers);
+}
+
+xla::XlaOp BroadcastRows(xla::XlaOp values, absl::Span<const int64_t> sizes) {
+  return xla::BroadcastInDim(values, sizes, {0});
+}
+
+// Sums the [num_indices, dim] rows sharing the same index. The indices are
+// sorted first, so that the rows get reduced in place by a sorted segment sum,
+// instead of a scatter with colliding updates over the whole weight.
+SegmentSumResult BuildSortedSegmentSum(xla::XlaOp indices, xla::XlaOp rows,
+                                       int64_t num_weights,
+                                       int64_t padding_idx) {
+  const xla::Shape& indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
+  const xla::Shape& rows_shape = XlaHelpers::ShapeOfXlaOp(rows);
+  xla::PrimitiveType index_type = indices_shape.element_type();
+  int64_t num_indices = indices_shape.dimensions(0);
+  xla::XlaBuilder* builder = indices.builder();
+  xla::XlaOp sentinel = xla::Broadcast(
+      XlaHelpers::ScalarValue<int64_t>(num_weights, index_type, builder),
+      {num_indices});
+  if (padding_idx >= 0) {
+    // The padding indices are moved out of bounds, so that they get no
+    // gradient.
+    indices = xla::Select(
+        xla::Eq(indices, XlaHelpers::ScalarValue<int64_t>(
+                             padding_idx, index_type, builder)),
+        sentinel, indices);
+  }
+  xla::XlaOp positions =
+      xla::Iota(builder, xla::PrimitiveType::S32, num_indices);
+  xla::XlaOp sorted = xla::Sort(
+      {indices, positions},
+      xla::CreateScalarLtComputation({index_type, xla::PrimitiveType::S32},
+                                     builder),
+      /*dimension=*/0, /*is_stable=*/true);
+  xla::XlaOp sorted_indices = xla::GetTupleElement(sorted, 0);
+  xla::XlaOp sorted_rows =
+      xla::TorchIndexSelect(rows, xla::GetTupleElement(sorted, 1), 0);
+
+  // Every run of equal sorted indices is a segment, numbered by the prefix sum
+  // of the segment starts.
+  xla::XlaOp previous = xla::ConcatInDim(
+      builder,
+      {xla::Broadcast(
+           XlaHelpers::ScalarValue<int64_t>(-1, index_type, builder), {1}),
+       xla::SliceInDim(sorted_indices, 0, num_indices - 1, 1, 0)},
+      0);
+  xla::XlaOp zero_s32 = xla::Zero(builder, xla::PrimitiveType::S32);
+  xla::XlaOp segments =
+      BuildCumulativeComputation(
+          xla::ConvertElementType(xla::Ne(sorted_indices, previous),
+                                  xla::PrimitiveType::S32),
+          0, xla::CreateScalarAddComputation(xla::PrimitiveType::S32, builder),
+          zero_s32) -
+      xla::One(builder, xla::PrimitiveType::S32);
+
+  SegmentSumResult result;
+  result.rows = ScatterRows(
+      xla::Broadcast(xla::Zero(builder, rows_shape.element_type()),
+                     rows_shape.dimensions()),
+      segments, sorted_rows,
+      xla::CreateScalarAddComputation(rows_shape.element_type(), builder),
+      /*indices_are_sorted=*/true, /*unique_indices=*/false);
+  result.indices = ScatterRows(
+      sentinel, segments, sorted_indices,
+      xla::CreateScalarMinComputation(index_type, builder),
+      /*indices_are_sorted=*/true, /*unique_indices=*/false);
+  // The padding segment and the unused trailing entries all hold num_weights,
+  // which gets replaced by num_weights plus the position of the entry.
+  result.indices =
+      xla::Select(xla::Ge(result.indices, sentinel),
+                  sentinel + xla::Iota(builder, index_type, num_indices),
+                  result.indices);
+  result.counts = ScatterRows(
+      xla::Broadcast(zero_s32, {num_indices}), segments,
+      xla::Broadcast(xla::One(builder, xla::PrimitiveType::S32),
+                     {num_indices}),
+      xla::CreateScalarAddComputation(xla::PrimitiveType::S32, builder),
+      /*indices_are_sorted=*/true, /*unique_indices=*/false);
+  return result;
+}
+
+// Same as BuildEmbeddingBag(), with S32 offset2bag, bag_size and max_indices.
+EmbeddingBagResult BuildEmbeddingBagS32(
+    xla::XlaOp weight, xla::XlaOp indices, xla::XlaOp offsets,
+    const absl::optional<xla::XlaOp>& per_sample_weights,
+    EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx) {
+  const xla::Shape& weight_shape = XlaHelpers::ShapeOfXlaOp(weight);
+  const xla::Shape& indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
+  const xla::Shape& offsets_shape = XlaHelpers::ShapeOfXlaOp(offsets);
+  XLA_CHECK_EQ(weight_shape.rank(), 2) << weight_shape;
+  XLA_CHECK_EQ(indices_shape.rank(), 1) << indices_shape;
+  XLA_CHECK_EQ(offsets_shape.rank(), 1) << offsets_shape;
+  xla::PrimitiveType type = weight_shape.element_type();
+  xla::PrimitiveType index_type = indices_shape.element_type();
+  int64_t num_indices = indices_shape.dimensions(0);
+  int64_t dim = weight_shape.dimensions(1);
+  int64_t num_bags =
+      offsets_shape.dimensions(0) - (include_last_offset ? 1 : 0);
+  XLA_CHECK_GE(num_bags, 0);
+  xla::XlaBuilder* builder = weight.builder();
+  xla::XlaOp zero_s32 = xla::Zero(builder, xla::PrimitiveType::S32);
+  xla::XlaOp one_s32 = xla::One(builder, xla::PrimitiveType::S32);
+  xla::XlaComputation add_s32 =
+      xla::CreateScalarAddComputation(xla::PrimitiveType::S32, builder);
+
+  // The bag of every index is the number of bag starts up to it, minus one.
+  // The offsets of the trailing empty bags are out of bounds, and dropped.
+  xla::XlaOp bag_starts =
+      ScatterRows(xla::Broadcast(zero_s32, {num_indices}),
+                  xla::SliceInDim(offsets, 0, num_bags, 1, 0),
+                  xla::Broadcast(one_s32, {num_bags}), add_s32,
+                  /*indices_are_sorted=*/true, /*unique_indices=*/false);
+  EmbeddingBagResult result;
+  result.offset2bag =
+      BuildCumulativeComputation(bag_starts, 0, add_s32, zero_s32) - one_s32;
+
+  xla::XlaOp valid =
+      padding_idx >= 0
+          ? xla::Ne(indices, XlaHelpers::ScalarValue<int64_t>(
+                                 padding_idx, index_type, builder))
+          : xla::Broadcast(xla::ConstantR0<bool>(builder, true), {num_indices});
+  xla::XlaOp valid_rows = BroadcastRows(valid, {num_indices, dim});
+  xla::XlaOp rows = xla::TorchIndexSelect(weight, indices, 0);
+  if (per_sample_weights) {
+    rows = rows * BroadcastRows(xla::ConvertElementType(*per_sample_weights,
+                                                        type),
+                                {num_indices, dim});
+  }
+  result.bag_size = ScatterRows(
+      xla::Broadcast(zero_s32, {num_bags}), result.offset2bag,
+      xla::ConvertElementType(valid, xla::PrimitiveType::S32), add_s32,
+      /*indices_are_sorted=*/true, /*unique_indices=*/false);
+
+  xla::XlaOp zero = xla::Zero(builder, type);
+  if (mode == EmbeddingBagMode::kMax) {
+    xla::XlaOp lowest = xla::MinValue(builder, type);
+    xla::XlaOp valid_or_lowest = xla::Select(
+        valid_rows, rows, xla::Broadcast(lowest, {num_indices, dim}));
+    xla::XlaOp bag_max = ScatterRows(
+        xla::Broadcast(lowest, {num_bags, dim}), result.offset2bag,
+        valid_or_lowest,
+        xla::CreateScalarMaxComputation(type, builder),
+        /*indices_are_sorted=*/true, /*unique_indices=*/false);
+    xla::XlaOp empty_bags = BroadcastRows(
+        xla::Eq(result.bag_size, zero_s32), {num_bags, dim});
+    result.output =
+        xla::Select(empty_bags, xla::Broadcast(zero, {num_bags, dim}), bag_max);
+    // Like the CPU kernel, the first index reaching the maximum of a bag wins.
+    xla::XlaOp num_indices_s32 = XlaHelpers::ScalarValue<int64_t>(
+        num_indices, xla::PrimitiveType::S32, builder);
+    xla::XlaOp is_max = xla::And(
+        valid_rows,
+        xla::Eq(rows, xla::TorchIndexSelect(bag_max, result.offset2bag, 0)));
+    xla::XlaOp first_max = ScatterRows(
+        xla::Broadcast(num_indices_s32, {num_bags, dim}), result.offset2bag,
+        xla::Select(is_max,
+                    xla::Iota(builder,
+                              xla::ShapeUtil::MakeShape(
+                                  xla::PrimitiveType::S32, {num_indices, dim}),
+                              0),
+                    xla::Broadcast(num_indices_s32, {num_indices, dim})),
+        xla::CreateScalarMinComputation(xla::PrimitiveType::S32, builder),
+        /*indices_are_sorted=*/true, /*unique_indices=*/false);
+    xla::XlaOp max_indices = xla::ConvertElementType(
+        xla::TorchIndexSelect(
+            indices, xla::Min(first_max, num_indices_s32 - one_s32), 0),
+        xla::PrimitiveType::S32);
+    result.max_indices =
+        xla::Select(xla::Lt(first_max, num_indices_s32), max_indices,
+                    xla::Broadcast(xla::Neg(one_s32), {num_bags, dim}));
+    return result;
+  }
+  result.output = ScatterRows(
+      xla::Broadcast(zero, {num_bags, dim}), result.offset2bag,
+      xla::Select(valid_rows, rows, xla::Broadcast(zero, {num_indices, dim})),
+      xla::CreateScalarAddComputation(type, builder),
+      /*indices_are_sorted=*/true, /*unique_indices=*/false);
+  if (mode == EmbeddingBagMode::kMean) {
+    result.output =
+        result.output /
+        BroadcastRows(xla::ConvertElementType(
+                          xla::Max(result.bag_size, one_s32), type),
+                      {num_bags, dim});
+  }
+  result.max_indices = result.bag_size;
+  return result;
+}
+
+// The [num_indices, dim] gradients of the weight rows selected by the indices,
+// for the sum and mean modes.
+xla::XlaOp BuildEmbeddingBagRowGrads(
+    xla::XlaOp grad, xla::XlaOp offset2bag, xla::XlaOp bag_size,
+    const absl::optional<xla::XlaOp>& per_sample_weights,
+    EmbeddingBagMode mode) {
+  const xla::Shape& grad_shape = XlaHelpers::ShapeOfXlaOp(grad);
+  int64_t num_indices = XlaHelpers::ShapeOfXlaOp(offset2bag).dimensions(0);
+  std::vector<int64_t> rows_sizes = {num_indices, grad_shape.dimensions(1)};
+  xla::XlaOp rows = xla::TorchIndexSelect(grad, offset2bag, 0);
+  if (mode == EmbeddingBagMode::kMean) {
+    xla::XlaOp index_bag_size = xla::TorchIndexSelect(bag_size, offset2bag, 0);
+    rows = rows /
+           BroadcastRows(xla::ConvertElementType(
+                             xla::Max(index_bag_size,
+                                      xla::ScalarLike(index_bag_size, 1)),
+                             grad_shape.element_type()),
+                         rows_sizes);
+  }
+  if (per_sample_weights) {
+    rows = rows * BroadcastRows(xla::ConvertElementType(
+                                    *per_sample_weights,
+                                    grad_shape.element_type()),
+                                rows_sizes);
+  }
+  return rows;
+}
+
+}  // namespace
+
+EmbeddingBagResult BuildEmbeddingBag(
+    xla::XlaOp weight, xla::XlaOp indices, xla::XlaOp offsets,
+    const absl::optional<xla::XlaOp>& per_sample_weights,
+    EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx) {
+  EmbeddingBagResult result =
+      BuildEmbeddingBagS32(weight, indices, offsets, per_sample_weights, mode,
+                           include_last_offset, padding_idx);
+  xla::PrimitiveType index_type = XlaHelpers::TypeOfXlaOp(indices);
+  result.offset2bag = xla::ConvertElementType(result.offset2bag, index_type);
+  result.bag_size = xla::ConvertElementType(result.bag_size, index_type);
+  result.max_indices = xla::ConvertElementType(result.max_indices, index_type);
+  return result;
+}
+
+xla::XlaOp BuildEmbeddingBagBackward(
+    xla::XlaOp grad, xla::XlaOp indices, xla::XlaOp offset2bag,
+    xla::XlaOp bag_size, xla::XlaOp max_indices,
+    const absl::optional<xla::XlaOp>& per_sample_weights, int64_t num_weights,
+    EmbeddingBagMode mode, bool scale_grad_by_freq, int64_t padding_idx) {
+  const xla::Shape& grad_shape = XlaHelpers::ShapeOfXlaOp(grad);
+  XLA_CHECK_EQ(grad_shape.rank(), 2) << grad_shape;
+  if (mode == EmbeddingBagMode::kMax) {
+    xla::XlaOp zeros =
+        xla::Broadcast(xla::Zero(grad.builder(), grad_shape.element_type()),
+                       {num_weights, grad_shape.dimensions(1)});
+    return ScatterAddElements(zeros, max_indices, grad);
+  }
+  return BuildEmbeddingDenseBackward(
+      BuildEmbeddingBagRowGrads(grad, offset2bag, bag_size, per_sample_weights,
+                                mode),
+      indices, num_weights, padding_idx, scale_grad_by_freq);
+}
+
+xla::XlaOp BuildEmbeddingDenseBackward(xla::XlaOp grad, xla::XlaOp indices,
+                                       int64_t num_weights,
+                                       int64_t padding_idx,
+                                       bool scale_grad_by_freq) {
+  const xla::Shape& grad_shape = XlaHelpers::ShapeOfXlaOp(grad);
+  const xla::Shape& indices_shape = XlaHelpers::ShapeOfXlaOp(indices);
+  // The weight is of rank 2, so the gradient has one more dimension than the
+  // indices.
+  XLA_CHECK_EQ(grad_shape.rank(), indices_shape.rank() + 1);
+  int64_t num_indices = xla::ShapeUtil::ElementsIn(indices_shape);
+  int64_t dim = grad_shape.dimensions(grad_shape.rank() - 1);
+  xla::XlaBuilder* builder = grad.builder();
+  xla::XlaOp zeros =
+      xla::Broadcast(xla::Zero(builder, grad_shape.element_type()),
+                     {num_weights, dim});
+  if (num_indices == 0) {
+    return zeros;
+  }
+  SegmentSumResult segments = BuildSortedSegmentSum(
+      xla::Reshape(indices, {num_indices}),
+      xla::Reshape(grad, {num_indices, dim}), num_weights, padding_idx);
+  xla::XlaOp rows = segments.rows;
+  if (scale_grad_by_freq) {
+    rows = rows / BroadcastRows(
+                      xla::ConvertElementType(
+                          xla::Max(segments.counts,
+                                   xla::ScalarLike(segments.counts, 1)),
+                          grad_shape.element_type()),
+                      {num_indices, dim});
+  }
+  return ScatterRows(
+      zeros, segments.indices, rows,
+      xla::CreateScalarAddComputation(grad_shape.element_type(), builder),
+      /*indices_are_sorted=*/true, /*unique_indices=*/true);
+}
+
+xla::XlaOp BuildEmbeddingBagSparseSgd(
+    xla::XlaOp weight, xla::XlaOp grad, xla::XlaOp indices, xla::XlaOp offsets,
+    const absl::optional<xla::XlaOp>& per_sample_weights, xla::XlaOp lr,
+    EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx) {
+  const xla::Shape& weight_shape = XlaHelpers::ShapeOfXlaOp(weight);
+  if (xla::ShapeUtil::ElementsIn(XlaHelpers::ShapeOfXlaOp(indices)) == 0) {
+    return weight;
+  }
+  // Only the bags layout (and the max indices) are used out of the forward
+  // computation, the rest gets removed as dead code.
+  EmbeddingBagResult bags =
+      BuildEmbeddingBagS32(weight, indices, offsets, per_sample_weights, mode,
+                           include_last_offset, padding_idx);
+  xla::XlaOp neg_lr =
+      xla::Neg(xla::ConvertElementType(lr, weight_shape.element_type()));
+  if (mode == EmbeddingBagMode::kMax) {
+    return ScatterAddElements(weight, bags.max_indices, grad * neg_lr);
+  }
+  SegmentSumResult segments = BuildSortedSegmentSum(
+      indices,
+      BuildEmbeddingBagRowGrads(grad, bags.offset2bag, bags.bag_size,
+                                per_sample_weights, mode),
+      weight_shape.dimensions(0), padding_idx);
+  return ScatterRows(
+      weight, segments.indices, segments.rows * neg_lr,
+      xla::CreateScalarAddComputation(weight_shape.element_type(),
+                                      weight.builder()),
+      /*indices_are_sorted=*/true, /*unique_indices=*/true);
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// Same values as the mode argument of the ATen embedding bag operations.
+enum class EmbeddingBagMode { kSum = 0, kMean = 1, kMax = 2 };
+
+struct EmbeddingBagResult {
+  xla::XlaOp output;
+  xla::XlaOp offset2bag;
+  xla::XlaOp bag_size;
+  xla::XlaOp max_indices;
+};
+
+// Reduces the weight rows selected by the rank 1 indices within the bags
+// starting at offsets. The outputs match the ones of the ATen _embedding_bag()
+// operation: the [num_bags, dim] output, the bag of every index, the number of
+// (non padding) indices in every bag, and, for the max mode, the weight row
+// index of every output element (-1 for the empty bags). For the other modes
+// max_indices is the bag_size.
+EmbeddingBagResult BuildEmbeddingBag(
+    xla::XlaOp weight, xla::XlaOp indices, xla::XlaOp offsets,
+    const absl::optional<xla::XlaOp>& per_sample_weights,
+    EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx);
+
+// The gradient of the weight of BuildEmbeddingBag(). The rows of every index
+// are summed by a sorted segment reduction, and written once per distinct
+// index, instead of being scattered over the whole weight.
+xla::XlaOp BuildEmbeddingBagBackward(
+    xla::XlaOp grad, xla::XlaOp indices, xla::XlaOp offset2bag,
+    xla::XlaOp bag_size, xla::XlaOp max_indices,
+    const absl::optional<xla::XlaOp>& per_sample_weights, int64_t num_weights,
+    EmbeddingBagMode mode, bool scale_grad_by_freq, int64_t padding_idx);
+
+// The gradient of the weight of an embedding, given the [num_indices, dim]
+// gradient rows of the rank 1 indices.
+xla::XlaOp BuildEmbeddingDenseBackward(xla::XlaOp grad, xla::XlaOp indices,
+                                       int64_t num_weights,
+                                       int64_t padding_idx,
+                                       bool scale_grad_by_freq);
+
+// Applies an SGD step (weight -= lr * gradient) of the weight of an embedding
+// bag, given the gradient of its output. Only the weight rows selected by the
+// indices are read and written.
+xla::XlaOp BuildEmbeddingBagSparseSgd(
+    xla::XlaOp weight, xla::XlaOp grad, xla::XlaOp indices, xla::XlaOp offsets,
+    const absl::optional<xla::XlaOp>& per_sample_weights, xla::XlaOp lr,
+    EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx);
+
+}  // namespace torch_xla
@@ -0,0 +1,208 @@
+#include "torch_xla/csrc/example_batch.h"
+
+#include <ATen/Functions.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <thread>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/core/example/example.pb.h"
+#include "tensorflow/core/example/feature.pb.h"
+
+namespace torch_xla {
+namespace {
+
+// How the values of a feature get laid out within the batch.
+struct FeatureLayout {
+  std::string name;
+  tensorflow::Feature::KindCase kind;
+  // The number of values (or bytes, for the bytes features) of every example,
+  // -1 if they differ and the feature does not get stacked.
+  int64_t size = 0;
+  ExampleFeatureBatch* batch = nullptr;
+};
+
+int64_t GetValueSize(const tensorflow::Feature& feature) {
+  switch (feature.kind_case()) {
+    case tensorflow::Feature::kBytesList:
+      return feature.bytes_list().value_size() == 1
+                 ? feature.bytes_list().value(0).size()
+                 : -1;
+    case tensorflow::Feature::kFloatList:
+      return feature.float_list().value_size();
+    case tensorflow::Feature::kInt64List:
+      return feature.int64_list().value_size();
+    default:
+      return -1;
+  }
+}
+
+at::ScalarType GetScalarType(tensorflow::Feature::KindCase kind) {
+  switch (kind) {
+    case tensorflow::Feature::kBytesList:
+      return at::kChar;
+    case tensorflow::Feature::kFloatList:
+      return at::kFloat;
+    case tensorflow::Feature::kInt64List:
+      return at::kLong;
+    default:
+      XLA_ERROR() << "Unknown TF example feature kind: " << kind;
+  }
+}
+
+at::Tensor MakeTensor(const void* data, int64_t size,
+                      tensorflow::Feature::KindCase kind) {
+  at::Tensor tensor = at::empty({size}, at::TensorOptions(GetScalarType(kind)));
+  std::memcpy(tensor.data_ptr(), data, size * tensor.element_size());
+  return tensor;
+}
+
+// Copies the values of the feature into the row of the stacked tensor, or
+// into tensors of their own.
+void FillFeature(const FeatureLayout& layout,
+                 const tensorflow::Feature& feature, size_t row) {
+  if (layout.size >= 0) {
+    at::Tensor& stacked = layout.batch->stacked;
+    char* dest = reinterpret_cast<char*>(stacked.data_ptr()) +
+                 row * layout.size * stacked.element_size();
+    size_t size = layout.size * stacked.element_size();
+    switch (layout.kind) {
+      case tensorflow::Feature::kBytesList:
+        std::memcpy(dest, feature.bytes_list().value(0).data(), size);
+        break;
+      case tensorflow::Feature::kFloatList:
+        std::memcpy(dest, feature.float_list().value().data(), size);
+        break;
+      case tensorflow::Feature::kInt64List:
+        std::memcpy(dest, feature.int64_list().value().data(), size);
+        break;
+      default:
+        break;
+    }
+    return;
+  }
+  std::vector<at::Tensor>& values = layout.batch->values[row];
+  switch (layout.kind) {
+    case tensorflow::Feature::kBytesList:
+      for (auto& value : feature.bytes_list().value()) {
+        values.push_back(MakeTensor(value.data(), value.size(), layout.kind));
+      }
+      break;
+    case tensorflow::Feature::kFloatList:
+      values.push_back(MakeTensor(feature.float_list().value().data(),
+                                  feature.float_list().value_size(),
+                                  layout.kind));
+      break;
+    case tensorflow::Feature::kInt64List:
+      values.push_back(MakeTensor(feature.int64_list().value().data(),
+                                  feature.int64_list().value_size(),
+                                  layout.kind));
+      break;
+    default:
+      break;
+  }
+}
+
+// Runs fn over the [0, size) range, split in chunks which run on the thread
+// pool, with the calling thread running the first one.
+void ParallelChunks(size_t size,
+                    const std::function<void(size_t, size_t)>& fn) {
+  // The minimum number of examples of a chunk, to amortize the scheduling.
+  static const size_t kMinChunkSize = 16;
+  size_t num_chunks = std::min<size_t>(
+      (size + kMinChunkSize - 1) / kMinChunkSize,
+      std::max<size_t>(std::thread::hardware_concurrency(), 1));
+  if (num_chunks <= 1) {
+    fn(0, size);
+    return;
+  }
+  size_t chunk_size = (size + num_chunks - 1) / num_chunks;
+  auto mwait = std::make_shared<xla::util::MultiWait>(num_chunks);
+  for (size_t i = 1; i < num_chunks; ++i) {
+    size_t start = std::min(i * chunk_size, size);
+    size_t end = std::min(start + chunk_size, size);
+    xla::env::ScheduleClosure(xla::util::MultiWait::Completer(
+        mwait, [&fn, start, end]() { fn(start, end); }));
+  }
+  // Through the completer, so that the chunks running on the pool are waited
+  // for even if the first one throws.
+  xla::util::MultiWait::Completer(
+      mwait, [&fn, chunk_size]() { fn(0, chunk_size); })();
+  mwait->Wait();
+}
+
+}  // namespace
+
+std::map<std::string, ExampleFeatureBatch> ParseExampleBatch(
+    absl::Span<const xla::util::RecordReader::Data> records,
+    const std::string& path) {
+  XLA_TIMED("ParseExampleBatch");
+  std::map<std::string, ExampleFeatureBatch> batch;
+  if (records.empty()) {
+    return batch;
+  }
+  std::vector<tensorflow::Example> examples(records.size());
+  ParallelChunks(records.size(), [&](size_t start, size_t end) {
+    for (size_t i = start; i < end; ++i) {
+      XLA_CHECK(
+          examples[i].ParseFromArray(records[i].data(), records[i].size()))
+          << "Unable to parse TF example from " << path;
+    }
+  });
+
+  std::vector<FeatureLayout> layouts;
+  for (auto& name_feat : examples.front().features().feature()) {
+    FeatureLayout layout;
+    layout.name = name_feat.first;
+    layout.kind = name_feat.second.kind_case();
+    XLA_CHECK(layout.kind == tensorflow::Feature::kBytesList ||
+              layout.kind == tensorflow::Feature::kFloatList ||
+              layout.kind == tensorflow::Feature::kInt64List)
+        << "Unknown data type for feature " << layout.name << " from " << path;
+    layout.size = GetValueSize(name_feat.second);
+    for (size_t i = 1; i < examples.size() && layout.size >= 0; ++i) {
+      auto& features = examples[i].features().feature();
+      auto it = features.find(layout.name);
+      XLA_CHECK(it != features.end())
+          << "Feature " << layout.name << " missing from example " << i
+          << " of the batch from " << path;
+      if (it->second.kind_case() != layout.kind ||
+          GetValueSize(it->second) != layout.size) {
+        layout.size = -1;
+      }
+    }
+    layout.batch = &batch[layout.name];
+    if (layout.size >= 0) {
+      layout.batch->stacked = at::empty(
+          {static_cast<int64_t>(examples.size()), layout.size},
+          at::TensorOptions(GetScalarType(layout.kind)));
+    } else {
+      layout.batch->values.resize(examples.size());
+    }
+    layouts.push_back(std::move(layout));
+  }
+
+  ParallelChunks(examples.size(), [&](size_t start, size_t end) {
+    for (size_t i = start; i < end; ++i) {
+      auto& features = examples[i].features().feature();
+      for (auto& layout : layouts) {
+        auto it = features.find(layout.name);
+        XLA_CHECK(it != features.end())
+            << "Feature " << layout.name << " missing from example " << i
+            << " of the batch from " << path;
+        XLA_CHECK_EQ(it->second.kind_case(), layout.kind)
+            << "Feature " << layout.name << " of example " << i
+            << " of the batch from " << path << " has a different type";
+        FillFeature(layout, it->second, i);
+      }
+    }
+  });
+  return batch;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <ATen/Tensor.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/xla_client/record_reader.h"
+
+namespace torch_xla {
+
+// A feature of a batch of TF examples.
+struct ExampleFeatureBatch {
+  // If all the examples have the same number of values for the feature (and
+  // bytes features a single value of the same size), the values of all the
+  // examples stacked into a contiguous [batch, values] tensor.
+  at::Tensor stacked;
+  // Otherwise, by example, the tensors of the feature values: one for the
+  // numeric features, and one per value for the bytes ones.
+  std::vector<std::vector<at::Tensor>> values;
+};
+
+// Parses the TF examples serialized within the records, in parallel over the
+// thread pool, by feature name. All the examples must have the same features,
+// of the same types. Does not need the GIL.
+std::map<std::string, ExampleFeatureBatch> ParseExampleBatch(
+    absl::Span<const xla::util::RecordReader::Data> records,
+    const std::string& path);
+
+}  // namespace torch_xla
@@ -0,0 +1,419 @@
+#include "torch_xla/csrc/flash_attention.h"
+
+#include <algorithm>
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/loops.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+const xla::PrimitiveType kIndexType = xla::PrimitiveType::S32;
+
+struct InitValues {
+  size_t append(xla::XlaOp op) {
+    values.push_back(std::move(op));
+    return values.size() - 1;
+  }
+
+  std::vector<xla::XlaOp> values;
+};
+
+struct AttentionDims {
+  int64_t rank = 0;
+  int64_t query_length = 0;
+  int64_t key_length = 0;
+  int64_t block_size = 0;
+  int64_t num_blocks = 0;
+  xla::PrimitiveType type = xla::PrimitiveType::PRIMITIVE_TYPE_INVALID;
+  // The scores, the softmax statistics and the gradients are accumulated in
+  // single precision when the inputs are in reduced precision.
+  xla::PrimitiveType accum_type = xla::PrimitiveType::PRIMITIVE_TYPE_INVALID;
+};
+
+AttentionDims GetAttentionDims(xla::XlaOp query, xla::XlaOp key,
+                               xla::XlaOp value, int64_t block_size) {
+  const xla::Shape& query_shape = XlaHelpers::ShapeOfXlaOp(query);
+  const xla::Shape& key_shape = XlaHelpers::ShapeOfXlaOp(key);
+  const xla::Shape& value_shape = XlaHelpers::ShapeOfXlaOp(value);
+  AttentionDims dims;
+  dims.rank = query_shape.rank();
+  XLA_CHECK_GE(dims.rank, 2) << "Invalid attention query: " << query_shape;
+  XLA_CHECK_EQ(key_shape.rank(), dims.rank)
+      << "Invalid attention key: " << key_shape;
+  XLA_CHECK_EQ(value_shape.rank(), dims.rank)
+      << "Invalid attention value: " << value_shape;
+  for (int64_t i = 0; i < dims.rank - 2; ++i) {
+    XLA_CHECK(key_shape.dimensions(i) == query_shape.dimensions(i) &&
+              value_shape.dimensions(i) == query_shape.dimensions(i))
+        << "Mismatching attention batch dimensions: query=" << query_shape
+        << " key=" << key_shape << " value=" << value_shape;
+  }
+  XLA_CHECK_EQ(key_shape.dimensions(dims.rank - 1),
+               query_shape.dimensions(dims.rank - 1))
+      << "Mismatching attention query and key: query=" << query_shape
+      << " key=" << key_shape;
+  XLA_CHECK_EQ(value_shape.dimensions(dims.rank - 2),
+               key_shape.dimensions(dims.rank - 2))
+      << "Mismatching attention key and value: key=" << key_shape
+      << " value=" << value_shape;
+  XLA_CHECK(key_shape.element_type() == query_shape.element_type() &&
+            value_shape.element_type() == query_shape.element_type())
+      << "Mismatching attention types: query=" << query_shape
+      << " key=" << key_shape << " value=" << value_shape;
+  XLA_CHECK_GT(block_size, 0) << "Invalid attention block size: "
+                              << block_size;
+  dims.query_length = query_shape.dimensions(dims.rank - 2);
+  dims.key_length = key_shape.dimensions(dims.rank - 2);
+  dims.block_size = std::max<int64_t>(std::min(block_size, dims.key_length), 1);
+  dims.num_blocks = (dims.key_length + dims.block_size - 1) / dims.block_size;
+  dims.type = query_shape.element_type();
+  dims.accum_type = dims.type == xla::PrimitiveType::BF16 ||
+                            dims.type == xla::PrimitiveType::F16
+                        ? xla::PrimitiveType::F32
+                        : dims.type;
+  return dims;
+}
+
+// Pads the key dimension of the input up to a whole number of blocks.
+xla::XlaOp PadKeys(xla::XlaOp input, const AttentionDims& dims, int64_t dim) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t padding = dims.num_blocks * dims.block_size - shape.dimensions(dim);
+  if (padding == 0) {
+    return input;
+  }
+  xla::PaddingConfig padding_config;
+  for (int64_t i = 0; i < shape.rank(); ++i) {
+    padding_config.add_dimensions();
+  }
+  padding_config.mutable_dimensions(dim)->set_edge_padding_high(padding);
+  return xla::Pad(input, xla::Zero(input.builder(), shape.element_type()),
+                  padding_config);
+}
+
+// Brings the mask to the rank of the scores, with its key dimension (if not
+// broadcasted) padded like the keys.
+xla::XlaOp PrepareMask(xla::XlaOp mask, const AttentionDims& dims,
+                       absl::Span<const int64_t> query_sizes) {
+  const xla::Shape& mask_shape = XlaHelpers::ShapeOfXlaOp(mask);
+  XLA_CHECK_LE(mask_shape.rank(), dims.rank)
+      << "Invalid attention mask: " << mask_shape;
+  std::vector<int64_t> sizes(dims.rank - mask_shape.rank(), 1);
+  sizes.insert(sizes.end(), mask_shape.dimensions().begin(),
+               mask_shape.dimensions().end());
+  std::vector<int64_t> scores_sizes(query_sizes.begin(), query_sizes.end());
+  scores_sizes.back() = dims.key_length;
+  for (int64_t i = 0; i < dims.rank; ++i) {
+    XLA_CHECK(sizes[i] == 1 || sizes[i] == scores_sizes[i])
+        << "Attention mask " << mask_shape
+        << " not broadcastable to the scores: ("
+        << absl::StrJoin(scores_sizes, ", ") << ")";
+  }
+  xla::XlaOp result = XlaHelpers::DynamicReshape(mask, sizes);
+  return sizes.back() > 1 ? PadKeys(result, dims, dims.rank - 1) : result;
+}
+
+xla::XlaOp SliceKeyBlock(xla::XlaOp input, xla::XlaOp start, int64_t dim,
+                         int64_t block_size) {
+  std::vector<int64_t> sizes = XlaHelpers::SizesOfXlaOp(input);
+  sizes[dim] = block_size;
+  std::vector<xla::XlaOp> starts(sizes.size(),
+                                 xla::Zero(input.builder(), kIndexType));
+  starts[dim] = start;
+  return xla::DynamicSlice(input, starts, sizes);
+}
+
+xla::XlaOp UpdateKeyBlock(xla::XlaOp input, xla::XlaOp update,
+                          xla::XlaOp start, int64_t dim) {
+  std::vector<xla::XlaOp> starts(XlaHelpers::ShapeOfXlaOp(input).rank(),
+                                 xla::Zero(input.builder(), kIndexType));
+  starts[dim] = start;
+  return xla::DynamicUpdateSlice(input, update, starts);
+}
+
+// Multiplies two tensors sharing the leading batch dimensions, contracting
+// the given dimension of each.
+xla::XlaOp BuildBatchDot(xla::XlaOp lhs, int64_t lhs_contracting_dim,
+                         xla::XlaOp rhs, int64_t rhs_contracting_dim,
+                         xla::PrimitiveType accum_type) {
+  int64_t rank = XlaHelpers::ShapeOfXlaOp(lhs).rank();
+  xla::DotDimensionNumbers dot_dims;
+  for (int64_t i = 0; i < rank - 2; ++i) {
+    dot_dims.add_lhs_batch_dimensions(i);
+    dot_dims.add_rhs_batch_dimensions(i);
+  }
+  dot_dims.add_lhs_contracting_dimensions(lhs_contracting_dim);
+  dot_dims.add_rhs_contracting_dimensions(rhs_contracting_dim);
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
+  return xla::DotGeneral(lhs, rhs, dot_dims, &precision_config, accum_type);
+}
+
+// Replaces the infinite maximums of the rows which are entirely masked out, so
+// that subtracting them does not generate NaNs.
+xla::XlaOp FiniteOrZero(xla::XlaOp values) {
+  return xla::Select(xla::IsFinite(values), values, xla::ZerosLike(values));
+}
+
+std::vector<int64_t> RowDimensions(const AttentionDims& dims) {
+  return torch::lazy::Iota<int64_t>(dims.rank - 1);
+}
+
+// Computes the scaled scores of the queries against the key block at the given
+// start position, with the positions masked out (by the mask, the causality or
+// the padding of the keys) set to -inf.
+xla::XlaOp BuildBlockScores(xla::XlaOp query, xla::XlaOp key_block,
+                            const absl::optional<xla::XlaOp>& mask,
+                            xla::XlaOp start, const AttentionDims& dims,
+                            double scale, bool is_causal) {
+  xla::XlaBuilder* builder = query.builder();
+  xla::XlaOp scores = BuildBatchDot(query, dims.rank - 1, key_block,
+                                    dims.rank - 1, dims.accum_type) *
+                      XlaHelpers::ScalarValue(scale, dims.accum_type, builder);
+  std::vector<int64_t> scores_sizes = XlaHelpers::SizesOfXlaOp(scores);
+  xla::Shape index_shape = xla::ShapeUtil::MakeShape(
+      kIndexType, {dims.query_length, dims.block_size});
+  xla::XlaOp key_index = xla::Iota(builder, index_shape, 1) + start;
+  absl::optional<xla::XlaOp> valid;
+  if (dims.num_blocks * dims.block_size > dims.key_length) {
+    valid = xla::Lt(key_index, XlaHelpers::ScalarValue<int32_t>(
+                                   dims.key_length, kIndexType, builder));
+  }
+  if (is_causal) {
+    xla::XlaOp causal = xla::Le(key_index, xla::Iota(builder, index_shape, 0));
+    valid = valid ? xla::And(*valid, causal) : causal;
+  }
+  if (valid) {
+    valid = xla::BroadcastInDim(*valid, scores_sizes,
+                                {dims.rank - 2, dims.rank - 1});
+  }
+  if (mask) {
+    xla::XlaOp mask_block = *mask;
+    if (XlaHelpers::SizesOfXlaOp(mask_block).back() > 1) {
+      mask_block =
+          SliceKeyBlock(mask_block, start, dims.rank - 1, dims.block_size);
+    }
+    mask_block = xla::BroadcastInDim(mask_block, scores_sizes,
+                                     torch::lazy::Iota<int64_t>(dims.rank));
+    if (XlaHelpers::TypeOfXlaOp(mask_block) == xla::PrimitiveType::PRED) {
+      valid = valid ? xla::And(*valid, mask_block) : mask_block;
+    } else {
+      scores = scores + xla::ConvertElementType(mask_block, dims.accum_type);
+    }
+  }
+  if (valid) {
+    scores = xla::Select(
+        *valid, scores,
+        xla::Broadcast(xla::MinValue(builder, dims.accum_type), scores_sizes));
+  }
+  return scores;
+}
+
+}  // namespace
+
+int64_t GetFlashAttentionBlockSize() {
+  static const int64_t block_size =
+      xla::sys_util::GetEnvInt("XLA_FLASH_ATTENTION_BLOCK_SIZE", 512);
+  return block_size;
+}
+
+FlashAttentionResult BuildFlashAttention(xla::XlaOp query, xla::XlaOp key,
+                                         xla::XlaOp value,
+                                         const absl::optional<xla::XlaOp>& mask,
+                                         double scale, bool is_causal,
+                                         int64_t block_size) {
+  AttentionDims dims = GetAttentionDims(query, key, value, block_size);
+  xla::XlaBuilder* outer_builder = query.builder();
+  std::vector<int64_t> query_sizes = XlaHelpers::SizesOfXlaOp(query);
+  std::vector<int64_t> row_sizes(query_sizes.begin(), query_sizes.end() - 1);
+  std::vector<int64_t> output_sizes(row_sizes);
+  output_sizes.push_back(XlaHelpers::SizesOfXlaOp(value).back());
+  std::vector<int64_t> row_dims = RowDimensions(dims);
+
+  InitValues initial_values;
+  size_t counter_id =
+      initial_values.append(xla::Zero(outer_builder, kIndexType));
+  size_t query_id = initial_values.append(query);
+  size_t key_id = initial_values.append(PadKeys(key, dims, dims.rank - 2));
+  size_t value_id = initial_values.append(PadKeys(value, dims, dims.rank - 2));
+  size_t max_id = initial_values.append(
+      xla::Broadcast(xla::MinValue(outer_builder, dims.accum_type), row_sizes));
+  size_t sum_id = initial_values.append(xla::Zeros(
+      outer_builder, xla::ShapeUtil::MakeShape(dims.accum_type, row_sizes)));
+  size_t accum_id = initial_values.append(
+      xla::Zeros(outer_builder,
+                 xla::ShapeUtil::MakeShape(dims.accum_type, output_sizes)));
+  absl::optional<size_t> mask_id;
+  if (mask) {
+    mask_id = initial_values.append(PrepareMask(*mask, dims, query_sizes));
+  }
+
+  auto cond_fn = [&](absl::Span<const xla::XlaOp> init,
+                     xla::XlaBuilder* builder) -> xla::StatusOr<xla::XlaOp> {
+    return xla::Lt(init[counter_id], XlaHelpers::ScalarValue<int32_t>(
+                                         dims.num_blocks, kIndexType, builder));
+  };
+  auto body_fn =
+      [&](absl::Span<const xla::XlaOp> init,
+          xla::XlaBuilder* builder) -> xla::StatusOr<std::vector<xla::XlaOp>> {
+    xla::XlaOp start =
+        init[counter_id] * XlaHelpers::ScalarValue<int32_t>(
+                               dims.block_size, kIndexType, builder);
+    xla::XlaOp key_block =
+        SliceKeyBlock(init[key_id], start, dims.rank - 2, dims.block_size);
+    xla::XlaOp value_block =
+        SliceKeyBlock(init[value_id], start, dims.rank - 2, dims.block_size);
+    absl::optional<xla::XlaOp> mask_block;
+    if (mask_id) {
+      mask_block = init[*mask_id];
+    }
+    xla::XlaOp scores = BuildBlockScores(init[query_id], key_block, mask_block,
+                                         start, dims, scale, is_causal);
+    xla::XlaOp block_max =
+        xla::Reduce(scores, xla::MinValue(builder, dims.accum_type),
+                    XlaHelpers::CreateMaxComputation(dims.accum_type),
+                    {dims.rank - 1});
+    xla::XlaOp new_max = xla::Max(init[max_id], block_max);
+    xla::XlaOp shift = FiniteOrZero(new_max);
+    xla::XlaOp probs = xla::Exp(xla::Sub(scores, shift, row_dims));
+    // Rescales what was accumulated with the previous maximum.
+    xla::XlaOp correction = xla::Exp(init[max_id] - shift);
+
+    std::vector<xla::XlaOp> results(init.begin(), init.end());
+    results[counter_id] = init[counter_id] + xla::One(builder, kIndexType);
+    results[max_id] = new_max;
+    results[sum_id] =
+        init[sum_id] * correction +
+        xla::Reduce(probs, xla::Zero(builder, dims.accum_type),
+                    XlaHelpers::CreateAddComputation(dims.accum_type),
+                    {dims.rank - 1});
+    results[accum_id] = xla::Add(
+        xla::Mul(init[accum_id], correction, row_dims),
+        BuildBatchDot(xla::ConvertElementType(probs, dims.type), dims.rank - 1,
+                      value_block, dims.rank - 2, dims.accum_type));
+    return results;
+  };
+
+  std::vector<xla::XlaOp> results = ConsumeValue(
+      xla::WhileLoopHelper(cond_fn, body_fn, initial_values.values,
+                           "FlashAttention", outer_builder));
+
+  xla::XlaOp output = xla::ConvertElementType(
+      xla::Div(results[accum_id], results[sum_id], row_dims), dims.type);
+  xla::XlaOp logsumexp =
+      FiniteOrZero(results[max_id]) + xla::Log(results[sum_id]);
+  return {output, logsumexp};
+}
+
+FlashAttentionGrads BuildFlashAttentionBackward(
+    xla::XlaOp grad_output, xla::XlaOp query, xla::XlaOp key, xla::XlaOp value,
+    xla::XlaOp output, xla::XlaOp logsumexp,
+    const absl::optional<xla::XlaOp>& mask, double scale, bool is_causal,
+    int64_t block_size) {
+  AttentionDims dims = GetAttentionDims(query, key, value, block_size);
+  xla::XlaBuilder* outer_builder = query.builder();
+  std::vector<int64_t> query_sizes = XlaHelpers::SizesOfXlaOp(query);
+  std::vector<int64_t> row_dims = RowDimensions(dims);
+  // The rows sums of grad_output * output, which are the rows sums of the
+  // attention probabilities times their gradients.
+  xla::XlaOp delta = xla::Reduce(
+      xla::ConvertElementType(grad_output, dims.accum_type) *
+          xla::ConvertElementType(output, dims.accum_type),
+      xla::Zero(outer_builder, dims.accum_type),
+      XlaHelpers::CreateAddComputation(dims.accum_type), {dims.rank - 1});
+  xla::XlaOp padded_key = PadKeys(key, dims, dims.rank - 2);
+  xla::XlaOp padded_value = PadKeys(value, dims, dims.rank - 2);
+
+  InitValues initial_values;
+  size_t counter_id =
+      initial_values.append(xla::Zero(outer_builder, kIndexType));
+  size_t query_id = initial_values.append(query);
+  size_t key_id = initial_values.append(padded_key);
+  size_t value_id = initial_values.append(padded_value);
+  size_t grad_output_id = initial_values.append(grad_output);
+  size_t logsumexp_id = initial_values.append(FiniteOrZero(logsumexp));
+  size_t delta_id = initial_values.append(delta);
+  size_t grad_query_id = initial_values.append(xla::Zeros(
+      outer_builder, xla::ShapeUtil::MakeShape(dims.accum_type, query_sizes)));
+  size_t grad_key_id = initial_values.append(xla::Zeros(
+      outer_builder,
+      xla::ShapeUtil::MakeShape(dims.accum_type,
+                                XlaHelpers::SizesOfXlaOp(padded_key))));
+  size_t grad_value_id = initial_values.append(xla::Zeros(
+      outer_builder,
+      xla::ShapeUtil::MakeShape(dims.accum_type,
+                                XlaHelpers::SizesOfXlaOp(padded_value))));
+  absl::optional<size_t> mask_id;
+  if (mask) {
+    mask_id = initial_values.append(PrepareMask(*mask, dims, query_sizes));
+  }
+
+  auto cond_fn = [&](absl::Span<const xla::XlaOp> init,
+                     xla::XlaBuilder* builder) -> xla::StatusOr<xla::XlaOp> {
+    return xla::Lt(init[counter_id], XlaHelpers::ScalarValue<int32_t>(
+                                         dims.num_blocks, kIndexType, builder));
+  };
+  auto body_fn =
+      [&](absl::Span<const xla::XlaOp> init,
+          xla::XlaBuilder* builder) -> xla::StatusOr<std::vector<xla::XlaOp>> {
+    xla::XlaOp start =
+        init[counter_id] * XlaHelpers::ScalarValue<int32_t>(
+                               dims.block_size, kIndexType, builder);
+    xla::XlaOp key_block =
+        SliceKeyBlock(init[key_id], start, dims.rank - 2, dims.block_size);
+    xla::XlaOp value_block =
+        SliceKeyBlock(init[value_id], start, dims.rank - 2, dims.block_size);
+    absl::optional<xla::XlaOp> mask_block;
+    if (mask_id) {
+      mask_block = init[*mask_id];
+    }
+    xla::XlaOp scores = BuildBlockScores(init[query_id], key_block, mask_block,
+                                         start, dims, scale, is_causal);
+    xla::XlaOp probs = xla::Exp(xla::Sub(scores, init[logsumexp_id], row_dims));
+    xla::XlaOp grad_probs =
+        BuildBatchDot(init[grad_output_id], dims.rank - 1, value_block,
+                      dims.rank - 1, dims.accum_type);
+    xla::XlaOp grad_scores =
+        probs * xla::Sub(grad_probs, init[delta_id], row_dims) *
+        XlaHelpers::ScalarValue(scale, dims.accum_type, builder);
+    grad_scores = xla::ConvertElementType(grad_scores, dims.type);
+    xla::XlaOp grad_key_block =
+        BuildBatchDot(grad_scores, dims.rank - 2, init[query_id],
+                      dims.rank - 2, dims.accum_type);
+    xla::XlaOp grad_value_block = BuildBatchDot(
+        xla::ConvertElementType(probs, dims.type), dims.rank - 2,
+        init[grad_output_id], dims.rank - 2, dims.accum_type);
+
+    std::vector<xla::XlaOp> results(init.begin(), init.end());
+    results[counter_id] = init[counter_id] + xla::One(builder, kIndexType);
+    results[grad_query_id] =
+        init[grad_query_id] + BuildBatchDot(grad_scores, dims.rank - 1,
+                                            key_block, dims.rank - 2,
+                                            dims.accum_type);
+    results[grad_key_id] = UpdateKeyBlock(init[grad_key_id], grad_key_block,
+                                          start, dims.rank - 2);
+    results[grad_value_id] = UpdateKeyBlock(
+        init[grad_value_id], grad_value_block, start, dims.rank - 2);
+    return results;
+  };
+
+  std::vector<xla::XlaOp> results = ConsumeValue(
+      xla::WhileLoopHelper(cond_fn, body_fn, initial_values.values,
+                           "FlashAttentionBackward", outer_builder));
+
+  auto unpad_keys = [&](xla::XlaOp grad) {
+    return xla::ConvertElementType(
+        xla::SliceInDim(grad, 0, dims.key_length, 1, dims.rank - 2),
+        dims.type);
+  };
+  return {xla::ConvertElementType(results[grad_query_id], dims.type),
+          unpad_keys(results[grad_key_id]), unpad_keys(results[grad_value_id])};
+}
+
+}  // namespace torch_xla
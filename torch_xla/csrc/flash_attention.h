@@ -0,0 +1,46 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+struct FlashAttentionResult {
+  xla::XlaOp output;
+  // The log of the softmax denominators, with shape [..., Lq], which is all
+  // the backward pass needs to recompute the attention probabilities.
+  xla::XlaOp logsumexp;
+};
+
+struct FlashAttentionGrads {
+  xla::XlaOp grad_query;
+  xla::XlaOp grad_key;
+  xla::XlaOp grad_value;
+};
+
+// Returns the size of the key blocks the attention is tiled with
+// (XLA_FLASH_ATTENTION_BLOCK_SIZE).
+int64_t GetFlashAttentionBlockSize();
+
+// Computes softmax(query @ key^T * scale + mask) @ value, with query of shape
+// [..., Lq, E], key of shape [..., Lk, E] and value of shape [..., Lk, Ev]. The
+// optional mask must be broadcastable to [..., Lq, Lk], and is either boolean
+// (true for the positions taking part in the attention) or added to the
+// scores. The keys are processed in blocks with an online softmax, so that the
+// [..., Lq, Lk] scores are never materialized.
+FlashAttentionResult BuildFlashAttention(xla::XlaOp query, xla::XlaOp key,
+                                         xla::XlaOp value,
+                                         const absl::optional<xla::XlaOp>& mask,
+                                         double scale, bool is_causal,
+                                         int64_t block_size);
+
+// Computes the gradients of the query, key and value of BuildFlashAttention(),
+// recomputing the attention probabilities block by block out of the saved
+// logsumexp.
+FlashAttentionGrads BuildFlashAttentionBackward(
+    xla::XlaOp grad_output, xla::XlaOp query, xla::XlaOp key, xla::XlaOp value,
+    xla::XlaOp output, xla::XlaOp logsumexp,
+    const absl::optional<xla::XlaOp>& mask, double scale, bool is_causal,
+    int64_t block_size);
+
+}  // namespace torch_xla
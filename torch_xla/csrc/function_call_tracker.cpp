@@ -1,13 +1,21 @@
 #include "torch_xla/csrc/function_call_tracker.h"
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <functional>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/core/platform/stacktrace.h"
 #include "torch/csrc/lazy/python/python_util.h"
@@ -16,6 +24,32 @@ namespace torch_xla {
 namespace fn_tracker {
 namespace {
 
+// The layout of the binary files, in the native byte order, is:
+//   char[8] magic
+//   uint32 tag count, then per tag: uint32 size, char[size] name
+//   uint32 thread count, then per thread: uint64 thread id, uint64 dropped
+//     record count, uint32 record count, Record[record count] from the oldest
+//     to the newest
+constexpr char kBinaryMagic[8] = {'X', 'L', 'A', 'F', 'N', 'T', 'R', '1'};
+
+struct Record {
+  int64_t timestamp_ns;
+  uint32_t tag;
+  int32_t level;
+};
+
+// The records of one thread. Its lock is only ever contended by the dumps.
+struct ThreadBuffer {
+  explicit ThreadBuffer(size_t size)
+      : thread_id(std::hash<std::thread::id>()(std::this_thread::get_id())),
+        records(size) {}
+
+  std::mutex lock;
+  uint64_t thread_id;
+  std::vector<Record> records;
+  uint64_t count = 0;
+};
+
 struct TrackerContext {
   TrackerContext(std::string path, int level)
       : path(std::move(path)), level(level) {}
@@ -24,17 +58,46 @@ struct TrackerContext {
   std::string path;
   int level;
   std::unordered_set<std::string> tags;
+  bool binary = false;
+  size_t buffer_size = 0;
+  uint64_t sampling = 1;
+  int64_t window_ns = 0;
+  int64_t period_ns = 0;
+  // The binary mode state, guarded by the lock.
+  std::unordered_map<std::string, uint32_t> tag_ids;
+  std::vector<std::string> tag_names;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
 };
 
+// What a thread keeps to track the calls without taking the tracker lock.
+struct ThreadState {
+  uint64_t calls = 0;
+  ThreadBuffer* buffer = nullptr;
+  // The binary tag ids of the tags, or -1 for the ones filtered out by
+  // XLA_FNTRACKER_LIST.
+  std::unordered_map<const char*, int64_t> tag_ids;
+};
+
+thread_local ThreadState g_thread_state;
+
+void DumpAtExit();
+
 TrackerContext* LoadTrackerContext() {
   std::string fntracker_file =
       xla::sys_util::GetEnvString("XLA_FNTRACKER_FILE", "");
   TrackerContext* tctx = nullptr;
   if (!fntracker_file.empty()) {
+    std::string mode =
+        xla::sys_util::GetEnvString("XLA_FNTRACKER_MODE", "text");
+    XLA_CHECK(mode == "text" || mode == "binary")
+        << "Invalid XLA_FNTRACKER_MODE: " << mode;
+    // The text mode logs the frames of every call, which is too slow for the
+    // ATen operations, so they only get tracked by default in binary mode.
+    int default_level = mode == "binary" ? std::numeric_limits<int>::max()
+                                         : kAtenOpLevel - 1;
     tctx = new TrackerContext(
         std::move(fntracker_file),
-        xla::sys_util::GetEnvInt("XLA_FNTRACKER_LEVEL",
-                                 std::numeric_limits<int>::max()));
+        xla::sys_util::GetEnvInt("XLA_FNTRACKER_LEVEL", default_level));
 
     std::string fn_list = xla::sys_util::GetEnvString("XLA_FNTRACKER_LIST", "");
     for (auto& fn : absl::StrSplit(fn_list, ':')) {
@@ -42,6 +105,20 @@ TrackerContext* LoadTrackerContext() {
         tctx->tags.insert(std::string(fn));
       }
     }
+    tctx->binary = mode == "binary";
+    tctx->buffer_size = std::max<int64_t>(
+        xla::sys_util::GetEnvInt("XLA_FNTRACKER_BUFFER_SIZE", 65536), 1);
+    tctx->sampling = std::max<int64_t>(
+        xla::sys_util::GetEnvInt("XLA_FNTRACKER_SAMPLING", 1), 1);
+    tctx->window_ns =
+        xla::sys_util::GetEnvInt("XLA_FNTRACKER_WINDOW_MS", 0) * 1000000;
+    tctx->period_ns =
+        std::max<int64_t>(
+            xla::sys_util::GetEnvInt("XLA_FNTRACKER_PERIOD_MS", 60000), 1) *
+        1000000;
+    if (tctx->binary) {
+      std::atexit(DumpAtExit);
+    }
   }
   return tctx;
 }
@@ -51,6 +128,48 @@ TrackerContext* GetTrackerContext() {
   return tctx;
 }
 
+void DumpAtExit() { DumpBinary(GetTrackerContext()->path); }
+
+// Returns the binary tag id of the tag, -1 if it does not get tracked.
+int64_t GetTagId(TrackerContext* tctx, const char* tag) {
+  auto it = g_thread_state.tag_ids.find(tag);
+  if (it != g_thread_state.tag_ids.end()) {
+    return it->second;
+  }
+  std::string name(tag);
+  int64_t id = -1;
+  if (tctx->tags.empty() || tctx->tags.count(name) > 0) {
+    std::lock_guard<std::mutex> guard(tctx->lock);
+    auto id_it = tctx->tag_ids.emplace(name, tctx->tag_names.size()).first;
+    if (id_it->second == tctx->tag_names.size()) {
+      tctx->tag_names.push_back(name);
+    }
+    id = id_it->second;
+  }
+  g_thread_state.tag_ids.emplace(tag, id);
+  return id;
+}
+
+ThreadBuffer* GetThreadBuffer(TrackerContext* tctx) {
+  if (g_thread_state.buffer == nullptr) {
+    // The buffers outlive their threads, so that the dumps get their records.
+    std::lock_guard<std::mutex> guard(tctx->lock);
+    tctx->buffers.push_back(
+        std::make_unique<ThreadBuffer>(tctx->buffer_size));
+    g_thread_state.buffer = tctx->buffers.back().get();
+  }
+  return g_thread_state.buffer;
+}
+
+void RecordFunction(TrackerContext* tctx, uint32_t tag, int level,
+                    int64_t now_ns) {
+  ThreadBuffer* buffer = GetThreadBuffer(tctx);
+  std::lock_guard<std::mutex> guard(buffer->lock);
+  buffer->records[buffer->count % buffer->records.size()] = {now_ns, tag,
+                                                             level};
+  ++buffer->count;
+}
+
 void LogFunction(TrackerContext* tctx, const char* tag) {
   std::lock_guard<std::mutex> guard(tctx->lock);
   std::ofstream fn_file(tctx->path, std::ios_base::app);
@@ -60,15 +179,68 @@ void LogFunction(TrackerContext* tctx, const char* tag) {
           << tensorflow::CurrentStackTrace() << "\n";
 }
 
+template <typename T>
+void WriteValue(std::ofstream* out, T value) {
+  out->write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
 }  // namespace
 
 void TrackFunction(const char* tag, int level) {
   TrackerContext* tctx = GetTrackerContext();
-  if (tctx != nullptr && level <= tctx->level &&
-      (tctx->tags.empty() || tctx->tags.count(tag) > 0)) {
+  if (tctx == nullptr || level > tctx->level ||
+      ++g_thread_state.calls % tctx->sampling != 0) {
+    return;
+  }
+  int64_t now_ns = 0;
+  if (tctx->binary || tctx->window_ns > 0) {
+    now_ns = xla::sys_util::NowNs();
+    if (tctx->window_ns > 0 && now_ns % tctx->period_ns >= tctx->window_ns) {
+      return;
+    }
+  }
+  int64_t tag_id = GetTagId(tctx, tag);
+  if (tag_id < 0) {
+    return;
+  }
+  if (tctx->binary) {
+    RecordFunction(tctx, static_cast<uint32_t>(tag_id), level, now_ns);
+  } else {
     LogFunction(tctx, tag);
   }
 }
 
+bool DumpBinary(const std::string& path) {
+  TrackerContext* tctx = GetTrackerContext();
+  if (tctx == nullptr || !tctx->binary) {
+    return false;
+  }
+  std::lock_guard<std::mutex> guard(tctx->lock);
+  std::ofstream out(path, std::ios_base::binary | std::ios_base::trunc);
+  XLA_CHECK(out) << "Unable to open the function tracker file: " << path;
+  out.write(kBinaryMagic, sizeof(kBinaryMagic));
+  WriteValue<uint32_t>(&out, tctx->tag_names.size());
+  for (auto& name : tctx->tag_names) {
+    WriteValue<uint32_t>(&out, name.size());
+    out.write(name.data(), name.size());
+  }
+  WriteValue<uint32_t>(&out, tctx->buffers.size());
+  for (auto& buffer : tctx->buffers) {
+    std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+    size_t size = buffer->records.size();
+    uint64_t count = std::min<uint64_t>(buffer->count, size);
+    WriteValue<uint64_t>(&out, buffer->thread_id);
+    WriteValue<uint64_t>(&out, buffer->count - count);
+    WriteValue<uint32_t>(&out, count);
+    for (uint64_t i = buffer->count - count; i < buffer->count; ++i) {
+      const Record& record = buffer->records[i % size];
+      WriteValue<int64_t>(&out, record.timestamp_ns);
+      WriteValue<uint32_t>(&out, record.tag);
+      WriteValue<int32_t>(&out, record.level);
+    }
+  }
+  return true;
+}
+
 }  // namespace fn_tracker
 }  // namespace torch_xla
@@ -1,12 +1,32 @@
 #pragma once
 
+#include <string>
+
 namespace torch_xla {
 namespace fn_tracker {
 
 #define XLA_FN_TRACK(level) \
   torch_xla::fn_tracker::TrackFunction(__FUNCTION__, level)
 
+// The level of the tracking of the ATen operations, above the one of the CPU
+// fallbacks. Only tracked by default in binary mode.
+constexpr int kAtenOpLevel = 5;
+
+// Tracks a call of the tagged function, if XLA_FNTRACKER_FILE is set. The tag
+// must be a string literal, or otherwise outlive the tracker. In text mode the
+// calls get logged to the file together with their Python and C++ frames. In
+// binary mode (XLA_FNTRACKER_MODE=binary) only their time and tag get recorded,
+// within one ring buffer of XLA_FNTRACKER_BUFFER_SIZE records per thread, which
+// get written to the file at exit, or with DumpBinary(). The
+// scripts/decode_fn_tracker.py script decodes the binary files.
+// In both modes, only one call out of XLA_FNTRACKER_SAMPLING of every thread
+// gets tracked, and with XLA_FNTRACKER_WINDOW_MS set, only the calls within the
+// first XLA_FNTRACKER_WINDOW_MS milliseconds of every XLA_FNTRACKER_PERIOD_MS.
 void TrackFunction(const char* tag, int level);
 
+// Writes the binary records of all the threads to the file. Returns false if
+// the tracker is not in binary mode.
+bool DumpBinary(const std::string& path);
+
 }  // namespace fn_tracker
 }  // namespace torch_xla
@@ -0,0 +1,135 @@
+#include "torch_xla/csrc/graph_profiler.h"
+
+#include <algorithm>
+#include <map>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+namespace {
+
+int64_t ShapeBytes(const xla::Shape& shape) {
+  int64_t bytes = 0;
+  xla::ShapeUtil::ForEachSubshape(
+      shape, [&](const xla::Shape& subshape, const xla::ShapeIndex& index) {
+        if (subshape.IsArray()) {
+          bytes += xla::ShapeUtil::ByteSizeOf(subshape);
+        }
+      });
+  return bytes;
+}
+
+std::vector<std::pair<std::string, int64_t>> GetTopSources(
+    absl::Span<const torch::lazy::Node* const> post_order) {
+  static const size_t max_sources =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_PROFILE_SOURCES", 5);
+  std::map<std::string, int64_t> counts;
+  for (auto node : post_order) {
+    const std::vector<torch::lazy::SourceLocation>& frames =
+        GetFrameInfo(node);
+    if (!frames.empty()) {
+      const torch::lazy::SourceLocation& frame = frames.front();
+      counts[absl::StrCat(frame.function, " (", frame.file, ":", frame.line,
+                          ")")] += 1;
+    }
+  }
+  std::vector<std::pair<std::string, int64_t>> sources(counts.begin(),
+                                                       counts.end());
+  std::stable_sort(sources.begin(), sources.end(),
+                   [](const std::pair<std::string, int64_t>& s1,
+                      const std::pair<std::string, int64_t>& s2) {
+                     return s1.second > s2.second;
+                   });
+  if (sources.size() > max_sources) {
+    sources.resize(max_sources);
+  }
+  return sources;
+}
+
+}  // namespace
+
+GraphProfiler* GraphProfiler::Get() {
+  static GraphProfiler* profiler = new GraphProfiler();
+  return profiler;
+}
+
+GraphProfiler::GraphStats& GraphProfiler::GetGraphStats(
+    const torch::lazy::hash_t& hash) {
+  static const size_t max_graphs =
+      xla::sys_util::GetEnvInt("XLA_GRAPH_PROFILE_SIZE", 1024);
+  auto it = graphs_.find(hash);
+  if (it != graphs_.end()) {
+    graph_list_.splice(graph_list_.begin(), graph_list_, it->second);
+    return *it->second;
+  }
+  graph_list_.emplace_front();
+  graph_list_.front().hash = hash;
+  graphs_.emplace(hash, graph_list_.begin());
+  if (graph_list_.size() > max_graphs) {
+    XLA_COUNTER("GraphProfileEvictions", 1);
+    graphs_.erase(graph_list_.back().hash);
+    graph_list_.pop_back();
+  }
+  return graph_list_.front();
+}
+
+void GraphProfiler::RecordCompile(
+    const torch::lazy::hash_t& hash, const std::string& device,
+    int64_t compile_time_ns,
+    absl::Span<const torch::lazy::Node* const> post_order) {
+  std::vector<std::pair<std::string, int64_t>> sources =
+      GetTopSources(post_order);
+  std::lock_guard<std::mutex> lock(lock_);
+  GraphStats& stats = GetGraphStats(hash);
+  stats.device = device;
+  stats.compilations += 1;
+  stats.compile_time_ns += compile_time_ns;
+  if (!sources.empty()) {
+    stats.sources = std::move(sources);
+  }
+}
+
+void GraphProfiler::RecordExecution(
+    const torch::lazy::hash_t& hash, const std::string& device,
+    const xla::ComputationClient::Computation& computation,
+    int64_t execute_time_ns) {
+  std::lock_guard<std::mutex> lock(lock_);
+  GraphStats& stats = GetGraphStats(hash);
+  if (stats.executions == 0) {
+    // The graphs loaded from the persistent cache never get compiled here.
+    stats.device = device;
+    const xla::ProgramShape& program_shape = computation.program_shape();
+    stats.parameter_bytes = 0;
+    for (auto& parameter : program_shape.parameters()) {
+      stats.parameter_bytes += ShapeBytes(parameter);
+    }
+    stats.output_bytes = ShapeBytes(program_shape.result());
+  }
+  stats.executions += 1;
+  stats.execute_time_ns += execute_time_ns;
+}
+
+std::vector<GraphProfiler::GraphStats> GraphProfiler::GetStats() {
+  std::vector<GraphStats> graphs;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    graphs.assign(graph_list_.begin(), graph_list_.end());
+  }
+  std::sort(graphs.begin(), graphs.end(),
+            [](const GraphStats& g1, const GraphStats& g2) {
+              return g1.execute_time_ns > g2.execute_time_ns;
+            });
+  return graphs;
+}
+
+void GraphProfiler::Reset() {
+  std::lock_guard<std::mutex> lock(lock_);
+  graphs_.clear();
+  graph_list_.clear();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch/csrc/lazy/core/hash.h"
+#include "torch/csrc/lazy/core/ir.h"
+
+namespace torch_xla {
+
+// The GraphProfiler keeps the compile and execution statistics of every graph,
+// keyed by the graph hash, which the global CompileTime and ExecuteTime
+// metrics lump together. The hash is the one the XLA_SAVE_TENSORS_FILE dumps
+// report as "Graph Hash", so that the slow graphs can be found there. Only
+// the XLA_GRAPH_PROFILE_SIZE most recently compiled or executed graphs are
+// kept.
+class GraphProfiler {
+ public:
+  struct GraphStats {
+    torch::lazy::hash_t hash;
+    std::string device;
+    int64_t compilations = 0;
+    int64_t compile_time_ns = 0;
+    int64_t executions = 0;
+    // The time from the launch of the executions to their results being
+    // available, which is the device time for the backends executing
+    // synchronously.
+    int64_t execute_time_ns = 0;
+    // The per device bytes of the parameters and outputs of one execution.
+    int64_t parameter_bytes = 0;
+    int64_t output_bytes = 0;
+    // The Python source locations the most IR nodes of the graph come from,
+    // with their node counts, if the graph got traced with XLA_IR_DEBUG.
+    std::vector<std::pair<std::string, int64_t>> sources;
+  };
+
+  static GraphProfiler* Get();
+
+  void RecordCompile(const torch::lazy::hash_t& hash,
+                     const std::string& device, int64_t compile_time_ns,
+                     absl::Span<const torch::lazy::Node* const> post_order);
+
+  void RecordExecution(const torch::lazy::hash_t& hash,
+                       const std::string& device,
+                       const xla::ComputationClient::Computation& computation,
+                       int64_t execute_time_ns);
+
+  // Returns the statistics of the graphs, sorted by decreasing total execution
+  // time.
+  std::vector<GraphStats> GetStats();
+
+  void Reset();
+
+ private:
+  using GraphList = std::list<GraphStats>;
+
+  // Returns the statistics of the graph, moving them to the front of the LRU
+  // list, and evicting the least recently used graph if the list grows beyond
+  // its size.
+  GraphStats& GetGraphStats(const torch::lazy::hash_t& hash);
+
+  std::mutex lock_;
+  GraphList graph_list_;
+  std::unordered_map<torch::lazy::hash_t, GraphList::iterator,
+                     torch::lazy::HashReducer>
+      graphs_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,86 @@
+#include "torch_xla/csrc/host_callbacks.h"
+
+#include "absl/memory/memory.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+
+HostCallbackRegistry* HostCallbackRegistry::Get() {
+  static HostCallbackRegistry* registry = new HostCallbackRegistry();
+  return registry;
+}
+
+HostCallbackRegistry::HostCallbackRegistry()
+    : listener_(absl::make_unique<xla::OutfeedListener>(
+          xla::ComputationClient::Get(),
+          [this](int64_t id) { return GetShape(id); },
+          [this](const std::string& device, int64_t id, xla::Literal payload) {
+            Dispatch(device, id, std::move(payload));
+          })) {}
+
+int64_t HostCallbackRegistry::Register(
+    Callback callback, xla::Shape shape, at::ScalarType element_type,
+    const torch::lazy::BackendDevice& device) {
+  // The outfeed values have the default layout.
+  xla::Shape outfeed_shape = xla::ShapeUtil::MakeShapeWithDescendingLayout(
+      shape.element_type(), shape.dimensions());
+  int64_t id;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    id = next_id_++;
+    entries_.emplace(id, Entry{std::move(callback), std::move(outfeed_shape),
+                               element_type});
+  }
+  listener_->Listen(device.toString());
+  return id;
+}
+
+void HostCallbackRegistry::Unregister(int64_t id) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = entries_.find(id);
+  XLA_CHECK(it != entries_.end()) << "Unknown host callback " << id;
+  unregistered_shapes_.emplace(id, it->second.shape);
+  entries_.erase(it);
+}
+
+xla::Shape HostCallbackRegistry::GetShape(int64_t id) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto it = entries_.find(id);
+  if (it != entries_.end()) {
+    return it->second.shape;
+  }
+  auto unregistered_it = unregistered_shapes_.find(id);
+  XLA_CHECK(unregistered_it != unregistered_shapes_.end())
+      << "Outfeed value for the unknown host callback " << id;
+  return unregistered_it->second;
+}
+
+void HostCallbackRegistry::Dispatch(const std::string& device, int64_t id,
+                                    xla::Literal payload) {
+  Callback callback;
+  at::ScalarType element_type;
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    auto it = entries_.find(id);
+    if (it == entries_.end()) {
+      XLA_COUNTER("HostCallbackDroppedValues", 1);
+      return;
+    }
+    callback = it->second.callback;
+    element_type = it->second.element_type;
+  }
+  XLA_COUNTER("HostCallbackValues", 1);
+  try {
+    callback(device,
+             MakeTensorFromXlaLiteral(std::move(payload), element_type));
+  } catch (const std::exception& ex) {
+    TF_LOG(ERROR) << "Host callback " << id << " failed: " << ex.what();
+  }
+}
+
+}  // namespace torch_xla
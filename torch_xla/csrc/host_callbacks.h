@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/xla_client/outfeed_listener.h"
+#include "torch/csrc/lazy/backend/backend_device.h"
+#include "torch/types.h"
+
+namespace torch_xla {
+
+// Routes the values the HostCallback nodes stream out of the running
+// computations, through the device outfeeds, to the registered callbacks. The
+// callbacks run on the outfeed listener thread of the device, in the order the
+// computation emitted their values, so they must not block for long.
+class HostCallbackRegistry {
+ public:
+  using Callback = std::function<void(const std::string& device,
+                                      at::Tensor value)>;
+
+  static HostCallbackRegistry* Get();
+
+  // Registers a callback receiving values of the given shape and element type
+  // out of the device, and starts listening to its outfeed. Returns the ID the
+  // HostCallback nodes carry.
+  int64_t Register(Callback callback, xla::Shape shape,
+                   at::ScalarType element_type,
+                   const torch::lazy::BackendDevice& device);
+
+  // The values still emitted for the callback, by computations already in
+  // flight, are read and dropped.
+  void Unregister(int64_t id);
+
+ private:
+  struct Entry {
+    Callback callback;
+    xla::Shape shape;
+    at::ScalarType element_type;
+  };
+
+  HostCallbackRegistry();
+
+  xla::Shape GetShape(int64_t id);
+
+  void Dispatch(const std::string& device, int64_t id, xla::Literal payload);
+
+  std::mutex lock_;
+  int64_t next_id_ = 0;
+  std::unordered_map<int64_t, Entry> entries_;
+  std::unordered_map<int64_t, xla::Shape> unregistered_shapes_;
+  std::unique_ptr<xla::OutfeedListener> listener_;
+};
+
+}  // namespace torch_xla
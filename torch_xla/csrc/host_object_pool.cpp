@@ -0,0 +1,184 @@
+#include "torch_xla/csrc/host_object_pool.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace host_pool {
+namespace {
+
+constexpr size_t kAlignment = 16;
+constexpr size_t kNumSizeClasses = kMaxPooledSize / kAlignment;
+constexpr size_t kSlabSize = 64 * 1024;
+// The number of blocks moved at once between the thread caches and the
+// central lists.
+constexpr size_t kBatchSize = 32;
+
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct FreeList {
+  void Push(void* ptr) {
+    FreeBlock* block = static_cast<FreeBlock*>(ptr);
+    block->next = head;
+    head = block;
+    ++count;
+  }
+
+  void* Pop() {
+    FreeBlock* block = head;
+    head = block->next;
+    --count;
+    return block;
+  }
+
+  FreeBlock* head = nullptr;
+  size_t count = 0;
+};
+
+class CentralPool {
+ public:
+  static CentralPool* Get() {
+    static CentralPool* pool = new CentralPool();
+    return pool;
+  }
+
+  // Moves up to kBatchSize free blocks of the size class into the list.
+  void Fetch(size_t size_class, FreeList* list) {
+    SizeClass& sclass = classes_[size_class];
+    std::lock_guard<std::mutex> lock(sclass.lock);
+    if (sclass.blocks.count == 0) {
+      NewSlab(size_class, &sclass.blocks);
+    }
+    while (list->count < kBatchSize && sclass.blocks.count > 0) {
+      list->Push(sclass.blocks.Pop());
+    }
+  }
+
+  // Moves back count free blocks of the size class from the list.
+  void Release(size_t size_class, FreeList* list, size_t count) {
+    SizeClass& sclass = classes_[size_class];
+    std::lock_guard<std::mutex> lock(sclass.lock);
+    for (; count > 0 && list->count > 0; --count) {
+      sclass.blocks.Push(list->Pop());
+    }
+  }
+
+  int64_t GetNumSlabs() const { return num_slabs_.load(); }
+
+ private:
+  struct SizeClass {
+    std::mutex lock;
+    FreeList blocks;
+  };
+
+  void NewSlab(size_t size_class, FreeList* list) {
+    XLA_COUNTER("HostObjectPoolSlabs", 1);
+    size_t block_size = (size_class + 1) * kAlignment;
+    char* slab = static_cast<char*>(::operator new(kSlabSize));
+    for (size_t offset = 0; offset + block_size <= kSlabSize;
+         offset += block_size) {
+      list->Push(slab + offset);
+    }
+    num_slabs_ += 1;
+  }
+
+  std::array<SizeClass, kNumSizeClasses> classes_;
+  std::atomic<int64_t> num_slabs_{0};
+};
+
+struct ThreadCache {
+  ~ThreadCache() {
+    for (size_t i = 0; i < lists.size(); ++i) {
+      CentralPool::Get()->Release(i, &lists[i], lists[i].count);
+    }
+  }
+
+  std::array<FreeList, kNumSizeClasses> lists;
+};
+
+// The cache is reached through a trivially destructible pointer, so that the
+// objects freed by the destructors of the thread locals which run after the
+// one of the cache go straight to the central lists.
+thread_local ThreadCache* g_thread_cache = nullptr;
+thread_local bool g_thread_exited = false;
+
+struct ThreadCacheOwner {
+  ~ThreadCacheOwner() {
+    delete g_thread_cache;
+    g_thread_cache = nullptr;
+    g_thread_exited = true;
+  }
+};
+
+ThreadCache* GetThreadCache() {
+  if (g_thread_cache == nullptr && !g_thread_exited) {
+    static thread_local ThreadCacheOwner owner;
+    g_thread_cache = new ThreadCache();
+  }
+  return g_thread_cache;
+}
+
+size_t GetSizeClass(size_t size) {
+  return (std::max<size_t>(size, 1) + kAlignment - 1) / kAlignment - 1;
+}
+
+}  // namespace
+
+bool IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_HOST_OBJECT_POOL", false);
+  return enabled;
+}
+
+void* Allocate(size_t size) {
+  if (size > kMaxPooledSize || !IsEnabled()) {
+    return ::operator new(size);
+  }
+  size_t size_class = GetSizeClass(size);
+  ThreadCache* cache = GetThreadCache();
+  if (cache == nullptr) {
+    FreeList list;
+    CentralPool::Get()->Fetch(size_class, &list);
+    void* ptr = list.Pop();
+    CentralPool::Get()->Release(size_class, &list, list.count);
+    return ptr;
+  }
+  FreeList& list = cache->lists[size_class];
+  if (list.count == 0) {
+    CentralPool::Get()->Fetch(size_class, &list);
+  }
+  return list.Pop();
+}
+
+void Deallocate(void* ptr, size_t size) {
+  if (size > kMaxPooledSize || !IsEnabled()) {
+    ::operator delete(ptr);
+    return;
+  }
+  size_t size_class = GetSizeClass(size);
+  ThreadCache* cache = GetThreadCache();
+  if (cache == nullptr) {
+    FreeList list;
+    list.Push(ptr);
+    CentralPool::Get()->Release(size_class, &list, 1);
+    return;
+  }
+  FreeList& list = cache->lists[size_class];
+  list.Push(ptr);
+  if (list.count >= 2 * kBatchSize) {
+    CentralPool::Get()->Release(size_class, &list, kBatchSize);
+  }
+}
+
+int64_t GetNumSlabs() { return CentralPool::Get()->GetNumSlabs(); }
+
+}  // namespace host_pool
+}  // namespace torch_xla
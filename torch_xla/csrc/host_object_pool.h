@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace torch_xla {
+namespace host_pool {
+
+// Allocates the small host objects which get created at every traced
+// operation (the IR nodes, tensor data, impls and views) out of size classes
+// carved from larger slabs, with a cache of free blocks per thread, so that
+// tight tracing loops mostly recycle blocks without going through malloc.
+// Enabled with XLA_HOST_OBJECT_POOL=1, otherwise (or for sizes above
+// kMaxPooledSize) the blocks come from the global operator new. The slabs are
+// never released to the system.
+constexpr size_t kMaxPooledSize = 1024;
+
+bool IsEnabled();
+
+void* Allocate(size_t size);
+
+// The size must be the one the block was allocated with.
+void Deallocate(void* ptr, size_t size);
+
+// Returns the number of slabs allocated so far, across the size classes.
+int64_t GetNumSlabs();
+
+template <typename T>
+class Allocator {
+ public:
+  using value_type = T;
+
+  Allocator() = default;
+
+  template <typename U>
+  Allocator(const Allocator<U>&) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(Allocate(n * sizeof(T))); }
+
+  void deallocate(T* ptr, size_t n) { Deallocate(ptr, n * sizeof(T)); }
+};
+
+template <typename T, typename U>
+bool operator==(const Allocator<T>&, const Allocator<U>&) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const Allocator<T>&, const Allocator<U>&) {
+  return false;
+}
+
+// Like std::make_shared(), with the object and its control block allocated
+// from the pool.
+template <typename T, typename... Args>
+std::shared_ptr<T> MakeShared(Args&&... args) {
+  return std::allocate_shared<T>(Allocator<T>(), std::forward<Args>(args)...);
+}
+
+}  // namespace host_pool
+}  // namespace torch_xla
+
+// Routes the heap allocations of the class, like the c10::make_intrusive()
+// ones, to the pool.
+#define XLA_HOST_POOL_ALLOCATED                                   \
+  static void* operator new(size_t size) {                        \
+    return ::torch_xla::host_pool::Allocate(size);                \
+  }                                                               \
+  static void operator delete(void* ptr, size_t size) {           \
+    ::torch_xla::host_pool::Deallocate(ptr, size);                \
+  }
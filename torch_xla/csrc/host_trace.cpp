@@ -0,0 +1,43 @@
+#include "torch_xla/csrc/host_trace.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace host_trace {
+namespace {
+
+struct ThreadState {
+  // The number of the spans of the thread currently open.
+  int64_t depth = 0;
+  // Whether the current root span got sampled.
+  bool sampled = false;
+  int64_t num_roots = 0;
+};
+
+ThreadState* GetThreadState() {
+  static thread_local ThreadState state;
+  return &state;
+}
+
+}  // namespace
+
+bool ScopedSpan::EnterSampled() {
+  static const int64_t sampling =
+      std::max<int64_t>(xla::sys_util::GetEnvInt("XLA_HOST_TRACE_SAMPLING", 1),
+                        1);
+  ThreadState* state = GetThreadState();
+  if (state->depth == 0) {
+    state->sampled = state->num_roots % sampling == 0;
+    state->num_roots += 1;
+  }
+  state->depth += 1;
+  return state->sampled;
+}
+
+void ScopedSpan::Exit() { GetThreadState()->depth -= 1; }
+
+}  // namespace host_trace
+}  // namespace torch_xla
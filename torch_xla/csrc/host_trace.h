@@ -0,0 +1,89 @@
+#pragma once
+
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+#include "torch_xla/csrc/function_call_tracker.h"
+#include "torch_xla/csrc/step_breakdown.h"
+
+namespace torch_xla {
+namespace host_trace {
+
+// The spans are verbose ones, which the profiling sessions record with a host
+// tracer level of 3.
+constexpr int kHostTraceLevel = tensorflow::profiler::TraceMeLevel::kVerbose;
+
+// The host side spans of the dispatch, tracing, lowering and transfer paths,
+// which show up on the profiler timeline next to the device activity. They
+// cost a relaxed atomic load when no profiling session is active, and get
+// compiled out altogether when building with XLA_DISABLE_HOST_TRACING=1.
+// While profiling, only one root span (the outermost span of a thread) out
+// of XLA_HOST_TRACE_SAMPLING gets recorded, together with all the spans
+// nested within it, so that the sampled spans keep their full call trees.
+class ScopedSpan {
+ public:
+  explicit ScopedSpan(const char* name) {
+    if (Enter()) {
+      trace_.emplace(name, kHostTraceLevel);
+    }
+  }
+
+  template <typename NameGenerator>
+  explicit ScopedSpan(NameGenerator&& name_generator) {
+    if (Enter()) {
+      trace_.emplace(std::forward<NameGenerator>(name_generator),
+                     kHostTraceLevel);
+    }
+  }
+
+  ~ScopedSpan() {
+    if (entered_) {
+      Exit();
+    }
+  }
+
+ private:
+  bool Enter() {
+    if (!tensorflow::profiler::TraceMe::Active(kHostTraceLevel)) {
+      return false;
+    }
+    entered_ = true;
+    return EnterSampled();
+  }
+
+  // Returns whether the span, nested within the current spans of the thread,
+  // gets recorded.
+  static bool EnterSampled();
+
+  static void Exit();
+
+  bool entered_ = false;
+  absl::optional<tensorflow::profiler::TraceMe> trace_;
+};
+
+}  // namespace host_trace
+}  // namespace torch_xla
+
+#ifdef XLA_DISABLE_HOST_TRACING
+#define XLA_TRACE_SCOPE(name)
+#define XLA_FN_TRACE(ns)                              \
+  XLA_FN_COUNTER(ns);                                 \
+  XLA_FN_TRACK(::torch_xla::fn_tracker::kAtenOpLevel); \
+  XLA_STEP_PHASE(kDispatch)
+#else
+#define XLA_TRACE_SCOPE(name) \
+  ::torch_xla::host_trace::ScopedSpan __xla_trace_span(name)
+
+// Counts the calls of the function, like XLA_FN_COUNTER(), tracks them with
+// the function call tracker, accounts their time to the dispatch phase of the
+// step and traces them within a span of the same name.
+#define XLA_FN_TRACE(ns)                                            \
+  XLA_FN_COUNTER(ns);                                               \
+  XLA_FN_TRACK(::torch_xla::fn_tracker::kAtenOpLevel);              \
+  XLA_STEP_PHASE(kDispatch);                                        \
+  ::torch_xla::host_trace::ScopedSpan __xla_trace_span(             \
+      [fn_name = __FUNCTION__]() { return absl::StrCat(ns, fn_name); })
+#endif
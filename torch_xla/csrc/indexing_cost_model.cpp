@@ -0,0 +1,329 @@
+#include "torch_xla/csrc/indexing_cost_model.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/core/platform/env.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/version.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+using Op = IndexingCostModel::Op;
+using Costs = IndexingCostModel::Costs;
+
+// The size of the non indexed dimension of the benchmark tensors.
+constexpr int64_t kBenchmarkWidth = 128;
+constexpr int kBenchmarkRuns = 5;
+
+// The (dim_size, num_indices) of the two points every cost line gets fitted
+// through. The small one is dominated by the fixed costs.
+constexpr std::pair<int64_t, int64_t> kSmallShape = {1024, 64};
+constexpr std::pair<int64_t, int64_t> kLargeShape = {8192, 512};
+
+struct ModelEntry {
+  std::once_flag once;
+  Costs costs;
+};
+
+struct ModelState {
+  std::mutex lock;
+  std::map<std::pair<int, Op>, std::shared_ptr<ModelEntry>> entries;
+};
+
+ModelState* GetModelState() {
+  static ModelState* state = new ModelState();
+  return state;
+}
+
+const char* OpName(Op op) { return op == Op::kGather ? "gather" : "scatter"; }
+
+std::string GetVersionStamp() {
+  return absl::StrCat(XLA_GITREV, ":", TORCH_GITREV, ":",
+                      xla::sys_util::GetEnvString("XLA_FLAGS", ""));
+}
+
+std::string GetStorePath(const torch::lazy::BackendDevice& device) {
+  std::string path =
+      xla::sys_util::GetEnvString("XLA_PERSISTENT_CACHE_PATH", "");
+  if (path.empty()) {
+    return path;
+  }
+  return absl::StrCat(
+      path, "/indexing_cost_model.",
+      DeviceType(static_cast<XlaDeviceType>(device.type())).toString(),
+      ".txt");
+}
+
+// The stored model is the version stamp line, followed by one line per op
+// with its name and its four costs.
+bool LoadCosts(const std::string& path, Op op, Costs* costs) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::string data;
+  if (!env->FileExists(path).ok() ||
+      !tensorflow::ReadFileToString(env, path, &data).ok()) {
+    return false;
+  }
+  std::vector<std::string> lines = absl::StrSplit(data, '\n');
+  if (lines.empty() || lines[0] != GetVersionStamp()) {
+    return false;
+  }
+  for (size_t i = 1; i < lines.size(); ++i) {
+    std::vector<std::string> fields =
+        absl::StrSplit(lines[i], ' ', absl::SkipEmpty());
+    if (fields.size() == 5 && fields[0] == OpName(op)) {
+      costs->dense_fixed = std::stod(fields[1]);
+      costs->dense_per_element = std::stod(fields[2]);
+      costs->sparse_fixed = std::stod(fields[3]);
+      costs->sparse_per_element = std::stod(fields[4]);
+      return true;
+    }
+  }
+  return false;
+}
+
+void StoreCosts(const std::string& path, Op op, const Costs& costs) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::string data;
+  std::vector<std::string> lines;
+  if (env->FileExists(path).ok() &&
+      tensorflow::ReadFileToString(env, path, &data).ok()) {
+    lines = absl::StrSplit(data, '\n', absl::SkipEmpty());
+  }
+  if (lines.empty() || lines[0] != GetVersionStamp()) {
+    lines = {GetVersionStamp()};
+  }
+  lines.erase(std::remove_if(lines.begin() + 1, lines.end(),
+                             [&](const std::string& line) {
+                               return absl::StartsWith(
+                                   line, absl::StrCat(OpName(op), " "));
+                             }),
+              lines.end());
+  lines.push_back(absl::StrCat(OpName(op), " ", costs.dense_fixed, " ",
+                               costs.dense_per_element, " ",
+                               costs.sparse_fixed, " ",
+                               costs.sparse_per_element));
+  // Written to a temporary file first, so that concurrent readers never see a
+  // partial model.
+  std::string tmp_path = absl::StrCat(path, ".tmp", env->NowMicros());
+  xla::Status status = tensorflow::WriteStringToFile(
+      env, tmp_path, absl::StrCat(absl::StrJoin(lines, "\n"), "\n"));
+  if (status.ok()) {
+    status = env->RenameFile(tmp_path, path);
+  }
+  if (!status.ok()) {
+    TF_LOG(WARNING) << "Unable to store the indexing cost model to " << path
+                    << ": " << status;
+  }
+}
+
+xla::XlaComputation BuildBenchmark(const torch::lazy::BackendDevice& device,
+                                   Op op, bool dense, int64_t dim_size,
+                                   int64_t num_indices) {
+  xla::XlaBuilder builder(absl::StrCat("IndexingBenchmark_", OpName(op)));
+  xla::XlaOp input = xla::Parameter(
+      &builder, 0,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32,
+                                {dim_size, kBenchmarkWidth}),
+      "input");
+  xla::XlaOp index = xla::Parameter(
+      &builder, 1,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                {num_indices, kBenchmarkWidth}),
+      "index");
+  xla::XlaOp result;
+  if (op == Op::kGather) {
+    result = xla::TorchGather(input, index, /*dim=*/0, /*sparse=*/!dense);
+  } else {
+    // Like the backward of an embedding: a scatter add of repeated indices.
+    ScatterOptions options(NumericAddCombiner());
+    options.indices_are_unique = false;
+    options.use_dense = dense;
+    xla::XlaOp source = xla::Broadcast(
+        xla::One(&builder, xla::PrimitiveType::F32),
+        {num_indices, kBenchmarkWidth});
+    result = CreateScatter(device, input, index, source, /*dim=*/0, options);
+  }
+  // Reduced to a scalar, so that the result transfers cost nothing.
+  result = xla::ReduceAll(
+      result, xla::Zero(&builder, xla::PrimitiveType::F32),
+      XlaHelpers::CreateAddComputation(xla::PrimitiveType::F32));
+  return ConsumeValue(builder.Build(result));
+}
+
+xla::ComputationClient::DataPtr CreateBenchmarkData(
+    const std::string& device, xla::PrimitiveType type, int64_t rows,
+    int64_t range) {
+  auto populate_fn = [=](const xla::ComputationClient::TensorSource& source,
+                         void* dest_buffer, size_t dest_buffer_size) {
+    if (type == xla::PrimitiveType::S32) {
+      // Spread, deterministic, indices.
+      int32_t* indices = reinterpret_cast<int32_t*>(dest_buffer);
+      for (size_t i = 0; i < dest_buffer_size / sizeof(int32_t); ++i) {
+        indices[i] = static_cast<int32_t>((i * 7919) % range);
+      }
+    } else {
+      std::memset(dest_buffer, 0, dest_buffer_size);
+    }
+  };
+  std::vector<xla::ComputationClient::TensorSource> sources;
+  sources.emplace_back(
+      xla::ShapeUtil::MakeShape(type, {rows, kBenchmarkWidth}), device,
+      std::move(populate_fn));
+  return xla::ComputationClient::Get()->TransferToServer(sources).front();
+}
+
+// Returns the best time (in microseconds) of the lowering over a few runs.
+double MeasureLowering(const torch::lazy::BackendDevice& device, Op op,
+                       bool dense, int64_t dim_size, int64_t num_indices) {
+  std::string device_str = device.toString();
+  xla::ComputationClient* client = xla::ComputationClient::Get();
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back(
+      {BuildBenchmark(device, op, dense, dim_size, num_indices), device_str,
+       client->GetCompilationDevices(device_str, {}), nullptr});
+  std::shared_ptr<xla::ComputationClient::Computation> computation =
+      client->Compile(std::move(instances)).front();
+  std::vector<xla::ComputationClient::DataPtr> arguments = {
+      CreateBenchmarkData(device_str, xla::PrimitiveType::F32, dim_size,
+                          dim_size),
+      CreateBenchmarkData(device_str, xla::PrimitiveType::S32, num_indices,
+                          dim_size)};
+  xla::ComputationClient::ExecuteComputationOptions options;
+  double best_time = 0;
+  // The first run is a warm up.
+  for (int run = 0; run <= kBenchmarkRuns; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<xla::ComputationClient::DataPtr> results =
+        client->ExecuteComputation(*computation, arguments, device_str,
+                                   options);
+    client->TransferFromServer(results);
+    double time = std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    if (run == 1 || (run > 1 && time < best_time)) {
+      best_time = time;
+    }
+  }
+  return best_time;
+}
+
+// Fits the (fixed, per_element) line through the two measured points.
+std::pair<double, double> FitCosts(double small_time, double small_work,
+                                   double large_time, double large_work) {
+  double per_element =
+      std::max((large_time - small_time) / (large_work - small_work), 0.0);
+  double fixed = std::max(small_time - per_element * small_work, 0.0);
+  return {fixed, per_element};
+}
+
+Costs Calibrate(const torch::lazy::BackendDevice& device, Op op) {
+  XLA_TIMED("IndexingCostModelCalibration");
+  Costs costs;
+  auto dense_work = [](std::pair<int64_t, int64_t> shape) {
+    return static_cast<double>(shape.first) * shape.second * kBenchmarkWidth;
+  };
+  auto sparse_work = [](std::pair<int64_t, int64_t> shape) {
+    return static_cast<double>(shape.second) * kBenchmarkWidth;
+  };
+  std::tie(costs.dense_fixed, costs.dense_per_element) = FitCosts(
+      MeasureLowering(device, op, /*dense=*/true, kSmallShape.first,
+                      kSmallShape.second),
+      dense_work(kSmallShape),
+      MeasureLowering(device, op, /*dense=*/true, kLargeShape.first,
+                      kLargeShape.second),
+      dense_work(kLargeShape));
+  std::tie(costs.sparse_fixed, costs.sparse_per_element) = FitCosts(
+      MeasureLowering(device, op, /*dense=*/false, kSmallShape.first,
+                      kSmallShape.second),
+      sparse_work(kSmallShape),
+      MeasureLowering(device, op, /*dense=*/false, kLargeShape.first,
+                      kLargeShape.second),
+      sparse_work(kLargeShape));
+  return costs;
+}
+
+}  // namespace
+
+bool IndexingCostModel::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_INDEXING_COST_MODEL", false);
+  return enabled;
+}
+
+bool IndexingCostModel::PreferDense(const torch::lazy::BackendDevice& device,
+                                    Op op, int64_t dim_size,
+                                    int64_t index_elements) {
+  Costs costs = GetCosts(device, op);
+  double dense_cost =
+      costs.dense_fixed + costs.dense_per_element *
+                              static_cast<double>(index_elements) * dim_size;
+  double sparse_cost = costs.sparse_fixed + costs.sparse_per_element *
+                                                static_cast<double>(
+                                                    index_elements);
+  bool dense = dense_cost < sparse_cost;
+  TF_VLOG(5) << "Indexing cost model for " << OpName(op)
+             << ": dim_size=" << dim_size
+             << " index_elements=" << index_elements
+             << " dense_cost=" << dense_cost << " sparse_cost=" << sparse_cost;
+  return dense;
+}
+
+IndexingCostModel::Costs IndexingCostModel::GetCosts(
+    const torch::lazy::BackendDevice& device, Op op) {
+  ModelState* state = GetModelState();
+  std::shared_ptr<ModelEntry> entry;
+  {
+    // Only guards the lookup. The calibration runs outside of it, behind the
+    // per entry once flag, so that it does not stall the other device types.
+    std::lock_guard<std::mutex> lock(state->lock);
+    std::shared_ptr<ModelEntry>& slot =
+        state->entries[std::make_pair(device.type(), op)];
+    if (slot == nullptr) {
+      slot = std::make_shared<ModelEntry>();
+    }
+    entry = slot;
+  }
+  std::call_once(entry->once, [&]() {
+    Costs costs;
+    std::string path = GetStorePath(device);
+    if (path.empty() || !LoadCosts(path, op, &costs)) {
+      XLA_COUNTER("IndexingCostModelCalibrations", 1);
+      costs = Calibrate(device, op);
+      if (!path.empty()) {
+        StoreCosts(path, op, costs);
+      }
+    }
+    TF_VLOG(1) << "Indexing cost model for " << OpName(op) << " on "
+               << device.toString() << ": dense_fixed=" << costs.dense_fixed
+               << "us dense_per_element=" << costs.dense_per_element
+               << "us sparse_fixed=" << costs.sparse_fixed
+               << "us sparse_per_element=" << costs.sparse_per_element
+               << "us";
+    entry->costs = costs;
+  });
+  return entry->costs;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "torch_xla/csrc/device.h"
+
+namespace torch_xla {
+
+// Cost model choosing between the dense (one-hot compare and reduce) and the
+// sparse (XLA gather/scatter) lowerings of the torch gather and scatter
+// operations, instead of the fixed XLA_DENSE_GATHER_FACTOR and
+// XLA_DENSE_SCATTER_FACTOR ratios. The costs of both lowerings are linear
+// models of the work they do, measured once per device type by a calibration
+// micro-benchmark, which is stored next to the persistent compilation cache
+// (if XLA_PERSISTENT_CACHE_PATH is set) so that later processes skip it.
+class IndexingCostModel {
+ public:
+  enum class Op { kGather, kScatter };
+
+  // The estimated time (in microseconds) of a lowering is fixed +
+  // per_element * work, where the work is index_elements * dim_size for the
+  // dense lowering, and index_elements for the sparse one.
+  struct Costs {
+    double dense_fixed = 0;
+    double dense_per_element = 0;
+    double sparse_fixed = 0;
+    double sparse_per_element = 0;
+  };
+
+  // Whether the lowerings get picked by the cost model
+  // (XLA_INDEXING_COST_MODEL).
+  static bool IsEnabled();
+
+  // Whether the dense lowering of the op is expected to be faster, for an
+  // index of index_elements elements into an input dimension of dim_size.
+  static bool PreferDense(const torch::lazy::BackendDevice& device, Op op,
+                          int64_t dim_size, int64_t index_elements);
+
+  // Returns the costs of the op on the type of the given device, calibrating
+  // them if they are neither known nor stored.
+  static Costs GetCosts(const torch::lazy::BackendDevice& device, Op op);
+};
+
+}  // namespace torch_xla
@@ -1,8 +1,11 @@
 #include <Python.h>
+#include <frameobject.h>
 #include <c10/core/Device.h>
 #include <c10/util/Optional.h>
 
+#include <algorithm>
 #include <cstring>
+#include <map>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -17,7 +20,10 @@
 #include "tensorflow/compiler/xla/service/hlo_verifier.h"
 #include "tensorflow/compiler/xla/service/sharding_propagation.h"
 #include "tensorflow/compiler/xla/service/spmd/spmd_partitioner.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/future.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/compiler/xla/xla_client/mesh_service.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/metrics_analysis.h"
@@ -31,28 +37,43 @@
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 #include "tensorflow/core/example/example.pb.h"
 #include "tensorflow/core/example/feature.pb.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 #include "tensorflow/python/profiler/internal/profiler_pywrap_impl.h"
 #include "tensorflow/python/profiler/internal/traceme_wrapper.h"
+#include "torch/csrc/autograd/python_variable.h"
 #include "torch/csrc/autograd/utils/wrap_outputs.h"
 #include "torch/csrc/autograd/variable.h"
 #include "torch/csrc/jit/python/pybind.h"
 #include "torch/csrc/lazy/core/config.h"
+#include "torch/csrc/lazy/core/helpers.h"
 #include "torch/csrc/lazy/core/ir_util.h"
+#include "torch_xla/csrc/aten_autograd_ops.h"
+#include "torch_xla/csrc/aten_cpu_fallback.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/computation.h"
+#include "torch_xla/csrc/debug_util.h"
 #include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/example_batch.h"
+#include "torch_xla/csrc/function_call_tracker.h"
 #include "torch_xla/csrc/generated/XLANativeFunctions.h"
+#include "torch_xla/csrc/graph_profiler.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/host_callbacks.h"
+#include "torch_xla/csrc/input_prefetcher.h"
 #include "torch_xla/csrc/ir.h"
 #include "torch_xla/csrc/ir_dump_util.h"
 #include "torch_xla/csrc/ir_util.h"
+#include "torch_xla/csrc/mapped_tensors.h"
+#include "torch_xla/csrc/source_location_table.h"
+#include "torch_xla/csrc/step_breakdown.h"
 #include "torch_xla/csrc/tensor_impl.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
 #include "torch_xla/csrc/version.h"
 #include "torch_xla/csrc/xla_backend_impl.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 #include "torch_xla/csrc/xla_op_builder.h"
 
 namespace torch_xla {
@@ -85,6 +106,7 @@ void PrepareToExit() {
     XLATensor::WaitDeviceOps({});
     client->PrepareToExit();
   }
+  DebugUtil::FlushTensorsGraphInfo();
 }
 
 std::string GetTensorsDump(
@@ -208,6 +230,15 @@ std::pair<at::Tensor, std::shared_ptr<torch::lazy::Value>> AllReduce(
       std::make_shared<torch::lazy::Value>(new_token));
 }
 
+xla::PrimitiveType GetWireType(const std::string& wire_type) {
+  if (wire_type == "bf16") {
+    return xla::PrimitiveType::BF16;
+  } else if (wire_type == "f16") {
+    return xla::PrimitiveType::F16;
+  }
+  XLA_ERROR() << "Unsupported compressed all-reduce wire type: " << wire_type;
+}
+
 std::pair<at::Tensor, std::shared_ptr<torch::lazy::Value>> ReduceScatter(
     const std::string& reduce_type, const at::Tensor& input,
     const std::shared_ptr<torch::lazy::Value>& token, double scale,
@@ -333,11 +364,27 @@ void SyncLiveTensors(const std::string& device_str,
 
 void StepMarker(const std::string& device_str,
                 const std::vector<std::string>& devices, bool wait) {
+  // The host time between the step markers traces the graphs, while the one
+  // within them syncs them. With one tracing thread per device, every thread
+  // measures its own steps.
+  static xla::metrics::Metric* tracing_metric = new xla::metrics::Metric(
+      "StepTracingTime", xla::metrics::MetricFnTime);
+  static xla::metrics::Metric* sync_metric =
+      new xla::metrics::Metric("StepSyncTime", xla::metrics::MetricFnTime);
+  static thread_local int64_t last_step_end_ns = 0;
   tensorflow::profiler::TraceMe activity(
       "StepMarker", tensorflow::profiler::TraceMeLevel::kInfo);
+  int64_t start_ns = xla::sys_util::NowNs();
+  int64_t last_end_ns = last_step_end_ns;
+  if (last_end_ns > 0) {
+    tracing_metric->AddSample(start_ns - last_end_ns);
+  }
   torch::lazy::BackendDevice device = GetDeviceOrCurrent(device_str);
   XLATensor::SyncLiveTensorsGraph(&device, devices, wait);
   XLATensor::MarkStep(device);
+  int64_t end_ns = xla::sys_util::NowNs();
+  sync_metric->AddSample(end_ns - start_ns);
+  last_step_end_ns = end_ns;
   bool debug_mode = xla::sys_util::GetEnvBool("PT_XLA_DEBUG", false);
   if (TF_PREDICT_FALSE(debug_mode)) {
     std::string report = xla::metrics::CreatePerformanceReport();
@@ -362,12 +409,74 @@ uint64_t GetRngSeed(const std::string& device_str) {
   return XLATensor::GetRunningSeed(GetDeviceOrCurrent(device_str));
 }
 
+py::dict PlanSpmdMemory(const std::vector<at::Tensor>& tensors,
+                        int64_t num_devices) {
+  std::vector<torch::lazy::Value> values;
+  for (auto& xtensor : GetXlaTensors(tensors, /*want_all=*/false)) {
+    torch::lazy::Value ir_value = xtensor->CurrentIrValue();
+    if (ir_value) {
+      values.push_back(std::move(ir_value));
+    }
+  }
+  XLA_CHECK(!values.empty()) << "The tensors have no pending graph";
+  SpmdMemoryPlan plan;
+  {
+    NoGilSection nogil;
+    plan =
+        ShardingUtil::PlanSpmdMemory(values, GetCurrentDevice(), num_devices);
+  }
+  auto py_plan = py::dict();
+  py_plan["argument_bytes"] = py::cast(plan.argument_bytes);
+  py_plan["output_bytes"] = py::cast(plan.output_bytes);
+  py_plan["temp_bytes"] = py::cast(plan.temp_bytes);
+  py_plan["peak_bytes"] = py::cast(plan.peak_bytes);
+  py_plan["collective_bytes"] = py::cast(plan.collective_bytes);
+  return py_plan;
+}
+
 std::string GetTensorsHloGraph(const std::vector<at::Tensor>& tensors) {
   std::vector<XLATensorPtr> xtensors =
       GetXlaTensors(tensors, /*want_all=*/false);
   return XLATensor::DumpHloComputation(xtensors);
 }
 
+std::string GetGraphId(const torch::lazy::hash_t& hash) {
+  return absl::StrCat(absl::Hex(c10::Uint128High64(hash), absl::kZeroPad16),
+                      absl::Hex(c10::Uint128Low64(hash), absl::kZeroPad16));
+}
+
+torch::lazy::hash_t GetGraphHash(const std::string& graph_id) {
+  XLA_CHECK_EQ(graph_id.size(), 32) << "Invalid graph ID: " << graph_id;
+  return torch::lazy::hash_t(std::stoull(graph_id.substr(0, 16), nullptr, 16),
+                             std::stoull(graph_id.substr(16), nullptr, 16));
+}
+
+std::string CaptureGraph(const std::vector<at::Tensor>& outputs,
+                         const std::vector<at::Tensor>& inputs) {
+  return GetGraphId(
+      XLATensor::CaptureGraph(GetXlaTensors(outputs, /*want_all=*/true),
+                              GetXlaTensors(inputs, /*want_all=*/true)));
+}
+
+std::string CaptureLoop(const std::string& graph_id, int64_t num_iterations,
+                        int64_t num_carried) {
+  XLA_CHECK_GE(num_carried, 0);
+  return GetGraphId(XLATensor::CaptureLoop(GetGraphHash(graph_id),
+                                           num_iterations, num_carried));
+}
+
+std::vector<at::Tensor> ReplayGraph(const std::string& graph_id,
+                                    const std::vector<at::Tensor>& inputs) {
+  std::vector<XLATensorPtr> xtensors = XLATensor::ReplayGraph(
+      GetGraphHash(graph_id), GetXlaTensors(inputs, /*want_all=*/true));
+  std::vector<at::Tensor> results;
+  results.reserve(xtensors.size());
+  for (auto& xtensor : xtensors) {
+    results.push_back(bridge::AtenFromXlaTensor(std::move(xtensor)));
+  }
+  return results;
+}
+
 std::string GetLiveTensorsReport(size_t nodes_threshold,
                                  const std::string& device_str) {
   auto opt_device = GetOptionalDevice(device_str);
@@ -385,8 +494,8 @@ std::string GetLiveTensorsReport(size_t nodes_threshold,
            << ", device=" << tensor->GetDevice()
            << ", ir_nodes=" << post_order.size() << "\n";
         for (size_t i = post_order.size(); i > 0; --i) {
-          if (!post_order[i - 1]->metadata().frame_info.empty()) {
-            ss << post_order[i - 1]->metadata().frame_info;
+          if (!GetFrameInfo(post_order[i - 1]).empty()) {
+            ss << GetFrameInfo(post_order[i - 1]);
             break;
           }
         }
@@ -408,6 +517,45 @@ std::ptrdiff_t GetTensorId(const at::Tensor& tensor) {
   return xtensor->GetUniqueId();
 }
 
+// The Python handle of an asynchronous fetch of the CPU values of a list of
+// tensors. Undefined and non XLA tensors are passed through, like
+// bridge::XlaCreateTensorList() does.
+class AsyncCpuTensors {
+ public:
+  explicit AsyncCpuTensors(const std::vector<at::Tensor>& tensors)
+      : tensors_(tensors) {
+    std::vector<XLATensorPtr> xla_tensors;
+    for (size_t i = 0; i < tensors_.size(); ++i) {
+      if (tensors_[i].defined()) {
+        XLATensorPtr xtensor = bridge::TryGetXlaTensor(tensors_[i]);
+        if (xtensor) {
+          xla_indices_.push_back(i);
+          xla_tensors.push_back(std::move(xtensor));
+        }
+      }
+    }
+    fetch_ = XLATensor::GetTensorsAsync(&xla_tensors);
+  }
+
+  bool IsDone() const { return fetch_->IsDone(); }
+
+  std::vector<at::Tensor> Wait() {
+    std::vector<at::Tensor> cpu_tensors = fetch_->Wait();
+    std::vector<at::Tensor> result(tensors_.begin(), tensors_.end());
+    for (size_t i = 0; i < xla_indices_.size(); ++i) {
+      size_t index = xla_indices_[i];
+      result[index] = torch::autograd::make_variable(
+          cpu_tensors[i], /*requires_grad=*/tensors_[index].requires_grad());
+    }
+    return result;
+  }
+
+ private:
+  std::vector<at::Tensor> tensors_;
+  std::vector<size_t> xla_indices_;
+  std::shared_ptr<XLATensor::AsyncFetch> fetch_;
+};
+
 std::vector<at::Tensor> GetXlaTensorsFromAten(
     const std::vector<at::Tensor>& aten_tensors,
     const std::vector<std::string>& devices) {
@@ -441,6 +589,109 @@ at::Tensor GetXlaTensorDimensionSize(const at::Tensor& tensor, int64_t dim) {
       XLATensor::get_dimensions_size(xtensor, {dim}));
 }
 
+py::object GetMetricHistogram(const std::string& name) {
+  xla::metrics::MetricData* data = xla::metrics::GetMetric(name);
+  if (data == nullptr) {
+    return py::none();
+  }
+  xla::metrics::Histogram histogram = data->GetHistogram();
+  auto py_buckets = py::list();
+  for (auto& index_count : histogram.Buckets()) {
+    std::pair<double, double> bounds =
+        xla::metrics::Histogram::BucketBounds(index_count.first);
+    py_buckets.append(
+        py::make_tuple(bounds.first, bounds.second, index_count.second));
+  }
+  return py::make_tuple(histogram.Count(), histogram.Sum(), histogram.Min(),
+                        histogram.Max(), py_buckets);
+}
+
+py::list GetMemorySnapshot() {
+  int64_t now_ns = xla::sys_util::NowNs();
+  py::list py_buffers;
+  for (auto& buffer : xla::memory_tracker::GetLiveBuffers()) {
+    py::dict py_buffer;
+    py_buffer["device"] = buffer.device;
+    py_buffer["bytes"] = buffer.bytes;
+    py_buffer["owner"] = buffer.owner;
+    py_buffer["graph"] = buffer.graph;
+    py_buffer["age_ns"] = now_ns - buffer.allocation_ns;
+    py_buffers.append(py_buffer);
+  }
+  return py_buffers;
+}
+
+py::list GetGraphProfile() {
+  py::list py_graphs;
+  for (auto& stats : GraphProfiler::Get()->GetStats()) {
+    py::dict py_stats;
+    py_stats["hash"] = torch::lazy::HashToString(stats.hash);
+    py_stats["device"] = stats.device;
+    py_stats["compilations"] = stats.compilations;
+    py_stats["compile_time_ns"] = stats.compile_time_ns;
+    py_stats["executions"] = stats.executions;
+    py_stats["execute_time_ns"] = stats.execute_time_ns;
+    py_stats["parameter_bytes"] = stats.parameter_bytes;
+    py_stats["output_bytes"] = stats.output_bytes;
+    py_stats["sources"] = stats.sources;
+    py_graphs.append(py_stats);
+  }
+  return py_graphs;
+}
+
+py::dict GetMetricsDelta(const xla::metrics_reader::MetricsSnapshot& before,
+                         const xla::metrics_reader::MetricsSnapshot& after) {
+  xla::metrics_reader::MetricsDelta delta =
+      xla::metrics_reader::DiffSnapshots(before, after);
+  py::dict py_delta;
+  py_delta["counters"] = delta.counters;
+  py::dict py_metrics;
+  for (auto& name_value : delta.metrics) {
+    py_metrics[py::str(name_value.first)] = py::make_tuple(
+        name_value.second.total_samples, name_value.second.accumulator);
+  }
+  py_delta["metrics"] = py_metrics;
+  py_delta["compiles"] = delta.compiles;
+  py_delta["executions"] = delta.executions;
+  py_delta["transfers_to_server"] = delta.transfers_to_server;
+  py_delta["transfers_from_server"] = delta.transfers_from_server;
+  py_delta["cpu_fallbacks"] = delta.cpu_fallbacks;
+  py_delta["bytes_to_server"] = delta.bytes_to_server;
+  py_delta["bytes_from_server"] = delta.bytes_from_server;
+  return py_delta;
+}
+
+py::list GetPerformanceAnalysis() {
+  py::list py_analyses;
+  for (auto& analysis : xla::metrics::RunPerformanceAnalysis()) {
+    py::dict py_analysis;
+    py_analysis["symptom"] = xla::metrics::SymptomName(analysis.symptom);
+    py_analysis["message"] = analysis.repr;
+    py_analysis["remediation"] = analysis.remediation;
+    py_analysis["values"] = analysis.values;
+    py_analyses.append(py_analysis);
+  }
+  return py_analyses;
+}
+
+py::list GetStepBreakdown() {
+  py::list py_steps;
+  for (auto& record : step_breakdown::GetSteps()) {
+    py::dict py_step;
+    py_step["step"] = record.step;
+    py_step["device"] = record.device;
+    py_step["wall_ns"] = record.wall_ns;
+    for (size_t i = 0; i < step_breakdown::kNumPhases; ++i) {
+      std::string name = absl::StrCat(
+          step_breakdown::PhaseName(static_cast<step_breakdown::Phase>(i)),
+          "_ns");
+      py_step[name.c_str()] = record.phase_ns[i];
+    }
+    py_steps.append(py_step);
+  }
+  return py_steps;
+}
+
 py::object GetMetricData(const std::string& name) {
   xla::metrics::MetricData* data = xla::metrics::GetMetric(name);
   if (data == nullptr) {
@@ -495,14 +746,24 @@ std::shared_ptr<xla::util::RecordReader> CreateRecordReader(
                                                    buffer_size);
 }
 
-bool RecordRead(const std::shared_ptr<xla::util::RecordReader>& reader,
+template <typename R>
+bool RecordRead(const std::shared_ptr<R>& reader,
                 xla::util::RecordReader::Data* value) {
   NoGilSection nogil;
   return reader->Read(value);
 }
 
-py::object RecordReadExample(
-    const std::shared_ptr<xla::util::RecordReader>& reader) {
+template <typename R>
+py::object RecordReadBytes(const std::shared_ptr<R>& reader) {
+  xla::util::RecordReader::Data record;
+  if (!RecordRead(reader, &record)) {
+    return py::none();
+  }
+  return py::bytes(record.data(), record.size());
+}
+
+template <typename R>
+py::object RecordReadExample(const std::shared_ptr<R>& reader) {
   auto make_r1_size = [](int64_t size) -> std::vector<int64_t> {
     return std::vector<int64_t>({size});
   };
@@ -564,6 +825,69 @@ py::object RecordReadExample(
   return example;
 }
 
+// Reads up to batch_size examples, and returns their features by name, either
+// as stacked [batch, values] tensors, uploaded to device if not empty, or as
+// lists of per example values for the ones whose sizes differ. Returns None at
+// the end of the file.
+template <typename R>
+py::object RecordReadExampleBatch(const std::shared_ptr<R>& reader,
+                                  size_t batch_size,
+                                  const std::string& device) {
+  std::map<std::string, ExampleFeatureBatch> batch;
+  {
+    NoGilSection nogil;
+    std::vector<xla::util::RecordReader::Data> records;
+    records.reserve(batch_size);
+    if (reader->ReadBatch(batch_size, &records) == 0) {
+      batch_size = 0;
+    } else {
+      batch = ParseExampleBatch(records, reader->path());
+    }
+    if (!batch.empty() && !device.empty()) {
+      std::vector<at::Tensor> stacked;
+      for (auto& name_feat : batch) {
+        if (name_feat.second.stacked.defined()) {
+          stacked.push_back(name_feat.second.stacked);
+        }
+      }
+      std::vector<at::Tensor> xla_stacked = GetXlaTensorsFromAten(
+          stacked, std::vector<std::string>(stacked.size(), device));
+      size_t index = 0;
+      for (auto& name_feat : batch) {
+        if (name_feat.second.stacked.defined()) {
+          name_feat.second.stacked = xla_stacked[index++];
+        }
+      }
+    }
+  }
+  if (batch_size == 0) {
+    return py::none();
+  }
+  auto example = py::dict();
+  for (auto& name_feat : batch) {
+    if (name_feat.second.stacked.defined()) {
+      example[py::str(name_feat.first)] =
+          torch::autograd::make_variable(name_feat.second.stacked);
+      continue;
+    }
+    auto values = py::list(name_feat.second.values.size());
+    for (size_t i = 0; i < name_feat.second.values.size(); ++i) {
+      auto& tensors = name_feat.second.values[i];
+      if (tensors.size() == 1) {
+        values[i] = torch::autograd::make_variable(tensors.front());
+      } else {
+        auto tlist = py::list(tensors.size());
+        for (size_t j = 0; j < tensors.size(); ++j) {
+          tlist[j] = torch::autograd::make_variable(tensors[j]);
+        }
+        values[i] = tlist;
+      }
+    }
+    example[py::str(name_feat.first)] = values;
+  }
+  return example;
+}
+
 std::unique_ptr<tensorflow::RandomAccessFile> OpenTfFile(
     const std::string& path) {
   tensorflow::Env* env = tensorflow::Env::Default();
@@ -586,36 +910,149 @@ py::object StatTfFile(const std::string& path) {
   return py_stat;
 }
 
+// Reads size bytes of the file from offset into dest, with a fan-out of IO
+// closures for the large reads. Returns the number of bytes read, fewer than
+// size only if the file ends before.
+size_t ReadTfFileInto(tensorflow::RandomAccessFile* file, uint64_t offset,
+                      size_t size, char* dest) {
+  static const size_t kMinReadSize = 1024 * 1024;
+  size_t num_threads = std::max<size_t>(size / kMinReadSize, 1);
+  num_threads =
+      std::min<size_t>(num_threads, std::thread::hardware_concurrency());
+  size_t block_size = size / num_threads;
+  auto block_bytes = [&](size_t i) {
+    return (i + 1 < num_threads) ? block_size : (size - i * block_size);
+  };
+
+  std::vector<size_t> read_sizes(num_threads, 0);
+  auto mwait = std::make_shared<xla::util::MultiWait>(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    auto reader = [&, i]() {
+      char* block = dest + i * block_size;
+      tensorflow::StringPiece result;
+      tensorflow::Status status =
+          file->Read(offset + i * block_size, block_bytes(i), &result, block);
+      if (!tensorflow::errors::IsOutOfRange(status)) {
+        XLA_CHECK_OK(status);
+      }
+      // The file systems are allowed to return their own memory.
+      if (result.data() != block) {
+        std::memcpy(block, result.data(), result.size());
+      }
+      read_sizes[i] = result.size();
+    };
+    xla::env::ScheduleIoClosure(
+        xla::util::MultiWait::Completer(mwait, std::move(reader)));
+  }
+  mwait->Wait();
+  size_t total_size = 0;
+  for (size_t i = 0; i < num_threads; ++i) {
+    total_size += read_sizes[i];
+    if (read_sizes[i] < block_bytes(i)) {
+      break;
+    }
+  }
+  return total_size;
+}
+
 py::bytes ReadTfFile(tensorflow::RandomAccessFile* file, uint64_t offset,
                      size_t size) {
-  static const size_t kMinReadSize = 1024 * 1024;
-  std::unique_ptr<char[]> buffer;
+  // Read straight into the bytes object, which nobody else can see before it
+  // gets returned.
+  py::bytes data(nullptr, size);
+  char* dest = PyBytes_AS_STRING(data.ptr());
+  size_t read_size;
   {
     NoGilSection nogil;
-    buffer.reset(new char[size]);
-
-    size_t num_threads = std::max<size_t>(size / kMinReadSize, 1);
-    num_threads =
-        std::min<size_t>(num_threads, std::thread::hardware_concurrency());
-    size_t block_size = size / num_threads;
-
-    auto mwait = std::make_shared<xla::util::MultiWait>(num_threads);
-    for (size_t i = 0; i < num_threads; ++i) {
-      auto reader = [&, i]() {
-        uint64_t base = static_cast<uint64_t>(i) * block_size;
-        size_t tsize =
-            (i + 1 < num_threads) ? block_size : (size - i * block_size);
-
-        tensorflow::StringPiece result;
-        XLA_CHECK_OK(
-            file->Read(offset + base, tsize, &result, buffer.get() + base));
-      };
-      xla::env::ScheduleIoClosure(
-          xla::util::MultiWait::Completer(mwait, std::move(reader)));
+    read_size = ReadTfFileInto(file, offset, size, dest);
+  }
+  XLA_CHECK_EQ(read_size, size) << "Short read at offset " << offset;
+  return data;
+}
+
+// The memory of a buffer protocol object, or of a CPU tensor, which the reads
+// go into (writable) or the writes come from. Keeps the object (and its buffer
+// export) alive.
+class TfFileBuffer {
+ public:
+  TfFileBuffer(py::object object, bool writable) : object_(std::move(object)) {
+    if (THPVariable_Check(object_.ptr())) {
+      at::Tensor tensor = THPVariable_Unpack(object_.ptr());
+      XLA_CHECK(tensor.device().is_cpu() && tensor.is_contiguous())
+          << "TF file buffers must be contiguous CPU tensors";
+      data_ = reinterpret_cast<char*>(tensor.data_ptr());
+      size_ = tensor.nbytes();
+      return;
+    }
+    info_ = std::make_unique<py::buffer_info>(
+        py::reinterpret_borrow<py::buffer>(object_).request(writable));
+    py::ssize_t stride = info_->itemsize;
+    for (py::ssize_t i = info_->ndim - 1; i >= 0; --i) {
+      XLA_CHECK(info_->shape[i] <= 1 || info_->strides[i] == stride)
+          << "TF file buffers must be C contiguous";
+      stride *= info_->shape[i];
+    }
+    data_ = reinterpret_cast<char*>(info_->ptr);
+    size_ = info_->size * info_->itemsize;
+  }
+
+  char* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+ private:
+  py::object object_;
+  std::unique_ptr<py::buffer_info> info_;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// A read running in background into a target, which stays alive until the
+// read completes, even if the read object is dropped before.
+class AsyncTfFileRead {
+ public:
+  AsyncTfFileRead(py::object file, std::unique_ptr<TfFileBuffer> target,
+                  xla::util::Future<size_t> future)
+      : file_(std::move(file)),
+        target_(std::move(target)),
+        future_(std::move(future)) {}
+
+  ~AsyncTfFileRead() {
+    NoGilSection nogil;
+    future_.Wait();
+  }
+
+  bool IsReady() const { return future_.IsReady(); }
+
+  size_t Wait() {
+    {
+      NoGilSection nogil;
+      future_.Wait();
     }
-    mwait->Wait();
+    return future_.Get();
   }
-  return py::bytes(buffer.get(), size);
+
+ private:
+  py::object file_;
+  std::unique_ptr<TfFileBuffer> target_;
+  xla::util::Future<size_t> future_;
+};
+
+std::shared_ptr<AsyncTfFileRead> ReadTfFileIntoAsync(py::object file,
+                                                     uint64_t offset,
+                                                     py::object target) {
+  auto read_target =
+      std::make_unique<TfFileBuffer>(std::move(target), /*writable=*/true);
+  tensorflow::RandomAccessFile* tf_file =
+      file.cast<tensorflow::RandomAccessFile*>();
+  char* data = read_target->data();
+  size_t size = read_target->size();
+  xla::util::Future<size_t> future =
+      xla::util::ScheduleIoFuture([tf_file, offset, size, data]() {
+        return ReadTfFileInto(tf_file, offset, size, data);
+      });
+  return std::make_shared<AsyncTfFileRead>(
+      std::move(file), std::move(read_target), std::move(future));
 }
 
 std::unique_ptr<tensorflow::WritableFile> CreateTfFile(
@@ -626,8 +1063,9 @@ std::unique_ptr<tensorflow::WritableFile> CreateTfFile(
   return file;
 }
 
-void WriteTfFile(tensorflow::WritableFile* file, const std::string& data) {
-  XLA_CHECK_OK(file->Append(tensorflow::StringPiece(data.data(), data.size())));
+void WriteTfFile(tensorflow::WritableFile* file, const char* data,
+                 size_t size) {
+  XLA_CHECK_OK(file->Append(tensorflow::StringPiece(data, size)));
 }
 
 void FlushTfFile(tensorflow::WritableFile* file) {
@@ -635,6 +1073,27 @@ void FlushTfFile(tensorflow::WritableFile* file) {
   XLA_CHECK_OK(file->Sync());
 }
 
+// Writes every buffer into its own file, with the files uploaded in parallel
+// over the IO closures. A single TF writable file is a sequential stream (on
+// GCS a single resumable upload), so splitting a checkpoint into many objects
+// is what lets the uploads run concurrently.
+void WriteTfFiles(const std::vector<std::string>& paths,
+                  const std::vector<std::unique_ptr<TfFileBuffer>>& buffers) {
+  XLA_CHECK_EQ(paths.size(), buffers.size());
+  XLA_TIMED("WriteTfFiles");
+  auto mwait = std::make_shared<xla::util::MultiWait>(paths.size());
+  for (size_t i = 0; i < paths.size(); ++i) {
+    auto writer = [&, i]() {
+      std::unique_ptr<tensorflow::WritableFile> file = CreateTfFile(paths[i]);
+      WriteTfFile(file.get(), buffers[i]->data(), buffers[i]->size());
+      XLA_CHECK_OK(file->Close()) << "Unable to write " << paths[i];
+    };
+    xla::env::ScheduleIoClosure(
+        xla::util::MultiWait::Completer(mwait, std::move(writer)));
+  }
+  mwait->Wait();
+}
+
 py::object ListTfFs(const std::string& pattern) {
   std::vector<std::string> files;
   {
@@ -655,17 +1114,63 @@ void RemoveTfFile(const std::string& path) {
   XLA_CHECK_OK(env->DeleteFile(path));
 }
 
+py::object PadToBucket(const at::Tensor& tensor, int64_t dim,
+                       const std::vector<int64_t>& buckets,
+                       const at::Scalar& value) {
+  XLA_CHECK(!buckets.empty()) << "At least one bucket size must be specified";
+  at::Tensor padded;
+  at::Tensor mask;
+  {
+    NoGilSection nogil;
+    dim = torch::lazy::GetCanonicalDimensionIndex(dim, tensor.dim());
+    int64_t size = tensor.size(dim);
+    std::vector<int64_t> sorted_buckets(buckets);
+    std::sort(sorted_buckets.begin(), sorted_buckets.end());
+    auto it =
+        std::lower_bound(sorted_buckets.begin(), sorted_buckets.end(), size);
+    // Sizes beyond the last bucket round up to a multiple of it.
+    int64_t bucket_size =
+        it != sorted_buckets.end()
+            ? *it
+            : (size + sorted_buckets.back() - 1) / sorted_buckets.back() *
+                  sorted_buckets.back();
+    std::vector<int64_t> pad(2 * (tensor.dim() - dim), 0);
+    pad.back() = bucket_size - size;
+    padded = bucket_size > size ? at::constant_pad_nd(tensor, pad, value)
+                                : tensor;
+    mask = at::arange(bucket_size, tensor.options().dtype(at::kLong)).lt(size);
+    int64_t slice_numel = tensor.numel() / std::max<int64_t>(size, 1);
+    XLA_COUNTER("BucketedElements", slice_numel * bucket_size);
+    XLA_COUNTER("BucketPaddingElements", slice_numel * (bucket_size - size));
+  }
+  auto result_tuple = py::tuple(2);
+  result_tuple[0] = torch::autograd::make_variable(
+      padded, /*requires_grad=*/tensor.requires_grad());
+  result_tuple[1] =
+      torch::autograd::make_variable(mask, /*requires_grad=*/false);
+  return result_tuple;
+}
+
 py::object XlaNms(const at::Tensor& boxes, const at::Tensor& scores,
+                  const c10::optional<at::Tensor>& idxs,
                   const at::Tensor& score_threshold,
                   const at::Tensor& iou_threshold, int64_t output_size) {
   at::Tensor selected_indices;
   at::Tensor num_valid;
   {
     NoGilSection nogil;
-    auto nms_result = XLATensor::nms(
-        bridge::GetXlaTensor(boxes), bridge::GetXlaTensor(scores),
-        bridge::GetXlaTensor(score_threshold),
-        bridge::GetXlaTensor(iou_threshold), output_size);
+    std::pair<XLATensorPtr, XLATensorPtr> nms_result;
+    if (idxs) {
+      nms_result = XLATensor::batched_nms(
+          bridge::GetXlaTensor(boxes), bridge::GetXlaTensor(scores),
+          bridge::GetXlaTensor(*idxs), bridge::GetXlaTensor(score_threshold),
+          bridge::GetXlaTensor(iou_threshold), output_size);
+    } else {
+      nms_result = XLATensor::nms(
+          bridge::GetXlaTensor(boxes), bridge::GetXlaTensor(scores),
+          bridge::GetXlaTensor(score_threshold),
+          bridge::GetXlaTensor(iou_threshold), output_size);
+    }
     selected_indices = bridge::AtenFromXlaTensor(std::move(nms_result.first));
     num_valid = bridge::AtenFromXlaTensor(std::move(nms_result.second));
   }
@@ -692,6 +1197,82 @@ std::vector<at::Tensor> XlaUserComputation(
   return results;
 }
 
+// The user computations by op, attributes and input shapes, so that the calls
+// of an op only need the shapes of the input tensors (taken on the C++ side)
+// to find their computation, and the Python side only builds a computation
+// the first time its key shows.
+class UserComputationRegistry {
+ public:
+  static UserComputationRegistry* Get() {
+    static const size_t kMaxCacheSize =
+        xla::sys_util::GetEnvInt("XLA_USER_COMPUTATION_CACHE_SIZE", 1024);
+    static UserComputationRegistry* registry =
+        new UserComputationRegistry(kMaxCacheSize);
+    return registry;
+  }
+
+  explicit UserComputationRegistry(size_t max_size) : cache_(max_size) {}
+
+  static torch::lazy::hash_t GetKey(int64_t op_id, const std::string& attrs,
+                                    absl::Span<const XLATensorPtr> inputs) {
+    torch::lazy::hash_t key = torch::lazy::MHash(op_id, attrs);
+    for (auto& input : inputs) {
+      key = torch::lazy::HashCombine(key, Hash(input->shape().get()));
+    }
+    return key;
+  }
+
+  ComputationPtr Lookup(const torch::lazy::hash_t& key) {
+    return cache_.Get(key);
+  }
+
+  void Register(const torch::lazy::hash_t& key, ComputationPtr computation) {
+    cache_.Add(key, std::move(computation));
+  }
+
+ private:
+  xla::util::Cache<torch::lazy::hash_t, Computation, torch::lazy::HashReducer>
+      cache_;
+};
+
+// Runs the computation registered for the op, attributes and input shapes,
+// returning false if none is.
+bool XlaCachedUserComputation(const std::string& opname, int64_t op_id,
+                              const std::vector<at::Tensor>& inputs,
+                              const std::string& attrs,
+                              std::vector<at::Tensor>* results) {
+  std::vector<XLATensorPtr> xinputs = GetXlaTensors(inputs, /*want_all=*/true);
+  ComputationPtr computation = UserComputationRegistry::Get()->Lookup(
+      UserComputationRegistry::GetKey(op_id, attrs, xinputs));
+  if (computation == nullptr) {
+    XLA_COUNTER("UserComputationCacheMiss", 1);
+    return false;
+  }
+  std::vector<XLATensorPtr> xresults =
+      XLATensor::user_computation(opname, xinputs, std::move(computation));
+  for (auto& xresult : xresults) {
+    at::Tensor tensor = bridge::AtenFromXlaTensor(std::move(xresult));
+    results->push_back(
+        torch::autograd::make_variable(tensor, /*requires_grad=*/false));
+  }
+  return true;
+}
+
+void RegisterUserComputation(int64_t op_id,
+                             const std::vector<at::Tensor>& inputs,
+                             const std::string& attrs,
+                             ComputationPtr computation) {
+  XLA_CHECK_EQ(computation->program_shape().parameters_size(), inputs.size())
+      << "User computation " << computation->name() << " has "
+      << computation->program_shape().parameters_size()
+      << " parameters, while it got registered for " << inputs.size()
+      << " inputs";
+  std::vector<XLATensorPtr> xinputs = GetXlaTensors(inputs, /*want_all=*/true);
+  UserComputationRegistry::Get()->Register(
+      UserComputationRegistry::GetKey(op_id, attrs, xinputs),
+      std::move(computation));
+}
+
 ComputationPtr CreateComputation(const std::string& name, xla::XlaOp root) {
   xla::XlaComputation computation = ConsumeValue(root.builder()->Build(root));
   return std::make_shared<Computation>(name, std::move(computation));
@@ -725,6 +1306,9 @@ py::dict GetMemoryInfo(const std::string& device_str) {
   auto py_dict = py::dict();
   py_dict["kb_free"] = mem_info.kb_free;
   py_dict["kb_total"] = mem_info.kb_total;
+  py_dict["kb_peak"] = mem_info.kb_peak;
+  py_dict["kb_largest_free_block"] = mem_info.kb_largest_free_block;
+  py_dict["num_allocs"] = mem_info.num_allocs;
   return py_dict;
 }
 
@@ -748,9 +1332,48 @@ void MapXlaEnvVarsToLazy() {
   FLAGS_torch_lazy_ir_debug = wants_frames;
 }
 
-std::string GetPyTypeString(py::handle obj) {
-  std::string type = obj.attr("__class__").attr("__name__").cast<std::string>();
-  return type;
+// Walks the Python stack for the compact source location records. Threads not
+// holding the GIL are not tracing from Python, so they get no frames, rather
+// than blocking on the GIL.
+std::vector<SourceLocationTable::Frame> CapturePythonFrames(
+    size_t max_frames) {
+  std::vector<SourceLocationTable::Frame> frames;
+  if (!Py_IsInitialized() || !PyGILState_Check()) {
+    return frames;
+  }
+  PyFrameObject* frame = PyEval_GetFrame();
+#if PY_VERSION_HEX >= 0x030900B1
+  Py_XINCREF(frame);
+  while (frame != nullptr && frames.size() < max_frames) {
+    PyCodeObject* code = PyFrame_GetCode(frame);
+    frames.push_back({code, PyFrame_GetLineNumber(frame)});
+    Py_DECREF(code);
+    PyFrameObject* back = PyFrame_GetBack(frame);
+    Py_DECREF(frame);
+    frame = back;
+  }
+  Py_XDECREF(frame);
+#else
+  for (; frame != nullptr && frames.size() < max_frames;
+       frame = frame->f_back) {
+    frames.push_back({frame->f_code, PyFrame_GetLineNumber(frame)});
+  }
+#endif
+  return frames;
+}
+
+torch::lazy::SourceLocation DescribePythonFrame(
+    const SourceLocationTable::Frame& frame) {
+  PyCodeObject* code =
+      reinterpret_cast<PyCodeObject*>(const_cast<void*>(frame.code));
+  // The records identify the frames by code object, so the code objects must
+  // never be freed (and their address reused).
+  Py_INCREF(code);
+  torch::lazy::SourceLocation location;
+  location.file = PyUnicode_AsUTF8(code->co_filename);
+  location.function = PyUnicode_AsUTF8(code->co_name);
+  location.line = frame.line;
+  return location;
 }
 
 void BuildProfilerSubmodule(py::module* m) {
@@ -767,6 +1390,19 @@ void BuildProfilerSubmodule(py::module* m) {
                },
                py::arg("port"));
 
+  py::class_<xla::profiler::MetricsServer,
+             std::unique_ptr<xla::profiler::MetricsServer>>
+      metrics_server_class(profiler, "MetricsServer");
+  profiler.def(
+      "start_metrics_server",
+      [](int port, const std::map<std::string, std::string>& labels)
+          -> std::unique_ptr<xla::profiler::MetricsServer> {
+        auto server = absl::make_unique<xla::profiler::MetricsServer>(labels);
+        server->Start(port);
+        return server;
+      },
+      py::arg("port"), py::arg("labels"));
+
   profiler.def("trace",
                [](const char* service_addr, const char* logdir, int duration_ms,
                   int num_tracing_attempts, int timeout_s, int interval_s,
@@ -823,6 +1459,49 @@ void BuildProfilerSubmodule(py::module* m) {
       });
 }
 
+xla::OpSharding ShardingFromTileAssignment(const py::list& tile_assignment,
+                                           bool replicated, bool manual,
+                                           bool partial) {
+  XLA_CHECK(!(replicated && manual))
+      << "Invalid input sharding spec: "
+      << "replicated=" << replicated << " manual=" << manual;
+
+  // Support {REPLICATED, OTHER, MANUAL} sharding types
+  xla::OpSharding sharding;
+  if (replicated && !manual) {
+    xla::HloSharding hlo_sharding = xla::HloSharding::Replicate();
+    sharding = hlo_sharding.ToProto();
+  } else if (!replicated && manual) {
+    xla::HloSharding hlo_sharding = xla::HloSharding::Manual();
+    sharding = hlo_sharding.ToProto();
+  } else {
+    // The tile assignment is a nested list of any rank, whose last dimension
+    // holds the replicas of every tile with a partial replication.
+    std::vector<int64_t> tile_shape;
+    py::object level = tile_assignment;
+    while (py::isinstance<py::list>(level)) {
+      py::list items = level.cast<py::list>();
+      XLA_CHECK_GT(items.size(), 0) << "Invalid input sharding spec: "
+                                    << "empty or irregular tile_assignment";
+      tile_shape.push_back(items.size());
+      level = items[0];
+    }
+    xla::Array<int64_t> tile_array(tile_shape);
+    tile_array.Each([&](absl::Span<const int64_t> indices, int64_t* v) {
+      py::object item = tile_assignment;
+      for (int64_t index : indices) {
+        item = item.cast<py::list>()[index];
+      }
+      *v = item.cast<int64_t>();
+    });
+    xla::HloSharding hlo_sharding =
+        partial ? xla::HloSharding::PartialTile(tile_array)
+                : xla::HloSharding::Tile(tile_array);
+    sharding = hlo_sharding.ToProto();
+  }
+  return sharding;
+}
+
 void InitXlaModuleBindings(py::module m) {
   m.def("_prepare_to_exit", []() { PrepareToExit(); });
   m.def("_get_git_revs", []() { return GetRevisions(); });
@@ -833,8 +1512,83 @@ void InitXlaModuleBindings(py::module m) {
   m.def("_xla_nms", [](const at::Tensor& boxes, const at::Tensor& scores,
                        const at::Tensor& score_threshold,
                        const at::Tensor& iou_threshold, int64_t output_size) {
-    return XlaNms(boxes, scores, score_threshold, iou_threshold, output_size);
+    return XlaNms(boxes, scores, /*idxs=*/c10::nullopt, score_threshold,
+                  iou_threshold, output_size);
+  });
+  m.def("_xla_batched_nms",
+        [](const at::Tensor& boxes, const at::Tensor& scores,
+           const at::Tensor& idxs, const at::Tensor& score_threshold,
+           const at::Tensor& iou_threshold, int64_t output_size) {
+          return XlaNms(boxes, scores, idxs, score_threshold, iou_threshold,
+                        output_size);
+        });
+  m.def("_xla_crop_and_resize",
+        [](const at::Tensor& input, const at::Tensor& boxes,
+           std::vector<int64_t> output_size) {
+          at::Tensor result;
+          {
+            NoGilSection nogil;
+            result = bridge::AtenFromXlaTensor(XLATensor::crop_and_resize(
+                bridge::GetXlaTensor(input), bridge::GetXlaTensor(boxes),
+                std::move(output_size)));
+          }
+          return torch::autograd::make_variable(result,
+                                                /*requires_grad=*/false);
+        });
+  m.def("_xla_scaled_dot_product_attention",
+        [](const at::Tensor& query, const at::Tensor& key,
+           const at::Tensor& value, const c10::optional<at::Tensor>& attn_mask,
+           bool is_causal, c10::optional<double> scale) {
+          return aten_autograd_ops::ScaledDotProductAttentionAutogradFunction::
+              apply(query, key, value, attn_mask, is_causal, scale);
+        });
+  m.def("_xla_rms_norm",
+        [](const at::Tensor& input, std::vector<int64_t> normalized_shape,
+           const c10::optional<at::Tensor>& weight, double eps) {
+          torch::autograd::variable_list outputs =
+              aten_autograd_ops::LayerNormAutogradFunction::apply(
+                  input, normalized_shape, weight, /*bias=*/c10::nullopt, eps,
+                  /*rms=*/true);
+          return outputs[0];
+        });
+  m.def("_xla_pad_to_bucket",
+        [](const at::Tensor& tensor, int64_t dim,
+           const std::vector<int64_t>& buckets, const at::Scalar& value) {
+          return PadToBucket(tensor, dim, buckets, value);
+        });
+  m.def("_xla_nonzero_padded", [](const at::Tensor& input) {
+    std::tuple<XLATensorPtr, XLATensorPtr> results;
+    {
+      NoGilSection nogil;
+      results = XLATensor::nonzero_padded(bridge::GetXlaTensor(input));
+    }
+    return std::make_tuple(bridge::AtenFromXlaTensor(std::get<0>(results)),
+                           bridge::AtenFromXlaTensor(std::get<1>(results)));
   });
+  m.def("_xla_masked_select_padded",
+        [](const at::Tensor& input, const at::Tensor& mask) {
+          std::tuple<XLATensorPtr, XLATensorPtr> results;
+          {
+            NoGilSection nogil;
+            results = XLATensor::masked_select_padded(
+                bridge::GetXlaTensor(input), bridge::GetXlaTensor(mask));
+          }
+          return std::make_tuple(
+              bridge::AtenFromXlaTensor(std::get<0>(results)),
+              bridge::AtenFromXlaTensor(std::get<1>(results)));
+        });
+  m.def("_xla_dynamic_update_slice",
+        [](const at::Tensor& input, const at::Tensor& source,
+           const at::Tensor& offset, int64_t dim) {
+          XLATensorPtr result;
+          {
+            NoGilSection nogil;
+            result = XLATensor::dynamic_update_slice(
+                bridge::GetXlaTensor(input), bridge::GetXlaTensor(source),
+                bridge::GetXlaTensor(offset), dim);
+          }
+          return bridge::AtenFromXlaTensor(std::move(result));
+        });
   m.def("_xla_user_computation",
         [](const std::string& opname, const std::vector<at::Tensor>& inputs,
            const ComputationPtr& computation) {
@@ -845,6 +1599,28 @@ void InitXlaModuleBindings(py::module m) {
           }
           return results;
         });
+  m.def("_xla_cached_user_computation",
+        [](const std::string& opname, int64_t op_id,
+           const std::vector<at::Tensor>& inputs,
+           const py::bytes& attrs) -> py::object {
+          std::string attrs_str = attrs;
+          std::vector<at::Tensor> results;
+          bool found;
+          {
+            NoGilSection nogil;
+            found = XlaCachedUserComputation(opname, op_id, inputs, attrs_str,
+                                             &results);
+          }
+          if (!found) {
+            return py::none();
+          }
+          return py::cast(results);
+        });
+  m.def("_xla_register_user_computation",
+        [](int64_t op_id, const std::vector<at::Tensor>& inputs,
+           const py::bytes& attrs, const ComputationPtr& computation) {
+          RegisterUserComputation(op_id, inputs, attrs, computation);
+        });
   m.def("_get_xla_tensors_dot",
         [](const std::vector<at::Tensor>& tensors) -> std::string {
           auto coverter = [](absl::Span<const torch::lazy::Node* const> nodes) {
@@ -859,6 +1635,22 @@ void InitXlaModuleBindings(py::module m) {
           };
           return GetTensorsDump(tensors, coverter);
         });
+  m.def("_xla_tensors_graph_bytes",
+        [](const std::vector<at::Tensor>& tensors,
+           const std::vector<at::Tensor>& boundary) -> int64_t {
+          std::vector<torch::lazy::Value> values;
+          std::vector<const torch::lazy::Node*> nodes;
+          std::vector<const torch::lazy::Node*> boundary_nodes;
+          for (auto& tensor : boundary) {
+            values.push_back(bridge::GetXlaTensor(tensor)->GetIrValue());
+            boundary_nodes.push_back(values.back().node.get());
+          }
+          for (auto& tensor : tensors) {
+            values.push_back(bridge::GetXlaTensor(tensor)->GetIrValue());
+            nodes.push_back(values.back().node.get());
+          }
+          return Util::GetGraphBytes(nodes, boundary_nodes);
+        });
   m.def("_get_xla_tensors_hlo",
         [](const std::vector<at::Tensor>& tensors) -> std::string {
           return GetTensorsHloGraph(tensors);
@@ -878,6 +1670,33 @@ void InitXlaModuleBindings(py::module m) {
     }
     return result;
   });
+  m.def("_xla_load_mapped_tensors",
+        [](const std::string& path, const std::vector<int64_t>& offsets,
+           const std::vector<at::Tensor>& meta_tensors,
+           const std::vector<std::string>& devices) {
+          // The meta tensors only carry the element types and the sizes of the
+          // tensors stored within the file.
+          XLA_CHECK_EQ(offsets.size(), meta_tensors.size());
+          std::vector<MappedTensorInfo> infos;
+          infos.reserve(offsets.size());
+          for (size_t i = 0; i < offsets.size(); ++i) {
+            infos.push_back({offsets[i], meta_tensors[i].scalar_type(),
+                             meta_tensors[i].sizes().vec()});
+          }
+          std::vector<at::Tensor> result;
+          {
+            NoGilSection nogil;
+            std::vector<torch::lazy::BackendDataPtr> datas =
+                LoadMappedTensorsData(path, infos, GetXlaDevices(devices));
+            result.reserve(datas.size());
+            for (size_t i = 0; i < datas.size(); ++i) {
+              XLATensorPtr xtensor =
+                  XLATensor::Create(std::move(datas[i]), infos[i].scalar_type);
+              result.push_back(bridge::AtenFromXlaTensor(std::move(xtensor)));
+            }
+          }
+          return result;
+        });
   m.def("_xla_get_cpu_tensors", [](const std::vector<at::Tensor>& tensors) {
     std::vector<at::Tensor> result;
     {
@@ -892,6 +1711,55 @@ void InitXlaModuleBindings(py::module m) {
     }
     return result;
   });
+  py::class_<AsyncCpuTensors, std::shared_ptr<AsyncCpuTensors>>(
+      m, "AsyncCpuTensors")
+      .def("done", &AsyncCpuTensors::IsDone)
+      .def("wait", [](AsyncCpuTensors& self) {
+        NoGilSection nogil;
+        return self.Wait();
+      });
+  m.def("_xla_copy_to_cpu_tensors", [](const std::vector<at::Tensor>& tensors,
+                                       std::vector<at::Tensor> dest) {
+    NoGilSection nogil;
+    std::vector<XLATensorPtr> xla_tensors;
+    xla_tensors.reserve(tensors.size());
+    for (auto& tensor : tensors) {
+      xla_tensors.push_back(bridge::GetXlaTensor(tensor));
+    }
+    XLATensor::GetTensorsInto(&xla_tensors, absl::MakeSpan(dest));
+  });
+  m.def("_xla_get_cpu_tensors_async",
+        [](const std::vector<at::Tensor>& tensors) {
+          NoGilSection nogil;
+          return std::make_shared<AsyncCpuTensors>(tensors);
+        });
+  py::class_<InputPrefetcher, std::shared_ptr<InputPrefetcher>>(
+      m, "InputPrefetcher")
+      .def("put",
+           [](InputPrefetcher& self, std::vector<at::Tensor> tensors) {
+             NoGilSection nogil;
+             self.Put(std::move(tensors));
+           })
+      .def("get",
+           [](InputPrefetcher& self) -> py::object {
+             std::vector<at::Tensor> tensors;
+             bool valid;
+             {
+               NoGilSection nogil;
+               valid = self.Get(&tensors);
+             }
+             if (!valid) {
+               return py::none();
+             }
+             return py::cast(tensors);
+           })
+      .def("close", [](InputPrefetcher& self) { self.Close(); });
+  m.def("_xla_create_input_prefetcher",
+        [](const std::string& device, size_t depth) {
+          return std::make_shared<InputPrefetcher>(
+              GetDeviceOrCurrent(device), depth);
+        },
+        py::arg("device") = "", py::arg("depth") = 2);
   m.def("_xla_get_tensor_view_alias_id",
         [](const at::Tensor& tensor) { return GetTensorViewAliasId(tensor); });
   m.def("_xla_get_tensor_id",
@@ -902,6 +1770,13 @@ void InitXlaModuleBindings(py::module m) {
         []() { return xla::ComputationClient::Get()->GetNumDevices(); });
   m.def("_xla_get_all_devices",
         []() { return xla::ComputationClient::Get()->GetAllDevices(); });
+  m.def("_xla_get_device_coords", [](const std::vector<std::string>& devices) {
+    std::vector<std::vector<int>> coords;
+    for (auto& device : devices) {
+      coords.push_back(xla::ComputationClient::Get()->GetDeviceCoords(device));
+    }
+    return coords;
+  });
   m.def("_xla_real_devices", [](const std::vector<std::string>& devices) {
     std::vector<std::string> xla_devices;
     {
@@ -972,6 +1847,149 @@ void InitXlaModuleBindings(py::module m) {
           result_tuple[1] = new_token;
           return result_tuple;
         });
+  m.def("_xla_compressed_all_reduce",
+        [](const at::Tensor& input, const at::Tensor& residual,
+           const std::shared_ptr<torch::lazy::Value>& token, double scale,
+           const py::list& groups, bool pin_layout,
+           const std::string& wire_type) {
+          std::vector<std::vector<int64_t>> replica_groups =
+              CreateReduceGroups(groups);
+          XLATensorPtr result;
+          XLATensorPtr new_residual;
+          XLATensorPtr error;
+          torch::lazy::Value new_token;
+          {
+            NoGilSection nogil;
+            std::tie(result, new_residual, error, new_token) =
+                XLATensor::compressed_all_reduce(
+                    bridge::GetXlaTensor(input),
+                    bridge::GetXlaTensor(residual), *token, scale,
+                    GetWireType(wire_type), replica_groups, pin_layout);
+          }
+          auto result_tuple = py::tuple(4);
+          result_tuple[0] = torch::autograd::make_variable(
+              bridge::AtenFromXlaTensor(std::move(result)),
+              /*requires_grad=*/input.requires_grad());
+          result_tuple[1] = bridge::AtenFromXlaTensor(std::move(new_residual));
+          result_tuple[2] = bridge::AtenFromXlaTensor(std::move(error));
+          result_tuple[3] = std::make_shared<torch::lazy::Value>(new_token);
+          return result_tuple;
+        });
+  m.def("_xla_sync_batch_norm",
+        [](const at::Tensor& input, const at::Tensor& weight,
+           const at::Tensor& bias,
+           const std::shared_ptr<torch::lazy::Value>& token, double eps,
+           const py::list& groups, bool pin_layout) {
+          std::vector<std::vector<int64_t>> replica_groups =
+              CreateReduceGroups(groups);
+          XLATensorPtr output;
+          XLATensorPtr mean;
+          XLATensorPtr variance;
+          torch::lazy::Value new_token;
+          {
+            NoGilSection nogil;
+            std::tie(output, mean, variance, new_token) =
+                XLATensor::sync_batch_norm(
+                    bridge::GetXlaTensor(input), bridge::GetXlaTensor(weight),
+                    bridge::GetXlaTensor(bias), *token, eps, replica_groups,
+                    pin_layout);
+          }
+          auto result_tuple = py::tuple(4);
+          result_tuple[0] = bridge::AtenFromXlaTensor(std::move(output));
+          result_tuple[1] = bridge::AtenFromXlaTensor(std::move(mean));
+          result_tuple[2] = bridge::AtenFromXlaTensor(std::move(variance));
+          result_tuple[3] = std::make_shared<torch::lazy::Value>(new_token);
+          return result_tuple;
+        });
+  m.def("_xla_sync_batch_norm_backward",
+        [](const at::Tensor& grad, const at::Tensor& input,
+           const at::Tensor& weight, const at::Tensor& mean,
+           const at::Tensor& variance,
+           const std::shared_ptr<torch::lazy::Value>& token, double eps,
+           const py::list& groups, bool pin_layout) {
+          std::vector<std::vector<int64_t>> replica_groups =
+              CreateReduceGroups(groups);
+          XLATensorPtr grad_input;
+          XLATensorPtr grad_weight;
+          XLATensorPtr grad_bias;
+          torch::lazy::Value new_token;
+          {
+            NoGilSection nogil;
+            std::tie(grad_input, grad_weight, grad_bias, new_token) =
+                XLATensor::sync_batch_norm_backward(
+                    bridge::GetXlaTensor(grad), bridge::GetXlaTensor(input),
+                    bridge::GetXlaTensor(weight), bridge::GetXlaTensor(mean),
+                    bridge::GetXlaTensor(variance), *token, eps,
+                    replica_groups, pin_layout);
+          }
+          auto result_tuple = py::tuple(4);
+          result_tuple[0] = bridge::AtenFromXlaTensor(std::move(grad_input));
+          result_tuple[1] = bridge::AtenFromXlaTensor(std::move(grad_weight));
+          result_tuple[2] = bridge::AtenFromXlaTensor(std::move(grad_bias));
+          result_tuple[3] = std::make_shared<torch::lazy::Value>(new_token);
+          return result_tuple;
+        });
+  m.def("_xla_register_host_callback",
+        [](py::function callback, const at::Tensor& value) {
+          XLATensorPtr xtensor = bridge::GetXlaTensor(value);
+          // The Python function must be released with the GIL held.
+          std::shared_ptr<py::function> function(
+              new py::function(std::move(callback)), [](py::function* ptr) {
+                py::gil_scoped_acquire gil;
+                delete ptr;
+              });
+          return HostCallbackRegistry::Get()->Register(
+              [function](const std::string& device, at::Tensor tensor) {
+                py::gil_scoped_acquire gil;
+                (*function)(device, torch::autograd::make_variable(tensor));
+              },
+              xtensor->shape().get(), xtensor->dtype(), xtensor->GetDevice());
+        });
+  m.def("_xla_unregister_host_callback", [](int64_t callback_id) {
+    HostCallbackRegistry::Get()->Unregister(callback_id);
+  });
+  m.def("_xla_host_callback",
+        [](const at::Tensor& value, int64_t callback_id) -> at::Tensor {
+          XLATensorPtr result = XLATensor::host_callback(
+              bridge::GetXlaTensor(value), callback_id);
+          return bridge::AtenFromXlaTensor(std::move(result));
+        });
+  m.def("_xla_summary_scalar_update_",
+        [](at::Tensor& state, const at::Tensor& value, double ema_decay) {
+          XLATensorPtr xla_state = bridge::GetXlaTensor(state);
+          XLATensor::summary_scalar_update_(
+              xla_state, bridge::GetXlaTensor(value), ema_decay);
+        });
+  m.def("_xla_summary_histogram_update_",
+        [](at::Tensor& state, const at::Tensor& value, double min_value,
+           double max_value) {
+          XLATensorPtr xla_state = bridge::GetXlaTensor(state);
+          XLATensor::summary_histogram_update_(
+              xla_state, bridge::GetXlaTensor(value), min_value, max_value);
+        });
+  m.def("_xla_summary_scalar_state_size",
+        []() { return kSummaryScalarStateSize; });
+  m.def("_xla_record_compression_error", [](double error) {
+    XLA_VALUE_METRIC("CompressedAllReduceError", error);
+  });
+  m.def("_xla_record_expert_load",
+        [](const std::vector<int64_t>& counts, int64_t capacity) {
+          int64_t total = 0;
+          int64_t max_count = 0;
+          int64_t dropped = 0;
+          for (auto count : counts) {
+            total += count;
+            max_count = std::max(max_count, count);
+            dropped += std::max<int64_t>(count - capacity, 0);
+          }
+          if (total > 0) {
+            XLA_VALUE_METRIC("MoeExpertLoadImbalance",
+                             static_cast<double>(max_count) * counts.size() /
+                                 total);
+            XLA_VALUE_METRIC("MoeDroppedTokenFraction",
+                             static_cast<double>(dropped) / total);
+          }
+        });
   m.def("_xla_all_to_all",
         [](const at::Tensor& input,
            const std::shared_ptr<torch::lazy::Value>& token,
@@ -1139,6 +2157,39 @@ void InitXlaModuleBindings(py::module m) {
         },
         py::arg("tensors"), py::arg("devices"), py::arg("wait") = true,
         py::arg("sync_xla_data") = true);
+  m.def("_xla_set_accumulators",
+        [](const std::vector<at::Tensor>& tensors, bool accumulator) {
+          for (auto& xtensor : GetXlaTensors(tensors, /*want_all=*/true)) {
+            xtensor->SetAccumulator(accumulator);
+          }
+        },
+        py::arg("tensors"), py::arg("accumulator") = true);
+  m.def("_xla_capture_graph",
+        [](const std::vector<at::Tensor>& outputs,
+           const std::vector<at::Tensor>& inputs) {
+          NoGilSection nogil;
+          return CaptureGraph(outputs, inputs);
+        });
+  m.def("_xla_capture_loop", [](const std::string& graph_id,
+                                int64_t num_iterations, int64_t num_carried) {
+    NoGilSection nogil;
+    return CaptureLoop(graph_id, num_iterations, num_carried);
+  });
+  m.def("_xla_freeze_graph", [](const std::string& graph_id) {
+    XLATensor::FreezeGraph(GetGraphHash(graph_id));
+  });
+  m.def("_xla_unfreeze_graph", [](const std::string& graph_id) {
+    XLATensor::UnfreezeGraph(GetGraphHash(graph_id));
+  });
+  m.def("_xla_replay_graph", [](const std::string& graph_id,
+                                const std::vector<at::Tensor>& inputs) {
+    std::vector<at::Tensor> results;
+    {
+      NoGilSection nogil;
+      results = ReplayGraph(graph_id, inputs);
+    }
+    return results;
+  });
   m.def("_xla_sync_live_tensors",
         [](const std::string& device, const std::vector<std::string>& devices,
            bool wait) {
@@ -1153,6 +2204,18 @@ void InitXlaModuleBindings(py::module m) {
           StepMarker(device, devices, wait);
         },
         py::arg("device") = "", py::arg("devices"), py::arg("wait") = true);
+  m.def("_xla_offload_tensors", [](const std::vector<at::Tensor>& tensors) {
+    std::vector<XLATensorPtr> xtensors =
+        GetXlaTensors(tensors, /*want_all=*/true);
+    NoGilSection nogil;
+    XLATensor::OffloadTensors(&xtensors);
+  });
+  m.def("_xla_prefetch_tensors", [](const std::vector<at::Tensor>& tensors) {
+    std::vector<XLATensorPtr> xtensors =
+        GetXlaTensors(tensors, /*want_all=*/true);
+    NoGilSection nogil;
+    XLATensor::PrefetchTensors(xtensors);
+  });
   m.def("_xla_wait_device_ops",
         [](const std::vector<std::string>& devices) {
           NoGilSection nogil;
@@ -1168,8 +2231,38 @@ void InitXlaModuleBindings(py::module m) {
   m.def("_xla_metric_data", [](const std::string& name) -> py::object {
     return GetMetricData(name);
   });
+  m.def("_xla_metric_histogram", [](const std::string& name) -> py::object {
+    return GetMetricHistogram(name);
+  });
   m.def("_xla_metrics_report",
         []() { return xla::metrics_reader::CreateMetricReport(); });
+  py::class_<xla::metrics_reader::MetricsSnapshot>(m, "MetricsSnapshot");
+  m.def("_xla_metrics_snapshot",
+        []() { return xla::metrics_reader::TakeSnapshot(); });
+  m.def("_xla_metrics_diff",
+        [](const xla::metrics_reader::MetricsSnapshot& before,
+           const xla::metrics_reader::MetricsSnapshot& after) {
+          return GetMetricsDelta(before, after);
+        });
+  m.def("_xla_metrics_check_gates",
+        [](const xla::metrics_reader::MetricsSnapshot& before,
+           const xla::metrics_reader::MetricsSnapshot& after,
+           const std::map<std::string, int64_t>& limits) {
+          return xla::metrics_reader::CheckGates(
+              xla::metrics_reader::DiffSnapshots(before, after), limits);
+        });
+  m.def("_xla_cpu_fallback_stats", []() { return GetCpuFallbackStats(); });
+  m.def("_xla_graph_profile", []() { return GetGraphProfile(); });
+  m.def("_xla_performance_analysis",
+        []() { return GetPerformanceAnalysis(); });
+  m.def("_xla_step_breakdown", []() { return GetStepBreakdown(); });
+  m.def("_xla_dump_fn_tracker", [](const std::string& path) {
+    NoGilSection nogil;
+    return fn_tracker::DumpBinary(path);
+  });
+  m.def("_xla_recompile_reports",
+        []() { return DebugUtil::GetGraphHashDivergences(); });
+  m.def("_xla_reset_graph_profile", []() { GraphProfiler::Get()->Reset(); });
   m.def("_xla_tensors_report",
         [](size_t nodes_threshold, const std::string& device) {
           return GetLiveTensorsReport(nodes_threshold, device);
@@ -1178,6 +2271,9 @@ void InitXlaModuleBindings(py::module m) {
   m.def("_xla_memory_info", [](const std::string& device) -> py::object {
     return GetMemoryInfo(device);
   });
+  m.def("_xla_memory_snapshot", []() { return GetMemorySnapshot(); });
+  m.def("_xla_memory_timeline",
+        []() { return xla::memory_tracker::CreateTimelineTrace(); });
   m.def("_xla_set_use_full_mat_mul_precision",
         [](bool use_full_mat_mul_precision) {
           XlaHelpers::set_mat_mul_precision(
@@ -1196,19 +2292,56 @@ void InitXlaModuleBindings(py::module m) {
         },
         py::arg("path"), py::arg("compression") = "",
         py::arg("buffer_size") = 16 * 1024 * 1024);
-  m.def(
-      "_xla_tfrecord_read",
-      [](const std::shared_ptr<xla::util::RecordReader>& reader) -> py::object {
-        xla::util::RecordReader::Data record;
-        if (!RecordRead(reader, &record)) {
-          return py::none();
-        }
-        return py::bytes(record.data(), record.size());
-      });
+  py::class_<xla::util::InterleavedRecordReader,
+             std::shared_ptr<xla::util::InterleavedRecordReader>>(
+      m, "InterleavedRecordReader");
+  m.def("_xla_create_tfrecord_interleaved_reader",
+        [](const std::vector<std::string>& paths,
+           const std::string& compression, int64_t buffer_size,
+           size_t parallelism, size_t readahead, bool shuffle, uint64_t seed) {
+          NoGilSection nogil;
+          xla::util::InterleavedRecordReader::Options options;
+          options.compression = compression;
+          options.buffer_size = buffer_size;
+          options.parallelism = parallelism;
+          options.readahead = readahead;
+          options.shuffle = shuffle;
+          options.seed = seed;
+          return std::make_shared<xla::util::InterleavedRecordReader>(
+              paths, std::move(options));
+        },
+        py::arg("paths"), py::arg("compression") = "",
+        py::arg("buffer_size") = 16 * 1024 * 1024, py::arg("parallelism") = 4,
+        py::arg("readahead") = 64, py::arg("shuffle") = false,
+        py::arg("seed") = 0);
+  m.def("_xla_tfrecord_read",
+        [](const std::shared_ptr<xla::util::RecordReader>& reader) {
+          return RecordReadBytes(reader);
+        });
+  m.def("_xla_tfrecord_read",
+        [](const std::shared_ptr<xla::util::InterleavedRecordReader>& reader) {
+          return RecordReadBytes(reader);
+        });
   m.def("_xla_tfexample_read",
         [](const std::shared_ptr<xla::util::RecordReader>& reader) {
           return RecordReadExample(reader);
         });
+  m.def("_xla_tfexample_read",
+        [](const std::shared_ptr<xla::util::InterleavedRecordReader>& reader) {
+          return RecordReadExample(reader);
+        });
+  m.def("_xla_tfexample_read_batch",
+        [](const std::shared_ptr<xla::util::RecordReader>& reader,
+           size_t batch_size, const std::string& device) {
+          return RecordReadExampleBatch(reader, batch_size, device);
+        },
+        py::arg("reader"), py::arg("batch_size"), py::arg("device") = "");
+  m.def("_xla_tfexample_read_batch",
+        [](const std::shared_ptr<xla::util::InterleavedRecordReader>& reader,
+           size_t batch_size, const std::string& device) {
+          return RecordReadExampleBatch(reader, batch_size, device);
+        },
+        py::arg("reader"), py::arg("batch_size"), py::arg("device") = "");
 
   py::class_<tensorflow::RandomAccessFile>(m, "TfRdFile");
   m.def("_xla_tffile_open", [](const std::string& path) {
@@ -1226,6 +2359,23 @@ void InitXlaModuleBindings(py::module m) {
         [](tensorflow::RandomAccessFile* file, uint64_t offset, size_t size) {
           return ReadTfFile(file, offset, size);
         });
+  m.def("_xla_tffile_readinto",
+        [](tensorflow::RandomAccessFile* file, uint64_t offset,
+           py::object target) {
+          TfFileBuffer read_target(std::move(target), /*writable=*/true);
+          NoGilSection nogil;
+          return ReadTfFileInto(file, offset, read_target.size(),
+                                read_target.data());
+        });
+  py::class_<AsyncTfFileRead, std::shared_ptr<AsyncTfFileRead>>(
+      m, "AsyncTfFileRead")
+      .def("is_ready", &AsyncTfFileRead::IsReady)
+      .def("wait", &AsyncTfFileRead::Wait);
+  m.def("_xla_tffile_readinto_async",
+        [](py::object file, uint64_t offset, py::object target) {
+          return ReadTfFileIntoAsync(std::move(file), offset,
+                                     std::move(target));
+        });
 
   py::class_<tensorflow::WritableFile>(m, "TfWrFile");
   m.def("_xla_tffile_create", [](const std::string& path) {
@@ -1240,8 +2390,24 @@ void InitXlaModuleBindings(py::module m) {
   m.def("_xla_tffile_write",
         [](tensorflow::WritableFile* file, const std::string& data) {
           NoGilSection nogil;
-          WriteTfFile(file, data);
+          WriteTfFile(file, data.data(), data.size());
+        });
+  m.def("_xla_tffile_write_buffer",
+        [](tensorflow::WritableFile* file, py::object buffer) {
+          TfFileBuffer source(std::move(buffer), /*writable=*/false);
+          NoGilSection nogil;
+          WriteTfFile(file, source.data(), source.size());
         });
+  m.def("_xla_tffiles_write", [](const std::vector<std::string>& paths,
+                                 const std::vector<py::object>& buffers) {
+    std::vector<std::unique_ptr<TfFileBuffer>> sources;
+    for (auto& buffer : buffers) {
+      sources.push_back(
+          std::make_unique<TfFileBuffer>(buffer, /*writable=*/false));
+    }
+    NoGilSection nogil;
+    WriteTfFiles(paths, sources);
+  });
   m.def("_xla_tffile_flush", [](tensorflow::WritableFile* file) {
     NoGilSection nogil;
     FlushTfFile(file);
@@ -1351,62 +2517,179 @@ void InitXlaModuleBindings(py::module m) {
                 weight_decay, eps, amsgrad, maximize, use_adamw);
           }
         });
+  m.def("_xla_foreach_adam_optimizer_step_",
+        [](const at::Tensor& found_inf, const std::vector<at::Tensor>& steps,
+           const std::vector<at::Tensor>& params,
+           const std::vector<at::Tensor>& grads,
+           const std::vector<at::Tensor>& exp_avgs,
+           const std::vector<at::Tensor>& exp_avg_sqs,
+           const std::vector<at::Tensor>& max_exp_avg_sqs, double beta1,
+           double beta2, double lr, double weight_decay, double eps,
+           bool amsgrad, bool maximize, bool use_adamw) {
+          {
+            NoGilSection nogil;
+            XLATensor::foreach_adam_optimizer_step_(
+                bridge::GetXlaTensor(found_inf), bridge::GetXlaTensors(steps),
+                bridge::GetXlaTensors(params), bridge::GetXlaTensors(grads),
+                bridge::GetXlaTensors(exp_avgs),
+                bridge::GetXlaTensors(exp_avg_sqs),
+                bridge::GetXlaTensors(max_exp_avg_sqs), beta1, beta2, lr,
+                weight_decay, eps, amsgrad, maximize, use_adamw);
+          }
+        });
+  m.def("_xla_lamb_optimizer_step_",
+        [](const at::Tensor& found_inf, const std::vector<at::Tensor>& steps,
+           const std::vector<at::Tensor>& params,
+           const std::vector<at::Tensor>& grads,
+           const std::vector<at::Tensor>& exp_avgs,
+           const std::vector<at::Tensor>& exp_avg_sqs, double beta1,
+           double beta2, double lr, double weight_decay, double eps) {
+          {
+            NoGilSection nogil;
+            XLATensor::lamb_optimizer_step_(
+                bridge::GetXlaTensor(found_inf), bridge::GetXlaTensors(steps),
+                bridge::GetXlaTensors(params), bridge::GetXlaTensors(grads),
+                bridge::GetXlaTensors(exp_avgs),
+                bridge::GetXlaTensors(exp_avg_sqs), beta1, beta2, lr,
+                weight_decay, eps);
+          }
+        });
+  m.def("_xla_adafactor_optimizer_step_",
+        [](const at::Tensor& found_inf, const std::vector<at::Tensor>& steps,
+           const std::vector<at::Tensor>& params,
+           const std::vector<at::Tensor>& grads,
+           const std::vector<at::Tensor>& exp_avg_sqs,
+           const std::vector<at::Tensor>& exp_avg_sq_rows,
+           const std::vector<at::Tensor>& exp_avg_sq_cols, double lr,
+           double weight_decay, double decay_rate, double eps1, double eps2,
+           double clip_threshold, bool scale_parameter) {
+          {
+            NoGilSection nogil;
+            XLATensor::adafactor_optimizer_step_(
+                bridge::GetXlaTensor(found_inf), bridge::GetXlaTensors(steps),
+                bridge::GetXlaTensors(params), bridge::GetXlaTensors(grads),
+                bridge::GetXlaTensors(exp_avg_sqs),
+                bridge::GetXlaTensors(exp_avg_sq_rows),
+                bridge::GetXlaTensors(exp_avg_sq_cols), lr, weight_decay,
+                decay_rate, eps1, eps2, clip_threshold, scale_parameter);
+          }
+        });
+  m.def("_xla_foreach_clip_norm_",
+        [](const std::vector<at::Tensor>& tensors, double max_norm,
+           double norm_type) -> at::Tensor {
+          XLATensorPtr total_norm;
+          {
+            NoGilSection nogil;
+            total_norm = XLATensor::foreach_clip_norm_(
+                bridge::GetXlaTensors(tensors), max_norm, norm_type);
+          }
+          return bridge::AtenFromXlaTensor(std::move(total_norm));
+        });
+  m.def("_xla_embedding_bag_sparse_sgd_",
+        [](at::Tensor& weight, const at::Tensor& grad,
+           const at::Tensor& indices, const at::Tensor& offsets, double lr,
+           int64_t mode, const c10::optional<at::Tensor>& per_sample_weights,
+           bool include_last_offset, int64_t padding_idx) {
+          XLATensorPtr weight_tensor = bridge::GetXlaTensor(weight);
+          XLATensorPtr per_sample_weights_tensor =
+              per_sample_weights ? bridge::GetXlaTensor(*per_sample_weights)
+                                 : XLATensorPtr();
+          {
+            NoGilSection nogil;
+            XLATensor::embedding_bag_sparse_sgd_(
+                weight_tensor, bridge::GetXlaTensor(grad),
+                bridge::GetXlaTensor(indices), bridge::GetXlaTensor(offsets),
+                lr, mode, per_sample_weights_tensor, include_last_offset,
+                padding_idx);
+          }
+        });
+  m.def("_xla_quantized_linear",
+        [](const at::Tensor& input, const at::Tensor& weight,
+           const at::Tensor& weight_scales,
+           const c10::optional<at::Tensor>& bias, double input_scale,
+           int64_t input_zero_point, c10::optional<double> output_scale,
+           int64_t output_zero_point) {
+          QuantizationParams params;
+          params.input_scale = input_scale;
+          params.input_zero_point = input_zero_point;
+          if (output_scale) {
+            params.output_scale = *output_scale;
+          }
+          params.output_zero_point = output_zero_point;
+          XLATensorPtr bias_tensor =
+              bias ? bridge::GetXlaTensor(*bias) : XLATensorPtr();
+          XLATensorPtr result;
+          {
+            NoGilSection nogil;
+            result = XLATensor::quantized_linear(
+                bridge::GetXlaTensor(input), bridge::GetXlaTensor(weight),
+                bridge::GetXlaTensor(weight_scales), bias_tensor, params);
+          }
+          return bridge::AtenFromXlaTensor(std::move(result));
+        });
+  m.def("_xla_quantized_conv",
+        [](const at::Tensor& input, const at::Tensor& weight,
+           const at::Tensor& weight_scales,
+           const c10::optional<at::Tensor>& bias, std::vector<int64_t> stride,
+           std::vector<int64_t> padding, std::vector<int64_t> dilation,
+           int64_t groups, double input_scale, int64_t input_zero_point,
+           c10::optional<double> output_scale, int64_t output_zero_point) {
+          QuantizationParams params;
+          params.input_scale = input_scale;
+          params.input_zero_point = input_zero_point;
+          if (output_scale) {
+            params.output_scale = *output_scale;
+          }
+          params.output_zero_point = output_zero_point;
+          XLATensorPtr bias_tensor =
+              bias ? bridge::GetXlaTensor(*bias) : XLATensorPtr();
+          XLATensorPtr result;
+          {
+            NoGilSection nogil;
+            result = XLATensor::quantized_convolution(
+                bridge::GetXlaTensor(input), bridge::GetXlaTensor(weight),
+                bridge::GetXlaTensor(weight_scales), bias_tensor,
+                std::move(stride), std::move(padding), std::move(dilation),
+                groups, params);
+          }
+          return bridge::AtenFromXlaTensor(std::move(result));
+        });
   m.def("_xla_mark_sharding", [](const at::Tensor& input,
                                  const py::list& tile_assignment,
-                                 bool replicated = false, bool manual = false) {
-    XLA_CHECK(!(replicated && manual))
-        << "Invalid input sharding spec: "
-        << "replicated=" << replicated << " manual=" << manual;
-
-    // Support {REPLICATED, OTHER, MANUAL} sharding types
-    xla::OpSharding sharding;
-    if (replicated && !manual) {
-      xla::HloSharding hlo_sharding = xla::HloSharding::Replicate();
-      sharding = hlo_sharding.ToProto();
-    } else if (!replicated && manual) {
-      xla::HloSharding hlo_sharding = xla::HloSharding::Manual();
-      sharding = hlo_sharding.ToProto();
-    } else {
-      size_t rank0 = tile_assignment.size();
-      XLA_CHECK(rank0 > 0) << "Invalid input sharding spec: "
-                           << "empty tile_assignment";
-
-      // Support chunk (1-D) and mesh (2-D) shardings
-      std::string type = GetPyTypeString(tile_assignment[0]);
-      if (type.compare("list") == 0) {
-        py::list row = tile_assignment[0].cast<py::list>();
-        size_t rank1 = row.size();
-        XLA_CHECK(rank1 > 0) << "Invalid input sharding spec: "
-                             << "empty or irregular tile_assignment";
-        XLA_CHECK(GetPyTypeString(row[0]).compare("list") != 0)
-            << "Invalid input sharding spec: "
-            << "tile_assignment (ndarray) rank > 2";
-
-        std::vector<int64_t> tile_shape{static_cast<long>(rank0),
-                                        static_cast<long>(rank1)};
-        xla::Array<int64_t> tile_array(tile_shape);
-        tile_array.Each([&](absl::Span<const int64_t> indices, int64_t* v) {
-          auto r = tile_assignment[indices[0]].cast<py::list>();
-          *v = r[indices[1]].cast<int64_t>();
+                                 bool replicated, bool manual, bool partial) {
+    xla::OpSharding sharding = ShardingFromTileAssignment(
+        tile_assignment, replicated, manual, partial);
+    XLATensorPtr xtensor = bridge::GetXlaTensor(input);
+    xtensor->SetShardingSpec(sharding, replicated, manual);
+  });
+  m.def("_xla_spmd_full_to_shard_shape",
+        [](const at::Tensor& input, const py::list& tile_assignment,
+           bool replicated, bool partial) -> at::Tensor {
+          XLA_CHECK(ShardingUtil::UseSpmd())
+              << "The manual sharding regions require XLA_USE_SPMD";
+          xla::OpSharding sharding = ShardingFromTileAssignment(
+              tile_assignment, replicated, /*manual=*/false, partial);
+          XLATensorPtr xtensor = bridge::GetXlaTensor(input);
+          return bridge::AtenFromXlaTensor(XLATensor::spmd_full_to_shard_shape(
+              xtensor, std::move(sharding)));
         });
-        xla::HloSharding hlo_sharding = xla::HloSharding::Tile(tile_array);
-        sharding = hlo_sharding.ToProto();
-      } else if (type.compare("int") == 0 || type.compare("float") == 0) {
-        std::vector<int64_t> tile_shape{static_cast<long>(rank0)};
-        xla::Array<int64_t> tile_array(tile_shape);
-        tile_array.Each([&](absl::Span<const int64_t> indices, int64_t* v) {
-          *v = tile_assignment[indices[0]].cast<int64_t>();
+  m.def("_xla_spmd_shard_to_full_shape",
+        [](const at::Tensor& input, const py::list& tile_assignment,
+           bool replicated, bool partial,
+           std::vector<int64_t> full_sizes) -> at::Tensor {
+          XLA_CHECK(ShardingUtil::UseSpmd())
+              << "The manual sharding regions require XLA_USE_SPMD";
+          xla::OpSharding sharding = ShardingFromTileAssignment(
+              tile_assignment, replicated, /*manual=*/false, partial);
+          XLATensorPtr xtensor = bridge::GetXlaTensor(input);
+          return bridge::AtenFromXlaTensor(XLATensor::spmd_shard_to_full_shape(
+              xtensor, std::move(sharding), std::move(full_sizes)));
         });
-        xla::HloSharding hlo_sharding = xla::HloSharding::Tile(tile_array);
-        sharding = hlo_sharding.ToProto();
-      } else {
-        LOG(ERROR) << "Unsupported tile_assignment (ndarray) element type: "
-                   << type;
-      }
+  m.def("_xla_get_spmd_devices", []() -> std::vector<std::string> {
+    if (!ShardingUtil::UseSpmd()) {
+      return {};
     }
-
-    XLATensorPtr xtensor = bridge::GetXlaTensor(input);
-    xtensor->SetShardingSpec(sharding, replicated, manual);
+    return ShardingUtil::GetSpmdDevices();
   });
   m.def("_xla_clear_sharding", [](const at::Tensor& input) {
     XLATensorPtr xtensor = bridge::GetXlaTensor(input);
@@ -1421,6 +2704,58 @@ void InitXlaModuleBindings(py::module m) {
     }
     return std::string();
   });
+  m.def("_xla_get_tensor_shards", [](const at::Tensor& input) -> py::tuple {
+    // The slices of the sharded tensors come straight from their devices, the
+    // other tensors have a single slice covering all of them.
+    XLATensorPtr xtensor = bridge::GetXlaTensor(input);
+    std::vector<at::Tensor> slices;
+    std::vector<std::vector<int64_t>> offsets;
+    std::string sharding;
+    {
+      NoGilSection nogil;
+      xla::ComputationClient::DataPtr data =
+          UnwrapXlaData(xtensor->GetXlaData());
+      const ShardedData* sharded = dynamic_cast<const ShardedData*>(data.get());
+      if (sharded != nullptr) {
+        slices =
+            ShardingUtil::GetDataSlices(*sharded, xtensor->dtype(), &offsets);
+        sharding = sharded->sharding().SerializeAsString();
+      } else {
+        slices.push_back(xtensor->ToTensor(/*detached=*/true));
+        offsets.emplace_back(slices.back().dim(), 0);
+      }
+    }
+    return py::make_tuple(slices, offsets, py::bytes(sharding));
+  });
+  m.def("_xla_tensor_from_shards",
+        [](const std::vector<at::Tensor>& slices,
+           const std::vector<std::vector<int64_t>>& offsets,
+           const std::string& sharding_proto, const std::vector<int64_t>& sizes,
+           const std::string& device) -> at::Tensor {
+          XLA_CHECK(ShardingUtil::UseSpmd())
+              << "The sharded tensors can only be restored in the SPMD mode";
+          XLA_CHECK(!slices.empty());
+          xla::OpSharding sharding;
+          XLA_CHECK(sharding.ParseFromString(sharding_proto))
+              << "Invalid sharding";
+          torch::lazy::BackendDevice xla_device = GetDeviceOrCurrent(device);
+          at::ScalarType scalar_type = slices.front().scalar_type();
+          XLATensorPtr xtensor;
+          {
+            NoGilSection nogil;
+            xla::Shape shape = MakeXlaShapeFromLazyShape(
+                torch::lazy::Shape(scalar_type, sizes), xla_device);
+            xtensor = XLATensor::Create(
+                WrapXlaData(ShardingUtil::CreateShardedDataFromSlices(
+                    slices, offsets, shape, sharding, xla_device.toString())),
+                scalar_type);
+            xtensor->SetShardingSpec(
+                sharding,
+                /*replicated=*/sharding.type() == xla::OpSharding::REPLICATED,
+                /*manual=*/false);
+          }
+          return bridge::AtenFromXlaTensor(std::move(xtensor));
+        });
   m.def("_xla_partitioning_pass",
         [](const std::vector<at::Tensor>& tensors, int64_t num_replicas,
            int64_t num_devices, bool conv_halo_exchange_always_on_lhs = true,
@@ -1468,8 +2803,15 @@ void InitXlaModuleBindings(py::module m) {
           return module->ToString();
         });
 
+  m.def("_xla_spmd_memory_plan",
+        [](const std::vector<at::Tensor>& tensors, int64_t num_devices) {
+          return PlanSpmdMemory(tensors, num_devices);
+        });
+
   m.def("_init_xla_lazy_backend", []() {
     MapXlaEnvVarsToLazy();
+    SourceLocationTable::SetCallbacks(CapturePythonFrames,
+                                      DescribePythonFrame);
     InitXlaBackend();
   });
 
@@ -0,0 +1,74 @@
+#include "torch_xla/csrc/input_prefetcher.h"
+
+#include <algorithm>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "torch_xla/csrc/tensor.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+
+InputPrefetcher::InputPrefetcher(const torch::lazy::BackendDevice& device,
+                                 size_t depth)
+    : device_(device.toString()), depth_(std::max<size_t>(depth, 1)) {}
+
+InputPrefetcher::~InputPrefetcher() {
+  Close();
+  // The uploads hold references to their batches, so there is no need to wait
+  // for the in flight ones.
+}
+
+void InputPrefetcher::Put(std::vector<at::Tensor> tensors) {
+  auto batch = std::make_shared<Batch>();
+  for (auto& tensor : tensors) {
+    batch->element_types.push_back(tensor.scalar_type());
+  }
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    cv_.wait(lock, [this] { return closed_ || batches_.size() < depth_; });
+    XLA_CHECK(!closed_) << "Put() on a closed input prefetcher";
+    batches_.push_back(batch);
+  }
+  XLA_COUNTER("InputPrefetcherBatches", 1);
+  auto uploadfn = [batch, device = device_, tensors = std::move(tensors)]() {
+    std::vector<std::string> devices(tensors.size(), device);
+    batch->datas = CreateTensorsData(tensors, devices);
+  };
+  xla::env::ScheduleIoClosure(batch->mwait.Completer(std::move(uploadfn)));
+}
+
+bool InputPrefetcher::Get(std::vector<at::Tensor>* tensors) {
+  XLA_TIMED("InputPrefetcherGet");
+  std::shared_ptr<Batch> batch;
+  {
+    std::unique_lock<std::mutex> lock(lock_);
+    cv_.wait(lock, [this] { return closed_ || !batches_.empty(); });
+    if (batches_.empty()) {
+      return false;
+    }
+    batch = std::move(batches_.front());
+    batches_.pop_front();
+  }
+  cv_.notify_all();
+  batch->mwait.Wait();
+  tensors->clear();
+  tensors->reserve(batch->datas.size());
+  for (size_t i = 0; i < batch->datas.size(); ++i) {
+    XLATensorPtr xtensor =
+        XLATensor::Create(std::move(batch->datas[i]), batch->element_types[i]);
+    tensors->push_back(bridge::AtenFromXlaTensor(std::move(xtensor)));
+  }
+  return true;
+}
+
+void InputPrefetcher::Close() {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    closed_ = true;
+  }
+  cv_.notify_all();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "torch/csrc/lazy/backend/backend_data.h"
+#include "torch/csrc/lazy/backend/backend_device.h"
+#include "torch_xla/csrc/aten_xla_bridge.h"
+
+namespace torch_xla {
+
+// The InputPrefetcher uploads batches of CPU tensors to a device in the
+// background, keeping up to depth batches in flight (or uploaded and not yet
+// consumed), so that the training loop can get device tensors without waiting
+// for their transfer, and without the upload code needing to hold the GIL.
+class InputPrefetcher {
+ public:
+  InputPrefetcher(const torch::lazy::BackendDevice& device, size_t depth);
+
+  ~InputPrefetcher();
+
+  // Queues a batch of CPU tensors for upload, blocking while depth batches are
+  // already queued. The tensors must not be modified in place after this call.
+  void Put(std::vector<at::Tensor> tensors);
+
+  // Stores within tensors the device tensors of the oldest queued batch,
+  // waiting for its upload to complete. Returns false if the prefetcher has
+  // been closed, and all the batches have been consumed.
+  bool Get(std::vector<at::Tensor>* tensors);
+
+  // Marks the end of the stream of batches. Pending batches can still be
+  // consumed with Get().
+  void Close();
+
+ private:
+  struct Batch {
+    Batch() : mwait(1) {}
+
+    xla::util::MultiWait mwait;
+    std::vector<at::ScalarType> element_types;
+    std::vector<torch::lazy::BackendDataPtr> datas;
+  };
+
+  std::string device_;
+  size_t depth_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::deque<std::shared_ptr<Batch>> batches_;
+  bool closed_ = false;
+};
+
+}  // namespace torch_xla
@@ -4,25 +4,28 @@
 #include <sstream>
 
 #include "absl/strings/str_cat.h"
-#include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sharded_cache.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "torch/csrc/lazy/core/config.h"
 #include "torch/csrc/lazy/core/hash.h"
 #include "torch/csrc/lazy/core/ir_metadata.h"
 #include "torch/csrc/lazy/python/python_util.h"
+#include "torch_xla/csrc/host_trace.h"
 #include "torch_xla/csrc/lowering_context.h"
 
 namespace torch_xla {
 namespace {
 
-using ShapeCache =
-    xla::util::Cache<torch::lazy::hash_t, xla::Shape, torch::lazy::HashReducer>;
+using ShapeCache = xla::util::ShardedCache<torch::lazy::hash_t, xla::Shape,
+                                           torch::lazy::HashReducer>;
 
 ShapeCache* GetShapeCache() {
   static int64_t shape_cache_size =
       xla::sys_util::GetEnvInt("XLA_IR_SHAPE_CACHE_SIZE", 4096);
-  static ShapeCache* cache = new ShapeCache(shape_cache_size);
+  static ShapeCache* cache =
+      new ShapeCache(shape_cache_size, /*num_shards=*/16,
+                     xla::util::CacheOptions{"ShapeCache"});
   return cache;
 }
 
@@ -155,6 +158,7 @@ xla::Shape XlaNode::GetOpShape(
   ShapeCache* shape_cache = GetShapeCache();
   auto shape = shape_cache->Get(hash());
   if (shape == nullptr) {
+    XLA_TRACE_SCOPE("ShapeInference");
     shape = shape_cache->Add(hash(), std::make_shared<xla::Shape>(shape_fn()));
   }
   return *shape;
@@ -165,4 +169,17 @@ const xla::Shape& GetXlaShape(const torch::lazy::Value& value) {
   return casted->xla_shape(value.index);
 }
 
+const std::vector<torch::lazy::SourceLocation>& XlaNode::frame_info() const {
+  const std::vector<torch::lazy::SourceLocation>& frame_info =
+      metadata().frame_info;
+  return !frame_info.empty() ? frame_info
+                             : SourceLocationTable::Get(source_location_);
+}
+
+const std::vector<torch::lazy::SourceLocation>& GetFrameInfo(
+    const torch::lazy::Node* node) {
+  const XlaNode* casted = dynamic_cast<const XlaNode*>(node);
+  return casted != nullptr ? casted->frame_info() : node->metadata().frame_info;
+}
+
 }  // namespace torch_xla
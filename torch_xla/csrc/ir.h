@@ -20,6 +20,8 @@
 #include "torch/csrc/lazy/core/hash.h"
 #include "torch/csrc/lazy/core/ir.h"
 #include "torch/csrc/lazy/core/ir_builder.h"
+#include "torch_xla/csrc/node_arena.h"
+#include "torch_xla/csrc/source_location_table.h"
 
 namespace torch_xla {
 
@@ -121,6 +123,32 @@ class XlaNode : public torch::lazy::Node {
   }
   void ClearSharding() { output_sharding_ = nullptr; }
 
+  // Returns the Python frames the node has been created from, innermost first,
+  // either from the XLA_IR_DEBUG metadata, or from the compact source location
+  // records (XLA_IR_SOURCE_LOCATIONS).
+  const std::vector<torch::lazy::SourceLocation>& frame_info() const;
+
+  // Retrieves the memoized post-order of the graph rooted at this node, or
+  // nullptr if none has been recorded. Since the node keeps its operands
+  // alive, the nodes within the post-order are valid as long as this node is.
+  std::shared_ptr<const std::vector<const torch::lazy::Node*>> post_order()
+      const {
+    return std::atomic_load(&post_order_);
+  }
+  void set_post_order(
+      std::shared_ptr<const std::vector<const torch::lazy::Node*>> post_order)
+      const {
+    std::atomic_store(&post_order_, std::move(post_order));
+  }
+
+  // Whether the output of the node is an update of its first operand (like
+  // the scatters), so that the buffer of the operand can be written in place
+  // when nothing else references it (see XLA_INPLACE_UPDATES).
+  bool inplace_update() const { return inplace_update_; }
+
+ protected:
+  void MarkInPlaceUpdate() { inplace_update_ = true; }
+
  private:
   xla::Shape GetOpShape(const std::function<xla::Shape()>& shape_fn) const;
 
@@ -128,8 +156,6 @@ class XlaNode : public torch::lazy::Node {
                                        const xla::Shape& shape,
                                        torch::lazy::hash_t hash_seed);
 
-  static std::vector<torch::lazy::SourceLocation> GetFrameInfo();
-
   xla::Shape xla_shape_;
   torch::lazy::hash_t node_hash_ = 0;
   torch::lazy::hash_t dag_hash_;
@@ -137,6 +163,14 @@ class XlaNode : public torch::lazy::Node {
   // Experimental sharding annotation attached to the IR node.
   // TODO: make sure that view update doesn't reset this.
   const xla::OpSharding* output_sharding_ = nullptr;
+
+  mutable std::shared_ptr<const std::vector<const torch::lazy::Node*>>
+      post_order_;
+
+  // The id of the SourceLocationTable record of the node creation site.
+  uint32_t source_location_ = SourceLocationTable::Capture();
+
+  bool inplace_update_ = false;
 };
 
 inline std::ostream& operator<<(std::ostream& stream, const XlaNode& node) {
@@ -146,6 +180,10 @@ inline std::ostream& operator<<(std::ostream& stream, const XlaNode& node) {
 
 const xla::Shape& GetXlaShape(const torch::lazy::Value& value);
 
+// Returns the Python frames the node has been created from, if known.
+const std::vector<torch::lazy::SourceLocation>& GetFrameInfo(
+    const torch::lazy::Node* node);
+
 template <typename T>
 T* NodeCast(const torch::lazy::Node* node, torch::lazy::OpKind op) {
   if (op != node->op()) {
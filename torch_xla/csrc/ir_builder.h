@@ -17,19 +17,19 @@ namespace torch_xla {
 struct XLAIrBuilder : torch::lazy::IrBuilder {
   torch::lazy::NodePtr MakeDeviceData(
       const std::shared_ptr<torch::lazy::BackendData>& data) const override {
-    return torch::lazy::MakeNode<DeviceData>(data);
+    return MakeXlaNode<DeviceData>(data);
   }
 
   torch::lazy::NodePtr MakeScalar(const at::Scalar& value,
                                   const at::ScalarType& type) const override {
-    return torch::lazy::MakeNode<Scalar>(
+    return MakeXlaNode<Scalar>(
         value, MakeXlaPrimitiveType(type, GetDefaultDevice()));
   }
   torch::lazy::NodePtr MakeExpand(const torch::lazy::Value& input0,
                                   const std::vector<int64_t>& size,
                                   const bool& is_scalar_expand) const override {
     // TODO(JackCaoG): handle is_scalar_expand
-    return torch::lazy::MakeNode<Expand>(input0, size);
+    return MakeXlaNode<Expand>(input0, size);
   }
   torch::lazy::NodePtr MakeView(
       const torch::lazy::Value& input0,
@@ -41,7 +41,7 @@ struct XLAIrBuilder : torch::lazy::IrBuilder {
                                 const at::ScalarType& dtype,
                                 const c10::optional<at::ScalarType>& stype =
                                     c10::nullopt) const override {
-    return torch::lazy::MakeNode<Cast>(input0, dtype, stype);
+    return MakeXlaNode<Cast>(input0, dtype, stype);
   }
   torch::lazy::NodePtr MakeTensorList(
       const torch::lazy::OpList& inputs) const override {
@@ -142,19 +142,19 @@ struct XLAIrBuilder : torch::lazy::IrBuilder {
 
   torch::lazy::NodePtr MakeSizeNode(const torch::lazy::Value& input,
                                     size_t dim) const override {
-    return torch::lazy::MakeNode<SizeNode>(input, dim);
+    return MakeXlaNode<SizeNode>(input, dim);
   }
   torch::lazy::NodePtr MakeSizeAdd(const torch::lazy::Value& a,
                                    const torch::lazy::Value& b) const override {
-    return torch::lazy::MakeNode<SizeAdd>(a, b);
+    return MakeXlaNode<SizeAdd>(a, b);
   }
   torch::lazy::NodePtr MakeSizeMul(const torch::lazy::Value& a,
                                    const torch::lazy::Value& b) const override {
-    return torch::lazy::MakeNode<SizeMul>(a, b);
+    return MakeXlaNode<SizeMul>(a, b);
   }
   torch::lazy::NodePtr MakeSizeDiv(const torch::lazy::Value& a,
                                    const torch::lazy::Value& b) const override {
-    return torch::lazy::MakeNode<SizeDiv>(a, b);
+    return MakeXlaNode<SizeDiv>(a, b);
   }
 };
 
@@ -178,6 +178,19 @@ std::string GenerateTextNodeSpec(const torch::lazy::Node* node,
   return ss.str();
 }
 
+xla::XlaComputation LowerValues(c10::ArrayRef<torch::lazy::Value> values,
+                                const torch::lazy::BackendDevice& device) {
+  LoweringContext lowering_ctx("IrToHlo", device);
+  for (auto& ir_value : values) {
+    lowering_ctx.AddResult(
+        torch::lazy::Output(ir_value.node.get(), ir_value.index));
+  }
+  // Annotate HLO sharding selectively in the compuation.
+  // This is no-op if an instruction doesn't have any sharding annotation.
+  ShardingUtil::SetHloSharding(&lowering_ctx);
+  return ConsumeValue(lowering_ctx.BuildXla());
+}
+
 }  // namespace
 
 std::string DumpUtil::ToDot(absl::Span<const torch::lazy::Node* const> nodes) {
@@ -249,17 +262,13 @@ std::string DumpUtil::PostOrderToText(
 
 std::string DumpUtil::ToHlo(c10::ArrayRef<torch::lazy::Value> values,
                             const torch::lazy::BackendDevice& device) {
-  LoweringContext lowering_ctx("IrToHlo", device);
-  for (auto& ir_value : values) {
-    lowering_ctx.AddResult(
-        torch::lazy::Output(ir_value.node.get(), ir_value.index));
-  }
-  // Annotate HLO sharding selectively in the compuation.
-  // This is no-op if an instruction doesn't have any sharding annotation.
-  ShardingUtil::SetHloSharding(&lowering_ctx);
-
-  xla::XlaComputation computation = ConsumeValue(lowering_ctx.BuildXla());
+  xla::XlaComputation computation = LowerValues(values, device);
   return ConsumeValue(xla::util::GetComputationHloText(computation));
 }
 
+std::string DumpUtil::ToHloProto(c10::ArrayRef<torch::lazy::Value> values,
+                                 const torch::lazy::BackendDevice& device) {
+  return LowerValues(values, device).proto().SerializeAsString();
+}
+
 }  // namespace torch_xla
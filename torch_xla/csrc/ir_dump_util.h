@@ -25,6 +25,11 @@ class DumpUtil {
 
   static std::string ToHlo(c10::ArrayRef<torch::lazy::Value> values,
                            const torch::lazy::BackendDevice& device);
+
+  // Like ToHlo(), but returns the serialized xla::HloModuleProto, which is
+  // much cheaper to build than its text.
+  static std::string ToHloProto(c10::ArrayRef<torch::lazy::Value> values,
+                                const torch::lazy::BackendDevice& device);
 };
 
 }  // namespace torch_xla
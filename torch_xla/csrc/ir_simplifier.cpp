@@ -0,0 +1,136 @@
+#include "torch_xla/csrc/ir_simplifier.h"
+
+#include <cstdint>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "torch/csrc/lazy/core/hash.h"
+#include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/ops/expand.h"
+#include "torch_xla/csrc/ops/scalar.h"
+#include "torch_xla/csrc/ops/view.h"
+
+namespace torch_xla {
+namespace {
+
+// What makes two nodes compute the same value. The node hash covers the
+// operation and its attributes (and the shape for the leaf nodes), while the
+// operands are the canonical ones. DeviceData nodes all have the same node hash
+// for the same shape, so they are told apart by the parameter they map to.
+struct NodeSignature {
+  bool operator==(const NodeSignature& other) const {
+    return node_hash == other.node_hash && parameter == other.parameter &&
+           operands == other.operands;
+  }
+
+  torch::lazy::hash_t node_hash;
+  int64_t parameter = -1;
+  std::vector<torch::lazy::Output> operands;
+};
+
+struct NodeSignatureHasher {
+  size_t operator()(const NodeSignature& signature) const {
+    torch::lazy::hash_t hash =
+        torch::lazy::HashCombine(signature.node_hash, signature.parameter);
+    for (auto& operand : signature.operands) {
+      hash = torch::lazy::HashCombine(
+          hash, torch::lazy::HashCombine(
+                    reinterpret_cast<uintptr_t>(operand.node), operand.index));
+    }
+    return torch::lazy::HashReduce(hash);
+  }
+};
+
+}  // namespace
+
+bool IrSimplifier::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_IR_SIMPLIFY", true);
+  return enabled;
+}
+
+IrSimplifier::IrSimplifier(
+    absl::Span<const torch::lazy::Node* const> post_order,
+    absl::Span<const size_t> parameter_sequence) {
+  std::unordered_map<NodeSignature, const torch::lazy::Node*,
+                     NodeSignatureHasher>
+      signatures;
+  size_t parameter_count = 0;
+  for (auto node : post_order) {
+    const XlaNode* xla_node = dynamic_cast<const XlaNode*>(node);
+    XLA_CHECK(xla_node != nullptr) << *node;
+    NodeSignature signature;
+    const DeviceData* device_data = DeviceData::Cast(node);
+    if (device_data != nullptr) {
+      XLA_CHECK_LT(parameter_count, parameter_sequence.size());
+      signature.parameter = parameter_sequence[parameter_count++];
+    }
+    // Nodes carrying a sharding annotation get their own HLO instructions.
+    if (xla_node->GetSharding() != nullptr) {
+      continue;
+    }
+    for (auto& operand : node->operands()) {
+      signature.operands.emplace_back(GetCanonical(operand.node),
+                                      operand.index);
+    }
+    const torch::lazy::Node* target = node;
+    torch::lazy::NodePtr folded = Fold(xla_node, signature.operands);
+    if (folded != nullptr) {
+      target = folded.get();
+      signature.node_hash =
+          dynamic_cast<const XlaNode*>(target)->node_hash();
+      signature.operands.clear();
+      folded_nodes_.push_back(std::move(folded));
+      replacements_[node] = target;
+    } else {
+      signature.node_hash = xla_node->node_hash();
+    }
+
+    auto it = signatures.emplace(std::move(signature), target);
+    if (!it.second) {
+      replacements_[node] = it.first->second;
+      if (device_data == nullptr && target == node) {
+        ++cse_nodes_;
+      }
+    }
+  }
+  if (cse_nodes_ > 0) {
+    XLA_COUNTER("IrSimplifyCseNodes", cse_nodes_);
+  }
+  if (!folded_nodes_.empty()) {
+    XLA_COUNTER("IrSimplifyFoldedNodes", folded_nodes_.size());
+  }
+  TF_VLOG(5) << "IR simplification removed " << cse_nodes_
+             << " duplicated nodes and folded " << folded_nodes_.size()
+             << " nodes, out of " << post_order.size();
+}
+
+const torch::lazy::Node* IrSimplifier::GetReplacement(
+    const torch::lazy::Node* node) const {
+  auto it = replacements_.find(node);
+  return it != replacements_.end() ? it->second : nullptr;
+}
+
+const torch::lazy::Node* IrSimplifier::GetCanonical(
+    const torch::lazy::Node* node) const {
+  const torch::lazy::Node* replacement = GetReplacement(node);
+  return replacement != nullptr ? replacement : node;
+}
+
+torch::lazy::NodePtr IrSimplifier::Fold(
+    const XlaNode* node, const std::vector<torch::lazy::Output>& operands) {
+  if (dynamic_cast<const Expand*>(node) == nullptr &&
+      dynamic_cast<const ViewOp*>(node) == nullptr) {
+    return nullptr;
+  }
+  const Scalar* scalar = dynamic_cast<const Scalar*>(operands.at(0).node);
+  if (scalar == nullptr || scalar->GetSharding() != nullptr ||
+      node->xla_shape().is_dynamic()) {
+    return nullptr;
+  }
+  return MakeXlaNode<Scalar>(scalar->value(), node->xla_shape());
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Simplifies an IR graph before its lowering. Nodes computing the same value
+// as a previous node of the post order (same node hash, same operands) are
+// replaced by it, and the shape only operations (expand and view) of
+// broadcasted scalars are folded into new scalars with the output shape.
+// The graph itself is left untouched, as its nodes are shared with the live
+// tensors: the lowering of a replaced node reuses the XLA operations emitted
+// for its replacement.
+// The simplification only depends on the information captured by the graph
+// hash, so that computations can still be cached by it.
+class IrSimplifier {
+ public:
+  // Returns whether the simplification is enabled (XLA_IR_SIMPLIFY).
+  static bool IsEnabled();
+
+  // The parameter_sequence holds, for every DeviceData node of the post order,
+  // the index of the parameter it maps to, so that nodes reading the same
+  // device data are recognized as such.
+  IrSimplifier(absl::Span<const torch::lazy::Node* const> post_order,
+               absl::Span<const size_t> parameter_sequence);
+
+  // Returns the node whose outputs replace the ones of node, or nullptr if the
+  // node needs to be lowered.
+  const torch::lazy::Node* GetReplacement(const torch::lazy::Node* node) const;
+
+  // The number of nodes replaced by an equivalent node of the graph.
+  size_t cse_nodes() const { return cse_nodes_; }
+
+  // The number of nodes replaced by a folded scalar.
+  size_t folded_nodes() const { return folded_nodes_.size(); }
+
+ private:
+  const torch::lazy::Node* GetCanonical(const torch::lazy::Node* node) const;
+
+  torch::lazy::NodePtr Fold(const XlaNode* node,
+                            const std::vector<torch::lazy::Output>& operands);
+
+  std::unordered_map<const torch::lazy::Node*, const torch::lazy::Node*>
+      replacements_;
+  // The scalar nodes created by the folding, which need to stay alive for the
+  // lowering.
+  std::vector<torch::lazy::NodePtr> folded_nodes_;
+  size_t cse_nodes_ = 0;
+};
+
+}  // namespace torch_xla
@@ -1,6 +1,9 @@
 #include "torch_xla/csrc/ir_util.h"
 
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "torch_xla/csrc/ops/device_data.h"
 
 namespace torch_xla {
 
@@ -58,6 +61,43 @@ std::vector<const torch::lazy::Node*> Util::ComputePostOrder(
   return ComputePostOrder(nodes, &emap);
 }
 
+std::vector<const torch::lazy::Node*> Util::ComputeMemoizedPostOrder(
+    absl::Span<const torch::lazy::Node* const> nodes, EmissionMap* emap) {
+  std::vector<const torch::lazy::Node*> post_order;
+  for (auto node : nodes) {
+    const XlaNode* casted = dynamic_cast<const XlaNode*>(node);
+    std::shared_ptr<const std::vector<const torch::lazy::Node*>> memo =
+        casted != nullptr ? casted->post_order() : nullptr;
+    if (memo != nullptr) {
+      XLA_COUNTER("PostOrderMemoHit", 1);
+      if (nodes.size() == 1) {
+        // No other sub-graph to merge with, so the emission map is not needed.
+        return *memo;
+      }
+      // A post-order of the sub-graph stays valid after dropping the nodes
+      // already emitted by the previous roots, as those come first anyway.
+      for (auto memo_node : *memo) {
+        if (emap->emplace(memo_node, torch::lazy::Util::kEmitted).second) {
+          post_order.push_back(memo_node);
+        }
+      }
+    } else {
+      // The post-order is complete (hence it can be memoized) only if nothing
+      // has been emitted before.
+      bool complete = emap->empty();
+      auto node_post_order = ComputePostOrder(node, emap);
+      if (complete && casted != nullptr) {
+        casted->set_post_order(
+            std::make_shared<const std::vector<const torch::lazy::Node*>>(
+                node_post_order));
+      }
+      post_order.insert(post_order.end(), node_post_order.begin(),
+                        node_post_order.end());
+    }
+  }
+  return post_order;
+}
+
 std::vector<torch::lazy::Value> Util::Clone(
     c10::ArrayRef<torch::lazy::Value> values,
     absl::Span<const torch::lazy::Node* const> post_order) {
@@ -101,4 +141,28 @@ size_t Util::GetGraphSize(absl::Span<const torch::lazy::Node* const> nodes) {
   return post_order.size();
 }
 
+int64_t Util::GetGraphBytes(
+    absl::Span<const torch::lazy::Node* const> nodes,
+    absl::Span<const torch::lazy::Node* const> boundary) {
+  // The boundary nodes are marked as emitted, so the post order stops at them.
+  EmissionMap emap;
+  for (auto node : boundary) {
+    emap[node] = torch::lazy::Util::kEmitted;
+  }
+  int64_t bytes = 0;
+  for (auto node : ComputePostOrder(nodes, &emap)) {
+    if (DeviceData::Cast(node) != nullptr) {
+      continue;
+    }
+    xla::ShapeUtil::ForEachSubshape(
+        static_cast<const XlaNode*>(node)->xla_shape(),
+        [&](const xla::Shape& subshape, const xla::ShapeIndex& /*index*/) {
+          if (subshape.IsArray()) {
+            bytes += xla::ShapeUtil::ByteSizeOfElements(subshape);
+          }
+        });
+  }
+  return bytes;
+}
+
 }  // namespace torch_xla
@@ -30,6 +30,13 @@ class Util {
   static std::vector<const torch::lazy::Node*> ComputePostOrder(
       absl::Span<const torch::lazy::Node* const> nodes);
 
+  // Same as the ComputePostOrder() API with multiple nodes, but the post-order
+  // of the sub-graphs rooted at the given nodes is memoized on the nodes
+  // themselves, and reused (without walking the sub-graph again) when the same
+  // roots get synced again.
+  static std::vector<const torch::lazy::Node*> ComputeMemoizedPostOrder(
+      absl::Span<const torch::lazy::Node* const> nodes, EmissionMap* emap);
+
   // Clones the IR graph whose roots are passed in the values parameter.
   static std::vector<torch::lazy::Value> Clone(
       c10::ArrayRef<torch::lazy::Value> values);
@@ -42,6 +49,13 @@ class Util {
   // Retrieves the number of nodes within the graph whose sink are passed in the
   // nodes argument.
   static size_t GetGraphSize(absl::Span<const torch::lazy::Node* const> nodes);
+
+  // Retrieves the bytes of the values computed by the graph whose sink are
+  // passed in the nodes argument, without walking past the boundary nodes. The
+  // device data nodes are not computed by the graph, so they do not count.
+  static int64_t GetGraphBytes(
+      absl::Span<const torch::lazy::Node* const> nodes,
+      absl::Span<const torch::lazy::Node* const> boundary);
 };
 
 }  // namespace torch_xla
@@ -0,0 +1,202 @@
+#include "torch_xla/csrc/layer_norm.h"
+
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+struct NormLayout {
+  std::vector<int64_t> sizes;
+  // The sizes of the statistics, before they are reshaped to stat_sizes.
+  std::vector<int64_t> outer_sizes;
+  std::vector<int64_t> stat_sizes;
+  std::vector<int64_t> outer_dims;
+  std::vector<int64_t> normalized_dims;
+  int64_t row_size = 1;
+};
+
+NormLayout GetNormLayout(const xla::Shape& shape, int64_t normalized_ndim) {
+  XLA_CHECK_LE(normalized_ndim, shape.rank()) << shape;
+  NormLayout layout;
+  int64_t axis = shape.rank() - normalized_ndim;
+  for (int64_t dim = 0; dim < shape.rank(); ++dim) {
+    layout.sizes.push_back(shape.dimensions(dim));
+    if (dim < axis) {
+      layout.outer_sizes.push_back(shape.dimensions(dim));
+      layout.stat_sizes.push_back(shape.dimensions(dim));
+      layout.outer_dims.push_back(dim);
+    } else {
+      layout.stat_sizes.push_back(1);
+      layout.normalized_dims.push_back(dim);
+      layout.row_size *= shape.dimensions(dim);
+    }
+  }
+  return layout;
+}
+
+// The reduced precision inputs get normalized in F32.
+xla::PrimitiveType GetAccumulationType(xla::PrimitiveType type) {
+  return type == xla::PrimitiveType::F16 || type == xla::PrimitiveType::BF16
+             ? xla::PrimitiveType::F32
+             : type;
+}
+
+xla::XlaOp BroadcastStat(xla::XlaOp stat, const NormLayout& layout) {
+  return xla::BroadcastInDim(stat, layout.sizes, layout.outer_dims);
+}
+
+xla::XlaOp BroadcastAffine(xla::XlaOp values, const NormLayout& layout) {
+  return xla::BroadcastInDim(values, layout.sizes, layout.normalized_dims);
+}
+
+// Sums both operands over the dimensions within a single (variadic) reduction,
+// so that the input gets read once.
+std::pair<xla::XlaOp, xla::XlaOp> BuildPairSum(
+    xla::XlaOp first, xla::XlaOp second,
+    absl::Span<const int64_t> dimensions) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(first);
+  xla::XlaBuilder pair_builder("PairSum");
+  xla::Shape scalar_shape = xla::ShapeUtil::MakeShape(type, {});
+  xla::XlaOp first_acc =
+      xla::Parameter(&pair_builder, 0, scalar_shape, "first_acc");
+  xla::XlaOp second_acc =
+      xla::Parameter(&pair_builder, 1, scalar_shape, "second_acc");
+  xla::XlaOp first_value =
+      xla::Parameter(&pair_builder, 2, scalar_shape, "first_value");
+  xla::XlaOp second_value =
+      xla::Parameter(&pair_builder, 3, scalar_shape, "second_value");
+  xla::Tuple(&pair_builder,
+             {first_acc + first_value, second_acc + second_value});
+  xla::XlaComputation pair_sum = ConsumeValue(pair_builder.Build());
+
+  xla::XlaOp zero = xla::Zero(first.builder(), type);
+  xla::XlaOp sums = xla::Reduce(first.builder(), {first, second}, {zero, zero},
+                                pair_sum, dimensions);
+  return {xla::GetTupleElement(sums, 0), xla::GetTupleElement(sums, 1)};
+}
+
+}  // namespace
+
+LayerNormOutput BuildLayerNorm(xla::XlaOp input,
+                               const absl::optional<xla::XlaOp>& weight,
+                               const absl::optional<xla::XlaOp>& bias,
+                               int64_t normalized_ndim, double eps, bool rms) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  NormLayout layout = GetNormLayout(input_shape, normalized_ndim);
+  xla::PrimitiveType acc_type =
+      GetAccumulationType(input_shape.element_type());
+  xla::XlaBuilder* builder = input.builder();
+  xla::XlaOp x = xla::ConvertElementType(input, acc_type);
+  xla::XlaOp row_size =
+      XlaHelpers::ScalarValue<int64_t>(layout.row_size, acc_type, builder);
+  xla::XlaOp eps_value =
+      XlaHelpers::ScalarValue<double>(eps, acc_type, builder);
+
+  xla::XlaOp mean;
+  xla::XlaOp variance;
+  if (rms) {
+    mean = xla::Broadcast(xla::Zero(builder, acc_type), layout.outer_sizes);
+    variance = xla::Reduce(x * x, xla::Zero(builder, acc_type),
+                           XlaHelpers::CreateAddComputation(acc_type),
+                           layout.normalized_dims) /
+               row_size;
+  } else {
+    // The sums of the values and squares are taken relative to the first
+    // value of every row, which keeps the single pass variance accurate when
+    // the mean is large compared to the standard deviation.
+    std::vector<int64_t> start_indices(input_shape.rank(), 0);
+    std::vector<int64_t> strides(input_shape.rank(), 1);
+    xla::XlaOp shift = xla::Reshape(
+        xla::Slice(x, start_indices, layout.stat_sizes, strides),
+        layout.outer_sizes);
+    xla::XlaOp shifted = x - BroadcastStat(shift, layout);
+    std::pair<xla::XlaOp, xla::XlaOp> sums =
+        BuildPairSum(shifted, shifted * shifted, layout.normalized_dims);
+    xla::XlaOp shifted_mean = sums.first / row_size;
+    variance = xla::Max(sums.second / row_size - shifted_mean * shifted_mean,
+                        xla::Zero(builder, acc_type));
+    mean = shift + shifted_mean;
+  }
+  xla::XlaOp rstd = xla::Rsqrt(variance + eps_value);
+  xla::XlaOp output =
+      (rms ? x : x - BroadcastStat(mean, layout)) * BroadcastStat(rstd, layout);
+  if (weight) {
+    output = output * BroadcastAffine(
+                          xla::ConvertElementType(*weight, acc_type), layout);
+  }
+  if (bias) {
+    output = output +
+             BroadcastAffine(xla::ConvertElementType(*bias, acc_type), layout);
+  }
+  return {xla::ConvertElementType(output, input_shape.element_type()),
+          xla::Reshape(mean, layout.stat_sizes),
+          xla::Reshape(rstd, layout.stat_sizes)};
+}
+
+LayerNormGrads BuildLayerNormBackward(xla::XlaOp grad, xla::XlaOp input,
+                                      xla::XlaOp mean, xla::XlaOp rstd,
+                                      const absl::optional<xla::XlaOp>& weight,
+                                      int64_t normalized_ndim, bool rms) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  NormLayout layout = GetNormLayout(input_shape, normalized_ndim);
+  xla::PrimitiveType acc_type =
+      GetAccumulationType(input_shape.element_type());
+  xla::XlaBuilder* builder = input.builder();
+  xla::XlaOp x = xla::ConvertElementType(input, acc_type);
+  xla::XlaOp grad_output = xla::ConvertElementType(grad, acc_type);
+  xla::XlaOp rstd_rows = BroadcastStat(
+      xla::Reshape(xla::ConvertElementType(rstd, acc_type), layout.outer_sizes),
+      layout);
+  xla::XlaOp normalized =
+      rms ? x * rstd_rows
+          : (x - BroadcastStat(
+                     xla::Reshape(xla::ConvertElementType(mean, acc_type),
+                                  layout.outer_sizes),
+                     layout)) *
+                rstd_rows;
+  xla::XlaOp grad_normalized = grad_output;
+  if (weight) {
+    grad_normalized =
+        grad_normalized *
+        BroadcastAffine(xla::ConvertElementType(*weight, acc_type), layout);
+  }
+  xla::XlaOp row_size =
+      XlaHelpers::ScalarValue<int64_t>(layout.row_size, acc_type, builder);
+
+  LayerNormGrads grads;
+  if (rms) {
+    xla::XlaOp projection =
+        xla::Reduce(grad_normalized * normalized, xla::Zero(builder, acc_type),
+                    XlaHelpers::CreateAddComputation(acc_type),
+                    layout.normalized_dims) /
+        row_size;
+    grads.grad_input =
+        rstd_rows *
+        (grad_normalized - normalized * BroadcastStat(projection, layout));
+  } else {
+    std::pair<xla::XlaOp, xla::XlaOp> sums = BuildPairSum(
+        grad_normalized, grad_normalized * normalized, layout.normalized_dims);
+    xla::XlaOp grad_mean = BroadcastStat(sums.first / row_size, layout);
+    xla::XlaOp projection = BroadcastStat(sums.second / row_size, layout);
+    grads.grad_input =
+        rstd_rows * (grad_normalized - grad_mean - normalized * projection);
+  }
+  std::pair<xla::XlaOp, xla::XlaOp> affine_sums =
+      BuildPairSum(grad_output * normalized, grad_output, layout.outer_dims);
+  // The affine parameters can be kept in higher precision than the input.
+  xla::PrimitiveType affine_type = weight ? XlaHelpers::TypeOfXlaOp(*weight)
+                                          : input_shape.element_type();
+  grads.grad_input =
+      xla::ConvertElementType(grads.grad_input, input_shape.element_type());
+  grads.grad_weight = xla::ConvertElementType(affine_sums.first, affine_type);
+  grads.grad_bias = xla::ConvertElementType(affine_sums.second, affine_type);
+  return grads;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+struct LayerNormOutput {
+  xla::XlaOp output;
+  // The mean and the inverse standard deviation of the normalized rows, with
+  // the shape of the input, with the normalized dimensions of size 1. They
+  // are F32 for reduced precision inputs, and the mean is zero for the RMS
+  // normalization.
+  xla::XlaOp mean;
+  xla::XlaOp rstd;
+};
+
+struct LayerNormGrads {
+  xla::XlaOp grad_input;
+  xla::XlaOp grad_weight;
+  xla::XlaOp grad_bias;
+};
+
+// Normalizes the last normalized_ndim dimensions of the input, with the mean
+// and variance of every row computed by a single reduction pass. If rms is
+// true, the rows are only scaled by their root mean square.
+LayerNormOutput BuildLayerNorm(xla::XlaOp input,
+                               const absl::optional<xla::XlaOp>& weight,
+                               const absl::optional<xla::XlaOp>& bias,
+                               int64_t normalized_ndim, double eps, bool rms);
+
+// The gradients of BuildLayerNorm(), out of the saved mean and rstd. Both the
+// row reductions of the input gradient, and the column reductions of the
+// weight and bias gradients, are single passes.
+LayerNormGrads BuildLayerNormBackward(xla::XlaOp grad, xla::XlaOp input,
+                                      xla::XlaOp mean, xla::XlaOp rstd,
+                                      const absl::optional<xla::XlaOp>& weight,
+                                      int64_t normalized_ndim, bool rms);
+
+}  // namespace torch_xla
@@ -0,0 +1,204 @@
+#include "torch_xla/csrc/layout_autotuner.h"
+
+#include <ATen/Functions.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/core/platform/env.h"
+#include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace {
+
+constexpr int kBenchmarkRuns = 5;
+
+struct AutotunerState {
+  std::mutex lock;
+  // The relayout copies by shape, until the shape gets tuned, at which point
+  // it is set to -1.
+  std::unordered_map<std::string, int64_t> copies;
+  size_t num_tuned = 0;
+};
+
+AutotunerState* GetAutotunerState() {
+  static AutotunerState* state = new AutotunerState();
+  return state;
+}
+
+std::string GetLayoutsFile() {
+  return xla::sys_util::GetEnvString("XLA_LAYOUTS_FILE", "");
+}
+
+xla::XlaComputation BuildBenchmark(const xla::Shape& shape) {
+  xla::XlaBuilder builder("LayoutBenchmark");
+  xla::XlaOp input = xla::Parameter(&builder, 0, shape, "input");
+  // An element-wise computation reduced to a scalar, so that the result
+  // transfers cost nothing.
+  xla::XlaOp result = input * input + input;
+  result = xla::ReduceAll(
+      result, xla::Zero(&builder, shape.element_type()),
+      XlaHelpers::CreateAddComputation(shape.element_type()));
+  return ConsumeValue(builder.Build(result));
+}
+
+// Returns the best time (in microseconds) over a few runs of the host
+// conversion, the upload and the element-wise computation, with the layout of
+// the given shape.
+double MeasureLayout(const torch::lazy::BackendDevice& device,
+                     const xla::Shape& shape) {
+  std::string device_str = device.toString();
+  xla::ComputationClient* client = xla::ComputationClient::Get();
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back({BuildBenchmark(shape), device_str,
+                       client->GetCompilationDevices(device_str, {}),
+                       nullptr});
+  std::shared_ptr<xla::ComputationClient::Computation> computation =
+      client->Compile(std::move(instances)).front();
+  at::Tensor tensor = at::zeros(
+      torch::lazy::ToVector<int64_t>(shape.dimensions()),
+      at::TensorOptions(TensorTypeFromXlaType(shape.element_type())));
+  xla::ComputationClient::ExecuteComputationOptions options;
+  double best_time = 0;
+  // The first run is a warm up.
+  for (int run = 0; run <= kBenchmarkRuns; ++run) {
+    auto start = std::chrono::steady_clock::now();
+    auto literal = std::make_shared<xla::Literal>(
+        GetTensorLiteral(tensor, &shape, &device));
+    auto populate_fn = [&](const xla::ComputationClient::TensorSource&,
+                           void* dest, size_t dest_size) {
+      std::memcpy(dest, literal->untyped_data(), dest_size);
+    };
+    std::vector<xla::ComputationClient::TensorSource> sources;
+    sources.emplace_back(shape, device_str, std::move(populate_fn));
+    std::vector<xla::ComputationClient::DataPtr> arguments =
+        client->TransferToServer(sources);
+    std::vector<xla::ComputationClient::DataPtr> results =
+        client->ExecuteComputation(*computation, arguments, device_str,
+                                   options);
+    client->TransferFromServer(results);
+    double time = std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    if (run == 1 || (run > 1 && time < best_time)) {
+      best_time = time;
+    }
+  }
+  return best_time;
+}
+
+// Replaces the line of the shape dimensions within the layouts file, keeping
+// the ones of the other shapes.
+void StoreLayout(const std::string& path, const xla::Shape& shape) {
+  std::string dimensions = absl::StrJoin(shape.dimensions(), ",");
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::string data;
+  std::vector<std::string> lines;
+  if (env->FileExists(path).ok() &&
+      tensorflow::ReadFileToString(env, path, &data).ok()) {
+    lines = absl::StrSplit(data, '\n', absl::SkipEmpty());
+  }
+  lines.erase(std::remove_if(lines.begin(), lines.end(),
+                             [&](const std::string& line) {
+                               return absl::StartsWith(
+                                   line, absl::StrCat(dimensions, "="));
+                             }),
+              lines.end());
+  lines.push_back(absl::StrCat(
+      dimensions, "=", absl::StrJoin(shape.layout().minor_to_major(), ",")));
+  // Written to a temporary file first, so that concurrent readers never see a
+  // partial file.
+  std::string tmp_path = absl::StrCat(path, ".tmp", env->NowMicros());
+  xla::Status status = tensorflow::WriteStringToFile(
+      env, tmp_path, absl::StrCat(absl::StrJoin(lines, "\n"), "\n"));
+  if (status.ok()) {
+    status = env->RenameFile(tmp_path, path);
+  }
+  if (!status.ok()) {
+    TF_LOG(WARNING) << "Unable to store the tuned layouts to " << path << ": "
+                    << status;
+  }
+}
+
+void Tune(const torch::lazy::BackendDevice& device,
+          const xla::Shape& device_shape) {
+  XLA_TIMED("LayoutAutotune");
+  xla::Shape row_major_shape = xla::ShapeUtil::MakeShapeWithDescendingLayout(
+      device_shape.element_type(), device_shape.dimensions());
+  double device_time = MeasureLayout(device, device_shape);
+  double row_major_time = MeasureLayout(device, row_major_shape);
+  const xla::Shape& best_shape =
+      row_major_time < device_time ? row_major_shape : device_shape;
+  TF_VLOG(1) << "Layout autotune of " << device_shape << " on " << device
+             << ": " << device_time << "us, " << row_major_shape << ": "
+             << row_major_time << "us";
+  StoreLayout(GetLayoutsFile(), best_shape);
+}
+
+}  // namespace
+
+bool LayoutAutotuner::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_LAYOUTS_AUTOTUNE", false) &&
+      !GetLayoutsFile().empty();
+  return enabled;
+}
+
+void LayoutAutotuner::RecordRelayout(const xla::Shape& device_shape) {
+  static const int64_t kMinCopies =
+      xla::sys_util::GetEnvInt("XLA_LAYOUTS_AUTOTUNE_MIN_COPIES", 16);
+  static const size_t kMaxShapes =
+      xla::sys_util::GetEnvInt("XLA_LAYOUTS_AUTOTUNE_SHAPES", 16);
+  if (device_shape.element_type() == xla::PrimitiveType::PRED) {
+    return;
+  }
+  AutotunerState* state = GetAutotunerState();
+  {
+    std::lock_guard<std::mutex> lock(state->lock);
+    int64_t& copies =
+        state->copies[xla::ShapeUtil::HumanStringWithLayout(device_shape)];
+    // The benchmark uploads go through the relayout copies as well, and land
+    // here once the shape is being tuned.
+    if (copies < 0 || ++copies < kMinCopies ||
+        state->num_tuned >= kMaxShapes) {
+      return;
+    }
+    copies = -1;
+    state->num_tuned += 1;
+  }
+  XLA_COUNTER("LayoutAutotuneShapes", 1);
+  torch::lazy::BackendDevice device = GetCurrentDevice();
+  auto tunefn = [device, device_shape]() {
+    try {
+      Tune(device, device_shape);
+    } catch (const std::exception& ex) {
+      TF_LOG(WARNING) << "Layout autotune of " << device_shape
+                      << " failed: " << ex.what();
+    }
+  };
+  xla::env::ScheduleIoClosure(std::move(tunefn));
+}
+
+}  // namespace torch_xla
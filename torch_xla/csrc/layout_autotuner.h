@@ -0,0 +1,27 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/shape.h"
+
+namespace torch_xla {
+
+// The LayoutAutotuner picks the device layouts of the array shapes whose host
+// transfers need relayout copies (the ones whose device layout differs from
+// the PyTorch row major one, both on the uploads and on the downloads of the
+// execution results). Once a shape has been relayed out
+// XLA_LAYOUTS_AUTOTUNE_MIN_COPIES times, a micro-benchmark on the current
+// device times its upload, and an element-wise computation over it, with both
+// layouts, and the winner is stored within the XLA_LAYOUTS_FILE file, which
+// the layout manager reads at startup. The layouts of the running process do
+// not change, as that would change the shapes of the live device data.
+class LayoutAutotuner {
+ public:
+  // Whether the autotuning mode is enabled (XLA_LAYOUTS_AUTOTUNE, with
+  // XLA_LAYOUTS_FILE set).
+  static bool IsEnabled();
+
+  // Records a relayout copy between the row major host layout and the
+  // device_shape one.
+  static void RecordRelayout(const xla::Shape& device_shape);
+};
+
+}  // namespace torch_xla
@@ -14,7 +14,9 @@
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/core/platform/env.h"
 #include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/conv_layout_planner.h"
 
 namespace torch_xla {
 namespace {
@@ -61,21 +63,37 @@ class LayoutManager {
     // Layouts: SHAPE=LAYOUT;...
     // SHAPE: INT,...
     // LAYOUT: INT,...
+    // The XLA_LAYOUTS_FILE file has one SHAPE=LAYOUT per line, and the
+    // XLA_LAYOUTS entries take precedence over its ones.
+    std::string layouts_file =
+        xla::sys_util::GetEnvString("XLA_LAYOUTS_FILE", "");
+    if (!layouts_file.empty()) {
+      std::string data;
+      tensorflow::Env* env = tensorflow::Env::Default();
+      if (env->FileExists(layouts_file).ok() &&
+          tensorflow::ReadFileToString(env, layouts_file, &data).ok()) {
+        AddLayouts(absl::StrSplit(data, '\n', absl::SkipEmpty()));
+      }
+    }
     std::string layouts_env = xla::sys_util::GetEnvString("XLA_LAYOUTS", "");
     if (!layouts_env.empty()) {
-      std::vector<std::string> layouts = absl::StrSplit(layouts_env, ';');
-      for (const auto& layout_str : layouts) {
-        std::vector<std::string> parts = absl::StrSplit(layout_str, '=');
-        XLA_CHECK_EQ(parts.size(), 2) << layout_str;
-
-        auto entry = std::make_shared<LayoutEntry>();
-        entry->dimensions = ParseIntList(parts[0]);
-        entry->layout = ParseLayout(parts[1], entry->dimensions.size());
-        layouts_.emplace(entry->dimensions, entry);
-
-        TF_VLOG(2) << "Registering layout " << parts[1] << " for shape "
-                   << parts[0];
-      }
+      AddLayouts(absl::StrSplit(layouts_env, ';'));
+    }
+  }
+
+  void AddLayouts(const std::vector<std::string>& layouts) {
+    for (const auto& layout_str : layouts) {
+      std::vector<std::string> parts = absl::StrSplit(layout_str, '=');
+      XLA_CHECK_EQ(parts.size(), 2) << layout_str;
+
+      auto entry = std::make_shared<LayoutEntry>();
+      entry->dimensions = ParseIntList(parts[0]);
+      entry->layout = ParseLayout(parts[1], entry->dimensions.size());
+      layouts_.erase(entry->dimensions);
+      layouts_.emplace(entry->dimensions, entry);
+
+      TF_VLOG(2) << "Registering layout " << parts[1] << " for shape "
+                 << parts[0];
     }
   }
 
@@ -181,6 +199,13 @@ xla::Shape MakeArrayShapeFromDimensions(
     return MakeShapeWithLayout(type, dimensions, dynamic_dimensions,
                                *layout_ptr);
   }
+  if (ConvLayoutPlanner::IsEnabled()) {
+    layout_ptr = ConvLayoutPlanner::GetLayout(dimensions, type, hw_type);
+    if (layout_ptr != nullptr) {
+      return MakeShapeWithLayout(type, dimensions, dynamic_dimensions,
+                                 *layout_ptr);
+    }
+  }
   if (dimensions.size() > 1 && hw_type == XlaDeviceType::TPU) {
     return MakeTpuShape(dimensions, dynamic_dimensions, type);
   }
@@ -8,10 +8,12 @@
 #include "absl/strings/str_replace.h"
 #include "absl/strings/string_view.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "torch/csrc/lazy/core/ir_metadata.h"
 #include "torch_xla/csrc/computation.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/host_trace.h"
 #include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
@@ -56,8 +58,10 @@ class HloMetadataSetter {
     }
     metadata.set_op_name(absl::StrCat(op_name_prefix, op_type));
 
-    if (!nmeta.frame_info.empty()) {
-      const torch::lazy::SourceLocation& frame = nmeta.frame_info.front();
+    const std::vector<torch::lazy::SourceLocation>& frame_info =
+        GetFrameInfo(node);
+    if (!frame_info.empty()) {
+      const torch::lazy::SourceLocation& frame = frame_info.front();
       std::string::size_type pos = frame.file.find_last_of('/');
       if (pos == std::string::npos) {
         pos = 0;
@@ -95,17 +99,29 @@ xla::XlaOp LoweringContext::GetParameter(
   torch::lazy::BackendData::Handle handle = data->GetHandle();
   auto it = parameters_map_.find(handle);
   if (it == parameters_map_.end()) {
-    xla::XlaOp param = xla::Parameter(builder(), parameters_.size(),
-                                      UnwrapXlaData(data)->shape(),
-                                      absl::StrCat("p", parameters_.size()));
+    xla::XlaOp param =
+        xla::Parameter(builder(), parameter_sources_.size(),
+                       UnwrapXlaData(data)->shape(),
+                       absl::StrCat("p", parameter_sources_.size()));
     it = parameters_map_.emplace(handle, Parameter{param, parameters_.size()})
              .first;
     parameters_.push_back(data);
+    parameter_sources_.push_back({data, torch::lazy::Output()});
   }
   parameter_sequence_.push_back(it->second.index);
   return it->second.param;
 }
 
+xla::XlaOp LoweringContext::AddOutputParameter(
+    const torch::lazy::Output& output, const xla::Shape& shape) {
+  xla::XlaOp param =
+      xla::Parameter(builder(), parameter_sources_.size(), shape,
+                     absl::StrCat("p", parameter_sources_.size()));
+  parameter_sources_.push_back({nullptr, output});
+  AssignOutputOp(output, param);
+  return param;
+}
+
 const std::vector<torch::lazy::BackendDataPtr>&
 LoweringContext::GetParametersData() const {
   return parameters_;
@@ -158,12 +174,17 @@ xla::XlaOp LoweringContext::GetOutputOp(const torch::lazy::Output& output) {
 }
 
 XlaOpVector LoweringContext::LowerNode(const torch::lazy::Node* node) {
+  XLA_TRACE_SCOPE(
+      [node]() { return absl::StrCat("LowerNode ", node->op().ToString()); });
   XlaOpVector result_ops;
   try {
     HloMetadataSetter meta_setter(this, node);
 
     const XlaNode* casted = dynamic_cast<const XlaNode*>(node);
-    result_ops = casted->Lower(this);
+    AutocastPolicy::Cast cast = AutocastPolicy::GetCast(node->op());
+    result_ops = cast == AutocastPolicy::Cast::kNone
+                     ? casted->Lower(this)
+                     : LowerWithCast(casted, cast);
   } catch (const std::exception& ex) {
     ReportBuilderError(node, ex.what());
   }
@@ -173,6 +194,44 @@ XlaOpVector LoweringContext::LowerNode(const torch::lazy::Node* node) {
   return result_ops;
 }
 
+XlaOpVector LoweringContext::LowerWithCast(const XlaNode* node,
+                                           AutocastPolicy::Cast cast) {
+  // The casts replace the operands only while lowering the node, the other
+  // users of the operands keep seeing their original types.
+  std::vector<std::pair<torch::lazy::Output, xla::XlaOp>> saved_operands;
+  for (const torch::lazy::Output& operand : node->operands()) {
+    xla::XlaOp op = GetOutputOp(operand);
+    const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(op);
+    if (!shape.IsArray()) {
+      continue;
+    }
+    xla::PrimitiveType type =
+        AutocastPolicy::GetCastType(cast, shape.element_type());
+    if (type != shape.element_type()) {
+      saved_operands.emplace_back(operand, op);
+      AssignOutputOp(operand, xla::ConvertElementType(op, type));
+    }
+  }
+  XlaOpVector result_ops = node->Lower(this);
+  for (auto& operand_op : saved_operands) {
+    AssignOutputOp(operand_op.first, operand_op.second);
+  }
+  if (saved_operands.empty()) {
+    return result_ops;
+  }
+  XLA_COUNTER("AutocastNodes", 1);
+  for (size_t i = 0; i < result_ops.size(); ++i) {
+    const xla::Shape& shape = node->xla_shape(i);
+    if (shape.IsArray() &&
+        XlaHelpers::TypeOfXlaOp(result_ops[i]) != shape.element_type()) {
+      result_ops[i] =
+          xla::ConvertElementType(result_ops[i], shape.element_type());
+      AssignOutputOp(torch::lazy::Output(node, i), result_ops[i]);
+    }
+  }
+  return result_ops;
+}
+
 void LoweringContext::ReportBuilderError(const torch::lazy::Node* node,
                                          const char* error_msg) {
   std::stringstream ss;
@@ -187,7 +246,7 @@ void LoweringContext::ReportBuilderError(const torch::lazy::Node* node,
   if (!nmeta.scope.empty()) {
     ss << "Scope: " << nmeta.scope << "\n";
   }
-  ss << nmeta.frame_info;
+  ss << GetFrameInfo(node);
   throw std::runtime_error(ss.str());
 }
 
@@ -217,6 +276,13 @@ size_t LoweringContext::AddResult(xla::XlaOp op) {
   return root_tuple_.size() - 1;
 }
 
+xla::XlaOp LoweringContext::GetOutfeedToken() {
+  if (!outfeed_token_.valid()) {
+    outfeed_token_ = xla::CreateToken(builder());
+  }
+  return outfeed_token_;
+}
+
 void LoweringContext::AddParameter(const torch::lazy::Output& output,
                                    size_t index,
                                    const torch::lazy::Shape& shape,
@@ -14,6 +14,7 @@
 #include "torch/csrc/lazy/backend/backend_data.h"
 #include "torch/csrc/lazy/backend/lowering_context.h"
 #include "torch/csrc/lazy/core/ir_util.h"
+#include "torch_xla/csrc/autocast_policy.h"
 #include "torch_xla/csrc/device.h"
 #include "torch_xla/csrc/ir.h"
 #include "torch_xla/csrc/ir_util.h"
@@ -38,10 +39,29 @@ class LoweringContext : public torch::lazy::LoweringContext {
   xla::XlaOp GetParameter(
       const std::shared_ptr<torch::lazy::BackendData>& data);
 
+  // Declares a parameter standing for an output lowered by another lowering
+  // context, and assigns it to the output. Used when sub-graphs get lowered
+  // into their own computations.
+  xla::XlaOp AddOutputParameter(const torch::lazy::Output& output,
+                                const xla::Shape& shape);
+
   // Retrieves the vector holding all the tensors associated with the parameter
   // instructions which have been created.
   const std::vector<torch::lazy::BackendDataPtr>& GetParametersData() const;
 
+  // What feeds an XLA parameter of the computation: either device data, or
+  // (if data is nullptr) an output declared with AddOutputParameter().
+  struct ParameterSource {
+    torch::lazy::BackendDataPtr data;
+    torch::lazy::Output output;
+  };
+
+  // Retrieves the sources of all the XLA parameters, in parameter number
+  // order.
+  const std::vector<ParameterSource>& GetParameterSources() const {
+    return parameter_sources_;
+  }
+
   const std::vector<size_t>& GetParameterSequence() const;
 
   xla::XlaOp GetResult(size_t index) const;
@@ -93,12 +113,23 @@ class LoweringContext : public torch::lazy::LoweringContext {
     return emitted_outputs_;
   }
 
+  // Returns the token chaining the outfeeds of the computation, so that the
+  // device emits them in lowering order. The outfeed emitting nodes must store
+  // their new token back with SetOutfeedToken().
+  xla::XlaOp GetOutfeedToken();
+
+  void SetOutfeedToken(xla::XlaOp token) { outfeed_token_ = token; }
+
  private:
   struct Parameter {
     xla::XlaOp param;
     size_t index = 0;
   };
 
+  // Lowers the node with its operands cast as the autocast policy requires,
+  // and its results cast back to the types of the node outputs.
+  XlaOpVector LowerWithCast(const XlaNode* node, AutocastPolicy::Cast cast);
+
   // Reports an XLA builder error for the given node.
   TF_ATTRIBUTE_NORETURN void ReportBuilderError(const torch::lazy::Node* node,
                                                 const char* error_msg);
@@ -106,8 +137,10 @@ class LoweringContext : public torch::lazy::LoweringContext {
   xla::XlaBuilder builder_;
   std::unordered_map<torch::lazy::BackendData::Handle, Parameter>
       parameters_map_;
+  std::vector<ParameterSource> parameter_sources_;
   std::vector<xla::XlaOp> root_tuple_;
   OutputMap<xla::XlaOp> emitted_outputs_;
+  xla::XlaOp outfeed_token_;
 };  // namespace torch_xla
 
 }  // namespace torch_xla
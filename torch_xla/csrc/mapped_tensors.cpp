@@ -0,0 +1,119 @@
+#include "torch_xla/csrc/mapped_tensors.h"
+
+#include <ATen/Functions.h>
+#include <c10/util/accumulate.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "torch_xla/csrc/tensor_util.h"
+
+namespace torch_xla {
+namespace {
+
+class MappedFile {
+ public:
+  explicit MappedFile(const std::string& path) {
+    fd_ = open(path.c_str(), O_RDONLY);
+    XLA_CHECK_GE(fd_, 0) << "Unable to open " << path << ": "
+                         << std::strerror(errno);
+    struct stat st;
+    XLA_CHECK_EQ(fstat(fd_, &st), 0)
+        << "Unable to stat " << path << ": " << std::strerror(errno);
+    size_ = st.st_size;
+    if (size_ > 0) {
+      void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+      XLA_CHECK(data != MAP_FAILED)
+          << "Unable to map " << path << ": " << std::strerror(errno);
+      data_ = reinterpret_cast<char*>(data);
+    }
+  }
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+    close(fd_);
+  }
+
+  char* data() const { return data_; }
+
+  size_t size() const { return size_; }
+
+  // Tells the kernel we are done with the given range of the mapping, so that
+  // its pages can be dropped right away.
+  void Release(size_t start, size_t end) {
+    static const size_t page_size = sysconf(_SC_PAGESIZE);
+    start = start / page_size * page_size;
+    if (end > start) {
+      madvise(data_ + start, end - start, MADV_DONTNEED);
+    }
+  }
+
+ private:
+  int fd_ = -1;
+  char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+}  // namespace
+
+std::vector<torch::lazy::BackendDataPtr> LoadMappedTensorsData(
+    const std::string& path, absl::Span<const MappedTensorInfo> infos,
+    const std::vector<std::string>& devices) {
+  XLA_TIMED("LoadMappedTensors");
+  XLA_CHECK_EQ(infos.size(), devices.size());
+  static const size_t shard_bytes = xla::sys_util::GetEnvInt(
+      "XLA_MAPPED_LOAD_SHARD_BYTES", static_cast<int64_t>(1) << 30);
+  MappedFile file(path);
+  std::vector<torch::lazy::BackendDataPtr> datas;
+  datas.reserve(infos.size());
+  size_t index = 0;
+  while (index < infos.size()) {
+    std::vector<at::Tensor> tensors;
+    std::vector<std::string> shard_devices;
+    size_t shard_size = 0;
+    size_t shard_start = file.size();
+    size_t shard_end = 0;
+    for (; index < infos.size(); ++index) {
+      if (!tensors.empty() && shard_size >= shard_bytes) {
+        break;
+      }
+      const MappedTensorInfo& info = infos[index];
+      size_t size = c10::multiply_integers(info.sizes) *
+                    c10::elementSize(info.scalar_type);
+      XLA_CHECK(info.offset >= 0 && info.offset + size <= file.size())
+          << "Tensor at offset " << info.offset << " with " << size
+          << " bytes is beyond the end of " << path;
+      at::Tensor tensor = at::from_blob(file.data() + info.offset, info.sizes,
+                                        at::TensorOptions(info.scalar_type));
+      shard_size += size;
+      shard_start = std::min<size_t>(shard_start, info.offset);
+      shard_end = std::max<size_t>(shard_end, info.offset + size);
+      tensors.push_back(std::move(tensor));
+      shard_devices.push_back(devices[index]);
+    }
+    TF_VLOG(3) << "Loading " << tensors.size() << " tensors (" << shard_size
+               << " bytes) from " << path;
+    std::vector<torch::lazy::BackendDataPtr> shard_datas =
+        CreateTensorsData(tensors, shard_devices);
+    XLA_VALUE_METRIC("MappedTensorsLoadBytes", shard_size);
+    for (auto& data : shard_datas) {
+      datas.push_back(std::move(data));
+    }
+    tensors.clear();
+    file.Release(shard_start, shard_end);
+  }
+  return datas;
+}
+
+}  // namespace torch_xla
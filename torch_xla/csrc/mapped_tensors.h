@@ -0,0 +1,29 @@
+#pragma once
+
+#include <ATen/Tensor.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "torch/csrc/lazy/backend/backend_data.h"
+
+namespace torch_xla {
+
+// Describes a tensor stored within a file, with dense row major layout.
+struct MappedTensorInfo {
+  int64_t offset = 0;
+  at::ScalarType scalar_type = at::ScalarType::Float;
+  std::vector<int64_t> sizes;
+};
+
+// Uploads the tensors stored within the file at path to the given devices,
+// reading them straight from a memory mapping of the file, instead of loading
+// them into CPU tensors first. The tensors are uploaded in shards of at most
+// XLA_MAPPED_LOAD_SHARD_BYTES bytes, whose pages are dropped once uploaded, so
+// that the host memory usage stays bounded independently of the file size.
+std::vector<torch::lazy::BackendDataPtr> LoadMappedTensorsData(
+    const std::string& path, absl::Span<const MappedTensorInfo> infos,
+    const std::vector<std::string>& devices);
+
+}  // namespace torch_xla
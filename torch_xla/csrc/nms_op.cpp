@@ -1,5 +1,6 @@
 #include "torch_xla/csrc/nms_op.h"
 
+#include <algorithm>
 #include <limits>
 
 #include "tensorflow/compiler/xla/client/lib/arithmetic.h"
@@ -9,82 +10,115 @@
 #include "tensorflow/compiler/xla/client/lib/sorting.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch/csrc/lazy/core/util.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/reduction.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 
-// Code extracted from:
+// Originally based on:
 // https://github.com/tensorflow/tensorflow/blob/dc4c6d305ba3d2de4a795ec77b483b0fa695b9ee/tensorflow/compiler/tf2xla/kernels/image_ops.cc#L399
+// with the suppression now processing the sorted boxes in tiles.
 
 namespace torch_xla {
 namespace {
 
-struct WhileCondFn {
-  WhileCondFn(int64_t num_boxes, int64_t output_size)
-      : num_boxes(num_boxes), output_size(output_size) {}
-
-  xla::StatusOr<xla::XlaOp> operator()(absl::Span<const xla::XlaOp> values,
-                                       xla::XlaBuilder* builder) const {
-    xla::XlaOp row_idx = values[0];
-    xla::XlaOp row_in_bounds =
-        xla::Lt(row_idx, xla::ConstantR0<int32_t>(builder, num_boxes));
-    xla::XlaOp num_outputs_so_far = values[1];
-    xla::XlaOp results_not_full = xla::Lt(
-        num_outputs_so_far, xla::ConstantR0<int32_t>(builder, output_size));
-    return xla::And(row_in_bounds, results_not_full);
-  }
+// The sorted boxes are processed in tiles of this size, so that the IoU
+// matrices never exceed [num_boxes, tile_size].
+int64_t GetNmsTileSize() {
+  static const int64_t tile_size =
+      xla::sys_util::GetEnvInt("XLA_NMS_TILE_SIZE", 512);
+  XLA_CHECK_GT(tile_size, 0);
+  return tile_size;
+}
 
-  int64_t num_boxes;
-  int64_t output_size;
-};
+xla::XlaOp BoxCoordinate(xla::XlaOp boxes, int64_t index) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(boxes);
+  return xla::Reshape(xla::SliceInDim(boxes, /*start_index=*/index,
+                                      /*limit_index=*/index + 1,
+                                      /*stride=*/1, /*dimno=*/0),
+                      {shape.dimensions(1)});
+}
 
-// Process the boxes one-by-one using the iou matrix mask.
-// This implementation uses a correct, but greedy, sequential algorithm
-// to ensure that suppressed boxes cannot themselves suppress other
-// boxes.
-struct SuppressBodyFn {
-  explicit SuppressBodyFn(int64_t num_boxes) : num_boxes(num_boxes) {}
+// Computes the [rows, cols] IoU matrix between two sets of boxes, given as
+// [4, rows] and [4, cols] coordinates in the (y_min, x_min, y_max, x_max)
+// form. Boxes with no area have zero IoU with any other box.
+xla::XlaOp BuildIou(xla::XlaOp row_boxes, xla::XlaOp col_boxes) {
+  int64_t rows = XlaHelpers::ShapeOfXlaOp(row_boxes).dimensions(1);
+  int64_t cols = XlaHelpers::ShapeOfXlaOp(col_boxes).dimensions(1);
+  auto row_coordinate = [&](int64_t index) {
+    return xla::BroadcastInDim(BoxCoordinate(row_boxes, index), {rows, cols},
+                               {0});
+  };
+  auto col_coordinate = [&](int64_t index) {
+    return xla::BroadcastInDim(BoxCoordinate(col_boxes, index), {rows, cols},
+                               {1});
+  };
+  xla::XlaOp row_ymin = row_coordinate(0);
+  xla::XlaOp row_xmin = row_coordinate(1);
+  xla::XlaOp row_ymax = row_coordinate(2);
+  xla::XlaOp row_xmax = row_coordinate(3);
+  xla::XlaOp col_ymin = col_coordinate(0);
+  xla::XlaOp col_xmin = col_coordinate(1);
+  xla::XlaOp col_ymax = col_coordinate(2);
+  xla::XlaOp col_xmax = col_coordinate(3);
+  xla::XlaOp zero = xla::ZerosLike(row_ymin);
+  xla::XlaOp i_area =
+      xla::Max(xla::Min(row_ymax, col_ymax) - xla::Max(row_ymin, col_ymin),
+               zero) *
+      xla::Max(xla::Min(row_xmax, col_xmax) - xla::Max(row_xmin, col_xmin),
+               zero);
+  xla::XlaOp u_area = (row_ymax - row_ymin) * (row_xmax - row_xmin) +
+                      (col_ymax - col_ymin) * (col_xmax - col_xmin) - i_area;
+  return xla::Select(xla::Gt(u_area, zero), i_area / u_area, zero);
+}
 
-  xla::StatusOr<std::vector<xla::XlaOp>> operator()(
-      absl::Span<const xla::XlaOp> values, xla::XlaBuilder* builder) const {
-    xla::XlaOp row_idx = values[0];
-    xla::XlaOp num_outputs_so_far = values[1];
-    xla::XlaOp iou_mask = values[2];
-    xla::XlaOp included_iou = values[3];
-    xla::XlaOp zero = xla::Zero(builder, xla::PrimitiveType::S32);
-    xla::XlaOp one = xla::One(builder, xla::PrimitiveType::S32);
-    // Determine if current elem is active using a slice.
-    // The only reason we need an explicit vector is because some old GCCs can't
-    // deduce the right type for MakeConstSpan, and providing a single-value
-    // initializer list directly uses the wrong overload. Delete this once the
-    // deprecated overload is gone.
-    std::vector<xla::XlaOp> row_idx_vector = {row_idx};
-    xla::XlaOp active_elem =
-        xla::DynamicSlice(included_iou, row_idx_vector, {1});
-    active_elem = xla::Reshape(active_elem, {});
-    // Increment output count iff current elem is not suppressed.
-    num_outputs_so_far =
-        xla::Select(active_elem, num_outputs_so_far + one, num_outputs_so_far);
-    // Slice out the row_idx.
-    xla::XlaOp row_iou =
-        xla::DynamicSlice(iou_mask, {row_idx, zero}, {1, num_boxes});
-    // Remove the diagonal from consideration. An elem cannot suppress
-    // itself.
-    row_iou = xla::DynamicUpdateSlice(
-        row_iou, xla::ConstantR2FromArray2D<bool>(builder, {{false}}),
-        {zero, row_idx});
-    // Create a suppression by inverting polarity.
-    row_iou = xla::Reshape(row_iou, {num_boxes});
-    xla::XlaOp supp_mask = xla::Not(row_iou);
-    // Update mask iff current elem is not suppressed.
-    included_iou = xla::Select(xla::Broadcast(active_elem, {num_boxes}),
-                               xla::And(included_iou, supp_mask), included_iou);
-    return std::vector<xla::XlaOp>{row_idx + one, num_outputs_so_far, iou_mask,
-                                   included_iou};
-  }
+// Whether the IoU between the row and col boxes exceeds the threshold.
+xla::XlaOp BuildOverlaps(xla::XlaOp row_boxes, xla::XlaOp col_boxes,
+                         xla::XlaOp iou_threshold) {
+  xla::XlaOp iou = BuildIou(row_boxes, col_boxes);
+  return xla::Gt(
+      iou, xla::Broadcast(
+               xla::ConvertElementType(iou_threshold,
+                                       XlaHelpers::TypeOfXlaOp(iou)),
+               XlaHelpers::SizesOfXlaOp(iou)));
+}
 
-  int64_t num_boxes;
-};
+// Suppresses the boxes of a tile overlapping with a kept box of higher score
+// within the same tile. The overlaps are the [tile, tile] IoU mask of the
+// tile, restricted to its upper triangle (row box scoring higher than the col
+// one). The sequential greedy selection is computed as the fixed point of
+// keep[j] = initial_keep[j] && !any_i(overlaps[i][j] && keep[i]), which is
+// reached in at most tile iterations (usually a few), each being a vectorized
+// [tile, tile] reduction.
+xla::XlaOp BuildTileSelfSuppression(xla::XlaOp initial_keep,
+                                    xla::XlaOp overlaps) {
+  int64_t tile_size = XlaHelpers::ShapeOfXlaOp(initial_keep).dimensions(0);
+  auto cond_fn = [&](absl::Span<const xla::XlaOp> init,
+                     xla::XlaBuilder* builder) -> xla::StatusOr<xla::XlaOp> {
+    return init[2];
+  };
+  auto body_fn =
+      [&](absl::Span<const xla::XlaOp> init,
+          xla::XlaBuilder* builder) -> xla::StatusOr<std::vector<xla::XlaOp>> {
+    xla::XlaOp suppressed = BuildAny(
+        xla::And(init[3], xla::BroadcastInDim(init[1], {tile_size, tile_size},
+                                              {0})),
+        {0}, /*keep_reduced_dimensions=*/false);
+    xla::XlaOp keep = xla::And(init[0], xla::Not(suppressed));
+    xla::XlaOp changed = BuildAny(xla::Ne(keep, init[1]), {0},
+                                  /*keep_reduced_dimensions=*/false);
+    return std::vector<xla::XlaOp>{init[0], keep, changed, init[3]};
+  };
+  xla::XlaBuilder* builder = initial_keep.builder();
+  std::vector<xla::XlaOp> results = ConsumeValue(xla::WhileLoopHelper(
+      cond_fn, body_fn,
+      {initial_keep, initial_keep, xla::ConstantR0<bool>(builder, true),
+       overlaps},
+      "NmsTileSelfSuppression", builder));
+  return results[1];
+}
 
 xla::XlaOp NmsGather(xla::XlaOp input, absl::Span<const int64_t> input_sizes,
                      xla::XlaOp indices,
@@ -159,139 +193,205 @@ NmsResult BuildNms(xla::XlaOp boxes, xla::XlaOp scores,
   XLA_CHECK_EQ(scores_shape.dimensions(0), num_boxes);
   XLA_CHECK_LT(num_boxes, std::numeric_limits<int32_t>::max());
   XLA_CHECK_GE(output_size, 0);
-  XLA_CHECK_LT(output_size, std::numeric_limits<int32_t>::max());
+  XLA_CHECK_LE(output_size, num_boxes);
 
   xla::XlaBuilder* builder = boxes.builder();
-  // Choose a more convenient layout.
-  xla::XlaOp boxes_transposed = xla::Transpose(boxes, {1, 0});
-  xla::XlaOp boxes_sorted = xla::GetTupleElement(
-      xla::Sort({xla::Broadcast(scores, {4}), boxes_transposed},
-                xla::CreateScalarGtComputation(
-                    {scores_shape.element_type(), boxes_shape.element_type()},
-                    builder),
-                /*dimension=*/1),
-      1);
-  // Track the mapping of indices into sorted domain.
+  absl::optional<xla::XlaOp> dynamic_size;
+  if (boxes_shape.is_dynamic_dimension(0)) {
+    // The boxes past the actual size get excluded from the selection, and the
+    // computation continues with the bounded shapes.
+    dynamic_size = XlaHelpers::GetDimensionsSize({boxes}, {0}).size;
+    boxes = xla::RemoveDynamicDimension(boxes, 0);
+  }
+  if (scores_shape.is_dynamic_dimension(0)) {
+    scores = xla::RemoveDynamicDimension(scores, 0);
+  }
+
+  // A single sort of the scores carrying the box indices, the boxes being then
+  // gathered in the sorted order.
   xla::XlaOp iota_indices =
       xla::Iota(builder, xla::PrimitiveType::S32, num_boxes);
   xla::XlaOp indices_sort = xla::Sort(
       {scores, iota_indices},
       xla::CreateScalarGtComputation(
           {scores_shape.element_type(), xla::PrimitiveType::S32}, builder));
-  xla::XlaOp indices_sorted = xla::GetTupleElement(indices_sort, 1);
   xla::XlaOp scores_sorted = xla::GetTupleElement(indices_sort, 0);
+  xla::XlaOp indices_sorted = xla::GetTupleElement(indices_sort, 1);
+  // Shape is [4, num_boxes], in sorted order.
+  xla::XlaOp boxes_sorted = xla::Transpose(
+      NmsGather(boxes, {num_boxes, 4}, indices_sorted, {num_boxes}, /*axis=*/0),
+      {1, 0});
 
-  // Shapes are henceforth [1, num_boxes]. 'c_y0' denotes 'coordinate' y0.
-  xla::XlaOp c_y0 = xla::Reshape(xla::SliceInDim(boxes_sorted,
-                                                 /*start_index=*/0,
-                                                 /*limit_index=*/1,
-                                                 /*stride=*/1,
-                                                 /*dimno=*/0),
-                                 {num_boxes});
-  xla::XlaOp c_x0 = xla::Reshape(xla::SliceInDim(boxes_sorted,
-                                                 /*start_index=*/1,
-                                                 /*limit_index=*/2,
-                                                 /*stride=*/1,
-                                                 /*dimno=*/0),
-                                 {num_boxes});
-  xla::XlaOp c_y1 = xla::Reshape(xla::SliceInDim(boxes_sorted,
-                                                 /*start_index=*/2,
-                                                 /*limit_index=*/3,
-                                                 /*stride=*/1,
-                                                 /*dimno=*/0),
-                                 {num_boxes});
-  xla::XlaOp c_x1 = xla::Reshape(xla::SliceInDim(boxes_sorted,
-                                                 /*start_index=*/3,
-                                                 /*limit_index=*/4,
-                                                 /*stride=*/1,
-                                                 /*dimno=*/0),
-                                 {num_boxes});
-
-  xla::XlaOp y1 = xla::Select(xla::Le(c_y0, c_y1), c_y0, c_y1);
-  xla::XlaOp y2 = xla::Select(xla::Le(c_y0, c_y1), c_y1, c_y0);
-  xla::XlaOp x1 = xla::Select(xla::Le(c_x0, c_x1), c_x0, c_x1);
-  xla::XlaOp x2 = xla::Select(xla::Le(c_x0, c_x1), c_x1, c_x0);
-  xla::XlaOp area = (y2 - y1) * (x2 - x1);
+  // Normalize the boxes to the (y_min, x_min, y_max, x_max) form, and pad
+  // them (with empty boxes which never get selected) to full tiles.
+  int64_t tile_size = std::min(GetNmsTileSize(),
+                               std::max<int64_t>(num_boxes, 1));
+  int64_t num_tiles = std::max<int64_t>((num_boxes + tile_size - 1) / tile_size,
+                                        1);
+  int64_t padded_size = num_tiles * tile_size;
+  xla::XlaOp c_y0 = BoxCoordinate(boxes_sorted, 0);
+  xla::XlaOp c_x0 = BoxCoordinate(boxes_sorted, 1);
+  xla::XlaOp c_y1 = BoxCoordinate(boxes_sorted, 2);
+  xla::XlaOp c_x1 = BoxCoordinate(boxes_sorted, 3);
+  xla::XlaOp padded_boxes = xla::PadInDim(
+      xla::ConcatInDim(builder,
+                       {xla::Broadcast(xla::Min(c_y0, c_y1), {1}),
+                        xla::Broadcast(xla::Min(c_x0, c_x1), {1}),
+                        xla::Broadcast(xla::Max(c_y0, c_y1), {1}),
+                        xla::Broadcast(xla::Max(c_x0, c_x1), {1})},
+                       0),
+      xla::Zero(builder, boxes_shape.element_type()), /*dimno=*/1,
+      /*pad_lo=*/0, /*pad_hi=*/padded_size - num_boxes);
 
-  // Shapes are henceforth [1, num_boxes].
-  y1 = xla::Broadcast(y1, {1});
-  y2 = xla::Broadcast(y2, {1});
-  x1 = xla::Broadcast(x1, {1});
-  x2 = xla::Broadcast(x2, {1});
-  area = xla::Broadcast(area, {1});
+  // The boxes below the score threshold can be excluded upfront, since sorted
+  // they can only suppress boxes which are below the threshold as well.
+  xla::XlaOp included = xla::Gt(
+      scores_sorted, xla::Broadcast(xla::ConvertElementType(
+                                        score_threshold,
+                                        scores_shape.element_type()),
+                                    {num_boxes}));
+  if (dynamic_size) {
+    included = xla::And(
+        included, xla::Lt(indices_sorted,
+                          xla::Broadcast(xla::ConvertElementType(
+                                             *dynamic_size,
+                                             xla::PrimitiveType::S32),
+                                         {num_boxes})));
+  }
+  xla::XlaOp initial_keep =
+      xla::PadInDim(included, xla::ConstantR0<bool>(builder, false),
+                    /*dimno=*/0, /*pad_lo=*/0,
+                    /*pad_hi=*/padded_size - num_boxes);
 
-  // Shapes are henceforth [num_boxes, num_boxes].
-  xla::XlaOp i_xmin = xla::Max(x1, xla::Transpose(x1, {1, 0}));
-  xla::XlaOp i_ymin = xla::Max(y1, xla::Transpose(y1, {1, 0}));
-  xla::XlaOp i_xmax = xla::Min(x2, xla::Transpose(x2, {1, 0}));
-  xla::XlaOp i_ymax = xla::Min(y2, xla::Transpose(y2, {1, 0}));
-  auto square_zero = xla::ZerosLike(i_xmin);
+  // Every tile is first suppressed by the boxes kept within all the previous
+  // tiles, with a single [padded_size, tile_size] IoU computation, and then by
+  // its own boxes. The loop stops once enough boxes have been selected.
+  auto cond_fn = [&](absl::Span<const xla::XlaOp> init,
+                     xla::XlaBuilder* builder) -> xla::StatusOr<xla::XlaOp> {
+    return xla::And(
+        xla::Lt(init[0], xla::ConstantR0<int32_t>(builder, num_tiles)),
+        xla::Lt(init[1], xla::ConstantR0<int32_t>(builder, output_size)));
+  };
+  auto body_fn =
+      [&](absl::Span<const xla::XlaOp> init,
+          xla::XlaBuilder* builder) -> xla::StatusOr<std::vector<xla::XlaOp>> {
+    xla::XlaOp all_boxes = init[2];
+    xla::XlaOp keep = init[3];
+    xla::XlaOp threshold = init[4];
+    xla::XlaOp zero = xla::Zero(builder, xla::PrimitiveType::S32);
+    xla::XlaOp start = init[0] * xla::ConstantR0<int32_t>(builder, tile_size);
+    xla::XlaOp tile_boxes =
+        xla::DynamicSlice(all_boxes, {zero, start}, {4, tile_size});
+    xla::XlaOp tile_keep = xla::DynamicSlice(keep, {start}, {tile_size});
 
-  xla::XlaOp i_area = xla::Max(i_xmax - i_xmin, square_zero) *
-                      xla::Max(i_ymax - i_ymin, square_zero);
-  xla::XlaOp u_area = area + xla::Transpose(area, {1, 0}) - i_area;
-  xla::XlaOp iou = i_area / u_area;
+    xla::XlaOp previous_keep = xla::And(
+        keep, xla::Lt(xla::Iota(builder, xla::PrimitiveType::S32, padded_size),
+                      xla::Broadcast(start, {padded_size})));
+    xla::XlaOp suppressed = BuildAny(
+        xla::And(BuildOverlaps(all_boxes, tile_boxes, threshold),
+                 xla::BroadcastInDim(previous_keep, {padded_size, tile_size},
+                                     {0})),
+        {0}, /*keep_reduced_dimensions=*/false);
+    tile_keep = xla::And(tile_keep, xla::Not(suppressed));
 
-  xla::XlaOp iou_threshold_mask = xla::Gt(iou, iou_threshold + square_zero);
-  xla::XlaOp included_iou =
-      xla::Broadcast(xla::ConstantR0<bool>(builder, true), {num_boxes});
-  if (boxes_shape.is_dynamic_dimension(0)) {
-    // Update included_iou's size to match boxes actual size.
-    included_iou = xla::SetDimensionSize(
-        included_iou, XlaHelpers::GetDimensionsSize({boxes}, {0}).size, 0);
-  }
+    xla::XlaOp upper_triangle = xla::Lt(
+        xla::Iota(builder,
+                  xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                            {tile_size, tile_size}),
+                  0),
+        xla::Iota(builder,
+                  xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                            {tile_size, tile_size}),
+                  1));
+    tile_keep = BuildTileSelfSuppression(
+        tile_keep,
+        xla::And(BuildOverlaps(tile_boxes, tile_boxes, threshold),
+                 upper_triangle));
 
+    xla::XlaOp num_tile_kept = xla::Reduce(
+        xla::ConvertElementType(tile_keep, xla::PrimitiveType::S32), zero,
+        xla::CreateScalarAddComputation(xla::PrimitiveType::S32, builder),
+        {0});
+    return std::vector<xla::XlaOp>{
+        init[0] + xla::One(builder, xla::PrimitiveType::S32),
+        init[1] + num_tile_kept, all_boxes,
+        xla::DynamicUpdateSlice(keep, tile_keep, {start}), threshold};
+  };
   xla::XlaOp zero_s32 = xla::Zero(builder, xla::PrimitiveType::S32);
-  xla::XlaOp one_s32 = xla::One(builder, xla::PrimitiveType::S32);
-  std::vector<xla::XlaOp> init_values;
-  init_values.reserve(4);
-  init_values.push_back(zero_s32);  // col_idx
-  init_values.push_back(zero_s32);  // num_outputs
-  init_values.push_back(iou_threshold_mask);
-  init_values.push_back(included_iou);
-
-  auto suppress_loop_result = ConsumeValue(xla::WhileLoopHelper(
-      WhileCondFn(num_boxes, output_size), SuppressBodyFn(num_boxes),
-      init_values, "BoxSuppressLoop", builder));
+  std::vector<xla::XlaOp> loop_results = ConsumeValue(xla::WhileLoopHelper(
+      cond_fn, body_fn,
+      {zero_s32, zero_s32, padded_boxes, initial_keep, iou_threshold},
+      "NmsTileLoop", builder));
 
-  xla::XlaOp included_score =
-      xla::Gt(scores_sorted, xla::Broadcast(score_threshold, {num_boxes}));
-  xla::XlaOp included = xla::And(included_score, suppress_loop_result[3]);
+  // Only the boxes of the processed tiles are selected, as the others have not
+  // been checked for suppression.
+  xla::XlaOp padded_iota =
+      xla::Iota(builder, xla::PrimitiveType::S32, padded_size);
+  xla::XlaOp selected = xla::And(
+      loop_results[3],
+      xla::Lt(padded_iota,
+              xla::Broadcast(loop_results[0] *
+                                 xla::ConstantR0<int32_t>(builder, tile_size),
+                             {padded_size})));
 
-  // Only consider boxes over which we have iterated. This allows for accurate
-  // counting. DynamicSlice would require knowledge of the size of the output.
-  xla::XlaOp valid_elem = xla::Lt(
-      iota_indices, xla::Broadcast(suppress_loop_result[0], {num_boxes}));
-  included = xla::And(included, valid_elem);
-
-  xla::XlaOp neg_inf = xla::Broadcast(
-      xla::MinValue(builder, scores_shape.element_type()), {num_boxes});
-  xla::XlaOp scores_included = xla::Select(included, scores_sorted, neg_inf);
-  xla::XlaOp output_tuple = xla::TopK(scores_included, output_size);
-  xla::XlaOp selected_indices_sorted = xla::GetTupleElement(output_tuple, 1);
-  // Calculate num_valid.
-  // Note: num_valid cannot be taken from the loop outputs, because outputs
-  // can be suppressed by score threshold.
-  xla::XlaOp ones_included =
-      xla::Select(included, xla::Broadcast(one_s32, {num_boxes}),
-                  xla::Broadcast(zero_s32, {num_boxes}));
-  // num_valid is scalar. torch::lazy::Value should be bound by output_size.
-  xla::XlaOp num_valid_total = xla::Reduce(
-      ones_included,
-      /*init_value=*/zero_s32,
-      /*computation=*/
+  // Instead of a top-k, the selected boxes (already in score order) get ranked
+  // by a prefix sum, followed by the other ones in sorted order, and the
+  // sorted positions are scattered at their ranks.
+  xla::XlaOp selected_s32 =
+      xla::ConvertElementType(selected, xla::PrimitiveType::S32);
+  xla::XlaOp selected_prefix = BuildCumulativeComputation(
+      selected_s32, 0,
       xla::CreateScalarAddComputation(xla::PrimitiveType::S32, builder),
-      /*dimensions_to_reduce=*/{0});
+      zero_s32);
+  xla::XlaOp num_selected = xla::Reduce(
+      selected_s32, zero_s32,
+      xla::CreateScalarAddComputation(xla::PrimitiveType::S32, builder), {0});
+  xla::XlaOp one_s32 = xla::One(builder, xla::PrimitiveType::S32);
+  xla::XlaOp rank = xla::Select(
+      selected, selected_prefix - one_s32,
+      xla::Broadcast(num_selected, {padded_size}) + padded_iota -
+          selected_prefix);
+  xla::XlaOp ranked_positions = CreateIndexCopy(
+      xla::Broadcast(zero_s32, {padded_size}), 0, rank, padded_iota);
+  xla::XlaOp selected_positions =
+      xla::SliceInDim(ranked_positions, /*start_index=*/0,
+                      /*limit_index=*/output_size, /*stride=*/1, /*dimno=*/0);
   xla::XlaOp num_valid =
-      xla::Min(num_valid_total, xla::ConstantR0<int32_t>(builder, output_size));
+      xla::Min(num_selected, xla::ConstantR0<int32_t>(builder, output_size));
 
   // Re-index into the original scores input tensor, using a Gather.
   // Boxes were suppressed in the sorted domain.
   xla::XlaOp selected_indices =
-      NmsGather(indices_sorted, scores_shape.dimensions(),
-                selected_indices_sorted, {output_size},
-                /*axis=*/0);
+      NmsGather(indices_sorted, {num_boxes}, selected_positions,
+                {output_size}, /*axis=*/0);
   return {selected_indices, num_valid};
 }
 
+NmsResult BuildBatchedNms(xla::XlaOp boxes, xla::XlaOp scores,
+                          xla::XlaOp idxs, xla::XlaOp score_threshold,
+                          xla::XlaOp iou_threshold, int64_t output_size) {
+  const xla::Shape& boxes_shape = XlaHelpers::ShapeOfXlaOp(boxes);
+  XLA_CHECK_EQ(boxes_shape.rank(), 2);
+  XLA_CHECK_EQ(XlaHelpers::ShapeOfXlaOp(idxs).rank(), 1);
+  xla::PrimitiveType type = boxes_shape.element_type();
+  xla::XlaBuilder* builder = boxes.builder();
+  // Boxes of different groups are moved apart, by more than the extent of all
+  // the boxes, so that they never overlap. The IoU is translation invariant.
+  xla::XlaOp min_value =
+      xla::Reduce(boxes, xla::MaxValue(builder, type),
+                  XlaHelpers::CreateMinComputation(type), {0, 1});
+  xla::XlaOp max_value =
+      xla::Reduce(boxes, xla::MinValue(builder, type),
+                  XlaHelpers::CreateMaxComputation(type), {0, 1});
+  xla::XlaOp offsets =
+      xla::ConvertElementType(idxs, type) *
+      xla::Broadcast(max_value - min_value + xla::One(builder, type),
+                     XlaHelpers::SizesOfXlaOp(idxs));
+  xla::XlaOp shifted_boxes =
+      xla::Sub(boxes, xla::Broadcast(min_value, boxes_shape.dimensions())) +
+      xla::BroadcastInDim(offsets, boxes_shape.dimensions(), {0});
+  return BuildNms(shifted_boxes, scores, score_threshold, iou_threshold,
+                  output_size);
+}
+
 }  // namespace torch_xla
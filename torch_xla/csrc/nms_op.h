@@ -9,8 +9,18 @@ struct NmsResult {
   xla::XlaOp num_valid;
 };
 
+// Selects up to output_size boxes, in decreasing score order, skipping the
+// ones with a score not above score_threshold and the ones overlapping (with
+// an IoU above iou_threshold) a selected box of higher score. The remaining
+// entries of the selected indices list the other boxes, in score order.
 NmsResult BuildNms(xla::XlaOp boxes, xla::XlaOp scores,
                    xla::XlaOp score_threshold, xla::XlaOp iou_threshold,
                    int64_t output_size);
 
+// Same as BuildNms(), but boxes only suppress the boxes with the same index in
+// idxs (like the class, or a combined image and class index of the boxes).
+NmsResult BuildBatchedNms(xla::XlaOp boxes, xla::XlaOp scores,
+                          xla::XlaOp idxs, xla::XlaOp score_threshold,
+                          xla::XlaOp iou_threshold, int64_t output_size);
+
 }  // namespace torch_xla
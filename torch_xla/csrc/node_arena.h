@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "torch/csrc/lazy/core/ir.h"
+#include "torch_xla/csrc/host_object_pool.h"
+#include "torch_xla/csrc/host_trace.h"
+#include "torch_xla/csrc/step_breakdown.h"
+
+namespace torch_xla {
+
+// Same as torch::lazy::MakeNode(), but allocates the node (and its shared
+// pointer control block) from the host object pool, if enabled. Tracing a step
+// creates (and the following sync releases) the same set of nodes over and
+// over, so the pool recycles their memory for the nodes of the next steps.
+template <typename T, typename... Args>
+torch::lazy::NodePtr MakeXlaNode(Args&&... args) {
+  XLA_TRACE_SCOPE("MakeXlaNode");
+  XLA_STEP_PHASE(kTracing);
+  if (!host_pool::IsEnabled()) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+  return host_pool::MakeShared<T>(std::forward<Args>(args)...);
+}
+
+}  // namespace torch_xla
@@ -7,7 +7,9 @@
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 #include "torch/csrc/lazy/core/hash.h"
 #include "torch/csrc/lazy/core/ir_util.h"
@@ -15,6 +17,7 @@
 #include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/lowering_context.h"
 #include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/persistent_cache.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
 
@@ -80,10 +83,81 @@ torch::lazy::hash_t GetNodesKeySeed(const std::string& device,
   return torch::lazy::MHash(device, torch::lazy::Hash(devices));
 }
 
+torch::lazy::hash_t GetPersistentCacheKey(const torch::lazy::hash_t& key) {
+  // Keeps the single op entries apart from the whole graph ones.
+  static const torch::lazy::hash_t kOpByOpSeed =
+      torch::lazy::MHash(std::string("OpByOp"));
+  return torch::lazy::HashCombine(kOpByOpSeed, key);
+}
+
+// Returns the computations for the op cache keys, loading them from the
+// persistent cache (in parallel) when enabled, and compiling the missing ones
+// with a single Compile() call, which compiles the instances in parallel.
+std::vector<PersistentCache::ComputationPtr> CompileOps(
+    absl::Span<const torch::lazy::hash_t> cache_keys,
+    std::vector<xla::ComputationClient::CompileInstance> instances,
+    const std::string& device) {
+  std::vector<PersistentCache::ComputationPtr> computations(instances.size());
+  PersistentCache* persistent_cache = PersistentCache::Get();
+  if (persistent_cache != nullptr) {
+    auto mwait = std::make_shared<xla::util::MultiWait>(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i) {
+      auto loader = [&, i]() {
+        computations[i] =
+            persistent_cache->Load(GetPersistentCacheKey(cache_keys[i]));
+      };
+      xla::env::ScheduleIoClosure(
+          xla::util::MultiWait::Completer(mwait, std::move(loader)));
+    }
+    mwait->Wait();
+  }
+  std::vector<size_t> missing;
+  std::vector<xla::ComputationClient::CompileInstance> compile_instances;
+  for (size_t i = 0; i < instances.size(); ++i) {
+    if (computations[i] == nullptr) {
+      missing.push_back(i);
+      compile_instances.push_back(std::move(instances[i]));
+    }
+  }
+  if (missing.size() < instances.size()) {
+    XLA_COUNTER("OpByOpPersistentCacheHit", instances.size() - missing.size());
+  }
+  if (missing.empty()) {
+    return computations;
+  }
+  bool compiled = false;
+  xla::util::ExceptionCleanup compile_exit(
+      [&](xla::util::ExceptionCleanup::StatusType status) {
+        if (!compiled && persistent_cache != nullptr) {
+          // Let other processes waiting on these ops compile them.
+          for (auto index : missing) {
+            persistent_cache->ReleaseLease(
+                GetPersistentCacheKey(cache_keys[index]));
+          }
+        }
+      });
+  TF_VLOG(3) << "Compiling " << compile_instances.size()
+             << " computations on device " << device;
+  auto computation_ptrs =
+      xla::ComputationClient::Get()->Compile(std::move(compile_instances));
+  TF_VLOG(3) << "Compiling " << computation_ptrs.size()
+             << " computations on device " << device << " done!";
+  compiled = true;
+  for (size_t i = 0; i < missing.size(); ++i) {
+    computations[missing[i]] = computation_ptrs[i];
+    if (persistent_cache != nullptr) {
+      persistent_cache->Store(GetPersistentCacheKey(cache_keys[missing[i]]),
+                              computation_ptrs[i]);
+    }
+  }
+  return computations;
+}
+
 }  // namespace
 
 OpByOpExecutor::OpByOpExecutor(size_t compile_cache_size)
-    : compile_cache_(compile_cache_size) {}
+    : compile_cache_(compile_cache_size,
+                     xla::util::CacheOptions{"OpByOpCompileCache"}) {}
 
 std::vector<xla::ComputationClient::ExecuteChainedOp> OpByOpExecutor::BuildOps(
     c10::ArrayRef<torch::lazy::Value> roots, const std::string& device,
@@ -183,12 +257,8 @@ std::vector<xla::ComputationClient::ExecuteChainedOp> OpByOpExecutor::BuildOps(
   // If we missed the cache for certain ops, compile them now and fixup the
   // chained ops vector.
   if (!compile_instances.empty()) {
-    TF_VLOG(3) << "Compiling " << compile_instances.size()
-               << " computations on device " << device;
     auto computation_ptrs =
-        xla::ComputationClient::Get()->Compile(std::move(compile_instances));
-    TF_VLOG(3) << "Compiling " << computation_ptrs.size()
-               << " computations on device " << device << " done!";
+        CompileOps(cache_keys, std::move(compile_instances), device);
     for (size_t i = 0; i < computation_ptrs.size(); ++i) {
       compile_cache_.Add(cache_keys[i], computation_ptrs[i]);
       for (auto index : compile_indices[cache_keys[i]]) {
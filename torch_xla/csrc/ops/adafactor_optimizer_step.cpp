@@ -0,0 +1,99 @@
+#include "torch_xla/csrc/ops/adafactor_optimizer_step.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+// Returns the number of operands of the parameter whose step is at the given
+// operand index.
+size_t ParamOperands(const torch::lazy::OpList& operands, size_t index) {
+  XLA_CHECK_LT(index + 3, operands.size());
+  return AdafactorOptimizerStep::IsFactored(GetXlaShape(operands[index + 1]))
+             ? 5
+             : 4;
+}
+
+xla::Shape NodeOutputShape(const torch::lazy::OpList& operands) {
+  std::vector<xla::Shape> shapes;
+  for (size_t i = AdafactorOptimizerStep::kScalarOperands; i < operands.size();
+       i += ParamOperands(operands, i)) {
+    shapes.push_back(/*step=*/GetXlaShape(operands[i]));
+    shapes.push_back(/*param=*/GetXlaShape(operands[i + 1]));
+    for (size_t j = i + 3; j < i + ParamOperands(operands, i); ++j) {
+      shapes.push_back(GetXlaShape(operands[j]));
+    }
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+// Every parameter outputs all its operands but the gradient.
+size_t GetNumOutputs(const torch::lazy::OpList& operands) {
+  size_t num_outputs = 0;
+  for (size_t i = AdafactorOptimizerStep::kScalarOperands; i < operands.size();
+       i += ParamOperands(operands, i)) {
+    num_outputs += ParamOperands(operands, i) - 1;
+  }
+  return num_outputs;
+}
+
+}  // namespace
+
+AdafactorOptimizerStep::AdafactorOptimizerStep(
+    const torch::lazy::OpList& operands, double decay_rate, double eps1,
+    double eps2, double clip_threshold, bool use_weight_decay,
+    bool scale_parameter)
+    : XlaNode(xla_adafactor_optimizer_step, operands,
+              NodeOutputShape(operands),
+              /*num_outputs=*/GetNumOutputs(operands),
+              torch::lazy::MHash(decay_rate, eps1, eps2, clip_threshold,
+                                 use_weight_decay, scale_parameter)),
+      decay_rate_(decay_rate),
+      eps1_(eps1),
+      eps2_(eps2),
+      clip_threshold_(clip_threshold),
+      use_weight_decay_(use_weight_decay),
+      scale_parameter_(scale_parameter) {}
+
+torch::lazy::NodePtr AdafactorOptimizerStep::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<AdafactorOptimizerStep>(
+      operands, decay_rate_, eps1_, eps2_, clip_threshold_, use_weight_decay_,
+      scale_parameter_);
+}
+
+XlaOpVector AdafactorOptimizerStep::Lower(LoweringContext* loctx) const {
+  xla::XlaOp found_inf = loctx->GetOutputOp(operand(0));
+  xla::XlaOp lr = loctx->GetOutputOp(operand(1));
+  xla::XlaOp weight_decay = loctx->GetOutputOp(operand(2));
+  std::vector<xla::XlaOp> results;
+  for (size_t i = kScalarOperands; i < operands().size();
+       i += ParamOperands(operands(), i)) {
+    xla::XlaOp exp_avg_sq = loctx->GetOutputOp(operand(i + 3));
+    xla::XlaOp exp_avg_sq_col = ParamOperands(operands(), i) > 4
+                                    ? loctx->GetOutputOp(operand(i + 4))
+                                    : exp_avg_sq;
+    std::vector<xla::XlaOp> param_results = BuildAdafactorOptimizerStep(
+        found_inf, loctx->GetOutputOp(operand(i)),
+        loctx->GetOutputOp(operand(i + 1)), loctx->GetOutputOp(operand(i + 2)),
+        exp_avg_sq, exp_avg_sq_col, lr, weight_decay, decay_rate_, eps1_,
+        eps2_, clip_threshold_, use_weight_decay_, scale_parameter_);
+    results.insert(results.end(), param_results.begin(), param_results.end());
+  }
+  return ReturnOps(results, loctx);
+}
+
+std::string AdafactorOptimizerStep::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", decay_rate=" << decay_rate_
+     << ", eps1=" << eps1_ << ", eps2=" << eps2_
+     << ", clip_threshold=" << clip_threshold_
+     << ", use_weight_decay=" << use_weight_decay_
+     << ", scale_parameter=" << scale_parameter_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Adafactor step of a list of parameters within a single node. The operands
+// are the found_inf, lr and weight_decay scalars, followed by the step, param
+// and grad of every parameter, and then its second moment state: the
+// exp_avg_sq_row and exp_avg_sq_col factors for the parameters of rank 2 or
+// more, or the full exp_avg_sq for the others. The outputs are the new step,
+// param and second moment state of every parameter.
+class AdafactorOptimizerStep : public XlaNode {
+ public:
+  static constexpr size_t kScalarOperands = 3;
+
+  // Whether the second moment of a parameter is factored.
+  static bool IsFactored(const xla::Shape& param_shape) {
+    return param_shape.rank() >= 2;
+  }
+
+  AdafactorOptimizerStep(const torch::lazy::OpList& operands,
+                         double decay_rate, double eps1, double eps2,
+                         double clip_threshold, bool use_weight_decay,
+                         bool scale_parameter);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+ private:
+  double decay_rate_;
+  double eps1_;
+  double eps2_;
+  double clip_threshold_;
+  bool use_weight_decay_;
+  bool scale_parameter_;
+};
+
+}  // namespace torch_xla
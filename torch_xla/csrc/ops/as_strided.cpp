@@ -2,8 +2,12 @@
 
 #include <algorithm>
 
+#include "absl/types/optional.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch/csrc/lazy/core/util.h"
 #include "torch_xla/csrc/data_ops.h"
@@ -15,28 +19,191 @@
 namespace torch_xla {
 namespace {
 
+// The windowed strides get lowered as a concatenation of this many slices at
+// most, and with a gather beyond.
+constexpr int64_t kMaxWindowSlices = 16;
+
+struct StridedDim {
+  int64_t dim;
+  int64_t size;
+  int64_t stride;
+};
+
+// Lowers the view of the flat input made of the dims, sorted by decreasing
+// stride, if every dim spans no more than the stride of the previous one, and
+// the strides are multiples of the following ones. Such views (contiguous,
+// sliced or strided) are a slice of a reshape of the flat input, padded to a
+// whole number of outer strides. The result has the dims in the given order.
+absl::optional<xla::XlaOp> LowerNestedStrides(xla::XlaOp r1_input,
+                                              absl::Span<const StridedDim> dims,
+                                              int64_t storage_offset) {
+  for (size_t i = 1; i < dims.size(); ++i) {
+    if (dims[i - 1].stride % dims[i].stride != 0 ||
+        dims[i - 1].stride < dims[i].stride * dims[i].size) {
+      return absl::nullopt;
+    }
+  }
+  int64_t input_size = XlaHelpers::ShapeOfXlaOp(r1_input).dimensions(0);
+  int64_t length = dims.front().size * dims.front().stride;
+  int64_t limit = std::min(input_size, storage_offset + length);
+  xla::XlaOp flat =
+      xla::SliceInDim(r1_input, storage_offset, limit, 1, /*dimno=*/0);
+  if (limit - storage_offset < length) {
+    flat = xla::PadInDim(
+        flat, xla::Zero(r1_input.builder(), XlaHelpers::TypeOfXlaOp(flat)),
+        /*dimno=*/0, /*pad_lo=*/0,
+        /*pad_hi=*/length - (limit - storage_offset));
+  }
+  std::vector<int64_t> reshape_sizes({dims.front().size});
+  std::vector<int64_t> limits({dims.front().size});
+  std::vector<int64_t> sizes({dims.front().size});
+  for (size_t i = 1; i < dims.size(); ++i) {
+    reshape_sizes.push_back(dims[i - 1].stride / dims[i].stride);
+    limits.push_back(dims[i].size);
+    sizes.push_back(dims[i].size);
+  }
+  reshape_sizes.push_back(dims.back().stride);
+  limits.push_back(1);
+  xla::XlaOp reshaped = xla::Reshape(flat, reshape_sizes);
+  if (reshape_sizes != limits) {
+    reshaped = xla::Slice(reshaped, std::vector<int64_t>(limits.size(), 0),
+                          limits, std::vector<int64_t>(limits.size(), 1));
+  }
+  return xla::Reshape(reshaped, sizes);
+}
+
+// Lowers the views in which a dim overlaps the previous one, like the sliding
+// windows of unfold(), whose dim i-1 moves by step elements of dim i. The
+// windows are the concatenation of step wide slices of the non overlapping
+// view with the window dim split in steps.
+absl::optional<xla::XlaOp> LowerWindowedStrides(
+    xla::XlaOp r1_input, absl::Span<const StridedDim> dims,
+    int64_t storage_offset) {
+  for (size_t i = 1; i < dims.size(); ++i) {
+    if (dims[i - 1].stride >= dims[i].stride * dims[i].size) {
+      continue;
+    }
+    if (dims[i - 1].stride % dims[i].stride != 0) {
+      return absl::nullopt;
+    }
+    int64_t step = dims[i - 1].stride / dims[i].stride;
+    int64_t num_slices = xla::CeilOfRatio(dims[i].size, step);
+    if (num_slices > kMaxWindowSlices) {
+      return absl::nullopt;
+    }
+    std::vector<StridedDim> split_dims(dims.begin(), dims.end());
+    split_dims[i - 1].size += num_slices - 1;
+    split_dims[i].size = step;
+    absl::optional<xla::XlaOp> split =
+        LowerNestedStrides(r1_input, split_dims, storage_offset);
+    if (!split) {
+      return absl::nullopt;
+    }
+    std::vector<xla::XlaOp> slices;
+    for (int64_t q = 0; q < num_slices; ++q) {
+      slices.push_back(
+          xla::SliceInDim(*split, q, q + dims[i - 1].size, 1, i - 1));
+    }
+    xla::XlaOp windows = xla::ConcatInDim(r1_input.builder(), slices, i);
+    return xla::SliceInDim(windows, 0, dims[i].size, 1, i);
+  }
+  return absl::nullopt;
+}
+
 xla::XlaOp LowerAsStrided(xla::XlaOp input, absl::Span<const int64_t> size,
                           absl::Span<const int64_t> stride,
                           int64_t storage_offset) {
   const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
   int64_t input_element_count = xla::ShapeUtil::ElementsIn(input_shape);
-  int64_t slice_size = xla::util::Multiply<int64_t>(size);
-  XLA_CHECK_LE(storage_offset + slice_size, input_element_count);
-
-  xla::XlaOp off_input = input;
-  if (storage_offset > 0 || slice_size < input_element_count) {
-    xla::XlaOp r1_input = XlaHelpers::Flatten(input);
-    off_input = xla::SliceInDim(r1_input, storage_offset,
-                                storage_offset + slice_size, 1, 0);
+  if (xla::util::Multiply<int64_t>(size) == 0) {
+    return xla::Broadcast(
+        xla::Zero(input.builder(), input_shape.element_type()), size);
+  }
+  int64_t max_offset = storage_offset;
+  for (size_t i = 0; i < size.size(); ++i) {
+    max_offset += (size[i] - 1) * stride[i];
   }
+  XLA_CHECK_LT(max_offset, input_element_count);
 
-  std::vector<int64_t> permutation = xla::InversePermutation(
-      AsStrided::GetArrayStridePermutation(stride, size));
-  std::vector<int64_t> new_sizes = xla::PermuteInverse(size, permutation);
-  xla::XlaOp reshaped_input = XlaHelpers::DynamicReshape(off_input, new_sizes);
-  return xla::IsIdentityPermutation(permutation)
-             ? reshaped_input
-             : xla::Transpose(reshaped_input, permutation);
+  if (AsStrided::IsContiguousPermutation(size, stride)) {
+    int64_t slice_size = xla::util::Multiply<int64_t>(size);
+    xla::XlaOp off_input = input;
+    if (storage_offset > 0 || slice_size < input_element_count) {
+      xla::XlaOp r1_input = XlaHelpers::Flatten(input);
+      off_input = xla::SliceInDim(r1_input, storage_offset,
+                                  storage_offset + slice_size, 1, 0);
+    }
+    std::vector<int64_t> permutation = xla::InversePermutation(
+        AsStrided::GetArrayStridePermutation(stride, size));
+    std::vector<int64_t> new_sizes = xla::PermuteInverse(size, permutation);
+    xla::XlaOp reshaped_input =
+        XlaHelpers::DynamicReshape(off_input, new_sizes);
+    return xla::IsIdentityPermutation(permutation)
+               ? reshaped_input
+               : xla::Transpose(reshaped_input, permutation);
+  }
+
+  // The size one and zero stride (broadcast) dims do not move within the
+  // input, and get added back at the end.
+  std::vector<StridedDim> dims;
+  for (size_t i = 0; i < size.size(); ++i) {
+    if (size[i] > 1 && stride[i] > 0) {
+      dims.push_back({static_cast<int64_t>(i), size[i], stride[i]});
+    }
+  }
+  std::stable_sort(dims.begin(), dims.end(),
+                   [](const StridedDim& a, const StridedDim& b) {
+                     return a.stride > b.stride;
+                   });
+  xla::XlaOp r1_input = XlaHelpers::Flatten(input);
+  xla::XlaOp output;
+  if (dims.empty()) {
+    output = xla::Reshape(
+        xla::SliceInDim(r1_input, storage_offset, storage_offset + 1, 1, 0),
+        {});
+  } else {
+    absl::optional<xla::XlaOp> strided =
+        LowerNestedStrides(r1_input, dims, storage_offset);
+    if (!strided) {
+      strided = LowerWindowedStrides(r1_input, dims, storage_offset);
+    }
+    if (strided) {
+      output = *strided;
+    } else {
+      XLA_COUNTER("AsStridedGather", 1);
+      std::vector<int64_t> dims_size;
+      std::vector<int64_t> dims_stride;
+      for (auto& dim : dims) {
+        dims_size.push_back(dim.size);
+        dims_stride.push_back(dim.stride);
+      }
+      xla::XlaOp indices = AsStrided::BuildElementIndices(
+          input.builder(), dims_size, dims_stride, storage_offset);
+      output = xla::Reshape(
+          xla::TorchIndexSelect(
+              r1_input,
+              xla::Reshape(indices, {xla::util::Multiply<int64_t>(dims_size)}),
+              0),
+          dims_size);
+    }
+    // Back from the stride order to the dims order.
+    std::vector<int64_t> permutation(dims.size());
+    for (size_t i = 0; i < dims.size(); ++i) {
+      permutation[i] = i;
+    }
+    std::sort(permutation.begin(), permutation.end(),
+              [&](int64_t a, int64_t b) { return dims[a].dim < dims[b].dim; });
+    if (!xla::IsIdentityPermutation(permutation)) {
+      output = xla::Transpose(output, permutation);
+    }
+  }
+  std::vector<int64_t> broadcast_dims;
+  for (size_t i = 0; i < size.size(); ++i) {
+    if (size[i] > 1 && stride[i] > 0) {
+      broadcast_dims.push_back(i);
+    }
+  }
+  return xla::BroadcastInDim(output, size, broadcast_dims);
 }
 
 }  // namespace
@@ -77,9 +244,23 @@ bool AsStrided::StrideIsSupported(const xla::Shape& input_shape,
                                   absl::Span<const int64_t> size,
                                   absl::Span<const int64_t> stride,
                                   int64_t storage_offset) {
-  std::vector<int64_t> sorted_stride(stride.begin(), stride.end());
-  std::sort(sorted_stride.begin(), sorted_stride.end());
-  return stride.empty() || sorted_stride.front() == 1;
+  // All the strides can be lowered, with a gather if nothing cheaper fits.
+  return std::all_of(stride.begin(), stride.end(),
+                     [](int64_t value) { return value >= 0; });
+}
+
+bool AsStrided::IsContiguousPermutation(absl::Span<const int64_t> size,
+                                        absl::Span<const int64_t> stride) {
+  std::vector<int64_t> permutation = GetArrayStridePermutation(stride, size);
+  int64_t expected_stride = 1;
+  for (size_t i = permutation.size(); i > 0; --i) {
+    int64_t dim = permutation[i - 1];
+    if (size[dim] != 1 && stride[dim] != expected_stride) {
+      return false;
+    }
+    expected_stride *= size[dim];
+  }
+  return true;
 }
 
 std::vector<int64_t> AsStrided::GetArrayStridePermutation(
@@ -90,4 +271,20 @@ std::vector<int64_t> AsStrided::GetArrayStridePermutation(
   return permutation;
 }
 
+xla::XlaOp AsStrided::BuildElementIndices(xla::XlaBuilder* builder,
+                                          absl::Span<const int64_t> size,
+                                          absl::Span<const int64_t> stride,
+                                          int64_t storage_offset) {
+  xla::Shape shape = xla::ShapeUtil::MakeShape(xla::PrimitiveType::S64, size);
+  xla::XlaOp indices =
+      xla::Broadcast(XlaHelpers::ScalarValue<int64_t>(storage_offset, builder),
+                     size);
+  for (size_t i = 0; i < size.size(); ++i) {
+    xla::XlaOp dim_stride =
+        XlaHelpers::ScalarValue<int64_t>(stride[i], builder);
+    indices = indices + xla::Iota(builder, shape, i) * dim_stride;
+  }
+  return indices;
+}
+
 }  // namespace torch_xla
@@ -2,6 +2,7 @@
 
 #include <vector>
 
+#include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/types.h"
 #include "torch_xla/csrc/ir.h"
 
@@ -29,9 +30,21 @@ class AsStrided : public XlaNode {
                                 absl::Span<const int64_t> stride,
                                 int64_t storage_offset);
 
+  // Whether the strides are the ones of a contiguous tensor, with permuted
+  // dimensions, which maps to a reshape and a transpose.
+  static bool IsContiguousPermutation(absl::Span<const int64_t> size,
+                                      absl::Span<const int64_t> stride);
+
   static std::vector<int64_t> GetArrayStridePermutation(
       absl::Span<const int64_t> stride, absl::Span<const int64_t> size);
 
+  // Returns the S64 tensor of the given size, with the index within the
+  // flattened input of every element of the strided view.
+  static xla::XlaOp BuildElementIndices(xla::XlaBuilder* builder,
+                                        absl::Span<const int64_t> size,
+                                        absl::Span<const int64_t> stride,
+                                        int64_t storage_offset);
+
  private:
   std::vector<int64_t> size_;
   std::vector<int64_t> stride_;
@@ -1,6 +1,7 @@
 #include "torch_xla/csrc/ops/as_strided_view_update.h"
 
 #include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
@@ -9,6 +10,7 @@
 #include "torch_xla/csrc/ops/xla_ops.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
+#include "torch_xla/csrc/xla_lower_util.h"
 
 namespace torch_xla {
 namespace {
@@ -20,6 +22,17 @@ xla::XlaOp LowerAsStridedViewUpdate(xla::XlaOp target, xla::XlaOp input,
   const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
   int64_t input_element_count = xla::ShapeUtil::ElementsIn(input_shape);
   int64_t slice_size = xla::util::Multiply<int64_t>(size);
+  if (!AsStrided::IsContiguousPermutation(input_shape.dimensions(), stride)) {
+    // Scatter the view elements at their flat indices within the target.
+    XLA_COUNTER("AsStridedViewUpdateScatter", 1);
+    xla::XlaOp indices = AsStrided::BuildElementIndices(
+        input.builder(), input_shape.dimensions(), stride, storage_offset);
+    xla::XlaOp updated = CreateIndexUpdate(
+        XlaHelpers::Flatten(target),
+        xla::Reshape(indices, {input_element_count, 1}), /*start_dim=*/0,
+        XlaHelpers::Flatten(input), /*combiner=*/nullptr);
+    return XlaHelpers::DynamicReshape(updated, size);
+  }
   XLA_CHECK_LE(storage_offset + input_element_count, slice_size);
 
   std::vector<int64_t> permutation =
@@ -2,7 +2,9 @@
 
 #include "tensorflow/compiler/xla/client/lib/matrix.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/small_matrix.h"
 
 namespace torch_xla {
 
@@ -19,7 +21,10 @@ torch::lazy::NodePtr Cholesky::Clone(torch::lazy::OpList operands) const {
 XlaOpVector Cholesky::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
   xla::XlaOp output =
-      xla::Triangle(xla::Cholesky(input, /*lower=*/lower_), /*lower=*/lower_);
+      IsSmallMatrix(XlaHelpers::ShapeOfXlaOp(input))
+          ? BuildSmallCholesky(input, lower_)
+          : xla::Triangle(xla::Cholesky(input, /*lower=*/lower_),
+                          /*lower=*/lower_);
   return ReturnOp(output, loctx);
 }
 
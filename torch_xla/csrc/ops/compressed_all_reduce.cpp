@@ -0,0 +1,82 @@
+#include "torch_xla/csrc/ops/compressed_all_reduce.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace {
+
+xla::Shape NodeOutputShape(const torch::lazy::Value& input,
+                           const torch::lazy::Value& residual,
+                           const torch::lazy::Value& token, double scale,
+                           xla::PrimitiveType wire_type,
+                           const std::vector<std::vector<int64_t>>& groups,
+                           bool pin_layout) {
+  auto shape_fn = [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    CompressedAllReduceResult result =
+        BuildCompressedAllReduce(operands[0], operands[1], operands[2], scale,
+                                 wire_type, groups, pin_layout);
+    return xla::Tuple(operands[0].builder(), {result.result, result.residual,
+                                              result.error, result.token});
+  };
+  return InferOutputShape(
+      {GetXlaShape(input), GetXlaShape(residual), GetXlaShape(token)},
+      shape_fn);
+}
+
+}  // namespace
+
+CompressedAllReduce::CompressedAllReduce(
+    const torch::lazy::Value& input, const torch::lazy::Value& residual,
+    const torch::lazy::Value& token, double scale,
+    xla::PrimitiveType wire_type, std::vector<std::vector<int64_t>> groups,
+    bool pin_layout)
+    : XlaNode(xla_compressed_all_reduce, {input, residual, token},
+              [&]() {
+                return NodeOutputShape(input, residual, token, scale,
+                                       wire_type, groups, pin_layout);
+              },
+              /*num_outputs=*/4,
+              torch::lazy::MHash(scale, static_cast<int>(wire_type), groups,
+                                 pin_layout)),
+      scale_(scale),
+      wire_type_(wire_type),
+      groups_(std::move(groups)),
+      pin_layout_(pin_layout) {}
+
+torch::lazy::NodePtr CompressedAllReduce::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<CompressedAllReduce>(
+      operands.at(0), operands.at(1), operands.at(2), scale_, wire_type_,
+      groups_, pin_layout_);
+}
+
+XlaOpVector CompressedAllReduce::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp residual = loctx->GetOutputOp(operand(1));
+  xla::XlaOp token = loctx->GetOutputOp(operand(2));
+  CompressedAllReduceResult result = BuildCompressedAllReduce(
+      input, residual, token, scale_, wire_type_, groups_, pin_layout_);
+  return ReturnOps(
+      {result.result, result.residual, result.error, result.token}, loctx);
+}
+
+std::string CompressedAllReduce::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", scale=" << scale_ << ", wire_type="
+     << xla::primitive_util::LowercasePrimitiveTypeName(wire_type_)
+     << ", pin_layout=" << pin_layout_ << ", groups=(";
+  for (size_t i = 0; i < groups_.size(); ++i) {
+    ss << (i == 0 ? "(" : ",(");
+    ss << absl::StrJoin(groups_[i], ", ") << ")";
+  }
+  ss << ")";
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "torch_xla/csrc/cross_replica_reduces.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Sums the input across the replicas in a lower precision wire type, with the
+// error feedback residual of the previous reductions added to it. The outputs
+// are the result, the new residual, the relative compression error and the
+// new token.
+class CompressedAllReduce : public XlaNode {
+ public:
+  CompressedAllReduce(const torch::lazy::Value& input,
+                      const torch::lazy::Value& residual,
+                      const torch::lazy::Value& token, double scale,
+                      xla::PrimitiveType wire_type,
+                      std::vector<std::vector<int64_t>> groups,
+                      bool pin_layout);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double scale() const { return scale_; }
+
+  xla::PrimitiveType wire_type() const { return wire_type_; }
+
+  const std::vector<std::vector<int64_t>>& groups() const { return groups_; }
+
+  bool pin_layout() const { return pin_layout_; }
+
+ private:
+  double scale_;
+  xla::PrimitiveType wire_type_;
+  std::vector<std::vector<int64_t>> groups_;
+  bool pin_layout_;
+};
+
+}  // namespace torch_xla
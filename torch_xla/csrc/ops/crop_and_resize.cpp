@@ -0,0 +1,41 @@
+#include "torch_xla/csrc/ops/crop_and_resize.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/resize_ops.h"
+
+namespace torch_xla {
+
+CropAndResize::CropAndResize(const torch::lazy::Value& input,
+                             const torch::lazy::Value& boxes,
+                             std::vector<int64_t> output_size)
+    : XlaNode(xla_crop_and_resize, {input, boxes},
+              [&]() {
+                return resize::GetCropAndResizeOutputShape2d(
+                    GetXlaShape(input), output_size);
+              },
+              /*num_outputs=*/1, torch::lazy::MHash(output_size)),
+      output_size_(std::move(output_size)) {}
+
+torch::lazy::NodePtr CropAndResize::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<CropAndResize>(operands.at(0), operands.at(1),
+                                              output_size_);
+}
+
+XlaOpVector CropAndResize::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp boxes = loctx->GetOutputOp(operand(1));
+  return ReturnOp(resize::LowerCropAndResize2d(input, boxes, output_size_),
+                  loctx);
+}
+
+std::string CropAndResize::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", output_size=("
+     << absl::StrJoin(output_size_, ", ") << ")";
+  return ss.str();
+}
+
+}  // namespace torch_xla
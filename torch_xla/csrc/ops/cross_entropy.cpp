@@ -0,0 +1,140 @@
+#include "torch_xla/csrc/ops/cross_entropy.h"
+
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/cross_entropy.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace {
+
+xla::Shape NodeOutputShape(const torch::lazy::Value& logits,
+                           const torch::lazy::Value& labels,
+                           const absl::optional<torch::lazy::Value>& weight,
+                           ReductionMode reduction, int64_t ignore_index,
+                           double label_smoothing) {
+  auto lower_for_shape_fn =
+      [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    absl::optional<xla::XlaOp> weight;
+    if (operands.size() > 2) {
+      weight = operands[2];
+    }
+    CrossEntropyOutput result =
+        BuildCrossEntropy(operands[0], operands[1], weight, reduction,
+                          ignore_index, label_smoothing);
+    return xla::Tuple(operands[0].builder(), {result.loss, result.logsumexp});
+  };
+  std::vector<xla::Shape> shapes;
+  for (auto& input : xla::util::GetValuesVector<torch::lazy::Value>(
+           {logits, labels}, {&weight})) {
+    shapes.push_back(GetXlaShape(input));
+  }
+  return InferOutputShape(shapes, lower_for_shape_fn);
+}
+
+}  // namespace
+
+CrossEntropy::CrossEntropy(const torch::lazy::Value& logits,
+                           const torch::lazy::Value& labels,
+                           const absl::optional<torch::lazy::Value>& weight,
+                           ReductionMode reduction, int64_t ignore_index,
+                           double label_smoothing)
+    : XlaNode(xla_cross_entropy,
+              xla::util::GetValuesVector<torch::lazy::Value>({logits, labels},
+                                                             {&weight}),
+              [&]() {
+                return NodeOutputShape(logits, labels, weight, reduction,
+                                       ignore_index, label_smoothing);
+              },
+              /*num_outputs=*/2,
+              torch::lazy::MHash(torch::lazy::GetEnumValue(reduction),
+                                 ignore_index, label_smoothing)),
+      reduction_(reduction),
+      ignore_index_(ignore_index),
+      label_smoothing_(label_smoothing) {}
+
+torch::lazy::NodePtr CrossEntropy::Clone(torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> weight;
+  if (operands.size() > 2) {
+    weight = operands.at(2);
+  }
+  return torch::lazy::MakeNode<CrossEntropy>(operands.at(0), operands.at(1),
+                                             weight, reduction_, ignore_index_,
+                                             label_smoothing_);
+}
+
+XlaOpVector CrossEntropy::Lower(LoweringContext* loctx) const {
+  xla::XlaOp logits = loctx->GetOutputOp(operand(0));
+  xla::XlaOp labels = loctx->GetOutputOp(operand(1));
+  absl::optional<xla::XlaOp> weight;
+  if (operands().size() > 2) {
+    weight = loctx->GetOutputOp(operand(2));
+  }
+  CrossEntropyOutput result = BuildCrossEntropy(
+      logits, labels, weight, reduction_, ignore_index_, label_smoothing_);
+  return ReturnOps({result.loss, result.logsumexp}, loctx);
+}
+
+std::string CrossEntropy::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString()
+     << ", reduction=" << torch::lazy::GetEnumValue(reduction_)
+     << ", ignore_index=" << ignore_index_
+     << ", label_smoothing=" << label_smoothing_;
+  return ss.str();
+}
+
+CrossEntropyBackward::CrossEntropyBackward(
+    const torch::lazy::Value& grad_output, const torch::lazy::Value& logits,
+    const torch::lazy::Value& labels, const torch::lazy::Value& logsumexp,
+    const absl::optional<torch::lazy::Value>& weight, ReductionMode reduction,
+    int64_t ignore_index, double label_smoothing)
+    : XlaNode(xla_cross_entropy_backward,
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {grad_output, logits, labels, logsumexp}, {&weight}),
+              GetXlaShape(logits),
+              /*num_outputs=*/1,
+              torch::lazy::MHash(torch::lazy::GetEnumValue(reduction),
+                                 ignore_index, label_smoothing)),
+      reduction_(reduction),
+      ignore_index_(ignore_index),
+      label_smoothing_(label_smoothing) {}
+
+torch::lazy::NodePtr CrossEntropyBackward::Clone(
+    torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> weight;
+  if (operands.size() > 4) {
+    weight = operands.at(4);
+  }
+  return torch::lazy::MakeNode<CrossEntropyBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3), weight,
+      reduction_, ignore_index_, label_smoothing_);
+}
+
+XlaOpVector CrossEntropyBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
+  xla::XlaOp logits = loctx->GetOutputOp(operand(1));
+  xla::XlaOp labels = loctx->GetOutputOp(operand(2));
+  xla::XlaOp logsumexp = loctx->GetOutputOp(operand(3));
+  absl::optional<xla::XlaOp> weight;
+  if (operands().size() > 4) {
+    weight = loctx->GetOutputOp(operand(4));
+  }
+  return ReturnOp(BuildCrossEntropyBackward(grad_output, logits, labels,
+                                            logsumexp, weight, reduction_,
+                                            ignore_index_, label_smoothing_),
+                  loctx);
+}
+
+std::string CrossEntropyBackward::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString()
+     << ", reduction=" << torch::lazy::GetEnumValue(reduction_)
+     << ", ignore_index=" << ignore_index_
+     << ", label_smoothing=" << label_smoothing_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
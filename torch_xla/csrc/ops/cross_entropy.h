@@ -0,0 +1,67 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/reduction.h"
+
+namespace torch_xla {
+
+// Fused log_softmax() and nll_loss() of the logits, with optional label
+// smoothing. Outputs the loss and the logsumexp of the logits over the
+// classes, which the backward node consumes.
+class CrossEntropy : public XlaNode {
+ public:
+  CrossEntropy(const torch::lazy::Value& logits,
+               const torch::lazy::Value& labels,
+               const absl::optional<torch::lazy::Value>& weight,
+               ReductionMode reduction, int64_t ignore_index,
+               double label_smoothing);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  ReductionMode reduction() const { return reduction_; }
+
+  int64_t ignore_index() const { return ignore_index_; }
+
+  double label_smoothing() const { return label_smoothing_; }
+
+ private:
+  ReductionMode reduction_;
+  int64_t ignore_index_;
+  double label_smoothing_;
+};
+
+// Outputs the gradient of the logits of a CrossEntropy node.
+class CrossEntropyBackward : public XlaNode {
+ public:
+  CrossEntropyBackward(const torch::lazy::Value& grad_output,
+                       const torch::lazy::Value& logits,
+                       const torch::lazy::Value& labels,
+                       const torch::lazy::Value& logsumexp,
+                       const absl::optional<torch::lazy::Value>& weight,
+                       ReductionMode reduction, int64_t ignore_index,
+                       double label_smoothing);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  ReductionMode reduction() const { return reduction_; }
+
+  int64_t ignore_index() const { return ignore_index_; }
+
+  double label_smoothing() const { return label_smoothing_; }
+
+ private:
+  ReductionMode reduction_;
+  int64_t ignore_index_;
+  double label_smoothing_;
+};
+
+}  // namespace torch_xla
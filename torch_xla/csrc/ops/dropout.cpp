@@ -0,0 +1,82 @@
+#include "torch_xla/csrc/ops/dropout.h"
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+xla::Shape NodeOutputShape(const torch::lazy::Value& input) {
+  const xla::Shape& input_shape = GetXlaShape(input);
+  return xla::ShapeUtil::MakeTupleShape(
+      {input_shape,
+       xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                 {GetPackedMaskWords(input_shape)})});
+}
+
+}  // namespace
+
+Dropout::Dropout(const torch::lazy::Value& input,
+                 const torch::lazy::Value& seed, double probability)
+    : XlaNode(xla_dropout, {input, seed},
+              [&]() { return NodeOutputShape(input); },
+              /*num_outputs=*/2, torch::lazy::MHash(probability)),
+      probability_(probability) {}
+
+torch::lazy::NodePtr Dropout::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<Dropout>(operands.at(0), operands.at(1),
+                                        probability_);
+}
+
+XlaOpVector Dropout::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp seed = loctx->GetOutputOp(operand(1));
+  xla::XlaOp mask = BuildDropoutKeepMask(
+      seed, XlaHelpers::ShapeOfXlaOp(input), probability_);
+  return ReturnOps({BuildDropoutApply(input, mask, probability_),
+                    BuildPackedMask(mask)},
+                   loctx);
+}
+
+std::string Dropout::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", probability=" << probability_;
+  return ss.str();
+}
+
+DropoutBackward::DropoutBackward(const torch::lazy::Value& grad_output,
+                                 const torch::lazy::Value& mask,
+                                 double probability, bool regenerate)
+    : XlaNode(xla_dropout_backward, {grad_output, mask},
+              GetXlaShape(grad_output),
+              /*num_outputs=*/1, torch::lazy::MHash(probability, regenerate)),
+      probability_(probability),
+      regenerate_(regenerate) {}
+
+torch::lazy::NodePtr DropoutBackward::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<DropoutBackward>(operands.at(0), operands.at(1),
+                                                probability_, regenerate_);
+}
+
+XlaOpVector DropoutBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
+  xla::XlaOp mask_source = loctx->GetOutputOp(operand(1));
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(grad_output);
+  xla::XlaOp mask =
+      regenerate_ ? BuildDropoutKeepMask(mask_source, shape, probability_)
+                  : BuildUnpackedMask(mask_source, shape);
+  return ReturnOp(BuildDropoutApply(grad_output, mask, probability_), loctx);
+}
+
+std::string DropoutBackward::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", probability=" << probability_
+     << ", regenerate=" << regenerate_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Zeroes the input elements with the given probability, out of the mask the
+// seed generates, and scales the others by 1 / (1 - probability). The outputs
+// are the result, and the mask packed one bit per element in S32 words.
+class Dropout : public XlaNode {
+ public:
+  Dropout(const torch::lazy::Value& input, const torch::lazy::Value& seed,
+          double probability);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double probability() const { return probability_; }
+
+ private:
+  double probability_;
+};
+
+// The gradient of a Dropout node, out of its packed mask, or, if regenerate is
+// true, out of the mask its seed generates again.
+class DropoutBackward : public XlaNode {
+ public:
+  DropoutBackward(const torch::lazy::Value& grad_output,
+                  const torch::lazy::Value& mask, double probability,
+                  bool regenerate);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double probability() const { return probability_; }
+
+  bool regenerate() const { return regenerate_; }
+
+ private:
+  double probability_;
+  bool regenerate_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,255 @@
+#include "torch_xla/csrc/ops/embedding_bag.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace {
+
+std::vector<xla::Shape> GetOperandShapes(
+    absl::Span<const torch::lazy::Value> operands) {
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(GetXlaShape(operand));
+  }
+  return shapes;
+}
+
+absl::optional<xla::XlaOp> OptionalOperand(
+    absl::Span<const xla::XlaOp> operands, size_t index) {
+  return operands.size() > index ? absl::optional<xla::XlaOp>(operands[index])
+                                 : absl::nullopt;
+}
+
+absl::optional<torch::lazy::Value> OptionalOperand(
+    const torch::lazy::OpList& operands, size_t index) {
+  return operands.size() > index
+             ? absl::optional<torch::lazy::Value>(operands.at(index))
+             : absl::nullopt;
+}
+
+std::string ModeName(EmbeddingBagMode mode) {
+  switch (mode) {
+    case EmbeddingBagMode::kSum:
+      return "sum";
+    case EmbeddingBagMode::kMean:
+      return "mean";
+    case EmbeddingBagMode::kMax:
+      return "max";
+  }
+  XLA_ERROR() << "Invalid embedding bag mode: " << static_cast<int>(mode);
+}
+
+xla::Shape EmbeddingBagOutputShape(absl::Span<const torch::lazy::Value> values,
+                                   EmbeddingBagMode mode,
+                                   bool include_last_offset,
+                                   int64_t padding_idx) {
+  auto lower_for_shape_fn =
+      [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    EmbeddingBagResult result = BuildEmbeddingBag(
+        operands[0], operands[1], operands[2], OptionalOperand(operands, 3),
+        mode, include_last_offset, padding_idx);
+    return xla::Tuple(operands[0].builder(),
+                      {result.output, result.offset2bag, result.bag_size,
+                       result.max_indices});
+  };
+  return InferOutputShape(GetOperandShapes(values), lower_for_shape_fn);
+}
+
+xla::Shape EmbeddingGradOutputShape(const torch::lazy::Value& grad,
+                                           int64_t num_weights) {
+  const xla::Shape& grad_shape = GetXlaShape(grad);
+  return xla::ShapeUtil::MakeShape(
+      grad_shape.element_type(),
+      {num_weights, grad_shape.dimensions(grad_shape.rank() - 1)});
+}
+
+}  // namespace
+
+EmbeddingBag::EmbeddingBag(
+    const torch::lazy::Value& weight, const torch::lazy::Value& indices,
+    const torch::lazy::Value& offsets,
+    const absl::optional<torch::lazy::Value>& per_sample_weights,
+    EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx)
+    : XlaNode(torch::lazy::OpKind(at::aten::_embedding_bag),
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {weight, indices, offsets}, {&per_sample_weights}),
+              [&]() {
+                return EmbeddingBagOutputShape(
+                    xla::util::GetValuesVector<torch::lazy::Value>(
+                        {weight, indices, offsets}, {&per_sample_weights}),
+                    mode, include_last_offset, padding_idx);
+              },
+              /*num_outputs=*/4,
+              torch::lazy::MHash(torch::lazy::GetEnumValue(mode),
+                                 include_last_offset, padding_idx)),
+      mode_(mode),
+      include_last_offset_(include_last_offset),
+      padding_idx_(padding_idx) {}
+
+torch::lazy::NodePtr EmbeddingBag::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<EmbeddingBag>(
+      operands.at(0), operands.at(1), operands.at(2),
+      OptionalOperand(operands, 3), mode_, include_last_offset_, padding_idx_);
+}
+
+XlaOpVector EmbeddingBag::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> inputs;
+  for (auto& operand : operands()) {
+    inputs.push_back(loctx->GetOutputOp(operand));
+  }
+  EmbeddingBagResult result =
+      BuildEmbeddingBag(inputs[0], inputs[1], inputs[2],
+                        OptionalOperand(inputs, 3), mode_,
+                        include_last_offset_, padding_idx_);
+  return ReturnOps({result.output, result.offset2bag, result.bag_size,
+                    result.max_indices},
+                   loctx);
+}
+
+std::string EmbeddingBag::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", mode=" << ModeName(mode_)
+     << ", include_last_offset=" << include_last_offset_
+     << ", padding_idx=" << padding_idx_;
+  return ss.str();
+}
+
+EmbeddingBagBackward::EmbeddingBagBackward(
+    const torch::lazy::Value& grad, const torch::lazy::Value& indices,
+    const torch::lazy::Value& offset2bag, const torch::lazy::Value& bag_size,
+    const torch::lazy::Value& max_indices,
+    const absl::optional<torch::lazy::Value>& per_sample_weights,
+    int64_t num_weights, EmbeddingBagMode mode, bool scale_grad_by_freq,
+    int64_t padding_idx)
+    : XlaNode(torch::lazy::OpKind(at::aten::_embedding_bag_dense_backward),
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {grad, indices, offset2bag, bag_size, max_indices},
+                  {&per_sample_weights}),
+              EmbeddingGradOutputShape(grad, num_weights),
+              /*num_outputs=*/1,
+              torch::lazy::MHash(num_weights, torch::lazy::GetEnumValue(mode),
+                                 scale_grad_by_freq, padding_idx)),
+      num_weights_(num_weights),
+      mode_(mode),
+      scale_grad_by_freq_(scale_grad_by_freq),
+      padding_idx_(padding_idx) {}
+
+torch::lazy::NodePtr EmbeddingBagBackward::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<EmbeddingBagBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3),
+      operands.at(4), OptionalOperand(operands, 5), num_weights_, mode_,
+      scale_grad_by_freq_, padding_idx_);
+}
+
+XlaOpVector EmbeddingBagBackward::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> inputs;
+  for (auto& operand : operands()) {
+    inputs.push_back(loctx->GetOutputOp(operand));
+  }
+  return ReturnOp(
+      BuildEmbeddingBagBackward(inputs[0], inputs[1], inputs[2], inputs[3],
+                                inputs[4], OptionalOperand(inputs, 5),
+                                num_weights_, mode_, scale_grad_by_freq_,
+                                padding_idx_),
+      loctx);
+}
+
+std::string EmbeddingBagBackward::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", num_weights=" << num_weights_
+     << ", mode=" << ModeName(mode_)
+     << ", scale_grad_by_freq=" << scale_grad_by_freq_
+     << ", padding_idx=" << padding_idx_;
+  return ss.str();
+}
+
+EmbeddingDenseBackward::EmbeddingDenseBackward(
+    const torch::lazy::Value& grad, const torch::lazy::Value& indices,
+    int64_t num_weights, int64_t padding_idx, bool scale_grad_by_freq)
+    : XlaNode(torch::lazy::OpKind(at::aten::embedding_dense_backward),
+              {grad, indices},
+              EmbeddingGradOutputShape(grad, num_weights),
+              /*num_outputs=*/1,
+              torch::lazy::MHash(num_weights, padding_idx,
+                                 scale_grad_by_freq)),
+      num_weights_(num_weights),
+      padding_idx_(padding_idx),
+      scale_grad_by_freq_(scale_grad_by_freq) {}
+
+torch::lazy::NodePtr EmbeddingDenseBackward::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<EmbeddingDenseBackward>(
+      operands.at(0), operands.at(1), num_weights_, padding_idx_,
+      scale_grad_by_freq_);
+}
+
+XlaOpVector EmbeddingDenseBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad = loctx->GetOutputOp(operand(0));
+  xla::XlaOp indices = loctx->GetOutputOp(operand(1));
+  return ReturnOp(BuildEmbeddingDenseBackward(grad, indices, num_weights_,
+                                              padding_idx_,
+                                              scale_grad_by_freq_),
+                  loctx);
+}
+
+std::string EmbeddingDenseBackward::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", num_weights=" << num_weights_
+     << ", padding_idx=" << padding_idx_
+     << ", scale_grad_by_freq=" << scale_grad_by_freq_;
+  return ss.str();
+}
+
+EmbeddingBagSparseSgd::EmbeddingBagSparseSgd(
+    const torch::lazy::Value& weight, const torch::lazy::Value& grad,
+    const torch::lazy::Value& indices, const torch::lazy::Value& offsets,
+    const torch::lazy::Value& lr,
+    const absl::optional<torch::lazy::Value>& per_sample_weights,
+    EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx)
+    : XlaNode(xla_embedding_bag_sparse_sgd,
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {weight, grad, indices, offsets, lr},
+                  {&per_sample_weights}),
+              GetXlaShape(weight),
+              /*num_outputs=*/1,
+              torch::lazy::MHash(torch::lazy::GetEnumValue(mode),
+                                 include_last_offset, padding_idx)),
+      mode_(mode),
+      include_last_offset_(include_last_offset),
+      padding_idx_(padding_idx) {}
+
+torch::lazy::NodePtr EmbeddingBagSparseSgd::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<EmbeddingBagSparseSgd>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3),
+      operands.at(4), OptionalOperand(operands, 5), mode_,
+      include_last_offset_, padding_idx_);
+}
+
+XlaOpVector EmbeddingBagSparseSgd::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> inputs;
+  for (auto& operand : operands()) {
+    inputs.push_back(loctx->GetOutputOp(operand));
+  }
+  return ReturnOp(BuildEmbeddingBagSparseSgd(
+                      inputs[0], inputs[1], inputs[2], inputs[3],
+                      OptionalOperand(inputs, 5), inputs[4], mode_,
+                      include_last_offset_, padding_idx_),
+                  loctx);
+}
+
+std::string EmbeddingBagSparseSgd::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", mode=" << ModeName(mode_)
+     << ", include_last_offset=" << include_last_offset_
+     << ", padding_idx=" << padding_idx_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
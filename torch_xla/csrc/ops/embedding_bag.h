@@ -0,0 +1,124 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "torch_xla/csrc/embedding_ops.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Outputs the bags output, offset2bag, bag_size and max_indices, like the ATen
+// _embedding_bag() operation.
+class EmbeddingBag : public XlaNode {
+ public:
+  EmbeddingBag(const torch::lazy::Value& weight,
+               const torch::lazy::Value& indices,
+               const torch::lazy::Value& offsets,
+               const absl::optional<torch::lazy::Value>& per_sample_weights,
+               EmbeddingBagMode mode, bool include_last_offset,
+               int64_t padding_idx);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  EmbeddingBagMode mode() const { return mode_; }
+
+  bool include_last_offset() const { return include_last_offset_; }
+
+  int64_t padding_idx() const { return padding_idx_; }
+
+ private:
+  EmbeddingBagMode mode_;
+  bool include_last_offset_;
+  int64_t padding_idx_;
+};
+
+// The gradient of the weight of an EmbeddingBag node.
+class EmbeddingBagBackward : public XlaNode {
+ public:
+  EmbeddingBagBackward(
+      const torch::lazy::Value& grad, const torch::lazy::Value& indices,
+      const torch::lazy::Value& offset2bag, const torch::lazy::Value& bag_size,
+      const torch::lazy::Value& max_indices,
+      const absl::optional<torch::lazy::Value>& per_sample_weights,
+      int64_t num_weights, EmbeddingBagMode mode, bool scale_grad_by_freq,
+      int64_t padding_idx);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  int64_t num_weights() const { return num_weights_; }
+
+  EmbeddingBagMode mode() const { return mode_; }
+
+  bool scale_grad_by_freq() const { return scale_grad_by_freq_; }
+
+  int64_t padding_idx() const { return padding_idx_; }
+
+ private:
+  int64_t num_weights_;
+  EmbeddingBagMode mode_;
+  bool scale_grad_by_freq_;
+  int64_t padding_idx_;
+};
+
+class EmbeddingDenseBackward : public XlaNode {
+ public:
+  EmbeddingDenseBackward(const torch::lazy::Value& grad,
+                         const torch::lazy::Value& indices,
+                         int64_t num_weights, int64_t padding_idx,
+                         bool scale_grad_by_freq);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  int64_t num_weights() const { return num_weights_; }
+
+  int64_t padding_idx() const { return padding_idx_; }
+
+  bool scale_grad_by_freq() const { return scale_grad_by_freq_; }
+
+ private:
+  int64_t num_weights_;
+  int64_t padding_idx_;
+  bool scale_grad_by_freq_;
+};
+
+// Outputs the weight of an embedding bag after an SGD step, given the gradient
+// of the bags output. Only the rows selected by the indices get updated.
+class EmbeddingBagSparseSgd : public XlaNode {
+ public:
+  EmbeddingBagSparseSgd(
+      const torch::lazy::Value& weight, const torch::lazy::Value& grad,
+      const torch::lazy::Value& indices, const torch::lazy::Value& offsets,
+      const torch::lazy::Value& lr,
+      const absl::optional<torch::lazy::Value>& per_sample_weights,
+      EmbeddingBagMode mode, bool include_last_offset, int64_t padding_idx);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  EmbeddingBagMode mode() const { return mode_; }
+
+  bool include_last_offset() const { return include_last_offset_; }
+
+  int64_t padding_idx() const { return padding_idx_; }
+
+ private:
+  EmbeddingBagMode mode_;
+  bool include_last_offset_;
+  int64_t padding_idx_;
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,156 @@
+#include "torch_xla/csrc/ops/flash_attention.h"
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/flash_attention.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace {
+
+std::vector<xla::Shape> GetOperandShapes(
+    absl::Span<const torch::lazy::Value> operands) {
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(GetXlaShape(operand));
+  }
+  return shapes;
+}
+
+xla::Shape NodeOutputShape(const torch::lazy::Value& query,
+                           const torch::lazy::Value& key,
+                           const torch::lazy::Value& value,
+                           const absl::optional<torch::lazy::Value>& mask,
+                           double scale, bool is_causal, int64_t block_size) {
+  auto lower_for_shape_fn =
+      [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    absl::optional<xla::XlaOp> mask;
+    if (operands.size() > 3) {
+      mask = operands[3];
+    }
+    FlashAttentionResult result =
+        BuildFlashAttention(operands[0], operands[1], operands[2], mask, scale,
+                            is_causal, block_size);
+    return xla::Tuple(operands[0].builder(),
+                      {result.output, result.logsumexp});
+  };
+  std::vector<torch::lazy::Value> operands =
+      xla::util::GetValuesVector<torch::lazy::Value>({query, key, value},
+                                                     {&mask});
+  return InferOutputShape(GetOperandShapes(operands), lower_for_shape_fn);
+}
+
+xla::Shape NodeOutputShape(const torch::lazy::Value& query,
+                           const torch::lazy::Value& key,
+                           const torch::lazy::Value& value) {
+  return xla::ShapeUtil::MakeTupleShape(
+      {GetXlaShape(query), GetXlaShape(key), GetXlaShape(value)});
+}
+
+}  // namespace
+
+FlashAttention::FlashAttention(const torch::lazy::Value& query,
+                               const torch::lazy::Value& key,
+                               const torch::lazy::Value& value,
+                               const absl::optional<torch::lazy::Value>& mask,
+                               double scale, bool is_causal,
+                               int64_t block_size)
+    : XlaNode(xla_flash_attention,
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {query, key, value}, {&mask}),
+              [&]() {
+                return NodeOutputShape(query, key, value, mask, scale,
+                                       is_causal, block_size);
+              },
+              /*num_outputs=*/2,
+              torch::lazy::MHash(scale, is_causal, block_size)),
+      scale_(scale),
+      is_causal_(is_causal),
+      block_size_(block_size) {}
+
+torch::lazy::NodePtr FlashAttention::Clone(torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> mask;
+  if (operands.size() > 3) {
+    mask = operands.at(3);
+  }
+  return torch::lazy::MakeNode<FlashAttention>(operands.at(0), operands.at(1),
+                                               operands.at(2), mask, scale_,
+                                               is_causal_, block_size_);
+}
+
+XlaOpVector FlashAttention::Lower(LoweringContext* loctx) const {
+  xla::XlaOp query = loctx->GetOutputOp(operand(0));
+  xla::XlaOp key = loctx->GetOutputOp(operand(1));
+  xla::XlaOp value = loctx->GetOutputOp(operand(2));
+  absl::optional<xla::XlaOp> mask;
+  if (operands().size() > 3) {
+    mask = loctx->GetOutputOp(operand(3));
+  }
+  FlashAttentionResult result = BuildFlashAttention(
+      query, key, value, mask, scale_, is_causal_, block_size_);
+  return ReturnOps({result.output, result.logsumexp}, loctx);
+}
+
+std::string FlashAttention::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", scale=" << scale_
+     << ", is_causal=" << is_causal_ << ", block_size=" << block_size_;
+  return ss.str();
+}
+
+FlashAttentionBackward::FlashAttentionBackward(
+    const torch::lazy::Value& grad_output, const torch::lazy::Value& query,
+    const torch::lazy::Value& key, const torch::lazy::Value& value,
+    const torch::lazy::Value& output, const torch::lazy::Value& logsumexp,
+    const absl::optional<torch::lazy::Value>& mask, double scale,
+    bool is_causal, int64_t block_size)
+    : XlaNode(xla_flash_attention_backward,
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {grad_output, query, key, value, output, logsumexp},
+                  {&mask}),
+              [&]() { return NodeOutputShape(query, key, value); },
+              /*num_outputs=*/3,
+              torch::lazy::MHash(scale, is_causal, block_size)),
+      scale_(scale),
+      is_causal_(is_causal),
+      block_size_(block_size) {}
+
+torch::lazy::NodePtr FlashAttentionBackward::Clone(
+    torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> mask;
+  if (operands.size() > 6) {
+    mask = operands.at(6);
+  }
+  return torch::lazy::MakeNode<FlashAttentionBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3),
+      operands.at(4), operands.at(5), mask, scale_, is_causal_, block_size_);
+}
+
+XlaOpVector FlashAttentionBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
+  xla::XlaOp query = loctx->GetOutputOp(operand(1));
+  xla::XlaOp key = loctx->GetOutputOp(operand(2));
+  xla::XlaOp value = loctx->GetOutputOp(operand(3));
+  xla::XlaOp output = loctx->GetOutputOp(operand(4));
+  xla::XlaOp logsumexp = loctx->GetOutputOp(operand(5));
+  absl::optional<xla::XlaOp> mask;
+  if (operands().size() > 6) {
+    mask = loctx->GetOutputOp(operand(6));
+  }
+  FlashAttentionGrads grads = BuildFlashAttentionBackward(
+      grad_output, query, key, value, output, logsumexp, mask, scale_,
+      is_causal_, block_size_);
+  return ReturnOps({grads.grad_query, grads.grad_key, grads.grad_value},
+                   loctx);
+}
+
+std::string FlashAttentionBackward::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", scale=" << scale_
+     << ", is_causal=" << is_causal_ << ", block_size=" << block_size_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
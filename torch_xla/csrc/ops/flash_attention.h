@@ -0,0 +1,67 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Scaled dot product attention, with the keys processed in blocks so that the
+// memory use is linear in the sequence length. Outputs the attention output and
+// the logsumexp of the scores rows, which the backward node consumes.
+class FlashAttention : public XlaNode {
+ public:
+  FlashAttention(const torch::lazy::Value& query,
+                 const torch::lazy::Value& key,
+                 const torch::lazy::Value& value,
+                 const absl::optional<torch::lazy::Value>& mask, double scale,
+                 bool is_causal, int64_t block_size);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double scale() const { return scale_; }
+
+  bool is_causal() const { return is_causal_; }
+
+  int64_t block_size() const { return block_size_; }
+
+ private:
+  double scale_;
+  bool is_causal_;
+  int64_t block_size_;
+};
+
+// Outputs the gradients of the query, key and value of a FlashAttention node.
+class FlashAttentionBackward : public XlaNode {
+ public:
+  FlashAttentionBackward(const torch::lazy::Value& grad_output,
+                         const torch::lazy::Value& query,
+                         const torch::lazy::Value& key,
+                         const torch::lazy::Value& value,
+                         const torch::lazy::Value& output,
+                         const torch::lazy::Value& logsumexp,
+                         const absl::optional<torch::lazy::Value>& mask,
+                         double scale, bool is_causal, int64_t block_size);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double scale() const { return scale_; }
+
+  bool is_causal() const { return is_causal_; }
+
+  int64_t block_size() const { return block_size_; }
+
+ private:
+  double scale_;
+  bool is_causal_;
+  int64_t block_size_;
+};
+
+}  // namespace torch_xla
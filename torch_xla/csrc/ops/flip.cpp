@@ -1,6 +1,7 @@
 #include "torch_xla/csrc/ops/flip.h"
 
 #include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
 
 namespace torch_xla {
@@ -16,7 +17,16 @@ torch::lazy::NodePtr Flip::Clone(torch::lazy::OpList operands) const {
 
 XlaOpVector Flip::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  xla::XlaOp output = xla::Rev(input, dims_);
+  // The reverse is an index remap which already fuses into the consumers, so
+  // only the no-op reverses of the dimensions of size one are left out.
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  std::vector<int64_t> rev_dims;
+  for (int64_t dim : dims_) {
+    if (input_shape.dimensions(dim) > 1) {
+      rev_dims.push_back(dim);
+    }
+  }
+  xla::XlaOp output = rev_dims.empty() ? input : xla::Rev(input, rev_dims);
   return ReturnOp(output, loctx);
 }
 
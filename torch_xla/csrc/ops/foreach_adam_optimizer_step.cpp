@@ -0,0 +1,77 @@
+#include "torch_xla/csrc/ops/foreach_adam_optimizer_step.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+size_t GetNumParams(const torch::lazy::OpList& operands) {
+  XLA_CHECK_EQ((operands.size() - ForeachAdamOptimizerStep::kScalarOperands) %
+                   ForeachAdamOptimizerStep::kParamOperands,
+               0);
+  return (operands.size() - ForeachAdamOptimizerStep::kScalarOperands) /
+         ForeachAdamOptimizerStep::kParamOperands;
+}
+
+xla::Shape NodeOutputShape(const torch::lazy::OpList& operands) {
+  std::vector<xla::Shape> shapes;
+  for (size_t i = ForeachAdamOptimizerStep::kScalarOperands;
+       i < operands.size(); i += ForeachAdamOptimizerStep::kParamOperands) {
+    const xla::Shape& param_shape = GetXlaShape(operands[i + 1]);
+    shapes.push_back(/*step=*/GetXlaShape(operands[i]));
+    shapes.push_back(/*param=*/param_shape);
+    shapes.push_back(/*exp_avg=*/param_shape);
+    shapes.push_back(/*exp_avg_sq=*/param_shape);
+    shapes.push_back(/*max_exp_avg_sq=*/param_shape);
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+}  // namespace
+
+ForeachAdamOptimizerStep::ForeachAdamOptimizerStep(
+    const torch::lazy::OpList& operands, bool use_weight_decay,
+    bool use_amsgrad, bool use_adamw)
+    : XlaNode(xla_foreach_adam_optimizer_step, operands,
+              NodeOutputShape(operands),
+              /*num_outputs=*/GetNumParams(operands) * kParamOutputs,
+              torch::lazy::MHash(use_weight_decay, use_amsgrad, use_adamw)),
+      use_weight_decay_(use_weight_decay),
+      use_amsgrad_(use_amsgrad),
+      use_adamw_(use_adamw) {}
+
+torch::lazy::NodePtr ForeachAdamOptimizerStep::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<ForeachAdamOptimizerStep>(
+      operands, use_weight_decay_, use_amsgrad_, use_adamw_);
+}
+
+XlaOpVector ForeachAdamOptimizerStep::Lower(LoweringContext* loctx) const {
+  xla::XlaOp found_inf = loctx->GetOutputOp(operand(0));
+  xla::XlaOp beta1 = loctx->GetOutputOp(operand(1));
+  xla::XlaOp beta2 = loctx->GetOutputOp(operand(2));
+  xla::XlaOp lr = loctx->GetOutputOp(operand(3));
+  xla::XlaOp weight_decay = loctx->GetOutputOp(operand(4));
+  xla::XlaOp eps = loctx->GetOutputOp(operand(5));
+  std::vector<xla::XlaOp> results;
+  for (size_t i = kScalarOperands; i < operands().size();
+       i += kParamOperands) {
+    xla::XlaOp param = loctx->GetOutputOp(operand(i + 1));
+    xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(param);
+    std::vector<xla::XlaOp> param_results = BuildAdamOptimizerStep(
+        found_inf, loctx->GetOutputOp(operand(i)), param,
+        loctx->GetOutputOp(operand(i + 2)), loctx->GetOutputOp(operand(i + 3)),
+        loctx->GetOutputOp(operand(i + 4)), loctx->GetOutputOp(operand(i + 5)),
+        beta1, beta2, lr, xla::ConvertElementType(weight_decay, type),
+        xla::ConvertElementType(eps, type), use_weight_decay_, use_amsgrad_,
+        use_adamw_);
+    results.insert(results.end(), param_results.begin(), param_results.end());
+  }
+  return ReturnOps(results, loctx);
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Adam (or AdamW) step of a list of parameters within a single node. The
+// operands are the found_inf, beta1, beta2, lr, weight_decay and eps scalars,
+// followed by the step, param, grad, exp_avg, exp_avg_sq and max_exp_avg_sq of
+// every parameter. The outputs are the new step, param, exp_avg, exp_avg_sq and
+// max_exp_avg_sq of every parameter.
+class ForeachAdamOptimizerStep : public XlaNode {
+ public:
+  static constexpr size_t kScalarOperands = 6;
+  static constexpr size_t kParamOperands = 6;
+  static constexpr size_t kParamOutputs = 5;
+
+  ForeachAdamOptimizerStep(const torch::lazy::OpList& operands,
+                           bool use_weight_decay, bool use_amsgrad,
+                           bool use_adamw);
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+ private:
+  bool use_weight_decay_;
+  bool use_amsgrad_;
+  bool use_adamw_;
+};
+
+}  // namespace torch_xla
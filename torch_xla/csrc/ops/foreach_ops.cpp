@@ -0,0 +1,285 @@
+#include "torch_xla/csrc/ops/foreach_ops.h"
+
+#include <cmath>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/reduction.h"
+
+namespace torch_xla {
+namespace {
+
+std::string KindName(ForeachPointwise::Kind kind) {
+  switch (kind) {
+    case ForeachPointwise::Kind::kAddScalar:
+      return "add_scalar";
+    case ForeachPointwise::Kind::kAddList:
+      return "add_list";
+    case ForeachPointwise::Kind::kMulScalar:
+      return "mul_scalar";
+    case ForeachPointwise::Kind::kMulList:
+      return "mul_list";
+    case ForeachPointwise::Kind::kAddcmul:
+      return "addcmul";
+  }
+  XLA_ERROR() << "Invalid foreach kind: " << static_cast<int>(kind);
+}
+
+size_t GetNumElements(const torch::lazy::OpList& operands,
+                      ForeachPointwise::Kind kind) {
+  size_t num_scalars = ForeachPointwise::NumScalarOperands(kind);
+  size_t num_tensors = ForeachPointwise::NumTensorOperands(kind);
+  XLA_CHECK_GE(operands.size(), num_scalars);
+  XLA_CHECK_EQ((operands.size() - num_scalars) % num_tensors, 0);
+  return (operands.size() - num_scalars) / num_tensors;
+}
+
+xla::Shape PointwiseOutputShape(const torch::lazy::OpList& operands,
+                                ForeachPointwise::Kind kind) {
+  std::vector<xla::Shape> shapes;
+  for (size_t i = ForeachPointwise::NumScalarOperands(kind);
+       i < operands.size(); i += ForeachPointwise::NumTensorOperands(kind)) {
+    shapes.push_back(GetXlaShape(operands[i]));
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+xla::Shape NormOutputShape(const torch::lazy::OpList& operands) {
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(
+        xla::ShapeUtil::MakeShape(GetXlaShape(operand).element_type(), {}));
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+xla::Shape ClipNormOutputShape(const torch::lazy::OpList& operands) {
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(GetXlaShape(operand));
+  }
+  shapes.push_back(xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32, {}));
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+xla::XlaOp BuildPointwise(ForeachPointwise::Kind kind,
+                          absl::Span<const xla::XlaOp> scalars,
+                          absl::Span<const xla::XlaOp> tensors) {
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(tensors[0]);
+  switch (kind) {
+    case ForeachPointwise::Kind::kAddScalar:
+      return tensors[0] + xla::ConvertElementType(scalars[0], type);
+    case ForeachPointwise::Kind::kAddList:
+      return tensors[0] +
+             tensors[1] * xla::ConvertElementType(scalars[0], type);
+    case ForeachPointwise::Kind::kMulScalar:
+      return tensors[0] * xla::ConvertElementType(scalars[0], type);
+    case ForeachPointwise::Kind::kMulList:
+      return tensors[0] * tensors[1];
+    case ForeachPointwise::Kind::kAddcmul:
+      return tensors[0] + xla::ConvertElementType(scalars[0], type) *
+                              tensors[1] * tensors[2];
+  }
+  XLA_ERROR() << "Invalid foreach kind: " << static_cast<int>(kind);
+}
+
+xla::XlaOp BuildNorm(xla::XlaOp input, double norm_type) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  std::vector<int64_t> dimensions = torch::lazy::Iota<int64_t>(shape.rank());
+  xla::XlaBuilder* builder = input.builder();
+  if (std::isinf(norm_type)) {
+    return norm_type > 0
+               ? BuildMaxInDims(xla::Abs(input), dimensions,
+                                /*keep_reduced_dimensions=*/false)
+               : BuildMinInDims(xla::Abs(input), dimensions,
+                                /*keep_reduced_dimensions=*/false);
+  }
+  if (norm_type == 0) {
+    xla::XlaOp zero = xla::Zero(builder, shape.element_type());
+    return BuildSum(xla::ConvertElementType(xla::Ne(input, zero),
+                                            shape.element_type()),
+                    dimensions, /*keep_reduced_dimensions=*/false);
+  }
+  if (norm_type == 1) {
+    return BuildSum(xla::Abs(input), dimensions,
+                    /*keep_reduced_dimensions=*/false);
+  }
+  if (norm_type == 2) {
+    return xla::Sqrt(BuildSum(input * input, dimensions,
+                              /*keep_reduced_dimensions=*/false));
+  }
+  xla::XlaOp exponent =
+      XlaHelpers::ScalarValue<double>(norm_type, shape.element_type(), builder);
+  xla::XlaOp inv_exponent = XlaHelpers::ScalarValue<double>(
+      1.0 / norm_type, shape.element_type(), builder);
+  return xla::Pow(BuildSum(xla::Pow(xla::Abs(input), exponent), dimensions,
+                           /*keep_reduced_dimensions=*/false),
+                  inv_exponent);
+}
+
+// Combines the (F32) norms of a list of tensors into the norm of their
+// concatenation.
+xla::XlaOp BuildGlobalNorm(absl::Span<const xla::XlaOp> norms,
+                           double norm_type, xla::XlaBuilder* builder) {
+  if (norms.empty()) {
+    return xla::Zero(builder, xla::PrimitiveType::F32);
+  }
+  xla::XlaOp result;
+  for (size_t i = 0; i < norms.size(); ++i) {
+    xla::XlaOp norm = norms[i];
+    if (std::isinf(norm_type)) {
+      result = i == 0 ? norm
+                      : (norm_type > 0 ? xla::Max(result, norm)
+                                       : xla::Min(result, norm));
+      continue;
+    }
+    if (norm_type != 0 && norm_type != 1) {
+      norm = norm_type == 2 ? norm * norm
+                            : xla::Pow(norm, xla::ScalarLike(norm, norm_type));
+    }
+    result = i == 0 ? norm : result + norm;
+  }
+  if (std::isinf(norm_type) || norm_type == 0 || norm_type == 1) {
+    return result;
+  }
+  if (norm_type == 2) {
+    return xla::Sqrt(result);
+  }
+  return xla::Pow(result, xla::ScalarLike(result, 1.0 / norm_type));
+}
+
+}  // namespace
+
+ForeachPointwise::ForeachPointwise(const torch::lazy::OpList& operands,
+                                   Kind kind)
+    : XlaNode(xla_foreach_pointwise, operands,
+              PointwiseOutputShape(operands, kind),
+              /*num_outputs=*/GetNumElements(operands, kind),
+              torch::lazy::MHash(torch::lazy::GetEnumValue(kind))),
+      kind_(kind) {}
+
+size_t ForeachPointwise::NumScalarOperands(Kind kind) {
+  return kind == Kind::kMulList ? 0 : 1;
+}
+
+size_t ForeachPointwise::NumTensorOperands(Kind kind) {
+  switch (kind) {
+    case Kind::kAddScalar:
+    case Kind::kMulScalar:
+      return 1;
+    case Kind::kAddList:
+    case Kind::kMulList:
+      return 2;
+    case Kind::kAddcmul:
+      return 3;
+  }
+  XLA_ERROR() << "Invalid foreach kind: " << static_cast<int>(kind);
+}
+
+torch::lazy::NodePtr ForeachPointwise::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<ForeachPointwise>(operands, kind_);
+}
+
+XlaOpVector ForeachPointwise::Lower(LoweringContext* loctx) const {
+  size_t num_scalars = NumScalarOperands(kind_);
+  size_t num_tensors = NumTensorOperands(kind_);
+  std::vector<xla::XlaOp> scalars;
+  for (size_t i = 0; i < num_scalars; ++i) {
+    scalars.push_back(loctx->GetOutputOp(operand(i)));
+  }
+  std::vector<xla::XlaOp> results;
+  for (size_t i = num_scalars; i < operands().size(); i += num_tensors) {
+    std::vector<xla::XlaOp> tensors;
+    for (size_t j = 0; j < num_tensors; ++j) {
+      tensors.push_back(loctx->GetOutputOp(operand(i + j)));
+    }
+    results.push_back(BuildPointwise(kind_, scalars, tensors));
+  }
+  return ReturnOps(results, loctx);
+}
+
+std::string ForeachPointwise::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", kind=" << KindName(kind_);
+  return ss.str();
+}
+
+ForeachNorm::ForeachNorm(const torch::lazy::OpList& operands,
+                         double norm_type)
+    : XlaNode(xla_foreach_norm, operands, NormOutputShape(operands),
+              /*num_outputs=*/operands.size(), torch::lazy::MHash(norm_type)),
+      norm_type_(norm_type) {}
+
+torch::lazy::NodePtr ForeachNorm::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<ForeachNorm>(operands, norm_type_);
+}
+
+XlaOpVector ForeachNorm::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> results;
+  for (auto& input : operands()) {
+    results.push_back(BuildNorm(loctx->GetOutputOp(input), norm_type_));
+  }
+  return ReturnOps(results, loctx);
+}
+
+std::string ForeachNorm::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", norm_type=" << norm_type_;
+  return ss.str();
+}
+
+ForeachClipNorm::ForeachClipNorm(const torch::lazy::OpList& operands,
+                                 double max_norm, double norm_type)
+    : XlaNode(xla_foreach_clip_norm, operands, ClipNormOutputShape(operands),
+              /*num_outputs=*/operands.size() + 1,
+              torch::lazy::MHash(max_norm, norm_type)),
+      max_norm_(max_norm),
+      norm_type_(norm_type) {}
+
+torch::lazy::NodePtr ForeachClipNorm::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<ForeachClipNorm>(operands, max_norm_,
+                                                norm_type_);
+}
+
+XlaOpVector ForeachClipNorm::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> inputs;
+  std::vector<xla::XlaOp> norms;
+  for (auto& operand : operands()) {
+    xla::XlaOp input = loctx->GetOutputOp(operand);
+    inputs.push_back(input);
+    norms.push_back(BuildNorm(
+        xla::ConvertElementType(input, xla::PrimitiveType::F32), norm_type_));
+  }
+  xla::XlaOp total_norm =
+      BuildGlobalNorm(norms, norm_type_, loctx->builder());
+  // Same epsilon as torch.nn.utils.clip_grad_norm_(), and the tensors are only
+  // scaled down.
+  xla::XlaOp coef = xla::Min(
+      xla::ScalarLike(total_norm, max_norm_) /
+          (total_norm + xla::ScalarLike(total_norm, 1e-6)),
+      xla::One(loctx->builder(), xla::PrimitiveType::F32));
+  std::vector<xla::XlaOp> results;
+  for (auto& input : inputs) {
+    results.push_back(
+        input *
+        xla::ConvertElementType(coef, XlaHelpers::TypeOfXlaOp(input)));
+  }
+  results.push_back(total_norm);
+  return ReturnOps(results, loctx);
+}
+
+std::string ForeachClipNorm::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", max_norm=" << max_norm_
+     << ", norm_type=" << norm_type_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
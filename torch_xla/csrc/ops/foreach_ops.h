@@ -0,0 +1,83 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Elementwise operation over lists of tensors within a single node, so that a
+// model with many (small) parameters lowers one node per optimizer stage
+// instead of one subgraph per parameter. The operands are the scalar operands
+// of the operation, shared by all the list elements, followed by the tensor
+// operands of every list element. The outputs are the results for every list
+// element, with the shape of the first tensor operand of such element.
+class ForeachPointwise : public XlaNode {
+ public:
+  enum class Kind {
+    // self + scalar
+    kAddScalar,
+    // self + alpha * other
+    kAddList,
+    // self * scalar
+    kMulScalar,
+    // self * other
+    kMulList,
+    // self + value * tensor1 * tensor2
+    kAddcmul,
+  };
+
+  ForeachPointwise(const torch::lazy::OpList& operands, Kind kind);
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  // The number of scalar operands preceding the tensor operands.
+  static size_t NumScalarOperands(Kind kind);
+
+  // The number of tensor operands of every list element.
+  static size_t NumTensorOperands(Kind kind);
+
+ private:
+  Kind kind_;
+};
+
+// The p-norm of every tensor in a list, within a single node. The outputs are
+// the (rank zero) norms of the input operands. An infinite norm_type computes
+// the max (or min, if negative) absolute value, and a zero one the number of
+// non zero values.
+class ForeachNorm : public XlaNode {
+ public:
+  ForeachNorm(const torch::lazy::OpList& operands, double norm_type);
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+ private:
+  double norm_type_;
+};
+
+// Scales a list of tensors so that their global p-norm (the norm of the
+// concatenation of all of them) is at most max_norm. The outputs are the
+// scaled tensors, followed by the (F32, rank zero) global norm of the inputs.
+class ForeachClipNorm : public XlaNode {
+ public:
+  ForeachClipNorm(const torch::lazy::OpList& operands, double max_norm,
+                  double norm_type);
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+ private:
+  double max_norm_;
+  double norm_type_;
+};
+
+}  // namespace torch_xla
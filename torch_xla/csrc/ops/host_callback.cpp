@@ -0,0 +1,32 @@
+#include "torch_xla/csrc/ops/host_callback.h"
+
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+
+HostCallback::HostCallback(const torch::lazy::Value& input,
+                           int64_t callback_id)
+    : XlaNode(xla_host_callback, {input}, GetXlaShape(input),
+              /*num_outputs=*/1, torch::lazy::MHash(callback_id)),
+      callback_id_(callback_id) {}
+
+torch::lazy::NodePtr HostCallback::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<HostCallback>(operands.at(0), callback_id_);
+}
+
+XlaOpVector HostCallback::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  loctx->SetOutfeedToken(BuildHostCallbackOutfeed(
+      input, loctx->GetOutfeedToken(), callback_id_));
+  return ReturnOp(input, loctx);
+}
+
+std::string HostCallback::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", callback_id=" << callback_id_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Streams the input to the host callback with the given ID, through the device
+// outfeed, while the computation runs. The output is the input, which the
+// consumers must use in its place for the callback to be part of the graph.
+class HostCallback : public XlaNode {
+ public:
+  HostCallback(const torch::lazy::Value& input, int64_t callback_id);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  int64_t callback_id() const { return callback_id_; }
+
+ private:
+  int64_t callback_id_;
+};
+
+}  // namespace torch_xla
@@ -12,7 +12,9 @@ IndexPut::IndexPut(const torch::lazy::Value& base,
               GetXlaShape(base),
               /*num_outputs=*/1, torch::lazy::MHash(start_dim, accumulate)),
       start_dim_(start_dim),
-      accumulate_(accumulate) {}
+      accumulate_(accumulate) {
+  MarkInPlaceUpdate();
+}
 
 std::string IndexPut::ToString() const {
   std::stringstream ss;
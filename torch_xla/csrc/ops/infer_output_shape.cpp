@@ -1,5 +1,6 @@
 #include "torch_xla/csrc/ops/infer_output_shape.h"
 
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "torch_xla/csrc/helpers.h"
 
 namespace torch_xla {
@@ -18,4 +19,87 @@ xla::Shape InferOutputShape(absl::Span<const xla::Shape> input_shapes,
   return XlaHelpers::ShapeOfXlaOp(result);
 }
 
+xla::Shape InferBinaryOpShape(const xla::Shape& shape1,
+                              const xla::Shape& shape2,
+                              const LowerForShapeFn& core_lowering_fn) {
+  if (shape1.is_dynamic() || shape2.is_dynamic()) {
+    return InferOutputShape({shape1, shape2}, core_lowering_fn);
+  }
+  return XlaHelpers::GetPromotedBinaryOpShape(shape1, shape2);
+}
+
+xla::Shape InferComparisonOpShape(const xla::Shape& shape1,
+                                  const xla::Shape& shape2,
+                                  const LowerForShapeFn& core_lowering_fn) {
+  if (shape1.is_dynamic() || shape2.is_dynamic()) {
+    return InferOutputShape({shape1, shape2}, core_lowering_fn);
+  }
+  xla::Shape shape = XlaHelpers::GetPromotedShape(shape1, shape2);
+  shape.set_element_type(xla::PrimitiveType::PRED);
+  return shape;
+}
+
+xla::Shape InferTransposeShape(const xla::Shape& shape,
+                               absl::Span<const int64_t> permutation) {
+  XLA_CHECK_EQ(shape.rank(), permutation.size()) << shape;
+  std::vector<int64_t> dimensions;
+  std::vector<bool> dynamic_dimensions;
+  for (auto dim : permutation) {
+    dimensions.push_back(shape.dimensions(dim));
+    dynamic_dimensions.push_back(shape.is_dynamic_dimension(dim));
+  }
+  return xla::ShapeUtil::MakeShape(shape.element_type(), dimensions,
+                                   dynamic_dimensions);
+}
+
+xla::Shape InferDotShape(const xla::Shape& lhs_shape,
+                         const xla::Shape& rhs_shape,
+                         const LowerForShapeFn& core_lowering_fn) {
+  if (lhs_shape.is_dynamic() || rhs_shape.is_dynamic() ||
+      lhs_shape.element_type() != rhs_shape.element_type() ||
+      lhs_shape.rank() < 1 || lhs_shape.rank() > 2 || rhs_shape.rank() < 1 ||
+      rhs_shape.rank() > 2) {
+    return InferOutputShape({lhs_shape, rhs_shape}, core_lowering_fn);
+  }
+  int64_t lhs_contracting = lhs_shape.dimensions(lhs_shape.rank() - 1);
+  int64_t rhs_contracting = rhs_shape.dimensions(0);
+  XLA_CHECK_EQ(lhs_contracting, rhs_contracting)
+      << "Incompatible dot shapes: " << lhs_shape << " and " << rhs_shape;
+  std::vector<int64_t> dimensions;
+  if (lhs_shape.rank() == 2) {
+    dimensions.push_back(lhs_shape.dimensions(0));
+  }
+  if (rhs_shape.rank() == 2) {
+    dimensions.push_back(rhs_shape.dimensions(1));
+  }
+  return xla::ShapeUtil::MakeShape(lhs_shape.element_type(), dimensions);
+}
+
+xla::Shape InferReduceShape(const xla::Shape& shape, xla::PrimitiveType type,
+                            absl::Span<const int64_t> dimensions,
+                            bool keep_reduced_dimensions,
+                            const LowerForShapeFn& core_lowering_fn) {
+  std::vector<bool> reduced(shape.rank(), false);
+  bool closed_form = !shape.is_dynamic();
+  for (auto dim : dimensions) {
+    if (dim < 0 || dim >= shape.rank() || reduced[dim]) {
+      closed_form = false;
+      break;
+    }
+    reduced[dim] = true;
+  }
+  if (!closed_form) {
+    return InferOutputShape({shape}, core_lowering_fn);
+  }
+  std::vector<int64_t> output_dimensions;
+  for (int64_t i = 0; i < shape.rank(); ++i) {
+    if (!reduced[i]) {
+      output_dimensions.push_back(shape.dimensions(i));
+    } else if (keep_reduced_dimensions) {
+      output_dimensions.push_back(1);
+    }
+  }
+  return xla::ShapeUtil::MakeShape(type, output_dimensions);
+}
+
 }  // namespace torch_xla
@@ -12,4 +12,34 @@ using LowerForShapeFn =
 xla::Shape InferOutputShape(absl::Span<const xla::Shape> input_shapes,
                             const LowerForShapeFn& core_lowering_fn);
 
+// Closed form shape functions for the ops which show up the most while
+// tracing. They compute the same shapes InferOutputShape() would, without
+// building a throwaway XLA computation, and fall back to it (using the given
+// lowering) for the inputs they do not handle, like dynamic shapes.
+
+// Shape of an elementwise binary op, with type and broadcast promotion.
+xla::Shape InferBinaryOpShape(const xla::Shape& shape1,
+                              const xla::Shape& shape2,
+                              const LowerForShapeFn& core_lowering_fn);
+
+// Shape of a comparison op, with broadcast promotion.
+xla::Shape InferComparisonOpShape(const xla::Shape& shape1,
+                                  const xla::Shape& shape2,
+                                  const LowerForShapeFn& core_lowering_fn);
+
+// Shape of a transpose with the given permutation.
+xla::Shape InferTransposeShape(const xla::Shape& shape,
+                               absl::Span<const int64_t> permutation);
+
+// Shape of an xla::Dot() of rank 1 or 2 operands.
+xla::Shape InferDotShape(const xla::Shape& lhs_shape,
+                         const xla::Shape& rhs_shape,
+                         const LowerForShapeFn& core_lowering_fn);
+
+// Shape of a reduction over dimensions, producing the given element type.
+xla::Shape InferReduceShape(const xla::Shape& shape, xla::PrimitiveType type,
+                            absl::Span<const int64_t> dimensions,
+                            bool keep_reduced_dimensions,
+                            const LowerForShapeFn& core_lowering_fn);
+
 }  // namespace torch_xla
@@ -0,0 +1,66 @@
+#include "torch_xla/csrc/ops/lamb_optimizer_step.h"
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+namespace {
+
+size_t GetNumParams(const torch::lazy::OpList& operands) {
+  XLA_CHECK_EQ((operands.size() - LambOptimizerStep::kScalarOperands) %
+                   LambOptimizerStep::kParamOperands,
+               0);
+  return (operands.size() - LambOptimizerStep::kScalarOperands) /
+         LambOptimizerStep::kParamOperands;
+}
+
+xla::Shape NodeOutputShape(const torch::lazy::OpList& operands) {
+  std::vector<xla::Shape> shapes;
+  for (size_t i = LambOptimizerStep::kScalarOperands; i < operands.size();
+       i += LambOptimizerStep::kParamOperands) {
+    const xla::Shape& param_shape = GetXlaShape(operands[i + 1]);
+    shapes.push_back(/*step=*/GetXlaShape(operands[i]));
+    shapes.push_back(/*param=*/param_shape);
+    shapes.push_back(/*exp_avg=*/param_shape);
+    shapes.push_back(/*exp_avg_sq=*/param_shape);
+  }
+  return xla::ShapeUtil::MakeTupleShape(shapes);
+}
+
+}  // namespace
+
+LambOptimizerStep::LambOptimizerStep(const torch::lazy::OpList& operands,
+                                     bool use_weight_decay)
+    : XlaNode(xla_lamb_optimizer_step, operands, NodeOutputShape(operands),
+              /*num_outputs=*/GetNumParams(operands) * kParamOutputs,
+              torch::lazy::MHash(use_weight_decay)),
+      use_weight_decay_(use_weight_decay) {}
+
+torch::lazy::NodePtr LambOptimizerStep::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<LambOptimizerStep>(operands, use_weight_decay_);
+}
+
+XlaOpVector LambOptimizerStep::Lower(LoweringContext* loctx) const {
+  xla::XlaOp found_inf = loctx->GetOutputOp(operand(0));
+  xla::XlaOp beta1 = loctx->GetOutputOp(operand(1));
+  xla::XlaOp beta2 = loctx->GetOutputOp(operand(2));
+  xla::XlaOp lr = loctx->GetOutputOp(operand(3));
+  xla::XlaOp weight_decay = loctx->GetOutputOp(operand(4));
+  xla::XlaOp eps = loctx->GetOutputOp(operand(5));
+  std::vector<xla::XlaOp> results;
+  for (size_t i = kScalarOperands; i < operands().size();
+       i += kParamOperands) {
+    std::vector<xla::XlaOp> param_results = BuildLambOptimizerStep(
+        found_inf, loctx->GetOutputOp(operand(i)),
+        loctx->GetOutputOp(operand(i + 1)), loctx->GetOutputOp(operand(i + 2)),
+        loctx->GetOutputOp(operand(i + 3)), loctx->GetOutputOp(operand(i + 4)),
+        beta1, beta2, lr, weight_decay, eps, use_weight_decay_);
+    results.insert(results.end(), param_results.begin(), param_results.end());
+  }
+  return ReturnOps(results, loctx);
+}
+
+}  // namespace torch_xla
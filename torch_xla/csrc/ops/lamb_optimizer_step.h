@@ -0,0 +1,28 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// LAMB step of a list of parameters within a single node. The operands are the
+// found_inf, beta1, beta2, lr, weight_decay and eps scalars, followed by the
+// step, param, grad, exp_avg and exp_avg_sq of every parameter. The outputs are
+// the new step, param, exp_avg and exp_avg_sq of every parameter.
+class LambOptimizerStep : public XlaNode {
+ public:
+  static constexpr size_t kScalarOperands = 6;
+  static constexpr size_t kParamOperands = 5;
+  static constexpr size_t kParamOutputs = 4;
+
+  LambOptimizerStep(const torch::lazy::OpList& operands,
+                    bool use_weight_decay);
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+ private:
+  bool use_weight_decay_;
+};
+
+}  // namespace torch_xla
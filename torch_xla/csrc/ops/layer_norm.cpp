@@ -0,0 +1,170 @@
+#include "torch_xla/csrc/ops/layer_norm.h"
+
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/layer_norm.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace {
+
+std::vector<xla::Shape> GetOperandShapes(
+    absl::Span<const torch::lazy::Value> operands) {
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(GetXlaShape(operand));
+  }
+  return shapes;
+}
+
+xla::Shape NodeOutputShape(absl::Span<const torch::lazy::Value> values,
+                           bool has_weight, bool has_bias,
+                           int64_t normalized_ndim, double eps, bool rms) {
+  auto lower_for_shape_fn =
+      [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    absl::optional<xla::XlaOp> weight;
+    absl::optional<xla::XlaOp> bias;
+    size_t index = 1;
+    if (has_weight) {
+      weight = operands[index++];
+    }
+    if (has_bias) {
+      bias = operands[index++];
+    }
+    LayerNormOutput result =
+        BuildLayerNorm(operands[0], weight, bias, normalized_ndim, eps, rms);
+    return xla::Tuple(operands[0].builder(),
+                      {result.output, result.mean, result.rstd});
+  };
+  return InferOutputShape(GetOperandShapes(values), lower_for_shape_fn);
+}
+
+xla::Shape BackwardOutputShape(const torch::lazy::Value& input,
+                               const absl::optional<torch::lazy::Value>& weight,
+                               int64_t normalized_ndim) {
+  const xla::Shape& input_shape = GetXlaShape(input);
+  xla::PrimitiveType affine_type = weight
+                                       ? GetXlaShape(*weight).element_type()
+                                       : input_shape.element_type();
+  std::vector<int64_t> normalized_sizes(
+      input_shape.dimensions().end() - normalized_ndim,
+      input_shape.dimensions().end());
+  xla::Shape affine_shape =
+      xla::ShapeUtil::MakeShape(affine_type, normalized_sizes);
+  return xla::ShapeUtil::MakeTupleShape(
+      {input_shape, affine_shape, affine_shape});
+}
+
+}  // namespace
+
+LayerNorm::LayerNorm(const torch::lazy::Value& input,
+                     const absl::optional<torch::lazy::Value>& weight,
+                     const absl::optional<torch::lazy::Value>& bias,
+                     int64_t normalized_ndim, double eps, bool rms)
+    : XlaNode(xla_layer_norm,
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {input}, {&weight, &bias}),
+              [&]() {
+                return NodeOutputShape(
+                    xla::util::GetValuesVector<torch::lazy::Value>(
+                        {input}, {&weight, &bias}),
+                    weight.has_value(), bias.has_value(), normalized_ndim,
+                    eps, rms);
+              },
+              /*num_outputs=*/3,
+              torch::lazy::MHash(normalized_ndim, eps, rms, weight.has_value(),
+                                 bias.has_value())),
+      normalized_ndim_(normalized_ndim),
+      eps_(eps),
+      rms_(rms),
+      has_weight_(weight.has_value()),
+      has_bias_(bias.has_value()) {}
+
+torch::lazy::NodePtr LayerNorm::Clone(torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> weight;
+  absl::optional<torch::lazy::Value> bias;
+  size_t index = 1;
+  if (has_weight_) {
+    weight = operands.at(index++);
+  }
+  if (has_bias_) {
+    bias = operands.at(index++);
+  }
+  return torch::lazy::MakeNode<LayerNorm>(operands.at(0), weight, bias,
+                                          normalized_ndim_, eps_, rms_);
+}
+
+XlaOpVector LayerNorm::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  absl::optional<xla::XlaOp> weight;
+  absl::optional<xla::XlaOp> bias;
+  size_t index = 1;
+  if (has_weight_) {
+    weight = loctx->GetOutputOp(operand(index++));
+  }
+  if (has_bias_) {
+    bias = loctx->GetOutputOp(operand(index++));
+  }
+  LayerNormOutput result =
+      BuildLayerNorm(input, weight, bias, normalized_ndim_, eps_, rms_);
+  return ReturnOps({result.output, result.mean, result.rstd}, loctx);
+}
+
+std::string LayerNorm::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", normalized_ndim=" << normalized_ndim_
+     << ", eps=" << eps_ << ", rms=" << rms_;
+  return ss.str();
+}
+
+LayerNormBackward::LayerNormBackward(
+    const torch::lazy::Value& grad, const torch::lazy::Value& input,
+    const torch::lazy::Value& mean, const torch::lazy::Value& rstd,
+    const absl::optional<torch::lazy::Value>& weight, int64_t normalized_ndim,
+    bool rms)
+    : XlaNode(xla_layer_norm_backward,
+              xla::util::GetValuesVector<torch::lazy::Value>(
+                  {grad, input, mean, rstd}, {&weight}),
+              [&]() {
+                return BackwardOutputShape(input, weight, normalized_ndim);
+              },
+              /*num_outputs=*/3, torch::lazy::MHash(normalized_ndim, rms)),
+      normalized_ndim_(normalized_ndim),
+      rms_(rms) {}
+
+torch::lazy::NodePtr LayerNormBackward::Clone(
+    torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> weight;
+  if (operands.size() > 4) {
+    weight = operands.at(4);
+  }
+  return torch::lazy::MakeNode<LayerNormBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3), weight,
+      normalized_ndim_, rms_);
+}
+
+XlaOpVector LayerNormBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad = loctx->GetOutputOp(operand(0));
+  xla::XlaOp input = loctx->GetOutputOp(operand(1));
+  xla::XlaOp mean = loctx->GetOutputOp(operand(2));
+  xla::XlaOp rstd = loctx->GetOutputOp(operand(3));
+  absl::optional<xla::XlaOp> weight;
+  if (operands().size() > 4) {
+    weight = loctx->GetOutputOp(operand(4));
+  }
+  LayerNormGrads grads = BuildLayerNormBackward(grad, input, mean, rstd,
+                                                weight, normalized_ndim_, rms_);
+  return ReturnOps({grads.grad_input, grads.grad_weight, grads.grad_bias},
+                   loctx);
+}
+
+std::string LayerNormBackward::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", normalized_ndim=" << normalized_ndim_
+     << ", rms=" << rms_;
+  return ss.str();
+}
+
+}  // namespace torch_xla
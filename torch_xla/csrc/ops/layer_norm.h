@@ -0,0 +1,63 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Layer (or RMS, if rms is true) normalization of the last normalized_ndim
+// dimensions of the input. Outputs the normalized input, and the mean and
+// rstd of the rows which the backward node consumes.
+class LayerNorm : public XlaNode {
+ public:
+  LayerNorm(const torch::lazy::Value& input,
+            const absl::optional<torch::lazy::Value>& weight,
+            const absl::optional<torch::lazy::Value>& bias,
+            int64_t normalized_ndim, double eps, bool rms);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  int64_t normalized_ndim() const { return normalized_ndim_; }
+
+  double eps() const { return eps_; }
+
+  bool rms() const { return rms_; }
+
+ private:
+  int64_t normalized_ndim_;
+  double eps_;
+  bool rms_;
+  bool has_weight_;
+  bool has_bias_;
+};
+
+// Outputs the gradients of the input, weight and bias of a LayerNorm node.
+class LayerNormBackward : public XlaNode {
+ public:
+  LayerNormBackward(const torch::lazy::Value& grad,
+                    const torch::lazy::Value& input,
+                    const torch::lazy::Value& mean,
+                    const torch::lazy::Value& rstd,
+                    const absl::optional<torch::lazy::Value>& weight,
+                    int64_t normalized_ndim, bool rms);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  int64_t normalized_ndim() const { return normalized_ndim_; }
+
+  bool rms() const { return rms_; }
+
+ private:
+  int64_t normalized_ndim_;
+  bool rms_;
+};
+
+}  // namespace torch_xla
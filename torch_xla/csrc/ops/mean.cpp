@@ -29,7 +29,12 @@ xla::Shape NodeOutputShape(const torch::lazy::Value& input,
       [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return LowerMean(operands[0], dimensions, keep_reduced_dimensions, dtype);
   };
-  return InferOutputShape({GetXlaShape(input)}, lower_for_shape_fn);
+  const xla::Shape& input_shape = GetXlaShape(input);
+  xla::PrimitiveType type =
+      dtype ? MakeXlaPrimitiveType(*dtype, /*device=*/nullptr)
+            : input_shape.element_type();
+  return InferReduceShape(input_shape, type, dimensions,
+                          keep_reduced_dimensions, lower_for_shape_fn);
 }
 
 }  // namespace
@@ -26,6 +26,25 @@ xla::Shape NodeOutputShape(const torch::lazy::Value& boxes,
       shape_fn);
 }
 
+xla::Shape BatchedNodeOutputShape(const torch::lazy::Value& boxes,
+                                  const torch::lazy::Value& scores,
+                                  const torch::lazy::Value& idxs,
+                                  const torch::lazy::Value& score_threshold,
+                                  const torch::lazy::Value& iou_threshold,
+                                  int64_t output_size) {
+  auto shape_fn = [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    NmsResult result =
+        BuildBatchedNms(operands[0], operands[1], operands[2], operands[3],
+                        operands[4], output_size);
+    return xla::Tuple(result.selected_indices.builder(),
+                      {result.selected_indices, result.num_valid});
+  };
+  return InferOutputShape(
+      {GetXlaShape(boxes), GetXlaShape(scores), GetXlaShape(idxs),
+       GetXlaShape(score_threshold), GetXlaShape(iou_threshold)},
+      shape_fn);
+}
+
 }  // namespace
 
 Nms::Nms(const torch::lazy::Value& boxes, const torch::lazy::Value& scores,
@@ -61,4 +80,43 @@ std::string Nms::ToString() const {
   return ss.str();
 }
 
+BatchedNms::BatchedNms(const torch::lazy::Value& boxes,
+                       const torch::lazy::Value& scores,
+                       const torch::lazy::Value& idxs,
+                       const torch::lazy::Value& score_threshold,
+                       const torch::lazy::Value& iou_threshold,
+                       int64_t output_size)
+    : XlaNode(xla_batched_nms,
+              {boxes, scores, idxs, score_threshold, iou_threshold},
+              [&]() {
+                return BatchedNodeOutputShape(boxes, scores, idxs,
+                                              score_threshold, iou_threshold,
+                                              output_size);
+              },
+              /*num_outputs=*/2, torch::lazy::MHash(output_size)),
+      output_size_(output_size) {}
+
+torch::lazy::NodePtr BatchedNms::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<BatchedNms>(operands.at(0), operands.at(1),
+                                           operands.at(2), operands.at(3),
+                                           operands.at(4), output_size_);
+}
+
+XlaOpVector BatchedNms::Lower(LoweringContext* loctx) const {
+  xla::XlaOp boxes = loctx->GetOutputOp(operand(0));
+  xla::XlaOp scores = loctx->GetOutputOp(operand(1));
+  xla::XlaOp idxs = loctx->GetOutputOp(operand(2));
+  xla::XlaOp score_threshold = loctx->GetOutputOp(operand(3));
+  xla::XlaOp iou_threshold = loctx->GetOutputOp(operand(4));
+  NmsResult result = BuildBatchedNms(boxes, scores, idxs, score_threshold,
+                                     iou_threshold, output_size_);
+  return ReturnOps({result.selected_indices, result.num_valid}, loctx);
+}
+
+std::string BatchedNms::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", output_size=" << output_size_;
+  return ss.str();
+}
+
 }  // namespace torch_xla
@@ -22,4 +22,24 @@ class Nms : public XlaNode {
   int64_t output_size_;
 };
 
+// Same as Nms, but boxes only suppress the boxes with the same index in idxs.
+class BatchedNms : public XlaNode {
+ public:
+  BatchedNms(const torch::lazy::Value& boxes, const torch::lazy::Value& scores,
+             const torch::lazy::Value& idxs,
+             const torch::lazy::Value& score_threshold,
+             const torch::lazy::Value& iou_threshold, int64_t output_size);
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  int64_t output_size() const { return output_size_; }
+
+ private:
+  int64_t output_size_;
+};
+
 }  // namespace torch_xla
@@ -8,31 +8,38 @@
 namespace torch_xla {
 namespace {
 
-xla::Shape NodeOutputShape(const torch::lazy::Value& input) {
+xla::Shape NodeOutputShape(const torch::lazy::Value& input, bool padded) {
   const xla::Shape& input_shape = GetXlaShape(input);
   int64_t index_elements = xla::ShapeUtil::ElementsIn(input_shape);
   xla::PrimitiveType size_type = GetShapeDimensionType(/*device=*/nullptr);
   xla::Shape result_shape = xla::ShapeUtil::MakeShape(
       size_type, {index_elements, input_shape.rank()});
-  result_shape.set_dynamic_dimension(0, true);
+  result_shape.set_dynamic_dimension(0, !padded);
   return xla::ShapeUtil::MakeTupleShape(
       {result_shape, xla::ShapeUtil::MakeShape(size_type, {})});
 }
 
 }  // namespace
 
-NonZero::NonZero(const torch::lazy::Value& input)
+NonZero::NonZero(const torch::lazy::Value& input, bool padded)
     : XlaNode(torch::lazy::OpKind(at::aten::nonzero), {input},
-              NodeOutputShape(input),
-              /*num_outputs=*/2) {}
+              NodeOutputShape(input, padded),
+              /*num_outputs=*/2, torch::lazy::MHash(padded)),
+      padded_(padded) {}
 
 torch::lazy::NodePtr NonZero::Clone(torch::lazy::OpList operands) const {
-  return torch::lazy::MakeNode<NonZero>(operands.at(0));
+  return torch::lazy::MakeNode<NonZero>(operands.at(0), padded_);
 }
 
 XlaOpVector NonZero::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
-  return ReturnOps(BuildNonZero(input), loctx);
+  return ReturnOps(BuildNonZero(input, padded_), loctx);
+}
+
+std::string NonZero::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", padded=" << padded_;
+  return ss.str();
 }
 
 }  // namespace torch_xla
@@ -4,16 +4,24 @@
 
 namespace torch_xla {
 
-// This node has no metadata, so it could have been implemented as generic-op in
-// ops.cpp, but since this might require special handling from upper IR layers,
-// it gets its own IR node class.
+// Since this might require special handling from upper IR layers, it gets its
+// own IR node class.
 class NonZero : public XlaNode {
  public:
-  NonZero(const torch::lazy::Value& input);
+  // If padded, the indices keep their upper bound size, with zeros past the
+  // count in the second output, instead of a dynamic size.
+  NonZero(const torch::lazy::Value& input, bool padded = false);
 
   torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
 
   XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  bool padded() const { return padded_; }
+
+ private:
+  bool padded_;
 };
 
 }  // namespace torch_xla
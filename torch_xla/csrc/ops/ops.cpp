@@ -61,9 +61,9 @@ namespace torch_xla {
     };                                                                         \
     return GenericOp(torch::lazy::OpKind(sym), {input0, input1},               \
                      [&]() {                                                   \
-                       return InferOutputShape(                                \
-                           {GetXlaShape(input0), GetXlaShape(input1)},         \
-                           shape_fn);                                          \
+                       return InferBinaryOpShape(GetXlaShape(input0),          \
+                                                 GetXlaShape(input1),          \
+                                                 shape_fn);                    \
                      },                                                        \
                      std::move(lower_fn));                                     \
   }
@@ -72,7 +72,6 @@ PTXLA_UNARY_OP(Neg, at::aten::neg, xla::Neg);
 PTXLA_UNARY_OP(Exp, at::aten::exp, xla::Exp);
 PTXLA_UNARY_OP(Log, at::aten::log, xla::Log);
 PTXLA_UNARY_OP(Log1p, at::aten::log1p, xla::Log1p);
-PTXLA_UNARY_OP(Sqrt, at::aten::sqrt, xla::Sqrt);
 PTXLA_UNARY_OP(Not, at::aten::bitwise_not, xla::Not);
 
 PTXLA_BINARY_OP(Min, at::aten::min, xla::Min);
@@ -82,10 +81,9 @@ PTXLA_BINARY_OP(Atan2, at::aten::atan2, xla::Atan2);
 
 torch::lazy::NodePtr Trunc(const torch::lazy::Value& input) {
   std::vector<torch::lazy::Shape> shapes;
-  return torch::lazy::MakeNode<Floor>(
-             torch::lazy::MakeNode<Abs>(input, std::move(shapes)),
-             std::vector<torch::lazy::Shape>()) *
-         torch::lazy::MakeNode<Sign>(input, std::vector<torch::lazy::Shape>());
+  return MakeXlaNode<Floor>(MakeXlaNode<Abs>(input, std::move(shapes)),
+                            std::vector<torch::lazy::Shape>()) *
+         MakeXlaNode<Sign>(input, std::vector<torch::lazy::Shape>());
 }
 
 torch::lazy::NodePtr FracOp(const torch::lazy::Value& input) {
@@ -134,17 +132,8 @@ torch::lazy::NodePtr ReluOp(const torch::lazy::Value& input) {
     xla::XlaOp xla_output = BuildRelu(xla_input);
     return node.ReturnOp(xla_output, loctx);
   };
-  auto lower_for_shape_fn =
-      [](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 1) << "Unexpected number of operands";
-    return BuildRelu(operands[0]);
-  };
   return GenericOp(torch::lazy::OpKind(at::aten::relu), {input},
-                   [&]() {
-                     return InferOutputShape({GetXlaShape(input)},
-                                             lower_for_shape_fn);
-                   },
-                   std::move(lower_fn));
+                   GetXlaShape(input), std::move(lower_fn));
 }
 
 torch::lazy::NodePtr Prelu(const torch::lazy::Value& input,
@@ -202,16 +191,6 @@ torch::lazy::NodePtr SiLUBackward(const torch::lazy::Value& grad_output,
       std::move(lower_fn));
 }
 
-torch::lazy::NodePtr Sigmoid(const torch::lazy::Value& input) {
-  auto lower_fn = [](const XlaNode& node,
-                     LoweringContext* loctx) -> XlaOpVector {
-    xla::XlaOp xla_input = loctx->GetOutputOp(node.operand(0));
-    return node.ReturnOp(BuildSigmoid(xla_input), loctx);
-  };
-  return GenericOp(torch::lazy::OpKind(at::aten::sigmoid), {input},
-                   GetXlaShape(input), std::move(lower_fn));
-}
-
 torch::lazy::NodePtr SigmoidBackward(const torch::lazy::Value& grad_output,
                                      const torch::lazy::Value& output) {
   return grad_output * (ScalarOp(1, GetXlaShape(output)) - output) * output;
@@ -220,7 +199,7 @@ torch::lazy::NodePtr SigmoidBackward(const torch::lazy::Value& grad_output,
 torch::lazy::NodePtr LogSoftmaxBackwardOp(const torch::lazy::Value& grad_output,
                                           const torch::lazy::Value& output,
                                           int64_t dim) {
-  return torch::lazy::MakeNode<LogSoftmaxBackward>(
+  return MakeXlaNode<LogSoftmaxBackward>(
       grad_output, output,
       torch::lazy::GetCanonicalDimensionIndex(dim,
                                               GetXlaShape(grad_output).rank()));
@@ -229,7 +208,7 @@ torch::lazy::NodePtr LogSoftmaxBackwardOp(const torch::lazy::Value& grad_output,
 torch::lazy::NodePtr SoftmaxBackwardOp(const torch::lazy::Value& grad_output,
                                        const torch::lazy::Value& output,
                                        int64_t dim) {
-  return torch::lazy::MakeNode<SoftmaxBackward>(
+  return MakeXlaNode<SoftmaxBackward>(
       grad_output, output,
       torch::lazy::GetCanonicalDimensionIndex(dim,
                                               GetXlaShape(grad_output).rank()));
@@ -325,9 +304,9 @@ torch::lazy::NodePtr Dot(const torch::lazy::Value& input,
   };
   return GenericOp(torch::lazy::OpKind(at::aten::mm), {input, weight},
                    [&]() {
-                     return InferOutputShape(
-                         {GetXlaShape(input), GetXlaShape(weight)},
-                         lower_for_shape_fn);
+                     return InferDotShape(GetXlaShape(input),
+                                          GetXlaShape(weight),
+                                          lower_for_shape_fn);
                    },
                    std::move(lower_fn));
 }
@@ -424,9 +403,9 @@ torch::lazy::NodePtr ComparisonOp(c10::Symbol kind,
   };
   return GenericOp(torch::lazy::OpKind(kind), {input, other},
                    [&]() {
-                     return InferOutputShape(
-                         {GetXlaShape(input), GetXlaShape(other)},
-                         lower_for_shape_fn);
+                     return InferComparisonOpShape(GetXlaShape(input),
+                                                   GetXlaShape(other),
+                                                   lower_for_shape_fn);
                    },
                    std::move(lower_fn));
 }
@@ -452,9 +431,9 @@ torch::lazy::NodePtr Where(const torch::lazy::Value& condition,
                    std::move(lower_fn));
 }
 
-torch::lazy::NodePtr ARange(const at::Scalar& start, const at::Scalar& end,
-                            const at::Scalar& step,
-                            at::ScalarType scalar_type) {
+xla::Literal ARangeLiteral(const at::Scalar& start, const at::Scalar& end,
+                           const at::Scalar& step,
+                           at::ScalarType scalar_type) {
   xla::PrimitiveType type = MakeXlaPrimitiveType(scalar_type,
                                                  /*device=*/nullptr);
   XLA_CHECK_NE(step.toDouble(), 0.0);
@@ -519,7 +498,7 @@ torch::lazy::NodePtr ARange(const at::Scalar& start, const at::Scalar& end,
     default:
       XLA_ERROR() << "XLA type not supported: " << type;
   }
-  return torch::lazy::MakeNode<Constant>(std::move(values));
+  return values;
 }
 
 torch::lazy::NodePtr BroadcastTensors(
@@ -559,8 +538,8 @@ torch::lazy::NodePtr Norm(const torch::lazy::Value& input,
   if (!p.has_value() || p->toDouble() == 2.0) {
     torch::lazy::NodePtr square = input * input;
     torch::lazy::NodePtr result =
-        torch::lazy::MakeNode<Sum>(square, dimensions, keepdim, dtype);
-    return Sqrt(result);
+        MakeXlaNode<Sum>(square, dimensions, keepdim, dtype);
+    return MakeXlaNode<Sqrt>(result, std::vector<torch::lazy::Shape>());
   }
   double norm_value = p->toDouble();
   if (norm_value == 1.0) {
@@ -575,8 +554,8 @@ torch::lazy::NodePtr Norm(const torch::lazy::Value& input,
     //   tensor(3.1235)
     //   >>> print(x.abs().sum())
     //   tensor(11.9437)
-    return torch::lazy::MakeNode<Sum>(
-        torch::lazy::MakeNode<Abs>(input, std::vector<torch::lazy::Shape>()),
+    return MakeXlaNode<Sum>(
+        MakeXlaNode<Abs>(input, std::vector<torch::lazy::Shape>()),
         dimensions, keepdim, dtype);
   }
   // Generic sum(x^p)^(1/p) norms.
@@ -585,10 +564,10 @@ torch::lazy::NodePtr Norm(const torch::lazy::Value& input,
   torch::lazy::NodePtr norm_exp_inv =
       ScalarOp(1.0 / norm_value, GetXlaShape(input).element_type());
   torch::lazy::NodePtr exp =
-      Pow(torch::lazy::MakeNode<Abs>(input, std::vector<torch::lazy::Shape>()),
+      Pow(MakeXlaNode<Abs>(input, std::vector<torch::lazy::Shape>()),
           norm_exp);
   torch::lazy::NodePtr result =
-      torch::lazy::MakeNode<Sum>(exp, dimensions, keepdim, dtype);
+      MakeXlaNode<Sum>(exp, dimensions, keepdim, dtype);
   return Pow(result, norm_exp_inv);
 }
 
@@ -687,13 +666,12 @@ torch::lazy::NodePtr Remainder(const torch::lazy::Value& input,
                                const torch::lazy::Value& divisor) {
   torch::lazy::ScopePusher ir_scope(at::aten::remainder.toQualString());
   torch::lazy::NodePtr f = Fmod(
-      input,
-      torch::lazy::MakeNode<Abs>(divisor, std::vector<torch::lazy::Shape>()));
+      input, MakeXlaNode<Abs>(divisor, std::vector<torch::lazy::Shape>()));
   return f + divisor * ComparisonOp(
                            at::aten::lt,
-                           torch::lazy::MakeNode<Sign>(
+                           MakeXlaNode<Sign>(
                                f, std::vector<torch::lazy::Shape>()) *
-                               torch::lazy::MakeNode<Sign>(
+                               MakeXlaNode<Sign>(
                                    divisor, std::vector<torch::lazy::Shape>()),
                            ScalarOp(0, GetXlaShape(input)));
 }
@@ -769,8 +747,7 @@ torch::lazy::NodePtr TanhGelu(const torch::lazy::Value& input) {
   torch::lazy::NodePtr half = ScalarOp(0.5, shape);
   torch::lazy::NodePtr inner = beta * (input + kappa * Pow(input, three));
   return half * input *
-         (one + torch::lazy::MakeNode<Tanh>(inner,
-                                            std::vector<torch::lazy::Shape>()));
+         (one + MakeXlaNode<Tanh>(inner, std::vector<torch::lazy::Shape>()));
 }
 
 torch::lazy::NodePtr TanhGeluBackward(const torch::lazy::Value& grad,
@@ -787,7 +764,7 @@ torch::lazy::NodePtr TanhGeluBackward(const torch::lazy::Value& grad,
   torch::lazy::NodePtr half = ScalarOp(0.5, shape);
   torch::lazy::NodePtr inner = beta * (input + kappa * Pow(input, three));
   torch::lazy::NodePtr tanh_inner =
-      torch::lazy::MakeNode<Tanh>(inner, std::vector<torch::lazy::Shape>());
+      MakeXlaNode<Tanh>(inner, std::vector<torch::lazy::Shape>());
 
   torch::lazy::NodePtr left = half * input;
   torch::lazy::NodePtr right = one + tanh_inner;
@@ -14,15 +14,15 @@ namespace torch_xla {
 
 inline torch::lazy::NodePtr ScalarOp(const at::Scalar& value,
                                      xla::Shape shape) {
-  return torch::lazy::MakeNode<Scalar>(value, std::move(shape));
+  return MakeXlaNode<Scalar>(value, std::move(shape));
 }
 inline torch::lazy::NodePtr ScalarOp(const at::Scalar& value,
                                      xla::PrimitiveType type) {
-  return torch::lazy::MakeNode<Scalar>(value, type);
+  return MakeXlaNode<Scalar>(value, type);
 }
 
 inline torch::lazy::NodePtr ConstantOp(xla::Literal value) {
-  return torch::lazy::MakeNode<Constant>(std::move(value));
+  return MakeXlaNode<Constant>(std::move(value));
 }
 
 inline torch::lazy::NodePtr GenericOp(
@@ -30,9 +30,9 @@ inline torch::lazy::NodePtr GenericOp(
     xla::Shape shape, Generic::LowerFn lower_fn, size_t num_outputs = 1,
     // cast to uint32_t to avoid ambiguous constructor of uint128
     torch::lazy::hash_t hash_seed = (uint32_t)0x5a2d296e9) {
-  return torch::lazy::MakeNode<Generic>(std::move(op), operands,
-                                        std::move(shape), std::move(lower_fn),
-                                        num_outputs, hash_seed);
+  return MakeXlaNode<Generic>(std::move(op), operands,
+                              std::move(shape), std::move(lower_fn),
+                              num_outputs, hash_seed);
 }
 
 inline torch::lazy::NodePtr GenericOp(
@@ -42,7 +42,7 @@ inline torch::lazy::NodePtr GenericOp(
     size_t num_outputs = 1,
     // cast to uint32_t to avoid ambiguous constructor of uint128
     torch::lazy::hash_t hash_seed = (uint32_t)0x5a2d296e9) {
-  return torch::lazy::MakeNode<Generic>(
+  return MakeXlaNode<Generic>(
       std::move(op), operands, std::move(shapes), shape_fn, std::move(lower_fn),
       num_outputs, hash_seed);
 }
@@ -53,18 +53,18 @@ inline torch::lazy::NodePtr GenericOp(
     size_t num_outputs = 1,
     // cast to uint32_t to avoid ambiguous constructor of uint128
     torch::lazy::hash_t hash_seed = (uint32_t)0x5a2d296e9) {
-  return torch::lazy::MakeNode<Generic>(std::move(op), operands, shape_fn,
-                                        std::move(lower_fn), num_outputs,
-                                        hash_seed);
+  return MakeXlaNode<Generic>(std::move(op), operands, shape_fn,
+                              std::move(lower_fn), num_outputs,
+                              hash_seed);
 }
 
 inline torch::lazy::NodePtr GenericOp(torch::lazy::OpKind op, xla::Shape shape,
                                       Generic::LowerFn lower_fn,
                                       size_t num_outputs,
                                       torch::lazy::hash_t hash_seed) {
-  return torch::lazy::MakeNode<Generic>(std::move(op), std::move(shape),
-                                        std::move(lower_fn), num_outputs,
-                                        hash_seed);
+  return MakeXlaNode<Generic>(std::move(op), std::move(shape),
+                              std::move(lower_fn), num_outputs,
+                              hash_seed);
 }
 
 torch::lazy::NodePtr Cos(const torch::lazy::Value& input);
@@ -100,8 +100,6 @@ torch::lazy::NodePtr LogBase(const torch::lazy::Value& input,
 
 torch::lazy::NodePtr Log1p(const torch::lazy::Value& input);
 
-torch::lazy::NodePtr Sqrt(const torch::lazy::Value& input);
-
 torch::lazy::NodePtr Prelu(const torch::lazy::Value& input,
                            const torch::lazy::Value& weight);
 
@@ -115,8 +113,6 @@ torch::lazy::NodePtr Not(const torch::lazy::Value& input);
 
 torch::lazy::NodePtr LogSigmoid(const torch::lazy::Value& input);
 
-torch::lazy::NodePtr Sigmoid(const torch::lazy::Value& input);
-
 torch::lazy::NodePtr SiLU(const torch::lazy::Value& input);
 
 torch::lazy::NodePtr SiLUBackward(const torch::lazy::Value& grad_output,
@@ -171,8 +167,8 @@ torch::lazy::NodePtr Where(const torch::lazy::Value& condition,
                            const torch::lazy::Value& input,
                            const torch::lazy::Value& other);
 
-torch::lazy::NodePtr ARange(const at::Scalar& start, const at::Scalar& end,
-                            const at::Scalar& step, at::ScalarType scalar_type);
+xla::Literal ARangeLiteral(const at::Scalar& start, const at::Scalar& end,
+                           const at::Scalar& step, at::ScalarType scalar_type);
 
 torch::lazy::NodePtr BroadcastTensors(
     c10::ArrayRef<torch::lazy::Value> tensors);
@@ -231,6 +231,11 @@ torch_xla::XlaOpVector Sgn::Lower(LoweringContext* loctx) const {
   return ReturnOp(BuildSgn(xla_input), loctx);
 }
 
+torch_xla::XlaOpVector Sigmoid::Lower(LoweringContext* loctx) const {
+  xla::XlaOp xla_input = loctx->GetOutputOp(operand(0));
+  return ReturnOp(BuildSigmoid(xla_input), loctx);
+}
+
 torch_xla::XlaOpVector Sign::Lower(LoweringContext* loctx) const {
   xla::XlaOp xla_input = loctx->GetOutputOp(operand(0));
   return ReturnOp(BuildSign(xla_input), loctx);
@@ -264,6 +269,11 @@ torch_xla::XlaOpVector Sinh::Lower(LoweringContext* loctx) const {
 //   return ReturnOps({result.sign, result.logdet}, loctx);
 // }
 
+torch_xla::XlaOpVector Sqrt::Lower(LoweringContext* loctx) const {
+  xla::XlaOp xla_input = loctx->GetOutputOp(operand(0));
+  return ReturnOp(xla::Sqrt(xla_input), loctx);
+}
+
 torch_xla::XlaOpVector Tan::Lower(LoweringContext* loctx) const {
   xla::XlaOp xla_input = loctx->GetOutputOp(operand(0));
   return ReturnOp(xla::Tan(xla_input), loctx);
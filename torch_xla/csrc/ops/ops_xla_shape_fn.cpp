@@ -139,15 +139,14 @@ xla::Shape LogicalAndOutputShape(const torch::lazy::Value& input,
         operands[0], operands[1],
         [](xla::XlaOp lhs, xla::XlaOp rhs) { return xla::And(lhs, rhs); });
   };
-  return InferOutputShape({GetXlaShape(input), GetXlaShape(other)}, shape_fn);
+  return InferComparisonOpShape(GetXlaShape(input), GetXlaShape(other),
+                                shape_fn);
 }
 
 xla::Shape LogicalNotOutputShape(const torch::lazy::Value& input) {
-  auto shape_fn = [](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
-    return XlaHelpers::PromotedLogicalUnaryOp(
-        operands[0], [](xla::XlaOp lhs) { return xla::Not(lhs); });
-  };
-  return InferOutputShape({GetXlaShape(input)}, shape_fn);
+  xla::Shape logical_not_shape(GetXlaShape(input));
+  logical_not_shape.set_element_type(xla::PRED);
+  return logical_not_shape;
 }
 
 xla::Shape LogicalOrOutputShape(const torch::lazy::Value& input,
@@ -157,7 +156,8 @@ xla::Shape LogicalOrOutputShape(const torch::lazy::Value& input,
         operands[0], operands[1],
         [](xla::XlaOp lhs, xla::XlaOp rhs) { return xla::Or(lhs, rhs); });
   };
-  return InferOutputShape({GetXlaShape(input), GetXlaShape(other)}, shape_fn);
+  return InferComparisonOpShape(GetXlaShape(input), GetXlaShape(other),
+                                shape_fn);
 }
 
 xla::Shape LogicalXorOutputShape(const torch::lazy::Value& input,
@@ -167,7 +167,8 @@ xla::Shape LogicalXorOutputShape(const torch::lazy::Value& input,
         operands[0], operands[1],
         [](xla::XlaOp lhs, xla::XlaOp rhs) { return xla::Xor(lhs, rhs); });
   };
-  return InferOutputShape({GetXlaShape(input), GetXlaShape(other)}, shape_fn);
+  return InferComparisonOpShape(GetXlaShape(input), GetXlaShape(other),
+                                shape_fn);
 }
 
 xla::Shape LogSigmoidForwardOutputShape(const torch::lazy::Value& input) {
@@ -188,8 +189,8 @@ xla::Shape MaximumOutputShape(const torch::lazy::Value& input,
     auto promoted = XlaHelpers::Promote(operands[0], operands[1]);
     return xla::Max(promoted.first, promoted.second);
   };
-  return InferOutputShape({GetXlaShape(input), GetXlaShape(other)},
-                          lower_for_shape_fn);
+  return InferBinaryOpShape(GetXlaShape(input), GetXlaShape(other),
+                            lower_for_shape_fn);
 }
 
 xla::Shape MinimumOutputShape(const torch::lazy::Value& input,
@@ -197,10 +198,10 @@ xla::Shape MinimumOutputShape(const torch::lazy::Value& input,
   auto lower_for_shape_fn =
       [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     auto promoted = XlaHelpers::Promote(operands[0], operands[1]);
-    return xla::Max(promoted.first, promoted.second);
+    return xla::Min(promoted.first, promoted.second);
   };
-  return InferOutputShape({GetXlaShape(input), GetXlaShape(other)},
-                          lower_for_shape_fn);
+  return InferBinaryOpShape(GetXlaShape(input), GetXlaShape(other),
+                            lower_for_shape_fn);
 }
 
 xla::Shape ReciprocalOutputShape(const torch::lazy::Value& input) {
@@ -223,6 +224,10 @@ xla::Shape SgnOutputShape(const torch::lazy::Value& input) {
   return GetXlaShape(input);
 }
 
+xla::Shape SigmoidOutputShape(const torch::lazy::Value& input) {
+  return GetXlaShape(input);
+}
+
 xla::Shape SignOutputShape(const torch::lazy::Value& input) {
   return GetXlaShape(input);
 }
@@ -237,8 +242,8 @@ xla::Shape SiluBackwardOutputShape(const torch::lazy::Value& grad_output,
       [](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return BuildSiLUBackward(operands[0], operands[1]);
   };
-  return InferOutputShape({GetXlaShape(grad_output), GetXlaShape(input)},
-                          lower_for_shape_fn);
+  return InferBinaryOpShape(GetXlaShape(grad_output), GetXlaShape(input),
+                            lower_for_shape_fn);
 }
 
 xla::Shape SinOutputShape(const torch::lazy::Value& input) {
@@ -259,6 +264,10 @@ xla::Shape SinhOutputShape(const torch::lazy::Value& input) {
 //   return InferOutputShape({GetXlaShape(input)}, lower_for_shape_fn);
 // }
 
+xla::Shape SqrtOutputShape(const torch::lazy::Value& input) {
+  return GetXlaShape(input);
+}
+
 xla::Shape TanOutputShape(const torch::lazy::Value& input) {
   return GetXlaShape(input);
 }
@@ -90,6 +90,8 @@ xla::Shape SeluOutputShape(const torch::lazy::Value& input);
 
 xla::Shape SgnOutputShape(const torch::lazy::Value& input);
 
+xla::Shape SigmoidOutputShape(const torch::lazy::Value& input);
+
 xla::Shape SignOutputShape(const torch::lazy::Value& input);
 
 xla::Shape SiluOutputShape(const torch::lazy::Value& input);
@@ -104,6 +106,8 @@ xla::Shape SinhOutputShape(const torch::lazy::Value& input);
 /* Blocked on https://github.com/pytorch/xla/issues/3596 */
 // xla::Shape SlogdetOutputShape(const torch::lazy::Value& input);
 
+xla::Shape SqrtOutputShape(const torch::lazy::Value& input);
+
 xla::Shape TanOutputShape(const torch::lazy::Value& input);
 
 xla::Shape TanhOutputShape(const torch::lazy::Value& input);
@@ -10,12 +10,7 @@ namespace {
 
 xla::Shape NodeOutputShape(const torch::lazy::Value& input,
                            absl::Span<const int64_t> dims) {
-  auto lower_for_shape_fn =
-      [dims](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
-    XLA_CHECK_EQ(operands.size(), 1);
-    return xla::Transpose(operands[0], dims);
-  };
-  return InferOutputShape({GetXlaShape(input)}, lower_for_shape_fn);
+  return InferTransposeShape(GetXlaShape(input), dims);
 }
 
 }  // namespace
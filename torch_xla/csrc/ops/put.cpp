@@ -10,7 +10,9 @@ Put::Put(const torch::lazy::Value& input, const torch::lazy::Value& index,
     : XlaNode(torch::lazy::OpKind(at::aten::put), {input, index, source},
               GetXlaShape(input),
               /*num_outputs=*/1, torch::lazy::MHash(accumulate)),
-      accumulate_(accumulate) {}
+      accumulate_(accumulate) {
+  MarkInPlaceUpdate();
+}
 
 torch::lazy::NodePtr Put::Clone(torch::lazy::OpList operands) const {
   return torch::lazy::MakeNode<Put>(operands.at(0), operands.at(1),
@@ -6,13 +6,18 @@
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/small_matrix.h"
 
 namespace torch_xla {
 namespace {
 
 std::vector<xla::XlaOp> LowerQR(xla::XlaOp input, bool some) {
   xla::XlaOp q, r;
-  xla::QrExplicit(input, /*full_matrices=*/!some, q, r);
+  if (IsSmallMatrix(XlaHelpers::ShapeOfXlaOp(input))) {
+    BuildSmallQr(input, /*full_matrices=*/!some, &q, &r);
+  } else {
+    xla::QrExplicit(input, /*full_matrices=*/!some, q, r);
+  }
   return {q, r};
 }
 
@@ -0,0 +1,168 @@
+#include "torch_xla/csrc/ops/quantized_ops.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace {
+
+torch::lazy::hash_t ParamsHash(const QuantizationParams& params) {
+  return torch::lazy::MHash(params.input_scale, params.input_zero_point,
+                            params.output_scale.has_value(),
+                            params.output_scale.value_or(0.0),
+                            params.output_zero_point);
+}
+
+std::string ParamsToString(const QuantizationParams& params) {
+  std::stringstream ss;
+  ss << "input_scale=" << params.input_scale
+     << ", input_zero_point=" << params.input_zero_point;
+  if (params.output_scale) {
+    ss << ", output_scale=" << *params.output_scale
+       << ", output_zero_point=" << params.output_zero_point;
+  }
+  return ss.str();
+}
+
+std::vector<torch::lazy::Value> GetOperands(
+    const torch::lazy::Value& input, const torch::lazy::Value& weight,
+    const torch::lazy::Value& weight_scales,
+    const absl::optional<torch::lazy::Value>& bias) {
+  return xla::util::GetValuesVector<torch::lazy::Value>(
+      {input, weight, weight_scales}, {&bias});
+}
+
+std::vector<xla::Shape> GetOperandShapes(
+    absl::Span<const torch::lazy::Value> operands) {
+  std::vector<xla::Shape> shapes;
+  for (auto& operand : operands) {
+    shapes.push_back(GetXlaShape(operand));
+  }
+  return shapes;
+}
+
+absl::optional<xla::XlaOp> GetOptionalBias(
+    absl::Span<const xla::XlaOp> operands) {
+  return operands.size() > 3 ? absl::optional<xla::XlaOp>(operands[3])
+                             : absl::nullopt;
+}
+
+}  // namespace
+
+QuantizedLinear::QuantizedLinear(const torch::lazy::Value& input,
+                                 const torch::lazy::Value& weight,
+                                 const torch::lazy::Value& weight_scales,
+                                 const absl::optional<torch::lazy::Value>& bias,
+                                 const QuantizationParams& params)
+    : XlaNode(
+          xla_quantized_linear, GetOperands(input, weight, weight_scales, bias),
+          [&]() {
+            auto lower_for_shape_fn =
+                [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+              return BuildQuantizedLinear(operands[0], operands[1],
+                                          operands[2],
+                                          GetOptionalBias(operands), params);
+            };
+            return InferOutputShape(
+                GetOperandShapes(
+                    GetOperands(input, weight, weight_scales, bias)),
+                lower_for_shape_fn);
+          },
+          /*num_outputs=*/1, ParamsHash(params)),
+      params_(params) {}
+
+torch::lazy::NodePtr QuantizedLinear::Clone(
+    torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> bias;
+  if (operands.size() > 3) {
+    bias = operands.at(3);
+  }
+  return torch::lazy::MakeNode<QuantizedLinear>(
+      operands.at(0), operands.at(1), operands.at(2), bias, params_);
+}
+
+XlaOpVector QuantizedLinear::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> operands;
+  for (auto& operand : this->operands()) {
+    operands.push_back(loctx->GetOutputOp(operand));
+  }
+  return ReturnOp(BuildQuantizedLinear(operands[0], operands[1], operands[2],
+                                       GetOptionalBias(operands), params_),
+                  loctx);
+}
+
+std::string QuantizedLinear::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", " << ParamsToString(params_);
+  return ss.str();
+}
+
+QuantizedConvolution::QuantizedConvolution(
+    const torch::lazy::Value& input, const torch::lazy::Value& weight,
+    const torch::lazy::Value& weight_scales,
+    const absl::optional<torch::lazy::Value>& bias,
+    std::vector<int64_t> stride, std::vector<int64_t> padding,
+    std::vector<int64_t> dilation, int64_t groups,
+    const QuantizationParams& params)
+    : XlaNode(
+          xla_quantized_convolution,
+          GetOperands(input, weight, weight_scales, bias),
+          [&]() {
+            auto lower_for_shape_fn =
+                [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+              return BuildQuantizedConvolution(
+                  operands[0], operands[1], operands[2],
+                  GetOptionalBias(operands), stride, padding, dilation, groups,
+                  params);
+            };
+            return InferOutputShape(
+                GetOperandShapes(
+                    GetOperands(input, weight, weight_scales, bias)),
+                lower_for_shape_fn);
+          },
+          /*num_outputs=*/1,
+          torch::lazy::HashCombine(
+              torch::lazy::MHash(stride, padding, dilation, groups),
+              ParamsHash(params))),
+      stride_(std::move(stride)),
+      padding_(std::move(padding)),
+      dilation_(std::move(dilation)),
+      groups_(groups),
+      params_(params) {}
+
+torch::lazy::NodePtr QuantizedConvolution::Clone(
+    torch::lazy::OpList operands) const {
+  absl::optional<torch::lazy::Value> bias;
+  if (operands.size() > 3) {
+    bias = operands.at(3);
+  }
+  return torch::lazy::MakeNode<QuantizedConvolution>(
+      operands.at(0), operands.at(1), operands.at(2), bias, stride_, padding_,
+      dilation_, groups_, params_);
+}
+
+XlaOpVector QuantizedConvolution::Lower(LoweringContext* loctx) const {
+  std::vector<xla::XlaOp> operands;
+  for (auto& operand : this->operands()) {
+    operands.push_back(loctx->GetOutputOp(operand));
+  }
+  return ReturnOp(
+      BuildQuantizedConvolution(operands[0], operands[1], operands[2],
+                                GetOptionalBias(operands), stride_, padding_,
+                                dilation_, groups_, params_),
+      loctx);
+}
+
+std::string QuantizedConvolution::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", stride=(" << absl::StrJoin(stride_, ", ")
+     << "), padding=(" << absl::StrJoin(padding_, ", ") << "), dilation=("
+     << absl::StrJoin(dilation_, ", ") << "), groups=" << groups_ << ", "
+     << ParamsToString(params_);
+  return ss.str();
+}
+
+}  // namespace torch_xla
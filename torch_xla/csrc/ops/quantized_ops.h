@@ -0,0 +1,68 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "torch_xla/csrc/ir.h"
+#include "torch_xla/csrc/quantized_ops.h"
+
+namespace torch_xla {
+
+// The int8 x int8 -> int32 matmul of the input and the (transposed) weight,
+// with the per channel scales of the weight, fused with the bias addition and
+// the requantization of the output.
+class QuantizedLinear : public XlaNode {
+ public:
+  QuantizedLinear(const torch::lazy::Value& input,
+                  const torch::lazy::Value& weight,
+                  const torch::lazy::Value& weight_scales,
+                  const absl::optional<torch::lazy::Value>& bias,
+                  const QuantizationParams& params);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  const QuantizationParams& params() const { return params_; }
+
+ private:
+  QuantizationParams params_;
+};
+
+// Same as QuantizedLinear, for the int8 convolution.
+class QuantizedConvolution : public XlaNode {
+ public:
+  QuantizedConvolution(const torch::lazy::Value& input,
+                       const torch::lazy::Value& weight,
+                       const torch::lazy::Value& weight_scales,
+                       const absl::optional<torch::lazy::Value>& bias,
+                       std::vector<int64_t> stride,
+                       std::vector<int64_t> padding,
+                       std::vector<int64_t> dilation, int64_t groups,
+                       const QuantizationParams& params);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  const std::vector<int64_t>& stride() const { return stride_; }
+
+  const std::vector<int64_t>& padding() const { return padding_; }
+
+  const std::vector<int64_t>& dilation() const { return dilation_; }
+
+  int64_t groups() const { return groups_; }
+
+  const QuantizationParams& params() const { return params_; }
+
+ private:
+  std::vector<int64_t> stride_;
+  std::vector<int64_t> padding_;
+  std::vector<int64_t> dilation_;
+  int64_t groups_;
+  QuantizationParams params_;
+};
+
+}  // namespace torch_xla
@@ -11,7 +11,9 @@ Scatter::Scatter(const torch::lazy::Value& input,
     : XlaNode(torch::lazy::OpKind(at::aten::scatter), {input, index, src},
               GetXlaShape(input),
               /*num_outputs=*/1, torch::lazy::MHash(dim)),
-      dim_(dim) {}
+      dim_(dim) {
+  MarkInPlaceUpdate();
+}
 
 torch::lazy::NodePtr Scatter::Clone(torch::lazy::OpList operands) const {
   return torch::lazy::MakeNode<Scatter>(operands.at(0), operands.at(1),
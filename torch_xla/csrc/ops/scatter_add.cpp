@@ -13,7 +13,9 @@ ScatterAdd::ScatterAdd(const torch::lazy::Value& input,
     : XlaNode(torch::lazy::OpKind(at::aten::scatter_add), {input, index, src},
               GetXlaShape(input),
               /*num_outputs=*/1, torch::lazy::MHash(dim)),
-      dim_(dim) {}
+      dim_(dim) {
+  MarkInPlaceUpdate();
+}
 
 torch::lazy::NodePtr ScatterAdd::Clone(torch::lazy::OpList operands) const {
   return torch::lazy::MakeNode<ScatterAdd>(operands.at(0), operands.at(1),
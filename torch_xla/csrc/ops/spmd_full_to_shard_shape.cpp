@@ -0,0 +1,40 @@
+#include "torch_xla/csrc/ops/spmd_full_to_shard_shape.h"
+
+#include "tensorflow/compiler/xla/service/hlo_sharding.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_sharding_util.h"
+
+namespace torch_xla {
+
+SpmdFullToShardShape::SpmdFullToShardShape(const torch::lazy::Value& input,
+                                           xla::OpSharding sharding)
+    : XlaNode(
+          xla_spmd_full_to_shard_shape, {input},
+          [&]() {
+            return ShardingUtil::GetShardShape(GetXlaShape(input), sharding);
+          },
+          /*num_outputs=*/1,
+          torch::lazy::MHash(sharding.SerializeAsString())),
+      sharding_(std::move(sharding)) {}
+
+torch::lazy::NodePtr SpmdFullToShardShape::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<SpmdFullToShardShape>(operands.at(0),
+                                                     sharding_);
+}
+
+XlaOpVector SpmdFullToShardShape::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  return ReturnOp(ShardingUtil::BuildFullToShardShape(input, sharding_),
+                  loctx);
+}
+
+std::string SpmdFullToShardShape::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", sharding="
+     << xla::HloSharding::FromProto(sharding_).ValueOrDie().ToString();
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Enters a manual sharding region: the input, sharded like the given sharding,
+// becomes its per device shard, which the ops up to the matching
+// SpmdShardToFullShape see as a whole tensor, and the collectives within the
+// region exchange between the devices.
+class SpmdFullToShardShape : public XlaNode {
+ public:
+  SpmdFullToShardShape(const torch::lazy::Value& input,
+                       xla::OpSharding sharding);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  const xla::OpSharding& sharding() const { return sharding_; }
+
+ private:
+  xla::OpSharding sharding_;
+};
+
+}  // namespace torch_xla
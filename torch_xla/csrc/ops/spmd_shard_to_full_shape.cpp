@@ -0,0 +1,52 @@
+#include "torch_xla/csrc/ops/spmd_shard_to_full_shape.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/service/hlo_sharding.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_sharding_util.h"
+
+namespace torch_xla {
+namespace {
+
+xla::Shape NodeOutputShape(const torch::lazy::Value& input,
+                           absl::Span<const int64_t> full_sizes) {
+  return xla::ShapeUtil::MakeShape(GetXlaShape(input).element_type(),
+                                   full_sizes);
+}
+
+}  // namespace
+
+SpmdShardToFullShape::SpmdShardToFullShape(const torch::lazy::Value& input,
+                                           xla::OpSharding sharding,
+                                           std::vector<int64_t> full_sizes)
+    : XlaNode(xla_spmd_shard_to_full_shape, {input},
+              [&]() { return NodeOutputShape(input, full_sizes); },
+              /*num_outputs=*/1,
+              torch::lazy::MHash(sharding.SerializeAsString(), full_sizes)),
+      sharding_(std::move(sharding)),
+      full_sizes_(std::move(full_sizes)) {}
+
+torch::lazy::NodePtr SpmdShardToFullShape::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<SpmdShardToFullShape>(operands.at(0),
+                                                     sharding_, full_sizes_);
+}
+
+XlaOpVector SpmdShardToFullShape::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  return ReturnOp(
+      ShardingUtil::BuildShardToFullShape(input, sharding_, xla_shape()),
+      loctx);
+}
+
+std::string SpmdShardToFullShape::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", sharding="
+     << xla::HloSharding::FromProto(sharding_).ValueOrDie().ToString()
+     << ", full_sizes=(" << absl::StrJoin(full_sizes_, ", ") << ")";
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Leaves a manual sharding region: the per device shards become the global
+// tensor of the given sizes, sharded like the given sharding.
+class SpmdShardToFullShape : public XlaNode {
+ public:
+  SpmdShardToFullShape(const torch::lazy::Value& input,
+                       xla::OpSharding sharding,
+                       std::vector<int64_t> full_sizes);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  const xla::OpSharding& sharding() const { return sharding_; }
+
+  const std::vector<int64_t>& full_sizes() const { return full_sizes_; }
+
+ private:
+  xla::OpSharding sharding_;
+  std::vector<int64_t> full_sizes_;
+};
+
+}  // namespace torch_xla
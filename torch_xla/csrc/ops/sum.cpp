@@ -28,7 +28,10 @@ xla::Shape NodeOutputShape(const torch::lazy::Value& input,
       [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
     return LowerSum(operands[0], dimensions, keep_reduced_dimensions, dtype);
   };
-  return InferOutputShape({GetXlaShape(input)}, lower_for_shape_fn);
+  const xla::Shape& input_shape = GetXlaShape(input);
+  return InferReduceShape(
+      input_shape, CastToScalarTypeType(input_shape.element_type(), dtype),
+      dimensions, keep_reduced_dimensions, lower_for_shape_fn);
 }
 
 }  // namespace
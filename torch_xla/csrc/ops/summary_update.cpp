@@ -0,0 +1,51 @@
+#include "torch_xla/csrc/ops/summary_update.h"
+
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/xla_lower_util.h"
+
+namespace torch_xla {
+
+SummaryUpdate::SummaryUpdate(const torch::lazy::Value& state,
+                             const torch::lazy::Value& value, Kind kind,
+                             double ema_decay, double min_value,
+                             double max_value)
+    : XlaNode(xla_summary_update, {state, value}, GetXlaShape(state),
+              /*num_outputs=*/1,
+              torch::lazy::MHash(static_cast<int>(kind), ema_decay, min_value,
+                                 max_value)),
+      kind_(kind),
+      ema_decay_(ema_decay),
+      min_value_(min_value),
+      max_value_(max_value) {}
+
+torch::lazy::NodePtr SummaryUpdate::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<SummaryUpdate>(operands.at(0), operands.at(1),
+                                              kind_, ema_decay_, min_value_,
+                                              max_value_);
+}
+
+XlaOpVector SummaryUpdate::Lower(LoweringContext* loctx) const {
+  xla::XlaOp state = loctx->GetOutputOp(operand(0));
+  xla::XlaOp value = loctx->GetOutputOp(operand(1));
+  if (kind_ == Kind::kHistogram) {
+    return ReturnOp(
+        BuildSummaryHistogramUpdate(state, value, min_value_, max_value_),
+        loctx);
+  }
+  return ReturnOp(BuildSummaryScalarUpdate(state, value, ema_decay_), loctx);
+}
+
+std::string SummaryUpdate::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString();
+  if (kind_ == Kind::kHistogram) {
+    ss << ", histogram, min_value=" << min_value_
+       << ", max_value=" << max_value_;
+  } else {
+    ss << ", scalar, ema_decay=" << ema_decay_;
+  }
+  return ss.str();
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Folds a value into the state tensor of a device resident summary, returning
+// the new state. A scalar summary state is a F32[kSummaryScalarStateSize]
+// tensor holding the count, sum, min, max, last mean and running average of
+// the folded values. A histogram summary state holds the F32 counts of its
+// bins, which evenly split [min_value, max_value).
+class SummaryUpdate : public XlaNode {
+ public:
+  enum class Kind {
+    kScalar,
+    kHistogram,
+  };
+
+  SummaryUpdate(const torch::lazy::Value& state,
+                const torch::lazy::Value& value, Kind kind, double ema_decay,
+                double min_value, double max_value);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  Kind kind() const { return kind_; }
+
+  double ema_decay() const { return ema_decay_; }
+
+  double min_value() const { return min_value_; }
+
+  double max_value() const { return max_value_; }
+
+ private:
+  Kind kind_;
+  double ema_decay_;
+  double min_value_;
+  double max_value_;
+};
+
+}  // namespace torch_xla
@@ -8,11 +8,42 @@
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/small_matrix.h"
 
 namespace torch_xla {
 namespace {
 
+// The small matrix lowering only computes the reduced singular vectors, which
+// are the full ones of the square matrices.
+std::vector<xla::XlaOp> LowerSmallSVD(xla::XlaOp input, bool some,
+                                      bool compute_uv) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t m_dim = input_shape.dimensions(input_shape.rank() - 2);
+  int64_t n_dim = input_shape.dimensions(input_shape.rank() - 1);
+  SmallSvdResult svd_result = BuildSmallSvd(input);
+  xla::XlaOp u = svd_result.u;
+  xla::XlaOp v = svd_result.v;
+  if (!compute_uv) {
+    xla::Shape ushape(input_shape);
+    ushape.set_dimensions(input_shape.rank() - 1, m_dim);
+    xla::Shape vshape(input_shape);
+    vshape.set_dimensions(input_shape.rank() - 2, n_dim);
+    vshape.set_dimensions(input_shape.rank() - 1,
+                          some ? std::min(m_dim, n_dim) : n_dim);
+    u = xla::Zeros(input.builder(), ushape);
+    v = xla::Zeros(input.builder(), vshape);
+  }
+  return {u, svd_result.d, v};
+}
+
 std::vector<xla::XlaOp> LowerSVD(xla::XlaOp input, bool some, bool compute_uv) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  if (IsSmallSvdMatrix(shape) &&
+      (some || !compute_uv ||
+       shape.dimensions(shape.rank() - 2) ==
+           shape.dimensions(shape.rank() - 1))) {
+    return LowerSmallSVD(input, some, compute_uv);
+  }
   xla::SVDResult svd_result =
       xla::SVD(input, /*max_iter=*/100, /*epsilon=*/1e-6,
                XlaHelpers::mat_mul_precision());
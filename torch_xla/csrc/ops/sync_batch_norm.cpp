@@ -0,0 +1,150 @@
+#include "torch_xla/csrc/ops/sync_batch_norm.h"
+
+#include "absl/strings/str_join.h"
+#include "torch_xla/csrc/batch_norm.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/infer_output_shape.h"
+#include "torch_xla/csrc/ops/xla_ops.h"
+
+namespace torch_xla {
+namespace {
+
+xla::Shape NodeOutputShape(const torch::lazy::Value& input,
+                           const torch::lazy::Value& weight,
+                           const torch::lazy::Value& bias,
+                           const torch::lazy::Value& token,
+                           const std::vector<std::vector<int64_t>>& groups,
+                           bool pin_layout) {
+  auto shape_fn = [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    SyncBatchNormOutput result = BuildSyncBatchNormTraining(
+        operands[0], operands[1], operands[2], operands[3], 0.5, groups,
+        pin_layout);
+    return xla::Tuple(operands[0].builder(),
+                      {result.output, result.batch_mean,
+                       result.batch_variance, result.token});
+  };
+  return InferOutputShape({GetXlaShape(input), GetXlaShape(weight),
+                           GetXlaShape(bias), GetXlaShape(token)},
+                          shape_fn);
+}
+
+xla::Shape BackwardOutputShape(
+    const torch::lazy::Value& grad, const torch::lazy::Value& input,
+    const torch::lazy::Value& weight, const torch::lazy::Value& mean,
+    const torch::lazy::Value& variance, const torch::lazy::Value& token,
+    const std::vector<std::vector<int64_t>>& groups, bool pin_layout) {
+  auto shape_fn = [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    SyncBatchNormGrads grads = BuildSyncBatchNormBackward(
+        operands[0], operands[1], operands[2], operands[3], operands[4],
+        operands[5], 0.5, groups, pin_layout);
+    return xla::Tuple(operands[0].builder(),
+                      {grads.grad_input, grads.grad_weight, grads.grad_bias,
+                       grads.token});
+  };
+  return InferOutputShape(
+      {GetXlaShape(grad), GetXlaShape(input), GetXlaShape(weight),
+       GetXlaShape(mean), GetXlaShape(variance), GetXlaShape(token)},
+      shape_fn);
+}
+
+std::string GroupsToString(const std::vector<std::vector<int64_t>>& groups) {
+  std::stringstream ss;
+  ss << "(";
+  for (size_t i = 0; i < groups.size(); ++i) {
+    ss << (i == 0 ? "(" : ",(");
+    ss << absl::StrJoin(groups[i], ", ") << ")";
+  }
+  ss << ")";
+  return ss.str();
+}
+
+}  // namespace
+
+SyncBatchNorm::SyncBatchNorm(const torch::lazy::Value& input,
+                             const torch::lazy::Value& weight,
+                             const torch::lazy::Value& bias,
+                             const torch::lazy::Value& token, double eps,
+                             std::vector<std::vector<int64_t>> groups,
+                             bool pin_layout)
+    : XlaNode(xla_sync_batch_norm, {input, weight, bias, token},
+              [&]() {
+                return NodeOutputShape(input, weight, bias, token, groups,
+                                       pin_layout);
+              },
+              /*num_outputs=*/4, torch::lazy::MHash(eps, groups, pin_layout)),
+      eps_(eps),
+      groups_(std::move(groups)),
+      pin_layout_(pin_layout) {}
+
+torch::lazy::NodePtr SyncBatchNorm::Clone(torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<SyncBatchNorm>(operands.at(0), operands.at(1),
+                                              operands.at(2), operands.at(3),
+                                              eps_, groups_, pin_layout_);
+}
+
+XlaOpVector SyncBatchNorm::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp weight = loctx->GetOutputOp(operand(1));
+  xla::XlaOp bias = loctx->GetOutputOp(operand(2));
+  xla::XlaOp token = loctx->GetOutputOp(operand(3));
+  SyncBatchNormOutput result = BuildSyncBatchNormTraining(
+      input, weight, bias, token, eps_, groups_, pin_layout_);
+  return ReturnOps({result.output, result.batch_mean, result.batch_variance,
+                    result.token},
+                   loctx);
+}
+
+std::string SyncBatchNorm::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", eps=" << eps_
+     << ", pin_layout=" << pin_layout_
+     << ", groups=" << GroupsToString(groups_);
+  return ss.str();
+}
+
+SyncBatchNormBackward::SyncBatchNormBackward(
+    const torch::lazy::Value& grad, const torch::lazy::Value& input,
+    const torch::lazy::Value& weight, const torch::lazy::Value& mean,
+    const torch::lazy::Value& variance, const torch::lazy::Value& token,
+    double eps, std::vector<std::vector<int64_t>> groups, bool pin_layout)
+    : XlaNode(xla_sync_batch_norm_backward,
+              {grad, input, weight, mean, variance, token},
+              [&]() {
+                return BackwardOutputShape(grad, input, weight, mean, variance,
+                                           token, groups, pin_layout);
+              },
+              /*num_outputs=*/4, torch::lazy::MHash(eps, groups, pin_layout)),
+      eps_(eps),
+      groups_(std::move(groups)),
+      pin_layout_(pin_layout) {}
+
+torch::lazy::NodePtr SyncBatchNormBackward::Clone(
+    torch::lazy::OpList operands) const {
+  return torch::lazy::MakeNode<SyncBatchNormBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3),
+      operands.at(4), operands.at(5), eps_, groups_, pin_layout_);
+}
+
+XlaOpVector SyncBatchNormBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad = loctx->GetOutputOp(operand(0));
+  xla::XlaOp input = loctx->GetOutputOp(operand(1));
+  xla::XlaOp weight = loctx->GetOutputOp(operand(2));
+  xla::XlaOp mean = loctx->GetOutputOp(operand(3));
+  xla::XlaOp variance = loctx->GetOutputOp(operand(4));
+  xla::XlaOp token = loctx->GetOutputOp(operand(5));
+  SyncBatchNormGrads grads = BuildSyncBatchNormBackward(
+      grad, input, weight, mean, variance, token, eps_, groups_, pin_layout_);
+  return ReturnOps(
+      {grads.grad_input, grads.grad_weight, grads.grad_bias, grads.token},
+      loctx);
+}
+
+std::string SyncBatchNormBackward::ToString() const {
+  std::stringstream ss;
+  ss << XlaNode::ToString() << ", eps=" << eps_
+     << ", pin_layout=" << pin_layout_
+     << ", groups=" << GroupsToString(groups_);
+  return ss.str();
+}
+
+}  // namespace torch_xla
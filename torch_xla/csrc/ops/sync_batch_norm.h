@@ -0,0 +1,68 @@
+#pragma once
+
+#include "torch_xla/csrc/cross_replica_reduces.h"
+#include "torch_xla/csrc/ir.h"
+
+namespace torch_xla {
+
+// Batch normalization with the statistics of all the replicas of the groups.
+// The outputs are the normalized input, the batch mean and (biased) variance
+// which the backward node consumes, and the new token.
+class SyncBatchNorm : public XlaNode {
+ public:
+  SyncBatchNorm(const torch::lazy::Value& input,
+                const torch::lazy::Value& weight,
+                const torch::lazy::Value& bias,
+                const torch::lazy::Value& token, double eps,
+                std::vector<std::vector<int64_t>> groups, bool pin_layout);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double eps() const { return eps_; }
+
+  const std::vector<std::vector<int64_t>>& groups() const { return groups_; }
+
+  bool pin_layout() const { return pin_layout_; }
+
+ private:
+  double eps_;
+  std::vector<std::vector<int64_t>> groups_;
+  bool pin_layout_;
+};
+
+// Outputs the gradients of the input, weight and bias of a SyncBatchNorm node,
+// and the new token.
+class SyncBatchNormBackward : public XlaNode {
+ public:
+  SyncBatchNormBackward(const torch::lazy::Value& grad,
+                        const torch::lazy::Value& input,
+                        const torch::lazy::Value& weight,
+                        const torch::lazy::Value& mean,
+                        const torch::lazy::Value& variance,
+                        const torch::lazy::Value& token, double eps,
+                        std::vector<std::vector<int64_t>> groups,
+                        bool pin_layout);
+
+  std::string ToString() const override;
+
+  torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  double eps() const { return eps_; }
+
+  const std::vector<std::vector<int64_t>>& groups() const { return groups_; }
+
+  bool pin_layout() const { return pin_layout_; }
+
+ private:
+  double eps_;
+  std::vector<std::vector<int64_t>> groups_;
+  bool pin_layout_;
+};
+
+}  // namespace torch_xla
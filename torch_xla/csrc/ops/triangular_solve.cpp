@@ -4,6 +4,7 @@
 #include "tensorflow/compiler/xla/layout_util.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/small_matrix.h"
 
 namespace torch_xla {
 namespace {
@@ -55,6 +56,12 @@ std::vector<xla::XlaOp> LowerTriangularSolve(xla::XlaOp rhs, xla::XlaOp lhs,
   xla::XlaOp lhs_broadcasted =
       XlaHelpers::ImplicitBroadcast(lhs, lhs_shape, broadcasted_shapes.second);
 
+  if (IsSmallMatrix(broadcasted_shapes.second)) {
+    return {BuildSmallTriangularSolve(lhs_broadcasted, rhs_broadcasted,
+                                      left_side, lower, transpose,
+                                      unit_diagonal),
+            lhs_broadcasted};
+  }
   xla::XlaOp solution = xla::TriangularSolve(
       lhs_broadcasted, rhs_broadcasted, left_side, lower, unit_diagonal,
       transpose ? xla::TriangularSolveOptions::TRANSPOSE
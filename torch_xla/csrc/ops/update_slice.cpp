@@ -31,7 +31,18 @@ UpdateSlice::UpdateSlice(const torch::lazy::Value& input,
               /*num_outputs=*/1, torch::lazy::Hash(base_indices)),
       base_indices_(base_indices.begin(), base_indices.end()) {}
 
+UpdateSlice::UpdateSlice(const torch::lazy::Value& input,
+                         const torch::lazy::Value& source,
+                         const torch::lazy::Value& offset, int64_t dim)
+    : XlaNode(xla_update_slice, {input, source, offset}, GetXlaShape(input),
+              /*num_outputs=*/1, torch::lazy::MHash(dim)),
+      dim_(dim) {}
+
 torch::lazy::NodePtr UpdateSlice::Clone(torch::lazy::OpList operands) const {
+  if (dim_ >= 0) {
+    return torch::lazy::MakeNode<UpdateSlice>(operands.at(0), operands.at(1),
+                                              operands.at(2), dim_);
+  }
   return torch::lazy::MakeNode<UpdateSlice>(operands.at(0), operands.at(1),
                                             base_indices_);
 }
@@ -39,14 +50,21 @@ torch::lazy::NodePtr UpdateSlice::Clone(torch::lazy::OpList operands) const {
 XlaOpVector UpdateSlice::Lower(LoweringContext* loctx) const {
   xla::XlaOp input = loctx->GetOutputOp(operand(0));
   xla::XlaOp source = loctx->GetOutputOp(operand(1));
-  xla::XlaOp output = BuildUpdateSlice(input, source, base_indices_);
+  xla::XlaOp output =
+      dim_ >= 0 ? BuildDynamicUpdateSlice(input, source,
+                                          loctx->GetOutputOp(operand(2)), dim_)
+                : BuildUpdateSlice(input, source, base_indices_);
   return ReturnOp(output, loctx);
 }
 
 std::string UpdateSlice::ToString() const {
   std::stringstream ss;
-  ss << XlaNode::ToString() << ", base_indices=("
-     << absl::StrJoin(base_indices_, ", ") << ")";
+  ss << XlaNode::ToString();
+  if (dim_ >= 0) {
+    ss << ", dim=" << dim_;
+  } else {
+    ss << ", base_indices=(" << absl::StrJoin(base_indices_, ", ") << ")";
+  }
   return ss.str();
 }
 
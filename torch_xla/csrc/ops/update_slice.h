@@ -10,6 +10,12 @@ class UpdateSlice : public XlaNode {
   UpdateSlice(const torch::lazy::Value& input, const torch::lazy::Value& source,
               absl::Span<const int64_t> base_indices);
 
+  // Updates the slice of input starting at the offset scalar along dim, and at
+  // zero along the other dimensions. The offset is an operand, so the appends
+  // at growing offsets all share the same graph.
+  UpdateSlice(const torch::lazy::Value& input, const torch::lazy::Value& source,
+              const torch::lazy::Value& offset, int64_t dim);
+
   torch::lazy::NodePtr Clone(torch::lazy::OpList operands) const override;
 
   XlaOpVector Lower(LoweringContext* loctx) const override;
@@ -20,6 +26,8 @@ class UpdateSlice : public XlaNode {
 
  private:
   std::vector<int64_t> base_indices_;
+  // The dimension of the dynamic offset, if the node has one.
+  int64_t dim_ = -1;
 };
 
 }  // namespace torch_xla
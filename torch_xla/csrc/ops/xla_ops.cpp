@@ -2,21 +2,46 @@
 
 namespace torch_xla {
 
+const OpKindWrapper xla_adafactor_optimizer_step(
+    "xla::adafactor_optimizer_step");
 const OpKindWrapper xla_adam_optimizer_step("xla::adam_optimizer_step");
 const OpKindWrapper xla_all_gather("xla::all_gather");
 const OpKindWrapper xla_all_to_all("xla::all_to_all");
 const OpKindWrapper xla_as_strided_view_update("xla::as_strided_view_update");
+const OpKindWrapper xla_batched_nms("xla::batched_nms");
 const OpKindWrapper xla_cast("xla::cast");
 const OpKindWrapper xla_collective_permute("xla::collective_permute");
+const OpKindWrapper xla_compressed_all_reduce("xla::compressed_all_reduce");
+const OpKindWrapper xla_crop_and_resize("xla::crop_and_resize");
+const OpKindWrapper xla_cross_entropy("xla::cross_entropy");
+const OpKindWrapper xla_cross_entropy_backward("xla::cross_entropy_backward");
 const OpKindWrapper xla_cross_replica_sum("xla::cross_replica_sum");
 const OpKindWrapper xla_device_data("xla::device_data");
 const OpKindWrapper xla_diagonal_view_update("xla::diagonal_view_update");
+const OpKindWrapper xla_dropout("xla::dropout");
+const OpKindWrapper xla_dropout_backward("xla::dropout_backward");
+const OpKindWrapper xla_embedding_bag_sparse_sgd(
+    "xla::embedding_bag_sparse_sgd");
+const OpKindWrapper xla_flash_attention("xla::flash_attention");
+const OpKindWrapper xla_flash_attention_backward(
+    "xla::flash_attention_backward");
+const OpKindWrapper xla_foreach_adam_optimizer_step(
+    "xla::foreach_adam_optimizer_step");
+const OpKindWrapper xla_foreach_clip_norm("xla::foreach_clip_norm");
+const OpKindWrapper xla_foreach_norm("xla::foreach_norm");
+const OpKindWrapper xla_foreach_pointwise("xla::foreach_pointwise");
 const OpKindWrapper xla_generic_slice("xla::generic_slice");
 const OpKindWrapper xla_get_dimensions_size("xla::xla_get_dimensions_size");
+const OpKindWrapper xla_host_callback("xla::host_callback");
+const OpKindWrapper xla_lamb_optimizer_step("xla::lamb_optimizer_step");
+const OpKindWrapper xla_layer_norm("xla::layer_norm");
+const OpKindWrapper xla_layer_norm_backward("xla::layer_norm_backward");
 const OpKindWrapper xla_moving_average("xla::moving_average");
 const OpKindWrapper xla_nms("xla::nms");
 const OpKindWrapper xla_not_supported("xla::not_supported");
 const OpKindWrapper xla_optimization_barrier("xla::optimization_barrier");
+const OpKindWrapper xla_quantized_convolution("xla::quantized_convolution");
+const OpKindWrapper xla_quantized_linear("xla::quantized_linear");
 const OpKindWrapper xla_recv("xla::recv");
 const OpKindWrapper xla_reduce_scatter("xla::reduce_scatter");
 const OpKindWrapper xla_replication_pad("xla::replication_pad");
@@ -25,6 +50,14 @@ const OpKindWrapper xla_replication_pad_backward(
 const OpKindWrapper xla_select("xla::select");
 const OpKindWrapper xla_send("xla::send");
 const OpKindWrapper xla_sgd_optimizer_step("xla::sgd_optimizer_step");
+const OpKindWrapper xla_spmd_full_to_shard_shape(
+    "xla::spmd_full_to_shard_shape");
+const OpKindWrapper xla_spmd_shard_to_full_shape(
+    "xla::spmd_shard_to_full_shape");
+const OpKindWrapper xla_summary_update("xla::summary_update");
+const OpKindWrapper xla_sync_batch_norm("xla::sync_batch_norm");
+const OpKindWrapper xla_sync_batch_norm_backward(
+    "xla::sync_batch_norm_backward");
 const OpKindWrapper xla_tensor_data("xla::tensor_data");
 const OpKindWrapper xla_unselect("xla::unselect");
 const OpKindWrapper xla_update_slice("xla::update_slice");
@@ -27,21 +27,42 @@ class OpKindWrapper {
   mutable std::once_flag once_;
 };
 
+extern const OpKindWrapper xla_adafactor_optimizer_step;
 extern const OpKindWrapper xla_adam_optimizer_step;
 extern const OpKindWrapper xla_all_gather;
 extern const OpKindWrapper xla_all_to_all;
 extern const OpKindWrapper xla_as_strided_view_update;
+extern const OpKindWrapper xla_batched_nms;
 extern const OpKindWrapper xla_cast;
 extern const OpKindWrapper xla_collective_permute;
+extern const OpKindWrapper xla_compressed_all_reduce;
+extern const OpKindWrapper xla_crop_and_resize;
+extern const OpKindWrapper xla_cross_entropy;
+extern const OpKindWrapper xla_cross_entropy_backward;
 extern const OpKindWrapper xla_cross_replica_sum;
 extern const OpKindWrapper xla_device_data;
 extern const OpKindWrapper xla_diagonal_view_update;
+extern const OpKindWrapper xla_dropout;
+extern const OpKindWrapper xla_dropout_backward;
+extern const OpKindWrapper xla_embedding_bag_sparse_sgd;
+extern const OpKindWrapper xla_flash_attention;
+extern const OpKindWrapper xla_flash_attention_backward;
+extern const OpKindWrapper xla_foreach_adam_optimizer_step;
+extern const OpKindWrapper xla_foreach_clip_norm;
+extern const OpKindWrapper xla_foreach_norm;
+extern const OpKindWrapper xla_foreach_pointwise;
 extern const OpKindWrapper xla_generic_slice;
 extern const OpKindWrapper xla_get_dimensions_size;
+extern const OpKindWrapper xla_host_callback;
+extern const OpKindWrapper xla_lamb_optimizer_step;
+extern const OpKindWrapper xla_layer_norm;
+extern const OpKindWrapper xla_layer_norm_backward;
 extern const OpKindWrapper xla_moving_average;
 extern const OpKindWrapper xla_nms;
 extern const OpKindWrapper xla_not_supported;
 extern const OpKindWrapper xla_optimization_barrier;
+extern const OpKindWrapper xla_quantized_convolution;
+extern const OpKindWrapper xla_quantized_linear;
 extern const OpKindWrapper xla_recv;
 extern const OpKindWrapper xla_reduce_scatter;
 extern const OpKindWrapper xla_replication_pad;
@@ -49,6 +70,11 @@ extern const OpKindWrapper xla_replication_pad_backward;
 extern const OpKindWrapper xla_select;
 extern const OpKindWrapper xla_send;
 extern const OpKindWrapper xla_sgd_optimizer_step;
+extern const OpKindWrapper xla_spmd_full_to_shard_shape;
+extern const OpKindWrapper xla_spmd_shard_to_full_shape;
+extern const OpKindWrapper xla_summary_update;
+extern const OpKindWrapper xla_sync_batch_norm;
+extern const OpKindWrapper xla_sync_batch_norm_backward;
 extern const OpKindWrapper xla_tensor_data;
 extern const OpKindWrapper xla_unselect;
 extern const OpKindWrapper xla_update_slice;
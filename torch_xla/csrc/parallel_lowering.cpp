@@ -0,0 +1,250 @@
+#include "torch_xla/csrc/parallel_lowering.h"
+
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/ops/device_data.h"
+
+namespace torch_xla {
+namespace {
+
+// Owner value of the nodes reachable from the roots of more than one group.
+constexpr int64_t kShared = -1;
+
+struct Group {
+  // The nodes owned by the group, in post order.
+  std::vector<const torch::lazy::Node*> nodes;
+  // The outputs of shared nodes used by the group nodes.
+  std::vector<torch::lazy::Output> inputs;
+  std::vector<xla::Shape> input_shapes;
+  // The root outputs owned by the group.
+  std::vector<torch::lazy::Output> outputs;
+  xla::XlaComputation computation;
+  std::vector<LoweringContext::ParameterSource> parameter_sources;
+};
+
+size_t GetMinGroupNodes() {
+  static const size_t min_group_nodes = xla::sys_util::GetEnvInt(
+      "XLA_PARALLEL_LOWERING_MIN_GROUP_NODES", 256);
+  return min_group_nodes;
+}
+
+// Returns the outputs a node needs from other nodes, in order to be lowered.
+// Replaced nodes get the ones of their replacement assigned.
+std::vector<torch::lazy::Output> GetInputs(
+    const torch::lazy::Node* node,
+    const ParallelLowering::ReplacementFn& replacement_fn) {
+  const torch::lazy::Node* replacement =
+      replacement_fn != nullptr ? replacement_fn(node) : nullptr;
+  if (replacement == nullptr) {
+    return std::vector<torch::lazy::Output>(node->operands().begin(),
+                                            node->operands().end());
+  }
+  std::vector<torch::lazy::Output> inputs;
+  for (size_t i = 0; i < node->num_outputs(); ++i) {
+    inputs.emplace_back(replacement, i);
+  }
+  return inputs;
+}
+
+void LowerNode(const torch::lazy::Node* node,
+               const ParallelLowering::ReplacementFn& replacement_fn,
+               LoweringContext* loctx) {
+  const torch::lazy::Node* replacement =
+      replacement_fn != nullptr ? replacement_fn(node) : nullptr;
+  if (replacement == nullptr) {
+    loctx->LowerNode(node);
+    return;
+  }
+  for (size_t i = 0; i < node->num_outputs(); ++i) {
+    loctx->AssignOutputOp(
+        torch::lazy::Output(node, i),
+        loctx->GetOutputOp(torch::lazy::Output(replacement, i)));
+  }
+}
+
+void LowerGroup(const std::string& name,
+                const torch::lazy::BackendDevice& device,
+                const ParallelLowering::ReplacementFn& replacement_fn,
+                Group* group) {
+  LoweringContext loctx(name, device);
+  for (size_t i = 0; i < group->inputs.size(); ++i) {
+    loctx.AddOutputParameter(group->inputs[i], group->input_shapes[i]);
+  }
+  for (auto node : group->nodes) {
+    LowerNode(node, replacement_fn, &loctx);
+  }
+  std::vector<xla::XlaOp> results;
+  for (auto& output : group->outputs) {
+    results.push_back(loctx.GetOutputOp(output));
+  }
+  group->computation =
+      ConsumeValue(loctx.BuildXla(xla::Tuple(loctx.builder(), results)));
+  group->parameter_sources = loctx.GetParameterSources();
+}
+
+}  // namespace
+
+size_t ParallelLowering::GetMinNodes() {
+  static const size_t min_nodes =
+      xla::sys_util::GetEnvInt("XLA_PARALLEL_LOWERING_MIN_NODES", 0);
+  return min_nodes;
+}
+
+bool ParallelLowering::Lower(
+    absl::Span<const torch::lazy::Node* const> post_order,
+    absl::Span<const torch::lazy::Output> roots,
+    const ReplacementFn& replacement_fn, LoweringContext* loctx) {
+  size_t num_groups = std::min<size_t>(
+      std::max<unsigned>(std::thread::hardware_concurrency(), 1),
+      roots.size());
+  if (num_groups < 2) {
+    return false;
+  }
+  std::unordered_map<const torch::lazy::Node*, size_t> positions;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    const XlaNode* xla_node = dynamic_cast<const XlaNode*>(post_order[i]);
+    // The sharding annotations are applied on the main computation outputs.
+    if (xla_node == nullptr || xla_node->GetSharding() != nullptr) {
+      return false;
+    }
+    positions.emplace(post_order[i], i);
+  }
+
+  // Every node users come before it in reverse post order, so by the time a
+  // node is visited its owner is final, and can be pushed to its inputs.
+  std::vector<int64_t> owners(post_order.size(), kShared);
+  std::vector<bool> owned(post_order.size(), false);
+  auto set_owner = [&](size_t position, int64_t owner) {
+    if (!owned[position]) {
+      owners[position] = owner;
+      owned[position] = true;
+    } else if (owners[position] != owner) {
+      owners[position] = kShared;
+    }
+  };
+  for (size_t i = 0; i < roots.size(); ++i) {
+    set_owner(positions.at(roots[i].node), i * num_groups / roots.size());
+  }
+  for (size_t i = post_order.size(); i > 0; --i) {
+    for (auto& input : GetInputs(post_order[i - 1], replacement_fn)) {
+      auto it = positions.find(input.node);
+      // Nodes created by the IR simplification are not part of the post
+      // order, and get lowered by the first context needing them.
+      if (it != positions.end()) {
+        set_owner(it->second, owners[i - 1]);
+      }
+    }
+  }
+
+  std::vector<size_t> group_sizes(num_groups, 0);
+  for (auto owner : owners) {
+    if (owner != kShared) {
+      group_sizes[owner] += 1;
+    }
+  }
+  std::vector<int64_t> group_index(num_groups, kShared);
+  std::vector<Group> groups;
+  for (size_t i = 0; i < num_groups; ++i) {
+    if (group_sizes[i] >= GetMinGroupNodes()) {
+      group_index[i] = groups.size();
+      groups.emplace_back();
+    }
+  }
+  if (groups.size() < 2) {
+    return false;
+  }
+  // The nodes of the groups too small to be worth it become shared ones, which
+  // keeps the inputs of the shared nodes all shared.
+  for (auto& owner : owners) {
+    if (owner != kShared) {
+      owner = group_index[owner];
+    }
+  }
+  XLA_COUNTER("ParallelLoweringGraphs", 1);
+  XLA_VALUE_METRIC("ParallelLoweringGroups", groups.size());
+
+  // Declare the parameters in post order first, as the main computation
+  // parameters need to match the order in which the graph data is collected.
+  for (auto node : post_order) {
+    const DeviceData* device_data = DeviceData::Cast(node);
+    if (device_data != nullptr) {
+      loctx->GetParameter(device_data->data());
+    }
+  }
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    if (owners[i] == kShared) {
+      LowerNode(post_order[i], replacement_fn, loctx);
+    }
+  }
+
+  using OutputSet =
+      std::unordered_set<torch::lazy::Output, torch::lazy::Output::Hasher>;
+  std::vector<OutputSet> group_inputs(groups.size());
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    if (owners[i] == kShared) {
+      continue;
+    }
+    Group* group = &groups[owners[i]];
+    group->nodes.push_back(post_order[i]);
+    for (auto& input : GetInputs(post_order[i], replacement_fn)) {
+      auto it = positions.find(input.node);
+      if (it != positions.end() && owners[it->second] == kShared &&
+          group_inputs[owners[i]].insert(input).second) {
+        group->inputs.push_back(input);
+        group->input_shapes.push_back(
+            XlaHelpers::ShapeOfXlaOp(loctx->GetOutputOp(input)));
+      }
+    }
+  }
+  OutputSet group_outputs;
+  for (auto& root : roots) {
+    int64_t owner = owners[positions.at(root.node)];
+    if (owner != kShared && group_outputs.insert(root).second) {
+      groups[owner].outputs.push_back(root);
+    }
+  }
+
+  {
+    XLA_TIMED("ParallelLowering");
+    xla::util::MultiWait mwait(groups.size());
+    for (size_t i = 0; i < groups.size(); ++i) {
+      auto lowerfn = [&, i]() {
+        LowerGroup(absl::StrCat(loctx->builder()->name(), "_", i),
+                   loctx->device(), replacement_fn, &groups[i]);
+      };
+      xla::env::ScheduleClosure(mwait.Completer(std::move(lowerfn)));
+    }
+    mwait.Wait();
+  }
+
+  for (auto& group : groups) {
+    std::vector<xla::XlaOp> operands;
+    for (auto& source : group.parameter_sources) {
+      operands.push_back(source.data != nullptr
+                             ? loctx->GetParameter(source.data)
+                             : loctx->GetOutputOp(source.output));
+    }
+    xla::XlaOp call = xla::Call(loctx->builder(), group.computation, operands);
+    for (size_t i = 0; i < group.outputs.size(); ++i) {
+      loctx->AssignOutputOp(group.outputs[i], xla::GetTupleElement(call, i));
+    }
+  }
+  TF_VLOG(4) << "Lowered " << post_order.size() << " IR nodes in "
+             << groups.size() << " parallel groups";
+  return true;
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+
+#include "absl/types/span.h"
+#include "torch_xla/csrc/lowering_context.h"
+
+namespace torch_xla {
+
+// Lowers the independent sub-graphs of big IR graphs concurrently. The roots
+// get split into groups, and the nodes only reachable from the roots of a
+// group are lowered into a separate computation, by a separate thread, while
+// the nodes shared among groups are lowered into the main context first. The
+// main computation then calls the group computations, feeding them the shared
+// values and the device data they need (the XLA compiler inlines the calls).
+class ParallelLowering {
+ public:
+  // Returns the node whose outputs replace the ones of the given node, or
+  // nullptr if the node needs to be lowered.
+  using ReplacementFn =
+      std::function<const torch::lazy::Node*(const torch::lazy::Node*)>;
+
+  // Returns the minimum number of nodes of the graphs to be lowered in
+  // parallel (XLA_PARALLEL_LOWERING_MIN_NODES), or zero if disabled.
+  static size_t GetMinNodes();
+
+  // Lowers all nodes of the post order into loctx, which must not have any
+  // lowered node yet. Returns false, without lowering anything, if the graph
+  // does not have enough independent sub-graphs big enough to be worth it.
+  static bool Lower(absl::Span<const torch::lazy::Node* const> post_order,
+                    absl::Span<const torch::lazy::Output> roots,
+                    const ReplacementFn& replacement_fn,
+                    LoweringContext* loctx);
+};
+
+}  // namespace torch_xla
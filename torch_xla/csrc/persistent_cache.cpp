@@ -0,0 +1,312 @@
+#include "torch_xla/csrc/persistent_cache.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/service/hlo.pb.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/core/lib/io/record_reader.h"
+#include "tensorflow/core/lib/io/record_writer.h"
+#include "tensorflow/core/platform/env.h"
+#include "torch_xla/csrc/version.h"
+
+namespace torch_xla {
+namespace {
+
+// Bump this every time the layout of the records within an entry changes.
+const int kEntryFormat = 1;
+
+std::string GetVersionStamp() {
+  return absl::StrCat(kEntryFormat, ":", XLA_GITREV, ":", TORCH_GITREV, ":",
+                      xla::sys_util::GetEnvString("XLA_FLAGS", ""));
+}
+
+// The records of an entry, in the order they are written within the file.
+enum EntryRecord {
+  kVersionRecord = 0,
+  kHashRecord,
+  kHloModuleRecord,
+  kProgramShapeRecord,
+  kDevicesRecord,
+  kExecutableRecord,
+  kNumRecords,
+};
+
+bool ReadEntryRecords(const std::string& path,
+                      std::vector<tensorflow::tstring>* records) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  if (!env->FileExists(path).ok()) {
+    return false;
+  }
+  std::unique_ptr<tensorflow::RandomAccessFile> file;
+  xla::Status status = env->NewRandomAccessFile(path, &file);
+  if (!status.ok()) {
+    TF_VLOG(3) << "Unable to open persistent cache entry " << path << ": "
+               << status;
+    return false;
+  }
+  tensorflow::io::RecordReader reader(file.get());
+  uint64_t offset = 0;
+  records->resize(kNumRecords);
+  for (auto& record : *records) {
+    status = reader.ReadRecord(&offset, &record);
+    if (!status.ok()) {
+      TF_VLOG(3) << "Unable to read persistent cache entry " << path << ": "
+                 << status;
+      return false;
+    }
+  }
+  return true;
+}
+
+std::string GetLeasePath(const std::string& entry_path) {
+  return absl::StrCat(entry_path, ".lease");
+}
+
+}  // namespace
+
+PersistentCache* PersistentCache::Get() {
+  static PersistentCache* cache = []() -> PersistentCache* {
+    std::string path =
+        xla::sys_util::GetEnvString("XLA_PERSISTENT_CACHE_PATH", "");
+    if (path.empty()) {
+      return nullptr;
+    }
+    return new PersistentCache(std::move(path));
+  }();
+  return cache;
+}
+
+PersistentCache::PersistentCache(std::string path)
+    : path_(std::move(path)), version_(GetVersionStamp()) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  XLA_CHECK_OK(env->RecursivelyCreateDir(path_))
+      << "Unable to create persistent cache folder: " << path_;
+  // Lease files need exclusive creation semantics, which only the local file
+  // system provides.
+  use_leases_ =
+      xla::sys_util::GetEnvBool("XLA_PERSISTENT_CACHE_COMPILE_LEASES", true) &&
+      path_.find("://") == std::string::npos;
+  TF_VLOG(1) << "Persistent compilation cache at " << path_
+             << (use_leases_ ? " (with compile leases)" : "");
+}
+
+std::string PersistentCache::GetEntryPath(
+    const torch::lazy::hash_t& hash) const {
+  return GetEntryPath(torch::lazy::HashToString(hash));
+}
+
+std::string PersistentCache::GetEntryPath(
+    const std::string& hash_string) const {
+  return absl::StrCat(path_, "/", hash_string, ".xlacache");
+}
+
+PersistentCache::ComputationPtr PersistentCache::Load(
+    const torch::lazy::hash_t& hash) {
+  ComputationPtr computation = LoadEntry(hash);
+  if (computation != nullptr || !use_leases_) {
+    return computation;
+  }
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (leases_.count(hash) > 0) {
+      // Another thread of this process is compiling the graph.
+      return nullptr;
+    }
+  }
+  while (!AcquireLease(hash)) {
+    computation = WaitForEntry(hash);
+    if (computation != nullptr) {
+      return computation;
+    }
+  }
+  // The lease holder might have stored the entry, and dropped the lease, right
+  // before we took it.
+  computation = LoadEntry(hash);
+  if (computation != nullptr) {
+    ReleaseLease(hash);
+  }
+  return computation;
+}
+
+PersistentCache::ComputationPtr PersistentCache::LoadEntry(
+    const torch::lazy::hash_t& hash) {
+  return LoadIfPresent(torch::lazy::HashToString(hash));
+}
+
+PersistentCache::ComputationPtr PersistentCache::LoadIfPresent(
+    const std::string& hash_string) {
+  XLA_TIMED("PersistentCacheLoad");
+  std::string path = GetEntryPath(hash_string);
+  std::vector<tensorflow::tstring> records;
+  if (!ReadEntryRecords(path, &records)) {
+    XLA_COUNTER("PersistentCacheMiss", 1);
+    return nullptr;
+  }
+  if (records[kVersionRecord] != version_ ||
+      records[kHashRecord] != hash_string) {
+    TF_VLOG(3) << "Stale persistent cache entry " << path;
+    XLA_COUNTER("PersistentCacheStale", 1);
+    return nullptr;
+  }
+  xla::HloModuleProto hlo_module;
+  xla::ProgramShapeProto program_shape;
+  if (!hlo_module.ParseFromArray(records[kHloModuleRecord].data(),
+                                 records[kHloModuleRecord].size()) ||
+      !program_shape.ParseFromArray(records[kProgramShapeRecord].data(),
+                                    records[kProgramShapeRecord].size())) {
+    TF_VLOG(3) << "Corrupted persistent cache entry " << path;
+    XLA_COUNTER("PersistentCacheStale", 1);
+    return nullptr;
+  }
+  std::vector<std::string> devices;
+  if (!records[kDevicesRecord].empty()) {
+    devices = absl::StrSplit(std::string(records[kDevicesRecord]), ',');
+  }
+  ComputationPtr computation =
+      xla::ComputationClient::Get()->DeserializeComputation(
+          std::string(records[kExecutableRecord]),
+          xla::XlaComputation(std::move(hlo_module)),
+          xla::ProgramShape(program_shape), std::move(devices));
+  if (computation == nullptr) {
+    XLA_COUNTER("PersistentCacheStale", 1);
+    return nullptr;
+  }
+  TF_VLOG(3) << "Loaded persistent cache entry " << path;
+  XLA_COUNTER("PersistentCacheHit", 1);
+  return computation;
+}
+
+void PersistentCache::Store(const torch::lazy::hash_t& hash,
+                            ComputationPtr computation) {
+  auto storefn = [this, hash, computation = std::move(computation)]() {
+    StoreEntry(hash, computation);
+    ReleaseLease(hash);
+  };
+  xla::env::ScheduleIoClosure(std::move(storefn));
+}
+
+void PersistentCache::ReleaseLease(const torch::lazy::hash_t& hash) {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (leases_.erase(hash) == 0) {
+      return;
+    }
+  }
+  std::string lease_path = GetLeasePath(GetEntryPath(hash));
+  if (unlink(lease_path.c_str()) != 0) {
+    TF_LOG(WARNING) << "Unable to remove compile lease " << lease_path << ": "
+                    << std::strerror(errno);
+  }
+}
+
+bool PersistentCache::AcquireLease(const torch::lazy::hash_t& hash) {
+  std::string lease_path = GetLeasePath(GetEntryPath(hash));
+  int fd = open(lease_path.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+  if (fd < 0) {
+    if (errno == EEXIST) {
+      return false;
+    }
+    // Without a lease we simply compile, like if leases were not enabled.
+    TF_LOG(WARNING) << "Unable to create compile lease " << lease_path << ": "
+                    << std::strerror(errno);
+    return true;
+  }
+  close(fd);
+  std::lock_guard<std::mutex> lock(lock_);
+  leases_.insert(hash);
+  XLA_COUNTER("PersistentCacheLeases", 1);
+  return true;
+}
+
+PersistentCache::ComputationPtr PersistentCache::WaitForEntry(
+    const torch::lazy::hash_t& hash) {
+  static const int64_t kLeaseTimeout =
+      xla::sys_util::GetEnvInt("XLA_PERSISTENT_CACHE_LEASE_TIMEOUT", 600);
+  XLA_TIMED("PersistentCacheLeaseWait");
+  std::string lease_path = GetLeasePath(GetEntryPath(hash));
+  TF_VLOG(3) << "Waiting for compile lease " << lease_path;
+  while (true) {
+    struct stat lease_stat;
+    if (stat(lease_path.c_str(), &lease_stat) != 0) {
+      // The lease holder is done, and the entry, if it was able to store one,
+      // is in place.
+      return LoadEntry(hash);
+    }
+    if (std::time(nullptr) - lease_stat.st_mtime > kLeaseTimeout) {
+      // The holder likely died before storing the entry.
+      TF_LOG(WARNING) << "Removing stale compile lease " << lease_path;
+      XLA_COUNTER("PersistentCacheStaleLeases", 1);
+      unlink(lease_path.c_str());
+      return nullptr;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  }
+}
+
+void PersistentCache::StoreEntry(const torch::lazy::hash_t& hash,
+                                 const ComputationPtr& computation) {
+  XLA_TIMED("PersistentCacheStore");
+  std::string executable =
+      xla::ComputationClient::Get()->SerializeComputation(*computation);
+  if (executable.empty()) {
+    XLA_COUNTER("PersistentCacheUnserializable", 1);
+    return;
+  }
+  std::string path = GetEntryPath(hash);
+  // Write to a temporary file and rename it at the end, so that concurrent
+  // readers (possibly in other processes) never observe a partial entry.
+  std::string temp_path =
+      absl::StrCat(path, ".tmp-", xla::sys_util::NowNs());
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::unique_ptr<tensorflow::WritableFile> file;
+  xla::Status status = env->NewWritableFile(temp_path, &file);
+  if (status.ok()) {
+    tensorflow::io::RecordWriter writer(file.get());
+    std::string records[kNumRecords];
+    records[kVersionRecord] = version_;
+    records[kHashRecord] = torch::lazy::HashToString(hash);
+    records[kHloModuleRecord] =
+        computation->computation().proto().SerializeAsString();
+    records[kProgramShapeRecord] =
+        computation->program_shape().ToProto().SerializeAsString();
+    records[kDevicesRecord] = absl::StrJoin(computation->devices(), ",");
+    records[kExecutableRecord] = std::move(executable);
+    for (size_t i = 0; i < kNumRecords && status.ok(); ++i) {
+      status = writer.WriteRecord(records[i]);
+    }
+    if (status.ok()) {
+      status = writer.Close();
+    }
+    if (status.ok()) {
+      status = file->Close();
+    }
+  }
+  if (status.ok()) {
+    status = env->RenameFile(temp_path, path);
+  }
+  if (!status.ok()) {
+    TF_LOG(WARNING) << "Unable to write persistent cache entry " << path
+                    << ": " << status;
+    env->DeleteFile(temp_path).IgnoreError();
+    return;
+  }
+  TF_VLOG(3) << "Stored persistent cache entry " << path;
+  XLA_COUNTER("PersistentCacheStored", 1);
+}
+
+}  // namespace torch_xla
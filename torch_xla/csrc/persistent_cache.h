@@ -0,0 +1,80 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch/csrc/lazy/core/hash.h"
+
+namespace torch_xla {
+
+// The PersistentCache stores compiled computations within a folder (local or
+// any other file system supported by the TF file APIs, like GCS), so that a
+// new process running the same graphs can skip the compilation step.
+// Every entry is stamped with a version string which includes the PyTorch and
+// PyTorch/XLA git revisions, together with the XLA flags, and entries with a
+// non matching stamp are ignored.
+// When the folder is local, processes sharing it coordinate the compilations
+// using lease files: the first process missing an entry takes its lease and
+// compiles, while the others wait for the entry to be stored, and load it.
+class PersistentCache {
+ public:
+  using ComputationPtr = std::shared_ptr<xla::ComputationClient::Computation>;
+
+  // Returns the persistent cache singleton, or nullptr if the persistent cache
+  // is not enabled (XLA_PERSISTENT_CACHE_PATH not set).
+  static PersistentCache* Get();
+
+  explicit PersistentCache(std::string path);
+
+  const std::string& path() const { return path_; }
+
+  // Loads the computation stored for the given graph hash, returning nullptr
+  // if none is present, or if the stored one cannot be used. If compile leases
+  // are enabled, and another process holds the lease for the entry, waits for
+  // it to store the entry. A nullptr return means that the caller owns the
+  // lease, and is expected to either Store() the computation, or to call
+  // ReleaseLease().
+  ComputationPtr Load(const torch::lazy::hash_t& hash);
+
+  // Stores the computation for the given graph hash. The serialization and
+  // the write happen asynchronously. The compile lease for the entry, if any,
+  // is released once the write completes.
+  void Store(const torch::lazy::hash_t& hash, ComputationPtr computation);
+
+  // Releases the compile lease held for the given hash, if any.
+  void ReleaseLease(const torch::lazy::hash_t& hash);
+
+  // Loads the computation stored for the graph hash string (as returned by
+  // torch::lazy::HashToString()), returning nullptr if none is present or
+  // usable. Unlike Load(), never takes or waits for compile leases.
+  ComputationPtr LoadIfPresent(const std::string& hash_string);
+
+ private:
+  std::string GetEntryPath(const torch::lazy::hash_t& hash) const;
+
+  std::string GetEntryPath(const std::string& hash_string) const;
+
+  ComputationPtr LoadEntry(const torch::lazy::hash_t& hash);
+
+  // Tries to take the compile lease for the given hash. Returns true if this
+  // process now owns it.
+  bool AcquireLease(const torch::lazy::hash_t& hash);
+
+  // Waits for another process to either store the entry, or to drop its
+  // lease. Returns the stored computation, if any.
+  ComputationPtr WaitForEntry(const torch::lazy::hash_t& hash);
+
+  void StoreEntry(const torch::lazy::hash_t& hash,
+                  const ComputationPtr& computation);
+
+  std::string path_;
+  std::string version_;
+  bool use_leases_ = false;
+  std::mutex lock_;
+  std::unordered_set<torch::lazy::hash_t, torch::lazy::HashReducer> leases_;
+};
+
+}  // namespace torch_xla
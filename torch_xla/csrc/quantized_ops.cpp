@@ -0,0 +1,155 @@
+#include "torch_xla/csrc/quantized_ops.h"
+
+#include <limits>
+
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+void CheckInt8(xla::XlaOp op, const char* name) {
+  XLA_CHECK_EQ(XlaHelpers::TypeOfXlaOp(op), xla::PrimitiveType::S8)
+      << "The " << name << " of the quantized ops must be int8";
+}
+
+// Subtracts the contribution of the input zero point from the int32
+// accumulators, input_zero_point * sum(weight) for every output channel, with
+// the weight sums reduced over all the weight dimensions but the first.
+xla::XlaOp RemoveInputZeroPoint(xla::XlaOp acc, xla::XlaOp weight,
+                                int64_t input_zero_point, int64_t channel_dim) {
+  if (input_zero_point == 0) {
+    return acc;
+  }
+  const xla::Shape& weight_shape = XlaHelpers::ShapeOfXlaOp(weight);
+  std::vector<int64_t> reduce_dims =
+      xla::util::Iota<int64_t>(weight_shape.rank() - 1, 1);
+  xla::XlaOp weight_sums =
+      xla::Reduce(xla::ConvertElementType(weight, xla::PrimitiveType::S32),
+                  xla::Zero(weight.builder(), xla::PrimitiveType::S32),
+                  XlaHelpers::CreateAddComputation(xla::PrimitiveType::S32),
+                  reduce_dims);
+  xla::XlaOp zero_point = XlaHelpers::ScalarValue<int64_t>(
+      input_zero_point, xla::PrimitiveType::S32, weight.builder());
+  return acc - xla::BroadcastInDim(weight_sums * zero_point,
+                                   XlaHelpers::SizesOfXlaOp(acc),
+                                   {channel_dim});
+}
+
+// Scales the int32 accumulators back to the real values, adds the bias, and
+// requantizes them if the output is quantized.
+xla::XlaOp BuildRequantize(xla::XlaOp acc, xla::XlaOp weight_scales,
+                           const absl::optional<xla::XlaOp>& bias,
+                           int64_t channel_dim,
+                           const QuantizationParams& params) {
+  xla::XlaBuilder* builder = acc.builder();
+  std::vector<int64_t> sizes = XlaHelpers::SizesOfXlaOp(acc);
+  xla::XlaOp scales =
+      xla::ConvertElementType(weight_scales, xla::PrimitiveType::F32) *
+      XlaHelpers::ScalarValue<double>(params.input_scale,
+                                      xla::PrimitiveType::F32, builder);
+  xla::XlaOp output =
+      xla::ConvertElementType(acc, xla::PrimitiveType::F32) *
+      xla::BroadcastInDim(scales, sizes, {channel_dim});
+  if (bias) {
+    xla::XlaOp f32_bias =
+        xla::ConvertElementType(*bias, xla::PrimitiveType::F32);
+    output = output + xla::BroadcastInDim(f32_bias, sizes, {channel_dim});
+  }
+  if (!params.output_scale) {
+    return output;
+  }
+  xla::XlaOp inv_output_scale = XlaHelpers::ScalarValue<double>(
+      1.0 / *params.output_scale, xla::PrimitiveType::F32, builder);
+  xla::XlaOp output_zero_point = XlaHelpers::ScalarValue<int64_t>(
+      params.output_zero_point, xla::PrimitiveType::F32, builder);
+  xla::XlaOp quantized =
+      xla::RoundToEven(output * inv_output_scale) + output_zero_point;
+  quantized = xla::Clamp(
+      XlaHelpers::ScalarValue<int64_t>(std::numeric_limits<int8_t>::min(),
+                                       xla::PrimitiveType::F32, builder),
+      quantized,
+      XlaHelpers::ScalarValue<int64_t>(std::numeric_limits<int8_t>::max(),
+                                       xla::PrimitiveType::F32, builder));
+  return xla::ConvertElementType(quantized, xla::PrimitiveType::S8);
+}
+
+}  // namespace
+
+xla::XlaOp BuildQuantizedLinear(xla::XlaOp input, xla::XlaOp weight,
+                                xla::XlaOp weight_scales,
+                                const absl::optional<xla::XlaOp>& bias,
+                                const QuantizationParams& params) {
+  CheckInt8(input, "input");
+  CheckInt8(weight, "weight");
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  const xla::Shape& weight_shape = XlaHelpers::ShapeOfXlaOp(weight);
+  XLA_CHECK_EQ(weight_shape.rank(), 2) << weight_shape;
+  XLA_CHECK_EQ(input_shape.dimensions(input_shape.rank() - 1),
+               weight_shape.dimensions(1))
+      << input_shape << " vs. " << weight_shape;
+  xla::DotDimensionNumbers dims;
+  dims.add_lhs_contracting_dimensions(input_shape.rank() - 1);
+  dims.add_rhs_contracting_dimensions(1);
+  // The int8 products are accumulated in int32 by the dot itself.
+  xla::XlaOp acc = xla::DotGeneral(input, weight, dims,
+                                   /*precision_config=*/nullptr,
+                                   /*preferred_element_type=*/
+                                   xla::PrimitiveType::S32);
+  int64_t channel_dim = input_shape.rank() - 1;
+  acc = RemoveInputZeroPoint(acc, weight, params.input_zero_point, channel_dim);
+  return BuildRequantize(acc, weight_scales, bias, channel_dim, params);
+}
+
+xla::XlaOp BuildQuantizedConvolution(
+    xla::XlaOp input, xla::XlaOp weight, xla::XlaOp weight_scales,
+    const absl::optional<xla::XlaOp>& bias, absl::Span<const int64_t> stride,
+    absl::Span<const int64_t> padding, absl::Span<const int64_t> dilation,
+    int64_t groups, const QuantizationParams& params) {
+  CheckInt8(input, "input");
+  CheckInt8(weight, "weight");
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t num_spatial = input_shape.rank() - 2;
+  XLA_CHECK(num_spatial == 2 || num_spatial == 3) << num_spatial;
+  XLA_CHECK_EQ(padding.size(), num_spatial);
+  std::vector<std::pair<int64_t, int64_t>> conv_padding;
+  xla::XlaOp padded_input = input;
+  if (params.input_zero_point != 0) {
+    // Pad with the zero point, so that the correction of the zero point below
+    // is the same for all the output positions.
+    xla::PaddingConfig padding_config;
+    for (int64_t dim = 0; dim < input_shape.rank(); ++dim) {
+      xla::PaddingConfig::PaddingConfigDimension* dims =
+          padding_config.add_dimensions();
+      int64_t dim_padding = dim < 2 ? 0 : padding[dim - 2];
+      dims->set_edge_padding_low(dim_padding);
+      dims->set_edge_padding_high(dim_padding);
+    }
+    padded_input = xla::Pad(
+        input,
+        XlaHelpers::ScalarValue<int64_t>(params.input_zero_point,
+                                         xla::PrimitiveType::S8,
+                                         input.builder()),
+        padding_config);
+    conv_padding.assign(num_spatial, {0, 0});
+  } else {
+    for (auto dim_padding : padding) {
+      conv_padding.emplace_back(dim_padding, dim_padding);
+    }
+  }
+  xla::XlaOp acc = xla::ConvGeneralDilated(
+      padded_input, weight, stride, conv_padding,
+      /*lhs_dilation=*/{},
+      /*rhs_dilation=*/dilation,
+      xla::XlaBuilder::CreateDefaultConvDimensionNumbers(num_spatial),
+      /*feature_group_count=*/groups,
+      /*batch_group_count=*/1, /*precision_config=*/nullptr,
+      /*preferred_element_type=*/xla::PrimitiveType::S32);
+  acc = RemoveInputZeroPoint(acc, weight, params.input_zero_point,
+                             /*channel_dim=*/1);
+  return BuildRequantize(acc, weight_scales, bias, /*channel_dim=*/1, params);
+}
+
+}  // namespace torch_xla
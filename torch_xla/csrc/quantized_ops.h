@@ -0,0 +1,38 @@
+#pragma once
+
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// The affine quantization of the int8 activations of the quantized ops. The
+// int8 weights are quantized symmetrically per output channel, so they have
+// scales but no zero points.
+struct QuantizationParams {
+  double input_scale = 1.0;
+  int64_t input_zero_point = 0;
+  // If missing, the ops output the dequantized F32 values, otherwise they are
+  // requantized to int8 with these parameters.
+  absl::optional<double> output_scale;
+  int64_t output_zero_point = 0;
+};
+
+// Computes input @ weight^T of the int8 [..., K] input and [N, K] weight with
+// int32 accumulation, then scales the accumulators by the input scale and the
+// per channel weight_scales, adds the optional F32 [N] bias and requantizes.
+xla::XlaOp BuildQuantizedLinear(xla::XlaOp input, xla::XlaOp weight,
+                                xla::XlaOp weight_scales,
+                                const absl::optional<xla::XlaOp>& bias,
+                                const QuantizationParams& params);
+
+// Same as above for the convolution of the int8 [N, Cin, spatial...] input and
+// [Cout, Cin / groups, spatial...] weight. The padding holds the input zero
+// point, i.e. the real value zero, like for the quantized ATen convolutions.
+xla::XlaOp BuildQuantizedConvolution(
+    xla::XlaOp input, xla::XlaOp weight, xla::XlaOp weight_scales,
+    const absl::optional<xla::XlaOp>& bias, absl::Span<const int64_t> stride,
+    absl::Span<const int64_t> padding, absl::Span<const int64_t> dilation,
+    int64_t groups, const QuantizationParams& params);
+
+}  // namespace torch_xla
@@ -14,8 +14,12 @@ namespace torch_xla {
 namespace {
 
 xla::BitGeneratorTy GetBitGenerator() {
-  static const std::string* bit_generator = new std::string(
-      xla::sys_util::GetEnvString("XLA_RNG_BIT_GENERATOR", "default"));
+  // The counter based seeds of the random operations are only some offsets
+  // apart, so they need a counter based bit generator mixing the seeds.
+  static const std::string* bit_generator =
+      new std::string(xla::sys_util::GetEnvString(
+          "XLA_RNG_BIT_GENERATOR",
+          UseCounterBasedRng() ? "philox" : "default"));
   if (*bit_generator == "default") {
     return [](xla::XlaOp key, xla::XlaOp state, const xla::Shape& shape) {
       state = xla::ConcatScalars(key.builder(), {key, state});
@@ -69,6 +73,12 @@ xla::Shape MakeRngShape(const xla::Shape& shape) {
 
 }  // namespace
 
+bool UseCounterBasedRng() {
+  static bool counter_based =
+      xla::sys_util::GetEnvBool("XLA_RNG_COUNTER_BASED", false);
+  return counter_based;
+}
+
 xla::XlaOp RngDiscreteUniform(xla::XlaOp seed, const xla::Shape& shape,
                               xla::XlaOp minval, xla::XlaOp maxval) {
   xla::PrimitiveType minval_type = XlaHelpers::TypeOfXlaOp(minval);
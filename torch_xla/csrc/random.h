@@ -4,6 +4,10 @@
 
 namespace torch_xla {
 
+// Whether the random operations get counter based seeds, derived from the step
+// seed and their offset within the step, rather than chained seeds.
+bool UseCounterBasedRng();
+
 xla::XlaOp RngUniform(xla::XlaOp seed, const xla::Shape& shape,
                       xla::XlaOp minval, xla::XlaOp maxval);
 
@@ -7,7 +7,10 @@
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/autocast_policy.h"
 #include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/tensor_util.h"
@@ -91,16 +94,27 @@ SummationResult CreateSummation(xla::XlaOp input,
                                 absl::Span<const int64_t> dimensions,
                                 bool keep_reduced_dimensions, bool scale) {
   const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
-  xla::XlaOp init_value = xla::Zero(input.builder(), shape.element_type());
+  // The low precision sums accumulate in F32 under the autocast policy.
+  xla::PrimitiveType accumulation_type =
+      AutocastPolicy::GetAccumulationType(shape.element_type());
+  xla::XlaOp init_value = xla::Zero(input.builder(), accumulation_type);
   SummationResult result;
   result.rinfo =
       GetReductionInfo(input, shape, dimensions, keep_reduced_dimensions);
+  xla::XlaOp accumulated_input =
+      accumulation_type != shape.element_type()
+          ? xla::ConvertElementType(input, accumulation_type)
+          : input;
   result.result = xla::Reduce(
-      input, init_value, XlaHelpers::CreateAddComputation(shape.element_type()),
-      dimensions);
+      accumulated_input, init_value,
+      XlaHelpers::CreateAddComputation(accumulation_type), dimensions);
   if (scale) {
     result.result = GetScaleValue(
-        result.result, result.rinfo.element_count.size, shape.element_type());
+        result.result, result.rinfo.element_count.size, accumulation_type);
+  }
+  if (accumulation_type != shape.element_type()) {
+    result.result =
+        xla::ConvertElementType(result.result, shape.element_type());
   }
   if (keep_reduced_dimensions) {
     result.result =
@@ -124,6 +138,79 @@ xla::XlaOp CreateProduct(xla::XlaOp input, absl::Span<const int64_t> dimensions,
   return result;
 }
 
+// The size of the cumulative dimensions past which they are scanned in
+// logarithmic depth, instead of by a window as large as the dimension.
+int64_t CumulativeScanThreshold() {
+  static int64_t threshold =
+      xla::sys_util::GetEnvInt("XLA_CUMULATIVE_SCAN_THRESHOLD", 1024);
+  return threshold;
+}
+
+// Applies the reducer to the elements of lhs and rhs, by reducing them
+// stacked along a new minor dimension, since the reducer is a scalar
+// computation.
+xla::XlaOp CombineElements(xla::XlaOp lhs, xla::XlaOp rhs,
+                           const xla::XlaComputation& reducer,
+                           xla::XlaOp init) {
+  std::vector<int64_t> sizes = XlaHelpers::SizesOfXlaOp(lhs);
+  int64_t rank = sizes.size();
+  sizes.push_back(1);
+  xla::XlaOp stacked = xla::ConcatInDim(
+      lhs.builder(), {xla::Reshape(lhs, sizes), xla::Reshape(rhs, sizes)},
+      rank);
+  return xla::Reduce(stacked, init, reducer, {rank});
+}
+
+// Interleaves the elements of even and odd along dim, which holds the
+// even and odd positions of a dimension of the given size.
+xla::XlaOp InterleaveInDim(xla::XlaOp even, xla::XlaOp odd, int64_t dim,
+                           int64_t size) {
+  std::vector<int64_t> sizes = XlaHelpers::SizesOfXlaOp(even);
+  int64_t rank = sizes.size();
+  int64_t half_size = sizes[dim];
+  if (XlaHelpers::SizesOfXlaOp(odd)[dim] < half_size) {
+    xla::PaddingConfig padding_config;
+    for (int64_t i = 0; i < rank; ++i) {
+      padding_config.add_dimensions()->set_edge_padding_high(i == dim ? 1 : 0);
+    }
+    odd = xla::Pad(odd, xla::Zero(odd.builder(), XlaHelpers::TypeOfXlaOp(odd)),
+                   padding_config);
+  }
+  std::vector<int64_t> pair_sizes = sizes;
+  pair_sizes.insert(pair_sizes.begin() + dim + 1, 1);
+  xla::XlaOp pairs = xla::ConcatInDim(
+      even.builder(),
+      {xla::Reshape(even, pair_sizes), xla::Reshape(odd, pair_sizes)}, dim + 1);
+  std::vector<int64_t> interleaved_sizes = sizes;
+  interleaved_sizes[dim] = 2 * half_size;
+  return xla::SliceInDim(xla::Reshape(pairs, interleaved_sizes), 0, size, 1,
+                         dim);
+}
+
+// The associative scan of the input along dim: the pairs of neighbour
+// elements are combined, the half as long result is scanned recursively,
+// then combined with the even elements. It takes O(n) work and O(log(n))
+// depth, instead of the O(n^2) work of a window as large as the dimension.
+xla::XlaOp BuildAssociativeScan(xla::XlaOp input, int64_t dim,
+                                const xla::XlaComputation& reducer,
+                                xla::XlaOp init) {
+  int64_t size = XlaHelpers::SizesOfXlaOp(input)[dim];
+  if (size < 2) {
+    return input;
+  }
+  xla::XlaOp reduced =
+      CombineElements(xla::SliceInDim(input, 0, size - 1, 2, dim),
+                      xla::SliceInDim(input, 1, size, 2, dim), reducer, init);
+  xla::XlaOp odd = BuildAssociativeScan(reduced, dim, reducer, init);
+  int64_t num_odd = size / 2;
+  xla::XlaOp even_scan = CombineElements(
+      size % 2 == 0 ? xla::SliceInDim(odd, 0, num_odd - 1, 1, dim) : odd,
+      xla::SliceInDim(input, 2, size, 2, dim), reducer, init);
+  xla::XlaOp even = xla::ConcatInDim(
+      input.builder(), {xla::SliceInDim(input, 0, 1, 1, dim), even_scan}, dim);
+  return InterleaveInDim(even, odd, dim, size);
+}
+
 }  // namespace
 
 xla::XlaOp BuildBinaryCrossEntropy(xla::XlaOp input, xla::XlaOp target,
@@ -234,6 +321,12 @@ xla::XlaOp BuildCumulativeComputation(xla::XlaOp input, int64_t dim,
                                       const xla::XlaComputation& reducer,
                                       xla::XlaOp init) {
   const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t threshold = CumulativeScanThreshold();
+  if (threshold > 0 && input_shape.dimensions(dim) > threshold &&
+      !input_shape.is_dynamic_dimension(dim)) {
+    XLA_COUNTER("CumulativeScan", 1);
+    return BuildAssociativeScan(input, dim, reducer, init);
+  }
   std::vector<int64_t> window_strides(input_shape.rank(), 1);
   std::vector<int64_t> window_dims(input_shape.rank(), 1);
   window_dims[dim] = input_shape.dimensions(dim);
@@ -1,5 +1,6 @@
 #include "torch_xla/csrc/resize_ops.h"
 
+#include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/shape_util.h"
@@ -23,8 +24,143 @@ double ResizeFactor(const xla::Shape& input_shape,
          static_cast<double>(output_shape.dimensions(dim));
 }
 
+// Builds the [out_size, in_size] matrix whose rows hold the weights of the
+// input elements interpolated into every output element, following the
+// PyTorch source index computations.
+xla::XlaOp BuildInterpolationMatrix(xla::XlaBuilder* builder,
+                                    xla::PrimitiveType type, int64_t in_size,
+                                    int64_t out_size, bool align_corners,
+                                    bool nearest) {
+  xla::Shape shape = xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32,
+                                               {out_size, in_size});
+  xla::XlaOp out_index = xla::Iota(builder, shape, 0);
+  xla::XlaOp in_index = xla::Iota(builder, shape, 1);
+  auto scalar = [&](double value) {
+    return XlaHelpers::ScalarValue<double>(value, xla::PrimitiveType::F32,
+                                           builder);
+  };
+  xla::XlaOp weights;
+  if (nearest) {
+    xla::XlaOp source = xla::Min(
+        xla::Floor(out_index * scalar(static_cast<double>(in_size) / out_size)),
+        scalar(in_size - 1));
+    weights = xla::ConvertElementType(xla::Eq(source, in_index),
+                                      xla::PrimitiveType::F32);
+  } else {
+    xla::XlaOp source;
+    if (align_corners) {
+      double scale = out_size > 1
+                         ? static_cast<double>(in_size - 1) / (out_size - 1)
+                         : 0.0;
+      source = out_index * scalar(scale);
+    } else {
+      source = (out_index + scalar(0.5)) *
+                   scalar(static_cast<double>(in_size) / out_size) -
+               scalar(0.5);
+    }
+    source = xla::Clamp(scalar(0.0), source, scalar(in_size - 1));
+    weights =
+        xla::Max(scalar(0.0), scalar(1.0) - xla::Abs(source - in_index));
+  }
+  return xla::ConvertElementType(weights, type);
+}
+
+// Interpolates the dimension dim of the input with the weights matrix, which
+// is [out_size, in_size], or [in_size, out_size] if transposed, as for the
+// gradients.
+xla::XlaOp InterpolateDim(xla::XlaOp input, xla::XlaOp weights, int64_t dim,
+                          bool transposed) {
+  int64_t rank = XlaHelpers::ShapeOfXlaOp(input).rank();
+  xla::DotDimensionNumbers dot_dims;
+  dot_dims.add_lhs_contracting_dimensions(dim);
+  dot_dims.add_rhs_contracting_dimensions(transposed ? 0 : 1);
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(xla::PrecisionConfig::HIGHEST);
+  xla::XlaOp result =
+      xla::DotGeneral(input, weights, dot_dims, &precision_config);
+  // The interpolated dimension is the minor one of the dot result.
+  std::vector<int64_t> permutation;
+  for (int64_t i = 0; i < rank - 1; ++i) {
+    if (i == dim) {
+      permutation.push_back(rank - 1);
+    }
+    permutation.push_back(i);
+  }
+  if (dim == rank - 1) {
+    return result;
+  }
+  return xla::Transpose(result, permutation);
+}
+
+// Resizes the spatial dimensions of the NCHW input (or of the gradients, if
+// backward) one at a time, by matmuls with the interpolation matrices.
+xla::XlaOp LowerMatMulResize2d(xla::XlaOp input,
+                               const xla::Shape& output_shape,
+                               bool align_corners, bool nearest,
+                               bool backward) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::XlaOp output = input;
+  for (int64_t dim = 2; dim < 4; ++dim) {
+    int64_t in_size = input_shape.dimensions(dim);
+    int64_t out_size = output_shape.dimensions(dim);
+    if (in_size == out_size) {
+      continue;
+    }
+    // The gradients flow back through the transposed forward weights.
+    xla::XlaOp weights = backward
+                             ? BuildInterpolationMatrix(
+                                   input.builder(), input_shape.element_type(),
+                                   out_size, in_size, align_corners, nearest)
+                             : BuildInterpolationMatrix(
+                                   input.builder(), input_shape.element_type(),
+                                   in_size, out_size, align_corners, nearest);
+    output = InterpolateDim(output, weights, dim, /*transposed=*/backward);
+  }
+  return output;
+}
+
+// Builds the [batch, out_size, in_size] matrices whose rows hold the weights
+// of the input elements interpolated into every output element, for the
+// [batch] normalized crop windows from start to end.
+xla::XlaOp BuildCropInterpolationMatrices(xla::XlaOp start, xla::XlaOp end,
+                                          int64_t batch, int64_t in_size,
+                                          int64_t out_size) {
+  xla::XlaBuilder* builder = start.builder();
+  xla::Shape shape = xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32,
+                                               {batch, out_size, in_size});
+  xla::XlaOp out_index = xla::Iota(builder, shape, 1);
+  xla::XlaOp in_index = xla::Iota(builder, shape, 2);
+  auto scalar = [&](double value) {
+    return XlaHelpers::ScalarValue<double>(value, xla::PrimitiveType::F32,
+                                           builder);
+  };
+  xla::XlaOp scaled_start =
+      xla::BroadcastInDim(start * scalar(in_size - 1), shape.dimensions(), {0});
+  xla::XlaOp scaled_end =
+      xla::BroadcastInDim(end * scalar(in_size - 1), shape.dimensions(), {0});
+  xla::XlaOp source;
+  if (out_size > 1) {
+    source = scaled_start + out_index * (scaled_end - scaled_start) *
+                                scalar(1.0 / (out_size - 1));
+  } else {
+    source = (scaled_start + scaled_end) * scalar(0.5);
+  }
+  source = xla::Clamp(scalar(0.0), source, scalar(in_size - 1));
+  return xla::Max(scalar(0.0), scalar(1.0) - xla::Abs(source - in_index));
+}
+
 }  // namespace
 
+bool UseMatMulResize() {
+  static bool use_matmul =
+      xla::sys_util::GetEnvBool("XLA_RESIZE_MATMUL", true);
+  return use_matmul;
+}
+
+bool IsSupported(XlaDeviceType hw_type) {
+  return hw_type == XlaDeviceType::TPU || UseMatMulResize();
+}
+
 xla::Shape GetForwardOutputShape2d(const xla::Shape& input_shape,
                                    absl::Span<const int64_t> output_size) {
   XLA_CHECK_EQ(output_size.size(), 2);
@@ -52,6 +188,11 @@ xla::XlaOp LowerForward2d(const std::string& target, xla::XlaOp input,
   if (input_shape.dimensions(2) == 1 && input_shape.dimensions(3) == 1) {
     return input + xla::Zeros(input.builder(), output_shape);
   }
+  if (UseMatMulResize()) {
+    bool nearest = absl::StartsWith(target, "ResizeNearest");
+    return LowerMatMulResize2d(input, output_shape, align_corners, nearest,
+                               /*backward=*/false);
+  }
   // XLA wants NHWC while PyTorch comes in as NCHW, so we need to transpose,
   // call the kernel, and transpose back.
   std::vector<int64_t> transpose_permute({0, 3, 2, 1});
@@ -75,6 +216,11 @@ xla::XlaOp LowerBackward2d(const std::string& target, xla::XlaOp input,
       input_shape.dimensions(3) == output_shape.dimensions(3)) {
     return input;
   }
+  if (UseMatMulResize()) {
+    bool nearest = absl::StartsWith(target, "ResizeNearest");
+    return LowerMatMulResize2d(input, output_shape, align_corners, nearest,
+                               /*backward=*/true);
+  }
   // XLA wants NHWC while PyTorch comes in as NCHW, so we need to transpose,
   // call the kernel, and transpose back.
   std::vector<int64_t> transpose_permute({0, 3, 2, 1});
@@ -98,5 +244,54 @@ xla::XlaOp LowerBackward2d(const std::string& target, xla::XlaOp input,
   return xla::Transpose(resised, inv_transpose_permute);
 }
 
+xla::Shape GetCropAndResizeOutputShape2d(
+    const xla::Shape& input_shape, absl::Span<const int64_t> output_size) {
+  XLA_CHECK_EQ(input_shape.rank(), 4) << input_shape;
+  XLA_CHECK_EQ(output_size.size(), 2);
+  return ShapeBuilder(xla::PrimitiveType::F32)
+      .Add(input_shape, 0)
+      .Add(input_shape, 1)
+      .Add(output_size[0])
+      .Add(output_size[1])
+      .Build();
+}
+
+xla::XlaOp LowerCropAndResize2d(xla::XlaOp input, xla::XlaOp boxes,
+                                absl::Span<const int64_t> output_size) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t batch = input_shape.dimensions(0);
+  xla::XlaOp fboxes = xla::ConvertElementType(boxes, xla::PrimitiveType::F32);
+  auto box_coord = [&](int64_t index) {
+    return xla::Reshape(xla::SliceInDim(fboxes, index, index + 1, 1, 1),
+                        {batch});
+  };
+  xla::XlaOp row_weights =
+      BuildCropInterpolationMatrices(box_coord(0), box_coord(2), batch,
+                                     input_shape.dimensions(2), output_size[0]);
+  xla::XlaOp col_weights =
+      BuildCropInterpolationMatrices(box_coord(1), box_coord(3), batch,
+                                     input_shape.dimensions(3), output_size[1]);
+  xla::XlaOp finput = xla::ConvertElementType(input, xla::PrimitiveType::F32);
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(xla::PrecisionConfig::HIGHEST);
+  // [N, OH, H] x [N, C, H, W] -> [N, OH, C, W].
+  xla::DotDimensionNumbers row_dims;
+  row_dims.add_lhs_batch_dimensions(0);
+  row_dims.add_rhs_batch_dimensions(0);
+  row_dims.add_lhs_contracting_dimensions(2);
+  row_dims.add_rhs_contracting_dimensions(2);
+  xla::XlaOp rows =
+      xla::DotGeneral(row_weights, finput, row_dims, &precision_config);
+  // [N, OH, C, W] x [N, OW, W] -> [N, OH, C, OW].
+  xla::DotDimensionNumbers col_dims;
+  col_dims.add_lhs_batch_dimensions(0);
+  col_dims.add_rhs_batch_dimensions(0);
+  col_dims.add_lhs_contracting_dimensions(3);
+  col_dims.add_rhs_contracting_dimensions(2);
+  xla::XlaOp output =
+      xla::DotGeneral(rows, col_weights, col_dims, &precision_config);
+  return xla::Transpose(output, {0, 2, 1, 3});
+}
+
 }  // namespace resize
 }  // namespace torch_xla
@@ -4,10 +4,19 @@
 
 #include "absl/types/span.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "torch_xla/csrc/device.h"
 
 namespace torch_xla {
 namespace resize {
 
+// Whether the resizes get lowered to separable interpolation matmuls, instead
+// of the resize custom calls (see XLA_RESIZE_MATMUL).
+bool UseMatMulResize();
+
+// Whether the resizes can be lowered on the given device type. The resize
+// custom calls are only implemented by TPU, the matmuls run everywhere.
+bool IsSupported(XlaDeviceType hw_type);
+
 xla::Shape GetForwardOutputShape2d(const xla::Shape& input_shape,
                                    absl::Span<const int64_t> output_size);
 
@@ -22,5 +31,16 @@ xla::XlaOp LowerBackward2d(const std::string& target, xla::XlaOp input,
                            const xla::Shape& output_shape, bool align_corners,
                            bool half_pixel_centers);
 
+xla::Shape GetCropAndResizeOutputShape2d(const xla::Shape& input_shape,
+                                         absl::Span<const int64_t> output_size);
+
+// Crops a box out of every image of the NCHW input, and bilinearly resizes it
+// to output_size, as an F32 result. The [N, 4] boxes are (y0, x0, y1, x1),
+// normalized to [0, 1], with the box corners mapping on the corner pixels, so
+// that swapped coordinates (like x0 > x1) flip the crop. Lowers to batched
+// interpolation matmuls, so the boxes can be computed on the device.
+xla::XlaOp LowerCropAndResize2d(xla::XlaOp input, xla::XlaOp boxes,
+                                absl::Span<const int64_t> output_size);
+
 }  // namespace resize
 }  // namespace torch_xla
@@ -0,0 +1,403 @@
+#include "torch_xla/csrc/small_matrix.h"
+
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/compiler/xla/client/lib/comparators.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/lib/matrix.h"
+#include "tensorflow/compiler/xla/client/lib/slicing.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+// The convergence of the Jacobi sweeps is quadratic, so that this many of them
+// bring the off diagonal norms of the matrices within a few tens of columns
+// well below the F64 precision.
+constexpr int kSvdSweeps = 10;
+
+bool FitsSmallMatrix(const xla::Shape& shape, int64_t max_size) {
+  if (shape.rank() < 2 || shape.is_dynamic() ||
+      (shape.element_type() != xla::PrimitiveType::F32 &&
+       shape.element_type() != xla::PrimitiveType::F64)) {
+    return false;
+  }
+  return shape.dimensions(shape.rank() - 2) <= max_size &&
+         shape.dimensions(shape.rank() - 1) <= max_size;
+}
+
+std::vector<int64_t> BatchDimensions(const xla::Shape& shape) {
+  return std::vector<int64_t>(shape.dimensions().begin(),
+                              shape.dimensions().end() - 2);
+}
+
+// The dimensions mapping the ..., K values to the last dimension of a ...
+// , M, K matrix.
+std::vector<int64_t> RowBroadcastDimensions(int64_t rank) {
+  std::vector<int64_t> dimensions(rank - 2);
+  std::iota(dimensions.begin(), dimensions.end(), 0);
+  dimensions.push_back(rank - 1);
+  return dimensions;
+}
+
+// The S32 iota of the shape dimensions, along its rows (minor_dim 0) or
+// columns (minor_dim 1).
+xla::XlaOp MinorIota(xla::XlaBuilder* builder, const xla::Shape& shape,
+                     int64_t minor_dim) {
+  return xla::Iota(
+      builder,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions()),
+      shape.rank() - 2 + minor_dim);
+}
+
+xla::XlaOp IndexValue(xla::XlaBuilder* builder, int64_t index) {
+  return xla::ConstantR0<int32_t>(builder, static_cast<int32_t>(index));
+}
+
+// The batched product of the two minor dimensions of lhs and rhs. The
+// decompositions accumulate the errors of every step, so the products always
+// run at the highest precision.
+xla::XlaOp BatchMatMul(xla::XlaOp lhs, bool transpose_lhs, xla::XlaOp rhs,
+                       bool transpose_rhs) {
+  int64_t rank = XlaHelpers::ShapeOfXlaOp(lhs).rank();
+  xla::DotDimensionNumbers dims;
+  for (int64_t i = 0; i < rank - 2; ++i) {
+    dims.add_lhs_batch_dimensions(i);
+    dims.add_rhs_batch_dimensions(i);
+  }
+  dims.add_lhs_contracting_dimensions(transpose_lhs ? rank - 2 : rank - 1);
+  dims.add_rhs_contracting_dimensions(transpose_rhs ? rank - 1 : rank - 2);
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(xla::PrecisionConfig::HIGHEST);
+  return xla::DotGeneral(lhs, rhs, dims, &precision_config);
+}
+
+// The product of the ..., M, N input with the N, K constant matrix.
+xla::XlaOp MatMulConstant(xla::XlaOp input, xla::XlaOp matrix) {
+  int64_t rank = XlaHelpers::ShapeOfXlaOp(input).rank();
+  xla::DotDimensionNumbers dims;
+  dims.add_lhs_contracting_dimensions(rank - 1);
+  dims.add_rhs_contracting_dimensions(0);
+  xla::PrecisionConfig precision_config =
+      XlaHelpers::BuildPrecisionConfig(xla::PrecisionConfig::HIGHEST);
+  return xla::DotGeneral(input, matrix, dims, &precision_config);
+}
+
+// The round robin pairings of the (even) num_columns columns, where each round
+// pairs every column once, and the num_columns - 1 rounds pair every two
+// columns once.
+std::vector<std::vector<std::pair<int64_t, int64_t>>> RoundRobinPairs(
+    int64_t num_columns) {
+  std::vector<int64_t> columns(num_columns);
+  std::iota(columns.begin(), columns.end(), 0);
+  std::vector<std::vector<std::pair<int64_t, int64_t>>> rounds;
+  for (int64_t round = 0; round + 1 < num_columns; ++round) {
+    std::vector<std::pair<int64_t, int64_t>> pairs;
+    for (int64_t i = 0; i < num_columns / 2; ++i) {
+      pairs.emplace_back(columns[i], columns[num_columns - 1 - i]);
+    }
+    rounds.push_back(std::move(pairs));
+    // The first column stays, the others rotate by one.
+    std::rotate(columns.begin() + 1, columns.end() - 1, columns.end());
+  }
+  return rounds;
+}
+
+// The num_columns, K matrix selecting the given K columns of the matrices it
+// multiplies.
+xla::XlaOp SelectionMatrix(xla::XlaBuilder* builder, xla::PrimitiveType type,
+                           int64_t num_columns,
+                           const std::vector<int64_t>& columns) {
+  int64_t size = columns.size();
+  std::vector<float> values(num_columns * size, 0.0f);
+  for (int64_t i = 0; i < size; ++i) {
+    values[columns[i] * size + i] = 1.0f;
+  }
+  return xla::ConvertElementType(
+      xla::Reshape(xla::ConstantR1<float>(builder, values),
+                   {num_columns, size}),
+      type);
+}
+
+struct RoundSelection {
+  xla::XlaOp p;
+  xla::XlaOp q;
+  xla::XlaOp p_transposed;
+  xla::XlaOp q_transposed;
+};
+
+struct JacobiRotation {
+  xla::XlaOp c;
+  xla::XlaOp s;
+};
+
+// The rotations orthogonalizing the selected pairs of columns of w.
+JacobiRotation ComputeJacobiRotation(xla::XlaOp w,
+                                     const RoundSelection& selection) {
+  xla::XlaBuilder* builder = w.builder();
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(w);
+  xla::PrimitiveType type = shape.element_type();
+  xla::XlaComputation add = XlaHelpers::CreateAddComputation(type);
+  xla::XlaOp zero = xla::Zero(builder, type);
+  xla::XlaOp one = xla::One(builder, type);
+  xla::XlaOp wp = MatMulConstant(w, selection.p);
+  xla::XlaOp wq = MatMulConstant(w, selection.q);
+  std::vector<int64_t> rows_dim = {shape.rank() - 2};
+  xla::XlaOp alpha = xla::Reduce(wp * wp, zero, add, rows_dim);
+  xla::XlaOp beta = xla::Reduce(wq * wq, zero, add, rows_dim);
+  xla::XlaOp gamma = xla::Reduce(wp * wq, zero, add, rows_dim);
+  // The pairs already orthogonal within the precision are left alone, which
+  // includes the ones with a zero column.
+  xla::XlaOp rotate = xla::Gt(
+      xla::Abs(gamma), xla::Epsilon(builder, type) * xla::Sqrt(alpha * beta));
+  xla::XlaOp ones = xla::FullLike(gamma, 1);
+  xla::XlaOp zeta =
+      (beta - alpha) /
+      (XlaHelpers::ScalarValue<double>(2, type, builder) *
+       xla::Select(rotate, gamma, ones));
+  // The smaller root of t^2 + 2 zeta t - 1, which keeps the rotation angle
+  // within pi / 4.
+  xla::XlaOp t = xla::Select(xla::Ge(zeta, zero), ones, -ones) /
+                 (xla::Abs(zeta) + xla::Sqrt(one + zeta * zeta));
+  xla::XlaOp c = xla::Rsqrt(one + t * t);
+  return {xla::Select(rotate, c, ones),
+          xla::Select(rotate, c * t, xla::ZerosLike(gamma))};
+}
+
+// Rotates the selected pairs of columns of x by the given rotations.
+xla::XlaOp RotateColumns(xla::XlaOp x, const JacobiRotation& rotation,
+                         const RoundSelection& selection) {
+  xla::XlaOp xp = MatMulConstant(x, selection.p);
+  xla::XlaOp xq = MatMulConstant(x, selection.q);
+  const xla::Shape& pair_shape = XlaHelpers::ShapeOfXlaOp(xp);
+  std::vector<int64_t> dimensions = RowBroadcastDimensions(pair_shape.rank());
+  xla::XlaOp c =
+      xla::BroadcastInDim(rotation.c, pair_shape.dimensions(), dimensions);
+  xla::XlaOp s =
+      xla::BroadcastInDim(rotation.s, pair_shape.dimensions(), dimensions);
+  return MatMulConstant(c * xp - s * xq, selection.p_transposed) +
+         MatMulConstant(s * xp + c * xq, selection.q_transposed);
+}
+
+}  // namespace
+
+bool IsSmallMatrix(const xla::Shape& shape) {
+  static const int64_t max_size =
+      xla::sys_util::GetEnvInt("XLA_SMALL_MATRIX_SIZE", 32);
+  return FitsSmallMatrix(shape, max_size);
+}
+
+bool IsSmallSvdMatrix(const xla::Shape& shape) {
+  static const int64_t max_size =
+      xla::sys_util::GetEnvInt("XLA_SMALL_MATRIX_SVD_SIZE", 16);
+  return FitsSmallMatrix(shape, max_size);
+}
+
+xla::XlaOp BuildSmallCholesky(xla::XlaOp input, bool lower) {
+  XLA_COUNTER("SmallMatrixLowering", 1);
+  xla::XlaBuilder* builder = input.builder();
+  // The upper factor is the transposed lower one of the transposed input,
+  // whose lower triangle holds the upper one of the input.
+  xla::XlaOp a = lower ? input : xla::TransposeInMinorDims(input);
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(a);
+  int64_t n = shape.dimensions(shape.rank() - 1);
+  xla::Shape column_shape(shape);
+  column_shape.set_dimensions(shape.rank() - 1, 1);
+  xla::XlaOp rows = MinorIota(builder, column_shape, 0);
+  xla::XlaOp zero_column = xla::Zeros(builder, column_shape);
+  xla::XlaOp l = xla::Zeros(builder, shape);
+  for (int64_t j = 0; j < n; ++j) {
+    // The columns j and beyond of l are still zero, so the product only
+    // subtracts the contributions of the columns already computed.
+    xla::XlaOp v =
+        xla::SliceInMinorDims(a, {0, j}, {n, j + 1}) -
+        BatchMatMul(l, false, xla::SliceInMinorDims(l, {j, 0}, {j + 1, n}),
+                    true);
+    xla::XlaOp diagonal =
+        xla::Sqrt(xla::SliceInMinorDims(v, {j, 0}, {j + 1, 1}));
+    xla::XlaOp column = xla::Select(xla::Ge(rows, IndexValue(builder, j)),
+                                    v / diagonal, zero_column);
+    l = xla::UpdateSliceInMinorDims(l, column, {0, j});
+  }
+  return lower ? l : xla::TransposeInMinorDims(l);
+}
+
+xla::XlaOp BuildSmallTriangularSolve(xla::XlaOp a, xla::XlaOp b,
+                                     bool left_side, bool lower,
+                                     bool transpose_a, bool unit_diagonal) {
+  XLA_COUNTER("SmallMatrixLowering", 1);
+  xla::XlaBuilder* builder = a.builder();
+  // Every variant reduces to the m y = c solve, with m = op(a) for the left
+  // side ones, while x op(a) = b is op(a)^T x^T = b^T.
+  xla::XlaOp m = transpose_a ? xla::TransposeInMinorDims(a) : a;
+  bool lower_m = transpose_a ? !lower : lower;
+  xla::XlaOp c = b;
+  if (!left_side) {
+    m = xla::TransposeInMinorDims(m);
+    lower_m = !lower_m;
+    c = xla::TransposeInMinorDims(b);
+  }
+  const xla::Shape& m_shape = XlaHelpers::ShapeOfXlaOp(m);
+  const xla::Shape& c_shape = XlaHelpers::ShapeOfXlaOp(c);
+  int64_t n = m_shape.dimensions(m_shape.rank() - 1);
+  int64_t k = c_shape.dimensions(c_shape.rank() - 1);
+  // Only the strict triangle of m takes part in the products, the other one
+  // may hold anything.
+  xla::XlaOp rows = MinorIota(builder, m_shape, 0);
+  xla::XlaOp cols = MinorIota(builder, m_shape, 1);
+  xla::XlaOp strict =
+      xla::Select(lower_m ? xla::Gt(rows, cols) : xla::Lt(rows, cols), m,
+                  xla::ZerosLike(m));
+  xla::XlaOp y = xla::ZerosLike(c);
+  for (int64_t step = 0; step < n; ++step) {
+    int64_t i = lower_m ? step : n - 1 - step;
+    // The rows of y not solved yet are zero.
+    xla::XlaOp row =
+        xla::SliceInMinorDims(c, {i, 0}, {i + 1, k}) -
+        BatchMatMul(xla::SliceInMinorDims(strict, {i, 0}, {i + 1, n}), false,
+                    y, false);
+    if (!unit_diagonal) {
+      row = row / xla::SliceInMinorDims(m, {i, i}, {i + 1, i + 1});
+    }
+    y = xla::UpdateSliceInMinorDims(y, row, {i, 0});
+  }
+  return left_side ? y : xla::TransposeInMinorDims(y);
+}
+
+void BuildSmallQr(xla::XlaOp input, bool full_matrices, xla::XlaOp* q,
+                  xla::XlaOp* r) {
+  XLA_COUNTER("SmallMatrixLowering", 1);
+  xla::XlaBuilder* builder = input.builder();
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = shape.element_type();
+  int64_t m = shape.dimensions(shape.rank() - 2);
+  int64_t n = shape.dimensions(shape.rank() - 1);
+  int64_t k = std::min(m, n);
+  xla::Shape column_shape(shape);
+  column_shape.set_dimensions(shape.rank() - 1, 1);
+  xla::XlaOp rows = MinorIota(builder, column_shape, 0);
+  xla::XlaOp zero_column = xla::Zeros(builder, column_shape);
+  xla::XlaOp zero = xla::Zero(builder, type);
+  xla::XlaOp two = XlaHelpers::ScalarValue<double>(2, type, builder);
+  xla::XlaOp rr = input;
+  xla::XlaOp qq = xla::Broadcast(xla::IdentityMatrix(builder, type, m, m),
+                                 BatchDimensions(shape));
+  for (int64_t j = 0; j < std::min(m - 1, n); ++j) {
+    xla::XlaOp x =
+        xla::Select(xla::Ge(rows, IndexValue(builder, j)),
+                    xla::SliceInMinorDims(rr, {0, j}, {m, j + 1}), zero_column);
+    xla::XlaOp x_j = xla::SliceInMinorDims(x, {j, 0}, {j + 1, 1});
+    xla::XlaOp norm = xla::Sqrt(BatchMatMul(x, true, x, false));
+    // The reflection maps x to alpha e_j, where alpha has the opposite sign of
+    // x_j, so that v does not suffer from cancellation.
+    xla::XlaOp alpha = xla::Select(xla::Ge(x_j, zero), -norm, norm);
+    xla::XlaOp v =
+        xla::Select(xla::Eq(rows, IndexValue(builder, j)), x - alpha, x);
+    xla::XlaOp v_norm2 = BatchMatMul(v, true, v, false);
+    // The columns already zero below the diagonal get no reflection.
+    xla::XlaOp reflect = xla::Gt(v_norm2, zero);
+    xla::XlaOp tau = xla::Select(
+        reflect, two / xla::Select(reflect, v_norm2, xla::FullLike(v_norm2, 1)),
+        xla::ZerosLike(v_norm2));
+    xla::XlaOp tau_v = v * tau;
+    rr = rr - BatchMatMul(tau_v, false, BatchMatMul(v, true, rr, false), false);
+    qq = qq - BatchMatMul(BatchMatMul(qq, false, v, false), false, tau_v, true);
+  }
+  rr = xla::UpperTriangle(rr);
+  *q = full_matrices ? qq : xla::SliceInMinorDims(qq, {0, 0}, {m, k});
+  *r = full_matrices ? rr : xla::SliceInMinorDims(rr, {0, 0}, {k, n});
+}
+
+SmallSvdResult BuildSmallSvd(xla::XlaOp input) {
+  XLA_COUNTER("SmallMatrixLowering", 1);
+  xla::XlaBuilder* builder = input.builder();
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::PrimitiveType type = input_shape.element_type();
+  int64_t rank = input_shape.rank();
+  // The one-sided Jacobi orthogonalizes the columns, so the wide matrices go
+  // through the SVD of their transpose, a^T = u s v^T being a = v s u^T.
+  bool transposed = input_shape.dimensions(rank - 2) <
+                    input_shape.dimensions(rank - 1);
+  xla::XlaOp w = transposed ? xla::TransposeInMinorDims(input) : input;
+  xla::Shape shape = XlaHelpers::ShapeOfXlaOp(w);
+  int64_t num_rows = shape.dimensions(rank - 2);
+  int64_t k = shape.dimensions(rank - 1);
+  // The round robin needs an even number of columns, so an odd one gets a
+  // zero column, which never rotates and stays the last one.
+  int64_t num_columns = k + k % 2;
+  if (num_columns > k) {
+    xla::Shape pad_shape(shape);
+    pad_shape.set_dimensions(rank - 1, 1);
+    w = xla::ConcatInDim(builder, {w, xla::Zeros(builder, pad_shape)},
+                         rank - 1);
+  }
+  xla::XlaOp v = xla::Broadcast(
+      xla::IdentityMatrix(builder, type, num_columns, num_columns),
+      BatchDimensions(shape));
+  std::vector<RoundSelection> selections;
+  for (auto& pairs : RoundRobinPairs(num_columns)) {
+    std::vector<int64_t> p_columns;
+    std::vector<int64_t> q_columns;
+    for (auto& pair : pairs) {
+      p_columns.push_back(pair.first);
+      q_columns.push_back(pair.second);
+    }
+    RoundSelection selection;
+    selection.p = SelectionMatrix(builder, type, num_columns, p_columns);
+    selection.q = SelectionMatrix(builder, type, num_columns, q_columns);
+    selection.p_transposed = xla::Transpose(selection.p, {1, 0});
+    selection.q_transposed = xla::Transpose(selection.q, {1, 0});
+    selections.push_back(std::move(selection));
+  }
+  for (int sweep = 0; sweep < kSvdSweeps; ++sweep) {
+    for (auto& selection : selections) {
+      JacobiRotation rotation = ComputeJacobiRotation(w, selection);
+      w = RotateColumns(w, rotation, selection);
+      v = RotateColumns(v, rotation, selection);
+    }
+  }
+  w = xla::SliceInMinorDims(w, {0, 0}, {num_rows, k});
+  v = xla::SliceInMinorDims(v, {0, 0}, {k, k});
+
+  // The columns of w are now the left singular vectors scaled by the singular
+  // values.
+  xla::XlaOp zero = xla::Zero(builder, type);
+  xla::XlaOp d = xla::Sqrt(xla::Reduce(
+      w * w, zero, XlaHelpers::CreateAddComputation(type), {rank - 2}));
+  xla::Shape index_shape = xla::ShapeUtil::MakeShape(
+      xla::PrimitiveType::S32, XlaHelpers::ShapeOfXlaOp(d).dimensions());
+  xla::XlaOp sorted = xla::Sort(
+      {d, xla::Iota(builder, index_shape, rank - 2)},
+      xla::CreateScalarGtComputation({type, xla::PrimitiveType::S32}, builder),
+      rank - 2);
+  d = xla::GetTupleElement(sorted, 0);
+  // The permutation matrix p[i, j] = (i == perm[j]) moves the columns into the
+  // order of the sorted singular values.
+  xla::Shape perm_shape(index_shape);
+  perm_shape.add_dimensions(k);
+  xla::XlaOp perm = xla::BroadcastInDim(xla::GetTupleElement(sorted, 1),
+                                        perm_shape.dimensions(),
+                                        RowBroadcastDimensions(rank));
+  xla::XlaOp p = xla::ConvertElementType(
+      xla::Eq(MinorIota(builder, perm_shape, 0), perm), type);
+  w = BatchMatMul(w, false, p, false);
+  v = BatchMatMul(v, false, p, false);
+  const xla::Shape& w_shape = XlaHelpers::ShapeOfXlaOp(w);
+  xla::XlaOp d_columns = xla::BroadcastInDim(d, w_shape.dimensions(),
+                                             RowBroadcastDimensions(rank));
+  // The columns of the zero singular values stay zero.
+  xla::XlaOp u = w / xla::Select(xla::Gt(d_columns, zero), d_columns,
+                                 xla::FullLike(d_columns, 1));
+  if (transposed) {
+    return {v, d, u};
+  }
+  return {u, d, v};
+}
+
+}  // namespace torch_xla
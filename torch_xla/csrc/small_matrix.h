@@ -0,0 +1,47 @@
+#pragma once
+
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace torch_xla {
+
+// The lowerings of the linear algebra operations for large batches of small
+// matrices. The generic XLA decompositions run while loops over blocks of
+// rows and columns, which for matrices of a few tens of rows cost much more
+// than the math. These ones are unrolled over the rows (or columns) of the
+// matrices, and express every step as batched matrix products, so that all
+// the matrices of the batch go through the matrix units at once.
+
+struct SmallSvdResult {
+  // The ..., M, K left singular vectors, where K is min(M, N).
+  xla::XlaOp u;
+  // The ..., K singular values, in descending order.
+  xla::XlaOp d;
+  // The ..., N, K right singular vectors.
+  xla::XlaOp v;
+};
+
+// Whether the ..., M, N matrices of the shape are small enough for the
+// unrolled lowerings to beat the generic ones, that is whether M and N are
+// within XLA_SMALL_MATRIX_SIZE (XLA_SMALL_MATRIX_SVD_SIZE for the SVD, whose
+// unrolled sweeps grow quadratically with the size).
+bool IsSmallMatrix(const xla::Shape& shape);
+
+bool IsSmallSvdMatrix(const xla::Shape& shape);
+
+// Same as xla::Triangle(xla::Cholesky(input, lower), lower).
+xla::XlaOp BuildSmallCholesky(xla::XlaOp input, bool lower);
+
+// Same as xla::TriangularSolve(), with a and b sharing the batch dimensions.
+xla::XlaOp BuildSmallTriangularSolve(xla::XlaOp a, xla::XlaOp b,
+                                     bool left_side, bool lower,
+                                     bool transpose_a, bool unit_diagonal);
+
+// Same as xla::QrExplicit(), through unrolled Householder reflections.
+void BuildSmallQr(xla::XlaOp input, bool full_matrices, xla::XlaOp* q,
+                  xla::XlaOp* r);
+
+// The reduced SVD of the input, through a fixed number of unrolled one-sided
+// Jacobi sweeps, which rotate disjoint pairs of columns at once.
+SmallSvdResult BuildSmallSvd(xla::XlaOp input);
+
+}  // namespace torch_xla
@@ -0,0 +1,148 @@
+#include "torch_xla/csrc/source_location_table.h"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch/csrc/lazy/core/hash.h"
+
+namespace torch_xla {
+namespace {
+
+using Frame = SourceLocationTable::Frame;
+
+struct FrameHasher {
+  size_t operator()(const Frame& frame) const {
+    return torch::lazy::HashReduce(torch::lazy::HashCombine(
+        reinterpret_cast<uintptr_t>(frame.code), frame.line));
+  }
+};
+
+struct FramesHasher {
+  size_t operator()(const std::vector<Frame>& frames) const {
+    torch::lazy::hash_t hash = frames.size();
+    for (auto& frame : frames) {
+      hash = torch::lazy::HashCombine(hash, FrameHasher()(frame));
+    }
+    return torch::lazy::HashReduce(hash);
+  }
+};
+
+struct Table {
+  std::mutex lock;
+  SourceLocationTable::CaptureFn capture_fn;
+  SourceLocationTable::DescribeFn describe_fn;
+  std::unordered_map<Frame, torch::lazy::SourceLocation, FrameHasher>
+      locations;
+  std::unordered_map<std::vector<Frame>, uint32_t, FramesHasher> ids;
+  // The record of id N is at index N - 1. A deque does not move its elements
+  // when growing, so the references handed out by Get() stay valid.
+  std::deque<std::vector<torch::lazy::SourceLocation>> records;
+};
+
+Table* GetTable() {
+  static Table* table = new Table();
+  return table;
+}
+
+size_t GetMaxFrames() {
+  static const size_t max_frames =
+      xla::sys_util::GetEnvInt("XLA_IR_SOURCE_LOCATIONS_DEPTH", 8);
+  return max_frames;
+}
+
+}  // namespace
+
+bool SourceLocationTable::IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_IR_SOURCE_LOCATIONS", false);
+  return enabled;
+}
+
+void SourceLocationTable::SetCallbacks(CaptureFn capture_fn,
+                                       DescribeFn describe_fn) {
+  Table* table = GetTable();
+  std::lock_guard<std::mutex> lock(table->lock);
+  table->capture_fn = std::move(capture_fn);
+  table->describe_fn = std::move(describe_fn);
+}
+
+uint32_t SourceLocationTable::Capture() {
+  if (!IsEnabled()) {
+    return 0;
+  }
+  CaptureFn capture_fn;
+  {
+    Table* table = GetTable();
+    std::lock_guard<std::mutex> lock(table->lock);
+    capture_fn = table->capture_fn;
+  }
+  if (capture_fn == nullptr) {
+    return 0;
+  }
+  return Intern(capture_fn(GetMaxFrames()));
+}
+
+uint32_t SourceLocationTable::Intern(absl::Span<const Frame> frames) {
+  if (frames.empty()) {
+    return 0;
+  }
+  Table* table = GetTable();
+  std::vector<Frame> key(frames.begin(), frames.end());
+  std::vector<Frame> new_frames;
+  DescribeFn describe_fn;
+  {
+    std::lock_guard<std::mutex> lock(table->lock);
+    auto it = table->ids.find(key);
+    if (it != table->ids.end()) {
+      return it->second;
+    }
+    for (auto& frame : key) {
+      if (table->locations.count(frame) == 0) {
+        new_frames.push_back(frame);
+      }
+    }
+    describe_fn = table->describe_fn;
+  }
+  // The description of the frames might need to acquire the Python GIL, so it
+  // cannot happen while holding the table lock.
+  std::vector<torch::lazy::SourceLocation> new_locations;
+  for (auto& frame : new_frames) {
+    new_locations.push_back(describe_fn != nullptr
+                                ? describe_fn(frame)
+                                : torch::lazy::SourceLocation());
+  }
+
+  std::lock_guard<std::mutex> lock(table->lock);
+  for (size_t i = 0; i < new_frames.size(); ++i) {
+    table->locations.emplace(new_frames[i], std::move(new_locations[i]));
+  }
+  auto it = table->ids.emplace(std::move(key), table->records.size() + 1);
+  if (it.second) {
+    std::vector<torch::lazy::SourceLocation> record;
+    for (auto& frame : frames) {
+      record.push_back(table->locations.at(frame));
+    }
+    table->records.push_back(std::move(record));
+    XLA_COUNTER("SourceLocationRecords", 1);
+  }
+  return it.first->second;
+}
+
+const std::vector<torch::lazy::SourceLocation>& SourceLocationTable::Get(
+    uint32_t id) {
+  static const std::vector<torch::lazy::SourceLocation>* empty =
+      new std::vector<torch::lazy::SourceLocation>();
+  if (id == 0) {
+    return *empty;
+  }
+  Table* table = GetTable();
+  std::lock_guard<std::mutex> lock(table->lock);
+  XLA_CHECK_LE(id, table->records.size());
+  return table->records[id - 1];
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "torch/csrc/lazy/core/ir_metadata.h"
+
+namespace torch_xla {
+
+// Compact storage of the Python source locations of the IR nodes. Instead of
+// every node carrying its own copy of the stack frames strings (like the
+// XLA_IR_DEBUG metadata does), the frames are identified by their code object
+// and line number, and every distinct stack is interned into a record once,
+// nodes only storing the record id. The strings describing a frame are built
+// the first time such frame is seen, so that the per node cost of tracking the
+// source locations is a short stack walk and a table lookup.
+class SourceLocationTable {
+ public:
+  // A Python frame, identified by its code object and line number.
+  struct Frame {
+    bool operator==(const Frame& other) const {
+      return code == other.code && line == other.line;
+    }
+
+    const void* code = nullptr;
+    int line = 0;
+  };
+
+  // Returns the innermost frames of the Python stack of the calling thread,
+  // up to the given count.
+  using CaptureFn = std::function<std::vector<Frame>(size_t max_frames)>;
+  // Describes a frame. Runs once per frame, which must stay a valid identity
+  // (hence its code object alive) from then on.
+  using DescribeFn = std::function<torch::lazy::SourceLocation(const Frame&)>;
+
+  // Whether the source locations of the IR nodes get captured
+  // (XLA_IR_SOURCE_LOCATIONS).
+  static bool IsEnabled();
+
+  // Installs the functions walking the Python stack. Until this is called,
+  // no source location gets captured.
+  static void SetCallbacks(CaptureFn capture_fn, DescribeFn describe_fn);
+
+  // Captures the Python stack of the calling thread, and returns the id of its
+  // record, or zero if disabled or if there is no Python stack.
+  static uint32_t Capture();
+
+  // Returns the id of the record for the given frames, innermost first.
+  static uint32_t Intern(absl::Span<const Frame> frames);
+
+  // Returns the source locations of a record, innermost first. The returned
+  // reference stays valid for the lifetime of the process.
+  static const std::vector<torch::lazy::SourceLocation>& Get(uint32_t id);
+};
+
+}  // namespace torch_xla
@@ -0,0 +1,133 @@
+#include "torch_xla/csrc/speculative_sync.h"
+
+#include <exception>
+
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+
+namespace torch_xla {
+namespace {
+
+// The trace state of a tracing thread.
+struct TraceState {
+  void Reset() {
+    hash = torch::lazy::kNullOpt;
+    num_values = 0;
+    predicted = false;
+  }
+
+  torch::lazy::hash_t hash = torch::lazy::kNullOpt;
+  size_t num_values = 0;
+  // The prefix hash, once num_values reached the prefix size.
+  torch::lazy::hash_t prefix_hash;
+  bool predicted = false;
+  torch::lazy::hash_t predicted_hash;
+};
+
+thread_local TraceState g_trace_state;
+
+}  // namespace
+
+SpeculativeSync* SpeculativeSync::Get() {
+  static SpeculativeSync* speculative_sync = []() -> SpeculativeSync* {
+    if (!xla::sys_util::GetEnvBool("XLA_SPECULATIVE_SYNC", false)) {
+      return nullptr;
+    }
+    return new SpeculativeSync(
+        xla::sys_util::GetEnvInt("XLA_SPECULATIVE_SYNC_PREFIX", 256),
+        xla::sys_util::GetEnvInt("XLA_SPECULATIVE_SYNC_MIN_MATCHES", 2),
+        xla::sys_util::GetEnvInt("XLA_SPECULATIVE_SYNC_PREFIXES", 256));
+  }();
+  return speculative_sync;
+}
+
+SpeculativeSync::SpeculativeSync(size_t prefix_values, size_t min_matches,
+                                 size_t max_prefixes)
+    : prefix_values_(prefix_values),
+      min_matches_(min_matches),
+      prefixes_(max_prefixes) {}
+
+void SpeculativeSync::RecordValue(const torch::lazy::hash_t& hash,
+                                  PreloadFn preload_fn) {
+  TraceState& state = g_trace_state;
+  if (state.num_values >= prefix_values_) {
+    return;
+  }
+  state.hash = torch::lazy::HashCombine(state.hash, hash);
+  if (++state.num_values < prefix_values_) {
+    return;
+  }
+  state.prefix_hash = state.hash;
+  std::shared_ptr<PrefixInfo> prefix = prefixes_.Get(state.prefix_hash);
+  if (prefix == nullptr) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (prefix->matches < min_matches_) {
+      return;
+    }
+    state.predicted_hash = prefix->graph_hash;
+  }
+  state.predicted = true;
+  Preload(state.predicted_hash, preload_fn);
+}
+
+void SpeculativeSync::Preload(const torch::lazy::hash_t& graph_hash,
+                              PreloadFn preload_fn) {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!pending_.insert(graph_hash).second) {
+      return;
+    }
+  }
+  XLA_COUNTER("SpeculativeSyncPreload", 1);
+  auto preloadfn = [this, graph_hash, preload_fn]() {
+    try {
+      preload_fn(graph_hash);
+    } catch (const std::exception& ex) {
+      TF_LOG(WARNING) << "Speculative preload of IR graph hash "
+                      << torch::lazy::HashToString(graph_hash)
+                      << " failed: " << ex.what();
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    pending_.erase(graph_hash);
+    cv_.notify_all();
+  };
+  xla::env::ScheduleIoClosure(std::move(preloadfn));
+}
+
+void SpeculativeSync::RecordGraph(const torch::lazy::hash_t& hash) {
+  TraceState& state = g_trace_state;
+  if (state.predicted) {
+    if (state.predicted_hash == hash) {
+      XLA_COUNTER("SpeculativeSyncHit", 1);
+    } else {
+      XLA_COUNTER("SpeculativeSyncMiss", 1);
+    }
+  }
+  bool has_prefix = state.num_values >= prefix_values_;
+  torch::lazy::hash_t prefix_hash = state.prefix_hash;
+  state.Reset();
+
+  std::unique_lock<std::mutex> lock(lock_);
+  if (has_prefix) {
+    std::shared_ptr<PrefixInfo> prefix = prefixes_.Get(prefix_hash);
+    if (prefix == nullptr) {
+      prefixes_.Add(prefix_hash, std::make_shared<PrefixInfo>(hash));
+    } else if (prefix->graph_hash == hash) {
+      prefix->matches += 1;
+    } else {
+      prefix->graph_hash = hash;
+      prefix->matches = 1;
+    }
+  }
+  if (pending_.count(hash) > 0) {
+    XLA_TIMED("SpeculativeSyncWait");
+    cv_.wait(lock, [&] { return pending_.count(hash) == 0; });
+  }
+}
+
+}  // namespace torch_xla
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "torch/csrc/lazy/core/hash.h"
+
+namespace torch_xla {
+
+// The SpeculativeSync class predicts the graph of a sync point before its
+// trace completes. The tracing thread folds the hashes of the IR values it
+// assigns to tensors into a running prefix hash, and once
+// XLA_SPECULATIVE_SYNC_PREFIX values went in, the prefix is looked up among
+// the ones of the previous steps. If the prefix led to the same graph for
+// XLA_SPECULATIVE_SYNC_MIN_MATCHES steps in a row, the load of the computation
+// of that graph (from the compile-ahead, warm start or persistent caches, which
+// also loads the executable onto the device) starts in background, hiding it
+// behind the remainder of the trace.
+class SpeculativeSync {
+ public:
+  using PreloadFn = void (*)(const torch::lazy::hash_t&);
+
+  // Returns the speculative sync singleton, or nullptr if the speculative sync
+  // mode is not enabled (XLA_SPECULATIVE_SYNC not set).
+  static SpeculativeSync* Get();
+
+  SpeculativeSync(size_t prefix_values, size_t min_matches,
+                  size_t max_prefixes);
+
+  // Records an IR value assigned to a tensor by the calling thread, running
+  // preload_fn in background for the predicted graph, if this value completes
+  // a known prefix.
+  void RecordValue(const torch::lazy::hash_t& hash, PreloadFn preload_fn);
+
+  // Records that the trace of the calling thread ended with the graph of the
+  // given hash, and starts a new trace. Waits for the in-flight preload of the
+  // graph, if any, so that the sync finds it within the computation cache.
+  void RecordGraph(const torch::lazy::hash_t& hash);
+
+ private:
+  struct PrefixInfo {
+    explicit PrefixInfo(const torch::lazy::hash_t& graph_hash)
+        : graph_hash(graph_hash) {}
+
+    torch::lazy::hash_t graph_hash;
+    // The number of steps in a row the prefix led to graph_hash.
+    size_t matches = 1;
+  };
+
+  using PrefixCache = xla::util::Cache<torch::lazy::hash_t, PrefixInfo,
+                                       torch::lazy::HashReducer>;
+
+  void Preload(const torch::lazy::hash_t& graph_hash, PreloadFn preload_fn);
+
+  size_t prefix_values_;
+  size_t min_matches_;
+  PrefixCache prefixes_;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::unordered_set<torch::lazy::hash_t, torch::lazy::HashReducer> pending_;
+};
+
+}  // namespace torch_xla
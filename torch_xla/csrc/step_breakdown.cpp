@@ -0,0 +1,155 @@
+#include "torch_xla/csrc/step_breakdown.h"
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+
+namespace torch_xla {
+namespace step_breakdown {
+namespace {
+
+class StepTracker {
+ public:
+  static StepTracker* Get() {
+    static StepTracker* tracker = new StepTracker();
+    return tracker;
+  }
+
+  void Add(Phase phase, int64_t time_ns) {
+    shards_[ShardIndex()].phase_ns[static_cast<size_t>(phase)].fetch_add(
+        time_ns, std::memory_order_relaxed);
+  }
+
+  void EndStep(const std::string& device) {
+    int64_t now_ns = xla::sys_util::NowNs();
+    StepRecord record;
+    record.device = device;
+    for (auto& shard : shards_) {
+      for (size_t i = 0; i < kNumPhases; ++i) {
+        record.phase_ns[i] += shard.phase_ns[i].exchange(0);
+      }
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    record.step = num_steps_++;
+    record.wall_ns = now_ns - last_step_ns_;
+    last_step_ns_ = now_ns;
+    steps_.push_back(std::move(record));
+    if (steps_.size() > max_steps_) {
+      steps_.pop_front();
+    }
+  }
+
+  std::vector<StepRecord> GetSteps() {
+    std::lock_guard<std::mutex> lock(lock_);
+    return std::vector<StepRecord>(steps_.begin(), steps_.end());
+  }
+
+ private:
+  StepTracker()
+      : max_steps_(std::max<int64_t>(
+            xla::sys_util::GetEnvInt("XLA_STEP_BREAKDOWN_HISTORY", 128), 1)),
+        last_step_ns_(xla::sys_util::NowNs()) {
+    for (auto& shard : shards_) {
+      for (auto& phase_ns : shard.phase_ns) {
+        phase_ns = 0;
+      }
+    }
+  }
+
+  // The phase times are accounted on every operation, from all the tracing
+  // threads, so every thread adds to the shard of its own, on separate cache
+  // lines.
+  static constexpr size_t kNumShards = 16;
+
+  struct alignas(64) Shard {
+    std::array<std::atomic<int64_t>, kNumPhases> phase_ns;
+  };
+
+  static size_t ShardIndex() {
+    static std::atomic<size_t> next_index(0);
+    static thread_local size_t index = next_index++ % kNumShards;
+    return index;
+  }
+
+  std::array<Shard, kNumShards> shards_;
+  std::mutex lock_;
+  size_t max_steps_;
+  int64_t num_steps_ = 0;
+  int64_t last_step_ns_;
+  std::deque<StepRecord> steps_;
+};
+
+bool IsEnabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_STEP_BREAKDOWN", false);
+  return enabled;
+}
+
+thread_local ScopedPhase* g_current_phase = nullptr;
+
+}  // namespace
+
+const char* PhaseName(Phase phase) {
+  switch (phase) {
+    case Phase::kDispatch:
+      return "dispatch";
+    case Phase::kTracing:
+      return "tracing";
+    case Phase::kCollectSyncTensors:
+      return "collect_sync_tensors";
+    case Phase::kHash:
+      return "hash";
+    case Phase::kCompile:
+      return "compile";
+    case Phase::kUpload:
+      return "upload";
+    case Phase::kExecute:
+      return "execute";
+    case Phase::kDeviceWait:
+      return "device_wait";
+    case Phase::kDownload:
+      return "download";
+    case Phase::kNumPhases:
+      break;
+  }
+  return "unknown";
+}
+
+ScopedPhase::ScopedPhase(Phase phase) : phase_(phase), enabled_(IsEnabled()) {
+  if (!enabled_) {
+    return;
+  }
+  start_ns_ = xla::sys_util::NowNs();
+  parent_ = g_current_phase;
+  if (parent_ != nullptr) {
+    // The time of the nested scope does not count for the enclosing one.
+    StepTracker::Get()->Add(parent_->phase_, start_ns_ - parent_->start_ns_);
+  }
+  g_current_phase = this;
+}
+
+ScopedPhase::~ScopedPhase() {
+  if (!enabled_) {
+    return;
+  }
+  int64_t now_ns = xla::sys_util::NowNs();
+  StepTracker::Get()->Add(phase_, now_ns - start_ns_);
+  g_current_phase = parent_;
+  if (parent_ != nullptr) {
+    parent_->start_ns_ = now_ns;
+  }
+}
+
+void EndStep(const std::string& device) {
+  if (IsEnabled()) {
+    StepTracker::Get()->EndStep(device);
+  }
+}
+
+std::vector<StepRecord> GetSteps() { return StepTracker::Get()->GetSteps(); }
+
+}  // namespace step_breakdown
+}  // namespace torch_xla
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace torch_xla {
+namespace step_breakdown {
+
+// Where the host time of the steps goes.
+enum class Phase {
+  // Within the ATen operations, from the Python dispatch on.
+  kDispatch,
+  // Creating the IR nodes, with their shape inference.
+  kTracing,
+  kCollectSyncTensors,
+  // The post order of the graphs and the hashing of their parameters.
+  kHash,
+  // The lowering and the compilation of the graphs.
+  kCompile,
+  kUpload,
+  // The dispatch of the graph executions.
+  kExecute,
+  // The waits for the device, at the device barrier or for the executions.
+  kDeviceWait,
+  kDownload,
+  kNumPhases,
+};
+
+constexpr size_t kNumPhases = static_cast<size_t>(Phase::kNumPhases);
+
+const char* PhaseName(Phase phase);
+
+// Accounts the host time of the scope to the phase, except the time of the
+// nested scopes, which goes to their own phases, so that the phases of a step
+// never overlap within a thread. Enabled with XLA_STEP_BREAKDOWN=1, as it
+// costs two clock reads and atomic adds to the tracing of every operation.
+class ScopedPhase {
+ public:
+  explicit ScopedPhase(Phase phase);
+
+  ~ScopedPhase();
+
+ private:
+  Phase phase_;
+  bool enabled_;
+  int64_t start_ns_ = 0;
+  ScopedPhase* parent_ = nullptr;
+};
+
+struct StepRecord {
+  int64_t step = 0;
+  std::string device;
+  // The wall time from the end of the previous step.
+  int64_t wall_ns = 0;
+  // The time of every phase, summed over the threads, indexed by Phase.
+  std::array<int64_t, kNumPhases> phase_ns = {};
+};
+
+// Closes the current step, whose record goes into the ring of the last
+// XLA_STEP_BREAKDOWN_HISTORY steps.
+void EndStep(const std::string& device);
+
+// Returns the records of the recent steps, from the oldest to the newest.
+std::vector<StepRecord> GetSteps();
+
+}  // namespace step_breakdown
+}  // namespace torch_xla
+
+#define XLA_STEP_PHASE(phase)                          \
+  ::torch_xla::step_breakdown::ScopedPhase __xla_phase( \
+      ::torch_xla::step_breakdown::Phase::phase)
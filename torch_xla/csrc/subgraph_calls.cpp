@@ -0,0 +1,272 @@
+#include "torch_xla/csrc/subgraph_calls.h"
+
+#include <memory>
+
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "torch/csrc/lazy/core/hash.h"
+#include "torch_xla/csrc/helpers.h"
+
+namespace torch_xla {
+namespace {
+
+using ComputationCache =
+    xla::util::Cache<torch::lazy::hash_t, xla::XlaComputation,
+                     torch::lazy::HashReducer>;
+
+ComputationCache* GetComputationCache() {
+  static const size_t cache_size =
+      xla::sys_util::GetEnvInt("XLA_SUBGRAPH_CALLS_CACHE_SIZE", 1024);
+  static ComputationCache* cache = new ComputationCache(cache_size);
+  return cache;
+}
+
+bool IsCallable(const torch::lazy::Node* node) {
+  const XlaNode* xla_node = dynamic_cast<const XlaNode*>(node);
+  // The sharding annotations are applied on the main computation outputs.
+  return xla_node != nullptr && xla_node->GetSharding() == nullptr &&
+         !node->operands().empty();
+}
+
+bool HasShapes(const xla::ProgramShape& program_shape,
+               absl::Span<const xla::Shape> shapes) {
+  if (static_cast<size_t>(program_shape.parameters_size()) != shapes.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    if (!xla::ShapeUtil::Equal(program_shape.parameters(i), shapes[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+size_t SubgraphCalls::GetMinNodes() {
+  static const size_t min_nodes =
+      xla::sys_util::GetEnvInt("XLA_SUBGRAPH_CALLS_MIN_NODES", 0);
+  return min_nodes;
+}
+
+SubgraphCalls::SubgraphCalls(
+    absl::Span<const torch::lazy::Node* const> post_order,
+    absl::Span<const torch::lazy::Output> roots,
+    ParallelLowering::ReplacementFn replacement_fn,
+    const torch::lazy::BackendDevice& device)
+    : replacement_fn_(std::move(replacement_fn)), device_(device) {
+  std::unordered_map<const torch::lazy::Node*, size_t> positions;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    positions.emplace(post_order[i], i);
+  }
+  std::vector<std::vector<torch::lazy::Output>> inputs;
+  inputs.reserve(post_order.size());
+  std::vector<size_t> use_counts(post_order.size(), 0);
+  for (auto node : post_order) {
+    inputs.push_back(GetInputs(node));
+    for (auto& input : inputs.back()) {
+      auto it = positions.find(input.node);
+      if (it != positions.end()) {
+        use_counts[it->second] += 1;
+      }
+    }
+  }
+  for (auto& root : roots) {
+    use_counts[positions.at(root.node)] += 1;
+  }
+
+  // A node used only once belongs to the region of its user. Users come before
+  // their operands in reverse post order, so the region of a node is final by
+  // the time it gets visited.
+  std::vector<size_t> regions(post_order.size());
+  std::vector<bool> members(post_order.size(), false);
+  for (size_t i = post_order.size(); i > 0; --i) {
+    size_t position = i - 1;
+    if (!members[position]) {
+      regions[position] = position;
+    }
+    // The region of a replaced node gets lowered by its replacement.
+    if (IsReplaced(post_order[position])) {
+      continue;
+    }
+    for (auto& input : inputs[position]) {
+      auto it = positions.find(input.node);
+      if (it != positions.end() && use_counts[it->second] == 1 &&
+          IsCallable(input.node) && !IsReplaced(input.node)) {
+        regions[it->second] = regions[position];
+        members[it->second] = true;
+      }
+    }
+  }
+  std::unordered_map<size_t, std::vector<size_t>> region_nodes;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    region_nodes[regions[i]].push_back(i);
+  }
+
+  size_t min_nodes = GetMinNodes();
+  std::vector<Subgraph> candidates;
+  std::unordered_map<torch::lazy::hash_t, size_t, torch::lazy::HashReducer>
+      hash_counts;
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    if (regions[i] != i || region_nodes[i].size() < min_nodes ||
+        !IsCallable(post_order[i]) || IsReplaced(post_order[i])) {
+      continue;
+    }
+    // The region post order is rebuilt from its root, as the nodes of the graph
+    // post order come in the order they have been first reached from any root,
+    // which is not the same for all the repeats of a region.
+    Subgraph subgraph;
+    std::unordered_map<const torch::lazy::Node*, size_t> local_positions;
+    std::unordered_map<torch::lazy::Output, size_t,
+                       torch::lazy::Output::Hasher>
+        input_positions;
+    std::vector<std::pair<size_t, size_t>> stack;
+    stack.emplace_back(i, 0);
+    torch::lazy::hash_t hash = torch::lazy::HashCombine(
+        static_cast<uint64_t>(device_.type()), post_order[i]->num_outputs());
+    while (!stack.empty()) {
+      size_t position = stack.back().first;
+      size_t& next_input = stack.back().second;
+      const std::vector<torch::lazy::Output>& node_inputs = inputs[position];
+      bool pushed = false;
+      for (; next_input < node_inputs.size(); ++next_input) {
+        auto input_it = positions.find(node_inputs[next_input].node);
+        if (input_it != positions.end() && members[input_it->second] &&
+            regions[input_it->second] == i &&
+            local_positions.count(input_it->first) == 0) {
+          ++next_input;
+          stack.emplace_back(input_it->second, 0);
+          pushed = true;
+          break;
+        }
+      }
+      if (pushed) {
+        continue;
+      }
+      const XlaNode* node = dynamic_cast<const XlaNode*>(post_order[position]);
+      torch::lazy::hash_t node_hash = node->node_hash();
+      for (auto& input : node_inputs) {
+        auto it = local_positions.find(input.node);
+        if (it != local_positions.end()) {
+          node_hash = torch::lazy::HashCombine(
+              node_hash, torch::lazy::HashCombine(it->second, input.index));
+          continue;
+        }
+        auto input_it =
+            input_positions.emplace(input, subgraph.inputs.size()).first;
+        if (input_it->second == subgraph.inputs.size()) {
+          subgraph.inputs.push_back(input);
+        }
+        const XlaNode* input_node = dynamic_cast<const XlaNode*>(input.node);
+        node_hash = torch::lazy::HashCombine(
+            node_hash,
+            torch::lazy::HashCombine(
+                // Tells the inputs apart from the region nodes.
+                ~static_cast<uint64_t>(input_it->second),
+                torch::lazy::Hash(
+                    input_node->xla_shape(input.index).ToString())));
+      }
+      hash = torch::lazy::HashCombine(hash, node_hash);
+      local_positions.emplace(node, subgraph.nodes.size());
+      subgraph.nodes.push_back(node);
+      stack.pop_back();
+    }
+    subgraph.hash = hash;
+    hash_counts[hash] += 1;
+    candidates.push_back(std::move(subgraph));
+  }
+
+  for (auto& subgraph : candidates) {
+    if (hash_counts[subgraph.hash] < 2 &&
+        GetComputationCache()->Get(subgraph.hash) == nullptr) {
+      continue;
+    }
+    subgraph_roots_.emplace(subgraph.nodes.back(), subgraphs_.size());
+    called_nodes_.insert(subgraph.nodes.begin(), subgraph.nodes.end() - 1);
+    subgraphs_.push_back(std::move(subgraph));
+  }
+  if (!subgraphs_.empty()) {
+    XLA_VALUE_METRIC("SubgraphCalls", subgraphs_.size());
+  }
+  TF_VLOG(5) << "Lowering " << subgraphs_.size() << " sub-graph calls, out of "
+             << candidates.size() << " regions with at least " << min_nodes
+             << " nodes";
+}
+
+bool SubgraphCalls::IsReplaced(const torch::lazy::Node* node) const {
+  return replacement_fn_ != nullptr && replacement_fn_(node) != nullptr;
+}
+
+std::vector<torch::lazy::Output> SubgraphCalls::GetInputs(
+    const torch::lazy::Node* node) const {
+  const torch::lazy::Node* replacement =
+      replacement_fn_ != nullptr ? replacement_fn_(node) : nullptr;
+  if (replacement == nullptr) {
+    return std::vector<torch::lazy::Output>(node->operands().begin(),
+                                            node->operands().end());
+  }
+  std::vector<torch::lazy::Output> inputs;
+  for (size_t i = 0; i < node->num_outputs(); ++i) {
+    inputs.emplace_back(replacement, i);
+  }
+  return inputs;
+}
+
+bool SubgraphCalls::LowerCall(const torch::lazy::Node* node,
+                              LoweringContext* loctx) {
+  auto it = subgraph_roots_.find(node);
+  if (it == subgraph_roots_.end()) {
+    return false;
+  }
+  const Subgraph& subgraph = subgraphs_[it->second];
+  std::vector<xla::XlaOp> operands;
+  std::vector<xla::Shape> input_shapes;
+  for (auto& input : subgraph.inputs) {
+    operands.push_back(loctx->GetOutputOp(input));
+    input_shapes.push_back(XlaHelpers::ShapeOfXlaOp(operands.back()));
+  }
+  ComputationCache* cache = GetComputationCache();
+  std::shared_ptr<xla::XlaComputation> computation = cache->Get(subgraph.hash);
+  if (computation == nullptr ||
+      !HasShapes(ConsumeValue(computation->GetProgramShape()), input_shapes)) {
+    XLA_COUNTER("SubgraphCallsCacheMiss", 1);
+    computation = std::make_shared<xla::XlaComputation>(
+        BuildComputation(subgraph, input_shapes));
+    cache->Add(subgraph.hash, computation);
+  }
+  xla::XlaOp call = xla::Call(loctx->builder(), *computation, operands);
+  for (size_t i = 0; i < node->num_outputs(); ++i) {
+    loctx->AssignOutputOp(torch::lazy::Output(node, i),
+                          xla::GetTupleElement(call, i));
+  }
+  return true;
+}
+
+xla::XlaComputation SubgraphCalls::BuildComputation(
+    const Subgraph& subgraph, absl::Span<const xla::Shape> input_shapes) {
+  XLA_TIMED("SubgraphCallsLowering");
+  LoweringContext loctx(
+      absl::StrCat("Subgraph_", torch::lazy::HashToString(subgraph.hash)),
+      device_);
+  for (size_t i = 0; i < subgraph.inputs.size(); ++i) {
+    loctx.AddOutputParameter(subgraph.inputs[i], input_shapes[i]);
+  }
+  // The region nodes are never replaced ones.
+  for (auto node : subgraph.nodes) {
+    loctx.LowerNode(node);
+  }
+  const torch::lazy::Node* root = subgraph.nodes.back();
+  std::vector<xla::XlaOp> results;
+  for (size_t i = 0; i < root->num_outputs(); ++i) {
+    results.push_back(loctx.GetOutputOp(torch::lazy::Output(root, i)));
+  }
+  return ConsumeValue(loctx.BuildXla(xla::Tuple(loctx.builder(), results)));
+}
+
+}  // namespace torch_xla
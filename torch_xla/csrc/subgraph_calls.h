@@ -0,0 +1,70 @@
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/parallel_lowering.h"
+
+namespace torch_xla {
+
+// Lowers the sub-graphs which repeat within an IR graph (like the blocks of
+// deep models), or across IR graphs, once into their own computation, which
+// the graph computation then calls.
+// The graph gets split into fanout free regions: a node whose value is only
+// used by another node belongs to the region of its user. The hash of a region
+// covers its nodes and the shapes of the values entering it, but not how these
+// values were computed, so repeated blocks of a model hash the same, even if
+// they are stacked onto each other. The region computations are cached by
+// such hash, and reused across graphs.
+class SubgraphCalls {
+ public:
+  // Returns the minimum number of nodes of the regions to be lowered as calls
+  // (XLA_SUBGRAPH_CALLS_MIN_NODES), or zero if disabled.
+  static size_t GetMinNodes();
+
+  SubgraphCalls(absl::Span<const torch::lazy::Node* const> post_order,
+                absl::Span<const torch::lazy::Output> roots,
+                ParallelLowering::ReplacementFn replacement_fn,
+                const torch::lazy::BackendDevice& device);
+
+  // Returns whether the node gets lowered within a region computation, as
+  // part of the call emitted for the region root.
+  bool IsCalled(const torch::lazy::Node* node) const {
+    return called_nodes_.count(node) > 0;
+  }
+
+  // If the node is the root of a region lowered as call, emits the call and
+  // returns true.
+  bool LowerCall(const torch::lazy::Node* node, LoweringContext* loctx);
+
+  size_t num_calls() const { return subgraphs_.size(); }
+
+ private:
+  struct Subgraph {
+    torch::lazy::hash_t hash;
+    // The region nodes, in post order, the last one being the region root.
+    std::vector<const torch::lazy::Node*> nodes;
+    // The values entering the region, which become the computation
+    // parameters.
+    std::vector<torch::lazy::Output> inputs;
+  };
+
+  bool IsReplaced(const torch::lazy::Node* node) const;
+
+  std::vector<torch::lazy::Output> GetInputs(
+      const torch::lazy::Node* node) const;
+
+  xla::XlaComputation BuildComputation(
+      const Subgraph& subgraph, absl::Span<const xla::Shape> input_shapes);
+
+  ParallelLowering::ReplacementFn replacement_fn_;
+  torch::lazy::BackendDevice device_;
+  std::vector<Subgraph> subgraphs_;
+  std::unordered_map<const torch::lazy::Node*, size_t> subgraph_roots_;
+  std::unordered_set<const torch::lazy::Node*> called_nodes_;
+};
+
+}  // namespace torch_xla
@@ -1,24 +1,38 @@
 #include "torch_xla/csrc/tensor.h"
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cmath>
 #include <condition_variable>
 #include <exception>
 #include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <numeric>
 #include <set>
+#include <shared_mutex>
 #include <stdexcept>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 #include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/protobuf_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/memory_tracker.h"
 #include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sharded_cache.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/unique.h"
@@ -31,11 +45,17 @@
 #include "torch/csrc/lazy/core/ir_util.h"
 #include "torch/csrc/lazy/core/tensor_util.h"
 #include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/compile_ahead.h"
 #include "torch_xla/csrc/debug_util.h"
+#include "torch_xla/csrc/graph_profiler.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/host_object_pool.h"
 #include "torch_xla/csrc/ir_dump_util.h"
+#include "torch_xla/csrc/ir_simplifier.h"
 #include "torch_xla/csrc/layout_manager.h"
 #include "torch_xla/csrc/op_by_op_executor.h"
+#include "torch_xla/csrc/parallel_lowering.h"
+#include "torch_xla/csrc/persistent_cache.h"
 #include "torch_xla/csrc/ops/arithmetic_ir_ops.h"
 #include "torch_xla/csrc/ops/cast.h"
 #include "torch_xla/csrc/ops/device_data.h"
@@ -43,16 +63,32 @@
 #include "torch_xla/csrc/ops/ops.h"
 #include "torch_xla/csrc/ops/view.h"
 #include "torch_xla/csrc/ops/xla_ops.h"
+#include "torch_xla/csrc/random.h"
+#include "torch_xla/csrc/speculative_sync.h"
+#include "torch_xla/csrc/step_breakdown.h"
+#include "torch_xla/csrc/subgraph_calls.h"
 #include "torch_xla/csrc/tensor_util.h"
 #include "torch_xla/csrc/torch_util.h"
+#include "torch_xla/csrc/warm_start.h"
+#include "torch_xla/csrc/xla_backend_impl.h"
 
 namespace torch_xla {
 namespace {
 
 struct TlsData {
-  void Reset() { trim_counter = 0; }
+  void Reset() {
+    trim_counter = 0;
+    trim_deferred = -1;
+    trim_scope.clear();
+  }
 
   size_t trim_counter = 0;
+  // Number of IR values created since the last eager micro graph got issued.
+  size_t eager_counter = 0;
+  // Number of IR values created since a graph trim got deferred to the next
+  // scope boundary, or -1 if no trim is pending.
+  int64_t trim_deferred = -1;
+  std::string trim_scope;
 };
 
 thread_local TlsData g_tls_data;
@@ -73,6 +109,9 @@ thread_local TlsData g_tls_data;
 // which send data to device do not need to hold any device locks while doing
 // so. Only operations which _use_ device data (computations, and transfer from
 // server) need to wait for asynchronous operations to complete (barrier).
+// The transfers from server of materialized tensors do not need the barrier
+// either: they wait for the readiness of their own buffers only, see
+// PendingDataArena below.
 
 class DeviceLocker {
  public:
@@ -157,6 +196,74 @@ void DeviceBarrier(const torch::lazy::BackendDevice& device) {
   locker->Barrier();
 }
 
+// The per buffer readiness of the placeholders of the outputs of the
+// asynchronous executions in flight, with the completion of the execution
+// which produces them. Reading a tensor waits for its own buffer, rather than
+// for the device barrier, so that fetching a tensor which is not produced by
+// the running graphs never waits behind them.
+class PendingDataArena {
+ public:
+  static PendingDataArena* Get() {
+    static PendingDataArena* arena = new PendingDataArena();
+    return arena;
+  }
+
+  void Register(const xla::ComputationClient::Data* data,
+                std::weak_ptr<xla::util::MultiWait> completion) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_[data] = std::move(completion);
+  }
+
+  void Unregister(const xla::ComputationClient::Data* data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.erase(data);
+  }
+
+  std::shared_ptr<xla::util::MultiWait> Find(
+      const xla::ComputationClient::Data* data) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(data);
+    return it != pending_.end() ? it->second.lock() : nullptr;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<const xla::ComputationClient::Data*,
+                     std::weak_ptr<xla::util::MultiWait>>
+      pending_;
+};
+
+// Waits for the device data to hold its value. The data which is neither
+// ready nor the output of a registered execution falls back to the device
+// barrier.
+void WaitForData(const xla::ComputationClient::Data& data) {
+  std::shared_ptr<xla::util::MultiWait> completion =
+      PendingDataArena::Get()->Find(&data);
+  if (completion != nullptr) {
+    XLA_COUNTER("PendingDataWait", 1);
+    XLA_STEP_PHASE(kDeviceWait);
+    try {
+      completion->Wait();
+    } catch (...) {
+      // The failure of the execution is also pending on the device locker,
+      // which gets reset by surfacing it from there. The completion keeps the
+      // device locks of the execution alive, so it has to go first.
+      completion.reset();
+      DeviceBarrier(ParseDeviceString(data.device()));
+      throw;
+    }
+  } else if (!data.HasValue()) {
+    DeviceBarrier(ParseDeviceString(data.device()));
+  }
+}
+
+void WaitForTensorsData(
+    absl::Span<const torch::lazy::BackendDataPtr> tensors_data) {
+  for (auto& xla_data : tensors_data) {
+    WaitForData(*UnwrapXlaData(xla_data));
+  }
+}
+
 // Use a set to impose an order on the device locking sequence (ABBA
 // prevention).
 std::vector<xla::util::ExceptionCleanup> LockDevices(
@@ -169,63 +276,287 @@ std::vector<xla::util::ExceptionCleanup> LockDevices(
   return unlocker;
 }
 
-class XlaDataCacheArena {
+// The CompilationArena deduplicates concurrent compilations of the same graph
+// (like the same replicated graph being synced by the threads driving
+// different local devices), and bounds the number of compilations running at
+// the same time.
+class CompilationArena {
  public:
-  struct TensorHasher {
-    size_t operator()(const at::Tensor& tensor) const {
-      return torch::lazy::HashReduce(torch::lazy::HashCombine(
-          torch::lazy::GetEnumValue(tensor.scalar_type()), TensorHash(tensor)));
-    };
-  };
-  struct TensorComparer {
-    bool operator()(const at::Tensor& tensor1,
-                    const at::Tensor& tensor2) const {
-      return TensorCompare(tensor1, tensor2);
+  static CompilationArena* Get() {
+    static CompilationArena* arena = new CompilationArena(
+        xla::sys_util::GetEnvInt("XLA_MAX_CONCURRENT_COMPILES", 0));
+    return arena;
+  }
+
+  explicit CompilationArena(size_t max_compiles)
+      : max_compiles_(max_compiles) {}
+
+  // Returns true if the caller is in charge of compiling the graph, in which
+  // case it has to call Exit() once done. Returns false if the graph was being
+  // compiled by another thread, after waiting for its completion.
+  bool Enter(const torch::lazy::hash_t& hash) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (in_flight_.count(hash) > 0) {
+      XLA_COUNTER("CompileInFlightWait", 1);
+      cv_.wait(lock, [&] { return in_flight_.count(hash) == 0; });
+      return false;
     }
+    in_flight_.insert(hash);
+    cv_.wait(lock, [this] {
+      return max_compiles_ == 0 || active_compiles_ < max_compiles_;
+    });
+    ++active_compiles_;
+    return true;
+  }
+
+  void Exit(const torch::lazy::hash_t& hash) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_flight_.erase(hash);
+    --active_compiles_;
+    cv_.notify_all();
+  }
+
+ private:
+  size_t max_compiles_ = 0;
+  size_t active_compiles_ = 0;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::unordered_set<torch::lazy::hash_t, torch::lazy::HashReducer> in_flight_;
+};
+
+struct TensorHasher {
+  size_t operator()(const at::Tensor& tensor) const {
+    return torch::lazy::HashReduce(torch::lazy::HashCombine(
+        torch::lazy::GetEnumValue(tensor.scalar_type()), TensorHash(tensor)));
   };
+};
+
+struct TensorComparer {
+  bool operator()(const at::Tensor& tensor1, const at::Tensor& tensor2) const {
+    return TensorCompare(tensor1, tensor2);
+  }
+};
 
-  using XlaDataCache = xla::util::Cache<at::Tensor, torch::lazy::BackendData,
-                                        TensorHasher, TensorComparer>;
+// The device data cache is hit by every scalar which makes it into the IR
+// graphs, from all the tracing threads, so it uses the sharded cache.
+using XlaDataCache =
+    xla::util::ShardedCache<at::Tensor, torch::lazy::BackendData,
+                            TensorHasher, TensorComparer>;
+// The constant cache needs the byte budget (and the cost aware eviction) of
+// the LRU cache.
+using XlaConstantCache = xla::util::Cache<at::Tensor, torch::lazy::BackendData,
+                                          TensorHasher, TensorComparer>;
+
+template <typename C>
+class XlaDataCacheArena {
+ public:
+  using CacheFactory = std::function<std::unique_ptr<C>()>;
 
-  explicit XlaDataCacheArena(size_t max_cache_size)
-      : max_cache_size_(max_cache_size) {}
+  explicit XlaDataCacheArena(CacheFactory factory)
+      : factory_(std::move(factory)) {}
 
-  XlaDataCache* Get(const torch::lazy::BackendDevice& device) {
-    std::lock_guard<std::mutex> lock(mutex_);
+  C* Get(const torch::lazy::BackendDevice& device) {
+    {
+      std::shared_lock<std::shared_timed_mutex> lock(mutex_);
+      auto it = device_caches_.find(device);
+      if (it != device_caches_.end()) {
+        return it->second.get();
+      }
+    }
+    std::lock_guard<std::shared_timed_mutex> lock(mutex_);
     auto it = device_caches_.find(device);
     if (it == device_caches_.end()) {
-      std::unique_ptr<XlaDataCache> cache(new XlaDataCache(max_cache_size_));
-      it = device_caches_.emplace(device, std::move(cache)).first;
+      it = device_caches_.emplace(device, factory_()).first;
     }
     return it->second.get();
   }
 
  private:
-  size_t max_cache_size_ = 0;
-  std::mutex mutex_;
-  std::map<torch::lazy::BackendDevice, std::unique_ptr<XlaDataCache>>
-      device_caches_;
+  CacheFactory factory_;
+  std::shared_timed_mutex mutex_;
+  std::map<torch::lazy::BackendDevice, std::unique_ptr<C>> device_caches_;
 };
 
-XlaDataCacheArena::XlaDataCache* GetXlaDataCache(
-    const torch::lazy::BackendDevice& device) {
+XlaDataCache* GetXlaDataCache(const torch::lazy::BackendDevice& device) {
   static const size_t kMaxCacheSize =
       xla::sys_util::GetEnvInt("XLA_DEVDATA_CACHE_SIZE", 128);
-  static XlaDataCacheArena* arena = new XlaDataCacheArena(kMaxCacheSize);
+  static XlaDataCacheArena<XlaDataCache>* arena =
+      new XlaDataCacheArena<XlaDataCache>([]() {
+        xla::util::CacheOptions options;
+        options.name = "DeviceDataCache";
+        return absl::make_unique<XlaDataCache>(kMaxCacheSize,
+                                               /*num_shards=*/16, options);
+      });
   return arena->Get(device);
 }
 
+size_t GetConstantCacheMaxBytes() {
+  static const size_t max_bytes =
+      xla::sys_util::GetEnvInt("XLA_DEVDATA_CONSTANT_CACHE_BYTES", 0);
+  return max_bytes;
+}
+
+// The constant cache holds the device data of non scalar host tensors, so that
+// repeatedly re-created constants (like masks or position encodings) are only
+// uploaded once. It is enabled by a non zero XLA_DEVDATA_CONSTANT_CACHE_BYTES.
+XlaConstantCache* GetXlaConstantCache(
+    const torch::lazy::BackendDevice& device) {
+  static const size_t kMaxCacheSize =
+      xla::sys_util::GetEnvInt("XLA_DEVDATA_CONSTANT_CACHE_SIZE", 1024);
+  static XlaDataCacheArena<XlaConstantCache>* arena =
+      new XlaDataCacheArena<XlaConstantCache>([]() {
+        auto size_fn = [](const torch::lazy::BackendData& data) -> size_t {
+          return xla::ShapeUtil::ByteSizeOf(
+              const_cast<XLAData&>(dynamic_cast<const XLAData&>(data))
+                  .xla_data()
+                  ->shape());
+        };
+        return absl::make_unique<XlaConstantCache>(
+            kMaxCacheSize, GetConstantCacheMaxBytes(), size_fn);
+      });
+  return arena->Get(device);
+}
+
+// Returns the cached device data for the tensor, uploading it on a miss, or
+// nullptr if the tensor is not eligible for the constant cache.
+torch::lazy::BackendDataPtr GetConstantDeviceData(
+    const at::Tensor& tensor, const torch::lazy::BackendDevice& device) {
+  static const size_t kMaxTensorBytes = xla::sys_util::GetEnvInt(
+      "XLA_DEVDATA_CONSTANT_MAX_BYTES", 16 * 1024 * 1024);
+  size_t max_bytes = GetConstantCacheMaxBytes();
+  size_t tensor_bytes = tensor.numel() * tensor.element_size();
+  if (max_bytes == 0 || tensor_bytes > std::min(kMaxTensorBytes, max_bytes)) {
+    return nullptr;
+  }
+  XlaConstantCache* cache = GetXlaConstantCache(device);
+  torch::lazy::BackendDataPtr device_data = cache->Get(tensor);
+  if (device_data == nullptr) {
+    at::Tensor tensor_copy = torch::lazy::CopyTensor(tensor);
+    device_data = TensorToXlaData(tensor_copy, device);
+    cache->Add(std::move(tensor_copy), device_data);
+    XLA_COUNTER("DeviceConstantCacheMiss", 1);
+  } else {
+    XLA_COUNTER("DeviceConstantCacheHit", 1);
+  }
+  return device_data;
+}
+
+// The host copy of a device data. The host mirror cache is keyed by the
+// address of the device data, which gets reused once it is freed, so the entry
+// is only valid while the device data it came from is alive.
+struct HostMirror {
+  HostMirror(const torch::lazy::BackendDataPtr& data, at::Tensor tensor)
+      : data(data), tensor(std::move(tensor)) {}
+
+  std::weak_ptr<torch::lazy::BackendData> data;
+  at::Tensor tensor;
+};
+
+using HostMirrorCache =
+    xla::util::Cache<const torch::lazy::BackendData*, HostMirror>;
+
+size_t GetHostMirrorMaxBytes() {
+  static const size_t max_bytes = xla::sys_util::GetEnvInt(
+      "XLA_HOST_MIRROR_CACHE_BYTES", 64 * 1024 * 1024);
+  return max_bytes;
+}
+
+size_t GetHostMirrorMaxSize() {
+  static const size_t max_size =
+      xla::sys_util::GetEnvInt("XLA_HOST_MIRROR_CACHE_SIZE", 256);
+  return max_size;
+}
+
+// The host mirror cache holds the host copies of the device data read by
+// ToTensor(), so that the tensors read more than once (like metrics, masks or
+// lookup tables) only get transferred once per device data.
+HostMirrorCache* GetHostMirrorCache() {
+  static HostMirrorCache* cache = []() -> HostMirrorCache* {
+    if (GetHostMirrorMaxSize() == 0 || GetHostMirrorMaxBytes() == 0) {
+      return nullptr;
+    }
+    return new HostMirrorCache(
+        GetHostMirrorMaxSize(), GetHostMirrorMaxBytes(),
+        [](const HostMirror& mirror) {
+          return static_cast<size_t>(mirror.tensor.numel() *
+                                     mirror.tensor.element_size());
+        });
+  }();
+  return cache;
+}
+
+using HostMirrorMissCache =
+    xla::util::Cache<const torch::lazy::BackendData*,
+                     std::weak_ptr<torch::lazy::BackendData>>;
+
+// The device data read once, which only get a host mirror when read again, so
+// that the data read a single time (most of them) do not pay for a copy.
+HostMirrorMissCache* GetHostMirrorMissCache() {
+  static HostMirrorMissCache* cache =
+      new HostMirrorMissCache(GetHostMirrorMaxSize());
+  return cache;
+}
+
+c10::optional<at::Tensor> GetHostMirror(
+    const torch::lazy::BackendDataPtr& data, at::ScalarType scalar_type) {
+  HostMirrorCache* cache = GetHostMirrorCache();
+  if (cache == nullptr) {
+    return c10::nullopt;
+  }
+  HostMirrorCache::TypePtr mirror = cache->Get(data.get());
+  if (mirror == nullptr || mirror->data.lock() != data ||
+      mirror->tensor.scalar_type() != scalar_type) {
+    return c10::nullopt;
+  }
+  XLA_COUNTER("HostMirrorHit", 1);
+  // The callers own the returned tensor, and can update it in place.
+  return torch::lazy::CopyTensor(mirror->tensor);
+}
+
+void AddHostMirror(const torch::lazy::BackendDataPtr& data,
+                   const at::Tensor& tensor) {
+  HostMirrorCache* cache = GetHostMirrorCache();
+  if (cache == nullptr || static_cast<size_t>(tensor.numel() *
+                                              tensor.element_size()) >
+                              GetHostMirrorMaxBytes()) {
+    return;
+  }
+  HostMirrorMissCache* misses = GetHostMirrorMissCache();
+  HostMirrorMissCache::TypePtr miss = misses->Get(data.get());
+  if (miss == nullptr || miss->lock() != data) {
+    // A stale entry left by a freed device data at the same address.
+    if (miss != nullptr) {
+      misses->Erase(data.get());
+    }
+    misses->Add(data.get(),
+                std::make_shared<std::weak_ptr<torch::lazy::BackendData>>(
+                    data));
+    return;
+  }
+  misses->Erase(data.get());
+  cache->Add(data.get(), std::make_shared<HostMirror>(
+                             data, torch::lazy::CopyTensor(tensor)));
+}
+
+void EraseHostMirror(const torch::lazy::BackendDataPtr& data) {
+  HostMirrorCache* cache = GetHostMirrorCache();
+  if (cache != nullptr && data != nullptr) {
+    cache->Erase(data.get());
+    GetHostMirrorMissCache()->Erase(data.get());
+  }
+}
+
 torch::lazy::Value IrValueFromScalar(const at::Scalar& value,
                                      at::ScalarType scalar_type,
                                      const torch::lazy::BackendDevice& device) {
   at::Tensor tensor = at::scalar_tensor(value, at::TensorOptions(scalar_type));
   torch::lazy::BackendDataPtr device_data = TensorToXlaData(tensor, device);
-  return torch::lazy::MakeNode<DeviceData>(std::move(device_data));
+  return MakeXlaNode<DeviceData>(std::move(device_data));
 }
 
 torch::lazy::BackendDataPtr GetDeviceData(
     const at::Tensor& tensor, const torch::lazy::BackendDevice& device) {
-  XlaDataCacheArena::XlaDataCache* cache = GetXlaDataCache(device);
+  XlaDataCache* cache = GetXlaDataCache(device);
   torch::lazy::BackendDataPtr device_data = cache->Get(tensor);
   if (device_data == nullptr) {
     at::Tensor tensor_copy = torch::lazy::CopyTensor(tensor);
@@ -266,6 +597,75 @@ bool ShouldSyncIrValue(const torch::lazy::Value& ir_value) {
   return ir_value->op() != xla_not_supported;
 }
 
+// Whether the sync roots get sorted by their IR hash, so that the graph hash
+// does not depend on the order the tensors were created in.
+bool UseCanonicalGraphHash() {
+  static bool canonical_graph_hash =
+      xla::sys_util::GetEnvBool("XLA_CANONICAL_GRAPH_HASH", false);
+  return canonical_graph_hash;
+}
+
+// In pipelined sync mode, the tracing, hashing and cache lookup of a sync
+// operation do not wait for the device data produced by the previous (still
+// executing) graph, and the device barrier is only taken right before the
+// computation is scheduled (or compiled).
+bool UsePipelinedSync() {
+  static bool pipelined_sync =
+      xla::sys_util::GetEnvBool("XLA_PIPELINED_SYNC", false);
+  return pipelined_sync;
+}
+
+// The host wall time of the graph executions, whatever the backend, which the
+// performance analysis compares with the tracing time of the steps.
+xla::metrics::Metric* GraphExecuteMetric() {
+  static xla::metrics::Metric* metric =
+      new xla::metrics::Metric("GraphExecuteTime", xla::metrics::MetricFnTime);
+  return metric;
+}
+
+// With XLA_COMPILATION_CACHE_ADMISSION=tinylfu, the graphs which are seldom
+// run (like the ones of dynamic shapes) do not evict the hot ones from a full
+// compilation cache.
+xla::util::CacheOptions GetCompilationCacheOptions() {
+  xla::util::CacheOptions options;
+  options.name = "CompilationCache";
+  std::string admission =
+      xla::sys_util::GetEnvString("XLA_COMPILATION_CACHE_ADMISSION", "always");
+  XLA_CHECK(admission == "always" || admission == "tinylfu")
+      << "Invalid XLA_COMPILATION_CACHE_ADMISSION: " << admission;
+  if (admission == "tinylfu") {
+    options.admission = xla::util::CacheAdmission::kTinyLfu;
+  }
+  return options;
+}
+
+// The bytes of the device buffers of the data, over all the shards if sharded.
+int64_t GetDataBytes(const xla::ComputationClient::Data& data) {
+  const ShardedData* sharded = dynamic_cast<const ShardedData*>(&data);
+  if (sharded == nullptr) {
+    return xla::ShapeUtil::ByteSizeOf(data.shape());
+  }
+  int64_t bytes = 0;
+  for (auto& shard : sharded->shards()) {
+    bytes += xla::ShapeUtil::ByteSizeOf(shard->shape());
+  }
+  return bytes;
+}
+
+// Records the tensor owning the data, and its buffer unless already recorded,
+// with the memory tracker.
+void TrackTensorData(const torch::lazy::BackendDataPtr& xla_data,
+                     int64_t tensor_id) {
+  if (xla::memory_tracker::IsEnabled() && xla_data != nullptr) {
+    xla::ComputationClient::Data* data = UnwrapXlaData(xla_data).get();
+    xla::memory_tracker::SetOwner(data, tensor_id);
+    if (data->HasValue()) {
+      xla::memory_tracker::RecordData(data, data->device(),
+                                      GetDataBytes(*data));
+    }
+  }
+}
+
 }  // namespace
 
 // The DeviceContextArena holds per device live information and statistics,
@@ -274,11 +674,103 @@ bool ShouldSyncIrValue(const torch::lazy::Value& ir_value) {
 // operations and ensure the same XLA computations are created during the
 // training loops.
 class XLATensor::DeviceContextArena {
+  // The live tensors of a device. Tensors get registered and unregistered at
+  // every creation and destruction, so rather than going into an ordered map
+  // under the device lock, they go into the slots of the shard of the
+  // registering thread, which get recycled through a free list. The handles of
+  // the slots carry their generation, so that a stale handle never frees a
+  // reused slot.
+  class LiveTensorRegistry {
+   public:
+    uint64_t Register(const std::shared_ptr<Data>& data) {
+      uint64_t shard_index = GetThreadShard();
+      Shard& shard = shards_[shard_index];
+      std::lock_guard<std::mutex> lock(shard.lock);
+      uint64_t slot_index;
+      if (!shard.free_slots.empty()) {
+        slot_index = shard.free_slots.back();
+        shard.free_slots.pop_back();
+      } else {
+        slot_index = shard.slots.size();
+        shard.slots.emplace_back();
+      }
+      Slot& slot = shard.slots[slot_index];
+      slot.data = data;
+      slot.unique_id = data->unique_id;
+      return (slot.generation << kGenerationShift) |
+             (shard_index << kShardShift) | slot_index;
+    }
+
+    void Unregister(uint64_t handle) {
+      Shard& shard = shards_[(handle >> kShardShift) & (kNumShards - 1)];
+      uint64_t slot_index = handle & kSlotMask;
+      std::lock_guard<std::mutex> lock(shard.lock);
+      Slot& slot = shard.slots[slot_index];
+      if (slot.generation != handle >> kGenerationShift) {
+        return;
+      }
+      slot.data.reset();
+      // The generations wrap around skipping zero, which marks the handles of
+      // the tensors which never got registered.
+      slot.generation = (slot.generation + 1) & kGenerationMask;
+      if (slot.generation == 0) {
+        slot.generation = 1;
+      }
+      shard.free_slots.push_back(slot_index);
+    }
+
+    // Appends the live tensors as (unique ID, data) pairs.
+    void Snapshot(
+        std::vector<std::pair<int64_t, std::shared_ptr<Data>>>* tensors) {
+      for (auto& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.lock);
+        for (auto& slot : shard.slots) {
+          std::shared_ptr<Data> data = slot.data.lock();
+          if (data != nullptr) {
+            tensors->emplace_back(slot.unique_id, std::move(data));
+          }
+        }
+      }
+    }
+
+   private:
+    static constexpr uint64_t kNumShards = 16;
+    static constexpr uint64_t kShardShift = 32;
+    static constexpr uint64_t kSlotMask = (uint64_t(1) << kShardShift) - 1;
+    static constexpr uint64_t kGenerationShift = 36;
+    static constexpr uint64_t kGenerationMask =
+        (uint64_t(1) << (64 - kGenerationShift)) - 1;
+
+    struct Slot {
+      std::weak_ptr<Data> data;
+      int64_t unique_id = 0;
+      uint64_t generation = 1;
+    };
+
+    struct Shard {
+      std::mutex lock;
+      std::vector<Slot> slots;
+      std::vector<uint64_t> free_slots;
+    };
+
+    static uint64_t GetThreadShard() {
+      static thread_local uint64_t shard =
+          std::hash<std::thread::id>()(std::this_thread::get_id()) %
+          kNumShards;
+      return shard;
+    }
+
+    std::array<Shard, kNumShards> shards_;
+  };
+
   struct DeviceContext {
     std::mutex lock;
-    std::map<int64_t, std::weak_ptr<Data>> tensors_data;
+    LiveTensorRegistry tensors_data;
     uint64_t seed = 101;
     uint64_t running_seed = 101;
+    // The number of random operations issued since the last step (or seed
+    // change), for the counter based RNG.
+    uint64_t rng_offset = 0;
     torch::lazy::Value seed_ir_value;
   };
 
@@ -290,15 +782,15 @@ class XLATensor::DeviceContextArena {
 
   void RegisterTensor(std::shared_ptr<Data> data) {
     DeviceContext* devctx = GetDeviceContext(data->device);
-    std::lock_guard<std::mutex> lock(devctx->lock);
-    devctx->tensors_data.emplace(data->unique_id, data);
+    data->registry_handle = devctx->tensors_data.Register(data);
     XLA_COUNTER("CreateXlaTensor", 1);
   }
 
   void UnregisterTensor(Data* data) {
-    DeviceContext* devctx = GetDeviceContext(data->device);
-    std::lock_guard<std::mutex> lock(devctx->lock);
-    devctx->tensors_data.erase(data->unique_id);
+    if (data->registry_handle != 0) {
+      DeviceContext* devctx = GetDeviceContext(data->device);
+      devctx->tensors_data.Unregister(data->registry_handle);
+    }
     XLA_COUNTER("DestroyXlaTensor", 1);
   }
 
@@ -306,13 +798,18 @@ class XLATensor::DeviceContextArena {
       const torch::lazy::BackendDevice* device) {
     std::vector<XLATensorPtr> tensors;
     auto fn = [&](DeviceContext* devctx) {
-      std::lock_guard<std::mutex> lock(devctx->lock);
-      for (auto& uid_wptr : devctx->tensors_data) {
-        std::shared_ptr<Data> data = uid_wptr.second.lock();
-        if (data != nullptr) {
-          tensors.push_back(
-              c10::make_intrusive<XLATensor>(XLATensor(std::move(data))));
-        }
+      std::vector<std::pair<int64_t, std::shared_ptr<Data>>> tensors_data;
+      devctx->tensors_data.Snapshot(&tensors_data);
+      // The tensors go in creation order, which is the one the graphs of the
+      // live tensors get built, and hashed, with.
+      std::sort(tensors_data.begin(), tensors_data.end(),
+                [](const std::pair<int64_t, std::shared_ptr<Data>>& a,
+                   const std::pair<int64_t, std::shared_ptr<Data>>& b) {
+                  return a.first < b.first;
+                });
+      for (auto& uid_data : tensors_data) {
+        tensors.push_back(c10::make_intrusive<XLATensor>(
+            XLATensor(std::move(uid_data.second))));
       }
     };
     ForAllDeviceContexts(fn, device);
@@ -329,6 +826,18 @@ class XLATensor::DeviceContextArena {
       devctx->seed_ir_value =
           IrValueFromScalar(MakeIntScalar(devctx->seed), kSeedType, device);
     }
+    if (UseCounterBasedRng()) {
+      // Every random operation derives its stream from the step seed (device
+      // data) and its offset within the step, instead of the previous seed,
+      // so the random operations do not depend on each other.
+      static const uint64_t kOffsetMul = 0x9e3779b97f4a7c15;
+      uint64_t offset = kOffsetMul * ++devctx->rng_offset;
+      devctx->running_seed = devctx->seed + offset;
+      torch::lazy::Value offset_value =
+          ScalarOp(MakeIntScalar(static_cast<int64_t>(offset)),
+                   MakeXlaPrimitiveType(kSeedType, &device));
+      return devctx->seed_ir_value + offset_value;
+    }
     // Keep the running seed as scalar as well, so we can return it directly
     // without executing graphs.
     devctx->running_seed = kSeedAdd + kSeedMul * devctx->running_seed;
@@ -353,6 +862,7 @@ class XLATensor::DeviceContextArena {
     std::lock_guard<std::mutex> lock(devctx->lock);
     devctx->seed = seed;
     devctx->running_seed = devctx->seed;
+    devctx->rng_offset = 0;
     devctx->seed_ir_value = torch::lazy::Value();
   }
 
@@ -361,13 +871,14 @@ class XLATensor::DeviceContextArena {
     std::lock_guard<std::mutex> lock(devctx->lock);
     devctx->seed = 1012031 + devctx->seed * 7012063;
     devctx->running_seed = devctx->seed;
+    devctx->rng_offset = 0;
     devctx->seed_ir_value = torch::lazy::Value();
   }
 
  private:
   std::vector<DeviceContext*> GetAllDeviceContexts() {
     std::vector<DeviceContext*> all_device_contexts;
-    std::lock_guard<std::mutex> lock(lock_);
+    std::shared_lock<std::shared_timed_mutex> lock(lock_);
     all_device_contexts.reserve(device_contexts_.size());
     for (auto& device_contexts : device_contexts_) {
       all_device_contexts.push_back(device_contexts.second);
@@ -387,7 +898,14 @@ class XLATensor::DeviceContextArena {
   }
 
   DeviceContext* GetDeviceContext(const torch::lazy::BackendDevice& device) {
-    std::lock_guard<std::mutex> lock(lock_);
+    {
+      std::shared_lock<std::shared_timed_mutex> lock(lock_);
+      auto it = device_contexts_.find(device);
+      if (it != device_contexts_.end()) {
+        return it->second;
+      }
+    }
+    std::lock_guard<std::shared_timed_mutex> lock(lock_);
     auto it = device_contexts_.find(device);
     if (it == device_contexts_.end()) {
       it = device_contexts_.emplace(device, new DeviceContext()).first;
@@ -395,18 +913,32 @@ class XLATensor::DeviceContextArena {
     return it->second;
   }
 
-  std::mutex lock_;
+  std::shared_timed_mutex lock_;
   std::map<torch::lazy::BackendDevice, DeviceContext*> device_contexts_;
 };
 
 struct DeviceDataInfo : public xla::ComputationClient::Data::Info {
-  DeviceDataInfo(int64_t tensor_id, bool read_only)
-      : tensor_id(tensor_id), read_only(read_only) {}
+  DeviceDataInfo(int64_t tensor_id, bool read_only, bool shared = false)
+      : tensor_id(tensor_id), read_only(read_only || shared), shared(shared) {}
 
   int64_t tensor_id = 0;
   bool read_only = false;
+  // Whether the data is the device data of more than one tensor. The shared
+  // data stays read only even once the tensor owning the info changes, so
+  // that the first write to any of the sharing tensors goes to a new buffer.
+  bool shared = false;
 };
 
+namespace {
+
+bool ShareClonedData() {
+  static const bool share_cloned_data =
+      xla::sys_util::GetEnvBool("XLA_SHARE_CLONED_DATA", true);
+  return share_cloned_data;
+}
+
+}  // namespace
+
 XLATensor::Data::~Data() { DeviceContextArena::Get()->UnregisterTensor(this); }
 
 XLATensor::Async::Async(
@@ -447,6 +979,9 @@ void XLATensor::Async::Wait() {
 XLATensorPtr XLATensor::Create(const at::Tensor& tensor,
                                const torch::lazy::BackendDevice& device) {
   XLA_CHECK_EQ(tensor.device().type(), at::kCPU);
+  // The first host tensors (like the model parameters) get moved to the device
+  // before any graph gets traced, which is when the warm start preload begins.
+  WarmStart::Get();
   XLATensorPtr xtensor =
       c10::make_intrusive<XLATensor>(XLATensor(tensor, device));
   DeviceContextArena::Get()->RegisterTensor(xtensor->data_ptr());
@@ -474,9 +1009,12 @@ XLATensorPtr XLATensor::Create(
   XLATensorPtr xtensor = c10::make_intrusive<XLATensor>(
       XLATensor(std::move(ir_value), device, logical_element_type));
   DeviceContextArena::Get()->RegisterTensor(xtensor->data_ptr());
+  xtensor->RecordSpeculativeValue();
   if (UseEagerDebugMode()) {
     std::vector<XLATensorPtr> xtensors({xtensor});
     ApplyEagerSync(xtensors);
+  } else if (UseEagerMode()) {
+    ApplyEagerMicroGraph(device);
   }
   return xtensor;
 }
@@ -492,26 +1030,28 @@ XLATensorPtr XLATensor::Create(
 
 XLATensor::XLATensor(const at::Tensor& tensor,
                      const torch::lazy::BackendDevice& device)
-    : data_(std::make_shared<Data>(tensor, device)) {}
+    : data_(host_pool::MakeShared<Data>(tensor, device)) {}
 
 XLATensor::XLATensor(torch::lazy::BackendDataPtr xla_data,
                      c10::optional<at::ScalarType> logical_element_type)
-    : data_(std::make_shared<Data>(xla_data, xla_data->device(),
-                                   logical_element_type)) {}
+    : data_(host_pool::MakeShared<Data>(xla_data, xla_data->device(),
+                                        logical_element_type)) {
+  TrackTensorData(data()->xla_data, GetUniqueId());
+}
 
 XLATensor::XLATensor(torch::lazy::Value ir_value,
                      const torch::lazy::BackendDevice& device,
                      c10::optional<at::ScalarType> logical_element_type)
-    : data_(std::make_shared<Data>(std::move(ir_value), device,
-                                   logical_element_type)) {
+    : data_(host_pool::MakeShared<Data>(std::move(ir_value), device,
+                                        logical_element_type)) {
   TryLimitGraphSize();
 }
 
 XLATensor::XLATensor(std::shared_ptr<View> view,
                      const torch::lazy::BackendDevice& device,
                      c10::optional<at::ScalarType> logical_element_type)
-    : data_(std::make_shared<Data>(std::move(view), device,
-                                   logical_element_type)) {}
+    : data_(host_pool::MakeShared<Data>(std::move(view), device,
+                                        logical_element_type)) {}
 
 XLATensor::XLATensor(std::shared_ptr<Data> data) : data_(std::move(data)) {}
 
@@ -604,7 +1144,13 @@ torch::lazy::BackendDataPtr XLATensor::GetXlaData() {
     ApplyPendingGraph();
   } else {
     XLA_CHECK(data()->tensor_data);
-    data()->xla_data = TensorToXlaData(*data()->tensor_data, GetDevice());
+    const xla::OpSharding* sharding = GetUploadSharding();
+    data()->xla_data =
+        sharding != nullptr
+            ? CreateTensorsData({*data()->tensor_data}, {sharding},
+                                {GetDevice().toString()})
+                  .front()
+            : TensorToXlaData(*data()->tensor_data, GetDevice());
   }
   return data()->xla_data;
 }
@@ -626,6 +1172,13 @@ std::string XLATensor::DumpHloComputation(
                             : std::string();
 }
 
+const xla::OpSharding* XLATensor::GetUploadSharding() const {
+  if (!ShardingUtil::UseSpmd() || data()->sharding_spec == nullptr) {
+    return nullptr;
+  }
+  return &data()->sharding_spec->sharding;
+}
+
 std::shared_ptr<XLATensor::ShardingSpec> XLATensor::sharding_spec() const {
   XLA_CHECK(data()->sharding_spec != nullptr)
       << "Trying to access a null cursor";
@@ -639,6 +1192,36 @@ void XLATensor::SetShardingSpec(const xla::OpSharding& sharding,
   auto new_sharding_spec =
       std::make_shared<ShardingSpec>(sharding, replicated, manual);
   data()->sharding_spec = new_sharding_spec;
+  if (ShardingUtil::UseSpmd() &&
+      (data()->ir_value.node == nullptr ||
+       DeviceData::Cast(data()->ir_value.node.get()) != nullptr)) {
+    // The IR node of a device data tensor is re-created from the placed data
+    // when needed, so that the graphs get it as a sharded parameter.
+    AssignIrValue(torch::lazy::Value());
+    c10::optional<at::Tensor> tensor_data = CurrentTensorData();
+    torch::lazy::BackendDataPtr xla_data = CurrentXlaData();
+    if (tensor_data) {
+      // The host data gets sliced and uploaded one shard per device, right
+      // away if it was already on device, otherwise when first needed.
+      if (xla_data != nullptr) {
+        data()->xla_data = CreateTensorsData({*tensor_data}, {&sharding},
+                                             {GetDevice().toString()})
+                               .front();
+      }
+    } else {
+      XLA_CHECK(xla_data != nullptr) << "Trying to access a null cursor";
+      const ShardedData* sharded =
+          dynamic_cast<const ShardedData*>(UnwrapXlaData(xla_data).get());
+      // The data placed with the same sharding, like the restored sharded
+      // checkpoints, stays where it is.
+      if (sharded == nullptr ||
+          !xla::protobuf_util::ProtobufEquals(sharded->sharding(), sharding)) {
+        SetXlaData(WrapXlaData(
+            ShardingUtil::ReshardData(UnwrapXlaData(xla_data), sharding)));
+      }
+    }
+    return;
+  }
   XLA_CHECK(data()->ir_value.node != nullptr)
       << "Tyring to access a null cursor";
   dynamic_cast<XlaNode*>(data()->ir_value.node.get())
@@ -656,6 +1239,8 @@ void XLATensor::SetXlaData(torch::lazy::BackendDataPtr xla_data) {
 }
 
 void XLATensor::SetXlaData(torch::lazy::BackendDataPtr xla_data, bool sync) {
+  TrackTensorData(xla_data, GetUniqueId());
+  EraseHostMirror(data()->xla_data);
   data()->xla_data = std::move(xla_data);
   // Assigning a device data should always clear the IR node, to allow graph
   // trimming. A view cannot be reset though, unless we are at a step-end
@@ -683,9 +1268,12 @@ void XLATensor::SetIrValue(torch::lazy::Value ir_value, bool inplace) {
     AssignIrValue(std::move(ir_value));
     TryLimitGraphSize();
   }
+  RecordSpeculativeValue();
   if (UseEagerDebugMode() && ShouldSyncIrNode()) {
     std::vector<XLATensorPtr> xtensors({c10::make_intrusive<XLATensor>(*this)});
     ApplyEagerSync(xtensors);
+  } else if (UseEagerMode() && ShouldSyncIrNode()) {
+    ApplyEagerMicroGraph(GetDevice());
   }
 }
 
@@ -693,11 +1281,21 @@ void XLATensor::SetInPlaceIrValue(torch::lazy::Value ir_value) {
   auto xla_shape = shape();
   if (xla_shape.get().element_type() != GetXlaShape(ir_value).element_type()) {
     ir_value =
-        torch::lazy::MakeNode<Cast>(ir_value, xla_shape.get().element_type());
+        MakeXlaNode<Cast>(ir_value, xla_shape.get().element_type());
   }
   SetIrValue(std::move(ir_value), /*inplace=*/true);
 }
 
+void XLATensor::RecordSpeculativeValue() const {
+  static SpeculativeSync* speculative_sync = SpeculativeSync::Get();
+  // The in-place updates of the views are left out, as their IR values only
+  // get built on access.
+  if (speculative_sync != nullptr && data()->ir_value) {
+    speculative_sync->RecordValue(data()->ir_value.hash(),
+                                  PreloadCachedCompile);
+  }
+}
+
 void XLATensor::AssignIrValue(torch::lazy::Value ir_value) const {
   data()->ir_value = std::move(ir_value);
   data()->generation += 1;
@@ -708,16 +1306,90 @@ void XLATensor::TryLimitGraphSize() {
       xla::sys_util::GetEnvInt("XLA_TRIM_GRAPH_CHECK_FREQUENCY", 5000);
   static const size_t kMaxPendingGraphSize =
       xla::sys_util::GetEnvInt("XLA_TRIM_GRAPH_SIZE", 100000);
-  if (data()->ir_value && ++g_tls_data.trim_counter % kCheckFrequency == 0) {
+  static const int64_t kMaxTrimDeferral =
+      xla::sys_util::GetEnvInt("XLA_TRIM_GRAPH_MAX_DEFERRAL", 0);
+  if (!data()->ir_value) {
+    return;
+  }
+  ++g_tls_data.trim_counter;
+  if (g_tls_data.trim_deferred >= 0) {
+    // Wait for the first IR value emitted outside of the scope (usually a
+    // model layer, see ScopePusher) which was active when the graph size limit
+    // got crossed, so that the cut points are stable across steps.
+    if (data()->ir_value->metadata().scope != g_tls_data.trim_scope ||
+        ++g_tls_data.trim_deferred > kMaxTrimDeferral) {
+      TrimGraph();
+    }
+    return;
+  }
+  if (g_tls_data.trim_counter % kCheckFrequency == 0) {
+    ReleaseDeadIr(GetDevice());
     size_t graph_size =
         torch::lazy::Util::GetGraphSize({data()->ir_value.node.get()});
     if (graph_size > kMaxPendingGraphSize) {
-      XLA_COUNTER("TrimIrGraph", 1);
-      ApplyPendingGraph();
+      if (kMaxTrimDeferral > 0) {
+        g_tls_data.trim_deferred = 0;
+        g_tls_data.trim_scope = data()->ir_value->metadata().scope;
+      } else {
+        TrimGraph();
+      }
     }
   }
 }
 
+void XLATensor::ReleaseDeadIr(const torch::lazy::BackendDevice& device) {
+  static const bool release_dead_ir =
+      xla::sys_util::GetEnvBool("XLA_RELEASE_DEAD_IR", true);
+  if (!release_dead_ir) {
+    return;
+  }
+  size_t released_views = 0;
+  for (auto& tensor : GetLiveTensors(&device)) {
+    if (tensor->ReleaseDeadView()) {
+      ++released_views;
+    }
+  }
+  if (released_views > 0) {
+    XLA_COUNTER("ReleasedDeadIrViews", released_views);
+  }
+}
+
+bool XLATensor::ReleaseDeadView() {
+  std::shared_ptr<View>& view = data()->view;
+  if (view == nullptr || view.use_count() > 1 ||
+      view->alias().use_count() > 1) {
+    return false;
+  }
+  if (data()->xla_data != nullptr && view->IsUpToDate()) {
+    // The view value has already been materialized.
+    view = nullptr;
+    AssignIrValue(torch::lazy::Value());
+  } else {
+    torch::lazy::Value ir_value = GetViewUpdate(view).ir_value;
+    view = nullptr;
+    AssignIrValue(std::move(ir_value));
+  }
+  return true;
+}
+
+void XLATensor::TrimGraph() {
+  static const bool kTrimLiveTensors =
+      xla::sys_util::GetEnvBool("XLA_TRIM_GRAPH_LIVE_TENSORS", false);
+  XLA_COUNTER("TrimIrGraph", 1);
+  g_tls_data.trim_deferred = -1;
+  g_tls_data.trim_scope.clear();
+  if (kTrimLiveTensors) {
+    // Cutting all the live tensors makes the resulting graphs independent of
+    // which tensor happened to cross the size limit.
+    torch::lazy::BackendDevice device = GetDevice();
+    std::vector<XLATensorPtr> tensors = GetLiveTensors(&device);
+    tensors.push_back(c10::make_intrusive<XLATensor>(*this));
+    SyncTensorsGraph(&tensors, {}, /*wait=*/false, /*sync_xla_data=*/true);
+  } else {
+    ApplyPendingGraph();
+  }
+}
+
 torch::lazy::Value XLATensor::GetIrValue() const {
   torch::lazy::Value ir_value = CurrentIrValue();
   if (ir_value) {
@@ -736,6 +1408,14 @@ torch::lazy::Value XLATensor::GetIrValue() const {
   }
   c10::optional<at::Tensor> tensor_data = CurrentTensorData();
   XLA_CHECK(tensor_data);
+  const xla::OpSharding* sharding = GetUploadSharding();
+  if (sharding != nullptr) {
+    data()->xla_data = CreateTensorsData({*tensor_data}, {sharding},
+                                         {GetDevice().toString()})
+                           .front();
+    AssignIrValue(CreateTensorNode(data()->xla_data, /*read_only=*/false));
+    return data()->ir_value;
+  }
   AssignIrValue(GetIrValueForTensor(*tensor_data, GetDevice()));
   return data()->ir_value;
 }
@@ -771,8 +1451,15 @@ torch::lazy::Value XLATensor::GetIrValueForTensor(
     data = GetDeviceData(tensor, device);
     read_only = true;
   } else {
-    XLA_TIMED("IrValueTensorToXlaData");
-    data = TensorToXlaData(tensor, device);
+    // Cached constants are shared among tensors, so they must be read only to
+    // never get aliased (and overwritten) by an in-place update.
+    data = GetConstantDeviceData(tensor, device);
+    if (data != nullptr) {
+      read_only = true;
+    } else {
+      XLA_TIMED("IrValueTensorToXlaData");
+      data = TensorToXlaData(tensor, device);
+    }
   }
   return CreateTensorNode(std::move(data), read_only);
 }
@@ -785,7 +1472,7 @@ torch::lazy::Value XLATensor::GetDeviceDataIrValue(
   // TODO: consider using upstream info class if possible
   UnwrapXlaData(data)->SetInfo(
       std::make_shared<DeviceDataInfo>(/*tensor_id=*/-1, /*read_only=*/true));
-  return torch::lazy::MakeNode<DeviceData>(std::move(data));
+  return MakeXlaNode<DeviceData>(std::move(data));
 }
 
 torch::lazy::Value XLATensor::GetIrValueForConstant(const at::Scalar& value,
@@ -793,12 +1480,32 @@ torch::lazy::Value XLATensor::GetIrValueForConstant(const at::Scalar& value,
   torch::lazy::Value ir_value =
       ScalarOp(std::move(value), shape.element_type());
   if (!shape.dimensions().empty()) {
-    ir_value = torch::lazy::MakeNode<Expand>(
+    ir_value = MakeXlaNode<Expand>(
         ir_value, torch::lazy::ToVector<int64_t>(shape.dimensions()));
   }
   return ir_value;
 }
 
+torch::lazy::Value XLATensor::GetIrValueForLiteral(
+    xla::Literal literal, const torch::lazy::BackendDevice& device) {
+  static const int64_t kMaxEmbeddedBytes =
+      xla::sys_util::GetEnvInt("XLA_CONSTANT_HOIST_BYTES", 4096);
+  xla::PrimitiveType type = literal.shape().element_type();
+  at::ScalarType scalar_type = TensorTypeFromXlaType(type);
+  // The literals whose type does not survive the tensor to device data
+  // conversion (like the F32 ones under XLA_USE_BF16) stay embedded.
+  if (kMaxEmbeddedBytes < 0 || literal.size_bytes() <= kMaxEmbeddedBytes ||
+      MakeXlaPrimitiveType(scalar_type, &device) != type) {
+    return ConstantOp(std::move(literal));
+  }
+  XLA_COUNTER("HoistedConstants", 1);
+  torch::lazy::BackendDataPtr data =
+      GetDeviceData(MakeTensorFromXlaLiteral(literal, scalar_type), device);
+  UnwrapXlaData(data)->SetInfo(
+      std::make_shared<DeviceDataInfo>(/*tensor_id=*/-1, /*read_only=*/true));
+  return MakeXlaNode<DeviceData>(std::move(data));
+}
+
 torch::lazy::Value XLATensor::GetIrValueForScalar(
     const at::Scalar& value, xla::PrimitiveType type,
     const torch::lazy::BackendDevice& device) {
@@ -820,7 +1527,7 @@ torch::lazy::Value XLATensor::GetIrValueForScalar(
     const torch::lazy::BackendDevice& device) {
   torch::lazy::Value ir_value = GetIrValueForScalar(value, type, device);
   if (!dimensions.empty()) {
-    ir_value = torch::lazy::MakeNode<Expand>(
+    ir_value = MakeXlaNode<Expand>(
         ir_value, torch::lazy::ToVector<int64_t>(dimensions));
   }
   return ir_value;
@@ -881,9 +1588,9 @@ void XLATensor::ModifyCurrentView(ViewInfo view_info) const {
   // This node is not a view. Since this function is meant to modify a view
   // in place, we need to turn this existing tensor into a view.
   torch::lazy::Value ir_value = GetIrValue();
-  std::shared_ptr<Alias> alias = std::make_shared<Alias>(ir_value);
-  data()->view =
-      std::make_shared<View>(view_info.shape, alias, std::move(view_info));
+  std::shared_ptr<Alias> alias = host_pool::MakeShared<Alias>(ir_value);
+  data()->view = host_pool::MakeShared<View>(view_info.shape, alias,
+                                             std::move(view_info));
   AssignIrValue(torch::lazy::Value());
 }
 
@@ -895,13 +1602,13 @@ std::shared_ptr<View> XLATensor::CreateView(ViewInfo view_info) const {
   // becoming one itself. This means creating an alias with the current IR
   // XlaNode, and using the same alias for the created IR XlaNode.
   torch::lazy::Value ir_value = GetIrValue();
-  std::shared_ptr<Alias> alias = std::make_shared<Alias>(ir_value);
+  std::shared_ptr<Alias> alias = host_pool::MakeShared<Alias>(ir_value);
   ViewInfo this_view_info(ViewInfo::Type::kNoOp, GetXlaShape(ir_value),
                           GetXlaShape(ir_value));
-  data()->view = std::make_shared<View>(GetXlaShape(ir_value), alias,
-                                        std::move(this_view_info));
+  data()->view = host_pool::MakeShared<View>(GetXlaShape(ir_value), alias,
+                                             std::move(this_view_info));
   AssignIrValue(torch::lazy::Value());
-  return std::make_shared<View>(view_info.shape, alias, view_info);
+  return host_pool::MakeShared<View>(view_info.shape, alias, view_info);
 }
 
 XLATensorPtr XLATensor::CreateViewTensor(ViewInfo view_info) const {
@@ -913,11 +1620,27 @@ at::Tensor XLATensor::ToTensor(bool detached) {
   at::Tensor tensor;
   c10::optional<at::Tensor> tensor_data = CurrentTensorData();
   if (!tensor_data) {
-    DeviceBarrier(GetDevice());
-    // The GetXlaData() call will trigger an ApplyPendingGraph() if an IR
-    // XlaNode is available on the tensor.
-    std::vector<at::Tensor> tensors = XlaDataToTensors({GetXlaData()}, dtype());
-    tensor = std::move(tensors.front());
+    torch::lazy::BackendDataPtr xla_data = CurrentXlaData();
+    bool materialized = xla_data != nullptr && data()->view == nullptr;
+    c10::optional<at::Tensor> mirror =
+        materialized ? GetHostMirror(xla_data, dtype()) : c10::nullopt;
+    if (mirror) {
+      tensor = std::move(*mirror);
+    } else {
+      if (materialized) {
+        WaitForData(*UnwrapXlaData(xla_data));
+      } else {
+        DeviceBarrier(GetDevice());
+      }
+      // The GetXlaData() call will trigger an ApplyPendingGraph() if an IR
+      // XlaNode is available on the tensor.
+      std::vector<at::Tensor> tensors =
+          XlaDataToTensors({GetXlaData()}, dtype());
+      tensor = std::move(tensors.front());
+      if (materialized) {
+        AddHostMirror(xla_data, tensor);
+      }
+    }
     if (!detached) {
       SetTensorData(tensor);
     }
@@ -1001,21 +1724,24 @@ std::vector<torch::lazy::BackendDataPtr> XLATensor::GatherTensorsXlaData(
     absl::Span<const torch::lazy::BackendDataPtr> tensors_data) {
   std::vector<torch::lazy::BackendDataPtr> result_tensors_data;
   std::unordered_map<int64_t, size_t> uid_index_map;
-  size_t indices_index = 0;
+  // The indices are not sorted when the roots are in canonical order.
+  std::unordered_map<size_t, size_t> index_positions;
+  for (size_t i = 0; i < indices.size(); ++i) {
+    index_positions.emplace(indices[i], i);
+  }
   for (size_t i = 0; i < tensors.size(); ++i) {
     int64_t tensor_id = tensors[i]->GetUniqueId();
     auto it = uid_index_map.find(tensor_id);
+    auto position_it = index_positions.find(i);
     if (it != uid_index_map.end()) {
       // Current tensor is a duplicate of a previously processed tensor that
       // had an IR XlaNode to sync. Get the XLA data from the tensor_data_map.
       result_tensors_data.push_back(result_tensors_data[it->second]);
-    } else if (indices_index < indices.size() && i == indices[indices_index]) {
-      // If we are at the current index (it means that the tensor at index
-      // 'i' had an IR node to sync), use the XLA data held within the Async
-      // object.
+    } else if (position_it != index_positions.end()) {
+      // If we are at a sync index (it means that the tensor at index 'i' had
+      // an IR node to sync), use the XLA data held within the Async object.
       uid_index_map.emplace(tensor_id, result_tensors_data.size());
-      result_tensors_data.push_back(tensors_data[indices_index]);
-      ++indices_index;
+      result_tensors_data.push_back(tensors_data[position_it->second]);
     } else if (!tensors[i]->CurrentTensorData()) {
       torch::lazy::BackendDataPtr xla_data = tensors[i]->CurrentXlaData();
       XLA_CHECK(xla_data != nullptr);
@@ -1036,6 +1762,7 @@ void XLATensor::TensorCollectionBarrier(SyncTensorCollection* coll) {
              << " ...";
   {
     XLA_TIMED("DeviceLockWait");
+    XLA_STEP_PHASE(kDeviceWait);
     coll->unlocker = LockDevices({coll->device});
   }
   TF_VLOG(4) << "Waiting on device barrier for device " << coll->device
@@ -1065,7 +1792,7 @@ std::vector<at::Tensor> XLATensor::GetTensorsOpByOp(
       xla::ComputationClient::Get()->TransferFromServer(
           UnwrapXlaData(tensors_data));
 
-  return FetchTensors(tensors, literals, &coll.indices);
+  return FetchTensors(tensors, absl::MakeSpan(literals), &coll.indices);
 }
 
 std::vector<at::Tensor> XLATensor::GetTensors(
@@ -1079,50 +1806,323 @@ std::vector<at::Tensor> XLATensor::GetTensors(
 
 std::vector<at::Tensor> XLATensor::GetTensorsFused(
     std::vector<XLATensorPtr>* tensors) {
+  static const int64_t concat_max_bytes =
+      xla::sys_util::GetEnvInt("XLA_FETCH_CONCAT_MAX_BYTES", 0);
+  if (concat_max_bytes > 0) {
+    return GetTensorsConcatenated(tensors, concat_max_bytes);
+  }
+  return GetTensorsMultiDevice(tensors, absl::Span<at::Tensor>());
+}
+
+std::vector<at::Tensor> XLATensor::GetTensorsMultiDevice(
+    std::vector<XLATensorPtr>* tensors, absl::Span<at::Tensor> dest) {
+  // The tensors are grouped by device, keeping their relative order.
+  std::map<std::string, std::vector<size_t>> device_indices;
+  for (size_t i = 0; i < tensors->size(); ++i) {
+    device_indices[(*tensors)[i]->GetDevice().toString()].push_back(i);
+  }
   SyncTensorsConfig config;
   config.force_xla_data = false;
-  auto async = SyncTensorsGraphInternal(tensors, {}, config);
-  if (async != nullptr) {
-    async->mwait.Wait();
+  config.fetch = true;
+  // The graphs of all the devices get scheduled before waiting for any of
+  // them, so that they run concurrently.
+  std::vector<std::vector<XLATensorPtr>> device_tensors;
+  std::vector<std::shared_ptr<Async>> asyncs;
+  std::vector<XLATensorPtr> ordered_tensors;
+  std::vector<size_t> ordered_positions;
+  ordered_tensors.reserve(tensors->size());
+  for (auto& device_and_indices : device_indices) {
+    std::vector<XLATensorPtr> group_tensors;
+    for (auto i : device_and_indices.second) {
+      group_tensors.push_back((*tensors)[i]);
+      ordered_tensors.push_back((*tensors)[i]);
+      ordered_positions.push_back(i);
+    }
+    asyncs.push_back(SyncTensorsGraphInternal(&group_tensors, {}, config));
+    device_tensors.push_back(std::move(group_tensors));
+  }
+  // The device data of all the devices is read back with a single transfer,
+  // and converted all at once.
+  std::vector<torch::lazy::BackendDataPtr> tensors_data;
+  std::vector<size_t> sync_indices;
+  size_t offset = 0;
+  for (size_t k = 0; k < device_tensors.size(); ++k) {
+    const std::shared_ptr<Async>& async = asyncs[k];
+    if (async != nullptr) {
+      XLA_STEP_PHASE(kDeviceWait);
+      async->mwait.Wait();
+      for (auto index : async->indices) {
+        sync_indices.push_back(offset + index);
+      }
+    }
+    std::vector<torch::lazy::BackendDataPtr> device_tensors_data =
+        GatherTensorsXlaData(
+            device_tensors[k],
+            async != nullptr ? async->indices : absl::Span<const size_t>(),
+            async != nullptr ? async->tensors_data
+                             : absl::Span<const torch::lazy::BackendDataPtr>());
+    tensors_data.insert(tensors_data.end(), device_tensors_data.begin(),
+                        device_tensors_data.end());
+    offset += device_tensors[k].size();
+  }
+  if (device_indices.size() > 1) {
+    XLA_COUNTER("MultiDeviceFetches", 1);
+  }
+  WaitForTensorsData(tensors_data);
+  XLA_STEP_PHASE(kDownload);
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::Get()->TransferFromServer(
+          UnwrapXlaData(tensors_data));
+  std::vector<at::Tensor> ordered_dest;
+  if (!dest.empty()) {
+    ordered_dest.reserve(dest.size());
+    for (auto i : ordered_positions) {
+      ordered_dest.push_back(dest[i]);
+    }
+  }
+  std::vector<at::Tensor> ordered_results =
+      FetchTensors(&ordered_tensors, absl::MakeSpan(literals), &sync_indices,
+                   absl::MakeSpan(ordered_dest));
+  std::vector<at::Tensor> results(tensors->size());
+  for (size_t i = 0; i < ordered_results.size(); ++i) {
+    results[ordered_positions[i]] = std::move(ordered_results[i]);
+  }
+  return results;
+}
+
+std::vector<at::Tensor> XLATensor::GetTensorsConcatenated(
+    std::vector<XLATensorPtr>* tensors, int64_t max_bytes) {
+  // The small tensors with a pending graph or device data, which are not
+  // sharded, are grouped by device and element type.
+  std::map<std::pair<std::string, at::ScalarType>, std::vector<size_t>> groups;
+  for (size_t i = 0; i < tensors->size(); ++i) {
+    const XLATensorPtr& tensor = (*tensors)[i];
+    if (tensor->CurrentTensorData() || tensor->sharding_spec() != nullptr) {
+      continue;
+    }
+    if (xla::ShapeUtil::ByteSizeOf(tensor->shape().get()) <= max_bytes) {
+      groups[std::make_pair(tensor->GetDevice().toString(), tensor->dtype())]
+          .push_back(i);
+    }
+  }
+  // Every group of two or more tensors gets fetched as a single flat tensor,
+  // concatenated on the device, followed by the tensors left alone.
+  std::vector<XLATensorPtr> fetch_tensors;
+  std::vector<std::vector<size_t>> concat_groups;
+  std::vector<bool> concatenated(tensors->size(), false);
+  for (auto& group : groups) {
+    if (group.second.size() < 2) {
+      continue;
+    }
+    std::vector<XLATensorPtr> flat_tensors;
+    flat_tensors.reserve(group.second.size());
+    for (auto i : group.second) {
+      int64_t numel = xla::ShapeUtil::ElementsIn((*tensors)[i]->shape().get());
+      flat_tensors.push_back(view((*tensors)[i], {numel}));
+      concatenated[i] = true;
+    }
+    fetch_tensors.push_back(cat(flat_tensors, 0, group.first.second));
+    concat_groups.push_back(group.second);
+  }
+  if (concat_groups.empty()) {
+    return GetTensorsMultiDevice(tensors, absl::Span<at::Tensor>());
+  }
+  XLA_COUNTER("ConcatenatedFetchTensors", fetch_tensors.size());
+  std::vector<size_t> other_indices;
+  for (size_t i = 0; i < tensors->size(); ++i) {
+    if (!concatenated[i]) {
+      other_indices.push_back(i);
+      fetch_tensors.push_back((*tensors)[i]);
+    }
+  }
+  std::vector<at::Tensor> fetched =
+      GetTensorsMultiDevice(&fetch_tensors, absl::Span<at::Tensor>());
+  // The host tensors of the concatenated ones are views within the fetched
+  // flat tensor.
+  std::vector<at::Tensor> results(tensors->size());
+  for (size_t k = 0; k < concat_groups.size(); ++k) {
+    int64_t offset = 0;
+    for (auto i : concat_groups[k]) {
+      std::vector<int64_t> sizes = torch::lazy::ToVector<int64_t>(
+          (*tensors)[i]->shape().get().dimensions());
+      int64_t numel = xla::ShapeUtil::ElementsIn((*tensors)[i]->shape().get());
+      results[i] = fetched[k].narrow(0, offset, numel).view(sizes);
+      offset += numel;
+    }
+  }
+  for (size_t k = 0; k < other_indices.size(); ++k) {
+    results[other_indices[k]] = std::move(fetched[concat_groups.size() + k]);
   }
+  return results;
+}
+
+void XLATensor::GetTensorsInto(std::vector<XLATensorPtr>* tensors,
+                               absl::Span<at::Tensor> dest) {
+  XLA_CHECK_EQ(tensors->size(), dest.size());
+  TF_VLOG(4) << "Copying the value of " << tensors->size()
+             << " tensor(s) into CPU tensors";
+  GetTensorsMultiDevice(tensors, dest);
+}
+
+std::vector<at::Tensor> XLATensor::AsyncFetch::Wait() { return tensors.Get(); }
+
+std::shared_ptr<XLATensor::AsyncFetch> XLATensor::GetTensorsAsync(
+    std::vector<XLATensorPtr>* tensors) {
+  TF_VLOG(4) << "Fetching asynchronously the value of " << tensors->size()
+             << " tensor(s)";
+  SyncTensorsConfig config;
+  config.force_xla_data = false;
+  config.fetch = true;
+  std::shared_ptr<Async> async = SyncTensorsGraphInternal(tensors, {}, config);
+  // Everything the fetch reads of the tensors gets captured now, as they could
+  // be updated in place before the background fetch runs.
   std::vector<torch::lazy::BackendDataPtr> tensors_data = GatherTensorsXlaData(
       *tensors, async != nullptr ? async->indices : absl::Span<const size_t>(),
       async != nullptr ? async->tensors_data
                        : absl::Span<const torch::lazy::BackendDataPtr>());
-  std::vector<xla::Literal> literals =
-      xla::ComputationClient::Get()->TransferFromServer(
-          UnwrapXlaData(tensors_data));
-  return FetchTensors(tensors, literals,
-                      async != nullptr ? &async->indices : nullptr);
+  FetchSnapshot snapshot =
+      TakeFetchSnapshot(*tensors, async != nullptr ? &async->indices : nullptr);
+  auto fetch = std::make_shared<AsyncFetch>();
+  auto fetchfn = [tensors_data = std::move(tensors_data),
+                  snapshot = std::move(snapshot)]() {
+    XLA_TIMED("AsyncFetchTensors");
+    WaitForTensorsData(tensors_data);
+    std::vector<xla::Literal> literals =
+        xla::ComputationClient::Get()->TransferFromServer(
+            UnwrapXlaData(tensors_data));
+    return FetchTensors(snapshot, absl::MakeSpan(literals));
+  };
+  // The download is chained to the execution, rather than parking an IO
+  // thread waiting for it. It blocks, so it runs on the IO thread pool rather
+  // than on the thread completing the execution. A failed execution fails the
+  // fetch.
+  if (async != nullptr) {
+    fetch->tensors = async->GetFuture().ThenIo(
+        [fetchfn = std::move(fetchfn)](int) { return fetchfn(); });
+  } else {
+    fetch->tensors = xla::util::ScheduleIoFuture(std::move(fetchfn));
+  }
+  return fetch;
+}
+
+void XLATensor::OffloadTensors(std::vector<XLATensorPtr>* tensors) {
+  std::vector<XLATensorPtr> fetch_tensors;
+  for (auto& tensor : *tensors) {
+    c10::optional<at::Tensor> tensor_data = tensor->CurrentTensorData();
+    if (tensor_data) {
+      tensor->OffloadXlaData(std::move(*tensor_data));
+    } else {
+      fetch_tensors.push_back(tensor);
+    }
+  }
+  if (!fetch_tensors.empty()) {
+    std::vector<at::Tensor> values = GetTensors(&fetch_tensors);
+    for (size_t i = 0; i < fetch_tensors.size(); ++i) {
+      fetch_tensors[i]->OffloadXlaData(std::move(values[i]));
+    }
+  }
+  XLA_COUNTER("OffloadedTensors", tensors->size());
+}
+
+void XLATensor::OffloadXlaData(at::Tensor tensor_data) {
+  // Not a sync, so the views of the tensor are kept, and their aliases keep
+  // tracking the base tensor.
+  SetXlaData(nullptr, /*sync=*/false);
+  SetTensorData(std::move(tensor_data));
+}
+
+void XLATensor::PrefetchTensors(absl::Span<const XLATensorPtr> tensors) {
+  std::vector<XLATensorPtr> upload_tensors;
+  std::vector<at::Tensor> values;
+  std::vector<std::string> devices;
+  for (auto& tensor : tensors) {
+    if (tensor->CurrentXlaData() != nullptr || tensor->CurrentIrValue()) {
+      continue;
+    }
+    c10::optional<at::Tensor> tensor_data = tensor->CurrentTensorData();
+    if (!tensor_data) {
+      continue;
+    }
+    const xla::OpSharding* sharding = tensor->GetUploadSharding();
+    if (sharding != nullptr) {
+      // The sharded uploads have no asynchronous path.
+      tensor->SetXlaData(CreateTensorsData({*tensor_data}, {sharding},
+                                           {tensor->GetDevice().toString()})
+                             .front(),
+                         /*sync=*/false);
+      continue;
+    }
+    upload_tensors.push_back(tensor);
+    values.push_back(*tensor_data);
+    devices.push_back(tensor->GetDevice().toString());
+  }
+  if (!upload_tensors.empty()) {
+    std::vector<torch::lazy::BackendDataPtr> tensors_data =
+        CreateTensorsData(values, devices, /*transfer_async=*/true);
+    for (size_t i = 0; i < upload_tensors.size(); ++i) {
+      upload_tensors[i]->SetXlaData(std::move(tensors_data[i]),
+                                    /*sync=*/false);
+    }
+  }
+  XLA_COUNTER("PrefetchedTensors", upload_tensors.size());
 }
 
 std::vector<at::Tensor> XLATensor::FetchTensors(
-    std::vector<XLATensorPtr>* tensors, absl::Span<const xla::Literal> literals,
+    std::vector<XLATensorPtr>* tensors, absl::Span<xla::Literal> literals,
+    const std::vector<size_t>* indices, absl::Span<at::Tensor> dest) {
+  return FetchTensors(TakeFetchSnapshot(*tensors, indices), literals, dest);
+}
+
+XLATensor::FetchSnapshot XLATensor::TakeFetchSnapshot(
+    const std::vector<XLATensorPtr>& tensors,
     const std::vector<size_t>* indices) {
-  std::vector<at::Tensor> results;
-  size_t literals_index = 0;
-  size_t sync_index = 0;
-  results.reserve(tensors->size());
-  for (size_t i = 0; i < tensors->size(); ++i) {
-    if (indices != nullptr && sync_index < indices->size() &&
-        i == (*indices)[sync_index]) {
-      results.push_back(MakeTensorFromXlaLiteral(literals[literals_index],
-                                                 (*tensors)[i]->dtype()));
-      ++literals_index;
-      ++sync_index;
+  // The indices are not sorted when the roots are in canonical order.
+  std::unordered_set<size_t> sync_indices;
+  if (indices != nullptr) {
+    sync_indices.insert(indices->begin(), indices->end());
+  }
+  FetchSnapshot snapshot;
+  snapshot.dtypes.reserve(tensors.size());
+  snapshot.tensors_data.reserve(tensors.size());
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    snapshot.dtypes.push_back(tensors[i]->dtype());
+    snapshot.tensors_data.push_back(sync_indices.count(i) > 0
+                                        ? c10::nullopt
+                                        : tensors[i]->CurrentTensorData());
+  }
+  return snapshot;
+}
+
+std::vector<at::Tensor> XLATensor::FetchTensors(
+    const FetchSnapshot& snapshot, absl::Span<xla::Literal> literals,
+    absl::Span<at::Tensor> dest) {
+  std::vector<at::Tensor> results(snapshot.dtypes.size());
+  // The tensor index of every literal.
+  std::vector<size_t> literal_tensor_indices;
+  literal_tensor_indices.reserve(literals.size());
+  for (size_t i = 0; i < snapshot.dtypes.size(); ++i) {
+    const c10::optional<at::Tensor>& tensor_data = snapshot.tensors_data[i];
+    if (!tensor_data) {
+      literal_tensor_indices.push_back(i);
+    } else if (dest.empty()) {
+      results[i] = *tensor_data;
     } else {
-      c10::optional<at::Tensor> tensor_data =
-          (*tensors)[i]->CurrentTensorData();
-      if (tensor_data) {
-        results.push_back(*tensor_data);
-      } else {
-        XLA_CHECK_LT(literals_index, literals.size());
-        results.push_back(MakeTensorFromXlaLiteral(literals[literals_index],
-                                                   (*tensors)[i]->dtype()));
-        ++literals_index;
-      }
+      dest[i].copy_(*tensor_data);
+      results[i] = dest[i];
     }
   }
+  XLA_CHECK_LE(literal_tensor_indices.size(), literals.size());
+  ParallelConvertLiterals(
+      literals.subspan(0, literal_tensor_indices.size()), [&](size_t k) {
+        size_t i = literal_tensor_indices[k];
+        if (dest.empty()) {
+          results[i] = MakeTensorFromXlaLiteral(std::move(literals[k]),
+                                                snapshot.dtypes[i]);
+        } else {
+          CopyXlaLiteralToTensor(literals[k], &dest[i]);
+          results[i] = dest[i];
+        }
+      });
   return results;
 }
 
@@ -1141,9 +2141,29 @@ std::vector<XLATensorPtr> XLATensor::CreateTensors(
 
 torch::lazy::Value XLATensor::CreateTensorNode(torch::lazy::BackendDataPtr data,
                                                bool read_only) const {
+  DeviceDataInfo* data_info =
+      dynamic_cast<DeviceDataInfo*>(UnwrapXlaData(data)->info());
+  bool shared = data_info != nullptr && data_info->shared;
   UnwrapXlaData(data)->SetInfo(
-      std::make_shared<DeviceDataInfo>(GetUniqueId(), read_only));
-  return torch::lazy::MakeNode<DeviceData>(std::move(data));
+      std::make_shared<DeviceDataInfo>(GetUniqueId(), read_only, shared));
+  return MakeXlaNode<DeviceData>(std::move(data));
+}
+
+torch::lazy::BackendDataPtr XLATensor::GetSharedXlaData() const {
+  torch::lazy::BackendDataPtr xla_data = CurrentXlaData();
+  if (!ShareClonedData() || xla_data == nullptr || data()->view != nullptr ||
+      data()->sharding_spec != nullptr) {
+    return nullptr;
+  }
+  DeviceDataInfo* data_info =
+      dynamic_cast<DeviceDataInfo*>(UnwrapXlaData(xla_data)->info());
+  if (data_info == nullptr || !data_info->shared) {
+    UnwrapXlaData(xla_data)->SetInfo(std::make_shared<DeviceDataInfo>(
+        data_info != nullptr ? data_info->tensor_id : GetUniqueId(),
+        data_info != nullptr && data_info->read_only, /*shared=*/true));
+  }
+  XLA_COUNTER("SharedDeviceData", 1);
+  return xla_data;
 }
 
 std::vector<XLATensorPtr> XLATensor::MakeOutputTensors(
@@ -1175,7 +2195,7 @@ torch::lazy::Value XLATensor::MaybeCastIrValue(
   }
   if (logical_element_type &&
       RequiresRawTypeCasting(*logical_element_type, &device)) {
-    ir_value = torch::lazy::MakeNode<Cast>(ir_value, *logical_element_type);
+    ir_value = MakeXlaNode<Cast>(ir_value, *logical_element_type);
   }
   return ir_value;
 }
@@ -1218,7 +2238,12 @@ XLATensorPtr XLATensor::CreateFrom(torch::lazy::Value ir_value,
 }
 
 void XLATensor::ApplyPendingGraph() {
-  DeviceBarrier(GetDevice());
+  torch::lazy::BackendDataPtr xla_data = CurrentXlaData();
+  if (xla_data != nullptr && data()->view == nullptr) {
+    WaitForData(*UnwrapXlaData(xla_data));
+  } else {
+    DeviceBarrier(GetDevice());
+  }
   // This method is called to ensure that the tensor data is available on
   // device, so that a call to CurrentXlaData() returns a valid pointer.
   if (CurrentXlaData() == nullptr) {
@@ -1231,10 +2256,27 @@ void XLATensor::ApplyEagerSync(std::vector<XLATensorPtr>& tensors) {
   SyncTensorsGraph(&tensors, {}, /*wait=*/false, /*sync_xla_data=*/false);
 }
 
+void XLATensor::ApplyEagerMicroGraph(const torch::lazy::BackendDevice& device) {
+  static const size_t kMicroGraphOps =
+      xla::sys_util::GetEnvInt("XLA_EAGER_MICRO_GRAPH_OPS", 32);
+  if (++g_tls_data.eager_counter < kMicroGraphOps) {
+    return;
+  }
+  g_tls_data.eager_counter = 0;
+  XLA_COUNTER("EagerMicroGraphs", 1);
+  // Syncing all the live tensors keeps the micro graphs short, as the next
+  // ones start from device data. The sync does not wait for the execution, so
+  // it overlaps with the dispatch of the following operations, and the views
+  // are left in place, as the step is not over.
+  std::vector<XLATensorPtr> tensors = GetLiveTensors(&device);
+  SyncTensorsGraph(&tensors, {}, /*wait=*/false, /*sync_xla_data=*/false);
+}
+
 XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
     const std::vector<XLATensorPtr>& tensors, const SyncTensorsConfig& config) {
   tensorflow::profiler::TraceMe activity(
       "CollectSyncTensors", tensorflow::profiler::TraceMeLevel::kInfo);
+  XLA_STEP_PHASE(kCollectSyncTensors);
   xla::util::Unique<torch::lazy::BackendDevice> unique_device;
   for (size_t i = 0; i < tensors.size(); ++i) {
     unique_device.set(tensors[i]->GetDevice());
@@ -1245,6 +2287,7 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   }
 
   std::vector<at::Tensor> at_tensors;
+  std::vector<const xla::OpSharding*> shardings;
   std::vector<std::string> devices;
   std::vector<size_t> at_tensor_index;
   std::unordered_set<int64_t> tensor_ids;
@@ -1254,6 +2297,7 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   coll.config = config;
   coll.device = *unique_device;
   coll.indices.reserve(tensors.size());
+  std::vector<torch::lazy::hash_t> root_hashes;
   for (size_t i = 0; i < tensors.size(); ++i) {
     if (tensor_ids.insert(tensors[i]->GetUniqueId()).second &&
         tensors[i]->CurrentXlaData() == nullptr) {
@@ -1261,7 +2305,7 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
       if (ir_value) {
         if (ShouldSyncIrValue(ir_value)) {
           // Add only tensors which need to be synced.
-          coll.hash = torch::lazy::HashCombine(coll.hash, ir_value.hash());
+          root_hashes.push_back(ir_value.hash());
           coll.indices.push_back(i);
         }
       } else if (config.force_xla_data) {
@@ -1270,11 +2314,34 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
         c10::optional<at::Tensor> tensor_data = tensors[i]->CurrentTensorData();
         XLA_CHECK(tensor_data);
         at_tensors.push_back(*tensor_data);
+        shardings.push_back(tensors[i]->GetUploadSharding());
         devices.push_back(tensors[i]->GetDevice().toString());
         at_tensor_index.push_back(i);
       }
     }
   }
+  if (config.canonical_roots && UseCanonicalGraphHash()) {
+    // Sorting the roots by their hash makes the graph hash, the post order and
+    // the parameter numbering independent from the order the tensors were
+    // created in. Roots with the same hash have the same graph, so their
+    // relative order does not change the computation.
+    std::vector<size_t> order(coll.indices.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t i1, size_t i2) {
+      return root_hashes[i1] < root_hashes[i2];
+    });
+    std::vector<size_t> indices;
+    std::vector<torch::lazy::hash_t> hashes;
+    for (auto i : order) {
+      indices.push_back(coll.indices[i]);
+      hashes.push_back(root_hashes[i]);
+    }
+    coll.indices = std::move(indices);
+    root_hashes = std::move(hashes);
+  }
+  for (auto& root_hash : root_hashes) {
+    coll.hash = torch::lazy::HashCombine(coll.hash, root_hash);
+  }
   // Mix the hash with the resource domain hashes as compile handles are only
   // valid within a domain (usually a single host).
   coll.hash = torch::lazy::MHash(
@@ -1283,7 +2350,7 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   if (!at_tensors.empty()) {
     XLA_COUNTER("SyncTensorsToData", at_tensors.size());
     std::vector<torch::lazy::BackendDataPtr> handles =
-        CreateTensorsData(at_tensors, devices);
+        CreateTensorsData(at_tensors, shardings, devices);
     for (size_t i = 0; i < handles.size(); ++i) {
       // If we are here, it means that the IR torch::lazy::Value for the
       // tensor is not present. Also, we uploaded the at::Tensor data to the
@@ -1298,13 +2365,53 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   return coll;
 }
 
+XLATensor::ComputationCache::TypePtr XLATensor::LoadCachedCompile(
+    const torch::lazy::hash_t& hash, bool acquire_lease) {
+  CompileAhead* compile_ahead = CompileAhead::Get();
+  WarmStart* warm_start = WarmStart::Get();
+  PersistentCache* persistent_cache = PersistentCache::Get();
+  std::shared_ptr<xla::ComputationClient::Computation> computation =
+      compile_ahead != nullptr ? compile_ahead->Take(hash) : nullptr;
+  if (computation == nullptr && warm_start != nullptr) {
+    computation = warm_start->Take(hash);
+  }
+  if (computation == nullptr && persistent_cache != nullptr) {
+    computation =
+        acquire_lease
+            ? persistent_cache->Load(hash)
+            : persistent_cache->LoadIfPresent(torch::lazy::HashToString(hash));
+  }
+  if (computation == nullptr) {
+    return nullptr;
+  }
+  auto cached_computation =
+      std::make_shared<CachedComputation>(std::move(computation));
+  GetComputationCache()->Add(hash, cached_computation);
+  return cached_computation;
+}
+
+void XLATensor::PreloadCachedCompile(const torch::lazy::hash_t& hash) {
+  if (GetComputationCache()->Get(hash) == nullptr &&
+      LoadCachedCompile(hash, /*acquire_lease=*/false) != nullptr) {
+    XLA_COUNTER("SpeculativeSyncPreloaded", 1);
+  }
+}
+
 XLATensor::ComputationCache::TypePtr XLATensor::LookupCachedCompile(
     const std::vector<XLATensorPtr>& tensors, const torch::lazy::hash_t& hash) {
   ComputationCache::TypePtr cached_computation =
       GetComputationCache()->Get(hash);
   if (cached_computation == nullptr) {
-    XLA_COUNTER("UncachedCompile", 1);
-    return nullptr;
+    if (ShardingUtil::UseSpmd()) {
+      // The partitioning information does not survive the other caches.
+      XLA_COUNTER("UncachedCompile", 1);
+      return nullptr;
+    }
+    cached_computation = LoadCachedCompile(hash, /*acquire_lease=*/true);
+    if (cached_computation == nullptr) {
+      XLA_COUNTER("UncachedCompile", 1);
+      return nullptr;
+    }
   }
   TF_VLOG(5) << "Graph hash " << torch::lazy::HashToString(hash)
              << " is computation hash "
@@ -1313,6 +2420,10 @@ XLATensor::ComputationCache::TypePtr XLATensor::LookupCachedCompile(
                         .proto()
                         .SerializeAsString()));
   XLA_COUNTER("CachedCompile", 1);
+  WarmStart* warm_start = WarmStart::Get();
+  if (warm_start != nullptr) {
+    warm_start->RecordGraph(hash);
+  }
   return cached_computation;
 }
 
@@ -1335,14 +2446,65 @@ std::shared_ptr<XLATensor::Async> XLATensor::TryRunCachedSync(
 XLATensor::ComputationCache* XLATensor::GetComputationCache() {
   static const size_t kMaxCacheSize =
       xla::sys_util::GetEnvInt("XLA_COMPILATION_CACHE_SIZE", 1024);
-  static ComputationCache* cache = new ComputationCache(kMaxCacheSize);
+  static const size_t kMaxCacheBytes =
+      xla::sys_util::GetEnvInt("XLA_COMPILATION_CACHE_MAX_BYTES", 0);
+  static ComputationCache* cache = new ComputationCache(
+      kMaxCacheSize, kMaxCacheBytes,
+      [](const CachedComputation& cached) -> size_t {
+        // The device program size is not exposed by the computation client, so
+        // the HLO module size is used as a proxy of the executable footprint.
+        return cached.computation->computation().proto().ByteSizeLong();
+      },
+      [](const CachedComputation& cached) -> double {
+        return cached.compile_time_ns > 0
+                   ? static_cast<double>(cached.compile_time_ns)
+                   : 1e9;
+      },
+      [](const torch::lazy::hash_t& hash,
+         const ComputationCache::TypePtr& cached) {
+        TF_VLOG(3) << "Evicting IR graph hash "
+                   << torch::lazy::HashToString(hash)
+                   << " from the compilation cache";
+        XLA_COUNTER("CompilationCacheEviction", 1);
+      },
+      GetCompilationCacheOptions());
   return cache;
 }
 
+XLATensor::ReplayCache* XLATensor::GetReplayCache() {
+  static const size_t kMaxCacheSize =
+      xla::sys_util::GetEnvInt("XLA_REPLAY_CACHE_SIZE", 64);
+  static ReplayCache* cache = new ReplayCache(kMaxCacheSize);
+  return cache;
+}
+
+XLATensor::FrozenGraphs* XLATensor::GetFrozenGraphs() {
+  static FrozenGraphs* frozen_graphs = new FrozenGraphs();
+  return frozen_graphs;
+}
+
+XLATensor::ReplayCache::TypePtr XLATensor::GetReplayGraph(
+    const torch::lazy::hash_t& hash) {
+  FrozenGraphs* frozen_graphs = GetFrozenGraphs();
+  {
+    std::lock_guard<std::mutex> lock(frozen_graphs->lock);
+    auto it = frozen_graphs->graphs.find(hash);
+    if (it != frozen_graphs->graphs.end()) {
+      return it->second;
+    }
+  }
+  return GetReplayCache()->Get(hash);
+}
+
+bool XLATensor::IsComputationCached(const torch::lazy::hash_t& hash) {
+  return GetComputationCache()->Get(hash) != nullptr;
+}
+
 XLATensor::PostOrderData XLATensor::RunPostOrder(
     const std::vector<XLATensorPtr>& tensors, SyncTensorCollection* coll) {
   tensorflow::profiler::TraceMe activity(
       "RunPostOrder", tensorflow::profiler::TraceMeLevel::kInfo);
+  XLA_STEP_PHASE(kHash);
   absl::Span<const size_t> indices = coll->indices;
   std::vector<const torch::lazy::Node*> roots;
   roots.reserve(indices.size());
@@ -1351,20 +2513,36 @@ XLATensor::PostOrderData XLATensor::RunPostOrder(
     roots.push_back(ir_value.node.get());
   }
   PostOrderData po_data;
-  po_data.post_order = Util::ComputePostOrder(roots, &po_data.emission_map);
+  static const bool memoize_post_order =
+      xla::sys_util::GetEnvBool("XLA_MEMOIZE_POST_ORDER", true);
+  // In the eager modes the new nodes get synced every few operations, so
+  // memoizing the post-order would retain a quadratic amount of memory.
+  if (memoize_post_order && !UseEagerDebugMode() && !UseEagerMode()) {
+    po_data.post_order =
+        Util::ComputeMemoizedPostOrder(roots, &po_data.emission_map);
+  } else {
+    po_data.post_order = Util::ComputePostOrder(roots, &po_data.emission_map);
+  }
   std::unordered_map<xla::ComputationClient::Data::OpaqueHandle, size_t>
       data_handles;
 
   for (auto node : po_data.post_order) {
     const DeviceData* device_data = DeviceData::Cast(node);
     if (device_data != nullptr) {
-      /* Acceptable race condition: HasValue may return false. This is OK
-       * since the conditional barrier is a performance optimization. */
-      if (!device_data->data()->HasValue()) {
-        TensorCollectionBarrier(coll);
+      xla::ComputationClient::Data::OpaqueHandle handle;
+      if (UsePipelinedSync()) {
+        // Placeholders still waiting for the previous execution have no
+        // handle yet, so parameters get deduplicated by data object identity.
+        handle = reinterpret_cast<xla::ComputationClient::Data::OpaqueHandle>(
+            device_data->data().get());
+      } else {
+        /* Acceptable race condition: HasValue may return false. This is OK
+         * since the conditional barrier is a performance optimization. */
+        if (!device_data->data()->HasValue()) {
+          TensorCollectionBarrier(coll);
+        }
+        handle = device_data->data()->GetHandle();
       }
-      xla::ComputationClient::Data::OpaqueHandle handle =
-          device_data->data()->GetHandle();
       auto it = data_handles.find(handle);
       if (it != data_handles.end()) {
         po_data.parameter_sequence.push_back(it->second);
@@ -1391,11 +2569,11 @@ std::vector<torch::lazy::Value> XLATensor::CollectRoots(
 
 std::vector<torch::lazy::BackendDataPtr> XLATensor::FetchTensorData(
     std::vector<XLATensorPtr>* tensors, const SyncTensorsConfig& config,
-    absl::Span<const size_t> indices) {
+    absl::Span<const size_t> indices, const SpmdComputationInfo* spmd_info) {
   std::vector<torch::lazy::BackendDataPtr> tensors_data;
   tensors_data.reserve(indices.size());
-  for (auto index : indices) {
-    XLATensorPtr& tensor = (*tensors)[index];
+  for (size_t i = 0; i < indices.size(); ++i) {
+    XLATensorPtr& tensor = (*tensors)[indices[i]];
     // If the config.force_xla_data flag is true, the purpose of this tensor
     // sync operation is to truncate the IR graph and materialize device data
     // in place of IR graph, on selected tensors. But since operation will
@@ -1410,9 +2588,12 @@ std::vector<torch::lazy::BackendDataPtr> XLATensor::FetchTensorData(
       const torch::lazy::BackendDevice& tensor_device = tensor->GetDevice();
       xla::Shape shape = MakeShapeWithDeviceLayout(
           tensor->shape(), static_cast<XlaDeviceType>(tensor_device.type()));
-      xla_data =
-          WrapXlaData(xla::ComputationClient::Get()->CreateDataPlaceholder(
-              tensor_device.toString(), std::move(shape)));
+      // The placeholders carry the output shardings from the start, as the
+      // graphs consuming them can get hashed and partitioned before the
+      // computation producing them completes.
+      xla_data = WrapXlaData(ShardingUtil::CreateDataPlaceholder(
+          tensor_device.toString(), std::move(shape),
+          spmd_info != nullptr ? &spmd_info->output_shardings[i] : nullptr));
       tensor->SetXlaData(xla_data, config.sync_xla_data);
     }
     tensors_data.emplace_back(std::move(xla_data));
@@ -1431,16 +2612,49 @@ std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
   std::shared_ptr<Async> async = std::make_shared<Async>(
       coll, std::move(parameters_data), std::move(tensors_data),
       std::move(cached_computation));
+  std::shared_ptr<xla::util::MultiWait> completion(async, &async->mwait);
+  for (auto& xla_data : async->tensors_data) {
+    if (xla_data != nullptr) {
+      PendingDataArena::Get()->Register(UnwrapXlaData(xla_data).get(),
+                                        completion);
+    }
+  }
 
   auto syncfn = [async, hash = coll->hash]() {
     xla::ComputationClient::ExecuteComputationOptions options;
+    // The readers of the outputs wait for them to be assigned, or fall back
+    // to the device barrier, which surfaces the failure of the execution.
+    xla::util::Cleanup<int> unregister([&](int) {
+      for (auto& xla_data : async->tensors_data) {
+        if (xla_data != nullptr) {
+          PendingDataArena::Get()->Unregister(UnwrapXlaData(xla_data).get());
+        }
+      }
+    });
     try {
       TF_VLOG(3) << "Executing IR graph hash "
                  << torch::lazy::HashToString(hash) << " on device "
                  << async->device << " ...";
-      auto results = xla::ComputationClient::Get()->ExecuteComputation(
-          *async->cached_computation->computation,
-          UnwrapXlaData(async->parameters_data), async->device, options);
+      const std::shared_ptr<SpmdComputationInfo>& spmd_info =
+          async->cached_computation->spmd_info;
+      int64_t execute_start_ns = xla::sys_util::NowNs();
+      std::vector<xla::ComputationClient::DataPtr> results;
+      {
+        XLA_STEP_PHASE(kExecute);
+        results = spmd_info != nullptr
+                      ? ShardingUtil::ExecuteSpmd(
+                            *async->cached_computation->computation,
+                            UnwrapXlaData(async->parameters_data), *spmd_info)
+                      : xla::ComputationClient::Get()->ExecuteComputation(
+                            *async->cached_computation->computation,
+                            UnwrapXlaData(async->parameters_data),
+                            async->device, options);
+      }
+      int64_t execute_time_ns = xla::sys_util::NowNs() - execute_start_ns;
+      GraphExecuteMetric()->AddSample(execute_time_ns);
+      GraphProfiler::Get()->RecordExecution(
+          hash, async->device, *async->cached_computation->computation,
+          execute_time_ns);
       TF_VLOG(3) << "Executing IR graph hash "
                  << torch::lazy::HashToString(hash) << " on device "
                  << async->device << " done!";
@@ -1451,6 +2665,13 @@ std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
         } else {
           async->tensors_data[i] = WrapXlaData(std::move(results[i]));
         }
+        if (xla::memory_tracker::IsEnabled()) {
+          const xla::ComputationClient::Data& data =
+              *UnwrapXlaData(async->tensors_data[i]);
+          xla::memory_tracker::RecordAllocation(
+              &data, data.device(), GetDataBytes(data),
+              torch::lazy::HashToString(hash));
+        }
       }
     } catch (...) {
       // There are two paths of discovery of an exception happening on an
@@ -1470,7 +2691,22 @@ std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
     }
   };
 
-  xla::env::ScheduleIoClosure(async->mwait.Completer(std::move(syncfn)));
+  xla::env::ScheduleIoClosure([async, syncfn = std::move(syncfn)]() {
+    std::exception_ptr exptr;
+    async->mwait.Completer([&]() {
+      try {
+        syncfn();
+      } catch (...) {
+        exptr = std::current_exception();
+        throw;
+      }
+    })();
+    if (exptr != nullptr) {
+      async->completion.SetException(exptr);
+    } else {
+      async->completion.SetValue(0);
+    }
+  });
   return async;
 }
 
@@ -1478,7 +2714,8 @@ std::shared_ptr<XLATensor::Async> XLATensor::ScheduleSyncTensorsGraph(
     std::vector<XLATensorPtr>* tensors, SyncTensorCollection* coll,
     std::vector<torch::lazy::BackendDataPtr> parameters_data,
     std::string device, ComputationCache::TypePtr cached_computation) {
-  auto tensors_data = FetchTensorData(tensors, coll->config, coll->indices);
+  auto tensors_data = FetchTensorData(tensors, coll->config, coll->indices,
+                                      cached_computation->spmd_info.get());
   return ScheduleSyncTensorsGraph(coll, std::move(parameters_data),
                                   std::move(tensors_data),
                                   std::move(cached_computation));
@@ -1496,6 +2733,8 @@ void XLATensor::SyncTensorsGraph(std::vector<XLATensorPtr>* tensors,
   SyncTensorsConfig config;
   config.sync_xla_data = sync_xla_data;
   if (op_by_op) {
+    XLA_CHECK(!ShardingUtil::UseSpmd())
+        << "XLA_SYNC_TENSORS_OPBYOP is not supported with XLA_USE_SPMD";
     OpByOpAsync async = SyncTensorsGraphOpByOp(tensors, devices, config);
     if (wait) {
       async.Wait();
@@ -1503,6 +2742,7 @@ void XLATensor::SyncTensorsGraph(std::vector<XLATensorPtr>* tensors,
   } else {
     auto async = SyncTensorsGraphInternal(tensors, devices, config);
     if (wait && async != nullptr) {
+      XLA_STEP_PHASE(kDeviceWait);
       async->mwait.Wait();
     }
   }
@@ -1520,12 +2760,304 @@ void XLATensor::SyncLiveTensorsGraph(const torch::lazy::BackendDevice* device,
 }
 
 void XLATensor::MarkStep(const torch::lazy::BackendDevice& device) {
+  static xla::metrics::Metric* resident_memory = new xla::metrics::Metric(
+      "HostResidentMemory", xla::metrics::MetricFnBytes);
   XLA_COUNTER("MarkStep", 1);
+  step_breakdown::EndStep(device.toString());
+  ReleaseDeadIr(device);
   DeviceContextArena::Get()->MarkStep(device);
+  int64_t resident_bytes = xla::sys_util::GetResidentMemoryBytes();
+  if (resident_bytes >= 0) {
+    resident_memory->AddSample(resident_bytes);
+  }
   torch::lazy::ScopePusher::ResetScopes();
   g_tls_data.Reset();
 }
 
+torch::lazy::hash_t XLATensor::CaptureGraph(
+    const std::vector<XLATensorPtr>& outputs,
+    const std::vector<XLATensorPtr>& inputs) {
+  SyncTensorsConfig config;
+  config.force_xla_data = false;
+  config.sync_xla_data = false;
+  // The replay maps the computation outputs to the outputs positionally.
+  config.canonical_roots = false;
+  SyncTensorCollection coll = CollectSyncTensors(outputs, config);
+  XLA_CHECK_EQ(coll.indices.size(), outputs.size())
+      << "All the outputs of a captured graph must be distinct tensors with "
+         "pending IR operations";
+  PostOrderData po_data = RunPostOrder(outputs, &coll);
+  // Parameters are matched against the inputs by handle, so they need to hold
+  // their device data.
+  TensorCollectionBarrier(&coll);
+  coll.hash = torch::lazy::HashCombine(
+      coll.hash, torch::lazy::Hash(po_data.parameter_sequence));
+  if (ShardingUtil::UseSpmd()) {
+    coll.hash = torch::lazy::HashCombine(
+        coll.hash, ShardingUtil::GetShardingHash(po_data.post_order));
+  }
+
+  ComputationCache::TypePtr cached_computation =
+      LookupCachedCompile(outputs, coll.hash);
+  std::vector<torch::lazy::BackendDataPtr> parameters_data;
+  if (cached_computation == nullptr) {
+    CompilationResult compile_result = Compile(outputs, {}, coll, &po_data);
+    cached_computation = std::make_shared<CachedComputation>(
+        std::move(compile_result.computation), /*compile_time_ns=*/0,
+        std::move(compile_result.spmd_info));
+    GetComputationCache()->Add(coll.hash, cached_computation);
+    // The lookup might have taken the compile lease for the graph.
+    PersistentCache* persistent_cache = PersistentCache::Get();
+    if (persistent_cache != nullptr) {
+      persistent_cache->Store(coll.hash, cached_computation->computation);
+    }
+    parameters_data = std::move(compile_result.parameters_data);
+  } else {
+    parameters_data = std::move(po_data.parameters_data);
+  }
+
+  std::unordered_map<xla::ComputationClient::Data::OpaqueHandle, int64_t>
+      input_handles;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    torch::lazy::BackendDataPtr xla_data = inputs[i]->CurrentXlaData();
+    XLA_CHECK(xla_data != nullptr)
+        << "Inputs of a captured graph must hold device data";
+    input_handles.emplace(xla_data->GetHandle(), i);
+  }
+  auto graph = std::make_shared<ReplayGraphInfo>();
+  graph->device = coll.device;
+  graph->cached_computation = std::move(cached_computation);
+  for (auto& data : parameters_data) {
+    auto it = input_handles.find(data->GetHandle());
+    if (it != input_handles.end()) {
+      graph->input_indices.push_back(it->second);
+      graph->constants.push_back(nullptr);
+    } else {
+      graph->input_indices.push_back(-1);
+      graph->constants.push_back(data);
+    }
+  }
+  for (auto& output : outputs) {
+    graph->output_shapes.push_back(MakeShapeWithDeviceLayout(
+        output->shape(), static_cast<XlaDeviceType>(coll.device.type())));
+    graph->output_types.push_back(output->data()->logical_element_type);
+  }
+  TF_VLOG(3) << "Captured IR graph hash " << torch::lazy::HashToString(coll.hash)
+             << " with " << inputs.size() << " inputs and " << outputs.size()
+             << " outputs";
+  GetReplayCache()->Add(coll.hash, std::move(graph));
+  return coll.hash;
+}
+
+std::vector<XLATensorPtr> XLATensor::ReplayGraph(
+    const torch::lazy::hash_t& hash, const std::vector<XLATensorPtr>& inputs) {
+  XLA_COUNTER("ReplayGraph", 1);
+  ReplayCache::TypePtr graph = GetReplayGraph(hash);
+  XLA_CHECK(graph != nullptr) << "No captured graph with hash "
+                              << torch::lazy::HashToString(hash);
+  const xla::ProgramShape& program_shape =
+      graph->cached_computation->computation->program_shape();
+  std::vector<torch::lazy::BackendDataPtr> parameters_data;
+  parameters_data.reserve(graph->input_indices.size());
+  for (size_t i = 0; i < graph->input_indices.size(); ++i) {
+    int64_t index = graph->input_indices[i];
+    if (index < 0) {
+      parameters_data.push_back(graph->constants[i]);
+      continue;
+    }
+    XLA_CHECK_LT(index, inputs.size());
+    XLA_CHECK_EQ(inputs[index]->GetDevice(), graph->device);
+    torch::lazy::BackendDataPtr xla_data = inputs[index]->GetXlaData();
+    // The partitioned computations take the shards of the parameters.
+    XLA_CHECK(graph->cached_computation->spmd_info != nullptr ||
+              xla::ShapeUtil::Compatible(UnwrapXlaData(xla_data)->shape(),
+                                         program_shape.parameters(i)))
+        << "Input " << index << " shape "
+        << UnwrapXlaData(xla_data)->shape() << " does not match the captured "
+        << program_shape.parameters(i);
+    parameters_data.push_back(std::move(xla_data));
+  }
+
+  std::vector<torch::lazy::BackendDataPtr> tensors_data;
+  std::vector<XLATensorPtr> outputs;
+  for (size_t i = 0; i < graph->output_shapes.size(); ++i) {
+    const std::shared_ptr<SpmdComputationInfo>& spmd_info =
+        graph->cached_computation->spmd_info;
+    torch::lazy::BackendDataPtr xla_data =
+        WrapXlaData(ShardingUtil::CreateDataPlaceholder(
+            graph->device.toString(), graph->output_shapes[i],
+            spmd_info != nullptr ? &spmd_info->output_shardings[i] : nullptr));
+    outputs.push_back(Create(xla_data, graph->output_types[i]));
+    tensors_data.push_back(std::move(xla_data));
+  }
+  SyncTensorCollection coll;
+  coll.device = graph->device;
+  coll.hash = hash;
+  ScheduleSyncTensorsGraph(&coll, std::move(parameters_data),
+                           std::move(tensors_data), graph->cached_computation);
+  return outputs;
+}
+
+torch::lazy::hash_t XLATensor::CaptureLoop(const torch::lazy::hash_t& hash,
+                                           int64_t num_iterations,
+                                           size_t num_carried) {
+  ReplayCache::TypePtr graph = GetReplayGraph(hash);
+  XLA_CHECK(graph != nullptr) << "No captured graph with hash "
+                              << torch::lazy::HashToString(hash);
+  XLA_CHECK(graph->cached_computation->spmd_info == nullptr)
+      << "Loop capture is not supported with XLA_USE_SPMD";
+  XLA_CHECK_GT(num_iterations, 0);
+  XLA_CHECK_LE(num_carried, graph->output_shapes.size());
+  torch::lazy::hash_t loop_hash = torch::lazy::HashCombine(
+      hash,
+      torch::lazy::MHash(num_iterations, static_cast<int64_t>(num_carried)));
+  if (GetReplayGraph(loop_hash) != nullptr) {
+    return loop_hash;
+  }
+  XLA_COUNTER("CaptureLoop", 1);
+  const xla::ComputationClient::Computation& step =
+      *graph->cached_computation->computation;
+  const xla::ProgramShape& step_shape = step.program_shape();
+  size_t num_params = graph->input_indices.size();
+  size_t num_outputs = graph->output_shapes.size();
+  // For every carried input, the step parameter it feeds.
+  std::vector<int64_t> carried_params(num_carried, -1);
+  for (size_t i = 0; i < num_params; ++i) {
+    int64_t index = graph->input_indices[i];
+    if (index >= 0 && index < num_carried) {
+      carried_params[index] = i;
+    }
+  }
+  for (size_t i = 0; i < num_carried; ++i) {
+    XLA_CHECK_GE(carried_params[i], 0)
+        << "Loop carried input " << i << " is not used by the captured graph";
+    const xla::Shape& output_shape = step_shape.result().tuple_shapes(i);
+    const xla::Shape& input_shape = step_shape.parameters(carried_params[i]);
+    XLA_CHECK(xla::ShapeUtil::Compatible(output_shape, input_shape))
+        << "Loop carried output " << i << " shape " << output_shape
+        << " does not match its input shape " << input_shape;
+  }
+
+  // The loop state holds the iteration counter, the step parameters (the
+  // streamed ones with their iteration dimension), and the last values of the
+  // outputs which are not carried.
+  auto is_streamed = [&](size_t param) {
+    return graph->input_indices[param] >= static_cast<int64_t>(num_carried);
+  };
+  std::vector<xla::Shape> param_shapes;
+  std::vector<xla::Shape> state_shapes = {
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S64, {})};
+  for (size_t i = 0; i < num_params; ++i) {
+    param_shapes.push_back(
+        is_streamed(i) ? xla::ShapeUtil::PrependMajorDimension(
+                             num_iterations, step_shape.parameters(i))
+                       : step_shape.parameters(i));
+    state_shapes.push_back(param_shapes.back());
+  }
+  for (size_t i = num_carried; i < num_outputs; ++i) {
+    state_shapes.push_back(step_shape.result().tuple_shapes(i));
+  }
+  xla::Shape state_shape = xla::ShapeUtil::MakeTupleShape(state_shapes);
+
+  xla::XlaBuilder cond_builder("CaptureLoopCond");
+  {
+    xla::XlaOp state = xla::Parameter(&cond_builder, 0, state_shape, "state");
+    xla::Lt(xla::GetTupleElement(state, 0),
+            xla::ConstantR0<int64_t>(&cond_builder, num_iterations));
+  }
+  xla::XlaBuilder body_builder("CaptureLoopBody");
+  {
+    xla::XlaOp state = xla::Parameter(&body_builder, 0, state_shape, "state");
+    xla::XlaOp counter = xla::GetTupleElement(state, 0);
+    std::vector<xla::XlaOp> args;
+    for (size_t i = 0; i < num_params; ++i) {
+      xla::XlaOp arg = xla::GetTupleElement(state, 1 + i);
+      if (is_streamed(i)) {
+        const xla::Shape& shape = step_shape.parameters(i);
+        xla::XlaOp zero = xla::Zero(&body_builder, xla::PrimitiveType::S64);
+        std::vector<xla::XlaOp> start_indices(shape.rank() + 1, zero);
+        start_indices[0] = counter;
+        std::vector<int64_t> sizes = {1};
+        sizes.insert(sizes.end(), shape.dimensions().begin(),
+                     shape.dimensions().end());
+        arg = xla::Reshape(xla::DynamicSlice(arg, start_indices, sizes),
+                           shape.dimensions());
+      }
+      args.push_back(arg);
+    }
+    xla::XlaOp result = xla::Call(&body_builder, step.computation(), args);
+    std::vector<xla::XlaOp> next_state = {
+        counter + xla::One(&body_builder, xla::PrimitiveType::S64)};
+    for (size_t i = 0; i < num_params; ++i) {
+      // The constants and the streamed parameters do not change.
+      int64_t index = graph->input_indices[i];
+      next_state.push_back(index >= 0 && !is_streamed(i)
+                               ? xla::GetTupleElement(result, index)
+                               : xla::GetTupleElement(state, 1 + i));
+    }
+    for (size_t i = num_carried; i < num_outputs; ++i) {
+      next_state.push_back(xla::GetTupleElement(result, i));
+    }
+    xla::Tuple(&body_builder, next_state);
+  }
+  xla::XlaBuilder builder("CaptureLoop");
+  std::vector<xla::XlaOp> init_state = {
+      xla::ConstantR0<int64_t>(&builder, 0)};
+  for (size_t i = 0; i < num_params; ++i) {
+    init_state.push_back(xla::Parameter(&builder, i, param_shapes[i],
+                                        absl::StrCat("p", i)));
+  }
+  for (size_t i = num_carried; i < num_outputs; ++i) {
+    init_state.push_back(
+        xla::Zeros(&builder, step_shape.result().tuple_shapes(i)));
+  }
+  xla::XlaOp loop = xla::While(ConsumeValue(cond_builder.Build()),
+                               ConsumeValue(body_builder.Build()),
+                               xla::Tuple(&builder, init_state));
+  std::vector<xla::XlaOp> outputs;
+  for (size_t i = 0; i < num_outputs; ++i) {
+    outputs.push_back(xla::GetTupleElement(
+        loop, i < num_carried ? 1 + carried_params[i]
+                              : 1 + num_params + (i - num_carried)));
+  }
+  xla::XlaComputation computation =
+      ConsumeValue(builder.Build(xla::Tuple(&builder, outputs)));
+
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  xla::Shape shape = MakeShapeWithDeviceLayout(
+      program_shape.result(), static_cast<XlaDeviceType>(graph->device.type()));
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back(
+      {std::move(computation), graph->device.toString(),
+       xla::ComputationClient::Get()->GetCompilationDevices(
+           graph->device.toString(), {}),
+       &shape});
+  auto loop_graph = std::make_shared<ReplayGraphInfo>(*graph);
+  loop_graph->cached_computation = std::make_shared<CachedComputation>(
+      xla::ComputationClient::Get()->Compile(std::move(instances)).front());
+  TF_VLOG(3) << "Captured IR graph hash "
+             << torch::lazy::HashToString(loop_hash) << " running "
+             << num_iterations << " iterations of "
+             << torch::lazy::HashToString(hash);
+  GetReplayCache()->Add(loop_hash, std::move(loop_graph));
+  return loop_hash;
+}
+
+void XLATensor::FreezeGraph(const torch::lazy::hash_t& hash) {
+  ReplayCache::TypePtr graph = GetReplayGraph(hash);
+  XLA_CHECK(graph != nullptr) << "No captured graph with hash "
+                              << torch::lazy::HashToString(hash);
+  FrozenGraphs* frozen_graphs = GetFrozenGraphs();
+  std::lock_guard<std::mutex> lock(frozen_graphs->lock);
+  frozen_graphs->graphs.emplace(hash, std::move(graph));
+}
+
+void XLATensor::UnfreezeGraph(const torch::lazy::hash_t& hash) {
+  FrozenGraphs* frozen_graphs = GetFrozenGraphs();
+  std::lock_guard<std::mutex> lock(frozen_graphs->lock);
+  frozen_graphs->graphs.erase(hash);
+}
+
 void XLATensor::WaitDeviceOps(absl::Span<const std::string> devices) {
   std::set<torch::lazy::BackendDevice> wait_devices;
   if (!devices.empty()) {
@@ -1601,8 +3133,135 @@ XLATensor::OpByOpAsync XLATensor::SyncTensorsGraphOpByOp(
   return async_op.Schedule();
 }
 
+void XLATensor::ComputeDonatableParameters(SyncTensorCollection* coll,
+                                           PostOrderData* po_data) {
+  static const bool donate_dead_parameters =
+      xla::sys_util::GetEnvBool("XLA_DONATE_DEAD_PARAMETERS", false);
+  if (!donate_dead_parameters || !coll->config.sync_xla_data) {
+    return;
+  }
+  std::unordered_set<int64_t> live_tensor_ids;
+  std::unordered_set<const torch::lazy::BackendData*> live_data;
+  for (auto& tensor : GetLiveTensors(&coll->device)) {
+    live_tensor_ids.insert(tensor->GetUniqueId());
+    torch::lazy::BackendDataPtr xla_data = tensor->CurrentXlaData();
+    if (xla_data != nullptr) {
+      live_data.insert(xla_data.get());
+    }
+  }
+  for (size_t i = 0; i < po_data->parameters_data.size(); ++i) {
+    const torch::lazy::BackendDataPtr& data = po_data->parameters_data[i];
+    DeviceDataInfo* data_info =
+        dynamic_cast<DeviceDataInfo*>(UnwrapXlaData(data)->info());
+    if (data_info != nullptr && !data_info->read_only &&
+        live_tensor_ids.count(data_info->tensor_id) == 0 &&
+        live_data.count(data.get()) == 0) {
+      po_data->donatable_parameters.push_back(i);
+    }
+  }
+  XLA_VALUE_METRIC("DonatableParameters",
+                   po_data->donatable_parameters.size());
+}
+
+void XLATensor::ComputeInPlaceUpdates(const std::vector<XLATensorPtr>& tensors,
+                                      SyncTensorCollection* coll,
+                                      PostOrderData* po_data) {
+  static const bool inplace_updates =
+      xla::sys_util::GetEnvBool("XLA_INPLACE_UPDATES", false);
+  // The step barrier syncs alias all the updated tensors already. The synced
+  // tensors must get their device data, which replaces the IR graph reading
+  // the donated buffers.
+  if (coll->config.sync_xla_data || !coll->config.force_xla_data) {
+    return;
+  }
+  std::unordered_map<const torch::lazy::BackendData*, size_t>
+      parameter_indices;
+  // The writable parameters by the ID of the tensor owning their device data.
+  std::unordered_map<int64_t, size_t> tensor_parameters;
+  for (size_t i = 0; i < po_data->parameters_data.size(); ++i) {
+    const torch::lazy::BackendDataPtr& data = po_data->parameters_data[i];
+    parameter_indices.emplace(data.get(), i);
+    DeviceDataInfo* data_info =
+        dynamic_cast<DeviceDataInfo*>(UnwrapXlaData(data)->info());
+    if (data_info != nullptr && !data_info->read_only) {
+      tensor_parameters.emplace(data_info->tensor_id, i);
+    }
+  }
+  std::unordered_set<int64_t> synced_tensor_ids;
+  std::unordered_map<const torch::lazy::BackendData*, std::pair<size_t, size_t>>
+      candidates;
+  for (size_t i = 0; i < coll->indices.size(); ++i) {
+    const XLATensorPtr& tensor = tensors[coll->indices[i]];
+    synced_tensor_ids.insert(tensor->GetUniqueId());
+    if (tensor->data()->view != nullptr) {
+      continue;
+    }
+    if (tensor->IsAccumulator()) {
+      auto it = tensor_parameters.find(tensor->GetUniqueId());
+      if (it != tensor_parameters.end()) {
+        candidates.emplace(po_data->parameters_data[it->second].get(),
+                           std::make_pair(it->second, i));
+      }
+      continue;
+    }
+    if (!inplace_updates) {
+      continue;
+    }
+    torch::lazy::Value ir_value = tensor->CurrentIrValue();
+    const XlaNode* node = dynamic_cast<const XlaNode*>(ir_value.node.get());
+    if (node == nullptr || !node->inplace_update()) {
+      continue;
+    }
+    const DeviceData* device_data = DeviceData::Cast(node->operand(0).node);
+    if (device_data == nullptr) {
+      continue;
+    }
+    DeviceDataInfo* data_info = dynamic_cast<DeviceDataInfo*>(
+        UnwrapXlaData(device_data->data())->info());
+    auto it = parameter_indices.find(device_data->data().get());
+    if (data_info != nullptr && !data_info->read_only &&
+        data_info->tensor_id == tensor->GetUniqueId() &&
+        it != parameter_indices.end()) {
+      candidates.emplace(device_data->data().get(),
+                         std::make_pair(it->second, i));
+    }
+  }
+  // The updated buffers must not be referenced by the device data of a live
+  // tensor, or by the pending IR graph of a live tensor not being synced.
+  torch::lazy::Util::EmissionMap emission_map;
+  for (auto& tensor : GetLiveTensors(&coll->device)) {
+    if (candidates.empty()) {
+      break;
+    }
+    torch::lazy::BackendDataPtr xla_data = tensor->CurrentXlaData();
+    if (xla_data != nullptr) {
+      candidates.erase(xla_data.get());
+      continue;
+    }
+    torch::lazy::Value ir_value = tensor->CurrentIrValue();
+    if (!ir_value || synced_tensor_ids.count(tensor->GetUniqueId()) > 0) {
+      continue;
+    }
+    for (auto node : torch::lazy::Util::ComputePostOrder(ir_value.node.get(),
+                                                         &emission_map)) {
+      const DeviceData* device_data = DeviceData::Cast(node);
+      if (device_data != nullptr) {
+        candidates.erase(device_data->data().get());
+      }
+    }
+  }
+  for (auto& candidate : candidates) {
+    po_data->inplace_updates.push_back(candidate.second);
+  }
+  std::sort(po_data->inplace_updates.begin(), po_data->inplace_updates.end());
+  if (!po_data->inplace_updates.empty()) {
+    XLA_COUNTER("InPlaceUpdates", po_data->inplace_updates.size());
+  }
+}
+
 void XLATensor::BuildInputOutputAliases(
     const std::vector<XLATensorPtr>& tensors, absl::Span<const size_t> indices,
+    absl::Span<const size_t> donatable_parameters,
     LoweringContext* lowering_ctx) {
   std::unordered_map<int64_t, size_t> output_tensor_id_map;
   for (size_t i = 0; i < indices.size(); ++i) {
@@ -1635,9 +3294,84 @@ void XLATensor::BuildInputOutputAliases(
       }
     }
   }
+  // The donatable parameters are not referenced by any live tensor, so their
+  // buffers can be reused by any (not already aliased) output of equal shape.
+  std::vector<bool> aliased_parameters(parameters_data.size(), false);
+  for (auto parameter_index : alias_map) {
+    if (parameter_index >= 0) {
+      aliased_parameters[parameter_index] = true;
+    }
+  }
+  for (auto i : donatable_parameters) {
+    if (aliased_parameters[i]) {
+      continue;
+    }
+    for (size_t output_index = 0; output_index < alias_map.size();
+         ++output_index) {
+      if (alias_map[output_index] >= 0) {
+        continue;
+      }
+      xla::XlaOp root = lowering_ctx->GetResult(output_index);
+      if (parameters_data[i]->shape() == XlaHelpers::ShapeOfXlaOp(root)) {
+        lowering_ctx->builder()->SetUpAlias(
+            {static_cast<int64_t>(output_index)}, i, {});
+        alias_map[output_index] = i;
+        TF_VLOG(6) << "Donated paramter " << i << " to output " << output_index
+                   << ": " << parameters_data[i]->shape();
+        break;
+      }
+    }
+  }
   XLA_VALUE_METRIC("InputOutputAliasCount", alias_map.size());
 }
 
+void XLATensor::LowerPostOrder(
+    absl::Span<const torch::lazy::Node* const> post_order,
+    absl::Span<const size_t> parameter_sequence,
+    absl::Span<const torch::lazy::Output> roots,
+    LoweringContext* lowering_ctx) {
+  std::unique_ptr<IrSimplifier> simplifier;
+  ParallelLowering::ReplacementFn replacement_fn;
+  if (IrSimplifier::IsEnabled()) {
+    simplifier =
+        absl::make_unique<IrSimplifier>(post_order, parameter_sequence);
+    replacement_fn = [&](const torch::lazy::Node* node) {
+      return simplifier->GetReplacement(node);
+    };
+  }
+  size_t parallel_min_nodes = ParallelLowering::GetMinNodes();
+  if (parallel_min_nodes > 0 && post_order.size() >= parallel_min_nodes &&
+      ParallelLowering::Lower(post_order, roots, replacement_fn,
+                              lowering_ctx)) {
+    return;
+  }
+  std::unique_ptr<SubgraphCalls> calls;
+  size_t calls_min_nodes = SubgraphCalls::GetMinNodes();
+  if (calls_min_nodes > 0 && post_order.size() >= calls_min_nodes) {
+    calls = absl::make_unique<SubgraphCalls>(post_order, roots, replacement_fn,
+                                             lowering_ctx->device());
+  }
+  for (auto node : post_order) {
+    if (calls != nullptr &&
+        (calls->IsCalled(node) || calls->LowerCall(node, lowering_ctx))) {
+      continue;
+    }
+    const torch::lazy::Node* replacement =
+        replacement_fn != nullptr ? replacement_fn(node) : nullptr;
+    if (replacement == nullptr) {
+      lowering_ctx->LowerNode(node);
+      continue;
+    }
+    // Folded scalars are not part of the post order, and get lowered by the
+    // GetOutputOp() call.
+    for (size_t i = 0; i < node->num_outputs(); ++i) {
+      lowering_ctx->AssignOutputOp(
+          torch::lazy::Output(node, i),
+          lowering_ctx->GetOutputOp(torch::lazy::Output(replacement, i)));
+    }
+  }
+}
+
 XLATensor::CompilationResult XLATensor::Compile(
     const std::vector<XLATensorPtr>& tensors,
     absl::Span<const std::string> devices, const SyncTensorCollection& coll,
@@ -1649,19 +3383,32 @@ XLATensor::CompilationResult XLATensor::Compile(
             {{"graph_hash", torch::lazy::HashToString(coll.hash)}});
       },
       tensorflow::profiler::TraceMeLevel::kInfo);
+  // The partitioned parameters and outputs do not keep the shapes the aliases
+  // get set up with.
   static const bool enable_aliasing =
-      xla::sys_util::GetEnvBool("XLA_ENABLE_PARAM_ALIASING", true);
+      xla::sys_util::GetEnvBool("XLA_ENABLE_PARAM_ALIASING", true) &&
+      !ShardingUtil::UseSpmd();
   LoweringContext lowering_ctx("SyncTensorsGraph", coll.device,
-                               po_data->post_order,
+                               /*post_order=*/{},
                                std::move(po_data->emission_map));
+  std::vector<torch::lazy::Output> roots;
   for (auto index : coll.indices) {
     torch::lazy::Value ir_value = tensors[index]->CurrentIrValue();
-    xla::XlaOp root = lowering_ctx.GetOutputOp(
-        torch::lazy::Output(ir_value.node.get(), ir_value.index));
-    lowering_ctx.AddResult(root);
+    roots.emplace_back(ir_value.node.get(), ir_value.index);
+  }
+  LowerPostOrder(po_data->post_order, po_data->parameter_sequence, roots,
+                 &lowering_ctx);
+  for (auto& root : roots) {
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(root));
   }
   // Annotate HLO sharding selectively in the compuation.
-  ShardingUtil::SetHloSharding(&lowering_ctx);
+  if (ShardingUtil::UseSpmd() && ShardingUtil::UseAutoSharding()) {
+    ShardingUtil::ShardingMap inferred_shardings =
+        ShardingUtil::PropagateShardings(po_data->post_order);
+    ShardingUtil::SetHloSharding(&lowering_ctx, &inferred_shardings);
+  } else {
+    ShardingUtil::SetHloSharding(&lowering_ctx);
+  }
 
   if (enable_aliasing && coll.config.sync_xla_data) {
     // We can only alias at the step barrier, when force_xla_data is true.
@@ -1688,26 +3435,90 @@ XLATensor::CompilationResult XLATensor::Compile(
     // will later fetch the new value of A, which is incorrect.
     // But, when we issue a step barrier (force_xla_data == true) we have to
     // turn everything into DEVICE_DATA, so we can activate aliasing.
-    BuildInputOutputAliases(tensors, coll.indices, &lowering_ctx);
+    BuildInputOutputAliases(tensors, coll.indices,
+                            po_data->donatable_parameters, &lowering_ctx);
+  } else if (enable_aliasing) {
+    // Outside of the step barrier, only the in-place updates whose buffers
+    // nothing else references can be aliased.
+    const std::vector<xla::ComputationClient::DataPtr>& parameters_data =
+        UnwrapXlaData(lowering_ctx.GetParametersData());
+    for (auto& update : po_data->inplace_updates) {
+      xla::XlaOp root = lowering_ctx.GetResult(update.second);
+      if (parameters_data[update.first]->shape() ==
+          XlaHelpers::ShapeOfXlaOp(root)) {
+        lowering_ctx.builder()->SetUpAlias(
+            {static_cast<int64_t>(update.second)}, update.first, {});
+        TF_VLOG(6) << "Aliased in-place updated parameter " << update.first
+                   << " with output " << update.second;
+      }
+    }
   }
 
   xla::XlaComputation computation = ConsumeValue(lowering_ctx.BuildXla());
+  std::vector<std::string> compilation_devices =
+      xla::ComputationClient::Get()->GetCompilationDevices(
+          coll.device.toString(), devices);
+  std::shared_ptr<SpmdComputationInfo> spmd_info;
+  if (ShardingUtil::UseSpmd()) {
+    spmd_info = std::make_shared<SpmdComputationInfo>();
+    computation = ShardingUtil::PartitionComputation(
+        computation, UnwrapXlaData(lowering_ctx.GetParametersData()),
+        spmd_info.get());
+    compilation_devices = spmd_info->devices;
+  }
   xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
   xla::Shape shape = MakeShapeWithDeviceLayout(
       program_shape.result(), static_cast<XlaDeviceType>(coll.device.type()));
 
   std::vector<xla::ComputationClient::CompileInstance> instances;
   instances.push_back({std::move(computation), coll.device.toString(),
-                       xla::ComputationClient::Get()->GetCompilationDevices(
-                           coll.device.toString(), devices),
-                       &shape});
+                       std::move(compilation_devices), &shape});
+  CompileAhead* compile_ahead = CompileAhead::Get();
+  if (compile_ahead != nullptr && spmd_info == nullptr) {
+    compile_ahead->RecordComputation(coll.hash, instances.front());
+  }
 
-  TF_VLOG(3) << "Compiling IR graph hash "
-             << torch::lazy::HashToString(coll.hash) << " on device "
-             << coll.device << " ...";
   std::vector<std::shared_ptr<xla::ComputationClient::Computation>>
-      computations =
-          xla::ComputationClient::Get()->Compile(std::move(instances));
+      computations;
+  PersistentCache* persistent_cache =
+      spmd_info != nullptr ? PersistentCache::Get() : nullptr;
+  if (spmd_info != nullptr) {
+    // The graphs partitioning into the same per device program share its
+    // executable, within the process and across the runs, while the graph
+    // level caches keep their own partitioning information.
+    std::shared_ptr<xla::ComputationClient::Computation> program =
+        ShardingUtil::GetCachedProgram(spmd_info->program_hash);
+    if (program == nullptr && persistent_cache != nullptr) {
+      program = persistent_cache->Load(spmd_info->program_hash);
+    }
+    if (program != nullptr) {
+      XLA_COUNTER("SpmdCachedProgram", 1);
+      ShardingUtil::CacheProgram(spmd_info->program_hash, program);
+      computations.push_back(std::move(program));
+    }
+  }
+  if (computations.empty()) {
+    // A failed compilation lets other processes waiting on the program
+    // compile it.
+    xla::util::ExceptionCleanup lease_release(
+        [&](xla::util::ExceptionCleanup::StatusType status) {
+          if (persistent_cache != nullptr) {
+            persistent_cache->ReleaseLease(spmd_info->program_hash);
+          }
+        });
+    TF_VLOG(3) << "Compiling IR graph hash "
+               << torch::lazy::HashToString(coll.hash) << " on device "
+               << coll.device << " ...";
+    computations = xla::ComputationClient::Get()->Compile(std::move(instances));
+    if (spmd_info != nullptr) {
+      ShardingUtil::CacheProgram(spmd_info->program_hash,
+                                 computations.front());
+      if (persistent_cache != nullptr) {
+        persistent_cache->Store(spmd_info->program_hash, computations.front());
+        lease_release.Release();
+      }
+    }
+  }
   TF_VLOG(3) << "Compiling IR graph hash "
              << torch::lazy::HashToString(coll.hash) << " on device "
              << coll.device << " done!";
@@ -1722,7 +3533,8 @@ XLATensor::CompilationResult XLATensor::Compile(
   return {/*device=*/coll.device,
           /*emitted_nodes=*/lowering_ctx.GetEmittedNodeCount(),
           /*computation=*/std::move(computations.front()),
-          /*parameters_data=*/std::move(po_data->parameters_data)};
+          /*parameters_data=*/std::move(po_data->parameters_data),
+          /*spmd_info=*/std::move(spmd_info)};
 }
 
 std::shared_ptr<XLATensor::Async> XLATensor::SyncTensorsGraphInternal(
@@ -1734,30 +3546,111 @@ std::shared_ptr<XLATensor::Async> XLATensor::SyncTensorsGraphInternal(
   if (coll.indices.empty()) {
     /* Enure previous execution is complete before exiting this
      * function */
-    TensorCollectionBarrier(&coll);
+    if (!config.fetch) {
+      TensorCollectionBarrier(&coll);
+    }
     return nullptr;
   }
   PostOrderData po_data = RunPostOrder(*tensors, &coll);
-  DebugUtil::SaveTensorsGraphInfo("ScheduleSyncTensorsGraph", *tensors,
-                                  &coll.indices);
 
   coll.hash = torch::lazy::HashCombine(
       coll.hash, torch::lazy::Hash(po_data.parameter_sequence));
+  if (ShardingUtil::UseSpmd()) {
+    coll.hash = torch::lazy::HashCombine(
+        coll.hash, ShardingUtil::GetShardingHash(po_data.post_order));
+  }
+  ComputeDonatableParameters(&coll, &po_data);
+  if (!po_data.donatable_parameters.empty()) {
+    // The donations are baked into the compiled computation, so graphs with
+    // different donatable parameters must not share it.
+    coll.hash = torch::lazy::HashCombine(
+        coll.hash, torch::lazy::Hash(po_data.donatable_parameters));
+  }
+  ComputeInPlaceUpdates(*tensors, &coll, &po_data);
+  for (auto& update : po_data.inplace_updates) {
+    coll.hash = torch::lazy::HashCombine(
+        coll.hash, torch::lazy::MHash(static_cast<int64_t>(update.first),
+                                      static_cast<int64_t>(update.second)));
+  }
   TF_VLOG(4) << "Parameter sequence graph hash "
              << torch::lazy::HashToString(coll.hash);
+  SpeculativeSync* speculative_sync = SpeculativeSync::Get();
+  if (speculative_sync != nullptr && !ShardingUtil::UseSpmd()) {
+    speculative_sync->RecordGraph(coll.hash);
+  }
+  DebugUtil::SaveTensorsGraphInfo("ScheduleSyncTensorsGraph", *tensors,
+                                  &coll.indices,
+                                  DebugUtil::GetDefaultGraphFormat(),
+                                  &coll.hash);
+  CompileAhead* compile_ahead = CompileAhead::Get();
   std::shared_ptr<Async> async = TryRunCachedSync(tensors, &coll, &po_data);
   if (async != nullptr) {
+    if (compile_ahead != nullptr) {
+      compile_ahead->RecordExecution(coll.hash, coll.device.toString(),
+                                     IsComputationCached);
+    }
     return async;
   }
 
-  CompilationResult compile_result = Compile(*tensors, devices, coll, &po_data);
-
-  XLA_VALUE_METRIC("TensorsGraphSize", compile_result.emitted_nodes);
-  TF_VLOG(5) << "TensorsGraphSize=" << compile_result.emitted_nodes;
-
-  auto cached_computation = std::make_shared<CachedComputation>(
-      std::move(compile_result.computation));
-  GetComputationCache()->Add(coll.hash, cached_computation);
+  CompilationArena* compilation_arena = CompilationArena::Get();
+  while (!compilation_arena->Enter(coll.hash)) {
+    // Another thread was compiling the same graph, which should now be cached.
+    async = TryRunCachedSync(tensors, &coll, &po_data);
+    if (async != nullptr) {
+      return async;
+    }
+  }
+  CompilationResult compile_result;
+  ComputationCache::TypePtr cached_computation;
+  PersistentCache* persistent_cache = PersistentCache::Get();
+  bool compiled = false;
+  {
+    // Waiters are released once the computation is within the cache.
+    xla::util::ExceptionCleanup compile_exit(
+        [&](xla::util::ExceptionCleanup::StatusType status) {
+          compilation_arena->Exit(coll.hash);
+          if (!compiled && persistent_cache != nullptr) {
+            // Let other processes waiting on this graph compile it.
+            persistent_cache->ReleaseLease(coll.hash);
+          }
+        });
+    if (UsePipelinedSync()) {
+      // Lowering needs the device data handles of the parameters.
+      TensorCollectionBarrier(&coll);
+    }
+    DebugUtil::ReportGraphHashDivergence(coll.device, coll.hash,
+                                         po_data.post_order,
+                                         po_data.parameter_sequence);
+    int64_t compile_start_ns = xla::sys_util::NowNs();
+    {
+      XLA_STEP_PHASE(kCompile);
+      compile_result = Compile(*tensors, devices, coll, &po_data);
+    }
+    compiled = true;
+
+    XLA_VALUE_METRIC("TensorsGraphSize", compile_result.emitted_nodes);
+    TF_VLOG(5) << "TensorsGraphSize=" << compile_result.emitted_nodes;
+
+    int64_t compile_time_ns = xla::sys_util::NowNs() - compile_start_ns;
+    GraphProfiler::Get()->RecordCompile(coll.hash, coll.device.toString(),
+                                        compile_time_ns, po_data.post_order);
+    cached_computation = std::make_shared<CachedComputation>(
+        std::move(compile_result.computation), compile_time_ns,
+        std::move(compile_result.spmd_info));
+    GetComputationCache()->Add(coll.hash, cached_computation);
+  }
+  XLA_VALUE_METRIC("CompilationCacheBytes", GetComputationCache()->GetBytes());
+  if (persistent_cache != nullptr) {
+    persistent_cache->Store(coll.hash, cached_computation->computation);
+    WarmStart* warm_start = WarmStart::Get();
+    if (warm_start != nullptr) {
+      warm_start->RecordGraph(coll.hash);
+    }
+  }
+  if (compile_ahead != nullptr) {
+    compile_ahead->RecordExecution(coll.hash, coll.device.toString(),
+                                   IsComputationCached);
+  }
 
   return ScheduleSyncTensorsGraph(
       tensors, &coll, std::move(compile_result.parameters_data),
@@ -1789,6 +3682,12 @@ bool XLATensor::UseEagerDebugMode() {
   return use_eager_debug_mode;
 }
 
+bool XLATensor::UseEagerMode() {
+  static const bool use_eager_mode =
+      xla::sys_util::GetEnvBool("XLA_USE_EAGER_MODE", false);
+  return use_eager_mode;
+}
+
 bool XLATensor::ShouldSyncIrNode() {
   if (!this->data()->ir_value) {
     return false;
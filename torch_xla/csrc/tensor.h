@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
@@ -11,6 +13,7 @@
 #include "tensorflow/compiler/xla/xla_client/async_task.h"
 #include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/future.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch/csrc/autograd/variable.h"
@@ -18,9 +21,11 @@
 #include "torch_xla/csrc/computation.h"
 #include "torch_xla/csrc/cross_replica_reduces.h"
 #include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/host_object_pool.h"
 #include "torch_xla/csrc/ir.h"
 #include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/quantized_ops.h"
 #include "torch_xla/csrc/view.h"
 #include "torch_xla/csrc/xla_sharding_util.h"
 
@@ -52,6 +57,8 @@ class XLATensor : public c10::intrusive_ptr_target {
   // LazyTensorPtr instead.
   XLATensor() = delete;
 
+  XLA_HOST_POOL_ALLOCATED
+
   size_t generation() const { return data()->generation; }
 
   XLATensorPtr alias() const {
@@ -131,6 +138,11 @@ class XLATensor : public c10::intrusive_ptr_target {
   // that is affected by the view tensor.
   static void ApplyEagerSync(std::vector<XLATensorPtr>& tensors);
 
+  // The eager mode (XLA_USE_EAGER_MODE) counts the created IR values, and
+  // every XLA_EAGER_MICRO_GRAPH_OPS of them asynchronously syncs the pending
+  // graphs of the live tensors of the device, as one micro graph.
+  static void ApplyEagerMicroGraph(const torch::lazy::BackendDevice& device);
+
   static torch::lazy::Value GetDeviceDataIrValue(
       const at::Scalar& value, xla::PrimitiveType type,
       const torch::lazy::BackendDevice& device);
@@ -138,6 +150,11 @@ class XLATensor : public c10::intrusive_ptr_target {
   // compared to the device_data.
   static torch::lazy::Value GetIrValueForConstant(const at::Scalar& value,
                                                   const xla::Shape& shape);
+  // Embeds the literal within the graph if it is at most
+  // XLA_CONSTANT_HOIST_BYTES, and feeds it as a cached (and read only) device
+  // data otherwise, so that the graph hash does not depend on its values.
+  static torch::lazy::Value GetIrValueForLiteral(
+      xla::Literal literal, const torch::lazy::BackendDevice& device);
   static torch::lazy::Value GetIrValueForScalar(
       const at::Scalar& value, xla::PrimitiveType type,
       const torch::lazy::BackendDevice& device);
@@ -206,14 +223,92 @@ class XLATensor : public c10::intrusive_ptr_target {
   // the computation boundaries.
   static void MarkStep(const torch::lazy::BackendDevice& device);
 
+  // Compiles the pending IR graph of the outputs tensors and records it for
+  // replay. The graph parameters are matched (by device data handle) against
+  // the inputs tensors, which must hold device data. Parameters which are not
+  // found within the inputs are captured as constants. Returns the hash by
+  // which the graph can be replayed with ReplayGraph().
+  static torch::lazy::hash_t CaptureGraph(
+      const std::vector<XLATensorPtr>& outputs,
+      const std::vector<XLATensorPtr>& inputs);
+
+  // Runs a graph previously recorded with CaptureGraph(), binding the device
+  // data of the inputs tensors to the captured parameter slots, without
+  // tracing, lowering or hashing the IR graph again. The execution is
+  // asynchronous, and the returned tensors are backed by placeholders which get
+  // filled once the execution completes.
+  static std::vector<XLATensorPtr> ReplayGraph(
+      const torch::lazy::hash_t& hash, const std::vector<XLATensorPtr>& inputs);
+
+  // Builds, from a graph previously recorded with CaptureGraph(), a graph
+  // running num_iterations iterations of it within a single XLA while loop,
+  // and records it for replay, returning its hash. The first num_carried
+  // outputs are fed back as the first num_carried inputs of the next
+  // iteration, and are returned after the last one, together with the last
+  // values of the other outputs. The inputs past num_carried are streamed: the
+  // replay takes them stacked along a new major dimension of num_iterations
+  // elements, every iteration taking its own slice.
+  static torch::lazy::hash_t CaptureLoop(const torch::lazy::hash_t& hash,
+                                         int64_t num_iterations,
+                                         size_t num_carried);
+
+  // Keeps the graph previously recorded with CaptureGraph() (or CaptureLoop()),
+  // and its executable, resident until UnfreezeGraph() gets called for it,
+  // whatever the XLA_REPLAY_CACHE_SIZE evictions.
+  static void FreezeGraph(const torch::lazy::hash_t& hash);
+
+  static void UnfreezeGraph(const torch::lazy::hash_t& hash);
+
   // Waits for all the outstanding operations on all the supplied devices.
   // If devices is empty, the wait will happen for all local devices.
   static void WaitDeviceOps(absl::Span<const std::string> devices);
 
   // Retrieves the PyTorch CPU tensors behind the XLA tensors IR operations.
-  // All the tensors must be on the same device.
+  // The tensors can live on different devices, in which case the pending IR
+  // of every device gets synced by its own graph, and the values of all the
+  // devices are read back with a single transfer (but with
+  // XLA_GET_TENSORS_OPBYOP, which needs a single device). With
+  // XLA_FETCH_CONCAT_MAX_BYTES set, the tensors up to that size are
+  // concatenated on their device first, so that one buffer per device and
+  // element type gets fetched.
   static std::vector<at::Tensor> GetTensors(std::vector<XLATensorPtr>* tensors);
 
+  // Same as GetTensors(), but stores the values within the caller supplied CPU
+  // tensors, which must have the same sizes as the XLA tensors.
+  static void GetTensorsInto(std::vector<XLATensorPtr>* tensors,
+                             absl::Span<at::Tensor> dest);
+
+  // The handle of an asynchronous GetTensors() operation.
+  struct AsyncFetch {
+    // Waits for the fetch to complete and returns the PyTorch CPU tensors.
+    // Errors which happened during the fetch are re-thrown here.
+    std::vector<at::Tensor> Wait();
+
+    bool IsDone() const { return tensors.IsReady(); }
+
+    xla::util::Future<std::vector<at::Tensor>> tensors;
+  };
+
+  // Same as GetTensors(), but returns right after the computation of the
+  // pending IR, if any, got scheduled. The device to host transfer, and the
+  // conversion to PyTorch tensors, run in the background. The device data is
+  // captured at call time, so later in-place updates of the tensors do not
+  // affect the result.
+  static std::shared_ptr<AsyncFetch> GetTensorsAsync(
+      std::vector<XLATensorPtr>* tensors);
+
+  // Moves the values of the tensors to host memory and drops their device
+  // data, whose buffers get released once the pending graphs using them have
+  // run. The tensors which already have a current host copy are not fetched.
+  // The host resident tensors get uploaded again when used.
+  static void OffloadTensors(std::vector<XLATensorPtr>* tensors);
+
+  // Starts the uploads of the host resident tensors, through the asynchronous
+  // transfer path, so that they overlap with the graphs which are running. The
+  // host copies are kept, so that offloading the tensors again is free if they
+  // are not updated in the meantime.
+  static void PrefetchTensors(absl::Span<const XLATensorPtr> tensors);
+
   // Operation which creates XLA tensors out of PyTorch CPU tensors by batching
   // the requests to the computation servers.
   static std::vector<XLATensorPtr> CreateTensors(
@@ -270,6 +365,39 @@ class XLATensor : public c10::intrusive_ptr_target {
       const XLATensorPtr& input, const torch::lazy::Value& token,
       std::vector<std::pair<int64_t, int64_t>> source_target_pairs);
 
+  // Returns the reduced input, the new error feedback residual, the relative
+  // compression error and the new token.
+  static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr,
+                    torch::lazy::Value>
+  compressed_all_reduce(const XLATensorPtr& input,
+                        const XLATensorPtr& residual,
+                        const torch::lazy::Value& token, double scale,
+                        xla::PrimitiveType wire_type,
+                        std::vector<std::vector<int64_t>> groups,
+                        bool pin_layout);
+
+  // Batch normalization with the statistics of all the replicas of the groups.
+  // Returns the output, the batch mean and (biased) variance, and the new
+  // token.
+  static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr,
+                    torch::lazy::Value>
+  sync_batch_norm(const XLATensorPtr& input, const XLATensorPtr& weight,
+                  const XLATensorPtr& bias, const torch::lazy::Value& token,
+                  double eps, std::vector<std::vector<int64_t>> groups,
+                  bool pin_layout);
+
+  // Returns the input, weight and bias gradients of sync_batch_norm(), and the
+  // new token.
+  static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr,
+                    torch::lazy::Value>
+  sync_batch_norm_backward(const XLATensorPtr& grad, const XLATensorPtr& input,
+                           const XLATensorPtr& weight,
+                           const XLATensorPtr& mean,
+                           const XLATensorPtr& variance,
+                           const torch::lazy::Value& token, double eps,
+                           std::vector<std::vector<int64_t>> groups,
+                           bool pin_layout);
+
   static XLATensorPtr get_dimensions_size(const XLATensorPtr& input,
                                           std::vector<int64_t> dimensions);
 
@@ -295,10 +423,55 @@ class XLATensor : public c10::intrusive_ptr_target {
       double weight_decay, double eps, bool amsgrad, bool maximize,
       bool use_adamw);
 
+  // Same as adam_optimizer_step_(), but for a list of parameters updated
+  // within a single IR node.
+  static void foreach_adam_optimizer_step_(
+      const XLATensorPtr& found_inf, absl::Span<const XLATensorPtr> steps,
+      absl::Span<const XLATensorPtr> params,
+      absl::Span<const XLATensorPtr> grads,
+      absl::Span<const XLATensorPtr> exp_avgs,
+      absl::Span<const XLATensorPtr> exp_avg_sqs,
+      absl::Span<const XLATensorPtr> max_exp_avg_sqs, double beta1,
+      double beta2, double lr, double weight_decay, double eps, bool amsgrad,
+      bool maximize, bool use_adamw);
+
+  static void lamb_optimizer_step_(const XLATensorPtr& found_inf,
+                                   absl::Span<const XLATensorPtr> steps,
+                                   absl::Span<const XLATensorPtr> params,
+                                   absl::Span<const XLATensorPtr> grads,
+                                   absl::Span<const XLATensorPtr> exp_avgs,
+                                   absl::Span<const XLATensorPtr> exp_avg_sqs,
+                                   double beta1, double beta2, double lr,
+                                   double weight_decay, double eps);
+
+  // The exp_avg_sqs are the second moments of the parameters of rank lower
+  // than 2, and the exp_avg_sq_rows and exp_avg_sq_cols the factored second
+  // moments of the others, each list following the order of the parameters.
+  static void adafactor_optimizer_step_(
+      const XLATensorPtr& found_inf, absl::Span<const XLATensorPtr> steps,
+      absl::Span<const XLATensorPtr> params,
+      absl::Span<const XLATensorPtr> grads,
+      absl::Span<const XLATensorPtr> exp_avg_sqs,
+      absl::Span<const XLATensorPtr> exp_avg_sq_rows,
+      absl::Span<const XLATensorPtr> exp_avg_sq_cols, double lr,
+      double weight_decay, double decay_rate, double eps1, double eps2,
+      double clip_threshold, bool scale_parameter);
+
   static std::vector<XLATensorPtr> user_computation(
       const std::string& opname, absl::Span<const XLATensorPtr> inputs,
       ComputationPtr computation);
 
+  // Enters a manual sharding region of the SPMD graphs, with the input sharded
+  // like the given sharding, and returns the per device shard of it.
+  static XLATensorPtr spmd_full_to_shard_shape(const XLATensorPtr& input,
+                                               xla::OpSharding sharding);
+
+  // Exits a manual sharding region, assembling the per device shards into the
+  // tensor of the full sizes, sharded like the given sharding.
+  static XLATensorPtr spmd_shard_to_full_shape(
+      const XLATensorPtr& input, xla::OpSharding sharding,
+      std::vector<int64_t> full_sizes);
+
   //////////////////////////////////////////////////////////////////////////////
   // ATEN operators follows here, listed in alphabetical order.
   //////////////////////////////////////////////////////////////////////////////
@@ -443,6 +616,11 @@ class XLATensor : public c10::intrusive_ptr_target {
                               const XLATensorPtr& batch2,
                               const at::Scalar& beta, const at::Scalar& alpha);
 
+  static std::pair<XLATensorPtr, XLATensorPtr> batched_nms(
+      const XLATensorPtr& boxes, const XLATensorPtr& scores,
+      const XLATensorPtr& idxs, const XLATensorPtr& score_threshold,
+      const XLATensorPtr& iou_threshold, int64_t output_size);
+
   static XLATensorPtr bernoulli(const XLATensorPtr& input, double probability);
   static XLATensorPtr bernoulli(const XLATensorPtr& input);
   static void bernoulli_(XLATensorPtr& input, double probability);
@@ -530,6 +708,12 @@ class XLATensor : public c10::intrusive_ptr_target {
       std::vector<int64_t> dilation, bool transposed,
       std::vector<int64_t> output_padding, int64_t groups);
 
+  // Crops the [N, 4] normalized (y0, x0, y1, x1) boxes out of the NCHW images,
+  // and bilinearly resizes them to output_size, as float images.
+  static XLATensorPtr crop_and_resize(const XLATensorPtr& input,
+                                      const XLATensorPtr& boxes,
+                                      std::vector<int64_t> output_size);
+
   // Returns the cross product of the two input tensors in the given dimension.
   // If the dimension is not given, it defaults to the first dimension found
   // with the size 3.
@@ -537,6 +721,20 @@ class XLATensor : public c10::intrusive_ptr_target {
                             const XLATensorPtr& other,
                             c10::optional<int64_t> dim);
 
+  // Returns the cross entropy loss of the logits and the class indices target
+  // (the same as nll_loss(log_softmax(input, 1))), and the logsumexp of the
+  // logits the backward needs.
+  static std::tuple<XLATensorPtr, XLATensorPtr> cross_entropy(
+      const XLATensorPtr& input, const XLATensorPtr& target,
+      const XLATensorPtr& weight, int64_t reduction, int64_t ignore_index,
+      double label_smoothing);
+
+  static XLATensorPtr cross_entropy_backward(
+      const XLATensorPtr& grad_output, const XLATensorPtr& input,
+      const XLATensorPtr& target, const XLATensorPtr& logsumexp,
+      const XLATensorPtr& weight, int64_t reduction, int64_t ignore_index,
+      double label_smoothing);
+
   // Returns the cumulative product of elements of input in the given dimension.
   static XLATensorPtr cumprod(const XLATensorPtr& input, int64_t dim,
                               c10::optional<at::ScalarType> dtype);
@@ -561,6 +759,26 @@ class XLATensor : public c10::intrusive_ptr_target {
       c10::optional<at::ScalarType> logical_element_type = c10::nullopt);
   static XLATensorPtr div(const XLATensorPtr& input, const at::Scalar& other);
 
+  // Returns input with the slice starting at the device scalar offset along
+  // dim (and zero along the other dimensions) replaced by source, which must
+  // match input but along dim.
+  static XLATensorPtr dynamic_update_slice(const XLATensorPtr& input,
+                                           const XLATensorPtr& source,
+                                           const XLATensorPtr& offset,
+                                           int64_t dim);
+
+  // Returns the dropout of the input, and the tensor to save for the backward
+  // pass: the keep mask packed one bit per element in S32 words, or, if
+  // regenerate_mask is true, the seed the backward generates the mask again
+  // from.
+  static std::tuple<XLATensorPtr, XLATensorPtr> dropout(
+      const XLATensorPtr& input, double probability, bool regenerate_mask);
+
+  static XLATensorPtr dropout_backward(const XLATensorPtr& grad_output,
+                                       const XLATensorPtr& mask,
+                                       double probability,
+                                       bool regenerate_mask);
+
   // A generalized contraction between tensors of arbitrary dimension defined by
   // the given equation and applied to the input tensors.
   static XLATensorPtr einsum(const std::string& equation,
@@ -577,6 +795,30 @@ class XLATensor : public c10::intrusive_ptr_target {
                                    const at::Scalar& input_scale,
                                    const XLATensorPtr& output);
 
+  // Reduces (with the ATen mode of sum, mean or max) the weight rows selected
+  // by the indices within the bags starting at offsets. Returns the output,
+  // offset2bag, bag_size and max_indices of the ATen _embedding_bag().
+  static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr, XLATensorPtr>
+  embedding_bag(const XLATensorPtr& weight, const XLATensorPtr& indices,
+                const XLATensorPtr& offsets, int64_t mode,
+                const XLATensorPtr& per_sample_weights,
+                bool include_last_offset, int64_t padding_idx);
+
+  static XLATensorPtr embedding_bag_backward(
+      const XLATensorPtr& grad, const XLATensorPtr& indices,
+      const XLATensorPtr& offset2bag, const XLATensorPtr& bag_size,
+      const XLATensorPtr& max_indices, int64_t num_weights,
+      bool scale_grad_by_freq, int64_t mode,
+      const XLATensorPtr& per_sample_weights, int64_t padding_idx);
+
+  // Applies an SGD step to the weight of an embedding bag, given the gradient
+  // of its output, only updating the weight rows selected by the indices.
+  static void embedding_bag_sparse_sgd_(
+      XLATensorPtr& weight, const XLATensorPtr& grad,
+      const XLATensorPtr& indices, const XLATensorPtr& offsets, double lr,
+      int64_t mode, const XLATensorPtr& per_sample_weights,
+      bool include_last_offset, int64_t padding_idx);
+
   static XLATensorPtr embedding_dense_backward(const XLATensorPtr& grad_output,
                                                const XLATensorPtr& indices,
                                                int64_t num_weights,
@@ -604,6 +846,23 @@ class XLATensor : public c10::intrusive_ptr_target {
   // Fills the input with the given value.
   static void fill_(XLATensorPtr& input, const at::Scalar& value);
 
+  // Computes the scaled dot product attention of the query, key and value
+  // (with an optional boolean or additive mask), returning the attention output
+  // and the logsumexp of the scores rows.
+  static std::tuple<XLATensorPtr, XLATensorPtr> flash_attention(
+      const XLATensorPtr& query, const XLATensorPtr& key,
+      const XLATensorPtr& value, const XLATensorPtr& mask, double scale,
+      bool is_causal);
+
+  static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr>
+  flash_attention_backward(const XLATensorPtr& grad_output,
+                           const XLATensorPtr& query, const XLATensorPtr& key,
+                           const XLATensorPtr& value,
+                           const XLATensorPtr& output,
+                           const XLATensorPtr& logsumexp,
+                           const XLATensorPtr& mask, double scale,
+                           bool is_causal);
+
   // Flips (reverses) the values in the dimensions of the input tensor.
   static XLATensorPtr flip(const XLATensorPtr& input,
                            absl::Span<const int64_t> dims);
@@ -615,6 +874,47 @@ class XLATensor : public c10::intrusive_ptr_target {
       const XLATensorPtr& input, const at::Scalar& other,
       c10::optional<at::ScalarType> logical_element_type = c10::nullopt);
 
+  // Elementwise operations over non empty lists of tensors, within a single IR
+  // node. The tensors at the same position in the lists must have the same
+  // shape.
+  static std::vector<XLATensorPtr> foreach_add(
+      absl::Span<const XLATensorPtr> inputs, const at::Scalar& other);
+  static void foreach_add_(absl::Span<const XLATensorPtr> inputs,
+                           const at::Scalar& other);
+  static std::vector<XLATensorPtr> foreach_add(
+      absl::Span<const XLATensorPtr> inputs,
+      absl::Span<const XLATensorPtr> others, const at::Scalar& alpha);
+  static void foreach_add_(absl::Span<const XLATensorPtr> inputs,
+                           absl::Span<const XLATensorPtr> others,
+                           const at::Scalar& alpha);
+
+  static std::vector<XLATensorPtr> foreach_addcmul(
+      absl::Span<const XLATensorPtr> inputs,
+      absl::Span<const XLATensorPtr> tensors1,
+      absl::Span<const XLATensorPtr> tensors2, const at::Scalar& value);
+  static void foreach_addcmul_(absl::Span<const XLATensorPtr> inputs,
+                               absl::Span<const XLATensorPtr> tensors1,
+                               absl::Span<const XLATensorPtr> tensors2,
+                               const at::Scalar& value);
+
+  // Scales the inputs so that their global norm is at most max_norm, and
+  // returns such norm (before the scaling).
+  static XLATensorPtr foreach_clip_norm_(absl::Span<const XLATensorPtr> inputs,
+                                         double max_norm, double norm_type);
+
+  static std::vector<XLATensorPtr> foreach_mul(
+      absl::Span<const XLATensorPtr> inputs, const at::Scalar& other);
+  static void foreach_mul_(absl::Span<const XLATensorPtr> inputs,
+                           const at::Scalar& other);
+  static std::vector<XLATensorPtr> foreach_mul(
+      absl::Span<const XLATensorPtr> inputs,
+      absl::Span<const XLATensorPtr> others);
+  static void foreach_mul_(absl::Span<const XLATensorPtr> inputs,
+                           absl::Span<const XLATensorPtr> others);
+
+  static std::vector<XLATensorPtr> foreach_norm(
+      absl::Span<const XLATensorPtr> inputs, double norm_type);
+
   static XLATensorPtr frac(const XLATensorPtr& input);
 
   static XLATensorPtr full(absl::Span<const int64_t> size,
@@ -715,11 +1015,30 @@ class XLATensor : public c10::intrusive_ptr_target {
                                           const XLATensorPtr& input,
                                           const at::Scalar& lambda);
 
+  // Streams the input to the registered host callback while the computation
+  // runs. Returns the input, to be used in its place.
+  static XLATensorPtr host_callback(const XLATensorPtr& input,
+                                    int64_t callback_id);
+
   static XLATensorPtr hardtanh_backward(const XLATensorPtr& grad_output,
                                         const XLATensorPtr& input,
                                         const at::Scalar& min_val,
                                         const at::Scalar& max_val);
 
+  // Normalizes the last normalized_ndim dimensions of the input (only scaling
+  // them by their root mean square if rms is true), returning the output and
+  // the mean and rstd of the normalized rows.
+  static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr> layer_norm(
+      const XLATensorPtr& input, int64_t normalized_ndim,
+      const XLATensorPtr& weight, const XLATensorPtr& bias, double eps,
+      bool rms);
+
+  static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr>
+  layer_norm_backward(const XLATensorPtr& grad_output,
+                      const XLATensorPtr& input, const XLATensorPtr& mean,
+                      const XLATensorPtr& rstd, const XLATensorPtr& weight,
+                      int64_t normalized_ndim, bool rms);
+
   static XLATensorPtr leaky_relu(const XLATensorPtr& input,
                                  double negative_slope);
   static XLATensorPtr leaky_relu_backward(const XLATensorPtr& grad_output,
@@ -774,6 +1093,12 @@ class XLATensor : public c10::intrusive_ptr_target {
   static XLATensorPtr masked_select(const XLATensorPtr& input,
                                     const XLATensorPtr& mask);
 
+  // Same as masked_select(), but the values keep the static size of the input
+  // elements, with zeros past the selected count returned as second output, so
+  // that reading the size of the result does not need a sync.
+  static std::tuple<XLATensorPtr, XLATensorPtr> masked_select_padded(
+      const XLATensorPtr& input, const XLATensorPtr& mask);
+
   static XLATensorPtr matmul(const XLATensorPtr& input,
                              const XLATensorPtr& other);
 
@@ -910,6 +1235,10 @@ class XLATensor : public c10::intrusive_ptr_target {
 
   static XLATensorPtr nonzero(const XLATensorPtr& input);
 
+  // Same as nonzero(), with the indices padded like masked_select_padded().
+  static std::tuple<XLATensorPtr, XLATensorPtr> nonzero_padded(
+      const XLATensorPtr& input);
+
   static XLATensorPtr norm(const XLATensorPtr& input,
                            const c10::optional<at::Scalar>& p,
                            c10::optional<at::ScalarType> dtype,
@@ -953,6 +1282,22 @@ class XLATensor : public c10::intrusive_ptr_target {
   static std::tuple<XLATensorPtr, XLATensorPtr> qr(const XLATensorPtr& input,
                                                    bool some);
 
+  // The int8 linear layer and convolution, with int32 accumulation and per
+  // output channel weight scales. The outputs are int8 if params has an output
+  // scale, and the dequantized float values otherwise.
+  static XLATensorPtr quantized_linear(const XLATensorPtr& input,
+                                       const XLATensorPtr& weight,
+                                       const XLATensorPtr& weight_scales,
+                                       const XLATensorPtr& bias,
+                                       const QuantizationParams& params);
+
+  static XLATensorPtr quantized_convolution(
+      const XLATensorPtr& input, const XLATensorPtr& weight,
+      const XLATensorPtr& weight_scales, const XLATensorPtr& bias,
+      std::vector<int64_t> stride, std::vector<int64_t> padding,
+      std::vector<int64_t> dilation, int64_t groups,
+      const QuantizationParams& params);
+
   static void random_(XLATensorPtr& input, int64_t from, int64_t to);
 
   static XLATensorPtr randperm(int64_t n,
@@ -1042,7 +1387,6 @@ class XLATensor : public c10::intrusive_ptr_target {
   static XLATensorPtr silu(const XLATensorPtr& input);
   static XLATensorPtr silu_backward(XLATensorPtr& grad_output,
                                     XLATensorPtr& input);
-  static XLATensorPtr sigmoid(const XLATensorPtr& input);
   static XLATensorPtr sigmoid_backward(const XLATensorPtr& grad_output,
                                        const XLATensorPtr& output);
 
@@ -1090,8 +1434,6 @@ class XLATensor : public c10::intrusive_ptr_target {
   static std::vector<XLATensorPtr> split_with_sizes(
       const XLATensorPtr& input, std::vector<int64_t> split_size, int64_t dim);
 
-  static XLATensorPtr sqrt(const XLATensorPtr& input);
-
   // Squeeze out all trivial (size 1) dimensions.
   static XLATensorPtr squeeze(const XLATensorPtr& input);
 
@@ -1131,6 +1473,18 @@ class XLATensor : public c10::intrusive_ptr_target {
   static std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr> svd(
       const XLATensorPtr& input, bool some, bool compute_uv);
 
+  // Folds the value into the F32[kSummaryScalarStateSize] state of a scalar
+  // summary, in place.
+  static void summary_scalar_update_(XLATensorPtr& state,
+                                     const XLATensorPtr& value,
+                                     double ema_decay);
+
+  // Adds the value elements to the bin counts of a histogram summary state, in
+  // place.
+  static void summary_histogram_update_(XLATensorPtr& state,
+                                        const XLATensorPtr& value,
+                                        double min_value, double max_value);
+
   static std::tuple<XLATensorPtr, XLATensorPtr> symeig(
       const XLATensorPtr& input, bool eigenvectors, bool upper);
 
@@ -1230,11 +1584,20 @@ class XLATensor : public c10::intrusive_ptr_target {
   };
 
   std::shared_ptr<ShardingSpec> sharding_spec() const;
+  // The sharding the host data of the tensor gets uploaded with, or nullptr
+  // if it gets uploaded to the tensor device.
+  const xla::OpSharding* GetUploadSharding() const;
   bool IsShardingAnnotated() const;
   void SetShardingSpec(const xla::OpSharding& sharding, bool replicated,
                        bool manual);
   void ClearShardingSpec();
 
+  // Whether the tensor accumulates values (like gradients over micro-batches)
+  // in place, so that the syncs outside of the step barrier can write its own
+  // update into the buffer of its device data (see ComputeInPlaceUpdates()).
+  bool IsAccumulator() const { return data()->accumulator; }
+  void SetAccumulator(bool accumulator) { data()->accumulator = accumulator; }
+
  private:
   struct SyncTensorsConfig {
     // Whether we want to force XLA data on the target tensors (hence trimming
@@ -1243,6 +1606,13 @@ class XLATensor : public c10::intrusive_ptr_target {
     // Whether when setting the XLA data, the other properties of the tensor
     // state should be reset.
     bool sync_xla_data = true;
+    // Whether the sync roots can be sorted by their IR hash, when the
+    // canonical graph hashing (XLA_CANONICAL_GRAPH_HASH) is enabled.
+    bool canonical_roots = true;
+    // Whether the sync is the one of a fetch, which waits for the device data
+    // of the tensors itself, so that it does not need the device barrier when
+    // there is nothing to sync.
+    bool fetch = false;
   };
 
   struct SyncTensorCollection {
@@ -1260,6 +1630,10 @@ class XLATensor : public c10::intrusive_ptr_target {
     torch::lazy::Util::EmissionMap emission_map;
     std::vector<torch::lazy::BackendDataPtr> parameters_data;
     std::vector<size_t> parameter_sequence;
+    std::vector<size_t> donatable_parameters;
+    // The (parameter index, output index) pairs of the in-place updates whose
+    // output can be written into the buffer of the updated parameter.
+    std::vector<std::pair<size_t, size_t>> inplace_updates;
   };
 
   struct CompilationResult {
@@ -1267,20 +1641,53 @@ class XLATensor : public c10::intrusive_ptr_target {
     size_t emitted_nodes = 0;
     std::shared_ptr<xla::ComputationClient::Computation> computation;
     std::vector<torch::lazy::BackendDataPtr> parameters_data;
+    // Set if the computation got partitioned with XLA_USE_SPMD.
+    std::shared_ptr<SpmdComputationInfo> spmd_info;
   };
 
   struct CachedComputation {
     CachedComputation(
-        std::shared_ptr<xla::ComputationClient::Computation> computation)
-        : computation(std::move(computation)) {}
+        std::shared_ptr<xla::ComputationClient::Computation> computation,
+        int64_t compile_time_ns = 0,
+        std::shared_ptr<SpmdComputationInfo> spmd_info = nullptr)
+        : computation(std::move(computation)),
+          compile_time_ns(compile_time_ns),
+          spmd_info(std::move(spmd_info)) {}
 
     std::shared_ptr<xla::ComputationClient::Computation> computation;
+    // The time it took to compile the computation, or zero if unknown (like
+    // for computations loaded from the persistent cache).
+    int64_t compile_time_ns = 0;
+    std::shared_ptr<SpmdComputationInfo> spmd_info;
   };
 
   using ComputationCache =
       xla::util::Cache<torch::lazy::hash_t, CachedComputation,
                        torch::lazy::HashReducer>;
 
+  struct ReplayGraphInfo {
+    torch::lazy::BackendDevice device;
+    ComputationCache::TypePtr cached_computation;
+    // For every parameter of the computation, the index of the input tensor
+    // which feeds it, or -1 if the parameter is a captured constant.
+    std::vector<int64_t> input_indices;
+    std::vector<torch::lazy::BackendDataPtr> constants;
+    std::vector<xla::Shape> output_shapes;
+    std::vector<c10::optional<at::ScalarType>> output_types;
+  };
+
+  using ReplayCache = xla::util::Cache<torch::lazy::hash_t, ReplayGraphInfo,
+                                       torch::lazy::HashReducer>;
+
+  // The captured graphs which are out of the replay cache eviction, together
+  // with their executables.
+  struct FrozenGraphs {
+    std::mutex lock;
+    std::unordered_map<torch::lazy::hash_t, ReplayCache::TypePtr,
+                       torch::lazy::HashReducer>
+        graphs;
+  };
+
   struct Async {
     Async(SyncTensorCollection* coll,
           std::vector<torch::lazy::BackendDataPtr> parameters_data,
@@ -1289,7 +1696,12 @@ class XLATensor : public c10::intrusive_ptr_target {
 
     void Wait();
 
+    // Signaled once the execution completed, after the mwait. The
+    // continuations chained on the future run on the thread of the execution.
+    xla::util::Future<int> GetFuture() const { return completion.GetFuture(); }
+
     xla::util::MultiWait mwait;
+    xla::util::Promise<int> completion;
     std::vector<size_t> indices;
     std::vector<xla::util::ExceptionCleanup> unlocker;
     std::vector<torch::lazy::BackendDataPtr> parameters_data;
@@ -1338,10 +1750,14 @@ class XLATensor : public c10::intrusive_ptr_target {
     const torch::lazy::BackendDevice device;
     const int64_t unique_id = 0;
     size_t generation = 1;
+    // The handle of the live tensor registry of the device, zero when the
+    // tensor is not registered.
+    uint64_t registry_handle = 0;
 
     // Sharding annotation for the tensor
     // TODO(yeounoh) detach & clear for the unpartitioned tensor
     std::shared_ptr<ShardingSpec> sharding_spec;
+    bool accumulator = false;
   };
 
   XLATensor(const at::Tensor& tensor, const torch::lazy::BackendDevice& device);
@@ -1370,11 +1786,22 @@ class XLATensor : public c10::intrusive_ptr_target {
 
   void AssignIrValue(torch::lazy::Value ir_value) const;
 
+  // Feeds the IR value of the tensor to the speculative sync, if enabled.
+  void RecordSpeculativeValue() const;
+
   void SetTensorData(at::Tensor tensor_data);
 
+  // Drops the device data of the tensor, whose value is the given host one.
+  void OffloadXlaData(at::Tensor tensor_data);
+
   torch::lazy::Value CreateTensorNode(torch::lazy::BackendDataPtr data,
                                       bool read_only) const;
 
+  // Returns the device data holding the current value of the tensor, marked
+  // as shared so that no in-place update ever gets aliased to its buffer, or
+  // nullptr if the tensor has no device data which can be shared.
+  torch::lazy::BackendDataPtr GetSharedXlaData() const;
+
   View::IrNode GetViewUpdate(const std::shared_ptr<View>& view) const;
 
   std::shared_ptr<View> UpdateView(std::shared_ptr<View> view,
@@ -1412,6 +1839,20 @@ class XLATensor : public c10::intrusive_ptr_target {
   //     a = a + b
   void TryLimitGraphSize();
 
+  // Syncs the IR graph of this tensor (or of all the live tensors on its
+  // device, if XLA_TRIM_GRAPH_LIVE_TENSORS is set) to limit its size.
+  void TrimGraph();
+
+  // Releases the pending IR which the live tensors of the device keep alive,
+  // but which cannot be observed anymore (XLA_RELEASE_DEAD_IR).
+  static void ReleaseDeadIr(const torch::lazy::BackendDevice& device);
+
+  // Turns this tensor back into a plain one, if it is a view whose alias is
+  // not shared with any other view anymore (the other views have been
+  // destroyed or overwritten). Such alias keeps alive the IR value the view
+  // was created from, which the tensor IR might not depend upon anymore.
+  bool ReleaseDeadView();
+
   std::vector<XLATensorPtr> MakeOutputTensors(
       torch::lazy::NodePtr node, bool inherit_logical_type = true) const;
 
@@ -1420,6 +1861,16 @@ class XLATensor : public c10::intrusive_ptr_target {
 
   static ComputationCache* GetComputationCache();
 
+  static ReplayCache* GetReplayCache();
+
+  static FrozenGraphs* GetFrozenGraphs();
+
+  // Returns the captured graph with the given hash, frozen or not, or nullptr
+  // if missing.
+  static ReplayCache::TypePtr GetReplayGraph(const torch::lazy::hash_t& hash);
+
+  static bool IsComputationCached(const torch::lazy::hash_t& hash);
+
   static SyncTensorCollection CollectSyncTensors(
       const std::vector<XLATensorPtr>& tensors,
       const SyncTensorsConfig& config);
@@ -1434,6 +1885,17 @@ class XLATensor : public c10::intrusive_ptr_target {
   static std::vector<at::Tensor> GetTensorsFused(
       std::vector<XLATensorPtr>* tensors);
 
+  // Implementation of GetTensorsFused() and GetTensorsInto(), for tensors
+  // living on one or more devices. See FetchTensors() for the dest argument.
+  static std::vector<at::Tensor> GetTensorsMultiDevice(
+      std::vector<XLATensorPtr>* tensors, absl::Span<at::Tensor> dest);
+
+  // Same as GetTensorsMultiDevice(), but the tensors up to max_bytes are
+  // fetched as one flat tensor per device and element type, concatenated on
+  // the device, whose views are returned.
+  static std::vector<at::Tensor> GetTensorsConcatenated(
+      std::vector<XLATensorPtr>* tensors, int64_t max_bytes);
+
   // Runs an asynchronous syn operation using the op-by-op executor.
   using OpByOpAsync = xla::util::AsyncTask<int>;
   static OpByOpAsync SyncTensorsGraphOpByOp(
@@ -1453,13 +1915,34 @@ class XLATensor : public c10::intrusive_ptr_target {
 
   static std::vector<torch::lazy::BackendDataPtr> FetchTensorData(
       std::vector<XLATensorPtr>* tensors, const SyncTensorsConfig& config,
-      absl::Span<const size_t> indices);
+      absl::Span<const size_t> indices,
+      const SpmdComputationInfo* spmd_info = nullptr);
 
+  // If dest is not empty, the values are stored within its CPU tensors
+  // (which are also the ones returned), instead of newly allocated ones.
   static std::vector<at::Tensor> FetchTensors(
-      std::vector<XLATensorPtr>* tensors,
-      absl::Span<const xla::Literal> literals,
+      std::vector<XLATensorPtr>* tensors, absl::Span<xla::Literal> literals,
+      const std::vector<size_t>* indices,
+      absl::Span<at::Tensor> dest = absl::Span<at::Tensor>());
+
+  // The state of the tensors which FetchTensors() reads, captured on the
+  // calling thread, so that the conversion can run on another one while the
+  // tensors keep being updated.
+  struct FetchSnapshot {
+    std::vector<at::ScalarType> dtypes;
+    // The current host data of the tensors which are not in the sync indices,
+    // if any. The other tensors get their values from the literals.
+    std::vector<c10::optional<at::Tensor>> tensors_data;
+  };
+
+  static FetchSnapshot TakeFetchSnapshot(
+      const std::vector<XLATensorPtr>& tensors,
       const std::vector<size_t>* indices);
 
+  static std::vector<at::Tensor> FetchTensors(
+      const FetchSnapshot& snapshot, absl::Span<xla::Literal> literals,
+      absl::Span<at::Tensor> dest = absl::Span<at::Tensor>());
+
   // Schedules the execution of a sync tensors operation in background. The
   // asynchronous operation will hold the device locks by capturing the ones
   // present within the coll structure.
@@ -1477,6 +1960,17 @@ class XLATensor : public c10::intrusive_ptr_target {
   static PostOrderData RunPostOrder(const std::vector<XLATensorPtr>& tensors,
                                     SyncTensorCollection* coll);
 
+  // Loads the computation of the graph hash from the compile-ahead, warm start
+  // or persistent caches into the computation cache, returning nullptr if none
+  // has it. With acquire_lease, a persistent cache miss leaves this process
+  // holding the lease to compile the graph.
+  static ComputationCache::TypePtr LoadCachedCompile(
+      const torch::lazy::hash_t& hash, bool acquire_lease);
+
+  // Loads the computation of the graph hash into the computation cache, if
+  // missing from it, ahead of its sync (see SpeculativeSync).
+  static void PreloadCachedCompile(const torch::lazy::hash_t& hash);
+
   static ComputationCache::TypePtr LookupCachedCompile(
       const std::vector<XLATensorPtr>& tensors,
       const torch::lazy::hash_t& hash);
@@ -1485,9 +1979,36 @@ class XLATensor : public c10::intrusive_ptr_target {
       std::vector<XLATensorPtr>* tensors, SyncTensorCollection* coll,
       PostOrderData* po_data);
 
-  static void BuildInputOutputAliases(const std::vector<XLATensorPtr>& tensors,
-                                      absl::Span<const size_t> indices,
-                                      LoweringContext* lowering_ctx);
+  // Computes (within po_data) the indices of the parameters whose device data
+  // is not referenced by any live tensor, and which can hence be donated to
+  // outputs of the same shape.
+  static void ComputeDonatableParameters(SyncTensorCollection* coll,
+                                         PostOrderData* po_data);
+
+  // Computes (within po_data) the outputs which are in-place updates (like
+  // index_put_() or scatter_()) of the device data of their own tensor, whose
+  // buffer is referenced by nothing outside of the synced graph. They can be
+  // aliased even outside of the step barrier (see XLA_INPLACE_UPDATES). The
+  // accumulator tensors count as in-place updates of their device data,
+  // whatever their IR graph, and regardless of XLA_INPLACE_UPDATES.
+  static void ComputeInPlaceUpdates(const std::vector<XLATensorPtr>& tensors,
+                                    SyncTensorCollection* coll,
+                                    PostOrderData* po_data);
+
+  static void BuildInputOutputAliases(
+      const std::vector<XLATensorPtr>& tensors,
+      absl::Span<const size_t> indices,
+      absl::Span<const size_t> donatable_parameters,
+      LoweringContext* lowering_ctx);
+
+  // Lowers all the nodes of the post order, skipping the ones made redundant
+  // by the IR simplification, and splitting the lowering of big graphs among
+  // threads, if enabled.
+  static void LowerPostOrder(
+      absl::Span<const torch::lazy::Node* const> post_order,
+      absl::Span<const size_t> parameter_sequence,
+      absl::Span<const torch::lazy::Output> roots,
+      LoweringContext* lowering_ctx);
 
   static CompilationResult Compile(const std::vector<XLATensorPtr>& tensors,
                                    absl::Span<const std::string> devices,
@@ -1502,6 +2023,8 @@ class XLATensor : public c10::intrusive_ptr_target {
 
   static bool UseEagerDebugMode();
 
+  static bool UseEagerMode();
+
   bool ShouldSyncIrNode();
 
   std::shared_ptr<Data> data_;
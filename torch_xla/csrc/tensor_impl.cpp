@@ -4,6 +4,9 @@
 #include <c10/core/impl/DeviceGuardImplInterface.h>
 #include <c10/macros/Macros.h>
 
+#include <algorithm>
+
+#include "absl/types/span.h"
 #include "tensorflow/compiler/xla/xla_client/computation_client.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "torch/csrc/lazy/core/tensor_util.h"
@@ -99,7 +102,7 @@ c10::intrusive_ptr<c10::TensorImpl> XLATensorImpl::shallow_copy_and_detach(
 
 void XLATensorImpl::shallow_copy_from(
     const c10::intrusive_ptr<TensorImpl>& impl) {
-  XLATensorImpl* xla_impl = dynamic_cast<XLATensorImpl*>(impl.get());
+  XLATensorImpl* xla_impl = static_cast<XLATensorImpl*>(impl.get());
   copy_tensor_metadata(
       /*src_impl=*/xla_impl,
       /*dest_impl=*/this,
@@ -149,24 +152,30 @@ bool XLATensorImpl::is_contiguous_custom(at::MemoryFormat memory_format) const {
 
 void XLATensorImpl::SetupSizeProperties() {
   size_t generation = tensor_->generation();
-  if (generation != generation_) {
+  if (generation == generation_) {
+    return;
+  }
+  // Most IR updates (like the in-place ones) keep the tensor shape, in which
+  // case the sizes and strides are left alone, and only the generation moves.
+  auto shape = tensor_->shape();
+  absl::Span<const int64_t> dimensions = shape.get().dimensions();
+  at::IntArrayRef sizes = sizes_and_strides_.sizes_arrayref();
+  if (generation_ == 0 ||
+      !std::equal(dimensions.begin(), dimensions.end(), sizes.begin(),
+                  sizes.end())) {
     // Fill up the basic dimension data members which the base class
     // implementation uses in its APIs.
-    auto shape = tensor_->shape();
-    c10::SmallVector<int64_t, 5> updated_sizes;
-    numel_ = 1;
-    for (auto dim : shape.get().dimensions()) {
-      updated_sizes.push_back(dim);
-      numel_ *= dim;
-    }
-    sizes_and_strides_.set_sizes(updated_sizes);
-    auto updated_strides = torch::lazy::ComputeArrayStrides(
-        torch::lazy::ToVector<int64_t>(shape.get().dimensions()));
-    for (int i = 0; i < updated_strides.size(); i++) {
-      sizes_and_strides_.stride_at_unchecked(i) = updated_strides[i];
+    sizes_and_strides_.set_sizes(
+        at::IntArrayRef(dimensions.data(), dimensions.size()));
+    int64_t stride = 1;
+    for (int64_t i = static_cast<int64_t>(dimensions.size()) - 1; i >= 0;
+         --i) {
+      sizes_and_strides_.stride_at_unchecked(i) = stride;
+      stride *= dimensions[i];
     }
-    generation_ = generation;
+    numel_ = stride;
   }
+  generation_ = generation;
 }
 
 caffe2::TypeMeta XLATensorImpl::GetTypeMeta(const XLATensor& tensor) {
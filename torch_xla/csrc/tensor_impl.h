@@ -4,18 +4,21 @@
 #include <c10/core/Storage.h>
 #include <c10/core/TensorImpl.h>
 
+#include "torch_xla/csrc/host_object_pool.h"
 #include "torch_xla/csrc/tensor.h"
 
 namespace torch_xla {
 
 // Tensor implementation class used to be fed to the at::Tensor.
 // Its scope is just to handle an XLATensor.
-class XLATensorImpl : public c10::TensorImpl {
+class XLATensorImpl final : public c10::TensorImpl {
  public:
   explicit XLATensorImpl(XLATensor&& tensor);
   explicit XLATensorImpl(XLATensor& tensor);
   explicit XLATensorImpl(XLATensorPtr tensor);
 
+  XLA_HOST_POOL_ALLOCATED
+
   XLATensorPtr& tensor() { return tensor_; }
 
   void set_tensor(XLATensorPtr xla_tensor);
@@ -15,11 +15,13 @@
 #include "torch/csrc/lazy/core/util.h"
 #include "torch_xla/csrc/aten_xla_bridge.h"
 #include "torch_xla/csrc/data_ops.h"
+#include "torch_xla/csrc/flash_attention.h"
 #include "torch_xla/csrc/generated/LazyIr.h"
 #include "torch_xla/csrc/helpers.h"
 #include "torch_xla/csrc/ir_util.h"
 #include "torch_xla/csrc/layout_manager.h"
 #include "torch_xla/csrc/lowering_context.h"
+#include "torch_xla/csrc/ops/adafactor_optimizer_step.h"
 #include "torch_xla/csrc/ops/adam_optimizer_step.h"
 #include "torch_xla/csrc/ops/adaptive_avg_pool3d.h"
 #include "torch_xla/csrc/ops/adaptive_max_pool2d.h"
@@ -46,27 +48,38 @@
 #include "torch_xla/csrc/ops/cat.h"
 #include "torch_xla/csrc/ops/cholesky.h"
 #include "torch_xla/csrc/ops/collective_permute.h"
+#include "torch_xla/csrc/ops/compressed_all_reduce.h"
 #include "torch_xla/csrc/ops/constant.h"
 #include "torch_xla/csrc/ops/constant_pad_nd.h"
 #include "torch_xla/csrc/ops/convolution_backward_overrideable.h"
 #include "torch_xla/csrc/ops/convolution_overrideable.h"
+#include "torch_xla/csrc/ops/crop_and_resize.h"
+#include "torch_xla/csrc/ops/cross_entropy.h"
 #include "torch_xla/csrc/ops/cumprod.h"
 #include "torch_xla/csrc/ops/cumsum.h"
 #include "torch_xla/csrc/ops/device_data.h"
 #include "torch_xla/csrc/ops/diagonal.h"
 #include "torch_xla/csrc/ops/discrete_uniform.h"
+#include "torch_xla/csrc/ops/dropout.h"
+#include "torch_xla/csrc/ops/embedding_bag.h"
 #include "torch_xla/csrc/ops/expand.h"
 #include "torch_xla/csrc/ops/exponential.h"
+#include "torch_xla/csrc/ops/flash_attention.h"
+#include "torch_xla/csrc/ops/foreach_adam_optimizer_step.h"
+#include "torch_xla/csrc/ops/foreach_ops.h"
 #include "torch_xla/csrc/ops/flip.h"
 #include "torch_xla/csrc/ops/gather.h"
 #include "torch_xla/csrc/ops/generic.h"
 #include "torch_xla/csrc/ops/get_dimensions_size.h"
 #include "torch_xla/csrc/ops/hardshrink.h"
 #include "torch_xla/csrc/ops/hardtanh_backward.h"
+#include "torch_xla/csrc/ops/host_callback.h"
 #include "torch_xla/csrc/ops/index_ops.h"
 #include "torch_xla/csrc/ops/index_select.h"
 #include "torch_xla/csrc/ops/infer_output_shape.h"
 #include "torch_xla/csrc/ops/kth_value.h"
+#include "torch_xla/csrc/ops/lamb_optimizer_step.h"
+#include "torch_xla/csrc/ops/layer_norm.h"
 #include "torch_xla/csrc/ops/leaky_relu.h"
 #include "torch_xla/csrc/ops/leaky_relu_backward.h"
 #include "torch_xla/csrc/ops/linear_interpolation.h"
@@ -100,6 +113,7 @@
 #include "torch_xla/csrc/ops/prod.h"
 #include "torch_xla/csrc/ops/put.h"
 #include "torch_xla/csrc/ops/qr.h"
+#include "torch_xla/csrc/ops/quantized_ops.h"
 #include "torch_xla/csrc/ops/recv.h"
 #include "torch_xla/csrc/ops/reduce_scatter.h"
 #include "torch_xla/csrc/ops/reflection_pad2d.h"
@@ -120,19 +134,24 @@
 #include "torch_xla/csrc/ops/softmax.h"
 #include "torch_xla/csrc/ops/softshrink.h"
 #include "torch_xla/csrc/ops/split.h"
+#include "torch_xla/csrc/ops/spmd_full_to_shard_shape.h"
+#include "torch_xla/csrc/ops/spmd_shard_to_full_shape.h"
 #include "torch_xla/csrc/ops/squeeze.h"
 #include "torch_xla/csrc/ops/stack.h"
 #include "torch_xla/csrc/ops/std.h"
 #include "torch_xla/csrc/ops/std_mean.h"
 #include "torch_xla/csrc/ops/sum.h"
+#include "torch_xla/csrc/ops/summary_update.h"
 #include "torch_xla/csrc/ops/svd.h"
 #include "torch_xla/csrc/ops/symeig.h"
+#include "torch_xla/csrc/ops/sync_batch_norm.h"
 #include "torch_xla/csrc/ops/threshold.h"
 #include "torch_xla/csrc/ops/threshold_backward.h"
 #include "torch_xla/csrc/ops/topk.h"
 #include "torch_xla/csrc/ops/triangular_solve.h"
 #include "torch_xla/csrc/ops/uniform.h"
 #include "torch_xla/csrc/ops/unsqueeze.h"
+#include "torch_xla/csrc/ops/update_slice.h"
 #include "torch_xla/csrc/ops/upsample_bilinear2d.h"
 #include "torch_xla/csrc/ops/upsample_bilinear2d_backward.h"
 #include "torch_xla/csrc/ops/upsample_nearest2d.h"
@@ -159,7 +178,7 @@ torch::lazy::Value MaybeExpand(const torch::lazy::Value& input,
   if (GetXlaShape(input).dimensions() == target_shape.dimensions()) {
     return input;
   }
-  return torch::lazy::MakeNode<Expand>(
+  return MakeXlaNode<Expand>(
       input, torch::lazy::ToVector<int64_t>(target_shape.dimensions()));
 }
 
@@ -289,7 +308,7 @@ torch::lazy::Value GetFloatingIrValue(const XLATensorPtr& input,
   torch::lazy::Value input_value = input->GetIrValue();
   if (xla::primitive_util::IsIntegralType(
           GetXlaShape(input_value).element_type())) {
-    input_value = torch::lazy::MakeNode<Cast>(input_value, float_type);
+    input_value = MakeXlaNode<Cast>(input_value, float_type);
   }
   return input_value;
 }
@@ -297,7 +316,7 @@ torch::lazy::Value GetFloatingIrValue(const XLATensorPtr& input,
 torch::lazy::Value GetBooleanIrValue(torch::lazy::Value input_value) {
   if (GetXlaShape(input_value).element_type() != xla::PrimitiveType::PRED) {
     input_value =
-        torch::lazy::MakeNode<Cast>(input_value, xla::PrimitiveType::PRED);
+        MakeXlaNode<Cast>(input_value, xla::PrimitiveType::PRED);
   }
   return input_value;
 }
@@ -311,6 +330,13 @@ absl::optional<torch::lazy::Value> GetOptionalIrValue(
   return value;
 }
 
+EmbeddingBagMode GetEmbeddingBagMode(int64_t mode) {
+  XLA_CHECK(mode >= static_cast<int64_t>(EmbeddingBagMode::kSum) &&
+            mode <= static_cast<int64_t>(EmbeddingBagMode::kMax))
+      << "Invalid embedding bag mode: " << mode;
+  return static_cast<EmbeddingBagMode>(mode);
+}
+
 void CheckIsIntegralOrPred(const xla::Shape& shape,
                            const std::string& op_name) {
   XLA_CHECK(xla::ShapeUtil::ElementIsIntegral(shape) ||
@@ -334,6 +360,55 @@ ViewInfo CreateAsStridedViewInfo(const xla::Shape& input_shape,
                   input_shape, std::move(as_strided_info));
 }
 
+// The operands of a foreach pointwise node: the scalar (if the kind takes one)
+// followed by the elements at the same position of all the lists.
+std::vector<torch::lazy::Value> GetForeachOperands(
+    ForeachPointwise::Kind kind, const at::Scalar& scalar,
+    std::initializer_list<absl::Span<const XLATensorPtr>> lists) {
+  absl::Span<const XLATensorPtr> inputs = *lists.begin();
+  XLA_CHECK(!inputs.empty()) << "Empty foreach tensor list";
+  std::vector<torch::lazy::Value> operands;
+  if (ForeachPointwise::NumScalarOperands(kind) > 0) {
+    operands.push_back(XLATensor::GetIrValueForScalar(
+        scalar, inputs[0]->shape().get().element_type(),
+        inputs[0]->GetDevice()));
+  }
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    for (auto& list : lists) {
+      XLA_CHECK_EQ(list.size(), inputs.size())
+          << "Mismatching foreach tensor lists";
+      operands.push_back(list[i]->GetIrValue());
+    }
+  }
+  return operands;
+}
+
+std::vector<XLATensorPtr> CreateForeachResults(
+    absl::Span<const XLATensorPtr> inputs, const torch::lazy::NodePtr& node) {
+  std::vector<XLATensorPtr> results;
+  results.reserve(inputs.size());
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    results.push_back(inputs[i]->CreateFrom(torch::lazy::Value(node, i)));
+  }
+  return results;
+}
+
+void CheckQuantizationParams(const QuantizationParams& params) {
+  XLA_CHECK_GT(params.input_scale, 0.0);
+  XLA_CHECK(params.input_zero_point >= -128 && params.input_zero_point <= 127)
+      << "Invalid int8 input zero point: " << params.input_zero_point;
+  if (params.output_scale) {
+    XLA_CHECK_GT(*params.output_scale, 0.0);
+    XLA_CHECK(params.output_zero_point >= -128 &&
+              params.output_zero_point <= 127)
+        << "Invalid int8 output zero point: " << params.output_zero_point;
+  }
+}
+
+at::ScalarType GetQuantizedOutputType(const QuantizationParams& params) {
+  return params.output_scale ? at::ScalarType::Char : at::ScalarType::Float;
+}
+
 }  // namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -344,7 +419,7 @@ std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::all_reduce(
     AllReduceType reduce_type, double scale,
     std::vector<std::vector<int64_t>> groups, bool pin_layout) {
   std::vector<torch::lazy::Value> input_values({input->GetIrValue()});
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AllReduce>(
+  torch::lazy::NodePtr node = MakeXlaNode<AllReduce>(
       reduce_type, input_values, token, scale, std::move(groups), pin_layout);
   return {input->CreateFrom(torch::lazy::Value(node, 0)),
           torch::lazy::Value(node, 1)};
@@ -355,7 +430,7 @@ torch::lazy::Value XLATensor::all_reduce_(
     AllReduceType reduce_type, double scale,
     std::vector<std::vector<int64_t>> groups, bool pin_layout) {
   std::vector<torch::lazy::Value> input_values({input->GetIrValue()});
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AllReduce>(
+  torch::lazy::NodePtr node = MakeXlaNode<AllReduce>(
       reduce_type, input_values, token, scale, std::move(groups), pin_layout);
   input->SetInPlaceIrValue(torch::lazy::Value(node, 0));
   return torch::lazy::Value(node, 1);
@@ -370,7 +445,7 @@ torch::lazy::Value XLATensor::all_reduce(
   for (auto& input : *inputs) {
     input_values.push_back(input->GetIrValue());
   }
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AllReduce>(
+  torch::lazy::NodePtr node = MakeXlaNode<AllReduce>(
       reduce_type, input_values, token, scale, std::move(groups), pin_layout);
   for (size_t i = 0; i < inputs->size(); ++i) {
     (*inputs)[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
@@ -383,7 +458,7 @@ std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::reduce_scatter(
     AllReduceType reduce_type, double scale, int64_t scatter_dim,
     int64_t shard_count, std::vector<std::vector<int64_t>> groups,
     bool pin_layout) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<ReduceScatter>(
+  torch::lazy::NodePtr node = MakeXlaNode<ReduceScatter>(
       reduce_type, input->GetIrValue(), token, scale, scatter_dim, shard_count,
       std::move(groups), pin_layout);
   return {input->CreateFrom(torch::lazy::Value(node, 0)),
@@ -395,7 +470,7 @@ torch::lazy::Value XLATensor::reduce_scatter_out(
     const torch::lazy::Value& token, AllReduceType reduce_type, double scale,
     int64_t scatter_dim, int64_t shard_count,
     std::vector<std::vector<int64_t>> groups, bool pin_layout) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<ReduceScatter>(
+  torch::lazy::NodePtr node = MakeXlaNode<ReduceScatter>(
       reduce_type, input->GetIrValue(), token, scale, scatter_dim, shard_count,
       std::move(groups), pin_layout);
   output->SetIrValue(torch::lazy::Value(node, 0));
@@ -406,7 +481,7 @@ std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::all_to_all(
     const XLATensorPtr& input, const torch::lazy::Value& token,
     int64_t split_dimension, int64_t concat_dimension, int64_t split_count,
     std::vector<std::vector<int64_t>> groups, bool pin_layout) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AllToAll>(
+  torch::lazy::NodePtr node = MakeXlaNode<AllToAll>(
       input->GetIrValue(), token, split_dimension, concat_dimension,
       split_count, std::move(groups), pin_layout);
   return {input->CreateFrom(torch::lazy::Value(node, 0)),
@@ -417,7 +492,7 @@ std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::all_gather(
     const XLATensorPtr& input, const torch::lazy::Value& token, int64_t dim,
     int64_t shard_count, std::vector<std::vector<int64_t>> groups,
     bool pin_layout) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AllGather>(
+  torch::lazy::NodePtr node = MakeXlaNode<AllGather>(
       input->GetIrValue(), token, dim, shard_count, std::move(groups),
       pin_layout);
   return {input->CreateFrom(torch::lazy::Value(node, 0)),
@@ -428,7 +503,7 @@ torch::lazy::Value XLATensor::all_gather_out(
     XLATensorPtr& output, const XLATensorPtr& input,
     const torch::lazy::Value& token, int64_t dim, int64_t shard_count,
     std::vector<std::vector<int64_t>> groups, bool pin_layout) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AllGather>(
+  torch::lazy::NodePtr node = MakeXlaNode<AllGather>(
       input->GetIrValue(), token, dim, shard_count, std::move(groups),
       pin_layout);
   output->SetIrValue(torch::lazy::Value(node, 0));
@@ -438,22 +513,83 @@ torch::lazy::Value XLATensor::all_gather_out(
 std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::collective_permute(
     const XLATensorPtr& input, const torch::lazy::Value& token,
     std::vector<std::pair<int64_t, int64_t>> source_target_pairs) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<CollectivePermute>(
+  torch::lazy::NodePtr node = MakeXlaNode<CollectivePermute>(
       input->GetIrValue(), token, std::move(source_target_pairs));
   return {input->CreateFrom(torch::lazy::Value(node, 0)),
           torch::lazy::Value(node, 1)};
 }
 
+std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr, torch::lazy::Value>
+XLATensor::compressed_all_reduce(const XLATensorPtr& input,
+                                 const XLATensorPtr& residual,
+                                 const torch::lazy::Value& token, double scale,
+                                 xla::PrimitiveType wire_type,
+                                 std::vector<std::vector<int64_t>> groups,
+                                 bool pin_layout) {
+  torch::lazy::NodePtr node = MakeXlaNode<CompressedAllReduce>(
+      input->GetIrValue(), residual->GetIrValue(), token, scale, wire_type,
+      std::move(groups), pin_layout);
+  XLA_COUNTER("CompressedAllReduce", 1);
+  return std::make_tuple(
+      input->CreateFrom(torch::lazy::Value(node, 0)),
+      residual->CreateFrom(torch::lazy::Value(node, 1)),
+      input->CreateFrom(torch::lazy::Value(node, 2), at::ScalarType::Float),
+      torch::lazy::Value(node, 3));
+}
+
+std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr, torch::lazy::Value>
+XLATensor::sync_batch_norm(const XLATensorPtr& input,
+                           const XLATensorPtr& weight,
+                           const XLATensorPtr& bias,
+                           const torch::lazy::Value& token, double eps,
+                           std::vector<std::vector<int64_t>> groups,
+                           bool pin_layout) {
+  torch::lazy::NodePtr node = MakeXlaNode<SyncBatchNorm>(
+      input->GetIrValue(), weight->GetIrValue(), bias->GetIrValue(), token,
+      eps, std::move(groups), pin_layout);
+  XLA_COUNTER("SyncBatchNorm", 1);
+  // The statistics of the reduced precision inputs are kept in F32.
+  at::ScalarType stat_type = input->dtype() == at::ScalarType::Half ||
+                                     input->dtype() == at::ScalarType::BFloat16
+                                 ? at::ScalarType::Float
+                                 : input->dtype();
+  return std::make_tuple(
+      input->CreateFrom(torch::lazy::Value(node, 0)),
+      input->CreateFrom(torch::lazy::Value(node, 1), stat_type),
+      input->CreateFrom(torch::lazy::Value(node, 2), stat_type),
+      torch::lazy::Value(node, 3));
+}
+
+std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr, torch::lazy::Value>
+XLATensor::sync_batch_norm_backward(const XLATensorPtr& grad,
+                                    const XLATensorPtr& input,
+                                    const XLATensorPtr& weight,
+                                    const XLATensorPtr& mean,
+                                    const XLATensorPtr& variance,
+                                    const torch::lazy::Value& token,
+                                    double eps,
+                                    std::vector<std::vector<int64_t>> groups,
+                                    bool pin_layout) {
+  torch::lazy::NodePtr node = MakeXlaNode<SyncBatchNormBackward>(
+      grad->GetIrValue(), input->GetIrValue(), weight->GetIrValue(),
+      mean->GetIrValue(), variance->GetIrValue(), token, eps, std::move(groups),
+      pin_layout);
+  return std::make_tuple(input->CreateFrom(torch::lazy::Value(node, 0)),
+                         weight->CreateFrom(torch::lazy::Value(node, 1)),
+                         weight->CreateFrom(torch::lazy::Value(node, 2)),
+                         torch::lazy::Value(node, 3));
+}
+
 XLATensorPtr XLATensor::get_dimensions_size(const XLATensorPtr& input,
                                             std::vector<int64_t> dimensions) {
-  return input->CreateFrom(torch::lazy::MakeNode<GetDimensionsSize>(
+  return input->CreateFrom(MakeXlaNode<GetDimensionsSize>(
                                input->GetIrValue(), std::move(dimensions)),
                            at::ScalarType::Int);
 }
 
 std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::recv(
     XLATensorPtr& output, const torch::lazy::Value& token, int64_t channel_id) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<ir::ops::Recv>(
+  torch::lazy::NodePtr node = MakeXlaNode<ir::ops::Recv>(
       token, GetXlaShape(output->GetIrValue()), channel_id);
   output->SetIrValue(torch::lazy::Value(node, 0));
   return {output->CreateFrom(torch::lazy::Value(node, 0)),
@@ -463,7 +599,7 @@ std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::recv(
 std::pair<XLATensorPtr, torch::lazy::Value> XLATensor::send(
     const XLATensorPtr& input, const torch::lazy::Value& token,
     int64_t channel_id) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<ir::ops::Send>(
+  torch::lazy::NodePtr node = MakeXlaNode<ir::ops::Send>(
       input->GetIrValue(), token, channel_id);
   return {input->CreateFrom(torch::lazy::Value(node, 0)),
           torch::lazy::Value(node, 1)};
@@ -483,7 +619,7 @@ void XLATensor::sgd_optimizer_step_(const XLATensorPtr& found_inf,
       maximize ? -lr : lr, param->shape(), param->GetDevice());
   torch::lazy::Value dampening_value =
       GetIrValueForScalar(dampening, param->shape(), param->GetDevice());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<SgdOptimizerStep>(
+  torch::lazy::NodePtr node = MakeXlaNode<SgdOptimizerStep>(
       found_inf->GetIrValue(), step->GetIrValue(), param->GetIrValue(),
       buf->GetIrValue(), d_p->GetIrValue(), weight_decay_value, momentum_value,
       lr_value, dampening_value,
@@ -512,7 +648,7 @@ void XLATensor::adam_optimizer_step_(
       GetIrValueForScalar(weight_decay, param->shape(), param->GetDevice());
   torch::lazy::Value eps_value =
       GetIrValueForScalar(eps, param->shape(), param->GetDevice());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AdamOptimizerStep>(
+  torch::lazy::NodePtr node = MakeXlaNode<AdamOptimizerStep>(
       found_inf->GetIrValue(), step->GetIrValue(), param->GetIrValue(),
       grad_value, exp_avg->GetIrValue(), exp_avg_sq->GetIrValue(),
       max_exp_avg_sq->GetIrValue(), beta1_value, beta2_value, lr_value,
@@ -526,6 +662,136 @@ void XLATensor::adam_optimizer_step_(
   max_exp_avg_sq->SetInPlaceIrValue(torch::lazy::Value(node, 4));
 }
 
+void XLATensor::foreach_adam_optimizer_step_(
+    const XLATensorPtr& found_inf, absl::Span<const XLATensorPtr> steps,
+    absl::Span<const XLATensorPtr> params,
+    absl::Span<const XLATensorPtr> grads,
+    absl::Span<const XLATensorPtr> exp_avgs,
+    absl::Span<const XLATensorPtr> exp_avg_sqs,
+    absl::Span<const XLATensorPtr> max_exp_avg_sqs, double beta1,
+    double beta2, double lr, double weight_decay, double eps, bool amsgrad,
+    bool maximize, bool use_adamw) {
+  XLA_CHECK(steps.size() == params.size() && grads.size() == params.size() &&
+            exp_avgs.size() == params.size() &&
+            exp_avg_sqs.size() == params.size() &&
+            max_exp_avg_sqs.size() == params.size())
+      << "Mismatching optimizer state lists";
+  std::vector<torch::lazy::Value> operands;
+  operands.push_back(found_inf->GetIrValue());
+  for (double scalar : {beta1, beta2, lr, weight_decay, eps}) {
+    operands.push_back(GetIrValueForScalar(scalar, found_inf->shape(),
+                                           found_inf->GetDevice()));
+  }
+  for (size_t i = 0; i < params.size(); ++i) {
+    operands.push_back(steps[i]->GetIrValue());
+    operands.push_back(params[i]->GetIrValue());
+    operands.push_back(maximize ? XLATensor::mul(grads[i], -1)->GetIrValue()
+                                : grads[i]->GetIrValue());
+    operands.push_back(exp_avgs[i]->GetIrValue());
+    operands.push_back(exp_avg_sqs[i]->GetIrValue());
+    operands.push_back(max_exp_avg_sqs[i]->GetIrValue());
+  }
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachAdamOptimizerStep>(
+      operands, /*use_weight_decay=*/weight_decay != 0,
+      /*use_amsgrad=*/amsgrad, /*use_adamw=*/use_adamw);
+  for (size_t i = 0; i < params.size(); ++i) {
+    size_t base = i * ForeachAdamOptimizerStep::kParamOutputs;
+    steps[i]->SetInPlaceIrValue(torch::lazy::Value(node, base));
+    params[i]->SetInPlaceIrValue(torch::lazy::Value(node, base + 1));
+    exp_avgs[i]->SetInPlaceIrValue(torch::lazy::Value(node, base + 2));
+    exp_avg_sqs[i]->SetInPlaceIrValue(torch::lazy::Value(node, base + 3));
+    max_exp_avg_sqs[i]->SetInPlaceIrValue(torch::lazy::Value(node, base + 4));
+  }
+}
+
+void XLATensor::lamb_optimizer_step_(
+    const XLATensorPtr& found_inf, absl::Span<const XLATensorPtr> steps,
+    absl::Span<const XLATensorPtr> params,
+    absl::Span<const XLATensorPtr> grads,
+    absl::Span<const XLATensorPtr> exp_avgs,
+    absl::Span<const XLATensorPtr> exp_avg_sqs, double beta1, double beta2,
+    double lr, double weight_decay, double eps) {
+  XLA_CHECK(steps.size() == params.size() && grads.size() == params.size() &&
+            exp_avgs.size() == params.size() &&
+            exp_avg_sqs.size() == params.size())
+      << "Mismatching optimizer state lists";
+  std::vector<torch::lazy::Value> operands;
+  operands.push_back(found_inf->GetIrValue());
+  for (double scalar : {beta1, beta2, lr, weight_decay, eps}) {
+    operands.push_back(GetIrValueForScalar(scalar, found_inf->shape(),
+                                           found_inf->GetDevice()));
+  }
+  for (size_t i = 0; i < params.size(); ++i) {
+    operands.push_back(steps[i]->GetIrValue());
+    operands.push_back(params[i]->GetIrValue());
+    operands.push_back(grads[i]->GetIrValue());
+    operands.push_back(exp_avgs[i]->GetIrValue());
+    operands.push_back(exp_avg_sqs[i]->GetIrValue());
+  }
+  torch::lazy::NodePtr node = MakeXlaNode<LambOptimizerStep>(
+      operands, /*use_weight_decay=*/weight_decay != 0);
+  for (size_t i = 0; i < params.size(); ++i) {
+    size_t base = i * LambOptimizerStep::kParamOutputs;
+    steps[i]->SetInPlaceIrValue(torch::lazy::Value(node, base));
+    params[i]->SetInPlaceIrValue(torch::lazy::Value(node, base + 1));
+    exp_avgs[i]->SetInPlaceIrValue(torch::lazy::Value(node, base + 2));
+    exp_avg_sqs[i]->SetInPlaceIrValue(torch::lazy::Value(node, base + 3));
+  }
+}
+
+void XLATensor::adafactor_optimizer_step_(
+    const XLATensorPtr& found_inf, absl::Span<const XLATensorPtr> steps,
+    absl::Span<const XLATensorPtr> params,
+    absl::Span<const XLATensorPtr> grads,
+    absl::Span<const XLATensorPtr> exp_avg_sqs,
+    absl::Span<const XLATensorPtr> exp_avg_sq_rows,
+    absl::Span<const XLATensorPtr> exp_avg_sq_cols, double lr,
+    double weight_decay, double decay_rate, double eps1, double eps2,
+    double clip_threshold, bool scale_parameter) {
+  XLA_CHECK(steps.size() == params.size() && grads.size() == params.size() &&
+            exp_avg_sq_rows.size() == exp_avg_sq_cols.size())
+      << "Mismatching optimizer state lists";
+  std::vector<torch::lazy::Value> operands;
+  operands.push_back(found_inf->GetIrValue());
+  for (double scalar : {lr, weight_decay}) {
+    operands.push_back(GetIrValueForScalar(scalar, found_inf->shape(),
+                                           found_inf->GetDevice()));
+  }
+  // The tensors receiving the outputs of the node, in order.
+  std::vector<XLATensorPtr> outputs;
+  size_t factored = 0;
+  size_t unfactored = 0;
+  for (size_t i = 0; i < params.size(); ++i) {
+    operands.push_back(steps[i]->GetIrValue());
+    operands.push_back(params[i]->GetIrValue());
+    operands.push_back(grads[i]->GetIrValue());
+    outputs.push_back(steps[i]);
+    outputs.push_back(params[i]);
+    if (AdafactorOptimizerStep::IsFactored(params[i]->shape().get())) {
+      XLA_CHECK_LT(factored, exp_avg_sq_rows.size());
+      operands.push_back(exp_avg_sq_rows[factored]->GetIrValue());
+      operands.push_back(exp_avg_sq_cols[factored]->GetIrValue());
+      outputs.push_back(exp_avg_sq_rows[factored]);
+      outputs.push_back(exp_avg_sq_cols[factored]);
+      ++factored;
+    } else {
+      XLA_CHECK_LT(unfactored, exp_avg_sqs.size());
+      operands.push_back(exp_avg_sqs[unfactored]->GetIrValue());
+      outputs.push_back(exp_avg_sqs[unfactored]);
+      ++unfactored;
+    }
+  }
+  XLA_CHECK(factored == exp_avg_sq_rows.size() &&
+            unfactored == exp_avg_sqs.size())
+      << "Mismatching optimizer state lists";
+  torch::lazy::NodePtr node = MakeXlaNode<AdafactorOptimizerStep>(
+      operands, decay_rate, eps1, eps2, clip_threshold,
+      /*use_weight_decay=*/weight_decay != 0, scale_parameter);
+  for (size_t i = 0; i < outputs.size(); ++i) {
+    outputs[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
+  }
+}
+
 std::vector<XLATensorPtr> XLATensor::user_computation(
     const std::string& opname, absl::Span<const XLATensorPtr> inputs,
     ComputationPtr computation) {
@@ -534,7 +800,7 @@ std::vector<XLATensorPtr> XLATensor::user_computation(
   for (auto& input : inputs) {
     input_values.push_back(input->GetIrValue());
   }
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<UserComputation>(
+  torch::lazy::NodePtr node = MakeXlaNode<UserComputation>(
       torch::lazy::OpKind::Get(opname), input_values, std::move(computation));
   // Cast can be one of the user computation and we don't want to inherit the
   // logical_element_type in this case
@@ -542,6 +808,19 @@ std::vector<XLATensorPtr> XLATensor::user_computation(
                                            /*inherit_logical_type=*/false);
 }
 
+XLATensorPtr XLATensor::spmd_full_to_shard_shape(const XLATensorPtr& input,
+                                                 xla::OpSharding sharding) {
+  return input->CreateFrom(MakeXlaNode<SpmdFullToShardShape>(
+      input->GetIrValue(), std::move(sharding)));
+}
+
+XLATensorPtr XLATensor::spmd_shard_to_full_shape(
+    const XLATensorPtr& input, xla::OpSharding sharding,
+    std::vector<int64_t> full_sizes) {
+  return input->CreateFrom(MakeXlaNode<SpmdShardToFullShape>(
+      input->GetIrValue(), std::move(sharding), std::move(full_sizes)));
+}
+
 //////////////////////////////////////////////////////////////////////////////
 // ATEN operators follows here, listed in alphabetical order.
 //////////////////////////////////////////////////////////////////////////////
@@ -591,7 +870,7 @@ XLATensorPtr XLATensor::__rshift__(
 
 std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::adaptive_max_pool2d(
     const XLATensorPtr& input, std::vector<int64_t> output_size) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AdaptiveMaxPool2d>(
+  torch::lazy::NodePtr node = MakeXlaNode<AdaptiveMaxPool2d>(
       input->GetIrValue(), output_size);
   XLATensorPtr out = input->CreateFrom(torch::lazy::Value(node, 0));
   XLATensorPtr indices =
@@ -607,7 +886,7 @@ XLATensorPtr XLATensor::adaptive_max_pool2d_backward(
 
 XLATensorPtr XLATensor::adaptive_avg_pool3d(const XLATensorPtr& input,
                                             std::vector<int64_t> output_size) {
-  return input->CreateFrom(torch::lazy::MakeNode<AdaptiveAvgPool3d>(
+  return input->CreateFrom(MakeXlaNode<AdaptiveAvgPool3d>(
       input->GetIrValue(), std::move(output_size)));
 }
 
@@ -620,14 +899,14 @@ XLATensorPtr XLATensor::adaptive_avg_pool3d_backward(
 XLATensorPtr XLATensor::_adaptive_avg_pool2d(
     const XLATensorPtr& input, std::vector<int64_t> output_size,
     std::vector<torch::lazy::Shape>&& shapes) {
-  return input->CreateFrom(torch::lazy::MakeNode<AdaptiveAvgPool2d>(
+  return input->CreateFrom(MakeXlaNode<AdaptiveAvgPool2d>(
       input->GetIrValue(), std::move(output_size), std::move(shapes)));
 }
 
 XLATensorPtr XLATensor::_adaptive_avg_pool2d_backward(
     const XLATensorPtr& grad_output, const XLATensorPtr& input,
     std::vector<torch::lazy::Shape>&& shapes) {
-  return input->CreateFrom(torch::lazy::MakeNode<AdaptiveAvgPool2dBackward>(
+  return input->CreateFrom(MakeXlaNode<AdaptiveAvgPool2dBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), std::move(shapes)));
 }
 
@@ -640,7 +919,7 @@ void XLATensor::_amp_foreach_non_finite_check_and_unscale_(
     inputs.push_back(x->GetIrValue());
   }
   torch::lazy::NodePtr node =
-      torch::lazy::MakeNode<AmpForachNonFiniteCheckAndUnscale>(
+      MakeXlaNode<AmpForachNonFiniteCheckAndUnscale>(
           inputs, found_inf->GetIrValue(), new_inv_scale->GetIrValue());
   for (size_t i = 0; i < self.size(); ++i) {
     self[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
@@ -654,7 +933,7 @@ void XLATensor::_amp_update_scale_(XLATensorPtr& current_scale,
                                    double scale_growth_factor,
                                    double scale_backoff_factor,
                                    int growth_interval) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<AmpUpdateScale>(
+  torch::lazy::NodePtr node = MakeXlaNode<AmpUpdateScale>(
       growth_tracker->GetIrValue(), current_scale->GetIrValue(),
       found_inf->GetIrValue(), scale_growth_factor, scale_backoff_factor,
       growth_interval);
@@ -663,7 +942,7 @@ void XLATensor::_amp_update_scale_(XLATensorPtr& current_scale,
 }
 
 XLATensorPtr XLATensor::abs(const XLATensorPtr& input) {
-  return input->CreateFrom(torch::lazy::MakeNode<Abs>(
+  return input->CreateFrom(MakeXlaNode<Abs>(
       input->GetIrValue(), std::vector<torch::lazy::Shape>()));
 }
 
@@ -732,11 +1011,11 @@ XLATensorPtr XLATensor::all(const XLATensorPtr& input,
                                    ? at::ScalarType::Byte
                                    : at::ScalarType::Bool;
   return input->CreateFrom(
-      torch::lazy::MakeNode<All>(input->GetIrValue(),
-                                 torch::lazy::GetCanonicalDimensionIndices(
-                                     xla::util::ToVector<int64_t>(dimensions),
-                                     input->shape().get().rank()),
-                                 keep_reduced_dimensions),
+      MakeXlaNode<All>(input->GetIrValue(),
+                       torch::lazy::GetCanonicalDimensionIndices(
+                           xla::util::ToVector<int64_t>(dimensions),
+                           input->shape().get().rank()),
+                       keep_reduced_dimensions),
       result_type);
 }
 
@@ -744,22 +1023,22 @@ XLATensorPtr XLATensor::amax(const XLATensorPtr& input,
                              std::vector<int64_t> dimensions,
                              bool keep_reduced_dimensions) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Amax>(input->GetIrValue(),
-                                  torch::lazy::GetCanonicalDimensionIndices(
-                                      xla::util::ToVector<int64_t>(dimensions),
-                                      input->shape().get().rank()),
-                                  keep_reduced_dimensions));
+      MakeXlaNode<Amax>(input->GetIrValue(),
+                        torch::lazy::GetCanonicalDimensionIndices(
+                            xla::util::ToVector<int64_t>(dimensions),
+                            input->shape().get().rank()),
+                        keep_reduced_dimensions));
 }
 
 XLATensorPtr XLATensor::amin(const XLATensorPtr& input,
                              std::vector<int64_t> dimensions,
                              bool keep_reduced_dimensions) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Amin>(input->GetIrValue(),
-                                  torch::lazy::GetCanonicalDimensionIndices(
-                                      xla::util::ToVector<int64_t>(dimensions),
-                                      input->shape().get().rank()),
-                                  keep_reduced_dimensions));
+      MakeXlaNode<Amin>(input->GetIrValue(),
+                        torch::lazy::GetCanonicalDimensionIndices(
+                            xla::util::ToVector<int64_t>(dimensions),
+                            input->shape().get().rank()),
+                        keep_reduced_dimensions));
 }
 
 XLATensorPtr XLATensor::any(const XLATensorPtr& input,
@@ -769,18 +1048,20 @@ XLATensorPtr XLATensor::any(const XLATensorPtr& input,
                                    ? at::ScalarType::Byte
                                    : at::ScalarType::Bool;
   return input->CreateFrom(
-      torch::lazy::MakeNode<Any>(input->GetIrValue(),
-                                 torch::lazy::GetCanonicalDimensionIndices(
-                                     xla::util::ToVector<int64_t>(dimensions),
-                                     input->shape().get().rank()),
-                                 keep_reduced_dimensions),
+      MakeXlaNode<Any>(input->GetIrValue(),
+                       torch::lazy::GetCanonicalDimensionIndices(
+                           xla::util::ToVector<int64_t>(dimensions),
+                           input->shape().get().rank()),
+                       keep_reduced_dimensions),
       result_type);
 }
 
 void XLATensor::arange_out(XLATensorPtr& out, const at::Scalar& start,
                            const at::Scalar& end, const at::Scalar& step,
                            at::ScalarType scalar_type) {
-  out->SetIrValue(ARange(start, end, step, scalar_type));
+  out->SetIrValue(
+      GetIrValueForLiteral(ARangeLiteral(start, end, step, scalar_type),
+                           out->GetDevice()));
   out->SetScalarType(scalar_type);
 }
 
@@ -788,14 +1069,14 @@ XLATensorPtr XLATensor::argmax(const XLATensorPtr& input, int64_t dim,
                                bool keepdim) {
   int64_t canonical_dim =
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank());
-  return input->CreateFrom(torch::lazy::MakeNode<ArgMax>(
+  return input->CreateFrom(MakeXlaNode<ArgMax>(
                                input->GetIrValue(), canonical_dim, keepdim),
                            at::ScalarType::Long);
 }
 
 XLATensorPtr XLATensor::argmax(const XLATensorPtr& input) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<ArgMax>(input->GetIrValue(), -1, false),
+      MakeXlaNode<ArgMax>(input->GetIrValue(), -1, false),
       at::ScalarType::Long);
 }
 
@@ -803,14 +1084,14 @@ XLATensorPtr XLATensor::argmin(const XLATensorPtr& input, int64_t dim,
                                bool keepdim) {
   int64_t canonical_dim =
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank());
-  return input->CreateFrom(torch::lazy::MakeNode<ArgMin>(
+  return input->CreateFrom(MakeXlaNode<ArgMin>(
                                input->GetIrValue(), canonical_dim, keepdim),
                            at::ScalarType::Long);
 }
 
 XLATensorPtr XLATensor::argmin(const XLATensorPtr& input) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<ArgMin>(input->GetIrValue(), -1, false),
+      MakeXlaNode<ArgMin>(input->GetIrValue(), -1, false),
       at::ScalarType::Long);
 }
 
@@ -827,7 +1108,7 @@ void XLATensor::as_strided_(XLATensorPtr& input, std::vector<int64_t> size,
                             std::vector<int64_t> stride,
                             c10::optional<int64_t> storage_offset) {
   if (input->data()->view == nullptr) {
-    input->SetIrValue(torch::lazy::MakeNode<AsStrided>(
+    input->SetIrValue(MakeXlaNode<AsStrided>(
         input->GetIrValue(), std::move(size), std::move(stride),
         storage_offset.value_or(0)));
   } else {
@@ -853,7 +1134,7 @@ XLATensorPtr XLATensor::avg_pool_nd(const XLATensorPtr& input,
   kernel_size = CheckIntList(kernel_size, spatial_dim_count, "kernel_size");
   stride = CheckIntList(stride, spatial_dim_count, "stride", kernel_size);
   padding = CheckIntList(padding, spatial_dim_count, "padding");
-  return input->CreateFrom(torch::lazy::MakeNode<AvgPoolNd>(
+  return input->CreateFrom(MakeXlaNode<AvgPoolNd>(
       input->GetIrValue(), spatial_dim_count, std::move(kernel_size),
       std::move(stride), std::move(padding), ceil_mode, count_include_pad));
 }
@@ -866,7 +1147,7 @@ XLATensorPtr XLATensor::avg_pool_nd_backward(
   kernel_size = CheckIntList(kernel_size, spatial_dim_count, "kernel_size");
   stride = CheckIntList(stride, spatial_dim_count, "stride", kernel_size);
   padding = CheckIntList(padding, spatial_dim_count, "padding");
-  return out_backprop->CreateFrom(torch::lazy::MakeNode<AvgPoolNdBackward>(
+  return out_backprop->CreateFrom(MakeXlaNode<AvgPoolNdBackward>(
       out_backprop->GetIrValue(), input->GetIrValue(), spatial_dim_count,
       std::move(kernel_size), std::move(stride), std::move(padding), ceil_mode,
       count_include_pad));
@@ -887,30 +1168,44 @@ XLATensorPtr XLATensor::baddbmm(const XLATensorPtr& input,
                                    bias_multiplier));
 }
 
+std::pair<XLATensorPtr, XLATensorPtr> XLATensor::batched_nms(
+    const XLATensorPtr& boxes, const XLATensorPtr& scores,
+    const XLATensorPtr& idxs, const XLATensorPtr& score_threshold,
+    const XLATensorPtr& iou_threshold, int64_t output_size) {
+  torch::lazy::NodePtr node = MakeXlaNode<BatchedNms>(
+      boxes->GetIrValue(), scores->GetIrValue(), idxs->GetIrValue(),
+      score_threshold->GetIrValue(), iou_threshold->GetIrValue(), output_size);
+  return std::pair<XLATensorPtr, XLATensorPtr>(
+      Create(torch::lazy::Value(node, 0), boxes->GetDevice(),
+             at::ScalarType::Int),
+      Create(torch::lazy::Value(node, 1), boxes->GetDevice(),
+             at::ScalarType::Int));
+}
+
 XLATensorPtr XLATensor::bernoulli(const XLATensorPtr& input,
                                   double probability) {
   auto input_shape = input->shape();
-  return input->CreateFrom(torch::lazy::MakeNode<Bernoulli>(
+  return input->CreateFrom(MakeXlaNode<Bernoulli>(
       GetIrValueForScalar(probability, input_shape, input->GetDevice()),
       GetRngSeed(input->GetDevice()), input_shape.get()));
 }
 
 XLATensorPtr XLATensor::bernoulli(const XLATensorPtr& input) {
-  return input->CreateFrom(torch::lazy::MakeNode<Bernoulli>(
+  return input->CreateFrom(MakeXlaNode<Bernoulli>(
       input->GetIrValue(), GetRngSeed(input->GetDevice()),
       input->shape().get()));
 }
 
 void XLATensor::bernoulli_(XLATensorPtr& input, double probability) {
   auto input_shape = input->shape();
-  input->SetInPlaceIrValue(torch::lazy::MakeNode<Bernoulli>(
+  input->SetInPlaceIrValue(MakeXlaNode<Bernoulli>(
       GetIrValueForScalar(probability, input_shape, input->GetDevice()),
       GetRngSeed(input->GetDevice()), input_shape.get()));
 }
 
 void XLATensor::bernoulli_(XLATensorPtr& input,
                            const XLATensorPtr& probability) {
-  input->SetInPlaceIrValue(torch::lazy::MakeNode<Bernoulli>(
+  input->SetInPlaceIrValue(MakeXlaNode<Bernoulli>(
       probability->GetIrValue(), GetRngSeed(input->GetDevice()),
       input->shape().get()));
 }
@@ -919,7 +1214,7 @@ XLATensorPtr XLATensor::binary_cross_entropy(const XLATensorPtr& input,
                                              const XLATensorPtr& target,
                                              const XLATensorPtr& weight,
                                              int64_t reduction) {
-  return input->CreateFrom(torch::lazy::MakeNode<BinaryCrossEntropy>(
+  return input->CreateFrom(MakeXlaNode<BinaryCrossEntropy>(
       input->GetIrValue(), target->GetIrValue(), GetOptionalIrValue(weight),
       GetXlaReductionMode(reduction)));
 }
@@ -927,7 +1222,7 @@ XLATensorPtr XLATensor::binary_cross_entropy(const XLATensorPtr& input,
 XLATensorPtr XLATensor::binary_cross_entropy_backward(
     const XLATensorPtr& grad_output, const XLATensorPtr& input,
     const XLATensorPtr& target, const XLATensorPtr& weight, int64_t reduction) {
-  return input->CreateFrom(torch::lazy::MakeNode<BinaryCrossEntropyBackward>(
+  return input->CreateFrom(MakeXlaNode<BinaryCrossEntropyBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), target->GetIrValue(),
       GetOptionalIrValue(weight), GetXlaReductionMode(reduction)));
 }
@@ -1027,7 +1322,7 @@ XLATensorPtr XLATensor::cat(absl::Span<const XLATensorPtr> tensors, int64_t dim,
   if (values.empty()) {
     return tensors[0];
   }
-  return tensors[0]->CreateFrom(torch::lazy::MakeNode<Cat>(values, dim, dtype),
+  return tensors[0]->CreateFrom(MakeXlaNode<Cat>(values, dim, dtype),
                                 dtype);
 }
 
@@ -1043,7 +1338,7 @@ void XLATensor::celu_(XLATensorPtr& input, const at::Scalar& alpha) {
 XLATensorPtr XLATensor::cholesky(const XLATensorPtr& input, bool upper) {
   // Cholesky takes lower instead of upper, hence the negation.
   return input->CreateFrom(
-      torch::lazy::MakeNode<Cholesky>(input->GetIrValue(), !upper));
+      MakeXlaNode<Cholesky>(input->GetIrValue(), !upper));
 }
 
 XLATensorPtr XLATensor::clamp(const XLATensorPtr& input,
@@ -1061,7 +1356,7 @@ XLATensorPtr XLATensor::clamp(const XLATensorPtr& input,
       << "At least one of \'min\' or \'max\' must not be None";
   torch::lazy::Value res = input->GetIrValue();
   if (min) {
-    res = torch::lazy::MakeNode<Maximum>(
+    res = MakeXlaNode<Maximum>(
         res, bridge::GetXlaTensor(*min)->GetIrValue(),
         std::vector<torch::lazy::Shape>());
   }
@@ -1072,6 +1367,12 @@ XLATensorPtr XLATensor::clamp(const XLATensorPtr& input,
 }
 
 XLATensorPtr XLATensor::clone(const XLATensorPtr& input) {
+  // The clone of a tensor holding device data shares it, and whichever of the
+  // two gets written first moves to a buffer of its own.
+  torch::lazy::BackendDataPtr xla_data = input->GetSharedXlaData();
+  if (xla_data != nullptr) {
+    return Create(std::move(xla_data), input->dtype_optional());
+  }
   return input->CreateFrom(input->GetIrValue());
 }
 
@@ -1080,7 +1381,7 @@ XLATensorPtr XLATensor::constant_pad_nd(const XLATensorPtr& input,
                                         const at::Scalar& value) {
   std::vector<int64_t> complete_pad(pad.begin(), pad.end());
   complete_pad.resize(2 * input->shape().get().rank());
-  return input->CreateFrom(torch::lazy::MakeNode<ConstantPadNd>(
+  return input->CreateFrom(MakeXlaNode<ConstantPadNd>(
       input->GetIrValue(), complete_pad, value));
 }
 
@@ -1090,7 +1391,7 @@ XLATensorPtr XLATensor::convolution_overrideable(
     std::vector<int64_t> padding, std::vector<int64_t> dilation,
     bool transposed, std::vector<int64_t> output_padding, int64_t groups) {
   torch::lazy::NodePtr ir_value =
-      torch::lazy::MakeNode<ConvolutionOverrideable>(
+      MakeXlaNode<ConvolutionOverrideable>(
           input->GetIrValue(), weight->GetIrValue(), bias->GetIrValue(),
           std::move(stride), std::move(padding), std::move(dilation),
           transposed, std::move(output_padding), groups);
@@ -1103,7 +1404,7 @@ XLATensorPtr XLATensor::convolution_overrideable(
     std::vector<int64_t> dilation, bool transposed,
     std::vector<int64_t> output_padding, int64_t groups) {
   torch::lazy::NodePtr ir_value =
-      torch::lazy::MakeNode<ConvolutionOverrideable>(
+      MakeXlaNode<ConvolutionOverrideable>(
           input->GetIrValue(), weight->GetIrValue(), std::move(stride),
           std::move(padding), std::move(dilation), transposed,
           std::move(output_padding), groups);
@@ -1117,7 +1418,7 @@ XLATensor::convolution_backward_overrideable(
     std::vector<int64_t> padding, std::vector<int64_t> dilation,
     bool transposed, std::vector<int64_t> output_padding, int64_t groups) {
   torch::lazy::NodePtr node =
-      torch::lazy::MakeNode<ConvolutionBackwardOverrideable>(
+      MakeXlaNode<ConvolutionBackwardOverrideable>(
           out_backprop->GetIrValue(), input->GetIrValue(), weight->GetIrValue(),
           std::move(stride), std::move(padding), std::move(dilation),
           transposed, std::move(output_padding), groups);
@@ -1131,12 +1432,50 @@ XLATensor::convolution_backward_overrideable(
                          std::move(grad_bias));
 }
 
+XLATensorPtr XLATensor::crop_and_resize(const XLATensorPtr& input,
+                                        const XLATensorPtr& boxes,
+                                        std::vector<int64_t> output_size) {
+  return input->CreateFrom(
+      MakeXlaNode<CropAndResize>(input->GetIrValue(), boxes->GetIrValue(),
+                                 std::move(output_size)),
+      at::ScalarType::Float);
+}
+
 XLATensorPtr XLATensor::cross(const XLATensorPtr& input,
                               const XLATensorPtr& other,
                               c10::optional<int64_t> dim) {
   return tensor_ops::Cross(input, other, dim);
 }
 
+std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::cross_entropy(
+    const XLATensorPtr& input, const XLATensorPtr& target,
+    const XLATensorPtr& weight, int64_t reduction, int64_t ignore_index,
+    double label_smoothing) {
+  torch::lazy::NodePtr node = MakeXlaNode<CrossEntropy>(
+      input->GetIrValue(), target->GetIrValue(), GetOptionalIrValue(weight),
+      GetXlaReductionMode(reduction), ignore_index, label_smoothing);
+  // The logsumexp of the reduced precision logits is kept in F32.
+  at::ScalarType logsumexp_type =
+      input->dtype() == at::ScalarType::Half ||
+              input->dtype() == at::ScalarType::BFloat16
+          ? at::ScalarType::Float
+          : input->dtype();
+  return std::make_tuple(
+      input->CreateFrom(torch::lazy::Value(node, 0)),
+      input->CreateFrom(torch::lazy::Value(node, 1), logsumexp_type));
+}
+
+XLATensorPtr XLATensor::cross_entropy_backward(
+    const XLATensorPtr& grad_output, const XLATensorPtr& input,
+    const XLATensorPtr& target, const XLATensorPtr& logsumexp,
+    const XLATensorPtr& weight, int64_t reduction, int64_t ignore_index,
+    double label_smoothing) {
+  return input->CreateFrom(MakeXlaNode<CrossEntropyBackward>(
+      grad_output->GetIrValue(), input->GetIrValue(), target->GetIrValue(),
+      logsumexp->GetIrValue(), GetOptionalIrValue(weight),
+      GetXlaReductionMode(reduction), ignore_index, label_smoothing));
+}
+
 XLATensorPtr XLATensor::cumprod(const XLATensorPtr& input, int64_t dim,
                                 c10::optional<at::ScalarType> dtype) {
   int64_t canonical_dim =
@@ -1145,7 +1484,7 @@ XLATensorPtr XLATensor::cumprod(const XLATensorPtr& input, int64_t dim,
     dtype = input->dtype_optional();
   }
   return input->CreateFrom(
-      torch::lazy::MakeNode<CumProd>(input->GetIrValue(), canonical_dim, dtype),
+      MakeXlaNode<CumProd>(input->GetIrValue(), canonical_dim, dtype),
       dtype);
 }
 
@@ -1157,7 +1496,7 @@ XLATensorPtr XLATensor::cumsum(const XLATensorPtr& input, int64_t dim,
     dtype = input->dtype_optional();
   }
   return input->CreateFrom(
-      torch::lazy::MakeNode<CumSum>(input->GetIrValue(), canonical_dim, dtype),
+      MakeXlaNode<CumSum>(input->GetIrValue(), canonical_dim, dtype),
       dtype);
 }
 
@@ -1213,7 +1552,7 @@ XLATensorPtr XLATensor::div(
       res = Trunc(res);
     } else if (*rounding_mode == "floor") {
       res =
-          torch::lazy::MakeNode<Floor>(res, std::vector<torch::lazy::Shape>());
+          MakeXlaNode<Floor>(res, std::vector<torch::lazy::Shape>());
     } else {
       XLA_CHECK(false)
           << "rounding_mode must be one of None, 'trunc', or 'floor'";
@@ -1229,7 +1568,7 @@ XLATensorPtr XLATensor::div(
       xla::PrimitiveType res_intended_type =
           MakeXlaPrimitiveType(*logical_element_type, &input->GetDevice());
       if (GetXlaShape(res).element_type() != res_intended_type) {
-        res = torch::lazy::MakeNode<Cast>(res, res_intended_type);
+        res = MakeXlaNode<Cast>(res, res_intended_type);
       }
     }
     return input->CreateFrom(res, logical_element_type);
@@ -1255,6 +1594,52 @@ XLATensorPtr XLATensor::div(const XLATensorPtr& input,
   return input->CreateFrom(input_value / other_value, scalar_type);
 }
 
+XLATensorPtr XLATensor::dynamic_update_slice(const XLATensorPtr& input,
+                                             const XLATensorPtr& source,
+                                             const XLATensorPtr& offset,
+                                             int64_t dim) {
+  auto input_shape = input->shape();
+  int64_t canonical_dim =
+      torch::lazy::GetCanonicalDimensionIndex(dim, input_shape.get().rank());
+  auto source_shape = source->shape();
+  XLA_CHECK_EQ(source_shape.get().rank(), input_shape.get().rank())
+      << source_shape.get() << " vs. " << input_shape.get();
+  for (int64_t i = 0; i < input_shape.get().rank(); ++i) {
+    XLA_CHECK(i == canonical_dim || source_shape.get().dimensions(i) ==
+                                        input_shape.get().dimensions(i))
+        << "The update " << source_shape.get() << " must match the "
+        << input_shape.get() << " input but along dimension " << canonical_dim;
+  }
+  XLA_CHECK_EQ(xla::ShapeUtil::ElementsIn(offset->shape().get()), 1)
+      << "The offset must be a scalar: " << offset->shape().get();
+  return input->CreateFrom(
+      MakeXlaNode<UpdateSlice>(input->GetIrValue(), source->GetIrValue(),
+                               offset->GetIrValue(), canonical_dim));
+}
+
+std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::dropout(
+    const XLATensorPtr& input, double probability, bool regenerate_mask) {
+  XLA_COUNTER("PackedDropout", 1);
+  torch::lazy::Value seed = GetRngSeed(input->GetDevice());
+  torch::lazy::NodePtr node =
+      MakeXlaNode<Dropout>(input->GetIrValue(), seed, probability);
+  XLATensorPtr mask =
+      regenerate_mask
+          ? Create(seed, input->GetDevice(), at::ScalarType::Long)
+          : input->CreateFrom(torch::lazy::Value(node, 1), at::ScalarType::Int);
+  return std::make_tuple(input->CreateFrom(torch::lazy::Value(node, 0)), mask);
+}
+
+XLATensorPtr XLATensor::dropout_backward(const XLATensorPtr& grad_output,
+                                         const XLATensorPtr& mask,
+                                         double probability,
+                                         bool regenerate_mask) {
+  return grad_output->CreateFrom(
+      MakeXlaNode<DropoutBackward>(grad_output->GetIrValue(),
+                                   mask->GetIrValue(), probability,
+                                   regenerate_mask));
+}
+
 XLATensorPtr XLATensor::eq(const XLATensorPtr& input, const at::Scalar& other) {
   return DispatchComparisonOp(at::aten::eq, input, other);
 }
@@ -1285,11 +1670,60 @@ XLATensorPtr XLATensor::elu_backward(const XLATensorPtr& grad_output,
                                              input_scale));
 }
 
+std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr, XLATensorPtr>
+XLATensor::embedding_bag(const XLATensorPtr& weight,
+                         const XLATensorPtr& indices,
+                         const XLATensorPtr& offsets, int64_t mode,
+                         const XLATensorPtr& per_sample_weights,
+                         bool include_last_offset, int64_t padding_idx) {
+  torch::lazy::NodePtr node = MakeXlaNode<EmbeddingBag>(
+      weight->GetIrValue(), indices->GetIrValue(), offsets->GetIrValue(),
+      GetOptionalIrValue(per_sample_weights), GetEmbeddingBagMode(mode),
+      include_last_offset, padding_idx);
+  return std::make_tuple(
+      weight->CreateFrom(torch::lazy::Value(node, 0)),
+      indices->CreateFrom(torch::lazy::Value(node, 1)),
+      indices->CreateFrom(torch::lazy::Value(node, 2)),
+      indices->CreateFrom(torch::lazy::Value(node, 3)));
+}
+
+XLATensorPtr XLATensor::embedding_bag_backward(
+    const XLATensorPtr& grad, const XLATensorPtr& indices,
+    const XLATensorPtr& offset2bag, const XLATensorPtr& bag_size,
+    const XLATensorPtr& max_indices, int64_t num_weights,
+    bool scale_grad_by_freq, int64_t mode,
+    const XLATensorPtr& per_sample_weights, int64_t padding_idx) {
+  XLA_CHECK(!scale_grad_by_freq ||
+            GetEmbeddingBagMode(mode) != EmbeddingBagMode::kMax)
+      << "The max mode does not support scaling the gradient by frequency";
+  return grad->CreateFrom(MakeXlaNode<EmbeddingBagBackward>(
+      grad->GetIrValue(), indices->GetIrValue(), offset2bag->GetIrValue(),
+      bag_size->GetIrValue(), max_indices->GetIrValue(),
+      GetOptionalIrValue(per_sample_weights), num_weights,
+      GetEmbeddingBagMode(mode), scale_grad_by_freq, padding_idx));
+}
+
+void XLATensor::embedding_bag_sparse_sgd_(
+    XLATensorPtr& weight, const XLATensorPtr& grad,
+    const XLATensorPtr& indices, const XLATensorPtr& offsets, double lr,
+    int64_t mode, const XLATensorPtr& per_sample_weights,
+    bool include_last_offset, int64_t padding_idx) {
+  torch::lazy::Value lr_value = GetIrValueForScalar(
+      lr, weight->shape().get().element_type(), weight->GetDevice());
+  weight->SetInPlaceIrValue(MakeXlaNode<EmbeddingBagSparseSgd>(
+      weight->GetIrValue(), grad->GetIrValue(), indices->GetIrValue(),
+      offsets->GetIrValue(), lr_value, GetOptionalIrValue(per_sample_weights),
+      GetEmbeddingBagMode(mode), include_last_offset, padding_idx));
+}
+
 XLATensorPtr XLATensor::embedding_dense_backward(
     const XLATensorPtr& grad_output, const XLATensorPtr& indices,
     int64_t num_weights, int64_t padding_idx, bool scale_grad_by_freq) {
-  return tensor_ops::EmbeddingDenseBackward(grad_output, indices, num_weights,
-                                            padding_idx, scale_grad_by_freq);
+  XLA_CHECK_EQ(indices->dtype(), at::ScalarType::Long)
+      << "Embedding indices are expected to be of scalar type Long";
+  return grad_output->CreateFrom(MakeXlaNode<EmbeddingDenseBackward>(
+      grad_output->GetIrValue(), indices->GetIrValue(), num_weights,
+      padding_idx, scale_grad_by_freq));
 }
 
 XLATensorPtr XLATensor::exp(const XLATensorPtr& input) {
@@ -1299,14 +1733,14 @@ XLATensorPtr XLATensor::exp(const XLATensorPtr& input) {
 XLATensorPtr XLATensor::expand(const XLATensorPtr& input,
                                std::vector<int64_t> size) {
   auto input_shape = input->shape();
-  return input->CreateFrom(torch::lazy::MakeNode<Expand>(
+  return input->CreateFrom(MakeXlaNode<Expand>(
       input->GetIrValue(),
       GetExpandDimensions(input_shape.get(), std::move(size))));
 }
 
 void XLATensor::exponential_(XLATensorPtr& input, double lambd) {
   auto input_shape = input->shape();
-  input->SetInPlaceIrValue(torch::lazy::MakeNode<Exponential>(
+  input->SetInPlaceIrValue(MakeXlaNode<Exponential>(
       GetIrValueForScalar(lambd, input_shape.get().element_type(),
                           input->GetDevice()),
       GetRngSeed(input->GetDevice()), input_shape.get()));
@@ -1333,6 +1767,38 @@ void XLATensor::fill_(XLATensorPtr& input, const at::Scalar& value) {
   input->SetInPlaceIrValue(std::move(constant));
 }
 
+std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::flash_attention(
+    const XLATensorPtr& query, const XLATensorPtr& key,
+    const XLATensorPtr& value, const XLATensorPtr& mask, double scale,
+    bool is_causal) {
+  torch::lazy::NodePtr node = MakeXlaNode<FlashAttention>(
+      query->GetIrValue(), key->GetIrValue(), value->GetIrValue(),
+      GetOptionalIrValue(mask), scale, is_causal,
+      GetFlashAttentionBlockSize());
+  at::ScalarType logsumexp_type = query->dtype() == at::ScalarType::Double
+                                      ? at::ScalarType::Double
+                                      : at::ScalarType::Float;
+  return std::make_tuple(
+      query->CreateFrom(torch::lazy::Value(node, 0)),
+      query->CreateFrom(torch::lazy::Value(node, 1), logsumexp_type));
+}
+
+std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr>
+XLATensor::flash_attention_backward(
+    const XLATensorPtr& grad_output, const XLATensorPtr& query,
+    const XLATensorPtr& key, const XLATensorPtr& value,
+    const XLATensorPtr& output, const XLATensorPtr& logsumexp,
+    const XLATensorPtr& mask, double scale, bool is_causal) {
+  torch::lazy::NodePtr node = MakeXlaNode<FlashAttentionBackward>(
+      grad_output->GetIrValue(), query->GetIrValue(), key->GetIrValue(),
+      value->GetIrValue(), output->GetIrValue(), logsumexp->GetIrValue(),
+      GetOptionalIrValue(mask), scale, is_causal,
+      GetFlashAttentionBlockSize());
+  return std::make_tuple(query->CreateFrom(torch::lazy::Value(node, 0)),
+                         key->CreateFrom(torch::lazy::Value(node, 1)),
+                         value->CreateFrom(torch::lazy::Value(node, 2)));
+}
+
 XLATensorPtr XLATensor::flip(const XLATensorPtr& input,
                              absl::Span<const int64_t> dims) {
   auto dimensions = torch::lazy::GetCanonicalDimensionIndices(
@@ -1340,7 +1806,7 @@ XLATensorPtr XLATensor::flip(const XLATensorPtr& input,
   std::set<int64_t> unique_dims(dimensions.begin(), dimensions.end());
   XLA_CHECK_EQ(unique_dims.size(), dimensions.size());
   return input->CreateFrom(
-      torch::lazy::MakeNode<Flip>(input->GetIrValue(), dimensions));
+      MakeXlaNode<Flip>(input->GetIrValue(), dimensions));
 }
 
 XLATensorPtr XLATensor::fmod(
@@ -1359,6 +1825,137 @@ XLATensorPtr XLATensor::fmod(
                            logical_element_type);
 }
 
+std::vector<XLATensorPtr> XLATensor::foreach_add(
+    absl::Span<const XLATensorPtr> inputs, const at::Scalar& other) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kAddScalar, other, {inputs}),
+      ForeachPointwise::Kind::kAddScalar);
+  return CreateForeachResults(inputs, node);
+}
+
+void XLATensor::foreach_add_(absl::Span<const XLATensorPtr> inputs,
+                             const at::Scalar& other) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kAddScalar, other, {inputs}),
+      ForeachPointwise::Kind::kAddScalar);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
+  }
+}
+
+std::vector<XLATensorPtr> XLATensor::foreach_add(
+    absl::Span<const XLATensorPtr> inputs,
+    absl::Span<const XLATensorPtr> others, const at::Scalar& alpha) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kAddList, alpha,
+                         {inputs, others}),
+      ForeachPointwise::Kind::kAddList);
+  return CreateForeachResults(inputs, node);
+}
+
+void XLATensor::foreach_add_(absl::Span<const XLATensorPtr> inputs,
+                             absl::Span<const XLATensorPtr> others,
+                             const at::Scalar& alpha) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kAddList, alpha,
+                         {inputs, others}),
+      ForeachPointwise::Kind::kAddList);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
+  }
+}
+
+std::vector<XLATensorPtr> XLATensor::foreach_addcmul(
+    absl::Span<const XLATensorPtr> inputs,
+    absl::Span<const XLATensorPtr> tensors1,
+    absl::Span<const XLATensorPtr> tensors2, const at::Scalar& value) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kAddcmul, value,
+                         {inputs, tensors1, tensors2}),
+      ForeachPointwise::Kind::kAddcmul);
+  return CreateForeachResults(inputs, node);
+}
+
+void XLATensor::foreach_addcmul_(absl::Span<const XLATensorPtr> inputs,
+                                 absl::Span<const XLATensorPtr> tensors1,
+                                 absl::Span<const XLATensorPtr> tensors2,
+                                 const at::Scalar& value) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kAddcmul, value,
+                         {inputs, tensors1, tensors2}),
+      ForeachPointwise::Kind::kAddcmul);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
+  }
+}
+
+XLATensorPtr XLATensor::foreach_clip_norm_(
+    absl::Span<const XLATensorPtr> inputs, double max_norm,
+    double norm_type) {
+  XLA_CHECK(!inputs.empty()) << "Empty foreach tensor list";
+  std::vector<torch::lazy::Value> operands;
+  for (auto& input : inputs) {
+    operands.push_back(input->GetIrValue());
+  }
+  torch::lazy::NodePtr node =
+      MakeXlaNode<ForeachClipNorm>(operands, max_norm, norm_type);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
+  }
+  return inputs[0]->CreateFrom(torch::lazy::Value(node, inputs.size()),
+                               at::ScalarType::Float);
+}
+
+std::vector<XLATensorPtr> XLATensor::foreach_mul(
+    absl::Span<const XLATensorPtr> inputs, const at::Scalar& other) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kMulScalar, other, {inputs}),
+      ForeachPointwise::Kind::kMulScalar);
+  return CreateForeachResults(inputs, node);
+}
+
+void XLATensor::foreach_mul_(absl::Span<const XLATensorPtr> inputs,
+                             const at::Scalar& other) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kMulScalar, other, {inputs}),
+      ForeachPointwise::Kind::kMulScalar);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
+  }
+}
+
+std::vector<XLATensorPtr> XLATensor::foreach_mul(
+    absl::Span<const XLATensorPtr> inputs,
+    absl::Span<const XLATensorPtr> others) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kMulList, at::Scalar(),
+                         {inputs, others}),
+      ForeachPointwise::Kind::kMulList);
+  return CreateForeachResults(inputs, node);
+}
+
+void XLATensor::foreach_mul_(absl::Span<const XLATensorPtr> inputs,
+                             absl::Span<const XLATensorPtr> others) {
+  torch::lazy::NodePtr node = MakeXlaNode<ForeachPointwise>(
+      GetForeachOperands(ForeachPointwise::Kind::kMulList, at::Scalar(),
+                         {inputs, others}),
+      ForeachPointwise::Kind::kMulList);
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    inputs[i]->SetInPlaceIrValue(torch::lazy::Value(node, i));
+  }
+}
+
+std::vector<XLATensorPtr> XLATensor::foreach_norm(
+    absl::Span<const XLATensorPtr> inputs, double norm_type) {
+  XLA_CHECK(!inputs.empty()) << "Empty foreach tensor list";
+  std::vector<torch::lazy::Value> operands;
+  for (auto& input : inputs) {
+    operands.push_back(input->GetIrValue());
+  }
+  return CreateForeachResults(
+      inputs, MakeXlaNode<ForeachNorm>(operands, norm_type));
+}
+
 XLATensorPtr XLATensor::frac(const XLATensorPtr& input) {
   return input->CreateFrom(FracOp(input->GetIrValue()));
 }
@@ -1403,7 +2000,7 @@ XLATensorPtr XLATensor::gather(const XLATensorPtr& input, int64_t dim,
       XLA_CHECK_LE(index->size(dim), input->size(dim));
     }
   }
-  return input->CreateFrom(torch::lazy::MakeNode<Gather>(
+  return input->CreateFrom(MakeXlaNode<Gather>(
       input->GetIrValue(), canonical_dim, index->GetIrValue()));
 }
 
@@ -1535,14 +2132,14 @@ void XLATensor::index_put_(XLATensorPtr& input,
 XLATensorPtr XLATensor::index_select(const XLATensorPtr& input, int64_t dim,
                                      const XLATensorPtr& index) {
   torch::lazy::Value index_value = EnsureRank1(index->GetIrValue());
-  return input->CreateFrom(torch::lazy::MakeNode<IndexSelect>(
+  return input->CreateFrom(MakeXlaNode<IndexSelect>(
       input->GetIrValue(),
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank()),
       index_value));
 }
 
 XLATensorPtr XLATensor::isnan(const XLATensorPtr& input) {
-  torch::lazy::Value result = torch::lazy::MakeNode<Isnan>(
+  torch::lazy::Value result = MakeXlaNode<Isnan>(
       input->GetIrValue(), std::vector<torch::lazy::Shape>());
   torch::lazy::Value casted = GetBooleanIrValue(result);
   return input->CreateFrom(casted, at::ScalarType::Bool);
@@ -1550,7 +2147,7 @@ XLATensorPtr XLATensor::isnan(const XLATensorPtr& input) {
 
 std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::kthvalue(
     const XLATensorPtr& input, int64_t k, int64_t dim, bool keepdim) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<KthValue>(
+  torch::lazy::NodePtr node = MakeXlaNode<KthValue>(
       input->GetIrValue(), k,
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank()),
       keepdim);
@@ -1571,35 +2168,75 @@ XLATensorPtr XLATensor::le(const XLATensorPtr& input,
 XLATensorPtr XLATensor::hardshrink(const XLATensorPtr& input,
                                    const at::Scalar& lambda) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Hardshrink>(input->GetIrValue(), lambda));
+      MakeXlaNode<Hardshrink>(input->GetIrValue(), lambda));
 }
 
 XLATensorPtr XLATensor::hardshrink_backward(const XLATensorPtr& grad_out,
                                             const XLATensorPtr& input,
                                             const at::Scalar& lambda) {
-  return input->CreateFrom(torch::lazy::MakeNode<ShrinkBackward>(
+  return input->CreateFrom(MakeXlaNode<ShrinkBackward>(
       torch::lazy::OpKind(at::aten::hardshrink_backward),
       grad_out->GetIrValue(), input->GetIrValue(), lambda));
 }
 
+XLATensorPtr XLATensor::host_callback(const XLATensorPtr& input,
+                                      int64_t callback_id) {
+  return input->CreateFrom(
+      MakeXlaNode<HostCallback>(input->GetIrValue(), callback_id));
+}
+
 XLATensorPtr XLATensor::hardtanh_backward(const XLATensorPtr& grad_output,
                                           const XLATensorPtr& input,
                                           const at::Scalar& min_val,
                                           const at::Scalar& max_val) {
-  return grad_output->CreateFrom(torch::lazy::MakeNode<HardtanhBackward>(
+  return grad_output->CreateFrom(MakeXlaNode<HardtanhBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), min_val, max_val));
 }
 
+std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr> XLATensor::layer_norm(
+    const XLATensorPtr& input, int64_t normalized_ndim,
+    const XLATensorPtr& weight, const XLATensorPtr& bias, double eps,
+    bool rms) {
+  torch::lazy::NodePtr node = MakeXlaNode<LayerNorm>(
+      input->GetIrValue(), GetOptionalIrValue(weight), GetOptionalIrValue(bias),
+      normalized_ndim, eps, rms);
+  // The statistics of the reduced precision inputs are kept in F32.
+  at::ScalarType stat_type = input->dtype() == at::ScalarType::Half ||
+                                     input->dtype() == at::ScalarType::BFloat16
+                                 ? at::ScalarType::Float
+                                 : input->dtype();
+  return std::make_tuple(
+      input->CreateFrom(torch::lazy::Value(node, 0)),
+      input->CreateFrom(torch::lazy::Value(node, 1), stat_type),
+      input->CreateFrom(torch::lazy::Value(node, 2), stat_type));
+}
+
+std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr>
+XLATensor::layer_norm_backward(const XLATensorPtr& grad_output,
+                               const XLATensorPtr& input,
+                               const XLATensorPtr& mean,
+                               const XLATensorPtr& rstd,
+                               const XLATensorPtr& weight,
+                               int64_t normalized_ndim, bool rms) {
+  torch::lazy::NodePtr node = MakeXlaNode<LayerNormBackward>(
+      grad_output->GetIrValue(), input->GetIrValue(), mean->GetIrValue(),
+      rstd->GetIrValue(), GetOptionalIrValue(weight), normalized_ndim, rms);
+  const XLATensorPtr& affine = weight ? weight : input;
+  return std::make_tuple(input->CreateFrom(torch::lazy::Value(node, 0)),
+                         affine->CreateFrom(torch::lazy::Value(node, 1)),
+                         affine->CreateFrom(torch::lazy::Value(node, 2)));
+}
+
 XLATensorPtr XLATensor::leaky_relu(const XLATensorPtr& input,
                                    double negative_slope) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<LeakyRelu>(input->GetIrValue(), negative_slope));
+      MakeXlaNode<LeakyRelu>(input->GetIrValue(), negative_slope));
 }
 
 XLATensorPtr XLATensor::leaky_relu_backward(const XLATensorPtr& grad_output,
                                             const XLATensorPtr& input,
                                             double negative_slope) {
-  return grad_output->CreateFrom(torch::lazy::MakeNode<LeakyReluBackward>(
+  return grad_output->CreateFrom(MakeXlaNode<LeakyReluBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), negative_slope));
 }
 
@@ -1626,7 +2263,7 @@ XLATensorPtr XLATensor::linspace(const at::Scalar& start, const at::Scalar& end,
   torch::lazy::Value end_val =
       GetIrValueForScalar(end, xla::PrimitiveType::F32, device);
   return XLATensor::Create(
-      torch::lazy::MakeNode<Linspace>(start_val, end_val, steps), device,
+      MakeXlaNode<Linspace>(start_val, end_val, steps), device,
       element_type);
 }
 
@@ -1662,10 +2299,10 @@ XLATensorPtr XLATensor::log_softmax(const XLATensorPtr& input, int64_t dim,
     dtype = input->dtype_optional();
   }
   return input->CreateFrom(
-      torch::lazy::MakeNode<LogSoftmax>(input->GetIrValue(),
-                                        torch::lazy::GetCanonicalDimensionIndex(
-                                            dim, input->shape().get().rank()),
-                                        dtype, std::move(shapes)),
+      MakeXlaNode<LogSoftmax>(input->GetIrValue(),
+                              torch::lazy::GetCanonicalDimensionIndex(
+                                  dim, input->shape().get().rank()),
+                              dtype, std::move(shapes)),
       dtype);
 }
 
@@ -1692,7 +2329,7 @@ void XLATensor::log1p_(XLATensorPtr& input) {
 XLATensorPtr XLATensor::logsumexp(const XLATensorPtr& input,
                                   std::vector<int64_t> dimensions,
                                   bool keep_reduced_dimensions) {
-  return input->CreateFrom(torch::lazy::MakeNode<Logsumexp>(
+  return input->CreateFrom(MakeXlaNode<Logsumexp>(
       input->GetIrValue(),
       torch::lazy::GetCanonicalDimensionIndices(
           xla::util::ToVector<int64_t>(dimensions),
@@ -1724,7 +2361,7 @@ XLATensorPtr XLATensor::lt(const XLATensorPtr& input,
 void XLATensor::masked_fill_(XLATensorPtr& input, const XLATensorPtr& mask,
                              const at::Scalar& value) {
   torch::lazy::ScopePusher ir_scope(at::aten::masked_fill.toQualString());
-  input->SetIrValue(torch::lazy::MakeNode<MaskedFill>(
+  input->SetIrValue(MakeXlaNode<MaskedFill>(
       input->GetIrValue(), MaybeExpand(mask->GetIrValue(), input->shape()),
       value));
 }
@@ -1732,18 +2369,29 @@ void XLATensor::masked_fill_(XLATensorPtr& input, const XLATensorPtr& mask,
 void XLATensor::masked_scatter_(XLATensorPtr& input, const XLATensorPtr& mask,
                                 const XLATensorPtr& source) {
   torch::lazy::ScopePusher ir_scope(at::aten::masked_scatter.toQualString());
-  input->SetIrValue(torch::lazy::MakeNode<MaskedScatter>(
+  input->SetIrValue(MakeXlaNode<MaskedScatter>(
       input->GetIrValue(), MaybeExpand(mask->GetIrValue(), input->shape()),
       source->GetIrValue()));
 }
 
 XLATensorPtr XLATensor::masked_select(const XLATensorPtr& input,
                                       const XLATensorPtr& mask) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<MaskedSelect>(
+  torch::lazy::NodePtr node = MakeXlaNode<MaskedSelect>(
       input->GetIrValue(), mask->GetIrValue());
   return input->CreateFrom(torch::lazy::Value(node, 0));
 }
 
+std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::masked_select_padded(
+    const XLATensorPtr& input, const XLATensorPtr& mask) {
+  // The dynamic size of masked_select() would need a sync to be read.
+  XLA_COUNTER("AvoidedSizeSyncs", 1);
+  torch::lazy::NodePtr node = MakeXlaNode<MaskedSelect>(
+      input->GetIrValue(), mask->GetIrValue(), /*padded=*/true);
+  return std::make_tuple(
+      input->CreateFrom(torch::lazy::Value(node, 0)),
+      input->CreateFrom(torch::lazy::Value(node, 1), at::ScalarType::Long));
+}
+
 XLATensorPtr XLATensor::matmul(const XLATensorPtr& input,
                                const XLATensorPtr& other) {
   return input->CreateFrom(MatMul(input->GetIrValue(), other->GetIrValue()));
@@ -1758,7 +2406,7 @@ std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::max(const XLATensorPtr& input,
                                                       bool keepdim) {
   int64_t canonical_dim =
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<MaxInDim>(
+  torch::lazy::NodePtr node = MakeXlaNode<MaxInDim>(
       input->GetIrValue(), canonical_dim, keepdim);
   return std::make_tuple(
       input->CreateFrom(torch::lazy::Value(node, 0)),
@@ -1769,7 +2417,7 @@ void XLATensor::max_out(XLATensorPtr& max, XLATensorPtr& max_values,
                         const XLATensorPtr& input, int64_t dim, bool keepdim) {
   int64_t canonical_dim =
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<MaxInDim>(
+  torch::lazy::NodePtr node = MakeXlaNode<MaxInDim>(
       input->GetIrValue(), canonical_dim, keepdim);
   max->SetIrValue(torch::lazy::Value(node, 0));
   max_values->SetIrValue(torch::lazy::Value(node, 1));
@@ -1782,7 +2430,7 @@ std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::max_pool_nd(
   kernel_size = CheckIntList(kernel_size, spatial_dim_count, "kernel_size");
   stride = CheckIntList(stride, spatial_dim_count, "stride", kernel_size);
   padding = CheckIntList(padding, spatial_dim_count, "padding");
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<MaxPoolNd>(
+  torch::lazy::NodePtr node = MakeXlaNode<MaxPoolNd>(
       input->GetIrValue(), spatial_dim_count, std::move(kernel_size),
       std::move(stride), std::move(padding), ceil_mode);
   return std::make_tuple(
@@ -1797,7 +2445,7 @@ XLATensorPtr XLATensor::max_pool_nd_backward(
   kernel_size = CheckIntList(kernel_size, spatial_dim_count, "kernel_size");
   stride = CheckIntList(stride, spatial_dim_count, "stride", kernel_size);
   padding = CheckIntList(padding, spatial_dim_count, "padding");
-  return out_backprop->CreateFrom(torch::lazy::MakeNode<MaxPoolNdBackward>(
+  return out_backprop->CreateFrom(MakeXlaNode<MaxPoolNdBackward>(
       out_backprop->GetIrValue(), input->GetIrValue(), spatial_dim_count,
       std::move(kernel_size), std::move(stride), std::move(padding),
       ceil_mode));
@@ -1806,7 +2454,7 @@ XLATensorPtr XLATensor::max_pool_nd_backward(
 XLATensorPtr XLATensor::max_unpool(const XLATensorPtr& input,
                                    const XLATensorPtr& indices,
                                    std::vector<int64_t> output_size) {
-  return input->CreateFrom(torch::lazy::MakeNode<MaxUnpoolNd>(
+  return input->CreateFrom(MakeXlaNode<MaxUnpoolNd>(
       input->GetIrValue(), indices->GetIrValue(), std::move(output_size)));
 }
 
@@ -1818,11 +2466,11 @@ XLATensorPtr XLATensor::mean(const XLATensorPtr& input,
     dtype = input->dtype_optional();
   }
   return input->CreateFrom(
-      torch::lazy::MakeNode<Mean>(input->GetIrValue(),
-                                  torch::lazy::GetCanonicalDimensionIndices(
-                                      xla::util::ToVector<int64_t>(dimensions),
-                                      input->shape().get().rank()),
-                                  keep_reduced_dimensions, dtype),
+      MakeXlaNode<Mean>(input->GetIrValue(),
+                        torch::lazy::GetCanonicalDimensionIndices(
+                            xla::util::ToVector<int64_t>(dimensions),
+                            input->shape().get().rank()),
+                        keep_reduced_dimensions, dtype),
       dtype);
 }
 
@@ -1842,7 +2490,7 @@ std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::min(const XLATensorPtr& input,
                                                       bool keepdim) {
   int64_t canonical_dim =
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<MinInDim>(
+  torch::lazy::NodePtr node = MakeXlaNode<MinInDim>(
       input->GetIrValue(), canonical_dim, keepdim);
   return std::make_tuple(
       input->CreateFrom(torch::lazy::Value(node, 0)),
@@ -1853,7 +2501,7 @@ void XLATensor::min_out(XLATensorPtr& min, XLATensorPtr& min_indices,
                         const XLATensorPtr& input, int64_t dim, bool keepdim) {
   int64_t canonical_dim =
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<MinInDim>(
+  torch::lazy::NodePtr node = MakeXlaNode<MinInDim>(
       input->GetIrValue(), canonical_dim, keepdim);
   min->SetIrValue(torch::lazy::Value(node, 0));
   min_indices->SetIrValue(torch::lazy::Value(node, 1));
@@ -1861,7 +2509,7 @@ void XLATensor::min_out(XLATensorPtr& min, XLATensorPtr& min_indices,
 
 XLATensorPtr XLATensor::mish(const XLATensorPtr& input) {
   return input->CreateFrom(input->GetIrValue() *
-                           torch::lazy::MakeNode<Tanh>(
+                           MakeXlaNode<Tanh>(
                                tensor_ops::Softplus(input, 1, 20)->GetIrValue(),
                                std::vector<torch::lazy::Shape>()));
 }
@@ -1875,15 +2523,15 @@ XLATensorPtr XLATensor::mse_loss(const XLATensorPtr& input,
                                  const XLATensorPtr& target,
                                  int64_t reduction) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<MseLoss>(input->GetIrValue(), target->GetIrValue(),
-                                     GetXlaReductionMode(reduction)));
+      MakeXlaNode<MseLoss>(input->GetIrValue(), target->GetIrValue(),
+                           GetXlaReductionMode(reduction)));
 }
 
 XLATensorPtr XLATensor::mse_loss_backward(const XLATensorPtr& grad_output,
                                           const XLATensorPtr& input,
                                           const XLATensorPtr& target,
                                           int64_t reduction) {
-  return input->CreateFrom(torch::lazy::MakeNode<MseLossBackward>(
+  return input->CreateFrom(MakeXlaNode<MseLossBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), target->GetIrValue(),
       GetXlaReductionMode(reduction)));
 }
@@ -1960,7 +2608,7 @@ XLATensor::native_batch_norm(const XLATensorPtr& input,
       GetIrValueOrDefault(running_mean, 0, features_shape, input->GetDevice());
   torch::lazy::Value running_var_value =
       GetIrValueOrDefault(running_var, 0, features_shape, input->GetDevice());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<NativeBatchNormForward>(
+  torch::lazy::NodePtr node = MakeXlaNode<NativeBatchNormForward>(
       input->GetIrValue(), weight_value, bias_value, running_mean_value,
       running_var_value, training, eps);
   XLATensorPtr output = input->CreateFrom(torch::lazy::Value(node, 0));
@@ -1970,11 +2618,11 @@ XLATensor::native_batch_norm(const XLATensorPtr& input,
     mean = input->CreateFrom(torch::lazy::Value(node, 1));
     variance_inverse = input->CreateFrom(torch::lazy::Value(node, 3));
     if (running_mean) {
-      running_mean->SetIrValue(torch::lazy::MakeNode<LinearInterpolation>(
+      running_mean->SetIrValue(MakeXlaNode<LinearInterpolation>(
           mean->GetIrValue(), running_mean->GetIrValue(), momentum));
     }
     if (running_var) {
-      running_var->SetIrValue(torch::lazy::MakeNode<LinearInterpolation>(
+      running_var->SetIrValue(MakeXlaNode<LinearInterpolation>(
           torch::lazy::Value(node, 2), running_var->GetIrValue(), momentum));
     }
   } else {
@@ -1996,7 +2644,7 @@ XLATensor::native_batch_norm_backward(const XLATensorPtr& grad_out,
   xla::Shape features_shape = BatchNormFeaturesShape(input);
   torch::lazy::Value weight_value =
       GetIrValueOrDefault(weight, 1, features_shape, input->GetDevice());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<NativeBatchNormBackward>(
+  torch::lazy::NodePtr node = MakeXlaNode<NativeBatchNormBackward>(
       grad_out->GetIrValue(), input->GetIrValue(), weight_value,
       save_mean->GetIrValue(), save_invstd->GetIrValue(), training, eps);
   XLATensorPtr grad_input = input->CreateFrom(torch::lazy::Value(node, 0));
@@ -2023,7 +2671,7 @@ XLATensorPtr XLATensor::nll_loss(const XLATensorPtr& input,
                                  const XLATensorPtr& target,
                                  const XLATensorPtr& weight, int64_t reduction,
                                  int ignore_index) {
-  return input->CreateFrom(torch::lazy::MakeNode<NllLoss>(
+  return input->CreateFrom(MakeXlaNode<NllLoss>(
       input->GetIrValue(), target->GetIrValue(), GetOptionalIrValue(weight),
       GetXlaReductionMode(reduction), ignore_index));
 }
@@ -2032,7 +2680,7 @@ XLATensorPtr XLATensor::nll_loss2d(const XLATensorPtr& input,
                                    const XLATensorPtr& target,
                                    const XLATensorPtr& weight,
                                    int64_t reduction, int ignore_index) {
-  return input->CreateFrom(torch::lazy::MakeNode<NllLoss2d>(
+  return input->CreateFrom(MakeXlaNode<NllLoss2d>(
       input->GetIrValue(), target->GetIrValue(), GetOptionalIrValue(weight),
       GetXlaReductionMode(reduction), ignore_index));
 }
@@ -2043,7 +2691,7 @@ XLATensorPtr XLATensor::nll_loss2d_backward(const XLATensorPtr& grad_output,
                                             const XLATensorPtr& weight,
                                             int64_t reduction, int ignore_index,
                                             const XLATensorPtr& total_weight) {
-  return input->CreateFrom(torch::lazy::MakeNode<NllLoss2dBackward>(
+  return input->CreateFrom(MakeXlaNode<NllLoss2dBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), target->GetIrValue(),
       GetOptionalIrValue(weight), GetOptionalIrValue(total_weight),
       GetXlaReductionMode(reduction), ignore_index));
@@ -2055,7 +2703,7 @@ XLATensorPtr XLATensor::nll_loss_backward(const XLATensorPtr& grad_output,
                                           const XLATensorPtr& weight,
                                           int64_t reduction, int ignore_index,
                                           const XLATensorPtr& total_weight) {
-  return input->CreateFrom(torch::lazy::MakeNode<NllLossBackward>(
+  return input->CreateFrom(MakeXlaNode<NllLossBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), target->GetIrValue(),
       GetOptionalIrValue(weight), GetOptionalIrValue(total_weight),
       GetXlaReductionMode(reduction), ignore_index));
@@ -2065,7 +2713,7 @@ std::pair<XLATensorPtr, XLATensorPtr> XLATensor::nms(
     const XLATensorPtr& boxes, const XLATensorPtr& scores,
     const XLATensorPtr& score_threshold, const XLATensorPtr& iou_threshold,
     int64_t output_size) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<Nms>(
+  torch::lazy::NodePtr node = MakeXlaNode<Nms>(
       boxes->GetIrValue(), scores->GetIrValue(), score_threshold->GetIrValue(),
       iou_threshold->GetIrValue(), output_size);
   return std::pair<XLATensorPtr, XLATensorPtr>(
@@ -2077,10 +2725,20 @@ std::pair<XLATensorPtr, XLATensorPtr> XLATensor::nms(
 
 XLATensorPtr XLATensor::nonzero(const XLATensorPtr& input) {
   torch::lazy::NodePtr node =
-      torch::lazy::MakeNode<NonZero>(input->GetIrValue());
+      MakeXlaNode<NonZero>(input->GetIrValue());
   return input->CreateFrom(torch::lazy::Value(node, 0), at::ScalarType::Long);
 }
 
+std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::nonzero_padded(
+    const XLATensorPtr& input) {
+  XLA_COUNTER("AvoidedSizeSyncs", 1);
+  torch::lazy::NodePtr node =
+      MakeXlaNode<NonZero>(input->GetIrValue(), /*padded=*/true);
+  return std::make_tuple(
+      input->CreateFrom(torch::lazy::Value(node, 0), at::ScalarType::Long),
+      input->CreateFrom(torch::lazy::Value(node, 1), at::ScalarType::Long));
+}
+
 XLATensorPtr XLATensor::norm(const XLATensorPtr& input,
                              const c10::optional<at::Scalar>& p,
                              c10::optional<at::ScalarType> dtype,
@@ -2095,13 +2753,13 @@ XLATensorPtr XLATensor::norm(const XLATensorPtr& input,
 }
 
 XLATensorPtr XLATensor::normal(double mean, const XLATensorPtr& std) {
-  return std->CreateFrom(torch::lazy::MakeNode<Normal>(
+  return std->CreateFrom(MakeXlaNode<Normal>(
       GetIrValueForScalar(mean, std->shape(), std->GetDevice()),
       std->GetIrValue(), GetRngSeed(std->GetDevice())));
 }
 
 XLATensorPtr XLATensor::normal(const XLATensorPtr& mean, double std) {
-  return mean->CreateFrom(torch::lazy::MakeNode<Normal>(
+  return mean->CreateFrom(MakeXlaNode<Normal>(
       mean->GetIrValue(),
       GetIrValueForScalar(std, mean->shape(), mean->GetDevice()),
       GetRngSeed(mean->GetDevice())));
@@ -2109,13 +2767,13 @@ XLATensorPtr XLATensor::normal(const XLATensorPtr& mean, double std) {
 
 XLATensorPtr XLATensor::normal(const XLATensorPtr& mean,
                                const XLATensorPtr& std) {
-  return mean->CreateFrom(torch::lazy::MakeNode<Normal>(
+  return mean->CreateFrom(MakeXlaNode<Normal>(
       mean->GetIrValue(), MaybeExpand(std->GetIrValue(), mean->shape()),
       GetRngSeed(mean->GetDevice())));
 }
 
 void XLATensor::normal_(XLATensorPtr& input, double mean, double std) {
-  input->SetInPlaceIrValue(torch::lazy::MakeNode<Normal>(
+  input->SetInPlaceIrValue(MakeXlaNode<Normal>(
       GetIrValueForScalar(mean, input->shape(), input->GetDevice()),
       GetIrValueForScalar(std, input->shape(), input->GetDevice()),
       GetRngSeed(input->GetDevice())));
@@ -2124,8 +2782,8 @@ void XLATensor::normal_(XLATensorPtr& input, double mean, double std) {
 XLATensorPtr XLATensor::not_supported(
     std::string description, xla::Shape shape,
     const torch::lazy::BackendDevice& device) {
-  return Create(torch::lazy::MakeNode<NotSupported>(std::move(description),
-                                                    std::move(shape)),
+  return Create(MakeXlaNode<NotSupported>(std::move(description),
+                                          std::move(shape)),
                 device);
 }
 
@@ -2135,7 +2793,7 @@ void XLATensor::optimization_barrier_(std::vector<XLATensorPtr>& tensors) {
   for (XLATensorPtr& tensor : tensors) {
     irs.push_back(tensor->GetIrValue());
   }
-  torch::lazy::NodePtr result = torch::lazy::MakeNode<OptimizationBarrier>(irs);
+  torch::lazy::NodePtr result = MakeXlaNode<OptimizationBarrier>(irs);
   for (int i = 0; i < tensors.size(); i++) {
     tensors[i]->SetInPlaceIrValue(torch::lazy::Value(result, i));
   }
@@ -2185,33 +2843,62 @@ XLATensorPtr XLATensor::prod(const XLATensorPtr& input,
     dtype = input->dtype_optional();
   }
   return input->CreateFrom(
-      torch::lazy::MakeNode<Prod>(input->GetIrValue(),
-                                  torch::lazy::GetCanonicalDimensionIndices(
-                                      xla::util::ToVector<int64_t>(dimensions),
-                                      input->shape().get().rank()),
-                                  keep_reduced_dimensions, dtype),
+      MakeXlaNode<Prod>(input->GetIrValue(),
+                        torch::lazy::GetCanonicalDimensionIndices(
+                            xla::util::ToVector<int64_t>(dimensions),
+                            input->shape().get().rank()),
+                        keep_reduced_dimensions, dtype),
       dtype);
 }
 
 void XLATensor::put_(XLATensorPtr& input, const XLATensorPtr& index,
                      const XLATensorPtr& source, bool accumulate) {
   input->SetInPlaceIrValue(
-      torch::lazy::MakeNode<Put>(input->GetIrValue(), index->GetIrValue(),
-                                 source->GetIrValue(), accumulate));
+      MakeXlaNode<Put>(input->GetIrValue(), index->GetIrValue(),
+                       source->GetIrValue(), accumulate));
 }
 
 std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::qr(const XLATensorPtr& input,
                                                      bool some) {
   torch::lazy::NodePtr node =
-      torch::lazy::MakeNode<QR>(input->GetIrValue(), some);
+      MakeXlaNode<QR>(input->GetIrValue(), some);
   return std::make_tuple(input->CreateFrom(torch::lazy::Value(node, 0)),
                          input->CreateFrom(torch::lazy::Value(node, 1)));
 }
 
+XLATensorPtr XLATensor::quantized_linear(const XLATensorPtr& input,
+                                         const XLATensorPtr& weight,
+                                         const XLATensorPtr& weight_scales,
+                                         const XLATensorPtr& bias,
+                                         const QuantizationParams& params) {
+  CheckQuantizationParams(params);
+  return input->CreateFrom(
+      MakeXlaNode<QuantizedLinear>(
+          input->GetIrValue(), weight->GetIrValue(),
+          weight_scales->GetIrValue(), GetOptionalIrValue(bias), params),
+      GetQuantizedOutputType(params));
+}
+
+XLATensorPtr XLATensor::quantized_convolution(
+    const XLATensorPtr& input, const XLATensorPtr& weight,
+    const XLATensorPtr& weight_scales, const XLATensorPtr& bias,
+    std::vector<int64_t> stride, std::vector<int64_t> padding,
+    std::vector<int64_t> dilation, int64_t groups,
+    const QuantizationParams& params) {
+  CheckQuantizationParams(params);
+  return input->CreateFrom(
+      MakeXlaNode<QuantizedConvolution>(
+          input->GetIrValue(), weight->GetIrValue(),
+          weight_scales->GetIrValue(), GetOptionalIrValue(bias),
+          std::move(stride), std::move(padding), std::move(dilation), groups,
+          params),
+      GetQuantizedOutputType(params));
+}
+
 void XLATensor::random_(XLATensorPtr& input, int64_t from, int64_t to) {
   XLA_CHECK_LE(from, to);
   auto input_shape = input->shape();
-  input->SetInPlaceIrValue(torch::lazy::MakeNode<DiscreteUniform>(
+  input->SetInPlaceIrValue(MakeXlaNode<DiscreteUniform>(
       GetIrValueForScalar(from, xla::PrimitiveType::S64, input->GetDevice()),
       GetIrValueForScalar(to, xla::PrimitiveType::S64, input->GetDevice()),
       GetRngSeed(input->GetDevice()), input_shape));
@@ -2219,14 +2906,14 @@ void XLATensor::random_(XLATensorPtr& input, int64_t from, int64_t to) {
 
 XLATensorPtr XLATensor::reflection_pad2d(const XLATensorPtr& input,
                                          std::vector<int64_t> padding) {
-  return input->CreateFrom(torch::lazy::MakeNode<ReflectionPad2d>(
+  return input->CreateFrom(MakeXlaNode<ReflectionPad2d>(
       input->GetIrValue(), std::move(padding)));
 }
 
 XLATensorPtr XLATensor::reflection_pad2d_backward(
     const XLATensorPtr& grad_output, const XLATensorPtr& input,
     std::vector<int64_t> padding) {
-  return input->CreateFrom(torch::lazy::MakeNode<ReflectionPad2dBackward>(
+  return input->CreateFrom(MakeXlaNode<ReflectionPad2dBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), std::move(padding)));
 }
 
@@ -2253,39 +2940,39 @@ XLATensorPtr XLATensor::remainder(const XLATensorPtr& input,
 XLATensorPtr XLATensor::repeat(const XLATensorPtr& input,
                                std::vector<int64_t> repeats) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Repeat>(input->GetIrValue(), std::move(repeats)));
+      MakeXlaNode<Repeat>(input->GetIrValue(), std::move(repeats)));
 }
 
 XLATensorPtr XLATensor::replication_pad1d(const XLATensorPtr& input,
                                           std::vector<int64_t> padding) {
-  return input->CreateFrom(torch::lazy::MakeNode<ReplicationPad>(
+  return input->CreateFrom(MakeXlaNode<ReplicationPad>(
       input->GetIrValue(), std::move(padding)));
 }
 
 XLATensorPtr XLATensor::replication_pad1d_backward(
     const XLATensorPtr& grad_output, const XLATensorPtr& input,
     std::vector<int64_t> padding) {
-  return input->CreateFrom(torch::lazy::MakeNode<ReplicationPadBackward>(
+  return input->CreateFrom(MakeXlaNode<ReplicationPadBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), std::move(padding)));
 }
 
 XLATensorPtr XLATensor::replication_pad2d(const XLATensorPtr& input,
                                           std::vector<int64_t> padding) {
-  return input->CreateFrom(torch::lazy::MakeNode<ReplicationPad>(
+  return input->CreateFrom(MakeXlaNode<ReplicationPad>(
       input->GetIrValue(), std::move(padding)));
 }
 
 XLATensorPtr XLATensor::replication_pad2d_backward(
     const XLATensorPtr& grad_output, const XLATensorPtr& input,
     std::vector<int64_t> padding) {
-  return input->CreateFrom(torch::lazy::MakeNode<ReplicationPadBackward>(
+  return input->CreateFrom(MakeXlaNode<ReplicationPadBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), std::move(padding)));
 }
 
 void XLATensor::resize_(XLATensorPtr& input, std::vector<int64_t> size) {
   if (input->data()->view == nullptr) {
     input->SetIrValue(
-        torch::lazy::MakeNode<Resize>(input->GetIrValue(), std::move(size)));
+        MakeXlaNode<Resize>(input->GetIrValue(), std::move(size)));
   } else {
     auto input_shape = input->shape();
     xla::Shape resize_shape =
@@ -2307,7 +2994,7 @@ XLATensorPtr XLATensor::roll(const XLATensorPtr& input,
   }
   auto canonical_dims = torch::lazy::GetCanonicalDimensionIndices(
       torch::lazy::ToVector<int64_t>(dims), input->shape().get().rank());
-  return input->CreateFrom(torch::lazy::MakeNode<Roll>(
+  return input->CreateFrom(MakeXlaNode<Roll>(
       input->GetIrValue(), torch::lazy::ToVector<int64_t>(shifts),
       canonical_dims));
 }
@@ -2317,7 +3004,7 @@ XLATensorPtr XLATensor::rrelu_with_noise(const XLATensorPtr& input,
                                          const at::Scalar& lower,
                                          const at::Scalar& upper,
                                          bool training) {
-  torch::lazy::NodePtr output_node = torch::lazy::MakeNode<RreluWithNoise>(
+  torch::lazy::NodePtr output_node = MakeXlaNode<RreluWithNoise>(
       input->GetIrValue(), GetRngSeed(input->GetDevice()), lower, upper,
       training);
   noise->SetIrValue(torch::lazy::Value(output_node, 1));
@@ -2328,7 +3015,7 @@ XLATensorPtr XLATensor::rrelu_with_noise_backward(
     const XLATensorPtr& grad_output, const XLATensorPtr& input,
     const XLATensorPtr& noise, const at::Scalar& lower, const at::Scalar& upper,
     bool training) {
-  return grad_output->CreateFrom(torch::lazy::MakeNode<RreluWithNoiseBackward>(
+  return grad_output->CreateFrom(MakeXlaNode<RreluWithNoiseBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), noise->GetIrValue(),
       lower, upper, training));
 }
@@ -2357,12 +3044,23 @@ XLATensorPtr XLATensor::rsub(
 
 void XLATensor::copy_(XLATensorPtr& input, XLATensorPtr& src) {
   if (input->GetDevice() == src->GetDevice()) {
+    // The shared data is never sharded, so it can only replace the data of an
+    // input without a sharding annotation.
+    if (input->dtype() == src->dtype() && input->data()->view == nullptr &&
+        input->sharding_spec() == nullptr &&
+        input->shape().get() == src->shape().get()) {
+      torch::lazy::BackendDataPtr xla_data = src->GetSharedXlaData();
+      if (xla_data != nullptr) {
+        input->SetXlaData(std::move(xla_data));
+        return;
+      }
+    }
     torch::lazy::Value copy_value;
     if (input->dtype() == src->dtype()) {
       copy_value = src->GetIrValue();
     } else {
-      copy_value = torch::lazy::MakeNode<Cast>(src->GetIrValue(),
-                                               input->dtype(), src->dtype());
+      copy_value = MakeXlaNode<Cast>(src->GetIrValue(),
+                                     input->dtype(), src->dtype());
     }
     input->SetIrValue(MaybeExpand(copy_value, input->shape()));
   } else {
@@ -2379,7 +3077,7 @@ void XLATensor::copy_(XLATensorPtr& input, XLATensorPtr& src) {
 XLATensorPtr XLATensor::scatter(const XLATensorPtr& input, int64_t dim,
                                 const XLATensorPtr& index,
                                 const XLATensorPtr& src) {
-  return input->CreateFrom(torch::lazy::MakeNode<Scatter>(
+  return input->CreateFrom(MakeXlaNode<Scatter>(
       input->GetIrValue(), index->GetIrValue(), src->GetIrValue(),
       torch::lazy::GetCanonicalDimensionIndex(dim,
                                               input->shape().get().rank())));
@@ -2390,7 +3088,7 @@ XLATensorPtr XLATensor::scatter(const XLATensorPtr& input, int64_t dim,
                                 const at::Scalar& value) {
   torch::lazy::Value constant =
       GetIrValueForScalar(value, input->shape(), input->GetDevice());
-  return input->CreateFrom(torch::lazy::MakeNode<Scatter>(
+  return input->CreateFrom(MakeXlaNode<Scatter>(
       input->GetIrValue(), index->GetIrValue(), constant,
       torch::lazy::GetCanonicalDimensionIndex(dim,
                                               input->shape().get().rank())));
@@ -2399,7 +3097,7 @@ XLATensorPtr XLATensor::scatter(const XLATensorPtr& input, int64_t dim,
 XLATensorPtr XLATensor::scatter_add(const XLATensorPtr& input, int64_t dim,
                                     const XLATensorPtr& index,
                                     const XLATensorPtr& src) {
-  return input->CreateFrom(torch::lazy::MakeNode<ScatterAdd>(
+  return input->CreateFrom(MakeXlaNode<ScatterAdd>(
       input->GetIrValue(), index->GetIrValue(), src->GetIrValue(),
       torch::lazy::GetCanonicalDimensionIndex(dim,
                                               input->shape().get().rank())));
@@ -2410,7 +3108,7 @@ XLATensorPtr XLATensor::scatter_add(const XLATensorPtr& input, int64_t dim,
                                     const at::Scalar& value) {
   torch::lazy::Value constant =
       GetIrValueForScalar(value, input->shape(), input->GetDevice());
-  return input->CreateFrom(torch::lazy::MakeNode<ScatterAdd>(
+  return input->CreateFrom(MakeXlaNode<ScatterAdd>(
       input->GetIrValue(), index->GetIrValue(), constant,
       torch::lazy::GetCanonicalDimensionIndex(dim,
                                               input->shape().get().rank())));
@@ -2425,10 +3123,6 @@ void XLATensor::selu_(XLATensorPtr& input) {
   input->SetInPlaceIrValue(Selu(input->GetIrValue()));
 }
 
-XLATensorPtr XLATensor::sigmoid(const XLATensorPtr& input) {
-  return input->CreateFrom(Sigmoid(input->GetIrValue()));
-}
-
 XLATensorPtr XLATensor::sigmoid_backward(const XLATensorPtr& grad_output,
                                          const XLATensorPtr& output) {
   return grad_output->CreateFrom(
@@ -2483,10 +3177,10 @@ XLATensorPtr XLATensor::softmax(const XLATensorPtr& input, int64_t dim,
     dtype = input->dtype_optional();
   }
   return input->CreateFrom(
-      torch::lazy::MakeNode<Softmax>(input->GetIrValue(),
-                                     torch::lazy::GetCanonicalDimensionIndex(
-                                         dim, input->shape().get().rank()),
-                                     dtype),
+      MakeXlaNode<Softmax>(input->GetIrValue(),
+                           torch::lazy::GetCanonicalDimensionIndex(
+                               dim, input->shape().get().rank()),
+                           dtype),
       dtype);
 }
 
@@ -2518,13 +3212,13 @@ XLATensorPtr XLATensor::softplus_backward(const XLATensorPtr& grad_output,
 XLATensorPtr XLATensor::softshrink(const XLATensorPtr& input,
                                    const at::Scalar& lambda) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Softshrink>(input->GetIrValue(), lambda));
+      MakeXlaNode<Softshrink>(input->GetIrValue(), lambda));
 }
 
 XLATensorPtr XLATensor::softshrink_backward(const XLATensorPtr& grad_out,
                                             const XLATensorPtr& input,
                                             const at::Scalar& lambda) {
-  return input->CreateFrom(torch::lazy::MakeNode<ShrinkBackward>(
+  return input->CreateFrom(MakeXlaNode<ShrinkBackward>(
       torch::lazy::OpKind(at::aten::softshrink_backward),
       grad_out->GetIrValue(), input->GetIrValue(), lambda));
 }
@@ -2540,13 +3234,13 @@ std::vector<XLATensorPtr> XLATensor::split(const XLATensorPtr& input,
     // no matter what split_size is.
     xla::Literal literal(input_shape.get());
     return {
-        input->CreateFrom(torch::lazy::MakeNode<Constant>(std::move(literal)))};
+        input->CreateFrom(MakeXlaNode<Constant>(std::move(literal)))};
   }
   std::vector<int64_t> split_sizes;
   for (; dim_size > 0; dim_size -= split_size) {
     split_sizes.push_back(std::min<int64_t>(dim_size, split_size));
   }
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<Split>(
+  torch::lazy::NodePtr node = MakeXlaNode<Split>(
       input->GetIrValue(), std::move(split_sizes), split_dim);
   return input->MakeOutputTensors(node);
 }
@@ -2556,15 +3250,11 @@ std::vector<XLATensorPtr> XLATensor::split_with_sizes(
   auto input_shape = input->shape();
   int split_dim =
       torch::lazy::GetCanonicalDimensionIndex(dim, input_shape.get().rank());
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<Split>(
+  torch::lazy::NodePtr node = MakeXlaNode<Split>(
       input->GetIrValue(), std::move(split_size), split_dim);
   return input->MakeOutputTensors(node);
 }
 
-XLATensorPtr XLATensor::sqrt(const XLATensorPtr& input) {
-  return input->CreateFrom(Sqrt(input->GetIrValue()));
-}
-
 XLATensorPtr XLATensor::squeeze(const XLATensorPtr& input) {
   auto input_shape = input->shape();
   auto output_dimensions = BuildSqueezedDimensions(
@@ -2582,11 +3272,11 @@ XLATensorPtr XLATensor::squeeze(const XLATensorPtr& input, int64_t dim) {
 }
 
 void XLATensor::squeeze_(XLATensorPtr& input) {
-  input->SetIrValue(torch::lazy::MakeNode<Squeeze>(input->GetIrValue(), -1));
+  input->SetIrValue(MakeXlaNode<Squeeze>(input->GetIrValue(), -1));
 }
 
 void XLATensor::squeeze_(XLATensorPtr& input, int64_t dim) {
-  input->SetIrValue(torch::lazy::MakeNode<Squeeze>(
+  input->SetIrValue(MakeXlaNode<Squeeze>(
       input->GetIrValue(), torch::lazy::GetCanonicalDimensionIndex(
                                dim, input->shape().get().rank())));
 }
@@ -2601,24 +3291,24 @@ XLATensorPtr XLATensor::stack(absl::Span<const XLATensorPtr> tensors,
   int64_t canonical_dim = torch::lazy::GetCanonicalDimensionIndex(
       dim, tensors.front()->shape().get().rank() + 1);
   return tensors[0]->CreateFrom(
-      torch::lazy::MakeNode<Stack>(values, canonical_dim));
+      MakeXlaNode<Stack>(values, canonical_dim));
 }
 
 XLATensorPtr XLATensor::std(const XLATensorPtr& input,
                             std::vector<int64_t> dimensions,
                             bool keep_reduced_dimensions, int64_t correction) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Std>(input->GetIrValue(),
-                                 torch::lazy::GetCanonicalDimensionIndices(
-                                     xla::util::ToVector<int64_t>(dimensions),
-                                     input->shape().get().rank()),
-                                 keep_reduced_dimensions, correction));
+      MakeXlaNode<Std>(input->GetIrValue(),
+                       torch::lazy::GetCanonicalDimensionIndices(
+                           xla::util::ToVector<int64_t>(dimensions),
+                           input->shape().get().rank()),
+                       keep_reduced_dimensions, correction));
 }
 
 std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::std_mean(
     const XLATensorPtr& input, std::vector<int64_t> dimensions,
     int64_t correction, bool keep_reduced_dimensions) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<StdMean>(
+  torch::lazy::NodePtr node = MakeXlaNode<StdMean>(
       input->GetIrValue(),
       torch::lazy::GetCanonicalDimensionIndices(
           xla::util::ToVector<int64_t>(dimensions),
@@ -2660,18 +3350,35 @@ XLATensorPtr XLATensor::sum(const XLATensorPtr& input,
     dtype = input->dtype_optional();
   }
   return input->CreateFrom(
-      torch::lazy::MakeNode<Sum>(input->GetIrValue(),
-                                 torch::lazy::GetCanonicalDimensionIndices(
-                                     xla::util::ToVector<int64_t>(dimensions),
-                                     input->shape().get().rank()),
-                                 keep_reduced_dimensions, dtype),
+      MakeXlaNode<Sum>(input->GetIrValue(),
+                       torch::lazy::GetCanonicalDimensionIndices(
+                           xla::util::ToVector<int64_t>(dimensions),
+                           input->shape().get().rank()),
+                       keep_reduced_dimensions, dtype),
       dtype);
 }
 
+void XLATensor::summary_scalar_update_(XLATensorPtr& state,
+                                       const XLATensorPtr& value,
+                                       double ema_decay) {
+  state->SetInPlaceIrValue(MakeXlaNode<SummaryUpdate>(
+      state->GetIrValue(), value->GetIrValue(), SummaryUpdate::Kind::kScalar,
+      ema_decay, /*min_value=*/0.0, /*max_value=*/0.0));
+}
+
+void XLATensor::summary_histogram_update_(XLATensorPtr& state,
+                                          const XLATensorPtr& value,
+                                          double min_value, double max_value) {
+  XLA_CHECK_LT(min_value, max_value);
+  state->SetInPlaceIrValue(MakeXlaNode<SummaryUpdate>(
+      state->GetIrValue(), value->GetIrValue(), SummaryUpdate::Kind::kHistogram,
+      /*ema_decay=*/0.0, min_value, max_value));
+}
+
 std::tuple<XLATensorPtr, XLATensorPtr, XLATensorPtr> XLATensor::svd(
     const XLATensorPtr& input, bool some, bool compute_uv) {
   torch::lazy::NodePtr node =
-      torch::lazy::MakeNode<SVD>(input->GetIrValue(), some, compute_uv);
+      MakeXlaNode<SVD>(input->GetIrValue(), some, compute_uv);
   return std::make_tuple(input->CreateFrom(torch::lazy::Value(node, 0)),
                          input->CreateFrom(torch::lazy::Value(node, 1)),
                          input->CreateFrom(torch::lazy::Value(node, 2)));
@@ -2681,7 +3388,7 @@ std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::symeig(
     const XLATensorPtr& input, bool eigenvectors, bool upper) {
   // SymEig takes lower instead of upper, hence the negation.
   torch::lazy::NodePtr node =
-      torch::lazy::MakeNode<SymEig>(input->GetIrValue(), eigenvectors, !upper);
+      MakeXlaNode<SymEig>(input->GetIrValue(), eigenvectors, !upper);
   return std::make_tuple(input->CreateFrom(torch::lazy::Value(node, 0)),
                          input->CreateFrom(torch::lazy::Value(node, 1)));
 }
@@ -2700,13 +3407,13 @@ XLATensorPtr XLATensor::tanh_backward(const XLATensorPtr& grad_output,
 XLATensorPtr XLATensor::threshold(const XLATensorPtr& input, float threshold,
                                   float value) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Threshold>(input->GetIrValue(), threshold, value));
+      MakeXlaNode<Threshold>(input->GetIrValue(), threshold, value));
 }
 
 XLATensorPtr XLATensor::threshold_backward(const XLATensorPtr& grad_output,
                                            const XLATensorPtr& input,
                                            float threshold) {
-  return grad_output->CreateFrom(torch::lazy::MakeNode<ThresholdBackward>(
+  return grad_output->CreateFrom(MakeXlaNode<ThresholdBackward>(
       grad_output->GetIrValue(), input->GetIrValue(), threshold));
 }
 
@@ -2734,7 +3441,7 @@ XLATensorPtr XLATensor::to(XLATensorPtr& input,
 std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::topk(
     const XLATensorPtr& input, int64_t k, int64_t dim, bool largest,
     bool sorted, bool stable) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<TopK>(
+  torch::lazy::NodePtr node = MakeXlaNode<TopK>(
       input->GetIrValue(), k,
       torch::lazy::GetCanonicalDimensionIndex(dim, input->shape().get().rank()),
       largest, sorted, stable);
@@ -2775,7 +3482,7 @@ std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::triangular_solve(
     const XLATensorPtr& rhs, const XLATensorPtr& lhs, bool left_side,
     bool upper, bool transpose, bool unitriangular) {
   // TriangularSolve takes lower instead of upper, hence the negation.
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<TriangularSolve>(
+  torch::lazy::NodePtr node = MakeXlaNode<TriangularSolve>(
       rhs->GetIrValue(), lhs->GetIrValue(), left_side, !upper, transpose,
       unitriangular);
   return std::make_tuple(rhs->CreateFrom(torch::lazy::Value(node, 0)),
@@ -2802,7 +3509,7 @@ std::vector<XLATensorPtr> XLATensor::unbind(const XLATensorPtr& input,
 void XLATensor::uniform_(XLATensorPtr& input, double from, double to) {
   XLA_CHECK_LE(from, to);
   auto input_shape = input->shape();
-  input->SetInPlaceIrValue(torch::lazy::MakeNode<Uniform>(
+  input->SetInPlaceIrValue(MakeXlaNode<Uniform>(
       GetIrValueForScalar(from, input_shape.get().element_type(),
                           input->GetDevice()),
       GetIrValueForScalar(to, input_shape.get().element_type(),
@@ -2823,13 +3530,13 @@ void XLATensor::unsqueeze_(XLATensorPtr& input, int64_t dim) {
   int squeeze_dim = torch::lazy::GetCanonicalDimensionIndex(
       dim, input->shape().get().rank() + 1);
   input->SetIrValue(
-      torch::lazy::MakeNode<Unsqueeze>(input->GetIrValue(), squeeze_dim));
+      MakeXlaNode<Unsqueeze>(input->GetIrValue(), squeeze_dim));
 }
 
 XLATensorPtr XLATensor::upsample_bilinear2d(const XLATensorPtr& input,
                                             std::vector<int64_t> output_size,
                                             bool align_corners) {
-  return input->CreateFrom(torch::lazy::MakeNode<UpsampleBilinear>(
+  return input->CreateFrom(MakeXlaNode<UpsampleBilinear>(
       input->GetIrValue(), std::move(output_size), align_corners));
 }
 
@@ -2837,21 +3544,21 @@ XLATensorPtr XLATensor::upsample_bilinear2d_backward(
     const XLATensorPtr& grad_output, std::vector<int64_t> output_size,
     std::vector<int64_t> input_size, bool align_corners) {
   return grad_output->CreateFrom(
-      torch::lazy::MakeNode<UpsampleBilinearBackward>(
+      MakeXlaNode<UpsampleBilinearBackward>(
           grad_output->GetIrValue(), std::move(output_size),
           std::move(input_size), align_corners));
 }
 
 XLATensorPtr XLATensor::upsample_nearest2d(const XLATensorPtr& input,
                                            std::vector<int64_t> output_size) {
-  return input->CreateFrom(torch::lazy::MakeNode<UpsampleNearest>(
+  return input->CreateFrom(MakeXlaNode<UpsampleNearest>(
       input->GetIrValue(), std::move(output_size)));
 }
 
 XLATensorPtr XLATensor::upsample_nearest2d_backward(
     const XLATensorPtr& grad_output, std::vector<int64_t> output_size,
     std::vector<int64_t> input_size) {
-  return grad_output->CreateFrom(torch::lazy::MakeNode<UpsampleNearestBackward>(
+  return grad_output->CreateFrom(MakeXlaNode<UpsampleNearestBackward>(
       grad_output->GetIrValue(), std::move(output_size),
       std::move(input_size)));
 }
@@ -2871,17 +3578,17 @@ XLATensorPtr XLATensor::var(const XLATensorPtr& input,
                             std::vector<int64_t> dimensions, int64_t correction,
                             bool keep_reduced_dimensions) {
   return input->CreateFrom(
-      torch::lazy::MakeNode<Var>(input->GetIrValue(),
-                                 torch::lazy::GetCanonicalDimensionIndices(
-                                     xla::util::ToVector<int64_t>(dimensions),
-                                     input->shape().get().rank()),
-                                 correction, keep_reduced_dimensions));
+      MakeXlaNode<Var>(input->GetIrValue(),
+                       torch::lazy::GetCanonicalDimensionIndices(
+                           xla::util::ToVector<int64_t>(dimensions),
+                           input->shape().get().rank()),
+                       correction, keep_reduced_dimensions));
 }
 
 std::tuple<XLATensorPtr, XLATensorPtr> XLATensor::var_mean(
     const XLATensorPtr& input, std::vector<int64_t> dimensions,
     int64_t correction, bool keep_reduced_dimensions) {
-  torch::lazy::NodePtr node = torch::lazy::MakeNode<VarMean>(
+  torch::lazy::NodePtr node = MakeXlaNode<VarMean>(
       input->GetIrValue(),
       torch::lazy::GetCanonicalDimensionIndices(
           xla::util::ToVector<int64_t>(dimensions),
@@ -183,54 +183,5 @@ XLATensorPtr Select(const XLATensorPtr& input, int64_t dim, int64_t index) {
   return XLATensor::view(result, new_dims);
 }
 
-XLATensorPtr EmbeddingDenseBackward(const XLATensorPtr& grad_output,
-                                    const XLATensorPtr& indices,
-                                    int64_t num_weights, int64_t padding_idx,
-                                    bool scale_grad_by_freq) {
-  XLA_CHECK_EQ(indices->dtype(), at::ScalarType::Long)
-      << "Embedding indices are expected to be of scalar type Long";
-  auto indices_shape_ref = indices->shape();
-  // The weight must be of rank 2, which means the rank of grad_output is one
-  // more than the indices.
-  XLA_CHECK_EQ(grad_output->shape().get().rank(),
-               indices_shape_ref.get().rank() + 1);
-  int64_t numel = xla::ShapeUtil::ElementsIn(indices_shape_ref.get());
-  XLATensorPtr grad =
-      XLATensor::view(grad_output, {numel, grad_output->size(-1)});
-  XLATensorPtr grad_weight =
-      XLATensor::full({num_weights, grad_output->size(-1)}, 0,
-                      grad_output->GetDevice(), grad_output->dtype());
-  XLATensorPtr indices_rank1 = XLATensor::view(indices, {numel});
-  if (scale_grad_by_freq) {
-    // Compute the histogram of index values.
-    XLATensorPtr counts = XLATensor::full(
-        {num_weights}, 0, indices->GetDevice(), indices->dtype());
-    XLATensorPtr ones =
-        XLATensor::full({numel}, 1, indices->GetDevice(), indices->dtype());
-    XLATensor::index_put_(counts, counts, {indices_rank1}, /*start_dim=*/0,
-                          /*values=*/ones,
-                          /*accumulate=*/true, /*result_permutation=*/{0});
-    XLATensorPtr grad_weights_scale =
-        XLATensor::index(counts, {indices_rank1}, 0);
-    // Scale the value of the gradient by the histogram.
-    grad = XLATensor::div(grad, XLATensor::unsqueeze(grad_weights_scale, 1));
-  }
-  // Don't accumulate gradients for indices which are equal with the given
-  // padding_idx.
-  XLATensorPtr skip_padding = XLATensor::unsqueeze(
-      XLATensor::ne(indices_rank1, static_cast<double>(padding_idx)), 1);
-  skip_padding = XLATensor::expand(
-      skip_padding,
-      torch::lazy::ToVector<int64_t>(grad->shape().get().dimensions()));
-  XLATensorPtr zero_grad =
-      XLATensor::full_like(grad, 0, grad->GetDevice(), grad->dtype());
-  return XLATensor::index_put(
-      grad_weight, {indices_rank1},
-      /*start_dim=*/0,
-      /*values=*/XLATensor::where(skip_padding, grad, zero_grad),
-      /*accumulate=*/true,
-      /*result_permutation=*/{0, 1});
-}
-
 }  // namespace tensor_ops
 }  // namespace torch_xla
@@ -33,10 +33,5 @@ XLATensorPtr SoftplusBackward(const XLATensorPtr& grad_output,
 
 XLATensorPtr Select(const XLATensorPtr& input, int64_t dim, int64_t index);
 
-XLATensorPtr EmbeddingDenseBackward(const XLATensorPtr& grad_output,
-                                    const XLATensorPtr& indices,
-                                    int64_t num_weights, int64_t padding_idx,
-                                    bool scale_grad_by_freq);
-
 }  // namespace tensor_ops
 }  // namespace torch_xla
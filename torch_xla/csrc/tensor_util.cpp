@@ -4,15 +4,24 @@
 #include <ATen/Functions.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <functional>
 #include <list>
+#include <map>
 #include <numeric>
 #include <thread>
 
+#include "absl/strings/str_cat.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/xla/layout_util.h"
 #include "tensorflow/compiler/xla/literal_util.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/service/hlo_sharding.h"
 #include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/cache.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/tf_logging.h"
@@ -22,9 +31,14 @@
 #include "tensorflow/core/lib/bfloat16/bfloat16.h"
 #include "torch/csrc/lazy/core/hash.h"
 #include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/copy_kernels.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/host_trace.h"
+#include "torch_xla/csrc/layout_autotuner.h"
 #include "torch_xla/csrc/layout_manager.h"
+#include "torch_xla/csrc/step_breakdown.h"
 #include "torch_xla/csrc/torch_util.h"
+#include "torch_xla/csrc/xla_sharding_util.h"
 
 namespace torch_xla {
 namespace {
@@ -377,6 +391,30 @@ void CopyData<tensorflow::bfloat16, at::BFloat16>(tensorflow::bfloat16* dest,
                                                   const CopyCasted&) {
   CheckedMemcpy<tensorflow::bfloat16, at::BFloat16>(dest, source, n);
 }
+template <>
+void CopyData<tensorflow::bfloat16, float>(tensorflow::bfloat16* dest,
+                                           const float* source, int64_t n,
+                                           const CopyCasted&) {
+  static_assert(sizeof(tensorflow::bfloat16) == sizeof(uint16_t),
+                "Unexpected bfloat16 size");
+  ConvertF32ToBF16(source, reinterpret_cast<uint16_t*>(dest), n);
+}
+template <>
+void CopyData<float, tensorflow::bfloat16>(float* dest,
+                                           const tensorflow::bfloat16* source,
+                                           int64_t n, const CopyCasted&) {
+  ConvertBF16ToF32(reinterpret_cast<const uint16_t*>(source), dest, n);
+}
+template <>
+void CopyData<int32_t, int64_t>(int32_t* dest, const int64_t* source,
+                                int64_t n, const CopyDirect&) {
+  ConvertS64ToS32(source, dest, n);
+}
+template <>
+void CopyData<int64_t, int32_t>(int64_t* dest, const int32_t* source,
+                                int64_t n, const CopyDirect&) {
+  ConvertS32ToS64(source, dest, n);
+}
 
 std::vector<int64_t> GetIterationDimensions(const xla::Shape& shape) {
   // We want to favor the most minor dimension as core iteration dimension, as
@@ -401,71 +439,99 @@ std::vector<int64_t> GetIterationDimensions(const xla::Shape& shape) {
   return iter_dims;
 }
 
-struct CopyPartition {
-  explicit CopyPartition(absl::Span<const int64_t> dimensions)
-      : base(dimensions.size()), limit(dimensions.begin(), dimensions.end()) {}
-
-  std::vector<int64_t> base;
-  std::vector<int64_t> limit;
-};
-
-std::vector<CopyPartition> CreateCopyPartitions(
-    absl::Span<const int64_t> dimensions, int64_t strided_copy_dimension) {
-  // The minimum number of elements copy that can be assigned to a thread.
-  static const int64_t kMinThreadElements = 100000;
-  // Use at most 50% of the available cores.
-  int64_t max_parts =
-      std::max<int64_t>(std::thread::hardware_concurrency() / 2, 1);
-  // Find the maximum dimension which is not the strided copy dimension.
-  int64_t max_dim = -1;
-  for (int64_t i = 0; i < dimensions.size(); ++i) {
-    if (i != strided_copy_dimension &&
-        (max_dim < 0 || dimensions[i] > dimensions[max_dim])) {
-      max_dim = i;
-    }
+// Runs copy_fn over the [0, num_rows) rows range, split in chunks which are
+// dynamically claimed by the copy pool threads, so that threads which are done
+// early pick up the slack of the slower ones.
+void ParallelCopyRows(int64_t num_rows, int64_t row_bytes,
+                      const std::function<void(int64_t, int64_t)>& copy_fn) {
+  // The minimum size of a chunk, to amortize the scheduling costs.
+  static const int64_t kMinChunkBytes = 64 * 1024;
+  static const int64_t kCacheLineSize = 64;
+  int64_t chunk_rows = std::max<int64_t>(kMinChunkBytes / row_bytes, 1);
+  // Keep the chunk boundaries on cache lines, when rows are smaller than one,
+  // to avoid threads writing the same lines.
+  int64_t line_rows = std::max<int64_t>(kCacheLineSize / row_bytes, 1);
+  chunk_rows = (chunk_rows + line_rows - 1) / line_rows * line_rows;
+  int64_t num_chunks = (num_rows + chunk_rows - 1) / chunk_rows;
+  int64_t num_workers = std::min<int64_t>(
+      num_chunks, static_cast<int64_t>(xla::env::GetCopyThreadPoolSize()));
+  if (num_workers <= 1) {
+    copy_fn(0, num_rows);
+    return;
   }
-
-  int64_t num_elements = xla::util::Multiply<int64_t>(dimensions);
-  int64_t max_dim_unit_elements = num_elements / dimensions[max_dim];
-  int64_t max_dim_size = dimensions[max_dim];
-  int64_t part_size =
-      std::max<int64_t>(std::max<int64_t>(max_dim_size / max_parts, 1),
-                        kMinThreadElements / max_dim_unit_elements);
-  std::vector<CopyPartition> parts;
-  int64_t csize = 0;
-  while (csize < max_dim_size) {
-    int64_t n = std::min<int64_t>(part_size, max_dim_size - csize);
-    CopyPartition p(dimensions);
-    p.base[max_dim] = csize;
-    p.limit[max_dim] = csize + n;
-    csize += n;
-    parts.emplace_back(std::move(p));
+  std::atomic<int64_t> next_chunk(0);
+  auto worker = [&]() {
+    for (int64_t chunk = next_chunk++; chunk < num_chunks;
+         chunk = next_chunk++) {
+      int64_t start_row = chunk * chunk_rows;
+      copy_fn(start_row, std::min(chunk_rows, num_rows - start_row));
+    }
+  };
+  // The calling thread is one of the workers.
+  auto mwait = std::make_shared<xla::util::MultiWait>(num_workers - 1);
+  for (int64_t i = 1; i < num_workers; ++i) {
+    xla::env::ScheduleCopyClosure(
+        xla::util::MultiWait::Completer(mwait, worker));
   }
-  return parts;
+  worker();
+  mwait->Wait();
 }
 
+// Copies num_rows rows, starting from start_row, where a row is the set of
+// elements along the iter_dims.front() dimension, and rows are enumerated
+// following the order of the other iter_dims.
+// Consecutive rows along iter_dims[1] are copied in square tiles, so that when
+// iter_dims[1] is the most minor dimension of the source, both the source reads
+// and the destination writes of a tile stay within a few cache lines (and TLB
+// entries), instead of striding over the whole source row.
 template <typename SType, typename DType>
-void SlicedCopy(absl::Span<const int64_t> dimensions, const SType* src_data,
-                absl::Span<const int64_t> src_strides, DType* dest_data,
-                absl::Span<const int64_t> dest_strides,
-                absl::Span<const int64_t> iter_dims,
-                const CopyPartition& part) {
-  std::vector<int64_t> indices(part.base);
-  int64_t inner_src_stride = src_strides[iter_dims.front()];
-  int64_t inner_dest_stride = dest_strides[iter_dims.front()];
-  int64_t n = 0;
-  while (n < indices.size()) {
-    StridedCopy(dest_data + GetFlatTensorOffset(dest_strides, indices),
-                inner_dest_stride,
-                src_data + GetFlatTensorOffset(src_strides, indices),
-                inner_src_stride, dimensions[iter_dims.front()]);
-    for (n = 1; n < indices.size(); ++n) {
+void CopyRows(absl::Span<const int64_t> dimensions, const SType* src_data,
+              absl::Span<const int64_t> src_strides, DType* dest_data,
+              absl::Span<const int64_t> dest_strides,
+              absl::Span<const int64_t> iter_dims, int64_t start_row,
+              int64_t num_rows) {
+  // A 32x32 tile of the largest element type is 32KB between source and
+  // destination, which fits the L1 cache.
+  static const int64_t kTileSize = 32;
+  std::vector<int64_t> indices(dimensions.size(), 0);
+  int64_t row = start_row;
+  for (size_t n = 1; n < iter_dims.size(); ++n) {
+    int64_t dim = iter_dims[n];
+    indices[dim] = row % dimensions[dim];
+    row /= dimensions[dim];
+  }
+  int64_t inner_dim = iter_dims.front();
+  int64_t tile_dim = iter_dims[1];
+  int64_t row_size = dimensions[inner_dim];
+  int64_t inner_src_stride = src_strides[inner_dim];
+  int64_t inner_dest_stride = dest_strides[inner_dim];
+  int64_t tile_src_stride = src_strides[tile_dim];
+  int64_t tile_dest_stride = dest_strides[tile_dim];
+  while (num_rows > 0) {
+    int64_t tile_rows = std::min(
+        {kTileSize, num_rows, dimensions[tile_dim] - indices[tile_dim]});
+    const SType* src = src_data + GetFlatTensorOffset(src_strides, indices);
+    DType* dest = dest_data + GetFlatTensorOffset(dest_strides, indices);
+    for (int64_t col = 0; col < row_size; col += kTileSize) {
+      int64_t tile_cols = std::min(kTileSize, row_size - col);
+      for (int64_t r = 0; r < tile_rows; ++r) {
+        StridedCopy(dest + r * tile_dest_stride + col * inner_dest_stride,
+                    inner_dest_stride,
+                    src + r * tile_src_stride + col * inner_src_stride,
+                    inner_src_stride, tile_cols);
+      }
+    }
+    num_rows -= tile_rows;
+    indices[tile_dim] += tile_rows;
+    for (size_t n = 1; n < iter_dims.size(); ++n) {
       int64_t dim = iter_dims[n];
-      indices[dim] += 1;
-      if (indices[dim] < part.limit[dim]) {
+      if (indices[dim] < dimensions[dim]) {
         break;
       }
-      indices[dim] = part.base[dim];
+      indices[dim] = 0;
+      if (n + 1 < iter_dims.size()) {
+        indices[iter_dims[n + 1]] += 1;
+      }
     }
   }
 }
@@ -488,24 +554,34 @@ void CopyTensors(const void* src_buffer, const xla::Shape& src_shape,
                            typename CopyType < NeedCast<SType>::value ||
                                NeedCast<DType>::value > ::type());
   } else if (total_elements > 0) {
-    // We issue a multi-threaded copy by slicing the bigger dimension and
-    // assigning its copy to different threads. This code is only valid for
-    // ranks >= 2, but the layout check above covers the case.
+    if (LayoutAutotuner::IsEnabled()) {
+      // One of the sides is the row major PyTorch layout.
+      LayoutAutotuner::RecordRelayout(
+          xla::LayoutUtil::IsMonotonicWithDim0Major(dest_shape.layout())
+              ? src_shape
+              : dest_shape);
+    }
+    // We issue a multi-threaded copy by splitting the rows (the copies along
+    // the iteration dimension) among the copy threads. This code is only valid
+    // for ranks >= 2, but the layout check above covers the case.
     std::vector<int64_t> src_strides = ComputeShapeStrides(src_shape);
     std::vector<int64_t> dest_strides = ComputeShapeStrides(dest_shape);
     std::vector<int64_t> iter_dims = GetIterationDimensions(dest_shape);
-    std::vector<CopyPartition> parts =
-        CreateCopyPartitions(dest_shape.dimensions(), iter_dims.front());
-    auto mwait = std::make_shared<xla::util::MultiWait>(parts.size());
-    for (size_t i = 0; i < parts.size(); ++i) {
-      auto copy_fn = [&, i]() {
-        SlicedCopy<SType, DType>(dest_shape.dimensions(), src_data, src_strides,
-                                 dest_data, dest_strides, iter_dims, parts[i]);
-      };
-      xla::env::ScheduleClosure(
-          xla::util::MultiWait::Completer(mwait, std::move(copy_fn)));
+    // Tiles are formed along the most minor source dimension, so that the
+    // source is read in contiguous runs.
+    auto src_minor_it = std::find(iter_dims.begin() + 1, iter_dims.end(),
+                                  src_shape.layout().minor_to_major(0));
+    if (src_minor_it != iter_dims.end()) {
+      std::rotate(iter_dims.begin() + 1, src_minor_it, src_minor_it + 1);
     }
-    mwait->Wait();
+    int64_t row_size = dest_shape.dimensions(iter_dims.front());
+    auto copy_fn = [&](int64_t start_row, int64_t num_rows) {
+      CopyRows<SType, DType>(dest_shape.dimensions(), src_data, src_strides,
+                             dest_data, dest_strides, iter_dims, start_row,
+                             num_rows);
+    };
+    ParallelCopyRows(total_elements / row_size, row_size * sizeof(DType),
+                     copy_fn);
   }
 }
 
@@ -591,10 +667,72 @@ void TensorToBufferSType(const at::Tensor& tensor, const xla::Shape& dest_shape,
   }
 }
 
+// Returns whether the XLA and ATen element types have the same memory
+// representation.
+bool IsSameRepresentation(xla::PrimitiveType type,
+                          at::ScalarType scalar_type) {
+  switch (scalar_type) {
+    case at::ScalarType::Bool:
+      return type == xla::PrimitiveType::PRED;
+    case at::ScalarType::Byte:
+      return type == xla::PrimitiveType::U8;
+    case at::ScalarType::Char:
+      return type == xla::PrimitiveType::S8;
+    case at::ScalarType::Short:
+      return type == xla::PrimitiveType::S16;
+    case at::ScalarType::Int:
+      return type == xla::PrimitiveType::S32;
+    case at::ScalarType::Long:
+      return type == xla::PrimitiveType::S64;
+    case at::ScalarType::Float:
+      return type == xla::PrimitiveType::F32;
+    case at::ScalarType::Double:
+      return type == xla::PrimitiveType::F64;
+    case at::ScalarType::BFloat16:
+      return type == xla::PrimitiveType::BF16;
+    case at::ScalarType::Half:
+      return type == xla::PrimitiveType::F16;
+    case at::ScalarType::ComplexFloat:
+      return type == xla::PrimitiveType::C64;
+    case at::ScalarType::ComplexDouble:
+      return type == xla::PrimitiveType::C128;
+    default:
+      return false;
+  }
+}
+
+// Returns whether a dense buffer with the given shape has the same layout and
+// element type of a contiguous tensor of the given element type.
+bool IsTensorCompatibleShape(const xla::Shape& shape,
+                             at::ScalarType scalar_type) {
+  return shape.IsArray() && !shape.is_dynamic() &&
+         !xla::ShapeUtil::IsZeroElementArray(shape) &&
+         IsSameRepresentation(shape.element_type(), scalar_type) &&
+         xla::LayoutUtil::IsMonotonicWithDim0Major(shape.layout());
+}
+
+// Returns a reference to the tensor data, if it can be uploaded to a buffer
+// of the given shape without any conversion. Otherwise returns nullptr.
+std::shared_ptr<const void> GetBorrowedTensorData(const at::Tensor& tensor,
+                                                  const xla::Shape& shape) {
+  static const bool zero_copy_upload =
+      xla::sys_util::GetEnvBool("XLA_ZERO_COPY_UPLOAD", true);
+  if (!zero_copy_upload || !tensor.device().is_cpu() ||
+      !tensor.is_contiguous() || tensor.is_conj() || tensor.is_neg() ||
+      !IsTensorCompatibleShape(shape, tensor.scalar_type())) {
+    return nullptr;
+  }
+  // The deleter holds a reference to the tensor, which keeps its storage
+  // alive for as long as the client uses the data.
+  return std::shared_ptr<const void>(tensor.data_ptr(),
+                                     [tensor](const void*) {});
+}
+
 void PopulateTensorBuffer(const at::Tensor& tensor,
                           const xla::Shape& dest_shape, void* dest_buffer,
                           size_t dest_buffer_size,
                           const torch::lazy::BackendDevice& device) {
+  XLA_TRACE_SCOPE("PopulateTensorBuffer");
   switch (tensor.type().scalarType()) {
     case at::ScalarType::Double:
       TensorToBufferSType<double>(tensor, dest_shape, dest_buffer,
@@ -653,6 +791,15 @@ torch::lazy::BackendDataPtr TensorToXlaData(
     const at::Tensor& tensor, const xla::Shape& shape,
     const torch::lazy::BackendDevice& device) {
   XLA_TIMED("TensorToData");
+  XLA_TRACE_SCOPE("TensorToXlaData");
+  XLA_STEP_PHASE(kUpload);
+  if (ShardingUtil::UseSpmd()) {
+    // The tensors are replicated over the SPMD devices until they get marked
+    // as sharded.
+    return WrapXlaData(ShardingUtil::CreateShardedData(
+        tensor, shape, xla::HloSharding::Replicate().ToProto(),
+        device.toString()));
+  }
   static const bool transfer_async =
       xla::sys_util::GetEnvBool("XLA_TRANSFER_SCALAR_ASYNC", false);
   if (transfer_async && tensor.dim() == 0 && tensor.numel() == 1) {
@@ -687,6 +834,7 @@ torch::lazy::BackendDataPtr TensorToXlaData(
     std::vector<xla::ComputationClient::TensorSource> source_tensors;
     source_tensors.emplace_back(shape, device.toString(),
                                 std::move(populate_fn));
+    source_tensors.back().data = GetBorrowedTensorData(tensor, shape);
 
     auto handles =
         xla::ComputationClient::Get()->TransferToServer(source_tensors);
@@ -696,56 +844,189 @@ torch::lazy::BackendDataPtr TensorToXlaData(
 }
 
 template <typename SType, typename DType>
-at::Tensor XlaLiteralToTensor(const xla::Literal& literal,
-                              at::ScalarType atype) {
-  std::vector<int64_t> dimensions =
-      torch::lazy::ToVector<int64_t>(literal.shape().dimensions());
+void XlaLiteralToTensor(const xla::Literal& literal, at::Tensor* tensor) {
   xla::Shape torch_shape = MakeTorchTensorLayout(
       literal.shape().dimensions(), /*dynamic_dimensions=*/{},
       literal.shape().element_type());
   int64_t total_elements = xla::ShapeUtil::ElementsIn(torch_shape);
 
   const auto literal_data = literal.data<SType>();
-  at::Tensor tensor = at::empty(dimensions, at::TensorOptions(atype));
   CopyTensors<SType, DType>(literal_data.data(), literal.shape(),
-                            tensor.data_ptr<DType>(),
+                            tensor->data_ptr<DType>(),
                             total_elements * sizeof(DType), torch_shape);
-  return tensor;
 }
 
 template <typename SType>
-at::Tensor XlaLiteralToTensorHelper(const xla::Literal& literal,
-                                    at::ScalarType dest_element_type) {
-  switch (dest_element_type) {
+void XlaLiteralToTensorHelper(const xla::Literal& literal, at::Tensor* tensor) {
+  switch (tensor->scalar_type()) {
     case at::ScalarType::Bool:
-      return XlaLiteralToTensor<SType, bool>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, bool>(literal, tensor);
     case at::ScalarType::Byte:
-      return XlaLiteralToTensor<SType, uint8_t>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, uint8_t>(literal, tensor);
     case at::ScalarType::Char:
-      return XlaLiteralToTensor<SType, int8_t>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, int8_t>(literal, tensor);
     case at::ScalarType::Short:
-      return XlaLiteralToTensor<SType, int16_t>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, int16_t>(literal, tensor);
     case at::ScalarType::Int:
-      return XlaLiteralToTensor<SType, int32_t>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, int32_t>(literal, tensor);
     case at::ScalarType::Long:
-      return XlaLiteralToTensor<SType, int64_t>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, int64_t>(literal, tensor);
     case at::ScalarType::Float:
-      return XlaLiteralToTensor<SType, float>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, float>(literal, tensor);
     case at::ScalarType::Double:
-      return XlaLiteralToTensor<SType, double>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, double>(literal, tensor);
     case at::ScalarType::BFloat16:
-      return XlaLiteralToTensor<SType, at::BFloat16>(literal,
-                                                     dest_element_type);
+      return XlaLiteralToTensor<SType, at::BFloat16>(literal, tensor);
     case at::ScalarType::Half:
-      return XlaLiteralToTensor<SType, at::Half>(literal, dest_element_type);
+      return XlaLiteralToTensor<SType, at::Half>(literal, tensor);
     case at::ScalarType::ComplexFloat:
-      return XlaLiteralToTensor<SType, c10::complex<float>>(literal,
-                                                            dest_element_type);
+      return XlaLiteralToTensor<SType, c10::complex<float>>(literal, tensor);
     case at::ScalarType::ComplexDouble:
-      return XlaLiteralToTensor<SType, c10::complex<double>>(literal,
-                                                             dest_element_type);
+      return XlaLiteralToTensor<SType, c10::complex<double>>(literal, tensor);
     default:
-      XLA_ERROR() << "Unsupported scalar type: " << dest_element_type;
+      XLA_ERROR() << "Unsupported scalar type: " << tensor->scalar_type();
+  }
+}
+
+// Returns whether the literal memory can be used as-is as the storage of a
+// tensor of the given element type.
+bool IsLiteralViewable(const xla::Literal& literal,
+                       at::ScalarType dest_element_type) {
+  return IsTensorCompatibleShape(literal.shape(), dest_element_type);
+}
+
+// Tensors up to this size get uploaded packed together within a single device
+// buffer, instead of paying the per transfer overhead for each one of them.
+size_t GetPackedUploadMaxBytes() {
+  static const size_t max_bytes =
+      xla::sys_util::GetEnvInt("XLA_PACKED_UPLOAD_MAX_BYTES", 4096);
+  return max_bytes;
+}
+
+size_t GetPackedUploadMinTensors() {
+  static const size_t min_tensors =
+      xla::sys_util::GetEnvInt("XLA_PACKED_UPLOAD_MIN_TENSORS", 16);
+  return min_tensors;
+}
+
+bool IsPackableShape(const xla::Shape& shape) {
+  if (!shape.IsArray() || shape.is_dynamic() ||
+      xla::primitive_util::IsComplexType(shape.element_type())) {
+    return false;
+  }
+  size_t size = xla::ShapeUtil::ByteSizeOf(shape);
+  return size > 0 && size <= GetPackedUploadMaxBytes();
+}
+
+// Each tensor starts at an offset aligned to the maximum element size, within
+// the packed buffer.
+size_t PackedTensorOffset(size_t offset) { return (offset + 7) / 8 * 8; }
+
+// Builds the computation which splits the packed U8 buffer into the arrays
+// with the given shapes.
+xla::XlaComputation BuildUnpackComputation(absl::Span<const xla::Shape> shapes,
+                                           int64_t packed_size) {
+  xla::XlaBuilder builder("UnpackTensors");
+  xla::XlaOp packed = xla::Parameter(
+      &builder, 0,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::U8, {packed_size}),
+      "packed");
+  std::vector<xla::XlaOp> outputs;
+  int64_t offset = 0;
+  for (auto& shape : shapes) {
+    offset = PackedTensorOffset(offset);
+    int64_t size = xla::ShapeUtil::ByteSizeOf(shape);
+    int64_t element_size =
+        xla::ShapeUtil::ByteSizeOfPrimitiveType(shape.element_type());
+    xla::XlaOp bytes = xla::Slice(packed, {offset}, {offset + size}, {1});
+    xla::XlaOp values;
+    if (shape.element_type() == xla::PrimitiveType::PRED) {
+      values = xla::ConvertElementType(bytes, xla::PrimitiveType::PRED);
+    } else if (element_size == 1) {
+      values = xla::BitcastConvertType(bytes, shape.element_type());
+    } else {
+      values = xla::BitcastConvertType(
+          xla::Reshape(bytes, {size / element_size, element_size}),
+          shape.element_type());
+    }
+    outputs.push_back(xla::Reshape(values, shape.dimensions()));
+    offset += size;
+  }
+  xla::Tuple(&builder, outputs);
+  return ConsumeValue(builder.Build());
+}
+
+// Uploads the tensors at the given indices in a single packed buffer, and
+// splits it within the device into the data of each tensor.
+void UploadPackedTensors(const std::vector<at::Tensor>& tensors,
+                         absl::Span<const xla::Shape> shapes,
+                         absl::Span<const size_t> indices,
+                         const std::string& device,
+                         std::vector<torch::lazy::BackendDataPtr>* datas) {
+  using ComputationCache =
+      xla::util::Cache<std::string, xla::ComputationClient::Computation>;
+  static ComputationCache* cache = new ComputationCache(
+      xla::sys_util::GetEnvInt("XLA_PACKED_UPLOAD_CACHE_SIZE", 64));
+  XLA_COUNTER("PackedUploads", 1);
+  XLA_COUNTER("PackedUploadTensors", indices.size());
+
+  std::vector<xla::Shape> packed_shapes;
+  std::string key = device;
+  int64_t packed_size = 0;
+  for (auto index : indices) {
+    packed_shapes.push_back(shapes[index]);
+    absl::StrAppend(&key, ";", shapes[index].ToString(/*print_layout=*/true));
+    packed_size = PackedTensorOffset(packed_size) +
+                  xla::ShapeUtil::ByteSizeOf(shapes[index]);
+  }
+  torch::lazy::BackendDevice xla_device = ParseDeviceString(device);
+  auto populate_fn =
+      [&](const xla::ComputationClient::TensorSource& source_tensor,
+          void* dest_buffer, size_t dest_buffer_size) {
+        char* buffer = reinterpret_cast<char*>(dest_buffer);
+        std::memset(buffer, 0, dest_buffer_size);
+        size_t offset = 0;
+        for (auto index : indices) {
+          const xla::Shape& shape = shapes[index];
+          // The unpack computation reshapes the bytes in row major order.
+          xla::Shape row_major_shape = MakeTorchTensorLayout(
+              shape.dimensions(), /*dynamic_dimensions=*/{},
+              shape.element_type());
+          size_t size = xla::ShapeUtil::ByteSizeOf(shape);
+          offset = PackedTensorOffset(offset);
+          PopulateTensorBuffer(tensors[index], row_major_shape, buffer + offset,
+                               size, xla_device);
+          offset += size;
+        }
+      };
+  std::vector<xla::ComputationClient::TensorSource> source_tensors;
+  source_tensors.emplace_back(
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::U8, {packed_size}), device,
+      std::move(populate_fn));
+  std::vector<xla::ComputationClient::DataPtr> packed_data =
+      xla::ComputationClient::Get()->TransferToServer(source_tensors);
+
+  ComputationCache::TypePtr computation = cache->Get(key);
+  if (computation == nullptr) {
+    XLA_COUNTER("PackedUploadCompiles", 1);
+    xla::Shape output_shape = xla::ShapeUtil::MakeTupleShape(packed_shapes);
+    std::vector<xla::ComputationClient::CompileInstance> instances;
+    instances.push_back(
+        {BuildUnpackComputation(packed_shapes, packed_size), device,
+         xla::ComputationClient::Get()->GetCompilationDevices(device, {}),
+         &output_shape});
+    computation = cache->Add(
+        key, std::move(xla::ComputationClient::Get()
+                           ->Compile(std::move(instances))
+                           .front()));
+  }
+  xla::ComputationClient::ExecuteComputationOptions options;
+  std::vector<xla::ComputationClient::DataPtr> results =
+      xla::ComputationClient::Get()->ExecuteComputation(
+          *computation, packed_data, device, options);
+  XLA_CHECK_EQ(results.size(), indices.size());
+  for (size_t i = 0; i < indices.size(); ++i) {
+    (*datas)[indices[i]] = WrapXlaData(std::move(results[i]));
   }
 }
 
@@ -795,42 +1076,82 @@ std::vector<int64_t> ComputeShapeStrides(const xla::Shape& shape) {
   return strides;
 }
 
+at::Tensor MakeTensorFromXlaLiteral(xla::Literal&& literal,
+                                    at::ScalarType dest_element_type) {
+  if (!IsLiteralViewable(literal, dest_element_type)) {
+    return MakeTensorFromXlaLiteral(static_cast<const xla::Literal&>(literal),
+                                    dest_element_type);
+  }
+  // The literal memory already has the element type and layout of the
+  // destination tensor, so the tensor can take over the literal, instead of
+  // copying its data.
+  XLA_COUNTER("LiteralToTensorZeroCopy", 1);
+  std::vector<int64_t> dimensions =
+      torch::lazy::ToVector<int64_t>(literal.shape().dimensions());
+  auto owned_literal = std::make_shared<xla::Literal>(std::move(literal));
+  void* data = owned_literal->untyped_data();
+  auto deleter = [owned_literal](void*) mutable { owned_literal.reset(); };
+  return at::from_blob(data, dimensions, std::move(deleter),
+                       at::TensorOptions(dest_element_type));
+}
+
 at::Tensor MakeTensorFromXlaLiteral(const xla::Literal& literal,
                                     at::ScalarType dest_element_type) {
+  at::Tensor tensor = at::empty(
+      torch::lazy::ToVector<int64_t>(literal.shape().dimensions()),
+      at::TensorOptions(dest_element_type));
+  CopyXlaLiteralToTensor(literal, &tensor);
+  return tensor;
+}
+
+void CopyXlaLiteralToTensor(const xla::Literal& literal, at::Tensor* tensor) {
+  XLA_CHECK(tensor->device().is_cpu())
+      << "Destination tensor must be on CPU: " << tensor->device();
+  XLA_CHECK(absl::Span<const int64_t>(tensor->sizes().data(),
+                                      tensor->sizes().size()) ==
+            literal.shape().dimensions())
+      << "Destination tensor sizes " << tensor->sizes()
+      << " do not match the ones of " << literal.shape();
+  if (!tensor->is_contiguous()) {
+    // The copy kernels only deal with dense layouts, so strided destinations
+    // go through a contiguous temporary.
+    at::Tensor contiguous_tensor =
+        at::empty(tensor->sizes(), tensor->options());
+    CopyXlaLiteralToTensor(literal, &contiguous_tensor);
+    tensor->copy_(contiguous_tensor);
+    return;
+  }
   switch (literal.shape().element_type()) {
     case xla::PrimitiveType::PRED:
-      return XlaLiteralToTensorHelper<bool>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<bool>(literal, tensor);
     case xla::PrimitiveType::BF16:
-      return XlaLiteralToTensorHelper<tensorflow::bfloat16>(literal,
-                                                            dest_element_type);
+      return XlaLiteralToTensorHelper<tensorflow::bfloat16>(literal, tensor);
     case xla::PrimitiveType::F16:
-      return XlaLiteralToTensorHelper<xla::half>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<xla::half>(literal, tensor);
     case xla::PrimitiveType::F32:
-      return XlaLiteralToTensorHelper<float>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<float>(literal, tensor);
     case xla::PrimitiveType::F64:
-      return XlaLiteralToTensorHelper<double>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<double>(literal, tensor);
     case xla::PrimitiveType::U8:
-      return XlaLiteralToTensorHelper<uint8_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<uint8_t>(literal, tensor);
     case xla::PrimitiveType::S8:
-      return XlaLiteralToTensorHelper<int8_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<int8_t>(literal, tensor);
     case xla::PrimitiveType::S16:
-      return XlaLiteralToTensorHelper<int16_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<int16_t>(literal, tensor);
     case xla::PrimitiveType::U16:
-      return XlaLiteralToTensorHelper<uint16_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<uint16_t>(literal, tensor);
     case xla::PrimitiveType::S32:
-      return XlaLiteralToTensorHelper<int32_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<int32_t>(literal, tensor);
     case xla::PrimitiveType::U32:
-      return XlaLiteralToTensorHelper<uint32_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<uint32_t>(literal, tensor);
     case xla::PrimitiveType::S64:
-      return XlaLiteralToTensorHelper<int64_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<int64_t>(literal, tensor);
     case xla::PrimitiveType::U64:
-      return XlaLiteralToTensorHelper<uint64_t>(literal, dest_element_type);
+      return XlaLiteralToTensorHelper<uint64_t>(literal, tensor);
     case xla::PrimitiveType::C64:
-      return XlaLiteralToTensorHelper<xla::complex64>(literal,
-                                                      dest_element_type);
+      return XlaLiteralToTensorHelper<xla::complex64>(literal, tensor);
     case xla::PrimitiveType::C128:
-      return XlaLiteralToTensorHelper<xla::complex128>(literal,
-                                                       dest_element_type);
+      return XlaLiteralToTensorHelper<xla::complex128>(literal, tensor);
     default:
       XLA_ERROR() << "Unsupported literal type: " << literal.shape();
   }
@@ -859,6 +1180,8 @@ std::vector<torch::lazy::BackendDataPtr> CreateTensorsData(
     const std::vector<at::Tensor>& tensors,
     const std::vector<std::string>& devices, bool transfer_async) {
   XLA_TIMED("TensorToData");
+  XLA_TRACE_SCOPE("CreateTensorsData");
+  XLA_STEP_PHASE(kUpload);
   XLA_CHECK_EQ(tensors.size(), devices.size());
   if (transfer_async) {
     std::shared_ptr<DataAsync> async = std::make_shared<DataAsync>();
@@ -885,10 +1208,29 @@ std::vector<torch::lazy::BackendDataPtr> CreateTensorsData(
     populate_mwait->Wait();
     return async->async_datas;
   } else {
+    std::vector<xla::Shape> shapes;
+    std::map<std::string, std::vector<size_t>> packable_indices;
+    for (size_t i = 0; i < tensors.size(); ++i) {
+      torch::lazy::BackendDevice device = ParseDeviceString(devices[i]);
+      shapes.push_back(CreateComputationShapeFromTensor(tensors[i], &device));
+      if (IsPackableShape(shapes.back())) {
+        packable_indices[devices[i]].push_back(i);
+      }
+    }
+    std::vector<torch::lazy::BackendDataPtr> datas(tensors.size());
+    for (auto& device_indices : packable_indices) {
+      if (device_indices.second.size() >= GetPackedUploadMinTensors()) {
+        UploadPackedTensors(tensors, shapes, device_indices.second,
+                            device_indices.first, &datas);
+      }
+    }
+    std::vector<size_t> source_indices;
     std::vector<xla::ComputationClient::TensorSource> source_tensors;
     for (size_t i = 0; i < tensors.size(); ++i) {
+      if (datas[i] != nullptr) {
+        continue;
+      }
       torch::lazy::BackendDevice device = ParseDeviceString(devices[i]);
-      xla::Shape shape = CreateComputationShapeFromTensor(tensors[i], &device);
       auto populate_fn =
           [&, i, device](
               const xla::ComputationClient::TensorSource& source_tensor,
@@ -896,14 +1238,78 @@ std::vector<torch::lazy::BackendDataPtr> CreateTensorsData(
             PopulateTensorBuffer(tensors[i], source_tensor.shape, dest_buffer,
                                  dest_buffer_size, device);
           };
-      source_tensors.emplace_back(std::move(shape), devices[i],
+      source_tensors.emplace_back(std::move(shapes[i]), devices[i],
                                   std::move(populate_fn));
+      source_tensors.back().data =
+          GetBorrowedTensorData(tensors[i], source_tensors.back().shape);
+      source_indices.push_back(i);
+    }
+    if (!source_tensors.empty()) {
+      std::vector<xla::ComputationClient::DataPtr> handles =
+          xla::ComputationClient::Get()->TransferToServer(source_tensors);
+      for (size_t i = 0; i < source_indices.size(); ++i) {
+        datas[source_indices[i]] = WrapXlaData(std::move(handles[i]));
+      }
     }
-    return WrapXlaData(
-        xla::ComputationClient::Get()->TransferToServer(source_tensors));
+    return datas;
   }
 }
 
+std::vector<torch::lazy::BackendDataPtr> CreateTensorsData(
+    const std::vector<at::Tensor>& tensors,
+    const std::vector<const xla::OpSharding*>& shardings,
+    const std::vector<std::string>& devices) {
+  XLA_CHECK_EQ(tensors.size(), shardings.size());
+  XLA_CHECK_EQ(tensors.size(), devices.size());
+  std::vector<at::Tensor> unsharded_tensors;
+  std::vector<std::string> unsharded_devices;
+  std::vector<size_t> unsharded_indices;
+  std::vector<at::Tensor> shards;
+  std::vector<std::string> shard_devices;
+  std::vector<size_t> sharded_indices;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    if (shardings[i] == nullptr) {
+      unsharded_tensors.push_back(tensors[i]);
+      unsharded_devices.push_back(devices[i]);
+      unsharded_indices.push_back(i);
+      continue;
+    }
+    const std::vector<std::string>& spmd_devices =
+        ShardingUtil::GetSpmdDevices();
+    std::vector<at::Tensor> tensor_shards = ShardingUtil::ShardTensor(
+        tensors[i], *shardings[i], spmd_devices.size());
+    shards.insert(shards.end(), tensor_shards.begin(), tensor_shards.end());
+    shard_devices.insert(shard_devices.end(), spmd_devices.begin(),
+                         spmd_devices.end());
+    sharded_indices.push_back(i);
+  }
+  std::vector<torch::lazy::BackendDataPtr> datas(tensors.size());
+  if (!unsharded_tensors.empty()) {
+    std::vector<torch::lazy::BackendDataPtr> handles =
+        CreateTensorsData(unsharded_tensors, unsharded_devices);
+    for (size_t i = 0; i < handles.size(); ++i) {
+      datas[unsharded_indices[i]] = std::move(handles[i]);
+    }
+  }
+  if (!shards.empty()) {
+    XLA_COUNTER("ShardedTensorsToData", sharded_indices.size());
+    std::vector<xla::ComputationClient::DataPtr> handles =
+        UnwrapXlaData(CreateTensorsData(shards, shard_devices));
+    size_t num_shards = handles.size() / sharded_indices.size();
+    for (size_t k = 0; k < sharded_indices.size(); ++k) {
+      size_t i = sharded_indices[k];
+      torch::lazy::BackendDevice device = ParseDeviceString(devices[i]);
+      std::vector<xla::ComputationClient::DataPtr> tensor_handles(
+          handles.begin() + k * num_shards,
+          handles.begin() + (k + 1) * num_shards);
+      datas[i] = WrapXlaData(std::make_shared<ShardedData>(
+          devices[i], CreateComputationShapeFromTensor(tensors[i], &device),
+          std::move(tensor_handles), *shardings[i]));
+    }
+  }
+  return datas;
+}
+
 xla::Literal GetTensorLiteral(const at::Tensor& tensor, const xla::Shape* shape,
                               const torch::lazy::BackendDevice* device) {
   torch::lazy::BackendDevice xla_device = GetDeviceOrCurrent(device);
@@ -921,16 +1327,69 @@ xla::Literal GetTensorLiteral(const at::Tensor& tensor, const xla::Shape* shape,
   return literal;
 }
 
+void ParallelConvertLiterals(absl::Span<const xla::Literal> literals,
+                             const std::function<void(size_t)>& convert_fn) {
+  // The literals above this size have their rows copied in parallel already.
+  static const int64_t kMaxParallelLiteralBytes = 64 * 1024;
+  std::vector<size_t> small_indices;
+  for (size_t i = 0; i < literals.size(); ++i) {
+    if (literals[i].size_bytes() <= kMaxParallelLiteralBytes) {
+      small_indices.push_back(i);
+    } else {
+      convert_fn(i);
+    }
+  }
+  int64_t num_workers = std::min<int64_t>(
+      small_indices.size(),
+      static_cast<int64_t>(xla::env::GetCopyThreadPoolSize()));
+  if (num_workers <= 1) {
+    for (auto i : small_indices) {
+      convert_fn(i);
+    }
+    return;
+  }
+  std::atomic<size_t> next_index(0);
+  auto worker = [&]() {
+    for (size_t k = next_index++; k < small_indices.size(); k = next_index++) {
+      convert_fn(small_indices[k]);
+    }
+  };
+  // The calling thread is one of the workers.
+  auto mwait = std::make_shared<xla::util::MultiWait>(num_workers - 1);
+  for (int64_t i = 1; i < num_workers; ++i) {
+    xla::env::ScheduleCopyClosure(
+        xla::util::MultiWait::Completer(mwait, worker));
+  }
+  worker();
+  mwait->Wait();
+}
+
 std::vector<at::Tensor> XlaDataToTensors(
     absl::Span<const torch::lazy::BackendDataPtr> xla_data,
     at::ScalarType dest_element_type) {
-  std::vector<xla::Literal> literals =
-      xla::ComputationClient::Get()->TransferFromServer(
-          UnwrapXlaData(xla_data));
-  std::vector<at::Tensor> tensors;
-  tensors.reserve(literals.size());
-  for (auto& literal : literals) {
-    tensors.push_back(MakeTensorFromXlaLiteral(literal, dest_element_type));
+  XLA_TRACE_SCOPE("XlaDataToTensors");
+  XLA_STEP_PHASE(kDownload);
+  std::vector<xla::ComputationClient::DataPtr> datas;
+  std::vector<size_t> data_indices;
+  std::vector<at::Tensor> tensors(xla_data.size());
+  for (size_t i = 0; i < xla_data.size(); ++i) {
+    xla::ComputationClient::DataPtr data = UnwrapXlaData(xla_data[i]);
+    const ShardedData* sharded = dynamic_cast<const ShardedData*>(data.get());
+    if (sharded != nullptr) {
+      tensors[i] =
+          ShardingUtil::ShardedDataToTensor(*sharded, dest_element_type);
+    } else {
+      datas.push_back(std::move(data));
+      data_indices.push_back(i);
+    }
+  }
+  if (!datas.empty()) {
+    std::vector<xla::Literal> literals =
+        xla::ComputationClient::Get()->TransferFromServer(datas);
+    ParallelConvertLiterals(literals, [&](size_t i) {
+      tensors[data_indices[i]] =
+          MakeTensorFromXlaLiteral(std::move(literals[i]), dest_element_type);
+    });
   }
   return tensors;
 }
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -33,6 +34,23 @@ std::vector<int64_t> ComputeShapeStrides(const xla::Shape& shape);
 at::Tensor MakeTensorFromXlaLiteral(const xla::Literal& literal,
                                     at::ScalarType dest_element_type);
 
+// Same as above, but when the literal element type and layout already match
+// the ones of the tensor, the returned tensor takes over the literal memory
+// instead of copying it.
+at::Tensor MakeTensorFromXlaLiteral(xla::Literal&& literal,
+                                    at::ScalarType dest_element_type);
+
+// Converts an XLA literal into the caller supplied CPU tensor, which must have
+// the same sizes as the literal, converting to the tensor element type.
+void CopyXlaLiteralToTensor(const xla::Literal& literal, at::Tensor* tensor);
+
+// Runs convert_fn(i) for each of the literals, which converts the i-th literal
+// into a tensor. The small literals get converted in parallel on the copy
+// pool, while the large ones, whose copies already get split across the copy
+// pool, are converted by the calling thread.
+void ParallelConvertLiterals(absl::Span<const xla::Literal> literals,
+                             const std::function<void(size_t)>& convert_fn);
+
 // TODO LTC @wonjoo - Migrate to upstream after Device -> BackendDevice
 std::vector<at::Tensor> XlaDataToTensors(
     absl::Span<const torch::lazy::BackendDataPtr> xla_data,
@@ -55,6 +73,14 @@ std::vector<torch::lazy::BackendDataPtr> CreateTensorsData(
     const std::vector<at::Tensor>& tensors,
     const std::vector<std::string>& devices, bool transfer_async = false);
 
+// Same as above, but the tensors with a sharding get sliced per the tile
+// assignment and uploaded as one shard per SPMD device, with all the shards
+// of all the tensors populated and transferred concurrently.
+std::vector<torch::lazy::BackendDataPtr> CreateTensorsData(
+    const std::vector<at::Tensor>& tensors,
+    const std::vector<const xla::OpSharding*>& shardings,
+    const std::vector<std::string>& devices);
+
 // Creates an XLA literal out of an ATEN tensor. If shape is specified, that
 // shape+layout will be used, otherwise one will be generated out of the ATEN
 // tensor shape. The device argument (can be nullptr for the default device)
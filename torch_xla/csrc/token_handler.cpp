@@ -2,6 +2,7 @@
 
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/helpers.h"
 
@@ -30,8 +31,17 @@ xla::XlaOp SliceOneToken(xla::XlaOp input) {
 
 }  // namespace
 
+bool TokenHandler::ChainCollectives() {
+  static bool chain_collectives =
+      xla::sys_util::GetEnvBool("XLA_CHAIN_COLLECTIVES", true);
+  return chain_collectives;
+}
+
 xla::XlaOp TokenHandler::GetInput(xla::XlaOp input,
                                   const xla::Shape* input_shape) {
+  if (!ChainCollectives()) {
+    return input;
+  }
   if (input_shape == nullptr) {
     input_shape = &XlaHelpers::ShapeOfXlaOp(input);
   }
@@ -40,6 +50,9 @@ xla::XlaOp TokenHandler::GetInput(xla::XlaOp input,
 }
 
 xla::XlaOp TokenHandler::GetNewToken(xla::XlaOp result) {
+  if (!ChainCollectives()) {
+    return token_;
+  }
   xla::XlaOp slice = SliceOneToken(result);
   // Token is always a numeric zero, and multiplying it for one element of the
   // result will still leave it as zero.
@@ -4,10 +4,18 @@
 
 namespace torch_xla {
 
+// Chains the collectives through pseudo-tokens, numeric zeros added to their
+// inputs and computed from their results, since the XLA collectives do not take
+// real tokens.
 class TokenHandler {
  public:
   explicit TokenHandler(xla::XlaOp token) : token_(token) {}
 
+  // Whether the collectives get chained (see XLA_CHAIN_COLLECTIVES). If not,
+  // the token passes through unchanged, and XLA is free to schedule the
+  // independent collectives concurrently, and overlap them with the compute.
+  static bool ChainCollectives();
+
   xla::XlaOp GetInput(xla::XlaOp input, const xla::Shape* input_shape);
 
   xla::XlaOp GetNewToken(xla::XlaOp result);
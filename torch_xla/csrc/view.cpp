@@ -4,14 +4,19 @@
 #include <functional>
 #include <numeric>
 
+#include "absl/types/span.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "torch/csrc/lazy/core/util.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/host_object_pool.h"
 #include "torch_xla/csrc/ops/as_strided.h"
 #include "torch_xla/csrc/ops/as_strided_view_update.h"
+#include "torch_xla/csrc/ops/cat.h"
 #include "torch_xla/csrc/ops/diagonal.h"
 #include "torch_xla/csrc/ops/diagonal_view_update.h"
 #include "torch_xla/csrc/ops/generic_slice.h"
@@ -22,6 +27,7 @@
 #include "torch_xla/csrc/ops/unselect.h"
 #include "torch_xla/csrc/ops/update_slice.h"
 #include "torch_xla/csrc/ops/view.h"
+#include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
 namespace {
@@ -122,6 +128,133 @@ torch::lazy::Value ApplyUpdate(torch::lazy::Value ir_value,
   return result;
 }
 
+bool CoalesceViewUpdates() {
+  static const bool coalesce =
+      xla::sys_util::GetEnvBool("XLA_COALESCE_VIEW_UPDATES", true);
+  return coalesce;
+}
+
+// The region of the view source written by a narrow, or unit stride select,
+// view.
+struct SliceBox {
+  std::vector<int64_t> indices;
+  std::vector<int64_t> sizes;
+};
+
+absl::optional<SliceBox> GetSliceBox(const ViewInfo& view_info) {
+  if (view_info.view_type == ViewInfo::Type::kNarrow) {
+    return SliceBox{view_info.indices, torch::lazy::ToVector<int64_t>(
+                                           view_info.shape.dimensions())};
+  }
+  if (view_info.view_type == ViewInfo::Type::kSelect &&
+      view_info.select->stride == 1) {
+    SliceBox box{std::vector<int64_t>(view_info.source_shape.rank(), 0),
+                 torch::lazy::ToVector<int64_t>(
+                     view_info.source_shape.dimensions())};
+    box.indices[view_info.select->dim] = view_info.select->start;
+    box.sizes[view_info.select->dim] =
+        view_info.select->end - view_info.select->start;
+    return box;
+  }
+  return absl::nullopt;
+}
+
+// Returns the dimension along which the two slices, matching on all the other
+// dimensions, are adjacent or overlap, the rank if they are the same slice, or
+// -1 if their union is not a slice.
+int64_t GetSliceMergeDim(const SliceBox& prev, const SliceBox& next) {
+  int64_t rank = prev.indices.size();
+  int64_t merge_dim = rank;
+  for (int64_t dim = 0; dim < rank; ++dim) {
+    int64_t prev_end = prev.indices[dim] + prev.sizes[dim];
+    int64_t next_end = next.indices[dim] + next.sizes[dim];
+    if (prev.indices[dim] == next.indices[dim] && prev_end == next_end) {
+      continue;
+    }
+    if (merge_dim != rank || next.indices[dim] > prev_end ||
+        prev.indices[dim] > next_end) {
+      return -1;
+    }
+    merge_dim = dim;
+  }
+  return merge_dim;
+}
+
+// Merges a slice update into the previous one, if both write slices through
+// the same view path, whose union is a slice. The values get concatenated,
+// with the new one overwriting the overlapping part of the previous one, so
+// that the small writes on a large tensor (like the steps of a KV cache) lower
+// to a single slice update, instead of a chain of full size ones.
+bool MergeSliceUpdate(Alias::UpdateData* update,
+                      const torch::lazy::Value& ir_value,
+                      const std::vector<ViewInfo>& view_infos) {
+  if (!CoalesceViewUpdates() || view_infos.empty() ||
+      view_infos.size() != update->view_infos.size() ||
+      !std::equal(view_infos.begin(), view_infos.end() - 1,
+                  update->view_infos.begin())) {
+    return false;
+  }
+  const ViewInfo& prev_info = update->view_infos.back();
+  const ViewInfo& next_info = view_infos.back();
+  absl::optional<SliceBox> prev = GetSliceBox(prev_info);
+  absl::optional<SliceBox> next = GetSliceBox(next_info);
+  if (!prev || !next ||
+      !xla::ShapeUtil::Equal(prev_info.source_shape, next_info.source_shape)) {
+    return false;
+  }
+  const xla::Shape& prev_shape = GetXlaShape(update->ir_value);
+  const xla::Shape& next_shape = GetXlaShape(ir_value);
+  if (prev_shape.element_type() != next_shape.element_type() ||
+      prev_shape.dimensions() != absl::MakeConstSpan(prev->sizes) ||
+      next_shape.dimensions() != absl::MakeConstSpan(next->sizes)) {
+    return false;
+  }
+  int64_t dim = GetSliceMergeDim(*prev, *next);
+  if (dim < 0) {
+    return false;
+  }
+  if (dim == prev_info.source_shape.rank()) {
+    update->ir_value = ir_value;
+    return true;
+  }
+  int64_t prev_start = prev->indices[dim];
+  int64_t next_start = next->indices[dim];
+  int64_t prev_end = prev_start + prev->sizes[dim];
+  int64_t next_end = next_start + next->sizes[dim];
+  auto prev_slice = [&](int64_t start, int64_t end) {
+    std::vector<int64_t> base_indices(prev->sizes.size(), 0);
+    std::vector<int64_t> sizes = prev->sizes;
+    base_indices[dim] = start - prev_start;
+    sizes[dim] = end - start;
+    return torch::lazy::MakeNode<GenericSlice>(update->ir_value, base_indices,
+                                               sizes);
+  };
+  std::vector<torch::lazy::Value> pieces;
+  if (prev_start < next_start) {
+    pieces.push_back(prev_slice(prev_start, next_start));
+  }
+  pieces.push_back(ir_value);
+  if (prev_end > next_end) {
+    pieces.push_back(prev_slice(next_end, prev_end));
+  }
+  std::vector<int64_t> sizes = prev->sizes;
+  sizes[dim] = std::max(prev_end, next_end) - std::min(prev_start, next_start);
+  ViewInfo merged(ViewInfo::Type::kNarrow,
+                  xla::ShapeUtil::MakeShape(
+                      prev_info.source_shape.element_type(), sizes),
+                  prev_info.source_shape);
+  merged.indices = prev->indices;
+  merged.indices[dim] = std::min(prev_start, next_start);
+  update->ir_value =
+      pieces.size() == 1
+          ? pieces.front()
+          : torch::lazy::MakeNode<Cat>(
+                pieces, dim, TensorTypeFromXlaType(prev_shape.element_type()));
+  update->view_infos.back() = std::move(merged);
+  XLA_COUNTER("ViewUpdatesCoalesced", 1);
+  return true;
+}
+
 }  // namespace
 
 ViewInfo::ViewInfo(Type view_type, xla::Shape shape, xla::Shape source_shape)
@@ -172,7 +305,8 @@ void Alias::Update(torch::lazy::Value ir_value,
                    std::vector<ViewInfo> view_infos) {
   if (!updates_.empty() && updates_.back().view_infos == view_infos) {
     updates_.back().ir_value = std::move(ir_value);
-  } else {
+  } else if (updates_.empty() ||
+             !MergeSliceUpdate(&updates_.back(), ir_value, view_infos)) {
     updates_.push_back({std::move(ir_value), std::move(view_infos)});
   }
   ++generation_;
@@ -219,8 +353,8 @@ std::shared_ptr<View> View::CreateSubView(xla::Shape shape,
                                           ViewInfo view_info) {
   std::vector<ViewInfo> view_infos(view_infos_);
   view_infos.push_back(std::move(view_info));
-  return std::make_shared<View>(std::move(shape), alias_,
-                                std::move(view_infos));
+  return host_pool::MakeShared<View>(std::move(shape), alias_,
+                                     std::move(view_infos));
 }
 
 View::IrNode View::GetViewIrNode() {
@@ -0,0 +1,232 @@
+#include "torch_xla/csrc/warm_start.h"
+
+#include <cstring>
+#include <exception>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/core/platform/env.h"
+#include "torch_xla/csrc/xla_sharding_util.h"
+
+namespace torch_xla {
+namespace {
+
+const char* const kLayoutsPrefix = "layouts ";
+
+// The layout manager entries, from the XLA_LAYOUTS_FILE file and XLA_LAYOUTS.
+std::string GetLayouts() {
+  std::string layouts = xla::sys_util::GetEnvString("XLA_LAYOUTS", "");
+  std::string layouts_file =
+      xla::sys_util::GetEnvString("XLA_LAYOUTS_FILE", "");
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::string data;
+  if (!layouts_file.empty() && env->FileExists(layouts_file).ok() &&
+      tensorflow::ReadFileToString(env, layouts_file, &data).ok()) {
+    std::vector<std::string> lines =
+        absl::StrSplit(data, '\n', absl::SkipEmpty());
+    layouts = absl::StrCat(absl::StrJoin(lines, ";"), "|", layouts);
+  }
+  return layouts;
+}
+
+// The manifest is a "layouts <XLA_LAYOUTS>" line, followed by one graph hash
+// string per line. Returns false if no manifest is present at path.
+bool ReadManifest(const std::string& path, std::string* layouts,
+                  std::vector<std::string>* graphs) {
+  tensorflow::Env* env = tensorflow::Env::Default();
+  std::string data;
+  if (!env->FileExists(path).ok() ||
+      !tensorflow::ReadFileToString(env, path, &data).ok()) {
+    return false;
+  }
+  std::vector<std::string> lines = absl::StrSplit(data, '\n');
+  if (lines.empty() || !absl::StartsWith(lines[0], kLayoutsPrefix)) {
+    TF_LOG(WARNING) << "Ignoring malformed warm start manifest " << path;
+    return false;
+  }
+  *layouts = lines[0].substr(std::strlen(kLayoutsPrefix));
+  for (size_t i = 1; i < lines.size(); ++i) {
+    if (!lines[i].empty()) {
+      graphs->push_back(std::move(lines[i]));
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+WarmStart* WarmStart::Get() {
+  static WarmStart* warm_start = []() -> WarmStart* {
+    PersistentCache* persistent_cache = PersistentCache::Get();
+    // The partitioning information does not survive the persistent cache.
+    if (!xla::sys_util::GetEnvBool("XLA_WARM_START", false) ||
+        persistent_cache == nullptr || ShardingUtil::UseSpmd()) {
+      return nullptr;
+    }
+    std::string manifest_path = xla::sys_util::GetEnvString(
+        "XLA_WARM_START_MANIFEST",
+        absl::StrCat(persistent_cache->path(), "/warm_start.manifest"));
+    WarmStart* warm_start = new WarmStart(
+        std::move(manifest_path),
+        xla::sys_util::GetEnvInt("XLA_WARM_START_MAX_GRAPHS", 1024));
+    warm_start->Preload(persistent_cache);
+    return warm_start;
+  }();
+  return warm_start;
+}
+
+WarmStart::WarmStart(std::string manifest_path, size_t max_graphs)
+    : manifest_path_(std::move(manifest_path)),
+      max_graphs_(max_graphs),
+      layouts_(GetLayouts()) {
+  LoadManifest();
+}
+
+void WarmStart::LoadManifest() {
+  std::string layouts;
+  std::vector<std::string> graphs;
+  if (!ReadManifest(manifest_path_, &layouts, &graphs)) {
+    return;
+  }
+  if (layouts != layouts_) {
+    // The executables were compiled for different device layouts, so the
+    // manifest is rewritten from scratch.
+    TF_LOG(WARNING) << "Warm start manifest " << manifest_path_
+                    << " was recorded with XLA_LAYOUTS=\"" << layouts
+                    << "\", ignoring it";
+    layouts_match_ = false;
+    return;
+  }
+  for (auto& graph : graphs) {
+    if (graphs_.size() < max_graphs_ && graph_set_.insert(graph).second) {
+      graphs_.push_back(std::move(graph));
+    }
+  }
+  TF_VLOG(1) << "Loaded warm start manifest " << manifest_path_ << " with "
+             << graphs_.size() << " graphs";
+}
+
+void WarmStart::Preload(PersistentCache* persistent_cache) {
+  std::lock_guard<std::mutex> lock(lock_);
+  if (!layouts_match_) {
+    return;
+  }
+  for (const auto& graph : graphs_) {
+    auto pending = std::make_shared<Pending>();
+    if (!pending_.emplace(graph, pending).second) {
+      continue;
+    }
+    auto loadfn = [this, persistent_cache, graph,
+                   pending = std::move(pending)]() {
+      ComputationPtr computation;
+      try {
+        computation = persistent_cache->LoadIfPresent(graph);
+      } catch (const std::exception& ex) {
+        TF_LOG(WARNING) << "Warm start load of IR graph hash " << graph
+                        << " failed: " << ex.what();
+      }
+      if (computation != nullptr) {
+        XLA_COUNTER("WarmStartPreloaded", 1);
+      }
+      std::lock_guard<std::mutex> lock(lock_);
+      pending->computation = std::move(computation);
+      pending->done = true;
+      cv_.notify_all();
+    };
+    // The graphs are scheduled in the order they ran, so that the first ones
+    // are loaded first.
+    xla::env::ScheduleIoClosure(std::move(loadfn));
+  }
+}
+
+void WarmStart::RecordGraph(const torch::lazy::hash_t& hash) {
+  std::string graph = torch::lazy::HashToString(hash);
+  std::lock_guard<std::mutex> lock(lock_);
+  if (graphs_.size() >= max_graphs_ || !graph_set_.insert(graph).second) {
+    return;
+  }
+  graphs_.push_back(std::move(graph));
+  XLA_COUNTER("WarmStartRecorded", 1);
+  if (!write_scheduled_) {
+    write_scheduled_ = true;
+    ScheduleWrite();
+  }
+}
+
+WarmStart::ComputationPtr WarmStart::Take(const torch::lazy::hash_t& hash) {
+  std::unique_lock<std::mutex> lock(lock_);
+  if (pending_.empty()) {
+    return nullptr;
+  }
+  auto it = pending_.find(torch::lazy::HashToString(hash));
+  if (it == pending_.end()) {
+    return nullptr;
+  }
+  std::shared_ptr<Pending> pending = it->second;
+  if (!pending->done) {
+    XLA_TIMED("WarmStartWait");
+    cv_.wait(lock, [&] { return pending->done; });
+  }
+  pending_.erase(it);
+  if (pending->computation != nullptr) {
+    XLA_COUNTER("WarmStartHit", 1);
+  }
+  return pending->computation;
+}
+
+std::vector<std::string> WarmStart::GetGraphs() {
+  std::lock_guard<std::mutex> lock(lock_);
+  return graphs_;
+}
+
+void WarmStart::ScheduleWrite() {
+  // Called with lock_ held.
+  xla::env::ScheduleIoClosure([this]() {
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      write_scheduled_ = false;
+    }
+    Flush();
+  });
+}
+
+void WarmStart::Flush() {
+  std::vector<std::string> graphs = GetGraphs();
+  // Other processes of the same program (like the ones of a multi-process
+  // run) may have recorded graphs this one did not run.
+  std::string layouts;
+  std::vector<std::string> stored_graphs;
+  if (ReadManifest(manifest_path_, &layouts, &stored_graphs) &&
+      layouts == layouts_) {
+    std::unordered_set<std::string> graph_set(graphs.begin(), graphs.end());
+    for (auto& graph : stored_graphs) {
+      if (graphs.size() < max_graphs_ && graph_set.insert(graph).second) {
+        graphs.push_back(std::move(graph));
+      }
+    }
+  }
+  tensorflow::Env* env = tensorflow::Env::Default();
+  // Written to a temporary file first, so that concurrent readers never see a
+  // partial manifest.
+  std::string tmp_path = absl::StrCat(manifest_path_, ".tmp", env->NowMicros());
+  xla::Status status = tensorflow::WriteStringToFile(
+      env, tmp_path,
+      absl::StrCat(kLayoutsPrefix, layouts_, "\n",
+                   absl::StrJoin(graphs, "\n"), "\n"));
+  if (status.ok()) {
+    status = env->RenameFile(tmp_path, manifest_path_);
+  }
+  if (!status.ok()) {
+    TF_LOG(WARNING) << "Unable to write the warm start manifest "
+                    << manifest_path_ << ": " << status;
+    env->DeleteFile(tmp_path).IgnoreError();
+  }
+}
+
+}  // namespace torch_xla
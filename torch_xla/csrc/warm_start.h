@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch/csrc/lazy/core/hash.h"
+#include "torch_xla/csrc/persistent_cache.h"
+
+namespace torch_xla {
+
+// The WarmStart class keeps a manifest of the graph hashes a program ran,
+// in the order they were first seen, together with the XLA_LAYOUTS they were
+// compiled with. A later process of the same program loads the manifest, and
+// fetches the computations of all its graphs from the persistent cache in
+// background (which also loads the executables onto the devices), so that the
+// sync points of the first steps find them already loaded, instead of going
+// through the persistent cache one graph at a time.
+class WarmStart {
+ public:
+  using ComputationPtr = std::shared_ptr<xla::ComputationClient::Computation>;
+
+  // Returns the warm start singleton, or nullptr if the warm start is not
+  // enabled (XLA_WARM_START not set, or persistent cache not enabled). The
+  // first call starts the preload of the manifest graphs.
+  static WarmStart* Get();
+
+  // Loads the manifest at manifest_path, if present. At most max_graphs
+  // graphs are kept within the manifest.
+  WarmStart(std::string manifest_path, size_t max_graphs);
+
+  // Schedules the load of the computations of the manifest graphs from the
+  // persistent cache. Nothing gets loaded if the manifest was written with
+  // different XLA_LAYOUTS.
+  void Preload(PersistentCache* persistent_cache);
+
+  // Records that the graph with the given hash ran, adding it to the manifest
+  // (written in background) if new.
+  void RecordGraph(const torch::lazy::hash_t& hash);
+
+  // Returns the preloaded computation for the given hash, waiting for it if
+  // the load is still in flight. Returns nullptr if the hash was not
+  // preloaded, or if its persistent cache entry is missing.
+  ComputationPtr Take(const torch::lazy::hash_t& hash);
+
+  // Returns the hash strings of the manifest graphs.
+  std::vector<std::string> GetGraphs();
+
+  // Writes the manifest.
+  void Flush();
+
+ private:
+  struct Pending {
+    bool done = false;
+    ComputationPtr computation;
+  };
+
+  void LoadManifest();
+
+  void ScheduleWrite();
+
+  std::string manifest_path_;
+  size_t max_graphs_;
+  std::string layouts_;
+  bool layouts_match_ = true;
+  std::mutex lock_;
+  std::condition_variable cv_;
+  std::vector<std::string> graphs_;
+  std::unordered_set<std::string> graph_set_;
+  std::unordered_map<std::string, std::shared_ptr<Pending>> pending_;
+  bool write_scheduled_ = false;
+};
+
+}  // namespace torch_xla
@@ -11,19 +11,26 @@
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/stream_executor/dnn.h"
 #include "torch/csrc/lazy/core/helpers.h"
 #include "torch/csrc/lazy/core/util.h"
+#include "torch_xla/csrc/autocast_policy.h"
 #include "torch_xla/csrc/convert_ops.h"
 #include "torch_xla/csrc/data_ops.h"
 #include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/indexing_cost_model.h"
 #include "torch_xla/csrc/random.h"
 #include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
 namespace {
 
+// The mask bits packed within an S32 word.
+constexpr int64_t kMaskWordBits = 32;
+
 struct ConditionMaskData {
   xla::Shape iota_shape;
   int64_t flattened_size;
@@ -65,7 +72,12 @@ xla::XlaOp GetPromotedR1Mask(xla::XlaOp mask, const xla::Shape& input_shape) {
 
 bool ShouldUseDenseScatter(const torch::lazy::BackendDevice& device,
                            const xla::Shape& input_shape,
-                           const xla::Shape& index_shape) {
+                           const xla::Shape& index_shape, int64_t dim) {
+  if (IndexingCostModel::IsEnabled()) {
+    return IndexingCostModel::PreferDense(
+        device, IndexingCostModel::Op::kScatter, input_shape.dimensions(dim),
+        xla::ShapeUtil::ElementsIn(index_shape));
+  }
   static int dense_scatter_factor =
       xla::sys_util::GetEnvInt("XLA_DENSE_SCATTER_FACTOR", 100);
   XlaDeviceType hw_type = static_cast<XlaDeviceType>(device.type());
@@ -263,7 +275,22 @@ xla::XlaOp XlaDenseScatter(xla::XlaOp input, xla::XlaOp index, xla::XlaOp src,
   });
 }
 
-std::vector<xla::XlaOp> BuildConditionIndices(xla::XlaOp condition) {
+// Limits the dimension 0 of the sorted selection to the selected count, either
+// as a dynamic size or by zeroing the padding past it.
+xla::XlaOp LimitToLength(xla::XlaOp sorted, xla::XlaOp length, bool padded) {
+  if (!padded) {
+    return xla::SetDimensionSize(sorted, length, 0);
+  }
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(sorted);
+  xla::Shape iota_shape = shape;
+  iota_shape.set_element_type(XlaHelpers::TypeOfXlaOp(length));
+  xla::XlaOp valid = xla::Lt(xla::Iota(sorted.builder(), iota_shape, 0),
+                             xla::Broadcast(length, iota_shape.dimensions()));
+  return xla::Select(valid, sorted, xla::Zeros(sorted.builder(), shape));
+}
+
+std::vector<xla::XlaOp> BuildConditionIndices(xla::XlaOp condition,
+                                              bool padded = false) {
   ConditionMaskData cmd = CreateConditionMaskData(condition);
   std::vector<xla::XlaOp> to_sort = {cmd.r1_condition_int};
   std::vector<xla::PrimitiveType> types_to_sort = {cmd.condition_int_type};
@@ -287,8 +314,103 @@ std::vector<xla::XlaOp> BuildConditionIndices(xla::XlaOp condition) {
   }
 
   xla::XlaOp result = xla::ConcatInDim(condition.builder(), to_concat, 1);
-  xla::XlaOp result_padded = xla::SetDimensionSize(result, cmd.length, 0);
-  return {result_padded, cmd.length};
+  return {LimitToLength(result, cmd.length, padded), cmd.length};
+}
+
+// The size of the tiles the top-k of the large dimensions is first selected
+// within, or zero to always sort the whole dimension.
+int64_t TopKTileSize() {
+  static int64_t tile_size =
+      xla::sys_util::GetEnvInt("XLA_TOPK_TILE_SIZE", 1024);
+  return tile_size;
+}
+
+// Sorts the input along dim and returns the first k values and indices.
+std::vector<xla::XlaOp> SortAndSlice(xla::XlaOp input, xla::XlaOp indices,
+                                     int64_t k, int64_t dim, bool largest,
+                                     bool stable) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  std::vector<xla::PrimitiveType> types = {
+      shape.element_type(), XlaHelpers::TypeOfXlaOp(indices)};
+  xla::XlaComputation comparator =
+      largest ? xla::CreateScalarGtComputation(types, input.builder())
+              : xla::CreateScalarLtComputation(types, input.builder());
+  xla::XlaOp sort_result = xla::Sort({input, indices}, comparator, dim, stable);
+
+  std::vector<int64_t> start_indices(shape.rank(), 0);
+  std::vector<int64_t> limit_indices(shape.dimensions().begin(),
+                                     shape.dimensions().end());
+  limit_indices[dim] = k;
+  std::vector<int64_t> strides(shape.rank(), 1);
+  return {xla::Slice(xla::GetTupleElement(sort_result, 0), start_indices,
+                     limit_indices, strides),
+          xla::Slice(xla::GetTupleElement(sort_result, 1), start_indices,
+                     limit_indices, strides)};
+}
+
+int64_t GetTopKTileSize(const xla::Shape& shape, int64_t k, int64_t dim) {
+  int64_t tile_size = TopKTileSize();
+  if (tile_size <= 0 || shape.is_dynamic_dimension(dim)) {
+    return 0;
+  }
+  // The tiles must hold a few times k for the first stage to discard most of
+  // the dimension, and there must be enough of them to beat a single sort.
+  tile_size = std::max<int64_t>(tile_size, 4 * k);
+  return shape.dimensions(dim) >= 2 * tile_size ? tile_size : 0;
+}
+
+// Selects the top-k in two stages: the dimension is split in tiles, each tile
+// is sorted on its own to keep its top-k, and the top-k of the concatenated
+// tile winners is selected by a last, much smaller, sort. The sorts are stable
+// so the ties (and the padding of the last tile) keep the order of the input.
+std::vector<xla::XlaOp> TiledTopK(xla::XlaOp input, int64_t k, int64_t dim,
+                                  bool largest, int64_t tile_size) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t num_tiles = xla::CeilOfRatio(shape.dimensions(dim), tile_size);
+  xla::PaddingConfig padding_config;
+  for (int64_t i = 0; i < shape.rank(); ++i) {
+    padding_config.add_dimensions()->set_edge_padding_high(
+        i == dim ? num_tiles * tile_size - shape.dimensions(dim) : 0);
+  }
+  xla::XlaOp pad_value =
+      largest ? xla::MinValue(input.builder(), shape.element_type())
+              : xla::MaxValue(input.builder(), shape.element_type());
+  xla::XlaOp padded = xla::Pad(input, pad_value, padding_config);
+  std::vector<int64_t> padded_sizes =
+      xla::util::ToVector<int64_t>(shape.dimensions());
+  padded_sizes[dim] = num_tiles * tile_size;
+  xla::XlaOp iota = xla::Iota(
+      input.builder(),
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, padded_sizes), dim);
+
+  std::vector<int64_t> tiled_sizes = padded_sizes;
+  tiled_sizes[dim] = tile_size;
+  tiled_sizes.insert(tiled_sizes.begin() + dim, num_tiles);
+  std::vector<xla::XlaOp> tile_top =
+      SortAndSlice(xla::Reshape(padded, tiled_sizes),
+                   xla::Reshape(iota, tiled_sizes), k, dim + 1, largest,
+                   /*stable=*/true);
+
+  std::vector<int64_t> merged_sizes = padded_sizes;
+  merged_sizes[dim] = num_tiles * k;
+  return SortAndSlice(xla::Reshape(tile_top[0], merged_sizes),
+                      xla::Reshape(tile_top[1], merged_sizes), k, dim,
+                      largest, /*stable=*/true);
+}
+
+// Returns the top-k values along dim, and their S32 indices.
+std::vector<xla::XlaOp> SelectTopK(xla::XlaOp input, int64_t k, int64_t dim,
+                                   bool largest, bool stable) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  int64_t tile_size = GetTopKTileSize(shape, k, dim);
+  if (tile_size > 0) {
+    XLA_COUNTER("TiledTopK", 1);
+    return TiledTopK(input, k, dim, largest, tile_size);
+  }
+  xla::Shape iota_shape =
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
+  xla::XlaOp iota = xla::Iota(input.builder(), iota_shape, dim);
+  return SortAndSlice(input, iota, k, dim, largest, stable);
 }
 
 }  // namespace
@@ -317,26 +439,29 @@ std::vector<xla::XlaOp> CreateKthValue(xla::XlaOp input, int64_t k, int64_t dim,
   // Here 'k' is 1 based (1...).
   const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
   XLA_CHECK_LE(k, shape.dimensions(dim));
-  xla::Shape iota_shape =
-      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
-  xla::XlaOp iota = xla::Iota(input.builder(), iota_shape, dim);
-  xla::XlaOp sort_result = xla::Sort(
-      {input, iota},
-      xla::CreateScalarLtComputation(
-          {shape.element_type(), xla::PrimitiveType::S32}, input.builder()),
-      dim);
+  // The k-th smallest value is the last of the k smallest ones, or of the
+  // (size - k + 1) largest ones, whichever needs the smaller top-k.
+  int64_t size = shape.dimensions(dim);
+  bool largest = k > size / 2;
+  int64_t count = largest ? size - k + 1 : k;
+  std::vector<xla::XlaOp> top;
+  if (GetTopKTileSize(shape, count, dim) > 0) {
+    top = SelectTopK(input, count, dim, largest, /*stable=*/false);
+  } else {
+    top = SelectTopK(input, k, dim, /*largest=*/false, /*stable=*/false);
+    count = k;
+  }
 
   std::vector<int64_t> start_indices(shape.rank(), 0);
-  start_indices[dim] = k - 1;
+  start_indices[dim] = count - 1;
   std::vector<int64_t> limit_indices(shape.dimensions().begin(),
                                      shape.dimensions().end());
-  limit_indices[dim] = k;
+  limit_indices[dim] = count;
   std::vector<int64_t> strides(shape.rank(), 1);
 
-  xla::XlaOp values = xla::Slice(xla::GetTupleElement(sort_result, 0),
-                                 start_indices, limit_indices, strides);
-  xla::XlaOp indices = xla::Slice(xla::GetTupleElement(sort_result, 1),
-                                  start_indices, limit_indices, strides);
+  xla::XlaOp values = xla::Slice(top[0], start_indices, limit_indices, strides);
+  xla::XlaOp indices =
+      xla::Slice(top[1], start_indices, limit_indices, strides);
   if (!keepdim) {
     auto reshape_sizes = torch::lazy::DropDimensions(
         xla::util::ToVector<int64_t>(shape.dimensions()),
@@ -355,32 +480,11 @@ std::vector<xla::XlaOp> CreateTopK(xla::XlaOp input, int64_t k, int64_t dim,
   // Here 'k' is 1 based (1...).
   const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
   XLA_CHECK_LE(k, shape.dimensions(dim));
-  xla::Shape iota_shape =
-      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, shape.dimensions());
-  xla::XlaOp iota = xla::Iota(input.builder(), iota_shape, dim);
-  xla::XlaComputation comparator =
-      largest ? xla::CreateScalarGtComputation(
-                    {shape.element_type(), xla::PrimitiveType::S32},
-                    input.builder())
-              : xla::CreateScalarLtComputation(
-                    {shape.element_type(), xla::PrimitiveType::S32},
-                    input.builder());
-  xla::XlaOp sort_result = xla::Sort({input, iota}, comparator, dim, stable);
-
-  std::vector<int64_t> start_indices(shape.rank(), 0);
-  std::vector<int64_t> limit_indices(shape.dimensions().begin(),
-                                     shape.dimensions().end());
-  limit_indices[dim] = k;
-  std::vector<int64_t> strides(shape.rank(), 1);
-
-  xla::XlaOp values = xla::Slice(xla::GetTupleElement(sort_result, 0),
-                                 start_indices, limit_indices, strides);
-  xla::XlaOp indices = xla::Slice(xla::GetTupleElement(sort_result, 1),
-                                  start_indices, limit_indices, strides);
+  std::vector<xla::XlaOp> top = SelectTopK(input, k, dim, largest, stable);
   // aten::topk() wants Long tensors as indices.
-  return {values, xla::ConvertElementType(
-                      indices, GetDevicePrimitiveType(xla::PrimitiveType::S64,
-                                                      /*device=*/nullptr))};
+  return {top[0], xla::ConvertElementType(
+                      top[1], GetDevicePrimitiveType(xla::PrimitiveType::S64,
+                                                     /*device=*/nullptr))};
 }
 
 xla::XlaOp CreateMatMul(xla::XlaOp lhs, xla::XlaOp rhs) {
@@ -422,9 +526,7 @@ xla::XlaOp CreateMatMul(xla::XlaOp lhs, xla::XlaOp rhs) {
     dims.add_lhs_contracting_dimensions(lhs_shape.rank() - 1);
     dims.add_rhs_contracting_dimensions(lhs_shape.rank() - 2);
 
-    xla::PrecisionConfig precision_config =
-        XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
-    return xla::DotGeneral(reshaped_lhs, reshaped_rhs, dims, &precision_config);
+    return BuildDotGeneral(reshaped_lhs, reshaped_rhs, dims);
   }
   XLA_ERROR() << "Unsupported matmul operation: matmul(" << lhs_shape << ", "
               << rhs_shape << ")";
@@ -460,9 +562,29 @@ xla::XlaOp BuildMatMulWithMultiplier(xla::XlaOp lhs, xla::XlaOp rhs,
 }
 
 xla::XlaOp BuildDot(xla::XlaOp lhs, xla::XlaOp rhs) {
+  // Same contraction as xla::Dot().
+  xla::DotDimensionNumbers dims;
+  dims.add_lhs_contracting_dimensions(XlaHelpers::ShapeOfXlaOp(lhs).rank() -
+                                      1);
+  dims.add_rhs_contracting_dimensions(0);
+  return BuildDotGeneral(lhs, rhs, dims);
+}
+
+xla::XlaOp BuildDotGeneral(xla::XlaOp lhs, xla::XlaOp rhs,
+                           const xla::DotDimensionNumbers& dims) {
   xla::PrecisionConfig precision_config =
       XlaHelpers::BuildPrecisionConfig(XlaHelpers::mat_mul_precision());
-  return xla::Dot(lhs, rhs, &precision_config);
+  xla::PrimitiveType type = XlaHelpers::TypeOfXlaOp(lhs);
+  xla::PrimitiveType accumulation_type =
+      AutocastPolicy::GetAccumulationType(type);
+  if (accumulation_type == type) {
+    return xla::DotGeneral(lhs, rhs, dims, &precision_config);
+  }
+  // Accumulate the low precision products in F32, and only round the results.
+  return xla::ConvertElementType(
+      xla::DotGeneral(lhs, rhs, dims, &precision_config,
+                      /*preferred_element_type=*/accumulation_type),
+      type);
 }
 
 xla::XlaOp BuildBernoulli(xla::XlaOp probability, xla::XlaOp seed,
@@ -499,6 +621,80 @@ xla::XlaOp BuildDropout(xla::XlaOp input, float probability, xla::XlaOp seed) {
   return input * mask;
 }
 
+xla::XlaOp BuildDropoutKeepMask(xla::XlaOp seed, const xla::Shape& shape,
+                                double probability) {
+  // The noise is F32 for all the input types, since the reduced precision ones
+  // would round the probability.
+  xla::Shape noise_shape = xla::ShapeUtil::MakeShape(xla::PrimitiveType::F32,
+                                                     shape.dimensions());
+  xla::XlaOp noise = RngUniform(
+      seed, noise_shape, xla::Zero(seed.builder(), xla::PrimitiveType::F32),
+      xla::One(seed.builder(), xla::PrimitiveType::F32));
+  return xla::Ge(noise, XlaHelpers::ScalarValue<float>(
+                            probability, xla::PrimitiveType::F32,
+                            seed.builder()));
+}
+
+xla::XlaOp BuildDropoutApply(xla::XlaOp input, xla::XlaOp mask,
+                             double probability) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::XlaOp scale = XlaHelpers::ScalarValue<double>(
+      1.0 / (1.0 - probability), shape.element_type(), input.builder());
+  return xla::Select(mask, input * scale, xla::ZerosLike(input));
+}
+
+int64_t GetPackedMaskWords(const xla::Shape& shape) {
+  int64_t num_elements = xla::ShapeUtil::ElementsIn(shape);
+  return std::max<int64_t>((num_elements + kMaskWordBits - 1) / kMaskWordBits,
+                           1);
+}
+
+xla::XlaOp BuildPackedMask(xla::XlaOp mask) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(mask);
+  int64_t num_elements = xla::ShapeUtil::ElementsIn(shape);
+  int64_t num_words = GetPackedMaskWords(shape);
+  xla::XlaBuilder* builder = mask.builder();
+  xla::XlaOp bits = xla::ConvertElementType(
+      xla::Reshape(mask, {num_elements}), xla::PrimitiveType::S32);
+  xla::PaddingConfig padding_config;
+  auto* dims = padding_config.add_dimensions();
+  dims->set_edge_padding_low(0);
+  dims->set_edge_padding_high(num_words * kMaskWordBits - num_elements);
+  dims->set_interior_padding(0);
+  bits = xla::Reshape(
+      xla::Pad(bits, xla::Zero(builder, xla::PrimitiveType::S32),
+               padding_config),
+      {num_words, kMaskWordBits});
+  xla::XlaOp shifts = xla::Iota(
+      builder,
+      xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32,
+                                {num_words, kMaskWordBits}),
+      1);
+  // The bits of a word are disjoint, so their sum is their bitwise or.
+  return xla::Reduce(
+      xla::ShiftLeft(bits, shifts), xla::Zero(builder, xla::PrimitiveType::S32),
+      XlaHelpers::CreateAddComputation(xla::PrimitiveType::S32), {1});
+}
+
+xla::XlaOp BuildUnpackedMask(xla::XlaOp packed, const xla::Shape& shape) {
+  const xla::Shape& packed_shape = XlaHelpers::ShapeOfXlaOp(packed);
+  int64_t num_words = packed_shape.dimensions(0);
+  xla::XlaBuilder* builder = packed.builder();
+  xla::Shape bits_shape = xla::ShapeUtil::MakeShape(
+      xla::PrimitiveType::S32, {num_words, kMaskWordBits});
+  xla::XlaOp bits = xla::And(
+      xla::ShiftRightLogical(
+          xla::BroadcastInDim(packed, bits_shape.dimensions(), {0}),
+          xla::Iota(builder, bits_shape, 1)),
+      xla::One(builder, xla::PrimitiveType::S32));
+  int64_t num_elements = xla::ShapeUtil::ElementsIn(shape);
+  bits = xla::SliceInDim(xla::Reshape(bits, {num_words * kMaskWordBits}), 0,
+                         num_elements, 1, 0);
+  return xla::Reshape(
+      xla::Ne(bits, xla::Zero(builder, xla::PrimitiveType::S32)),
+      shape.dimensions());
+}
+
 std::vector<xla::XlaOp> CreateBroadcastTensors(
     absl::Span<const xla::XlaOp> operands) {
   xla::Shape result_shape = XlaHelpers::ShapeOfXlaOp(operands.front());
@@ -647,7 +843,11 @@ xla::XlaOp CreateScatter(const torch::lazy::BackendDevice& device,
     std::vector<int64_t> base_indices(source_shape.rank(), 0);
     source_op = BuildSlice(source_op, base_indices, index_shape.dimensions());
   }
-  if (ShouldUseDenseScatter(device, input_shape, index_shape)) {
+  bool use_dense =
+      options.use_dense
+          ? *options.use_dense
+          : ShouldUseDenseScatter(device, input_shape, index_shape, dim);
+  if (use_dense) {
     return XlaDenseScatter(input, index, source_op, dim, options);
   }
 
@@ -719,13 +919,15 @@ xla::XlaOp BuildLinspace(const torch::lazy::BackendDevice& device,
   return CreatePut(device, res, last_index, end, /*accumulate=*/false);
 }
 
-std::vector<xla::XlaOp> BuildNonZero(xla::XlaOp input) {
+std::vector<xla::XlaOp> BuildNonZero(xla::XlaOp input, bool padded) {
   const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
   return BuildConditionIndices(
-      xla::Ne(input, xla::Zero(input.builder(), input_shape.element_type())));
+      xla::Ne(input, xla::Zero(input.builder(), input_shape.element_type())),
+      padded);
 }
 
-std::vector<xla::XlaOp> BuildMaskedSelect(xla::XlaOp input, xla::XlaOp mask) {
+std::vector<xla::XlaOp> BuildMaskedSelect(xla::XlaOp input, xla::XlaOp mask,
+                                          bool padded) {
   xla::Shape input_shape;
   xla::XlaOp r1_input = XlaHelpers::Flatten(input, &input_shape);
   xla::XlaOp r1_bcast_mask = GetPromotedR1Mask(mask, input_shape);
@@ -738,9 +940,7 @@ std::vector<xla::XlaOp> BuildMaskedSelect(xla::XlaOp input, xla::XlaOp mask) {
       /*dimension=*/0,
       /*is_stable=*/true);
   xla::XlaOp sorted_input = xla::GetTupleElement(sorted, 1);
-  xla::XlaOp sorted_input_padded =
-      xla::SetDimensionSize(sorted_input, cmd.length, 0);
-  return {sorted_input_padded, cmd.length};
+  return {LimitToLength(sorted_input, cmd.length, padded), cmd.length};
 }
 
 xla::XlaOp BuildMaskedScatter(xla::XlaOp input, xla::XlaOp mask,
@@ -956,6 +1156,161 @@ std::vector<xla::XlaOp> BuildAdamOptimizerStep(
   return results;
 }
 
+std::vector<xla::XlaOp> BuildLambOptimizerStep(
+    const xla::XlaOp& found_inf, const xla::XlaOp& step,
+    const xla::XlaOp& param, const xla::XlaOp& grad, const xla::XlaOp& exp_avg,
+    const xla::XlaOp& exp_avg_sq, const xla::XlaOp& beta1,
+    const xla::XlaOp& beta2, const xla::XlaOp& lr,
+    const xla::XlaOp& weight_decay, const xla::XlaOp& eps,
+    bool use_weight_decay) {
+  // XLA version of the LAMB algorithm
+  // https://arxiv.org/abs/1904.00962
+  xla::PrimitiveType type = XlaHelpers::ShapeOfXlaOp(param).element_type();
+  xla::PrimitiveType step_type = XlaHelpers::ShapeOfXlaOp(step).element_type();
+  xla::XlaOp one = xla::One(param.builder(), type);
+  xla::XlaOp zero = xla::Zero(param.builder(), type);
+  xla::XlaOp step_one = xla::One(param.builder(), step_type);
+
+  xla::XlaOp found_inf_cond = xla::Ne(
+      found_inf, xla::Zero(param.builder(),
+                           XlaHelpers::ShapeOfXlaOp(found_inf).element_type()));
+  xla::XlaOp new_step =
+      step + xla::ConvertElementType(xla::Not(found_inf_cond), step_type);
+
+  xla::XlaOp bias_correction1 =
+      xla::ConvertElementType(step_one - xla::Pow(beta1, new_step), type);
+  xla::XlaOp bias_correction2 =
+      xla::ConvertElementType(step_one - xla::Pow(beta2, new_step), type);
+  xla::XlaOp param_beta1 = xla::ConvertElementType(beta1, type);
+  xla::XlaOp param_beta2 = xla::ConvertElementType(beta2, type);
+
+  xla::XlaOp new_exp_avg = xla::Select(
+      found_inf_cond, exp_avg,
+      exp_avg * param_beta1 + grad * (one - param_beta1));
+  xla::XlaOp new_exp_avg_sq =
+      xla::Select(found_inf_cond, exp_avg_sq,
+                  exp_avg_sq * param_beta2 + grad * grad * (one - param_beta2));
+  xla::XlaOp update =
+      (new_exp_avg / bias_correction1) /
+      (xla::Sqrt(new_exp_avg_sq / bias_correction2) +
+       xla::ConvertElementType(eps, type));
+  if (use_weight_decay) {
+    update = update + param * xla::ConvertElementType(weight_decay, type);
+  }
+  // The layer-wise trust ratio, which is one if either norm is zero.
+  xla::XlaComputation add_func = XlaHelpers::CreateAddComputation(type);
+  xla::XlaOp param_norm =
+      xla::Sqrt(xla::ReduceAll(param * param, zero, add_func));
+  xla::XlaOp update_norm =
+      xla::Sqrt(xla::ReduceAll(update * update, zero, add_func));
+  xla::XlaOp trust_ratio = xla::Select(
+      xla::And(xla::Gt(param_norm, zero), xla::Gt(update_norm, zero)),
+      param_norm / update_norm, one);
+  xla::XlaOp new_param = xla::Select(
+      found_inf_cond, param,
+      param - xla::ConvertElementType(lr, type) * trust_ratio * update);
+
+  std::vector<xla::XlaOp> results;
+  results.push_back(new_step);
+  results.push_back(new_param);
+  results.push_back(new_exp_avg);
+  results.push_back(new_exp_avg_sq);
+  return results;
+}
+
+std::vector<xla::XlaOp> BuildAdafactorOptimizerStep(
+    const xla::XlaOp& found_inf, const xla::XlaOp& step,
+    const xla::XlaOp& param, const xla::XlaOp& grad,
+    const xla::XlaOp& exp_avg_sq, const xla::XlaOp& exp_avg_sq_col,
+    const xla::XlaOp& lr, const xla::XlaOp& weight_decay, double decay_rate,
+    double eps1, double eps2, double clip_threshold, bool use_weight_decay,
+    bool scale_parameter) {
+  // XLA version of the Adafactor algorithm
+  // https://arxiv.org/abs/1804.04235
+  const xla::Shape& param_shape = XlaHelpers::ShapeOfXlaOp(param);
+  xla::PrimitiveType type = param_shape.element_type();
+  xla::PrimitiveType step_type = XlaHelpers::ShapeOfXlaOp(step).element_type();
+  xla::XlaBuilder* builder = param.builder();
+  xla::XlaOp one = xla::One(builder, type);
+  xla::XlaOp zero = xla::Zero(builder, type);
+  xla::XlaComputation add_func = XlaHelpers::CreateAddComputation(type);
+  auto mean = [&](xla::XlaOp input, int64_t dim) {
+    int64_t size = XlaHelpers::ShapeOfXlaOp(input).dimensions(dim);
+    return xla::Reduce(input, zero, add_func, {dim}) /
+           XlaHelpers::ScalarValue<double>(size, type, builder);
+  };
+  auto rms = [&](xla::XlaOp input) {
+    int64_t size =
+        xla::ShapeUtil::ElementsIn(XlaHelpers::ShapeOfXlaOp(input));
+    return xla::Sqrt(xla::ReduceAll(input * input, zero, add_func) /
+                     XlaHelpers::ScalarValue<double>(size, type, builder));
+  };
+
+  xla::XlaOp found_inf_cond = xla::Ne(
+      found_inf,
+      xla::Zero(builder, XlaHelpers::ShapeOfXlaOp(found_inf).element_type()));
+  xla::XlaOp new_step =
+      step + xla::ConvertElementType(xla::Not(found_inf_cond), step_type);
+  xla::XlaOp beta2t = xla::ConvertElementType(
+      xla::One(builder, step_type) -
+          xla::Pow(new_step,
+                   XlaHelpers::ScalarValue(decay_rate, step_type, builder)),
+      type);
+
+  std::vector<xla::XlaOp> results;
+  results.push_back(new_step);
+  xla::XlaOp squared_grad =
+      grad * grad + XlaHelpers::ScalarValue(eps1, type, builder);
+  xla::XlaOp update;
+  std::vector<xla::XlaOp> new_state;
+  int64_t rank = param_shape.rank();
+  if (rank >= 2) {
+    std::vector<int64_t> batch_dims = torch::lazy::Iota<int64_t>(rank - 2);
+    xla::XlaOp new_row = exp_avg_sq * beta2t +
+                         mean(squared_grad, rank - 1) * (one - beta2t);
+    xla::XlaOp new_col = exp_avg_sq_col * beta2t +
+                         mean(squared_grad, rank - 2) * (one - beta2t);
+    // The rows normalized by their mean, times the columns, approximate the
+    // full second moment.
+    xla::XlaOp row_factor =
+        xla::Rsqrt(xla::Div(new_row, mean(new_row, rank - 2), batch_dims));
+    xla::XlaOp col_factor = xla::Rsqrt(new_col);
+    std::vector<int64_t> row_dims(batch_dims);
+    row_dims.push_back(rank - 2);
+    std::vector<int64_t> col_dims(batch_dims);
+    col_dims.push_back(rank - 1);
+    update = xla::Mul(xla::Mul(grad, row_factor, row_dims), col_factor,
+                      col_dims);
+    new_state.push_back(xla::Select(found_inf_cond, exp_avg_sq, new_row));
+    new_state.push_back(xla::Select(found_inf_cond, exp_avg_sq_col, new_col));
+  } else {
+    xla::XlaOp new_exp_avg_sq =
+        exp_avg_sq * beta2t + squared_grad * (one - beta2t);
+    update = xla::Rsqrt(new_exp_avg_sq) * grad;
+    new_state.push_back(
+        xla::Select(found_inf_cond, exp_avg_sq, new_exp_avg_sq));
+  }
+  update = update /
+           xla::Max(one, rms(update) / XlaHelpers::ScalarValue(
+                                           clip_threshold, type, builder));
+  xla::XlaOp step_size = xla::ConvertElementType(lr, type);
+  if (scale_parameter) {
+    step_size = step_size *
+                xla::Max(XlaHelpers::ScalarValue(eps2, type, builder),
+                         rms(param));
+  }
+  xla::XlaOp new_param = param;
+  if (use_weight_decay) {
+    new_param = new_param - new_param *
+                                xla::ConvertElementType(weight_decay, type) *
+                                step_size;
+  }
+  new_param = new_param - update * step_size;
+  results.push_back(xla::Select(found_inf_cond, param, new_param));
+  results.insert(results.end(), new_state.begin(), new_state.end());
+  return results;
+}
+
 xla::XlaOp BuildXLogY(xla::XlaOp input, xla::XlaOp other) {
   // input and xla::Log(other) can have different types, need to promote
   // the multiply.
@@ -976,46 +1331,117 @@ xla::XlaOp BuildXLogY(xla::XlaOp input, xla::XlaOp other) {
 xla::XlaOp BuildRoll(xla::XlaOp input, absl::Span<const int64_t> shifts,
                      absl::Span<const int64_t> dims) {
   const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
-
-  int64_t input_dims = input_shape.dimensions_size();
-  int64_t num_dims = dims.size();
-
-  bool need_flatten = num_dims == 0 ? true : false;
-
-  int64_t step = need_flatten ? 1 : num_dims;
   int64_t input_numel = xla::ShapeUtil::ElementsIn(input_shape);
 
+  bool need_flatten = dims.empty();
+  xla::XlaOp rolled =
+      need_flatten ? xla::Reshape(input, {input_numel}) : input;
+  int64_t step = need_flatten ? 1 : dims.size();
   for (int64_t i = 0; i != step; ++i) {
-    input = need_flatten ? xla::Reshape(input, {input_numel}) : input;
-
-    int64_t cur_dim = need_flatten ? 0 : dims[i];
-    if (cur_dim < 0) {
-      cur_dim += input_dims;
-    }
-
-    int64_t offset = shifts[i];
+    int64_t cur_dim =
+        need_flatten ? 0
+                     : torch::lazy::GetCanonicalDimensionIndex(
+                           dims[i], input_shape.rank());
     int64_t dim_size =
         need_flatten ? input_numel : input_shape.dimensions(cur_dim);
-
+    if (dim_size == 0) {
+      continue;
+    }
     // Adjust large offsets into [0, dim_size). This also makes negative
     // offsets positive.
-    offset = ((offset % dim_size) + dim_size) % dim_size;
-
-    // Stack two copies of the dimension, then slice from the calculated
-    // offset.
-    xla::XlaOp concat =
-        xla::ConcatInDim(input.builder(), {input, input}, cur_dim);
-    std::vector<xla::XlaOp> start_indices(
-        need_flatten ? 1 : input_shape.dimensions_size(),
-        xla::Zero(input.builder(), xla::PrimitiveType::S64));
-    start_indices[cur_dim] = XlaHelpers::ScalarValue(
-        dim_size - offset, xla::PrimitiveType::S64, input.builder());
-    input = xla::DynamicSlice(concat, start_indices,
-                              need_flatten ? absl::MakeConstSpan({input_numel})
-                                           : input_shape.dimensions());
-  }
-
-  return need_flatten ? xla::Reshape(input, input_shape.dimensions()) : input;
+    int64_t offset = ((shifts[i] % dim_size) + dim_size) % dim_size;
+    if (offset == 0) {
+      continue;
+    }
+    // The element at index j comes from (j + dim_size - offset) % dim_size,
+    // which with a static offset are the two contiguous ranges below. Their
+    // concatenation is built at the output size and fuses into the consumers,
+    // instead of slicing the output out of a doubled copy of the input.
+    int64_t split = dim_size - offset;
+    xla::XlaOp tail = xla::SliceInDim(rolled, split, dim_size, 1, cur_dim);
+    xla::XlaOp head = xla::SliceInDim(rolled, 0, split, 1, cur_dim);
+    rolled = xla::ConcatInDim(input.builder(), {tail, head}, cur_dim);
+  }
+  return need_flatten ? xla::Reshape(rolled, input_shape.dimensions())
+                      : rolled;
+}
+
+xla::XlaOp BuildHostCallbackOutfeed(xla::XlaOp input, xla::XlaOp token,
+                                    int64_t callback_id) {
+  const xla::Shape& input_shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::XlaOp header = XlaHelpers::ScalarValue<int32_t>(
+      callback_id, xla::PrimitiveType::S32, input.builder());
+  token = xla::OutfeedWithToken(
+      header, token, xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {}),
+      /*outfeed_config=*/"");
+  return xla::OutfeedWithToken(
+      input, token,
+      xla::ShapeUtil::MakeShapeWithDescendingLayout(input_shape.element_type(),
+                                                    input_shape.dimensions()),
+      /*outfeed_config=*/"");
+}
+
+xla::XlaOp BuildSummaryScalarUpdate(xla::XlaOp state, xla::XlaOp value,
+                                    double ema_decay) {
+  int64_t numel = xla::ShapeUtil::ElementsIn(XlaHelpers::ShapeOfXlaOp(value));
+  if (numel == 0) {
+    return state;
+  }
+  xla::XlaBuilder* builder = state.builder();
+  xla::PrimitiveType type = xla::PrimitiveType::F32;
+  xla::XlaOp fvalue = xla::ConvertElementType(value, type);
+  auto field = [&](int64_t index) {
+    return xla::Reshape(xla::SliceInDim(state, index, index + 1, 1, 0), {});
+  };
+  xla::XlaOp count = field(0);
+  xla::XlaOp value_sum = xla::ReduceAll(
+      fvalue, xla::Zero(builder, type), XlaHelpers::CreateAddComputation(type));
+  xla::XlaOp value_min =
+      xla::ReduceAll(fvalue, xla::MaxValue(builder, type),
+                     XlaHelpers::CreateMinComputation(type));
+  xla::XlaOp value_max =
+      xla::ReduceAll(fvalue, xla::MinValue(builder, type),
+                     XlaHelpers::CreateMaxComputation(type));
+  xla::XlaOp value_mean =
+      value_sum / XlaHelpers::ScalarValue<float>(numel, type, builder);
+  xla::XlaOp decay = XlaHelpers::ScalarValue<float>(ema_decay, type, builder);
+  xla::XlaOp one = xla::One(builder, type);
+  // The running average starts from the first folded mean.
+  xla::XlaOp ema = xla::Select(
+      xla::Gt(count, xla::Zero(builder, type)),
+      decay * field(5) + (one - decay) * value_mean, value_mean);
+  std::vector<xla::XlaOp> fields = {
+      count + XlaHelpers::ScalarValue<float>(numel, type, builder),
+      field(1) + value_sum,
+      xla::Min(field(2), value_min),
+      xla::Max(field(3), value_max),
+      value_mean,
+      ema};
+  for (auto& new_field : fields) {
+    new_field = xla::Reshape(new_field, {1});
+  }
+  return xla::ConcatInDim(builder, fields, 0);
+}
+
+xla::XlaOp BuildSummaryHistogramUpdate(xla::XlaOp state, xla::XlaOp value,
+                                       double min_value, double max_value) {
+  XLA_CHECK_LT(min_value, max_value);
+  xla::XlaBuilder* builder = state.builder();
+  xla::PrimitiveType type = xla::PrimitiveType::F32;
+  int64_t num_bins = XlaHelpers::ShapeOfXlaOp(state).dimensions(0);
+  xla::XlaOp fvalue = XlaHelpers::Flatten(xla::ConvertElementType(value, type));
+  xla::XlaOp scale = XlaHelpers::ScalarValue<float>(
+      num_bins / (max_value - min_value), type, builder);
+  xla::XlaOp bin = xla::Floor(
+      (fvalue - XlaHelpers::ScalarValue<float>(min_value, type, builder)) *
+      scale);
+  bin = xla::Clamp(xla::Zero(builder, type), bin,
+                   XlaHelpers::ScalarValue<float>(num_bins - 1, type, builder));
+  xla::XlaOp not_nan = xla::Not(xla::IsNan(fvalue));
+  xla::XlaOp index = xla::ConvertElementType(
+      xla::Select(not_nan, bin, xla::ZerosLike(bin)), xla::PrimitiveType::S32);
+  xla::XlaOp weight = xla::ConvertElementType(not_nan, type);
+  return CreateIndexAdd(state, 0, index, weight);
 }
 
 }  // namespace torch_xla
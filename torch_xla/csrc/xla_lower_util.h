@@ -31,6 +31,11 @@ xla::XlaOp BuildMatMulWithMultiplier(xla::XlaOp lhs, xla::XlaOp rhs,
 
 xla::XlaOp BuildDot(xla::XlaOp lhs, xla::XlaOp rhs);
 
+// The dot with the mat_mul_precision() precision, whose low precision products
+// are accumulated in F32 under the autocast policy.
+xla::XlaOp BuildDotGeneral(xla::XlaOp lhs, xla::XlaOp rhs,
+                           const xla::DotDimensionNumbers& dims);
+
 xla::XlaOp BuildBernoulli(xla::XlaOp probability, xla::XlaOp seed,
                           xla::PrimitiveType type);
 
@@ -39,6 +44,27 @@ xla::XlaOp BuildExponential(xla::XlaOp lambda, xla::XlaOp seed,
 
 xla::XlaOp BuildDropout(xla::XlaOp input, float probability, xla::XlaOp seed);
 
+// The PRED mask of the elements of the shape a dropout of the given
+// probability keeps, out of the uniform numbers the seed generates, so that the
+// same seed always regenerates the same mask.
+xla::XlaOp BuildDropoutKeepMask(xla::XlaOp seed, const xla::Shape& shape,
+                                double probability);
+
+// Zeroes the input elements outside the keep mask, and scales the others by
+// 1 / (1 - probability).
+xla::XlaOp BuildDropoutApply(xla::XlaOp input, xla::XlaOp mask,
+                             double probability);
+
+// Packs the elements of the PRED mask, in row major order, into the bits of a
+// rank 1 S32 array, 32 elements per word.
+xla::XlaOp BuildPackedMask(xla::XlaOp mask);
+
+// The number of words of the packed mask of the shape.
+int64_t GetPackedMaskWords(const xla::Shape& shape);
+
+// The inverse of BuildPackedMask(), returning the PRED mask of the shape.
+xla::XlaOp BuildUnpackedMask(xla::XlaOp packed, const xla::Shape& shape);
+
 std::vector<xla::XlaOp> CreateBroadcastTensors(
     absl::Span<const xla::XlaOp> operands);
 
@@ -71,6 +97,9 @@ struct ScatterOptions {
   XlaOpCombiner combiner;
   absl::optional<xla::XlaOp> init_value;
   bool indices_are_unique = true;
+  // Forces the dense (or the sparse) lowering, instead of picking one from the
+  // shapes.
+  absl::optional<bool> use_dense;
 };
 
 xla::XlaOp CreateScatter(const torch::lazy::BackendDevice& device,
@@ -83,9 +112,13 @@ xla::XlaOp CreatePut(const torch::lazy::BackendDevice& device, xla::XlaOp input,
 xla::XlaOp BuildLinspace(const torch::lazy::BackendDevice& device,
                          xla::XlaOp start, xla::XlaOp end, int64_t steps);
 
-std::vector<xla::XlaOp> BuildNonZero(xla::XlaOp input);
+// Returns the selected values (or indices) and their count. If padded, the
+// results keep the static upper bound size, with zeros past the count, instead
+// of a dynamic dimension.
+std::vector<xla::XlaOp> BuildNonZero(xla::XlaOp input, bool padded = false);
 
-std::vector<xla::XlaOp> BuildMaskedSelect(xla::XlaOp input, xla::XlaOp mask);
+std::vector<xla::XlaOp> BuildMaskedSelect(xla::XlaOp input, xla::XlaOp mask,
+                                          bool padded = false);
 
 xla::XlaOp BuildMaskedScatter(xla::XlaOp input, xla::XlaOp mask,
                               xla::XlaOp source);
@@ -116,9 +149,55 @@ std::vector<xla::XlaOp> BuildAdamOptimizerStep(
     const xla::XlaOp& weight_decay, const xla::XlaOp& eps,
     bool use_weight_decay, bool use_amsgrad, bool use_adamw);
 
+// Computes a LAMB step, which scales the Adam update (with the L2 weight decay
+// added) of each parameter by its trust ratio ||param|| / ||update||. Returns
+// the new step, param, exp_avg and exp_avg_sq.
+std::vector<xla::XlaOp> BuildLambOptimizerStep(
+    const xla::XlaOp& found_inf, const xla::XlaOp& step,
+    const xla::XlaOp& param, const xla::XlaOp& grad, const xla::XlaOp& exp_avg,
+    const xla::XlaOp& exp_avg_sq, const xla::XlaOp& beta1,
+    const xla::XlaOp& beta2, const xla::XlaOp& lr,
+    const xla::XlaOp& weight_decay, const xla::XlaOp& eps,
+    bool use_weight_decay);
+
+// Computes an Adafactor step (without first moment). The second moment of the
+// parameters of rank 2 or more is factored into the exp_avg_sq_row and
+// exp_avg_sq_col running averages of the rows and columns (the last two
+// dimensions), while the others keep their full second moment within
+// exp_avg_sq (with exp_avg_sq_col unused). Returns the new step, param and
+// second moment state (exp_avg_sq_row and exp_avg_sq_col if factored, or
+// exp_avg_sq).
+std::vector<xla::XlaOp> BuildAdafactorOptimizerStep(
+    const xla::XlaOp& found_inf, const xla::XlaOp& step,
+    const xla::XlaOp& param, const xla::XlaOp& grad,
+    const xla::XlaOp& exp_avg_sq, const xla::XlaOp& exp_avg_sq_col,
+    const xla::XlaOp& lr, const xla::XlaOp& weight_decay, double decay_rate,
+    double eps1, double eps2, double clip_threshold, bool use_weight_decay,
+    bool scale_parameter);
+
 xla::XlaOp BuildXLogY(xla::XlaOp input, xla::XlaOp other);
 
 xla::XlaOp BuildRoll(xla::XlaOp input, absl::Span<const int64_t> shifts,
                      absl::Span<const int64_t> dims);
 
+// Emits the input into the outfeed, preceded by a S32 header holding the
+// callback ID, both chained after the token. Returns the new token.
+xla::XlaOp BuildHostCallbackOutfeed(xla::XlaOp input, xla::XlaOp token,
+                                    int64_t callback_id);
+
+// The size of the state of a scalar summary: the count, sum, min, max, last
+// mean and running average of the folded values.
+constexpr int64_t kSummaryScalarStateSize = 6;
+
+// Folds the elements of value into the scalar summary state, with ema_decay
+// the weight of the previous running average.
+xla::XlaOp BuildSummaryScalarUpdate(xla::XlaOp state, xla::XlaOp value,
+                                    double ema_decay);
+
+// Adds the elements of value to the counts of the histogram state, whose bins
+// evenly split [min_value, max_value). The values out of the range are counted
+// in the first or last bin, while the NaN ones are dropped.
+xla::XlaOp BuildSummaryHistogramUpdate(xla::XlaOp state, xla::XlaOp value,
+                                       double min_value, double max_value);
+
 }  // namespace torch_xla
@@ -1,55 +1,654 @@
 
 #include "torch_xla/csrc/xla_sharding_util.h"
 
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "absl/strings/str_join.h"
+#include "absl/types/optional.h"
 #include "tensorflow/compiler/xla/execution_options_util.h"
+#include "tensorflow/compiler/xla/service/hlo_instruction.h"
 #include "tensorflow/compiler/xla/service/hlo_module.h"
 #include "tensorflow/compiler/xla/service/hlo_parser.h"
 #include "tensorflow/compiler/xla/service/hlo_pass_pipeline.h"
+#include "tensorflow/compiler/xla/service/hlo_sharding.h"
 #include "tensorflow/compiler/xla/service/hlo_verifier.h"
 #include "tensorflow/compiler/xla/service/sharding_propagation.h"
 #include "tensorflow/compiler/xla/service/spmd/spmd_partitioner.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/compiler/xla/xla.pb.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "torch_xla/csrc/device.h"
+#include "torch_xla/csrc/helpers.h"
+#include "torch_xla/csrc/ops/convolution_overrideable.h"
+#include "torch_xla/csrc/ops/device_data.h"
+#include "torch_xla/csrc/tensor_util.h"
 
 namespace torch_xla {
 namespace {
 
 using xla::internal::XlaBuilderFriend;
 
+struct TileSlice {
+  int64_t start = 0;
+  int64_t length = 0;
+  // The padded size of the shard along the dimension.
+  int64_t size = 0;
+};
+
+xla::HloSharding GetHloSharding(const xla::OpSharding& sharding) {
+  xla::HloSharding hlo_sharding =
+      ConsumeValue(xla::HloSharding::FromProto(sharding));
+  XLA_CHECK(hlo_sharding.IsReplicated() || !hlo_sharding.IsTileMaximal())
+      << "Only the replicated and tiled shardings can be placed: "
+      << hlo_sharding.ToString();
+  XLA_CHECK(!hlo_sharding.IsManual())
+      << "The manual sharding cannot be placed: " << hlo_sharding.ToString();
+  return hlo_sharding;
+}
+
+// Returns the slices of the global tensor held by the device, like the SPMD
+// partitioner lays them out: every tiled dimension is split in chunks of the
+// rounded up size, with the last ones padded.
+std::vector<TileSlice> GetTileSlices(const xla::HloSharding& sharding,
+                                     int64_t device,
+                                     absl::Span<const int64_t> sizes) {
+  std::vector<int64_t> tile_index;
+  sharding.tile_assignment().Each(
+      [&](absl::Span<const int64_t> indices, int64_t value) {
+        if (value == device && tile_index.empty()) {
+          tile_index.assign(indices.begin(), indices.end());
+        }
+      });
+  XLA_CHECK(!tile_index.empty())
+      << "Device " << device << " is not within " << sharding.ToString();
+  XLA_CHECK_EQ(sharding.TiledDataRank(), sizes.size()) << sharding.ToString();
+  std::vector<TileSlice> slices;
+  for (size_t dim = 0; dim < sizes.size(); ++dim) {
+    TileSlice slice;
+    slice.size = xla::CeilOfRatio(sizes[dim],
+                                  sharding.tile_assignment().dim(dim));
+    slice.start = std::min(tile_index[dim] * slice.size, sizes[dim]);
+    slice.length = std::min(slice.size, sizes[dim] - slice.start);
+    slices.push_back(slice);
+  }
+  return slices;
+}
+
+xla::HloComputationProto* GetEntryComputation(xla::HloModuleProto* hlo_proto) {
+  for (auto& computation : *hlo_proto->mutable_computations()) {
+    if (computation.id() == hlo_proto->entry_computation_id()) {
+      return &computation;
+    }
+  }
+  XLA_ERROR() << "No entry computation within " << hlo_proto->name();
+}
+
+void SetParameterShardings(xla::HloModuleProto* hlo_proto,
+                           absl::Span<const xla::OpSharding> shardings) {
+  for (auto& instruction :
+       *GetEntryComputation(hlo_proto)->mutable_instructions()) {
+    if (instruction.opcode() == "parameter") {
+      XLA_CHECK_LT(instruction.parameter_number(), shardings.size());
+      *instruction.mutable_sharding() =
+          shardings[instruction.parameter_number()];
+    }
+  }
+}
+
+std::vector<xla::OpSharding> GetOutputShardings(
+    const xla::HloModuleProto& hlo_proto, size_t num_outputs) {
+  xla::OpSharding sharding = hlo_proto.has_spmd_output_sharding()
+                                 ? hlo_proto.spmd_output_sharding()
+                                 : xla::HloSharding::Replicate().ToProto();
+  if (sharding.type() != xla::OpSharding::TUPLE) {
+    return std::vector<xla::OpSharding>(num_outputs, sharding);
+  }
+  XLA_CHECK_EQ(sharding.tuple_shardings_size(), num_outputs);
+  return std::vector<xla::OpSharding>(sharding.tuple_shardings().begin(),
+                                      sharding.tuple_shardings().end());
+}
+
+// The partitioner assigns the partitions with partition-id and cross
+// partition collectives, while the backend runs a computation over multiple
+// devices as replicas. With a single replica the global device ids are the
+// partition ids, so dropping the channels turns the collectives into cross
+// replica ones over the same groups.
+void ConvertPartitionsToReplicas(xla::HloModuleProto* hlo_proto) {
+  static const std::set<std::string>* collectives =
+      new std::set<std::string>({"all-gather", "all-reduce", "all-to-all",
+                                 "collective-permute", "reduce-scatter"});
+  for (auto& computation : *hlo_proto->mutable_computations()) {
+    for (auto& instruction : *computation.mutable_instructions()) {
+      if (instruction.opcode() == "partition-id") {
+        instruction.set_opcode("replica-id");
+      } else if (instruction.channel_id() > 0 &&
+                 collectives->count(instruction.opcode()) > 0) {
+        instruction.set_channel_id(0);
+        instruction.set_use_global_device_ids(false);
+      }
+    }
+  }
+}
+
+// Returns the per device data of a parameter. The data which did not go
+// through TensorToXlaData(), like the results of computations run outside of
+// the SPMD mode, gets replicated on the fly.
+std::vector<xla::ComputationClient::DataPtr> GetShards(
+    const xla::ComputationClient::DataPtr& data,
+    const std::vector<std::string>& devices) {
+  const ShardedData* sharded = dynamic_cast<const ShardedData*>(data.get());
+  if (sharded != nullptr) {
+    XLA_CHECK_EQ(sharded->shards().size(), devices.size());
+    return sharded->shards();
+  }
+  XLA_COUNTER("SpmdReplicatedParameter", 1);
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::Get()->TransferFromServer({data});
+  at::Tensor tensor = MakeTensorFromXlaLiteral(
+      literals.front(),
+      TensorTypeFromXlaType(literals.front().shape().element_type()));
+  return UnwrapXlaData(CreateTensorsData(
+      std::vector<at::Tensor>(devices.size(), tensor), devices));
+}
+
+bool IsElementwise(const torch::lazy::Node* node) {
+  static const std::unordered_set<c10::Symbol>* ops =
+      new std::unordered_set<c10::Symbol>(
+          {at::aten::abs,       at::aten::add,        at::aten::clamp,
+           at::aten::div,       at::aten::eq,         at::aten::erf,
+           at::aten::exp,       at::aten::ge,         at::aten::gelu,
+           at::aten::gt,        at::aten::hardtanh,   at::aten::le,
+           at::aten::leaky_relu, at::aten::log,       at::aten::lt,
+           at::aten::maximum,   at::aten::minimum,    at::aten::mul,
+           at::aten::ne,        at::aten::neg,        at::aten::pow,
+           at::aten::reciprocal, at::aten::relu,      at::aten::rsqrt,
+           at::aten::sigmoid,   at::aten::sign,       at::aten::silu,
+           at::aten::sqrt,      at::aten::sub,        at::aten::tanh,
+           at::aten::threshold, at::aten::where});
+  return ops->count(node->op().op) > 0;
+}
+
+const xla::Shape& GetOutputShape(const torch::lazy::Output& output) {
+  return dynamic_cast<const XlaNode*>(output.node)->xla_shape(output.index);
+}
+
+// The number of tiles of every data dimension, or an empty vector if the
+// sharding is not a tiled one.
+std::vector<int64_t> GetTileCounts(const xla::OpSharding& sharding) {
+  if (sharding.type() != xla::OpSharding::OTHER ||
+      sharding.last_tile_dims_size() > 0) {
+    return {};
+  }
+  std::vector<int64_t> counts(sharding.tile_assignment_dimensions().begin(),
+                              sharding.tile_assignment_dimensions().end());
+  if (sharding.replicate_on_last_tile_dim()) {
+    counts.pop_back();
+  }
+  return counts;
+}
+
+// Returns the sharding with the same devices and the given tile counts.
+xla::OpSharding Retile(const xla::OpSharding& sharding,
+                       const std::vector<int64_t>& counts) {
+  xla::OpSharding retiled = sharding;
+  retiled.clear_tile_assignment_dimensions();
+  for (auto count : counts) {
+    retiled.add_tile_assignment_dimensions(count);
+  }
+  if (sharding.replicate_on_last_tile_dim()) {
+    retiled.add_tile_assignment_dimensions(
+        sharding.tile_assignment_dimensions(
+            sharding.tile_assignment_dimensions_size() - 1));
+  }
+  return retiled;
+}
+
+// The explicit sharding of the node, or the one of its data for the device
+// data nodes.
+const xla::OpSharding* GetNodeSharding(const torch::lazy::Node* node) {
+  const XlaNode* xla_node = dynamic_cast<const XlaNode*>(node);
+  if (xla_node != nullptr && xla_node->GetSharding() != nullptr) {
+    return xla_node->GetSharding();
+  }
+  const DeviceData* device_data = DeviceData::Cast(node);
+  if (device_data != nullptr) {
+    const ShardedData* sharded = dynamic_cast<const ShardedData*>(
+        UnwrapXlaData(device_data->data()).get());
+    if (sharded != nullptr) {
+      return &sharded->sharding();
+    }
+  }
+  return nullptr;
+}
+
+const xla::OpSharding* GetOperandSharding(
+    const torch::lazy::Output& output,
+    const ShardingUtil::ShardingMap& inferred) {
+  const xla::OpSharding* sharding = GetNodeSharding(output.node);
+  if (sharding != nullptr) {
+    return sharding;
+  }
+  auto it = inferred.find(output.node);
+  return it != inferred.end() ? &it->second : nullptr;
+}
+
+// Hashes the device layout of the sharding, ignoring the metadata, so that the
+// equivalent shardings get the same hash.
+torch::lazy::hash_t HashSharding(const xla::OpSharding& sharding) {
+  torch::lazy::hash_t hash =
+      torch::lazy::MHash(static_cast<int64_t>(sharding.type()),
+                         sharding.replicate_on_last_tile_dim());
+  if (sharding.type() == xla::OpSharding::TUPLE) {
+    for (auto& element : sharding.tuple_shardings()) {
+      hash = torch::lazy::HashCombine(hash, HashSharding(element));
+    }
+  } else if (sharding.type() != xla::OpSharding::REPLICATED) {
+    std::vector<int64_t> dimensions(
+        sharding.tile_assignment_dimensions().begin(),
+        sharding.tile_assignment_dimensions().end());
+    std::vector<int64_t> devices(sharding.tile_assignment_devices().begin(),
+                                 sharding.tile_assignment_devices().end());
+    std::vector<int64_t> last_tile_dims(sharding.last_tile_dims().begin(),
+                                        sharding.last_tile_dims().end());
+    hash = torch::lazy::MHash(hash, dimensions, devices, last_tile_dims);
+  }
+  return hash;
+}
+
+// The fingerprint of the per device program, which does not depend on the
+// unique ids the builders hand out.
+torch::lazy::hash_t HashProgram(const xla::HloModuleProto& hlo_proto,
+                                absl::Span<const std::string> devices) {
+  auto module_config = xla::HloModule::CreateModuleConfigFromProto(
+                           hlo_proto, xla::DebugOptions())
+                           .ValueOrDie();
+  auto module = xla::HloModule::CreateFromProto(hlo_proto, module_config)
+                    .ValueOrDie();
+  return torch::lazy::MHash(
+      module->ToString(xla::HloPrintOptions::Fingerprint()),
+      absl::StrJoin(devices, ","));
+}
+
+// Pads the slice of the global tensor held by a device to the shard shape.
+at::Tensor PadSlice(const at::Tensor& source,
+                    absl::Span<const TileSlice> slices) {
+  std::vector<int64_t> shard_sizes;
+  bool padded = false;
+  for (auto& slice : slices) {
+    shard_sizes.push_back(slice.size);
+    padded = padded || slice.length < slice.size;
+  }
+  if (!padded) {
+    // The views get uploaded without copies if they are contiguous, and get
+    // copied by the transfer populate functions otherwise, concurrently with
+    // the other shards.
+    return source;
+  }
+  at::Tensor shard = at::zeros(shard_sizes, source.options());
+  at::Tensor target = shard;
+  for (size_t dim = 0; dim < slices.size(); ++dim) {
+    target = target.narrow(dim, 0, slices[dim].length);
+  }
+  target.copy_(source);
+  return shard;
+}
+
+// The sharding of output of the [..., M, K] x [..., K, N] matmul, when the
+// contracting dimension is not sharded.
+absl::optional<xla::OpSharding> InferMatMulSharding(
+    const torch::lazy::Node* node, const ShardingUtil::ShardingMap& inferred) {
+  int64_t rank = GetOutputShape(torch::lazy::Output(node, 0)).rank();
+  const xla::OpSharding* lhs = GetOperandSharding(node->operand(0), inferred);
+  const xla::OpSharding* rhs = GetOperandSharding(node->operand(1), inferred);
+  std::vector<int64_t> lhs_counts =
+      lhs != nullptr ? GetTileCounts(*lhs) : std::vector<int64_t>();
+  if (lhs_counts.size() == static_cast<size_t>(rank) && rank >= 2 &&
+      lhs_counts.back() == 1) {
+    return *lhs;
+  }
+  std::vector<int64_t> rhs_counts =
+      rhs != nullptr ? GetTileCounts(*rhs) : std::vector<int64_t>();
+  if (rhs_counts.size() >= 2 &&
+      rhs_counts.size() <= static_cast<size_t>(rank) &&
+      rhs_counts[rhs_counts.size() - 2] == 1) {
+    // A lower rank rhs gets broadcast over the leading output dimensions.
+    std::vector<int64_t> counts(rank - rhs_counts.size(), 1);
+    counts.insert(counts.end(), rhs_counts.begin(), rhs_counts.end());
+    return Retile(*rhs, counts);
+  }
+  return absl::nullopt;
+}
+
+// The sharding of the output of the [N, C, spatial...] convolution, when
+// either the batch or the output features are sharded.
+absl::optional<xla::OpSharding> InferConvolutionSharding(
+    const torch::lazy::Node* node, const ShardingUtil::ShardingMap& inferred) {
+  const ConvolutionOverrideable* conv =
+      dynamic_cast<const ConvolutionOverrideable*>(node);
+  if (conv == nullptr || conv->transposed() || conv->groups() != 1) {
+    return absl::nullopt;
+  }
+  const xla::OpSharding* input =
+      GetOperandSharding(node->operand(0), inferred);
+  std::vector<int64_t> input_counts =
+      input != nullptr ? GetTileCounts(*input) : std::vector<int64_t>();
+  if (!input_counts.empty() &&
+      std::all_of(input_counts.begin() + 1, input_counts.end(),
+                  [](int64_t count) { return count == 1; })) {
+    return *input;
+  }
+  const xla::OpSharding* weight =
+      GetOperandSharding(node->operand(1), inferred);
+  std::vector<int64_t> weight_counts =
+      weight != nullptr ? GetTileCounts(*weight) : std::vector<int64_t>();
+  if (!weight_counts.empty() &&
+      std::all_of(weight_counts.begin() + 1, weight_counts.end(),
+                  [](int64_t count) { return count == 1; })) {
+    std::vector<int64_t> counts(weight_counts.size(), 1);
+    counts[1] = weight_counts[0];
+    return Retile(*weight, counts);
+  }
+  return absl::nullopt;
+}
+
+// The elementwise ops keep the sharding of the first operand with the shape of
+// the output.
+absl::optional<xla::OpSharding> InferElementwiseSharding(
+    const torch::lazy::Node* node, const ShardingUtil::ShardingMap& inferred) {
+  const xla::Shape& shape = GetOutputShape(torch::lazy::Output(node, 0));
+  for (auto& operand : node->operands()) {
+    const xla::OpSharding* sharding = GetOperandSharding(operand, inferred);
+    if (sharding != nullptr && !GetTileCounts(*sharding).empty() &&
+        xla::ShapeUtil::SameDimensions(GetOutputShape(operand), shape)) {
+      return *sharding;
+    }
+  }
+  return absl::nullopt;
+}
+
+int64_t BufferBytes(const xla::Shape& shape) {
+  int64_t bytes = 0;
+  xla::ShapeUtil::ForEachSubshape(
+      shape, [&](const xla::Shape& subshape, const xla::ShapeIndex&) {
+        if (subshape.IsArray()) {
+          bytes += xla::ShapeUtil::ByteSizeOf(subshape);
+        }
+      });
+  return bytes;
+}
+
+// Walks the entry computation in post order, with every buffer live from its
+// instruction to its last user. The tuples, their elements and the bitcasts
+// alias their operands, and the parameters are the arguments.
+SpmdMemoryPlan PlanMemory(const xla::HloModuleProto& hlo_proto) {
+  static const std::set<std::string>* collectives =
+      new std::set<std::string>({"all-gather", "all-reduce", "all-to-all",
+                                 "collective-permute", "reduce-scatter"});
+  auto module_config = ConsumeValue(xla::HloModule::CreateModuleConfigFromProto(
+      hlo_proto, xla::DebugOptions()));
+  std::unique_ptr<xla::HloModule> module =
+      ConsumeValue(xla::HloModule::CreateFromProto(hlo_proto, module_config));
+  xla::HloComputation* entry = module->entry_computation();
+  std::vector<xla::HloInstruction*> order = entry->MakeInstructionPostOrder();
+  auto is_alias = [](const xla::HloInstruction* instruction) {
+    return instruction->opcode() == xla::HloOpcode::kTuple ||
+           instruction->opcode() == xla::HloOpcode::kGetTupleElement ||
+           instruction->opcode() == xla::HloOpcode::kBitcast;
+  };
+
+  std::unordered_map<const xla::HloInstruction*, size_t> last_use;
+  for (size_t i = 0; i < order.size(); ++i) {
+    last_use[order[i]] = i;
+  }
+  last_use[entry->root_instruction()] = order.size();
+  // The users come after their operands, so the aliases extend the live
+  // ranges of their operands before these get visited.
+  for (size_t i = order.size(); i > 0; --i) {
+    xla::HloInstruction* instruction = order[i - 1];
+    for (auto* operand : instruction->operands()) {
+      size_t use = is_alias(instruction) ? last_use[instruction] : i - 1;
+      last_use[operand] = std::max(last_use[operand], use);
+    }
+  }
+
+  SpmdMemoryPlan plan;
+  std::map<size_t, int64_t> releases;
+  int64_t live_bytes = 0;
+  int64_t max_live_bytes = 0;
+  for (size_t i = 0; i < order.size(); ++i) {
+    xla::HloInstruction* instruction = order[i];
+    int64_t bytes = BufferBytes(instruction->shape());
+    if (collectives->count(xla::HloOpcodeString(instruction->opcode())) > 0) {
+      plan.collective_bytes[xla::HloOpcodeString(instruction->opcode())] +=
+          bytes;
+    }
+    if (instruction->opcode() == xla::HloOpcode::kParameter) {
+      plan.argument_bytes += bytes;
+    } else if (!is_alias(instruction)) {
+      live_bytes += bytes;
+      max_live_bytes = std::max(max_live_bytes, live_bytes);
+      releases[last_use[instruction]] += bytes;
+    }
+    live_bytes -= releases[i];
+  }
+  plan.output_bytes = BufferBytes(entry->root_instruction()->shape());
+  plan.peak_bytes = plan.argument_bytes + max_live_bytes;
+  plan.temp_bytes = std::max<int64_t>(
+      plan.peak_bytes - plan.argument_bytes - plan.output_bytes, 0);
+  return plan;
+}
+
+// The collectives of the manual sharding regions are built over the replica
+// ids, while the computation is partitioned with a single replica. They become
+// cross partition collectives over the same ids, which
+// ConvertPartitionsToReplicas() turns back into cross replica ones. Returns the
+// largest channel id they get, as the partitioner numbers its own collectives
+// after it.
+int64_t AssignCollectiveChannels(xla::HloModuleProto* hlo_proto) {
+  static const std::set<std::string>* global_id_collectives =
+      new std::set<std::string>({"all-gather", "all-reduce", "reduce-scatter"});
+  int64_t channel_id = 0;
+  for (auto& computation : hlo_proto->computations()) {
+    for (auto& instruction : computation.instructions()) {
+      channel_id = std::max<int64_t>(channel_id, instruction.channel_id());
+    }
+  }
+  for (auto& computation : *hlo_proto->mutable_computations()) {
+    for (auto& instruction : *computation.mutable_instructions()) {
+      if (instruction.channel_id() == 0 &&
+          (global_id_collectives->count(instruction.opcode()) > 0 ||
+           instruction.opcode() == "all-to-all" ||
+           instruction.opcode() == "collective-permute")) {
+        instruction.set_channel_id(++channel_id);
+        // Without groups, the cross partition mode covers all the partitions.
+        instruction.set_use_global_device_ids(
+            global_id_collectives->count(instruction.opcode()) > 0 &&
+            instruction.replica_groups_size() > 0);
+      }
+    }
+  }
+  return channel_id;
+}
+
+// Counts the collectives the partitioner inserted, the ones with a channel id
+// above the ones of the graph.
+void CountReshardingCollectives(const xla::HloModuleProto& hlo_proto,
+                                int64_t graph_channel_id) {
+  static const std::set<std::string>* collectives =
+      new std::set<std::string>({"all-gather", "all-reduce", "all-to-all",
+                                 "collective-permute", "reduce-scatter"});
+  std::map<std::string, int64_t> counts;
+  int64_t total = 0;
+  for (auto& computation : hlo_proto.computations()) {
+    for (auto& instruction : computation.instructions()) {
+      if (instruction.channel_id() > graph_channel_id &&
+          collectives->count(instruction.opcode()) > 0) {
+        counts[instruction.opcode()] += 1;
+        total += 1;
+      }
+    }
+  }
+  XLA_VALUE_METRIC("SpmdReshardingCollectives", total);
+  if (total > 0) {
+    TF_VLOG(1) << "The SPMD partitioner inserted " << total
+               << " collectives: "
+               << absl::StrJoin(counts, ", ", absl::PairFormatter("="));
+  }
+}
+
 }  // namespace
 
-void ShardingUtil::SetHloSharding(LoweringContext* lowering_ctx) {
+ShardedData::ShardedData(std::string device, xla::Shape shape,
+                         xla::OpSharding sharding)
+    : Data(std::move(device), std::move(shape)),
+      sharding_(std::move(sharding)) {}
+
+ShardedData::ShardedData(std::string device, xla::Shape shape,
+                         std::vector<xla::ComputationClient::DataPtr> shards,
+                         xla::OpSharding sharding)
+    : Data(std::move(device), std::move(shape)),
+      shards_(std::move(shards)),
+      sharding_(std::move(sharding)) {}
+
+ShardedData::OpaqueHandle ShardedData::GetOpaqueHandle() {
+  XLA_CHECK(!shards_.empty()) << "Sharded data has no shards";
+  return shards_.front()->GetOpaqueHandle();
+}
+
+void ShardedData::Assign(const Data& data) {
+  const ShardedData& sharded = dynamic_cast<const ShardedData&>(data);
+  shards_ = sharded.shards_;
+  sharding_ = sharded.sharding_;
+}
+
+bool ShardedData::HasValue() const {
+  if (shards_.empty()) {
+    return false;
+  }
+  for (auto& shard : shards_) {
+    if (!shard->HasValue()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ShardingUtil::SetHloSharding(LoweringContext* lowering_ctx,
+                                  const ShardingMap* inferred_shardings) {
   for (std::pair<torch::lazy::Output, xla::XlaOp> elem :
        lowering_ctx->GetEmittedOutputs()) {
     const torch::lazy::Node* node = elem.first.node;
     const XlaNode* xla_node = dynamic_cast<const XlaNode*>(node);
-    auto instruction = XlaBuilderFriend::GetInstruction(elem.second);
-    if (xla_node->GetSharding() != nullptr) {
-      //*instruction->mutable_sharding() = *xla_node->GetSharding();
-      {
-        // Annotate the full-shape input with the sharding.
-        xla::XlaScopedShardingAssignment assign_sharding(
-            lowering_ctx->builder(), *xla_node->GetSharding());
-        xla::CustomCall(lowering_ctx->builder(),
-                        /*call_target_name=*/"Sharding",
-                        xla_node->Lower(lowering_ctx), xla_node->xla_shape(),
-                        /*opaque=*/"");
+    const xla::OpSharding* sharding = xla_node->GetSharding();
+    if (sharding == nullptr && inferred_shardings != nullptr) {
+      auto it = inferred_shardings->find(node);
+      if (it != inferred_shardings->end()) {
+        sharding = &it->second;
       }
     }
+    if (sharding != nullptr) {
+      // Annotate the emitted instruction itself. Lowering the node once more
+      // would emit a copy of it while iterating the emitted outputs.
+      auto instruction = XlaBuilderFriend::GetInstruction(elem.second);
+      *instruction->mutable_sharding() = *sharding;
+    }
+  }
+}
+
+bool ShardingUtil::UseAutoSharding() {
+  static const bool use_auto_sharding =
+      xla::sys_util::GetEnvBool("XLA_SPMD_AUTO_SHARDING", false);
+  return use_auto_sharding;
+}
+
+torch::lazy::hash_t ShardingUtil::GetShardingHash(
+    absl::Span<const torch::lazy::Node* const> post_order) {
+  torch::lazy::hash_t hash = torch::lazy::MHash(
+      static_cast<int64_t>(GetSpmdDevices().size()), UseAutoSharding());
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    const xla::OpSharding* sharding = GetNodeSharding(post_order[i]);
+    if (sharding != nullptr) {
+      hash = torch::lazy::HashCombine(
+          hash, torch::lazy::MHash(static_cast<int64_t>(i)));
+      hash = torch::lazy::HashCombine(hash, HashSharding(*sharding));
+    }
+  }
+  return hash;
+}
+
+ShardingUtil::ComputationPtr ShardingUtil::GetCachedProgram(
+    const torch::lazy::hash_t& program_hash) {
+  std::lock_guard<std::mutex> lock(*GetProgramCacheLock());
+  auto it = GetProgramCache()->find(program_hash);
+  if (it == GetProgramCache()->end()) {
+    return nullptr;
   }
+  ComputationPtr computation = it->second.lock();
+  if (computation == nullptr) {
+    GetProgramCache()->erase(it);
+  }
+  return computation;
+}
+
+void ShardingUtil::CacheProgram(const torch::lazy::hash_t& program_hash,
+                                ComputationPtr computation) {
+  std::lock_guard<std::mutex> lock(*GetProgramCacheLock());
+  (*GetProgramCache())[program_hash] = computation;
+}
+
+std::mutex* ShardingUtil::GetProgramCacheLock() {
+  static std::mutex* lock = new std::mutex();
+  return lock;
+}
+
+ShardingUtil::ProgramCache* ShardingUtil::GetProgramCache() {
+  static ProgramCache* cache = new ProgramCache();
+  return cache;
+}
+
+ShardingUtil::ShardingMap ShardingUtil::PropagateShardings(
+    absl::Span<const torch::lazy::Node* const> post_order) {
+  ShardingMap inferred;
+  for (auto node : post_order) {
+    const XlaNode* xla_node = dynamic_cast<const XlaNode*>(node);
+    if (xla_node == nullptr || xla_node->GetSharding() != nullptr ||
+        node->num_outputs() != 1 || node->operands().empty()) {
+      continue;
+    }
+    absl::optional<xla::OpSharding> sharding;
+    if (node->op() == torch::lazy::OpKind(at::aten::mm) ||
+        node->op() == torch::lazy::OpKind(at::aten::addmm) ||
+        node->op() == torch::lazy::OpKind(at::aten::matmul)) {
+      sharding = InferMatMulSharding(node, inferred);
+    } else if (node->op() ==
+               torch::lazy::OpKind(at::aten::convolution_overrideable)) {
+      sharding = InferConvolutionSharding(node, inferred);
+    } else if (IsElementwise(node)) {
+      sharding = InferElementwiseSharding(node, inferred);
+    }
+    if (sharding) {
+      inferred.emplace(node, std::move(*sharding));
+    }
+  }
+  XLA_VALUE_METRIC("SpmdInferredShardings", inferred.size());
+  return inferred;
 }
 
 // This is called separately before xrt compilation. This is also useful
 // for debugging partitioned HLO computation and sharding propation.
 xla::HloModuleProto ShardingUtil::SpmdPartitioningPass(
-    const xla::HloModuleProto& hlo_proto, bool conv_halo_exchange_always_on_lhs,
+    const xla::HloModuleProto& hlo_proto, int64_t num_replicas,
+    int64_t num_partitions, bool conv_halo_exchange_always_on_lhs,
     bool choose_faster_windowed_einsum_over_mem, bool unroll_windowed_einsum,
     bool bidirectional_windowed_einsum) {
-  // TODO(yeounoh) read available devices
-  int64_t num_replicas = 1;
-  int64_t num_partitions = 8;
-
   // TODO(yeounoh) propagate this down to the PJRT client
   auto execution_options = xla::CreateDefaultExecutionOptions();
   execution_options.set_use_spmd_partitioning(true);
@@ -87,4 +686,375 @@ xla::HloModuleProto ShardingUtil::SpmdPartitioningPass(
   return module.get()->ToProto();
 }
 
+bool ShardingUtil::UseSpmd() {
+  static const bool use_spmd =
+      xla::sys_util::GetEnvBool("XLA_USE_SPMD", false);
+  return use_spmd;
+}
+
+const std::vector<std::string>& ShardingUtil::GetSpmdDevices() {
+  static const std::vector<std::string>* spmd_devices = []() {
+    xla::ComputationClient* client = xla::ComputationClient::Get();
+    torch::lazy::BackendDevice default_device =
+        ParseDeviceString(client->GetDefaultDevice());
+    auto devices = new std::vector<std::string>();
+    for (auto& device : client->GetLocalDevices()) {
+      if (ParseDeviceString(device).type() == default_device.type()) {
+        devices->push_back(device);
+      }
+    }
+    TF_VLOG(1) << "SPMD devices: " << absl::StrJoin(*devices, ", ");
+    return devices;
+  }();
+  return *spmd_devices;
+}
+
+xla::XlaComputation ShardingUtil::PartitionComputation(
+    const xla::XlaComputation& computation,
+    absl::Span<const xla::ComputationClient::DataPtr> parameters_data,
+    SpmdComputationInfo* info) {
+  const std::vector<std::string>& devices = GetSpmdDevices();
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  XLA_CHECK(program_shape.result().IsTuple()) << program_shape.result();
+  std::vector<xla::OpSharding> parameter_shardings;
+  for (auto& data : parameters_data) {
+    const ShardedData* sharded = dynamic_cast<const ShardedData*>(data.get());
+    parameter_shardings.push_back(
+        sharded != nullptr ? sharded->sharding()
+                           : xla::HloSharding::Replicate().ToProto());
+  }
+  xla::HloModuleProto hlo_proto = computation.proto();
+  // The parameters are sharded like their data, whatever the sharding
+  // propagation would pick.
+  SetParameterShardings(&hlo_proto, parameter_shardings);
+  int64_t graph_channel_id = AssignCollectiveChannels(&hlo_proto);
+  xla::HloModuleProto partitioned_proto =
+      SpmdPartitioningPass(hlo_proto, /*num_replicas=*/1,
+                           /*num_partitions=*/devices.size());
+
+  XlaDeviceType device_type =
+      static_cast<XlaDeviceType>(ParseDeviceString(devices.front()).type());
+  info->devices = devices;
+  info->output_shapes.clear();
+  for (auto& shape : program_shape.result().tuple_shapes()) {
+    info->output_shapes.push_back(
+        MakeShapeWithDeviceLayout(shape, device_type));
+  }
+  info->output_shardings =
+      GetOutputShardings(partitioned_proto, info->output_shapes.size());
+  CountReshardingCollectives(partitioned_proto, graph_channel_id);
+  ConvertPartitionsToReplicas(&partitioned_proto);
+  info->program_hash = HashProgram(partitioned_proto, devices);
+  XLA_COUNTER("SpmdPartitionedComputation", 1);
+  return xla::XlaComputation(std::move(partitioned_proto));
+}
+
+SpmdMemoryPlan ShardingUtil::PlanSpmdMemory(
+    absl::Span<const torch::lazy::Value> values,
+    const torch::lazy::BackendDevice& device, int64_t num_devices) {
+  LoweringContext lowering_ctx("SpmdMemoryPlan", device);
+  for (auto& value : values) {
+    lowering_ctx.AddResult(torch::lazy::Output(value.node.get(), value.index));
+  }
+  SetHloSharding(&lowering_ctx);
+  xla::XlaComputation computation = ConsumeValue(lowering_ctx.BuildXla());
+  std::vector<xla::ComputationClient::DataPtr> parameters_data =
+      UnwrapXlaData(lowering_ctx.GetParametersData());
+
+  xla::HloModuleProto hlo_proto = computation.proto();
+  // Unlike in PartitionComputation(), the data need not be sharded yet, and
+  // the parameters keep the shardings of their IR nodes.
+  for (auto& instruction :
+       *GetEntryComputation(&hlo_proto)->mutable_instructions()) {
+    if (instruction.opcode() != "parameter") {
+      continue;
+    }
+    XLA_CHECK_LT(instruction.parameter_number(), parameters_data.size());
+    const ShardedData* sharded = dynamic_cast<const ShardedData*>(
+        parameters_data[instruction.parameter_number()].get());
+    if (sharded != nullptr) {
+      *instruction.mutable_sharding() = sharded->sharding();
+    } else if (!instruction.has_sharding()) {
+      *instruction.mutable_sharding() =
+          xla::HloSharding::Replicate().ToProto();
+    }
+  }
+  AssignCollectiveChannels(&hlo_proto);
+  xla::HloModuleProto partitioned_proto =
+      SpmdPartitioningPass(hlo_proto, /*num_replicas=*/1,
+                           /*num_partitions=*/num_devices);
+  XLA_COUNTER("SpmdMemoryPlan", 1);
+  return PlanMemory(partitioned_proto);
+}
+
+std::vector<xla::ComputationClient::DataPtr> ShardingUtil::ExecuteSpmd(
+    const xla::ComputationClient::Computation& computation,
+    absl::Span<const xla::ComputationClient::DataPtr> parameters_data,
+    const SpmdComputationInfo& info) {
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> arguments(
+      info.devices.size());
+  for (auto& data : parameters_data) {
+    std::vector<xla::ComputationClient::DataPtr> shards =
+        GetShards(data, info.devices);
+    for (size_t i = 0; i < shards.size(); ++i) {
+      arguments[i].push_back(std::move(shards[i]));
+    }
+  }
+  xla::ComputationClient::ExecuteReplicatedOptions options;
+  std::vector<std::vector<xla::ComputationClient::DataPtr>> results =
+      xla::ComputationClient::Get()->ExecuteReplicated(
+          computation, arguments, info.devices, options);
+  std::vector<xla::ComputationClient::DataPtr> outputs;
+  for (size_t i = 0; i < info.output_shapes.size(); ++i) {
+    std::vector<xla::ComputationClient::DataPtr> shards;
+    for (auto& device_results : results) {
+      XLA_CHECK_EQ(device_results.size(), info.output_shapes.size());
+      shards.push_back(device_results[i]);
+    }
+    outputs.push_back(std::make_shared<ShardedData>(
+        info.devices.front(), info.output_shapes[i], std::move(shards),
+        info.output_shardings[i]));
+  }
+  return outputs;
+}
+
+xla::ComputationClient::DataPtr ShardingUtil::CreateDataPlaceholder(
+    const std::string& device, xla::Shape shape,
+    const xla::OpSharding* sharding) {
+  if (UseSpmd()) {
+    return std::make_shared<ShardedData>(
+        device, std::move(shape),
+        sharding != nullptr ? *sharding
+                            : xla::HloSharding::Replicate().ToProto());
+  }
+  return xla::ComputationClient::Get()->CreateDataPlaceholder(device,
+                                                              std::move(shape));
+}
+
+xla::ComputationClient::DataPtr ShardingUtil::CreateShardedData(
+    const at::Tensor& tensor, const xla::Shape& shape,
+    const xla::OpSharding& sharding, const std::string& device) {
+  const std::vector<std::string>& devices = GetSpmdDevices();
+  std::vector<at::Tensor> shards =
+      ShardTensor(tensor, sharding, devices.size());
+  return std::make_shared<ShardedData>(
+      device, shape, UnwrapXlaData(CreateTensorsData(shards, devices)),
+      sharding);
+}
+
+xla::ComputationClient::DataPtr ShardingUtil::ReshardData(
+    const xla::ComputationClient::DataPtr& data,
+    const xla::OpSharding& sharding) {
+  at::ScalarType element_type =
+      TensorTypeFromXlaType(data->shape().element_type());
+  const ShardedData* sharded = dynamic_cast<const ShardedData*>(data.get());
+  at::Tensor tensor;
+  if (sharded != nullptr) {
+    tensor = ShardedDataToTensor(*sharded, element_type);
+  } else {
+    std::vector<xla::Literal> literals =
+        xla::ComputationClient::Get()->TransferFromServer({data});
+    tensor = MakeTensorFromXlaLiteral(literals.front(), element_type);
+  }
+  return CreateShardedData(tensor, data->shape(), sharding, data->device());
+}
+
+at::Tensor ShardingUtil::ShardedDataToTensor(const ShardedData& data,
+                                             at::ScalarType element_type) {
+  xla::HloSharding hlo_sharding = GetHloSharding(data.sharding());
+  std::vector<xla::ComputationClient::DataPtr> shards = data.shards();
+  if (hlo_sharding.IsReplicated()) {
+    shards.resize(1);
+  }
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::Get()->TransferFromServer(shards);
+  std::vector<at::Tensor> tensors;
+  for (auto& literal : literals) {
+    tensors.push_back(MakeTensorFromXlaLiteral(literal, element_type));
+  }
+  absl::Span<const int64_t> dimensions = data.shape().dimensions();
+  std::vector<int64_t> sizes(dimensions.begin(), dimensions.end());
+  return UnshardTensor(tensors, data.sharding(), sizes);
+}
+
+std::vector<at::Tensor> ShardingUtil::ShardTensor(
+    const at::Tensor& tensor, const xla::OpSharding& sharding,
+    size_t num_devices) {
+  xla::HloSharding hlo_sharding = GetHloSharding(sharding);
+  if (hlo_sharding.IsReplicated()) {
+    return std::vector<at::Tensor>(num_devices, tensor);
+  }
+  std::vector<at::Tensor> shards;
+  for (size_t device = 0; device < num_devices; ++device) {
+    std::vector<TileSlice> slices =
+        GetTileSlices(hlo_sharding, device,
+                      XlaHelpers::I64List(tensor.sizes()));
+    at::Tensor source = tensor;
+    for (size_t dim = 0; dim < slices.size(); ++dim) {
+      source = source.narrow(dim, slices[dim].start, slices[dim].length);
+    }
+    shards.push_back(PadSlice(source, slices));
+  }
+  return shards;
+}
+
+xla::Shape ShardingUtil::GetShardShape(const xla::Shape& shape,
+                                       const xla::OpSharding& sharding) {
+  xla::HloSharding hlo_sharding = GetHloSharding(sharding);
+  if (hlo_sharding.IsReplicated()) {
+    return shape;
+  }
+  std::vector<TileSlice> slices =
+      GetTileSlices(hlo_sharding, /*device=*/0, shape.dimensions());
+  xla::Shape shard_shape = shape;
+  for (size_t dim = 0; dim < slices.size(); ++dim) {
+    shard_shape.set_dimensions(dim, slices[dim].size);
+  }
+  return shard_shape;
+}
+
+xla::XlaOp ShardingUtil::BuildFullToShardShape(
+    xla::XlaOp input, const xla::OpSharding& sharding) {
+  xla::XlaBuilder* builder = input.builder();
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(input);
+  xla::XlaOp annotated;
+  {
+    xla::XlaScopedShardingAssignment assign_sharding(builder, sharding);
+    annotated = xla::CustomCall(builder, "Sharding", {input}, shape);
+  }
+  xla::XlaScopedShardingAssignment assign_sharding(
+      builder, xla::HloSharding::Manual().ToProto());
+  return xla::CustomCall(builder, "SPMDFullToShardShape", {annotated},
+                         GetShardShape(shape, sharding));
+}
+
+xla::XlaOp ShardingUtil::BuildShardToFullShape(
+    xla::XlaOp input, const xla::OpSharding& sharding,
+    const xla::Shape& full_shape) {
+  xla::XlaBuilder* builder = input.builder();
+  xla::XlaOp annotated;
+  {
+    xla::XlaScopedShardingAssignment assign_sharding(
+        builder, xla::HloSharding::Manual().ToProto());
+    annotated = xla::CustomCall(builder, "Sharding", {input},
+                                XlaHelpers::ShapeOfXlaOp(input));
+  }
+  xla::XlaScopedShardingAssignment assign_sharding(builder, sharding);
+  return xla::CustomCall(builder, "SPMDShardToFullShape", {annotated},
+                         full_shape);
+}
+
+std::vector<at::Tensor> ShardingUtil::GetDataSlices(
+    const ShardedData& data, at::ScalarType element_type,
+    std::vector<std::vector<int64_t>>* offsets) {
+  xla::HloSharding hlo_sharding = GetHloSharding(data.sharding());
+  absl::Span<const int64_t> sizes = data.shape().dimensions();
+  std::vector<xla::ComputationClient::DataPtr> shards;
+  std::vector<std::vector<TileSlice>> shard_slices;
+  if (hlo_sharding.IsReplicated()) {
+    shards.push_back(data.shards().front());
+    shard_slices.emplace_back(sizes.size());
+    for (size_t dim = 0; dim < sizes.size(); ++dim) {
+      shard_slices.back()[dim].length = sizes[dim];
+    }
+  } else {
+    // The devices holding the same slice, like with the partially replicated
+    // shardings, fetch it only once.
+    std::set<std::vector<int64_t>> fetched;
+    for (size_t device = 0; device < data.shards().size(); ++device) {
+      std::vector<TileSlice> slices =
+          GetTileSlices(hlo_sharding, device, sizes);
+      std::vector<int64_t> offset;
+      for (auto& slice : slices) {
+        offset.push_back(slice.start);
+      }
+      if (fetched.insert(std::move(offset)).second) {
+        shards.push_back(data.shards()[device]);
+        shard_slices.push_back(std::move(slices));
+      }
+    }
+  }
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::Get()->TransferFromServer(shards);
+  std::vector<at::Tensor> tensors;
+  offsets->clear();
+  for (size_t i = 0; i < literals.size(); ++i) {
+    at::Tensor tensor = MakeTensorFromXlaLiteral(literals[i], element_type);
+    std::vector<int64_t> offset;
+    for (size_t dim = 0; dim < shard_slices[i].size(); ++dim) {
+      tensor = tensor.narrow(dim, 0, shard_slices[i][dim].length);
+      offset.push_back(shard_slices[i][dim].start);
+    }
+    tensors.push_back(std::move(tensor));
+    offsets->push_back(std::move(offset));
+  }
+  return tensors;
+}
+
+xla::ComputationClient::DataPtr ShardingUtil::CreateShardedDataFromSlices(
+    absl::Span<const at::Tensor> slices,
+    absl::Span<const std::vector<int64_t>> offsets, const xla::Shape& shape,
+    const xla::OpSharding& sharding, const std::string& device) {
+  XLA_CHECK_EQ(slices.size(), offsets.size());
+  xla::HloSharding hlo_sharding = GetHloSharding(sharding);
+  const std::vector<std::string>& devices = GetSpmdDevices();
+  std::map<std::vector<int64_t>, size_t> slice_indices;
+  for (size_t i = 0; i < offsets.size(); ++i) {
+    slice_indices.emplace(offsets[i], i);
+  }
+  std::vector<at::Tensor> shards;
+  for (size_t i = 0; i < devices.size(); ++i) {
+    if (hlo_sharding.IsReplicated()) {
+      XLA_CHECK_EQ(slices.size(), 1);
+      shards.push_back(slices.front());
+      continue;
+    }
+    std::vector<TileSlice> tile_slices =
+        GetTileSlices(hlo_sharding, i, shape.dimensions());
+    std::vector<int64_t> offset;
+    for (auto& tile_slice : tile_slices) {
+      offset.push_back(tile_slice.start);
+    }
+    auto it = slice_indices.find(offset);
+    XLA_CHECK(it != slice_indices.end())
+        << "No slice at offset (" << absl::StrJoin(offset, ", ")
+        << ") for device " << devices[i];
+    const at::Tensor& slice = slices[it->second];
+    for (size_t dim = 0; dim < tile_slices.size(); ++dim) {
+      XLA_CHECK_EQ(slice.size(dim), tile_slices[dim].length)
+          << "Slice " << it->second << " does not match "
+          << hlo_sharding.ToString() << " at dimension " << dim;
+    }
+    shards.push_back(PadSlice(slice, tile_slices));
+  }
+  XLA_COUNTER("ShardedDataFromSlices", 1);
+  return std::make_shared<ShardedData>(
+      device, shape, UnwrapXlaData(CreateTensorsData(shards, devices)),
+      sharding);
+}
+
+at::Tensor ShardingUtil::UnshardTensor(absl::Span<const at::Tensor> shards,
+                                       const xla::OpSharding& sharding,
+                                       at::IntArrayRef sizes) {
+  XLA_CHECK(!shards.empty());
+  xla::HloSharding hlo_sharding = GetHloSharding(sharding);
+  if (hlo_sharding.IsReplicated()) {
+    return shards.front();
+  }
+  at::Tensor tensor = at::empty(sizes, shards.front().options());
+  for (size_t device = 0; device < shards.size(); ++device) {
+    std::vector<TileSlice> slices =
+        GetTileSlices(hlo_sharding, device,
+                      XlaHelpers::I64List(tensor.sizes()));
+    at::Tensor source = shards[device];
+    at::Tensor target = tensor;
+    for (size_t dim = 0; dim < slices.size(); ++dim) {
+      source = source.narrow(dim, 0, slices[dim].length);
+      target = target.narrow(dim, slices[dim].start, slices[dim].length);
+    }
+    target.copy_(source);
+  }
+  return tensor;
+}
+
 }  // namespace torch_xla
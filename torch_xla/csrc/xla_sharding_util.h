@@ -1,26 +1,229 @@
 #pragma once
 
+#include <ATen/Tensor.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/types/span.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/client/xla_computation.h"
 #include "tensorflow/compiler/xla/service/hlo.pb.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "torch/csrc/lazy/core/hash.h"
 #include "torch_xla/csrc/ir.h"
 #include "torch_xla/csrc/lowering_context.h"
 
 namespace torch_xla {
 
+// The device data of a tensor placed over the SPMD devices. The shape is the
+// global one, as seen by the graphs, while every shard holds the (padded)
+// slice of the device with the same index within the SPMD devices.
+class ShardedData : public xla::ComputationClient::Data {
+ public:
+  // Creates a placeholder, which gets the shards with Assign(). The sharding
+  // is the one the producing computation gives to the shards.
+  ShardedData(std::string device, xla::Shape shape, xla::OpSharding sharding);
+
+  ShardedData(std::string device, xla::Shape shape,
+              std::vector<xla::ComputationClient::DataPtr> shards,
+              xla::OpSharding sharding);
+
+  OpaqueHandle GetOpaqueHandle() override;
+
+  void Assign(const Data& data) override;
+
+  bool HasValue() const override;
+
+  const std::vector<xla::ComputationClient::DataPtr>& shards() const {
+    return shards_;
+  }
+
+  const xla::OpSharding& sharding() const { return sharding_; }
+
+ private:
+  std::vector<xla::ComputationClient::DataPtr> shards_;
+  xla::OpSharding sharding_;
+};
+
+// What is needed to run an SPMD partitioned computation and to assemble the
+// per device results into sharded data.
+struct SpmdComputationInfo {
+  std::vector<std::string> devices;
+  // The global shapes and the shardings of the outputs.
+  std::vector<xla::Shape> output_shapes;
+  std::vector<xla::OpSharding> output_shardings;
+  // The fingerprint of the per device program, shared by the graphs which
+  // partition into the same one.
+  torch::lazy::hash_t program_hash;
+};
+
+// The per device memory of an SPMD partitioned computation, planned from the
+// live ranges of the buffers of the partitioned HLO. The backend fuses the
+// elementwise ops, so the temporary memory is an upper bound of the one of the
+// compiled program.
+struct SpmdMemoryPlan {
+  int64_t argument_bytes = 0;
+  int64_t output_bytes = 0;
+  int64_t temp_bytes = 0;
+  int64_t peak_bytes = 0;
+  // The bytes of the results of the collectives, by opcode.
+  std::map<std::string, int64_t> collective_bytes;
+};
+
 class ShardingUtil {
  public:
+  using ComputationPtr = std::shared_ptr<xla::ComputationClient::Computation>;
+  using ShardingMap =
+      std::unordered_map<const torch::lazy::Node*, xla::OpSharding>;
+
   // Annotate HLO instructions in the lowered compuation by the embedded XLA
   // builder. For this call to be effective, this needs to be called after the
   // lowering and before building the computation; otherwise, this is a no-op.
-  static void SetHloSharding(LoweringContext* lowering_ctx);
+  // The inferred shardings, if any, apply to the nodes without an explicit
+  // one.
+  static void SetHloSharding(LoweringContext* lowering_ctx,
+                             const ShardingMap* inferred_shardings = nullptr);
+
+  // Whether the shardings of the unannotated nodes get inferred at the IR
+  // level, with XLA_SPMD_AUTO_SHARDING.
+  static bool UseAutoSharding();
+
+  // Infers in post order the shardings of the matmul, convolution and
+  // elementwise nodes from the ones of their operands, starting from the
+  // annotated nodes and the sharded device data. The nodes whose operand
+  // shardings do not map to a sharding of the output without collectives
+  // are left to the XLA sharding propagation.
+  static ShardingMap PropagateShardings(
+      absl::Span<const torch::lazy::Node* const> post_order);
+
+  // The hash of the SPMD device count and of the shardings of the nodes and
+  // of their device data, to be combined with the graph hash, which does not
+  // cover them.
+  static torch::lazy::hash_t GetShardingHash(
+      absl::Span<const torch::lazy::Node* const> post_order);
+
+  // Returns the compiled computation of the per device program, if one is
+  // still held by the compilation cache, or nullptr otherwise.
+  static ComputationPtr GetCachedProgram(
+      const torch::lazy::hash_t& program_hash);
+
+  static void CacheProgram(const torch::lazy::hash_t& program_hash,
+                           ComputationPtr computation);
 
   static xla::HloModuleProto SpmdPartitioningPass(
-      const xla::HloModuleProto& hlo_proto,
-      bool conv_halo_exchange_always_on_lhs = true,
+      const xla::HloModuleProto& hlo_proto, int64_t num_replicas,
+      int64_t num_partitions, bool conv_halo_exchange_always_on_lhs = true,
       bool choose_faster_windowed_einsum_over_mem = false,
       bool unroll_windowed_einsum = false,
       bool bidirectional_windowed_einsum = false);
+
+  // Whether the graphs get partitioned over all the local devices of the
+  // default device type, with XLA_USE_SPMD.
+  static bool UseSpmd();
+
+  // The devices the partitions of the SPMD computations run on.
+  static const std::vector<std::string>& GetSpmdDevices();
+
+  // Partitions the computation over the SPMD devices, with the parameters
+  // sharded like their data, and rewrites it so that the partitions run as
+  // the replicas of a replicated computation.
+  static xla::XlaComputation PartitionComputation(
+      const xla::XlaComputation& computation,
+      absl::Span<const xla::ComputationClient::DataPtr> parameters_data,
+      SpmdComputationInfo* info);
+
+  // Lowers the graph of the values and partitions it over num_devices, with
+  // the parameters sharded like their data, and plans the memory of the per
+  // device program, without compiling nor running it.
+  static SpmdMemoryPlan PlanSpmdMemory(
+      absl::Span<const torch::lazy::Value> values,
+      const torch::lazy::BackendDevice& device, int64_t num_devices);
+
+  // Runs the partitioned computation over the SPMD devices, and returns the
+  // sharded data of its outputs.
+  static std::vector<xla::ComputationClient::DataPtr> ExecuteSpmd(
+      const xla::ComputationClient::Computation& computation,
+      absl::Span<const xla::ComputationClient::DataPtr> parameters_data,
+      const SpmdComputationInfo& info);
+
+  // Returns an empty ShardedData in SPMD mode, with the given sharding or a
+  // replicated one, a backend placeholder otherwise.
+  static xla::ComputationClient::DataPtr CreateDataPlaceholder(
+      const std::string& device, xla::Shape shape,
+      const xla::OpSharding* sharding = nullptr);
+
+  // Uploads the shards of the tensor to the SPMD devices.
+  static xla::ComputationClient::DataPtr CreateShardedData(
+      const at::Tensor& tensor, const xla::Shape& shape,
+      const xla::OpSharding& sharding, const std::string& device);
+
+  // Moves the data of a tensor to the new sharding.
+  static xla::ComputationClient::DataPtr ReshardData(
+      const xla::ComputationClient::DataPtr& data,
+      const xla::OpSharding& sharding);
+
+  // Fetches and assembles the shards into the global tensor.
+  static at::Tensor ShardedDataToTensor(const ShardedData& data,
+                                        at::ScalarType element_type);
+
+  // Splits the tensor into one shard per device, padded to the shard shape
+  // of the SPMD partitioner.
+  static std::vector<at::Tensor> ShardTensor(const at::Tensor& tensor,
+                                             const xla::OpSharding& sharding,
+                                             size_t num_devices);
+
+  // The shape of the per device shards of a tensor of the given shape, padded
+  // like the SPMD partitioner does.
+  static xla::Shape GetShardShape(const xla::Shape& shape,
+                                  const xla::OpSharding& sharding);
+
+  // Lowers the entry into a manual sharding region, with the SPMD custom calls
+  // turning the input sharded like the given sharding into its per device
+  // shard.
+  static xla::XlaOp BuildFullToShardShape(xla::XlaOp input,
+                                          const xla::OpSharding& sharding);
+
+  // Lowers the exit from a manual sharding region, which assembles the per
+  // device shards into the global tensor of the given shape.
+  static xla::XlaOp BuildShardToFullShape(xla::XlaOp input,
+                                          const xla::OpSharding& sharding,
+                                          const xla::Shape& full_shape);
+
+  // Fetches the shards of the data from the devices in parallel, and returns
+  // the distinct slices of the global tensor they hold, without the padding,
+  // together with their offsets within the global tensor.
+  static std::vector<at::Tensor> GetDataSlices(
+      const ShardedData& data, at::ScalarType element_type,
+      std::vector<std::vector<int64_t>>* offsets);
+
+  // The reverse of GetDataSlices(), which uploads to every SPMD device the
+  // slice at the offset of its shard.
+  static xla::ComputationClient::DataPtr CreateShardedDataFromSlices(
+      absl::Span<const at::Tensor> slices,
+      absl::Span<const std::vector<int64_t>> offsets, const xla::Shape& shape,
+      const xla::OpSharding& sharding, const std::string& device);
+
+  // The reverse of ShardTensor().
+  static at::Tensor UnshardTensor(absl::Span<const at::Tensor> shards,
+                                  const xla::OpSharding& sharding,
+                                  at::IntArrayRef sizes);
+
+ private:
+  // The compiled programs are held weakly, so that they go away with the
+  // graphs of the compilation cache which use them.
+  using ProgramCache =
+      std::unordered_map<torch::lazy::hash_t,
+                         std::weak_ptr<xla::ComputationClient::Computation>,
+                         torch::lazy::HashReducer>;
+
+  static std::mutex* GetProgramCacheLock();
+
+  static ProgramCache* GetProgramCache();
 };
 
 }  // namespace torch_xla
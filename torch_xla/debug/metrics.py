@@ -42,6 +42,236 @@ def metric_data(name):
   return torch_xla._XLAC._xla_metric_data(name)
 
 
+def metric_histogram(name):
+  """Returns the histogram of all the samples of an active metric.
+
+  Args:
+    name (string): The name of the metric whose histogram needs to be
+      retrieved.
+
+  Returns:
+    A tuple of (COUNT, SUM, MIN, MAX, BUCKETS), or None if the metric does not
+    exist. The `BUCKETS` is a list of (LOWER, UPPER, COUNT) tuples, sorted by
+    value, with the log-linear bucket bounds which are the same in all the
+    processes, so that the histograms of several processes merge by adding up
+    the counts of the buckets with the same bounds.
+  """
+  return torch_xla._XLAC._xla_metric_histogram(name)
+
+
 def metrics_report():
   """Retrieves a string containing the full metrics and counters report."""
   return torch_xla._XLAC._xla_metrics_report()
+
+
+def snapshot():
+  """Takes a snapshot of the counters and metrics, for :func:`diff`."""
+  return torch_xla._XLAC._xla_metrics_snapshot()
+
+
+def diff(before, after=None):
+  """Returns the changes of the counters and metrics between two snapshots.
+
+  Args:
+    before: The snapshot taken at the start of the region.
+    after (optional): The snapshot taken at the end of the region. Defaults to
+      a snapshot taken now.
+
+  Returns:
+    A dictionary with the `counters` which changed (by name, with the change of
+    their value), the `metrics` which got new samples (by name, with a tuple of
+    the number and the sum of the new samples), and the summary values:
+    `compiles`, `executions`, `transfers_to_server`, `transfers_from_server`,
+    `cpu_fallbacks`, `bytes_to_server` and `bytes_from_server`.
+  """
+  return torch_xla._XLAC._xla_metrics_diff(before, after or snapshot())
+
+
+def check_gates(before, after=None, limits=None, **kwargs):
+  """Checks the changes between two snapshots against their maximum values.
+
+  Args:
+    before: The snapshot taken at the start of the region.
+    after (optional): The snapshot taken at the end of the region. Defaults to
+      a snapshot taken now.
+    limits (dict, optional): The maximum values, by name, which is one of the
+      summary values of :func:`diff`, else the name of a counter (whose
+      change is checked) or of a metric (whose number of new samples is
+      checked). The keyword arguments are added to them.
+
+  Returns:
+    A list of messages, one for every value above its limit.
+  """
+  limits = dict(limits or {}, **kwargs)
+  return torch_xla._XLAC._xla_metrics_check_gates(before, after or snapshot(),
+                                                  limits)
+
+
+class MetricsRegressionError(AssertionError):
+  pass
+
+
+class MetricsGate(object):
+  """Raises when a region of code goes above the limits of its metrics.
+
+  Wrapped around the steps which should run off the compilation cache, it
+  catches the regressions (like a new compilation or CPU fallback per step)
+  the moment they happen::
+
+    for step, (data, target) in enumerate(loader):
+      with met.MetricsGate(compiles=0, cpu_fallbacks=0, enabled=step > 2):
+        train_step(data, target)
+        xm.mark_step()
+
+  Args:
+    limits (dict, optional): See :func:`check_gates`.
+    enabled (bool, optional): Whether the gate is checked.
+      Default: True
+  """
+
+  def __init__(self, limits=None, enabled=True, **kwargs):
+    self.limits = dict(limits or {}, **kwargs)
+    self.enabled = enabled
+    self.delta = None
+    self._before = None
+
+  def __enter__(self):
+    if self.enabled:
+      self._before = snapshot()
+    return self
+
+  def __exit__(self, exc_type, exc_value, traceback):
+    if not self.enabled or exc_type is not None:
+      return False
+    after = snapshot()
+    self.delta = diff(self._before, after)
+    violations = check_gates(self._before, after, self.limits)
+    if violations:
+      raise MetricsRegressionError('; '.join(violations))
+    return False
+
+
+def cpu_fallback_stats():
+  """Returns how many times the operators fell back to the CPU.
+
+  Returns:
+    A dictionary from the operator name and the types and shapes of its input
+    tensors (like `aten::nonzero(Float[3, 4])`) to the number of fallbacks.
+  """
+  return torch_xla._XLAC._xla_cpu_fallback_stats()
+
+
+def graph_profile():
+  """Returns the compile and execution statistics of every graph.
+
+  Only the `XLA_GRAPH_PROFILE_SIZE` most recently compiled or executed graphs
+  are kept.
+
+  Returns:
+    A list of dictionaries, sorted by decreasing total execution time, with the
+    `hash` of the graph (the `Graph Hash` of the `XLA_SAVE_TENSORS_FILE` dumps),
+    its `device`, the number of `compilations` and `executions`, their total
+    `compile_time_ns` and `execute_time_ns`, the per device `parameter_bytes`
+    and `output_bytes` of one execution, and the `sources`, which are the
+    Python source locations most of the IR nodes of the graph come from, with
+    their node counts, when traced with `XLA_IR_DEBUG=1`.
+  """
+  return torch_xla._XLAC._xla_graph_profile()
+
+
+def clear_graph_profile():
+  """Clears the statistics returned by :func:`graph_profile`."""
+  torch_xla._XLAC._xla_reset_graph_profile()
+
+
+def recompile_reports():
+  """Returns the explanations of the last recompilations.
+
+  Every time a graph gets compiled, it is compared with the most similar of
+  the recent graphs compiled for the same device, and the report tells the
+  first IR node at which they differ, how its operation, type or shape
+  changed, and the Python frames of the sync. Tracing with `XLA_IR_DEBUG=1`
+  adds the Python frames which created the node.
+
+  Returns:
+    A list of strings, with the most recent report last.
+  """
+  return torch_xla._XLAC._xla_recompile_reports()
+
+
+def graph_report(top=10):
+  """Retrieves a string listing the graphs which take the most execution time.
+
+  Args:
+    top (int, optional): The number of graphs to list.
+      Default: 10
+  """
+  lines = []
+  for graph in graph_profile()[:top]:
+    executions = graph['executions']
+    lines.append('Graph: {} ({})'.format(graph['hash'], graph['device']))
+    lines.append('  Executions: {}'.format(executions))
+    lines.append('  ExecuteTime: {:.3f}ms ({:.3f}ms / execution)'.format(
+        graph['execute_time_ns'] * 1e-6,
+        graph['execute_time_ns'] * 1e-6 / max(executions, 1)))
+    lines.append('  Compilations: {}'.format(graph['compilations']))
+    lines.append('  CompileTime: {:.3f}ms'.format(graph['compile_time_ns'] *
+                                                  1e-6))
+    lines.append('  ParameterBytes: {}'.format(graph['parameter_bytes']))
+    lines.append('  OutputBytes: {}'.format(graph['output_bytes']))
+    for source, count in graph['sources']:
+      lines.append('  Source: {} ({} nodes)'.format(source, count))
+  return '\n'.join(lines) + '\n' if lines else ''
+
+
+def performance_analysis():
+  """Runs the analyzers of the ``PT_XLA_DEBUG=1`` report over the metrics.
+
+  Returns:
+    A list of dictionaries, one per detected problem, with the `symptom` name
+    (like `host_bound`, `transfer_stall` or `barrier_wait`), the `message`
+    of the report, the `remediation` text, possibly empty, and the `values`
+    the diagnosis is based on, with the times in nanoseconds.
+  """
+  return torch_xla._XLAC._xla_performance_analysis()
+
+
+def dump_function_calls(path):
+  """Writes the function calls recorded by the binary function call tracker.
+
+  The tracker runs in binary mode with ``XLA_FNTRACKER_MODE=binary`` and
+  ``XLA_FNTRACKER_FILE`` set, and also writes its file at exit. The
+  ``scripts/decode_fn_tracker.py`` script decodes the files.
+
+  Args:
+    path (string): The path of the file to write.
+
+  Returns:
+    Whether the file got written, which it does not if the tracker is not
+    in binary mode.
+  """
+  return torch_xla._XLAC._xla_dump_fn_tracker(path)
+
+
+def step_breakdown():
+  """Returns where the host time of the recent steps went.
+
+  The steps are only broken down with ``XLA_STEP_BREAKDOWN=1``, otherwise the
+  list is empty.
+
+  Every ``xm.mark_step()`` closes a step, whose record splits its host time
+  into phases, with the time of the nested phases only counted by them. The
+  graph executions dispatch asynchronously, so the execution of the graphs
+  of a step usually lands within the next one.
+
+  Returns:
+    A list of dictionaries, from the oldest step to the newest, with the
+    `step` index, the `device`, the `wall_ns` time since the previous step,
+    and the `dispatch_ns` (within the ATen operations), `tracing_ns` (IR node
+    creation), `collect_sync_tensors_ns`, `hash_ns`, `compile_ns`,
+    `upload_ns`, `execute_ns`, `device_wait_ns` and `download_ns` times,
+    summed over the threads. A step dominated by the dispatch and tracing
+    times is host bound, while one dominated by the device wait time is
+    device bound.
+  """
+  return torch_xla._XLAC._xla_step_breakdown()
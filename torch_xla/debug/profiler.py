@@ -37,6 +37,36 @@ def start_server(port: int, only_on_master: bool = True) -> object:
     return torch_xla._XLAC.profiler.start_server(port)
 
 
+def start_metrics_server(port: int, labels: dict = None) -> object:
+  """Start an HTTP server exporting the metrics and counters of the process.
+
+  The server answers the ``/metrics`` requests in the Prometheus text format,
+  with every counter as an ``xla_counter_total`` sample and every metric as an
+  ``xla_metric`` summary of its percentiles, labeled by name. Since every
+  process has metrics of its own, every process needs a server of its own, for
+  example on ``port + xm.get_local_ordinal()``.
+
+  Args:
+    port (int): the port to start the metrics server on.
+    labels (dict, optional): the labels added to every sample.
+      Default: the ``device`` and ``ordinal`` of the process
+  Returns:
+    A `MetricsServer` instance that dictates the lifecycle of the metrics
+    server. If this object is garbage collected, the metrics server is shut
+    down.
+  Raises:
+    RuntimeError: Raised if the port is invalid or busy already.
+  """
+  if labels is None:
+    device = xm.xla_device()
+    labels = {
+        'device': xm.xla_real_devices([str(device)])[0],
+        'ordinal': xm.get_ordinal(),
+    }
+  labels = {str(k): str(v) for k, v in labels.items()}
+  return torch_xla._XLAC.profiler.start_metrics_server(port, labels)
+
+
 def trace(service_addr: str,
           logdir: str,
           duration_ms: int = 1000,
@@ -65,7 +95,8 @@ def trace(service_addr: str,
     num_tracing_attempts (int): number of trials to send profiling request
       in case of failures.
     host_tracer_level (int): CPU tracing level. Values are: 1 - critical info
-      only, 2 - info, 3 - verbose.
+      only, 2 - info, 3 - verbose, which adds the spans of the ATen dispatch,
+      IR tracing, lowering and tensor transfers (see XLA_HOST_TRACE_SAMPLING).
       device_tracer_level (int): Device (TPU/GPU) tracing level. Values are: 1 -
       enabled, 0 - disabled.
     delay_ms (int): Specifies the services to start profiling delay_ms
@@ -0,0 +1,165 @@
+from __future__ import print_function
+
+import torch
+import torch_xla
+import torch_xla.core.xla_model as xm
+
+
+class ScalarSummary(object):
+  """A device resident summary of the values of a tensor.
+
+  Every `update()` folds the elements of a tensor into a small state tensor
+  within the pending graph, so that no host sync is needed. The state holds the
+  count, sum, min, max, last mean and running average of the folded values.
+
+  Args:
+    device (torch.device, optional): The device of the state tensor. Defaults to
+      the current XLA device.
+    ema_decay (float, optional): The weight of the previous running average.
+      Default: 0.99
+  """
+
+  def __init__(self, device=None, ema_decay=0.99):
+    self.ema_decay = ema_decay
+    self.state = torch.zeros(
+        torch_xla._XLAC._xla_summary_scalar_state_size(),
+        dtype=torch.float32,
+        device=device or xm.xla_device())
+    self.reset()
+
+  def reset(self):
+    # The min and max start from the infinities.
+    self.state.copy_(
+        torch.tensor([0.0, 0.0, float('inf'), -float('inf'), 0.0, 0.0]))
+
+  def update(self, value):
+    torch_xla._XLAC._xla_summary_scalar_update_(self.state, value.detach(),
+                                                self.ema_decay)
+
+  @staticmethod
+  def decode(state):
+    count, total, vmin, vmax, last, ema = state.tolist()
+    return {
+        'count': count,
+        'mean': total / count if count else None,
+        'min': vmin if count else None,
+        'max': vmax if count else None,
+        'last': last if count else None,
+        'ema': ema if count else None,
+    }
+
+
+class HistogramSummary(object):
+  """A device resident histogram of the values of a tensor.
+
+  The `bins` bins evenly split `[min_value, max_value)`. The values out of the
+  range are counted in the first or last bin, while the NaN ones are dropped.
+
+  Args:
+    bins (int): The number of bins.
+    min_value (float): The lower bound of the first bin.
+    max_value (float): The upper bound of the last bin.
+    device (torch.device, optional): The device of the state tensor. Defaults to
+      the current XLA device.
+  """
+
+  def __init__(self, bins, min_value, max_value, device=None):
+    assert min_value < max_value
+    self.min_value = min_value
+    self.max_value = max_value
+    self.state = torch.zeros(
+        bins, dtype=torch.float32, device=device or xm.xla_device())
+
+  def reset(self):
+    self.state.zero_()
+
+  def update(self, value):
+    torch_xla._XLAC._xla_summary_histogram_update_(
+        self.state, value.detach(), self.min_value, self.max_value)
+
+  def decode(self, state):
+    bins = state.numel()
+    width = (self.max_value - self.min_value) / bins
+    return [(self.min_value + i * width, self.min_value + (i + 1) * width,
+             int(count)) for i, count in enumerate(state.tolist())]
+
+
+class SummaryWriter(object):
+  """Collects device resident summaries and fetches them every few steps.
+
+  The states of all the summaries are fetched with a single asynchronous
+  transfer every `fetch_steps` calls to `step()`, which must follow the
+  `xm.mark_step()` of the training step. The fetched values are handed to the
+  callback the next time `step()` (or `flush()`) finds the transfer complete, so
+  the training loop never waits for them.
+
+  Example::
+
+    writer = SummaryWriter(fetch_steps=100, callback=print)
+    loss_summary = writer.scalar('loss')
+    for data, target in loader:
+      loss = loss_fn(model(data), target)
+      loss_summary.update(loss)
+      ...
+      xm.mark_step()
+      writer.step()
+
+  Args:
+    fetch_steps (int): The number of steps between two fetches.
+    callback (callable): Called with the step number and a dictionary of the
+      decoded summaries, by name.
+    reset_on_fetch (bool, optional): Whether the summaries restart from an
+      empty state after every fetch. Default: True
+  """
+
+  def __init__(self, fetch_steps, callback, reset_on_fetch=True):
+    self.fetch_steps = fetch_steps
+    self.callback = callback
+    self.reset_on_fetch = reset_on_fetch
+    self._summaries = dict()
+    self._step = 0
+    self._pending = None
+
+  def scalar(self, name, **kwargs):
+    return self._add(name, ScalarSummary(**kwargs))
+
+  def histogram(self, name, bins, min_value, max_value, **kwargs):
+    return self._add(name,
+                     HistogramSummary(bins, min_value, max_value, **kwargs))
+
+  def _add(self, name, summary):
+    assert name not in self._summaries, name
+    self._summaries[name] = summary
+    return summary
+
+  def _dispatch(self, wait):
+    if self._pending is None:
+      return
+    step, names, fetch = self._pending
+    if not wait and not fetch.done():
+      return
+    self._pending = None
+    states = fetch.wait()
+    self.callback(
+        step, {
+            name: self._summaries[name].decode(state)
+            for name, state in zip(names, states)
+        })
+
+  def step(self):
+    self._step += 1
+    self._dispatch(wait=False)
+    if self._step % self.fetch_steps != 0 or not self._summaries:
+      return
+    # A fetch still in flight gets delivered before the next one is issued.
+    self._dispatch(wait=True)
+    names = list(self._summaries.keys())
+    fetch = torch_xla._XLAC._xla_get_cpu_tensors_async(
+        [self._summaries[name].state for name in names])
+    self._pending = (self._step, names, fetch)
+    if self.reset_on_fetch:
+      for summary in self._summaries.values():
+        summary.reset()
+
+  def flush(self):
+    self._dispatch(wait=True)
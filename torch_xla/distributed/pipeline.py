@@ -0,0 +1,125 @@
+import torch
+import torch_xla.core.xla_model as xm
+
+
+class _CollectivePermute(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, value, pairs):
+    ctx.pairs = pairs
+    return xm.collective_permute(value, pairs)
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    reverse_pairs = [[target, source] for source, target in ctx.pairs]
+    return xm.collective_permute(grad_output, reverse_pairs), None
+
+
+def _stage_pairs(world_size, num_stages, ring):
+  assert world_size % num_stages == 0, \
+    'World size {} is not a multiple of the number of stages {}'.format(
+        world_size, num_stages)
+  # The replicas of a pipeline are consecutive, and the world is split into
+  # world_size / num_stages data parallel pipelines.
+  pairs = []
+  for base in range(0, world_size, num_stages):
+    for stage in range(num_stages):
+      if stage + 1 < num_stages:
+        pairs.append([base + stage, base + stage + 1])
+      elif ring:
+        pairs.append([base + stage, base])
+  return pairs
+
+
+def _circular_schedule(num_microbatches, num_stages, num_chunks):
+  # The microbatches enter in rounds of num_stages, and a round enters when the
+  # first microbatch of the previous one has gone through all the stages and
+  # chunks, so that every replica works on at most one microbatch per step.
+  num_logical_stages = num_stages * num_chunks
+  injections = dict()
+  for m in range(num_microbatches):
+    injections[(m // num_stages) * num_logical_stages + m % num_stages] = m
+  num_steps = max(injections) + num_logical_stages
+  # chunks[t][s] is the chunk replica stage s runs at step t.
+  chunks = [[0] * num_stages for _ in range(num_steps)]
+  finishes = dict()
+  for start, m in injections.items():
+    for logical_stage in range(num_logical_stages):
+      chunks[start + logical_stage][logical_stage % num_stages] = (
+          logical_stage // num_stages)
+    finishes[start + num_logical_stages - 1] = m
+  return num_steps, injections, chunks, finishes
+
+
+class Pipeline(object):
+  """Runs the microbatches through a pipeline of homogeneous stages.
+
+  Every replica is one pipeline stage, running the same stage function with
+  its own parameters, as the replicas all run the same graph. The whole
+  schedule is unrolled into the step graph, with the activations moving
+  between the stages with collective permutes, whose gradients flow back with
+  the reverse permutes. XLA can then overlap the transfers of a microbatch
+  with the compute of the others, instead of serializing them at each stage
+  boundary as hand ordered sends and receives do.
+
+  With ``num_chunks`` greater than one the schedule is interleaved: each replica
+  holds ``num_chunks`` non consecutive chunks of the model, and the
+  microbatches go around the stages that many times, which shrinks the
+  pipeline bubble by the same factor.
+
+  Args:
+    num_stages (int): The number of replicas of one pipeline. The world size
+      must be a multiple of it, with every group of ``num_stages`` consecutive
+      replicas forming a data parallel copy of the pipeline.
+    num_chunks (int, optional): The number of model chunks per replica.
+      Default: 1
+    device (torch.device, optional): The device of the replica.
+      Default: the current XLA device
+  """
+
+  def __init__(self, num_stages, num_chunks=1, device=None):
+    self.num_stages = num_stages
+    self.num_chunks = num_chunks
+    self.device = device or xm.xla_device()
+    self.stage = xm.get_ordinal() % num_stages
+    self.pairs = _stage_pairs(xm.xrt_world_size(), num_stages, num_chunks > 1)
+    # The stage of the replica is device data rather than a graph constant, so
+    # that all the replicas compile the same graph.
+    self._stage_tensor = torch.tensor(self.stage, device=self.device)
+    self.last_stage_mask = (self._stage_tensor == num_stages - 1).float()
+
+  def forward(self, stage_fn, microbatches):
+    """Runs the microbatches through the pipeline.
+
+    Args:
+      stage_fn (callable): The function of a stage, ``stage_fn(x)``, or
+        ``stage_fn(x, chunk)`` with ``chunk`` a device scalar tensor when
+        ``num_chunks`` is greater than one. Its output must have the shape and
+        type of its input.
+      microbatches (list): The input tensors of the first stage.
+
+    Returns:
+      The list of the outputs of the microbatches, which are only valid on the
+      last stage. The loss should be multiplied by ``last_stage_mask`` before
+      the backward pass.
+    """
+    num_steps, injections, chunks, finishes = _circular_schedule(
+        len(microbatches), self.num_stages, self.num_chunks)
+    is_first = self._stage_tensor == 0
+    outputs = [None] * len(microbatches)
+    x = torch.zeros_like(microbatches[0])
+    for t in range(num_steps):
+      m = injections.get(t, None)
+      if m is not None:
+        x = torch.where(is_first, microbatches[m], x)
+      if self.num_chunks > 1:
+        chunk_table = torch.tensor(chunks[t], device=self.device)
+        y = stage_fn(x, chunk_table[self._stage_tensor])
+      else:
+        y = stage_fn(x)
+      m = finishes.get(t, None)
+      if m is not None:
+        outputs[m] = y
+      if t + 1 < num_steps:
+        x = _CollectivePermute.apply(y, self.pairs) if self.pairs else y
+    return outputs
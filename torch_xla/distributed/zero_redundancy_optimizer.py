@@ -0,0 +1,156 @@
+import torch
+from torch import Tensor
+import torch_xla
+import torch_xla.core.xla_model as xm
+
+
+class ShardedAdam(torch.optim.Optimizer):
+  r"""Adam/AdamW optimizer with the optimizer state sharded across the replicas.
+
+    Each replica only keeps the moments (and a copy of the parameters) for its
+    ``1 / world_size`` shard of every flattened parameter. At every step the
+    gradients are reduce-scattered (and averaged), the replicas update their
+    shards with the fused Adam step, and the updated parameters are
+    all-gathered back, all within the step graph. The optimizer state memory
+    per replica is divided by the number of replicas.
+
+    The gradients are reduced by the optimizer itself, so ``step()`` must be
+    called directly instead of through ``xm.optimizer_step()``.
+
+    Args:
+        params (iterable): iterable of parameters to optimize or dicts defining
+            parameter groups
+        lr (float, optional): learning rate (default: 1e-3)
+        betas (Tuple[float, float], optional): coefficients used for computing
+            running averages of gradient and its square (default: (0.9, 0.999))
+        eps (float, optional): term added to the denominator to improve
+            numerical stability (default: 1e-8)
+        weight_decay (float, optional): weight decay (default: 0)
+        amsgrad (boolean, optional): whether to use the AMSGrad variant of this
+            algorithm (default: False)
+        maximize (bool, optional): maximize the params based on the objective,
+            instead of minimizing (default: False)
+        use_adamw (bool, optional): whether to apply the weight decay in the
+            decoupled AdamW fashion (default: False)
+        groups (list, optional): the replica groups the state is sharded
+            across, see ``xm.all_reduce()``. All the groups must have the same
+            size (default: all the replicas)
+        pin_layout (bool, optional): whether to pin the layout of the
+            collectives, see ``xm.all_reduce()`` (default: True)
+    """
+
+  def __init__(self,
+               params,
+               lr=1e-3,
+               betas=(0.9, 0.999),
+               eps=1e-8,
+               weight_decay=0,
+               amsgrad=False,
+               maximize=False,
+               use_adamw=False,
+               groups=None,
+               pin_layout=True):
+    defaults = dict(
+        lr=lr,
+        betas=betas,
+        eps=eps,
+        weight_decay=weight_decay,
+        amsgrad=amsgrad,
+        maximize=maximize,
+        use_adamw=use_adamw)
+    super(ShardedAdam, self).__init__(params, defaults)
+    self.groups = groups
+    self.pin_layout = pin_layout
+    self.shard_count = len(groups[0]) if groups else xm.xrt_world_size()
+
+  def _flatten_padded(self, tensor):
+    flat = tensor.reshape(-1)
+    padding = -flat.numel() % self.shard_count
+    if padding:
+      flat = torch.cat([flat, flat.new_zeros(padding)])
+    return flat
+
+  def _scatter(self, tensor):
+    # Since the parameters are the same on all the replicas, averaging them
+    # gives every replica its own shard without replica dependent slicing,
+    # which would make the replicas run different graphs.
+    return xm.reduce_scatter(
+        xm.REDUCE_SUM,
+        self._flatten_padded(tensor),
+        1.0 / self.shard_count,
+        0,
+        self.shard_count,
+        groups=self.groups,
+        pin_layout=self.pin_layout)
+
+  def _gather(self, shard, param):
+    full = xm.all_gather(
+        shard, dim=0, groups=self.groups, pin_layout=self.pin_layout)
+    param.copy_(full[:param.numel()].view_as(param))
+
+  @torch.no_grad()
+  def step(self, closure=None, found_inf: Tensor = None):
+    """Performs a single optimization step.
+
+        Args:
+            closure (callable, optional): A closure that reevaluates the model
+                and returns the loss.
+            found_inf (torch.Tensor, optional): A scalar tensor indicates if
+                the optimizer.step should be performed (found_inf is 0 or None) or
+                skipped (found_inf == 1).
+        """
+    if found_inf is not None and found_inf.shape:
+      raise ValueError("The found_inf tensor has to be scalar type")
+
+    loss = None
+    if closure is not None:
+      with torch.enable_grad():
+        loss = closure()
+    for group in self.param_groups:
+      params_with_grad = []
+      param_shards = []
+      grad_shards = []
+      exp_avgs = []
+      exp_avg_sqs = []
+      max_exp_avg_sqs = []
+      state_steps = []
+      beta1, beta2 = group['betas']
+
+      for p in group['params']:
+        if p.grad is None:
+          continue
+        if p.grad.is_sparse:
+          raise RuntimeError('ShardedAdam does not support sparse gradients')
+        if found_inf is None:
+          found_inf = torch.zeros((), dtype=torch.float32, device=p.device)
+        params_with_grad.append(p)
+        grad_shards.append(self._scatter(p.grad))
+
+        state = self.state[p]
+        # Lazy state initialization, with the state tensors covering only the
+        # shard of the flattened parameter of this replica.
+        if not state:
+          state['step'] = torch.zeros_like(found_inf)
+          state['param_shard'] = self._scatter(p.detach())
+          state['exp_avg'] = torch.zeros_like(state['param_shard'])
+          state['exp_avg_sq'] = torch.zeros_like(state['param_shard'])
+          state['max_exp_avg_sq'] = torch.zeros_like(state['param_shard'])
+
+        param_shards.append(state['param_shard'])
+        exp_avgs.append(state['exp_avg'])
+        exp_avg_sqs.append(state['exp_avg_sq'])
+        max_exp_avg_sqs.append(state['max_exp_avg_sq'])
+        state_steps.append(state['step'])
+
+      if not params_with_grad:
+        continue
+      # All the shards get updated within a single fused IR node.
+      torch_xla._XLAC._xla_foreach_adam_optimizer_step_(
+          found_inf, state_steps, param_shards, grad_shards, exp_avgs,
+          exp_avg_sqs, max_exp_avg_sqs, beta1, beta2, group['lr'],
+          group['weight_decay'], group['eps'], group['amsgrad'],
+          group['maximize'], group['use_adamw'])
+      for p, shard in zip(params_with_grad, param_shards):
+        self._gather(shard, p)
+
+    return loss
@@ -0,0 +1,127 @@
+import math
+import numpy as np
+import torch
+import torch_xla
+import torch_xla.core.xla_model as xm
+import torch_xla.experimental.xla_sharding as xs
+from torch_xla.distributed.pipeline import _CollectivePermute
+from typing import Tuple, Union
+
+
+def _ring_pairs(mesh, axis):
+  pairs = []
+  for group in mesh.get_replica_groups(axis):
+    for i in range(len(group)):
+      pairs.append([group[i], group[(i + 1) % len(group)]])
+  return pairs
+
+
+def _block_attention(q, k, v, scale, mask, m, l, o):
+  # One step of the online softmax, which rescales the partial sums of the
+  # previous key blocks to the new running maximum.
+  s = torch.matmul(q, k.transpose(-1, -2)) * scale
+  if mask is not None:
+    s = s.masked_fill(~mask, -math.inf)
+  m_new = torch.maximum(m, s.amax(dim=-1, keepdim=True))
+  p = torch.exp(s - m_new)
+  correction = torch.exp(m - m_new)
+  l = l * correction + p.sum(dim=-1, keepdim=True)
+  o = o * correction + torch.matmul(p, v)
+  return m_new, l, o
+
+
+def ring_attention(query: torch.Tensor,
+                   key: torch.Tensor,
+                   value: torch.Tensor,
+                   mesh: Union[Tuple[int], xs.Mesh],
+                   partition_spec: Tuple[Union[int, str, None]],
+                   causal: bool = False,
+                   scale: float = None) -> torch.Tensor:
+  """Computes the attention with the sequence sharded over a mesh axis.
+
+  The query, key and value ``[..., sequence, head_dim]`` tensors get sharded
+  like ``xs.mark_sharding()`` would with ``partition_spec``, whose sequence
+  entry names the context parallel mesh axis. Within a manual sharding region,
+  every device computes the attention of its query block against the key and
+  value blocks, which go around the ring of the devices along the axis with
+  collective permutes, while the online softmax accumulates the partial
+  results. No device ever holds more than one block of the keys and values,
+  and XLA can overlap the transfer of the next block with the compute of the
+  current one.
+
+  Args:
+    query (torch.Tensor): The queries, with the sequence in the dimension
+      before the last.
+    key (torch.Tensor): The keys, of the shape of the queries.
+    value (torch.Tensor): The values, of the shape of the queries.
+    mesh (Union[Tuple[int], Mesh]): The device mesh, as in
+      ``xs.mark_sharding()``.
+    partition_spec (tuple): The partition spec of the three tensors. The
+      sequence length must be a multiple of the size of its mesh axis, and the
+      last dimension must not be sharded.
+    causal (bool, optional): Whether the queries only attend to the keys at or
+      before their position.
+      Default: False
+    scale (float, optional): The scale of the scores.
+      Default: ``1 / sqrt(head_dim)``
+  Returns:
+    The attention output, sharded like the queries.
+  """
+  assert query.shape == key.shape == value.shape, \
+    f"The query {query.shape}, key {key.shape} and value {value.shape} shapes differ."
+  if not isinstance(mesh, xs.Mesh):
+    mesh = xs.Mesh(range(int(np.prod(mesh))), mesh)
+  seq_axis = partition_spec[-2]
+  assert seq_axis is not None, \
+    f"The sequence is not sharded by the partition spec {partition_spec}."
+  seq_axis = mesh.get_axis_index(seq_axis)
+  tile_assignment, _, _ = xs._get_tile_assignment(query.dim(), mesh,
+                                                  partition_spec)
+  # A partially replicated assignment has a trailing replication dimension.
+  tile_shape = np.array(tile_assignment).shape[:query.dim()]
+  assert tile_shape[-1] == 1, \
+    f"The head dimension is sharded by the partition spec {partition_spec}."
+  num_blocks = mesh.mesh_shape[seq_axis]
+  seq_len = query.shape[-2]
+  assert seq_len % num_blocks == 0, \
+    f"The sequence length {seq_len} is not a multiple of {num_blocks}."
+  block_len = seq_len // num_blocks
+  if scale is None:
+    scale = 1.0 / math.sqrt(query.shape[-1])
+
+  q = xs.enable_manual_sharding(query, mesh, partition_spec)
+  k = xs.enable_manual_sharding(key, mesh, partition_spec)
+  v = xs.enable_manual_sharding(value, mesh, partition_spec)
+  if causal:
+    # The devices run the same graph, and every device gets the index of its
+    # sequence block as a shard of its own.
+    block_index = torch.arange(
+        num_blocks, dtype=torch.int32).view([1] * (query.dim() - 2) +
+                                            [num_blocks, 1]).expand(tile_shape)
+    block_index = xs.enable_manual_sharding(
+        block_index.contiguous().to(query.device), mesh, partition_spec)
+    positions = torch.arange(
+        block_len, dtype=torch.int32, device=query.device)
+    q_pos = block_index * block_len + positions.view(-1, 1)
+
+  pairs = _ring_pairs(mesh, seq_axis)
+  m = torch.full(
+      q.shape[:-1] + (1,), -math.inf, dtype=q.dtype, device=q.device)
+  l = torch.zeros_like(m)
+  o = torch.zeros_like(q)
+  for step in range(num_blocks):
+    mask = None
+    if causal:
+      # After the steps, every device holds the key block of the device that
+      # many positions before it along the ring.
+      k_block = torch.remainder(block_index - step, num_blocks)
+      k_pos = k_block * block_len + positions.view(1, -1)
+      mask = q_pos >= k_pos
+    m, l, o = _block_attention(q, k, v, scale, mask, m, l, o)
+    if step + 1 < num_blocks:
+      k = _CollectivePermute.apply(k, pairs)
+      v = _CollectivePermute.apply(v, pairs)
+  # Every query attends at least to itself, in the causal case too, so that l
+  # is never zero.
+  o = o / l
+  return xs.disable_manual_sharding(o, mesh, partition_spec, query.shape)
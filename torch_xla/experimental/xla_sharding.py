@@ -3,14 +3,159 @@ import torch_xla
 import torch_xla.core.xla_model as xm
 from torch_xla.experimental.xla_sharded_tensor import XLAShardedTensor
 
+import collections
 import numpy as np
-from typing import Tuple, Union
+from typing import Sequence, Tuple, Union
+
+
+class Mesh(object):
+  """A logical mesh of devices, with optionally named axes.
+
+  The device ids are the indices of the devices the sharded graphs run on: the
+  SPMD devices with ``XLA_USE_SPMD``, the replicas otherwise. A mesh maps them
+  onto the logical axes, and can be passed to `mark_sharding()` in place of the
+  mesh shape, with the partition specs naming its axes, and its replica groups
+  to the collectives (like ``xm.all_reduce(groups=...)``).
+
+  Args:
+    device_ids (sequence): The device ids, in the row major order of the mesh.
+    mesh_shape (tuple): The size of every mesh axis.
+    axis_names (tuple, optional): The names of the mesh axes.
+      Default: None
+  """
+
+  def __init__(self,
+               device_ids: Sequence[int],
+               mesh_shape: Tuple[int, ...],
+               axis_names: Tuple[str, ...] = None):
+    device_ids = np.asarray(device_ids)
+    assert device_ids.size == np.prod(mesh_shape), \
+      f"{device_ids.size} devices are not mappable over {mesh_shape}."
+    assert sorted(device_ids.tolist()) == list(range(device_ids.size)), \
+      f"The device ids {device_ids.tolist()} are not a permutation."
+    if axis_names is not None:
+      assert len(axis_names) == len(mesh_shape), \
+        f"The axis names {axis_names} do not match the mesh shape {mesh_shape}."
+      assert len(set(axis_names)) == len(axis_names), \
+        f"The axis names {axis_names} are not unique."
+    self.device_ids = device_ids.reshape(-1)
+    self.mesh_shape = tuple(mesh_shape)
+    self.axis_names = tuple(axis_names) if axis_names is not None else None
+
+  def size(self):
+    return self.device_ids.size
+
+  def shape(self):
+    """Returns the ordered mapping of the axis names (or indices) to sizes."""
+    names = self.axis_names or range(len(self.mesh_shape))
+    return collections.OrderedDict(zip(names, self.mesh_shape))
+
+  def get_axis_index(self, axis: Union[int, str]) -> int:
+    if isinstance(axis, str):
+      assert self.axis_names is not None and axis in self.axis_names, \
+        f"Unknown mesh axis {axis}."
+      return self.axis_names.index(axis)
+    assert 0 <= axis < len(self.mesh_shape), f"Unknown mesh axis {axis}."
+    return axis
+
+  def get_logical_mesh(self):
+    return self.device_ids.reshape(self.mesh_shape)
+
+  def get_replica_groups(self, axes: Union[int, str, Sequence]):
+    """Returns the groups of the devices which differ only along the axes.
+
+    Args:
+      axes (int, str or sequence): The mesh axes the groups span.
+    Returns:
+      A list of device id lists, one per group, to be used as the ``groups``
+      of the collectives reducing along the axes.
+    """
+    if isinstance(axes, (int, str)):
+      axes = [axes]
+    axes = [self.get_axis_index(axis) for axis in axes]
+    other_axes = [i for i in range(len(self.mesh_shape)) if i not in axes]
+    group_size = int(np.prod([self.mesh_shape[i] for i in axes]))
+    mesh = self.get_logical_mesh().transpose(other_axes + axes)
+    return mesh.reshape(-1, group_size).tolist()
+
+
+def _get_mesh_devices():
+  return (torch_xla._XLAC._xla_get_spmd_devices() or
+          torch_xla._XLAC._xla_get_replication_devices() or
+          xm.xla_real_devices([xm.xla_device()]))
+
+
+def create_device_mesh(mesh_shape: Tuple[int, ...],
+                       axis_names: Tuple[str, ...] = None) -> Mesh:
+  """Creates a mesh with the devices ordered by their physical coordinates.
+
+  The devices which are the closest within the interconnect topology (like the
+  cores of a TPU chip, then the chips along the fastest links) end up next to
+  each other along the last mesh axis, then along the previous ones. The axis
+  carrying the most traffic, like the model parallel one, should come last.
+
+  Args:
+    mesh_shape (tuple): The size of every mesh axis.
+    axis_names (tuple, optional): The names of the mesh axes.
+      Default: None
+  Returns:
+    The `Mesh` over all the devices.
+  """
+  devices = _get_mesh_devices()
+  coords = torch_xla._XLAC._xla_get_device_coords(devices)
+  device_ids = sorted(range(len(devices)), key=lambda i: (coords[i], i))
+  return Mesh(device_ids, mesh_shape, axis_names)
+
+
+def _get_tile_assignment(rank, mesh_shape, partition_spec):
+  # With XLA_USE_SPMD the graphs are partitioned over the local devices,
+  # otherwise over the replicas.
+  num_devices = len(
+      torch_xla._XLAC._xla_get_spmd_devices()) or xm.xrt_world_size()
+  if isinstance(mesh_shape, Mesh):
+    mesh = mesh_shape
+    partition_spec = tuple(
+        mesh.get_axis_index(d) if d is not None else None
+        for d in partition_spec)
+  else:
+    mesh = Mesh(range(num_devices), mesh_shape)
+  mesh_shape = mesh.mesh_shape
+  assert mesh.size() == num_devices, \
+    f"{mesh_shape} is not mappable over {num_devices} devices."
+  assert all((d >= 0 and d < len(mesh_shape)) for d in partition_spec if d), \
+    f"partition_spec ({partition_spec}) contains out of bound index into mesh_shape."
+  # We might allow {len(partition_spec)} <= {len(t.shape)},
+  # where the unspecified ranks are replicated.
+  assert rank == len(partition_spec), \
+    f"Partition spec length ({len(partition_spec)}) is not equal to the input rank ({rank})."
+  assert len(mesh_shape) == len(partition_spec), \
+    f"Partition spec length ({len(partition_spec)}) is not equal to the mesh rank ({len(mesh_shape)})."
+  assert len(set(d for d in partition_spec if d is not None)) == len(
+      [d for d in partition_spec if d is not None]), \
+    f"partition_spec ({partition_spec}) maps more than one dimension to a mesh axis."
+
+  # The tensor dimensions get tiled along the mesh axes they name, and the ones
+  # with a None spec are not split. The devices along the mesh axes no
+  # dimension names hold replicas of the same tile, so these axes go last, as
+  # the replication dimension of a partially replicated tile assignment.
+  named_axes = [d for d in partition_spec if d is not None]
+  replica_axes = [i for i in range(len(mesh_shape)) if i not in named_axes]
+  tile_shape = [mesh_shape[d] if d is not None else 1 for d in partition_spec]
+  num_replicas = int(np.prod([mesh_shape[i] for i in replica_axes]))
+  replicated = not named_axes
+  partial = not replicated and num_replicas > 1
+  if partial:
+    tile_shape.append(num_replicas)
+  tile_assignment = mesh.get_logical_mesh().transpose(
+      named_axes + replica_axes).reshape(tile_shape).tolist()
+  return tile_assignment, replicated, partial
 
 
 # torch_xla.distributed.xla_sharding
-def mark_sharding(t: Union[torch.Tensor,
-                           XLAShardedTensor], mesh_shape: Tuple[int],
-                  partition_spec: Tuple[Union[int, None]]) -> XLAShardedTensor:
+def mark_sharding(t: Union[torch.Tensor, XLAShardedTensor],
+                  mesh_shape: Union[Tuple[int], Mesh],
+                  partition_spec: Tuple[Union[int, str,
+                                              None]]) -> XLAShardedTensor:
   """
     Annotates the tensor provided with XLA partition spec. Internally,
     it annotates the corresponding XLATensor as sharded for the XLA SpmdPartitioner pass.
@@ -20,7 +165,8 @@ def mark_sharding(t: Union[torch.Tensor,
 
         mesh_shape (Tuple[Union[int, None]]): A int tuple describing the logical topology
         of the device mesh, and each element describes the number of devices in
-        the corresponding axis.
+        the corresponding axis. A `Mesh` also maps the mesh onto its devices,
+        and lets the partition spec use its axis names.
 
         partition_spec (Tuple[int, None]): A tuple of device_mesh dimension index or `None`.
         This specifies how each input rank is sharded (index to mesh_shape) or replicated (None).
@@ -45,31 +191,134 @@ def mark_sharding(t: Union[torch.Tensor,
     output = linear(input)
     # full replication
     output = xs.mark_sharding(output, device_mesh, (None, None))
-    """
-  num_devices = xm.xrt_world_size()
-  assert np.prod(mesh_shape) == num_devices, \
-    f"{mesh_shape} is not mappable over {num_devices} devices."
-  assert all((d >= 0 and d < len(mesh_shape)) for d in partition_spec if d), \
-    f"partition_spec ({partition_spec}) contains out of bound index into mesh_shape."
-  # We might allow {len(partition_spec)} <= {len(t.shape)},
-  # where the unspecified ranks are replicated.
-  assert len(t.shape) == len(partition_spec), \
-    f"Partition spec length ({len(partition_spec)}) is not equal to the input rank ({len(t.shape)})."
-
-  device_ids = np.array(range(num_devices))
-  tile_assignment = list(device_ids.reshape(mesh_shape))
 
+    # The same with named axes, and the model parallel axis over the closest
+    # devices
+    mesh = xs.create_device_mesh((4, 2), ('data', 'model'))
+    input = xs.mark_sharding(input, mesh, ('data', None))
+    """
+  tile_assignment, replicated, partial = _get_tile_assignment(
+      len(t.shape), mesh_shape, partition_spec)
   manual = False
-  replicated = False
-  if all(d is None for d in partition_spec):
-    # TODO(yeounoh) support partial replication
-    replicated = True
 
   if isinstance(t, XLAShardedTensor):
     # Update sharding annotation
     torch_xla._XLAC._xla_mark_sharding(t.global_tensor, tile_assignment,
-                                       replicated, manual)
+                                       replicated, manual, partial)
     return t  #  XLAShardedTensor
 
-  torch_xla._XLAC._xla_mark_sharding(t, tile_assignment, replicated, manual)
+  torch_xla._XLAC._xla_mark_sharding(t, tile_assignment, replicated, manual,
+                                     partial)
   return XLAShardedTensor(t)
+
+
+def get_memory_plan(tensors: Sequence[torch.Tensor],
+                    num_devices: int = None) -> dict:
+  """
+    Plans the per device memory of the graph of the tensors, partitioned with
+    their sharding annotations, without compiling nor running it, so that the
+    sharding layouts can be compared offline.
+
+    Args:
+        tensors (Sequence[torch.Tensor]): the tensors with the pending graph.
+        num_devices (int, optional): the number of devices of the partitioning.
+          Default: all the mesh devices
+
+    Returns:
+        A dict with the ``argument_bytes``, ``output_bytes``, ``temp_bytes`` and
+        ``peak_bytes`` of one device, and the ``collective_bytes`` by collective
+        opcode. The temporary memory is planned before the backend fuses the
+        elementwise ops, and is an upper bound.
+    """
+  return torch_xla._XLAC._xla_spmd_memory_plan(
+      list(tensors), num_devices or len(_get_mesh_devices()))
+
+
+class _FullToShardShape(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, t, tile_assignment, replicated, partial):
+    ctx.tile_assignment = tile_assignment
+    ctx.replicated = replicated
+    ctx.partial = partial
+    ctx.full_sizes = list(t.shape)
+    return torch_xla._XLAC._xla_spmd_full_to_shard_shape(
+        t, tile_assignment, replicated, partial)
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    return torch_xla._XLAC._xla_spmd_shard_to_full_shape(
+        grad_output, ctx.tile_assignment, ctx.replicated, ctx.partial,
+        ctx.full_sizes), None, None, None
+
+
+class _ShardToFullShape(torch.autograd.Function):
+
+  @staticmethod
+  def forward(ctx, t, tile_assignment, replicated, partial, full_sizes):
+    ctx.tile_assignment = tile_assignment
+    ctx.replicated = replicated
+    ctx.partial = partial
+    return torch_xla._XLAC._xla_spmd_shard_to_full_shape(
+        t, tile_assignment, replicated, partial, full_sizes)
+
+  @staticmethod
+  def backward(ctx, grad_output):
+    return torch_xla._XLAC._xla_spmd_full_to_shard_shape(
+        grad_output, ctx.tile_assignment, ctx.replicated,
+        ctx.partial), None, None, None, None
+
+
+def enable_manual_sharding(t: torch.Tensor, mesh_shape: Union[Tuple[int], Mesh],
+                           partition_spec: Tuple[Union[int, str, None]]
+                          ) -> torch.Tensor:
+  """
+    Enters a manual sharding region of the SPMD graph, where the partitioner
+    leaves the computation alone and every device works on its own shard.
+
+    The tensor gets sharded like ``mark_sharding()`` would, and the returned
+    tensor is the per device shard, which the ops of the region see with the
+    (padded) shard shape. The collectives built within the region, like
+    ``xm.all_reduce()``, run over the SPMD devices, with the groups made of the
+    device indices. The region ends with ``disable_manual_sharding()``.
+
+    Tensors used within the region without going through this function are
+    seen whole by every device.
+
+    Args:
+        t (torch.Tensor): the tensor of the full shape.
+        mesh_shape (Union[Tuple[int], Mesh]): the device mesh, as in
+          ``mark_sharding()``.
+        partition_spec (Tuple[Union[int, str, None]]): the partition spec of
+          ``t``, as in ``mark_sharding()``.
+
+    Example
+    —------------------------------
+    mesh = xs.create_device_mesh((8,), ('data',))
+    shard = xs.enable_manual_sharding(grads, mesh, ('data', None))
+    shard = xm.all_reduce(xm.REDUCE_SUM, shard)
+    grads = xs.disable_manual_sharding(shard, mesh, ('data', None),
+                                       grads.shape)
+    """
+  assert torch_xla._XLAC._xla_get_spmd_devices(), \
+    "The manual sharding regions require XLA_USE_SPMD."
+  tile_assignment, replicated, partial = _get_tile_assignment(
+      len(t.shape), mesh_shape, partition_spec)
+  return _FullToShardShape.apply(t, tile_assignment, replicated, partial)
+
+
+def disable_manual_sharding(t: torch.Tensor, mesh_shape: Union[Tuple[int],
+                                                               Mesh],
+                            partition_spec: Tuple[Union[int, str, None]],
+                            full_shape: Sequence[int]) -> torch.Tensor:
+  """
+    Exits a manual sharding region, assembling the per device shards into the
+    tensor of ``full_shape``, sharded with ``partition_spec`` over the mesh.
+    """
+  assert torch_xla._XLAC._xla_get_spmd_devices(), \
+    "The manual sharding regions require XLA_USE_SPMD."
+  full_sizes = list(full_shape)
+  tile_assignment, replicated, partial = _get_tile_assignment(
+      len(full_sizes), mesh_shape, partition_spec)
+  return _ShardToFullShape.apply(t, tile_assignment, replicated, partial,
+                                 full_sizes)
@@ -1,8 +1,10 @@
 # This file is copied from https://github.com/pytorch/pytorch/blob/master/torch/utils/checkpoint.py.
 # PyTorch/XLA needs to add `optimization_barrier` before saving the input for the backward hence we
 # slightly modify the upstream version of the checkpoint util function.
+import collections
 import torch
 import warnings
+import torch_xla
 import torch_xla.core.xla_model as xm
 from torch.utils.checkpoint import detach_variable, check_backward_validity, get_device_states, set_device_states
 from typing import Any, Iterable, List, Tuple, Union
@@ -212,3 +214,111 @@ def checkpoint(function, *args, use_reentrant: bool = True, **kwargs):
     return CheckpointFunction.apply(function, preserve, *args)
   else:
     raise ValueError("XLA currently does not support use_reentrant==False")
+
+
+def estimate_activation_bytes(function, *args):
+  """Estimates the bytes of the activations computed by `function(*args)`.
+
+  The function is only traced, with no gradients, to get the shapes of the IR
+  values it computes from `args`, so nothing gets executed on device. The
+  estimate is an upper bound, as XLA fuses many of those values away.
+
+  Args:
+    function: The function to be traced.
+    args: The inputs of :attr:`function`.
+
+  Returns:
+    The sum of the bytes of the IR values computed by the function, besides the
+    device data it reads (like the model parameters).
+  """
+  with torch.no_grad():
+    outputs = function(*args)
+  return torch_xla._XLAC._xla_tensors_graph_bytes(
+      CheckpointFunction._extract_tensors_from_list(outputs),
+      CheckpointFunction._extract_tensors_from_list(args))
+
+
+def _select_checkpoints(costs, memory_budget):
+  # Every function either keeps its activations, or only its input when
+  # checkpointed. Checkpoint the functions saving the most until the kept bytes
+  # fit the budget.
+  kept = sum(activation_bytes for activation_bytes, _ in costs)
+  selected = [False] * len(costs)
+  order = sorted(range(len(costs)), key=lambda i: costs[i][1] - costs[i][0])
+  for i in order:
+    if kept <= memory_budget:
+      break
+    activation_bytes, input_bytes = costs[i]
+    if input_bytes < activation_bytes:
+      selected[i] = True
+      kept -= activation_bytes - input_bytes
+  return selected
+
+
+# The checkpoints selected by checkpoint_sequential(), keyed by the functions,
+# the input shape and the memory budget they were selected for.
+_checkpoint_selections = collections.OrderedDict()
+_MAX_CHECKPOINT_SELECTIONS = 64
+
+
+def _estimate_sequential_costs(functions, input):
+  # Every function runs once with no gradients, to trace its IR. The buffers of
+  # the modules, like the BatchNorm running stats, get restored afterwards, so
+  # that the estimation does not update them on top of the real run.
+  buffers = []
+  for function in functions:
+    if isinstance(function, torch.nn.Module):
+      buffers.extend((b, b.clone()) for b in function.buffers())
+  costs = []
+  output = input
+  with torch.no_grad():
+    for function in functions:
+      next_output = function(output)
+      costs.append((torch_xla._XLAC._xla_tensors_graph_bytes([next_output],
+                                                             [output]),
+                    output.element_size() * output.numel()))
+      output = next_output
+    for buffer, saved in buffers:
+      buffer.copy_(saved)
+  return costs
+
+
+def checkpoint_sequential(functions, input, memory_budget, **kwargs):
+  r"""Runs a sequence of functions, checkpointing some to fit a memory budget.
+
+  The activations of every function are estimated from the shapes of its IR,
+  with :func:`estimate_activation_bytes`, and the functions whose checkpointing
+  saves the most memory get checkpointed, until the activations kept for the
+  backward fit :attr:`memory_budget`. The estimation runs the functions once
+  more, so it only happens on the first call for a given input shape, and the
+  selected checkpoints are reused by the following calls.
+
+  Args:
+    functions: The sequence of the functions (or modules) to be run in order,
+      each taking the output of the previous one.
+    input: The tensor input of the first function.
+    memory_budget (int): The bytes of the activations which can be kept.
+    kwargs: The arguments of :func:`checkpoint`.
+
+  Returns:
+    The output of the last function.
+  """
+  functions = list(functions)
+  key = (tuple(id(function) for function in functions), tuple(input.shape),
+         input.dtype, memory_budget)
+  selected = _checkpoint_selections.get(key, None)
+  if selected is None:
+    selected = _select_checkpoints(
+        _estimate_sequential_costs(functions, input), memory_budget)
+    _checkpoint_selections[key] = selected
+    if len(_checkpoint_selections) > _MAX_CHECKPOINT_SELECTIONS:
+      _checkpoint_selections.popitem(last=False)
+  else:
+    _checkpoint_selections.move_to_end(key)
+  output = input
+  for function, checkpointed in zip(functions, selected):
+    if checkpointed:
+      output = checkpoint(function, output, **kwargs)
+    else:
+      output = function(output)
+  return output
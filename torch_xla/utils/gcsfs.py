@@ -10,6 +10,7 @@ import os
 import re
 import tempfile
 import sys
+import torch
 import torch_xla
 
 GcsBlob = collections.namedtuple('GcsBlob', 'path size mtime isdir')
@@ -235,6 +236,53 @@ def read(path):
   return _slurp_file(path)
 
 
+def readinto(path, buffer, offset=0):
+  """Reads the content of a GCS blob straight into a buffer.
+
+  Args:
+    path (string): The GCS path of the file. Must be "gs://BUCKET_NAME/PATH"
+      where ``BUCKET_NAME`` is the name of the GCS bucket, and ``PATH`` is a `/`
+      delimited path.
+    buffer (object): A writable, contiguous, buffer protocol object (like a
+      ``bytearray`` or a ``memoryview``), or a contiguous CPU tensor, whose size
+      is the number of bytes to read.
+    offset (int, optional): The offset within the blob to read from.
+      Default: 0
+
+  Returns:
+    The number of bytes read, which is less than the buffer size only if the
+    blob ends before.
+  """
+  gcs_file = torch_xla._XLAC._xla_tffile_open(path)
+  return torch_xla._XLAC._xla_tffile_readinto(gcs_file, offset, buffer)
+
+
+def readinto_async(path, buffer, offset=0):
+  """Starts reading the content of a GCS blob straight into a buffer.
+
+  The read runs in background, so that it can overlap with the computations.
+  The buffer must not be touched until the read completes.
+
+  Args:
+    path (string): Like for `readinto()`.
+    buffer (object): Like for `readinto()`.
+    offset (int, optional): Like for `readinto()`.
+
+  Returns:
+    An object whose ``wait()`` method waits for the read, and returns the
+    number of bytes read, and whose ``is_ready()`` method tells whether the
+    read completed.
+  """
+  gcs_file = torch_xla._XLAC._xla_tffile_open(path)
+  return torch_xla._XLAC._xla_tffile_readinto_async(gcs_file, offset, buffer)
+
+
+def _is_buffer(content):
+  if isinstance(content, (bytes, bytearray, memoryview, torch.Tensor)):
+    return True
+  return hasattr(content, '__array_interface__')
+
+
 def write(path, content):
   """Write a string/bytes or file into a GCS blob.
 
@@ -242,16 +290,38 @@ def write(path, content):
     path (string): The GCS path of the file. Must be "gs://BUCKET_NAME/PATH"
       where ``BUCKET_NAME`` is the name of the GCS bucket, and ``PATH`` is a `/`
       delimited path.
-    content (string, bytes or file object): The content to be written into
-      ``path``.
+    content (string, bytes, buffer, tensor or file object): The content to be
+      written into ``path``. Contiguous buffer protocol objects and CPU tensors
+      get written straight from their memory.
   """
-  if not isinstance(content, (bytes, str)):
-    content = content.read()
   gcs_file = torch_xla._XLAC._xla_tffile_create(path)
-  torch_xla._XLAC._xla_tffile_write(gcs_file, content)
+  if _is_buffer(content):
+    torch_xla._XLAC._xla_tffile_write_buffer(gcs_file, content)
+  else:
+    if not isinstance(content, str):
+      content = content.read()
+    torch_xla._XLAC._xla_tffile_write(gcs_file, content)
   torch_xla._XLAC._xla_tffile_flush(gcs_file)
 
 
+def write_many(paths, contents):
+  """Writes every content into its own GCS blob, uploading them in parallel.
+
+  A single GCS blob is written as a sequential upload stream, so storing large
+  data (like the tensors of a checkpoint) as many blobs written with this API
+  is what makes the uploads run concurrently.
+
+  Args:
+    paths (list): The GCS paths of the files. See `write()`.
+    contents (list): The contents to be written, one for each of the ``paths``.
+      Either bytes, contiguous buffer protocol objects (like ``memoryview`` or
+      numpy arrays), or contiguous CPU tensors, which get written straight from
+      their memory, without conversions or copies.
+  """
+  assert len(paths) == len(contents)
+  torch_xla._XLAC._xla_tffiles_write(paths, contents)
+
+
 def is_gcs_path(path):
   """Checks whether a path is a GCS path.
 
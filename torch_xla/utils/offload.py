@@ -0,0 +1,98 @@
+import torch
+import torch_xla.core.xla_model as xm
+
+
+def _layer_tensors(layer):
+  return [p for p in layer.parameters()] + [b for b in layer.buffers()]
+
+
+def _optimizer_state_tensors(optimizer):
+  tensors = []
+  for state in optimizer.state.values():
+    for value in state.values():
+      if isinstance(value, torch.Tensor) and value.device.type == 'xla':
+        tensors.append(value)
+  return tensors
+
+
+def offload_optimizer_state(optimizer):
+  """Moves the state tensors of the optimizer to host memory.
+
+  Called right after the optimizer step, the device buffers get released once
+  the step graph has run.
+
+  Args:
+    optimizer (:class:`torch.Optimizer`): The optimizer whose state to offload.
+  """
+  xm.offload_to_host(_optimizer_state_tensors(optimizer))
+
+
+def prefetch_optimizer_state(optimizer):
+  """Starts the uploads of the offloaded state tensors of the optimizer.
+
+  Called at the start of the training step, the uploads overlap with the
+  forward and backward passes.
+
+  Args:
+    optimizer (:class:`torch.Optimizer`): The optimizer whose state to
+      prefetch.
+  """
+  xm.prefetch_to_device(_optimizer_state_tensors(optimizer))
+
+
+class LayerStreamer(object):
+  """Streams the parameters of a stack of layers in and out of device memory.
+
+  The parameters and buffers of the layers live in host memory. Before a layer
+  runs, the uploads of the next ``prefetch`` layers start in the background,
+  and after it ran within a graph of its own, its parameters go back to host
+  memory. The device then only holds the parameters of ``prefetch + 1``
+  layers at a time, at the cost of one graph per layer, which fits the
+  inference of models whose parameters exceed the device memory. Since the
+  graph of a training step must hold all the parameters, the training use is
+  limited to the optimizer state, see ``offload_optimizer_state()``.
+
+  Args:
+    layers (list): The :class:`torch.nn.Module` layers, in their execution
+      order.
+    prefetch (int, optional): The number of layers uploaded ahead.
+      Default: 1
+  """
+
+  def __init__(self, layers, prefetch=1):
+    self.layers = list(layers)
+    self.prefetch = prefetch
+    self._handles = []
+    for i, layer in enumerate(self.layers):
+      self._handles.append(
+          layer.register_forward_pre_hook(self._make_pre_hook(i)))
+      self._handles.append(layer.register_forward_hook(self._make_hook(i)))
+    for layer in self.layers:
+      xm.offload_to_host(_layer_tensors(layer))
+
+  def _make_pre_hook(self, index):
+
+    def hook(module, inputs):
+      # The layer itself was prefetched by the previous ones, but for the first
+      # one.
+      first = index if index == 0 else index + self.prefetch
+      tensors = []
+      for layer in self.layers[first:index + self.prefetch + 1]:
+        tensors.extend(_layer_tensors(layer))
+      xm.prefetch_to_device(tensors)
+
+    return hook
+
+  def _make_hook(self, index):
+
+    def hook(module, inputs, output):
+      xm.mark_step()
+      xm.offload_to_host(_layer_tensors(module))
+
+    return hook
+
+  def remove(self):
+    """Removes the hooks, leaving the parameters where they are."""
+    for handle in self._handles:
+      handle.remove()
+    self._handles = []
@@ -1,8 +1,11 @@
 from __future__ import division
 from __future__ import print_function
 
+import hashlib
 import os
 import shutil
+import signal
+import threading
 
 import torch
 import torch_xla
@@ -12,8 +15,25 @@ import torch_xla.core.xla_model as xm
 
 class TensorReference(object):
 
-  def __init__(self, tid):
+  def __init__(self, tid, offset=None, dtype=None, shape=None):
     self.tid = tid
+    # Set only for the tensors stored within the mapped tensors file.
+    self.offset = offset
+    self.dtype = dtype
+    self.shape = shape
+
+
+class ShardedTensorReference(object):
+
+  def __init__(self, tid, dtype, shape, offsets, sharding, num_devices):
+    self.tid = tid
+    self.dtype = dtype
+    self.shape = shape
+    # The offsets within the global tensor of the stored slices.
+    self.offsets = offsets
+    # The serialized OpSharding of the tensor, empty if it was not sharded.
+    self.sharding = sharding
+    self.num_devices = num_devices
 
 
 def _get_tensors_folder(path):
@@ -24,11 +44,46 @@ def _get_tensor_file(path, tid):
   return os.path.join(path, 'tensor_{}.pt'.format(tid))
 
 
-def _rewrite_data(path, data, save_tensors):
+def _get_mapped_tensors_file(path):
+  return os.path.join(path, 'tensors.bin')
+
+
+def _get_shard_file(path, tid, index):
+  return os.path.join(path, 'tensor_{}_shard_{}.pt'.format(tid, index))
+
+
+# The alignment of the tensors within the mapped tensors file.
+_MAPPED_TENSOR_ALIGNMENT = 64
+
+
+def _write_mapped_tensors(path, tensors):
+  references = []
+  offset = 0
+  with open(_get_mapped_tensors_file(path), 'wb') as f:
+    for i, t in enumerate(tensors):
+      cpu_tensor = t.cpu().contiguous()
+      padding = -offset % _MAPPED_TENSOR_ALIGNMENT
+      f.write(b'\0' * padding)
+      offset += padding
+      data = cpu_tensor.reshape(-1).view(torch.uint8).numpy()
+      f.write(memoryview(data))
+      references.append(
+          TensorReference(
+              i,
+              offset=offset,
+              dtype=cpu_tensor.dtype,
+              shape=list(cpu_tensor.shape)))
+      offset += data.nbytes
+  return references
+
+
+def _rewrite_data(path, data, save_tensors, mapped=False):
 
   def convert_fn(tensors):
     torch_xla._XLAC._xla_sync_multi(
         tensors, devices=[], wait=True, sync_xla_data=True)
+    if mapped and save_tensors:
+      return _write_mapped_tensors(path, tensors)
     rewritten_tensors = []
     for i, t in enumerate(tensors):
       if save_tensors:
@@ -45,7 +100,7 @@ def _rewrite_data(path, data, save_tensors):
   return xm.ToXlaTensorArena(convert_fn, select_fn).transform(data)
 
 
-def save(data, path, master_only=True, global_master=False):
+def save(data, path, master_only=True, global_master=False, mapped=False):
   """Saves the input data into a file.
 
   The saved data is transferred to PyTorch CPU device before being saved, so a
@@ -69,21 +124,53 @@ def save(data, path, master_only=True, global_master=False):
       controls whether every host's master (if ``global_master`` is ``False``)
       saves the content, or only the global master (ordinal 0).
       Default: False
+    mapped (bool, optional): Whether the tensors should be stored within a
+      single raw file, which `load()` can memory map and upload straight to
+      the devices, without creating intermediate CPU tensors.
+      Default: False
   """
   should_write_data = not master_only or xm.is_master_ordinal(
       local=not global_master)
 
-  ref_data = _rewrite_data(_get_tensors_folder(path), data, should_write_data)
+  ref_data = _rewrite_data(
+      _get_tensors_folder(path), data, should_write_data, mapped=mapped)
   if should_write_data:
     torch.save(ref_data, path)
   xm.rendezvous('torch_xla.utils.serialization.save')
 
 
-def load(path):
+def _load_mapped_tensors(tensor_folder, tensors, device):
+  path = _get_mapped_tensors_file(tensor_folder)
+  if device is not None:
+    meta_tensors = [
+        torch.empty(t.shape, dtype=t.dtype, device='meta') for t in tensors
+    ]
+    return torch_xla._XLAC._xla_load_mapped_tensors(
+        path, [t.offset for t in tensors], meta_tensors,
+        [str(device)] * len(tensors))
+  size = os.path.getsize(path)
+  data = torch.from_file(path, shared=False, size=size, dtype=torch.uint8)
+  rewritten_tensors = []
+  for t in tensors:
+    nbytes = torch.empty((), dtype=t.dtype).element_size()
+    for dim in t.shape:
+      nbytes *= dim
+    rewritten_tensors.append(data[t.offset:t.offset + nbytes].view(
+        t.dtype).reshape(t.shape))
+  return rewritten_tensors
+
+
+def load(path, device=None):
   """Loads data previously saved with the `save()` API.
 
   Args:
     path (str): The path passed to the `save()` API.
+    device (torch.device, optional): If set, and the data was saved with
+      `mapped=True`, the tensors are uploaded straight from the memory mapped
+      tensors file to this device, in bounded size shards (see the
+      `XLA_MAPPED_LOAD_SHARD_BYTES` environment variable). Otherwise the loaded
+      tensors are CPU tensors.
+      Default: None
   Returns:
     The loaded data.
   """
@@ -91,6 +178,9 @@ def load(path):
   tensor_folder = _get_tensors_folder(path)
 
   def convert_fn(tensors):
+    # References pickled by older versions lack the offset attribute.
+    if tensors and getattr(tensors[0], 'offset', None) is not None:
+      return _load_mapped_tensors(tensor_folder, tensors, device)
     rewritten_tensors = []
     for t in tensors:
       rewritten_tensors.append(
@@ -101,3 +191,240 @@ def load(path):
     return type(v) == TensorReference
 
   return xm.ToXlaTensorArena(convert_fn, select_fn).transform(ref_data)
+
+
+def save_sharded(data, path, master_only=True, global_master=False):
+  """Saves the input data, with the tensors stored as the slices of their shards.
+
+  Unlike `save()`, the sharded tensors are never assembled on the host: the
+  shards of one tensor at a time are fetched from their devices in parallel,
+  and every distinct slice is written to its own file, together with its
+  offset within the tensor and the sharding of the tensor. The tensors which
+  are not sharded are stored as a single slice.
+
+  Args:
+    data: The input data to be saved. Any nested combination of Python objects
+      (list, tuples, sets, dicts, ...).
+    path: The destination file for the data saving operation. See `save()`.
+    master_only (bool, optional): See `save()`.
+      Default: True
+    global_master (bool, optional): See `save()`.
+      Default: False
+  """
+  should_write_data = not master_only or xm.is_master_ordinal(
+      local=not global_master)
+  tensor_folder = _get_tensors_folder(path)
+  num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+
+  def convert_fn(tensors):
+    torch_xla._XLAC._xla_sync_multi(
+        tensors, devices=[], wait=True, sync_xla_data=True)
+    rewritten_tensors = []
+    for i, t in enumerate(tensors):
+      offsets, sharding = None, b''
+      if should_write_data:
+        slices, offsets, sharding = torch_xla._XLAC._xla_get_tensor_shards(t)
+        for index, tensor_slice in enumerate(slices):
+          torch.save(tensor_slice, _get_shard_file(tensor_folder, i, index))
+      rewritten_tensors.append(
+          ShardedTensorReference(i, t.dtype, list(t.shape), offsets, sharding,
+                                 num_devices))
+    return rewritten_tensors
+
+  def select_fn(v):
+    return type(v) == torch.Tensor and xm.is_xla_tensor(v)
+
+  if os.path.isdir(tensor_folder):
+    shutil.rmtree(tensor_folder)
+  os.mkdir(tensor_folder)
+  ref_data = xm.ToXlaTensorArena(convert_fn, select_fn).transform(data)
+  if should_write_data:
+    torch.save(ref_data, path)
+  xm.rendezvous('torch_xla.utils.serialization.save_sharded')
+
+
+def _assemble_slices(ref, slices):
+  tensor = torch.empty(ref.shape, dtype=ref.dtype)
+  for offset, tensor_slice in zip(ref.offsets, slices):
+    target = tensor
+    for dim, start in enumerate(offset):
+      target = target.narrow(dim, start, tensor_slice.shape[dim])
+    target.copy_(tensor_slice)
+  return tensor
+
+
+def load_sharded(path, device=None):
+  """Loads data previously saved with the `save_sharded()` API.
+
+  Args:
+    path (str): The path passed to the `save_sharded()` API.
+    device (torch.device, optional): If set, the tensors are restored on this
+      device. The sharded tensors get their slices uploaded straight to the
+      devices holding them, with their saved sharding, when the number of SPMD
+      devices matches the one they were saved with. Otherwise the loaded
+      tensors are assembled on the host.
+      Default: None
+  Returns:
+    The loaded data.
+  """
+  ref_data = torch.load(path)
+  tensor_folder = _get_tensors_folder(path)
+  num_devices = len(torch_xla._XLAC._xla_get_spmd_devices())
+
+  def convert_fn(refs):
+    rewritten_tensors = []
+    for ref in refs:
+      slices = [
+          torch.load(_get_shard_file(tensor_folder, ref.tid, index))
+          for index in range(len(ref.offsets))
+      ]
+      if (device is not None and ref.sharding and
+          ref.num_devices == num_devices):
+        rewritten_tensors.append(
+            torch_xla._XLAC._xla_tensor_from_shards(slices, ref.offsets,
+                                                    ref.sharding, ref.shape,
+                                                    str(device)))
+        continue
+      tensor = _assemble_slices(ref, slices)
+      rewritten_tensors.append(
+          tensor.to(device) if device is not None else tensor)
+    return rewritten_tensors
+
+  def select_fn(v):
+    return type(v) == ShardedTensorReference
+
+  return xm.ToXlaTensorArena(convert_fn, select_fn).transform(ref_data)
+
+
+def _tensor_digest(tensor):
+  data = tensor.contiguous().reshape(-1).view(torch.uint8).numpy()
+  return hashlib.blake2b(memoryview(data), digest_size=16).digest()
+
+
+def _atomic_save(data, path):
+  tmp_path = path + '.tmp'
+  torch.save(data, tmp_path)
+  os.replace(tmp_path, path)
+
+
+class DeviceSnapshotter(object):
+  """Snapshots the device tensors of the training state in the background.
+
+  Every `snapshot_steps` calls to `step()`, which must follow the
+  `xm.mark_step()` of the training step, the device data of the XLA tensors
+  within `data` gets captured, and its transfer to the host starts in the
+  background while the training continues. The captured device buffers are
+  held (so they take device memory) until the transfer completes, but no copy
+  is made on the device.
+
+  Nothing is written to storage until `flush()`, which is also run when the
+  process receives one of the `signals` (like the SIGTERM of a preemption).
+  The flush waits for the latest snapshot and only writes the tensors whose
+  value changed since the previous flush, followed by the file at `path`,
+  which is replaced atomically. The result is read with `load()`, and at any
+  time `path` refers to a complete snapshot.
+
+  Under replication every process snapshots its own data, so the `path`
+  must be different for each of them.
+
+  Args:
+    path (str): The destination file of the snapshot.
+    data: The training state to snapshot. Any nested combination of Python
+      objects (list, tuples, sets, dicts, ...), like a dictionary holding the
+      state dictionaries of the model and the optimizer. Its structure must not
+      change between the snapshots.
+    snapshot_steps (int, optional): The number of steps between two snapshots.
+      Default: 1
+    signals (tuple, optional): The signals which trigger a `flush()`, before
+      being handed to their previous handlers. The handlers can only be set
+      from the main thread.
+      Default: (signal.SIGTERM,)
+  """
+
+  def __init__(self, path, data, snapshot_steps=1, signals=(signal.SIGTERM,)):
+    self.path = path
+    self.data = data
+    self.snapshot_steps = snapshot_steps
+    self._step = 0
+    self._pending = None
+    # The digests and file ids of the tensors written by the last flush.
+    self._digests = dict()
+    self._file_ids = dict()
+    self._lock = threading.RLock()
+    self._tensor_folder = _get_tensors_folder(path)
+    if not os.path.isdir(self._tensor_folder):
+      os.makedirs(self._tensor_folder)
+    self._prev_handlers = dict()
+    for signum in signals:
+      self._prev_handlers[signum] = signal.signal(signum, self._handle_signal)
+
+  def _handle_signal(self, signum, frame):
+    self.flush()
+    prev_handler = self._prev_handlers.get(signum)
+    if callable(prev_handler):
+      prev_handler(signum, frame)
+    elif prev_handler == signal.SIG_DFL:
+      signal.signal(signum, signal.SIG_DFL)
+      os.kill(os.getpid(), signum)
+
+  def snapshot(self):
+    """Starts a snapshot of the device tensors of the data."""
+    fetches = []
+
+    def convert_fn(tensors):
+      fetches.append(torch_xla._XLAC._xla_get_cpu_tensors_async(tensors))
+      return [TensorReference(i) for i in range(len(tensors))]
+
+    def select_fn(v):
+      return type(v) == torch.Tensor and xm.is_xla_tensor(v)
+
+    ref_data = xm.ToXlaTensorArena(convert_fn, select_fn).transform(self.data)
+    with self._lock:
+      # A snapshot not flushed yet is superseded by the new one.
+      self._pending = (self._step, ref_data, fetches[0] if fetches else None)
+
+  def step(self):
+    self._step += 1
+    if self._step % self.snapshot_steps == 0:
+      self.snapshot()
+
+  def flush(self):
+    """Writes the latest snapshot, if any, to storage.
+
+    Returns:
+      The number of tensors written, which is zero for the ones which did not
+      change since the previous flush.
+    """
+    with self._lock:
+      if self._pending is None:
+        return 0
+      step, ref_data, fetch = self._pending
+      self._pending = None
+      tensors = fetch.wait() if fetch is not None else []
+      written = 0
+      digests, file_ids = dict(), dict()
+      for i, tensor in enumerate(tensors):
+        digests[i] = _tensor_digest(tensor)
+        if self._digests.get(i) == digests[i]:
+          file_ids[i] = self._file_ids[i]
+          continue
+        # The files are never overwritten, so that the one at `path` keeps
+        # referring to a complete snapshot until replaced.
+        file_ids[i] = '{}_{}'.format(i, step)
+        torch.save(tensor, _get_tensor_file(self._tensor_folder, file_ids[i]))
+        written += 1
+
+      def convert_fn(refs):
+        return [TensorReference(file_ids[ref.tid]) for ref in refs]
+
+      def select_fn(v):
+        return type(v) == TensorReference
+
+      _atomic_save(
+          xm.ToXlaTensorArena(convert_fn, select_fn).transform(ref_data),
+          self.path)
+      for i, file_id in self._file_ids.items():
+        if file_ids.get(i) != file_id:
+          os.remove(_get_tensor_file(self._tensor_folder, file_id))
+      self._digests, self._file_ids = digests, file_ids
+      return written
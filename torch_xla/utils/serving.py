@@ -0,0 +1,196 @@
+import bisect
+import concurrent.futures
+import threading
+import time
+import torch
+import torch_xla
+import torch_xla.core.xla_model as xm
+import torch_xla.utils.utils as xu
+
+
+class FrozenModel(object):
+  """Runs a fixed model through executables captured once per batch size.
+
+  The graph of the model gets traced, compiled and captured for every batch
+  size, with the model parameters frozen within it as constants, and the
+  executables stay resident. The calls only upload the inputs and run the
+  executable of the smallest batch size fitting them, without tracing, hashing
+  or lowering any graph.
+
+  Args:
+    model_fn (callable): The function running the model, called with the XLA
+      tensors of the inputs, and returning one or more output tensors whose
+      first dimension is the batch one.
+    example_inputs (list): The CPU tensors of an example of the inputs, whose
+      first dimension is the batch one. Only their trailing shapes and types
+      are used.
+    batch_sizes (list): The batch sizes to capture the model graph for.
+    device (torch.device, optional): The device running the model.
+      Default: the current XLA device
+  """
+
+  def __init__(self, model_fn, example_inputs, batch_sizes, device=None):
+    self._device = device if device is not None else xm.xla_device()
+    self._batch_sizes = sorted(set(batch_sizes))
+    self._example_inputs = xu.as_list(example_inputs)
+    self._graphs = []
+    with torch.no_grad():
+      for batch_size in self._batch_sizes:
+        inputs = [
+            x.to(self._device) for x in self._make_inputs(batch_size, [])
+        ]
+        xm.unlazy(inputs)
+        outputs = xu.as_list(model_fn(*inputs))
+        graph_id = torch_xla._XLAC._xla_capture_graph(outputs, inputs)
+        torch_xla._XLAC._xla_freeze_graph(graph_id)
+        self._graphs.append(graph_id)
+
+  @property
+  def batch_sizes(self):
+    return self._batch_sizes
+
+  @property
+  def max_batch_size(self):
+    return self._batch_sizes[-1]
+
+  def _make_inputs(self, batch_size, inputs):
+    # Pads the inputs with zeros up to batch_size.
+    padded = []
+    for i, example in enumerate(self._example_inputs):
+      size = inputs[i].size(0) if inputs else 0
+      padding = torch.zeros((batch_size - size,) + tuple(example.shape[1:]),
+                            dtype=example.dtype)
+      padded.append(torch.cat([inputs[i], padding]) if size else padding)
+    return padded
+
+  def __call__(self, *inputs):
+    """Runs the model over the CPU tensors of the inputs.
+
+    Returns:
+      The CPU tensors of the outputs.
+    """
+    batch_size = inputs[0].size(0)
+    index = bisect.bisect_left(self._batch_sizes, batch_size)
+    if index >= len(self._batch_sizes):
+      raise ValueError(
+          'Batch size {} exceeds the largest captured one {}'.format(
+              batch_size, self.max_batch_size))
+    padded = self._make_inputs(self._batch_sizes[index], list(inputs))
+    outputs = torch_xla._XLAC._xla_replay_graph(
+        self._graphs[index], [x.to(self._device) for x in padded])
+    # The slicing runs on the host copies, so that the padded batch sizes do
+    # not trace device graphs of their own.
+    outputs = [x.cpu()[:batch_size] for x in outputs]
+    return outputs[0] if len(outputs) == 1 else tuple(outputs)
+
+  def release(self):
+    """Releases the executables of the captured graphs."""
+    for graph_id in self._graphs:
+      torch_xla._XLAC._xla_unfreeze_graph(graph_id)
+    self._graphs = []
+
+
+class DynamicBatcher(object):
+  """Coalesces the concurrent requests to a `FrozenModel` into batches.
+
+  The requests are queued, and a worker thread runs them in batches of up to
+  the largest captured batch size, waiting at most `max_delay` seconds after
+  the first queued request for more of them to show up.
+
+  Args:
+    model (FrozenModel): The model running the batches.
+    max_delay (float, optional): The time, in seconds, the first request of a
+      batch waits for the others.
+      Default: 0.005
+  """
+
+  def __init__(self, model, max_delay=0.005):
+    self._model = model
+    self._max_delay = max_delay
+    self._lock = threading.Condition()
+    self._requests = []
+    self._closed = False
+    self._thread = threading.Thread(target=self._run, daemon=True)
+    self._thread.start()
+
+  def submit(self, *inputs):
+    """Queues a request.
+
+    Args:
+      inputs: The CPU tensors of the request inputs, with their batch
+        dimension.
+    Returns:
+      A `concurrent.futures.Future` holding the CPU tensors of the outputs of
+      the request.
+    """
+    if inputs[0].size(0) > self._model.max_batch_size:
+      raise ValueError('Request batch size {} exceeds the largest captured one '
+                       '{}'.format(inputs[0].size(0),
+                                   self._model.max_batch_size))
+    future = concurrent.futures.Future()
+    with self._lock:
+      if self._closed:
+        raise RuntimeError('The batcher is closed')
+      self._requests.append((inputs, future))
+      self._lock.notify()
+    return future
+
+  def close(self):
+    """Runs the queued requests, and stops the worker thread."""
+    with self._lock:
+      self._closed = True
+      self._lock.notify()
+    self._thread.join()
+
+  def _take_batch(self):
+    with self._lock:
+      while not self._requests and not self._closed:
+        self._lock.wait()
+      if not self._requests:
+        return None
+      deadline = time.time() + self._max_delay
+      max_batch_size = self._model.max_batch_size
+      while not self._closed and self._queued_size() < max_batch_size:
+        timeout = deadline - time.time()
+        if timeout <= 0:
+          break
+        self._lock.wait(timeout)
+      end = self._batch_end()
+      batch = self._requests[:end]
+      self._requests = self._requests[end:]
+      return batch
+
+  def _queued_size(self):
+    return sum(inputs[0].size(0) for inputs, _ in self._requests)
+
+  def _batch_end(self):
+    # The number of queued requests fitting the largest batch size.
+    size = 0
+    for i, (inputs, _) in enumerate(self._requests):
+      size += inputs[0].size(0)
+      if size > self._model.max_batch_size:
+        return i
+    return len(self._requests)
+
+  def _run(self):
+    while True:
+      batch = self._take_batch()
+      if batch is None:
+        break
+      try:
+        num_inputs = len(batch[0][0])
+        inputs = [
+            torch.cat([request[0][i] for request in batch])
+            for i in range(num_inputs)
+        ]
+        outputs = xu.as_list(self._model(*inputs))
+        start = 0
+        for request_inputs, future in batch:
+          size = request_inputs[0].size(0)
+          results = [x[start:start + size] for x in outputs]
+          future.set_result(results[0] if len(results) == 1 else tuple(results))
+          start += size
+      except Exception as e:
+        for _, future in batch:
+          if not future.done():
+            future.set_exception(e)
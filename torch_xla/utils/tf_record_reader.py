@@ -51,6 +51,44 @@ class TfRecordReader(object):
       return ex
     return self._transform_example(ex)
 
+  def read_examples(self, batch_size, device=None):
+    """Reads a batch of TfExamples, parsed in parallel.
+
+    Args:
+      batch_size (int): The maximum number of examples to read. Fewer are
+        returned only at the end of the file.
+      device (string, optional): If set, the stacked features are uploaded to
+        this XLA device (like ``xla:0``).
+        Default: None
+
+    Returns:
+      In case of EOF returns ``None``, otherwise a dictionary whose keys are the
+      feature names. The features with the same number of values (or bytes) in
+      all the examples are stacked into ``[examples, values]`` tensors, the
+      others are lists with the values of every example, as returned by
+      `read_example()`.
+    """
+    ex = torch_xla._XLAC._xla_tfexample_read_batch(
+        self._reader, batch_size, device=str(device) if device else '')
+    if self._transforms is None or ex is None:
+      return ex
+    return self._transform_batch(ex)
+
+  def _transform_batch(self, ex):
+    for lbl, data in ex.items():
+      trs = self._transforms.get(lbl, None)
+      if trs is not None:
+        if callable(trs):
+          ex[lbl] = trs(data)
+        elif trs == 'STR':
+          rows = data if isinstance(data, list) else data.cpu()
+          ex[lbl] = [
+              row.numpy().tobytes().decode('ascii') for row in rows
+          ]
+        else:
+          raise RuntimeError('Invalid transform: {}'.format(trs))
+    return ex
+
   def _transform_example(self, ex):
     for lbl, data in ex.items():
       trs = self._transforms.get(lbl, None)
@@ -62,3 +100,53 @@ class TfRecordReader(object):
         else:
           raise RuntimeError('Invalid transform: {}'.format(trs))
     return ex
+
+
+class TfRecordInterleavedReader(TfRecordReader):
+  """Reads TfRecords or TfExamples from many files, interleaved.
+
+  Up to ``parallelism`` files are read at the same time, in background, each
+  keeping up to ``readahead`` records buffered, which is what it takes to
+  saturate the network with the GCS backed datasets.
+
+  Args:
+    paths (list): The paths of the files containing TfRecords.
+    compression (string, optional): The compression type. The empty string for
+      no compression, otherwise ``ZLIB`` or ``GZIP``.
+      Default: No compression.
+    buffer_size (int, optional): The size of the read buffer of every open
+      file.
+      Default: 16 * 1024 * 1024
+    parallelism (int, optional): The number of files read at the same time.
+      Default: 4
+    readahead (int, optional): The number of records buffered for every open
+      file.
+      Default: 64
+    shuffle (bool, optional): If ``False``, the records are taken round robin
+      from the open files, in the order of the list. If ``True``, the files
+      are read in an order shuffled with ``seed``, and the records are taken
+      from whichever open file has them ready.
+      Default: False
+    seed (int, optional): The seed of the file shuffling.
+      Default: 0
+    transforms (dict, optional): Like for `TfRecordReader`.
+  """
+
+  def __init__(self,
+               paths,
+               compression='',
+               buffer_size=16 * 1024 * 1024,
+               parallelism=4,
+               readahead=64,
+               shuffle=False,
+               seed=0,
+               transforms=None):
+    self._reader = torch_xla._XLAC._xla_create_tfrecord_interleaved_reader(
+        list(paths),
+        compression=compression,
+        buffer_size=buffer_size,
+        parallelism=parallelism,
+        readahead=readahead,
+        shuffle=shuffle,
+        seed=seed)
+    self._transforms = transforms